@@ -94,6 +94,12 @@ ipcmem__parse_ident(const char *ident,
 				type_code = 'd';
 				unitsz = sizeof(int64_t);
 			}
+			else if (strcmp(pos, "arrow") == 0)
+			{
+				/* columnar layout; see the 'columns' token */
+				type_code = 'A';
+				unitsz = 1;
+			}
 			else
 			{
 				PyErr_Format(PyExc_TypeError,
@@ -137,6 +143,16 @@ ipcmem__parse_ident(const char *ident,
 			/* just ignore the attributes */
 			mask |= 0x0040;
 		}
+		else if (strcmp(tok, "columns") == 0)
+		{
+			/* layout of the columnar format; parsed by the caller */
+			mask |= 0x0080;
+		}
+		else if (strcmp(tok, "rb_range") == 0)
+		{
+			/* just ignore the attributes */
+			mask |= 0x0100;
+		}
 		else
 		{
 			PyErr_Format(PyExc_ValueError, "unexpected token [%s]", tok);
@@ -1,4 +1,5 @@
 import cython
+import threading
 import numpy
 import cupy
 	
@@ -54,3 +55,116 @@ def ipc_import(str token):
 						cupy.cuda.memory.MemoryPointer(ipcMem, 0),
 						None,
 						'C')
+
+def ipc_import_columns(str token):
+	"""
+	It opens the GPU buffer exported by pgstrom.arrow_fdw_export_columns(),
+	then returns a list of (values, nullmap) for each column.
+	'values' is cupy.ndarray of the column's own dtype, and 'nullmap' is
+	cupy.ndarray of uint8 that is a validity bitmap in Arrow's bit order
+	(LSB first). Both support __cuda_array_interface__ and DLPack (toDlpack),
+	so PyTorch or RAPIDS can consume them without copy.
+	"""
+	ipcMem = IpcMemory()
+	ipcMem.open(token)
+	columns = None
+	for tok in token.split(','):
+		if tok.startswith('columns='):
+			columns = tok[len('columns='):].split(' ')
+	if ipcMem.cupy_type_code != 'A' or columns is None:
+		raise ValueError("GPU buffer is not in the columnar format")
+	nitems = ipcMem.cupy_nitems
+	results = []
+	for col in columns:
+		dtype, nullmap_offset, values_offset = col.split(':')
+		values = cupy.ndarray([nitems],
+							  numpy.dtype(dtype),
+							  cupy.cuda.memory.MemoryPointer(ipcMem, int(values_offset)),
+							  None,
+							  'C')
+		nullmap = cupy.ndarray([(nitems + 7) // 8],
+							   numpy.uint8,
+							   cupy.cuda.memory.MemoryPointer(ipcMem, int(nullmap_offset)),
+							   None,
+							   'C')
+		results.append((values, nullmap))
+	return results
+
+class BatchIterator:
+	"""
+	It iterates a foreign table batch-by-batch; each batch consists of
+	'batch_size' RecordBatches exported by
+	pgstrom.arrow_fdw_export_columns_batch(), and is returned in the same
+	form as ipc_import_columns(). The next batch is loaded on the server
+	side while the caller consumes the current one, then the previous batch
+	is released; so arrays of a batch are valid until the next iteration.
+	"""
+	def __init__(self, conn, str table, columns=None,
+				 int batch_size=1, device_id=None):
+		if batch_size < 1:
+			raise ValueError("batch_size must be positive")
+		self.conn = conn
+		self.table = table
+		self.columns = columns
+		self.batch_size = batch_size
+		self.device_id = device_id
+		self.rb_begin = 0
+		self.curr_ident = None
+		self.next_ident = None
+		self.next_error = None
+		self.worker = None
+		self.__prefetch()
+
+	def __load(self, int rb_begin):
+		try:
+			curr = self.conn.cursor()
+			curr.execute("SELECT pgstrom.arrow_fdw_export_columns_batch("
+						 "%s::regclass, %s, %s, %s, %s)",
+						 (self.table, rb_begin, self.batch_size,
+						  self.columns, self.device_id))
+			self.next_ident = curr.fetchone()[0]
+			curr.close()
+		except Exception as e:
+			self.next_error = e
+
+	def __prefetch(self):
+		self.next_ident = None
+		self.next_error = None
+		self.worker = threading.Thread(target=self.__load,
+									   args=(self.rb_begin,))
+		self.worker.start()
+		self.rb_begin += self.batch_size
+
+	def __release(self):
+		if self.curr_ident is not None:
+			curr = self.conn.cursor()
+			curr.execute("SELECT pgstrom.arrow_fdw_put_gpu_buffer(%s)",
+						 (self.curr_ident,))
+			curr.close()
+			self.curr_ident = None
+
+	def __iter__(self):
+		return self
+
+	def __next__(self):
+		if self.worker is None:
+			raise StopIteration
+		self.worker.join()
+		self.worker = None
+		if self.next_error is not None:
+			raise self.next_error
+		self.__release()
+		if self.next_ident is None:
+			raise StopIteration
+		self.curr_ident = self.next_ident
+		self.__prefetch()
+		return ipc_import_columns(self.curr_ident)
+
+	def close(self):
+		if self.worker is not None:
+			self.worker.join()
+			self.worker = None
+			pending = self.next_ident
+			self.__release()
+			self.curr_ident = pending
+		self.__release()
@@ -20,6 +20,12 @@ CREATE OR REPLACE FUNCTION pgstrom.arrow_fdw_truncate(regclass)
   AS 'MODULE_PATHNAME','pgstrom_arrow_fdw_truncate'
   LANGUAGE C STRICT;
 
+CREATE OR REPLACE FUNCTION
+pgstrom.arrow_fdw_compact(regclass, bigint = null)
+  RETURNS int
+  AS 'MODULE_PATHNAME','pgstrom_arrow_fdw_compact'
+  LANGUAGE C CALLED ON NULL INPUT;
+
 CREATE OR REPLACE FUNCTION
 pgstrom.arrow_fdw_export_cupy(regclass, text[] = null, int = null)
   RETURNS text
@@ -32,6 +38,25 @@ pgstrom.arrow_fdw_export_cupy_pinned(regclass, text[] = null, int = null)
   AS 'MODULE_PATHNAME','pgstrom_arrow_fdw_export_cupy_pinned'
   LANGUAGE C CALLED ON NULL INPUT;
 
+CREATE OR REPLACE FUNCTION
+pgstrom.arrow_fdw_export_columns(regclass, text[] = null, int = null)
+  RETURNS text
+  AS 'MODULE_PATHNAME','pgstrom_arrow_fdw_export_columns'
+  LANGUAGE C CALLED ON NULL INPUT;
+
+CREATE OR REPLACE FUNCTION
+pgstrom.arrow_fdw_export_columns_pinned(regclass, text[] = null, int = null)
+  RETURNS text
+  AS 'MODULE_PATHNAME','pgstrom_arrow_fdw_export_columns_pinned'
+  LANGUAGE C CALLED ON NULL INPUT;
+
+CREATE OR REPLACE FUNCTION
+pgstrom.arrow_fdw_export_columns_batch(regclass, int, int,
+                                       text[] = null, int = null)
+  RETURNS text
+  AS 'MODULE_PATHNAME','pgstrom_arrow_fdw_export_columns_batch'
+  LANGUAGE C CALLED ON NULL INPUT;
+
 CREATE OR REPLACE FUNCTION
 pgstrom.arrow_fdw_unpin_gpu_buffer(text)
   RETURNS bool
@@ -44,6 +69,468 @@ pgstrom.arrow_fdw_put_gpu_buffer(text)
   AS 'MODULE_PATHNAME','pgstrom_arrow_fdw_put_gpu_buffer'
   LANGUAGE C STRICT;
 
+CREATE TYPE pgstrom.__arrow_fdw_gpu_buffer_info AS (
+  ident     text,
+  device_nr int4,
+  table_oid regclass,
+  format    text,
+  length    int8,
+  nitems    int8,
+  pinned    bool,
+  refcnt    int4,
+  last_used timestamp with time zone
+);
+CREATE FUNCTION pgstrom.arrow_fdw_gpu_buffer_info()
+  RETURNS SETOF pgstrom.__arrow_fdw_gpu_buffer_info
+  AS 'MODULE_PATHNAME','pgstrom_arrow_fdw_gpu_buffer_info'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.arrow_fdw_gpu_buffers
+  AS SELECT * FROM pgstrom.arrow_fdw_gpu_buffer_info();
+
+--
+-- HyperLogLog approximate distinct count
+--
+CREATE FUNCTION pgstrom.hll_count_accum(bytea, anyelement)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_count_accum'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_count_merge(bytea, bytea)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','pgstrom_hll_count_merge'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.hll_count_final(bytea)
+  RETURNS bigint
+  AS 'MODULE_PATHNAME','pgstrom_hll_count_final'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.hll_count(anyelement)
+(
+  sfunc = pgstrom.hll_count_accum,
+  stype = bytea,
+  finalfunc = pgstrom.hll_count_final,
+  combinefunc = pgstrom.hll_count_merge,
+  parallel = safe
+);
+
+--
+-- Approximate percentile based on the histogram
+--
+CREATE FUNCTION pgstrom.approx_percentile_bucket(float8)
+  RETURNS int4
+  AS 'MODULE_PATHNAME','pgstrom_approx_percentile_bucket'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.approx_percentile_accum(internal, float8, float8)
+  RETURNS internal
+  AS 'MODULE_PATHNAME','pgstrom_approx_percentile_accum'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.fpercentile_accum(internal, int4, int8, float8)
+  RETURNS internal
+  AS 'MODULE_PATHNAME','pgstrom_fpercentile_accum'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.approx_percentile_final(internal)
+  RETURNS float8
+  AS 'MODULE_PATHNAME','pgstrom_approx_percentile_final'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.approx_percentile(float8, float8)
+(
+  sfunc = pgstrom.approx_percentile_accum,
+  stype = internal,
+  finalfunc = pgstrom.approx_percentile_final,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.fpercentile(int4, int8, float8)
+(
+  sfunc = pgstrom.fpercentile_accum,
+  stype = internal,
+  finalfunc = pgstrom.approx_percentile_final,
+  parallel = safe
+);
+
+--
+-- Exact numeric sum/avg by the scaled integers
+--
+CREATE FUNCTION pgstrom.numeric_scaled_hi(numeric, int4)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_numeric_scaled_hi'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.numeric_scaled_lo(numeric, int4)
+  RETURNS int8
+  AS 'MODULE_PATHNAME','pgstrom_numeric_scaled_lo'
+  LANGUAGE C STRICT IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.pnumeric_exact(int8, int8, int8, int4)
+  RETURNS int8[]
+  AS 'MODULE_PATHNAME','pgstrom_partial_numeric_exact'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.fnumeric_exact_accum(internal, int8[])
+  RETURNS internal
+  AS 'MODULE_PATHNAME','pgstrom_fnumeric_exact_accum'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.fsum_numeric_exact_final(internal)
+  RETURNS numeric
+  AS 'MODULE_PATHNAME','pgstrom_fsum_numeric_exact_final'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.favg_numeric_exact_final(internal)
+  RETURNS numeric
+  AS 'MODULE_PATHNAME','pgstrom_favg_numeric_exact_final'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.fsum_numeric_exact(int8[])
+(
+  sfunc = pgstrom.fnumeric_exact_accum,
+  stype = internal,
+  finalfunc = pgstrom.fsum_numeric_exact_final,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.favg_numeric_exact(int8[])
+(
+  sfunc = pgstrom.fnumeric_exact_accum,
+  stype = internal,
+  finalfunc = pgstrom.favg_numeric_exact_final,
+  parallel = safe
+);
+
+--
+-- Final MIN/MAX of float2 partial results (accumulated as float4)
+--
+CREATE AGGREGATE pgstrom.fmin_float2(float4)
+(
+  sfunc = pg_catalog.float4smaller,
+  stype = float4,
+  finalfunc = pgstrom.float2,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.fmax_float2(float4)
+(
+  sfunc = pg_catalog.float4larger,
+  stype = float4,
+  finalfunc = pgstrom.float2,
+  parallel = safe
+);
+
+--
+-- Preserved GPU device memory with last-access time and references
+--
+DROP VIEW IF EXISTS pgstrom.device_preserved_meminfo;
+DROP FUNCTION IF EXISTS pgstrom.pgstrom_device_preserved_meminfo();
+DROP TYPE IF EXISTS pgstrom.__pgstrom_device_preserved_meminfo;
+CREATE TYPE pgstrom.__pgstrom_device_preserved_meminfo AS (
+  device_nr int4,
+  handle    bytea,
+  owner     regrole,
+  length    int8,
+  ctime     timestamp with time zone,
+  atime     timestamp with time zone,
+  evictable bool,
+  refcnt    int4
+);
+CREATE FUNCTION pgstrom.pgstrom_device_preserved_meminfo()
+  RETURNS SETOF pgstrom.__pgstrom_device_preserved_meminfo
+  AS 'MODULE_PATHNAME'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.device_preserved_meminfo
+  AS SELECT * FROM pgstrom.pgstrom_device_preserved_meminfo();
+
+--
+-- Statistics of the GPU program cache
+--
+CREATE TYPE pgstrom.__program_cache_info AS (
+  program_id  int8,
+  crc         int8,
+  target_cc   int4,
+  extra_flags int4,
+  length      int8,
+  refcnt      int4,
+  status      text,
+  has_cubin   bool,
+  build_time  float8,
+  ctime       timestamp with time zone,
+  atime       timestamp with time zone,
+  nhits       int8
+);
+CREATE FUNCTION pgstrom.program_cache_info()
+  RETURNS SETOF pgstrom.__program_cache_info
+  AS 'MODULE_PATHNAME','pgstrom_program_cache_info'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.program_cache
+  AS SELECT * FROM pgstrom.program_cache_info();
+
+CREATE TYPE pgstrom.__program_cache_stats AS (
+  cache_size         int8,
+  cache_usage        int8,
+  num_entries        int4,
+  num_hits           int8,
+  num_misses         int8,
+  num_evictions      int8,
+  num_builds         int8,
+  num_build_failures int8,
+  build_queue        int4,
+  build_time_avg     float8,
+  build_time_hist    int8[]
+);
+CREATE FUNCTION pgstrom.program_cache_global_info()
+  RETURNS pgstrom.__program_cache_stats
+  AS 'MODULE_PATHNAME','pgstrom_program_cache_stats'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.program_cache_stats
+  AS SELECT * FROM pgstrom.program_cache_global_info();
+
+--
+-- Statistics of SSD2GPU I/O per block device, role and GPU
+--
+CREATE TYPE pgstrom.__nvme_io_stats AS (
+  kind           text,
+  name           text,
+  inflight_bytes int8,
+  total_bytes    int8,
+  total_requests int8,
+  total_wait     float8
+);
+CREATE FUNCTION pgstrom.nvme_io_stats_info()
+  RETURNS SETOF pgstrom.__nvme_io_stats
+  AS 'MODULE_PATHNAME','pgstrom_nvme_io_stats'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.nvme_io_stats
+  AS SELECT * FROM pgstrom.nvme_io_stats_info();
+
+--
+-- Cumulative statistics of GpuTasks per device and per statement
+--
+CREATE TYPE pgstrom.__stat_gpu_device AS (
+  gpu_id         int4,
+  gpu_name       text,
+  tasks          int8,
+  fallbacks      int8,
+  oom_retries    int8,
+  gpu_time       float8,
+  kernel_time    float8,
+  h2d_bytes      int8,
+  d2h_bytes      int8,
+  ssd2gpu_bytes  int8,
+  mem_total      int8,
+  mem_usage      int8,
+  mem_peak       int8,
+  stats_reset    timestamptz
+);
+CREATE FUNCTION pgstrom.stat_gpu_device_info()
+  RETURNS SETOF pgstrom.__stat_gpu_device
+  AS 'MODULE_PATHNAME','pgstrom_stat_gpu_device'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.stat_gpu_device
+  AS SELECT * FROM pgstrom.stat_gpu_device_info();
+
+CREATE TYPE pgstrom.__stat_gpu_statements AS (
+  queryid        int8,
+  tasks          int8,
+  fallbacks      int8,
+  oom_retries    int8,
+  gpu_time       float8,
+  kernel_time    float8,
+  h2d_bytes      int8,
+  d2h_bytes      int8
+);
+CREATE FUNCTION pgstrom.stat_gpu_statements_info()
+  RETURNS SETOF pgstrom.__stat_gpu_statements
+  AS 'MODULE_PATHNAME','pgstrom_stat_gpu_statements'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.stat_gpu_statements
+  AS SELECT * FROM pgstrom.stat_gpu_statements_info();
+
+CREATE FUNCTION pgstrom.stat_gpu_reset()
+  RETURNS void
+  AS 'MODULE_PATHNAME','pgstrom_stat_gpu_reset'
+  LANGUAGE C VOLATILE;
+
+--
+-- Recent rejections of device expressions
+--
+CREATE TYPE pgstrom.__device_expression_rejects AS (
+  func           regprocedure,
+  type           regtype,
+  reason         text,
+  location       text,
+  count          int8,
+  last_time      timestamptz,
+  seqno          int8
+);
+CREATE FUNCTION pgstrom.device_expression_rejects_info()
+  RETURNS SETOF pgstrom.__device_expression_rejects
+  AS 'MODULE_PATHNAME','pgstrom_device_expression_rejects'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.device_expression_rejects
+  AS SELECT * FROM pgstrom.device_expression_rejects_info();
+
+--
+-- User defined device functions
+--
+CREATE TABLE pgstrom.device_functions (
+  func_oid       regprocedure PRIMARY KEY,
+  func_devcost   int4 NOT NULL DEFAULT 1,
+  func_source    text NOT NULL
+);
+SELECT pg_catalog.pg_extension_config_dump('pgstrom.device_functions', '');
+
+CREATE FUNCTION pgstrom.device_functions_invalidate()
+  RETURNS trigger
+  AS 'MODULE_PATHNAME','pgstrom_device_functions_invalidate'
+  LANGUAGE C;
+CREATE TRIGGER device_functions_invalidate
+  AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON pgstrom.device_functions
+  FOR EACH STATEMENT EXECUTE PROCEDURE pgstrom.device_functions_invalidate();
+
+--
+-- Live state of GpuContexts in the system
+--
+CREATE TYPE pgstrom.__gpu_activity AS (
+  pid            int4,
+  device         int4,
+  pending        int4,
+  running        int4,
+  inflight       int4,
+  max_async      int4,
+  completed      int8,
+  program_id     int8,
+  mem_normal     int8,
+  mem_managed    int8,
+  mem_iomap      int8,
+  mem_hostmem    int8,
+  mem_segments   int4,
+  mem_free       int8,
+  mem_free_chunks int4[],
+  worker_states  text[]
+);
+CREATE FUNCTION pgstrom.gpu_activity()
+  RETURNS SETOF pgstrom.__gpu_activity
+  AS 'MODULE_PATHNAME','pgstrom_gpu_activity'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.gpu_activity
+  AS SELECT * FROM pgstrom.gpu_activity();
+
+--
+-- Calibration and runtime feedback of the GPU cost model
+--
+CREATE TYPE pgstrom.__gpu_cost_calibrate AS (
+  device         int4,
+  parameter      text,
+  current        float8,
+  recommended    float8,
+  measured_us    float8
+);
+CREATE FUNCTION pgstrom.gpu_cost_calibrate(int4 = NULL)
+  RETURNS SETOF pgstrom.__gpu_cost_calibrate
+  AS 'MODULE_PATHNAME','pgstrom_gpu_cost_calibrate'
+  LANGUAGE C CALLED ON NULL INPUT VOLATILE;
+
+CREATE TYPE pgstrom.__gpu_cost_feedback AS (
+  task           text,
+  plans          int8,
+  est_cost       float8,
+  actual_ms      float8,
+  cost_ratio     float8,
+  applied        float8,
+  calibrated     timestamptz
+);
+CREATE FUNCTION pgstrom.gpu_cost_feedback_info()
+  RETURNS SETOF pgstrom.__gpu_cost_feedback
+  AS 'MODULE_PATHNAME','pgstrom_gpu_cost_feedback_info'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.gpu_cost_feedback
+  AS SELECT * FROM pgstrom.gpu_cost_feedback_info();
+
+--
+-- Query results in Apache Arrow format
+--
+CREATE FUNCTION pgstrom.arrow_query(text,             -- query string
+                                    bigint = NULL)    -- max rows per chunk
+  RETURNS SETOF bytea
+  AS 'MODULE_PATHNAME','pgstrom_arrow_query'
+  LANGUAGE C CALLED ON NULL INPUT VOLATILE;
+
+--
+-- Bulk test data generation
+--
+CREATE FUNCTION pgstrom.random_fill(regclass,     -- target table
+                                    bigint,       -- number of rows
+                                    float=0.0)    -- NULL ratio (%)
+  RETURNS bigint
+  AS 'MODULE_PATHNAME','pgstrom_random_fill'
+  LANGUAGE C STRICT VOLATILE;
+
+--
+-- Columnar cache support
+--
+CREATE OR REPLACE FUNCTION pgstrom.ccache_invalidator()
+  RETURNS trigger
+  AS 'MODULE_PATHNAME','pgstrom_ccache_invalidator'
+  LANGUAGE C STRICT;
+
+CREATE OR REPLACE FUNCTION pgstrom.ccache_enabled(regclass, text[] = NULL)
+  RETURNS text
+AS $$
+DECLARE
+  attnames text := '';
+BEGIN
+  IF $2 IS NOT NULL THEN
+    SELECT string_agg(quote_literal(x), ',') INTO attnames FROM unnest($2) x;
+  END IF;
+  EXECUTE format('CREATE TRIGGER __pgstrom_ccache_row '
+                 'AFTER INSERT OR UPDATE OR DELETE ON %s '
+                 'FOR EACH ROW EXECUTE PROCEDURE '
+                 'pgstrom.ccache_invalidator(%s)', $1, attnames);
+  EXECUTE format('CREATE TRIGGER __pgstrom_ccache_stmt '
+                 'AFTER TRUNCATE ON %s '
+                 'FOR EACH STATEMENT EXECUTE PROCEDURE '
+                 'pgstrom.ccache_invalidator()', $1);
+  EXECUTE format('ALTER TABLE %s ENABLE ALWAYS TRIGGER __pgstrom_ccache_row', $1);
+  EXECUTE format('ALTER TABLE %s ENABLE ALWAYS TRIGGER __pgstrom_ccache_stmt', $1);
+  RETURN 'enabled';
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION pgstrom.ccache_disabled(regclass)
+  RETURNS text
+AS $$
+BEGIN
+  EXECUTE format('DROP TRIGGER IF EXISTS __pgstrom_ccache_row ON %s', $1);
+  EXECUTE format('DROP TRIGGER IF EXISTS __pgstrom_ccache_stmt ON %s', $1);
+  RETURN 'disabled';
+END;
+$$ LANGUAGE plpgsql STRICT;
+
+CREATE OR REPLACE FUNCTION pgstrom.ccache_prewarm(regclass)
+  RETURNS int4
+  AS 'MODULE_PATHNAME','pgstrom_ccache_prewarm'
+  LANGUAGE C STRICT;
+
+CREATE TYPE pgstrom.__ccache_info AS (
+  database_id oid,
+  table_id    regclass,
+  block_nr    int4,
+  nitems      int8,
+  length      int8,
+  ctime       timestamp with time zone,
+  atime       timestamp with time zone
+);
+CREATE FUNCTION pgstrom.ccache_chunk_info()
+  RETURNS SETOF pgstrom.__ccache_info
+  AS 'MODULE_PATHNAME','pgstrom_ccache_info'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.ccache_info
+  AS SELECT * FROM pgstrom.ccache_chunk_info();
+
 --
 -- Drop Gstore_Fdw support functions (deprecated)
 --
@@ -46,6 +46,19 @@ Datum pgstrom_float8_stddev_samp_numeric(PG_FUNCTION_ARGS);
 Datum pgstrom_float8_stddev_pop_numeric(PG_FUNCTION_ARGS);
 Datum pgstrom_float8_var_samp_numeric(PG_FUNCTION_ARGS);
 Datum pgstrom_float8_var_pop_numeric(PG_FUNCTION_ARGS);
+Datum pgstrom_hll_count_accum(PG_FUNCTION_ARGS);
+Datum pgstrom_hll_count_merge(PG_FUNCTION_ARGS);
+Datum pgstrom_hll_count_final(PG_FUNCTION_ARGS);
+Datum pgstrom_approx_percentile_bucket(PG_FUNCTION_ARGS);
+Datum pgstrom_approx_percentile_accum(PG_FUNCTION_ARGS);
+Datum pgstrom_fpercentile_accum(PG_FUNCTION_ARGS);
+Datum pgstrom_approx_percentile_final(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_scaled_hi(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_scaled_lo(PG_FUNCTION_ARGS);
+Datum pgstrom_partial_numeric_exact(PG_FUNCTION_ARGS);
+Datum pgstrom_fnumeric_exact_accum(PG_FUNCTION_ARGS);
+Datum pgstrom_fsum_numeric_exact_final(PG_FUNCTION_ARGS);
+Datum pgstrom_favg_numeric_exact_final(PG_FUNCTION_ARGS);
 
 /* utility to reference numeric[] */
 static inline Datum
@@ -429,3 +442,473 @@ pgstrom_float8_var_pop_numeric(PG_FUNCTION_ARGS)
 	PG_RETURN_NUMERIC(DirectFunctionCall1(float8_numeric, datum));
 }
 PG_FUNCTION_INFO_V1(pgstrom_float8_var_pop_numeric);
+
+/*
+ * HyperLogLog approximate distinct count
+ *
+ * The transition state is a bytea that contains HLL_NUM_REGISTERS of
+ * 8bit registers. Because HLL is insensitive to duplicated inputs,
+ * GpuPreAgg eliminates duplicated values per group on the device side
+ * prior to the final aggregation; see make_distinct_aggref().
+ */
+#define HLL_REGISTER_BITS		12
+#define HLL_NUM_REGISTERS		(1U << HLL_REGISTER_BITS)
+
+static inline void
+__hll_count_update(cl_uchar *hll_regs, cl_ulong hash)
+{
+	cl_uint		index = (hash >> (64 - HLL_REGISTER_BITS));
+	cl_ulong	bits = (hash << HLL_REGISTER_BITS);
+	cl_uchar	rho = 1;
+
+	while (rho <= 64 - HLL_REGISTER_BITS &&
+		   (bits & (1UL << 63)) == 0)
+	{
+		bits <<= 1;
+		rho++;
+	}
+	if (hll_regs[index] < rho)
+		hll_regs[index] = rho;
+}
+
+Datum
+pgstrom_hll_count_accum(PG_FUNCTION_ARGS)
+{
+	MemoryContext	aggcxt;
+	bytea		   *hll_state;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (PG_ARGISNULL(0))
+	{
+		hll_state = MemoryContextAllocZero(aggcxt, VARHDRSZ +
+										   HLL_NUM_REGISTERS);
+		SET_VARSIZE(hll_state, VARHDRSZ + HLL_NUM_REGISTERS);
+	}
+	else
+		hll_state = PG_GETARG_BYTEA_P(0);
+
+	if (!PG_ARGISNULL(1))
+	{
+		FmgrInfo   *hash_finfo = fcinfo->flinfo->fn_extra;
+		cl_ulong	hash;
+
+		if (!hash_finfo)
+		{
+			Oid				type_oid = get_fn_expr_argtype(fcinfo->flinfo, 1);
+			TypeCacheEntry *tcache;
+
+			hash_finfo = MemoryContextAllocZero(fcinfo->flinfo->fn_mcxt,
+												sizeof(FmgrInfo));
+#if PG_VERSION_NUM >= 110000
+			tcache = lookup_type_cache(type_oid,
+									   TYPECACHE_HASH_EXTENDED_PROC);
+			if (!OidIsValid(tcache->hash_extended_proc))
+				elog(ERROR, "could not identify an extended hash function for type %s",
+					 format_type_be(type_oid));
+			fmgr_info_cxt(tcache->hash_extended_proc, hash_finfo,
+						  fcinfo->flinfo->fn_mcxt);
+#else
+			tcache = lookup_type_cache(type_oid, TYPECACHE_HASH_PROC);
+			if (!OidIsValid(tcache->hash_proc))
+				elog(ERROR, "could not identify a hash function for type %s",
+					 format_type_be(type_oid));
+			fmgr_info_cxt(tcache->hash_proc, hash_finfo,
+						  fcinfo->flinfo->fn_mcxt);
+#endif
+			fcinfo->flinfo->fn_extra = hash_finfo;
+		}
+#if PG_VERSION_NUM >= 110000
+		hash = DatumGetUInt64(FunctionCall2Coll(hash_finfo,
+												PG_GET_COLLATION(),
+												PG_GETARG_DATUM(1),
+												Int64GetDatum(0)));
+#else
+		hash = DatumGetUInt32(FunctionCall1Coll(hash_finfo,
+												PG_GET_COLLATION(),
+												PG_GETARG_DATUM(1)));
+		hash = (hash << 32) | DatumGetUInt32(hash_uint32((uint32)hash));
+#endif
+		__hll_count_update((cl_uchar *)VARDATA(hll_state), hash);
+	}
+	PG_RETURN_BYTEA_P(hll_state);
+}
+PG_FUNCTION_INFO_V1(pgstrom_hll_count_accum);
+
+Datum
+pgstrom_hll_count_merge(PG_FUNCTION_ARGS)
+{
+	bytea	   *hll_state = PG_GETARG_BYTEA_P(0);
+	bytea	   *hll_other = PG_GETARG_BYTEA_P(1);
+	cl_uchar   *hll_regs;
+	cl_uchar   *hll_temp;
+	cl_uint		i;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (VARSIZE(hll_state) != VARHDRSZ + HLL_NUM_REGISTERS ||
+		VARSIZE(hll_other) != VARHDRSZ + HLL_NUM_REGISTERS)
+		elog(ERROR, "HyperLogLog state has unexpected length");
+	hll_regs = (cl_uchar *)VARDATA(hll_state);
+	hll_temp = (cl_uchar *)VARDATA(hll_other);
+	for (i=0; i < HLL_NUM_REGISTERS; i++)
+	{
+		if (hll_regs[i] < hll_temp[i])
+			hll_regs[i] = hll_temp[i];
+	}
+	PG_RETURN_BYTEA_P(hll_state);
+}
+PG_FUNCTION_INFO_V1(pgstrom_hll_count_merge);
+
+Datum
+pgstrom_hll_count_final(PG_FUNCTION_ARGS)
+{
+	bytea	   *hll_state;
+	cl_uchar   *hll_regs;
+	double		m = (double)HLL_NUM_REGISTERS;
+	double		sum = 0.0;
+	double		estimate;
+	cl_uint		nzeros = 0;
+	cl_uint		i;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT64(0);
+	hll_state = PG_GETARG_BYTEA_P(0);
+	if (VARSIZE(hll_state) != VARHDRSZ + HLL_NUM_REGISTERS)
+		elog(ERROR, "HyperLogLog state has unexpected length");
+	hll_regs = (cl_uchar *)VARDATA(hll_state);
+	for (i=0; i < HLL_NUM_REGISTERS; i++)
+	{
+		sum += ldexp(1.0, -(int)hll_regs[i]);
+		if (hll_regs[i] == 0)
+			nzeros++;
+	}
+	estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+	/* small range correction by linear counting */
+	if (estimate <= 2.5 * m && nzeros > 0)
+		estimate = m * log(m / (double)nzeros);
+
+	PG_RETURN_INT64((int64)rint(estimate));
+}
+PG_FUNCTION_INFO_V1(pgstrom_hll_count_final);
+
+/*
+ * Approximate percentile
+ *
+ * The transition state is a histogram of approx_percentile_bucket().
+ * pgstrom.approx_percentile() builds it from the values on the CPU side,
+ * and pgstrom.fpercentile() builds it from the number of rows per bucket
+ * counted by GpuPreAgg.
+ */
+typedef struct
+{
+	float8		fraction;
+	int64		nitems;		/* total number of items */
+	int32		lower;		/* bucket of counts[0] */
+	int32		nslots;		/* length of counts[] */
+	int64	   *counts;
+} approx_percentile_state;
+
+static approx_percentile_state *
+__approx_percentile_state(FunctionCallInfo fcinfo, float8 fraction)
+{
+	MemoryContext	aggcxt;
+	approx_percentile_state *state;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (!PG_ARGISNULL(0))
+		return (approx_percentile_state *)PG_GETARG_POINTER(0);
+
+	if (fraction < 0.0 || fraction > 1.0)
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("percentile value %g is not between 0 and 1",
+						fraction)));
+	state = MemoryContextAllocZero(aggcxt, sizeof(approx_percentile_state));
+	state->fraction = fraction;
+	return state;
+}
+
+static void
+__approx_percentile_update(approx_percentile_state *state,
+						   int32 bucket, int64 nitems)
+{
+	if (nitems <= 0)
+		return;
+	if (!state->counts)
+	{
+		state->counts = MemoryContextAllocZero(GetMemoryChunkContext(state),
+											   sizeof(int64) * 64);
+		state->lower = bucket - 32;
+		state->nslots = 64;
+	}
+	else if (bucket < state->lower ||
+			 bucket >= state->lower + state->nslots)
+	{
+		int32	lower = Min(bucket, state->lower);
+		int32	upper = Max(bucket + 1, state->lower + state->nslots);
+		int32	nslots = 2 * (upper - lower);
+		int64  *counts;
+
+		lower -= (nslots - (upper - lower)) / 2;
+		counts = MemoryContextAllocZero(GetMemoryChunkContext(state),
+										sizeof(int64) * nslots);
+		memcpy(counts + (state->lower - lower),
+			   state->counts,
+			   sizeof(int64) * state->nslots);
+		pfree(state->counts);
+		state->counts = counts;
+		state->lower = lower;
+		state->nslots = nslots;
+	}
+	state->counts[bucket - state->lower] += nitems;
+	state->nitems += nitems;
+}
+
+Datum
+pgstrom_approx_percentile_bucket(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT32(approx_percentile_bucket(PG_GETARG_FLOAT8(0)));
+}
+PG_FUNCTION_INFO_V1(pgstrom_approx_percentile_bucket);
+
+Datum
+pgstrom_approx_percentile_accum(PG_FUNCTION_ARGS)
+{
+	approx_percentile_state *state;
+
+	if (PG_ARGISNULL(0) && PG_ARGISNULL(2))
+		PG_RETURN_NULL();
+	state = __approx_percentile_state(fcinfo, PG_GETARG_FLOAT8(2));
+	if (!PG_ARGISNULL(1))
+		__approx_percentile_update(state,
+								   approx_percentile_bucket(PG_GETARG_FLOAT8(1)),
+								   1);
+	PG_RETURN_POINTER(state);
+}
+PG_FUNCTION_INFO_V1(pgstrom_approx_percentile_accum);
+
+Datum
+pgstrom_fpercentile_accum(PG_FUNCTION_ARGS)
+{
+	approx_percentile_state *state;
+
+	if (PG_ARGISNULL(0) && PG_ARGISNULL(3))
+		PG_RETURN_NULL();
+	state = __approx_percentile_state(fcinfo, PG_GETARG_FLOAT8(3));
+	if (!PG_ARGISNULL(1) && !PG_ARGISNULL(2))
+		__approx_percentile_update(state,
+								   PG_GETARG_INT32(1),
+								   PG_GETARG_INT64(2));
+	PG_RETURN_POINTER(state);
+}
+PG_FUNCTION_INFO_V1(pgstrom_fpercentile_accum);
+
+Datum
+pgstrom_approx_percentile_final(PG_FUNCTION_ARGS)
+{
+	approx_percentile_state *state;
+	int64		rank;
+	int64		count = 0;
+	int32		i;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+	state = (approx_percentile_state *)PG_GETARG_POINTER(0);
+	if (state->nitems == 0)
+		PG_RETURN_NULL();
+
+	rank = (int64)floor(state->fraction * (double)(state->nitems - 1));
+	for (i=0; i < state->nslots; i++)
+	{
+		count += state->counts[i];
+		if (count > rank)
+			break;
+	}
+	Assert(i < state->nslots);
+	PG_RETURN_FLOAT8(approx_percentile_value(state->lower + i));
+}
+PG_FUNCTION_INFO_V1(pgstrom_approx_percentile_final);
+
+/*
+ * Exact numeric sum/avg
+ *
+ * GpuPreAgg accumulates the upper and lower 32bits of the numeric value
+ * scaled by 10^scale, using pgstrom.numeric_scaled_hi/lo. The final sum
+ * is reconstructed as 128bit integer, then it is translated to numeric
+ * with the original scale, so no rounding error happen unlike float8.
+ */
+typedef struct
+{
+	int64		nrows;
+	int32		scale;
+	int128		sum;
+} numeric_exact_state;
+
+#define NUMERIC_EXACT_MAX_SCALE		18
+
+static int64
+__numeric_to_scaled_int8(Datum value, int32 scale)
+{
+	Datum		pow10;
+	Datum		ival;
+
+	if (scale < 0 || scale > NUMERIC_EXACT_MAX_SCALE)
+		elog(ERROR, "scale of exact numeric is out of range: %d", scale);
+	pow10 = DirectFunctionCall3(numeric_in,
+								CStringGetDatum(psprintf("1e%d", scale)),
+								ObjectIdGetDatum(InvalidOid),
+								Int32GetDatum(-1));
+	value = DirectFunctionCall2(numeric_mul, value, pow10);
+	ival = DirectFunctionCall2(numeric_trunc, value, Int32GetDatum(0));
+	if (!DatumGetBool(DirectFunctionCall2(numeric_eq, value, ival)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("numeric value has more digits than scale %d",
+						scale)));
+	return DatumGetInt64(DirectFunctionCall1(numeric_int8, ival));
+}
+
+Datum
+pgstrom_numeric_scaled_hi(PG_FUNCTION_ARGS)
+{
+	int64		ival = __numeric_to_scaled_int8(PG_GETARG_DATUM(0),
+												PG_GETARG_INT32(1));
+	PG_RETURN_INT64(ival >> 32);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_scaled_hi);
+
+Datum
+pgstrom_numeric_scaled_lo(PG_FUNCTION_ARGS)
+{
+	int64		ival = __numeric_to_scaled_int8(PG_GETARG_DATUM(0),
+												PG_GETARG_INT32(1));
+	PG_RETURN_INT64(ival & 0xffffffffL);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_scaled_lo);
+
+Datum
+pgstrom_partial_numeric_exact(PG_FUNCTION_ARGS)
+{
+	ArrayType  *result;
+	Datum		items[4];
+
+	if (PG_ARGISNULL(3))
+		elog(ERROR, "scale of exact numeric must not be NULL");
+	items[0] = (PG_ARGISNULL(0) ? Int64GetDatum(0) : PG_GETARG_DATUM(0));
+	items[1] = (PG_ARGISNULL(1) ? Int64GetDatum(0) : PG_GETARG_DATUM(1));
+	items[2] = (PG_ARGISNULL(2) ? Int64GetDatum(0) : PG_GETARG_DATUM(2));
+	items[3] = Int64GetDatum((int64)PG_GETARG_INT32(3));
+	result = construct_array(items, 4, INT8OID,
+							 sizeof(int64), FLOAT8PASSBYVAL, 'd');
+	PG_RETURN_ARRAYTYPE_P(result);
+}
+PG_FUNCTION_INFO_V1(pgstrom_partial_numeric_exact);
+
+Datum
+pgstrom_fnumeric_exact_accum(PG_FUNCTION_ARGS)
+{
+	MemoryContext	aggcxt;
+	numeric_exact_state *state;
+	ArrayType	   *xarray;
+	int64		   *x;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (PG_ARGISNULL(1))
+		elog(ERROR, "Null state was supplied");
+	xarray = PG_GETARG_ARRAYTYPE_P(1);
+	if (ARR_NDIM(xarray) != 1 ||
+		ARR_DIMS(xarray)[0] != 4 ||
+		ARR_HASNULL(xarray) ||
+		ARR_ELEMTYPE(xarray) != INT8OID)
+		elog(ERROR, "partial state of exact numeric is corrupted");
+	x = (int64 *)ARR_DATA_PTR(xarray);
+
+	if (!PG_ARGISNULL(0))
+	{
+		state = (numeric_exact_state *)PG_GETARG_POINTER(0);
+		if (state->scale != x[3])
+			elog(ERROR, "scale of exact numeric mismatch (%d of %d)",
+				 state->scale, (int)x[3]);
+	}
+	else
+	{
+		if (x[3] < 0 || x[3] > NUMERIC_EXACT_MAX_SCALE)
+			elog(ERROR, "scale of exact numeric is out of range: %d",
+				 (int)x[3]);
+		state = MemoryContextAllocZero(aggcxt, sizeof(numeric_exact_state));
+		state->scale = x[3];
+	}
+	if (x[0] > 0)
+	{
+		state->nrows += x[0];
+		state->sum += (int128)x[1] * ((int128)1 << 32) + (int128)x[2];
+	}
+	PG_RETURN_POINTER(state);
+}
+PG_FUNCTION_INFO_V1(pgstrom_fnumeric_exact_accum);
+
+static Datum
+__numeric_exact_sum(numeric_exact_state *state)
+{
+	int128		uval;
+	char		temp[60];
+	char		buf[120];
+	int			i, j, k;
+
+	/* decimal digits of the absolute value, in reverse order */
+	uval = (state->sum < 0 ? -state->sum : state->sum);
+	for (k=0; uval != 0 || k <= state->scale; k++)
+	{
+		temp[k] = '0' + (int)(uval % 10);
+		uval /= 10;
+	}
+	j = 0;
+	if (state->sum < 0)
+		buf[j++] = '-';
+	for (i=k-1; i >= 0; i--)
+	{
+		buf[j++] = temp[i];
+		if (i == state->scale && i > 0)
+			buf[j++] = '.';
+	}
+	buf[j] = '\0';
+
+	return DirectFunctionCall3(numeric_in,
+							   CStringGetDatum(buf),
+							   ObjectIdGetDatum(InvalidOid),
+							   Int32GetDatum(-1));
+}
+
+Datum
+pgstrom_fsum_numeric_exact_final(PG_FUNCTION_ARGS)
+{
+	numeric_exact_state *state;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+	state = (numeric_exact_state *)PG_GETARG_POINTER(0);
+	if (state->nrows == 0)
+		PG_RETURN_NULL();
+	PG_RETURN_DATUM(__numeric_exact_sum(state));
+}
+PG_FUNCTION_INFO_V1(pgstrom_fsum_numeric_exact_final);
+
+Datum
+pgstrom_favg_numeric_exact_final(PG_FUNCTION_ARGS)
+{
+	numeric_exact_state *state;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+	state = (numeric_exact_state *)PG_GETARG_POINTER(0);
+	if (state->nrows == 0)
+		PG_RETURN_NULL();
+	return DirectFunctionCall2(numeric_div,
+							   __numeric_exact_sum(state),
+							   DirectFunctionCall1(int8_numeric,
+												   Int64GetDatum(state->nrows)));
+}
+PG_FUNCTION_INFO_V1(pgstrom_favg_numeric_exact_final);
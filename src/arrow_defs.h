@@ -114,6 +114,23 @@ typedef enum
 	ArrowUnionMode__Dense		= 1,
 } ArrowUnionMode;
 
+/*
+ * CompressionType : byte
+ */
+typedef enum
+{
+	ArrowCompressionType__LZ4_FRAME	= 0,
+	ArrowCompressionType__ZSTD		= 1,
+} ArrowCompressionType;
+
+/*
+ * BodyCompressionMethod : byte
+ */
+typedef enum
+{
+	ArrowBodyCompressionMethod__BUFFER	= 0,
+} ArrowBodyCompressionMethod;
+
 /*
  * ArrowTypeOptions - our own definition
  */
@@ -177,6 +194,7 @@ typedef enum
 	ArrowNodeTag__FieldNode,
 	ArrowNodeTag__Buffer,
 	ArrowNodeTag__Schema,
+	ArrowNodeTag__BodyCompression,
 	ArrowNodeTag__RecordBatch,
 	ArrowNodeTag__DictionaryBatch,
 	ArrowNodeTag__Message,
@@ -427,6 +445,16 @@ typedef struct		ArrowSchema
 	int				_num_custom_metadata;
 } ArrowSchema;
 
+/*
+ * BodyCompression
+ */
+typedef struct		ArrowBodyCompression
+{
+	ArrowNode		node;
+	ArrowCompressionType codec;
+	ArrowBodyCompressionMethod method;
+} ArrowBodyCompression;
+
 /*
  * RecordBatch
  */
@@ -440,6 +468,8 @@ typedef struct		ArrowRecordBatch
 	/* vector of Buffer */
 	ArrowBuffer	    *buffers;
 	int				_num_buffers;
+	/* valid, if node.tag == ArrowNodeTag__BodyCompression */
+	ArrowBodyCompression compression;
 } ArrowRecordBatch;
 
 /*
@@ -500,8 +530,98 @@ typedef struct		ArrowFooter
 	int				_num_recordBatches;
 } ArrowFooter;
 
+/*
+ * Definitions for Apache Parquet files
+ *
+ * Only a part of the Parquet format we can map onto the Arrow format.
+ */
+typedef enum
+{
+	ParquetType__BOOLEAN			= 0,
+	ParquetType__INT32				= 1,
+	ParquetType__INT64				= 2,
+	ParquetType__INT96				= 3,
+	ParquetType__FLOAT				= 4,
+	ParquetType__DOUBLE				= 5,
+	ParquetType__BYTE_ARRAY			= 6,
+	ParquetType__FIXED_LEN_BYTE_ARRAY = 7,
+} ParquetType;
+
+typedef enum
+{
+	ParquetCodec__UNCOMPRESSED		= 0,
+	ParquetCodec__SNAPPY			= 1,
+	ParquetCodec__GZIP				= 2,
+	ParquetCodec__LZO				= 3,
+	ParquetCodec__BROTLI			= 4,
+	ParquetCodec__LZ4				= 5,
+	ParquetCodec__ZSTD				= 6,
+	ParquetCodec__LZ4_RAW			= 7,
+} ParquetCodec;
+
+typedef enum
+{
+	ParquetPageType__DATA_PAGE		= 0,
+	ParquetPageType__INDEX_PAGE		= 1,
+	ParquetPageType__DICTIONARY_PAGE = 2,
+	ParquetPageType__DATA_PAGE_V2	= 3,
+} ParquetPageType;
+
+typedef enum
+{
+	ParquetEncoding__PLAIN			= 0,
+	ParquetEncoding__PLAIN_DICTIONARY = 2,
+	ParquetEncoding__RLE			= 3,
+	ParquetEncoding__BIT_PACKED		= 4,
+	ParquetEncoding__RLE_DICTIONARY	= 8,
+} ParquetEncoding;
+
+/*
+ * ParquetColumnChunk - a column chunk in the row group
+ */
+typedef struct
+{
+	ParquetType		type;
+	ParquetCodec	codec;
+	int32_t			max_def_level;	/* 0 (REQUIRED) or 1 (OPTIONAL) */
+	int64_t			chunk_offset;	/* head of the first page */
+	int64_t			chunk_length;	/* total compressed size */
+	int64_t			num_values;
+	int64_t			null_count;		/* -1, if no statistics */
+} ParquetColumnChunk;
+
+/*
+ * ParquetRowGroup
+ */
+typedef struct
+{
+	int64_t			num_rows;
+	ParquetColumnChunk *columns;
+	int				_num_columns;
+} ParquetRowGroup;
+
+/*
+ * ParquetPageHeader
+ */
+typedef struct
+{
+	ParquetPageType	type;
+	int32_t			uncompressed_page_size;
+	int32_t			compressed_page_size;
+	int32_t			num_values;
+	ParquetEncoding	encoding;
+	/* only DATA_PAGE_V2 */
+	int32_t			num_nulls;
+	int32_t			def_levels_length;
+	int32_t			rep_levels_length;
+	bool			is_compressed;
+} ParquetPageHeader;
+
 /*
  * ArrowFileInfo - state information of readArrowFileDesc()
+ *
+ * If Apache Parquet file, footer.schema is built from the Parquet schema,
+ * and rowGroups[] are set instead of the dictionaries/recordBatches.
  */
 typedef struct
 {
@@ -510,6 +630,9 @@ typedef struct
 	ArrowFooter		footer;
 	ArrowMessage   *dictionaries;	/* array of ArrowDictionaryBatch */
 	ArrowMessage   *recordBatches;	/* array of ArrowRecordBatch */
+	bool			is_parquet;
+	ParquetRowGroup *rowGroups;		/* array of ParquetRowGroup */
+	int				_num_rowGroups;
 } ArrowFileInfo;
 
 #endif		/* !__CUDACC__ */
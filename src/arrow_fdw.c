@@ -18,6 +18,13 @@
 #include "pg_strom.h"
 #include "arrow_defs.h"
 #include "arrow_ipc.h"
+#include <glob.h>
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 #include "cuda_numeric.cu"
 
 /*
@@ -34,10 +41,19 @@ typedef struct RecordBatchFieldState
 	size_t		nullmap_length;
 	off_t		values_offset;
 	size_t		values_length;
+	size_t		values_rawlen;		/* length required for nitems */
 	off_t		extra_offset;
 	size_t		extra_length;
+	off_t		dict_offset;		/* offset array of the dictionary, */
+	size_t		dict_length;		/* if dictionary-encoded */
+	int16		parquet_codec;		/* ParquetCodec, if Parquet column chunk */
+	int16		parquet_max_def;	/* max definition level (0 or 1) */
 	int			num_children;
 	struct RecordBatchFieldState *children;
+	/* min/max statistics of the field, if any */
+	bool		stat_valid;
+	Datum		stat_min;
+	Datum		stat_max;
 } RecordBatchFieldState;
 
 typedef struct RecordBatchState
@@ -48,11 +64,23 @@ typedef struct RecordBatchState
 	off_t		rb_offset;	/* offset from the head */
 	size_t		rb_length;	/* length of the entire RecordBatch */
 	int64		rb_nitems;	/* number of items */
+	int			rb_compression;	/* ArrowCompressionType, or -1 */
 	/* per column information */
 	int			ncols;
 	RecordBatchFieldState columns[FLEXIBLE_ARRAY_MEMBER];
 } RecordBatchState;
 
+/* rb_compression of RecordBatchState mapped on a row group of Parquet file */
+#define ARROW_PARQUET_ROWGROUP		0x1000
+
+/*
+ * Format version of the persistent metadata cache, which saves the
+ * RecordBatchState and RecordBatchFieldState as is. Bump it whenever
+ * definition or meaning of their fields are changed, even if their
+ * size is not changed.
+ */
+#define ARROW_METADATA_PCACHE_VERSION	2
+
 /*
  * metadata cache (on shared memory)
  */
@@ -67,6 +95,7 @@ typedef struct
 {
 	dlist_node	chain;
 	dlist_node	lru_chain;
+	pg_atomic_uint32 lru_referenced; /* second chance on LRU reclaim */
 	dlist_head	siblings;	/* if two or more record batches per file */
 	/* key of RecordBatch metadata cache */
 	struct stat	stat_buf;
@@ -76,6 +105,7 @@ typedef struct
 	off_t		rb_offset;	/* offset from the head */
     size_t		rb_length;	/* length of the entire RecordBatch */
     int64		rb_nitems;	/* number of items */
+	int			rb_compression;	/* ArrowCompressionType, or -1 */
 	int			ncols;
 	int			nfields;	/* length of fstate[] array */
 	RecordBatchFieldState fstate[FLEXIBLE_ARRAY_MEMBER];
@@ -88,6 +118,7 @@ typedef struct
 	slock_t		lru_lock;
 	dlist_head	lru_list;
 	pg_atomic_uint64 consumed;
+	pg_atomic_uint64 write_generation;	/* bumped on writes of arrow files */
 
 	LWLock		lock_slots[ARROW_METADATA_HASH_NSLOTS];
 	dlist_head	hash_slots[ARROW_METADATA_HASH_NSLOTS];
@@ -96,6 +127,8 @@ typedef struct
 	/* for ArrowGpuBuffer links */
 	LWLock		gpubuf_locks[ARROW_GPUBUF_HASH_NSLOTS];
 	dlist_head	gpubuf_slots[ARROW_GPUBUF_HASH_NSLOTS];
+	LWLock		gpubuf_lru_lock;
+	dlist_head	gpubuf_lru_list;
 } arrowMetadataState;
 
 /*
@@ -139,20 +172,94 @@ typedef struct
 	MetadataCacheKey key;
 	uint32		hash;
 	bool		redo_log_written;
+	size_t		segment_nrows;	/* max number of rows per RecordBatch */
 	SQLtable	sql_table;
 } arrowWriteState;
 
+/*
+ * arrowStatsHint - RecordBatch pruning using min/max statistics
+ */
+typedef struct
+{
+	AttrNumber	attnum;			/* referenced column */
+	StrategyNumber strategy;	/* BT strategy, if Var is on the left side */
+	bool		var_on_left;	/* true, if Var is the left argument */
+	Oid			collid;			/* input collation of the operator */
+	FmgrInfo	cmp_func;		/* BTORDER_PROC of the operator */
+	Oid			argtype;		/* type of the comparison key */
+	ExprState  *arg;			/* comparison key (Const or Param) */
+} arrowStatsCond;
+
+typedef struct
+{
+	List	   *conds;			/* list of arrowStatsCond */
+	List	   *key_conds;		/* list of arrowStatsCond by the range of
+								 * inner keys of GpuJoin */
+	List	   *orig_quals;		/* original qualifiers (for EXPLAIN) */
+	ExprContext *econtext;
+	uint32		nskipped;		/* number of skipped RecordBatches */
+	uint64		nfiltered;		/* number of rows removed by CPU pre-filter */
+} arrowStatsHint;
+
+/*
+ * arrowMetaAggState - aggregation answered by the metadata of RecordBatches
+ */
+#define ARROW_META_AGG__COUNT_STAR		1
+#define ARROW_META_AGG__COUNT			2
+#define ARROW_META_AGG__MIN				3
+#define ARROW_META_AGG__MAX				4
+
+typedef struct
+{
+	int			kind;			/* one of ARROW_META_AGG__* */
+	AttrNumber	attnum;			/* argument column, if any */
+	FmgrInfo	cmp_func;		/* BTORDER_PROC of the column, if MIN/MAX */
+	int64		count;			/* current count, if COUNT */
+	Datum		value;			/* current value, if MIN/MAX */
+	bool		isnull;
+} arrowMetaAggItem;
+
+typedef struct
+{
+	ExprState  *quals;			/* qualifiers on the partial scan */
+	bool		quals_in_stats;	/* true, if all the qualifiers are checked
+								 * by the stats_hint */
+	TupleTableSlot *base_slot;	/* slot of the foreign table */
+	bool		done;			/* true, if result is already returned */
+	uint32		nbatches_meta;	/* number of RecordBatches answered by the
+								 * metadata */
+	uint32		nbatches_scan;	/* number of RecordBatches scanned */
+	int			naggs;
+	arrowMetaAggItem aggs[FLEXIBLE_ARRAY_MEMBER];
+} arrowMetaAggState;
+
 /*
  * ArrowFdwState
  */
 struct ArrowFdwState
 {
 	List	   *fdescList;
+	int			nfiles_pruned;		/* number of files pruned by the path */
 	Bitmapset  *referenced;
+	Bitmapset **ref_subfields;		/* referenced sub-fields of composite
+									 * columns, or NULL if all (per column) */
+	arrowStatsHint *stats_hint;		/* valid, if min/max statistics usable */
+	arrowMetaAggState *meta_agg;	/* valid, if aggregation by metadata */
 	pg_atomic_uint32   *rbatch_index;
 	pg_atomic_uint32	__rbatch_index_local;	/* if single process exec */
 	pgstrom_data_store *curr_pds;	/* current focused buffer */
 	cl_ulong	curr_index;			/* current index to row on KDS */
+	uint8	   *curr_filter;		/* pre-filter results, if any */
+	size_t		curr_filter_sz;		/* allocated length of curr_filter */
+	uint32		prefetch_index;		/* next RecordBatch to be prefetched */
+	/* GPU buffers which keep the referenced columns, if any */
+	bool		gpubuf_checked;		/* true, if already looked up */
+	List	   *gpubuf_refs;		/* list of arrowGpuBufferRef */
+	uint64	   *rbatch_row_offset;	/* first row index of RecordBatches */
+	uint32		gpubuf_nloaded;		/* number of RecordBatches loaded from
+									 * the GPU buffers */
+	Bitmapset  *rb_skipped;			/* RecordBatches to be skipped, because
+									 * the caller already has the results */
 	/* state of RecordBatches */
 	uint32		num_rbatches;
 	RecordBatchState *rbatches[FLEXIBLE_ARRAY_MEMBER];
@@ -162,10 +269,13 @@ struct ArrowFdwState
  * ArrowGpuBuffer (shared structure)
  */
 #define ARROW_GPUBUF_FORMAT__CUPY		1
+#define ARROW_GPUBUF_FORMAT__ARROW		2	/* columnar with nullmap */
 
 typedef struct 
 {
 	dlist_node	chain;
+	dlist_node	lru_chain;	/* link to gpubuf_lru_list */
+	TimestampTz	last_used;	/* protected by gpubuf_lru_lock */
 	pg_atomic_uint32 refcnt;
 	char	   *ident;
 	bool		pinned;
@@ -178,6 +288,8 @@ typedef struct
 	/* below is used for hash */
 	Oid			frel_oid;
 	int			format;		/* one of ARROW_GPUBUF_FORMAT__* */
+	uint32		rb_begin;	/* first RecordBatch, if partial */
+	uint32		rb_count;	/* number of RecordBatches, or 0 for all */
 	int			nattrs;
 	AttrNumber	attnums[FLEXIBLE_ARRAY_MEMBER];
 } ArrowGpuBuffer;
@@ -189,6 +301,22 @@ typedef struct
 	char		ident[FLEXIBLE_ARRAY_MEMBER];
 } ArrowGpuBufferTracker;
 
+/*
+ * arrowGpuBufferRef - reference to the GPU buffer by GpuScan/GpuJoin/GpuPreAgg
+ * during the scan on the foreign table
+ */
+typedef struct
+{
+	dlist_node	chain;		/* link to arrow_gpu_buffer_scan_refs */
+	ArrowFdwState *owner;	/* scan state which references the buffer */
+	ArrowGpuBuffer *gpubuf;
+	GpuContext *gcontext;
+	CUdeviceptr	m_gbuf;		/* mapped on @gcontext, if not 0 */
+	uint32		rb_begin;	/* first RecordBatch on the buffer */
+	uint32		rb_count;	/* number of RecordBatches on the buffer */
+	size_t		values_offset[FLEXIBLE_ARRAY_MEMBER];	/* per attnums */
+} arrowGpuBufferRef;
+
 /* ---------- static variables ---------- */
 static FdwRoutine		pgstrom_arrow_fdw_routine;
 static shmem_startup_hook_type shmem_startup_next = NULL;
@@ -197,9 +325,19 @@ static dlist_head		arrow_write_redo_list;
 static bool				arrow_fdw_enabled;				/* GUC */
 static int				arrow_metadata_cache_size_kb;	/* GUC */
 static size_t			arrow_metadata_cache_size;
+static int				arrow_metadata_stat_ttl;	/* GUC */
 static char			   *arrow_debug_row_numbers_hint;	/* GUC */
+static char			   *arrow_metadata_cache_dir;		/* GUC */
 static int				arrow_record_batch_size_kb;		/* GUC */
+static int				arrow_record_batch_max_rows;	/* GUC */
+static int				arrow_prefetch_depth;			/* GUC */
+static int				arrow_gpu_buffer_budget_kb;		/* GUC */
+static bool				arrow_mmap_scan_enabled;		/* GUC */
+static bool				arrow_cpu_prefilter_enabled;	/* GUC */
+static bool				arrow_gpu_buffer_scan_enabled;	/* GUC */
+static bool				arrow_metadata_agg_enabled;		/* GUC */
 static dlist_head		arrow_gpu_buffer_tracker_list;
+static dlist_head		arrow_gpu_buffer_scan_refs;
 
 /* ---------- static functions ---------- */
 static bool		arrowTypeIsEqual(ArrowField *a, ArrowField *b, int depth);
@@ -212,10 +350,18 @@ static List	   *__arrowFdwExtractFilesList(List *options_list,
 										   int *p_parallel_nworkers,
 										   bool *p_writable);
 static List	   *arrowFdwExtractFilesList(List *options_list);
+static List	   *arrowFdwPruneFilesList(List *filesList, TupleDesc tupdesc,
+									   List *quals, int *p_nfiles_pruned);
 static RecordBatchState *makeRecordBatchState(ArrowSchema *schema,
 											  ArrowBlock *block,
-											  ArrowRecordBatch *rbatch);
+											  ArrowRecordBatch *rbatch,
+											  ArrowFileInfo *af_info);
 static List	   *arrowLookupOrBuildMetadataCache(File fdesc);
+static bool		__arrowStatsTypeIsSupported(Oid type_oid);
+static bool		__arrowStatsCheckOpExpr(OpExpr *op, int natts,
+										Var **p_var, Expr **p_arg,
+										bool *p_var_on_left,
+										int *p_strategy, Oid *p_cmp_proc);
 static void		pg_datum_arrow_ref(kern_data_store *kds,
 								   kern_colmeta *cmeta,
 								   size_t index,
@@ -225,15 +371,28 @@ static void		pg_datum_arrow_ref(kern_data_store *kds,
 static arrowWriteState *createArrowWriteState(Relation frel, File file,
 											  bool redo_log_written);
 static void createArrowWriteRedoLog(File filp, bool is_newfile);
+static size_t	arrowPutValuesSQLtable(SQLtable *table, TupleDesc tupdesc,
+									   Datum *values, bool *nulls);
 static void writeOutArrowRecordBatch(arrowWriteState *aw_state,
 									 bool with_footer);
+/* routines for GPU buffers */
+static void		arrowFdwLookupGpuBuffers(ArrowFdwState *af_state,
+										 Relation relation,
+										 GpuContext *gcontext);
+static void		arrowFdwReleaseGpuBuffers(ArrowFdwState *af_state);
 
 Datum	pgstrom_arrow_fdw_handler(PG_FUNCTION_ARGS);
 Datum	pgstrom_arrow_fdw_validator(PG_FUNCTION_ARGS);
 Datum	pgstrom_arrow_fdw_precheck_schema(PG_FUNCTION_ARGS);
 Datum	pgstrom_arrow_fdw_truncate(PG_FUNCTION_ARGS);
+Datum	pgstrom_arrow_fdw_compact(PG_FUNCTION_ARGS);
+Datum	pgstrom_arrow_query(PG_FUNCTION_ARGS);
 Datum	pgstrom_arrow_fdw_export_cupy(PG_FUNCTION_ARGS);
 Datum	pgstrom_arrow_fdw_export_cupy_pinned(PG_FUNCTION_ARGS);
+Datum	pgstrom_arrow_fdw_export_columns(PG_FUNCTION_ARGS);
+Datum	pgstrom_arrow_fdw_export_columns_pinned(PG_FUNCTION_ARGS);
+Datum	pgstrom_arrow_fdw_export_columns_batch(PG_FUNCTION_ARGS);
+Datum	pgstrom_arrow_fdw_gpu_buffer_info(PG_FUNCTION_ARGS);
 Datum	pgstrom_arrow_fdw_unpin_gpu_buffer(PG_FUNCTION_ARGS);
 Datum	pgstrom_arrow_fdw_put_gpu_buffer(PG_FUNCTION_ARGS);
 
@@ -311,8 +470,10 @@ RecordBatchFieldLength(RecordBatchFieldState *fstate)
 		len += fstate->nullmap_length;
 	if (fstate->values_offset > 0)
 		len += fstate->values_length;
-	if (fstate->extra_offset > 0)
+	if (fstate->extra_length > 0)
 		len += fstate->extra_length;
+	if (fstate->dict_length > 0)
+		len += fstate->dict_length;
 	len = BLCKALIGN(len);
 	for (j=0; j < fstate->num_children; j++)
 		len += RecordBatchFieldLength(&fstate->children[j]);
@@ -387,7 +548,9 @@ ArrowGetForeignRelSize(PlannerInfo *root,
 					   Oid foreigntableid)
 {
 	ForeignTable   *ft = GetForeignTable(foreigntableid);
+	Relation		frel;
 	List		   *filesList;
+	List		   *quals;
 	Size			filesSizeTotal = 0;
 	Bitmapset	   *referenced = NULL;
 	BlockNumber		npages = 0;
@@ -410,6 +573,13 @@ ArrowGetForeignRelSize(PlannerInfo *root,
 	filesList = __arrowFdwExtractFilesList(ft->options,
 										   &parallel_nworkers,
 										   &writable);
+	/* files to be skipped by the 'key=value' in the path */
+	quals = extract_actual_clauses(baserel->baserestrictinfo, false);
+	frel = table_open(foreigntableid, NoLock);
+	filesList = arrowFdwPruneFilesList(filesList,
+									   RelationGetDescr(frel),
+									   quals, NULL);
+	table_close(frel, NoLock);
 	foreach (lc, filesList)
 	{
 		char	   *fname = strVal(lfirst(lc));
@@ -466,7 +636,8 @@ ArrowGetForeignRelSize(PlannerInfo *root,
 
 	if (optimal_gpu < 0 || optimal_gpu >= numDevAttrs)
 		optimal_gpu = -1;
-	else if (filesSizeTotal < nvme_strom_threshold())
+	else if (filesSizeTotal < nvme_strom_threshold() &&
+			 !nvme_strom_partial_scan())
 		optimal_gpu = -1;
 
 	baserel->rel_parallel_workers = parallel_nworkers;
@@ -643,6 +814,26 @@ ArrowGetForeignPlan(PlannerInfo *root,
 	ListCell   *lc;
 	int			i, j, k;
 
+	if (baserel->reloptkind == RELOPT_UPPER_REL)
+	{
+		List	   *quals = copyObject(linitial(best_path->fdw_private));
+
+		/*
+		 * Aggregation by the metadata; fdw_scan_tlist has the Aggref nodes
+		 * to be computed. Qualifiers are kept in the fdw_private, because
+		 * set_plan_references() never fixes up the fdw_private.
+		 */
+		fix_opfuncids((Node *)quals);
+		return make_foreignscan(tlist,
+								NIL,	/* no local quals */
+								0,		/* no scanrelid */
+								NIL,	/* no expressions to evaluate */
+								list_make2(quals,
+										   lsecond(best_path->fdw_private)),
+								tlist,	/* aggregate functions */
+								NIL,	/* no remote quals */
+								outer_plan);
+	}
 	Assert(IS_SIMPLE_REL(baserel));
 	/* pick up referenced attributes */
 	foreach (lc, baserel->baserestrictinfo)
@@ -678,6 +869,257 @@ ArrowGetForeignPlan(PlannerInfo *root,
 							outer_plan);
 }
 
+/*
+ * ArrowGetForeignUpperPaths
+ *
+ * It adds a ForeignPath for the aggregate-only query on a single Arrow_Fdw
+ * foreign table, like 'SELECT count(*), min(ts), max(ts) FROM arrow_tbl
+ * WHERE dt = ...'. COUNT/MIN/MAX are answered by the number of items,
+ * null_count and min/max statistics of the RecordBatches fully covered by
+ * the qualifiers, without any I/O. Only the RecordBatches which partially
+ * match the qualifiers are scanned.
+ */
+static int
+arrowMetaAggKind(Aggref *aggref, Index relid, AttrNumber *p_attnum)
+{
+	const char *func_name;
+	TargetEntry *tle;
+	Var		   *var;
+
+	if (aggref->aggsplit != AGGSPLIT_SIMPLE ||
+		aggref->aggkind != AGGKIND_NORMAL ||
+		aggref->agglevelsup > 0 ||
+		aggref->aggdistinct != NIL ||
+		aggref->aggorder != NIL ||
+		aggref->aggfilter != NULL ||
+		get_func_namespace(aggref->aggfnoid) != PG_CATALOG_NAMESPACE)
+		return 0;
+	func_name = get_func_name(aggref->aggfnoid);
+	if (strcmp(func_name, "count") == 0 && aggref->aggstar)
+	{
+		*p_attnum = InvalidAttrNumber;
+		return ARROW_META_AGG__COUNT_STAR;
+	}
+	if (list_length(aggref->args) != 1)
+		return 0;
+	tle = linitial(aggref->args);
+	var = (Var *) tle->expr;
+	if (!IsA(var, Var) ||
+		var->varlevelsup > 0 ||
+		var->varattno <= 0 ||
+		(relid > 0 && var->varno != relid))
+		return 0;
+	*p_attnum = var->varattno;
+	if (strcmp(func_name, "count") == 0)
+		return ARROW_META_AGG__COUNT;
+	if (!__arrowStatsTypeIsSupported(var->vartype) ||
+		linitial_oid(aggref->aggargtypes) != var->vartype)
+		return 0;
+	if (strcmp(func_name, "min") == 0)
+		return ARROW_META_AGG__MIN;
+	if (strcmp(func_name, "max") == 0)
+		return ARROW_META_AGG__MAX;
+	return 0;
+}
+
+/*
+ * arrowMetaAggScanRatio
+ *
+ * It estimates the ratio of RecordBatches to be scanned; that lacks the
+ * min/max statistics required to answer the aggregation.
+ */
+static double
+arrowMetaAggScanRatio(Oid foreigntableid, List *quals,
+					  Bitmapset *stat_refs, bool need_scan)
+{
+	ForeignTable   *ft = GetForeignTable(foreigntableid);
+	Relation		frel;
+	List		   *filesList;
+	ListCell	   *lc;
+	bool			writable;
+	double			nbatches = 0.0;
+	double			nbatches_scan = 0.0;
+
+	filesList = __arrowFdwExtractFilesList(ft->options, NULL, &writable);
+	frel = table_open(foreigntableid, NoLock);
+	filesList = arrowFdwPruneFilesList(filesList,
+									   RelationGetDescr(frel),
+									   quals, NULL);
+	table_close(frel, NoLock);
+	foreach (lc, filesList)
+	{
+		char	   *fname = strVal(lfirst(lc));
+		File		fdesc;
+		List	   *rb_cached;
+		ListCell   *cell;
+
+		fdesc = PathNameOpenFile(fname, O_RDONLY | PG_BINARY);
+		if (fdesc < 0)
+		{
+			if (writable && errno == ENOENT)
+				continue;
+			elog(ERROR, "failed to open file '%s' on behalf of '%s'",
+				 fname, get_rel_name(foreigntableid));
+		}
+		rb_cached = arrowLookupOrBuildMetadataCache(fdesc);
+		foreach (cell, rb_cached)
+		{
+			RecordBatchState *rb_state = lfirst(cell);
+			int		k;
+
+			for (k = bms_next_member(stat_refs, -1);
+				 k >= 0;
+				 k = bms_next_member(stat_refs, k))
+			{
+				if (k < 1 || k > rb_state->ncols ||
+					!rb_state->columns[k-1].stat_valid)
+					break;
+			}
+			if (k >= 0 || need_scan)
+				nbatches_scan += 1.0;
+			nbatches += 1.0;
+		}
+		FileClose(fdesc);
+	}
+	if (nbatches == 0.0)
+		return 0.0;
+	/* a RecordBatch on the boundary of the qualifiers will be scanned */
+	if (quals != NIL && nbatches_scan == 0.0)
+		nbatches_scan = 1.0;
+	return nbatches_scan / nbatches;
+}
+
+static void
+ArrowGetForeignUpperPaths(PlannerInfo *root,
+						  UpperRelationKind stage,
+						  RelOptInfo *input_rel,
+						  RelOptInfo *output_rel
+#if PG_VERSION_NUM >= 110000
+						  ,void *extra
+#endif
+	)
+{
+	Query		   *parse = root->parse;
+	RangeTblEntry  *rte;
+	PathTarget	   *target = output_rel->reltarget;
+	ForeignPath	   *fpath;
+	List		   *quals = NIL;
+	List		   *ref_list = NIL;
+	Bitmapset	   *referenced = NULL;
+	Bitmapset	   *stat_refs = NULL;
+	bool			need_scan = false;
+	double			scan_ratio;
+	Cost			total_cost;
+	ListCell	   *lc;
+	int				k;
+
+	if (!arrow_fdw_enabled ||
+		!arrow_metadata_agg_enabled ||
+		stage != UPPERREL_GROUP_AGG ||
+		output_rel->fdw_private != NULL ||
+		input_rel->reloptkind != RELOPT_BASEREL ||
+		!baseRelIsArrowFdw(input_rel) ||
+		input_rel->lateral_relids != NULL)
+		return;
+	if (parse->groupClause != NIL ||
+		parse->groupingSets != NIL ||
+		parse->havingQual != NULL ||
+		!parse->hasAggs)
+		return;
+#if PG_VERSION_NUM >= 110000
+	if (extra &&
+		((GroupPathExtraData *)extra)->patype == PARTITIONWISE_AGGREGATE_PARTIAL)
+		return;
+#endif
+	/* only COUNT/MIN/MAX on the columns of the foreign table */
+	foreach (lc, target->exprs)
+	{
+		Aggref	   *aggref = lfirst(lc);
+		AttrNumber	attnum;
+		int			kind;
+
+		if (!IsA(aggref, Aggref))
+			return;
+		kind = arrowMetaAggKind(aggref, input_rel->relid, &attnum);
+		if (kind == 0)
+			return;
+		if (attnum > 0)
+			referenced = bms_add_member(referenced, attnum -
+										FirstLowInvalidHeapAttributeNumber);
+		if (kind == ARROW_META_AGG__MIN || kind == ARROW_META_AGG__MAX)
+			stat_refs = bms_add_member(stat_refs, attnum);
+	}
+	/* qualifiers are evaluated on the partial scan by CPU */
+	foreach (lc, input_rel->baserestrictinfo)
+	{
+		RestrictInfo   *rinfo = lfirst(lc);
+		Var			   *var;
+		Expr		   *arg;
+		bool			var_on_left;
+		int				strategy;
+		Oid				cmp_proc;
+
+		if (rinfo->pseudoconstant ||
+			contain_subplans((Node *)rinfo->clause))
+			return;
+		if (__arrowStatsCheckOpExpr((OpExpr *)rinfo->clause,
+									input_rel->max_attr,
+									&var, &arg, &var_on_left,
+									&strategy, &cmp_proc))
+			stat_refs = bms_add_member(stat_refs, var->varattno);
+		else
+			need_scan = true;
+		quals = lappend(quals, rinfo->clause);
+		pull_varattnos((Node *)rinfo->clause, input_rel->relid, &referenced);
+	}
+	for (k = bms_next_member(referenced, -1);
+		 k >= 0;
+		 k = bms_next_member(referenced, k))
+	{
+		AttrNumber	attnum = k + FirstLowInvalidHeapAttributeNumber;
+
+		if (attnum <= 0)
+			return;		/* no system columns and whole-row references */
+		ref_list = lappend_int(ref_list, attnum);
+	}
+
+	/*
+	 * Cost estimation; RecordBatches answered by the metadata consume no
+	 * I/O, so only the ratio of the full scan cost is charged.
+	 */
+	rte = root->simple_rte_array[input_rel->relid];
+	scan_ratio = arrowMetaAggScanRatio(rte->relid, quals,
+									   stat_refs, need_scan);
+	total_cost = (input_rel->cheapest_total_path->total_cost * scan_ratio +
+				  cpu_operator_cost * list_length(target->exprs) +
+				  cpu_tuple_cost);
+#if PG_VERSION_NUM >= 120000
+	fpath = create_foreign_upper_path(root,
+									  output_rel,
+									  target,
+									  1.0,
+									  total_cost,
+									  total_cost,
+									  NIL,	/* no pathkeys */
+									  NULL,	/* no extra plan */
+									  list_make2(quals, ref_list));
+#else
+	fpath = create_foreignscan_path(root,
+									output_rel,
+									target,
+									1.0,
+									total_cost,
+									total_cost,
+									NIL,	/* no pathkeys */
+									NULL,	/* no outer rel */
+									NULL,	/* no extra plan */
+									list_make2(quals, ref_list));
+#endif
+	add_path(output_rel, (Path *)fpath);
+	/* mark the output_rel as processed */
+	output_rel->fdw_private = list_make1(fpath);
+}
+
 /*
  * getTimezoneOffset - returns timezone offset in second
  */
@@ -739,6 +1181,9 @@ typedef struct
 	ArrowBuffer    *buffer_tail;
 	ArrowFieldNode *fnode_curr;
 	ArrowFieldNode *fnode_tail;
+	bool			compressed;	/* buffers are compressed */
+	off_t			rb_offset;	/* offset of the RecordBatch body */
+	ArrowFileInfo  *af_info;	/* for lookup of DictionaryBatch */
 } setupRecordBatchContext;
 
 static void
@@ -797,6 +1242,103 @@ assignArrowTypeOptions(ArrowTypeOptions *attopts, const ArrowType *atype)
 	}
 }
 
+/*
+ * setupRecordBatchDictionaryField
+ *
+ * A dictionary-encoded field has nullmap and 32bit index array in the
+ * RecordBatch, and its values are stored in the DictionaryBatch. We keep
+ * the offset array and the body of the dictionary in @dict_XXX and
+ * @extra_XXX, to load them with the index array on the same KDS.
+ */
+static void
+setupRecordBatchDictionaryField(setupRecordBatchContext *con,
+								RecordBatchFieldState *fstate,
+								ArrowField *field,
+								int depth)
+{
+	ArrowDictionaryEncoding *dict = &field->dictionary;
+	ArrowFileInfo  *af_info = con->af_info;
+	ArrowDictionaryBatch *dbatch = NULL;
+	ArrowBuffer	   *buffer_curr;
+	off_t			db_offset = 0;
+	int64			dict_nitems;
+	int				i;
+
+	if (depth > 0)
+		elog(ERROR, "nested dictionary-encoded field is not supported");
+	if (field->type.node.tag != ArrowNodeTag__Utf8 &&
+		field->type.node.tag != ArrowNodeTag__Binary)
+		elog(ERROR, "dictionary-encoded Arrow::%s is not supported",
+			 field->type.node.tagName);
+	if (dict->indexType.bitWidth != 32)
+		elog(ERROR, "dictionary index must be 32bit integer");
+	if (con->compressed)
+		elog(ERROR, "dictionary-encoded field in compressed RecordBatch is not supported");
+
+	/* lookup DictionaryBatch */
+	for (i=0; i < af_info->footer._num_dictionaries; i++)
+	{
+		ArrowMessage   *message = &af_info->dictionaries[i];
+		ArrowBlock	   *block = &af_info->footer.dictionaries[i];
+
+		if (message->body.node.tag == ArrowNodeTag__DictionaryBatch &&
+			message->body.dictionaryBatch.id == dict->id)
+		{
+			if (dbatch || message->body.dictionaryBatch.isDelta)
+				elog(ERROR, "delta DictionaryBatch is not supported");
+			dbatch = &message->body.dictionaryBatch;
+			db_offset = block->offset + block->metaDataLength;
+		}
+	}
+	if (!dbatch)
+		elog(ERROR, "no DictionaryBatch for dictionary id=%ld", dict->id);
+	if (dbatch->data.compression.node.tag == ArrowNodeTag__BodyCompression)
+		elog(ERROR, "compressed DictionaryBatch is not supported");
+	if (dbatch->data._num_nodes != 1 ||
+		dbatch->data._num_buffers != 3)
+		elog(ERROR, "DictionaryBatch may have corruption");
+	dict_nitems = dbatch->data.nodes[0].length;
+
+	/* nullmap and index array */
+	if (con->buffer_curr + 2 > con->buffer_tail)
+		elog(ERROR, "RecordBatch has less buffers than expected");
+	buffer_curr = con->buffer_curr++;
+	if (fstate->null_count > 0)
+	{
+		fstate->nullmap_offset = buffer_curr->offset;
+		fstate->nullmap_length = buffer_curr->length;
+		if (fstate->nullmap_length < BITMAPLEN(fstate->nitems))
+			elog(ERROR, "nullmap length is smaller than expected");
+		if ((fstate->nullmap_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
+			(fstate->nullmap_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+			elog(ERROR, "nullmap is not aligned well");
+	}
+	buffer_curr = con->buffer_curr++;
+	fstate->values_offset = buffer_curr->offset;
+	fstate->values_length = buffer_curr->length;
+	fstate->values_rawlen = sizeof(cl_int) * fstate->nitems;
+	if (fstate->values_length < fstate->values_rawlen)
+		elog(ERROR, "dictionary index array is smaller than expected");
+	if ((fstate->values_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
+		(fstate->values_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+		elog(ERROR, "dictionary index array is not aligned well");
+
+	/* offset array and body of the dictionary */
+	buffer_curr = &dbatch->data.buffers[1];
+	fstate->dict_offset = db_offset + buffer_curr->offset - con->rb_offset;
+	fstate->dict_length = buffer_curr->length;
+	if (fstate->dict_length < sizeof(cl_uint) * (dict_nitems + 1))
+		elog(ERROR, "offset array of dictionary is smaller than expected");
+	buffer_curr = &dbatch->data.buffers[2];
+	fstate->extra_offset = db_offset + buffer_curr->offset - con->rb_offset;
+	fstate->extra_length = buffer_curr->length;
+	if ((fstate->dict_offset  & (MAXIMUM_ALIGNOF - 1)) != 0 ||
+		(fstate->dict_length  & (MAXIMUM_ALIGNOF - 1)) != 0 ||
+		(fstate->extra_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
+		(fstate->extra_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+		elog(ERROR, "dictionary is not aligned well");
+}
+
 static void
 setupRecordBatchField(setupRecordBatchContext *con,
 					  RecordBatchFieldState *fstate,
@@ -813,6 +1355,12 @@ setupRecordBatchField(setupRecordBatchContext *con,
 	fstate->nitems     = fnode->length;
 	fstate->null_count = fnode->null_count;
 
+	if (field->dictionary.indexType.node.tag == ArrowNodeTag__Int)
+	{
+		setupRecordBatchDictionaryField(con, fstate, field, depth);
+		return;
+	}
+
 	switch (field->type.node.tag)
 	{
 		case ArrowNodeTag__Int:
@@ -832,19 +1380,23 @@ setupRecordBatchField(setupRecordBatchContext *con,
 			{
 				fstate->nullmap_offset = buffer_curr->offset;
 				fstate->nullmap_length = buffer_curr->length;
-				if (fstate->nullmap_length < BITMAPLEN(fstate->nitems))
+				if (!con->compressed &&
+					fstate->nullmap_length < BITMAPLEN(fstate->nitems))
 					elog(ERROR, "nullmap length is smaller than expected");
 				if ((fstate->nullmap_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
-					(fstate->nullmap_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+					(!con->compressed &&
+					 (fstate->nullmap_length & (MAXIMUM_ALIGNOF - 1)) != 0))
 					elog(ERROR, "nullmap is not aligned well");
 			}
 			buffer_curr = con->buffer_curr++;
 			fstate->values_offset = buffer_curr->offset;
 			fstate->values_length = buffer_curr->length;
-			if (fstate->values_length < arrowFieldLength(field,fstate->nitems))
+			if (!con->compressed &&
+				fstate->values_length < arrowFieldLength(field,fstate->nitems))
 				elog(ERROR, "values array is smaller than expected");
 			if ((fstate->values_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
-				(fstate->values_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+				(!con->compressed &&
+				 (fstate->values_length & (MAXIMUM_ALIGNOF - 1)) != 0))
 				elog(ERROR, "values array is not aligned well");
 			break;
 
@@ -861,20 +1413,24 @@ setupRecordBatchField(setupRecordBatchContext *con,
 			{
 				fstate->nullmap_offset = buffer_curr->offset;
 				fstate->nullmap_length = buffer_curr->length;
-				if (fstate->nullmap_length < BITMAPLEN(fstate->nitems))
+				if (!con->compressed &&
+					fstate->nullmap_length < BITMAPLEN(fstate->nitems))
 					elog(ERROR, "nullmap length is smaller than expected");
 				if ((fstate->nullmap_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
-					(fstate->nullmap_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+					(!con->compressed &&
+					 (fstate->nullmap_length & (MAXIMUM_ALIGNOF - 1)) != 0))
 					elog(ERROR, "nullmap is not aligned well");
 			}
 			/* offset values */
 			buffer_curr = con->buffer_curr++;
 			fstate->values_offset = buffer_curr->offset;
 			fstate->values_length = buffer_curr->length;
-			if (fstate->values_length < arrowFieldLength(field,fstate->nitems))
+			if (!con->compressed &&
+				fstate->values_length < arrowFieldLength(field,fstate->nitems))
 				elog(ERROR, "offset array is smaller than expected");
 			if ((fstate->values_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
-				(fstate->values_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+				(!con->compressed &&
+				 (fstate->values_length & (MAXIMUM_ALIGNOF - 1)) != 0))
 				elog(ERROR, "offset array is not aligned well");
 			/* setup array element */
 			fstate->children = palloc0(sizeof(RecordBatchFieldState));
@@ -895,27 +1451,32 @@ setupRecordBatchField(setupRecordBatchContext *con,
 			{
 				fstate->nullmap_offset = buffer_curr->offset;
 				fstate->nullmap_length = buffer_curr->length;
-				if (fstate->nullmap_length < BITMAPLEN(fstate->nitems))
+				if (!con->compressed &&
+					fstate->nullmap_length < BITMAPLEN(fstate->nitems))
 					elog(ERROR, "nullmap length is smaller than expected");
 				if ((fstate->nullmap_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
-					(fstate->nullmap_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+					(!con->compressed &&
+					 (fstate->nullmap_length & (MAXIMUM_ALIGNOF - 1)) != 0))
 					elog(ERROR, "nullmap is not aligned well");
 			}
 
 			buffer_curr = con->buffer_curr++;
 			fstate->values_offset = buffer_curr->offset;
 			fstate->values_length = buffer_curr->length;
-			if (fstate->values_length < arrowFieldLength(field,fstate->nitems))
+			if (!con->compressed &&
+				fstate->values_length < arrowFieldLength(field,fstate->nitems))
 				elog(ERROR, "offset array is smaller than expected");
 			if ((fstate->values_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
-				(fstate->values_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+				(!con->compressed &&
+				 (fstate->values_length & (MAXIMUM_ALIGNOF - 1)) != 0))
 				elog(ERROR, "offset array is not aligned well");
 
 			buffer_curr = con->buffer_curr++;
 			fstate->extra_offset = buffer_curr->offset;
 			fstate->extra_length = buffer_curr->length;
 			if ((fstate->extra_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
-				(fstate->extra_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+				(!con->compressed &&
+				 (fstate->extra_length & (MAXIMUM_ALIGNOF - 1)) != 0))
 				elog(ERROR, "extra buffer is not aligned well");
 			break;
 
@@ -930,10 +1491,12 @@ setupRecordBatchField(setupRecordBatchContext *con,
 			{
 				fstate->nullmap_offset = buffer_curr->offset;
 				fstate->nullmap_length = buffer_curr->length;
-				if (fstate->nullmap_length < BITMAPLEN(fstate->nitems))
+				if (!con->compressed &&
+					fstate->nullmap_length < BITMAPLEN(fstate->nitems))
 					elog(ERROR, "nullmap length is smaller than expected");
 				if ((fstate->nullmap_offset & (MAXIMUM_ALIGNOF - 1)) != 0 ||
-					(fstate->nullmap_length & (MAXIMUM_ALIGNOF - 1)) != 0)
+					(!con->compressed &&
+					 (fstate->nullmap_length & (MAXIMUM_ALIGNOF - 1)) != 0))
 					elog(ERROR, "nullmap is not aligned well");
 			}
 
@@ -956,6 +1519,7 @@ setupRecordBatchField(setupRecordBatchContext *con,
 		default:
 			elog(ERROR, "Bug? ArrowSchema contains unsupported types");
 	}
+	fstate->values_rawlen = arrowFieldLength(field, fstate->nitems);
 	/* assign extra attributes (precision, unitsz, ...) */
 	assignArrowTypeOptions(&fstate->attopts, &field->type);
 }
@@ -963,7 +1527,8 @@ setupRecordBatchField(setupRecordBatchContext *con,
 static RecordBatchState *
 makeRecordBatchState(ArrowSchema *schema,
 					 ArrowBlock *block,
-					 ArrowRecordBatch *rbatch)
+					 ArrowRecordBatch *rbatch,
+					 ArrowFileInfo *af_info)
 {
 	setupRecordBatchContext con;
 	RecordBatchState *result;
@@ -974,12 +1539,40 @@ makeRecordBatchState(ArrowSchema *schema,
 	result->rb_offset = block->offset + block->metaDataLength;
 	result->rb_length = block->bodyLength;
 	result->rb_nitems = rbatch->length;
+	result->rb_compression = -1;
 
 	memset(&con, 0, sizeof(setupRecordBatchContext));
 	con.buffer_curr = rbatch->buffers;
 	con.buffer_tail = rbatch->buffers + rbatch->_num_buffers;
 	con.fnode_curr  = rbatch->nodes;
 	con.fnode_tail  = rbatch->nodes + rbatch->_num_nodes;
+	con.rb_offset   = result->rb_offset;
+	con.af_info     = af_info;
+	if (rbatch->compression.node.tag == ArrowNodeTag__BodyCompression)
+	{
+		ArrowBodyCompression *compression = &rbatch->compression;
+
+		if (compression->method != ArrowBodyCompressionMethod__BUFFER)
+			elog(ERROR, "arrow_fdw: unknown body compression method (%d)",
+				 (int)compression->method);
+		switch (compression->codec)
+		{
+#ifdef HAVE_LZ4
+			case ArrowCompressionType__LZ4_FRAME:
+				break;
+#endif
+#ifdef HAVE_ZSTD
+			case ArrowCompressionType__ZSTD:
+				break;
+#endif
+			default:
+				elog(ERROR, "arrow_fdw: compression codec (%s) is not supported in this build",
+					 compression->codec == ArrowCompressionType__LZ4_FRAME ? "LZ4_FRAME" :
+					 compression->codec == ArrowCompressionType__ZSTD ? "ZSTD" : "???");
+		}
+		result->rb_compression = compression->codec;
+		con.compressed = true;
+	}
 
 	for (j=0; j < ncols; j++)
 	{
@@ -996,3782 +1589,8720 @@ makeRecordBatchState(ArrowSchema *schema,
 }
 
 /*
- * ExecInitArrowFdw
+ * execInitArrowStatsHint
+ *
+ * It picks up simple qualifiers in the form of 'Var <op> Const/Param',
+ * where <op> is a btree comparison operator, to skip RecordBatches which
+ * never match the qualifiers according to the min/max statistics.
  */
-ArrowFdwState *
-ExecInitArrowFdw(Relation relation, Bitmapset *outer_refs)
+static bool
+__arrowStatsTypeIsSupported(Oid type_oid)
 {
-	TupleDesc		tupdesc = RelationGetDescr(relation);
-	ForeignTable   *ft = GetForeignTable(RelationGetRelid(relation));
-	List		   *filesList = NIL;
-	List		   *fdescList = NIL;
-	Bitmapset	   *referenced = NULL;
-	bool			whole_row_ref = false;
-	ArrowFdwState  *af_state;
-	List		   *rb_state_list = NIL;
-	ListCell	   *lc;
-	bool			writable;
-	int				i, num_rbatches;
-
-	Assert(RelationGetForm(relation)->relkind == RELKIND_FOREIGN_TABLE &&
-		   memcmp(GetFdwRoutineForRelation(relation, false),
-				  &pgstrom_arrow_fdw_routine, sizeof(FdwRoutine)) == 0);
-	/* expand 'referenced' if it has whole-row reference */
-	if (bms_is_member(-FirstLowInvalidHeapAttributeNumber, outer_refs))
-		whole_row_ref = true;
-	for (i=0; i < tupdesc->natts; i++)
+	switch (type_oid)
 	{
-		Form_pg_attribute attr = tupleDescAttr(tupdesc, i);
-		int		k = attr->attnum - FirstLowInvalidHeapAttributeNumber;
-
-		if (attr->attisdropped)
-			continue;
-		if (whole_row_ref || bms_is_member(k, outer_refs))
-			referenced = bms_add_member(referenced, k);
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return true;
+		default:
+			return false;
 	}
+}
 
-	filesList = __arrowFdwExtractFilesList(ft->options,
-										   NULL,
-										   &writable);
-	foreach (lc, filesList)
+/*
+ * __arrowStatsCheckOpExpr
+ *
+ * It checks whether the qualifier is 'Var <op> Const/Param' form that
+ * min/max statistics can be applied on.
+ */
+static bool
+__arrowStatsCheckOpExpr(OpExpr *op, int natts,
+						Var **p_var, Expr **p_arg, bool *p_var_on_left,
+						int *p_strategy, Oid *p_cmp_proc)
+{
+	Var			   *var;
+	Expr		   *arg;
+	bool			var_on_left;
+	TypeCacheEntry *tcache;
+	int				strategy;
+	Oid				lefttype;
+	Oid				righttype;
+	Oid				cmp_proc;
+
+	if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+		return false;
+	if (IsA(linitial(op->args), Var) &&
+		(IsA(lsecond(op->args), Const) ||
+		 IsA(lsecond(op->args), Param)))
 	{
-		char	   *fname = strVal(lfirst(lc));
-		File		fdesc;
-		List	   *rb_cached = NIL;
-		ListCell   *cell;
-
-		fdesc = PathNameOpenFile(fname, O_RDONLY | PG_BINARY);
-		if (fdesc < 0)
-		{
-			if (writable && errno == ENOENT)
-				continue;
-			elog(ERROR, "failed to open '%s' on behalf of '%s'",
-				 fname, RelationGetRelationName(relation));
-		}
-		fdescList = lappend_int(fdescList, fdesc);
-
-		rb_cached = arrowLookupOrBuildMetadataCache(fdesc);
-		/* check schema compatibility */
-		foreach (cell, rb_cached)
-		{
-			RecordBatchState   *rb_state = lfirst(cell);
-
-			if (!arrowSchemaCompatibilityCheck(tupdesc, rb_state))
-				elog(ERROR, "arrow file '%s' on behalf of foreign table '%s' has incompatible schema definition",
-					 fname, RelationGetRelationName(relation));
-		}
-		rb_state_list = list_concat(rb_state_list, rb_cached);
+		var = linitial(op->args);
+		arg = lsecond(op->args);
+		var_on_left = true;
 	}
-	num_rbatches = list_length(rb_state_list);
-	af_state = palloc0(offsetof(ArrowFdwState, rbatches[num_rbatches]));
-	af_state->fdescList = fdescList;
-	af_state->referenced = referenced;
-	af_state->rbatch_index = &af_state->__rbatch_index_local;
-	i = 0;
-	foreach (lc, rb_state_list)
-		af_state->rbatches[i++] = (RecordBatchState *)lfirst(lc);
-	af_state->num_rbatches = num_rbatches;
+	else if (IsA(lsecond(op->args), Var) &&
+			 (IsA(linitial(op->args), Const) ||
+			  IsA(linitial(op->args), Param)))
+	{
+		var = lsecond(op->args);
+		arg = linitial(op->args);
+		var_on_left = false;
+	}
+	else
+		return false;
 
-	return af_state;
+	if (IS_SPECIAL_VARNO(var->varno) ||
+		var->varlevelsup > 0 ||
+		var->varattno <= 0 ||
+		var->varattno > natts ||
+		!__arrowStatsTypeIsSupported(var->vartype))
+		return false;
+	tcache = lookup_type_cache(var->vartype, TYPECACHE_BTREE_OPFAMILY);
+	if (!OidIsValid(tcache->btree_opf) ||
+		!op_in_opfamily(op->opno, tcache->btree_opf))
+		return false;
+	get_op_opfamily_properties(op->opno, tcache->btree_opf, false,
+							   &strategy, &lefttype, &righttype);
+	cmp_proc = get_opfamily_proc(tcache->btree_opf,
+								 lefttype, righttype, BTORDER_PROC);
+	if (!OidIsValid(cmp_proc))
+		return false;
+
+	*p_var = var;
+	*p_arg = arg;
+	*p_var_on_left = var_on_left;
+	*p_strategy = strategy;
+	*p_cmp_proc = cmp_proc;
+	return true;
 }
 
-/*
- * ArrowBeginForeignScan
- */
-static void
-ArrowBeginForeignScan(ForeignScanState *node, int eflags)
+static arrowStatsHint *
+execInitArrowStatsHint(ScanState *ss, List *outer_quals)
 {
-	Relation		relation = node->ss.ss_currentRelation;
+	Relation		relation = ss->ss_currentRelation;
 	TupleDesc		tupdesc = RelationGetDescr(relation);
-	ForeignScan	   *fscan = (ForeignScan *) node->ss.ps.plan;
+	arrowStatsHint *as_hint = NULL;
 	ListCell	   *lc;
-	Bitmapset	   *referenced = NULL;
 
-	foreach (lc, fscan->fdw_private)
+	foreach (lc, outer_quals)
 	{
-		int		j = lfirst_int(lc);
+		OpExpr		   *op = lfirst(lc);
+		Var			   *var;
+		Expr		   *arg;
+		bool			var_on_left;
+		int				strategy;
+		Oid				cmp_proc;
+		arrowStatsCond *cond;
+		Expr		   *clause;
+
+		if (!__arrowStatsCheckOpExpr(op, tupdesc->natts,
+									 &var, &arg, &var_on_left,
+									 &strategy, &cmp_proc))
+			continue;
 
-		if (j >= 0 && j <= tupdesc->natts)
-			referenced = bms_add_member(referenced, j -
-										FirstLowInvalidHeapAttributeNumber);
+		cond = palloc0(sizeof(arrowStatsCond));
+		cond->attnum = var->varattno;
+		cond->strategy = (var_on_left
+						  ? strategy
+						  : BTCommuteStrategyNumber(strategy));
+		cond->var_on_left = var_on_left;
+		cond->collid = op->inputcollid;
+		fmgr_info(cmp_proc, &cond->cmp_func);
+		cond->argtype = exprType((Node *)arg);
+		cond->arg = ExecInitExpr(arg, &ss->ps);
+
+		if (!as_hint)
+		{
+			as_hint = palloc0(sizeof(arrowStatsHint));
+			as_hint->econtext = ss->ps.ps_ExprContext;
+		}
+		as_hint->conds = lappend(as_hint->conds, cond);
+		/* for EXPLAIN output, qualifier shall reference the varno=1 */
+		clause = copyObject((Expr *)op);
+		ChangeVarNodes((Node *)clause, var->varno, 1, 0);
+		as_hint->orig_quals = lappend(as_hint->orig_quals, clause);
 	}
-	node->fdw_state = ExecInitArrowFdw(relation, referenced);
+	return as_hint;
 }
 
-typedef struct
-{
-	off_t		rb_offset;
-	off_t		f_offset;
-	off_t		m_offset;
-	cl_int		io_index;
-	cl_int      depth;
-	strom_io_chunk ioc[FLEXIBLE_ARRAY_MEMBER];
-} arrowFdwSetupIOContext;
-
 /*
- * arrowFdwSetupIOvectorField
+ * execCheckArrowStatsHint
+ *
+ * It returns false, if RecordBatch never contains rows that satisfies the
+ * qualifiers.
  */
-static inline void
-__setupIOvectorField(arrowFdwSetupIOContext *con,
-					 off_t chunk_offset,
-					 size_t chunk_length,
-					 cl_uint *p_cmeta_offset,
-					 cl_uint *p_cmeta_length)
+static inline int
+__compareArrowStatsDatum(arrowStatsCond *cond, Datum stat, Datum key)
 {
-	off_t		f_pos = con->rb_offset + chunk_offset;
+	int		rv;
+
+	if (cond->var_on_left)
+		return DatumGetInt32(FunctionCall2Coll(&cond->cmp_func,
+											   cond->collid,
+											   stat, key));
+	rv = DatumGetInt32(FunctionCall2Coll(&cond->cmp_func,
+										 cond->collid,
+										 key, stat));
+	return (rv > 0 ? -1 : (rv < 0 ? 1 : 0));
+}
 
-	if (f_pos == con->f_offset &&
-		con->m_offset == MAXALIGN(con->m_offset))
-	{
-		/* good, buffer is continuous */
-		*p_cmeta_offset = __kds_packed(con->m_offset);
-		*p_cmeta_length = __kds_packed(chunk_length);
+static bool
+__execCheckArrowStatsConds(arrowStatsHint *as_hint, List *conds,
+						   RecordBatchState *rb_state)
+{
+	ListCell   *lc;
 
-		con->m_offset += chunk_length;
-		con->f_offset += chunk_length;
-	}
-	else
+	foreach (lc, conds)
 	{
-		off_t		f_base = TYPEALIGN_DOWN(PAGE_SIZE, f_pos);
-		off_t		f_tail;
-		off_t		shift = f_pos - f_base;
-		strom_io_chunk *ioc;
+		arrowStatsCond *cond = lfirst(lc);
+		RecordBatchFieldState *fstate = &rb_state->columns[cond->attnum-1];
+		Datum		key;
+		bool		isnull;
 
-		if (con->io_index < 0)
-			con->io_index = 0;	/* no previous i/o chunks */
-		else
+		if (!fstate->stat_valid)
+			continue;
+		key = ExecEvalExprSwitchContext(cond->arg,
+										as_hint->econtext,
+										&isnull);
+		if (isnull)
+			continue;
+		switch (cond->strategy)
 		{
-			ioc = &con->ioc[con->io_index++];
-
-			f_tail = TYPEALIGN(PAGE_SIZE, con->f_offset);
-			ioc->nr_pages = f_tail / PAGE_SIZE - ioc->fchunk_id;
-			con->m_offset += (f_tail - con->f_offset); //safety margin;
+			case BTLessStrategyNumber:
+				if (__compareArrowStatsDatum(cond, fstate->stat_min, key) >= 0)
+					return false;
+				break;
+			case BTLessEqualStrategyNumber:
+				if (__compareArrowStatsDatum(cond, fstate->stat_min, key) > 0)
+					return false;
+				break;
+			case BTEqualStrategyNumber:
+				if (__compareArrowStatsDatum(cond, fstate->stat_min, key) > 0 ||
+					__compareArrowStatsDatum(cond, fstate->stat_max, key) < 0)
+					return false;
+				break;
+			case BTGreaterEqualStrategyNumber:
+				if (__compareArrowStatsDatum(cond, fstate->stat_max, key) < 0)
+					return false;
+				break;
+			case BTGreaterStrategyNumber:
+				if (__compareArrowStatsDatum(cond, fstate->stat_max, key) <= 0)
+					return false;
+				break;
+			default:
+				break;
 		}
-		ioc = &con->ioc[con->io_index];
-		/* adjust position if con->m_offset is not aligned well */
-		if (con->m_offset + shift != MAXALIGN(con->m_offset + shift))
-			con->m_offset = MAXALIGN(con->m_offset + shift) - shift;
-		ioc->m_offset   = con->m_offset;
-		ioc->fchunk_id  = f_base / PAGE_SIZE;
-
-		*p_cmeta_offset = __kds_packed(con->m_offset + shift);
-		*p_cmeta_length = __kds_packed(chunk_length);
-
-		con->m_offset  += shift + chunk_length;
-		con->f_offset   = f_pos + chunk_length;
 	}
+	return true;
 }
 
-static void
-arrowFdwSetupIOvectorField(arrowFdwSetupIOContext *con,
-						   RecordBatchFieldState *fstate,
-						   kern_data_store *kds,
-						   kern_colmeta *cmeta)
+static bool
+execCheckArrowStatsHint(arrowStatsHint *as_hint, RecordBatchState *rb_state)
 {
-	//int		index = cmeta - kds->colmeta;
-
-	if (fstate->nullmap_length > 0)
-	{
-		Assert(fstate->null_count > 0);
-		__setupIOvectorField(con,
-							 fstate->nullmap_offset,
-							 fstate->nullmap_length,
-							 &cmeta->nullmap_offset,
-							 &cmeta->nullmap_length);
-		//elog(INFO, "D%d att[%d] nullmap=%lu,%lu m_offset=%lu f_offset=%lu", con->depth, index, fstate->nullmap_offset, fstate->nullmap_length, con->m_offset, con->f_offset);
-	}
-	if (fstate->values_length > 0)
-	{
-		__setupIOvectorField(con,
-							 fstate->values_offset,
-							 fstate->values_length,
-							 &cmeta->values_offset,
-							 &cmeta->values_length);
-		//elog(INFO, "D%d att[%d] values=%lu,%lu m_offset=%lu f_offset=%lu", con->depth, index, fstate->values_offset, fstate->values_length, con->m_offset, con->f_offset);
-	}
-	if (fstate->extra_length > 0)
-	{
-		__setupIOvectorField(con,
-							 fstate->extra_offset,
-							 fstate->extra_length,
-							 &cmeta->extra_offset,
-							 &cmeta->extra_length);
-		//elog(INFO, "D%d att[%d] extra=%lu,%lu m_offset=%lu f_offset=%lu", con->depth, index, fstate->extra_offset, fstate->extra_length, con->m_offset, con->f_offset);
-	}
-
-	/* nested sub-fields if composite types */
-	if (cmeta->atttypkind == TYPE_KIND__ARRAY ||
-		cmeta->atttypkind == TYPE_KIND__COMPOSITE)
-	{
-		kern_colmeta *subattr;
-		int		j;
-
-		Assert(fstate->num_children == cmeta->num_subattrs);
-		con->depth++;
-		for (j=0, subattr = &kds->colmeta[cmeta->idx_subattrs];
-			 j < cmeta->num_subattrs;
-			 j++, subattr++)
-		{
-			RecordBatchFieldState *child = &fstate->children[j];
-
-			arrowFdwSetupIOvectorField(con, child, kds, subattr);
-		}
-		con->depth--;
-	}
+	return (__execCheckArrowStatsConds(as_hint, as_hint->conds,
+									   rb_state) &&
+			__execCheckArrowStatsConds(as_hint, as_hint->key_conds,
+									   rb_state));
 }
 
 /*
- * arrowFdwSetupIOvector
+ * ExecAddArrowFdwKeyRange
+ *
+ * GpuJoin tells the range of inner hash keys once the inner hash table
+ * gets loaded, then RecordBatches out of the range can be skipped because
+ * its outer rows never match with the inner rows.
  */
-static strom_io_vector *
-arrowFdwSetupIOvector(kern_data_store *kds,
-					  RecordBatchState *rb_state,
-					  Bitmapset *referenced)
+static arrowStatsCond *
+__makeArrowStatsKeyCond(TypeCacheEntry *tcache, AttrNumber attnum,
+						StrategyNumber strategy, Datum key)
 {
-	arrowFdwSetupIOContext *con;
-	strom_io_vector *iovec = NULL;
-	int			j, nr_chunks = 0;
+	arrowStatsCond *cond = palloc0(sizeof(arrowStatsCond));
+
+	cond->attnum = attnum;
+	cond->strategy = strategy;
+	cond->var_on_left = true;
+	cond->collid = InvalidOid;
+	fmgr_info_copy(&cond->cmp_func, &tcache->cmp_proc_finfo,
+				   CurrentMemoryContext);
+	cond->argtype = tcache->type_id;
+	cond->arg = ExecInitExpr((Expr *)makeConst(tcache->type_id,
+											   -1,
+											   InvalidOid,
+											   tcache->typlen,
+											   key,
+											   false,
+											   tcache->typbyval), NULL);
+	return cond;
+}
 
-	Assert(kds->nr_colmeta >= kds->ncols);
-	con = alloca(offsetof(arrowFdwSetupIOContext,
-						  ioc[3 * kds->nr_colmeta]));
-	con->rb_offset = rb_state->rb_offset;
-	con->f_offset  = ~0UL;	/* invalid offset */
-	con->m_offset  = TYPEALIGN(PAGE_SIZE, KERN_DATA_STORE_HEAD_LENGTH(kds));
-	con->io_index  = -1;
-	for (j=0; j < kds->ncols; j++)
-	{
-		RecordBatchFieldState *fstate = &rb_state->columns[j];
-		kern_colmeta *cmeta = &kds->colmeta[j];
-		int			attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
+void
+ExecAddArrowFdwKeyRange(ArrowFdwState *af_state, AttrNumber attnum,
+						Oid type_oid, Datum min_key, Datum max_key)
+{
+	arrowStatsHint *as_hint = af_state->stats_hint;
+	TypeCacheEntry *tcache;
 
-		if (referenced && bms_is_member(attidx, referenced))
-			arrowFdwSetupIOvectorField(con, fstate, kds, cmeta);
-	}
-	if (con->io_index >= 0)
+	if (!__arrowStatsTypeIsSupported(type_oid))
+		return;
+	tcache = lookup_type_cache(type_oid, TYPECACHE_CMP_PROC_FINFO);
+	if (!OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+		return;
+	if (!as_hint)
 	{
-		/* close the last I/O chunks */
-		strom_io_chunk *ioc = &con->ioc[con->io_index];
-
-		ioc->nr_pages = (TYPEALIGN(PAGE_SIZE, con->f_offset) / PAGE_SIZE -
-						 ioc->fchunk_id);
-		con->m_offset = ioc->m_offset + PAGE_SIZE * ioc->nr_pages;
-		nr_chunks = con->io_index + 1;
+		as_hint = palloc0(sizeof(arrowStatsHint));
+		as_hint->econtext = CreateStandaloneExprContext();
+		af_state->stats_hint = as_hint;
 	}
-	kds->length = con->m_offset;
+	as_hint->key_conds = lappend(as_hint->key_conds,
+								 __makeArrowStatsKeyCond(tcache, attnum,
+											BTGreaterEqualStrategyNumber,
+														 min_key));
+	as_hint->key_conds = lappend(as_hint->key_conds,
+								 __makeArrowStatsKeyCond(tcache, attnum,
+											BTLessEqualStrategyNumber,
+														 max_key));
+}
 
-	iovec = palloc0(offsetof(strom_io_vector, ioc[nr_chunks]));
-	iovec->nr_chunks = nr_chunks;
-	if (nr_chunks > 0)
-		memcpy(iovec->ioc, con->ioc, sizeof(strom_io_chunk) * nr_chunks);
-	return iovec;
+/*
+ * ExecResetArrowFdwKeyRange
+ */
+void
+ExecResetArrowFdwKeyRange(ArrowFdwState *af_state)
+{
+	if (af_state->stats_hint)
+		af_state->stats_hint->key_conds = NIL;
 }
 
 /*
- * __dump_kds_and_iovec - just for debug
+ * __arrowRecordBatchLayoutHash
  */
-static inline void
-__dump_kds_and_iovec(kern_data_store *kds, strom_io_vector *iovec)
+static uint32
+__arrowRecordBatchLayoutHash(RecordBatchFieldState *columns, int ncols,
+							 uint32 hash)
 {
-#if 0
 	int		j;
 
-	elog(INFO, "nchunks = %d", iovec->nr_chunks);
-	for (j=0; j < iovec->nr_chunks; j++)
+	for (j=0; j < ncols; j++)
 	{
-		strom_io_chunk *ioc = &iovec->ioc[j];
-
-		elog(INFO, "io[%d] [ m_offset=%lu, f_read=%lu...%lu, nr_pages=%u}",
-			 j,
-			 ioc->m_offset,
-			 ioc->fchunk_id * PAGE_SIZE,
-			 (ioc->fchunk_id + ioc->nr_pages) * PAGE_SIZE,
-			 ioc->nr_pages);
+		RecordBatchFieldState *column = &columns[j];
+		int64	layout[10];
+
+		layout[0] = column->nitems;
+		layout[1] = column->null_count;
+		layout[2] = column->nullmap_offset;
+		layout[3] = column->nullmap_length;
+		layout[4] = column->values_offset;
+		layout[5] = column->values_length;
+		layout[6] = column->extra_offset;
+		layout[7] = column->extra_length;
+		layout[8] = column->dict_offset;
+		layout[9] = column->dict_length;
+		hash = ((hash << 1) | (hash >> 31)) ^
+			DatumGetUInt32(hash_any((unsigned char *)layout, sizeof(layout)));
+		if (column->num_children > 0)
+			hash = __arrowRecordBatchLayoutHash(column->children,
+												column->num_children,
+												hash);
 	}
+	return hash;
+}
 
-	elog(INFO, "kds {length=%zu nitems=%u typeid=%u typmod=%u table_oid=%u}",
-		 kds->length, kds->nitems,
-		 kds->tdtypeid, kds->tdtypmod, kds->table_oid);
-	for (j=0; j < kds->nr_colmeta; j++)
-	{
-		kern_colmeta *cmeta = &kds->colmeta[j];
-
-		elog(INFO, "%ccol[%d] nullmap=%lu,%lu values=%lu,%lu extra=%lu,%lu",
-			 j < kds->ncols ? ' ' : '*', j,
-			 __kds_unpack(cmeta->nullmap_offset),
-			 __kds_unpack(cmeta->nullmap_length),
-			 __kds_unpack(cmeta->values_offset),
-			 __kds_unpack(cmeta->values_length),
-			 __kds_unpack(cmeta->extra_offset),
-			 __kds_unpack(cmeta->extra_length));
+/*
+ * ExecArrowFdwRecordBatchIdents
+ *
+ * It returns the identifiers of the RecordBatches to be scanned, in the
+ * order of rb_index. The caller can tell which RecordBatches were already
+ * processed by the former queries, unless the Arrow files are modified by
+ * others than Arrow_Fdw.
+ */
+uint32
+ExecArrowFdwRecordBatchIdents(ArrowFdwState *af_state,
+							  ArrowRecordBatchIdent **p_idents)
+{
+	ArrowRecordBatchIdent *idents;
+	uint32		i;
 
+	idents = palloc0(sizeof(ArrowRecordBatchIdent) *
+					 Max(af_state->num_rbatches, 1));
+	for (i=0; i < af_state->num_rbatches; i++)
+	{
+		RecordBatchState *rb_state = af_state->rbatches[i];
+
+		idents[i].st_dev	= rb_state->stat_buf.st_dev;
+		idents[i].st_ino	= rb_state->stat_buf.st_ino;
+		idents[i].st_ctim	= rb_state->stat_buf.st_ctim;
+		idents[i].rb_offset	= rb_state->rb_offset;
+		idents[i].rb_length	= rb_state->rb_length;
+		idents[i].rb_nitems	= rb_state->rb_nitems;
+		idents[i].rb_layout	= __arrowRecordBatchLayoutHash(rb_state->columns,
+														   rb_state->ncols,
+														   0);
 	}
-#endif
+	*p_idents = idents;
+	return af_state->num_rbatches;
 }
 
 /*
- * arrowFdwLoadRecordBatch
+ * ExecSkipArrowFdwRecordBatches
+ *
+ * It marks the RecordBatches (by rb_index) not to be loaded by the scan.
  */
-static pgstrom_data_store *
-__arrowFdwLoadRecordBatch(RecordBatchState *rb_state,
-						  Relation relation,
-						  Bitmapset *referenced,
-						  GpuContext *gcontext,
-						  MemoryContext mcontext,
-						  int optimal_gpu)
+void
+ExecSkipArrowFdwRecordBatches(ArrowFdwState *af_state, Bitmapset *rb_skipped)
 {
-	TupleDesc			tupdesc = RelationGetDescr(relation);
-	pgstrom_data_store *pds;
-	kern_data_store	   *kds;
-	strom_io_vector	   *iovec;
-	size_t				head_sz;
-	int					j, fdesc;
-	CUresult			rc;
+	af_state->rb_skipped = bms_union(af_state->rb_skipped, rb_skipped);
+}
 
-	/* setup KDS and I/O-vector */
-	head_sz = KDS_calculateHeadSize(tupdesc);
-	kds = alloca(head_sz);
-	init_kernel_data_store(kds, tupdesc, 0, KDS_FORMAT_ARROW, 0);
-	kds->nitems = rb_state->rb_nitems;
-	kds->nrooms = rb_state->rb_nitems;
-	kds->table_oid = RelationGetRelid(relation);
-	Assert(head_sz == KERN_DATA_STORE_HEAD_LENGTH(kds));
-	for (j=0; j < kds->nr_colmeta; j++)
-		kds->colmeta[j].attopts = rb_state->columns[j].attopts;
-	iovec = arrowFdwSetupIOvector(kds, rb_state, referenced);
-	__dump_kds_and_iovec(kds, iovec);
+/*
+ * setupRecordBatchStats
+ *
+ * It restores min/max statistics of the RecordBatches from "min_values"
+ * and "max_values" custom-metadata of the fields, if any. Conversion of
+ * the values follows the same manner as pg_xxxx_arrow_ref() doing.
+ */
+static bool
+__parseRecordBatchStatDatum(RecordBatchFieldState *fstate,
+							const char *token, Datum *p_datum)
+{
+	char	   *end;
+	int64		ival = 0;
+	double		fval = 0.0;
+	int64		tz_offset;
+	Timestamp	ts;
+	DateADT		dt;
 
-	fdesc = FileGetRawDesc(rb_state->fdesc);
-	/*
-	 * If SSD-to-GPU Direct SQL is available on the arrow file, setup a small
-	 * PDS on host-pinned memory, with strom_io_vector.
-	 */
-	if (gcontext &&
-		gcontext->cuda_dindex == optimal_gpu &&
-		iovec->nr_chunks > 0 &&
-		kds->length <= gpuMemAllocIOMapMaxLength())
+	switch (fstate->atttypid)
 	{
-		size_t	iovec_sz = offsetof(strom_io_vector, ioc[iovec->nr_chunks]);
-
-		rc = gpuMemAllocHost(gcontext, (void **)&pds,
-							 offsetof(pgstrom_data_store, kds) +
-							 head_sz + iovec_sz);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on gpuMemAllocHost: %s", errorText(rc));
+		case FLOAT4OID:
+		case FLOAT8OID:
+			fval = strtod(token, &end);
+			break;
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			ival = strtol(token, &end, 10);
+			break;
+		default:
+			return false;
+	}
+	if (end == token || (*end != ',' && *end != '\0'))
+		return false;
 
-		pds->gcontext = gcontext;
-		pg_atomic_init_u32(&pds->refcnt, 1);
-		pds->nblocks_uncached = 0;
-		pds->filedesc = fdesc;
-		pds->iovec = (strom_io_vector *)((char *)&pds->kds + head_sz);
-		memcpy(&pds->kds, kds, head_sz);
-		memcpy(pds->iovec, iovec, iovec_sz);
+	switch (fstate->atttypid)
+	{
+		case INT2OID:
+			if (ival < SHRT_MIN || ival > SHRT_MAX)
+				return false;
+			*p_datum = Int16GetDatum((int16)ival);
+			break;
+		case INT4OID:
+			if (ival < INT_MIN || ival > INT_MAX)
+				return false;
+			*p_datum = Int32GetDatum((int32)ival);
+			break;
+		case INT8OID:
+			*p_datum = Int64GetDatum(ival);
+			break;
+		case FLOAT4OID:
+			*p_datum = Float4GetDatum((float4)fval);
+			break;
+		case FLOAT8OID:
+			*p_datum = Float8GetDatum(fval);
+			break;
+		case DATEOID:
+			switch (fstate->attopts.date.unit)
+			{
+				case ArrowDateUnit__Day:
+					dt = ival;
+					break;
+				case ArrowDateUnit__MilliSecond:
+					dt = ival / 1000;
+					break;
+				default:
+					return false;
+			}
+			dt -= (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE);
+			*p_datum = DateADTGetDatum(dt);
+			break;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			tz_offset = fstate->attopts.timestamp.tz_offset;
+			switch (fstate->attopts.timestamp.unit)
+			{
+				case ArrowTimeUnit__Second:
+					ts = ival * 1000000L + tz_offset;
+					break;
+				case ArrowTimeUnit__MilliSecond:
+					ts = ival * 1000L + tz_offset * 1000L;
+					break;
+				case ArrowTimeUnit__MicroSecond:
+					ts = ival + tz_offset * 1000000L;
+					break;
+				case ArrowTimeUnit__NanoSecond:
+					if (ival < 0)
+						return false;
+					ts = ival / 1000L + tz_offset * 1000000000L;
+					break;
+				default:
+					return false;
+			}
+			ts -= (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * USECS_PER_DAY;
+			*p_datum = TimestampGetDatum(ts);
+			break;
+		default:
+			return false;
 	}
-	else
+	return true;
+}
+
+static void
+__setupRecordBatchFieldStats(RecordBatchState **rb_states, int nbatches,
+							 int j, const char *values, bool is_max)
+{
+	const char *pos = values;
+	int			k;
+
+	for (k=0; k < nbatches; k++)
 	{
-		/* Elsewhere, load RecordBatch by filesystem */
-		if (gcontext)
+		RecordBatchFieldState *fstate = &rb_states[k]->columns[j];
+		const char *tail = (pos ? strchr(pos, ',') : NULL);
+		Datum		datum;
+
+		if (!pos || !__parseRecordBatchStatDatum(fstate, pos, &datum))
+			fstate->stat_valid = false;
+		else if (!is_max)
 		{
-			rc = gpuMemAllocManaged(gcontext,
-									(CUdeviceptr *)&pds,
-									offsetof(pgstrom_data_store,
-											 kds) + kds->length,
-									CU_MEM_ATTACH_GLOBAL);
-			if (rc != CUDA_SUCCESS)
-				elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+			fstate->stat_min = datum;
+			fstate->stat_valid = true;
 		}
 		else
-		{
-			pds = MemoryContextAllocHuge(mcontext,
-										 offsetof(pgstrom_data_store,
-												  kds) + kds->length);
-		}
-		__PDS_fillup_arrow(pds, gcontext, kds, fdesc, iovec);
+			fstate->stat_max = datum;	/* valid only if stat_min is valid */
+		pos = (tail ? tail + 1 : NULL);
 	}
-	pfree(iovec);
-	return pds;
 }
 
-static pgstrom_data_store *
-arrowFdwLoadRecordBatch(ArrowFdwState *af_state,
-						Relation relation,
-						EState *estate,
-						GpuContext *gcontext,
-						int optimal_gpu)
+static void
+setupRecordBatchStats(List *rb_state_list, ArrowSchema *schema)
 {
-	uint32		rb_index;
+	RecordBatchState **rb_states;
+	int			nbatches = list_length(rb_state_list);
+	int			i, j, k;
+	ListCell   *lc;
 
-	/* fetch next RecordBatch */
-	rb_index = pg_atomic_fetch_add_u32(af_state->rbatch_index, 1);
-	if (rb_index >= af_state->num_rbatches)
-		return NULL;	/* no more RecordBatch to read */
+	if (nbatches == 0)
+		return;
+	rb_states = palloc(sizeof(RecordBatchState *) * nbatches);
+	k = 0;
+	foreach (lc, rb_state_list)
+		rb_states[k++] = lfirst(lc);
 
-	return __arrowFdwLoadRecordBatch(af_state->rbatches[rb_index],
-									 relation,
-									 af_state->referenced,
-									 gcontext,
-									 estate->es_query_cxt,
-									 optimal_gpu);
-}
+	for (j=0; j < schema->_num_fields; j++)
+	{
+		ArrowField *field = &schema->fields[j];
+		const char *min_values = NULL;
+		const char *max_values = NULL;
 
-/*
- * ExecScanChunkArrowFdw
- */
-pgstrom_data_store *
-ExecScanChunkArrowFdw(GpuTaskState *gts)
-{
-	pgstrom_data_store *pds;
+		for (i=0; i < field->_num_custom_metadata; i++)
+		{
+			ArrowKeyValue *kv = &field->custom_metadata[i];
 
-	InstrStartNode(&gts->outer_instrument);
-	pds = arrowFdwLoadRecordBatch(gts->af_state,
-								  gts->css.ss.ss_currentRelation,
-								  gts->css.ss.ps.state,
-								  gts->gcontext,
-								  gts->optimal_gpu);
-	InstrStopNode(&gts->outer_instrument,
-				  !pds ? 0.0 : (double)pds->kds.nitems);
-	return pds;
+			if (strcmp(kv->key, "min_values") == 0)
+				min_values = kv->value;
+			else if (strcmp(kv->key, "max_values") == 0)
+				max_values = kv->value;
+		}
+		if (!min_values || !max_values)
+			continue;
+		__setupRecordBatchFieldStats(rb_states, nbatches, j,
+									 min_values, false);
+		__setupRecordBatchFieldStats(rb_states, nbatches, j,
+									 max_values, true);
+	}
+	pfree(rb_states);
 }
 
 /*
- * ArrowIterateForeignScan
+ * ExecInitArrowFdw
  */
-static TupleTableSlot *
-ArrowIterateForeignScan(ForeignScanState *node)
+ArrowFdwState *
+ExecInitArrowFdw(ScanState *ss, List *outer_quals, Bitmapset *outer_refs)
 {
-	ArrowFdwState  *af_state = node->fdw_state;
-	Relation		relation = node->ss.ss_currentRelation;
-	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
-	pgstrom_data_store *pds;
+	Relation		relation = ss->ss_currentRelation;
+	TupleDesc		tupdesc = RelationGetDescr(relation);
+	ForeignTable   *ft = GetForeignTable(RelationGetRelid(relation));
+	List		   *filesList = NIL;
+	List		   *fdescList = NIL;
+	Bitmapset	   *referenced = NULL;
+	bool			whole_row_ref = false;
+	ArrowFdwState  *af_state;
+	List		   *rb_state_list = NIL;
+	ListCell	   *lc;
+	bool			writable;
+	int				nfiles_pruned;
+	int				i, num_rbatches;
 
-	while ((pds = af_state->curr_pds) == NULL ||
-		   af_state->curr_index >= pds->kds.nitems)
+	Assert(RelationGetForm(relation)->relkind == RELKIND_FOREIGN_TABLE &&
+		   memcmp(GetFdwRoutineForRelation(relation, false),
+				  &pgstrom_arrow_fdw_routine, sizeof(FdwRoutine)) == 0);
+	/* expand 'referenced' if it has whole-row reference */
+	if (bms_is_member(-FirstLowInvalidHeapAttributeNumber, outer_refs))
+		whole_row_ref = true;
+	for (i=0; i < tupdesc->natts; i++)
 	{
-		EState	   *estate = node->ss.ps.state;
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, i);
+		int		k = attr->attnum - FirstLowInvalidHeapAttributeNumber;
 
-		/* unload the previous RecordBatch, if any */
-		if (pds)
-			PDS_release(pds);
-		af_state->curr_index = 0;
-		af_state->curr_pds = arrowFdwLoadRecordBatch(af_state,
-													 relation,
-													 estate,
-													 NULL, -1);
-		if (!af_state->curr_pds)
-			return NULL;
+		if (attr->attisdropped)
+			continue;
+		if (whole_row_ref || bms_is_member(k, outer_refs))
+			referenced = bms_add_member(referenced, k);
 	}
-	Assert(pds && af_state->curr_index < pds->kds.nitems);
-	if (KDS_fetch_tuple_arrow(slot, &pds->kds, af_state->curr_index++))
-		return slot;
-	return NULL;
+
+	filesList = __arrowFdwExtractFilesList(ft->options,
+										   NULL,
+										   &writable);
+	filesList = arrowFdwPruneFilesList(filesList, tupdesc, outer_quals,
+									   &nfiles_pruned);
+	foreach (lc, filesList)
+	{
+		char	   *fname = strVal(lfirst(lc));
+		File		fdesc;
+		List	   *rb_cached = NIL;
+		ListCell   *cell;
+
+		fdesc = PathNameOpenFile(fname, O_RDONLY | PG_BINARY);
+		if (fdesc < 0)
+		{
+			if (writable && errno == ENOENT)
+				continue;
+			elog(ERROR, "failed to open '%s' on behalf of '%s'",
+				 fname, RelationGetRelationName(relation));
+		}
+		fdescList = lappend_int(fdescList, fdesc);
+
+		rb_cached = arrowLookupOrBuildMetadataCache(fdesc);
+		/* check schema compatibility */
+		foreach (cell, rb_cached)
+		{
+			RecordBatchState   *rb_state = lfirst(cell);
+
+			if (!arrowSchemaCompatibilityCheck(tupdesc, rb_state))
+				elog(ERROR, "arrow file '%s' on behalf of foreign table '%s' has incompatible schema definition",
+					 fname, RelationGetRelationName(relation));
+		}
+		rb_state_list = list_concat(rb_state_list, rb_cached);
+	}
+	num_rbatches = list_length(rb_state_list);
+	af_state = palloc0(offsetof(ArrowFdwState, rbatches[num_rbatches]));
+	af_state->fdescList = fdescList;
+	af_state->nfiles_pruned = nfiles_pruned;
+	af_state->referenced = referenced;
+	af_state->stats_hint = execInitArrowStatsHint(ss, outer_quals);
+	af_state->rbatch_index = &af_state->__rbatch_index_local;
+	i = 0;
+	foreach (lc, rb_state_list)
+		af_state->rbatches[i++] = (RecordBatchState *)lfirst(lc);
+	af_state->num_rbatches = num_rbatches;
+
+	return af_state;
 }
 
 /*
- * ArrowReScanForeignScan
+ * arrowFdwSetupSubfieldRefs
+ *
+ * It picks up the sub-fields of composite columns referenced by FieldSelect,
+ * so only the child arrays of the referenced sub-fields are loaded.
+ * A column referenced by other than FieldSelect needs all the sub-fields.
+ * Only ForeignScan is supported, because all the expressions which may
+ * reference the columns are visible on the plan node.
  */
-void
-ExecReScanArrowFdw(ArrowFdwState *af_state)
+typedef struct
 {
-	/* rewind the current scan state */
-	pg_atomic_write_u32(af_state->rbatch_index, 0);
-	if (af_state->curr_pds)
-		PDS_release(af_state->curr_pds);
-	af_state->curr_pds = NULL;
-	af_state->curr_index = 0;
-}
+	Index		scanrelid;
+	int			natts;
+	bool	   *whole_refs;
+	Bitmapset **subfields;
+} arrowSubfieldRefsContext;
 
-static void
-ArrowReScanForeignScan(ForeignScanState *node)
+static bool
+__arrowFdwPickupSubfieldRefs(Node *node, arrowSubfieldRefsContext *con)
 {
-	ExecReScanArrowFdw((ArrowFdwState *)node->fdw_state);
-}
+	if (!node)
+		return false;
+	if (IsA(node, FieldSelect))
+	{
+		FieldSelect *fselect = (FieldSelect *) node;
+		Var		   *var = (Var *) fselect->arg;
+
+		if (IsA(var, Var) &&
+			var->varno == con->scanrelid &&
+			var->varlevelsup == 0 &&
+			var->varattno > 0 &&
+			var->varattno <= con->natts &&
+			fselect->fieldnum > 0)
+		{
+			int		j = var->varattno - 1;
 
-/*
- * ArrowEndForeignScan
- */
-void
-ExecEndArrowFdw(ArrowFdwState *af_state)
-{
-	ListCell   *lc;
+			con->subfields[j] = bms_add_member(con->subfields[j],
+											   fselect->fieldnum - 1);
+			return false;
+		}
+	}
+	else if (IsA(node, Var))
+	{
+		Var	   *var = (Var *) node;
 
-	foreach (lc, af_state->fdescList)
-		FileClose((File)lfirst_int(lc));
+		if (var->varno == con->scanrelid &&
+			var->varlevelsup == 0)
+		{
+			if (var->varattno == InvalidAttrNumber)
+				memset(con->whole_refs, 1, sizeof(bool) * con->natts);
+			else if (var->varattno > 0 && var->varattno <= con->natts)
+				con->whole_refs[var->varattno - 1] = true;
+		}
+		return false;
+	}
+	return expression_tree_walker(node, __arrowFdwPickupSubfieldRefs, con);
 }
 
 static void
-ArrowEndForeignScan(ForeignScanState *node)
+arrowFdwSetupSubfieldRefs(ArrowFdwState *af_state,
+						  TupleDesc tupdesc,
+						  ForeignScan *fscan)
 {
-	ExecEndArrowFdw((ArrowFdwState *)node->fdw_state);
-}
+	arrowSubfieldRefsContext con;
+	Bitmapset **ref_subfields = NULL;
+	int			j;
 
-/*
- * ArrowExplainForeignScan 
- */
-void
-ExplainArrowFdw(ArrowFdwState *af_state, Relation frel, ExplainState *es)
-{
-	TupleDesc	tupdesc = RelationGetDescr(frel);
-	ListCell   *lc;
-	int			fcount = 0;
-	char		label[80];
-	size_t	   *chunk_sz = alloca(sizeof(size_t) * tupdesc->natts);
-	int			i, j, k;
-	StringInfoData	buf;
-
-	/* shows referenced columns */
-	initStringInfo(&buf);
-	for (k = bms_next_member(af_state->referenced, -1);
-		 k >= 0;
-		 k = bms_next_member(af_state->referenced, k))
-	{
-		j = k + FirstLowInvalidHeapAttributeNumber - 1;
-
-		if (j >= 0)
-		{
-			Form_pg_attribute	attr = tupleDescAttr(tupdesc, j);
-			const char		   *attName = NameStr(attr->attname);
-			if (buf.len > 0)
-				appendStringInfoString(&buf, ", ");
-			appendStringInfoString(&buf, quote_identifier(attName));
-		}
-	}
-	ExplainPropertyText("referenced", buf.data, es);
+	con.scanrelid = fscan->scan.scanrelid;
+	con.natts = tupdesc->natts;
+	con.whole_refs = palloc0(sizeof(bool) * tupdesc->natts);
+	con.subfields = palloc0(sizeof(Bitmapset *) * tupdesc->natts);
+	__arrowFdwPickupSubfieldRefs((Node *)fscan->scan.plan.targetlist, &con);
+	__arrowFdwPickupSubfieldRefs((Node *)fscan->scan.plan.qual, &con);
+	__arrowFdwPickupSubfieldRefs((Node *)fscan->fdw_exprs, &con);
+	__arrowFdwPickupSubfieldRefs((Node *)fscan->fdw_recheck_quals, &con);
 
-	/* shows files on behalf of the foreign table */
-	foreach (lc, af_state->fdescList)
+	for (j=0; j < tupdesc->natts; j++)
 	{
-		File		fdesc = (File)lfirst_int(lc);
-		const char *fname = FilePathName(fdesc);
-		int			rbcount = 0;
-		char	   *pos = label;
-		struct stat	st_buf;
-
-		pos += snprintf(label, sizeof(label), "files%d", fcount++);
-		if (fstat(FileGetRawDesc(fdesc), &st_buf) != 0)
-			memset(&st_buf, 0, sizeof(struct stat));
-		if (es->format == EXPLAIN_FORMAT_TEXT)
-		{
-			resetStringInfo(&buf);
-			if (st_buf.st_size == 0)
-				appendStringInfoString(&buf, fname);
-			else
-				appendStringInfo(&buf, "%s (size: %s)",
-								 fname,
-								 format_bytesz(st_buf.st_size));
-			ExplainPropertyText(label, buf.data, es);
-		}
-		else
-		{
-			ExplainPropertyText(label, fname, es);
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
 
-			if (st_buf.st_size > 0)
-			{
-				sprintf(pos, "-size");
-				ExplainPropertyText(label, format_bytesz(st_buf.st_size), es);
-			}
-		}
-		if (!es->verbose)
+		if (con.whole_refs[j] || !con.subfields[j] ||
+			get_typtype(attr->atttypid) != TYPTYPE_COMPOSITE)
 			continue;
-
-		/* below only verbose mode */
-		memset(chunk_sz, 0, sizeof(size_t) * tupdesc->natts);
-		for (i=0; i < af_state->num_rbatches; i++)
-		{
-			RecordBatchState *rb_state = af_state->rbatches[i];
-
-			if (rb_state->fdesc != fdesc)
-				continue;
-
-			for (k = bms_next_member(af_state->referenced, -1);
-				 k >= 0;
-				 k = bms_next_member(af_state->referenced, k))
-			{
-				j = k + FirstLowInvalidHeapAttributeNumber - 1;
-				if (j < 0 || j >= tupdesc->natts)
-					continue;
-				chunk_sz[j] += RecordBatchFieldLength(&rb_state->columns[j]);
-			}
-			rbcount++;
-		}
-
-		if (rbcount >= 0)
-		{
-			for (k = bms_next_member(af_state->referenced, -1);
-                 k >= 0;
-                 k = bms_next_member(af_state->referenced, k))
-            {
-				Form_pg_attribute attr;
-
-				j = k + FirstLowInvalidHeapAttributeNumber - 1;
-				if (j < 0 || j >= tupdesc->natts)
-					continue;
-				attr = tupleDescAttr(tupdesc, j);
-				snprintf(label, sizeof(label),
-						 "  %s", NameStr(attr->attname));
-				ExplainPropertyText(label, format_bytesz(chunk_sz[j]), es);
-			}
-		}
+		if (!ref_subfields)
+			ref_subfields = palloc0(sizeof(Bitmapset *) * tupdesc->natts);
+		ref_subfields[j] = con.subfields[j];
 	}
-}
-
-static void
-ArrowExplainForeignScan(ForeignScanState *node, ExplainState *es)
-{
-	Relation	frel = node->ss.ss_currentRelation;
-
-	ExplainArrowFdw((ArrowFdwState *)node->fdw_state, frel, es);
+	af_state->ref_subfields = ref_subfields;
+	pfree(con.whole_refs);
+	pfree(con.subfields);
 }
 
 /*
- * readArrowFile
+ * ArrowBeginMetaAggScan
+ *
+ * It initializes the aggregation answered by the metadata. Because the plan
+ * has no scanrelid, the foreign table underlying the aggregation is opened
+ * here, then the usual ArrowFdwState is built on the relation.
  */
-static bool
-readArrowFile(const char *pathname, ArrowFileInfo *af_info, bool missing_ok)
+static void
+ArrowBeginMetaAggScan(ForeignScanState *node, int eflags)
 {
-    File	filp = PathNameOpenFile(pathname, O_RDONLY | PG_BINARY);
+	ForeignScan	   *fscan = (ForeignScan *) node->ss.ps.plan;
+	EState		   *estate = node->ss.ps.state;
+	List		   *quals = linitial(fscan->fdw_private);
+	List		   *ref_list = lsecond(fscan->fdw_private);
+	Relation		relation;
+	ArrowFdwState  *af_state;
+	arrowMetaAggState *ma_state;
+	Bitmapset	   *referenced = NULL;
+	ListCell	   *lc;
+	int				i, naggs = list_length(fscan->fdw_scan_tlist);
 
-	if (filp < 0)
+	relation = ExecOpenScanRelation(estate,
+									bms_singleton_member(fscan->fs_relids),
+									eflags);
+	node->ss.ss_currentRelation = relation;
+
+	ma_state = palloc0(offsetof(arrowMetaAggState, aggs[naggs]));
+	i = 0;
+	foreach (lc, fscan->fdw_scan_tlist)
 	{
-		if (missing_ok && errno == ENOENT)
-			return false;
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not open file \"%s\": %m", pathname)));
+		TargetEntry *tle = lfirst(lc);
+		arrowMetaAggItem *item = &ma_state->aggs[i++];
+
+		if (!IsA(tle->expr, Aggref))
+			elog(ERROR, "Bug? unexpected expression on Arrow_Fdw: %s",
+				 nodeToString(tle->expr));
+		item->kind = arrowMetaAggKind((Aggref *)tle->expr, 0, &item->attnum);
+		if (item->kind == 0)
+			elog(ERROR, "Bug? unsupported aggregate function on Arrow_Fdw");
+		if (item->kind == ARROW_META_AGG__MIN ||
+			item->kind == ARROW_META_AGG__MAX)
+		{
+			Form_pg_attribute attr = tupleDescAttr(RelationGetDescr(relation),
+												   item->attnum - 1);
+			TypeCacheEntry *tcache
+				= lookup_type_cache(attr->atttypid,
+									TYPECACHE_CMP_PROC_FINFO);
+			if (!OidIsValid(tcache->cmp_proc))
+				elog(ERROR, "no comparison function for type %s",
+					 format_type_be(attr->atttypid));
+			fmgr_info_copy(&item->cmp_func, &tcache->cmp_proc_finfo,
+						   CurrentMemoryContext);
+		}
 	}
-	readArrowFileDesc(FileGetRawDesc(filp), af_info);
-	FileClose(filp);
-	return true;
+	ma_state->naggs = naggs;
+	ma_state->quals = ExecInitQual(quals, &node->ss.ps);
+	ma_state->base_slot = MakeSingleTupleTableSlot(RelationGetDescr(relation),
+												   &TTSOpsVirtual);
+	foreach (lc, ref_list)
+		referenced = bms_add_member(referenced, lfirst_int(lc) -
+									FirstLowInvalidHeapAttributeNumber);
+	af_state = ExecInitArrowFdw(&node->ss, quals, referenced);
+	af_state->meta_agg = ma_state;
+	/* unless all the qualifiers are checked by stats, RecordBatch is scanned */
+	ma_state->quals_in_stats = (list_length(quals) ==
+								(af_state->stats_hint
+								 ? list_length(af_state->stats_hint->conds)
+								 : 0));
+	node->fdw_state = af_state;
 }
 
 /*
- * RecordBatchAcquireSampleRows - random sampling
+ * ArrowBeginForeignScan
  */
-static int
-RecordBatchAcquireSampleRows(Relation relation,
-							 RecordBatchState *rb_state,
-							 HeapTuple *rows,
-							 int nsamples)
+static void
+ArrowBeginForeignScan(ForeignScanState *node, int eflags)
 {
-	TupleDesc		tupdesc = RelationGetDescr(relation);
-	pgstrom_data_store *pds;
+	Relation		relation = node->ss.ss_currentRelation;
+	TupleDesc		tupdesc;
+	ForeignScan	   *fscan = (ForeignScan *) node->ss.ps.plan;
+	ListCell	   *lc;
 	Bitmapset	   *referenced = NULL;
-	Datum		   *values;
-	bool		   *isnull;
-	int				count;
-	int				i, j, nwords;
-
-	/* ANALYZE needs to fetch all the attributes */
-	nwords = (tupdesc->natts - FirstLowInvalidHeapAttributeNumber +
-			  BITS_PER_BITMAPWORD - 1) / BITS_PER_BITMAPWORD;
-	referenced = alloca(offsetof(Bitmapset, words[nwords]));
-	referenced->nwords = nwords;
-	memset(referenced->words, -1, sizeof(bitmapword) * nwords);
-	
-	pds = __arrowFdwLoadRecordBatch(rb_state,
-									relation,
-									referenced,
-									NULL,
-									CurrentMemoryContext,
-									-1);
-	values = alloca(sizeof(Datum) * tupdesc->natts);
-	isnull = alloca(sizeof(bool)  * tupdesc->natts);
-	for (count = 0; count < nsamples; count++)
-	{
-		/* fetch a row randomly */
-		i = (double)pds->kds.nitems * (((double) random()) /
-									   ((double)MAX_RANDOM_VALUE + 1));
-		Assert(i < pds->kds.nitems);
 
-		for (j=0; j < pds->kds.ncols; j++)
-		{
-			kern_colmeta   *cmeta = &pds->kds.colmeta[j];
-			
-			pg_datum_arrow_ref(&pds->kds,
-							   cmeta,
-							   i,
-							   values + j,
-							   isnull + j);
-		}
-		rows[count] = heap_form_tuple(tupdesc, values, isnull);
+	if (fscan->scan.scanrelid == 0)
+	{
+		ArrowBeginMetaAggScan(node, eflags);
+		return;
 	}
-	PDS_release(pds);
+	tupdesc = RelationGetDescr(relation);
+	foreach (lc, fscan->fdw_private)
+	{
+		int		j = lfirst_int(lc);
 
-	return count;
+		if (j >= 0 && j <= tupdesc->natts)
+			referenced = bms_add_member(referenced, j -
+										FirstLowInvalidHeapAttributeNumber);
+	}
+	node->fdw_state = ExecInitArrowFdw(&node->ss,
+									   fscan->scan.plan.qual,
+									   referenced);
+	arrowFdwSetupSubfieldRefs((ArrowFdwState *)node->fdw_state,
+							  tupdesc, fscan);
 }
 
+typedef struct
+{
+	off_t		rb_offset;
+	off_t		f_offset;
+	off_t		m_offset;
+	cl_int		io_index;
+	cl_int      depth;
+	strom_io_chunk ioc[FLEXIBLE_ARRAY_MEMBER];
+} arrowFdwSetupIOContext;
+
 /*
- * ArrowAcquireSampleRows
+ * arrowFdwSetupIOvectorField
  */
-static int
-ArrowAcquireSampleRows(Relation relation,
-					   int elevel,
-					   HeapTuple *rows,
-					   int nrooms,
-					   double *p_totalrows,
-					   double *p_totaldeadrows)
+static inline void
+__setupIOvectorField(arrowFdwSetupIOContext *con,
+					 off_t chunk_offset,
+					 size_t chunk_length,
+					 cl_uint *p_cmeta_offset,
+					 cl_uint *p_cmeta_length)
 {
-	TupleDesc		tupdesc = RelationGetDescr(relation);
-	ForeignTable   *ft = GetForeignTable(RelationGetRelid(relation));
-	List		   *filesList = NIL;
-	List		   *fdescList = NIL;
-	List		   *rb_state_list = NIL;
-	ListCell	   *lc;
-	bool			writable;
-	int64			total_nrows = 0;
-	int64			count_nrows = 0;
-	int				nsamples_min = nrooms / 100;
-	int				nitems = 0;
+	off_t		f_pos = con->rb_offset + chunk_offset;
 
-	filesList = __arrowFdwExtractFilesList(ft->options,
-										   NULL,
-										   &writable);
-	foreach (lc, filesList)
+	if (f_pos == con->f_offset &&
+		con->m_offset == MAXALIGN(con->m_offset))
 	{
-		char	   *fname = strVal(lfirst(lc));
-		File		fdesc;
-		List	   *rb_cached;
-		ListCell   *cell;
+		/* good, buffer is continuous */
+		*p_cmeta_offset = __kds_packed(con->m_offset);
+		*p_cmeta_length = __kds_packed(chunk_length);
 
-		fdesc = PathNameOpenFile(fname, O_RDONLY | PG_BINARY);
-        if (fdesc < 0)
+		con->m_offset += chunk_length;
+		con->f_offset += chunk_length;
+	}
+	else
+	{
+		off_t		f_base = TYPEALIGN_DOWN(PAGE_SIZE, f_pos);
+		off_t		f_tail;
+		off_t		shift = f_pos - f_base;
+		strom_io_chunk *ioc;
+
+		if (con->io_index < 0)
+			con->io_index = 0;	/* no previous i/o chunks */
+		else
 		{
-			if (writable && errno == ENOENT)
-				continue;
-			elog(ERROR, "failed to open file '%s' on behalf of '%s'",
-				 fname, RelationGetRelationName(relation));
-		}
-		fdescList = lappend_int(fdescList, fdesc);
-		
-		rb_cached = arrowLookupOrBuildMetadataCache(fdesc);
-		foreach (cell, rb_cached)
-		{
-			RecordBatchState *rb_state = lfirst(cell);
-
-			if (!arrowSchemaCompatibilityCheck(tupdesc, rb_state))
-				elog(ERROR, "arrow file '%s' on behalf of foreign table '%s' has incompatible schema definition",
-					 fname, RelationGetRelationName(relation));
-			if (rb_state->rb_nitems == 0)
-				continue;	/* not reasonable to sample, skipped */
-			total_nrows += rb_state->rb_nitems;
+			ioc = &con->ioc[con->io_index++];
 
-			rb_state_list = lappend(rb_state_list, rb_state);
+			f_tail = TYPEALIGN(PAGE_SIZE, con->f_offset);
+			ioc->nr_pages = f_tail / PAGE_SIZE - ioc->fchunk_id;
+			con->m_offset += (f_tail - con->f_offset); //safety margin;
 		}
-	}
-	nrooms = Min(nrooms, total_nrows);
+		ioc = &con->ioc[con->io_index];
+		/* adjust position if con->m_offset is not aligned well */
+		if (con->m_offset + shift != MAXALIGN(con->m_offset + shift))
+			con->m_offset = MAXALIGN(con->m_offset + shift) - shift;
+		ioc->m_offset   = con->m_offset;
+		ioc->fchunk_id  = f_base / PAGE_SIZE;
 
-	/* fetch samples for each record-batch */
-	foreach (lc, rb_state_list)
-	{
-		RecordBatchState *rb_state = lfirst(lc);
-		int			nsamples;
+		*p_cmeta_offset = __kds_packed(con->m_offset + shift);
+		*p_cmeta_length = __kds_packed(chunk_length);
 
-		count_nrows += rb_state->rb_nitems;
-		nsamples = (double)nrooms * ((double)count_nrows /
-									 (double)total_nrows) - nitems;
-		if (nitems + nsamples > nrooms)
-			nsamples = nrooms - nitems;
-		if (nsamples > nsamples_min)
-			nitems += RecordBatchAcquireSampleRows(relation,
-												   rb_state,
-												   rows + nitems,
-												   nsamples);
+		con->m_offset  += shift + chunk_length;
+		con->f_offset   = f_pos + chunk_length;
 	}
-	foreach (lc, fdescList)
-		FileClose((File)lfirst_int(lc));
-
-	*p_totalrows = total_nrows;
-	*p_totaldeadrows = 0.0;
-
-	return nitems;
 }
 
-/*
- * ArrowAnalyzeForeignTable
- */
-static bool
-ArrowAnalyzeForeignTable(Relation frel,
-						 AcquireSampleRowsFunc *p_sample_rows_func,
-						 BlockNumber *p_totalpages)
+static void
+arrowFdwSetupIOvectorField(arrowFdwSetupIOContext *con,
+						   RecordBatchFieldState *fstate,
+						   kern_data_store *kds,
+						   kern_colmeta *cmeta,
+						   Bitmapset *subfields)
 {
-	ForeignTable   *ft = GetForeignTable(RelationGetRelid(frel));
-	List		   *filesList = arrowFdwExtractFilesList(ft->options);
-	ListCell	   *lc;
-	Size			totalpages = 0;
+	//int		index = cmeta - kds->colmeta;
 
-	foreach (lc, filesList)
+	if (fstate->nullmap_length > 0)
 	{
-		const char *fname = strVal(lfirst(lc));
-		struct stat	statbuf;
-
-		if (stat(fname, &statbuf) != 0)
-		{
-			elog(NOTICE, "failed on stat('%s') on behalf of '%s', skipped",
-				 fname, get_rel_name(ft->relid));
-			continue;
-		}
-		totalpages += (statbuf.st_size + BLCKSZ - 1) / BLCKSZ;
+		Assert(fstate->null_count > 0);
+		__setupIOvectorField(con,
+							 fstate->nullmap_offset,
+							 fstate->nullmap_length,
+							 &cmeta->nullmap_offset,
+							 &cmeta->nullmap_length);
+		//elog(INFO, "D%d att[%d] nullmap=%lu,%lu m_offset=%lu f_offset=%lu", con->depth, index, fstate->nullmap_offset, fstate->nullmap_length, con->m_offset, con->f_offset);
 	}
-
-	if (totalpages > MaxBlockNumber)
-		totalpages = MaxBlockNumber;
-
-	*p_sample_rows_func = ArrowAcquireSampleRows;
-	*p_totalpages = totalpages;
-
-	return true;
-}
-
-/*
- * ArrowImportForeignSchema
- */
-static List *
-ArrowImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid serverOid)
-{
-	ArrowSchema	schema;
-	List	   *filesList;
-	ListCell   *lc;
-	int			j;
-	StringInfoData	cmd;
-
-	/* sanity checks */
-	switch (stmt->list_type)
+	if (fstate->values_length > 0)
 	{
-		case FDW_IMPORT_SCHEMA_ALL:
-			break;
-		case FDW_IMPORT_SCHEMA_LIMIT_TO:
-			elog(ERROR, "arrow_fdw does not support LIMIT TO clause");
-		case FDW_IMPORT_SCHEMA_EXCEPT:
-			elog(ERROR, "arrow_fdw does not support EXCEPT clause");
-		default:
-			elog(ERROR, "arrow_fdw: Bug? unknown list-type");
+		__setupIOvectorField(con,
+							 fstate->values_offset,
+							 fstate->values_length,
+							 &cmeta->values_offset,
+							 &cmeta->values_length);
+		//elog(INFO, "D%d att[%d] values=%lu,%lu m_offset=%lu f_offset=%lu", con->depth, index, fstate->values_offset, fstate->values_length, con->m_offset, con->f_offset);
+	}
+	if (fstate->dict_length > 0)
+	{
+		/* dictionary is located out of the RecordBatch */
+		__setupIOvectorField(con,
+							 fstate->dict_offset,
+							 fstate->dict_length,
+							 &cmeta->dict_offset,
+							 &cmeta->dict_length);
+	}
+	if (fstate->extra_length > 0)
+	{
+		__setupIOvectorField(con,
+							 fstate->extra_offset,
+							 fstate->extra_length,
+							 &cmeta->extra_offset,
+							 &cmeta->extra_length);
+		//elog(INFO, "D%d att[%d] extra=%lu,%lu m_offset=%lu f_offset=%lu", con->depth, index, fstate->extra_offset, fstate->extra_length, con->m_offset, con->f_offset);
 	}
-	filesList = arrowFdwExtractFilesList(stmt->options);
-	if (filesList == NIL)
-		ereport(ERROR,
-				(errmsg("No valid apache arrow files are specified"),
-				 errhint("Use 'file' or 'dir' option to specify apache arrow files on behalf of the foreign table")));
 
-	/* read the schema */
-	memset(&schema, 0, sizeof(ArrowSchema));
-	foreach (lc, filesList)
+	/* nested sub-fields if composite types */
+	if (cmeta->atttypkind == TYPE_KIND__ARRAY ||
+		cmeta->atttypkind == TYPE_KIND__COMPOSITE)
 	{
-		const char   *fname = strVal(lfirst(lc));
-		ArrowFileInfo af_info;
+		kern_colmeta *subattr;
+		int		j;
 
-		readArrowFile(fname, &af_info, false);
-		if (lc == list_head(filesList))
-		{
-			copyArrowNode(&schema.node, &af_info.footer.schema.node);
-		}
-		else
+		Assert(fstate->num_children == cmeta->num_subattrs);
+		con->depth++;
+		for (j=0, subattr = &kds->colmeta[cmeta->idx_subattrs];
+			 j < cmeta->num_subattrs;
+			 j++, subattr++)
 		{
-			/* compatibility checks */
-			ArrowSchema	   *stemp = &af_info.footer.schema;
+			RecordBatchFieldState *child = &fstate->children[j];
 
-			if (schema.endianness != stemp->endianness ||
-				schema._num_fields != stemp->_num_fields)
-				elog(ERROR, "file '%s' has incompatible schema definition",
-					 fname);
-			for (j=0; j < schema._num_fields; j++)
-			{
-				if (arrowTypeIsEqual(&schema.fields[j],
-									 &stemp->fields[j], 0))
-					elog(ERROR, "file '%s' has incompatible schema definition",
-						 fname);
-			}
+			if (subfields && !bms_is_member(j, subfields))
+				continue;	/* unreferenced sub-field is always NULL */
+			arrowFdwSetupIOvectorField(con, child, kds, subattr, NULL);
 		}
+		con->depth--;
 	}
+}
 
-	/* makes a command to define foreign table */
-	initStringInfo(&cmd);
-	appendStringInfo(&cmd, "CREATE FOREIGN TABLE %s (\n",
-					 quote_identifier(stmt->remote_schema));
-	for (j=0; j < schema._num_fields; j++)
+/*
+ * arrowFdwSetupIOvector
+ */
+static strom_io_vector *
+arrowFdwSetupIOvector(kern_data_store *kds,
+					  RecordBatchState *rb_state,
+					  Bitmapset *referenced,
+					  Bitmapset **ref_subfields)
+{
+	arrowFdwSetupIOContext *con;
+	strom_io_vector *iovec = NULL;
+	int			j, nr_chunks = 0;
+
+	Assert(kds->nr_colmeta >= kds->ncols);
+	con = alloca(offsetof(arrowFdwSetupIOContext,
+						  ioc[3 * kds->nr_colmeta]));
+	con->rb_offset = rb_state->rb_offset;
+	con->f_offset  = ~0UL;	/* invalid offset */
+	con->m_offset  = TYPEALIGN(PAGE_SIZE, KERN_DATA_STORE_HEAD_LENGTH(kds));
+	con->io_index  = -1;
+	for (j=0; j < kds->ncols; j++)
 	{
-		ArrowField *field = &schema.fields[j];
-		const char *type_name = arrowTypeToPGTypeName(field);
+		RecordBatchFieldState *fstate = &rb_state->columns[j];
+		kern_colmeta *cmeta = &kds->colmeta[j];
+		int			attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
 
-		if (j > 0)
-			appendStringInfo(&cmd, ",\n");
-		if (!field->name || field->_name_len == 0)
-		{
-			elog(NOTICE, "field %d has no name, so \"__col%02d\" is used",
-				 j+1, j+1);
-			appendStringInfo(&cmd, "  __col%02d  %s", j+1, type_name);
-		}
-		else
-			appendStringInfo(&cmd, "  %s %s",
-							 quote_identifier(field->name), type_name);
+		if (referenced && bms_is_member(attidx, referenced))
+			arrowFdwSetupIOvectorField(con, fstate, kds, cmeta,
+									   ref_subfields ? ref_subfields[j] : NULL);
 	}
-	appendStringInfo(&cmd,
-					 "\n"
-					 ") SERVER %s\n"
-					 "  OPTIONS (", stmt->server_name);
-	foreach (lc, stmt->options)
+	if (con->io_index >= 0)
 	{
-		DefElem	   *defel = lfirst(lc);
+		/* close the last I/O chunks */
+		strom_io_chunk *ioc = &con->ioc[con->io_index];
 
-		if (lc != list_head(stmt->options))
-			appendStringInfo(&cmd, ",\n           ");
-		appendStringInfo(&cmd, "%s '%s'",
-						 defel->defname,
-						 strVal(defel->arg));
+		ioc->nr_pages = (TYPEALIGN(PAGE_SIZE, con->f_offset) / PAGE_SIZE -
+						 ioc->fchunk_id);
+		con->m_offset = ioc->m_offset + PAGE_SIZE * ioc->nr_pages;
+		nr_chunks = con->io_index + 1;
 	}
-	appendStringInfo(&cmd, ")");
+	kds->length = con->m_offset;
 
-	return list_make1(cmd.data);
+	iovec = palloc0(offsetof(strom_io_vector, ioc[nr_chunks]));
+	iovec->nr_chunks = nr_chunks;
+	if (nr_chunks > 0)
+		memcpy(iovec->ioc, con->ioc, sizeof(strom_io_chunk) * nr_chunks);
+	return iovec;
 }
 
 /*
- * ArrowIsForeignScanParallelSafe
+ * __dump_kds_and_iovec - just for debug
  */
-static bool
-ArrowIsForeignScanParallelSafe(PlannerInfo *root,
-							   RelOptInfo *rel,
-							   RangeTblEntry *rte)
+static inline void
+__dump_kds_and_iovec(kern_data_store *kds, strom_io_vector *iovec)
 {
-	return true;
-}
+#if 0
+	int		j;
 
-/*
- * ArrowEstimateDSMForeignScan 
- */
-static Size
-ArrowEstimateDSMForeignScan(ForeignScanState *node,
-							ParallelContext *pcxt)
-{
-	//elog(INFO, "pid=%u ArrowEstimateDSMForeignScan", getpid());
-	return MAXALIGN(sizeof(pg_atomic_uint32));
+	elog(INFO, "nchunks = %d", iovec->nr_chunks);
+	for (j=0; j < iovec->nr_chunks; j++)
+	{
+		strom_io_chunk *ioc = &iovec->ioc[j];
+
+		elog(INFO, "io[%d] [ m_offset=%lu, f_read=%lu...%lu, nr_pages=%u}",
+			 j,
+			 ioc->m_offset,
+			 ioc->fchunk_id * PAGE_SIZE,
+			 (ioc->fchunk_id + ioc->nr_pages) * PAGE_SIZE,
+			 ioc->nr_pages);
+	}
+
+	elog(INFO, "kds {length=%zu nitems=%u typeid=%u typmod=%u table_oid=%u}",
+		 kds->length, kds->nitems,
+		 kds->tdtypeid, kds->tdtypmod, kds->table_oid);
+	for (j=0; j < kds->nr_colmeta; j++)
+	{
+		kern_colmeta *cmeta = &kds->colmeta[j];
+
+		elog(INFO, "%ccol[%d] nullmap=%lu,%lu values=%lu,%lu extra=%lu,%lu",
+			 j < kds->ncols ? ' ' : '*', j,
+			 __kds_unpack(cmeta->nullmap_offset),
+			 __kds_unpack(cmeta->nullmap_length),
+			 __kds_unpack(cmeta->values_offset),
+			 __kds_unpack(cmeta->values_length),
+			 __kds_unpack(cmeta->extra_offset),
+			 __kds_unpack(cmeta->extra_length));
+
+	}
+#endif
 }
 
 /*
- * ArrowInitializeDSMForeignScan
+ * arrowFdwLoadCompressedRecordBatch
+ *
+ * Arrow IPC allows to compress individual body buffers by LZ4_FRAME or ZSTD.
+ * Each compressed buffer has 8bytes prefix of the uncompressed length, or -1
+ * if the buffer is stored as is. The compressed image cannot be mapped on
+ * the KDS_FORMAT_ARROW by SSD-to-GPU Direct SQL, so we read and decompress
+ * them on the host side, then load the uncompressed KDS onto the device.
  */
-void
-ExecInitDSMArrowFdw(ArrowFdwState *af_state, pg_atomic_uint32 *rbatch_index)
+typedef struct
 {
-	pg_atomic_init_u32(rbatch_index, 0);
-	af_state->rbatch_index = rbatch_index;
-}
+	int			fdesc;
+	off_t		rb_offset;
+	int			codec;
+	size_t		m_offset;	/* current offset from the head of KDS */
+	char	   *kds_base;	/* NULL, if just estimation of the length */
+	char	   *rbuf;		/* buffer to read compressed image */
+	size_t		rbuf_sz;
+} arrowFdwDecompressContext;
 
 static void
-ArrowInitializeDSMForeignScan(ForeignScanState *node,
-							  ParallelContext *pcxt,
-							  void *coordinate)
+__arrowFdwPreadBuffer(int fdesc, void *buffer, size_t nbytes, off_t f_pos)
 {
-	ExecInitDSMArrowFdw((ArrowFdwState *)node->fdw_state,
-						(pg_atomic_uint32 *) coordinate);
+	ssize_t		sz, count = 0;
+
+	while (count < nbytes)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		sz = pread(fdesc, (char *)buffer + count, nbytes - count,
+				   f_pos + count);
+		if (sz > 0)
+			count += sz;
+		else if (sz == 0)
+			elog(ERROR, "unable to read arrow file any more");
+		else if (errno != EINTR)
+			elog(ERROR, "failed on pread(2) of arrow file: %m");
+	}
 }
 
 /*
- * ArrowReInitializeDSMForeignScan
+ * __arrowFdwDecompressBuffer
+ *
+ * It decompresses a body buffer onto the KDS. 'required' is the length the
+ * field needs for its nitems (or 0 if unknown); the uncompressed length
+ * written in the prefix must not be shorter than this.
  */
-void
-ExecReInitDSMArrowFdw(ArrowFdwState *af_state)
+static void
+__arrowFdwDecompressBuffer(arrowFdwDecompressContext *con,
+						   off_t chunk_offset,
+						   size_t chunk_length,
+						   size_t required,
+						   cl_uint *p_cmeta_offset,
+						   cl_uint *p_cmeta_length)
 {
-	pg_atomic_write_u32(af_state->rbatch_index, 0);
-}
+	off_t		f_pos = con->rb_offset + chunk_offset;
+	int64		raw_length;
+	size_t		comp_length;
+	bool		compressed = true;
+	char	   *dest;
+
+	if (chunk_length < sizeof(int64))
+		elog(ERROR, "arrow_fdw: compressed buffer is too short");
+	__arrowFdwPreadBuffer(con->fdesc, &raw_length, sizeof(int64), f_pos);
+	comp_length = chunk_length - sizeof(int64);
+	if (raw_length < 0)
+	{
+		/* -1 means the buffer is stored as is */
+		raw_length = comp_length;
+		compressed = false;
+	}
+	if (raw_length < required)
+		elog(ERROR, "arrow_fdw: uncompressed buffer length (%ld) is smaller than required (%zu)",
+			 raw_length, required);
 
+	con->m_offset = MAXALIGN(con->m_offset);
+	if (!con->kds_base)
+	{
+		/* just estimation of the KDS length */
+		con->m_offset += raw_length;
+		return;
+	}
+	dest = con->kds_base + con->m_offset;
+	*p_cmeta_offset = __kds_packed(con->m_offset);
+	*p_cmeta_length = __kds_packed(MAXALIGN(raw_length));
+	con->m_offset += raw_length;
+	/* tail padding within MAXALIGN */
+	memset(dest + raw_length, 0, MAXALIGN(raw_length) - raw_length);
+
+	if (!compressed)
+	{
+		__arrowFdwPreadBuffer(con->fdesc, dest, comp_length,
+							  f_pos + sizeof(int64));
+		return;
+	}
+	if (con->rbuf_sz < comp_length)
+	{
+		if (con->rbuf)
+			pfree(con->rbuf);
+		con->rbuf = MemoryContextAllocHuge(CurrentMemoryContext,
+										   comp_length);
+		con->rbuf_sz = comp_length;
+	}
+	__arrowFdwPreadBuffer(con->fdesc, con->rbuf, comp_length,
+						  f_pos + sizeof(int64));
+	switch (con->codec)
+	{
+#ifdef HAVE_LZ4
+		case ArrowCompressionType__LZ4_FRAME:
+			{
+				LZ4F_dctx  *dctx;
+				size_t		rv, src_pos = 0, dst_pos = 0;
+
+				rv = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+				if (LZ4F_isError(rv))
+					elog(ERROR, "failed on LZ4F_createDecompressionContext: %s",
+						 LZ4F_getErrorName(rv));
+				while (src_pos < comp_length)
+				{
+					size_t	dst_sz = raw_length - dst_pos;
+					size_t	src_sz = comp_length - src_pos;
+
+					rv = LZ4F_decompress(dctx,
+										 dest + dst_pos, &dst_sz,
+										 con->rbuf + src_pos, &src_sz,
+										 NULL);
+					if (LZ4F_isError(rv))
+						break;
+					dst_pos += dst_sz;
+					src_pos += src_sz;
+					if (rv == 0 || (dst_sz == 0 && src_sz == 0))
+						break;
+				}
+				LZ4F_freeDecompressionContext(dctx);
+				if (LZ4F_isError(rv))
+					elog(ERROR, "failed on LZ4F_decompress: %s",
+						 LZ4F_getErrorName(rv));
+				if (dst_pos != raw_length)
+					elog(ERROR, "arrow_fdw: LZ4 decompressed length mismatch (%zu of %ld)",
+						 dst_pos, raw_length);
+			}
+			break;
+#endif
+#ifdef HAVE_ZSTD
+		case ArrowCompressionType__ZSTD:
+			{
+				size_t		rv;
+
+				rv = ZSTD_decompress(dest, raw_length,
+									 con->rbuf, comp_length);
+				if (ZSTD_isError(rv))
+					elog(ERROR, "failed on ZSTD_decompress: %s",
+						 ZSTD_getErrorName(rv));
+				if (rv != raw_length)
+					elog(ERROR, "arrow_fdw: ZSTD decompressed length mismatch (%zu of %ld)",
+						 rv, raw_length);
+			}
+			break;
+#endif
+		default:
+			elog(ERROR, "Bug? unsupported compression codec (%d)", con->codec);
+	}
+}
 
 static void
-ArrowReInitializeDSMForeignScan(ForeignScanState *node,
-								ParallelContext *pcxt,
-								void *coordinate)
+arrowFdwDecompressField(arrowFdwDecompressContext *con,
+						RecordBatchFieldState *fstate,
+						kern_data_store *kds,
+						kern_colmeta *cmeta,
+						Bitmapset *subfields)
 {
-	ExecReInitDSMArrowFdw((ArrowFdwState *)node->fdw_state);
-}
+	if (fstate->nullmap_length > 0)
+	{
+		Assert(fstate->null_count > 0);
+		__arrowFdwDecompressBuffer(con,
+								   fstate->nullmap_offset,
+								   fstate->nullmap_length,
+								   BITMAPLEN(fstate->nitems),
+								   &cmeta->nullmap_offset,
+								   &cmeta->nullmap_length);
+	}
+	if (fstate->values_length > 0)
+		__arrowFdwDecompressBuffer(con,
+								   fstate->values_offset,
+								   fstate->values_length,
+								   fstate->values_rawlen,
+								   &cmeta->values_offset,
+								   &cmeta->values_length);
+	if (fstate->extra_length > 0)
+	{
+		size_t	required = 0;
 
-/*
- * ArrowInitializeWorkerForeignScan
- */
-void
-ExecInitWorkerArrowFdw(ArrowFdwState *af_state,
-					   pg_atomic_uint32 *rbatch_index)
-{
-	af_state->rbatch_index = rbatch_index;
+		/* the tail of offset array tells length of the extra buffer */
+		if (con->kds_base &&
+			fstate->values_length > 0 &&
+			fstate->dict_length == 0)
+		{
+			const cl_uint *offsets = (const cl_uint *)
+				(con->kds_base + __kds_unpack(cmeta->values_offset));
+			required = offsets[fstate->nitems];
+		}
+		__arrowFdwDecompressBuffer(con,
+								   fstate->extra_offset,
+								   fstate->extra_length,
+								   required,
+								   &cmeta->extra_offset,
+								   &cmeta->extra_length);
+	}
+
+	/* nested sub-fields if composite types */
+	if (cmeta->atttypkind == TYPE_KIND__ARRAY ||
+		cmeta->atttypkind == TYPE_KIND__COMPOSITE)
+	{
+		kern_colmeta *subattr;
+		int		j;
+
+		Assert(fstate->num_children == cmeta->num_subattrs);
+		for (j=0, subattr = &kds->colmeta[cmeta->idx_subattrs];
+			 j < cmeta->num_subattrs;
+			 j++, subattr++)
+		{
+			if (subfields && !bms_is_member(j, subfields))
+				continue;
+			arrowFdwDecompressField(con, &fstate->children[j],
+									kds, subattr, NULL);
+		}
+	}
 }
 
-static void
-ArrowInitializeWorkerForeignScan(ForeignScanState *node,
-								 shm_toc *toc,
-								 void *coordinate)
+static pgstrom_data_store *
+arrowFdwLoadCompressedRecordBatch(RecordBatchState *rb_state,
+								  kern_data_store *kds_head,
+								  Bitmapset *referenced,
+								  Bitmapset **ref_subfields,
+								  GpuContext *gcontext,
+								  MemoryContext mcontext)
 {
-	ExecInitWorkerArrowFdw((ArrowFdwState *)node->fdw_state,
-						   (pg_atomic_uint32 *) coordinate);
+	arrowFdwDecompressContext con;
+	pgstrom_data_store *pds = NULL;
+	kern_data_store *kds;
+	size_t		head_sz = KERN_DATA_STORE_HEAD_LENGTH(kds_head);
+	size_t		length;
+	int			pass, j;
+	CUresult	rc;
+
+	memset(&con, 0, sizeof(arrowFdwDecompressContext));
+	con.fdesc     = FileGetRawDesc(rb_state->fdesc);
+	con.rb_offset = rb_state->rb_offset;
+	con.codec     = rb_state->rb_compression;
+
+	/*
+	 * 1st pass estimates the length of KDS, and 2nd pass decompresses
+	 * the buffers onto the KDS actually.
+	 */
+	kds = kds_head;
+	for (pass=0; pass < 2; pass++)
+	{
+		con.m_offset = MAXALIGN(head_sz);
+		for (j=0; j < kds->ncols; j++)
+		{
+			int		attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
+
+			if (referenced && bms_is_member(attidx, referenced))
+				arrowFdwDecompressField(&con, &rb_state->columns[j],
+										kds, &kds->colmeta[j],
+										ref_subfields ? ref_subfields[j] : NULL);
+		}
+		if (pass > 0)
+			break;
+
+		length = MAXALIGN(con.m_offset);
+		if (gcontext)
+		{
+			rc = gpuMemAllocManaged(gcontext,
+									(CUdeviceptr *)&pds,
+									offsetof(pgstrom_data_store,
+											 kds) + length,
+									CU_MEM_ATTACH_GLOBAL);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+		}
+		else
+		{
+			pds = MemoryContextAllocHuge(mcontext,
+										 offsetof(pgstrom_data_store,
+												  kds) + length);
+		}
+		memset(pds, 0, offsetof(pgstrom_data_store, kds));
+		pds->gcontext = gcontext;
+		pg_atomic_init_u32(&pds->refcnt, 1);
+		pds->nblocks_uncached = 0;
+		pds->filedesc = -1;
+		pds->iovec = NULL;
+		memcpy(&pds->kds, kds_head, head_sz);
+		pds->kds.length = length;
+
+		kds = &pds->kds;
+		con.kds_base = (char *)kds;
+	}
+	if (con.rbuf)
+		pfree(con.rbuf);
+	return pds;
 }
 
 /*
- * ArrowShutdownForeignScan
+ * arrowFdwLoadParquetRowGroup
+ *
+ * Each row group of Apache Parquet file is mapped on a RecordBatchState,
+ * and values_offset/length of the fields point the column chunks. Parquet
+ * pages are encoded by PLAIN or dictionary, with RLE/bit-packed definition
+ * levels for NULLs, and optionally compressed, so we decode the column
+ * chunks on the host side onto the KDS_FORMAT_ARROW, like compressed
+ * RecordBatches.
  */
-void
-ExecShutdownArrowFdw(ArrowFdwState *af_state)
+typedef struct
 {
-	/* nothing to do */
+	int			fdesc;
+	off_t		rb_offset;
+	char	   *cbuf;		/* buffer to read a column chunk */
+	size_t		cbuf_sz;
+	char	   *pbuf;		/* buffer to decompress a data page */
+	size_t		pbuf_sz;
+	char	   *dbuf;		/* buffer to decompress a dictionary page */
+	size_t		dbuf_sz;
+	char	   *lbuf;		/* buffer of the decoded definition levels */
+	size_t		lbuf_sz;
+} parquetDecodeContext;
+
+typedef struct
+{
+	const unsigned char *pos;
+	const unsigned char *end;
+	int			bit_width;
+	uint64		rle_count;	/* remaining values in the RLE run */
+	uint32		rle_value;
+	uint64		bp_count;	/* remaining values in the bit-packed run */
+	uint64		bp_index;
+	const unsigned char *bp_pos;
+} parquetHybridDecoder;
+
+static char *
+__parquetExpandBuffer(char **p_buf, size_t *p_buf_sz, size_t required)
+{
+	if (*p_buf_sz < required)
+	{
+		if (*p_buf)
+			pfree(*p_buf);
+		*p_buf = MemoryContextAllocHuge(CurrentMemoryContext, required);
+		*p_buf_sz = required;
+	}
+	return *p_buf;
 }
 
 static void
-ArrowShutdownForeignScan(ForeignScanState *node)
+__parquetReleaseDecodeContext(parquetDecodeContext *con)
 {
-	ExecShutdownArrowFdw((ArrowFdwState *)node->fdw_state);
+	if (con->cbuf)
+		pfree(con->cbuf);
+	if (con->pbuf)
+		pfree(con->pbuf);
+	if (con->dbuf)
+		pfree(con->dbuf);
+	if (con->lbuf)
+		pfree(con->lbuf);
 }
 
 /*
- * ArrowPlanForeignModify
+ * __parquetColumnUnitSize - width of the Parquet physical type, and of the
+ * Arrow values; 0 means bit-packed boolean.
  */
-static List *
-ArrowPlanForeignModify(PlannerInfo *root,
-					   ModifyTable *plan,
-					   Index resultRelation,
-					   int subplan_index)
+static int
+__parquetColumnUnitSize(Oid atttypid, int *p_dst_unitsz)
 {
-	RangeTblEntry  *rte = planner_rt_fetch(resultRelation, root);
-	ForeignTable   *ft = GetForeignTable(rte->relid);
-	List		   *filesList;
-	bool			writable;
-
-	if (plan->operation != CMD_INSERT)
-		elog(ERROR, "not a supported operation on arrow_fdw foreign tables");
-
-	filesList = __arrowFdwExtractFilesList(ft->options,
-										   NULL,
-										   &writable);
-	if (!writable)
-		elog(ERROR, "arrow_fdw: foreign table \"%s\" is not writable",
-			 get_rel_name(rte->relid));
-	Assert(list_length(filesList) == 1);
+	int		src_unitsz;
+	int		dst_unitsz;
 
-	return NIL;
+	switch (atttypid)
+	{
+		case BOOLOID:
+			src_unitsz = dst_unitsz = 0;
+			break;
+		case INT2OID:
+			/* INT_8 and INT_16 are stored as INT32 */
+			src_unitsz = sizeof(int32);
+			dst_unitsz = sizeof(int16);
+			break;
+		case INT4OID:
+		case DATEOID:
+		case FLOAT4OID:
+			src_unitsz = dst_unitsz = sizeof(int32);
+			break;
+		case INT8OID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		case FLOAT8OID:
+			src_unitsz = dst_unitsz = sizeof(int64);
+			break;
+		default:
+			elog(ERROR, "arrow_fdw: Parquet column of %s is not supported",
+				 format_type_be(atttypid));
+	}
+	if (p_dst_unitsz)
+		*p_dst_unitsz = dst_unitsz;
+	return src_unitsz;
 }
 
 /*
- * ArrowBeginForeignModify
+ * __parquetSnappyDecompress - decoder of the raw Snappy format
+ *
+ * The format is a varint of the uncompressed length, then a sequence of
+ * literals and back-references of the already decoded bytes; see the
+ * format_description.txt of the Snappy project.
  */
 static void
-ArrowBeginForeignModify(ModifyTableState *mtstate,
-						ResultRelInfo *rrinfo,
-						List *fdw_private,
-						int subplan_index,
-						int eflags)
+__parquetSnappyDecompress(char *dest, size_t dest_sz,
+						  const char *__src, size_t src_sz)
 {
-	Relation		frel = rrinfo->ri_RelationDesc;
-	ForeignTable   *ft = GetForeignTable(RelationGetRelid(frel));
-	List		   *filesList = arrowFdwExtractFilesList(ft->options);
-	const char	   *fname;
-	File			filp;
-	bool			redo_log_written = false;
-
-	Assert(list_length(filesList) == 1);
-	fname = strVal(linitial(filesList));
-
-	LockRelation(frel, ShareRowExclusiveLock);
+	const unsigned char *src = (const unsigned char *)__src;
+	const unsigned char *end = src + src_sz;
+	uint64		raw_sz = 0;
+	size_t		pos = 0;
+	int			shift;
+
+	/* preamble; uncompressed length */
+	for (shift=0; ; shift += 7)
+	{
+		if (src >= end || shift > 63)
+			elog(ERROR, "arrow_fdw: Snappy preamble is corrupted");
+		raw_sz |= (uint64)(*src & 0x7f) << shift;
+		if ((*src++ & 0x80) == 0)
+			break;
+	}
+	if (raw_sz != dest_sz)
+		elog(ERROR, "arrow_fdw: Snappy decompressed length mismatch (%zu of %zu)",
+			 (size_t)raw_sz, dest_sz);
 
-	filp = PathNameOpenFile(fname, O_RDWR | PG_BINARY);
-	if (filp < 0)
+	while (src < end)
 	{
-		if (errno != ENOENT)
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not open file \"%s\": %m", fname)));
+		unsigned int tag = *src++;
+		size_t		len;
+		size_t		offset;
 
-		filp = PathNameOpenFile(fname, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
-		if (filp < 0)
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not open file \"%s\": %m", fname)));
-		PG_TRY();
-		{
-			createArrowWriteRedoLog(filp, true);
-			redo_log_written = true;
-		}
-		PG_CATCH();
+		if ((tag & 0x03) == 0x00)
 		{
-			unlink(fname);
-			PG_RE_THROW();
-		}
-		PG_END_TRY();
-	}
-	rrinfo->ri_FdwState = createArrowWriteState(frel, filp,
-												redo_log_written);
-}
-
-/*
- * ArrowExecForeignInsert
- */
-static TupleTableSlot *
-ArrowExecForeignInsert(EState *estate,
-					   ResultRelInfo *rrinfo,
-					   TupleTableSlot *slot,
-					   TupleTableSlot *planSlot)
-{
-	Relation		frel = rrinfo->ri_RelationDesc;
-	TupleDesc		tupdesc = RelationGetDescr(frel);
-	arrowWriteState *aw_state = rrinfo->ri_FdwState;
-	SQLtable	   *table = &aw_state->sql_table;
-	MemoryContext	oldcxt;
-	size_t			usage = 0;
-	int				j;
-
-	slot_getallattrs(slot);
-	oldcxt = MemoryContextSwitchTo(aw_state->memcxt);
-	for (j=0; j < tupdesc->natts; j++)
-	{
-		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
-		SQLfield   *column = &table->columns[j];
-		Datum		datum = slot->tts_values[j];
-		bool		isnull = slot->tts_isnull[j];
+			/* literal */
+			len = (tag >> 2);
+			if (len >= 60)
+			{
+				int		nbytes = len - 59;
+				int		i;
 
-		if (isnull)
+				if (end - src < nbytes)
+					elog(ERROR, "arrow_fdw: Snappy literal is truncated");
+				len = 0;
+				for (i=0; i < nbytes; i++)
+					len |= ((size_t)src[i]) << (8 * i);
+				src += nbytes;
+			}
+			len++;
+			if (end - src < len || dest_sz - pos < len)
+				elog(ERROR, "arrow_fdw: Snappy literal is out of range");
+			memcpy(dest + pos, src, len);
+			src += len;
+			pos += len;
+			continue;
+		}
+		/* copy from the decoded bytes */
+		if ((tag & 0x03) == 0x01)
 		{
-			usage += sql_field_put_value(column, NULL, 0);
+			if (end - src < 1)
+				elog(ERROR, "arrow_fdw: Snappy copy element is truncated");
+			len = ((tag >> 2) & 0x07) + 4;
+			offset = ((tag >> 5) << 8) | src[0];
+			src += 1;
 		}
-		else if (attr->attbyval)
+		else if ((tag & 0x03) == 0x02)
 		{
-			Assert(column->sql_type.pgsql.typbyval);
-			usage += sql_field_put_value(column, (char *)&datum, attr->attlen);
+			if (end - src < 2)
+				elog(ERROR, "arrow_fdw: Snappy copy element is truncated");
+			len = (tag >> 2) + 1;
+			offset = src[0] | (src[1] << 8);
+			src += 2;
 		}
-		else if (attr->attlen == -1)
+		else
 		{
-			int		vl_len = VARSIZE_ANY_EXHDR(datum);
-			char   *vl_ptr = VARDATA_ANY(datum);
-
-			Assert(column->sql_type.pgsql.typlen == -1);
-			usage += sql_field_put_value(column, vl_ptr, vl_len);
+			if (end - src < 4)
+				elog(ERROR, "arrow_fdw: Snappy copy element is truncated");
+			len = (tag >> 2) + 1;
+			offset = ((size_t)src[0]       |
+					  (size_t)src[1] <<  8 |
+					  (size_t)src[2] << 16 |
+					  (size_t)src[3] << 24);
+			src += 4;
 		}
+		if (offset == 0 || offset > pos || dest_sz - pos < len)
+			elog(ERROR, "arrow_fdw: Snappy copy element is out of range");
+		if (offset >= len)
+			memcpy(dest + pos, dest + pos - offset, len);
 		else
 		{
-			elog(ERROR, "Bug? unsupported type format");
+			/* overlapped copy repeats the last 'offset' bytes */
+			size_t	i;
+
+			for (i=0; i < len; i++)
+				dest[pos + i] = dest[pos + i - offset];
 		}
+		pos += len;
 	}
-	table->nitems++;
-	MemoryContextSwitchTo(oldcxt);
+	if (pos != dest_sz)
+		elog(ERROR, "arrow_fdw: Snappy decompressed length mismatch (%zu of %zu)",
+			 pos, dest_sz);
+}
 
-	/*
-	 * If usage exceeds the threshold of record-batch size, make a redo-log
-	 * on demand, and write out the buffer.
-	 */
-	if (usage > table->segment_sz)
-		writeOutArrowRecordBatch(aw_state, false);
+/*
+ * __parquetCodecIsSupported - checks whether the page compression codec
+ * can be decoded in this build
+ */
+static bool
+__parquetCodecIsSupported(int codec)
+{
+	switch (codec)
+	{
+		case ParquetCodec__UNCOMPRESSED:
+		case ParquetCodec__SNAPPY:
+#ifdef HAVE_ZSTD
+		case ParquetCodec__ZSTD:
+#endif
+			return true;
+		default:
+			break;
+	}
+	return false;
+}
 
-	return slot;
+static const char *
+__parquetCodecName(int codec)
+{
+	switch (codec)
+	{
+		case ParquetCodec__UNCOMPRESSED:	return "UNCOMPRESSED";
+		case ParquetCodec__SNAPPY:			return "SNAPPY";
+		case ParquetCodec__GZIP:			return "GZIP";
+		case ParquetCodec__LZO:				return "LZO";
+		case ParquetCodec__BROTLI:			return "BROTLI";
+		case ParquetCodec__LZ4:				return "LZ4";
+		case ParquetCodec__ZSTD:			return "ZSTD";
+		case ParquetCodec__LZ4_RAW:			return "LZ4_RAW";
+		default:							return "???";
+	}
 }
 
 /*
- * ArrowEndForeignModify
+ * checkParquetFileIsSupported
+ *
+ * Unsupported column types are already rejected on the schema build, so
+ * this checks the compression codec of the column chunks. It allows to
+ * raise an error on IMPORT FOREIGN SCHEMA or CREATE FOREIGN TABLE, rather
+ * than on the first scan.
  */
 static void
-ArrowEndForeignModify(EState *estate,
-					  ResultRelInfo *rrinfo)
+checkParquetFileIsSupported(ArrowFileInfo *af_info, const char *pathname)
 {
-	arrowWriteState *aw_state = rrinfo->ri_FdwState;
+	ArrowSchema *schema = &af_info->footer.schema;
+	int			i, j;
 
-	writeOutArrowRecordBatch(aw_state, true);
+	for (i=0; i < af_info->_num_rowGroups; i++)
+	{
+		ParquetRowGroup *rgroup = &af_info->rowGroups[i];
+
+		for (j=0; j < rgroup->_num_columns && j < schema->_num_fields; j++)
+		{
+			ParquetColumnChunk *cchunk = &rgroup->columns[j];
+
+			if (!__parquetCodecIsSupported(cchunk->codec))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("arrow_fdw: Parquet compression codec (%s) of column '%s' is not supported in this build",
+								__parquetCodecName(cchunk->codec),
+								schema->fields[j].name),
+						 errdetail("file: '%s'", pathname)));
+		}
+	}
+}
+
+static const char *
+__parquetDecompressPage(char **p_buf, size_t *p_buf_sz, int codec,
+						const char *src, size_t src_sz, size_t raw_sz)
+{
+	char	   *dest;
+
+	if (codec == ParquetCodec__UNCOMPRESSED)
+	{
+		if (src_sz != raw_sz)
+			elog(ERROR, "arrow_fdw: Parquet page length mismatch (%zu of %zu)",
+				 src_sz, raw_sz);
+		return src;
+	}
+	dest = __parquetExpandBuffer(p_buf, p_buf_sz, raw_sz);
+	switch (codec)
+	{
+		case ParquetCodec__SNAPPY:
+			__parquetSnappyDecompress(dest, raw_sz, src, src_sz);
+			break;
+#ifdef HAVE_ZSTD
+		case ParquetCodec__ZSTD:
+			{
+				size_t		rv;
+
+				rv = ZSTD_decompress(dest, raw_sz, src, src_sz);
+				if (ZSTD_isError(rv))
+					elog(ERROR, "failed on ZSTD_decompress: %s",
+						 ZSTD_getErrorName(rv));
+				if (rv != raw_sz)
+					elog(ERROR, "arrow_fdw: ZSTD decompressed length mismatch (%zu of %zu)",
+						 rv, raw_sz);
+			}
+			break;
+#endif
+		default:
+			elog(ERROR, "Bug? unsupported Parquet compression codec (%d)",
+				 codec);
+	}
+	return dest;
 }
 
 /*
- * ArrowExplainForeignModify
+ * __parquetHybridNext
+ *
+ * It fetches the next value of the RLE/bit-packed hybrid encoding, used for
+ * the definition levels and the dictionary indexes.
  */
 static void
-ArrowExplainForeignModify(ModifyTableState *mtstate,
-						  ResultRelInfo *rinfo,
-						  List *fdw_private,
-						  int subplan_index,
-						  struct ExplainState *es)
+__parquetHybridInit(parquetHybridDecoder *hd,
+					const char *buf, size_t len, int bit_width)
 {
-	/* print something */
+	if (bit_width < 0 || bit_width > 32)
+		elog(ERROR, "arrow_fdw: Parquet bit-width (%d) is out of range",
+			 bit_width);
+	memset(hd, 0, sizeof(parquetHybridDecoder));
+	hd->pos = (const unsigned char *)buf;
+	hd->end = (const unsigned char *)buf + len;
+	hd->bit_width = bit_width;
 }
 
-/*
- * handler of Arrow_Fdw
- */
-Datum
-pgstrom_arrow_fdw_handler(PG_FUNCTION_ARGS)
+static uint32
+__parquetHybridNext(parquetHybridDecoder *hd)
 {
-	PG_RETURN_POINTER(&pgstrom_arrow_fdw_routine);
+	uint64		bits = 0;
+	size_t		offset;
+	int			shift, k;
+
+	while (hd->rle_count == 0 && hd->bp_count == 0)
+	{
+		uint64		header = 0;
+		size_t		nbytes;
+		unsigned char c;
+
+		shift = 0;
+		do {
+			if (hd->pos >= hd->end || shift > 35)
+				elog(ERROR, "arrow_fdw: Parquet RLE/bit-packed run is corrupted");
+			c = *hd->pos++;
+			header |= ((uint64)(c & 0x7f)) << shift;
+			shift += 7;
+		} while ((c & 0x80) != 0);
+
+		if ((header & 1) == 0)
+		{
+			/* RLE run; the value is stored in ceil(bit_width/8) bytes */
+			nbytes = (hd->bit_width + 7) / 8;
+			if (nbytes > hd->end - hd->pos)
+				elog(ERROR, "arrow_fdw: Parquet RLE run is truncated");
+			hd->rle_value = 0;
+			for (k=0; k < nbytes; k++)
+				hd->rle_value |= ((uint32)hd->pos[k]) << (k * BITS_PER_BYTE);
+			hd->pos += nbytes;
+			hd->rle_count = (header >> 1);
+		}
+		else
+		{
+			/* bit-packed run; groups of 8 values */
+			nbytes = (header >> 1) * hd->bit_width;
+			if (nbytes > hd->end - hd->pos)
+				elog(ERROR, "arrow_fdw: Parquet bit-packed run is truncated");
+			hd->bp_pos = hd->pos;
+			hd->bp_index = 0;
+			hd->bp_count = (header >> 1) * 8;
+			hd->pos += nbytes;
+		}
+	}
+
+	if (hd->rle_count > 0)
+	{
+		hd->rle_count--;
+		return hd->rle_value;
+	}
+	/* values are packed from the LSB */
+	offset = hd->bp_index * hd->bit_width;
+	shift = (offset % BITS_PER_BYTE);
+	for (k=0; k < (shift + hd->bit_width + 7) / 8; k++)
+		bits |= ((uint64)hd->bp_pos[offset / BITS_PER_BYTE + k]) << (k * BITS_PER_BYTE);
+	hd->bp_index++;
+	hd->bp_count--;
+	return (bits >> shift) & ((1UL << hd->bit_width) - 1);
 }
-PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_handler);
 
 /*
- * arrowTypeIsEqual
+ * __parquetDecodeColumnChunk
+ *
+ * It decodes the pages in the column chunk, then writes out the nullmap
+ * and values on the supplied buffers, if not NULL. It returns the number
+ * of NULLs in the column chunk.
  */
-static bool
-arrowTypeIsEqual(ArrowField *a, ArrowField *b, int depth)
+static int64
+__parquetDecodeColumnChunk(parquetDecodeContext *con,
+						   RecordBatchFieldState *fstate,
+						   char *nullmap, char *values)
 {
-	int		j;
-
-	if (a->type.node.tag != b->type.node.tag)
-		return false;
-	switch (a->type.node.tag)
+	int			src_unitsz;
+	int			dst_unitsz;
+	const char *chunk;
+	size_t		chunk_sz = fstate->values_length;
+	size_t		pos = 0;
+	const char *dict = NULL;
+	int64		dict_nitems = 0;
+	int64		null_count = 0;
+	int64		row = 0;
+	int64		i, k;
+
+	src_unitsz = __parquetColumnUnitSize(fstate->atttypid, &dst_unitsz);
+	chunk = __parquetExpandBuffer(&con->cbuf, &con->cbuf_sz, chunk_sz);
+	__arrowFdwPreadBuffer(con->fdesc, (char *)chunk, chunk_sz,
+						  con->rb_offset + fstate->values_offset);
+	while (row < fstate->nitems)
 	{
-		case ArrowNodeTag__Int:
-			if (a->type.Int.bitWidth != b->type.Int.bitWidth)
-				return false;
-			break;
-		case ArrowNodeTag__FloatingPoint:
+		ParquetPageHeader phead;
+		const char *page;
+		const char *body;
+		size_t		body_sz;
+		const char *levels = NULL;
+		size_t		levels_sz = 0;
+		const char *valid = NULL;		/* NULL, if all valid */
+		int64		nvalids;
+
+		if (pos >= chunk_sz)
+			elog(ERROR, "arrow_fdw: Parquet column chunk has less values than expected");
+		pos += readParquetPageHeader(&phead, chunk + pos, chunk_sz - pos);
+		if (phead.compressed_page_size > chunk_sz - pos)
+			elog(ERROR, "arrow_fdw: Parquet page is out of the column chunk");
+		page = chunk + pos;
+		pos += phead.compressed_page_size;
+
+		if (phead.type == ParquetPageType__DICTIONARY_PAGE)
+		{
+			if (!values)
+				continue;
+			if ((phead.encoding != ParquetEncoding__PLAIN &&
+				 phead.encoding != ParquetEncoding__PLAIN_DICTIONARY) ||
+				src_unitsz == 0)
+				elog(ERROR, "arrow_fdw: unsupported Parquet dictionary page (encoding=%d)",
+					 (int)phead.encoding);
+			dict = __parquetDecompressPage(&con->dbuf, &con->dbuf_sz,
+										   fstate->parquet_codec,
+										   page, phead.compressed_page_size,
+										   phead.uncompressed_page_size);
+			dict_nitems = phead.num_values;
+			if (phead.uncompressed_page_size < src_unitsz * dict_nitems)
+				elog(ERROR, "arrow_fdw: Parquet dictionary page is too short");
+			continue;
+		}
+		else if (phead.type == ParquetPageType__DATA_PAGE)
+		{
+			/* levels and values are compressed together */
+			body = __parquetDecompressPage(&con->pbuf, &con->pbuf_sz,
+										   fstate->parquet_codec,
+										   page, phead.compressed_page_size,
+										   phead.uncompressed_page_size);
+			body_sz = phead.uncompressed_page_size;
+			if (fstate->parquet_max_def > 0)
 			{
-				ArrowPrecision	p1 = a->type.FloatingPoint.precision;
-				ArrowPrecision	p2 = b->type.FloatingPoint.precision;
-
-				if (p1 != p2)
-					return false;
+				uint32		len;
+
+				if (body_sz < sizeof(uint32))
+					elog(ERROR, "arrow_fdw: Parquet data page is too short");
+				memcpy(&len, body, sizeof(uint32));
+				if (len > body_sz - sizeof(uint32))
+					elog(ERROR, "arrow_fdw: Parquet definition levels are out of the page");
+				levels = body + sizeof(uint32);
+				levels_sz = len;
+				body += sizeof(uint32) + len;
+				body_sz -= sizeof(uint32) + len;
 			}
-			break;
-		case ArrowNodeTag__Utf8:
-		case ArrowNodeTag__Binary:
-		case ArrowNodeTag__Bool:
-			break;
-
-		case ArrowNodeTag__Decimal:
-			if (a->type.Decimal.precision != b->type.Decimal.precision ||
-				a->type.Decimal.scale != b->type.Decimal.scale)
-				return false;
-			break;
+		}
+		else if (phead.type == ParquetPageType__DATA_PAGE_V2)
+		{
+			/* levels are not compressed, and have no length prefix */
+			size_t		lv_sz = phead.def_levels_length;
+
+			if (phead.rep_levels_length != 0)
+				elog(ERROR, "arrow_fdw: Parquet repetition levels are not supported");
+			if (lv_sz > phead.compressed_page_size ||
+				lv_sz > phead.uncompressed_page_size)
+				elog(ERROR, "arrow_fdw: Parquet definition levels are out of the page");
+			levels = page;
+			levels_sz = lv_sz;
+			body_sz = phead.uncompressed_page_size - lv_sz;
+			body = __parquetDecompressPage(&con->pbuf, &con->pbuf_sz,
+										   phead.is_compressed
+										   ? fstate->parquet_codec
+										   : ParquetCodec__UNCOMPRESSED,
+										   page + lv_sz,
+										   phead.compressed_page_size - lv_sz,
+										   body_sz);
+		}
+		else
+		{
+			/* index pages have nothing to do */
+			continue;
+		}
+		if (phead.num_values > fstate->nitems - row)
+			elog(ERROR, "arrow_fdw: Parquet column chunk has more values than expected");
 
-		case ArrowNodeTag__Date:
-			if (a->type.Date.unit != b->type.Date.unit)
-				return false;
-			break;
+		/* definition levels; 1 means valid, 0 means NULL */
+		nvalids = phead.num_values;
+		if (fstate->parquet_max_def > 0)
+		{
+			parquetHybridDecoder hd;
+			char	   *lbuf;
 
-		case ArrowNodeTag__Time:
-			if (a->type.Time.unit != b->type.Time.unit)
-				return false;
-			break;
+			lbuf = __parquetExpandBuffer(&con->lbuf, &con->lbuf_sz,
+										 phead.num_values);
+			__parquetHybridInit(&hd, levels, levels_sz, 1);
+			for (i=0; i < phead.num_values; i++)
+			{
+				lbuf[i] = (__parquetHybridNext(&hd) != 0);
+				if (!lbuf[i])
+					nvalids--;
+				else if (nullmap)
+					nullmap[(row+i) >> 3] |= (1 << ((row+i) & 7));
+			}
+			valid = lbuf;
+		}
+		null_count += phead.num_values - nvalids;
 
-		case ArrowNodeTag__Timestamp:
-			if (a->type.Timestamp.unit != b->type.Timestamp.unit ||
-				a->type.Timestamp.timezone != NULL ||
-				b->type.Timestamp.timezone != NULL)
-				return false;
-			break;
+		/* values; NULLs are not stored */
+		if (!values)
+		{
+			/* just count NULLs */
+		}
+		else if (phead.encoding == ParquetEncoding__PLAIN)
+		{
+			if (src_unitsz == 0
+				? body_sz < BITMAPLEN(nvalids)
+				: body_sz < src_unitsz * nvalids)
+				elog(ERROR, "arrow_fdw: Parquet data page is too short");
+			for (i=0, k=0; i < phead.num_values; i++)
+			{
+				int64		index = row + i;
 
-		case ArrowNodeTag__Interval:
-			if (a->type.Interval.unit != b->type.Interval.unit)
-				return false;
-			break;
+				if (valid && !valid[i])
+					continue;
+				if (src_unitsz == 0)
+				{
+					if ((body[k >> 3] & (1 << (k & 7))) != 0)
+						values[index >> 3] |= (1 << (index & 7));
+				}
+				else if (src_unitsz == dst_unitsz)
+					memcpy(values + dst_unitsz * index,
+						   body + src_unitsz * k, dst_unitsz);
+				else
+				{
+					int32		ival;
 
-		case ArrowNodeTag__Struct:
-			if (depth > 0)
-				elog(ERROR, "arrow: nested composite types are not supported");
-			if (a->_num_children != b->_num_children)
-				return false;
-			for (j=0; j < a->_num_children; j++)
+					memcpy(&ival, body + src_unitsz * k, sizeof(int32));
+					((int16 *)values)[index] = (int16)ival;
+				}
+				k++;
+			}
+		}
+		else if (phead.encoding == ParquetEncoding__RLE && src_unitsz == 0)
+		{
+			/* booleans by RLE, with 4bytes length prefix */
+			parquetHybridDecoder hd;
+			uint32		len;
+
+			if (body_sz < sizeof(uint32))
+				elog(ERROR, "arrow_fdw: Parquet data page is too short");
+			memcpy(&len, body, sizeof(uint32));
+			if (len > body_sz - sizeof(uint32))
+				elog(ERROR, "arrow_fdw: Parquet RLE values are out of the page");
+			__parquetHybridInit(&hd, body + sizeof(uint32), len, 1);
+			for (i=0; i < phead.num_values; i++)
 			{
-				if (!arrowTypeIsEqual(&a->children[j],
-									  &b->children[j],
-									  depth + 1))
-					return false;
+				int64		index = row + i;
+
+				if (valid && !valid[i])
+					continue;
+				if (__parquetHybridNext(&hd) != 0)
+					values[index >> 3] |= (1 << (index & 7));
 			}
-			break;
+		}
+		else if (phead.encoding == ParquetEncoding__PLAIN_DICTIONARY ||
+				 phead.encoding == ParquetEncoding__RLE_DICTIONARY)
+		{
+			parquetHybridDecoder hd;
+
+			if (!dict)
+				elog(ERROR, "arrow_fdw: Parquet dictionary page is missing");
+			if (body_sz < 1)
+				elog(ERROR, "arrow_fdw: Parquet data page is too short");
+			__parquetHybridInit(&hd, body + 1, body_sz - 1,
+								(unsigned char)body[0]);
+			for (i=0; i < phead.num_values; i++)
+			{
+				int64		index = row + i;
+				uint32		code;
 
-		case ArrowNodeTag__List:
-			if (depth > 0)
-				elog(ERROR, "arrow_fdw: nested array types are not supported");
-			if (a->_num_children != 1 || b->_num_children != 1)
-				elog(ERROR, "Bug? List of arrow type is corrupted.");
-			if (!arrowTypeIsEqual(&a->children[0],
-								  &b->children[0],
-								  depth + 1))
-				return false;
-			break;
+				if (valid && !valid[i])
+					continue;
+				code = __parquetHybridNext(&hd);
+				if (code >= dict_nitems)
+					elog(ERROR, "arrow_fdw: Parquet dictionary index (%u) is out of range",
+						 code);
+				if (src_unitsz == dst_unitsz)
+					memcpy(values + dst_unitsz * index,
+						   dict + src_unitsz * code, dst_unitsz);
+				else
+				{
+					int32		ival;
 
-		default:
-			elog(ERROR, "'%s' of arrow type is not supported",
-				 a->type.node.tagName);
+					memcpy(&ival, dict + src_unitsz * code, sizeof(int32));
+					((int16 *)values)[index] = (int16)ival;
+				}
+			}
+		}
+		else
+		{
+			elog(ERROR, "arrow_fdw: unsupported Parquet data page (encoding=%d)",
+				 (int)phead.encoding);
+		}
+		row += phead.num_values;
 	}
-	return true;
+	return null_count;
 }
 
-static Oid
-arrowTypeToPGTypeOid(ArrowField *field, int *typmod)
+/*
+ * makeParquetRowGroupState
+ */
+static RecordBatchState *
+makeParquetRowGroupState(ArrowSchema *schema,
+						 ParquetRowGroup *rgroup,
+						 File fdesc)
 {
-	ArrowType  *t = &field->type;
+	RecordBatchState *result;
+	parquetDecodeContext con;
+	off_t		rg_head = LONG_MAX;
+	off_t		rg_tail = 0;
+	int			j, ncols = schema->_num_fields;
 
-	*typmod = -1;
-	switch (t->node.tag)
+	Assert(rgroup->_num_columns == ncols);
+	for (j=0; j < ncols; j++)
 	{
-		case ArrowNodeTag__Int:
-			switch (t->Int.bitWidth)
-			{
-				case 16:
-					return INT2OID;
-				case 32:
-					return INT4OID;
-				case 64:
-					return INT8OID;
-				default:
-					elog(ERROR, "Arrow.%s is not supported",
-						 arrowTypeName(field));
-					break;
-			}
-			break;
-		case ArrowNodeTag__FloatingPoint:
-			switch (t->FloatingPoint.precision)
-			{
-				case ArrowPrecision__Half:
-					return FLOAT2OID;
-				case ArrowPrecision__Single:
-					return FLOAT4OID;
-				case ArrowPrecision__Double:
-					return FLOAT8OID;
-				default:
-					elog(ERROR, "Arrow.%s is not supported",
-						 arrowTypeName(field));
-			}
-			break;
-		case ArrowNodeTag__Utf8:
-			return TEXTOID;
-		case ArrowNodeTag__Binary:
-			return BYTEAOID;
-		case ArrowNodeTag__Bool:
-			return BOOLOID;
-		case ArrowNodeTag__Decimal:
-			return NUMERICOID;
-		case ArrowNodeTag__Date:
-			return DATEOID;
-		case ArrowNodeTag__Time:
-			return TIMEOID;
-		case ArrowNodeTag__Timestamp:
-			if (t->Timestamp.timezone)
-				return TIMESTAMPTZOID;
-			return TIMESTAMPOID;
-		case ArrowNodeTag__Interval:
-			return INTERVALOID;
-		case ArrowNodeTag__List:
-			if (field->_num_children != 1)
-				elog(ERROR, "arrow_fdw: corrupted List type definition");
-			else
-			{
-				ArrowField *child = &field->children[0];
-				Oid		type_oid;
-				Oid		elem_oid;
-				int		elem_mod;
+		ParquetColumnChunk *cchunk = &rgroup->columns[j];
 
-				elem_oid = arrowTypeToPGTypeOid(child, &elem_mod);
-				type_oid = get_array_type(elem_oid);
-				if (!OidIsValid(type_oid))
-					elog(ERROR, "array of arrow::%s type is not defined",
-						 arrowTypeName(field));
-				return type_oid;
-			}
-			break;
+		rg_head = Min(rg_head, cchunk->chunk_offset);
+		rg_tail = Max(rg_tail, cchunk->chunk_offset + cchunk->chunk_length);
+	}
+	if (rg_head > rg_tail)
+		rg_head = rg_tail = 0;
 
-		case ArrowNodeTag__Struct:
-			{
-				Relation	rel;
-				ScanKeyData	skey[2];
-				SysScanDesc	sscan;
-				HeapTuple	tup;
-				Oid			type_oid = InvalidOid;
+	result = palloc0(offsetof(RecordBatchState, columns[ncols]));
+	result->ncols = ncols;
+	result->rb_offset = rg_head;
+	result->rb_length = rg_tail - rg_head;
+	result->rb_nitems = rgroup->num_rows;
+	result->rb_compression = ARROW_PARQUET_ROWGROUP;
+
+	memset(&con, 0, sizeof(parquetDecodeContext));
+	con.fdesc = FileGetRawDesc(fdesc);
+	con.rb_offset = rg_head;
+	for (j=0; j < ncols; j++)
+	{
+		RecordBatchFieldState *fstate = &result->columns[j];
+		ArrowField		   *field = &schema->fields[j];
+		ParquetColumnChunk *cchunk = &rgroup->columns[j];
+
+		if (!__parquetCodecIsSupported(cchunk->codec))
+			elog(ERROR, "arrow_fdw: Parquet compression codec (%s) is not supported in this build",
+				 __parquetCodecName(cchunk->codec));
+		fstate->atttypid   = arrowTypeToPGTypeOid(field, &fstate->atttypmod);
+		fstate->nitems     = rgroup->num_rows;
+		fstate->null_count = cchunk->null_count;
+		fstate->values_offset = cchunk->chunk_offset - rg_head;
+		fstate->values_length = cchunk->chunk_length;
+		fstate->values_rawlen = arrowFieldLength(field, fstate->nitems);
+		fstate->parquet_codec = cchunk->codec;
+		fstate->parquet_max_def = cchunk->max_def_level;
+		/* also checks whether the type is supported */
+		__parquetColumnUnitSize(fstate->atttypid, NULL);
+
+		if (fstate->parquet_max_def == 0)
+			fstate->null_count = 0;
+		else if (fstate->null_count < 0)
+		{
+			/* no statistics, so count NULLs by the definition levels */
+			fstate->null_count = __parquetDecodeColumnChunk(&con, fstate,
+															NULL, NULL);
+		}
+		if (fstate->null_count > fstate->nitems)
+			elog(ERROR, "arrow_fdw: Parquet column chunk has corrupted null_count");
+		assignArrowTypeOptions(&fstate->attopts, &field->type);
+	}
+	__parquetReleaseDecodeContext(&con);
 
-				/*
-				 * lookup composite type definition from pg_class
-				 * At least, nattrs == _num_children
-				 */
-				rel = table_open(RelationRelationId, AccessShareLock);
-				ScanKeyInit(&skey[0],
-							Anum_pg_class_relkind,
-							BTEqualStrategyNumber, F_CHAREQ,
-							CharGetDatum(RELKIND_COMPOSITE_TYPE));
-				ScanKeyInit(&skey[1],
-							Anum_pg_class_relnatts,
-							BTEqualStrategyNumber, F_INT2EQ,
-							Int16GetDatum(field->_num_children));
+	return result;
+}
 
-				sscan = systable_beginscan(rel, InvalidOid, false,
-										   NULL, 2, skey);
-				while (!OidIsValid(type_oid) &&
-					   HeapTupleIsValid(tup = systable_getnext(sscan)))
-				{
-					Form_pg_class relForm = (Form_pg_class) GETSTRUCT(tup);
-					TupleDesc	tupdesc;
-					int			j;
-					bool		compatible = true;
+static pgstrom_data_store *
+arrowFdwLoadParquetRowGroup(RecordBatchState *rb_state,
+							kern_data_store *kds_head,
+							Bitmapset *referenced,
+							GpuContext *gcontext,
+							MemoryContext mcontext)
+{
+	parquetDecodeContext con;
+	pgstrom_data_store *pds = NULL;
+	kern_data_store *kds;
+	size_t		head_sz = KERN_DATA_STORE_HEAD_LENGTH(kds_head);
+	size_t		length;
+	size_t		m_offset;
+	int			j;
+	CUresult	rc;
 
-					if (pg_namespace_aclcheck(relForm->relnamespace,
-											  GetUserId(),
-											  ACL_USAGE) != ACLCHECK_OK)
-						continue;
+	/* estimate the length of KDS */
+	length = MAXALIGN(head_sz);
+	for (j=0; j < kds_head->ncols; j++)
+	{
+		RecordBatchFieldState *fstate = &rb_state->columns[j];
+		int		attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
 
-					if (pg_type_aclcheck(relForm->reltype,
-										 GetUserId(),
-										 ACL_USAGE) != ACLCHECK_OK)
-						continue;
+		if (!referenced || !bms_is_member(attidx, referenced))
+			continue;
+		if (fstate->null_count > 0)
+			length += MAXALIGN(BITMAPLEN(fstate->nitems));
+		length += MAXALIGN(fstate->values_rawlen);
+	}
 
-					tupdesc = lookup_rowtype_tupdesc(relForm->reltype, -1);
-					Assert(tupdesc->natts == field->_num_children);
-					for (j=0; compatible && j < tupdesc->natts; j++)
-					{
-						Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
-						ArrowField  *child = &field->children[j];
-						Oid			typoid;
-						int			typmod;
+	if (gcontext)
+	{
+		rc = gpuMemAllocManaged(gcontext,
+								(CUdeviceptr *)&pds,
+								offsetof(pgstrom_data_store,
+										 kds) + length,
+								CU_MEM_ATTACH_GLOBAL);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	}
+	else
+	{
+		pds = MemoryContextAllocHuge(mcontext,
+									 offsetof(pgstrom_data_store,
+											  kds) + length);
+	}
+	memset(pds, 0, offsetof(pgstrom_data_store, kds));
+	pds->gcontext = gcontext;
+	pg_atomic_init_u32(&pds->refcnt, 1);
+	pds->nblocks_uncached = 0;
+	pds->filedesc = -1;
+	pds->iovec = NULL;
+	memcpy(&pds->kds, kds_head, head_sz);
+	pds->kds.length = length;
+	kds = &pds->kds;
+	/* nullmap and values are set up by bit-or, or with gaps of NULLs */
+	memset((char *)kds + head_sz, 0, length - head_sz);
+
+	memset(&con, 0, sizeof(parquetDecodeContext));
+	con.fdesc = FileGetRawDesc(rb_state->fdesc);
+	con.rb_offset = rb_state->rb_offset;
+	m_offset = MAXALIGN(head_sz);
+	for (j=0; j < kds->ncols; j++)
+	{
+		RecordBatchFieldState *fstate = &rb_state->columns[j];
+		kern_colmeta *cmeta = &kds->colmeta[j];
+		int			attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
+		char	   *nullmap = NULL;
+		char	   *values;
+		int64		null_count;
 
-						typoid = arrowTypeToPGTypeOid(child, &typmod);
-						if (typoid != attr->atttypid)
-							compatible = false;
-					}
-					ReleaseTupleDesc(tupdesc);
+		if (!referenced || !bms_is_member(attidx, referenced))
+			continue;
+		if (fstate->null_count > 0)
+		{
+			nullmap = (char *)kds + m_offset;
+			cmeta->nullmap_offset = __kds_packed(m_offset);
+			cmeta->nullmap_length = __kds_packed(MAXALIGN(BITMAPLEN(fstate->nitems)));
+			m_offset += MAXALIGN(BITMAPLEN(fstate->nitems));
+		}
+		values = (char *)kds + m_offset;
+		cmeta->values_offset = __kds_packed(m_offset);
+		cmeta->values_length = __kds_packed(MAXALIGN(fstate->values_rawlen));
+		m_offset += MAXALIGN(fstate->values_rawlen);
+
+		null_count = __parquetDecodeColumnChunk(&con, fstate,
+												nullmap, values);
+		if (null_count != fstate->null_count)
+			elog(ERROR, "arrow_fdw: Parquet column chunk has %ld NULLs, but %ld expected",
+				 null_count, fstate->null_count);
+	}
+	Assert(m_offset == length);
+	__parquetReleaseDecodeContext(&con);
 
-					if (compatible)
-						type_oid = relForm->reltype;
-				}
-				systable_endscan(sscan);
-				table_close(rel, AccessShareLock);
+	return pds;
+}
 
-				if (!OidIsValid(type_oid))
-					elog(ERROR, "arrow::%s is not supported",
-						 arrowTypeName(field));
-				return type_oid;
-			}
-			break;
-		case ArrowNodeTag__FixedSizeBinary:
-			if (t->FixedSizeBinary.byteWidth < 1 ||
-				t->FixedSizeBinary.byteWidth > BLCKSZ)
-				elog(ERROR, "arrow_fdw: %s with byteWidth=%d is not supported",
-					 t->node.tagName,
-					 t->FixedSizeBinary.byteWidth);
-			*typmod = t->FixedSizeBinary.byteWidth;
-			return BPCHAROID;
-		default:
-			elog(ERROR, "arrow_fdw: type '%s' is not supported",
-				 field->type.node.tagName);
+/*
+ * arrowFdwMmapRecordBatch
+ *
+ * CPU-only scan can reference the arrow file on the page cache directly,
+ * without copy of the buffers. It reserves a virtual address region for
+ * the PDS/KDS header, then maps the arrow file next to the header, so the
+ * colmeta of KDS can point the mapped buffers by the offset from the head.
+ */
+typedef struct
+{
+	off_t		rb_offset;
+	off_t		f_head;		/* head of the file range mapped */
+	off_t		f_tail;		/* tail of the file range referenced */
+	size_t		m_base;		/* offset of the file mapping from KDS */
+} arrowFdwMmapContext;
+
+static void
+__arrowFdwMmapBuffer(arrowFdwMmapContext *con,
+					 off_t chunk_offset,
+					 size_t chunk_length,
+					 cl_uint *p_cmeta_offset,
+					 cl_uint *p_cmeta_length)
+{
+	off_t		f_pos = con->rb_offset + chunk_offset;
+
+	if (!p_cmeta_offset)
+	{
+		/* 1st pass: range of the file to be mapped */
+		con->f_head = Min(con->f_head, f_pos);
+		con->f_tail = Max(con->f_tail, f_pos + chunk_length);
+	}
+	else
+	{
+		*p_cmeta_offset = __kds_packed(con->m_base + f_pos - con->f_head);
+		*p_cmeta_length = __kds_packed(MAXALIGN(chunk_length));
 	}
-	return InvalidOid;
 }
 
-static const char *
-arrowTypeToPGTypeName(ArrowField *field)
+static void
+arrowFdwMmapField(arrowFdwMmapContext *con,
+				  RecordBatchFieldState *fstate,
+				  kern_data_store *kds,
+				  kern_colmeta *cmeta,
+				  Bitmapset *subfields,
+				  bool setup_cmeta)
 {
-	Oid			typoid;
-	int			typmod;
-	HeapTuple	tup;
-	Form_pg_type type;
-	char	   *schema;
-	char	   *result;
+	if (fstate->nullmap_length > 0)
+		__arrowFdwMmapBuffer(con,
+							 fstate->nullmap_offset,
+							 fstate->nullmap_length,
+							 setup_cmeta ? &cmeta->nullmap_offset : NULL,
+							 setup_cmeta ? &cmeta->nullmap_length : NULL);
+	if (fstate->values_length > 0)
+		__arrowFdwMmapBuffer(con,
+							 fstate->values_offset,
+							 fstate->values_length,
+							 setup_cmeta ? &cmeta->values_offset : NULL,
+							 setup_cmeta ? &cmeta->values_length : NULL);
+	if (fstate->dict_length > 0)
+		__arrowFdwMmapBuffer(con,
+							 fstate->dict_offset,
+							 fstate->dict_length,
+							 setup_cmeta ? &cmeta->dict_offset : NULL,
+							 setup_cmeta ? &cmeta->dict_length : NULL);
+	if (fstate->extra_length > 0)
+		__arrowFdwMmapBuffer(con,
+							 fstate->extra_offset,
+							 fstate->extra_length,
+							 setup_cmeta ? &cmeta->extra_offset : NULL,
+							 setup_cmeta ? &cmeta->extra_length : NULL);
 
-	typoid = arrowTypeToPGTypeOid(field, &typmod);
-	if (!OidIsValid(typoid))
-		return NULL;
-	tup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(typoid));
-	if (!HeapTupleIsValid(tup))
-		elog(ERROR, "cache lookup failed for type %u", typoid);
-	type = (Form_pg_type) GETSTRUCT(tup);
-	schema = get_namespace_name(type->typnamespace);
-	if (typmod < 0)
-		result = psprintf("%s.%s",
-						  quote_identifier(schema),
-						  quote_identifier(NameStr(type->typname)));
-	else
-		result = psprintf("%s.%s(%d)",
-						  quote_identifier(schema),
-						  quote_identifier(NameStr(type->typname)),
-						  typmod);
-	ReleaseSysCache(tup);
+	/* nested sub-fields if composite types */
+	if (cmeta->atttypkind == TYPE_KIND__ARRAY ||
+		cmeta->atttypkind == TYPE_KIND__COMPOSITE)
+	{
+		kern_colmeta *subattr;
+		int		j;
 
-	return result;
+		Assert(fstate->num_children == cmeta->num_subattrs);
+		for (j=0, subattr = &kds->colmeta[cmeta->idx_subattrs];
+			 j < cmeta->num_subattrs;
+			 j++, subattr++)
+		{
+			if (subfields && !bms_is_member(j, subfields))
+				continue;
+			arrowFdwMmapField(con, &fstate->children[j],
+							  kds, subattr, NULL, setup_cmeta);
+		}
+	}
 }
 
-/*
- * arrowTypeIsConvertible
- */
-static bool
-arrowTypeIsConvertible(Oid type_oid, int typemod)
+static pgstrom_data_store *
+arrowFdwMmapRecordBatch(RecordBatchState *rb_state,
+						kern_data_store *kds_head,
+						Bitmapset *referenced,
+						Bitmapset **ref_subfields)
 {
-	HeapTuple		tup;
-	Form_pg_type	typeForm;
-	bool			retval = false;
-
-	switch (type_oid)
+	arrowFdwMmapContext con;
+	pgstrom_data_store *pds = NULL;
+	size_t		head_sz = KERN_DATA_STORE_HEAD_LENGTH(kds_head);
+	size_t		mmap_sz;
+	void	   *addr;
+	int			pass, j;
+
+	memset(&con, 0, sizeof(arrowFdwMmapContext));
+	con.rb_offset = rb_state->rb_offset;
+	con.f_head    = LONG_MAX;
+	con.f_tail    = 0;
+	con.m_base    = TYPEALIGN(PAGE_SIZE, offsetof(pgstrom_data_store,
+												  kds) + head_sz)
+		- offsetof(pgstrom_data_store, kds);
+
+	for (pass=0; pass < 2; pass++)
 	{
-		case INT2OID:		/* Int16 */
-		case INT4OID:		/* Int32 */
-		case INT8OID:		/* Int64 */
-		case FLOAT2OID:		/* FP16 */
-		case FLOAT4OID:		/* FP32 */
-		case FLOAT8OID:		/* FP64 */
-		case TEXTOID:		/* Utf8 */
-		case BYTEAOID:		/* Binary */
-		case BOOLOID:		/* Bool */
-		case NUMERICOID:	/* Decimal */
-		case DATEOID:		/* Date */
-		case TIMEOID:		/* Time */
-		case TIMESTAMPOID:	/* Timestamp */
-		case TIMESTAMPTZOID:/* TimestampTz */
-		case INTERVALOID:	/* Interval */
-		case BPCHAROID:		/* FixedSizeBinary */
-			return true;
-		default:
-			tup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(type_oid));
-			if (!HeapTupleIsValid(tup))
-				elog(ERROR, "cache lookup failed for type %u", type_oid);
-			typeForm = (Form_pg_type) GETSTRUCT(tup);
+		kern_data_store *kds = (pass == 0 ? kds_head : &pds->kds);
 
-			if (typeForm->typlen == -1 && OidIsValid(typeForm->typelem))
-			{
-				retval = arrowTypeIsConvertible(typeForm->typelem, typemod);
-			}
-			else if (typeForm->typtype == TYPTYPE_COMPOSITE)
-			{
-				Relation	rel;
-				TupleDesc	tupdesc;
-				int			j;
+		for (j=0; j < kds->ncols; j++)
+		{
+			int		attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
 
-				rel = relation_open(typeForm->typrelid, AccessShareLock);
-				tupdesc = RelationGetDescr(rel);
-				for (j=0; j < tupdesc->natts; j++)
-				{
-					Form_pg_attribute	attr = tupleDescAttr(tupdesc, j);
+			if (referenced && bms_is_member(attidx, referenced))
+				arrowFdwMmapField(&con, &rb_state->columns[j],
+								  kds, &kds->colmeta[j],
+								  ref_subfields ? ref_subfields[j] : NULL,
+								  pass > 0);
+		}
+		if (pass > 0)
+			break;
 
-					if (!arrowTypeIsConvertible(attr->atttypid,
-												attr->atttypmod))
-						break;
-				}
-				if (j >= tupdesc->natts)
-					retval = true;
-				relation_close(rel, AccessShareLock);
-			}
-			ReleaseSysCache(tup);
+		/* nothing to map? */
+		if (con.f_head >= con.f_tail)
+			return NULL;
+		con.f_head = TYPEALIGN_DOWN(PAGE_SIZE, con.f_head);
+		mmap_sz = TYPEALIGN(PAGE_SIZE, con.f_tail - con.f_head);
+		/* offset of KDS must be represented by __kds_packed() */
+		if (con.m_base + mmap_sz >= ((size_t)UINT_MAX << MAXIMUM_ALIGNOF_SHIFT))
+			return NULL;
+
+		/* reserve the virtual address region, then map the file */
+		pds = __mmapFile(NULL, offsetof(pgstrom_data_store,
+										kds) + con.m_base + mmap_sz,
+						 PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (pds == MAP_FAILED)
+			return NULL;
+		addr = (char *)&pds->kds + con.m_base;
+		Assert((uintptr_t)addr == TYPEALIGN(PAGE_SIZE, (uintptr_t)addr));
+		if (mmap(addr, mmap_sz,
+				 PROT_READ, MAP_SHARED | MAP_FIXED,
+				 FileGetRawDesc(rb_state->fdesc), con.f_head) == MAP_FAILED)
+		{
+			elog(DEBUG1, "arrow_fdw: failed on mmap('%s'): %m",
+				 FilePathName(rb_state->fdesc));
+			__munmapFile(pds);
+			return NULL;
+		}
+		memset(pds, 0, offsetof(pgstrom_data_store, kds));
+		pg_atomic_init_u32(&pds->refcnt, 1);
+		pds->filedesc = -1;
+		pds->mmap_length = (offsetof(pgstrom_data_store, kds) +
+							con.m_base + mmap_sz);
+		memcpy(&pds->kds, kds_head, head_sz);
+		pds->kds.length = con.m_base + mmap_sz;
 	}
-	return retval;
+	return pds;
 }
 
 /*
- * arrowFieldLength
+ * arrowFdwLoadRecordBatch
  */
-static size_t
-arrowFieldLength(ArrowField *field, int64 nitems)
+static pgstrom_data_store *
+__arrowFdwLoadRecordBatch(RecordBatchState *rb_state,
+						  Relation relation,
+						  Bitmapset *referenced,
+						  Bitmapset **ref_subfields,
+						  GpuContext *gcontext,
+						  MemoryContext mcontext,
+						  int optimal_gpu)
 {
-	ArrowType  *type = &field->type;
-	size_t		length = 0;
+	TupleDesc			tupdesc = RelationGetDescr(relation);
+	pgstrom_data_store *pds;
+	kern_data_store	   *kds;
+	strom_io_vector	   *iovec;
+	size_t				head_sz;
+	int					j, fdesc;
+	CUresult			rc;
 
-	switch (type->node.tag)
+	/* setup KDS and I/O-vector */
+	head_sz = KDS_calculateHeadSize(tupdesc);
+	kds = alloca(head_sz);
+	init_kernel_data_store(kds, tupdesc, 0, KDS_FORMAT_ARROW, 0);
+	kds->nitems = rb_state->rb_nitems;
+	kds->nrooms = rb_state->rb_nitems;
+	kds->table_oid = RelationGetRelid(relation);
+	Assert(head_sz == KERN_DATA_STORE_HEAD_LENGTH(kds));
+	for (j=0; j < kds->nr_colmeta; j++)
+		kds->colmeta[j].attopts = rb_state->columns[j].attopts;
+	/* Parquet row group shall be decoded on the host side */
+	if (rb_state->rb_compression == ARROW_PARQUET_ROWGROUP)
+		return arrowFdwLoadParquetRowGroup(rb_state, kds, referenced,
+										   gcontext, mcontext);
+	/* compressed RecordBatch shall be decompressed on the host side */
+	if (rb_state->rb_compression >= 0)
+		return arrowFdwLoadCompressedRecordBatch(rb_state, kds, referenced,
+												 ref_subfields,
+												 gcontext, mcontext);
+	/* CPU-only scan may reference the arrow file on the page cache */
+	if (!gcontext && arrow_mmap_scan_enabled)
 	{
-		case ArrowNodeTag__Int:
-			switch (type->Int.bitWidth)
-			{
-				case sizeof(cl_short) * BITS_PER_BYTE:
-					length = sizeof(cl_short) * nitems;
-					break;
-				case sizeof(cl_int) * BITS_PER_BYTE:
-					length = sizeof(cl_int) * nitems;
-					break;
-				case sizeof(cl_long) * BITS_PER_BYTE:
-					length = sizeof(cl_long) * nitems;
-					break;
-				default:
-					elog(ERROR, "Not a supported Int width: %d",
-						 type->Int.bitWidth);
-			}
-			break;
-		case ArrowNodeTag__FloatingPoint:
-			switch (type->FloatingPoint.precision)
-			{
-				case ArrowPrecision__Half:
-					length = sizeof(cl_short) * nitems;
-					break;
-				case ArrowPrecision__Single:
-					length = sizeof(cl_float) * nitems;
-					break;
-				case ArrowPrecision__Double:
-					length = sizeof(cl_double) * nitems;
-					break;
-				default:
-					elog(ERROR, "Not a supported FloatingPoint precision");
-			}
-			break;
-		case ArrowNodeTag__Utf8:
-		case ArrowNodeTag__Binary:
-		case ArrowNodeTag__List:
-			length = sizeof(cl_uint) * (nitems + 1);
-			break;
-		case ArrowNodeTag__Bool:
-			length = BITMAPLEN(nitems);
-			break;
-		case ArrowNodeTag__Decimal:
-			length = sizeof(int128) * nitems;
-			break;
-		case ArrowNodeTag__Date:
-			switch (type->Date.unit)
-			{
-				case ArrowDateUnit__Day:
-					length = sizeof(cl_int) * nitems;
-					break;
-				case ArrowDateUnit__MilliSecond:
-					length = sizeof(cl_long) * nitems;
-					break;
-				default:
-					elog(ERROR, "Not a supported Date unit");
-			}
-			break;
-		case ArrowNodeTag__Time:
-			switch (type->Time.unit)
-			{
-				case ArrowTimeUnit__Second:
-				case ArrowTimeUnit__MilliSecond:
-					length = sizeof(cl_int) * nitems;
-					break;
-				case ArrowTimeUnit__MicroSecond:
-				case ArrowTimeUnit__NanoSecond:
-					length = sizeof(cl_long) * nitems;
-					break;
-				default:
-					elog(ERROR, "Not a supported Time unit");
-			}
-			break;
-		case ArrowNodeTag__Timestamp:
-			length = sizeof(cl_long) * nitems;
-			break;
-		case ArrowNodeTag__Interval:
-			switch (type->Interval.unit)
-			{
-				case ArrowIntervalUnit__Year_Month:
-					length = sizeof(cl_uint) * nitems;
-					break;
-				case ArrowIntervalUnit__Day_Time:
-					length = sizeof(cl_long) * nitems;
-					break;
-				default:
-					elog(ERROR, "Not a supported Interval unit");
-			}
-			break;
-		case ArrowNodeTag__Struct:	//to be supported later
-			length = 0;		/* only nullmap */
-			break;
-		case ArrowNodeTag__FixedSizeBinary:
-			length = (size_t)type->FixedSizeBinary.byteWidth * nitems;
-			break;
-		default:
-			elog(ERROR, "Arrow Type '%s' is not supported now",
-				 type->node.tagName);
-			break;
+		pds = arrowFdwMmapRecordBatch(rb_state, kds, referenced,
+									  ref_subfields);
+		if (pds)
+			return pds;
 	}
-	return length;
+	iovec = arrowFdwSetupIOvector(kds, rb_state, referenced, ref_subfields);
+	__dump_kds_and_iovec(kds, iovec);
+
+	fdesc = FileGetRawDesc(rb_state->fdesc);
+	/*
+	 * If SSD-to-GPU Direct SQL is available on the arrow file, setup a small
+	 * PDS on host-pinned memory, with strom_io_vector.
+	 */
+	if (gcontext &&
+		gcontext->cuda_dindex == optimal_gpu &&
+		iovec->nr_chunks > 0 &&
+		kds->length <= gpuMemAllocIOMapMaxLength())
+	{
+		size_t	iovec_sz = offsetof(strom_io_vector, ioc[iovec->nr_chunks]);
+
+		rc = gpuMemAllocHost(gcontext, (void **)&pds,
+							 offsetof(pgstrom_data_store, kds) +
+							 head_sz + iovec_sz);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuMemAllocHost: %s", errorText(rc));
+
+		pds->gcontext = gcontext;
+		pg_atomic_init_u32(&pds->refcnt, 1);
+		pds->nblocks_uncached = 0;
+		pds->filedesc = fdesc;
+		pds->iovec = (strom_io_vector *)((char *)&pds->kds + head_sz);
+		pds->gpubuf_iov = NULL;
+		pds->recycle_sz = 0;
+		memcpy(&pds->kds, kds, head_sz);
+		memcpy(pds->iovec, iovec, iovec_sz);
+	}
+	else
+	{
+		/* Elsewhere, load RecordBatch by filesystem */
+		if (gcontext)
+		{
+			rc = gpuMemAllocManaged(gcontext,
+									(CUdeviceptr *)&pds,
+									offsetof(pgstrom_data_store,
+											 kds) + kds->length,
+									CU_MEM_ATTACH_GLOBAL);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+		}
+		else
+		{
+			pds = MemoryContextAllocHuge(mcontext,
+										 offsetof(pgstrom_data_store,
+												  kds) + kds->length);
+		}
+		__PDS_fillup_arrow(pds, gcontext, kds, fdesc, iovec);
+	}
+	pfree(iovec);
+	return pds;
 }
 
 /*
- * arrowSchemaCompatibilityCheck
+ * arrowFdwPrefetchRecordBatch
+ *
+ * It advises the kernel to read-ahead the referenced buffers of the next
+ * arrow_fdw.prefetch_depth RecordBatches, so the storage I/O runs in the
+ * background while the current RecordBatch is processed.
  */
-static bool
-__arrowSchemaCompatibilityCheck(TupleDesc tupdesc,
-								RecordBatchFieldState *rb_fstate)
+static void
+__arrowFdwPrefetchField(int fdesc, off_t rb_offset,
+						RecordBatchFieldState *fstate,
+						Bitmapset *subfields)
 {
 	int		j;
 
-	for (j=0; j < tupdesc->natts; j++)
+	if (fstate->nullmap_length > 0)
+		(void) posix_fadvise(fdesc, rb_offset + fstate->nullmap_offset,
+							 fstate->nullmap_length, POSIX_FADV_WILLNEED);
+	if (fstate->values_length > 0)
+		(void) posix_fadvise(fdesc, rb_offset + fstate->values_offset,
+							 fstate->values_length, POSIX_FADV_WILLNEED);
+	if (fstate->dict_length > 0)
+		(void) posix_fadvise(fdesc, rb_offset + fstate->dict_offset,
+							 fstate->dict_length, POSIX_FADV_WILLNEED);
+	if (fstate->extra_length > 0)
+		(void) posix_fadvise(fdesc, rb_offset + fstate->extra_offset,
+							 fstate->extra_length, POSIX_FADV_WILLNEED);
+	for (j=0; j < fstate->num_children; j++)
 	{
-		RecordBatchFieldState *fstate = &rb_fstate[j];
-		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
+		if (subfields && !bms_is_member(j, subfields))
+			continue;
+		__arrowFdwPrefetchField(fdesc, rb_offset,
+								&fstate->children[j], NULL);
+	}
+}
 
-		if (!fstate->children)
-		{
-			/* shortcur, it should be a scalar built-in type */
-			Assert(fstate->num_children == 0);
-			if (attr->atttypid != fstate->atttypid)
-				return false;
+static void
+arrowFdwPrefetchRecordBatch(ArrowFdwState *af_state, uint32 rb_index)
+{
+	uint32		rb_tail = Min(rb_index + 1 + arrow_prefetch_depth,
+							  af_state->num_rbatches);
+
+	if (af_state->prefetch_index <= rb_index)
+		af_state->prefetch_index = rb_index + 1;
+	while (af_state->prefetch_index < rb_tail)
+	{
+		RecordBatchState *rb_state
+			= af_state->rbatches[af_state->prefetch_index++];
+		int			j, fdesc;
+
+		/* no need to prefetch RecordBatch to be skipped */
+		if (af_state->stats_hint &&
+			!execCheckArrowStatsHint(af_state->stats_hint, rb_state))
+			continue;
+
+		fdesc = FileGetRawDesc(rb_state->fdesc);
+		for (j=0; j < rb_state->ncols; j++)
+		{
+			int		attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
+
+			if (bms_is_member(attidx, af_state->referenced))
+				__arrowFdwPrefetchField(fdesc, rb_state->rb_offset,
+										&rb_state->columns[j],
+										af_state->ref_subfields
+										? af_state->ref_subfields[j]
+										: NULL);
 		}
-		else
+	}
+}
+
+/*
+ * arrowFdwLoadRecordBatchGpuBuffer
+ *
+ * It sets up a small PDS on the host-pinned memory, if all the referenced
+ * columns of the RecordBatch are already resident on a GPU buffer; built
+ * by pgstrom.arrow_fdw_export_columns() and so on. Worker copies the values
+ * device-to-device, instead of reading the arrow file again.
+ * The I/O vector is also kept, to read the file on device memory shortage.
+ */
+static pgstrom_data_store *
+arrowFdwLoadRecordBatchGpuBuffer(ArrowFdwState *af_state,
+								 RecordBatchState *rb_state,
+								 uint32 rb_index,
+								 Relation relation,
+								 GpuContext *gcontext)
+{
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	arrowGpuBufferRef *gbref = NULL;
+	ArrowGpuBuffer *gpubuf;
+	pgstrom_data_store *pds;
+	kern_data_store *kds;
+	strom_io_vector *iovec;
+	gpubuf_io_vector *gbiov;
+	size_t		head_sz;
+	size_t		iovec_sz;
+	size_t		gbiov_sz;
+	size_t		host_sz = 0;
+	uint64		row_index;
+	char	   *pos;
+	ListCell   *lc;
+	int			j, k, fdesc;
+	int			nr_chunks = 0;
+	CUresult	rc;
+
+	if (rb_state->rb_compression >= 0)
+		return NULL;
+	foreach (lc, af_state->gpubuf_refs)
+	{
+		arrowGpuBufferRef *temp = lfirst(lc);
+
+		if (rb_index >= temp->rb_begin &&
+			rb_index - temp->rb_begin < temp->rb_count)
 		{
-			Form_pg_type	typ;
-			HeapTuple		tup;
-			bool			type_is_ok = true;
+			gbref = temp;
+			break;
+		}
+	}
+	if (!gbref)
+		return NULL;
+	gpubuf = gbref->gpubuf;
+	row_index = (af_state->rbatch_row_offset[rb_index] -
+				 af_state->rbatch_row_offset[gbref->rb_begin]);
 
-			tup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(attr->atttypid));
-			if (!HeapTupleIsValid(tup))
-				elog(ERROR, "cache lookup failed for type %u", attr->atttypid);
-			typ = (Form_pg_type) GETSTRUCT(tup);
-			if (typ->typlen == -1 && OidIsValid(typ->typelem) &&
-				fstate->num_children == 1)
-			{
-				/* Arrow::List */
-				RecordBatchFieldState *cstate = &fstate->children[0];
+	/* only fixed-length columns are kept on the GPU buffer */
+	for (j=0; j < rb_state->ncols; j++)
+	{
+		RecordBatchFieldState *fstate = &rb_state->columns[j];
+		int		attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
 
-				if (attr->atttypid != cstate->atttypid)
-					type_is_ok = false;
+		if (!bms_is_member(attidx, af_state->referenced))
+			continue;
+		if (fstate->dict_length > 0 ||
+			fstate->extra_length > 0 ||
+			fstate->num_children > 0)
+			return NULL;
+		host_sz += MAXALIGN(fstate->nullmap_length);
+	}
+
+	/* setup KDS and I/O-vector, as if SSD-to-GPU Direct SQL */
+	head_sz = KDS_calculateHeadSize(tupdesc);
+	kds = alloca(head_sz);
+	init_kernel_data_store(kds, tupdesc, 0, KDS_FORMAT_ARROW, 0);
+	kds->nitems = rb_state->rb_nitems;
+	kds->nrooms = rb_state->rb_nitems;
+	kds->table_oid = RelationGetRelid(relation);
+	Assert(head_sz == KERN_DATA_STORE_HEAD_LENGTH(kds));
+	for (j=0; j < kds->nr_colmeta; j++)
+		kds->colmeta[j].attopts = rb_state->columns[j].attopts;
+	iovec = arrowFdwSetupIOvector(kds, rb_state,
+								  af_state->referenced,
+								  af_state->ref_subfields);
+	if (iovec->nr_chunks == 0)
+	{
+		pfree(iovec);
+		return NULL;
+	}
+	iovec_sz = offsetof(strom_io_vector, ioc[iovec->nr_chunks]);
+	gbiov_sz = MAXALIGN(offsetof(gpubuf_io_vector, ioc[2 * kds->ncols]));
+
+	rc = gpuMemAllocHost(gcontext, (void **)&pds,
+						 offsetof(pgstrom_data_store, kds) +
+						 head_sz + iovec_sz + gbiov_sz + host_sz);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocHost: %s", errorText(rc));
+
+	fdesc = FileGetRawDesc(rb_state->fdesc);
+	memset(pds, 0, offsetof(pgstrom_data_store, kds));
+	pds->gcontext = gcontext;
+	pg_atomic_init_u32(&pds->refcnt, 1);
+	pds->nblocks_uncached = 0;
+	pds->filedesc = fdesc;
+	memcpy(&pds->kds, kds, head_sz);
+	pos = (char *)&pds->kds + head_sz;
+	pds->iovec = (strom_io_vector *)pos;
+	memcpy(pds->iovec, iovec, iovec_sz);
+	pos += iovec_sz;
+	gbiov = (gpubuf_io_vector *)pos;
+	gbiov->m_gbuf = gbref->m_gbuf;
+	pos += gbiov_sz;
+
+	for (j=0; j < kds->ncols; j++)
+	{
+		RecordBatchFieldState *fstate = &rb_state->columns[j];
+		kern_colmeta   *cmeta = &pds->kds.colmeta[j];
+		int				attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
+		gpubuf_io_chunk *ioc;
+		size_t			length;
+
+		if (!bms_is_member(attidx, af_state->referenced))
+			continue;
+		for (k=0; k < gpubuf->nattrs; k++)
+		{
+			if (gpubuf->attnums[k] == j + 1)
+				break;
+		}
+		Assert(k < gpubuf->nattrs);
+
+		/* nullmap is small enough, so read it from the file */
+		if (fstate->nullmap_length > 0)
+		{
+			__arrowFdwPreadBuffer(fdesc, pos, fstate->nullmap_length,
+								  rb_state->rb_offset +
+								  fstate->nullmap_offset);
+			ioc = &gbiov->ioc[nr_chunks++];
+			ioc->m_offset  = __kds_unpack(cmeta->nullmap_offset);
+			ioc->s_offset  = pos - (char *)&pds->kds;
+			ioc->length    = fstate->nullmap_length;
+			ioc->from_host = true;
+			pos += MAXALIGN(fstate->nullmap_length);
+		}
+		/* values are copied from the GPU buffer */
+		length = cmeta->attlen * Min(rb_state->rb_nitems, fstate->nitems);
+		if (length > fstate->values_length)
+			length = fstate->values_length;
+		if (length > 0)
+		{
+			ioc = &gbiov->ioc[nr_chunks++];
+			ioc->m_offset  = __kds_unpack(cmeta->values_offset);
+			ioc->s_offset  = (gbref->values_offset[k] +
+							  cmeta->attlen * row_index);
+			ioc->length    = length;
+			ioc->from_host = false;
+		}
+	}
+	gbiov->nr_chunks = nr_chunks;
+	pds->gpubuf_iov = gbiov;
+	pfree(iovec);
+
+	af_state->gpubuf_nloaded++;
+
+	return pds;
+}
+
+static pgstrom_data_store *
+arrowFdwLoadRecordBatch(ArrowFdwState *af_state,
+						Relation relation,
+						EState *estate,
+						GpuContext *gcontext,
+						int optimal_gpu)
+{
+	RecordBatchState *rb_state;
+	pgstrom_data_store *pds;
+	uint32		rb_index;
+
+retry:
+	/* fetch next RecordBatch */
+	rb_index = pg_atomic_fetch_add_u32(af_state->rbatch_index, 1);
+	if (rb_index >= af_state->num_rbatches)
+		return NULL;	/* no more RecordBatch to read */
+	rb_state = af_state->rbatches[rb_index];
+
+	/* skip RecordBatch, if the caller already has the results */
+	if (bms_is_member(rb_index, af_state->rb_skipped))
+		goto retry;
+
+	/* skip RecordBatch, if min/max statistics tells nothing to match */
+	if (af_state->stats_hint &&
+		!execCheckArrowStatsHint(af_state->stats_hint, rb_state))
+	{
+		af_state->stats_hint->nskipped++;
+		goto retry;
+	}
+
+	/* referenced columns may be already resident on the GPU buffer */
+	if (gcontext)
+	{
+		if (!af_state->gpubuf_checked)
+			arrowFdwLookupGpuBuffers(af_state, relation, gcontext);
+		if (af_state->gpubuf_refs != NIL)
+		{
+			pds = arrowFdwLoadRecordBatchGpuBuffer(af_state,
+												   rb_state,
+												   rb_index,
+												   relation,
+												   gcontext);
+			if (pds)
+				return pds;
+		}
+	}
+
+	/*
+	 * Kick read-ahead of the next RecordBatches, unless SSD-to-GPU Direct
+	 * SQL may bypass the page cache.
+	 */
+	if (arrow_prefetch_depth > 0 &&
+		(!gcontext || gcontext->cuda_dindex != optimal_gpu))
+		arrowFdwPrefetchRecordBatch(af_state, rb_index);
+
+	pgstromNvtxRangePush("arrowFdwLoadRecordBatch (rb_index=%u)", rb_index);
+	pds = __arrowFdwLoadRecordBatch(rb_state,
+									relation,
+									af_state->referenced,
+									af_state->ref_subfields,
+									gcontext,
+									estate->es_query_cxt,
+									optimal_gpu);
+	pgstromNvtxRangePop();
+
+	return pds;
+}
+
+/*
+ * ExecScanChunkArrowFdw
+ */
+pgstrom_data_store *
+ExecScanChunkArrowFdw(GpuTaskState *gts)
+{
+	pgstrom_data_store *pds;
+
+	InstrStartNode(&gts->outer_instrument);
+	pds = arrowFdwLoadRecordBatch(gts->af_state,
+								  gts->css.ss.ss_currentRelation,
+								  gts->css.ss.ps.state,
+								  gts->gcontext,
+								  gts->optimal_gpu);
+	InstrStopNode(&gts->outer_instrument,
+				  !pds ? 0.0 : (double)pds->kds.nitems);
+	return pds;
+}
+
+/*
+ * execArrowScanPreFilter
+ *
+ * CPU scan evaluates the qualifiers on the stats-hint (Var OP Const on
+ * integer or floating-point columns) column-by-column on the values and
+ * nullmap buffers of KDS, prior to the tuple materialization.
+ * The loops below are simple enough for compiler's auto-vectorization.
+ * Rows removed here never satisfy the qualifiers; the rest shall be
+ * checked by the executor again, so there is no semantic change.
+ */
+#define __ARROW_PREFILTER_LOOP(TYPE,KTYPE,KEY,OPER)				\
+	do {														\
+		const TYPE *__values = (const TYPE *)values;			\
+		for (i=0; i < nitems; i++)								\
+			filter[i] &= ((KTYPE)__values[i] OPER (KEY));		\
+	} while(0)
+
+/* NaN is larger than any other values in PostgreSQL */
+#define __ARROW_PREFILTER_NAN_LOOP(TYPE,KEY,OPER)				\
+	do {														\
+		const TYPE *__values = (const TYPE *)values;			\
+		for (i=0; i < nitems; i++)								\
+			filter[i] &= (((double)__values[i] OPER (KEY)) |	\
+						  (__values[i] != __values[i]));		\
+	} while(0)
+
+#define __ARROW_PREFILTER_STRATEGY(TYPE,KTYPE,KEY)						\
+	do {																\
+		switch (cond->strategy)											\
+		{																\
+			case BTLessStrategyNumber:									\
+				__ARROW_PREFILTER_LOOP(TYPE,KTYPE,KEY,<);				\
+				break;													\
+			case BTLessEqualStrategyNumber:								\
+				__ARROW_PREFILTER_LOOP(TYPE,KTYPE,KEY,<=);				\
+				break;													\
+			case BTEqualStrategyNumber:									\
+				__ARROW_PREFILTER_LOOP(TYPE,KTYPE,KEY,==);				\
+				break;													\
+			case BTGreaterEqualStrategyNumber:							\
+				__ARROW_PREFILTER_LOOP(TYPE,KTYPE,KEY,>=);				\
+				break;													\
+			case BTGreaterStrategyNumber:								\
+				__ARROW_PREFILTER_LOOP(TYPE,KTYPE,KEY,>);				\
+				break;													\
+			default:													\
+				break;													\
+		}																\
+	} while(0)
+
+static bool
+__execArrowScanPreFilterCond(arrowStatsCond *cond,
+							 ExprContext *econtext,
+							 kern_data_store *kds,
+							 uint8 *filter)
+{
+	kern_colmeta *cmeta = &kds->colmeta[cond->attnum - 1];
+	size_t		nitems = kds->nitems;
+	const char *values;
+	Datum		key;
+	bool		isnull;
+	int64		ival;
+	double		fval;
+	size_t		i;
+
+	if (cond->attnum > kds->ncols ||
+		cmeta->atttypkind != TYPE_KIND__BASE ||
+		cmeta->values_offset == 0)
+		return false;
+	values = (const char *)kds + __kds_unpack(cmeta->values_offset);
+
+	key = ExecEvalExprSwitchContext(cond->arg, econtext, &isnull);
+	if (isnull)
+	{
+		/* NULL never matches, so none of rows can survive */
+		memset(filter, 0, nitems);
+		return true;
+	}
+
+	switch (cmeta->atttypid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			if (cond->argtype == INT2OID)
+				ival = DatumGetInt16(key);
+			else if (cond->argtype == INT4OID)
+				ival = DatumGetInt32(key);
+			else if (cond->argtype == INT8OID)
+				ival = DatumGetInt64(key);
+			else
+				return false;
+			if (cmeta->atttypid == INT2OID)
+				__ARROW_PREFILTER_STRATEGY(int16, int64, ival);
+			else if (cmeta->atttypid == INT4OID)
+				__ARROW_PREFILTER_STRATEGY(int32, int64, ival);
+			else
+				__ARROW_PREFILTER_STRATEGY(int64, int64, ival);
+			break;
+
+		case FLOAT4OID:
+		case FLOAT8OID:
+			if (cond->argtype == FLOAT4OID)
+				fval = DatumGetFloat4(key);
+			else if (cond->argtype == FLOAT8OID)
+				fval = DatumGetFloat8(key);
+			else
+				return false;
+			/*
+			 * PostgreSQL sorts NaN larger than any other values, but C
+			 * operators always return false. Leave NaN to the executor.
+			 */
+			if (isnan(fval))
+				return false;
+			if (cond->strategy == BTGreaterEqualStrategyNumber)
+			{
+				if (cmeta->atttypid == FLOAT4OID)
+					__ARROW_PREFILTER_NAN_LOOP(float4, fval, >=);
 				else
-				{
-					/*
-					 * overwrite typoid / typmod because a same arrow file
-					 * can be reused, and it may be on behalf of different
-					 * user defined data type.
-					 */
-					fstate->atttypid = attr->atttypid;
-					fstate->atttypmod = attr->atttypmod;
-				}
+					__ARROW_PREFILTER_NAN_LOOP(float8, fval, >=);
 			}
-			else if (typ->typlen == -1 && OidIsValid(typ->typrelid))
+			else if (cond->strategy == BTGreaterStrategyNumber)
 			{
-				/* Arrow::Struct */
-				TupleDesc	sdesc = lookup_rowtype_tupdesc(attr->atttypid,
-														   attr->atttypmod);
-				if (sdesc->natts == fstate->num_children &&
-					__arrowSchemaCompatibilityCheck(sdesc, fstate->children))
-				{
-					/* see comment above */
-					fstate->atttypid = attr->atttypid;
-					fstate->atttypmod = attr->atttypmod;
-				}
+				if (cmeta->atttypid == FLOAT4OID)
+					__ARROW_PREFILTER_NAN_LOOP(float4, fval, >);
 				else
-				{
-					type_is_ok = false;
-				}
-				DecrTupleDescRefCount(sdesc);
-
+					__ARROW_PREFILTER_NAN_LOOP(float8, fval, >);
 			}
+			else if (cmeta->atttypid == FLOAT4OID)
+				__ARROW_PREFILTER_STRATEGY(float4, double, fval);
+			else
+				__ARROW_PREFILTER_STRATEGY(float8, double, fval);
+			break;
+
+		default:
+			return false;
+	}
+
+	/* NULL never satisfies the qualifier */
+	if (cmeta->nullmap_offset != 0)
+	{
+		const uint8 *nullmap = (const uint8 *)
+			((char *)kds + __kds_unpack(cmeta->nullmap_offset));
+
+		for (i=0; i < nitems; i++)
+		{
+			if (att_isnull(i, nullmap))
+				filter[i] = 0;
+		}
+	}
+	return true;
+}
+#undef __ARROW_PREFILTER_STRATEGY
+#undef __ARROW_PREFILTER_NAN_LOOP
+#undef __ARROW_PREFILTER_LOOP
+
+static void
+execArrowScanPreFilter(ArrowFdwState *af_state, EState *estate)
+{
+	arrowStatsHint *as_hint = af_state->stats_hint;
+	kern_data_store *kds = &af_state->curr_pds->kds;
+	bool		applied = false;
+	ListCell   *lc;
+
+	if (!as_hint || !arrow_cpu_prefilter_enabled || kds->nitems == 0)
+	{
+		/* arrow_fdw.cpu_prefilter may be turned off during the scan */
+		if (af_state->curr_filter)
+			pfree(af_state->curr_filter);
+		af_state->curr_filter = NULL;
+		af_state->curr_filter_sz = 0;
+		return;
+	}
+	if (!af_state->curr_filter || af_state->curr_filter_sz < kds->nitems)
+	{
+		if (af_state->curr_filter)
+			pfree(af_state->curr_filter);
+		af_state->curr_filter = MemoryContextAllocHuge(estate->es_query_cxt,
+													   kds->nitems);
+		af_state->curr_filter_sz = kds->nitems;
+	}
+	memset(af_state->curr_filter, 1, kds->nitems);
+
+	foreach (lc, as_hint->conds)
+	{
+		arrowStatsCond *cond = lfirst(lc);
+
+		if (__execArrowScanPreFilterCond(cond, as_hint->econtext, kds,
+										 af_state->curr_filter))
+			applied = true;
+	}
+	if (!applied)
+	{
+		pfree(af_state->curr_filter);
+		af_state->curr_filter = NULL;
+		af_state->curr_filter_sz = 0;
+	}
+}
+
+/*
+ * ArrowIterateMetaAggScan
+ *
+ * It returns a row of the aggregation. RecordBatches never match, or fully
+ * covered by the qualifiers are processed by the metadata; the rest of
+ * RecordBatches are loaded and aggregated row-by-row.
+ */
+static bool
+__arrowMetaAggCondIsCovered(arrowStatsHint *as_hint, arrowStatsCond *cond,
+							RecordBatchState *rb_state)
+{
+	RecordBatchFieldState *fstate = &rb_state->columns[cond->attnum-1];
+	Datum		key;
+	bool		isnull;
+
+	/* NULL never satisfies the qualifier */
+	if (!fstate->stat_valid || fstate->null_count > 0)
+		return false;
+	key = ExecEvalExprSwitchContext(cond->arg,
+									as_hint->econtext,
+									&isnull);
+	if (isnull)
+		return false;
+	switch (cond->strategy)
+	{
+		case BTLessStrategyNumber:
+			return (__compareArrowStatsDatum(cond, fstate->stat_max, key) < 0);
+		case BTLessEqualStrategyNumber:
+			return (__compareArrowStatsDatum(cond, fstate->stat_max, key) <= 0);
+		case BTEqualStrategyNumber:
+			return (__compareArrowStatsDatum(cond, fstate->stat_min, key) == 0 &&
+					__compareArrowStatsDatum(cond, fstate->stat_max, key) == 0);
+		case BTGreaterEqualStrategyNumber:
+			return (__compareArrowStatsDatum(cond, fstate->stat_min, key) >= 0);
+		case BTGreaterStrategyNumber:
+			return (__compareArrowStatsDatum(cond, fstate->stat_min, key) > 0);
+		default:
+			break;
+	}
+	return false;
+}
+
+static bool
+__arrowMetaAggBatchIsCovered(ArrowFdwState *af_state,
+							 RecordBatchState *rb_state)
+{
+	arrowMetaAggState *ma_state = af_state->meta_agg;
+	ListCell   *lc;
+	int			i;
+
+	if (!ma_state->quals_in_stats)
+		return false;
+	if (af_state->stats_hint)
+	{
+		foreach (lc, af_state->stats_hint->conds)
+		{
+			if (!__arrowMetaAggCondIsCovered(af_state->stats_hint,
+											 lfirst(lc), rb_state))
+				return false;
+		}
+	}
+	for (i=0; i < ma_state->naggs; i++)
+	{
+		arrowMetaAggItem *item = &ma_state->aggs[i];
+		RecordBatchFieldState *fstate;
+
+		if (item->kind != ARROW_META_AGG__MIN &&
+			item->kind != ARROW_META_AGG__MAX)
+			continue;
+		fstate = &rb_state->columns[item->attnum-1];
+		if (!fstate->stat_valid && fstate->null_count < rb_state->rb_nitems)
+			return false;
+	}
+	return true;
+}
+
+static inline void
+__arrowMetaAggUpdateMinMax(arrowMetaAggItem *item, Datum datum)
+{
+	int		rv;
+
+	if (item->isnull)
+	{
+		item->value = datum;
+		item->isnull = false;
+		return;
+	}
+	rv = DatumGetInt32(FunctionCall2Coll(&item->cmp_func,
+										 InvalidOid,
+										 datum, item->value));
+	if (item->kind == ARROW_META_AGG__MIN ? rv < 0 : rv > 0)
+		item->value = datum;
+}
+
+static void
+__arrowMetaAggUpdateByMetadata(arrowMetaAggState *ma_state,
+							   RecordBatchState *rb_state)
+{
+	int		i;
+
+	for (i=0; i < ma_state->naggs; i++)
+	{
+		arrowMetaAggItem *item = &ma_state->aggs[i];
+		RecordBatchFieldState *fstate;
+
+		if (item->kind == ARROW_META_AGG__COUNT_STAR)
+		{
+			item->count += rb_state->rb_nitems;
+			continue;
+		}
+		fstate = &rb_state->columns[item->attnum-1];
+		if (item->kind == ARROW_META_AGG__COUNT)
+			item->count += rb_state->rb_nitems - fstate->null_count;
+		else if (fstate->null_count < rb_state->rb_nitems)
+		{
+			Assert(fstate->stat_valid);
+			__arrowMetaAggUpdateMinMax(item, (item->kind == ARROW_META_AGG__MIN
+											  ? fstate->stat_min
+											  : fstate->stat_max));
+		}
+	}
+}
+
+static void
+__arrowMetaAggUpdateByScan(ForeignScanState *node,
+						   RecordBatchState *rb_state)
+{
+	ArrowFdwState  *af_state = node->fdw_state;
+	arrowMetaAggState *ma_state = af_state->meta_agg;
+	ExprContext	   *econtext = node->ss.ps.ps_ExprContext;
+	TupleTableSlot *slot = ma_state->base_slot;
+	pgstrom_data_store *pds;
+	size_t			index;
+	int				i;
+
+	pds = __arrowFdwLoadRecordBatch(rb_state,
+									node->ss.ss_currentRelation,
+									af_state->referenced,
+									NULL,
+									NULL,
+									node->ss.ps.state->es_query_cxt,
+									-1);
+	for (index=0; KDS_fetch_tuple_arrow(slot, &pds->kds, index); index++)
+	{
+		ResetExprContext(econtext);
+		econtext->ecxt_scantuple = slot;
+		if (!ExecQual(ma_state->quals, econtext))
+			continue;
+		for (i=0; i < ma_state->naggs; i++)
+		{
+			arrowMetaAggItem *item = &ma_state->aggs[i];
+			int		j = item->attnum - 1;
+
+			if (item->kind == ARROW_META_AGG__COUNT_STAR)
+				item->count++;
+			else if (slot->tts_isnull[j])
+				continue;
+			else if (item->kind == ARROW_META_AGG__COUNT)
+				item->count++;
+			else
+				__arrowMetaAggUpdateMinMax(item, slot->tts_values[j]);
+		}
+	}
+	ExecClearTuple(slot);
+	PDS_release(pds);
+}
+
+static TupleTableSlot *
+ArrowIterateMetaAggScan(ForeignScanState *node)
+{
+	ArrowFdwState  *af_state = node->fdw_state;
+	arrowMetaAggState *ma_state = af_state->meta_agg;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	uint32			rb_index;
+	int				i;
+
+	if (ma_state->done)
+		return NULL;
+	for (i=0; i < ma_state->naggs; i++)
+	{
+		ma_state->aggs[i].count = 0;
+		ma_state->aggs[i].value = 0;
+		ma_state->aggs[i].isnull = true;
+	}
+
+	for (;;)
+	{
+		RecordBatchState *rb_state;
+
+		CHECK_FOR_INTERRUPTS();
+
+		rb_index = pg_atomic_fetch_add_u32(af_state->rbatch_index, 1);
+		if (rb_index >= af_state->num_rbatches)
+			break;
+		rb_state = af_state->rbatches[rb_index];
+
+		/* RecordBatch that never match with the qualifiers */
+		if (af_state->stats_hint &&
+			!execCheckArrowStatsHint(af_state->stats_hint, rb_state))
+		{
+			af_state->stats_hint->nskipped++;
+			continue;
+		}
+
+		if (__arrowMetaAggBatchIsCovered(af_state, rb_state))
+		{
+			__arrowMetaAggUpdateByMetadata(ma_state, rb_state);
+			ma_state->nbatches_meta++;
+		}
+		else
+		{
+			__arrowMetaAggUpdateByScan(node, rb_state);
+			ma_state->nbatches_scan++;
+		}
+	}
+
+	ExecClearTuple(slot);
+	for (i=0; i < ma_state->naggs; i++)
+	{
+		arrowMetaAggItem *item = &ma_state->aggs[i];
+
+		if (item->kind == ARROW_META_AGG__COUNT_STAR ||
+			item->kind == ARROW_META_AGG__COUNT)
+		{
+			slot->tts_values[i] = Int64GetDatum(item->count);
+			slot->tts_isnull[i] = false;
+		}
+		else
+		{
+			slot->tts_values[i] = item->value;
+			slot->tts_isnull[i] = item->isnull;
+		}
+	}
+	ExecStoreVirtualTuple(slot);
+	ma_state->done = true;
+
+	return slot;
+}
+
+/*
+ * ArrowIterateForeignScan
+ */
+static TupleTableSlot *
+ArrowIterateForeignScan(ForeignScanState *node)
+{
+	ArrowFdwState  *af_state = node->fdw_state;
+	Relation		relation = node->ss.ss_currentRelation;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	pgstrom_data_store *pds;
+	size_t			index;
+
+	if (af_state->meta_agg)
+		return ArrowIterateMetaAggScan(node);
+	for (;;)
+	{
+		while ((pds = af_state->curr_pds) == NULL ||
+			   af_state->curr_index >= pds->kds.nitems)
+		{
+			EState	   *estate = node->ss.ps.state;
+
+			/* unload the previous RecordBatch, if any */
+			if (pds)
+				PDS_release(pds);
+			af_state->curr_index = 0;
+			af_state->curr_pds = arrowFdwLoadRecordBatch(af_state,
+														 relation,
+														 estate,
+														 NULL, -1);
+			if (!af_state->curr_pds)
+				return NULL;
+			execArrowScanPreFilter(af_state, estate);
+		}
+		Assert(pds && af_state->curr_index < pds->kds.nitems);
+		index = af_state->curr_index++;
+		if (!af_state->curr_filter || af_state->curr_filter[index])
+			break;
+		af_state->stats_hint->nfiltered++;
+	}
+	if (KDS_fetch_tuple_arrow(slot, &pds->kds, index))
+		return slot;
+	return NULL;
+}
+
+/*
+ * ArrowReScanForeignScan
+ */
+void
+ExecReScanArrowFdw(ArrowFdwState *af_state)
+{
+	/* rewind the current scan state */
+	pg_atomic_write_u32(af_state->rbatch_index, 0);
+	if (af_state->curr_pds)
+		PDS_release(af_state->curr_pds);
+	af_state->curr_pds = NULL;
+	af_state->curr_index = 0;
+	af_state->prefetch_index = 0;
+}
+
+static void
+ArrowReScanForeignScan(ForeignScanState *node)
+{
+	ArrowFdwState  *af_state = node->fdw_state;
+
+	ExecReScanArrowFdw(af_state);
+	if (af_state->meta_agg)
+		af_state->meta_agg->done = false;
+}
+
+/*
+ * ArrowEndForeignScan
+ */
+void
+ExecEndArrowFdw(ArrowFdwState *af_state)
+{
+	ListCell   *lc;
+
+	if (af_state->curr_pds)
+		PDS_release(af_state->curr_pds);
+	af_state->curr_pds = NULL;
+	arrowFdwReleaseGpuBuffers(af_state);
+	foreach (lc, af_state->fdescList)
+		FileClose((File)lfirst_int(lc));
+}
+
+static void
+ArrowEndForeignScan(ForeignScanState *node)
+{
+	ArrowFdwState  *af_state = node->fdw_state;
+
+	ExecEndArrowFdw(af_state);
+	if (af_state->meta_agg)
+		ExecDropSingleTupleTableSlot(af_state->meta_agg->base_slot);
+}
+
+/*
+ * ArrowExplainForeignScan 
+ */
+void
+ExplainArrowFdw(ArrowFdwState *af_state, Relation frel, ExplainState *es)
+{
+	TupleDesc	tupdesc = RelationGetDescr(frel);
+	ListCell   *lc;
+	int			fcount = 0;
+	char		label[80];
+	size_t	   *chunk_sz = alloca(sizeof(size_t) * tupdesc->natts);
+	int			i, j, k;
+	StringInfoData	buf;
+
+	/* shows referenced columns */
+	initStringInfo(&buf);
+	for (k = bms_next_member(af_state->referenced, -1);
+		 k >= 0;
+		 k = bms_next_member(af_state->referenced, k))
+	{
+		j = k + FirstLowInvalidHeapAttributeNumber - 1;
+
+		if (j >= 0)
+		{
+			Form_pg_attribute	attr = tupleDescAttr(tupdesc, j);
+			const char		   *attName = NameStr(attr->attname);
+
+			if (af_state->ref_subfields && af_state->ref_subfields[j])
+			{
+				TupleDesc	sub_tupdesc
+					= lookup_rowtype_tupdesc(attr->atttypid,
+											 attr->atttypmod);
+				int			m;
+
+				for (m = bms_next_member(af_state->ref_subfields[j], -1);
+					 m >= 0 && m < sub_tupdesc->natts;
+					 m = bms_next_member(af_state->ref_subfields[j], m))
+				{
+					Form_pg_attribute sattr = tupleDescAttr(sub_tupdesc, m);
+
+					if (buf.len > 0)
+						appendStringInfoString(&buf, ", ");
+					appendStringInfo(&buf, "%s.%s",
+									 quote_identifier(attName),
+									 quote_identifier(NameStr(sattr->attname)));
+				}
+				ReleaseTupleDesc(sub_tupdesc);
+				continue;
+			}
+			if (buf.len > 0)
+				appendStringInfoString(&buf, ", ");
+			appendStringInfoString(&buf, quote_identifier(attName));
+		}
+	}
+	ExplainPropertyText("referenced", buf.data, es);
+
+	/* shows qualifiers for min/max statistics */
+	if (af_state->stats_hint)
+	{
+		arrowStatsHint *as_hint = af_state->stats_hint;
+		List	   *dcontext;
+		char	   *temp;
+
+		dcontext = deparse_context_for(RelationGetRelationName(frel),
+									   RelationGetRelid(frel));
+		if (as_hint->orig_quals != NIL)
+		{
+			temp = deparse_expression((Node *)
+									  make_flat_ands_explicit(as_hint->orig_quals),
+									  dcontext, false, false);
+			ExplainPropertyText("Stats-Hint", temp, es);
+		}
+		if (es->analyze)
+		{
+			ExplainPropertyInteger("Stats-Skipped", NULL,
+								   as_hint->nskipped, es);
+			if (as_hint->nfiltered > 0)
+				ExplainPropertyInteger("Rows-PreFiltered", NULL,
+									   as_hint->nfiltered, es);
+		}
+	}
+
+	/* shows number of files pruned by 'key=value' in the path */
+	if (af_state->nfiles_pruned > 0)
+		ExplainPropertyInteger("Files-Pruned", NULL,
+							   af_state->nfiles_pruned, es);
+
+	/* shows number of RecordBatches loaded from the GPU buffers */
+	if (es->analyze && af_state->gpubuf_nloaded > 0)
+		ExplainPropertyInteger("GPU-Buffer-Loaded", NULL,
+							   af_state->gpubuf_nloaded, es);
+
+	/* shows files on behalf of the foreign table */
+	foreach (lc, af_state->fdescList)
+	{
+		File		fdesc = (File)lfirst_int(lc);
+		const char *fname = FilePathName(fdesc);
+		int			rbcount = 0;
+		char	   *pos = label;
+		struct stat	st_buf;
+
+		pos += snprintf(label, sizeof(label), "files%d", fcount++);
+		if (fstat(FileGetRawDesc(fdesc), &st_buf) != 0)
+			memset(&st_buf, 0, sizeof(struct stat));
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			resetStringInfo(&buf);
+			if (st_buf.st_size == 0)
+				appendStringInfoString(&buf, fname);
+			else
+				appendStringInfo(&buf, "%s (size: %s)",
+								 fname,
+								 format_bytesz(st_buf.st_size));
+			ExplainPropertyText(label, buf.data, es);
+		}
+		else
+		{
+			ExplainPropertyText(label, fname, es);
+
+			if (st_buf.st_size > 0)
+			{
+				sprintf(pos, "-size");
+				ExplainPropertyText(label, format_bytesz(st_buf.st_size), es);
+			}
+		}
+		if (!es->verbose)
+			continue;
+
+		/* below only verbose mode */
+		memset(chunk_sz, 0, sizeof(size_t) * tupdesc->natts);
+		for (i=0; i < af_state->num_rbatches; i++)
+		{
+			RecordBatchState *rb_state = af_state->rbatches[i];
+
+			if (rb_state->fdesc != fdesc)
+				continue;
+
+			for (k = bms_next_member(af_state->referenced, -1);
+				 k >= 0;
+				 k = bms_next_member(af_state->referenced, k))
+			{
+				j = k + FirstLowInvalidHeapAttributeNumber - 1;
+				if (j < 0 || j >= tupdesc->natts)
+					continue;
+				chunk_sz[j] += RecordBatchFieldLength(&rb_state->columns[j]);
+			}
+			rbcount++;
+		}
+
+		if (rbcount >= 0)
+		{
+			for (k = bms_next_member(af_state->referenced, -1);
+                 k >= 0;
+                 k = bms_next_member(af_state->referenced, k))
+            {
+				Form_pg_attribute attr;
+
+				j = k + FirstLowInvalidHeapAttributeNumber - 1;
+				if (j < 0 || j >= tupdesc->natts)
+					continue;
+				attr = tupleDescAttr(tupdesc, j);
+				snprintf(label, sizeof(label),
+						 "  %s", NameStr(attr->attname));
+				ExplainPropertyText(label, format_bytesz(chunk_sz[j]), es);
+			}
+		}
+	}
+}
+
+static void
+ArrowExplainForeignScan(ForeignScanState *node, ExplainState *es)
+{
+	Relation	frel = node->ss.ss_currentRelation;
+	ArrowFdwState *af_state = node->fdw_state;
+
+	if (af_state->meta_agg)
+	{
+		arrowMetaAggState *ma_state = af_state->meta_agg;
+		const char *relname = RelationGetRelationName(frel);
+
+		ExplainPropertyText("Relations",
+							psprintf("Aggregate on %s",
+									 quote_identifier(relname)), es);
+		if (es->analyze)
+		{
+			ExplainPropertyInteger("RecordBatches-by-Metadata", NULL,
+								   ma_state->nbatches_meta, es);
+			ExplainPropertyInteger("RecordBatches-Scanned", NULL,
+								   ma_state->nbatches_scan, es);
+		}
+	}
+	ExplainArrowFdw(af_state, frel, es);
+}
+
+/*
+ * readArrowFile
+ */
+static bool
+readArrowFile(const char *pathname, ArrowFileInfo *af_info, bool missing_ok)
+{
+    File	filp = PathNameOpenFile(pathname, O_RDONLY | PG_BINARY);
+
+	if (filp < 0)
+	{
+		if (missing_ok && errno == ENOENT)
+			return false;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", pathname)));
+	}
+	readArrowFileDesc(FileGetRawDesc(filp), af_info);
+	if (af_info->rowGroups)
+		checkParquetFileIsSupported(af_info, pathname);
+	FileClose(filp);
+	return true;
+}
+
+/*
+ * RecordBatchAcquireSampleRows - random sampling
+ */
+#define ARROW_ANALYZE_ROWS_PER_BATCH	300
+static int
+RecordBatchAcquireSampleRows(Relation relation,
+							 RecordBatchState *rb_state,
+							 HeapTuple *rows,
+							 int nsamples)
+{
+	TupleDesc		tupdesc = RelationGetDescr(relation);
+	pgstrom_data_store *pds;
+	Bitmapset	   *referenced = NULL;
+	Datum		   *values;
+	bool		   *isnull;
+	int				count;
+	int				i, j;
+
+	/*
+	 * ANALYZE fetches only the columns to be analyzed; not dropped and
+	 * statistics target is not zero. Columns which have no valid values
+	 * in this RecordBatch are also skipped, according to the metadata.
+	 */
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
+
+		if (attr->attisdropped || attr->attstattarget == 0)
+			continue;
+		if (j < rb_state->ncols &&
+			rb_state->columns[j].null_count >= rb_state->rb_nitems)
+			continue;
+		referenced = bms_add_member(referenced, attr->attnum -
+									FirstLowInvalidHeapAttributeNumber);
+	}
+
+	pds = __arrowFdwLoadRecordBatch(rb_state,
+									relation,
+									referenced,
+									NULL,
+									NULL,
+									CurrentMemoryContext,
+									-1);
+	values = alloca(sizeof(Datum) * tupdesc->natts);
+	isnull = alloca(sizeof(bool)  * tupdesc->natts);
+	for (count = 0; count < nsamples; count++)
+	{
+		/* fetch a row randomly */
+		i = (double)pds->kds.nitems * (((double) random()) /
+									   ((double)MAX_RANDOM_VALUE + 1));
+		Assert(i < pds->kds.nitems);
+
+		for (j=0; j < pds->kds.ncols; j++)
+		{
+			kern_colmeta   *cmeta = &pds->kds.colmeta[j];
+			int		attidx = j + 1 - FirstLowInvalidHeapAttributeNumber;
+
+			if (!bms_is_member(attidx, referenced))
+			{
+				values[j] = 0;
+				isnull[j] = true;
+				continue;
+			}
+			pg_datum_arrow_ref(&pds->kds,
+							   cmeta,
+							   i,
+							   values + j,
+							   isnull + j);
+		}
+		rows[count] = heap_form_tuple(tupdesc, values, isnull);
+	}
+	PDS_release(pds);
+	bms_free(referenced);
+
+	return count;
+}
+
+/*
+ * ArrowAcquireSampleRows
+ */
+static int
+ArrowAcquireSampleRows(Relation relation,
+					   int elevel,
+					   HeapTuple *rows,
+					   int nrooms,
+					   double *p_totalrows,
+					   double *p_totaldeadrows)
+{
+	TupleDesc		tupdesc = RelationGetDescr(relation);
+	ForeignTable   *ft = GetForeignTable(RelationGetRelid(relation));
+	List		   *filesList = NIL;
+	List		   *fdescList = NIL;
+	List		   *rb_state_list = NIL;
+	ListCell	   *lc;
+	bool			writable;
+	int64			total_nrows = 0;
+	int64			sample_nrows = 0;
+	int64			count_nrows = 0;
+	int				nbatches_total = 0;
+	int				nbatches_sample;
+	int				nitems = 0;
+
+	filesList = __arrowFdwExtractFilesList(ft->options,
+										   NULL,
+										   &writable);
+	foreach (lc, filesList)
+	{
+		char	   *fname = strVal(lfirst(lc));
+		File		fdesc;
+		List	   *rb_cached;
+		ListCell   *cell;
+
+		fdesc = PathNameOpenFile(fname, O_RDONLY | PG_BINARY);
+        if (fdesc < 0)
+		{
+			if (writable && errno == ENOENT)
+				continue;
+			elog(ERROR, "failed to open file '%s' on behalf of '%s'",
+				 fname, RelationGetRelationName(relation));
+		}
+		fdescList = lappend_int(fdescList, fdesc);
+		
+		rb_cached = arrowLookupOrBuildMetadataCache(fdesc);
+		foreach (cell, rb_cached)
+		{
+			RecordBatchState *rb_state = lfirst(cell);
+
+			if (!arrowSchemaCompatibilityCheck(tupdesc, rb_state))
+				elog(ERROR, "arrow file '%s' on behalf of foreign table '%s' has incompatible schema definition",
+					 fname, RelationGetRelationName(relation));
+			if (rb_state->rb_nitems == 0)
+				continue;	/* not reasonable to sample, skipped */
+			total_nrows += rb_state->rb_nitems;
+
+			rb_state_list = lappend(rb_state_list, rb_state);
+		}
+	}
+	nrooms = Min(nrooms, total_nrows);
+
+	/*
+	 * Choose RecordBatches to be sampled at random (Knuth's Algorithm S),
+	 * because it is too expensive to load all the RecordBatches of large
+	 * tables. Statistics are still made from the samples spread over the
+	 * whole table, and the total number of rows is exact by the metadata.
+	 */
+	nbatches_total = list_length(rb_state_list);
+	nbatches_sample = (nrooms + ARROW_ANALYZE_ROWS_PER_BATCH - 1)
+		/ ARROW_ANALYZE_ROWS_PER_BATCH;
+	if (nbatches_sample < nbatches_total)
+	{
+		List	   *rb_temp = NIL;
+		int			index = 0;
+
+		foreach (lc, rb_state_list)
+		{
+			double	prob = (double)(nbatches_sample - list_length(rb_temp)) /
+				(double)(nbatches_total - index);
+
+			if ((double)random() / ((double)MAX_RANDOM_VALUE + 1) < prob)
+				rb_temp = lappend(rb_temp, lfirst(lc));
+			index++;
+		}
+		rb_state_list = rb_temp;
+	}
+	foreach (lc, rb_state_list)
+		sample_nrows += ((RecordBatchState *)lfirst(lc))->rb_nitems;
+	nrooms = Min(nrooms, sample_nrows);
+
+	/* fetch samples for each record-batch */
+	foreach (lc, rb_state_list)
+	{
+		RecordBatchState *rb_state = lfirst(lc);
+		int			nsamples;
+
+		count_nrows += rb_state->rb_nitems;
+		nsamples = (double)nrooms * ((double)count_nrows /
+									 (double)sample_nrows) - nitems;
+		if (nitems + nsamples > nrooms)
+			nsamples = nrooms - nitems;
+		if (nsamples > 0)
+			nitems += RecordBatchAcquireSampleRows(relation,
+												   rb_state,
+												   rows + nitems,
+												   nsamples);
+	}
+	elog(elevel, "\"%s\": sampled %d rows from %d of %d RecordBatches, containing %ld rows in total",
+		 RelationGetRelationName(relation), nitems,
+		 list_length(rb_state_list), nbatches_total, (long)total_nrows);
+	foreach (lc, fdescList)
+		FileClose((File)lfirst_int(lc));
+
+	*p_totalrows = total_nrows;
+	*p_totaldeadrows = 0.0;
+
+	return nitems;
+}
+
+/*
+ * ArrowAnalyzeForeignTable
+ */
+static bool
+ArrowAnalyzeForeignTable(Relation frel,
+						 AcquireSampleRowsFunc *p_sample_rows_func,
+						 BlockNumber *p_totalpages)
+{
+	ForeignTable   *ft = GetForeignTable(RelationGetRelid(frel));
+	List		   *filesList = arrowFdwExtractFilesList(ft->options);
+	ListCell	   *lc;
+	Size			totalpages = 0;
+
+	foreach (lc, filesList)
+	{
+		const char *fname = strVal(lfirst(lc));
+		struct stat	statbuf;
+
+		if (stat(fname, &statbuf) != 0)
+		{
+			elog(NOTICE, "failed on stat('%s') on behalf of '%s', skipped",
+				 fname, get_rel_name(ft->relid));
+			continue;
+		}
+		totalpages += (statbuf.st_size + BLCKSZ - 1) / BLCKSZ;
+	}
+
+	if (totalpages > MaxBlockNumber)
+		totalpages = MaxBlockNumber;
+
+	*p_sample_rows_func = ArrowAcquireSampleRows;
+	*p_totalpages = totalpages;
+
+	return true;
+}
+
+/*
+ * ArrowImportForeignSchema
+ */
+static List *
+ArrowImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid serverOid)
+{
+	ArrowSchema	schema;
+	List	   *filesList;
+	ListCell   *lc;
+	int			j;
+	StringInfoData	cmd;
+
+	/* sanity checks */
+	switch (stmt->list_type)
+	{
+		case FDW_IMPORT_SCHEMA_ALL:
+			break;
+		case FDW_IMPORT_SCHEMA_LIMIT_TO:
+			elog(ERROR, "arrow_fdw does not support LIMIT TO clause");
+		case FDW_IMPORT_SCHEMA_EXCEPT:
+			elog(ERROR, "arrow_fdw does not support EXCEPT clause");
+		default:
+			elog(ERROR, "arrow_fdw: Bug? unknown list-type");
+	}
+	filesList = arrowFdwExtractFilesList(stmt->options);
+	if (filesList == NIL)
+		ereport(ERROR,
+				(errmsg("No valid apache arrow files are specified"),
+				 errhint("Use 'file' or 'dir' option to specify apache arrow files on behalf of the foreign table")));
+
+	/* read the schema */
+	memset(&schema, 0, sizeof(ArrowSchema));
+	foreach (lc, filesList)
+	{
+		const char   *fname = strVal(lfirst(lc));
+		ArrowFileInfo af_info;
+
+		readArrowFile(fname, &af_info, false);
+		if (lc == list_head(filesList))
+		{
+			copyArrowNode(&schema.node, &af_info.footer.schema.node);
+		}
+		else
+		{
+			/* compatibility checks */
+			ArrowSchema	   *stemp = &af_info.footer.schema;
+
+			if (schema.endianness != stemp->endianness ||
+				schema._num_fields != stemp->_num_fields)
+				elog(ERROR, "file '%s' has incompatible schema definition",
+					 fname);
+			for (j=0; j < schema._num_fields; j++)
+			{
+				if (arrowTypeIsEqual(&schema.fields[j],
+									 &stemp->fields[j], 0))
+					elog(ERROR, "file '%s' has incompatible schema definition",
+						 fname);
+			}
+		}
+	}
+
+	/* makes a command to define foreign table */
+	initStringInfo(&cmd);
+	appendStringInfo(&cmd, "CREATE FOREIGN TABLE %s (\n",
+					 quote_identifier(stmt->remote_schema));
+	for (j=0; j < schema._num_fields; j++)
+	{
+		ArrowField *field = &schema.fields[j];
+		const char *type_name = arrowTypeToPGTypeName(field);
+
+		if (j > 0)
+			appendStringInfo(&cmd, ",\n");
+		if (!field->name || field->_name_len == 0)
+		{
+			elog(NOTICE, "field %d has no name, so \"__col%02d\" is used",
+				 j+1, j+1);
+			appendStringInfo(&cmd, "  __col%02d  %s", j+1, type_name);
+		}
+		else
+			appendStringInfo(&cmd, "  %s %s",
+							 quote_identifier(field->name), type_name);
+	}
+	appendStringInfo(&cmd,
+					 "\n"
+					 ") SERVER %s\n"
+					 "  OPTIONS (", stmt->server_name);
+	foreach (lc, stmt->options)
+	{
+		DefElem	   *defel = lfirst(lc);
+
+		if (lc != list_head(stmt->options))
+			appendStringInfo(&cmd, ",\n           ");
+		appendStringInfo(&cmd, "%s '%s'",
+						 defel->defname,
+						 strVal(defel->arg));
+	}
+	appendStringInfo(&cmd, ")");
+
+	return list_make1(cmd.data);
+}
+
+/*
+ * ArrowIsForeignScanParallelSafe
+ */
+static bool
+ArrowIsForeignScanParallelSafe(PlannerInfo *root,
+							   RelOptInfo *rel,
+							   RangeTblEntry *rte)
+{
+	return true;
+}
+
+/*
+ * ArrowEstimateDSMForeignScan 
+ */
+static Size
+ArrowEstimateDSMForeignScan(ForeignScanState *node,
+							ParallelContext *pcxt)
+{
+	//elog(INFO, "pid=%u ArrowEstimateDSMForeignScan", getpid());
+	return MAXALIGN(sizeof(pg_atomic_uint32));
+}
+
+/*
+ * ArrowInitializeDSMForeignScan
+ */
+void
+ExecInitDSMArrowFdw(ArrowFdwState *af_state, pg_atomic_uint32 *rbatch_index)
+{
+	pg_atomic_init_u32(rbatch_index, 0);
+	af_state->rbatch_index = rbatch_index;
+}
+
+static void
+ArrowInitializeDSMForeignScan(ForeignScanState *node,
+							  ParallelContext *pcxt,
+							  void *coordinate)
+{
+	ExecInitDSMArrowFdw((ArrowFdwState *)node->fdw_state,
+						(pg_atomic_uint32 *) coordinate);
+}
+
+/*
+ * ArrowReInitializeDSMForeignScan
+ */
+void
+ExecReInitDSMArrowFdw(ArrowFdwState *af_state)
+{
+	pg_atomic_write_u32(af_state->rbatch_index, 0);
+}
+
+
+static void
+ArrowReInitializeDSMForeignScan(ForeignScanState *node,
+								ParallelContext *pcxt,
+								void *coordinate)
+{
+	ExecReInitDSMArrowFdw((ArrowFdwState *)node->fdw_state);
+}
+
+/*
+ * ArrowInitializeWorkerForeignScan
+ */
+void
+ExecInitWorkerArrowFdw(ArrowFdwState *af_state,
+					   pg_atomic_uint32 *rbatch_index)
+{
+	af_state->rbatch_index = rbatch_index;
+}
+
+static void
+ArrowInitializeWorkerForeignScan(ForeignScanState *node,
+								 shm_toc *toc,
+								 void *coordinate)
+{
+	ExecInitWorkerArrowFdw((ArrowFdwState *)node->fdw_state,
+						   (pg_atomic_uint32 *) coordinate);
+}
+
+/*
+ * ArrowShutdownForeignScan
+ */
+void
+ExecShutdownArrowFdw(ArrowFdwState *af_state)
+{
+	/* nothing to do */
+}
+
+static void
+ArrowShutdownForeignScan(ForeignScanState *node)
+{
+	ExecShutdownArrowFdw((ArrowFdwState *)node->fdw_state);
+}
+
+/*
+ * ArrowPlanForeignModify
+ */
+static List *
+ArrowPlanForeignModify(PlannerInfo *root,
+					   ModifyTable *plan,
+					   Index resultRelation,
+					   int subplan_index)
+{
+	RangeTblEntry  *rte = planner_rt_fetch(resultRelation, root);
+	ForeignTable   *ft = GetForeignTable(rte->relid);
+	List		   *filesList;
+	bool			writable;
+
+	if (plan->operation != CMD_INSERT)
+		elog(ERROR, "not a supported operation on arrow_fdw foreign tables");
+
+	filesList = __arrowFdwExtractFilesList(ft->options,
+										   NULL,
+										   &writable);
+	if (!writable)
+		elog(ERROR, "arrow_fdw: foreign table \"%s\" is not writable",
+			 get_rel_name(rte->relid));
+	Assert(list_length(filesList) == 1);
+
+	return NIL;
+}
+
+/*
+ * ArrowBeginForeignModify
+ */
+static void
+ArrowBeginForeignModify(ModifyTableState *mtstate,
+						ResultRelInfo *rrinfo,
+						List *fdw_private,
+						int subplan_index,
+						int eflags)
+{
+	Relation		frel = rrinfo->ri_RelationDesc;
+	ForeignTable   *ft = GetForeignTable(RelationGetRelid(frel));
+	List		   *filesList = arrowFdwExtractFilesList(ft->options);
+	const char	   *fname;
+	File			filp;
+	bool			redo_log_written = false;
+
+	Assert(list_length(filesList) == 1);
+	fname = strVal(linitial(filesList));
+
+	LockRelation(frel, ShareRowExclusiveLock);
+
+	filp = PathNameOpenFile(fname, O_RDWR | PG_BINARY);
+	if (filp < 0)
+	{
+		if (errno != ENOENT)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", fname)));
+
+		filp = PathNameOpenFile(fname, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+		if (filp < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", fname)));
+		PG_TRY();
+		{
+			createArrowWriteRedoLog(filp, true);
+			redo_log_written = true;
+		}
+		PG_CATCH();
+		{
+			unlink(fname);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+	}
+	rrinfo->ri_FdwState = createArrowWriteState(frel, filp,
+												redo_log_written);
+}
+
+/*
+ * ArrowExecForeignInsert
+ */
+static TupleTableSlot *
+ArrowExecForeignInsert(EState *estate,
+					   ResultRelInfo *rrinfo,
+					   TupleTableSlot *slot,
+					   TupleTableSlot *planSlot)
+{
+	Relation		frel = rrinfo->ri_RelationDesc;
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	arrowWriteState *aw_state = rrinfo->ri_FdwState;
+	SQLtable	   *table = &aw_state->sql_table;
+	MemoryContext	oldcxt;
+	size_t			usage;
+
+	slot_getallattrs(slot);
+	oldcxt = MemoryContextSwitchTo(aw_state->memcxt);
+	usage = arrowPutValuesSQLtable(table, tupdesc,
+								   slot->tts_values,
+								   slot->tts_isnull);
+	MemoryContextSwitchTo(oldcxt);
+
+	/*
+	 * If usage or number of rows exceeds the threshold of record-batch,
+	 * make a redo-log on demand, and write out the buffer.
+	 */
+	if (usage > table->segment_sz ||
+		table->nitems >= aw_state->segment_nrows)
+		writeOutArrowRecordBatch(aw_state, false);
+
+	return slot;
+}
+
+/*
+ * arrowPutValuesSQLtable
+ *
+ * It puts a row on the SQLtable buffer, then returns the total usage.
+ */
+static size_t
+arrowPutValuesSQLtable(SQLtable *table, TupleDesc tupdesc,
+					   Datum *values, bool *nulls)
+{
+	size_t		usage = 0;
+	int			j;
+
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
+		SQLfield   *column = &table->columns[j];
+		Datum		datum = values[j];
+		bool		isnull = nulls[j];
+
+		if (isnull)
+		{
+			usage += sql_field_put_value(column, NULL, 0);
+		}
+		else if (attr->attbyval)
+		{
+			Assert(column->sql_type.pgsql.typbyval);
+			usage += sql_field_put_value(column, (char *)&datum, attr->attlen);
+		}
+		else if (attr->attlen == -1)
+		{
+			int		vl_len = VARSIZE_ANY_EXHDR(datum);
+			char   *vl_ptr = VARDATA_ANY(datum);
+
+			Assert(column->sql_type.pgsql.typlen == -1);
+			usage += sql_field_put_value(column, vl_ptr, vl_len);
+		}
+		else
+		{
+			elog(ERROR, "Bug? unsupported type format");
+		}
+	}
+	table->nitems++;
+
+	return usage;
+}
+
+/*
+ * ArrowEndForeignModify
+ */
+static void
+ArrowEndForeignModify(EState *estate,
+					  ResultRelInfo *rrinfo)
+{
+	arrowWriteState *aw_state = rrinfo->ri_FdwState;
+
+	writeOutArrowRecordBatch(aw_state, true);
+}
+
+/*
+ * ArrowExplainForeignModify
+ */
+static void
+ArrowExplainForeignModify(ModifyTableState *mtstate,
+						  ResultRelInfo *rinfo,
+						  List *fdw_private,
+						  int subplan_index,
+						  struct ExplainState *es)
+{
+	/* print something */
+}
+
+/*
+ * handler of Arrow_Fdw
+ */
+Datum
+pgstrom_arrow_fdw_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&pgstrom_arrow_fdw_routine);
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_handler);
+
+/*
+ * arrowTypeIsEqual
+ */
+static bool
+arrowTypeIsEqual(ArrowField *a, ArrowField *b, int depth)
+{
+	int		j;
+
+	if (a->type.node.tag != b->type.node.tag)
+		return false;
+	switch (a->type.node.tag)
+	{
+		case ArrowNodeTag__Int:
+			if (a->type.Int.bitWidth != b->type.Int.bitWidth)
+				return false;
+			break;
+		case ArrowNodeTag__FloatingPoint:
+			{
+				ArrowPrecision	p1 = a->type.FloatingPoint.precision;
+				ArrowPrecision	p2 = b->type.FloatingPoint.precision;
+
+				if (p1 != p2)
+					return false;
+			}
+			break;
+		case ArrowNodeTag__Utf8:
+		case ArrowNodeTag__Binary:
+		case ArrowNodeTag__Bool:
+			break;
+
+		case ArrowNodeTag__Decimal:
+			if (a->type.Decimal.precision != b->type.Decimal.precision ||
+				a->type.Decimal.scale != b->type.Decimal.scale)
+				return false;
+			break;
+
+		case ArrowNodeTag__Date:
+			if (a->type.Date.unit != b->type.Date.unit)
+				return false;
+			break;
+
+		case ArrowNodeTag__Time:
+			if (a->type.Time.unit != b->type.Time.unit)
+				return false;
+			break;
+
+		case ArrowNodeTag__Timestamp:
+			if (a->type.Timestamp.unit != b->type.Timestamp.unit ||
+				a->type.Timestamp.timezone != NULL ||
+				b->type.Timestamp.timezone != NULL)
+				return false;
+			break;
+
+		case ArrowNodeTag__Interval:
+			if (a->type.Interval.unit != b->type.Interval.unit)
+				return false;
+			break;
+
+		case ArrowNodeTag__Struct:
+			if (depth > 0)
+				elog(ERROR, "arrow: nested composite types are not supported");
+			if (a->_num_children != b->_num_children)
+				return false;
+			for (j=0; j < a->_num_children; j++)
+			{
+				if (!arrowTypeIsEqual(&a->children[j],
+									  &b->children[j],
+									  depth + 1))
+					return false;
+			}
+			break;
+
+		case ArrowNodeTag__List:
+			if (depth > 0)
+				elog(ERROR, "arrow_fdw: nested array types are not supported");
+			if (a->_num_children != 1 || b->_num_children != 1)
+				elog(ERROR, "Bug? List of arrow type is corrupted.");
+			if (!arrowTypeIsEqual(&a->children[0],
+								  &b->children[0],
+								  depth + 1))
+				return false;
+			break;
+
+		default:
+			elog(ERROR, "'%s' of arrow type is not supported",
+				 a->type.node.tagName);
+	}
+	return true;
+}
+
+static Oid
+arrowTypeToPGTypeOid(ArrowField *field, int *typmod)
+{
+	ArrowType  *t = &field->type;
+
+	*typmod = -1;
+	switch (t->node.tag)
+	{
+		case ArrowNodeTag__Int:
+			switch (t->Int.bitWidth)
+			{
+				case 16:
+					return INT2OID;
+				case 32:
+					return INT4OID;
+				case 64:
+					return INT8OID;
+				default:
+					elog(ERROR, "Arrow.%s is not supported",
+						 arrowTypeName(field));
+					break;
+			}
+			break;
+		case ArrowNodeTag__FloatingPoint:
+			switch (t->FloatingPoint.precision)
+			{
+				case ArrowPrecision__Half:
+					return FLOAT2OID;
+				case ArrowPrecision__Single:
+					return FLOAT4OID;
+				case ArrowPrecision__Double:
+					return FLOAT8OID;
+				default:
+					elog(ERROR, "Arrow.%s is not supported",
+						 arrowTypeName(field));
+			}
+			break;
+		case ArrowNodeTag__Utf8:
+			return TEXTOID;
+		case ArrowNodeTag__Binary:
+			return BYTEAOID;
+		case ArrowNodeTag__Bool:
+			return BOOLOID;
+		case ArrowNodeTag__Decimal:
+			return NUMERICOID;
+		case ArrowNodeTag__Date:
+			return DATEOID;
+		case ArrowNodeTag__Time:
+			return TIMEOID;
+		case ArrowNodeTag__Timestamp:
+			if (t->Timestamp.timezone)
+				return TIMESTAMPTZOID;
+			return TIMESTAMPOID;
+		case ArrowNodeTag__Interval:
+			return INTERVALOID;
+		case ArrowNodeTag__List:
+			if (field->_num_children != 1)
+				elog(ERROR, "arrow_fdw: corrupted List type definition");
+			else
+			{
+				ArrowField *child = &field->children[0];
+				Oid		type_oid;
+				Oid		elem_oid;
+				int		elem_mod;
+
+				elem_oid = arrowTypeToPGTypeOid(child, &elem_mod);
+				type_oid = get_array_type(elem_oid);
+				if (!OidIsValid(type_oid))
+					elog(ERROR, "array of arrow::%s type is not defined",
+						 arrowTypeName(field));
+				return type_oid;
+			}
+			break;
+
+		case ArrowNodeTag__Struct:
+			{
+				Relation	rel;
+				ScanKeyData	skey[2];
+				SysScanDesc	sscan;
+				HeapTuple	tup;
+				Oid			type_oid = InvalidOid;
+
+				/*
+				 * lookup composite type definition from pg_class
+				 * At least, nattrs == _num_children
+				 */
+				rel = table_open(RelationRelationId, AccessShareLock);
+				ScanKeyInit(&skey[0],
+							Anum_pg_class_relkind,
+							BTEqualStrategyNumber, F_CHAREQ,
+							CharGetDatum(RELKIND_COMPOSITE_TYPE));
+				ScanKeyInit(&skey[1],
+							Anum_pg_class_relnatts,
+							BTEqualStrategyNumber, F_INT2EQ,
+							Int16GetDatum(field->_num_children));
+
+				sscan = systable_beginscan(rel, InvalidOid, false,
+										   NULL, 2, skey);
+				while (!OidIsValid(type_oid) &&
+					   HeapTupleIsValid(tup = systable_getnext(sscan)))
+				{
+					Form_pg_class relForm = (Form_pg_class) GETSTRUCT(tup);
+					TupleDesc	tupdesc;
+					int			j;
+					bool		compatible = true;
+
+					if (pg_namespace_aclcheck(relForm->relnamespace,
+											  GetUserId(),
+											  ACL_USAGE) != ACLCHECK_OK)
+						continue;
+
+					if (pg_type_aclcheck(relForm->reltype,
+										 GetUserId(),
+										 ACL_USAGE) != ACLCHECK_OK)
+						continue;
+
+					tupdesc = lookup_rowtype_tupdesc(relForm->reltype, -1);
+					Assert(tupdesc->natts == field->_num_children);
+					for (j=0; compatible && j < tupdesc->natts; j++)
+					{
+						Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
+						ArrowField  *child = &field->children[j];
+						Oid			typoid;
+						int			typmod;
+
+						typoid = arrowTypeToPGTypeOid(child, &typmod);
+						if (typoid != attr->atttypid)
+							compatible = false;
+					}
+					ReleaseTupleDesc(tupdesc);
+
+					if (compatible)
+						type_oid = relForm->reltype;
+				}
+				systable_endscan(sscan);
+				table_close(rel, AccessShareLock);
+
+				if (!OidIsValid(type_oid))
+					elog(ERROR, "arrow::%s is not supported",
+						 arrowTypeName(field));
+				return type_oid;
+			}
+			break;
+		case ArrowNodeTag__FixedSizeBinary:
+			if (t->FixedSizeBinary.byteWidth < 1 ||
+				t->FixedSizeBinary.byteWidth > BLCKSZ)
+				elog(ERROR, "arrow_fdw: %s with byteWidth=%d is not supported",
+					 t->node.tagName,
+					 t->FixedSizeBinary.byteWidth);
+			*typmod = t->FixedSizeBinary.byteWidth;
+			return BPCHAROID;
+		default:
+			elog(ERROR, "arrow_fdw: type '%s' is not supported",
+				 field->type.node.tagName);
+	}
+	return InvalidOid;
+}
+
+static const char *
+arrowTypeToPGTypeName(ArrowField *field)
+{
+	Oid			typoid;
+	int			typmod;
+	HeapTuple	tup;
+	Form_pg_type type;
+	char	   *schema;
+	char	   *result;
+
+	typoid = arrowTypeToPGTypeOid(field, &typmod);
+	if (!OidIsValid(typoid))
+		return NULL;
+	tup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(typoid));
+	if (!HeapTupleIsValid(tup))
+		elog(ERROR, "cache lookup failed for type %u", typoid);
+	type = (Form_pg_type) GETSTRUCT(tup);
+	schema = get_namespace_name(type->typnamespace);
+	if (typmod < 0)
+		result = psprintf("%s.%s",
+						  quote_identifier(schema),
+						  quote_identifier(NameStr(type->typname)));
+	else
+		result = psprintf("%s.%s(%d)",
+						  quote_identifier(schema),
+						  quote_identifier(NameStr(type->typname)),
+						  typmod);
+	ReleaseSysCache(tup);
+
+	return result;
+}
+
+/*
+ * arrowTypeIsConvertible
+ */
+static bool
+arrowTypeIsConvertible(Oid type_oid, int typemod)
+{
+	HeapTuple		tup;
+	Form_pg_type	typeForm;
+	bool			retval = false;
+
+	switch (type_oid)
+	{
+		case INT2OID:		/* Int16 */
+		case INT4OID:		/* Int32 */
+		case INT8OID:		/* Int64 */
+		case FLOAT2OID:		/* FP16 */
+		case FLOAT4OID:		/* FP32 */
+		case FLOAT8OID:		/* FP64 */
+		case TEXTOID:		/* Utf8 */
+		case BYTEAOID:		/* Binary */
+		case BOOLOID:		/* Bool */
+		case NUMERICOID:	/* Decimal */
+		case DATEOID:		/* Date */
+		case TIMEOID:		/* Time */
+		case TIMESTAMPOID:	/* Timestamp */
+		case TIMESTAMPTZOID:/* TimestampTz */
+		case INTERVALOID:	/* Interval */
+		case BPCHAROID:		/* FixedSizeBinary */
+			return true;
+		default:
+			tup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(type_oid));
+			if (!HeapTupleIsValid(tup))
+				elog(ERROR, "cache lookup failed for type %u", type_oid);
+			typeForm = (Form_pg_type) GETSTRUCT(tup);
+
+			if (typeForm->typlen == -1 && OidIsValid(typeForm->typelem))
+			{
+				retval = arrowTypeIsConvertible(typeForm->typelem, typemod);
+			}
+			else if (typeForm->typtype == TYPTYPE_COMPOSITE)
+			{
+				Relation	rel;
+				TupleDesc	tupdesc;
+				int			j;
+
+				rel = relation_open(typeForm->typrelid, AccessShareLock);
+				tupdesc = RelationGetDescr(rel);
+				for (j=0; j < tupdesc->natts; j++)
+				{
+					Form_pg_attribute	attr = tupleDescAttr(tupdesc, j);
+
+					if (!arrowTypeIsConvertible(attr->atttypid,
+												attr->atttypmod))
+						break;
+				}
+				if (j >= tupdesc->natts)
+					retval = true;
+				relation_close(rel, AccessShareLock);
+			}
+			ReleaseSysCache(tup);
+	}
+	return retval;
+}
+
+/*
+ * arrowFieldLength
+ */
+static size_t
+arrowFieldLength(ArrowField *field, int64 nitems)
+{
+	ArrowType  *type = &field->type;
+	size_t		length = 0;
+
+	switch (type->node.tag)
+	{
+		case ArrowNodeTag__Int:
+			switch (type->Int.bitWidth)
+			{
+				case sizeof(cl_short) * BITS_PER_BYTE:
+					length = sizeof(cl_short) * nitems;
+					break;
+				case sizeof(cl_int) * BITS_PER_BYTE:
+					length = sizeof(cl_int) * nitems;
+					break;
+				case sizeof(cl_long) * BITS_PER_BYTE:
+					length = sizeof(cl_long) * nitems;
+					break;
+				default:
+					elog(ERROR, "Not a supported Int width: %d",
+						 type->Int.bitWidth);
+			}
+			break;
+		case ArrowNodeTag__FloatingPoint:
+			switch (type->FloatingPoint.precision)
+			{
+				case ArrowPrecision__Half:
+					length = sizeof(cl_short) * nitems;
+					break;
+				case ArrowPrecision__Single:
+					length = sizeof(cl_float) * nitems;
+					break;
+				case ArrowPrecision__Double:
+					length = sizeof(cl_double) * nitems;
+					break;
+				default:
+					elog(ERROR, "Not a supported FloatingPoint precision");
+			}
+			break;
+		case ArrowNodeTag__Utf8:
+		case ArrowNodeTag__Binary:
+		case ArrowNodeTag__List:
+			length = sizeof(cl_uint) * (nitems + 1);
+			break;
+		case ArrowNodeTag__Bool:
+			length = BITMAPLEN(nitems);
+			break;
+		case ArrowNodeTag__Decimal:
+			length = sizeof(int128) * nitems;
+			break;
+		case ArrowNodeTag__Date:
+			switch (type->Date.unit)
+			{
+				case ArrowDateUnit__Day:
+					length = sizeof(cl_int) * nitems;
+					break;
+				case ArrowDateUnit__MilliSecond:
+					length = sizeof(cl_long) * nitems;
+					break;
+				default:
+					elog(ERROR, "Not a supported Date unit");
+			}
+			break;
+		case ArrowNodeTag__Time:
+			switch (type->Time.unit)
+			{
+				case ArrowTimeUnit__Second:
+				case ArrowTimeUnit__MilliSecond:
+					length = sizeof(cl_int) * nitems;
+					break;
+				case ArrowTimeUnit__MicroSecond:
+				case ArrowTimeUnit__NanoSecond:
+					length = sizeof(cl_long) * nitems;
+					break;
+				default:
+					elog(ERROR, "Not a supported Time unit");
+			}
+			break;
+		case ArrowNodeTag__Timestamp:
+			length = sizeof(cl_long) * nitems;
+			break;
+		case ArrowNodeTag__Interval:
+			switch (type->Interval.unit)
+			{
+				case ArrowIntervalUnit__Year_Month:
+					length = sizeof(cl_uint) * nitems;
+					break;
+				case ArrowIntervalUnit__Day_Time:
+					length = sizeof(cl_long) * nitems;
+					break;
+				default:
+					elog(ERROR, "Not a supported Interval unit");
+			}
+			break;
+		case ArrowNodeTag__Struct:	//to be supported later
+			length = 0;		/* only nullmap */
+			break;
+		case ArrowNodeTag__FixedSizeBinary:
+			length = (size_t)type->FixedSizeBinary.byteWidth * nitems;
+			break;
+		default:
+			elog(ERROR, "Arrow Type '%s' is not supported now",
+				 type->node.tagName);
+			break;
+	}
+	return length;
+}
+
+/*
+ * arrowSchemaCompatibilityCheck
+ */
+static bool
+__arrowSchemaCompatibilityCheck(TupleDesc tupdesc,
+								RecordBatchFieldState *rb_fstate)
+{
+	int		j;
+
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		RecordBatchFieldState *fstate = &rb_fstate[j];
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
+
+		if (!fstate->children)
+		{
+			/* shortcur, it should be a scalar built-in type */
+			Assert(fstate->num_children == 0);
+			if (attr->atttypid != fstate->atttypid)
+				return false;
+		}
+		else
+		{
+			Form_pg_type	typ;
+			HeapTuple		tup;
+			bool			type_is_ok = true;
+
+			tup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(attr->atttypid));
+			if (!HeapTupleIsValid(tup))
+				elog(ERROR, "cache lookup failed for type %u", attr->atttypid);
+			typ = (Form_pg_type) GETSTRUCT(tup);
+			if (typ->typlen == -1 && OidIsValid(typ->typelem) &&
+				fstate->num_children == 1)
+			{
+				/* Arrow::List */
+				RecordBatchFieldState *cstate = &fstate->children[0];
+
+				if (attr->atttypid != cstate->atttypid)
+					type_is_ok = false;
+				else
+				{
+					/*
+					 * overwrite typoid / typmod because a same arrow file
+					 * can be reused, and it may be on behalf of different
+					 * user defined data type.
+					 */
+					fstate->atttypid = attr->atttypid;
+					fstate->atttypmod = attr->atttypmod;
+				}
+			}
+			else if (typ->typlen == -1 && OidIsValid(typ->typrelid))
+			{
+				/* Arrow::Struct */
+				TupleDesc	sdesc = lookup_rowtype_tupdesc(attr->atttypid,
+														   attr->atttypmod);
+				if (sdesc->natts == fstate->num_children &&
+					__arrowSchemaCompatibilityCheck(sdesc, fstate->children))
+				{
+					/* see comment above */
+					fstate->atttypid = attr->atttypid;
+					fstate->atttypmod = attr->atttypmod;
+				}
+				else
+				{
+					type_is_ok = false;
+				}
+				DecrTupleDescRefCount(sdesc);
+
+			}
+			else
+			{
+				/* unknown */
+				type_is_ok = false;
+			}
+			ReleaseSysCache(tup);
+			if (!type_is_ok)
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool
+arrowSchemaCompatibilityCheck(TupleDesc tupdesc, RecordBatchState *rb_state)
+{
+	if (tupdesc->natts != rb_state->ncols)
+		return false;
+	return __arrowSchemaCompatibilityCheck(tupdesc, rb_state->columns);
+}
+
+/*
+ * pg_XXX_arrow_ref
+ */
+static Datum
+pg_varlena_arrow_ref(kern_data_store *kds,
+					 kern_colmeta *cmeta, size_t index)
+{
+	cl_uint	   *offset = (cl_uint *)
+		((char *)kds + __kds_unpack(cmeta->values_offset));
+	char	   *extra = (char *)kds + __kds_unpack(cmeta->extra_offset);
+	size_t		extra_len = __kds_unpack(cmeta->extra_length);
+	cl_uint		len;
+	struct varlena *res;
+
+	if (cmeta->dict_offset != 0)
+	{
+		/* dictionary-encoded; values array has index of the dictionary */
+		size_t		dict_len = __kds_unpack(cmeta->dict_length);
+
+		index = offset[index];
+		if (sizeof(cl_uint) * (index + 1) >= dict_len)
+			elog(ERROR, "corrupted arrow file? index points out of dictionary");
+		offset = (cl_uint *)((char *)kds + __kds_unpack(cmeta->dict_offset));
+	}
+	len = offset[index+1] - offset[index];
+	if (offset[index] > offset[index + 1] || offset[index+1] > extra_len)
+		elog(ERROR, "corrupted arrow file? offset points out of extra buffer");
+
+	res = palloc(VARHDRSZ + len);
+	SET_VARSIZE(res, VARHDRSZ + len);
+	memcpy(VARDATA(res), extra + offset[index], len);
+
+	return PointerGetDatum(res);
+}
+
+static Datum
+pg_bpchar_arrow_ref(kern_data_store *kds,
+					kern_colmeta *cmeta, size_t index)
+{
+	cl_char	   *values = ((char *)kds + __kds_unpack(cmeta->values_offset));
+	cl_int		unitsz = cmeta->atttypmod - VARHDRSZ;
+	struct varlena *res;
+
+	if (unitsz <= 0)
+		elog(ERROR, "CHAR(%d) is not expected", unitsz);
+	res = palloc(VARHDRSZ + unitsz);
+	memcpy((char *)res + VARHDRSZ, values + unitsz * index, unitsz);
+	SET_VARSIZE(res, VARHDRSZ + unitsz);
+
+	return PointerGetDatum(res);
+}
+
+static Datum
+pg_bool_arrow_ref(kern_data_store *kds,
+				  kern_colmeta *cmeta, size_t index)
+{
+	char   *bitmap = (char *)kds + __kds_unpack(cmeta->values_offset);
+
+	return BoolGetDatum(att_isnull(index, bitmap));
+}
+
+static Datum
+pg_int2_arrow_ref(kern_data_store *kds,
+				  kern_colmeta *cmeta, size_t index)
+{
+	cl_short   *values = (cl_short *)
+		((char *)kds + __kds_unpack(cmeta->values_offset));
+	return values[index];
+}
+
+static Datum
+pg_int4_arrow_ref(kern_data_store *kds,
+				  kern_colmeta *cmeta, size_t index)
+{
+	cl_int	   *values = (cl_int *)
+		((char *)kds + __kds_unpack(cmeta->values_offset));
+	return values[index];
+}
+
+static Datum
+pg_int8_arrow_ref(kern_data_store *kds,
+				  kern_colmeta *cmeta, size_t index)
+{
+	cl_long	   *values = (cl_long *)
+		((char *)kds + __kds_unpack(cmeta->values_offset));
+	return values[index];
+}
+
+static Datum
+pg_numeric_arrow_ref(kern_data_store *kds,
+					 kern_colmeta *cmeta, size_t index)
+{
+	char	   *result = palloc0(sizeof(struct NumericData));
+	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
+	int			dscale = cmeta->attopts.decimal.scale;
+	Int128_t	decimal;
+
+	decimal.ival = ((int128 *)base)[index];
+
+	while (dscale > 0 && decimal.ival % 10 == 0)
+	{
+		decimal.ival /= 10;
+		dscale--;
+	}
+	pg_numeric_to_varlena(result, dscale, decimal);
+
+	return PointerGetDatum(result);
+}
+
+static Datum
+pg_date_arrow_ref(kern_data_store *kds,
+				  kern_colmeta *cmeta, size_t index)
+{
+	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
+	DateADT		dt;
+
+	switch (cmeta->attopts.date.unit)
+	{
+		case ArrowDateUnit__Day:
+			dt = ((cl_uint *)base)[index];
+			break;
+		case ArrowDateUnit__MilliSecond:
+			dt = ((cl_ulong *)base)[index] / 1000;
+			break;
+		default:
+			elog(ERROR, "Bug? unexpected unit of Date type");
+	}
+	/* convert UNIX epoch to PostgreSQL epoch */
+	dt -= (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE);
+	return DateADTGetDatum(dt);
+}
+
+static Datum
+pg_time_arrow_ref(kern_data_store *kds,
+				  kern_colmeta *cmeta, size_t index)
+{
+	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
+	TimeADT		tm;
+
+	switch (cmeta->attopts.time.unit)
+	{
+		case ArrowTimeUnit__Second:
+			tm = ((cl_long)((cl_int *)base)[index]) * 1000000L;
+			break;
+		case ArrowTimeUnit__MilliSecond:
+			tm = ((cl_long)((cl_int *)base)[index]) * 1000L;
+			break;
+		case ArrowTimeUnit__MicroSecond:
+			tm = ((cl_long *)base)[index];
+			break;
+		case ArrowTimeUnit__NanoSecond:
+			tm = ((cl_ulong *)base)[index] / 1000L;
+			break;
+		default:
+			elog(ERROR, "Bug? unexpected unit of Time type");
+	}
+	return TimeADTGetDatum(tm);
+}
+
+static Datum
+pg_timestamp_arrow_ref(kern_data_store *kds,
+					   kern_colmeta *cmeta, size_t index)
+{
+	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
+	cl_long		tz_offset = cmeta->attopts.timestamp.tz_offset;
+	Timestamp	ts;
+
+	switch (cmeta->attopts.timestamp.unit)
+	{
+		case ArrowTimeUnit__Second:
+			ts = ((cl_ulong *)base)[index] * 1000000UL;
+			if (tz_offset != 0)
+				ts += tz_offset;
+			break;
+		case ArrowTimeUnit__MilliSecond:
+			ts = ((cl_ulong *)base)[index] * 1000UL;
+			if (tz_offset != 0)
+				ts += tz_offset * 1000UL;
+			break;
+		case ArrowTimeUnit__MicroSecond:
+			ts = ((cl_ulong *)base)[index];
+			if (tz_offset != 0)
+				ts += tz_offset * 1000000UL;
+			break;
+		case ArrowTimeUnit__NanoSecond:
+			ts = ((cl_ulong *)base)[index] / 1000UL;
+			if (tz_offset != 0)
+				ts += tz_offset * 1000000000UL;
+			break;
+		default:
+			elog(ERROR, "Bug? unexpected unit of Timestamp type");
+	}
+	/* convert UNIX epoch to PostgreSQL epoch */
+	ts -= (POSTGRES_EPOCH_JDATE -
+		   UNIX_EPOCH_JDATE) * USECS_PER_DAY;
+	return TimestampGetDatum(ts);
+}
+
+static Datum
+pg_interval_arrow_ref(kern_data_store *kds,
+					  kern_colmeta *cmeta, size_t index)
+{
+	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
+	Interval   *iv = palloc0(sizeof(Interval));
+
+	switch (cmeta->attopts.interval.unit)
+	{
+		case ArrowIntervalUnit__Year_Month:
+			/* 32bit: number of months */
+			iv->month = ((cl_uint *)base)[index];
+			break;
+		case ArrowIntervalUnit__Day_Time:
+			/* 32bit+32bit: number of days and milliseconds */
+			iv->day = (int32)(((cl_uint *)base)[2 * index]);
+			iv->time = (TimeOffset)(((cl_uint *)base)[2 * index + 1]) * 1000;
+			break;
+		default:
+			elog(ERROR, "Bug? unexpected unit of Interval type");
+	}
+	return PointerGetDatum(iv);
+}
+
+static Datum
+pg_array_arrow_ref(kern_data_store *kds,
+				   kern_colmeta *smeta,
+				   cl_uint start, cl_uint end)
+{
+	ArrayType  *res;
+	size_t		sz;
+	cl_uint		i, nitems = end - start;
+	cl_uint	   *offset;
+	bits8	   *nullmap = NULL;
+	char	   *base;
+	size_t		usage;
+
+	/* allocation of the result buffer */
+	if (smeta->nullmap_offset != 0)
+		sz = ARR_OVERHEAD_WITHNULLS(1, nitems);
+	else
+		sz = ARR_OVERHEAD_NONULLS(1);
+
+	if (smeta->attlen > 0)
+	{
+		sz += TYPEALIGN(smeta->attalign,
+						smeta->attlen) * nitems;
+	}
+	else if (smeta->attlen == -1)
+	{
+		if (smeta->values_offset == 0)
+			elog(ERROR, "Bug? corrupted kernel column metadata");
+		offset = (cl_uint *)((char *)kds + __kds_unpack(smeta->values_offset));
+		sz += (MAXALIGN(VARHDRSZ * nitems) +		/* space for varlena */
+			   MAXALIGN(sizeof(cl_uint) * nitems) +	/* space for alignment */
+			   offset[end] - offset[start]);
+	}
+	else
+		elog(ERROR, "Bug? corrupted kernel column metadata");
+
+	res = palloc0(sz);
+	res->ndim = 1;
+	if (smeta->nullmap_offset != 0)
+	{
+		res->dataoffset = ARR_OVERHEAD_WITHNULLS(1, nitems);
+		nullmap = ARR_NULLBITMAP(res);
+	}
+	res->elemtype = smeta->atttypid;
+	ARR_DIMS(res)[0] = nitems;
+	ARR_LBOUND(res)[0] = 1;
+
+	base = ARR_DATA_PTR(res);
+	usage = 0;
+	for (i=0; i < nitems; i++)
+	{
+		Datum	datum;
+		bool	isnull;
+
+		pg_datum_arrow_ref(kds, smeta, start+i, &datum, &isnull);
+		if (isnull)
+		{
+			if (!nullmap)
+				elog(ERROR, "Bug? element item should not be NULL");
+		}
+		else if (smeta->attlen > 0)
+		{
+			if (nullmap)
+				nullmap[i>>3] |= (1<<(i&7));
+			usage = TYPEALIGN(smeta->attalign, usage);
+			memcpy(base + usage, &datum, smeta->attlen);
+			usage += smeta->attlen;
+		}
+		else if (smeta->attlen == -1)
+		{
+			cl_int		vl_len = VARSIZE(datum);
+
+			if (nullmap)
+				nullmap[i>>3] |= (1<<(i&7));
+			usage = TYPEALIGN(smeta->attalign, usage);
+			memcpy(base + usage, DatumGetPointer(datum), vl_len);
+			usage += vl_len;
+
+			pfree(DatumGetPointer(datum));
+		}
+		else
+			elog(ERROR, "Bug? corrupted kernel column metadata");
+	}
+	SET_VARSIZE(res, (base + usage) - (char *)res);
+
+	return PointerGetDatum(res);
+}
+
+/*
+ * pg_datum_arrow_ref
+ */
+static void
+pg_datum_arrow_ref(kern_data_store *kds,
+				   kern_colmeta *cmeta,
+				   size_t index,
+				   Datum *p_datum,
+				   bool *p_isnull)
+{
+	Datum		datum = 0;
+	bool		isnull = true;
+
+	if (cmeta->nullmap_offset != 0)
+	{
+		size_t	nullmap_offset = __kds_unpack(cmeta->nullmap_offset);
+		uint8  *nullmap = (uint8 *)kds + nullmap_offset;
+
+		if (att_isnull(index, nullmap))
+			goto out;
+	}
+
+	if (cmeta->atttypkind == TYPE_KIND__ARRAY)
+	{
+		kern_colmeta   *smeta;
+		cl_uint		   *offset;
+
+		if (cmeta->num_subattrs != 1 ||
+			cmeta->idx_subattrs < kds->ncols ||
+			cmeta->idx_subattrs >= kds->nr_colmeta)
+			elog(ERROR, "Bug? corrupted kernel column metadata");
+		smeta = &kds->colmeta[cmeta->idx_subattrs];
+		if (cmeta->values_offset == 0)
+			goto out;		/* not loaded? always NULL */
+		offset = (cl_uint *)((char *)kds + __kds_unpack(cmeta->values_offset));
+		datum = pg_array_arrow_ref(kds, smeta,
+								   offset[index],
+								   offset[index+1]);
+		isnull = false;
+	}
+	else if (cmeta->atttypkind == TYPE_KIND__COMPOSITE)
+	{
+		TupleDesc	tupdesc = lookup_rowtype_tupdesc(cmeta->atttypid, -1);
+		Datum	   *sub_values = alloca(sizeof(Datum) * tupdesc->natts);
+		bool	   *sub_isnull = alloca(sizeof(bool)  * tupdesc->natts);
+		HeapTuple	htup;
+		int			j;
+
+		if (tupdesc->natts != cmeta->num_subattrs)
+			elog(ERROR, "Struct definition is conrrupted?");
+		if (cmeta->idx_subattrs < kds->ncols ||
+			cmeta->idx_subattrs + cmeta->num_subattrs > kds->nr_colmeta)
+			elog(ERROR, "Bug? strange kernel column metadata");
+
+		for (j=0; j < tupdesc->natts; j++)
+		{
+			kern_colmeta *sub_meta = &kds->colmeta[cmeta->idx_subattrs + j];
+
+			pg_datum_arrow_ref(kds, sub_meta, index,
+							   sub_values + j,
+							   sub_isnull + j);
+		}
+		htup = heap_form_tuple(tupdesc, sub_values, sub_isnull);
+
+		ReleaseTupleDesc(tupdesc);
+
+		datum = PointerGetDatum(htup->t_data);
+		isnull = false;
+	}
+	else if (cmeta->values_offset == 0)
+	{
+		/* not loaded, always null */
+		goto out;
+	}
+	else
+	{
+		Assert(cmeta->atttypkind == TYPE_KIND__BASE);
+		switch (cmeta->atttypid)
+		{
+			case INT2OID:
+			case FLOAT2OID:
+				datum = pg_int2_arrow_ref(kds, cmeta, index);
+				break;
+			case INT4OID:
+			case FLOAT4OID:
+				datum = pg_int4_arrow_ref(kds, cmeta, index);
+				break;
+			case INT8OID:
+			case FLOAT8OID:
+				datum = pg_int8_arrow_ref(kds, cmeta, index);
+				break;
+			case TEXTOID:
+			case BYTEAOID:
+				datum = pg_varlena_arrow_ref(kds, cmeta, index);
+				break;
+			case BPCHAROID:
+				datum = pg_bpchar_arrow_ref(kds, cmeta, index);
+				break;
+			case BOOLOID:
+				datum = pg_bool_arrow_ref(kds, cmeta, index);
+				break;
+			case NUMERICOID:
+				datum = pg_numeric_arrow_ref(kds, cmeta, index);
+				break;
+			case DATEOID:
+				datum = pg_date_arrow_ref(kds, cmeta, index);
+				break;
+			case TIMEOID:
+				datum = pg_time_arrow_ref(kds, cmeta, index);
+				break;
+			case TIMESTAMPOID:
+			case TIMESTAMPTZOID:
+				datum = pg_timestamp_arrow_ref(kds, cmeta, index);
+				break;
+			case INTERVALOID:
+				datum = pg_interval_arrow_ref(kds, cmeta, index);
+				break;
+			default:
+				elog(ERROR, "Bug? unexpected datum type: %u",
+					 cmeta->atttypid);
+				break;
+		}
+		isnull = false;
+	}
+out:
+	*p_datum  = datum;
+	*p_isnull = isnull;
+}
+
+/*
+ * KDS_fetch_tuple_arrow
+ */
+bool
+KDS_fetch_tuple_arrow(TupleTableSlot *slot,
+					  kern_data_store *kds,
+					  size_t index)
+{
+	Datum  *values = slot->tts_values;
+	bool   *isnull = slot->tts_isnull;
+	int		j;
+
+	if (index >= kds->nitems)
+		return false;
+	ExecStoreAllNullTuple(slot);
+	for (j=0; j < kds->ncols; j++)
+	{
+		kern_colmeta   *cmeta = &kds->colmeta[j];
+
+		pg_datum_arrow_ref(kds, cmeta,
+						   index,
+						   values + j,
+						   isnull + j);
+	}
+	return true;
+}
+
+/*
+ * arrowFdwExtractFilesList
+ */
+/*
+ * __arrowFdwExpandFilePattern
+ *
+ * It expands the file name by glob(3), if it contains any wildcard.
+ * A pattern that matches nothing adds no files, so the foreign table
+ * can pick up new files later without ALTER FOREIGN TABLE.
+ */
+static List *
+__arrowFdwExpandFilePattern(List *filesList, const char *fname,
+							bool *p_has_pattern)
+{
+	glob_t		gl;
+	size_t		i;
+	int			rv;
+
+	if (strpbrk(fname, "*?[") == NULL)
+		return lappend(filesList, makeString(pstrdup(fname)));
+
+	*p_has_pattern = true;
+	memset(&gl, 0, sizeof(glob_t));
+	rv = glob(fname, GLOB_ERR, NULL, &gl);
+	if (rv == 0)
+	{
+		for (i=0; i < gl.gl_pathc; i++)
+			filesList = lappend(filesList, makeString(pstrdup(gl.gl_pathv[i])));
+	}
+	else if (rv != GLOB_NOMATCH)
+	{
+		globfree(&gl);
+		elog(ERROR, "arrow: failed on glob('%s'): %s", fname,
+			 rv == GLOB_NOSPACE ? "out of memory" : "read error");
+	}
+	globfree(&gl);
+
+	return filesList;
+}
+
+/*
+ * __arrowFdwExtractDirFiles
+ *
+ * It maps files in the directory. Sub-directories named like 'key=value'
+ * (Hive-style partitioning) are also walked down recursively; the pairs
+ * in the path shall be used to prune files by arrowFdwPruneFilesList.
+ */
+static List *
+__arrowFdwExtractDirFiles(List *filesList,
+						  const char *dir_path,
+						  const char *dir_suffix)
+{
+	struct dirent *dentry;
+	DIR		   *dir;
+	char	   *temp;
+
+	dir = AllocateDir(dir_path);
+	while ((dentry = ReadDir(dir, dir_path)) != NULL)
+	{
+		bool	is_dir = false;
+
+		if (strcmp(dentry->d_name, ".") == 0 ||
+			strcmp(dentry->d_name, "..") == 0)
+			continue;
+		temp = psprintf("%s/%s", dir_path, dentry->d_name);
+		if (dentry->d_type == DT_DIR)
+			is_dir = true;
+		else if (dentry->d_type == DT_UNKNOWN ||
+				 dentry->d_type == DT_LNK)
+		{
+			struct stat	stat_buf;
+
+			if (stat(temp, &stat_buf) == 0 && S_ISDIR(stat_buf.st_mode))
+				is_dir = true;
+		}
+
+		if (is_dir)
+		{
+			if (dentry->d_name[0] != '=' &&
+				strchr(dentry->d_name, '=') != NULL)
+				filesList = __arrowFdwExtractDirFiles(filesList, temp,
+													  dir_suffix);
+			pfree(temp);
+			continue;
+		}
+		if (dir_suffix)
+		{
+			int		dlen = strlen(dentry->d_name);
+			int		slen = strlen(dir_suffix);
+			int		diff = dlen - slen;
+
+			if (dlen < 2 + slen ||
+				dentry->d_name[diff-1] != '.' ||
+				strcmp(dentry->d_name + diff, dir_suffix) != 0)
+			{
+				pfree(temp);
+				continue;
+			}
+		}
+		filesList = lappend(filesList, makeString(temp));
+	}
+	FreeDir(dir);
+
+	return filesList;
+}
+
+static List *
+__arrowFdwExtractFilesList(List *options_list,
+						   int *p_parallel_nworkers,
+						   bool *p_writable)
+{
+	ListCell   *lc;
+	List	   *filesList = NIL;
+	char	   *dir_path = NULL;
+	char	   *dir_suffix = NULL;
+	int			parallel_nworkers = -1;
+	bool		writable = false;	/* default: read-only */
+	bool		has_pattern = false;
+
+	foreach (lc, options_list)
+	{
+		DefElem	   *defel = lfirst(lc);
+
+		Assert(IsA(defel->arg, String));
+		if (strcmp(defel->defname, "file") == 0)
+		{
+			char   *temp = strVal(defel->arg);
+
+			filesList = __arrowFdwExpandFilePattern(filesList, temp,
+													&has_pattern);
+		}
+		else if (strcmp(defel->defname, "files") == 0)
+		{
+			char   *temp = pstrdup(strVal(defel->arg));
+			char   *saveptr;
+			char   *tok, *pos;
+
+			while ((tok = strtok_r(temp, ",", &saveptr)) != NULL)
+			{
+				while (isspace(*tok))
+					tok++;
+				pos = tok + strlen(tok) - 1;
+				while (pos >= tok && isspace(*pos))
+					*pos-- = '\0';
+
+				filesList = __arrowFdwExpandFilePattern(filesList, tok,
+														&has_pattern);
+				temp = NULL;
+			}
+		}
+		else if (strcmp(defel->defname, "dir") == 0)
+		{
+			dir_path = strVal(defel->arg);
+		}
+		else if (strcmp(defel->defname, "suffix") == 0)
+		{
+			dir_suffix = strVal(defel->arg);
+		}
+		else if (strcmp(defel->defname, "parallel_workers") == 0)
+		{
+			if (parallel_nworkers >= 0)
+				elog(ERROR, "'parallel_workers' appeared twice");
+			parallel_nworkers = pg_atoi(strVal(defel->arg), sizeof(int), '\0');
+		}
+		else if (strcmp(defel->defname, "writable") == 0)
+		{
+			writable = defGetBoolean(defel);
+		}
+		else
+			elog(ERROR, "arrow: unknown option (%s)", defel->defname);
+	}
+	if (dir_suffix && !dir_path)
+		elog(ERROR, "arrow: cannot use 'suffix' option without 'dir'");
+
+	if (writable)
+	{
+		if (dir_path)
+			elog(ERROR, "arrow: 'dir_path' and 'writable' options are exclusive");
+		if (list_length(filesList) == 0)
+			elog(ERROR, "arrow: 'writable' needs a backend file specified by 'file' option");
+		if (list_length(filesList) > 1)
+			elog(ERROR, "arrow: 'writable' cannot use multiple backend files");
+		if (has_pattern)
+			elog(ERROR, "arrow: 'writable' cannot use wildcard in file name");
+	}
+
+	if (dir_path)
+		filesList = __arrowFdwExtractDirFiles(filesList, dir_path, dir_suffix);
+
+	if (filesList == NIL)
+		elog(ERROR, "no files are configured on behalf of the arrow_fdw foreign table");
+	foreach (lc, filesList)
+	{
+		const char *fname = strVal((Value *)lfirst(lc));
+
+		if (!writable)
+		{
+			if (access(fname, R_OK) != 0)
+				elog(ERROR, "unable to read '%s': %m", fname);
+		}
+		else
+		{
+			if (access(fname, R_OK | W_OK) != 0)
+			{
+				if (errno != ENOENT)
+					elog(ERROR, "unable to read/write '%s': %m", fname);
+				else
+				{
+					char   *temp = pstrdup(fname);
+					char   *dname = dirname(temp);
+
+					if (access(dname, R_OK | W_OK | X_OK) != 0)
+						elog(ERROR, "unable to create '%s': %m", fname);
+					pfree(temp);
+				}
+			}
+		}
+	}
+	/* other properties */
+	if (p_parallel_nworkers)
+		*p_parallel_nworkers = parallel_nworkers;
+	if (p_writable)
+		*p_writable = writable;
+
+	return filesList;
+}
+
+static List *
+arrowFdwExtractFilesList(List *options_list)
+{
+	return __arrowFdwExtractFilesList(options_list, NULL, NULL);
+}
+
+/*
+ * arrowFdwPruneFilesList
+ *
+ * It removes files whose 'key=value' path components never satisfy the
+ * qualifiers, if 'key' is a column name of the foreign table. Like Hive-style
+ * partitioning, all the rows in the file are assumed to have the value in
+ * the path; '__HIVE_DEFAULT_PARTITION__' means NULL.
+ */
+typedef struct
+{
+	Node	   *clause;		/* OpExpr, ScalarArrayOpExpr or NullTest */
+	const char *attname;
+	Oid			atttypid;
+	int32		atttypmod;
+	Oid			typinput;
+	Oid			typioparam;
+	Const	   *arg;		/* comparison key, if not NullTest */
+	bool		var_on_left;
+	FmgrInfo	flinfo;
+	/* cache of the last evaluation */
+	char	   *last_value;
+	bool		last_result;
+} arrowPathPruneCond;
+
+#define ARROW_PATH_NULL_VALUE		"__HIVE_DEFAULT_PARTITION__"
+
+static List *
+__arrowFdwSetupPathPruneConds(TupleDesc tupdesc, List *quals)
+{
+	List	   *conds = NIL;
+	ListCell   *lc;
+
+	foreach (lc, quals)
+	{
+		Node	   *clause = lfirst(lc);
+		Var		   *var = NULL;
+		Const	   *arg = NULL;
+		Oid			opfuncid = InvalidOid;
+		bool		var_on_left = true;
+		Form_pg_attribute attr;
+		arrowPathPruneCond *cond;
+
+		if (IsA(clause, OpExpr))
+		{
+			OpExpr	   *op = (OpExpr *)clause;
+
+			if (list_length(op->args) != 2)
+				continue;
+			if (IsA(linitial(op->args), Var) &&
+				IsA(lsecond(op->args), Const))
+			{
+				var = linitial(op->args);
+				arg = lsecond(op->args);
+			}
+			else if (IsA(linitial(op->args), Const) &&
+					 IsA(lsecond(op->args), Var))
+			{
+				arg = linitial(op->args);
+				var = lsecond(op->args);
+				var_on_left = false;
+			}
+			else
+				continue;
+			opfuncid = get_opcode(op->opno);
+		}
+		else if (IsA(clause, ScalarArrayOpExpr))
+		{
+			ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *)clause;
+
+			if (list_length(saop->args) != 2 ||
+				!IsA(linitial(saop->args), Var) ||
+				!IsA(lsecond(saop->args), Const))
+				continue;
+			var = linitial(saop->args);
+			arg = lsecond(saop->args);
+			opfuncid = get_opcode(saop->opno);
+		}
+		else if (IsA(clause, NullTest))
+		{
+			NullTest   *nt = (NullTest *)clause;
+
+			if (nt->argisrow || !IsA(nt->arg, Var))
+				continue;
+			var = (Var *)nt->arg;
+		}
+		else
+			continue;
+
+		if (IS_SPECIAL_VARNO(var->varno) ||
+			var->varlevelsup > 0 ||
+			var->varattno <= 0 ||
+			var->varattno > tupdesc->natts)
+			continue;
+		attr = tupleDescAttr(tupdesc, var->varattno - 1);
+		if (attr->attisdropped)
+			continue;
+		/* only strict operators are safe to skip NULL */
+		if (OidIsValid(opfuncid) && !func_strict(opfuncid))
+			continue;
+
+		cond = palloc0(sizeof(arrowPathPruneCond));
+		cond->clause = clause;
+		cond->attname = NameStr(attr->attname);
+		cond->atttypid = var->vartype;
+		cond->atttypmod = var->vartypmod;
+		getTypeInputInfo(var->vartype,
+						 &cond->typinput,
+						 &cond->typioparam);
+		cond->arg = arg;
+		cond->var_on_left = var_on_left;
+		if (OidIsValid(opfuncid))
+			fmgr_info(opfuncid, &cond->flinfo);
+		conds = lappend(conds, cond);
+	}
+	return conds;
+}
+
+/*
+ * __arrowFdwLookupPathKey - fetch the value of the last 'key=value' component
+ */
+static bool
+__arrowFdwLookupPathKey(const char *fname, const char *key, char **p_value)
+{
+	const char *pos = fname;
+	const char *found = NULL;
+	const char *tail;
+	size_t		keylen = strlen(key);
+	char	   *value;
+	char	   *dst;
+
+	while (*pos != '\0')
+	{
+		tail = strchr(pos, '/');
+		if (!tail)
+			tail = pos + strlen(pos);
+		if ((size_t)(tail - pos) > keylen &&
+			pos[keylen] == '=' &&
+			strncmp(pos, key, keylen) == 0)
+			found = pos + keylen + 1;
+		pos = (*tail == '/' ? tail + 1 : tail);
+	}
+	if (!found)
+		return false;
+
+	/* decode escaped characters (%XX) */
+	tail = strchr(found, '/');
+	if (!tail)
+		tail = found + strlen(found);
+	dst = value = palloc(tail - found + 1);
+	for (pos = found; pos < tail; pos++)
+	{
+		if (pos[0] == '%' && pos + 2 < tail &&
+			isxdigit(pos[1]) && isxdigit(pos[2]))
+		{
+			char	hex[3] = { pos[1], pos[2], '\0' };
+
+			*dst++ = (char)strtol(hex, NULL, 16);
+			pos += 2;
+		}
+		else
+			*dst++ = *pos;
+	}
+	*dst = '\0';
+
+	if (strcmp(value, ARROW_PATH_NULL_VALUE) == 0)
+	{
+		pfree(value);
+		value = NULL;
+	}
+	*p_value = value;
+	return true;
+}
+
+/*
+ * __arrowFdwPathValueToDatum
+ *
+ * It returns false, if the value in the path is not valid input of the type.
+ * In this case, the file shall not be pruned.
+ */
+static bool
+__arrowFdwPathValueToDatum(arrowPathPruneCond *cond, char *value,
+						   Datum *p_datum)
+{
+	MemoryContext	memcxt = CurrentMemoryContext;
+	bool			retval = true;
+
+	PG_TRY();
+	{
+		*p_datum = OidInputFunctionCall(cond->typinput,
+										value,
+										cond->typioparam,
+										cond->atttypmod);
+	}
+	PG_CATCH();
+	{
+		ErrorData	   *edata;
+
+		MemoryContextSwitchTo(memcxt);
+		edata = CopyErrorData();
+		if (ERRCODE_TO_CATEGORY(edata->sqlerrcode) != ERRCODE_DATA_EXCEPTION)
+			PG_RE_THROW();
+		FlushErrorState();
+		FreeErrorData(edata);
+		retval = false;
+	}
+	PG_END_TRY();
+
+	return retval;
+}
+
+static bool
+__arrowFdwCheckPathPruneCond(arrowPathPruneCond *cond, char *value)
+{
+	Datum		datum;
+	Oid			collid;
+
+	if (IsA(cond->clause, NullTest))
+	{
+		NullTest   *nt = (NullTest *)cond->clause;
+
+		if (nt->nulltesttype == IS_NULL)
+			return (value == NULL);
+		return (value != NULL);
+	}
+	/* strict operator never returns true on NULL */
+	if (!value || cond->arg->constisnull)
+		return false;
+	if (!__arrowFdwPathValueToDatum(cond, value, &datum))
+		return true;
+
+	if (IsA(cond->clause, OpExpr))
+	{
+		collid = ((OpExpr *)cond->clause)->inputcollid;
+		if (cond->var_on_left)
+			return DatumGetBool(FunctionCall2Coll(&cond->flinfo, collid,
+												  datum,
+												  cond->arg->constvalue));
+		return DatumGetBool(FunctionCall2Coll(&cond->flinfo, collid,
+											  cond->arg->constvalue,
+											  datum));
+	}
+	else
+	{
+		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *)cond->clause;
+		ArrayType  *array = DatumGetArrayTypeP(cond->arg->constvalue);
+		int16		elmlen;
+		bool		elmbyval;
+		char		elmalign;
+		Datum	   *elem_values;
+		bool	   *elem_nulls;
+		int			i, nitems;
+		bool		has_null = false;
+
+		get_typlenbyvalalign(ARR_ELEMTYPE(array),
+							 &elmlen, &elmbyval, &elmalign);
+		deconstruct_array(array, ARR_ELEMTYPE(array),
+						  elmlen, elmbyval, elmalign,
+						  &elem_values, &elem_nulls, &nitems);
+		collid = saop->inputcollid;
+		for (i=0; i < nitems; i++)
+		{
+			bool	rv;
+
+			if (elem_nulls[i])
+			{
+				has_null = true;
+				continue;
+			}
+			rv = DatumGetBool(FunctionCall2Coll(&cond->flinfo, collid,
+												datum, elem_values[i]));
+			if (saop->useOr && rv)
+				return true;
+			if (!saop->useOr && !rv)
+				return false;
+		}
+		/* ANY() never matched, or ALL() contains NULL */
+		return (!saop->useOr && !has_null);
+	}
+}
+
+static List *
+arrowFdwPruneFilesList(List *filesList, TupleDesc tupdesc,
+					   List *quals, int *p_nfiles_pruned)
+{
+	List	   *conds = __arrowFdwSetupPathPruneConds(tupdesc, quals);
+	List	   *result = NIL;
+	ListCell   *lc1, *lc2;
+	int			nfiles_pruned = 0;
+
+	if (conds == NIL)
+		goto out;
+	foreach (lc1, filesList)
+	{
+		const char *fname = strVal(lfirst(lc1));
+		bool		matched = true;
+
+		foreach (lc2, conds)
+		{
+			arrowPathPruneCond *cond = lfirst(lc2);
+			char	   *value;
+
+			if (!__arrowFdwLookupPathKey(fname, cond->attname, &value))
+				continue;
+			/* files in the same directory usually have same value */
+			if (cond->last_value && value &&
+				strcmp(cond->last_value, value) == 0)
+				matched = cond->last_result;
+			else
+			{
+				matched = __arrowFdwCheckPathPruneCond(cond, value);
+				if (cond->last_value)
+					pfree(cond->last_value);
+				cond->last_value = (value ? pstrdup(value) : NULL);
+				cond->last_result = matched;
+			}
+			if (value)
+				pfree(value);
+			if (!matched)
+				break;
+		}
+		if (matched)
+			result = lappend(result, lfirst(lc1));
+		else
+			nfiles_pruned++;
+	}
+	if (nfiles_pruned > 0)
+		filesList = result;
+	else
+		list_free(result);
+out:
+	if (p_nfiles_pruned)
+		*p_nfiles_pruned = nfiles_pruned;
+	return filesList;
+}
+
+
+/*
+ * validator of Arrow_Fdw
+ */
+Datum
+pgstrom_arrow_fdw_validator(PG_FUNCTION_ARGS)
+{
+	List	   *options_list = untransformRelOptions(PG_GETARG_DATUM(0));
+	Oid			catalog = PG_GETARG_OID(1);
+
+	if (catalog == ForeignTableRelationId)
+	{
+		List	   *filesList;
+		ListCell   *lc;
+
+		filesList = arrowFdwExtractFilesList(options_list);
+		foreach (lc, filesList)
+		{
+			ArrowFileInfo	af_info;
+			const char	   *fname = strVal(lfirst(lc));
+
+			readArrowFile(fname, &af_info, true);
+		}
+	}
+	else if (options_list != NIL)
+	{
+		const char	   *label;
+		char			temp[80];
+
+		switch (catalog)
+		{
+			case ForeignDataWrapperRelationId:
+				label = "FOREIGN DATA WRAPPER";
+				break;
+			case ForeignServerRelationId:
+				label = "SERVER";
+				break;
+			case UserMappingRelationId:
+				label = "USER MAPPING";
+				break;
+			case AttributeRelationId:
+				label = "attribute of FOREIGN TABLE";
+				break;
+			default:
+				snprintf(temp, sizeof(temp),
+						 "[unexpected object catalog=%u]", catalog);
+				label = temp;
+				break;
+		}
+		elog(ERROR, "Arrow_Fdw does not support any options for %s", label);
+	}
+	PG_RETURN_VOID();
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_validator);
+
+/*
+ * pgstrom_arrow_fdw_precheck_schema
+ */
+static void
+arrow_fdw_precheck_schema(Relation rel)
+{
+	TupleDesc		tupdesc = RelationGetDescr(rel);
+	ForeignTable   *ft = GetForeignTable(RelationGetRelid(rel));
+	List		   *filesList;
+	ListCell	   *lc;
+	bool			writable;
+	int				j;
+
+	/* check schema definition is supported by Apache Arrow */
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute	attr = tupleDescAttr(tupdesc, j);
+
+		if (!arrowTypeIsConvertible(attr->atttypid,
+									attr->atttypmod))
+			elog(ERROR, "column %s of foreign table %s has %s type that is not convertible any supported Apache Arrow types",
+				 NameStr(attr->attname),
+				 RelationGetRelationName(rel),
+				 format_type_be(attr->atttypid));
+	}
+
+	filesList = __arrowFdwExtractFilesList(ft->options,
+										   NULL,
+										   &writable);
+	foreach (lc, filesList)
+	{
+		const char *fname = strVal(lfirst(lc));
+		File		filp;
+		List	   *rb_cached = NIL;
+		ListCell   *cell;
+
+		filp = PathNameOpenFile(fname, O_RDONLY | PG_BINARY);
+		if (filp < 0)
+		{
+			if (writable && errno == ENOENT)
+				continue;
+			elog(ERROR, "failed to open '%s' on behalf of '%s': %m",
+				 fname, RelationGetRelationName(rel));
+		}
+		/* check schema compatibility */
+		rb_cached = arrowLookupOrBuildMetadataCache(filp);
+		foreach (cell, rb_cached)
+		{
+			RecordBatchState *rb_state = lfirst(cell);
+
+			if (!arrowSchemaCompatibilityCheck(tupdesc, rb_state))
+				elog(ERROR, "arrow file '%s' on behalf of the foreign table '%s' has incompatible schema definition",
+					 fname, RelationGetRelationName(rel));
+		}
+		list_free(rb_cached);
+	}
+}
+
+Datum
+pgstrom_arrow_fdw_precheck_schema(PG_FUNCTION_ARGS)
+{
+	EventTriggerData   *trigdata;
+	
+	if (!CALLED_AS_EVENT_TRIGGER(fcinfo))
+		elog(ERROR, "%s: must be called as EventTrigger",
+			 __FUNCTION__);
+	trigdata = (EventTriggerData *) fcinfo->context;
+	if (strcmp(trigdata->event, "ddl_command_end") != 0)
+		elog(ERROR, "%s: must be called on ddl_command_end event",
+			 __FUNCTION__);
+	if (strcmp(trigdata->tag, "CREATE FOREIGN TABLE") == 0)
+	{
+		CreateStmt	   *stmt = (CreateStmt *)trigdata->parsetree;
+		Relation		rel;
+
+		rel = relation_openrv_extended(stmt->relation, AccessShareLock, true);
+		if (!rel)
+			PG_RETURN_NULL();
+		if (rel->rd_rel->relkind == RELKIND_FOREIGN_TABLE &&
+			GetFdwRoutineForRelation(rel, false) == &pgstrom_arrow_fdw_routine)
+		{
+			arrow_fdw_precheck_schema(rel);
+		}
+		relation_close(rel, AccessShareLock);
+	}
+	else if (strcmp(trigdata->tag, "ALTER FOREIGN TABLE") == 0)
+	{
+		AlterTableStmt *stmt = (AlterTableStmt *)trigdata->parsetree;
+		Relation		rel;
+		ListCell	   *lc;
+		bool			has_schema_change = false;
+
+		rel = relation_openrv_extended(stmt->relation, AccessShareLock, true);
+		if (!rel)
+			PG_RETURN_NULL();
+		if (rel->rd_rel->relkind == RELKIND_FOREIGN_TABLE &&
+			GetFdwRoutineForRelation(rel, false) == &pgstrom_arrow_fdw_routine)
+		{
+			foreach (lc, stmt->cmds)
+			{
+				AlterTableCmd  *cmd = lfirst(lc);
+
+				if (cmd->subtype == AT_AddColumn ||
+					cmd->subtype == AT_DropColumn ||
+					cmd->subtype == AT_AlterColumnType)
+				{
+					has_schema_change = true;
+					break;
+				}
+			}
+			if (has_schema_change)
+				arrow_fdw_precheck_schema(rel);
+		}
+		relation_close(rel, AccessShareLock);
+	}
+	else
+	{
+		elog(NOTICE, "%s was called on %s, ignored",
+			 __FUNCTION__, trigdata->tag);
+	}
+	PG_RETURN_NULL();
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_precheck_schema);
+
+/*
+ * arrowInvalidateMetadataCache
+ *
+ * NOTE: caller must have lock_slots[] with EXCLUSIVE mode
+ */
+static uint64
+arrowInvalidateMetadataCache(arrowMetadataCache *mcache, bool detach_lru)
+{
+	arrowMetadataCache *mtemp;
+	dlist_node	   *dnode;
+	uint64			released = 0;
+
+	while (!dlist_is_empty(&mcache->siblings))
+	{
+		dnode = dlist_pop_head_node(&mcache->siblings);
+		mtemp = dlist_container(arrowMetadataCache, chain, dnode);
+		Assert(dlist_is_empty(&mtemp->siblings) &&
+			   !mtemp->lru_chain.prev && !mtemp->lru_chain.next);
+		dlist_delete(&mtemp->chain);
+		released += MAXALIGN(offsetof(arrowMetadataCache,
+									  fstate[mtemp->nfields]));
+		pfree(mtemp);
+	}
+	released += MAXALIGN(offsetof(arrowMetadataCache,
+								  fstate[mcache->nfields]));
+	if (detach_lru)
+	{
+		SpinLockAcquire(&arrow_metadata_state->lru_lock);
+		dlist_delete(&mcache->lru_chain);
+		SpinLockRelease(&arrow_metadata_state->lru_lock);
+	}
+	dlist_delete(&mcache->chain);
+	pfree(mcache);
+
+	return pg_atomic_sub_fetch_u64(&arrow_metadata_state->consumed,
+								   released);
+}
+
+/*
+ * copyMetadataFieldCache - copy for nested structure
+ */
+static int
+copyMetadataFieldCache(RecordBatchFieldState *dest_curr,
+					   RecordBatchFieldState *dest_tail,
+					   int nattrs,
+					   RecordBatchFieldState *columns)
+{
+	RecordBatchFieldState *dest_next = dest_curr + nattrs;
+	int		j, k, nslots = nattrs;
+
+	if (dest_next > dest_tail)
+		return -1;
+
+	for (j=0; j < nattrs; j++)
+	{
+		dest_curr[j] = columns[j];
+		if (dest_curr[j].num_children == 0)
+			Assert(dest_curr[j].children == NULL);
+		else
+		{
+			dest_curr[j].children = dest_next;
+			k = copyMetadataFieldCache(dest_next,
+									   dest_tail,
+									   columns[j].num_children,
+									   columns[j].children);
+			if (k < 0)
+				return -1;
+			dest_next += k;
+			nslots += k;
+		}
+	}
+	return nslots;
+}
+
+/*
+ * makeRecordBatchStateFromCache
+ *   - setup RecordBatchState from arrowMetadataCache
+ */
+static RecordBatchState *
+makeRecordBatchStateFromCache(arrowMetadataCache *mcache, File fdesc)
+{
+	RecordBatchState   *rbstate;
+
+	rbstate = palloc0(offsetof(RecordBatchState,
+							   columns[mcache->nfields]));
+	rbstate->fdesc = fdesc;
+	memcpy(&rbstate->stat_buf, &mcache->stat_buf, sizeof(struct stat));
+	rbstate->rb_index  = mcache->rb_index;
+	rbstate->rb_offset = mcache->rb_offset;
+	rbstate->rb_length = mcache->rb_length;
+	rbstate->rb_nitems = mcache->rb_nitems;
+	rbstate->rb_compression = mcache->rb_compression;
+	rbstate->ncols = mcache->ncols;
+	copyMetadataFieldCache(rbstate->columns,
+						   rbstate->columns + mcache->nfields,
+						   mcache->ncols,
+						   mcache->fstate);
+	return rbstate;
+}
+
+/*
+ * __arrowMetadataCacheLruVictim
+ *
+ * It picks up the LRU tail entry as a victim of reclaim. Entries referenced
+ * since the last visit get a second chance, and move to the LRU head again.
+ * Lookup path only sets lru_referenced flag, not to acquire lru_lock.
+ *
+ * NOTE: caller must have arrow_metadata_state->lru_lock
+ */
+static arrowMetadataCache *
+__arrowMetadataCacheLruVictim(void)
+{
+	arrowMetadataCache *mcache;
+	dlist_node *dnode;
+
+	for (;;)
+	{
+		if (dlist_is_empty(&arrow_metadata_state->lru_list))
+			return NULL;
+		dnode = dlist_tail_node(&arrow_metadata_state->lru_list);
+		mcache = dlist_container(arrowMetadataCache, lru_chain, dnode);
+		if (pg_atomic_exchange_u32(&mcache->lru_referenced, 0) == 0)
+			return mcache;
+		dlist_move_head(&arrow_metadata_state->lru_list, dnode);
+	}
+}
+
+/*
+ * arrowReclaimMetadataCache
+ */
+static void
+arrowReclaimMetadataCache(void)
+{
+	arrowMetadataCache *mcache;
+	LWLock	   *lock = NULL;
+	uint32		lru_hash;
+	uint32		lru_index;
+	uint64		consumed;
+
+	consumed = pg_atomic_read_u64(&arrow_metadata_state->consumed);
+	if (consumed <= arrow_metadata_cache_size)
+		return;
+
+	SpinLockAcquire(&arrow_metadata_state->lru_lock);
+	mcache = __arrowMetadataCacheLruVictim();
+	if (!mcache)
+	{
+		SpinLockRelease(&arrow_metadata_state->lru_lock);
+		return;
+	}
+	lru_hash = mcache->hash;
+	SpinLockRelease(&arrow_metadata_state->lru_lock);
+
+	do {
+		lru_index = lru_hash % ARROW_METADATA_HASH_NSLOTS;
+		lock = &arrow_metadata_state->lock_slots[lru_index];
+
+		LWLockAcquire(lock, LW_EXCLUSIVE);
+		SpinLockAcquire(&arrow_metadata_state->lru_lock);
+		mcache = __arrowMetadataCacheLruVictim();
+		if (!mcache)
+		{
+			SpinLockRelease(&arrow_metadata_state->lru_lock);
+			LWLockRelease(lock);
+			break;
+		}
+		if (mcache->hash == lru_hash)
+		{
+			dlist_delete(&mcache->lru_chain);
+			memset(&mcache->lru_chain, 0, sizeof(dlist_node));
+			SpinLockRelease(&arrow_metadata_state->lru_lock);
+			consumed = arrowInvalidateMetadataCache(mcache, false);
+		}
+		else
+		{
+			/* LRU-tail was referenced by someone, try again */
+			lru_hash = mcache->hash;
+            SpinLockRelease(&arrow_metadata_state->lru_lock);
+		}
+		LWLockRelease(lock);
+	} while (consumed > arrow_metadata_cache_size);
+}
+
+/*
+ * __arrowBuildMetadataCache
+ *
+ * NOTE: caller must have exclusive lock on arrow_metadata_state->lock_slots[]
+ */
+static arrowMetadataCache *
+__arrowBuildMetadataCache(List *rb_state_list, uint32 hash)
+{
+	arrowMetadataCache *mcache = NULL;
+	arrowMetadataCache *mtemp;
+	dlist_node *dnode;
+	Size		sz, consumed = 0;
+	int			nfields;
+	ListCell   *lc;
+
+	foreach (lc, rb_state_list)
+	{
+		RecordBatchState *rbstate = lfirst(lc);
+
+		if (!mcache)
+			nfields = RecordBatchFieldCount(rbstate);
+		else
+			Assert(nfields == RecordBatchFieldCount(rbstate));
+
+		sz = offsetof(arrowMetadataCache, fstate[nfields]);
+		mtemp = MemoryContextAllocZero(TopSharedMemoryContext, sz);
+		if (!mtemp)
+		{
+			/* !!out of memory!! */
+			if (mcache)
+			{
+				while (!dlist_is_empty(&mcache->siblings))
+				{
+					dnode = dlist_pop_head_node(&mcache->siblings);
+					mtemp = dlist_container(arrowMetadataCache,
+											chain, dnode);
+					pfree(mtemp);
+				}
+				pfree(mcache);
+			}
+			return NULL;
+		}
+
+		dlist_init(&mtemp->siblings);
+		pg_atomic_init_u32(&mtemp->lru_referenced, 0);
+		memcpy(&mtemp->stat_buf, &rbstate->stat_buf, sizeof(struct stat));
+		mtemp->hash      = hash;
+		mtemp->rb_index  = rbstate->rb_index;
+        mtemp->rb_offset = rbstate->rb_offset;
+        mtemp->rb_length = rbstate->rb_length;
+        mtemp->rb_nitems = rbstate->rb_nitems;
+		mtemp->rb_compression = rbstate->rb_compression;
+        mtemp->ncols     = rbstate->ncols;
+		mtemp->nfields   =
+			copyMetadataFieldCache(mtemp->fstate,
+								   mtemp->fstate + nfields,
+								   rbstate->ncols,
+								   rbstate->columns);
+		Assert(mtemp->nfields == nfields);
+
+		if (!mcache)
+			mcache = mtemp;
+		else
+			dlist_push_tail(&mcache->siblings, &mtemp->chain);
+		consumed += MAXALIGN(sz);
+	}
+	pg_atomic_add_fetch_u64(&arrow_metadata_state->consumed, consumed);
+
+	return mcache;
+}
+
+
+/*
+ * checkArrowRecordBatchIsVisible
+ *
+ * NOTE: It must be called under shared lock on lock_slots[]
+ */
+static bool
+checkArrowRecordBatchIsVisible(RecordBatchState *rbstate,
+							   dlist_head *mvcc_slot)
+{
+	dlist_iter		iter;
+
+	dlist_foreach(iter, mvcc_slot)
+	{
+		arrowWriteMVCCLog  *mvcc = dlist_container(arrowWriteMVCCLog,
+												   chain, iter.cur);
+		if (mvcc->key.st_dev == rbstate->stat_buf.st_dev &&
+			mvcc->key.st_ino == rbstate->stat_buf.st_ino &&
+			mvcc->record_batch == rbstate->rb_index)
+		{
+			if (TransactionIdIsCurrentTransactionId(mvcc->xid))
+				return true;
 			else
-			{
-				/* unknown */
-				type_is_ok = false;
-			}
-			ReleaseSysCache(tup);
-			if (!type_is_ok)
 				return false;
 		}
 	}
 	return true;
 }
 
-static bool
-arrowSchemaCompatibilityCheck(TupleDesc tupdesc, RecordBatchState *rb_state)
-{
-	if (tupdesc->natts != rb_state->ncols)
-		return false;
-	return __arrowSchemaCompatibilityCheck(tupdesc, rb_state->columns);
-}
-
 /*
- * pg_XXX_arrow_ref
+ * Persistent metadata cache
+ *
+ * If arrow_fdw.metadata_cache_dir is configured, metadata of the arrow files
+ * are also saved in the directory, one file per arrow file named by its
+ * device and inode number. It allows to skip parsing of the arrow files
+ * after restart of the server. A saved entry is used only if stat(2) of the
+ * arrow file is identical to the one at the time when it was saved.
  */
-static Datum
-pg_varlena_arrow_ref(kern_data_store *kds,
-					 kern_colmeta *cmeta, size_t index)
-{
-	cl_uint	   *offset = (cl_uint *)
-		((char *)kds + __kds_unpack(cmeta->values_offset));
-	char	   *extra = (char *)kds + __kds_unpack(cmeta->extra_offset);
-	size_t		extra_len = __kds_unpack(cmeta->extra_length);
-	cl_uint		len = offset[index+1] - offset[index];
-	struct varlena *res;
-
-	if (offset[index] > offset[index + 1] || offset[index+1] > extra_len)
-		elog(ERROR, "corrupted arrow file? offset points out of extra buffer");
-
-	res = palloc(VARHDRSZ + len);
-	SET_VARSIZE(res, VARHDRSZ + len);
-	memcpy(VARDATA(res), extra + offset[index], len);
-
-	return PointerGetDatum(res);
-}
+#define ARROW_METADATA_PCACHE_MAGIC		0x434d4641	/* "AFMC" */
 
-static Datum
-pg_bpchar_arrow_ref(kern_data_store *kds,
-					kern_colmeta *cmeta, size_t index)
-{
-	cl_char	   *values = ((char *)kds + __kds_unpack(cmeta->values_offset));
-	cl_int		unitsz = cmeta->atttypmod - VARHDRSZ;
-	struct varlena *res;
-
-	if (unitsz <= 0)
-		elog(ERROR, "CHAR(%d) is not expected", unitsz);
-	res = palloc(VARHDRSZ + unitsz);
-	memcpy((char *)res + VARHDRSZ, values + unitsz * index, unitsz);
-	SET_VARSIZE(res, VARHDRSZ + unitsz);
-
-	return PointerGetDatum(res);
-}
-
-static Datum
-pg_bool_arrow_ref(kern_data_store *kds,
-				  kern_colmeta *cmeta, size_t index)
-{
-	char   *bitmap = (char *)kds + __kds_unpack(cmeta->values_offset);
-
-	return BoolGetDatum(att_isnull(index, bitmap));
-}
-
-static Datum
-pg_int2_arrow_ref(kern_data_store *kds,
-				  kern_colmeta *cmeta, size_t index)
+typedef struct
 {
-	cl_short   *values = (cl_short *)
-		((char *)kds + __kds_unpack(cmeta->values_offset));
-	return values[index];
-}
+	uint32		magic;
+	uint32		version;
+	uint32		rbstate_sz;	/* sizeof(RecordBatchState) */
+	uint32		fstate_sz;	/* sizeof(RecordBatchFieldState) */
+	uint32		nbatches;
+	dev_t		st_dev;
+	ino_t		st_ino;
+	off_t		st_size;
+	struct timespec st_mtim;
+	struct timespec st_ctim;
+} arrowMetadataPCacheHead;
 
-static Datum
-pg_int4_arrow_ref(kern_data_store *kds,
-				  kern_colmeta *cmeta, size_t index)
+typedef struct
 {
-	cl_int	   *values = (cl_int *)
-		((char *)kds + __kds_unpack(cmeta->values_offset));
-	return values[index];
-}
+	int			rb_index;
+	int			rb_compression;
+	off_t		rb_offset;
+	size_t		rb_length;
+	int64		rb_nitems;
+	int			ncols;
+	int			nfields;
+	/*
+	 * NOTE: @children of fstate[] is saved as an index of the fstate[]
+	 * array, instead of the pointer.
+	 */
+	RecordBatchFieldState fstate[FLEXIBLE_ARRAY_MEMBER];
+} arrowMetadataPCacheItem;
 
-static Datum
-pg_int8_arrow_ref(kern_data_store *kds,
-				  kern_colmeta *cmeta, size_t index)
+static char *
+__arrowMetadataPCachePath(struct stat *stat_buf)
 {
-	cl_long	   *values = (cl_long *)
-		((char *)kds + __kds_unpack(cmeta->values_offset));
-	return values[index];
+	return psprintf("%s/%lu.%lu.mcache",
+					arrow_metadata_cache_dir,
+					(unsigned long)stat_buf->st_dev,
+					(unsigned long)stat_buf->st_ino);
 }
 
-static Datum
-pg_numeric_arrow_ref(kern_data_store *kds,
-					 kern_colmeta *cmeta, size_t index)
+static void
+arrowSaveMetadataPCache(struct stat *stat_buf, List *rb_state_list)
 {
-	char	   *result = palloc0(sizeof(struct NumericData));
-	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
-	int			dscale = cmeta->attopts.decimal.scale;
-	Int128_t	decimal;
-
-	decimal.ival = ((int128 *)base)[index];
+	arrowMetadataPCacheHead head;
+	char	   *path;
+	char	   *temp;
+	int			fdesc;
+	bool		is_ok = true;
+	ListCell   *lc;
 
-	while (dscale > 0 && decimal.ival % 10 == 0)
+	if (!arrow_metadata_cache_dir || *arrow_metadata_cache_dir == '\0')
+		return;
+	path = __arrowMetadataPCachePath(stat_buf);
+	temp = psprintf("%s.%d.tmp", path, MyProcPid);
+	fdesc = open(temp, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY, 0600);
+	if (fdesc < 0)
 	{
-		decimal.ival /= 10;
-		dscale--;
+		elog(LOG, "arrow_fdw: could not create \"%s\": %m", temp);
+		return;
 	}
-	pg_numeric_to_varlena(result, dscale, decimal);
+	memset(&head, 0, sizeof(arrowMetadataPCacheHead));
+	head.magic     = ARROW_METADATA_PCACHE_MAGIC;
+	head.version   = ARROW_METADATA_PCACHE_VERSION;
+	head.rbstate_sz = sizeof(RecordBatchState);
+	head.fstate_sz = sizeof(RecordBatchFieldState);
+	head.nbatches  = list_length(rb_state_list);
+	head.st_dev    = stat_buf->st_dev;
+	head.st_ino    = stat_buf->st_ino;
+	head.st_size   = stat_buf->st_size;
+	head.st_mtim   = stat_buf->st_mtim;
+	head.st_ctim   = stat_buf->st_ctim;
+	if (__writeFile(fdesc, &head, sizeof(head)) != sizeof(head))
+		is_ok = false;
 
-	return PointerGetDatum(result);
-}
+	foreach (lc, rb_state_list)
+	{
+		RecordBatchState *rbstate = lfirst(lc);
+		arrowMetadataPCacheItem *item;
+		int			j, nfields = RecordBatchFieldCount(rbstate);
+		size_t		sz = offsetof(arrowMetadataPCacheItem, fstate[nfields]);
 
-static Datum
-pg_date_arrow_ref(kern_data_store *kds,
-				  kern_colmeta *cmeta, size_t index)
-{
-	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
-	DateADT		dt;
+		if (!is_ok)
+			break;
+		item = palloc0(sz);
+		item->rb_index  = rbstate->rb_index;
+		item->rb_compression = rbstate->rb_compression;
+		item->rb_offset = rbstate->rb_offset;
+		item->rb_length = rbstate->rb_length;
+		item->rb_nitems = rbstate->rb_nitems;
+		item->ncols     = rbstate->ncols;
+		item->nfields   = copyMetadataFieldCache(item->fstate,
+												 item->fstate + nfields,
+												 rbstate->ncols,
+												 rbstate->columns);
+		Assert(item->nfields == nfields);
+		for (j=0; j < nfields; j++)
+		{
+			RecordBatchFieldState *fstate = &item->fstate[j];
 
-	switch (cmeta->attopts.date.unit)
+			if (fstate->children)
+				fstate->children = (RecordBatchFieldState *)
+					(uintptr_t)(fstate->children - item->fstate);
+		}
+		if (__writeFile(fdesc, item, sz) != sz)
+			is_ok = false;
+		pfree(item);
+	}
+	if (close(fdesc) != 0)
+		is_ok = false;
+	if (!is_ok || rename(temp, path) != 0)
 	{
-		case ArrowDateUnit__Day:
-			dt = ((cl_uint *)base)[index];
-			break;
-		case ArrowDateUnit__MilliSecond:
-			dt = ((cl_ulong *)base)[index] / 1000;
-			break;
-		default:
-			elog(ERROR, "Bug? unexpected unit of Date type");
+		elog(LOG, "arrow_fdw: could not write metadata cache \"%s\": %m",
+			 path);
+		unlink(temp);
 	}
-	/* convert UNIX epoch to PostgreSQL epoch */
-	dt -= (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE);
-	return DateADTGetDatum(dt);
+	pfree(temp);
+	pfree(path);
 }
 
-static Datum
-pg_time_arrow_ref(kern_data_store *kds,
-				  kern_colmeta *cmeta, size_t index)
+static bool
+arrowLoadMetadataPCache(File filp, struct stat *stat_buf,
+						List **p_rb_state_list)
 {
-	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
-	TimeADT		tm;
+	arrowMetadataPCacheHead head;
+	List	   *rb_state_list = NIL;
+	char	   *path;
+	int			fdesc;
+	uint32		i;
 
-	switch (cmeta->attopts.time.unit)
+	if (!arrow_metadata_cache_dir || *arrow_metadata_cache_dir == '\0')
+		return false;
+	path = __arrowMetadataPCachePath(stat_buf);
+	fdesc = open(path, O_RDONLY | PG_BINARY);
+	if (fdesc < 0)
 	{
-		case ArrowTimeUnit__Second:
-			tm = ((cl_long)((cl_int *)base)[index]) * 1000000L;
-			break;
-		case ArrowTimeUnit__MilliSecond:
-			tm = ((cl_long)((cl_int *)base)[index]) * 1000L;
-			break;
-		case ArrowTimeUnit__MicroSecond:
-			tm = ((cl_long *)base)[index];
-			break;
-		case ArrowTimeUnit__NanoSecond:
-			tm = ((cl_ulong *)base)[index] / 1000L;
-			break;
-		default:
-			elog(ERROR, "Bug? unexpected unit of Time type");
+		if (errno != ENOENT)
+			elog(LOG, "arrow_fdw: could not open \"%s\": %m", path);
+		pfree(path);
+		return false;
 	}
-	return TimeADTGetDatum(tm);
-}
-
-static Datum
-pg_timestamp_arrow_ref(kern_data_store *kds,
-					   kern_colmeta *cmeta, size_t index)
-{
-	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
-	cl_long		tz_offset = cmeta->attopts.timestamp.tz_offset;
-	Timestamp	ts;
-
-	switch (cmeta->attopts.timestamp.unit)
+	if (__readFile(fdesc, &head, sizeof(head)) != sizeof(head) ||
+		head.magic     != ARROW_METADATA_PCACHE_MAGIC ||
+		head.version   != ARROW_METADATA_PCACHE_VERSION ||
+		head.rbstate_sz != sizeof(RecordBatchState) ||
+		head.fstate_sz != sizeof(RecordBatchFieldState) ||
+		head.st_dev    != stat_buf->st_dev ||
+		head.st_ino    != stat_buf->st_ino ||
+		head.st_size   != stat_buf->st_size ||
+		timespec_comp(&head.st_mtim, &stat_buf->st_mtim) != 0 ||
+		timespec_comp(&head.st_ctim, &stat_buf->st_ctim) != 0)
+		goto bailout;
+
+	for (i=0; i < head.nbatches; i++)
 	{
-		case ArrowTimeUnit__Second:
-			ts = ((cl_ulong *)base)[index] * 1000000UL;
-			if (tz_offset != 0)
-				ts += tz_offset;
-			break;
-		case ArrowTimeUnit__MilliSecond:
-			ts = ((cl_ulong *)base)[index] * 1000UL;
-			if (tz_offset != 0)
-				ts += tz_offset * 1000UL;
-			break;
-		case ArrowTimeUnit__MicroSecond:
-			ts = ((cl_ulong *)base)[index];
-			if (tz_offset != 0)
-				ts += tz_offset * 1000000UL;
-			break;
-		case ArrowTimeUnit__NanoSecond:
-			ts = ((cl_ulong *)base)[index] / 1000UL;
-			if (tz_offset != 0)
-				ts += tz_offset * 1000000000UL;
-			break;
-		default:
-			elog(ERROR, "Bug? unexpected unit of Timestamp type");
+		arrowMetadataPCacheItem item;
+		RecordBatchState *rbstate;
+		size_t		sz = offsetof(arrowMetadataPCacheItem, fstate);
+		int			j;
+
+		if (__readFile(fdesc, &item, sz) != sz ||
+			item.ncols <= 0 || item.nfields < item.ncols)
+			goto bailout;
+		rbstate = palloc0(offsetof(RecordBatchState,
+								   columns[item.nfields]));
+		rbstate->fdesc     = filp;
+		memcpy(&rbstate->stat_buf, stat_buf, sizeof(struct stat));
+		rbstate->rb_index  = item.rb_index;
+		rbstate->rb_offset = item.rb_offset;
+		rbstate->rb_length = item.rb_length;
+		rbstate->rb_nitems = item.rb_nitems;
+		rbstate->rb_compression = item.rb_compression;
+		rbstate->ncols     = item.ncols;
+		sz = sizeof(RecordBatchFieldState) * item.nfields;
+		if (__readFile(fdesc, rbstate->columns, sz) != sz)
+			goto bailout;
+		for (j=0; j < item.nfields; j++)
+		{
+			RecordBatchFieldState *fstate = &rbstate->columns[j];
+			uintptr_t	k = (uintptr_t)fstate->children;
+
+			if (fstate->num_children == 0)
+				fstate->children = NULL;
+			else if (k < (uintptr_t)item.ncols ||
+					 k + fstate->num_children > (uintptr_t)item.nfields)
+				goto bailout;
+			else
+				fstate->children = rbstate->columns + k;
+		}
+		rb_state_list = lappend(rb_state_list, rbstate);
 	}
-	/* convert UNIX epoch to PostgreSQL epoch */
-	ts -= (POSTGRES_EPOCH_JDATE -
-		   UNIX_EPOCH_JDATE) * USECS_PER_DAY;
-	return TimestampGetDatum(ts);
+	close(fdesc);
+	pfree(path);
+	*p_rb_state_list = rb_state_list;
+	return true;
+
+bailout:
+	elog(DEBUG1, "arrow_fdw: metadata cache \"%s\" is not valid", path);
+	close(fdesc);
+	pfree(path);
+	list_free_deep(rb_state_list);
+	return false;
 }
 
-static Datum
-pg_interval_arrow_ref(kern_data_store *kds,
-					  kern_colmeta *cmeta, size_t index)
+/*
+ * arrowStatFileCached
+ *
+ * It returns fstat(2) of the arrow file. If arrow_fdw.metadata_stat_ttl is
+ * configured, the result is kept per backend and reused within the TTL,
+ * as long as no arrow files are written in this instance.
+ */
+typedef struct
 {
-	char	   *base = (char *)kds + __kds_unpack(cmeta->values_offset);
-	Interval   *iv = palloc0(sizeof(Interval));
+	char		pathname[MAXPGPATH];	/* hash key */
+	struct stat	stat_buf;
+	TimestampTz	validated;
+	uint64		generation;
+} arrowStatCacheEntry;
 
-	switch (cmeta->attopts.interval.unit)
-	{
-		case ArrowIntervalUnit__Year_Month:
-			/* 32bit: number of months */
-			iv->month = ((cl_uint *)base)[index];
-			break;
-		case ArrowIntervalUnit__Day_Time:
-			/* 32bit+32bit: number of days and milliseconds */
-			iv->day = (int32)(((cl_uint *)base)[2 * index]);
-			iv->time = (TimeOffset)(((cl_uint *)base)[2 * index + 1]) * 1000;
-			break;
-		default:
-			elog(ERROR, "Bug? unexpected unit of Interval type");
-	}
-	return PointerGetDatum(iv);
-}
+static HTAB	   *arrow_stat_cache_htab = NULL;
 
-static Datum
-pg_array_arrow_ref(kern_data_store *kds,
-				   kern_colmeta *smeta,
-				   cl_uint start, cl_uint end)
+static void
+arrowStatFileCached(File fdesc, struct stat *stat_buf)
 {
-	ArrayType  *res;
-	size_t		sz;
-	cl_uint		i, nitems = end - start;
-	cl_uint	   *offset;
-	bits8	   *nullmap = NULL;
-	char	   *base;
-	size_t		usage;
-
-	/* allocation of the result buffer */
-	if (smeta->nullmap_offset != 0)
-		sz = ARR_OVERHEAD_WITHNULLS(1, nitems);
-	else
-		sz = ARR_OVERHEAD_NONULLS(1);
+	const char *pathname = FilePathName(fdesc);
+	arrowStatCacheEntry *entry = NULL;
+	TimestampTz	now = 0;
+	uint64		generation = 0;
+	bool		found;
 
-	if (smeta->attlen > 0)
+	if (arrow_metadata_stat_ttl > 0 && strlen(pathname) < MAXPGPATH)
+	{
+		if (!arrow_stat_cache_htab)
+		{
+			HASHCTL		hctl;
+
+			memset(&hctl, 0, sizeof(HASHCTL));
+			hctl.keysize = MAXPGPATH;
+			hctl.entrysize = sizeof(arrowStatCacheEntry);
+			hctl.hcxt = CacheMemoryContext;
+			arrow_stat_cache_htab = hash_create("arrow_fdw stat cache", 256,
+												&hctl,
+												HASH_ELEM | HASH_CONTEXT);
+		}
+		now = GetCurrentTimestamp();
+		generation = pg_atomic_read_u64(&arrow_metadata_state->write_generation);
+		entry = hash_search(arrow_stat_cache_htab, pathname,
+							HASH_ENTER, &found);
+		if (found &&
+			entry->generation == generation &&
+			!TimestampDifferenceExceeds(entry->validated, now,
+										arrow_metadata_stat_ttl))
+		{
+			memcpy(stat_buf, &entry->stat_buf, sizeof(struct stat));
+			return;
+		}
+	}
+	if (fstat(FileGetRawDesc(fdesc), stat_buf) != 0)
 	{
-		sz += TYPEALIGN(smeta->attalign,
-						smeta->attlen) * nitems;
+		if (entry)
+			hash_search(arrow_stat_cache_htab, pathname, HASH_REMOVE, NULL);
+		elog(ERROR, "failed on fstat('%s'): %m", pathname);
 	}
-	else if (smeta->attlen == -1)
+	if (entry)
 	{
-		if (smeta->values_offset == 0)
-			elog(ERROR, "Bug? corrupted kernel column metadata");
-		offset = (cl_uint *)((char *)kds + __kds_unpack(smeta->values_offset));
-		sz += (MAXALIGN(VARHDRSZ * nitems) +		/* space for varlena */
-			   MAXALIGN(sizeof(cl_uint) * nitems) +	/* space for alignment */
-			   offset[end] - offset[start]);
+		memcpy(&entry->stat_buf, stat_buf, sizeof(struct stat));
+		entry->validated = now;
+		entry->generation = generation;
 	}
-	else
-		elog(ERROR, "Bug? corrupted kernel column metadata");
+}
 
-	res = palloc0(sz);
-	res->ndim = 1;
-	if (smeta->nullmap_offset != 0)
+/*
+ * arrowLookupOrBuildMetadataCache
+ */
+List *
+arrowLookupOrBuildMetadataCache(File fdesc)
+{
+	MetadataCacheKey key;
+	struct stat	stat_buf;
+	uint32		index;
+	LWLock	   *lock;
+	dlist_head *hash_slot;
+	dlist_head *mvcc_slot;
+	dlist_iter	iter1, iter2;
+	bool		has_exclusive = false;
+	List	   *results = NIL;
+
+	arrowStatFileCached(fdesc, &stat_buf);
+
+	memset(&key, 0, sizeof(key));
+	key.st_dev	= stat_buf.st_dev;
+	key.st_ino	= stat_buf.st_ino;
+	key.hash = hash_any((unsigned char *)&key,
+						offsetof(MetadataCacheKey, hash));
+	index = key.hash % ARROW_METADATA_HASH_NSLOTS;
+	lock = &arrow_metadata_state->lock_slots[index];
+	hash_slot = &arrow_metadata_state->hash_slots[index];
+	mvcc_slot = &arrow_metadata_state->mvcc_slots[index];
+
+	LWLockAcquire(lock, LW_SHARED);
+retry:
+	dlist_foreach(iter1, hash_slot)
 	{
-		res->dataoffset = ARR_OVERHEAD_WITHNULLS(1, nitems);
-		nullmap = ARR_NULLBITMAP(res);
+		arrowMetadataCache *mcache
+			= dlist_container(arrowMetadataCache, chain, iter1.cur);
+		if (mcache->stat_buf.st_dev == stat_buf.st_dev &&
+			mcache->stat_buf.st_ino == stat_buf.st_ino)
+		{
+			RecordBatchState *rbstate;
+			
+			Assert(mcache->hash == key.hash);
+			if (timespec_comp(&mcache->stat_buf.st_mtim,
+							  &stat_buf.st_mtim) < 0 ||
+				timespec_comp(&mcache->stat_buf.st_ctim,
+							  &stat_buf.st_ctim) < 0)
+			{
+				char	buf1[80], buf2[80], buf3[80], buf4[80];
+				char   *tail;
+
+				if (!has_exclusive)
+				{
+					LWLockRelease(lock);
+					LWLockAcquire(lock, LW_EXCLUSIVE);
+					has_exclusive = true;
+					goto retry;
+				}
+				ctime_r(&mcache->stat_buf.st_mtime, buf1);
+				ctime_r(&mcache->stat_buf.st_ctime, buf2);
+				ctime_r(&stat_buf.st_mtime, buf3);
+				ctime_r(&stat_buf.st_ctime, buf4);
+				for (tail=buf1+strlen(buf1)-1; isspace(*tail); *tail--='\0');
+				for (tail=buf2+strlen(buf2)-1; isspace(*tail); *tail--='\0');
+				for (tail=buf3+strlen(buf3)-1; isspace(*tail); *tail--='\0');
+				for (tail=buf4+strlen(buf4)-1; isspace(*tail); *tail--='\0');
+				elog(DEBUG2, "arrow_fdw: metadata cache for '%s' (m:%s, c:%s) is older than the latest file (m:%s, c:%s), so invalidated",
+					 FilePathName(fdesc), buf1, buf2, buf3, buf4);
+				arrowInvalidateMetadataCache(mcache, true);
+				break;
+			}
+			/*
+			 * Ok, arrow file metadata cache found and still valid
+			 */
+			rbstate = makeRecordBatchStateFromCache(mcache, fdesc);
+			if (checkArrowRecordBatchIsVisible(rbstate, mvcc_slot))
+				results = list_make1(rbstate);
+			dlist_foreach (iter2, &mcache->siblings)
+			{
+				arrowMetadataCache *__mcache
+					= dlist_container(arrowMetadataCache, chain, iter2.cur);
+				rbstate = makeRecordBatchStateFromCache(__mcache, fdesc);
+				if (checkArrowRecordBatchIsVisible(rbstate, mvcc_slot))
+					results = lappend(results, rbstate);
+			}
+			/* LRU position shall be updated on reclaim, not here */
+			if (pg_atomic_read_u32(&mcache->lru_referenced) == 0)
+				pg_atomic_write_u32(&mcache->lru_referenced, 1);
+			LWLockRelease(lock);
+
+			return results;
+		}
 	}
-	res->elemtype = smeta->atttypid;
-	ARR_DIMS(res)[0] = nitems;
-	ARR_LBOUND(res)[0] = 1;
 
-	base = ARR_DATA_PTR(res);
-	usage = 0;
-	for (i=0; i < nitems; i++)
+	/*
+	 * Hmm... no valid metadata cache was not found, so build a new entry
+	 * under the exclusive lock on the arrow file.
+	 */
+	if (!has_exclusive)
 	{
-		Datum	datum;
-		bool	isnull;
+		LWLockRelease(lock);
+		LWLockAcquire(lock, LW_EXCLUSIVE);
+		has_exclusive = true;
+		goto retry;
+	}
+	else
+	{
+		arrowMetadataCache *mcache;
+		List		   *rb_state_any = NIL;
+		ListCell	   *lc;
 
-		pg_datum_arrow_ref(kds, smeta, start+i, &datum, &isnull);
-		if (isnull)
+		/* try to load the persistent metadata cache, if any */
+		if (!arrowLoadMetadataPCache(fdesc, &stat_buf, &rb_state_any))
 		{
-			if (!nullmap)
-				elog(ERROR, "Bug? element item should not be NULL");
+			ArrowFileInfo	af_info;
+
+			readArrowFileDesc(FileGetRawDesc(fdesc), &af_info);
+
+			if (af_info.recordBatches == NULL && af_info.rowGroups == NULL)
+				elog(DEBUG2, "arrow file '%s' contains no RecordBatch",
+					 FilePathName(fdesc));
+			for (index = 0; index < af_info.footer._num_recordBatches; index++)
+			{
+				RecordBatchState *rb_state;
+				ArrowBlock       *block
+					= &af_info.footer.recordBatches[index];
+				ArrowRecordBatch *rbatch
+					= &af_info.recordBatches[index].body.recordBatch;
+
+				rb_state = makeRecordBatchState(&af_info.footer.schema,
+												block, rbatch, &af_info);
+				rb_state->fdesc = fdesc;
+				memcpy(&rb_state->stat_buf, &stat_buf, sizeof(struct stat));
+				rb_state->rb_index = index;
+				rb_state_any = lappend(rb_state_any, rb_state);
+			}
+			/* each row group of Parquet file is mapped on a RecordBatch */
+			for (index = 0; index < af_info._num_rowGroups; index++)
+			{
+				RecordBatchState *rb_state;
+
+				rb_state = makeParquetRowGroupState(&af_info.footer.schema,
+													&af_info.rowGroups[index],
+													fdesc);
+				rb_state->fdesc = fdesc;
+				memcpy(&rb_state->stat_buf, &stat_buf, sizeof(struct stat));
+				rb_state->rb_index = index;
+				rb_state_any = lappend(rb_state_any, rb_state);
+			}
+			/* min/max statistics for RecordBatch pruning, if any */
+			setupRecordBatchStats(rb_state_any, &af_info.footer.schema);
+			/* save the metadata for restart, if configured */
+			arrowSaveMetadataPCache(&stat_buf, rb_state_any);
 		}
-		else if (smeta->attlen > 0)
+
+		foreach (lc, rb_state_any)
 		{
-			if (nullmap)
-				nullmap[i>>3] |= (1<<(i&7));
-			usage = TYPEALIGN(smeta->attalign, usage);
-			memcpy(base + usage, &datum, smeta->attlen);
-			usage += smeta->attlen;
+			RecordBatchState *rb_state = lfirst(lc);
+
+			if (checkArrowRecordBatchIsVisible(rb_state, mvcc_slot))
+				results = lappend(results, rb_state);
 		}
-		else if (smeta->attlen == -1)
+		/* try to build a metadata cache for further references */
+		mcache = __arrowBuildMetadataCache(rb_state_any, key.hash);
+		if (mcache)
 		{
-			cl_int		vl_len = VARSIZE(datum);
-
-			if (nullmap)
-				nullmap[i>>3] |= (1<<(i&7));
-			usage = TYPEALIGN(smeta->attalign, usage);
-			memcpy(base + usage, DatumGetPointer(datum), vl_len);
-			usage += vl_len;
-
-			pfree(DatumGetPointer(datum));
+			dlist_push_head(hash_slot, &mcache->chain);
+			SpinLockAcquire(&arrow_metadata_state->lru_lock);
+            dlist_push_head(&arrow_metadata_state->lru_list,
+							&mcache->lru_chain);
+			SpinLockRelease(&arrow_metadata_state->lru_lock);
 		}
-		else
-			elog(ERROR, "Bug? corrupted kernel column metadata");
 	}
-	SET_VARSIZE(res, (base + usage) - (char *)res);
+	LWLockRelease(lock);
+	/*
+	 * reclaim unreferenced metadata cache entries based on LRU, if shared-
+	 * memory consumption exceeds the configured threshold.
+	 */
+	arrowReclaimMetadataCache();
 
-	return PointerGetDatum(res);
+	return results;
 }
 
 /*
- * pg_datum_arrow_ref
+ * setupArrowSQLbufferSchema
  */
 static void
-pg_datum_arrow_ref(kern_data_store *kds,
-				   kern_colmeta *cmeta,
-				   size_t index,
-				   Datum *p_datum,
-				   bool *p_isnull)
+__setupArrowSQLbufferField(SQLtable *table,
+						   SQLfield *column,
+						   const char *attname,
+						   Oid atttypid,
+						   int atttypmod)
 {
-	Datum		datum = 0;
-	bool		isnull = true;
-
-	if (cmeta->nullmap_offset != 0)
-	{
-		size_t	nullmap_offset = __kds_unpack(cmeta->nullmap_offset);
-		uint8  *nullmap = (uint8 *)kds + nullmap_offset;
+	HeapTuple		tup;
+	Form_pg_type	typ;
+	const char	   *typnamespace;
+	const char	   *tz = show_timezone();
 
-		if (att_isnull(index, nullmap))
-			goto out;
-	}
+	tup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(atttypid));
+	if (!HeapTupleIsValid(tup))
+		elog(ERROR, "cache lookup failed for type: %u", atttypid);
+	typ = (Form_pg_type) GETSTRUCT(tup);
+	typnamespace = get_namespace_name(typ->typnamespace);
 
-	if (cmeta->atttypkind == TYPE_KIND__ARRAY)
+	table->numFieldNodes++;
+    table->numBuffers +=
+		assignArrowTypePgSQL(column,
+							 attname,
+							 atttypid,
+							 atttypmod,
+							 NameStr(typ->typname),
+							 typnamespace,
+							 typ->typlen,
+							 typ->typbyval,
+							 typ->typtype,
+							 typ->typalign,
+							 typ->typrelid,
+							 typ->typelem,
+							 tz,
+							 getTimezoneOffset(tz) * -1000000L);	/* [us]*/
+	if (OidIsValid(typ->typelem))
 	{
-		kern_colmeta   *smeta;
-		cl_uint		   *offset;
+		/* array type */
+		char		elem_name[NAMEDATALEN+10];
 
-		if (cmeta->num_subattrs != 1 ||
-			cmeta->idx_subattrs < kds->ncols ||
-			cmeta->idx_subattrs >= kds->nr_colmeta)
-			elog(ERROR, "Bug? corrupted kernel column metadata");
-		smeta = &kds->colmeta[cmeta->idx_subattrs];
-		if (cmeta->values_offset == 0)
-			goto out;		/* not loaded? always NULL */
-		offset = (cl_uint *)((char *)kds + __kds_unpack(cmeta->values_offset));
-		datum = pg_array_arrow_ref(kds, smeta,
-								   offset[index],
-								   offset[index+1]);
-		isnull = false;
+		snprintf(elem_name, sizeof(elem_name), "_%s[]", attname);
+		column->element = palloc0(sizeof(SQLfield));
+		__setupArrowSQLbufferField(table,
+								   column->element,
+								   elem_name,
+								   typ->typelem,
+								   -1);
 	}
-	else if (cmeta->atttypkind == TYPE_KIND__COMPOSITE)
+	else if (OidIsValid(typ->typrelid))
 	{
-		TupleDesc	tupdesc = lookup_rowtype_tupdesc(cmeta->atttypid, -1);
-		Datum	   *sub_values = alloca(sizeof(Datum) * tupdesc->natts);
-		bool	   *sub_isnull = alloca(sizeof(bool)  * tupdesc->natts);
-		HeapTuple	htup;
+		/* composite type */
+		TupleDesc	tupdesc = lookup_rowtype_tupdesc(atttypid, atttypmod);
 		int			j;
 
-		if (tupdesc->natts != cmeta->num_subattrs)
-			elog(ERROR, "Struct definition is conrrupted?");
-		if (cmeta->idx_subattrs < kds->ncols ||
-			cmeta->idx_subattrs + cmeta->num_subattrs > kds->nr_colmeta)
-			elog(ERROR, "Bug? strange kernel column metadata");
-
+		column->nfields = tupdesc->natts;
+		column->subfields = palloc0(sizeof(SQLfield) * tupdesc->natts);
 		for (j=0; j < tupdesc->natts; j++)
 		{
-			kern_colmeta *sub_meta = &kds->colmeta[cmeta->idx_subattrs + j];
-
-			pg_datum_arrow_ref(kds, sub_meta, index,
-							   sub_values + j,
-							   sub_isnull + j);
+			Form_pg_attribute sattr = tupleDescAttr(tupdesc, j);
+			__setupArrowSQLbufferField(table,
+									   &column->subfields[j],
+									   NameStr(sattr->attname),
+									   sattr->atttypid,
+									   sattr->atttypmod);
 		}
-		htup = heap_form_tuple(tupdesc, sub_values, sub_isnull);
-
 		ReleaseTupleDesc(tupdesc);
-
-		datum = PointerGetDatum(htup->t_data);
-		isnull = false;
-	}
-	else if (cmeta->values_offset == 0)
-	{
-		/* not loaded, always null */
-		goto out;
 	}
-	else
+	else if (typ->typtype == 'e')
 	{
-		Assert(cmeta->atttypkind == TYPE_KIND__BASE);
-		switch (cmeta->atttypid)
-		{
-			case INT2OID:
-			case FLOAT2OID:
-				datum = pg_int2_arrow_ref(kds, cmeta, index);
-				break;
-			case INT4OID:
-			case FLOAT4OID:
-				datum = pg_int4_arrow_ref(kds, cmeta, index);
-				break;
-			case INT8OID:
-			case FLOAT8OID:
-				datum = pg_int8_arrow_ref(kds, cmeta, index);
-				break;
-			case TEXTOID:
-			case BYTEAOID:
-				datum = pg_varlena_arrow_ref(kds, cmeta, index);
-				break;
-			case BPCHAROID:
-				datum = pg_bpchar_arrow_ref(kds, cmeta, index);
-				break;
-			case BOOLOID:
-				datum = pg_bool_arrow_ref(kds, cmeta, index);
-				break;
-			case NUMERICOID:
-				datum = pg_numeric_arrow_ref(kds, cmeta, index);
-				break;
-			case DATEOID:
-				datum = pg_date_arrow_ref(kds, cmeta, index);
-				break;
-			case TIMEOID:
-				datum = pg_time_arrow_ref(kds, cmeta, index);
-				break;
-			case TIMESTAMPOID:
-			case TIMESTAMPTZOID:
-				datum = pg_timestamp_arrow_ref(kds, cmeta, index);
-				break;
-			case INTERVALOID:
-				datum = pg_interval_arrow_ref(kds, cmeta, index);
-				break;
-			default:
-				elog(ERROR, "Bug? unexpected datum type: %u",
-					 cmeta->atttypid);
-				break;
-		}
-		isnull = false;
+		elog(ERROR, "Enum type is not supported right now");
 	}
-out:
-	*p_datum  = datum;
-	*p_isnull = isnull;
+	ReleaseSysCache(tup);
 }
 
-/*
- * KDS_fetch_tuple_arrow
- */
-bool
-KDS_fetch_tuple_arrow(TupleTableSlot *slot,
-					  kern_data_store *kds,
-					  size_t index)
+static void
+setupArrowSQLbufferSchema(SQLtable *table, TupleDesc tupdesc)
 {
-	Datum  *values = slot->tts_values;
-	bool   *isnull = slot->tts_isnull;
 	int		j;
 
-	if (index >= kds->nitems)
-		return false;
-	ExecStoreAllNullTuple(slot);
-	for (j=0; j < kds->ncols; j++)
+	table->nfields = tupdesc->natts;
+	for (j=0; j < tupdesc->natts; j++)
 	{
-		kern_colmeta   *cmeta = &kds->colmeta[j];
-
-		pg_datum_arrow_ref(kds, cmeta,
-						   index,
-						   values + j,
-						   isnull + j);
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
+		__setupArrowSQLbufferField(table,
+								   &table->columns[j],
+								   NameStr(attr->attname),
+								   attr->atttypid,
+								   attr->atttypmod);
+		/* min/max statistics for RecordBatch pruning, if supported */
+		sql_field_enable_stat(&table->columns[j]);
 	}
-	return true;
+	table->segment_sz = (size_t)arrow_record_batch_size_kb << 10;
 }
 
-/*
- * arrowFdwExtractFilesList
- */
-static List *
-__arrowFdwExtractFilesList(List *options_list,
-						   int *p_parallel_nworkers,
-						   bool *p_writable)
+static void
+setupArrowSQLbufferBatches(SQLtable *table)
 {
-	ListCell   *lc;
-	List	   *filesList = NIL;
-	char	   *dir_path = NULL;
-	char	   *dir_suffix = NULL;
-	int			parallel_nworkers = -1;
-	bool		writable = false;	/* default: read-only */
+	ArrowFileInfo af_info;
+	struct stat	stat_buf;
+	MetadataCacheKey key;
+	uint32		index;
+	int			i, nitems;
+	loff_t		pos = 0;
 
-	foreach (lc, options_list)
-	{
-		DefElem	   *defel = lfirst(lc);
+	if (fstat(table->fdesc, &stat_buf) != 0)
+		elog(ERROR, "failed on fstat('%s'): %m", table->filename);
+	memset(&key, 0, sizeof(key));
+	key.st_dev = stat_buf.st_dev;
+	key.st_ino = stat_buf.st_ino;
+	key.hash = hash_any((unsigned char *)&key,
+						offsetof(MetadataCacheKey, hash));
+	index = key.hash % ARROW_METADATA_HASH_NSLOTS;
 
-		Assert(IsA(defel->arg, String));
-		if (strcmp(defel->defname, "file") == 0)
-		{
-			char   *temp = strVal(defel->arg);
-			filesList = lappend(filesList, makeString(pstrdup(temp)));
-		}
-		else if (strcmp(defel->defname, "files") == 0)
-		{
-			char   *temp = pstrdup(strVal(defel->arg));
-			char   *saveptr;
-			char   *tok, *pos;
+	LWLockAcquire(&arrow_metadata_state->lock_slots[index], LW_SHARED);
+	readArrowFileDesc(table->fdesc, &af_info);
+	LWLockRelease(&arrow_metadata_state->lock_slots[index]);
 
-			while ((tok = strtok_r(temp, ",", &saveptr)) != NULL)
-			{
-				while (isspace(*tok))
-					tok++;
-				pos = tok + strlen(tok) - 1;
-				while (pos >= tok && isspace(*pos))
-					*pos-- = '\0';
+	/* Apache Parquet file is read-only */
+	if (af_info.is_parquet)
+		elog(ERROR, "arrow_fdw: Apache Parquet file '%s' is not writable",
+			 table->filename);
 
-				filesList = lappend(filesList, makeString(pstrdup(tok)));
+	/* dictionary-encoded fields are not writable */
+	for (i=0; i < af_info.footer.schema._num_fields; i++)
+	{
+		ArrowField *field = &af_info.footer.schema.fields[i];
 
-				temp = NULL;
-			}
-		}
-		else if (strcmp(defel->defname, "dir") == 0)
-		{
-			dir_path = strVal(defel->arg);
-		}
-		else if (strcmp(defel->defname, "suffix") == 0)
-		{
-			dir_suffix = strVal(defel->arg);
-		}
-		else if (strcmp(defel->defname, "parallel_workers") == 0)
-		{
-			if (parallel_nworkers >= 0)
-				elog(ERROR, "'parallel_workers' appeared twice");
-			parallel_nworkers = pg_atoi(strVal(defel->arg), sizeof(int), '\0');
-		}
-		else if (strcmp(defel->defname, "writable") == 0)
-		{
-			writable = defGetBoolean(defel);
-		}
-		else
-			elog(ERROR, "arrow: unknown option (%s)", defel->defname);
+		if (field->dictionary.indexType.node.tag == ArrowNodeTag__Int)
+			elog(ERROR, "arrow_fdw: unable to write dictionary-encoded field '%s' on '%s'",
+				 field->name, table->filename);
 	}
-	if (dir_suffix && !dir_path)
-		elog(ERROR, "arrow: cannot use 'suffix' option without 'dir'");
 
-	if (writable)
+	/* restore min/max statistics of the RecordBatches already written */
+	for (i=0; i < table->nfields && i < af_info.footer.schema._num_fields; i++)
 	{
-		if (dir_path)
-			elog(ERROR, "arrow: 'dir_path' and 'writable' options are exclusive");
-		if (list_length(filesList) == 0)
-			elog(ERROR, "arrow: 'writable' needs a backend file specified by 'file' option");
-		if (list_length(filesList) > 1)
-			elog(ERROR, "arrow: 'writable' cannot use multiple backend files");
+		sql_field_restore_stat(&table->columns[i],
+							   &af_info.footer.schema.fields[i],
+							   af_info.footer._num_recordBatches);
 	}
 
-	if (dir_path)
+	/* restore DictionaryBatches already in the file */
+	nitems = af_info.footer._num_dictionaries;
+	table->numDictionaries = nitems;
+	if (nitems > 0)
 	{
-		struct dirent *dentry;
-		DIR	   *dir;
-		char   *temp;
-
-		dir = AllocateDir(dir_path);
-		while ((dentry = ReadDir(dir, dir_path)) != NULL)
+		table->dictionaries = palloc(sizeof(ArrowBlock) * nitems);
+		memcpy(table->dictionaries,
+			   af_info.footer.dictionaries,
+			   sizeof(ArrowBlock) * nitems);
+		for (i=0; i < nitems; i++)
 		{
-			if (strcmp(dentry->d_name, ".") == 0 ||
-				strcmp(dentry->d_name, "..") == 0)
-				continue;
-			if (dir_suffix)
-			{
-				int		dlen = strlen(dentry->d_name);
-				int		slen = strlen(dir_suffix);
-				int		diff;
+			ArrowBlock *block = &table->dictionaries[i];
 
-				if (dlen < 2 + slen)
-					continue;
-				diff = dlen - slen;
-				if (dentry->d_name[diff-1] != '.' ||
-					strcmp(dentry->d_name + diff, dir_suffix) != 0)
-					continue;
-			}
-			temp = psprintf("%s/%s", dir_path, dentry->d_name);
-			filesList = lappend(filesList, makeString(temp));
+			pos = Max(pos, ARROWALIGN(block->offset +
+									  block->metaDataLength +
+									  block->bodyLength));
 		}
-		FreeDir(dir);
 	}
+	else
+		table->dictionaries = NULL;
 
-	if (filesList == NIL)
-		elog(ERROR, "no files are configured on behalf of the arrow_fdw foreign table");
-	foreach (lc, filesList)
+	/* restore RecordBatches already in the file */
+	nitems = af_info.footer._num_recordBatches;
+	table->numRecordBatches = nitems;
+	if (nitems > 0)
 	{
-		const char *fname = strVal((Value *)lfirst(lc));
-
-		if (!writable)
-		{
-			if (access(fname, R_OK) != 0)
-				elog(ERROR, "unable to read '%s': %m", fname);
-		}
-		else
+		table->recordBatches = palloc(sizeof(ArrowBlock) * nitems);
+		memcpy(table->recordBatches,
+			   af_info.footer.recordBatches,
+			   sizeof(ArrowBlock) * nitems);
+		for (i=0; i < nitems; i++)
 		{
-			if (access(fname, R_OK | W_OK) != 0)
-			{
-				if (errno != ENOENT)
-					elog(ERROR, "unable to read/write '%s': %m", fname);
-				else
-				{
-					char   *temp = pstrdup(fname);
-					char   *dname = dirname(temp);
+			ArrowBlock *block = &table->recordBatches[i];
 
-					if (access(dname, R_OK | W_OK | X_OK) != 0)
-						elog(ERROR, "unable to create '%s': %m", fname);
-					pfree(temp);
-				}
-			}
+			pos = Max(pos, ARROWALIGN(block->offset +
+									  block->metaDataLength +
+									  block->bodyLength));
 		}
 	}
-	/* other properties */
-	if (p_parallel_nworkers)
-		*p_parallel_nworkers = parallel_nworkers;
-	if (p_writable)
-		*p_writable = writable;
-
-	return filesList;
-}
+	else
+		table->recordBatches = NULL;
 
-static List *
-arrowFdwExtractFilesList(List *options_list)
-{
-	return __arrowFdwExtractFilesList(options_list, NULL, NULL);
+	if (lseek(table->fdesc, pos, SEEK_SET) < 0)
+		elog(ERROR, "failed on lseek('%s',%lu): %m",
+			 table->filename, pos);
 }
 
-
 /*
- * validator of Arrow_Fdw
+ * createArrowWriteState
  */
-Datum
-pgstrom_arrow_fdw_validator(PG_FUNCTION_ARGS)
+static arrowWriteState *
+createArrowWriteState(Relation frel, File file, bool redo_log_written)
 {
-	List	   *options_list = untransformRelOptions(PG_GETARG_DATUM(0));
-	Oid			catalog = PG_GETARG_OID(1);
-
-	if (catalog == ForeignTableRelationId)
-	{
-		List	   *filesList;
-		ListCell   *lc;
-
-		filesList = arrowFdwExtractFilesList(options_list);
-		foreach (lc, filesList)
-		{
-			ArrowFileInfo	af_info;
-			const char	   *fname = strVal(lfirst(lc));
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	arrowWriteState *aw_state;
+	SQLtable	   *table;
+	struct stat		stat_buf;
+	MetadataCacheKey key;
 
-			readArrowFile(fname, &af_info, true);
-		}
-	}
-	else if (options_list != NIL)
-	{
-		const char	   *label;
-		char			temp[80];
+	if (fstat(FileGetRawDesc(file), &stat_buf) != 0)
+		elog(ERROR, "failed on fstat('%s'): %m", FilePathName(file));
+	memset(&key, 0, sizeof(key));
+	key.st_dev = stat_buf.st_dev;
+	key.st_ino = stat_buf.st_ino;
+	key.hash = hash_any((unsigned char *)&key,
+						offsetof(MetadataCacheKey, hash));
+	aw_state = palloc0(offsetof(arrowWriteState,
+								sql_table.columns[tupdesc->natts]));
+	aw_state->memcxt = CurrentMemoryContext;
+	aw_state->file = file;
+	aw_state->key = key;
+	aw_state->hash = key.hash;
+	aw_state->redo_log_written = redo_log_written;
+	aw_state->segment_nrows = (arrow_record_batch_max_rows > 0
+							   ? arrow_record_batch_max_rows
+							   : SIZE_MAX);
+	table = &aw_state->sql_table;
+	table->filename = FilePathName(file);
+	table->fdesc = FileGetRawDesc(file);
+	setupArrowSQLbufferSchema(table, tupdesc);
+	if (!redo_log_written)
+		setupArrowSQLbufferBatches(table);
 
-		switch (catalog)
-		{
-			case ForeignDataWrapperRelationId:
-				label = "FOREIGN DATA WRAPPER";
-				break;
-			case ForeignServerRelationId:
-				label = "SERVER";
-				break;
-			case UserMappingRelationId:
-				label = "USER MAPPING";
-				break;
-			case AttributeRelationId:
-				label = "attribute of FOREIGN TABLE";
-				break;
-			default:
-				snprintf(temp, sizeof(temp),
-						 "[unexpected object catalog=%u]", catalog);
-				label = temp;
-				break;
-		}
-		elog(ERROR, "Arrow_Fdw does not support any options for %s", label);
-	}
-	PG_RETURN_VOID();
+	return aw_state;
 }
-PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_validator);
 
 /*
- * pgstrom_arrow_fdw_precheck_schema
+ * createArrowWriteRedoLog
  */
 static void
-arrow_fdw_precheck_schema(Relation rel)
+createArrowWriteRedoLog(File filp, bool is_newfile)
 {
-	TupleDesc		tupdesc = RelationGetDescr(rel);
-	ForeignTable   *ft = GetForeignTable(RelationGetRelid(rel));
-	List		   *filesList;
-	ListCell	   *lc;
-	bool			writable;
-	int				j;
-
-	/* check schema definition is supported by Apache Arrow */
-	for (j=0; j < tupdesc->natts; j++)
-	{
-		Form_pg_attribute	attr = tupleDescAttr(tupdesc, j);
+	arrowWriteRedoLog *redo;
+	int				fdesc = FileGetRawDesc(filp);
+	const char	   *fname = FilePathName(filp);
+	TransactionId	curr_xid = GetCurrentTransactionId();
+	CommandId		curr_cid = GetCurrentCommandId(true);
+	dlist_iter		iter;
+	MetadataCacheKey key;
+	struct stat		stat_buf;
+	size_t			main_sz;
 
-		if (!arrowTypeIsConvertible(attr->atttypid,
-									attr->atttypmod))
-			elog(ERROR, "column %s of foreign table %s has %s type that is not convertible any supported Apache Arrow types",
-				 NameStr(attr->attname),
-				 RelationGetRelationName(rel),
-				 format_type_be(attr->atttypid));
-	}
+	if (fstat(fdesc, &stat_buf) != 0)
+		elog(ERROR, "failed on fstat(2): %m");
 
-	filesList = __arrowFdwExtractFilesList(ft->options,
-										   NULL,
-										   &writable);
-	foreach (lc, filesList)
+	dlist_foreach(iter, &arrow_write_redo_list)
 	{
-		const char *fname = strVal(lfirst(lc));
-		File		filp;
-		List	   *rb_cached = NIL;
-		ListCell   *cell;
+		redo = dlist_container(arrowWriteRedoLog, chain, iter.cur);
 
-		filp = PathNameOpenFile(fname, O_RDONLY | PG_BINARY);
-		if (filp < 0)
-		{
-			if (writable && errno == ENOENT)
-				continue;
-			elog(ERROR, "failed to open '%s' on behalf of '%s': %m",
-				 fname, RelationGetRelationName(rel));
-		}
-		/* check schema compatibility */
-		rb_cached = arrowLookupOrBuildMetadataCache(filp);
-		foreach (cell, rb_cached)
+		if (redo->key.st_dev == stat_buf.st_dev &&
+			redo->key.st_ino == stat_buf.st_ino &&
+			redo->xid    == curr_xid &&
+			redo->cid    <= curr_cid)
 		{
-			RecordBatchState *rb_state = lfirst(cell);
-
-			if (!arrowSchemaCompatibilityCheck(tupdesc, rb_state))
-				elog(ERROR, "arrow file '%s' on behalf of the foreign table '%s' has incompatible schema definition",
-					 fname, RelationGetRelationName(rel));
+			/* nothing to do */
+			return;
 		}
-		list_free(rb_cached);
 	}
-}
 
-Datum
-pgstrom_arrow_fdw_precheck_schema(PG_FUNCTION_ARGS)
-{
-	EventTriggerData   *trigdata;
-	
-	if (!CALLED_AS_EVENT_TRIGGER(fcinfo))
-		elog(ERROR, "%s: must be called as EventTrigger",
-			 __FUNCTION__);
-	trigdata = (EventTriggerData *) fcinfo->context;
-	if (strcmp(trigdata->event, "ddl_command_end") != 0)
-		elog(ERROR, "%s: must be called on ddl_command_end event",
-			 __FUNCTION__);
-	if (strcmp(trigdata->tag, "CREATE FOREIGN TABLE") == 0)
+	memset(&key, 0, sizeof(MetadataCacheKey));
+	key.st_dev = stat_buf.st_dev;
+	key.st_ino = stat_buf.st_ino;
+	key.hash = hash_any((unsigned char *)&key,
+						offsetof(MetadataCacheKey, hash));
+	if (is_newfile)
 	{
-		CreateStmt	   *stmt = (CreateStmt *)trigdata->parsetree;
-		Relation		rel;
-
-		rel = relation_openrv_extended(stmt->relation, AccessShareLock, true);
-		if (!rel)
-			PG_RETURN_NULL();
-		if (rel->rd_rel->relkind == RELKIND_FOREIGN_TABLE &&
-			GetFdwRoutineForRelation(rel, false) == &pgstrom_arrow_fdw_routine)
-		{
-			arrow_fdw_precheck_schema(rel);
-		}
-		relation_close(rel, AccessShareLock);
+		main_sz = MAXALIGN(offsetof(arrowWriteRedoLog, footer_backup));
+		redo = MemoryContextAllocZero(CacheMemoryContext,
+									  main_sz + strlen(fname) + 1);
+		redo->key = key;
+		redo->xid = curr_xid;
+		redo->cid = curr_cid;
+		redo->pathname = (char *)redo + main_sz;
+		strcpy(redo->pathname, fname);
+		redo->is_truncate = false;
 	}
-	else if (strcmp(trigdata->tag, "ALTER FOREIGN TABLE") == 0)
+	else
 	{
-		AlterTableStmt *stmt = (AlterTableStmt *)trigdata->parsetree;
-		Relation		rel;
-		ListCell	   *lc;
-		bool			has_schema_change = false;
+		ssize_t			nbytes;
+		off_t			offset;
+		char			temp[100];
 
-		rel = relation_openrv_extended(stmt->relation, AccessShareLock, true);
-		if (!rel)
-			PG_RETURN_NULL();
-		if (rel->rd_rel->relkind == RELKIND_FOREIGN_TABLE &&
-			GetFdwRoutineForRelation(rel, false) == &pgstrom_arrow_fdw_routine)
-		{
-			foreach (lc, stmt->cmds)
-			{
-				AlterTableCmd  *cmd = lfirst(lc);
+		/* make backup image of the Footer section */
+		nbytes = sizeof(int32) + 6;		/* = strlen("ARROW1") */
+		offset = lseek(fdesc, -nbytes, SEEK_END);
+		if (offset < 0)
+			elog(ERROR, "failed on lseek(2): %m");
+		if (__readFile(fdesc, temp, nbytes) != nbytes)
+			elog(ERROR, "failed on read(2): %m");
+		offset -= *((int32 *)temp);
 
-				if (cmd->subtype == AT_AddColumn ||
-					cmd->subtype == AT_DropColumn ||
-					cmd->subtype == AT_AlterColumnType)
-				{
-					has_schema_change = true;
-					break;
-				}
-			}
-			if (has_schema_change)
-				arrow_fdw_precheck_schema(rel);
+		nbytes = stat_buf.st_size - offset;
+		if (nbytes <= 0)
+			elog(ERROR, "strange apache arrow format");
+		main_sz = MAXALIGN(offsetof(arrowWriteRedoLog,
+									footer_backup[nbytes]));
+		redo = MemoryContextAllocZero(CacheMemoryContext,
+									  main_sz + strlen(fname) + 1);
+		redo->key = key;
+		redo->xid = curr_xid;
+		redo->cid = curr_cid;
+		redo->pathname = (char *)redo + main_sz;
+		strcpy(redo->pathname, fname);
+		PG_TRY();
+		{
+			if (lseek(fdesc, -nbytes, SEEK_END) < 0)
+				elog(ERROR, "failed on lseek(2): %m");
+			if (__readFile(fdesc, redo->footer_backup, nbytes) != nbytes)
+				elog(ERROR, "failed on read(2): %m");
+			if (lseek(fdesc, -nbytes, SEEK_END) < 0)
+				elog(ERROR, "failed on lseek(2): %m");
+			redo->footer_offset = offset;
+			redo->footer_length = nbytes;
 		}
-		relation_close(rel, AccessShareLock);
-	}
-	else
-	{
-		elog(NOTICE, "%s was called on %s, ignored",
-			 __FUNCTION__, trigdata->tag);
+		PG_CATCH();
+		{
+			pfree(redo);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
 	}
-	PG_RETURN_NULL();
+	elog(DEBUG2, "arrow: redo-log on '%s' (st_dev=%u/st_ino=%u) xid=%u cid=%u offset=%lu length=%zu",
+		 redo->pathname, (uint32)redo->key.st_dev, (uint32)redo->key.st_ino,
+		 (uint32)redo->xid, (uint32)redo->cid,
+		 (uint64)redo->footer_offset,
+		 (uint64)redo->footer_length);
+
+	dlist_push_head(&arrow_write_redo_list, &redo->chain);
 }
-PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_precheck_schema);
 
 /*
- * arrowInvalidateMetadataCache
- *
- * NOTE: caller must have lock_slots[] with EXCLUSIVE mode
+ * writeOutArrowRecordBatch
  */
-static uint64
-arrowInvalidateMetadataCache(arrowMetadataCache *mcache, bool detach_lru)
+static void
+writeOutArrowRecordBatch(arrowWriteState *aw_state, bool with_footer)
 {
-	arrowMetadataCache *mtemp;
-	dlist_node	   *dnode;
-	uint64			released = 0;
+	SQLtable   *table = &aw_state->sql_table;
+	int			index = aw_state->hash % ARROW_METADATA_HASH_NSLOTS;
+	struct stat	stat_buf;
+	struct stat	stat_new;
+	ssize_t		nbytes;
+	arrowWriteMVCCLog *mvcc = NULL;
 
-	while (!dlist_is_empty(&mcache->siblings))
+	if (table->nitems > 0)
 	{
-		dnode = dlist_pop_head_node(&mcache->siblings);
-		mtemp = dlist_container(arrowMetadataCache, chain, dnode);
-		Assert(dlist_is_empty(&mtemp->siblings) &&
-			   !mtemp->lru_chain.prev && !mtemp->lru_chain.next);
-		dlist_delete(&mtemp->chain);
-		released += MAXALIGN(offsetof(arrowMetadataCache,
-									  fstate[mtemp->nfields]));
-		pfree(mtemp);
+		mvcc = MemoryContextAllocZero(TopSharedMemoryContext,
+									  sizeof(arrowWriteMVCCLog));
+		mvcc->key = aw_state->key;
+		mvcc->xid = GetCurrentTransactionId();
+		mvcc->cid = GetCurrentCommandId(true);
 	}
-	released += MAXALIGN(offsetof(arrowMetadataCache,
-								  fstate[mcache->nfields]));
-	if (detach_lru)
+
+	PG_TRY();
 	{
-		SpinLockAcquire(&arrow_metadata_state->lru_lock);
-		dlist_delete(&mcache->lru_chain);
-		SpinLockRelease(&arrow_metadata_state->lru_lock);
+		LWLockAcquire(&arrow_metadata_state->lock_slots[index],
+					  LW_EXCLUSIVE);
+		/* get the latest state of the file */
+		if (fstat(table->fdesc, &stat_buf) != 0)
+			elog(ERROR, "failed on fstat('%s'): %m", table->filename);
+		/* make a REDO log entry */
+		if (!aw_state->redo_log_written)
+		{
+			createArrowWriteRedoLog(aw_state->file, false);
+			aw_state->redo_log_written = true;
+		}
+		/* write out an empty arrow file */
+		if (stat_buf.st_size == 0)
+		{
+			Assert(lseek(table->fdesc, 0, SEEK_END) == 0);
+			nbytes = __writeFile(table->fdesc, "ARROW1\0\0", 8);
+			if (nbytes != 8)
+				elog(ERROR, "failed on __writeFile('%s'): %m",
+					 table->filename);
+			writeArrowSchema(table);
+		}
+		if (table->nitems > 0)
+		{
+			mvcc->record_batch = writeArrowRecordBatch(table);
+			dlist_push_tail(&arrow_metadata_state->mvcc_slots[index],
+							&mvcc->chain);
+			elog(DEBUG2,
+				 "arrow-write: '%s' (st_dev=%u, st_ino=%u), xid=%u, cid=%u, record_batch=%u",
+				 FilePathName(aw_state->file),
+				 (uint32)mvcc->key.st_dev, (uint32)mvcc->key.st_ino,
+				 (uint32)mvcc->xid, (uint32)mvcc->cid, mvcc->record_batch);
+		}
+		if (with_footer)
+			writeArrowFooter(table);
+		if (fstat(table->fdesc, &stat_new) != 0)
+			elog(ERROR, "failed on fstat('%s'): %m", table->filename);
+		pg_atomic_fetch_add_u64(&arrow_metadata_state->write_generation, 1);
+		LWLockRelease(&arrow_metadata_state->lock_slots[index]);
 	}
-	dlist_delete(&mcache->chain);
-	pfree(mcache);
+	PG_CATCH();
+	{
+		if (mvcc)
+			pfree(mvcc);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
 
-	return pg_atomic_sub_fetch_u64(&arrow_metadata_state->consumed,
-								   released);
+	/*
+	 * The RecordBatches already in the file are not modified by append,
+	 * so partial results of GpuPreAgg on them are still valid.
+	 */
+	if (stat_buf.st_size > 0)
+		gpupreagg_partial_cache_rebase(&stat_buf, &stat_new);
 }
 
 /*
- * copyMetadataFieldCache - copy for nested structure
+ * Routines for the columnar cache (ccache.c)
+ *
+ * A columnar cache chunk is an Apache Arrow file that has only one
+ * RecordBatch, built from the cached columns of the heap blocks.
  */
-static int
-copyMetadataFieldCache(RecordBatchFieldState *dest_curr,
-					   RecordBatchFieldState *dest_tail,
-					   int nattrs,
-					   RecordBatchFieldState *columns)
+struct SQLtable *
+arrowFdwCreateColumnarCache(TupleDesc tupdesc, int fdesc, const char *filename)
 {
-	RecordBatchFieldState *dest_next = dest_curr + nattrs;
-	int		j, k, nslots = nattrs;
+	SQLtable   *table;
 
-	if (dest_next > dest_tail)
-		return -1;
+	table = palloc0(offsetof(SQLtable, columns[tupdesc->natts]));
+	table->filename = filename;
+	table->fdesc = fdesc;
+	setupArrowSQLbufferSchema(table, tupdesc);
 
-	for (j=0; j < nattrs; j++)
-	{
-		dest_curr[j] = columns[j];
-		if (dest_curr[j].num_children == 0)
-			Assert(dest_curr[j].children == NULL);
-		else
-		{
-			dest_curr[j].children = dest_next;
-			k = copyMetadataFieldCache(dest_next,
-									   dest_tail,
-									   columns[j].num_children,
-									   columns[j].children);
-			if (k < 0)
-				return -1;
-			dest_next += k;
-			nslots += k;
-		}
-	}
-	return nslots;
+	return table;
 }
 
-/*
- * makeRecordBatchStateFromCache
- *   - setup RecordBatchState from arrowMetadataCache
- */
-static RecordBatchState *
-makeRecordBatchStateFromCache(arrowMetadataCache *mcache, File fdesc)
+size_t
+arrowFdwPutColumnarCache(SQLtable *table, TupleDesc tupdesc,
+						 Datum *values, bool *isnull)
 {
-	RecordBatchState   *rbstate;
+	return arrowPutValuesSQLtable(table, tupdesc, values, isnull);
+}
 
-	rbstate = palloc0(offsetof(RecordBatchState,
-							   columns[mcache->nfields]));
-	rbstate->fdesc = fdesc;
-	memcpy(&rbstate->stat_buf, &mcache->stat_buf, sizeof(struct stat));
-	rbstate->rb_index  = mcache->rb_index;
-	rbstate->rb_offset = mcache->rb_offset;
-	rbstate->rb_length = mcache->rb_length;
-	rbstate->rb_nitems = mcache->rb_nitems;
-	rbstate->ncols = mcache->ncols;
-	copyMetadataFieldCache(rbstate->columns,
-						   rbstate->columns + mcache->nfields,
-						   mcache->ncols,
-						   mcache->fstate);
-	return rbstate;
+size_t
+arrowFdwWriteColumnarCache(SQLtable *table)
+{
+	ssize_t		nbytes;
+	off_t		length;
+
+	Assert(table->nitems > 0);
+	nbytes = __writeFile(table->fdesc, "ARROW1\0\0", 8);
+	if (nbytes != 8)
+		elog(ERROR, "failed on __writeFile('%s'): %m", table->filename);
+	writeArrowSchema(table);
+	writeArrowRecordBatch(table);
+	writeArrowFooter(table);
+
+	length = lseek(table->fdesc, 0, SEEK_CUR);
+	if (length < 0)
+		elog(ERROR, "failed on lseek('%s'): %m", table->filename);
+	return length;
 }
 
 /*
- * arrowReclaimMetadataCache
+ * __arrowFdwLoadColumnarCacheDevice
+ *
+ * It sets up a small PDS on the host-pinned memory, if the entire image of
+ * the columnar cache chunk is resident on the device memory at @m_gbuf.
+ * Every I/O chunk towards the file is replaced by device-to-device copy from
+ * the same offset of the image. The I/O vector is also kept, to read the file
+ * on device memory shortage.
  */
-static void
-arrowReclaimMetadataCache(void)
+static pgstrom_data_store *
+__arrowFdwLoadColumnarCacheDevice(RecordBatchState *rb_state,
+								  Relation relation,
+								  Bitmapset *referenced,
+								  GpuContext *gcontext,
+								  CUdeviceptr m_gbuf)
 {
-	arrowMetadataCache *mcache;
-	LWLock	   *lock = NULL;
-	dlist_node *dnode;
-	uint32		lru_hash;
-	uint32		lru_index;
-	uint64		consumed;
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	pgstrom_data_store *pds;
+	kern_data_store *kds;
+	strom_io_vector *iovec;
+	gpubuf_io_vector *gbiov;
+	size_t		head_sz;
+	size_t		iovec_sz;
+	int			j;
+	CUresult	rc;
 
-	consumed = pg_atomic_read_u64(&arrow_metadata_state->consumed);
-	if (consumed <= arrow_metadata_cache_size)
-		return;
+	if (rb_state->rb_compression >= 0)
+		return NULL;
+	head_sz = KDS_calculateHeadSize(tupdesc);
+	kds = alloca(head_sz);
+	init_kernel_data_store(kds, tupdesc, 0, KDS_FORMAT_ARROW, 0);
+	kds->nitems = rb_state->rb_nitems;
+	kds->nrooms = rb_state->rb_nitems;
+	kds->table_oid = RelationGetRelid(relation);
+	Assert(head_sz == KERN_DATA_STORE_HEAD_LENGTH(kds));
+	for (j=0; j < kds->nr_colmeta; j++)
+		kds->colmeta[j].attopts = rb_state->columns[j].attopts;
+	iovec = arrowFdwSetupIOvector(kds, rb_state, referenced, NULL);
+	if (iovec->nr_chunks == 0)
+	{
+		pfree(iovec);
+		return NULL;
+	}
+	iovec_sz = MAXALIGN(offsetof(strom_io_vector, ioc[iovec->nr_chunks]));
 
-	SpinLockAcquire(&arrow_metadata_state->lru_lock);
-	if (dlist_is_empty(&arrow_metadata_state->lru_list))
+	rc = gpuMemAllocHost(gcontext, (void **)&pds,
+						 offsetof(pgstrom_data_store, kds) +
+						 head_sz + iovec_sz +
+						 offsetof(gpubuf_io_vector, ioc[iovec->nr_chunks]));
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocHost: %s", errorText(rc));
+
+	memset(pds, 0, offsetof(pgstrom_data_store, kds));
+	pds->gcontext = gcontext;
+	pg_atomic_init_u32(&pds->refcnt, 1);
+	pds->nblocks_uncached = 0;
+	pds->filedesc = FileGetRawDesc(rb_state->fdesc);
+	memcpy(&pds->kds, kds, head_sz);
+	pds->iovec = (strom_io_vector *)((char *)&pds->kds + head_sz);
+	memcpy(pds->iovec, iovec,
+		   offsetof(strom_io_vector, ioc[iovec->nr_chunks]));
+	gbiov = (gpubuf_io_vector *)((char *)pds->iovec + iovec_sz);
+	gbiov->m_gbuf = m_gbuf;
+	gbiov->nr_chunks = iovec->nr_chunks;
+	for (j=0; j < iovec->nr_chunks; j++)
 	{
-		SpinLockRelease(&arrow_metadata_state->lru_lock);
-		return;
+		strom_io_chunk	*ioc = &iovec->ioc[j];
+		gpubuf_io_chunk	*gioc = &gbiov->ioc[j];
+
+		gioc->m_offset  = ioc->m_offset;
+		gioc->s_offset  = (size_t)ioc->fchunk_id * PAGE_SIZE;
+		gioc->length    = (size_t)ioc->nr_pages * PAGE_SIZE;
+		gioc->from_host = false;
 	}
-	dnode = dlist_tail_node(&arrow_metadata_state->lru_list);
-	mcache = dlist_container(arrowMetadataCache, lru_chain, dnode);
-	lru_hash = mcache->hash;
-	SpinLockRelease(&arrow_metadata_state->lru_lock);
+	pds->gpubuf_iov = gbiov;
+	pfree(iovec);
 
-	do {
-		lru_index = lru_hash % ARROW_METADATA_HASH_NSLOTS;
-		lock = &arrow_metadata_state->lock_slots[lru_index];
+	return pds;
+}
 
-		LWLockAcquire(lock, LW_EXCLUSIVE);
-		SpinLockAcquire(&arrow_metadata_state->lru_lock);
-		if (dlist_is_empty(&arrow_metadata_state->lru_list))
-		{
-			SpinLockRelease(&arrow_metadata_state->lru_lock);
-			LWLockRelease(lock);
-			break;
-		}
-		dnode = dlist_tail_node(&arrow_metadata_state->lru_list);
-		mcache = dlist_container(arrowMetadataCache, lru_chain, dnode);
-		if (mcache->hash == lru_hash)
-		{
-			dlist_delete(&mcache->lru_chain);
-			memset(&mcache->lru_chain, 0, sizeof(dlist_node));
-			SpinLockRelease(&arrow_metadata_state->lru_lock);
-			consumed = arrowInvalidateMetadataCache(mcache, false);
-		}
-		else
-		{
-			/* LRU-tail was referenced by someone, try again */
-			lru_hash = mcache->hash;
-            SpinLockRelease(&arrow_metadata_state->lru_lock);
-		}
-		LWLockRelease(lock);
-	} while (consumed > arrow_metadata_cache_size);
+/*
+ * arrowFdwLoadColumnarCache
+ *
+ * It loads the referenced columns of a columnar cache chunk onto a PDS
+ * in KDS_FORMAT_ARROW, according to the definition of the relation.
+ * Columns not cached are left empty, so the caller must ensure all the
+ * referenced columns are in the @ccache_refs. It returns NULL if the chunk
+ * is not compatible to the current definition of the relation.
+ * If @m_gbuf is valid, it is the device image of the entire chunk file.
+ */
+pgstrom_data_store *
+arrowFdwLoadColumnarCache(File filp,
+						  Relation relation,
+						  Bitmapset *ccache_refs,
+						  Bitmapset *referenced,
+						  GpuContext *gcontext,
+						  MemoryContext mcontext,
+						  CUdeviceptr m_gbuf)
+{
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	int			fdesc = FileGetRawDesc(filp);
+	ArrowFileInfo af_info;
+	ArrowSchema *schema;
+	RecordBatchState *rb_temp;
+	RecordBatchState *rb_state;
+	pgstrom_data_store *pds;
+	size_t		head_sz;
+	int			j, k, anum;
+
+	readArrowFileDesc(fdesc, &af_info);
+	schema = &af_info.footer.schema;
+	if (af_info.footer._num_recordBatches != 1 ||
+		af_info.footer.schema._num_fields != bms_num_members(ccache_refs))
+		return NULL;
+	rb_temp = makeRecordBatchState(schema,
+								   &af_info.footer.recordBatches[0],
+								   &af_info.recordBatches[0].body.recordBatch,
+								   &af_info);
+	/*
+	 * RecordBatchState shall have entire columns of the relation, and
+	 * sub-fields of KDS also, because __arrowFdwLoadRecordBatch() copies
+	 * the type options of all the kern_colmeta.
+	 */
+	head_sz = KDS_calculateHeadSize(tupdesc);
+	rb_state = palloc0(offsetof(RecordBatchState, columns[head_sz /
+														  sizeof(kern_colmeta)]));
+	rb_state->fdesc = filp;
+	if (fstat(fdesc, &rb_state->stat_buf) != 0)
+		elog(ERROR, "failed on fstat('%s'): %m", FilePathName(filp));
+	rb_state->rb_index = 0;
+	rb_state->rb_offset = rb_temp->rb_offset;
+	rb_state->rb_length = rb_temp->rb_length;
+	rb_state->rb_nitems = rb_temp->rb_nitems;
+	rb_state->rb_compression = rb_temp->rb_compression;
+	rb_state->ncols = tupdesc->natts;
+
+	for (anum = bms_next_member(ccache_refs, -1), k=0;
+		 anum >= 0;
+		 anum = bms_next_member(ccache_refs, anum), k++)
+	{
+		ArrowField *field = &schema->fields[k];
+		RecordBatchFieldState *fstate = &rb_temp->columns[k];
+		Form_pg_attribute attr;
+
+		j = anum + FirstLowInvalidHeapAttributeNumber - 1;
+		if (j < 0 || j >= tupdesc->natts)
+			return NULL;
+		attr = tupleDescAttr(tupdesc, j);
+		if (attr->attisdropped ||
+			attr->atttypid != fstate->atttypid ||
+			strcmp(field->name, NameStr(attr->attname)) != 0)
+			return NULL;
+		memcpy(&rb_state->columns[j], fstate,
+			   sizeof(RecordBatchFieldState));
+	}
+	pds = NULL;
+	if (gcontext && m_gbuf != 0UL)
+		pds = __arrowFdwLoadColumnarCacheDevice(rb_state, relation,
+												referenced,
+												gcontext, m_gbuf);
+	if (!pds)
+		pds = __arrowFdwLoadRecordBatch(rb_state, relation, referenced, NULL,
+										gcontext, mcontext,
+										GetOptimalGpuForFile(filp));
+	pfree(rb_state);
+	pfree(rb_temp);
+
+	return pds;
 }
 
 /*
- * __arrowBuildMetadataCache
+ * TRUNCATE support
+ */
+/*
+ * __arrowExecCompactRecordBatches
  *
- * NOTE: caller must have exclusive lock on arrow_metadata_state->lock_slots[]
+ * It reads all the visible rows from the arrow file, then writes them out
+ * to the new file, with RecordBatches as large as table->segment_sz, but
+ * not more than arrow_fdw.record_batch_max_rows rows, like INSERT.
  */
-static arrowMetadataCache *
-__arrowBuildMetadataCache(List *rb_state_list, uint32 hash)
+static void
+__arrowExecCompactRecordBatches(Relation frel, SQLtable *table,
+								const char *path_name)
 {
-	arrowMetadataCache *mcache = NULL;
-	arrowMetadataCache *mtemp;
-	dlist_node *dnode;
-	Size		sz, consumed = 0;
-	int			nfields;
+	TupleDesc	tupdesc = RelationGetDescr(frel);
+	Bitmapset  *referenced = NULL;
+	Datum	   *values;
+	bool	   *isnull;
+	List	   *rb_state_list;
 	ListCell   *lc;
+	File		fdesc;
+	size_t		usage = 0;
+	size_t		segment_nrows = (arrow_record_batch_max_rows > 0
+								 ? arrow_record_batch_max_rows
+								 : SIZE_MAX);
+	MemoryContext tmpcxt;
+	MemoryContext oldcxt;
+	int			j;
+
+	fdesc = PathNameOpenFile(path_name, O_RDONLY | PG_BINARY);
+	if (fdesc < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path_name)));
+	rb_state_list = arrowLookupOrBuildMetadataCache(fdesc);
 
+	/* compaction needs to fetch all the attributes */
+	for (j=0; j < tupdesc->natts; j++)
+		referenced = bms_add_member(referenced, j + 1 -
+									FirstLowInvalidHeapAttributeNumber);
+	values = palloc(sizeof(Datum) * tupdesc->natts);
+	isnull = palloc(sizeof(bool)  * tupdesc->natts);
+	tmpcxt = AllocSetContextCreate(CurrentMemoryContext,
+								   "arrow_fdw compaction",
+								   ALLOCSET_DEFAULT_SIZES);
 	foreach (lc, rb_state_list)
 	{
-		RecordBatchState *rbstate = lfirst(lc);
-
-		if (!mcache)
-			nfields = RecordBatchFieldCount(rbstate);
-		else
-			Assert(nfields == RecordBatchFieldCount(rbstate));
+		RecordBatchState *rb_state = lfirst(lc);
+		pgstrom_data_store *pds;
+		size_t		index;
 
-		sz = offsetof(arrowMetadataCache, fstate[nfields]);
-		mtemp = MemoryContextAllocZero(TopSharedMemoryContext, sz);
-		if (!mtemp)
+		if (!arrowSchemaCompatibilityCheck(tupdesc, rb_state))
+			elog(ERROR, "arrow file '%s' on behalf of foreign table '%s' has incompatible schema definition",
+				 path_name, RelationGetRelationName(frel));
+		if (rb_state->rb_nitems == 0)
+			continue;
+		pds = __arrowFdwLoadRecordBatch(rb_state,
+										frel,
+										referenced,
+										NULL,
+										NULL,
+										CurrentMemoryContext,
+										-1);
+		for (index=0; index < pds->kds.nitems; index++)
 		{
-			/* !!out of memory!! */
-			if (mcache)
+			oldcxt = MemoryContextSwitchTo(tmpcxt);
+			for (j=0; j < pds->kds.ncols; j++)
 			{
-				while (!dlist_is_empty(&mcache->siblings))
-				{
-					dnode = dlist_pop_head_node(&mcache->siblings);
-					mtemp = dlist_container(arrowMetadataCache,
-											chain, dnode);
-					pfree(mtemp);
-				}
-				pfree(mcache);
+				pg_datum_arrow_ref(&pds->kds,
+								   &pds->kds.colmeta[j],
+								   index,
+								   values + j,
+								   isnull + j);
 			}
-			return NULL;
+			MemoryContextSwitchTo(oldcxt);
+
+			usage = arrowPutValuesSQLtable(table, tupdesc, values, isnull);
+			if (usage > table->segment_sz ||
+				table->nitems >= segment_nrows)
+				writeArrowRecordBatch(table);
+			MemoryContextReset(tmpcxt);
 		}
+		PDS_release(pds);
+		CHECK_FOR_INTERRUPTS();
+	}
+	if (table->nitems > 0)
+		writeArrowRecordBatch(table);
+	MemoryContextDelete(tmpcxt);
+	FileClose(fdesc);
+}
 
-		dlist_init(&mtemp->siblings);
-		memcpy(&mtemp->stat_buf, &rbstate->stat_buf, sizeof(struct stat));
-		mtemp->hash      = hash;
-		mtemp->rb_index  = rbstate->rb_index;
-        mtemp->rb_offset = rbstate->rb_offset;
-        mtemp->rb_length = rbstate->rb_length;
-        mtemp->rb_nitems = rbstate->rb_nitems;
-        mtemp->ncols     = rbstate->ncols;
-		mtemp->nfields   =
-			copyMetadataFieldCache(mtemp->fstate,
-								   mtemp->fstate + nfields,
-								   rbstate->ncols,
-								   rbstate->columns);
-		Assert(mtemp->nfields == nfields);
+/*
+ * __arrowExecTruncateRelation
+ *
+ * It creates a new arrow file, then swaps it with the current one, and
+ * makes a REDO log entry to clean up the older one at the end of the
+ * transaction. If compaction, visible rows are copied to the new file.
+ */
+static int
+__arrowExecTruncateRelation(Relation frel, bool compaction, size_t segment_sz)
+{
+	TupleDesc	tupdesc = RelationGetDescr(frel);
+	Oid			frel_oid = RelationGetRelid(frel);
+	ForeignTable *ft = GetForeignTable(frel_oid);
+	arrowWriteRedoLog *redo;
+	struct stat	stat_buf;
+	MetadataCacheKey key;
+	List	   *filesList;
+	SQLtable   *table;
+	const char *path_name;
+	const char *dir_name;
+	const char *file_name;
+	size_t		main_sz;
+	int			dirfd = -1;
+	int			fdesc = -1;
+	int			nbytes;
+	char		path[MAXPGPATH];
+	bool		writable;
 
-		if (!mcache)
-			mcache = mtemp;
-		else
-			dlist_push_tail(&mcache->siblings, &mtemp->chain);
-		consumed += MAXALIGN(sz);
+	filesList = __arrowFdwExtractFilesList(ft->options,
+										   NULL,
+										   &writable);
+	if (!writable)
+		elog(ERROR, "arrow_fdw: foreign table \"%s\" is not writable",
+			 RelationGetRelationName(frel));
+	Assert(list_length(filesList) == 1);
+	path_name = strVal(linitial(filesList));
+	if (stat(path_name, &stat_buf) != 0)
+		elog(ERROR, "failed on stat('%s'): %m", path_name);
+	memset(&key, 0, sizeof(key));
+	key.st_dev = stat_buf.st_dev;
+	key.st_ino = stat_buf.st_ino;
+	key.hash = hash_any((unsigned char *)&key,
+						offsetof(MetadataCacheKey, hash));
+	/* build SQLtable to write out schema */
+	table = palloc0(offsetof(SQLtable, columns[tupdesc->natts]));
+	setupArrowSQLbufferSchema(table, tupdesc);
+	if (segment_sz > 0)
+		table->segment_sz = segment_sz;
+
+	/* create REDO log entry */
+	main_sz = MAXALIGN(offsetof(arrowWriteRedoLog, footer_backup));
+	redo = MemoryContextAllocZero(CacheMemoryContext,
+								  main_sz + strlen(path_name) + 1);
+	redo->key    = key;
+	redo->xid    = GetCurrentTransactionId();
+	redo->cid    = GetCurrentCommandId(true);
+	redo->pathname = (char *)redo + main_sz;
+	strcpy(redo->pathname, path_name);
+	redo->is_truncate = true;
+
+	/* open directory of the arrow file (must have write permission) */
+	dir_name = dirname(pstrdup(path_name));
+	file_name = basename(pstrdup(path_name));
+	dirfd = open(dir_name, O_RDONLY | O_DIRECTORY);
+	if (dirfd < 0)
+	{
+		pfree(redo);
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open directory '%s': %m", dir_name)));
 	}
-	pg_atomic_add_fetch_u64(&arrow_metadata_state->consumed, consumed);
 
-	return mcache;
+	PG_TRY();
+	{
+		/* create an empty file */
+	retry:
+		redo->suffix = random();
+		snprintf(path, sizeof(path), "%s.%u.backup",
+				 file_name, redo->suffix);
+		fdesc = openat(dirfd, path, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fdesc < 0)
+		{
+			if (errno == EEXIST)
+				goto retry;
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not create a file '%s' at '%s': %m",
+							path, dir_name)));
+		}
+
+		/* write out an empty arrow file */
+		table->filename = path;
+		table->fdesc = fdesc;
+		nbytes = __writeFile(table->fdesc, "ARROW1\0\0", 8);
+		if (nbytes != 8)
+			elog(ERROR, "failed on __writeFile('%s'): %m", path);
+		writeArrowSchema(table);
+		if (compaction)
+			__arrowExecCompactRecordBatches(frel, table, path_name);
+		writeArrowFooter(table);
+
+		/* swap two files atomically */
+		if (renameat2(dirfd, file_name,
+					  dirfd, path, RENAME_EXCHANGE) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("failed to swap '%s' and '%s' at '%s': %m",
+							file_name, path, dir_name)));
+		pg_atomic_fetch_add_u64(&arrow_metadata_state->write_generation, 1);
+		/* partial results of GpuPreAgg on the older file are obsolete */
+		CacheInvalidateRelcache(frel);
+	}
+	PG_CATCH();
+	{
+		if (fdesc >= 0)
+		{
+			unlinkat(dirfd, path, 0);
+			close(fdesc);
+		}
+		close(dirfd);
+		pfree(redo);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	close(fdesc);
+	close(dirfd);
+
+	/* save the REDO log entry */
+	dlist_push_head(&arrow_write_redo_list, &redo->chain);
+
+	return table->numRecordBatches;
 }
 
+/*
+ * pgstrom_arrow_fdw_truncate
+ */
+Datum
+pgstrom_arrow_fdw_truncate(PG_FUNCTION_ARGS)
+{
+	Oid			frel_oid = PG_GETARG_OID(0);
+	Relation	frel;
+	FdwRoutine *routine;
+
+	frel = table_open(frel_oid, AccessExclusiveLock);
+	if (frel->rd_rel->relkind != RELKIND_FOREIGN_TABLE)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not arrow_fdw foreign table",
+						RelationGetRelationName(frel))));
+	routine = GetFdwRoutineForRelation(frel, false);
+	if (memcmp(routine, &pgstrom_arrow_fdw_routine, sizeof(FdwRoutine)) != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not arrow_fdw foreign table",
+						RelationGetRelationName(frel))));
+	__arrowExecTruncateRelation(frel, false, 0);
+
+	table_close(frel, NoLock);
+
+	PG_RETURN_VOID();
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_truncate);
 
 /*
- * checkArrowRecordBatchIsVisible
- *
- * NOTE: It must be called under shared lock on lock_slots[]
+ * pgstrom_arrow_fdw_compact
  */
-static bool
-checkArrowRecordBatchIsVisible(RecordBatchState *rbstate,
-							   dlist_head *mvcc_slot)
+Datum
+pgstrom_arrow_fdw_compact(PG_FUNCTION_ARGS)
 {
-	dlist_iter		iter;
+	Oid			frel_oid;
+	int64		segment_sz = 0;
+	Relation	frel;
+	FdwRoutine *routine;
+	int			nbatches;
 
-	dlist_foreach(iter, mvcc_slot)
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+	frel_oid = PG_GETARG_OID(0);
+	if (!PG_ARGISNULL(1))
 	{
-		arrowWriteMVCCLog  *mvcc = dlist_container(arrowWriteMVCCLog,
-												   chain, iter.cur);
-		if (mvcc->key.st_dev == rbstate->stat_buf.st_dev &&
-			mvcc->key.st_ino == rbstate->stat_buf.st_ino &&
-			mvcc->record_batch == rbstate->rb_index)
-		{
-			if (TransactionIdIsCurrentTransactionId(mvcc->xid))
-				return true;
-			else
-				return false;
-		}
+		segment_sz = PG_GETARG_INT64(1);
+		if (segment_sz < (4L << 20) || segment_sz > (2048L << 20))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("target batch size must be between 4MB and 2GB")));
 	}
-	return true;
+	frel = table_open(frel_oid, AccessExclusiveLock);
+	if (frel->rd_rel->relkind != RELKIND_FOREIGN_TABLE)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not arrow_fdw foreign table",
+						RelationGetRelationName(frel))));
+	routine = GetFdwRoutineForRelation(frel, false);
+	if (memcmp(routine, &pgstrom_arrow_fdw_routine, sizeof(FdwRoutine)) != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not arrow_fdw foreign table",
+						RelationGetRelationName(frel))));
+	nbatches = __arrowExecTruncateRelation(frel, true, segment_sz);
+
+	table_close(frel, NoLock);
+
+	PG_RETURN_INT32(nbatches);
 }
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_compact);
 
 /*
- * arrowLookupOrBuildMetadataCache
+ * pgstrom_arrow_query
+ *
+ * It runs the supplied query, then returns the results as a set of bytea.
+ * Each bytea is a self-contained Apache Arrow file that has one RecordBatch,
+ * so client can map them on the RecordBatches without per-row parsing.
  */
-List *
-arrowLookupOrBuildMetadataCache(File fdesc)
+static bytea *
+__arrowQueryWriteChunk(SQLtable *table)
 {
-	MetadataCacheKey key;
-	struct stat	stat_buf;
-	uint32		index;
-	LWLock	   *lock;
-	dlist_head *hash_slot;
-	dlist_head *mvcc_slot;
-	dlist_iter	iter1, iter2;
-	bool		has_exclusive = false;
-	List	   *results = NIL;
+	bytea	   *chunk;
+	off_t		length;
+
+	if (lseek(table->fdesc, 0, SEEK_SET) != 0 ||
+		ftruncate(table->fdesc, 0) != 0)
+		elog(ERROR, "failed on truncate('%s'): %m", table->filename);
+	if (__writeFile(table->fdesc, "ARROW1\0\0", 8) != 8)
+		elog(ERROR, "failed on __writeFile('%s'): %m", table->filename);
+	writeArrowSchema(table);
+	writeArrowRecordBatch(table);
+	writeArrowFooter(table);
+
+	length = lseek(table->fdesc, 0, SEEK_CUR);
+	if (length < 0)
+		elog(ERROR, "failed on lseek('%s'): %m", table->filename);
+	if (length > MaxAllocSize - VARHDRSZ)
+		elog(ERROR, "arrow chunk too large (%zu bytes)", (size_t)length);
+	chunk = palloc(VARHDRSZ + length);
+	if (lseek(table->fdesc, 0, SEEK_SET) != 0 ||
+		__readFile(table->fdesc, VARDATA(chunk), length) != length)
+		elog(ERROR, "failed on __readFile('%s'): %m", table->filename);
+	SET_VARSIZE(chunk, VARHDRSZ + length);
+
+	return chunk;
+}
 
-	if (fstat(FileGetRawDesc(fdesc), &stat_buf) != 0)
-		elog(ERROR, "failed on fstat('%s'): %m", FilePathName(fdesc));
+/*
+ * __arrowQueryPutChunk - writes out the buffer, then releases the SQLtable
+ * and the chunk image together with @chunk_cxt.
+ */
+static void
+__arrowQueryPutChunk(SQLtable *table,
+					 Tuplestorestate *tupstore, TupleDesc tupdesc,
+					 MemoryContext chunk_cxt)
+{
+	MemoryContext oldcxt = MemoryContextSwitchTo(chunk_cxt);
+	Datum		value;
+	bool		isnull = false;
 
-	memset(&key, 0, sizeof(key));
-	key.st_dev	= stat_buf.st_dev;
-	key.st_ino	= stat_buf.st_ino;
-	key.hash = hash_any((unsigned char *)&key,
-						offsetof(MetadataCacheKey, hash));
-	index = key.hash % ARROW_METADATA_HASH_NSLOTS;
-	lock = &arrow_metadata_state->lock_slots[index];
-	hash_slot = &arrow_metadata_state->hash_slots[index];
-	mvcc_slot = &arrow_metadata_state->mvcc_slots[index];
+	value = PointerGetDatum(__arrowQueryWriteChunk(table));
+	tuplestore_putvalues(tupstore, tupdesc, &value, &isnull);
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextReset(chunk_cxt);
+}
 
-	LWLockAcquire(lock, LW_SHARED);
-retry:
-	dlist_foreach(iter1, hash_slot)
+static void
+__arrowQueryExecute(const char *query, int64 batch_rows,
+					Tuplestorestate *tupstore, TupleDesc tupdesc,
+					int fdesc, const char *filename)
+{
+	Portal		portal;
+	SPIPlanPtr	plan;
+	SQLtable   *table = NULL;
+	TupleDesc	spi_tupdesc;
+	Datum	   *values;
+	bool	   *isnull;
+	MemoryContext chunk_cxt;
+	MemoryContext tuple_cxt;
+	MemoryContext oldcxt;
+	size_t		segment_sz;
+	size_t		usage = 0;
+	uint64		i;
+	int			j;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "failed on SPI_connect");
+	plan = SPI_prepare(query, 0, NULL);
+	if (!plan)
+		elog(ERROR, "failed on SPI_prepare(\"%s\"): %s",
+			 query, SPI_result_code_string(SPI_result));
+	if (!SPI_is_cursor_plan(plan))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("query does not return tuples: %s", query)));
+	portal = SPI_cursor_open(NULL, plan, NULL, NULL, true);
+	spi_tupdesc = portal->tupDesc;
+
+	chunk_cxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "arrow_query chunk context",
+									  ALLOCSET_DEFAULT_SIZES);
+	tuple_cxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "arrow_query tuple context",
+									  ALLOCSET_DEFAULT_SIZES);
+	values = palloc(sizeof(Datum) * spi_tupdesc->natts);
+	isnull = palloc(sizeof(bool)  * spi_tupdesc->natts);
+	/* bytea datum must fit MaxAllocSize */
+	segment_sz = Min((size_t)arrow_record_batch_size_kb << 10,
+					 MaxAllocSize / 4);
+	if (batch_rows <= 0)
+		batch_rows = arrow_record_batch_max_rows;
+	for (;;)
 	{
-		arrowMetadataCache *mcache
-			= dlist_container(arrowMetadataCache, chain, iter1.cur);
-		if (mcache->stat_buf.st_dev == stat_buf.st_dev &&
-			mcache->stat_buf.st_ino == stat_buf.st_ino)
+		SPI_cursor_fetch(portal, true, 10000);
+		if (SPI_processed == 0)
+			break;
+		for (i=0; i < SPI_processed; i++)
 		{
-			RecordBatchState *rbstate;
-			
-			Assert(mcache->hash == key.hash);
-			if (timespec_comp(&mcache->stat_buf.st_mtim,
-							  &stat_buf.st_mtim) < 0 ||
-				timespec_comp(&mcache->stat_buf.st_ctim,
-							  &stat_buf.st_ctim) < 0)
+			HeapTuple	tuple = SPI_tuptable->vals[i];
+
+			CHECK_FOR_INTERRUPTS();
+			if (!table)
 			{
-				char	buf1[80], buf2[80], buf3[80], buf4[80];
-				char   *tail;
+				oldcxt = MemoryContextSwitchTo(chunk_cxt);
+				table = palloc0(offsetof(SQLtable,
+										 columns[spi_tupdesc->natts]));
+				table->filename = filename;
+				table->fdesc = fdesc;
+				setupArrowSQLbufferSchema(table, spi_tupdesc);
+				MemoryContextSwitchTo(oldcxt);
+			}
+			oldcxt = MemoryContextSwitchTo(tuple_cxt);
+			heap_deform_tuple(tuple, spi_tupdesc, values, isnull);
+			for (j=0; j < spi_tupdesc->natts; j++)
+			{
+				Form_pg_attribute attr = tupleDescAttr(spi_tupdesc, j);
 
-				if (!has_exclusive)
-				{
-					LWLockRelease(lock);
-					LWLockAcquire(lock, LW_EXCLUSIVE);
-					has_exclusive = true;
-					goto retry;
-				}
-				ctime_r(&mcache->stat_buf.st_mtime, buf1);
-				ctime_r(&mcache->stat_buf.st_ctime, buf2);
-				ctime_r(&stat_buf.st_mtime, buf3);
-				ctime_r(&stat_buf.st_ctime, buf4);
-				for (tail=buf1+strlen(buf1)-1; isspace(*tail); *tail--='\0');
-				for (tail=buf2+strlen(buf2)-1; isspace(*tail); *tail--='\0');
-				for (tail=buf3+strlen(buf3)-1; isspace(*tail); *tail--='\0');
-				for (tail=buf4+strlen(buf4)-1; isspace(*tail); *tail--='\0');
-				elog(DEBUG2, "arrow_fdw: metadata cache for '%s' (m:%s, c:%s) is older than the latest file (m:%s, c:%s), so invalidated",
-					 FilePathName(fdesc), buf1, buf2, buf3, buf4);
-				arrowInvalidateMetadataCache(mcache, true);
-				break;
+				if (!isnull[j] && attr->attlen == -1)
+					values[j] = PointerGetDatum(PG_DETOAST_DATUM_PACKED(values[j]));
 			}
-			/*
-			 * Ok, arrow file metadata cache found and still valid
-			 */
-			rbstate = makeRecordBatchStateFromCache(mcache, fdesc);
-			if (checkArrowRecordBatchIsVisible(rbstate, mvcc_slot))
-				results = list_make1(rbstate);
-			dlist_foreach (iter2, &mcache->siblings)
+			MemoryContextSwitchTo(chunk_cxt);
+			usage = arrowPutValuesSQLtable(table, spi_tupdesc,
+										   values, isnull);
+			MemoryContextSwitchTo(oldcxt);
+			MemoryContextReset(tuple_cxt);
+
+			if (usage > segment_sz ||
+				(batch_rows > 0 && table->nitems >= batch_rows))
 			{
-				arrowMetadataCache *__mcache
-					= dlist_container(arrowMetadataCache, chain, iter2.cur);
-				rbstate = makeRecordBatchStateFromCache(__mcache, fdesc);
-				if (checkArrowRecordBatchIsVisible(rbstate, mvcc_slot))
-					results = lappend(results, rbstate);
+				__arrowQueryPutChunk(table, tupstore, tupdesc, chunk_cxt);
+				table = NULL;
 			}
-			SpinLockAcquire(&arrow_metadata_state->lru_lock);
-			dlist_move_head(&arrow_metadata_state->lru_list,
-							&mcache->lru_chain);
-			SpinLockRelease(&arrow_metadata_state->lru_lock);
-			LWLockRelease(lock);
-
-			return results;
 		}
+		SPI_freetuptable(SPI_tuptable);
 	}
+	if (table && table->nitems > 0)
+		__arrowQueryPutChunk(table, tupstore, tupdesc, chunk_cxt);
+	SPI_cursor_close(portal);
+	MemoryContextDelete(tuple_cxt);
+	MemoryContextDelete(chunk_cxt);
+	SPI_finish();
+}
 
-	/*
-	 * Hmm... no valid metadata cache was not found, so build a new entry
-	 * under the exclusive lock on the arrow file.
-	 */
-	if (!has_exclusive)
+Datum
+pgstrom_arrow_query(PG_FUNCTION_ARGS)
+{
+	static pg_atomic_uint64 queryFileCounter = {0};
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	char	   *query;
+	int64		batch_rows = (PG_ARGISNULL(1) ? 0 : PG_GETARG_INT64(1));
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	MemoryContext oldcxt;
+	char		tempdir[MAXPGPATH];
+	char		filename[MAXPGPATH];
+	int			fdesc;
+
+	if (PG_ARGISNULL(0))
+		elog(ERROR, "no query string was specified");
+	query = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	if (!rsinfo || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if ((rsinfo->allowedModes & SFRM_Materialize) == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+	oldcxt = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupdesc = CreateTemplateTupleDesc(1);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "chunk",
+					   BYTEAOID, -1, 0);
+	tupdesc = BlessTupleDesc(tupdesc);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	MemoryContextSwitchTo(oldcxt);
+
+	/* temporary file to build arrow chunks */
+	snprintf(tempdir, MAXPGPATH, "%s/%s",
+			 DataDir,
+			 PG_TEMP_FILES_DIR);
+	snprintf(filename, MAXPGPATH, "%s/%s_strom_%d.%ld.arrow",
+			 tempdir,
+			 PG_TEMP_FILE_PREFIX,
+			 MyProcPid,
+			 pg_atomic_fetch_add_u64(&queryFileCounter, 1));
+	fdesc = OpenTransientFile(filename, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+	if (fdesc < 0 && errno == ENOENT)
 	{
-		LWLockRelease(lock);
-		LWLockAcquire(lock, LW_EXCLUSIVE);
-		has_exclusive = true;
-		goto retry;
+		mkdir(tempdir, S_IRWXU);
+		fdesc = OpenTransientFile(filename, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
 	}
-	else
+	if (fdesc < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", filename)));
+	/* no need to keep the file name visible */
+	unlink(filename);
+	PG_TRY();
 	{
-		ArrowFileInfo	af_info;
-		arrowMetadataCache *mcache;
-		List		   *rb_state_any = NIL;
+		__arrowQueryExecute(query, batch_rows,
+							tupstore, tupdesc,
+							fdesc, filename);
+	}
+	PG_CATCH();
+	{
+		CloseTransientFile(fdesc);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	CloseTransientFile(fdesc);
 
-		readArrowFileDesc(FileGetRawDesc(fdesc), &af_info);
-		if (af_info.dictionaries != NULL)
-			elog(ERROR, "DictionaryBatch is not supported");
-		Assert(af_info.footer._num_dictionaries == 0);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
 
-		if (af_info.recordBatches == NULL)
-			elog(DEBUG2, "arrow file '%s' contains no RecordBatch",
-				 FilePathName(fdesc));
-		for (index = 0; index < af_info.footer._num_recordBatches; index++)
-		{
-			RecordBatchState *rb_state;
-			ArrowBlock       *block
-				= &af_info.footer.recordBatches[index];
-			ArrowRecordBatch *rbatch
-				= &af_info.recordBatches[index].body.recordBatch;
+	return (Datum) 0;
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_query);
 
-			rb_state = makeRecordBatchState(&af_info.footer.schema,
-											block, rbatch);
-			rb_state->fdesc = fdesc;
-			memcpy(&rb_state->stat_buf, &stat_buf, sizeof(struct stat));
-			rb_state->rb_index = index;
+static void
+__applyArrowTruncateRedoLog(arrowWriteRedoLog *redo, bool is_commit)
+{
+	char		backup[MAXPGPATH];
 
-			if (checkArrowRecordBatchIsVisible(rb_state, mvcc_slot))
-				results = lappend(results, rb_state);
-			rb_state_any = lappend(rb_state_any, rb_state);
-		}
-		/* try to build a metadata cache for further references */
-		mcache = __arrowBuildMetadataCache(rb_state_any, key.hash);
-		if (mcache)
-		{
-			dlist_push_head(hash_slot, &mcache->chain);
-			SpinLockAcquire(&arrow_metadata_state->lru_lock);
-            dlist_push_head(&arrow_metadata_state->lru_list,
-							&mcache->lru_chain);
-			SpinLockRelease(&arrow_metadata_state->lru_lock);
-		}
+	snprintf(backup, MAXPGPATH, "%s.%u.backup",
+			 redo->pathname, redo->suffix);
+	if (is_commit)
+	{
+		elog(DEBUG2, "arrow-redo: unlink [%s]", backup);
+		if (unlink(backup) != 0)
+			ereport(WARNING,
+					(errcode_for_file_access(),
+					 errmsg("could not remove truncated file \"%s\": %m",
+							backup),
+					 errhint("remove the \"%s\" manually", backup)));
+	}
+	else
+	{
+		elog(DEBUG2, "arrow-redo: rename [%s]->[%s]", backup, redo->pathname);
+		if (rename(backup, redo->pathname) != 0)
+			ereport(WARNING,
+					(errcode_for_file_access(),
+					 errmsg("could not restore backup file \"%s\": %m",
+							backup),
+					 errhint("please restore \"%s\" to \"%s\" manually",
+							 backup, redo->pathname)));
 	}
-	LWLockRelease(lock);
-	/*
-	 * reclaim unreferenced metadata cache entries based on LRU, if shared-
-	 * memory consumption exceeds the configured threshold.
-	 */
-	arrowReclaimMetadataCache();
-
-	return results;
 }
 
-/*
- * setupArrowSQLbufferSchema
- */
 static void
-__setupArrowSQLbufferField(SQLtable *table,
-						   SQLfield *column,
-						   const char *attname,
-						   Oid atttypid,
-						   int atttypmod)
+__applyArrowInsertRedoLog(arrowWriteRedoLog *redo, bool is_commit)
 {
-	HeapTuple		tup;
-	Form_pg_type	typ;
-	const char	   *typnamespace;
-	const char	   *tz = show_timezone();
-
-	tup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(atttypid));
-	if (!HeapTupleIsValid(tup))
-		elog(ERROR, "cache lookup failed for type: %u", atttypid);
-	typ = (Form_pg_type) GETSTRUCT(tup);
-	typnamespace = get_namespace_name(typ->typnamespace);
+	int		fdesc;
+	
+	if (is_commit)
+		return;
 
-	table->numFieldNodes++;
-    table->numBuffers +=
-		assignArrowTypePgSQL(column,
-							 attname,
-							 atttypid,
-							 atttypmod,
-							 NameStr(typ->typname),
-							 typnamespace,
-							 typ->typlen,
-							 typ->typbyval,
-							 typ->typtype,
-							 typ->typalign,
-							 typ->typrelid,
-							 typ->typelem,
-							 tz,
-							 getTimezoneOffset(tz) * -1000000L);	/* [us]*/
-	if (OidIsValid(typ->typelem))
+	/* special case, if it was an empty file */
+	if (redo->footer_offset == 0 &&
+		redo->footer_length == 0)
 	{
-		/* array type */
-		char		elem_name[NAMEDATALEN+10];
+		if (unlink(redo->pathname) != 0)
+			ereport(WARNING,
+					(errcode_for_file_access(),
+					 errmsg("failed on truncate('%s'): %m", redo->pathname),
+					 errdetail("could not apply REDO image, therefore, garbages are still remained")));
+		return;
+	}
 
-		snprintf(elem_name, sizeof(elem_name), "_%s[]", attname);
-		column->element = palloc0(sizeof(SQLfield));
-		__setupArrowSQLbufferField(table,
-								   column->element,
-								   elem_name,
-								   typ->typelem,
-								   -1);
+	fdesc = open(redo->pathname, O_RDWR);
+	if (fdesc < 0)
+	{
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("failed on open('%s'): %m", redo->pathname),
+				 errdetail("could not apply REDO image, therefore, arrow file might be corrupted")));
 	}
-	else if (OidIsValid(typ->typrelid))
+	else if (lseek(fdesc, redo->footer_offset, SEEK_SET) < 0)
+	{
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("failed on lseek('%s'): %m", redo->pathname),
+				 errdetail("could not apply REDO image, therefore, arrow file might be corrupted")));
+	}
+	else if (__writeFile(fdesc,
+						 redo->footer_backup,
+						 redo->footer_length) != redo->footer_length)
 	{
-		/* composite type */
-		TupleDesc	tupdesc = lookup_rowtype_tupdesc(atttypid, atttypmod);
-		int			j;
-
-		column->nfields = tupdesc->natts;
-		column->subfields = palloc0(sizeof(SQLfield) * tupdesc->natts);
-		for (j=0; j < tupdesc->natts; j++)
-		{
-			Form_pg_attribute sattr = tupleDescAttr(tupdesc, j);
-			__setupArrowSQLbufferField(table,
-									   &column->subfields[j],
-									   NameStr(sattr->attname),
-									   sattr->atttypid,
-									   sattr->atttypmod);
-		}
-		ReleaseTupleDesc(tupdesc);
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("failed on write('%s'): %m", redo->pathname),
+				 errdetail("could not apply REDO image, therefore, arrow file might be corrupted")));
 	}
-	else if (typ->typtype == 'e')
+	else if (ftruncate(fdesc, (redo->footer_offset +
+							   redo->footer_length)) != 0)
 	{
-		elog(ERROR, "Enum type is not supported right now");
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("failed on ftruncate('%s'): %m", redo->pathname),
+				 errdetail("could not apply REDO image, therefore, arrow file might be corrupted")));
 	}
-	ReleaseSysCache(tup);
+	close(fdesc);
+
+	elog(DEBUG2, "arrow_fdw: REDO log applied (xid=%u, cid=%u, file=[%s], offset=%zu, length=%zu)", redo->xid, redo->cid, redo->pathname, redo->footer_offset, redo->footer_length);
 }
 
 static void
-setupArrowSQLbufferSchema(SQLtable *table, TupleDesc tupdesc)
+__cleanupArrowWriteMVCCLog(TransactionId curr_xid, dlist_head *mvcc_slot)
 {
-	int		j;
+	dlist_mutable_iter iter;
 
-	table->nfields = tupdesc->natts;
-	for (j=0; j < tupdesc->natts; j++)
+	dlist_foreach_modify(iter, mvcc_slot)
 	{
-		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
-		__setupArrowSQLbufferField(table,
-								   &table->columns[j],
-								   NameStr(attr->attname),
-								   attr->atttypid,
-								   attr->atttypmod);
+		arrowWriteMVCCLog *mvcc = dlist_container(arrowWriteMVCCLog,
+												  chain, iter.cur);
+		if (mvcc->xid == curr_xid)
+		{
+			dlist_delete(&mvcc->chain);
+			elog(DEBUG2, "arrow: release mvcc-log (st_dev=%u, st_ino=%u), xid=%u, cid=%u, record_batch=%u",
+				 (uint32)mvcc->key.st_dev, (uint32)mvcc->key.st_ino,
+				 (uint32)mvcc->xid, (uint32)mvcc->cid, mvcc->record_batch);
+			pfree(mvcc);
+		}
 	}
-	table->segment_sz = (size_t)arrow_record_batch_size_kb << 10;
 }
 
+/*
+ * __arrowFdwXactCallback
+ */
 static void
-setupArrowSQLbufferBatches(SQLtable *table)
+__arrowFdwXactCallback(TransactionId curr_xid, bool is_commit)
 {
-	ArrowFileInfo af_info;
-	struct stat	stat_buf;
-	MetadataCacheKey key;
-	uint32		index;
-	int			i, nitems;
-	loff_t		pos = 0;
-
-	if (fstat(table->fdesc, &stat_buf) != 0)
-		elog(ERROR, "failed on fstat('%s'): %m", table->filename);
-	memset(&key, 0, sizeof(key));
-	key.st_dev = stat_buf.st_dev;
-	key.st_ino = stat_buf.st_ino;
-	key.hash = hash_any((unsigned char *)&key,
-						offsetof(MetadataCacheKey, hash));
-	index = key.hash % ARROW_METADATA_HASH_NSLOTS;
+	arrowWriteRedoLog  *redo;
+	dlist_mutable_iter	iter;
+	CommandId			curr_cid = InvalidCommandId;
+	uint32				index;
+	bool				locked[ARROW_METADATA_HASH_NSLOTS];
+	LWLock			   *locks[ARROW_METADATA_HASH_NSLOTS];
+	uint32				lcount = 0;
 
-	LWLockAcquire(&arrow_metadata_state->lock_slots[index], LW_SHARED);
-	readArrowFileDesc(table->fdesc, &af_info);
-	LWLockRelease(&arrow_metadata_state->lock_slots[index]);
+	if (curr_xid == InvalidTransactionId ||
+		dlist_is_empty(&arrow_write_redo_list))
+		return;
 
-	/* restore DictionaryBatches already in the file */
-	nitems = af_info.footer._num_dictionaries;
-	table->numDictionaries = nitems;
-	if (nitems > 0)
+	memset(locked, 0, sizeof(locked));
+	dlist_foreach_modify(iter, &arrow_write_redo_list)
 	{
-		table->dictionaries = palloc(sizeof(ArrowBlock) * nitems);
-		memcpy(table->dictionaries,
-			   af_info.footer.dictionaries,
-			   sizeof(ArrowBlock) * nitems);
-		for (i=0; i < nitems; i++)
-		{
-			ArrowBlock *block = &table->dictionaries[i];
-
-			pos = Max(pos, ARROWALIGN(block->offset +
-									  block->metaDataLength +
-									  block->bodyLength));
-		}
-	}
-	else
-		table->dictionaries = NULL;
+		redo = dlist_container(arrowWriteRedoLog, chain, iter.cur);
+		if (redo->xid != curr_xid)
+			continue;
+		if (curr_cid != InvalidCommandId &&
+			curr_cid < redo->cid)
+			elog(WARNING, "Bug? Order of REDO log is not be correct. ABORT transaction might generate wrong image restored.");
 
-	/* restore RecordBatches already in the file */
-	nitems = af_info.footer._num_recordBatches;
-	table->numRecordBatches = nitems;
-	if (nitems > 0)
-	{
-		table->recordBatches = palloc(sizeof(ArrowBlock) * nitems);
-		memcpy(table->recordBatches,
-			   af_info.footer.recordBatches,
-			   sizeof(ArrowBlock) * nitems);
-		for (i=0; i < nitems; i++)
+		index = redo->key.hash % ARROW_METADATA_HASH_NSLOTS;
+		if (!locked[index])
 		{
-			ArrowBlock *block = &table->recordBatches[i];
+			LWLock	   *lock = &arrow_metadata_state->lock_slots[index];
+			dlist_head *slot = &arrow_metadata_state->mvcc_slots[index];
 
-			pos = Max(pos, ARROWALIGN(block->offset +
-									  block->metaDataLength +
-									  block->bodyLength));
+			LWLockAcquire(lock, LW_EXCLUSIVE);
+			__cleanupArrowWriteMVCCLog(curr_xid, slot);
+			locked[index] = true;
+			locks[lcount++] = lock;
 		}
+		if (redo->is_truncate)
+			__applyArrowTruncateRedoLog(redo, is_commit);
+		else
+			__applyArrowInsertRedoLog(redo, is_commit);
+
+		dlist_delete(&redo->chain);
+		pfree(redo);
 	}
-	else
-		table->recordBatches = NULL;
+	if (lcount > 0)
+		pg_atomic_fetch_add_u64(&arrow_metadata_state->write_generation, 1);
 
-	if (lseek(table->fdesc, pos, SEEK_SET) < 0)
-		elog(ERROR, "failed on lseek('%s',%lu): %m",
-			 table->filename, pos);
+	for (index=0; index < lcount; index++)
+		LWLockRelease(locks[index]);
 }
 
 /*
- * createArrowWriteState
+ * arrowFdwXactCallback
  */
-static arrowWriteState *
-createArrowWriteState(Relation frel, File file, bool redo_log_written)
+static void
+arrowFdwXactCallback(XactEvent event, void *arg)
 {
-	TupleDesc		tupdesc = RelationGetDescr(frel);
-	arrowWriteState *aw_state;
-	SQLtable	   *table;
-	struct stat		stat_buf;
-	MetadataCacheKey key;
+	TransactionId	curr_xid = GetCurrentTransactionIdIfAny();
 
-	if (fstat(FileGetRawDesc(file), &stat_buf) != 0)
-		elog(ERROR, "failed on fstat('%s'): %m", FilePathName(file));
-	memset(&key, 0, sizeof(key));
-	key.st_dev = stat_buf.st_dev;
-	key.st_ino = stat_buf.st_ino;
-	key.hash = hash_any((unsigned char *)&key,
-						offsetof(MetadataCacheKey, hash));
-	aw_state = palloc0(offsetof(arrowWriteState,
-								sql_table.columns[tupdesc->natts]));
-	aw_state->memcxt = CurrentMemoryContext;
-	aw_state->file = file;
-	aw_state->key = key;
-	aw_state->hash = key.hash;
-	aw_state->redo_log_written = redo_log_written;
-	table = &aw_state->sql_table;
-	table->filename = FilePathName(file);
-	table->fdesc = FileGetRawDesc(file);
-	setupArrowSQLbufferSchema(table, tupdesc);
-	if (!redo_log_written)
-		setupArrowSQLbufferBatches(table);
+	if (event == XACT_EVENT_COMMIT)
+		__arrowFdwXactCallback(curr_xid, true);
+	else if (event == XACT_EVENT_ABORT)
+		__arrowFdwXactCallback(curr_xid, false);
 
-	return aw_state;
+	/* GPU buffers referenced by the aborted scan, if any */
+	if (event == XACT_EVENT_COMMIT ||
+		event == XACT_EVENT_ABORT)
+		arrowFdwReleaseGpuBuffers(NULL);
 }
 
 /*
- * createArrowWriteRedoLog
+ * arrowFdwSubXactCallback
  */
 static void
-createArrowWriteRedoLog(File filp, bool is_newfile)
+arrowFdwSubXactCallback(SubXactEvent event, SubTransactionId mySubid,
+						SubTransactionId parentSubid, void *arg)
 {
-	arrowWriteRedoLog *redo;
-	int				fdesc = FileGetRawDesc(filp);
-	const char	   *fname = FilePathName(filp);
-	TransactionId	curr_xid = GetCurrentTransactionId();
-	CommandId		curr_cid = GetCurrentCommandId(true);
-	dlist_iter		iter;
-	MetadataCacheKey key;
-	struct stat		stat_buf;
-	size_t			main_sz;
-
-	if (fstat(fdesc, &stat_buf) != 0)
-		elog(ERROR, "failed on fstat(2): %m");
-
-	dlist_foreach(iter, &arrow_write_redo_list)
-	{
-		redo = dlist_container(arrowWriteRedoLog, chain, iter.cur);
-
-		if (redo->key.st_dev == stat_buf.st_dev &&
-			redo->key.st_ino == stat_buf.st_ino &&
-			redo->xid    == curr_xid &&
-			redo->cid    <= curr_cid)
-		{
-			/* nothing to do */
-			return;
-		}
-	}
-
-	memset(&key, 0, sizeof(MetadataCacheKey));
-	key.st_dev = stat_buf.st_dev;
-	key.st_ino = stat_buf.st_ino;
-	key.hash = hash_any((unsigned char *)&key,
-						offsetof(MetadataCacheKey, hash));
-	if (is_newfile)
-	{
-		main_sz = MAXALIGN(offsetof(arrowWriteRedoLog, footer_backup));
-		redo = MemoryContextAllocZero(CacheMemoryContext,
-									  main_sz + strlen(fname) + 1);
-		redo->key = key;
-		redo->xid = curr_xid;
-		redo->cid = curr_cid;
-		redo->pathname = (char *)redo + main_sz;
-		strcpy(redo->pathname, fname);
-		redo->is_truncate = false;
-	}
-	else
-	{
-		ssize_t			nbytes;
-		off_t			offset;
-		char			temp[100];
+	TransactionId	curr_xid = GetCurrentTransactionIdIfAny();
 
-		/* make backup image of the Footer section */
-		nbytes = sizeof(int32) + 6;		/* = strlen("ARROW1") */
-		offset = lseek(fdesc, -nbytes, SEEK_END);
-		if (offset < 0)
-			elog(ERROR, "failed on lseek(2): %m");
-		if (__readFile(fdesc, temp, nbytes) != nbytes)
-			elog(ERROR, "failed on read(2): %m");
-		offset -= *((int32 *)temp);
+	if (event == SUBXACT_EVENT_COMMIT_SUB)
+		__arrowFdwXactCallback(curr_xid, true);
+	else if (event == SUBXACT_EVENT_ABORT_SUB)
+		__arrowFdwXactCallback(curr_xid, false);
+}
 
-		nbytes = stat_buf.st_size - offset;
-		if (nbytes <= 0)
-			elog(ERROR, "strange apache arrow format");
-		main_sz = MAXALIGN(offsetof(arrowWriteRedoLog,
-									footer_backup[nbytes]));
-		redo = MemoryContextAllocZero(CacheMemoryContext,
-									  main_sz + strlen(fname) + 1);
-		redo->key = key;
-		redo->xid = curr_xid;
-		redo->cid = curr_cid;
-		redo->pathname = (char *)redo + main_sz;
-		strcpy(redo->pathname, fname);
-		PG_TRY();
-		{
-			if (lseek(fdesc, -nbytes, SEEK_END) < 0)
-				elog(ERROR, "failed on lseek(2): %m");
-			if (__readFile(fdesc, redo->footer_backup, nbytes) != nbytes)
-				elog(ERROR, "failed on read(2): %m");
-			if (lseek(fdesc, -nbytes, SEEK_END) < 0)
-				elog(ERROR, "failed on lseek(2): %m");
-			redo->footer_offset = offset;
-			redo->footer_length = nbytes;
-		}
-		PG_CATCH();
-		{
-			pfree(redo);
-			PG_RE_THROW();
-		}
-		PG_END_TRY();
-	}
-	elog(DEBUG2, "arrow: redo-log on '%s' (st_dev=%u/st_ino=%u) xid=%u cid=%u offset=%lu length=%zu",
-		 redo->pathname, (uint32)redo->key.st_dev, (uint32)redo->key.st_ino,
-		 (uint32)redo->xid, (uint32)redo->cid,
-		 (uint64)redo->footer_offset,
-		 (uint64)redo->footer_length);
+/*
+ * __freeArrowGpuBuffer
+ *
+ * NOTE: caller must have exclusive lock on gpubuf_locks[] and gpubuf_lru_lock
+ */
+static void
+__freeArrowGpuBuffer(ArrowGpuBuffer *gpubuf)
+{
+	CUresult	rc;
 
-	dlist_push_head(&arrow_write_redo_list, &redo->chain);
+	rc = gpuMemFreePreserved(gpubuf->cuda_dindex,
+							 gpubuf->ipc_mhandle);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on gpuMemFreePreserved: %s", errorText(rc));
+	dlist_delete(&gpubuf->chain);
+	dlist_delete(&gpubuf->lru_chain);
+	pfree(gpubuf);
 }
 
 /*
- * writeOutArrowRecordBatch
+ * putArrowGpuBuffer
+ *
+ * NOTE: caller must have exclusive lock on gpubuf_locks[]
  */
 static void
-writeOutArrowRecordBatch(arrowWriteState *aw_state, bool with_footer)
+putArrowGpuBuffer(ArrowGpuBuffer *gpubuf)
 {
-	SQLtable   *table = &aw_state->sql_table;
-	int			index = aw_state->hash % ARROW_METADATA_HASH_NSLOTS;
-	struct stat	stat_buf;
-	ssize_t		nbytes;
-	arrowWriteMVCCLog *mvcc = NULL;
+	uint32 count;
 
-	if (table->nitems > 0)
+	if ((count = pg_atomic_sub_fetch_u32(&gpubuf->refcnt, 1)) == 0)
 	{
-		mvcc = MemoryContextAllocZero(TopSharedMemoryContext,
-									  sizeof(arrowWriteMVCCLog));
-		mvcc->key = aw_state->key;
-		mvcc->xid = GetCurrentTransactionId();
-		mvcc->cid = GetCurrentCommandId(true);
+		LWLockAcquire(&arrow_metadata_state->gpubuf_lru_lock, LW_EXCLUSIVE);
+		__freeArrowGpuBuffer(gpubuf);
+		LWLockRelease(&arrow_metadata_state->gpubuf_lru_lock);
 	}
+}
 
-	PG_TRY();
+/*
+ * reserveArrowGpuBuffer
+ *
+ * It checks whether a new GPU buffer of 'nbytes' fits the budget of the
+ * device (arrow_fdw.gpu_buffer_budget). If not, it evicts the pinned GPU
+ * buffers that are not referenced by any sessions, in LRU order. It
+ * returns false if the new buffer does not fit even after the eviction.
+ * Buffers referenced by sessions are never evicted, because they may be
+ * mapped by the Python scripts.
+ *
+ * NOTE: caller must have exclusive lock on gpubuf_locks[] of the new buffer,
+ * and locks of the other slots are acquired conditionally to avoid deadlocks.
+ */
+static bool
+reserveArrowGpuBuffer(int cuda_dindex, size_t nbytes)
+{
+	size_t		budget = (size_t)arrow_gpu_buffer_budget_kb << 10;
+	size_t		usage = 0;
+	dlist_mutable_iter iter;
+	bool		retval;
+
+	if (arrow_gpu_buffer_budget_kb == 0)
+		return true;	/* unlimited */
+	if (nbytes > budget)
+		return false;
+
+	LWLockAcquire(&arrow_metadata_state->gpubuf_lru_lock, LW_EXCLUSIVE);
+	dlist_foreach_modify(iter, &arrow_metadata_state->gpubuf_lru_list)
 	{
-		LWLockAcquire(&arrow_metadata_state->lock_slots[index],
-					  LW_EXCLUSIVE);
-		/* get the latest state of the file */
-		if (fstat(table->fdesc, &stat_buf) != 0)
-			elog(ERROR, "failed on fstat('%s'): %m", table->filename);
-		/* make a REDO log entry */
-		if (!aw_state->redo_log_written)
-		{
-			createArrowWriteRedoLog(aw_state->file, false);
-			aw_state->redo_log_written = true;
-		}
-		/* write out an empty arrow file */
-		if (stat_buf.st_size == 0)
-		{
-			Assert(lseek(table->fdesc, 0, SEEK_END) == 0);
-			nbytes = __writeFile(table->fdesc, "ARROW1\0\0", 8);
-			if (nbytes != 8)
-				elog(ERROR, "failed on __writeFile('%s'): %m",
-					 table->filename);
-			writeArrowSchema(table);
-		}
-		if (table->nitems > 0)
-		{
-			mvcc->record_batch = writeArrowRecordBatch(table);
-			dlist_push_tail(&arrow_metadata_state->mvcc_slots[index],
-							&mvcc->chain);
-			elog(DEBUG2,
-				 "arrow-write: '%s' (st_dev=%u, st_ino=%u), xid=%u, cid=%u, record_batch=%u",
-				 FilePathName(aw_state->file),
-				 (uint32)mvcc->key.st_dev, (uint32)mvcc->key.st_ino,
-				 (uint32)mvcc->xid, (uint32)mvcc->cid, mvcc->record_batch);
-		}
-		if (with_footer)
-			writeArrowFooter(table);
-		LWLockRelease(&arrow_metadata_state->lock_slots[index]);
+		ArrowGpuBuffer *gpubuf = dlist_container(ArrowGpuBuffer,
+												 lru_chain, iter.cur);
+		if (gpubuf->cuda_dindex == cuda_dindex)
+			usage += gpubuf->nbytes;
 	}
-	PG_CATCH();
+	/* evict the least recently used ones, if needed */
+	dlist_foreach_modify(iter, &arrow_metadata_state->gpubuf_lru_list)
 	{
-		if (mvcc)
-			pfree(mvcc);
-		PG_RE_THROW();
+		ArrowGpuBuffer *gpubuf = dlist_container(ArrowGpuBuffer,
+												 lru_chain, iter.cur);
+		LWLock	   *lock;
+		bool		has_lock;
+
+		if (usage + nbytes <= budget)
+			break;
+		if (gpubuf->cuda_dindex != cuda_dindex ||
+			!gpubuf->pinned ||
+			pg_atomic_read_u32(&gpubuf->refcnt) != 1)
+			continue;
+		lock = &arrow_metadata_state->gpubuf_locks[gpubuf->hash %
+												   ARROW_GPUBUF_HASH_NSLOTS];
+		has_lock = LWLockHeldByMe(lock);
+		if (!has_lock && !LWLockConditionalAcquire(lock, LW_EXCLUSIVE))
+			continue;
+		/* check again under the lock */
+		if (gpubuf->pinned && pg_atomic_read_u32(&gpubuf->refcnt) == 1)
+		{
+			elog(DEBUG2, "arrow GPU buffer [%s] was evicted", gpubuf->ident);
+			usage -= gpubuf->nbytes;
+			__freeArrowGpuBuffer(gpubuf);
+		}
+		if (!has_lock)
+			LWLockRelease(lock);
 	}
-	PG_END_TRY();
+	retval = (usage + nbytes <= budget);
+	LWLockRelease(&arrow_metadata_state->gpubuf_lru_lock);
+
+	return retval;
 }
 
 /*
- * TRUNCATE support
+ * registerArrowGpuBuffer
+ *
+ * NOTE: caller must have exclusive lock on gpubuf_locks[]
  */
 static void
-__arrowExecTruncateRelation(Relation frel)
+registerArrowGpuBuffer(ArrowGpuBuffer *gpubuf)
 {
-	TupleDesc	tupdesc = RelationGetDescr(frel);
-	Oid			frel_oid = RelationGetRelid(frel);
-	ForeignTable *ft = GetForeignTable(frel_oid);
-	arrowWriteRedoLog *redo;
-	struct stat	stat_buf;
-	MetadataCacheKey key;
-	List	   *filesList;
-	SQLtable   *table;
-	const char *path_name;
-	const char *dir_name;
-	const char *file_name;
-	size_t		main_sz;
-	int			dirfd = -1;
-	int			fdesc = -1;
-	int			nbytes;
-	char		path[MAXPGPATH];
-	bool		writable;
-
-	filesList = __arrowFdwExtractFilesList(ft->options,
-										   NULL,
-										   &writable);
-	if (!writable)
-		elog(ERROR, "arrow_fdw: foreign table \"%s\" is not writable",
-			 RelationGetRelationName(frel));
-	Assert(list_length(filesList) == 1);
-	path_name = strVal(linitial(filesList));
-	if (stat(path_name, &stat_buf) != 0)
-		elog(ERROR, "failed on stat('%s'): %m", path_name);
-	memset(&key, 0, sizeof(key));
-	key.st_dev = stat_buf.st_dev;
-	key.st_ino = stat_buf.st_ino;
-	key.hash = hash_any((unsigned char *)&key,
-						offsetof(MetadataCacheKey, hash));
-	/* build SQLtable to write out schema */
-	table = palloc0(offsetof(SQLtable, columns[tupdesc->natts]));
-	setupArrowSQLbufferSchema(table, tupdesc);
+	int			index = gpubuf->hash % ARROW_GPUBUF_HASH_NSLOTS;
 
-	/* create REDO log entry */
-	main_sz = MAXALIGN(offsetof(arrowWriteRedoLog, footer_backup));
-	redo = MemoryContextAllocZero(CacheMemoryContext,
-								  main_sz + strlen(path_name) + 1);
-	redo->key    = key;
-	redo->xid    = GetCurrentTransactionId();
-	redo->cid    = GetCurrentCommandId(true);
-	redo->pathname = (char *)redo + main_sz;
-	strcpy(redo->pathname, path_name);
-	redo->is_truncate = true;
+	dlist_push_tail(&arrow_metadata_state->gpubuf_slots[index],
+					&gpubuf->chain);
+	LWLockAcquire(&arrow_metadata_state->gpubuf_lru_lock, LW_EXCLUSIVE);
+	gpubuf->last_used = GetCurrentTimestamp();
+	dlist_push_tail(&arrow_metadata_state->gpubuf_lru_list,
+					&gpubuf->lru_chain);
+	LWLockRelease(&arrow_metadata_state->gpubuf_lru_lock);
+}
 
-	/* open directory of the arrow file (must have write permission) */
-	dir_name = dirname(pstrdup(path_name));
-	file_name = basename(pstrdup(path_name));
-	dirfd = open(dir_name, O_RDONLY | O_DIRECTORY);
-	if (dirfd < 0)
+/*
+ * putAllArrowGpuBuffer - callback function when session is closed
+ */
+static void
+putAllArrowGpuBuffer(int code, Datum arg)
+{
+	/*
+	 * In case of urgent termination, we shall not touch existing GPU
+	 * buffer any more. It shall be destructed due to process termination
+	 * of GPU memory keeper.
+	 */
+	if (code != 0)
+		return;
+	
+	while (!dlist_is_empty(&arrow_gpu_buffer_tracker_list))
 	{
-		pfree(redo);
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not open directory '%s': %m", dir_name)));
+		ArrowGpuBufferTracker *tracker;
+		dlist_node *dnode;
+		uint32		index;
+		LWLock	   *lock;
+
+		dnode = dlist_pop_head_node(&arrow_gpu_buffer_tracker_list);
+		tracker = dlist_container(ArrowGpuBufferTracker, chain, dnode);
+		index = tracker->gpubuf->hash % ARROW_GPUBUF_HASH_NSLOTS;
+		lock = &arrow_metadata_state->gpubuf_locks[index];
+
+		LWLockAcquire(lock, LW_EXCLUSIVE);
+		putArrowGpuBuffer(tracker->gpubuf);
+		LWLockRelease(lock);
+
+		elog(DEBUG2, "arrow GPU buffer [%s] was released", tracker->ident);
+		
+		pfree(tracker);
 	}
+}
 
-	PG_TRY();
-	{
-		/* create an empty file */
-	retry:
-		redo->suffix = random();
-		snprintf(path, sizeof(path), "%s.%u.backup",
-				 file_name, redo->suffix);
-		fdesc = openat(dirfd, path, O_RDWR | O_CREAT | O_EXCL, 0600);
-		if (fdesc < 0)
-		{
-			if (errno == EEXIST)
-				goto retry;
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not create a file '%s' at '%s': %m",
-							path, dir_name)));
-		}
+/*
+ * arrowFdwLookupGpuBuffers
+ *
+ * It looks up the GPU buffers in ARROW_GPUBUF_FORMAT__ARROW format, which are
+ * built on the same device of the GpuContext, and keep all the referenced
+ * columns of the latest arrow files. Found buffers are referenced and mapped
+ * on the GpuContext until end of the scan.
+ */
+static void
+arrowFdwLookupGpuBuffers(ArrowFdwState *af_state,
+						 Relation relation,
+						 GpuContext *gcontext)
+{
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	Oid			frel_oid = RelationGetRelid(relation);
+	struct timespec timestamp;
+	uint64		nrows = 0;
+	ListCell   *lc;
+	int			i, k;
+	CUresult	rc;
 
-		/* write out an empty arrow file */
-		table->filename = path;
-		table->fdesc = fdesc;
-		nbytes = __writeFile(table->fdesc, "ARROW1\0\0", 8);
-		if (nbytes != 8)
-			elog(ERROR, "failed on __writeFile('%s'): %m", path);
-		writeArrowSchema(table);
-		writeArrowFooter(table);
+	af_state->gpubuf_checked = true;
+	/* GPU buffer is built on all the files, so index of RecordBatches
+	 * does not match if some files are pruned */
+	if (!arrow_gpu_buffer_scan_enabled ||
+		bms_is_empty(af_state->referenced) ||
+		af_state->nfiles_pruned > 0 ||
+		af_state->num_rbatches == 0)
+		return;
 
-		/* swap two files atomically */
-		if (renameat2(dirfd, file_name,
-					  dirfd, path, RENAME_EXCHANGE) != 0)
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("failed to swap '%s' and '%s' at '%s': %m",
-							file_name, path, dir_name)));
+	memset(&timestamp, 0, sizeof(struct timespec));
+	af_state->rbatch_row_offset = palloc(sizeof(uint64) *
+										 (af_state->num_rbatches + 1));
+	for (i=0; i < af_state->num_rbatches; i++)
+	{
+		RecordBatchState *rb_state = af_state->rbatches[i];
+
+		if (timespec_comp(&rb_state->stat_buf.st_mtim, &timestamp) > 0)
+			timestamp = rb_state->stat_buf.st_mtim;
+		if (timespec_comp(&rb_state->stat_buf.st_ctim, &timestamp) > 0)
+			timestamp = rb_state->stat_buf.st_ctim;
+		af_state->rbatch_row_offset[i] = nrows;
+		nrows += rb_state->rb_nitems;
 	}
-	PG_CATCH();
+	af_state->rbatch_row_offset[i] = nrows;
+
+	for (i=0; i < ARROW_GPUBUF_HASH_NSLOTS; i++)
 	{
-		if (fdesc >= 0)
+		LWLock	   *lock = &arrow_metadata_state->gpubuf_locks[i];
+		dlist_iter	iter;
+
+		LWLockAcquire(lock, LW_SHARED);
+		dlist_foreach(iter, &arrow_metadata_state->gpubuf_slots[i])
 		{
-			unlinkat(dirfd, path, 0);
-			close(fdesc);
+			ArrowGpuBuffer *gpubuf = dlist_container(ArrowGpuBuffer,
+													 chain, iter.cur);
+			arrowGpuBufferRef *gbref;
+			uint32		rb_count;
+			size_t		nullmap_len;
+			size_t		offset = 0;
+			int			attidx;
+
+			if (gpubuf->frel_oid != frel_oid ||
+				gpubuf->format != ARROW_GPUBUF_FORMAT__ARROW ||
+				gpubuf->cuda_dindex != gcontext->cuda_dindex ||
+				timespec_comp(&gpubuf->timestamp, &timestamp) != 0)
+				continue;
+			rb_count = (gpubuf->rb_count > 0
+						? gpubuf->rb_count
+						: af_state->num_rbatches - gpubuf->rb_begin);
+			if ((uint64)gpubuf->rb_begin + rb_count > af_state->num_rbatches ||
+				(af_state->rbatch_row_offset[gpubuf->rb_begin + rb_count] -
+				 af_state->rbatch_row_offset[gpubuf->rb_begin]) != gpubuf->nrooms)
+				continue;
+			/* all the referenced columns must be kept */
+			for (attidx = bms_next_member(af_state->referenced, -1);
+				 attidx >= 0;
+				 attidx = bms_next_member(af_state->referenced, attidx))
+			{
+				int		anum = attidx + FirstLowInvalidHeapAttributeNumber;
+
+				for (k=0; k < gpubuf->nattrs; k++)
+				{
+					if (gpubuf->attnums[k] == anum)
+						break;
+				}
+				if (k == gpubuf->nattrs)
+					break;
+			}
+			if (attidx >= 0)
+				continue;
+
+			gbref = MemoryContextAllocZero(TopMemoryContext,
+										   offsetof(arrowGpuBufferRef,
+													values_offset[gpubuf->nattrs]));
+			/* see BuildArrowGpuBufferColumns for the layout */
+			nullmap_len = ARROWALIGN((gpubuf->nrooms +
+									  BITS_PER_BYTE - 1) / BITS_PER_BYTE);
+			for (k=0; k < gpubuf->nattrs; k++)
+			{
+				Form_pg_attribute attr;
+
+				if (gpubuf->attnums[k] < 1 ||
+					gpubuf->attnums[k] > tupdesc->natts)
+					break;
+				attr = tupleDescAttr(tupdesc, gpubuf->attnums[k] - 1);
+				if (attr->attisdropped || attr->attlen <= 0)
+					break;
+				offset += nullmap_len;
+				gbref->values_offset[k] = offset;
+				offset += ARROWALIGN(attr->attlen * gpubuf->nrooms);
+			}
+			if (k < gpubuf->nattrs || offset != gpubuf->nbytes)
+			{
+				/* table definition might be altered */
+				pfree(gbref);
+				continue;
+			}
+			gbref->owner = af_state;
+			gbref->gpubuf = gpubuf;
+			gbref->gcontext = gcontext;
+			gbref->rb_begin = gpubuf->rb_begin;
+			gbref->rb_count = rb_count;
+
+			pg_atomic_fetch_add_u32(&gpubuf->refcnt, 1);
+			dlist_push_tail(&arrow_gpu_buffer_scan_refs, &gbref->chain);
+			af_state->gpubuf_refs = lappend(af_state->gpubuf_refs, gbref);
 		}
-		close(dirfd);
-		pfree(redo);
-		PG_RE_THROW();
+		LWLockRelease(lock);
 	}
-	PG_END_TRY();
-	close(fdesc);
-	close(dirfd);
 
-	/* save the REDO log entry */
-	dlist_push_head(&arrow_write_redo_list, &redo->chain);
+	foreach (lc, af_state->gpubuf_refs)
+	{
+		arrowGpuBufferRef *gbref = lfirst(lc);
+		ArrowGpuBuffer *gpubuf = gbref->gpubuf;
+
+		/* move to the tail of LRU list */
+		LWLockAcquire(&arrow_metadata_state->gpubuf_lru_lock, LW_EXCLUSIVE);
+		gpubuf->last_used = GetCurrentTimestamp();
+		dlist_delete(&gpubuf->lru_chain);
+		dlist_push_tail(&arrow_metadata_state->gpubuf_lru_list,
+						&gpubuf->lru_chain);
+		LWLockRelease(&arrow_metadata_state->gpubuf_lru_lock);
+
+		rc = gpuIpcOpenMemHandle(gcontext,
+								 &gbref->m_gbuf,
+								 gpubuf->ipc_mhandle,
+								 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+		elog(DEBUG2, "arrow GPU buffer [%s] is referenced by scan",
+			 gpubuf->ident);
+	}
 }
 
 /*
- * pgstrom_arrow_fdw_truncate
+ * arrowFdwReleaseGpuBuffers
+ *
+ * It releases the GPU buffers referenced by the scan. If @af_state is NULL,
+ * all the remaining references are released at end of the transaction; the
+ * GpuContext shall unmap the buffers by itself in this case.
  */
-Datum
-pgstrom_arrow_fdw_truncate(PG_FUNCTION_ARGS)
+static void
+arrowFdwReleaseGpuBuffers(ArrowFdwState *af_state)
 {
-	Oid			frel_oid = PG_GETARG_OID(0);
-	Relation	frel;
-	FdwRoutine *routine;
-
-	frel = table_open(frel_oid, AccessExclusiveLock);
-	if (frel->rd_rel->relkind != RELKIND_FOREIGN_TABLE)
-		ereport(ERROR,
-				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
-				 errmsg("\"%s\" is not arrow_fdw foreign table",
-						RelationGetRelationName(frel))));
-	routine = GetFdwRoutineForRelation(frel, false);
-	if (memcmp(routine, &pgstrom_arrow_fdw_routine, sizeof(FdwRoutine)) != 0)
-		ereport(ERROR,
-				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
-				 errmsg("\"%s\" is not arrow_fdw foreign table",
-						RelationGetRelationName(frel))));
-	__arrowExecTruncateRelation(frel);
+	dlist_mutable_iter iter;
 
-	table_close(frel, NoLock);
+	dlist_foreach_modify(iter, &arrow_gpu_buffer_scan_refs)
+	{
+		arrowGpuBufferRef *gbref = dlist_container(arrowGpuBufferRef,
+												   chain, iter.cur);
+		ArrowGpuBuffer *gpubuf = gbref->gpubuf;
+		LWLock	   *lock;
+		CUresult	rc;
 
-	PG_RETURN_VOID();
-}
-PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_truncate);
+		if (af_state)
+		{
+			if (gbref->owner != af_state)
+				continue;
+			if (gbref->m_gbuf != 0UL)
+			{
+				rc = gpuIpcCloseMemHandle(gbref->gcontext, gbref->m_gbuf);
+				if (rc != CUDA_SUCCESS)
+					elog(WARNING, "failed on gpuIpcCloseMemHandle: %s",
+						 errorText(rc));
+			}
+		}
+		dlist_delete(&gbref->chain);
 
-static void
-__applyArrowTruncateRedoLog(arrowWriteRedoLog *redo, bool is_commit)
-{
-	char		backup[MAXPGPATH];
+		lock = &arrow_metadata_state->gpubuf_locks[gpubuf->hash %
+												   ARROW_GPUBUF_HASH_NSLOTS];
+		LWLockAcquire(lock, LW_EXCLUSIVE);
+		putArrowGpuBuffer(gpubuf);
+		LWLockRelease(lock);
 
-	snprintf(backup, MAXPGPATH, "%s.%u.backup",
-			 redo->pathname, redo->suffix);
-	if (is_commit)
-	{
-		elog(DEBUG2, "arrow-redo: unlink [%s]", backup);
-		if (unlink(backup) != 0)
-			ereport(WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not remove truncated file \"%s\": %m",
-							backup),
-					 errhint("remove the \"%s\" manually", backup)));
+		pfree(gbref);
 	}
-	else
+	if (af_state)
 	{
-		elog(DEBUG2, "arrow-redo: rename [%s]->[%s]", backup, redo->pathname);
-		if (rename(backup, redo->pathname) != 0)
-			ereport(WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not restore backup file \"%s\": %m",
-							backup),
-					 errhint("please restore \"%s\" to \"%s\" manually",
-							 backup, redo->pathname)));
+		list_free(af_state->gpubuf_refs);
+		af_state->gpubuf_refs = NIL;
+		af_state->gpubuf_checked = false;
 	}
 }
 
-static void
-__applyArrowInsertRedoLog(arrowWriteRedoLog *redo, bool is_commit)
+/*
+ * BuildArrowGpuBufferCupy
+ */
+static ArrowGpuBuffer *
+BuildArrowGpuBufferCupy(Relation frel,
+						List *attNums,
+						List *rb_state_list,
+						struct timespec timestamp,
+						int cuda_dindex,
+						Oid element_oid,
+						size_t nrooms,
+						bool pinned)
 {
-	int		fdesc;
-	
-	if (is_commit)
-		return;
-
-	/* special case, if it was an empty file */
-	if (redo->footer_offset == 0 &&
-		redo->footer_length == 0)
-	{
-		if (unlink(redo->pathname) != 0)
-			ereport(WARNING,
-					(errcode_for_file_access(),
-					 errmsg("failed on truncate('%s'): %m", redo->pathname),
-					 errdetail("could not apply REDO image, therefore, garbages are still remained")));
-		return;
-	}
+	GpuContext *gcontext = NULL;
+	ArrowGpuBuffer *gpubuf = NULL;
+	int			min_dindex = (cuda_dindex >= 0 ? cuda_dindex : 0);
+	int			max_dindex = (cuda_dindex >= 0 ? cuda_dindex : numDevAttrs-1);
+	int			nattrs = list_length(attNums);
+	const char *np_typename;
+	size_t		unitsz;
+	size_t		nbytes;
+	char	   *mmap_ptr = NULL;
+	size_t		mmap_len = 0UL;
+	CUdeviceptr	gmem_ptr = 0UL;
+	CUipcMemHandle ipc_mhandle;
+	ListCell   *lc;
+	int			index;
+	CUresult	rc = CUDA_ERROR_NO_DEVICE;
+	bool		over_budget = false;
 
-	fdesc = open(redo->pathname, O_RDWR);
-	if (fdesc < 0)
+	/* get type name */
+	switch (element_oid)
 	{
-		ereport(WARNING,
-				(errcode_for_file_access(),
-				 errmsg("failed on open('%s'): %m", redo->pathname),
-				 errdetail("could not apply REDO image, therefore, arrow file might be corrupted")));
+		case INT2OID:
+			unitsz = sizeof(uint16);
+			np_typename = "int16";
+			break;
+		case FLOAT2OID:
+			unitsz = sizeof(uint16);
+			np_typename = "float16";
+			break;
+		case INT4OID:
+			unitsz = sizeof(uint32);
+			np_typename = "int32";
+			break;
+		case FLOAT4OID:
+			unitsz = sizeof(uint32);
+			np_typename = "float32";
+			break;
+		case INT8OID:
+			unitsz = sizeof(uint64);
+			np_typename = "int64";
+			break;
+		case FLOAT8OID:
+			unitsz = sizeof(uint64);
+			np_typename = "float64";
+			break;
+		default:
+			elog(ERROR, "not a supported data type: %s",
+				 format_type_be(element_oid));
 	}
-	else if (lseek(fdesc, redo->footer_offset, SEEK_SET) < 0)
+	
+	/*
+	 * Allocation of the preserved device memory
+	 */
+	nbytes = unitsz * nattrs * nrooms;
+	for (cuda_dindex =  min_dindex; cuda_dindex <= max_dindex; cuda_dindex++)
 	{
-		ereport(WARNING,
-				(errcode_for_file_access(),
-				 errmsg("failed on lseek('%s'): %m", redo->pathname),
-				 errdetail("could not apply REDO image, therefore, arrow file might be corrupted")));
+		if (!reserveArrowGpuBuffer(cuda_dindex, nbytes))
+		{
+			over_budget = true;
+			continue;
+		}
+		rc = gpuMemAllocPreserved(cuda_dindex,
+								  &ipc_mhandle,
+								  nbytes);
+		if (rc == CUDA_SUCCESS)
+			break;
 	}
-	else if (__writeFile(fdesc,
-						 redo->footer_backup,
-						 redo->footer_length) != redo->footer_length)
+	if (rc != CUDA_SUCCESS)
 	{
-		ereport(WARNING,
-				(errcode_for_file_access(),
-				 errmsg("failed on write('%s'): %m", redo->pathname),
-				 errdetail("could not apply REDO image, therefore, arrow file might be corrupted")));
+		if (over_budget)
+			elog(ERROR, "arrow_fdw: GPU buffer (%zu bytes) exceeds arrow_fdw.gpu_buffer_budget",
+				 nbytes);
+		elog(ERROR, "failed on gpuMemAllocPreserved: %s", errorText(rc));
 	}
-	else if (ftruncate(fdesc, (redo->footer_offset +
-							   redo->footer_length)) != 0)
+
+	PG_TRY();
 	{
-		ereport(WARNING,
-				(errcode_for_file_access(),
-				 errmsg("failed on ftruncate('%s'): %m", redo->pathname),
-				 errdetail("could not apply REDO image, therefore, arrow file might be corrupted")));
-	}
-	close(fdesc);
+		StringInfoData ident;
+		File		curr_filp = -1;
+		size_t		row_index = 0;
+		int			j = 0;
+
+		/*
+		 * Build identifier string
+		 */
+		initStringInfo(&ident);
+		appendStringInfo(&ident,
+						 "device_id=%d,bytesize=%zu,ipc_handle=",
+						 devAttrs[cuda_dindex].DEV_ID,
+						 nbytes);
+		enlargeStringInfo(&ident, 2 * sizeof(CUipcMemHandle));
+		hex_encode((const char *)&ipc_mhandle,
+				   sizeof(CUipcMemHandle),
+				   ident.data + ident.len);
+		ident.len += 2 * sizeof(CUipcMemHandle);
+		appendStringInfo(&ident,",format=cupy-%s,nitems=%zu,table_oid=%u",
+						 np_typename,
+						 nattrs * nrooms,
+						 RelationGetRelid(frel));
+		appendStringInfoString(&ident, ",attnums=");
+		foreach (lc, attNums)
+		{
+			if (lc != list_head(attNums))
+				appendStringInfoChar(&ident,' ');
+			appendStringInfo(&ident, "%d", lfirst_int(lc));
+		}
 
-	elog(DEBUG2, "arrow_fdw: REDO log applied (xid=%u, cid=%u, file=[%s], offset=%zu, length=%zu)", redo->xid, redo->cid, redo->pathname, redo->footer_offset, redo->footer_length);
-}
+		/*
+		 * setup ArrowGpuBuffer
+		 */
+		gpubuf = MemoryContextAllocZero(TopSharedMemoryContext,
+										MAXALIGN(offsetof(ArrowGpuBuffer,
+														  attnums[nattrs])) +
+										MAXALIGN(ident.len + 1));
+		pg_atomic_init_u32(&gpubuf->refcnt, pinned ? 2 : 1);
+		gpubuf->pinned = pinned;
+		gpubuf->cuda_dindex = cuda_dindex;
+		memcpy(&gpubuf->ipc_mhandle, &ipc_mhandle, sizeof(CUipcMemHandle));
+		gpubuf->timestamp = timestamp;
+		gpubuf->nbytes = nbytes;
+		gpubuf->nrooms = nrooms;
+		gpubuf->frel_oid = RelationGetRelid(frel);
+		gpubuf->format = ARROW_GPUBUF_FORMAT__CUPY;
+		gpubuf->nattrs = nattrs;
+		foreach (lc, attNums)
+			gpubuf->attnums[j++] = lfirst_int(lc);
+		gpubuf->hash = hash_any((unsigned char *)&gpubuf->frel_oid,
+								offsetof(ArrowGpuBuffer, attnums[nattrs]) -
+								offsetof(ArrowGpuBuffer, frel_oid));
+		gpubuf->ident = (char *)&gpubuf->attnums[nattrs];
+		strcpy(gpubuf->ident, ident.data);
 
-static void
-__cleanupArrowWriteMVCCLog(TransactionId curr_xid, dlist_head *mvcc_slot)
-{
-	dlist_mutable_iter iter;
+		/*
+		 * Open GPU device memory, and load the array from apache arrow files
+		 */
+		gcontext = AllocGpuContext(cuda_dindex, true, true, false);
+		rc = gpuIpcOpenMemHandle(gcontext,
+								 &gmem_ptr,
+								 gpubuf->ipc_mhandle,
+								 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+		foreach (lc, rb_state_list)
+		{
+			RecordBatchState *rb_state = lfirst(lc);
 
-	dlist_foreach_modify(iter, mvcc_slot)
-	{
-		arrowWriteMVCCLog *mvcc = dlist_container(arrowWriteMVCCLog,
-												  chain, iter.cur);
-		if (mvcc->xid == curr_xid)
+			if (rb_state->rb_compression >= 0)
+				elog(ERROR, "arrow_fdw: compressed RecordBatch cannot be exported to GPU buffer");
+			if (rb_state->fdesc != curr_filp)
+			{
+				if (mmap_ptr)
+				{
+					if (munmap(mmap_ptr, mmap_len) != 0)
+						elog(ERROR, "failed on munmap: %m");
+					mmap_ptr = NULL;
+				}
+				mmap_len = (rb_state->stat_buf.st_size +
+							PAGE_SIZE - 1) & ~PAGE_MASK;
+				mmap_ptr = mmap(NULL, mmap_len,
+								PROT_READ, MAP_SHARED,
+								FileGetRawDesc(rb_state->fdesc), 0);
+				if (mmap_ptr == MAP_FAILED)
+				{
+					mmap_ptr = NULL;
+					elog(ERROR, "failed on mmap: %m");
+				}
+				curr_filp = rb_state->fdesc;
+			}
+			/*
+			 * copy array to device memory
+			 */
+			for (j=0; j < gpubuf->nattrs; j++)
+			{
+				RecordBatchFieldState *column;
+				int			attnum = gpubuf->attnums[j];
+				size_t		hoffset = rb_state->rb_offset;
+				size_t		doffset;
+				size_t		length;
+				size_t		padding = 0;
+
+				Assert(attnum > 0 && attnum <= rb_state->ncols);
+				column = &rb_state->columns[attnum-1];
+				hoffset += column->values_offset;
+				
+				doffset = unitsz * (row_index + j * gpubuf->nrooms);
+				length = unitsz * Min(rb_state->rb_nitems, column->nitems);
+				if (length > column->values_length)
+					length = column->values_length;
+				if (length < unitsz * rb_state->rb_nitems)
+					padding = unitsz * rb_state->rb_nitems - length;
+				rc = cuMemcpyHtoD(gmem_ptr + doffset,
+								  mmap_ptr + hoffset,
+								  length);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+				if (padding > 0)
+				{
+					rc = cuMemsetD8(gmem_ptr + doffset + length, 0, padding);
+					if (rc != CUDA_SUCCESS)
+						elog(ERROR, "failed on cuMemsetD8: %s", errorText(rc));
+				}
+			}
+			row_index += rb_state->rb_nitems;
+		}
+		if (mmap_ptr)
 		{
-			dlist_delete(&mvcc->chain);
-			elog(DEBUG2, "arrow: release mvcc-log (st_dev=%u, st_ino=%u), xid=%u, cid=%u, record_batch=%u",
-				 (uint32)mvcc->key.st_dev, (uint32)mvcc->key.st_ino,
-				 (uint32)mvcc->xid, (uint32)mvcc->cid, mvcc->record_batch);
-			pfree(mvcc);
+			if (munmap(mmap_ptr, mmap_len) != 0)
+				elog(ERROR, "failed on munmap: %m");
 		}
+		rc = gpuIpcCloseMemHandle(gcontext, gmem_ptr);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on gpuIpcCloseMemHandle: %s",
+				 errorText(rc));
+		PutGpuContext(gcontext);
 	}
-}
-
-/*
- * __arrowFdwXactCallback
- */
-static void
-__arrowFdwXactCallback(TransactionId curr_xid, bool is_commit)
-{
-	arrowWriteRedoLog  *redo;
-	dlist_mutable_iter	iter;
-	CommandId			curr_cid = InvalidCommandId;
-	uint32				index;
-	bool				locked[ARROW_METADATA_HASH_NSLOTS];
-	LWLock			   *locks[ARROW_METADATA_HASH_NSLOTS];
-	uint32				lcount = 0;
-
-	if (curr_xid == InvalidTransactionId ||
-		dlist_is_empty(&arrow_write_redo_list))
-		return;
-
-	memset(locked, 0, sizeof(locked));
-	dlist_foreach_modify(iter, &arrow_write_redo_list)
+	PG_CATCH();
 	{
-		redo = dlist_container(arrowWriteRedoLog, chain, iter.cur);
-		if (redo->xid != curr_xid)
-			continue;
-		if (curr_cid != InvalidCommandId &&
-			curr_cid < redo->cid)
-			elog(WARNING, "Bug? Order of REDO log is not be correct. ABORT transaction might generate wrong image restored.");
-
-		index = redo->key.hash % ARROW_METADATA_HASH_NSLOTS;
-		if (!locked[index])
+		if (mmap_ptr)
 		{
-			LWLock	   *lock = &arrow_metadata_state->lock_slots[index];
-			dlist_head *slot = &arrow_metadata_state->mvcc_slots[index];
-
-			LWLockAcquire(lock, LW_EXCLUSIVE);
-			__cleanupArrowWriteMVCCLog(curr_xid, slot);
-			locked[index] = true;
-			locks[lcount++] = lock;
+			if (munmap(mmap_ptr, mmap_len) != 0)
+				elog(WARNING, "failed on munmap: %m");
 		}
-		if (redo->is_truncate)
-			__applyArrowTruncateRedoLog(redo, is_commit);
-		else
-			__applyArrowInsertRedoLog(redo, is_commit);
-
-		dlist_delete(&redo->chain);
-		pfree(redo);
+		if (gcontext)
+			PutGpuContext(gcontext);
+		if (gpubuf)
+			pfree(gpubuf);
+		rc = gpuMemFreePreserved(cuda_dindex, ipc_mhandle);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on gpuMemFreePreserved: %s",
+				 errorText(rc));
+		PG_RE_THROW();
 	}
+	PG_END_TRY();
 
-	for (index=0; index < lcount; index++)
-		LWLockRelease(locks[index]);
-}
-
-/*
- * arrowFdwXactCallback
- */
-static void
-arrowFdwXactCallback(XactEvent event, void *arg)
-{
-	TransactionId	curr_xid = GetCurrentTransactionIdIfAny();
-
-	if (event == XACT_EVENT_COMMIT)
-		__arrowFdwXactCallback(curr_xid, true);
-	else if (event == XACT_EVENT_ABORT)
-		__arrowFdwXactCallback(curr_xid, false);
-}
-
-/*
- * arrowFdwSubXactCallback
- */
-static void
-arrowFdwSubXactCallback(SubXactEvent event, SubTransactionId mySubid,
-						SubTransactionId parentSubid, void *arg)
-{
-	TransactionId	curr_xid = GetCurrentTransactionIdIfAny();
-
-	if (event == SUBXACT_EVENT_COMMIT_SUB)
-		__arrowFdwXactCallback(curr_xid, true);
-	else if (event == SUBXACT_EVENT_ABORT_SUB)
-		__arrowFdwXactCallback(curr_xid, false);
+	registerArrowGpuBuffer(gpubuf);
+	return gpubuf;
 }
 
 /*
- * putArrowGpuBuffer
+ * __copyArrowGpuBufferNullmap
  *
- * NOTE: caller must have exclusive lock on gpubuf_locks[]
+ * It copies 'nitems' bits of the nullmap to 'dst' from the bit position
+ * 'dst_index'. NULL 'src' means all the items are valid.
  */
 static void
-putArrowGpuBuffer(ArrowGpuBuffer *gpubuf)
+__copyArrowGpuBufferNullmap(uint8 *dst, size_t dst_index,
+							const uint8 *src, size_t nitems)
 {
-	CUresult	rc;
-	uint32 count;
+	size_t		i = 0;
 
-	if ((count = pg_atomic_sub_fetch_u32(&gpubuf->refcnt, 1)) == 0)
+	if ((dst_index & 7) == 0)
 	{
-		rc = gpuMemFreePreserved(gpubuf->cuda_dindex,
-								 gpubuf->ipc_mhandle);
-		if (rc != CUDA_SUCCESS)
-			elog(WARNING, "failed on gpuMemFreePreserved: %s", errorText(rc));
-		dlist_delete(&gpubuf->chain);
-		pfree(gpubuf);
-	}
-}
+		size_t	nbytes = nitems / BITS_PER_BYTE;
 
-/*
- * putAllArrowGpuBuffer - callback function when session is closed
- */
-static void
-putAllArrowGpuBuffer(int code, Datum arg)
-{
-	/*
-	 * In case of urgent termination, we shall not touch existing GPU
-	 * buffer any more. It shall be destructed due to process termination
-	 * of GPU memory keeper.
-	 */
-	if (code != 0)
-		return;
-	
-	while (!dlist_is_empty(&arrow_gpu_buffer_tracker_list))
+		if (src)
+			memcpy(dst + dst_index / BITS_PER_BYTE, src, nbytes);
+		else
+			memset(dst + dst_index / BITS_PER_BYTE, 0xff, nbytes);
+		i = nbytes * BITS_PER_BYTE;
+	}
+	for (; i < nitems; i++)
 	{
-		ArrowGpuBufferTracker *tracker;
-		dlist_node *dnode;
-		uint32		index;
-		LWLock	   *lock;
-
-		dnode = dlist_pop_head_node(&arrow_gpu_buffer_tracker_list);
-		tracker = dlist_container(ArrowGpuBufferTracker, chain, dnode);
-		index = tracker->gpubuf->hash % ARROW_GPUBUF_HASH_NSLOTS;
-		lock = &arrow_metadata_state->gpubuf_locks[index];
-
-		LWLockAcquire(lock, LW_EXCLUSIVE);
-		putArrowGpuBuffer(tracker->gpubuf);
-		LWLockRelease(lock);
+		size_t	k = dst_index + i;
 
-		elog(DEBUG2, "arrow GPU buffer [%s] was released", tracker->ident);
-		
-		pfree(tracker);
+		if (!src || (src[i >> 3] & (1 << (i & 7))) != 0)
+			dst[k >> 3] |=  (1 << (k & 7));
+		else
+			dst[k >> 3] &= ~(1 << (k & 7));
 	}
 }
 
 /*
- * BuildArrowGpuBufferCupy
+ * BuildArrowGpuBufferColumns
+ *
+ * It loads the specified columns onto the preserved device memory in the
+ * columnar layout; each column has its own nullmap (in Arrow's bit order)
+ * and values array. Data type and offsets of the arrays are embedded in
+ * the identifier, so consumers can map each column with its own dtype.
+ * If rb_count > 0, it loads only the RecordBatches in the range.
  */
 static ArrowGpuBuffer *
-BuildArrowGpuBufferCupy(Relation frel,
-						List *attNums,
-						List *rb_state_list,
-						struct timespec timestamp,
-						int cuda_dindex,
-						Oid element_oid,
-						size_t nrooms,
-						bool pinned)
+BuildArrowGpuBufferColumns(Relation frel,
+						   List *attNums,
+						   List *rb_state_list,
+						   struct timespec timestamp,
+						   int cuda_dindex,
+						   size_t nrooms,
+						   uint32 rb_begin,
+						   uint32 rb_count,
+						   bool pinned)
 {
+	TupleDesc	tupdesc = RelationGetDescr(frel);
 	GpuContext *gcontext = NULL;
 	ArrowGpuBuffer *gpubuf = NULL;
 	int			min_dindex = (cuda_dindex >= 0 ? cuda_dindex : 0);
 	int			max_dindex = (cuda_dindex >= 0 ? cuda_dindex : numDevAttrs-1);
 	int			nattrs = list_length(attNums);
-	const char *np_typename;
-	size_t		unitsz;
-	size_t		nbytes;
+	size_t	   *unitsz = alloca(sizeof(size_t) * nattrs);
+	const char **np_typename = alloca(sizeof(const char *) * nattrs);
+	size_t	   *nullmap_offset = alloca(sizeof(size_t) * nattrs);
+	size_t	   *values_offset = alloca(sizeof(size_t) * nattrs);
+	size_t		nullmap_len;
+	uint8	   *nullmap = NULL;
+	size_t		nbytes = 0;
 	char	   *mmap_ptr = NULL;
 	size_t		mmap_len = 0UL;
 	CUdeviceptr	gmem_ptr = 0UL;
 	CUipcMemHandle ipc_mhandle;
 	ListCell   *lc;
-	int			index;
+	int			index, j = 0;
 	CUresult	rc = CUDA_ERROR_NO_DEVICE;
+	bool		over_budget = false;
 
-	/* get type name */
-	switch (element_oid)
+	/* device memory layout */
+	nullmap_len = ARROWALIGN((nrooms + BITS_PER_BYTE - 1) / BITS_PER_BYTE);
+	foreach (lc, attNums)
 	{
-		case INT2OID:
-			unitsz = sizeof(uint16);
-			np_typename = "int16";
-			break;
-		case FLOAT2OID:
-			unitsz = sizeof(uint16);
-			np_typename = "float16";
-			break;
-		case INT4OID:
-			unitsz = sizeof(uint32);
-			np_typename = "int32";
-			break;
-		case FLOAT4OID:
-			unitsz = sizeof(uint32);
-			np_typename = "float32";
-			break;
-		case INT8OID:
-			unitsz = sizeof(uint64);
-			np_typename = "int64";
-			break;
-		case FLOAT8OID:
-			unitsz = sizeof(uint64);
-			np_typename = "float64";
-			break;
-		default:
-			elog(ERROR, "not a supported data type: %s",
-				 format_type_be(element_oid));
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, lfirst_int(lc) - 1);
+
+		switch (attr->atttypid)
+		{
+			case INT2OID:
+				unitsz[j] = sizeof(uint16);
+				np_typename[j] = "int16";
+				break;
+			case FLOAT2OID:
+				unitsz[j] = sizeof(uint16);
+				np_typename[j] = "float16";
+				break;
+			case INT4OID:
+				unitsz[j] = sizeof(uint32);
+				np_typename[j] = "int32";
+				break;
+			case FLOAT4OID:
+				unitsz[j] = sizeof(uint32);
+				np_typename[j] = "float32";
+				break;
+			case INT8OID:
+				unitsz[j] = sizeof(uint64);
+				np_typename[j] = "int64";
+				break;
+			case FLOAT8OID:
+				unitsz[j] = sizeof(uint64);
+				np_typename[j] = "float64";
+				break;
+			default:
+				elog(ERROR, "not a supported data type: %s",
+					 format_type_be(attr->atttypid));
+		}
+		nullmap_offset[j] = nbytes;
+		nbytes += nullmap_len;
+		values_offset[j] = nbytes;
+		nbytes += ARROWALIGN(unitsz[j] * nrooms);
+		j++;
 	}
-	
+
 	/*
 	 * Allocation of the preserved device memory
 	 */
-	nbytes = unitsz * nattrs * nrooms;
 	for (cuda_dindex =  min_dindex; cuda_dindex <= max_dindex; cuda_dindex++)
 	{
+		if (!reserveArrowGpuBuffer(cuda_dindex, nbytes))
+		{
+			over_budget = true;
+			continue;
+		}
 		rc = gpuMemAllocPreserved(cuda_dindex,
 								  &ipc_mhandle,
 								  nbytes);
@@ -4779,14 +10310,18 @@ BuildArrowGpuBufferCupy(Relation frel,
 			break;
 	}
 	if (rc != CUDA_SUCCESS)
+	{
+		if (over_budget)
+			elog(ERROR, "arrow_fdw: GPU buffer (%zu bytes) exceeds arrow_fdw.gpu_buffer_budget",
+				 nbytes);
 		elog(ERROR, "failed on gpuMemAllocPreserved: %s", errorText(rc));
+	}
 
 	PG_TRY();
 	{
 		StringInfoData ident;
 		File		curr_filp = -1;
 		size_t		row_index = 0;
-		int			j = 0;
 
 		/*
 		 * Build identifier string
@@ -4801,8 +10336,7 @@ BuildArrowGpuBufferCupy(Relation frel,
 				   sizeof(CUipcMemHandle),
 				   ident.data + ident.len);
 		ident.len += 2 * sizeof(CUipcMemHandle);
-		appendStringInfo(&ident,",format=cupy-%s,nitems=%zu,table_oid=%u",
-						 np_typename,
+		appendStringInfo(&ident,",format=arrow,nitems=%zu,table_oid=%u",
 						 nattrs * nrooms,
 						 RelationGetRelid(frel));
 		appendStringInfoString(&ident, ",attnums=");
@@ -4812,6 +10346,19 @@ BuildArrowGpuBufferCupy(Relation frel,
 				appendStringInfoChar(&ident,' ');
 			appendStringInfo(&ident, "%d", lfirst_int(lc));
 		}
+		if (rb_count > 0)
+			appendStringInfo(&ident, ",rb_range=%u:%u",
+							 rb_begin, rb_count);
+		appendStringInfoString(&ident, ",columns=");
+		for (j=0; j < nattrs; j++)
+		{
+			if (j > 0)
+				appendStringInfoChar(&ident,' ');
+			appendStringInfo(&ident, "%s:%zu:%zu",
+							 np_typename[j],
+							 nullmap_offset[j],
+							 values_offset[j]);
+		}
 
 		/*
 		 * setup ArrowGpuBuffer
@@ -4828,8 +10375,11 @@ BuildArrowGpuBufferCupy(Relation frel,
 		gpubuf->nbytes = nbytes;
 		gpubuf->nrooms = nrooms;
 		gpubuf->frel_oid = RelationGetRelid(frel);
-		gpubuf->format = ARROW_GPUBUF_FORMAT__CUPY;
+		gpubuf->format = ARROW_GPUBUF_FORMAT__ARROW;
+		gpubuf->rb_begin = rb_begin;
+		gpubuf->rb_count = rb_count;
 		gpubuf->nattrs = nattrs;
+		j = 0;
 		foreach (lc, attNums)
 			gpubuf->attnums[j++] = lfirst_int(lc);
 		gpubuf->hash = hash_any((unsigned char *)&gpubuf->frel_oid,
@@ -4838,8 +10388,13 @@ BuildArrowGpuBufferCupy(Relation frel,
 		gpubuf->ident = (char *)&gpubuf->attnums[nattrs];
 		strcpy(gpubuf->ident, ident.data);
 
+		/* nullmap is built on the host, then copied to the device */
+		nullmap = MemoryContextAllocHuge(CurrentMemoryContext,
+										 nullmap_len * nattrs);
+		memset(nullmap, 0, nullmap_len * nattrs);
+
 		/*
-		 * Open GPU device memory, and load the array from apache arrow files
+		 * Open GPU device memory, and load the arrays from apache arrow files
 		 */
 		gcontext = AllocGpuContext(cuda_dindex, true, true, false);
 		rc = gpuIpcOpenMemHandle(gcontext,
@@ -4852,6 +10407,8 @@ BuildArrowGpuBufferCupy(Relation frel,
 		{
 			RecordBatchState *rb_state = lfirst(lc);
 
+			if (rb_state->rb_compression >= 0)
+				elog(ERROR, "arrow_fdw: compressed RecordBatch cannot be exported to GPU buffer");
 			if (rb_state->fdesc != curr_filp)
 			{
 				if (mmap_ptr)
@@ -4872,30 +10429,44 @@ BuildArrowGpuBufferCupy(Relation frel,
 				}
 				curr_filp = rb_state->fdesc;
 			}
-			/*
-			 * copy array to device memory
-			 */
-			for (j=0; j < gpubuf->nattrs; j++)
+
+			for (j=0; j < nattrs; j++)
 			{
 				RecordBatchFieldState *column;
 				int			attnum = gpubuf->attnums[j];
-				size_t		hoffset = rb_state->rb_offset;
+				size_t		nvalids;
 				size_t		doffset;
 				size_t		length;
 				size_t		padding = 0;
 
 				Assert(attnum > 0 && attnum <= rb_state->ncols);
 				column = &rb_state->columns[attnum-1];
-				hoffset += column->values_offset;
-				
-				doffset = unitsz * (row_index + j * gpubuf->nrooms);
-				length = unitsz * Min(rb_state->rb_nitems, column->nitems);
+				/* nullmap */
+				nvalids = Min(rb_state->rb_nitems, column->nitems);
+				if (column->null_count == 0 || column->nullmap_length == 0)
+					__copyArrowGpuBufferNullmap(nullmap + j * nullmap_len,
+												row_index, NULL, nvalids);
+				else
+				{
+					nvalids = Min(nvalids, BITS_PER_BYTE *
+								  column->nullmap_length);
+					__copyArrowGpuBufferNullmap(nullmap + j * nullmap_len,
+												row_index,
+												(uint8 *)mmap_ptr +
+												rb_state->rb_offset +
+												column->nullmap_offset,
+												nvalids);
+				}
+				/* values */
+				doffset = values_offset[j] + unitsz[j] * row_index;
+				length = unitsz[j] * Min(rb_state->rb_nitems, column->nitems);
 				if (length > column->values_length)
 					length = column->values_length;
-				if (length < unitsz * rb_state->rb_nitems)
-					padding = unitsz * rb_state->rb_nitems - length;
+				if (length < unitsz[j] * rb_state->rb_nitems)
+					padding = unitsz[j] * rb_state->rb_nitems - length;
 				rc = cuMemcpyHtoD(gmem_ptr + doffset,
-								  mmap_ptr + hoffset,
+								  mmap_ptr + rb_state->rb_offset +
+								  column->values_offset,
 								  length);
 				if (rc != CUDA_SUCCESS)
 					elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
@@ -4912,7 +10483,17 @@ BuildArrowGpuBufferCupy(Relation frel,
 		{
 			if (munmap(mmap_ptr, mmap_len) != 0)
 				elog(ERROR, "failed on munmap: %m");
+			mmap_ptr = NULL;
+		}
+		for (j=0; j < nattrs; j++)
+		{
+			rc = cuMemcpyHtoD(gmem_ptr + nullmap_offset[j],
+							  nullmap + j * nullmap_len,
+							  nullmap_len);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
 		}
+		pfree(nullmap);
 		rc = gpuIpcCloseMemHandle(gcontext, gmem_ptr);
 		if (rc != CUDA_SUCCESS)
 			elog(WARNING, "failed on gpuIpcCloseMemHandle: %s",
@@ -4938,15 +10519,21 @@ BuildArrowGpuBufferCupy(Relation frel,
 	}
 	PG_END_TRY();
 
-	index = gpubuf->hash % ARROW_GPUBUF_HASH_NSLOTS;
-	dlist_push_tail(&arrow_metadata_state->gpubuf_slots[index],
-					&gpubuf->chain);
+	registerArrowGpuBuffer(gpubuf);
 	return gpubuf;
 }
 
+/*
+ * lookupOrBuildArrowGpuBuffer
+ *
+ * If rb_count > 0, only RecordBatches in [rb_begin, rb_begin + rb_count)
+ * of the foreign table are exported, and NULL is returned if rb_begin is
+ * out of the range.
+ */
 static text *
-lookupOrBuildArrowGpuBufferCupy(Relation frel, List *attNums,
-								Oid element_oid, int cuda_dindex, bool pinned)
+lookupOrBuildArrowGpuBuffer(Relation frel, List *attNums, int format,
+							Oid element_oid, int cuda_dindex,
+							uint32 rb_begin, uint32 rb_count, bool pinned)
 {
 	Oid				frel_oid = RelationGetRelid(frel);
 	ForeignTable   *ft = GetForeignTable(frel_oid);
@@ -4963,6 +10550,7 @@ lookupOrBuildArrowGpuBufferCupy(Relation frel, List *attNums,
 	dlist_mutable_iter iter;
 	ArrowGpuBuffer *gpubuf, *_key;
 	text		   *result = NULL;
+	uint32			rb_index = 0;
 
 	/*
 	 * Estimation of the data size
@@ -4984,15 +10572,27 @@ lookupOrBuildArrowGpuBufferCupy(Relation frel, List *attNums,
 		{
 			RecordBatchState *rb_state = lfirst(cell);
 
-			nrooms += rb_state->rb_nitems;
 			if (timespec_comp(&rb_state->stat_buf.st_mtim, &timestamp) > 0)
 				timestamp = rb_state->stat_buf.st_mtim;
 			if (timespec_comp(&rb_state->stat_buf.st_ctim, &timestamp) > 0)
 				timestamp = rb_state->stat_buf.st_ctim;
-			rb_state_list = lappend(rb_state_list, rb_state);
+			if (rb_count == 0 ||
+				(rb_index >= rb_begin && rb_index - rb_begin < rb_count))
+			{
+				nrooms += rb_state->rb_nitems;
+				rb_state_list = lappend(rb_state_list, rb_state);
+			}
+			rb_index++;
 		}
 		fdescList = lappend_int(fdescList, filp);
 	}
+	if (rb_count > 0 && rb_state_list == NIL)
+	{
+		/* end of the batches */
+		foreach (lc, fdescList)
+			FileClose((File)lfirst_int(lc));
+		return NULL;
+	}
 	if (nrooms == 0)
 		elog(ERROR, "arrow_fdw: foreign table '%s' is empty",
 			 RelationGetRelationName(frel));
@@ -5004,7 +10604,9 @@ lookupOrBuildArrowGpuBufferCupy(Relation frel, List *attNums,
 	memset(_key, 0, offsetof(ArrowGpuBuffer, attnums[nattrs]));
 
 	_key->frel_oid = frel_oid;
-	_key->format = ARROW_GPUBUF_FORMAT__CUPY;
+	_key->format = format;
+	_key->rb_begin = rb_begin;
+	_key->rb_count = rb_count;
 	_key->nattrs = nattrs;
 	j = 0;
 	foreach (lc, attNums)
@@ -5023,6 +10625,8 @@ retry:
 		if (gpubuf->hash == _key->hash &&
 			gpubuf->frel_oid == _key->frel_oid &&
 			gpubuf->format == _key->format &&
+			gpubuf->rb_begin == _key->rb_begin &&
+			gpubuf->rb_count == _key->rb_count &&
 			gpubuf->nattrs == _key->nattrs &&
             memcmp(gpubuf->attnums, _key->attnums,
 				   sizeof(AttrNumber) * _key->nattrs) == 0 &&
@@ -5055,6 +10659,14 @@ retry:
 			{
 				pg_atomic_fetch_add_u32(&gpubuf->refcnt, 1);
 			}
+			/* move to the tail of LRU list */
+			LWLockAcquire(&arrow_metadata_state->gpubuf_lru_lock,
+						  LW_EXCLUSIVE);
+			gpubuf->last_used = GetCurrentTimestamp();
+			dlist_delete(&gpubuf->lru_chain);
+			dlist_push_tail(&arrow_metadata_state->gpubuf_lru_list,
+							&gpubuf->lru_chain);
+			LWLockRelease(&arrow_metadata_state->gpubuf_lru_lock);
 			goto found;
 		}
 	}
@@ -5066,14 +10678,25 @@ retry:
 		has_exclusive = true;
 		goto retry;
 	}
-	gpubuf = BuildArrowGpuBufferCupy(frel,
-									 attNums,
-									 rb_state_list,
-									 timestamp,
-									 cuda_dindex,
-									 element_oid,
-									 nrooms,
-									 pinned);
+	if (format == ARROW_GPUBUF_FORMAT__ARROW)
+		gpubuf = BuildArrowGpuBufferColumns(frel,
+											attNums,
+											rb_state_list,
+											timestamp,
+											cuda_dindex,
+											nrooms,
+											rb_begin,
+											rb_count,
+											pinned);
+	else
+		gpubuf = BuildArrowGpuBufferCupy(frel,
+										 attNums,
+										 rb_state_list,
+										 timestamp,
+										 cuda_dindex,
+										 element_oid,
+										 nrooms,
+										 pinned);
 	Assert(gpubuf->hash == _key->hash);
 found:
 	/* makes ArrowGpuBufferTracker */
@@ -5120,11 +10743,18 @@ found:
  * pgstrom.arrow_fdw_export_cupy[_pinned](regclass, -- oid of relation
  *                               text[],   -- name of attributes
  *                               int)      -- GPU device-id
+ *
+ * pgstrom.arrow_fdw_export_columns[_pinned] has identical arguments, but
+ * exports the columns in the columnar layout with per-column data types
+ * and nullmaps.
  */
-static Datum
+static text *
 __pgstrom_arrow_fdw_export_cupy(Oid frel_oid,
 								ArrayType *attNames,
 								int device_id,
+								int format,
+								uint32 rb_begin,
+								uint32 rb_count,
 								bool pinned)
 {
 	int32			cuda_dindex = -1;
@@ -5183,7 +10813,8 @@ __pgstrom_arrow_fdw_export_cupy(Oid frel_oid,
 				continue;
 			if (!OidIsValid(element_oid))
 				element_oid = attr->atttypid;
-			else if (element_oid != attr->atttypid)
+			else if (element_oid != attr->atttypid &&
+					 format == ARROW_GPUBUF_FORMAT__CUPY)
 				elog(ERROR, "multiple data types are mixtured in use");
 			attNums = lappend_int(attNums, attr->attnum);
 		}
@@ -5217,7 +10848,8 @@ __pgstrom_arrow_fdw_export_cupy(Oid frel_oid,
 			{
 				if (!OidIsValid(element_oid))
 					element_oid = attr->atttypid;
-				else if (element_oid != attr->atttypid)
+				else if (element_oid != attr->atttypid &&
+						 format == ARROW_GPUBUF_FORMAT__CUPY)
 					elog(ERROR, "multiple data types are mixtured in use");
 				attNums = lappend_int(attNums, attr->attnum);
 			}
@@ -5228,13 +10860,16 @@ __pgstrom_arrow_fdw_export_cupy(Oid frel_oid,
 	}
 	if (attNums == NIL)
 		elog(ERROR, "no valid attributes are specified");
-	result = lookupOrBuildArrowGpuBufferCupy(frel, attNums,
-											 element_oid,
-											 cuda_dindex,
-											 pinned);
+	result = lookupOrBuildArrowGpuBuffer(frel, attNums,
+										 format,
+										 element_oid,
+										 cuda_dindex,
+										 rb_begin,
+										 rb_count,
+										 pinned);
 	table_close(frel, AccessShareLock);
 
-	PG_RETURN_TEXT_P(result);
+	return result;
 }
 
 Datum
@@ -5255,6 +10890,8 @@ pgstrom_arrow_fdw_export_cupy(PG_FUNCTION_ARGS)
 	PG_RETURN_TEXT_P(__pgstrom_arrow_fdw_export_cupy(frel_oid,
 													 attNames,
 													 device_id,
+													 ARROW_GPUBUF_FORMAT__CUPY,
+													 0, 0,
 													 false));
 }
 PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_export_cupy);
@@ -5277,16 +10914,118 @@ pgstrom_arrow_fdw_export_cupy_pinned(PG_FUNCTION_ARGS)
 	PG_RETURN_TEXT_P(__pgstrom_arrow_fdw_export_cupy(frel_oid,
 													 attNames,
 													 device_id,
+													 ARROW_GPUBUF_FORMAT__CUPY,
+													 0, 0,
 													 true));
 }
 PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_export_cupy_pinned);
 
+Datum
+pgstrom_arrow_fdw_export_columns(PG_FUNCTION_ARGS)
+{
+	Oid			frel_oid = InvalidOid;
+	ArrayType  *attNames = NULL;
+	int32		device_id = -1;
+
+	if (PG_ARGISNULL(0))
+		elog(ERROR, "no relation oid was specified");
+	frel_oid = PG_GETARG_OID(0);
+	if (!PG_ARGISNULL(1))
+		attNames = PG_GETARG_ARRAYTYPE_P(1);
+	if (!PG_ARGISNULL(2))
+		device_id = PG_GETARG_INT32(2);
+
+	PG_RETURN_TEXT_P(__pgstrom_arrow_fdw_export_cupy(frel_oid,
+													 attNames,
+													 device_id,
+													 ARROW_GPUBUF_FORMAT__ARROW,
+													 0, 0,
+													 false));
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_export_columns);
+
+Datum
+pgstrom_arrow_fdw_export_columns_pinned(PG_FUNCTION_ARGS)
+{
+	Oid			frel_oid = InvalidOid;
+	ArrayType  *attNames = NULL;
+	int32		device_id = -1;
+
+	if (PG_ARGISNULL(0))
+		elog(ERROR, "no relation oid was specified");
+	frel_oid = PG_GETARG_OID(0);
+	if (!PG_ARGISNULL(1))
+		attNames = PG_GETARG_ARRAYTYPE_P(1);
+	if (!PG_ARGISNULL(2))
+		device_id = PG_GETARG_INT32(2);
+
+	PG_RETURN_TEXT_P(__pgstrom_arrow_fdw_export_cupy(frel_oid,
+													 attNames,
+													 device_id,
+													 ARROW_GPUBUF_FORMAT__ARROW,
+													 0, 0,
+													 true));
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_export_columns_pinned);
+
+/*
+ * pgstrom_arrow_fdw_export_columns_batch
+ *
+ * pgstrom.arrow_fdw_export_columns_batch(regclass, -- oid of relation
+ *                                        int,      -- first RecordBatch
+ *                                        int,      -- number of RecordBatches
+ *                                        text[],   -- name of attributes
+ *                                        int)      -- GPU device-id
+ *
+ * It exports a part of the foreign table in the columnar layout, to load
+ * tables larger than GPU device memory batch-by-batch. It returns NULL if
+ * the first RecordBatch is out of the range.
+ */
+Datum
+pgstrom_arrow_fdw_export_columns_batch(PG_FUNCTION_ARGS)
+{
+	Oid			frel_oid = InvalidOid;
+	int32		rb_begin;
+	int32		rb_count;
+	ArrayType  *attNames = NULL;
+	int32		device_id = -1;
+	text	   *result;
+
+	if (PG_ARGISNULL(0))
+		elog(ERROR, "no relation oid was specified");
+	frel_oid = PG_GETARG_OID(0);
+	if (PG_ARGISNULL(1) || PG_ARGISNULL(2))
+		elog(ERROR, "range of RecordBatches was not specified");
+	rb_begin = PG_GETARG_INT32(1);
+	rb_count = PG_GETARG_INT32(2);
+	if (rb_begin < 0 || rb_count < 1)
+		elog(ERROR, "invalid range of RecordBatches (begin=%d, count=%d)",
+			 rb_begin, rb_count);
+	if (!PG_ARGISNULL(3))
+		attNames = PG_GETARG_ARRAYTYPE_P(3);
+	if (!PG_ARGISNULL(4))
+		device_id = PG_GETARG_INT32(4);
+
+	result = __pgstrom_arrow_fdw_export_cupy(frel_oid,
+											 attNames,
+											 device_id,
+											 ARROW_GPUBUF_FORMAT__ARROW,
+											 rb_begin,
+											 rb_count,
+											 false);
+	if (!result)
+		PG_RETURN_NULL();
+	PG_RETURN_TEXT_P(result);
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_export_columns_batch);
+
 /*
  * unloadArrowGpuBuffer
  */
 static void
 unloadArrowGpuBuffer(const char *ident,
-					 Oid frel_oid, List *attNums, int format)
+					 Oid frel_oid, List *attNums, int format,
+					 uint32 rb_begin, uint32 rb_count)
 {
 	ArrowGpuBuffer *_key;
 	dlist_mutable_iter iter;
@@ -5295,8 +11034,11 @@ unloadArrowGpuBuffer(const char *ident,
 	int			j, nattrs = list_length(attNums);
 
 	_key = alloca(offsetof(ArrowGpuBuffer, attnums[nattrs]));
+	memset(_key, 0, offsetof(ArrowGpuBuffer, attnums[nattrs]));
 	_key->frel_oid = frel_oid;
 	_key->format = format;
+	_key->rb_begin = rb_begin;
+	_key->rb_count = rb_count;
 	_key->nattrs = nattrs;
 	j = 0;
 	foreach (lc, attNums)
@@ -5339,6 +11081,8 @@ pgstrom_arrow_fdw_unpin_gpu_buffer(PG_FUNCTION_ARGS)
 	int			format = -1;
 	Oid			frel_oid = InvalidOid;
 	List	   *attNums = NIL;
+	uint32		rb_begin = 0;
+	uint32		rb_count = 0;
 	
 	for (tok = strtok_r(ident, ",", &save);
 		 tok != NULL;
@@ -5359,11 +11103,18 @@ pgstrom_arrow_fdw_unpin_gpu_buffer(PG_FUNCTION_ARGS)
 				strcmp(pos, "cupy-float32") == 0 ||
 				strcmp(pos, "cupy-float64") == 0)
 				format = ARROW_GPUBUF_FORMAT__CUPY;
+			else if (strcmp(pos, "arrow") == 0)
+				format = ARROW_GPUBUF_FORMAT__ARROW;
 			else
 				elog(ERROR, "unknown GPU buffer identifier format [%s]", pos);
 		}
 		else if (strcmp(tok, "table_oid") == 0)
 			frel_oid = atooid(pos);
+		else if (strcmp(tok, "rb_range") == 0)
+		{
+			if (sscanf(pos, "%u:%u", &rb_begin, &rb_count) != 2)
+				elog(ERROR, "invalid GPU buffer identifier token [%s]", pos);
+		}
 		else if (strcmp(tok, "attnums") == 0)
 		{
 			char   *__tok, *__save;
@@ -5378,14 +11129,16 @@ pgstrom_arrow_fdw_unpin_gpu_buffer(PG_FUNCTION_ARGS)
 		else if (strcmp(tok, "device_id")  != 0 &&
 				 strcmp(tok, "bytesize")   != 0 &&
 				 strcmp(tok, "ipc_handle") != 0 &&
-				 strcmp(tok, "nitems")     != 0)
+				 strcmp(tok, "nitems")     != 0 &&
+				 strcmp(tok, "columns")    != 0)
 			elog(ERROR, "invalid GPU buffer identifier token [%s]", ident);
 	}
 
 	if (format < 0 || !OidIsValid(frel_oid) || attNums == NIL)
 		elog(ERROR, "GPU buffer identifier is corrupted: [%s]", __ident);
 	
-	unloadArrowGpuBuffer(__ident, frel_oid, attNums, format);
+	unloadArrowGpuBuffer(__ident, frel_oid, attNums, format,
+						 rb_begin, rb_count);
 
 	PG_RETURN_BOOL(true);
 }
@@ -5427,6 +11180,113 @@ pgstrom_arrow_fdw_put_gpu_buffer(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_put_gpu_buffer);
 
+/*
+ * pgstrom_arrow_fdw_gpu_buffer_info
+ *
+ * It shows the GPU buffers being resident on the device memory.
+ */
+typedef struct
+{
+	char	   *ident;
+	int			cuda_dindex;
+	Oid			frel_oid;
+	int			format;
+	size_t		nbytes;
+	size_t		nrooms;
+	bool		pinned;
+	uint32		refcnt;
+	TimestampTz	last_used;
+} arrowGpuBufferInfo;
+
+Datum
+pgstrom_arrow_fdw_gpu_buffer_info(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	arrowGpuBufferInfo *info;
+	List	   *info_list;
+	Datum		values[9];
+	bool		isnull[9];
+	HeapTuple	tuple;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		dlist_iter		iter;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(9);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "ident",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "device_nr",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "table_oid",
+						   REGCLASSOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "format",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "length",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "nitems",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "pinned",
+						   BOOLOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 8, "refcnt",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 9, "last_used",
+						   TIMESTAMPTZOID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		/* collect the GPU buffers in LRU order */
+		info_list = NIL;
+		LWLockAcquire(&arrow_metadata_state->gpubuf_lru_lock, LW_SHARED);
+		dlist_foreach(iter, &arrow_metadata_state->gpubuf_lru_list)
+		{
+			ArrowGpuBuffer *gpubuf = dlist_container(ArrowGpuBuffer,
+													 lru_chain, iter.cur);
+			info = palloc(sizeof(arrowGpuBufferInfo));
+			info->ident = pstrdup(gpubuf->ident);
+			info->cuda_dindex = gpubuf->cuda_dindex;
+			info->frel_oid = gpubuf->frel_oid;
+			info->format = gpubuf->format;
+			info->nbytes = gpubuf->nbytes;
+			info->nrooms = gpubuf->nrooms;
+			info->pinned = gpubuf->pinned;
+			info->refcnt = pg_atomic_read_u32(&gpubuf->refcnt);
+			info->last_used = gpubuf->last_used;
+			info_list = lappend(info_list, info);
+		}
+		LWLockRelease(&arrow_metadata_state->gpubuf_lru_lock);
+
+		fncxt->user_fctx = info_list;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+	info_list = (List *)fncxt->user_fctx;
+
+	if (info_list == NIL)
+		SRF_RETURN_DONE(fncxt);
+	info = linitial(info_list);
+	fncxt->user_fctx = list_delete_first(info_list);
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = CStringGetTextDatum(info->ident);
+	values[1] = Int32GetDatum(devAttrs[info->cuda_dindex].DEV_ID);
+	values[2] = ObjectIdGetDatum(info->frel_oid);
+	values[3] = CStringGetTextDatum(info->format == ARROW_GPUBUF_FORMAT__CUPY
+									? "cupy" : "arrow");
+	values[4] = Int64GetDatum(info->nbytes);
+	values[5] = Int64GetDatum(info->nrooms);
+	values[6] = BoolGetDatum(info->pinned);
+	values[7] = Int32GetDatum(info->refcnt);
+	values[8] = TimestampTzGetDatum(info->last_used);
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_gpu_buffer_info);
+
 /*
  * pgstrom_startup_arrow_fdw
  */
@@ -5448,6 +11308,7 @@ pgstrom_startup_arrow_fdw(void)
 		SpinLockInit(&arrow_metadata_state->lru_lock);
 		dlist_init(&arrow_metadata_state->lru_list);
 		pg_atomic_init_u64(&arrow_metadata_state->consumed, 0UL);
+		pg_atomic_init_u64(&arrow_metadata_state->write_generation, 0UL);
 		for (i=0; i < ARROW_METADATA_HASH_NSLOTS; i++)
 		{
 			LWLockInitialize(&arrow_metadata_state->lock_slots[i], -1);
@@ -5460,6 +11321,8 @@ pgstrom_startup_arrow_fdw(void)
 			LWLockInitialize(&arrow_metadata_state->gpubuf_locks[i], -1);
 			dlist_init(&arrow_metadata_state->gpubuf_slots[i]);
 		}
+		LWLockInitialize(&arrow_metadata_state->gpubuf_lru_lock, -1);
+		dlist_init(&arrow_metadata_state->gpubuf_lru_list);
 	}
 }
 
@@ -5477,6 +11340,7 @@ pgstrom_init_arrow_fdw(void)
 	r->GetForeignRelSize			= ArrowGetForeignRelSize;
 	r->GetForeignPaths				= ArrowGetForeignPaths;
 	r->GetForeignPlan				= ArrowGetForeignPlan;
+	r->GetForeignUpperPaths			= ArrowGetForeignUpperPaths;
 	r->BeginForeignScan				= ArrowBeginForeignScan;
 	r->IterateForeignScan			= ArrowIterateForeignScan;
 	r->ReScanForeignScan			= ArrowReScanForeignScan;
@@ -5528,6 +11392,20 @@ pgstrom_init_arrow_fdw(void)
 							NULL, NULL, NULL);
 	arrow_metadata_cache_size = (size_t)arrow_metadata_cache_size_kb << 10;
 
+	/*
+	 * Per backend cache of stat(2) for the metadata cache lookup
+	 */
+	DefineCustomIntVariable("arrow_fdw.metadata_stat_ttl",
+							"duration to reuse stat(2) of arrow files without validation",
+							NULL,
+							&arrow_metadata_stat_ttl,
+							0,			/* default: disabled */
+							0,
+							60000,		/* 60sec */
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_MS,
+							NULL, NULL, NULL);
+
 	/*
 	 * Debug option to hint number of rows
 	 */
@@ -5540,6 +11418,18 @@ pgstrom_init_arrow_fdw(void)
 							   GUC_NOT_IN_SAMPLE | GUC_NO_SHOW_ALL,
 							   NULL, NULL, NULL);
 
+	/*
+	 * Directory of the persistent metadata cache
+	 */
+	DefineCustomStringVariable("arrow_fdw.metadata_cache_dir",
+							   "directory to save metadata cache of arrow files persistently",
+							   NULL,
+							   &arrow_metadata_cache_dir,
+							   NULL,
+							   PGC_SIGHUP,
+							   GUC_NOT_IN_SAMPLE,
+							   NULL, NULL, NULL);
+
 	/*
 	 * Limit of RecordBatch size for writing
 	 */
@@ -5553,6 +11443,92 @@ pgstrom_init_arrow_fdw(void)
 							PGC_USERSET,
 							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
 							NULL, NULL, NULL);
+	DefineCustomIntVariable("arrow_fdw.record_batch_max_rows",
+							"maximum number of rows per record batch on writing",
+							NULL,
+							&arrow_record_batch_max_rows,
+							0,				/* default: unlimited */
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	/*
+	 * Enables to pre-filter rows on CPU-only scan
+	 */
+	DefineCustomBoolVariable("arrow_fdw.cpu_prefilter",
+							 "Enables column-wise pre-filter of rows on CPU scan",
+							 NULL,
+							 &arrow_cpu_prefilter_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/*
+	 * Enables to answer aggregates by the metadata
+	 */
+	DefineCustomBoolVariable("arrow_fdw.metadata_aggregate",
+							 "Enables to answer COUNT/MIN/MAX by the metadata of arrow files",
+							 NULL,
+							 &arrow_metadata_agg_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/*
+	 * Enables to map arrow files on CPU-only scan
+	 */
+	DefineCustomBoolVariable("arrow_fdw.mmap_scan",
+							 "Enables to reference arrow files by mmap(2) on CPU scan",
+							 NULL,
+							 &arrow_mmap_scan_enabled,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/*
+	 * Number of RecordBatches to be read-ahead
+	 */
+	DefineCustomIntVariable("arrow_fdw.prefetch_depth",
+							"number of RecordBatches to be prefetched on scan",
+							NULL,
+							&arrow_prefetch_depth,
+							2,
+							0,
+							64,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	/*
+	 * Enables to load RecordBatches from the GPU buffers on GPU scan
+	 */
+	DefineCustomBoolVariable("arrow_fdw.gpu_buffer_scan",
+							 "Enables to load resident GPU buffers on GPU scan, instead of arrow files",
+							 NULL,
+							 &arrow_gpu_buffer_scan_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/*
+	 * Budget of GPU buffers for Python collaboration, per device
+	 */
+	DefineCustomIntVariable("arrow_fdw.gpu_buffer_budget",
+							"budget of the GPU buffers per device",
+							NULL,
+							&arrow_gpu_buffer_budget_kb,
+							0,				/* default: unlimited */
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 
 	/* shared memory size */
 	RequestAddinShmemSpace(MAXALIGN(sizeof(arrowMetadataState)));
@@ -5566,4 +11542,5 @@ pgstrom_init_arrow_fdw(void)
 	/* misc init */
 	dlist_init(&arrow_write_redo_list);
 	dlist_init(&arrow_gpu_buffer_tracker_list);
+	dlist_init(&arrow_gpu_buffer_scan_refs);
 }
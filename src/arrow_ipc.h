@@ -33,6 +33,7 @@ typedef struct SQLbuffer		SQLbuffer;
 typedef struct SQLtable			SQLtable;
 typedef struct SQLfield			SQLfield;
 typedef struct SQLdictionary	SQLdictionary;
+typedef struct SQLstat			SQLstat;
 typedef union  SQLtype			SQLtype;
 typedef struct SQLtype__pgsql	SQLtype__pgsql;
 typedef struct SQLtype__mysql	SQLtype__mysql;
@@ -67,6 +68,27 @@ union SQLtype
 	SQLtype__mysql	mysql;
 };
 
+/*
+ * SQLstat - min/max statistics of a field per RecordBatch
+ *
+ * The values are kept in the arrow native representation; Int, Date and
+ * Timestamp use 'i', FloatingPoint uses 'f'.
+ */
+typedef union
+{
+	int64		i;
+	double		f;
+} SQLstat__datum;
+
+struct SQLstat
+{
+	SQLstat	   *next;
+	int			rb_index;		/* index of the RecordBatch */
+	bool		is_valid;		/* false, if no valid values */
+	SQLstat__datum min;
+	SQLstat__datum max;
+};
+
 struct SQLfield
 {
 	char	   *field_name;		/* name of the column, element or sub-field */
@@ -92,6 +114,10 @@ struct SQLfield
 	/* custom metadata(optional) */
 	ArrowKeyValue *customMetadata;
 	int			numCustomMetadata;
+	/* min/max statistics per RecordBatch (optional) */
+	bool		stat_enabled;
+	SQLstat		stat_datum;		/* statistics of the current buffer */
+	SQLstat	   *stat_list;		/* statistics of the written RecordBatches */
 };
 static inline size_t
 sql_field_put_value(SQLfield *column, const char *addr, int sz)
@@ -134,6 +160,7 @@ struct SQLdictionary
 	Oid			enum_typeid;
 	int			dict_id;
 	char		is_delta;
+	char		is_dynamic;		/* labels are added on demand */
 	SQLbuffer	values;
 	SQLbuffer	extra;
 	int			nitems;
@@ -143,10 +170,13 @@ struct SQLdictionary
 
 /* arrow_write.c */
 extern ssize_t	writeArrowSchema(SQLtable *table);
-extern void		writeArrowDictionaryBatches(SQLtable *table);
+extern void		writeArrowDictionaryBatches(SQLtable *table, bool is_dynamic);
 extern int		writeArrowRecordBatch(SQLtable *table);
 extern ssize_t	writeArrowFooter(SQLtable *table);
 extern size_t	estimateArrowBufferLength(SQLfield *column, size_t nitems);
+extern bool		sql_field_enable_stat(SQLfield *column);
+extern void		sql_field_restore_stat(SQLfield *column, ArrowField *field,
+									   int numRecordBatches);
 
 /* arrow_nodes.c */
 extern void		__initArrowNode(ArrowNode *node, ArrowNodeTag tag);
@@ -155,6 +185,8 @@ extern void		__initArrowNode(ArrowNode *node, ArrowNodeTag tag);
 extern char	   *dumpArrowNode(ArrowNode *node);
 extern void		copyArrowNode(ArrowNode *dest, const ArrowNode *src);
 extern void		readArrowFileDesc(int fdesc, ArrowFileInfo *af_info);
+extern size_t	readParquetPageHeader(ParquetPageHeader *phead,
+									  const char *buf, size_t len);
 extern char	   *arrowTypeName(ArrowField *field);
 
 /* arrow_pgsql.c */
@@ -171,6 +203,10 @@ extern int		assignArrowTypePgSQL(SQLfield *column,
 									 Oid typrelid,
 									 Oid typelem,
 									 const char *tz_name, int64_t tz_offset);
+extern int		sql_dictionary_put_label(SQLdictionary *dict,
+										 const char *label, int len);
+extern bool		sql_field_enable_dictionary(SQLfield *column,
+											SQLdictionary *dict);
 /*
  * Error messages, and misc definitions for pg2arrow
  */
@@ -350,6 +350,18 @@ __dumpArrowSchema(SQLbuffer *buf, ArrowNode *node)
 	sql_buffer_printf(buf, "]}");
 }
 
+static void
+__dumpArrowBodyCompression(SQLbuffer *buf, ArrowNode *node)
+{
+	ArrowBodyCompression *c = (ArrowBodyCompression *)node;
+
+	sql_buffer_printf(
+		buf, "{BodyCompression: codec=%s, method=%s}",
+		c->codec == ArrowCompressionType__LZ4_FRAME ? "LZ4_FRAME" :
+		c->codec == ArrowCompressionType__ZSTD ? "ZSTD" : "???",
+		c->method == ArrowBodyCompressionMethod__BUFFER ? "BUFFER" : "???");
+}
+
 static void
 __dumpArrowRecordBatch(SQLbuffer *buf, ArrowNode *node)
 {
@@ -370,7 +382,13 @@ __dumpArrowRecordBatch(SQLbuffer *buf, ArrowNode *node)
 			sql_buffer_printf(buf, ", ");
 		__dumpArrowNode(buf, (ArrowNode *)&r->buffers[i]);
 	}
-	sql_buffer_printf(buf,"]}");
+	sql_buffer_printf(buf,"]");
+	if (r->compression.node.tag == ArrowNodeTag__BodyCompression)
+	{
+		sql_buffer_printf(buf, ", compression=");
+		__dumpArrowNode(buf, (ArrowNode *)&r->compression);
+	}
+	sql_buffer_printf(buf,"}");
 }
 
 static void
@@ -682,6 +700,15 @@ __copyArrowSchema(ArrowSchema *dest, const ArrowSchema *src)
 	COPY_VECTOR(custom_metadata, ArrowKeyValue);
 }
 
+static void
+__copyArrowBodyCompression(ArrowBodyCompression *dest,
+						   const ArrowBodyCompression *src)
+{
+	__copyArrowNode(&dest->node, &src->node);
+	COPY_SCALAR(codec);
+	COPY_SCALAR(method);
+}
+
 static void
 __copyArrowRecordBatch(ArrowRecordBatch *dest, const ArrowRecordBatch *src)
 {
@@ -689,6 +716,7 @@ __copyArrowRecordBatch(ArrowRecordBatch *dest, const ArrowRecordBatch *src)
 	COPY_SCALAR(length);
 	COPY_VECTOR(nodes, ArrowFieldNode);
 	COPY_VECTOR(buffers, ArrowBuffer);
+	__copyArrowBodyCompression(&dest->compression, &src->compression);
 }
 
 static void
@@ -936,6 +964,7 @@ __initArrowNode(ArrowNode *node, ArrowNodeTag tag)
 		CASE_ARROW_NODE(FieldNode);
 		CASE_ARROW_NODE(Buffer);
 		CASE_ARROW_NODE(Schema);
+		CASE_ARROW_NODE(BodyCompression);
 		CASE_ARROW_NODE(RecordBatch);
 		CASE_ARROW_NODE(DictionaryBatch);
 		CASE_ARROW_NODE(Message);
@@ -1488,6 +1517,17 @@ readArrowBuffer(ArrowBuffer *node, const char *pos)
 
 }
 
+static void
+readArrowBodyCompression(ArrowBodyCompression *compression, const char *pos)
+{
+	FBTable		t = fetchFBTable((int32 *)pos);
+
+	memset(compression, 0, sizeof(ArrowBodyCompression));
+	INIT_ARROW_NODE(compression, BodyCompression);
+	compression->codec	= fetchChar(&t, 0);
+	compression->method	= fetchChar(&t, 1);
+}
+
 static void
 readArrowRecordBatch(ArrowRecordBatch *rbatch, const char *pos)
 {
@@ -1517,6 +1557,11 @@ readArrowRecordBatch(ArrowRecordBatch *rbatch, const char *pos)
 			next += readArrowBuffer(&rbatch->buffers[i], next);
 	}
 	rbatch->_num_buffers = nitems;
+
+	/* compression: BodyCompression (optional) */
+	next = fetchOffset(&t, 3);
+	if (next)
+		readArrowBodyCompression(&rbatch->compression, next);
 }
 
 static void
@@ -1638,6 +1683,8 @@ readArrowFooter(ArrowFooter *node, const char *pos)
 #define ARROW_FILE_HEAD_SIGNATURE_SZ	(sizeof(ARROW_FILE_HEAD_SIGNATURE) - 1)
 #define ARROW_FILE_TAIL_SIGNATURE		"ARROW1"
 #define ARROW_FILE_TAIL_SIGNATURE_SZ	(sizeof(ARROW_FILE_TAIL_SIGNATURE) - 1)
+#define PARQUET_FILE_SIGNATURE			"PAR1"
+#define PARQUET_FILE_SIGNATURE_SZ		(sizeof(PARQUET_FILE_SIGNATURE) - 1)
 
 #ifdef __PGSTROM_MODULE__
 #include "pg_strom.h"
@@ -1648,6 +1695,760 @@ readArrowFooter(ArrowFooter *node, const char *pos)
 #define __munmap(a,b)			munmap((a),(b))
 #endif /* __PGSTROM_MODULE__ */
 
+/*
+ * Routines to read Apache Parquet files
+ *
+ * Parquet file has 'PAR1' at the head and tail, and FileMetaData encoded by
+ * the Thrift compact protocol is placed in front of the tail signature.
+ * We read only the flat schema of fixed-width columns and the row groups,
+ * then build an ArrowSchema equivalent to the Parquet schema, so Arrow_Fdw
+ * can map each row group on a RecordBatch.
+ */
+typedef struct
+{
+	const unsigned char *pos;
+	const unsigned char *end;
+} ThriftCursor;
+
+#define ThriftType__STOP		0
+#define ThriftType__TRUE		1
+#define ThriftType__FALSE		2
+#define ThriftType__BYTE		3
+#define ThriftType__I16			4
+#define ThriftType__I32			5
+#define ThriftType__I64			6
+#define ThriftType__DOUBLE		7
+#define ThriftType__BINARY		8
+#define ThriftType__LIST		9
+#define ThriftType__SET			10
+#define ThriftType__MAP			11
+#define ThriftType__STRUCT		12
+
+static uint64
+__thriftReadVarint(ThriftCursor *c)
+{
+	uint64		value = 0;
+	int			shift = 0;
+
+	for (;;)
+	{
+		unsigned char	b;
+
+		if (c->pos >= c->end)
+			Elog("Parquet: Thrift metadata is truncated");
+		b = *c->pos++;
+		value |= ((uint64)(b & 0x7f)) << shift;
+		if ((b & 0x80) == 0)
+			break;
+		shift += 7;
+		if (shift >= 64)
+			Elog("Parquet: Thrift metadata has broken varint");
+	}
+	return value;
+}
+
+static int64
+__thriftReadInt(ThriftCursor *c, int type)
+{
+	uint64		value;
+
+	if (type == ThriftType__BYTE)
+	{
+		if (c->pos >= c->end)
+			Elog("Parquet: Thrift metadata is truncated");
+		return (int8)(*c->pos++);
+	}
+	if (type != ThriftType__I16 &&
+		type != ThriftType__I32 &&
+		type != ThriftType__I64)
+		Elog("Parquet: Thrift metadata has unexpected type (%d) for integer",
+			 type);
+	/* zigzag encoding */
+	value = __thriftReadVarint(c);
+	return (int64)(value >> 1) ^ -((int64)(value & 1));
+}
+
+static const char *
+__thriftReadBinary(ThriftCursor *c, int type, int *p_len)
+{
+	const char *str;
+	uint64		len;
+
+	if (type != ThriftType__BINARY)
+		Elog("Parquet: Thrift metadata has unexpected type (%d) for binary",
+			 type);
+	len = __thriftReadVarint(c);
+	if (len > (uint64)(c->end - c->pos))
+		Elog("Parquet: Thrift metadata is truncated");
+	str = (const char *)c->pos;
+	c->pos += len;
+	*p_len = len;
+	return str;
+}
+
+/*
+ * __thriftReadFieldBegin - returns type of the next field, or STOP
+ */
+static int
+__thriftReadFieldBegin(ThriftCursor *c, int *p_fid)
+{
+	unsigned char	b;
+	int				delta;
+
+	if (c->pos >= c->end)
+		Elog("Parquet: Thrift metadata is truncated");
+	b = *c->pos++;
+	if (b == ThriftType__STOP)
+		return ThriftType__STOP;
+	delta = (b >> 4);
+	if (delta != 0)
+		*p_fid += delta;
+	else
+		*p_fid = __thriftReadInt(c, ThriftType__I16);
+	return (b & 0x0f);
+}
+
+static int64
+__thriftReadListBegin(ThriftCursor *c, int type, int *p_elem_type)
+{
+	unsigned char	b;
+	int64			nitems;
+
+	if (type != ThriftType__LIST && type != ThriftType__SET)
+		Elog("Parquet: Thrift metadata has unexpected type (%d) for list",
+			 type);
+	if (c->pos >= c->end)
+		Elog("Parquet: Thrift metadata is truncated");
+	b = *c->pos++;
+	nitems = (b >> 4);
+	if (nitems == 15)
+		nitems = __thriftReadVarint(c);
+	*p_elem_type = (b & 0x0f);
+	if (nitems > c->end - c->pos)
+		Elog("Parquet: Thrift metadata has too large list");
+	return nitems;
+}
+
+static void
+__thriftSkipValue(ThriftCursor *c, int type, int depth)
+{
+	int64		i, nitems;
+	int			elem_type;
+	int			len	__attribute__((unused));
+
+	if (depth > 64)
+		Elog("Parquet: Thrift metadata is too deeply nested");
+	switch (type)
+	{
+		case ThriftType__TRUE:
+		case ThriftType__FALSE:
+			break;
+		case ThriftType__BYTE:
+		case ThriftType__I16:
+		case ThriftType__I32:
+		case ThriftType__I64:
+			__thriftReadInt(c, type);
+			break;
+		case ThriftType__DOUBLE:
+			if (c->end - c->pos < sizeof(double))
+				Elog("Parquet: Thrift metadata is truncated");
+			c->pos += sizeof(double);
+			break;
+		case ThriftType__BINARY:
+			__thriftReadBinary(c, type, &len);
+			break;
+		case ThriftType__LIST:
+		case ThriftType__SET:
+			nitems = __thriftReadListBegin(c, type, &elem_type);
+			for (i=0; i < nitems; i++)
+			{
+				/* bool elements are encoded as a byte */
+				if (elem_type == ThriftType__TRUE ||
+					elem_type == ThriftType__FALSE)
+					__thriftReadInt(c, ThriftType__BYTE);
+				else
+					__thriftSkipValue(c, elem_type, depth+1);
+			}
+			break;
+		case ThriftType__MAP:
+			nitems = __thriftReadVarint(c);
+			if (nitems > 0)
+			{
+				unsigned char	kv;
+
+				if (c->pos >= c->end)
+					Elog("Parquet: Thrift metadata is truncated");
+				kv = *c->pos++;
+				for (i=0; i < nitems; i++)
+				{
+					__thriftSkipValue(c, (kv >> 4), depth+1);
+					__thriftSkipValue(c, (kv & 0x0f), depth+1);
+				}
+			}
+			break;
+		case ThriftType__STRUCT:
+			{
+				int		fid = 0;
+
+				while ((type = __thriftReadFieldBegin(c, &fid)) != ThriftType__STOP)
+					__thriftSkipValue(c, type, depth+1);
+			}
+			break;
+		default:
+			Elog("Parquet: Thrift metadata has unknown type (%d)", type);
+	}
+}
+
+/*
+ * Statistics - we use only null_count
+ */
+static void
+readParquetStatistics(ThriftCursor *c, int64 *p_null_count)
+{
+	int		fid = 0;
+	int		type;
+
+	while ((type = __thriftReadFieldBegin(c, &fid)) != ThriftType__STOP)
+	{
+		if (fid == 3)
+			*p_null_count = __thriftReadInt(c, type);
+		else
+			__thriftSkipValue(c, type, 0);
+	}
+}
+
+/*
+ * ColumnMetaData
+ */
+static void
+readParquetColumnMetaData(ThriftCursor *c, ParquetColumnChunk *cchunk)
+{
+	int64	data_page_offset = -1;
+	int64	dictionary_page_offset = -1;
+	int		fid = 0;
+	int		type;
+
+	while ((type = __thriftReadFieldBegin(c, &fid)) != ThriftType__STOP)
+	{
+		switch (fid)
+		{
+			case 1:		/* type */
+				cchunk->type = __thriftReadInt(c, type);
+				break;
+			case 4:		/* codec */
+				cchunk->codec = __thriftReadInt(c, type);
+				break;
+			case 5:		/* num_values */
+				cchunk->num_values = __thriftReadInt(c, type);
+				break;
+			case 7:		/* total_compressed_size */
+				cchunk->chunk_length = __thriftReadInt(c, type);
+				break;
+			case 9:		/* data_page_offset */
+				data_page_offset = __thriftReadInt(c, type);
+				break;
+			case 11:	/* dictionary_page_offset */
+				dictionary_page_offset = __thriftReadInt(c, type);
+				break;
+			case 12:	/* statistics */
+				if (type != ThriftType__STRUCT)
+					Elog("Parquet: ColumnMetaData is corrupted");
+				readParquetStatistics(c, &cchunk->null_count);
+				break;
+			default:
+				__thriftSkipValue(c, type, 0);
+				break;
+		}
+	}
+	if (data_page_offset < 0)
+		Elog("Parquet: ColumnMetaData has no data_page_offset");
+	/* dictionary page, if any, is located prior to the data pages */
+	if (dictionary_page_offset > 0 &&
+		dictionary_page_offset < data_page_offset)
+		cchunk->chunk_offset = dictionary_page_offset;
+	else
+		cchunk->chunk_offset = data_page_offset;
+}
+
+/*
+ * ColumnChunk
+ */
+static void
+readParquetColumnChunk(ThriftCursor *c, ParquetColumnChunk *cchunk)
+{
+	bool	has_meta_data = false;
+	int		fid = 0;
+	int		type;
+
+	cchunk->null_count = -1;
+	while ((type = __thriftReadFieldBegin(c, &fid)) != ThriftType__STOP)
+	{
+		if (fid == 1)
+			Elog("Parquet: column chunks in the external file are not supported");
+		else if (fid == 3 && type == ThriftType__STRUCT)
+		{
+			readParquetColumnMetaData(c, cchunk);
+			has_meta_data = true;
+		}
+		else
+			__thriftSkipValue(c, type, 0);
+	}
+	if (!has_meta_data)
+		Elog("Parquet: ColumnChunk has no ColumnMetaData");
+}
+
+/*
+ * RowGroup
+ */
+static void
+readParquetRowGroup(ThriftCursor *c, ParquetRowGroup *rgroup)
+{
+	int		fid = 0;
+	int		type;
+	int		elem_type;
+	int64	i, nitems;
+
+	while ((type = __thriftReadFieldBegin(c, &fid)) != ThriftType__STOP)
+	{
+		if (fid == 1)
+		{
+			nitems = __thriftReadListBegin(c, type, &elem_type);
+			if (elem_type != ThriftType__STRUCT)
+				Elog("Parquet: RowGroup is corrupted");
+			rgroup->columns = palloc0(sizeof(ParquetColumnChunk) *
+									  Max(nitems, 1));
+			for (i=0; i < nitems; i++)
+				readParquetColumnChunk(c, &rgroup->columns[i]);
+			rgroup->_num_columns = nitems;
+		}
+		else if (fid == 3)
+			rgroup->num_rows = __thriftReadInt(c, type);
+		else
+			__thriftSkipValue(c, type, 0);
+	}
+}
+
+/*
+ * SchemaElement
+ */
+typedef struct
+{
+	int			type;			/* ParquetType, or -1 */
+	int			repetition;		/* 0:REQUIRED, 1:OPTIONAL, 2:REPEATED */
+	const char *name;
+	int			name_len;
+	int			num_children;
+	int			converted_type;	/* -1, if none */
+	int			logical_type;	/* field-id of LogicalType union, or -1 */
+	int			logical_unit;	/* 1:MILLIS, 2:MICROS, 3:NANOS */
+	bool		logical_utc;	/* isAdjustedToUTC */
+	int			logical_width;	/* bitWidth of IntType */
+} ParquetSchemaElement;
+
+#define ParquetConvertedType__DATE				6
+#define ParquetConvertedType__TIMESTAMP_MILLIS	9
+#define ParquetConvertedType__TIMESTAMP_MICROS	10
+#define ParquetConvertedType__INT_8				15
+#define ParquetConvertedType__INT_16			16
+#define ParquetConvertedType__INT_32			17
+#define ParquetConvertedType__INT_64			18
+
+#define ParquetLogicalType__DATE				6
+#define ParquetLogicalType__TIMESTAMP			8
+#define ParquetLogicalType__INTEGER				10
+
+static void
+readParquetLogicalTypeDetail(ThriftCursor *c, ParquetSchemaElement *elem)
+{
+	int		fid = 0;
+	int		type;
+
+	while ((type = __thriftReadFieldBegin(c, &fid)) != ThriftType__STOP)
+	{
+		if (elem->logical_type == ParquetLogicalType__TIMESTAMP &&
+			fid == 1 && (type == ThriftType__TRUE || type == ThriftType__FALSE))
+			elem->logical_utc = (type == ThriftType__TRUE);
+		else if (elem->logical_type == ParquetLogicalType__TIMESTAMP &&
+				 fid == 2 && type == ThriftType__STRUCT)
+		{
+			/* TimeUnit union; field-id tells the unit */
+			int		__fid = 0;
+			int		__type;
+
+			while ((__type = __thriftReadFieldBegin(c, &__fid)) != ThriftType__STOP)
+			{
+				elem->logical_unit = __fid;
+				__thriftSkipValue(c, __type, 0);
+			}
+		}
+		else if (elem->logical_type == ParquetLogicalType__INTEGER &&
+				 fid == 1)
+			elem->logical_width = __thriftReadInt(c, type);
+		else if (elem->logical_type == ParquetLogicalType__INTEGER &&
+				 fid == 2 && type == ThriftType__FALSE)
+			Elog("Parquet: unsigned integer is not supported");
+		else
+			__thriftSkipValue(c, type, 0);
+	}
+}
+
+static void
+readParquetSchemaElement(ThriftCursor *c, ParquetSchemaElement *elem)
+{
+	int		fid = 0;
+	int		type;
+
+	memset(elem, 0, sizeof(ParquetSchemaElement));
+	elem->type = -1;
+	elem->converted_type = -1;
+	elem->logical_type = -1;
+	while ((type = __thriftReadFieldBegin(c, &fid)) != ThriftType__STOP)
+	{
+		switch (fid)
+		{
+			case 1:		/* type */
+				elem->type = __thriftReadInt(c, type);
+				break;
+			case 3:		/* repetition_type */
+				elem->repetition = __thriftReadInt(c, type);
+				break;
+			case 4:		/* name */
+				elem->name = __thriftReadBinary(c, type, &elem->name_len);
+				break;
+			case 5:		/* num_children */
+				elem->num_children = __thriftReadInt(c, type);
+				break;
+			case 6:		/* converted_type */
+				elem->converted_type = __thriftReadInt(c, type);
+				break;
+			case 10:	/* logicalType (union) */
+				if (type != ThriftType__STRUCT)
+					Elog("Parquet: SchemaElement is corrupted");
+				else
+				{
+					int		__fid = 0;
+					int		__type;
+
+					while ((__type = __thriftReadFieldBegin(c, &__fid)) != ThriftType__STOP)
+					{
+						elem->logical_type = __fid;
+						if (__type == ThriftType__STRUCT)
+							readParquetLogicalTypeDetail(c, elem);
+						else
+							__thriftSkipValue(c, __type, 0);
+					}
+				}
+				break;
+			default:
+				__thriftSkipValue(c, type, 0);
+				break;
+		}
+	}
+}
+
+/*
+ * setupParquetArrowField - ArrowField equivalent to the Parquet column
+ */
+static void
+setupParquetArrowField(ArrowField *field, ParquetSchemaElement *elem)
+{
+	ArrowType  *t = &field->type;
+
+	initArrowNode(field, Field);
+	field->name = pnstrdup(elem->name, elem->name_len);
+	field->_name_len = elem->name_len;
+	if (elem->num_children > 0)
+		Elog("Parquet: nested column '%s' is not supported", field->name);
+	if (elem->repetition == 2)
+		Elog("Parquet: repeated column '%s' is not supported", field->name);
+	field->nullable = (elem->repetition == 1);
+
+	switch (elem->type)
+	{
+		case ParquetType__BOOLEAN:
+			initArrowNode(t, Bool);
+			break;
+		case ParquetType__INT32:
+			if (elem->converted_type == ParquetConvertedType__DATE ||
+				elem->logical_type == ParquetLogicalType__DATE)
+			{
+				initArrowNode(t, Date);
+				t->Date.unit = ArrowDateUnit__Day;
+			}
+			else if (elem->converted_type < 0 ||
+					 elem->converted_type == ParquetConvertedType__INT_8 ||
+					 elem->converted_type == ParquetConvertedType__INT_16 ||
+					 elem->converted_type == ParquetConvertedType__INT_32)
+			{
+				initArrowNode(t, Int);
+				t->Int.is_signed = true;
+				/* Int8 and Int16 are stored in INT32, and shortened */
+				if (elem->converted_type == ParquetConvertedType__INT_8 ||
+					elem->converted_type == ParquetConvertedType__INT_16 ||
+					(elem->logical_type == ParquetLogicalType__INTEGER &&
+					 elem->logical_width < 32))
+					t->Int.bitWidth = 16;
+				else
+					t->Int.bitWidth = 32;
+			}
+			else
+				Elog("Parquet: column '%s' has unsupported INT32 type (%d)",
+					 field->name, elem->converted_type);
+			break;
+		case ParquetType__INT64:
+			if (elem->logical_type == ParquetLogicalType__TIMESTAMP ||
+				elem->converted_type == ParquetConvertedType__TIMESTAMP_MILLIS ||
+				elem->converted_type == ParquetConvertedType__TIMESTAMP_MICROS)
+			{
+				initArrowNode(t, Timestamp);
+				if (elem->logical_type == ParquetLogicalType__TIMESTAMP)
+				{
+					if (elem->logical_unit == 1)
+						t->Timestamp.unit = ArrowTimeUnit__MilliSecond;
+					else if (elem->logical_unit == 2)
+						t->Timestamp.unit = ArrowTimeUnit__MicroSecond;
+					else if (elem->logical_unit == 3)
+						t->Timestamp.unit = ArrowTimeUnit__NanoSecond;
+					else
+						Elog("Parquet: column '%s' has unknown time unit",
+							 field->name);
+				}
+				else if (elem->converted_type == ParquetConvertedType__TIMESTAMP_MILLIS)
+					t->Timestamp.unit = ArrowTimeUnit__MilliSecond;
+				else
+					t->Timestamp.unit = ArrowTimeUnit__MicroSecond;
+				/* the legacy converted types are adjusted to UTC */
+				if (elem->logical_type == ParquetLogicalType__TIMESTAMP
+					? elem->logical_utc : true)
+				{
+					t->Timestamp.timezone = pstrdup("UTC");
+					t->Timestamp._timezone_len = 3;
+				}
+			}
+			else if (elem->converted_type < 0 ||
+					 elem->converted_type == ParquetConvertedType__INT_64)
+			{
+				initArrowNode(t, Int);
+				t->Int.is_signed = true;
+				t->Int.bitWidth = 64;
+			}
+			else
+				Elog("Parquet: column '%s' has unsupported INT64 type (%d)",
+					 field->name, elem->converted_type);
+			break;
+		case ParquetType__FLOAT:
+			initArrowNode(t, FloatingPoint);
+			t->FloatingPoint.precision = ArrowPrecision__Single;
+			break;
+		case ParquetType__DOUBLE:
+			initArrowNode(t, FloatingPoint);
+			t->FloatingPoint.precision = ArrowPrecision__Double;
+			break;
+		case ParquetType__INT96:
+			Elog("Parquet: column '%s' has unsupported physical type (INT96)",
+				 field->name);
+			break;
+		case ParquetType__BYTE_ARRAY:
+			Elog("Parquet: column '%s' has unsupported physical type (BYTE_ARRAY)",
+				 field->name);
+			break;
+		case ParquetType__FIXED_LEN_BYTE_ARRAY:
+			Elog("Parquet: column '%s' has unsupported physical type (FIXED_LEN_BYTE_ARRAY)",
+				 field->name);
+			break;
+		default:
+			Elog("Parquet: column '%s' has unsupported physical type (%d)",
+				 field->name, elem->type);
+	}
+}
+
+/*
+ * readParquetFileMetaData
+ */
+static void
+readParquetFileMetaData(ArrowFileInfo *af_info, const char *pos, size_t len)
+{
+	ThriftCursor c;
+	ParquetSchemaElement *elems = NULL;
+	int64		nelems = 0;
+	int			fid = 0;
+	int			type;
+	int			elem_type;
+	int64		i, j, nitems;
+
+	c.pos = (const unsigned char *)pos;
+	c.end = (const unsigned char *)pos + len;
+	while ((type = __thriftReadFieldBegin(&c, &fid)) != ThriftType__STOP)
+	{
+		switch (fid)
+		{
+			case 2:		/* schema */
+				nelems = __thriftReadListBegin(&c, type, &elem_type);
+				if (elem_type != ThriftType__STRUCT)
+					Elog("Parquet: FileMetaData is corrupted");
+				elems = palloc0(sizeof(ParquetSchemaElement) * Max(nelems, 1));
+				for (i=0; i < nelems; i++)
+					readParquetSchemaElement(&c, &elems[i]);
+				break;
+			case 4:		/* row_groups */
+				nitems = __thriftReadListBegin(&c, type, &elem_type);
+				if (elem_type != ThriftType__STRUCT)
+					Elog("Parquet: FileMetaData is corrupted");
+				af_info->rowGroups = palloc0(sizeof(ParquetRowGroup) *
+											 Max(nitems, 1));
+				for (i=0; i < nitems; i++)
+					readParquetRowGroup(&c, &af_info->rowGroups[i]);
+				af_info->_num_rowGroups = nitems;
+				break;
+			default:
+				__thriftSkipValue(&c, type, 0);
+				break;
+		}
+	}
+
+	/* the root element must have all the columns as its direct children */
+	if (nelems < 1 || elems[0].num_children != nelems - 1)
+		Elog("Parquet: nested schema is not supported");
+	initArrowNode(&af_info->footer, Footer);
+	af_info->footer.version = ArrowMetadataVersion__V4;
+	initArrowNode(&af_info->footer.schema, Schema);
+	af_info->footer.schema.endianness = ArrowEndianness__Little;
+	af_info->footer.schema.fields = palloc0(sizeof(ArrowField) *
+											Max(nelems - 1, 1));
+	for (j=1; j < nelems; j++)
+		setupParquetArrowField(&af_info->footer.schema.fields[j-1],
+							   &elems[j]);
+	af_info->footer.schema._num_fields = nelems - 1;
+
+	for (i=0; i < af_info->_num_rowGroups; i++)
+	{
+		ParquetRowGroup *rgroup = &af_info->rowGroups[i];
+
+		if (rgroup->_num_columns != nelems - 1)
+			Elog("Parquet: RowGroup[%ld] has %d columns, but schema has %ld",
+				 i, rgroup->_num_columns, nelems - 1);
+		for (j=0; j < rgroup->_num_columns; j++)
+		{
+			ParquetColumnChunk *cchunk = &rgroup->columns[j];
+
+			if (cchunk->type != elems[j+1].type)
+				Elog("Parquet: ColumnChunk type mismatch at RowGroup[%ld]", i);
+			if (cchunk->num_values != rgroup->num_rows)
+				Elog("Parquet: ColumnChunk has %ld values, but RowGroup[%ld] has %ld rows",
+					 cchunk->num_values, i, rgroup->num_rows);
+			if (cchunk->chunk_offset < PARQUET_FILE_SIGNATURE_SZ ||
+				cchunk->chunk_length <= 0 ||
+				cchunk->chunk_offset + cchunk->chunk_length >
+				af_info->stat_buf.st_size)
+				Elog("Parquet: ColumnChunk at RowGroup[%ld] is out of range", i);
+			cchunk->max_def_level = (elems[j+1].repetition == 1 ? 1 : 0);
+		}
+	}
+	pfree(elems);
+}
+
+/*
+ * readParquetPageHeader - returns length of the PageHeader
+ */
+static void
+readParquetDataPageHeader(ThriftCursor *c, ParquetPageHeader *phead,
+						  bool is_v2)
+{
+	int		fid = 0;
+	int		type;
+
+	while ((type = __thriftReadFieldBegin(c, &fid)) != ThriftType__STOP)
+	{
+		if (fid == 1)
+			phead->num_values = __thriftReadInt(c, type);
+		else if (!is_v2 && fid == 2)
+			phead->encoding = __thriftReadInt(c, type);
+		else if (is_v2 && fid == 2)
+			phead->num_nulls = __thriftReadInt(c, type);
+		else if (is_v2 && fid == 4)
+			phead->encoding = __thriftReadInt(c, type);
+		else if (is_v2 && fid == 5)
+			phead->def_levels_length = __thriftReadInt(c, type);
+		else if (is_v2 && fid == 6)
+			phead->rep_levels_length = __thriftReadInt(c, type);
+		else if (is_v2 && fid == 7)
+			phead->is_compressed = (type == ThriftType__TRUE);
+		else
+			__thriftSkipValue(c, type, 0);
+	}
+}
+
+size_t
+readParquetPageHeader(ParquetPageHeader *phead, const char *buf, size_t len)
+{
+	ThriftCursor c;
+	int		fid = 0;
+	int		type;
+
+	memset(phead, 0, sizeof(ParquetPageHeader));
+	phead->type = -1;
+	phead->is_compressed = true;
+	c.pos = (const unsigned char *)buf;
+	c.end = (const unsigned char *)buf + len;
+	while ((type = __thriftReadFieldBegin(&c, &fid)) != ThriftType__STOP)
+	{
+		switch (fid)
+		{
+			case 1:		/* type */
+				phead->type = __thriftReadInt(&c, type);
+				break;
+			case 2:		/* uncompressed_page_size */
+				phead->uncompressed_page_size = __thriftReadInt(&c, type);
+				break;
+			case 3:		/* compressed_page_size */
+				phead->compressed_page_size = __thriftReadInt(&c, type);
+				break;
+			case 5:		/* data_page_header */
+			case 7:		/* dictionary_page_header */
+				if (type != ThriftType__STRUCT)
+					Elog("Parquet: PageHeader is corrupted");
+				readParquetDataPageHeader(&c, phead, false);
+				break;
+			case 8:		/* data_page_header_v2 */
+				if (type != ThriftType__STRUCT)
+					Elog("Parquet: PageHeader is corrupted");
+				readParquetDataPageHeader(&c, phead, true);
+				break;
+			default:
+				__thriftSkipValue(&c, type, 0);
+				break;
+		}
+	}
+	if (phead->uncompressed_page_size < 0 ||
+		phead->compressed_page_size < 0 ||
+		phead->num_values < 0 ||
+		phead->def_levels_length < 0 ||
+		phead->rep_levels_length < 0)
+		Elog("Parquet: PageHeader is corrupted");
+	return (const char *)c.pos - buf;
+}
+
+/*
+ * readParquetFileDesc
+ */
+static void
+readParquetFileDesc(ArrowFileInfo *af_info, const char *mmap_head,
+					size_t file_sz)
+{
+	const char *tail = mmap_head + file_sz - PARQUET_FILE_SIGNATURE_SZ;
+	uint32		meta_len;
+
+	if (file_sz < 2 * PARQUET_FILE_SIGNATURE_SZ + sizeof(uint32))
+		Elog("Parquet file is too short (%zu bytes)", file_sz);
+	memcpy(&meta_len, tail - sizeof(uint32), sizeof(uint32));
+	if (meta_len > file_sz - 2 * PARQUET_FILE_SIGNATURE_SZ - sizeof(uint32))
+		Elog("Parquet: FileMetaData length (%u) is out of range", meta_len);
+	af_info->is_parquet = true;
+	readParquetFileMetaData(af_info,
+							tail - sizeof(uint32) - meta_len,
+							meta_len);
+}
+
 void
 readArrowFileDesc(int fdesc, ArrowFileInfo *af_info)
 {
@@ -1663,6 +2464,8 @@ readArrowFileDesc(int fdesc, ArrowFileInfo *af_info)
 	if (fstat(fdesc, &af_info->stat_buf) != 0)
 		Elog("failed on fstat: %m");
 	file_sz = af_info->stat_buf.st_size;
+	if (file_sz < ARROW_FILE_HEAD_SIGNATURE_SZ + ARROW_FILE_TAIL_SIGNATURE_SZ)
+		Elog("file is too short (%zu bytes) for Apache Arrow", file_sz);
 	mmap_sz = TYPEALIGN(sysconf(_SC_PAGESIZE), file_sz);
 	mmap_head = __mmap(NULL, mmap_sz, PROT_READ, MAP_SHARED, fdesc, 0);
 	if (mmap_head == MAP_FAILED)
@@ -1677,6 +2480,18 @@ readArrowFileDesc(int fdesc, ArrowFileInfo *af_info)
 			   ARROW_FILE_TAIL_SIGNATURE,
 			   ARROW_FILE_TAIL_SIGNATURE_SZ) != 0)
 	{
+		/* Apache Parquet files have 'PAR1' at the head and tail */
+		if (memcmp(mmap_head,
+				   PARQUET_FILE_SIGNATURE,
+				   PARQUET_FILE_SIGNATURE_SZ) == 0 &&
+			memcmp(mmap_head + file_sz - PARQUET_FILE_SIGNATURE_SZ,
+				   PARQUET_FILE_SIGNATURE,
+				   PARQUET_FILE_SIGNATURE_SZ) == 0)
+		{
+			readParquetFileDesc(af_info, mmap_head, file_sz);
+			__munmap(mmap_head, mmap_sz);
+			return;
+		}
 		Elog("Signature mismatch on Apache Arrow file");
 	}
 
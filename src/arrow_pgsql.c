@@ -16,6 +16,7 @@
  * GNU General Public License for more details.
  */
 #include "postgres.h"
+#include <math.h>
 #include "access/htup_details.h"
 #include "port/pg_bswap.h"
 #include "utils/array.h"
@@ -111,6 +112,55 @@ __put_inline_null_value(SQLfield *column, size_t row_index, int sz)
 	sql_buffer_append_zero(&column->values, sz);
 }
 
+/*
+ * utility functions to update min/max statistics, if enabled
+ */
+static inline void
+__update_stat_int_value(SQLfield *column, int64 value)
+{
+	SQLstat	   *stat = &column->stat_datum;
+
+	if (!column->stat_enabled)
+		return;
+	if (!stat->is_valid)
+	{
+		stat->min.i = value;
+		stat->max.i = value;
+		stat->is_valid = true;
+	}
+	else if (value < stat->min.i)
+		stat->min.i = value;
+	else if (value > stat->max.i)
+		stat->max.i = value;
+}
+
+static inline void
+__update_stat_float_value(SQLfield *column, double value)
+{
+	SQLstat	   *stat = &column->stat_datum;
+
+	if (!column->stat_enabled)
+		return;
+	if (!stat->is_valid)
+	{
+		stat->min.f = value;
+		stat->max.f = value;
+		stat->is_valid = true;
+	}
+	else if (isnan(value))
+	{
+		/* PostgreSQL considers NaN is larger than any other values */
+		stat->max.f = value;
+	}
+	else
+	{
+		if (isnan(stat->min.f) || value < stat->min.f)
+			stat->min.f = value;
+		if (!isnan(stat->max.f) && value > stat->max.f)
+			stat->max.f = value;
+	}
+}
+
 /*
  * IntXX/UintXX
  */
@@ -132,6 +182,7 @@ put_int8_value(SQLfield *column, const char *addr, int sz)
 
 		sql_buffer_setbit(&column->nullmap, row_index);
 		sql_buffer_append(&column->values, &value, sizeof(uint8));
+		__update_stat_int_value(column, (int8)value);
 	}
 	return __buffer_usage_inline_type(column);
 }
@@ -152,6 +203,7 @@ put_int16_value(SQLfield *column, const char *addr, int sz)
 			Elog("Uint16 cannot store negative values");
 		sql_buffer_setbit(&column->nullmap, row_index);
 		sql_buffer_append(&column->values, &value, sz);
+		__update_stat_int_value(column, (int16)value);
 	}
 	return __buffer_usage_inline_type(column);
 }
@@ -172,6 +224,7 @@ put_int32_value(SQLfield *column, const char *addr, int sz)
 			Elog("Uint32 cannot store negative values");
 		sql_buffer_setbit(&column->nullmap, row_index);
 		sql_buffer_append(&column->values, &value, sz);
+		__update_stat_int_value(column, (int32)value);
 	}
 	return __buffer_usage_inline_type(column);
 }
@@ -192,6 +245,7 @@ put_int64_value(SQLfield *column, const char *addr, int sz)
 			Elog("Uint64 cannot store negative values");
 		sql_buffer_setbit(&column->nullmap, row_index);
 		sql_buffer_append(&column->values, &value, sz);
+		__update_stat_int_value(column, (int64)value);
 	}
 	return __buffer_usage_inline_type(column);
 }
@@ -231,6 +285,13 @@ put_float32_value(SQLfield *column, const char *addr, int sz)
 		value = __ntoh32(*((const uint32 *)addr));
 		sql_buffer_setbit(&column->nullmap, row_index);
 		sql_buffer_append(&column->values, &value, sz);
+		if (column->stat_enabled)
+		{
+			float		fval;
+
+			memcpy(&fval, &value, sizeof(float));
+			__update_stat_float_value(column, fval);
+		}
 	}
 	return __buffer_usage_inline_type(column);
 }
@@ -249,6 +310,13 @@ put_float64_value(SQLfield *column, const char *addr, int sz)
 		value = __ntoh64(*((const uint64 *)addr));
 		sql_buffer_setbit(&column->nullmap, row_index);
 		sql_buffer_append(&column->values, &value, sz);
+		if (column->stat_enabled)
+		{
+			double		fval;
+
+			memcpy(&fval, &value, sizeof(double));
+			__update_stat_float_value(column, fval);
+		}
 	}
 	return __buffer_usage_inline_type(column);
 }
@@ -431,6 +499,9 @@ __put_date_value_generic(SQLfield *column, const char *addr, int pgsql_sz,
 		else if (adjustment < 0)
 			value /= adjustment;
 		sql_buffer_append(&column->values, &value, arrow_sz);
+		__update_stat_int_value(column, (arrow_sz == sizeof(int32)
+										 ? (int64)((int32)value)
+										 : (int64)value));
 	}
 	return __buffer_usage_inline_type(column);
 }
@@ -599,6 +670,7 @@ __put_timestamp_value_generic(SQLfield *column,
 			value /= adjustment;
 		sql_buffer_setbit(&column->nullmap, row_index);
 		sql_buffer_append(&column->values, &value, arrow_sz);
+		__update_stat_int_value(column, value);
 	}
 	return __buffer_usage_inline_type(column);
 }
@@ -1032,29 +1104,59 @@ put_dictionary_value(SQLfield *column,
 	}
 	else
 	{
-		SQLdictionary *enumdict = column->enumdict;
-		hashItem   *hitem;
-		uint32		hash;
-
-		hash = hash_any((const unsigned char *)addr, sz);
-		for (hitem = enumdict->hslots[hash % enumdict->nslots];
-			 hitem != NULL;
-			 hitem = hitem->next)
-		{
-			if (hitem->hash == hash &&
-				hitem->label_len == sz &&
-				memcmp(hitem->label, addr, sz) == 0)
-				break;
-		}
-		if (!hitem)
+		int32		index;
+
+		index = sql_dictionary_put_label(column->enumdict, addr, sz);
+		if (index < 0)
 			Elog("Enum label was not found in pg_enum result");
 
 		sql_buffer_setbit(&column->nullmap, row_index);
-        sql_buffer_append(&column->values,  &hitem->index, sizeof(int32));
+        sql_buffer_append(&column->values,  &index, sizeof(int32));
 	}
 	return __buffer_usage_inline_type(column);
 }
 
+/*
+ * sql_dictionary_put_label
+ *
+ * It returns index of the label in the dictionary. If not found, a new
+ * label is added on the dynamic dictionary, or -1 is returned.
+ */
+int
+sql_dictionary_put_label(SQLdictionary *dict, const char *label, int len)
+{
+	hashItem   *hitem;
+	uint32		hash;
+	int			j;
+
+	hash = hash_any((const unsigned char *)label, len);
+	j = hash % dict->nslots;
+	for (hitem = dict->hslots[j]; hitem != NULL; hitem = hitem->next)
+	{
+		if (hitem->hash == hash &&
+			hitem->label_len == len &&
+			memcmp(hitem->label, label, len) == 0)
+			return hitem->index;
+	}
+	if (!dict->is_dynamic)
+		return -1;
+
+	hitem = palloc0(offsetof(hashItem, label[len + 1]));
+	memcpy(hitem->label, label, len);
+	hitem->label_len = len;
+	hitem->index = dict->nitems++;
+	hitem->hash = hash;
+	hitem->next = dict->hslots[j];
+	dict->hslots[j] = hitem;
+
+	if (dict->values.usage == 0)
+		sql_buffer_append_zero(&dict->values, sizeof(int32));
+	sql_buffer_append(&dict->extra, label, len);
+	sql_buffer_append(&dict->values, &dict->extra.usage, sizeof(int32));
+
+	return hitem->index;
+}
+
 /* ----------------------------------------------------------------
  *
  * setup handler for each data types
@@ -1282,6 +1384,26 @@ assignArrowTypeDictionary(SQLfield *column)
 	return 2;	/* nullmap + values */
 }
 
+/*
+ * sql_field_enable_dictionary
+ *
+ * It switches a Utf8 field to dictionary-encoded one. Caller must adjust
+ * the number of buffers, because extra buffer is no longer needed.
+ */
+bool
+sql_field_enable_dictionary(SQLfield *column, SQLdictionary *dict)
+{
+	if (column->arrow_type.node.tag != ArrowNodeTag__Utf8 ||
+		column->enumdict || column->element || column->subfields ||
+		column->nitems > 0)
+		return false;
+	column->enumdict		= dict;
+	column->arrow_typename	= psprintf("Utf8; dictionary=%d", dict->dict_id);
+	column->put_value		= put_dictionary_value;
+
+	return true;
+}
+
 /*
  * assignArrowTypePgSQL
  */
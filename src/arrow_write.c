@@ -1038,22 +1038,28 @@ __writeArrowDictionaryBatch(int fdesc, SQLdictionary *dict)
 	return block;
 }
 
+/*
+ * NOTE: dictionaries with fixed labels (like enum) are written prior to
+ * the RecordBatches. On the other hands, labels of dynamic dictionaries
+ * are added during the data loading, so they have to be written after
+ * all the RecordBatches (is_dynamic = true).
+ */
 void
-writeArrowDictionaryBatches(SQLtable *table)
+writeArrowDictionaryBatches(SQLtable *table, bool is_dynamic)
 {
 	SQLdictionary  *dict;
-	int				index = 0;
+	int				index = table->numDictionaries;
 
-	for (dict = table->sql_dict_list, index=0;
-		 dict != NULL;
-		 dict = dict->next, index++)
+	for (dict = table->sql_dict_list; dict != NULL; dict = dict->next)
 	{
+		if ((dict->is_dynamic != 0) != is_dynamic)
+			continue;
 		if (!table->dictionaries)
 			table->dictionaries = palloc0(sizeof(ArrowBlock) * 32);
-		else
+		else if (index >= 32)
 			table->dictionaries = repalloc(table->dictionaries,
-										   sizeof(ArrowBlock) * index);
-		table->dictionaries[index]
+										   sizeof(ArrowBlock) * (index+1));
+		table->dictionaries[index++]
 			= __writeArrowDictionaryBatch(table->fdesc, dict);
 	}
 	table->numDictionaries = index;
@@ -1454,6 +1460,22 @@ writeArrowRecordBatch(SQLtable *table)
 	block->metaDataLength = metaLength;
 	block->bodyLength = bodyLength;
 
+	/* save min/max statistics of the RecordBatch, if any */
+	for (j=0; j < table->nfields; j++)
+	{
+		SQLfield   *column = &table->columns[j];
+		SQLstat	   *stat;
+
+		if (!column->stat_enabled)
+			continue;
+		stat = palloc(sizeof(SQLstat));
+		memcpy(stat, &column->stat_datum, sizeof(SQLstat));
+		stat->rb_index = index;
+		stat->next = column->stat_list;
+		column->stat_list = stat;
+		memset(&column->stat_datum, 0, sizeof(SQLstat));
+	}
+
 	/* make the local buffer empty again */
 	for (j=0; j < table->nfields; j++)
 		sql_field_clear(&table->columns[j]);
@@ -1462,6 +1484,219 @@ writeArrowRecordBatch(SQLtable *table)
 	return index;
 }
 
+/*
+ * setupArrowFieldStat
+ *
+ * It adds "min_values" and "max_values" custom-metadata on the field that
+ * keeps min/max statistics of the values for each RecordBatch, as a comma
+ * separated list. An empty token means no valid statistics for the batch.
+ */
+static bool
+__stat_value_is_float(SQLfield *column)
+{
+	return (column->arrow_type.node.tag == ArrowNodeTag__FloatingPoint);
+}
+
+static const char *
+__setupArrowFieldStatValues(SQLfield *column, int numRecordBatches,
+							SQLstat **stat_array, bool is_max)
+{
+	SQLbuffer	buf;
+	char		temp[64];
+	int			i, len;
+
+	sql_buffer_init(&buf);
+	for (i=0; i < numRecordBatches; i++)
+	{
+		SQLstat	   *stat = stat_array[i];
+
+		if (i > 0)
+			sql_buffer_append(&buf, ",", 1);
+		if (!stat || !stat->is_valid)
+			continue;
+		if (__stat_value_is_float(column))
+			len = snprintf(temp, sizeof(temp), "%.17g",
+						   is_max ? stat->max.f : stat->min.f);
+		else
+			len = snprintf(temp, sizeof(temp), "%ld",
+						   (long)(is_max ? stat->max.i : stat->min.i));
+		sql_buffer_append(&buf, temp, len);
+	}
+	sql_buffer_append_zero(&buf, 1);
+
+	return buf.data;
+}
+
+static void
+setupArrowFieldStat(ArrowField *field, SQLfield *column,
+					int numRecordBatches)
+{
+	ArrowKeyValue *kv;
+	SQLstat	  **stat_array;
+	SQLstat	   *stat;
+	const char *min_values;
+	const char *max_values;
+	int			i, nitems = 0;
+
+	if (!column->stat_enabled || numRecordBatches == 0)
+		return;
+	stat_array = palloc0(sizeof(SQLstat *) * numRecordBatches);
+	for (stat = column->stat_list; stat; stat = stat->next)
+	{
+		if (stat->rb_index >= 0 && stat->rb_index < numRecordBatches)
+			stat_array[stat->rb_index] = stat;
+	}
+	min_values = __setupArrowFieldStatValues(column, numRecordBatches,
+											 stat_array, false);
+	max_values = __setupArrowFieldStatValues(column, numRecordBatches,
+											 stat_array, true);
+	pfree(stat_array);
+
+	kv = palloc0(sizeof(ArrowKeyValue) * (field->_num_custom_metadata + 2));
+	for (i=0; i < field->_num_custom_metadata; i++)
+	{
+		ArrowKeyValue  *__kv = &field->custom_metadata[i];
+
+		/* stale statistics shall be replaced */
+		if (strcmp(__kv->key, "min_values") == 0 ||
+			strcmp(__kv->key, "max_values") == 0)
+			continue;
+		memcpy(&kv[nitems++], __kv, sizeof(ArrowKeyValue));
+	}
+	initArrowNode(&kv[nitems], KeyValue);
+	kv[nitems].key = "min_values";
+	kv[nitems]._key_len = 10;
+	kv[nitems].value = min_values;
+	kv[nitems]._value_len = strlen(min_values);
+	nitems++;
+	initArrowNode(&kv[nitems], KeyValue);
+	kv[nitems].key = "max_values";
+	kv[nitems]._key_len = 10;
+	kv[nitems].value = max_values;
+	kv[nitems]._value_len = strlen(max_values);
+	nitems++;
+
+	field->custom_metadata = kv;
+	field->_num_custom_metadata = nitems;
+}
+
+/*
+ * sql_field_enable_stat
+ *
+ * It enables min/max statistics on the field, if data type is supported.
+ */
+bool
+sql_field_enable_stat(SQLfield *column)
+{
+	if (column->enumdict || column->element || column->subfields)
+		return false;
+	switch (column->arrow_type.node.tag)
+	{
+		case ArrowNodeTag__Int:
+			break;
+		case ArrowNodeTag__FloatingPoint:
+			if (column->arrow_type.FloatingPoint.precision
+				!= ArrowPrecision__Single &&
+				column->arrow_type.FloatingPoint.precision
+				!= ArrowPrecision__Double)
+				return false;
+			break;
+		case ArrowNodeTag__Date:
+		case ArrowNodeTag__Timestamp:
+			break;
+		default:
+			return false;
+	}
+	column->stat_enabled = true;
+	memset(&column->stat_datum, 0, sizeof(SQLstat));
+	return true;
+}
+
+/*
+ * sql_field_restore_stat
+ *
+ * It restores min/max statistics of the RecordBatches already written,
+ * when new RecordBatches are appended to the existing file.
+ */
+static void
+__sql_field_restore_stat_values(SQLfield *column, SQLstat **stat_array,
+								int numRecordBatches,
+								const char *values, bool is_max)
+{
+	const char *pos = values;
+	int			index = 0;
+
+	while (pos && index < numRecordBatches)
+	{
+		const char *tail = strchr(pos, ',');
+		char	   *end = (char *)pos;
+		SQLstat	   *stat = stat_array[index];
+		SQLstat__datum datum;
+
+		if (pos != tail && *pos != '\0')
+		{
+			if (__stat_value_is_float(column))
+				datum.f = strtod(pos, &end);
+			else
+				datum.i = strtol(pos, &end, 10);
+		}
+		if (end == pos || (*end != ',' && *end != '\0'))
+			stat->is_valid = false;		/* empty or corrupted token */
+		else if (!is_max)
+		{
+			stat->min = datum;
+			stat->is_valid = true;
+		}
+		else
+			stat->max = datum;			/* valid only if min is valid */
+		pos = (tail ? tail + 1 : NULL);
+		index++;
+	}
+}
+
+void
+sql_field_restore_stat(SQLfield *column, ArrowField *field,
+					   int numRecordBatches)
+{
+	const char *min_values = NULL;
+	const char *max_values = NULL;
+	SQLstat	  **stat_array;
+	int			i;
+
+	if (!column->stat_enabled || numRecordBatches == 0)
+		return;
+	for (i=0; i < field->_num_custom_metadata; i++)
+	{
+		ArrowKeyValue  *kv = &field->custom_metadata[i];
+
+		if (strcmp(kv->key, "min_values") == 0)
+			min_values = kv->value;
+		else if (strcmp(kv->key, "max_values") == 0)
+			max_values = kv->value;
+	}
+	if (!min_values || !max_values)
+		return;
+
+	stat_array = palloc0(sizeof(SQLstat *) * numRecordBatches);
+	for (i=0; i < numRecordBatches; i++)
+	{
+		stat_array[i] = palloc0(sizeof(SQLstat));
+		stat_array[i]->rb_index = i;
+	}
+	__sql_field_restore_stat_values(column, stat_array, numRecordBatches,
+									min_values, false);
+	__sql_field_restore_stat_values(column, stat_array, numRecordBatches,
+									max_values, true);
+	for (i=0; i < numRecordBatches; i++)
+	{
+		SQLstat	   *stat = stat_array[i];
+
+		stat->next = column->stat_list;
+		column->stat_list = stat;
+	}
+	pfree(stat_array);
+}
+
 /*
  * writeArrowFooter
  */
@@ -1483,7 +1718,11 @@ writeArrowFooter(SQLtable *table)
 	schema->fields = alloca(sizeof(ArrowField) * table->nfields);
 	schema->_num_fields = table->nfields;
 	for (i=0; i < table->nfields; i++)
+	{
 		setupArrowField(&schema->fields[i], &table->columns[i]);
+		setupArrowFieldStat(&schema->fields[i], &table->columns[i],
+							table->numRecordBatches);
+	}
 	schema->custom_metadata = table->customMetadata;
 	schema->_num_custom_metadata = table->numCustomMetadata;
 
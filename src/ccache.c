@@ -0,0 +1,1947 @@
+/*
+ * ccache.c
+ *
+ * Columnar cache implementation of PG-Strom
+ * ----
+ * Copyright 2011-2020 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2020 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "pg_strom.h"
+
+/*
+ * ccacheChunk
+ *
+ * A columnar cache chunk covers CCACHE_CHUNK_NBLOCKS heap blocks from the
+ * @block_nr, and it is saved as an Apache Arrow file that contains only one
+ * RecordBatch of the cached columns. So, GpuScan/GpuJoin/GpuPreAgg load the
+ * chunk using the code path of Arrow_Fdw, including SSD2GPU Direct SQL.
+ */
+typedef struct
+{
+	dlist_node	lru_chain;		/* link to LRU list */
+	dlist_node	hash_chain;		/* link to Hash list */
+	pg_crc32	hash;			/* hash value */
+	Oid			database_oid;	/* OID of the cached database */
+	Oid			table_oid;		/* OID of the cached table */
+	Oid			relfilenode;	/* relfilenode of the cached table */
+	BlockNumber	block_nr;		/* block number where is head of the chunk */
+	cl_uint		generation;		/* unique number to identify the file */
+	size_t		length;			/* length of the ccache file */
+	cl_uint		nitems;			/* number of rows cached */
+	cl_int		refcnt;			/* reference counter */
+	TimestampTz	ctime;			/* timestamp of the cache creation.
+								 * may be zero, if not constructed yet. */
+	TimestampTz	atime;			/* time of the latest access */
+	/* device image of the chunk file, if any */
+	cl_int		gpu_dindex;		/* device index of the image */
+	size_t		gpu_length;		/* length of the image, or 0 if none */
+	CUipcMemHandle gpu_mhandle;	/* IPC handle of the preserved memory */
+} ccacheChunk;
+
+#define CCACHE_CTIME_NOT_BUILD		(0)
+#define CCACHE_CTIME_IN_PROGRESS	(DT_NOEND)
+#define CCACHE_CTIME_IS_READY(ctime)			\
+	((ctime) != CCACHE_CTIME_NOT_BUILD && (ctime) != CCACHE_CTIME_IN_PROGRESS)
+
+typedef struct
+{
+	slock_t			chunks_lock;
+	size_t			ccache_usage;
+	cl_uint			generation;
+	dlist_head		lru_misshit_list;
+	dlist_head		lru_active_list;
+	dlist_head		free_chunks_list;
+	dlist_head		gpu_release_list;	/* chunks with device image, but
+										 * no longer referenced */
+	dlist_head		active_slots[FLEXIBLE_ARRAY_MEMBER];
+} ccacheState;
+
+/*
+ * ccacheDeviceImage - a device image to be released out of the spinlock
+ */
+typedef struct
+{
+	cl_int			cuda_dindex;
+	CUipcMemHandle	gpu_mhandle;
+} ccacheDeviceImage;
+
+#define CCACHE_NUM_RELEASE_IMAGES	8
+
+/*
+ * ccacheDeviceRef - reference to the device image of a chunk, mapped by the
+ * scan. It is tracked on the TopMemoryContext, to release the chunk and the
+ * preserved device memory at end of the transaction, even if aborted.
+ */
+typedef struct
+{
+	dlist_node		chain;
+	ccacheChunk	   *cc_chunk;
+	cl_int			cuda_dindex;
+	CUipcMemHandle	gpu_mhandle;
+	GpuContext	   *gcontext;
+	CUdeviceptr		m_gbuf;
+} ccacheDeviceRef;
+
+/*
+ * ccacheScanState - per-scan state of the columnar cache
+ */
+struct ccacheScanState
+{
+	MemoryContext	memcxt;		/* per-query memory context */
+	Bitmapset	   *ccache_refs;	/* columns cached on the relation */
+	List		   *ccache_files;	/* chunk files opened by the scan */
+	List		   *device_refs;	/* device images mapped by the scan */
+};
+typedef struct ccacheScanState	ccacheScanState;
+
+/* static variables */
+static shmem_startup_hook_type shmem_startup_next = NULL;
+static bool			pgstrom_enable_ccache;		/* GUC */
+static size_t		ccache_total_size;			/* GUC */
+static char		   *ccache_base_dir_name;		/* GUC */
+static char		   *ccache_databases;			/* GUC */
+static int			ccache_num_builders;		/* GUC */
+static int			ccache_gpu_size_kb;			/* GUC */
+static char			ccache_base_dir[MAXPGPATH];
+static List		   *ccache_database_list = NIL;
+static ccacheState *ccache_state = NULL;		/* shmem */
+static size_t	   *ccache_gpu_usage = NULL;	/* shmem, per device */
+static dlist_head	ccache_device_refs;
+static cl_int		ccache_num_chunks;
+static cl_int		ccache_num_slots;
+static Oid			ccache_invalidator_func_oid = InvalidOid;
+static volatile bool ccache_builder_got_signal = false;
+
+/* functions */
+Datum pgstrom_ccache_invalidator(PG_FUNCTION_ARGS);
+Datum pgstrom_ccache_info(PG_FUNCTION_ARGS);
+Datum pgstrom_ccache_prewarm(PG_FUNCTION_ARGS);
+void  ccacheBuilderMain(Datum arg);
+
+/*
+ * ccache_compute_hashvalue
+ */
+static inline pg_crc32
+ccache_compute_hashvalue(Oid database_oid, Oid table_oid, BlockNumber block_nr)
+{
+	pg_crc32	hash;
+
+	Assert((block_nr & (CCACHE_CHUNK_NBLOCKS - 1)) == 0);
+	INIT_LEGACY_CRC32(hash);
+	COMP_LEGACY_CRC32(hash, &database_oid, sizeof(Oid));
+	COMP_LEGACY_CRC32(hash, &table_oid, sizeof(Oid));
+	COMP_LEGACY_CRC32(hash, &block_nr, sizeof(BlockNumber));
+	FIN_LEGACY_CRC32(hash);
+
+	return hash;
+}
+
+/*
+ * ccache_chunk_filename
+ *
+ * @generation is a part of the filename, because a new chunk of the same
+ * block range can be built while the invalidated one is still referenced.
+ */
+static inline void
+ccache_chunk_filename(char *fname, ccacheChunk *cc_chunk)
+{
+	Assert((cc_chunk->block_nr & (CCACHE_CHUNK_NBLOCKS - 1)) == 0);
+
+	snprintf(fname, MAXPGPATH, "%s/CC%u_%u_%u.%u.arrow",
+			 ccache_base_dir,
+			 cc_chunk->database_oid,
+			 cc_chunk->table_oid,
+			 cc_chunk->block_nr / CCACHE_CHUNK_NBLOCKS,
+			 cc_chunk->generation);
+}
+
+/*
+ * ccache_put_chunk
+ */
+static void
+ccache_put_chunk_nolock(ccacheChunk *cc_chunk)
+{
+	Assert(cc_chunk->refcnt > 0);
+	if (--cc_chunk->refcnt == 0)
+	{
+		char		fname[MAXPGPATH];
+
+		Assert(cc_chunk->hash_chain.prev == NULL &&
+			   cc_chunk->hash_chain.next == NULL);
+		if (cc_chunk->lru_chain.prev != NULL ||
+			cc_chunk->lru_chain.next != NULL)
+			dlist_delete(&cc_chunk->lru_chain);
+		if (CCACHE_CTIME_IS_READY(cc_chunk->ctime))
+		{
+			Assert(cc_chunk->length > 0);
+			ccache_chunk_filename(fname, cc_chunk);
+			if (unlink(fname) != 0)
+				elog(WARNING, "failed on unlink('%s'): %m", fname);
+			Assert(ccache_state->ccache_usage >= TYPEALIGN(BLCKSZ,
+														   cc_chunk->length));
+			ccache_state->ccache_usage -= TYPEALIGN(BLCKSZ, cc_chunk->length);
+		}
+		if (cc_chunk->gpu_length > 0)
+		{
+			/*
+			 * gpuMemFreePreserved() is a blocking request to the keeper,
+			 * so device image shall be released out of the spinlock, by
+			 * ccache_release_device_images().
+			 */
+			dlist_push_tail(&ccache_state->gpu_release_list,
+							&cc_chunk->hash_chain);
+		}
+		else
+		{
+			/* back to the free list */
+			memset(cc_chunk, 0, sizeof(ccacheChunk));
+			dlist_push_head(&ccache_state->free_chunks_list,
+							&cc_chunk->hash_chain);
+		}
+	}
+}
+
+static void
+ccache_put_chunk(ccacheChunk *cc_chunk)
+{
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	ccache_put_chunk_nolock(cc_chunk);
+	SpinLockRelease(&ccache_state->chunks_lock);
+}
+
+/*
+ * ccache_release_device_images
+ *
+ * It frees the device images of the chunks already released, then returns
+ * the chunks to the free list.
+ */
+static void
+ccache_release_device_images(void)
+{
+	ccacheDeviceImage images[CCACHE_NUM_RELEASE_IMAGES];
+	int			i, nitems;
+	CUresult	rc;
+
+	do {
+		nitems = 0;
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		while (nitems < CCACHE_NUM_RELEASE_IMAGES &&
+			   !dlist_is_empty(&ccache_state->gpu_release_list))
+		{
+			dlist_node *dnode
+				= dlist_pop_head_node(&ccache_state->gpu_release_list);
+			ccacheChunk *cc_chunk
+				= dlist_container(ccacheChunk, hash_chain, dnode);
+
+			Assert(cc_chunk->refcnt == 0 && cc_chunk->gpu_length > 0);
+			images[nitems].cuda_dindex = cc_chunk->gpu_dindex;
+			images[nitems].gpu_mhandle = cc_chunk->gpu_mhandle;
+			nitems++;
+			Assert(ccache_gpu_usage[cc_chunk->gpu_dindex] >=
+				   cc_chunk->gpu_length);
+			ccache_gpu_usage[cc_chunk->gpu_dindex] -= cc_chunk->gpu_length;
+			memset(cc_chunk, 0, sizeof(ccacheChunk));
+			dlist_push_head(&ccache_state->free_chunks_list,
+							&cc_chunk->hash_chain);
+		}
+		SpinLockRelease(&ccache_state->chunks_lock);
+
+		for (i=0; i < nitems; i++)
+		{
+			/* CUDA_ERROR_NOT_FOUND, if already evicted by the keeper */
+			rc = gpuMemFreePreserved(images[i].cuda_dindex,
+									 images[i].gpu_mhandle);
+			if (rc != CUDA_SUCCESS && rc != CUDA_ERROR_NOT_FOUND)
+				elog(WARNING, "failed on gpuMemFreePreserved: %s",
+					 errorText(rc));
+		}
+	} while (nitems == CCACHE_NUM_RELEASE_IMAGES);
+}
+
+/*
+ * ccache_invalidate_chunk_nolock
+ *
+ * It detaches the chunk from the hash slot, then the chunk shall be released
+ * when the last reference is gone.
+ */
+static void
+ccache_invalidate_chunk_nolock(ccacheChunk *cc_chunk)
+{
+	Assert(cc_chunk->hash_chain.prev != NULL &&
+		   cc_chunk->hash_chain.next != NULL);
+	dlist_delete(&cc_chunk->hash_chain);
+	memset(&cc_chunk->hash_chain, 0, sizeof(dlist_node));
+	if (cc_chunk->lru_chain.prev != NULL &&
+		cc_chunk->lru_chain.next != NULL)
+	{
+		dlist_delete(&cc_chunk->lru_chain);
+		memset(&cc_chunk->lru_chain, 0, sizeof(dlist_node));
+	}
+	ccache_put_chunk_nolock(cc_chunk);
+}
+
+/*
+ * ccache_get_chunk
+ *
+ * It returns a chunk which is ready to load, with reference counter.
+ * Elsewhere, it registers the chunk as a misshit entry, to be built by
+ * the background workers later, then returns NULL.
+ */
+static ccacheChunk *
+ccache_get_chunk(Relation relation, BlockNumber block_nr)
+{
+	Oid			table_oid = RelationGetRelid(relation);
+	Oid			relfilenode = relation->rd_node.relNode;
+	pg_crc32	hash;
+	cl_int		index;
+	dlist_iter	iter;
+	dlist_node *dnode;
+	ccacheChunk *cc_chunk = NULL;
+	ccacheChunk *cc_temp;
+	TimestampTz	now = GetCurrentTimestamp();
+
+	hash = ccache_compute_hashvalue(MyDatabaseId, table_oid, block_nr);
+	index = hash % ccache_num_slots;
+
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	dlist_foreach (iter, &ccache_state->active_slots[index])
+	{
+		cc_temp = dlist_container(ccacheChunk, hash_chain, iter.cur);
+		if (cc_temp->hash == hash &&
+			cc_temp->database_oid == MyDatabaseId &&
+			cc_temp->table_oid == table_oid &&
+			cc_temp->block_nr == block_nr)
+		{
+			/* the chunk was built prior to TRUNCATE, VACUUM FULL, ... */
+			if (cc_temp->relfilenode != relfilenode)
+			{
+				ccache_invalidate_chunk_nolock(cc_temp);
+				break;
+			}
+			cc_temp->atime = now;
+			if (cc_temp->ctime == CCACHE_CTIME_NOT_BUILD)
+			{
+				dlist_move_head(&ccache_state->lru_misshit_list,
+								&cc_temp->lru_chain);
+			}
+			else if (CCACHE_CTIME_IS_READY(cc_temp->ctime))
+			{
+				dlist_move_head(&ccache_state->lru_active_list,
+								&cc_temp->lru_chain);
+				cc_chunk = cc_temp;
+				cc_chunk->refcnt++;
+			}
+			goto found;
+		}
+	}
+	Assert(cc_chunk == NULL);
+	/* no chunks are tracked, add it as misshit entry */
+	if (!dlist_is_empty(&ccache_state->free_chunks_list))
+	{
+		dnode = dlist_pop_head_node(&ccache_state->free_chunks_list);
+		cc_temp = dlist_container(ccacheChunk, hash_chain, dnode);
+		Assert(cc_temp->refcnt == 0);
+	}
+	else if (!dlist_is_empty(&ccache_state->lru_misshit_list))
+	{
+		dnode = dlist_tail_node(&ccache_state->lru_misshit_list);
+		cc_temp = dlist_container(ccacheChunk, lru_chain, dnode);
+		Assert(cc_temp->refcnt == 1 &&
+			   cc_temp->ctime == CCACHE_CTIME_NOT_BUILD);
+		dlist_delete(&cc_temp->hash_chain);
+		dlist_delete(&cc_temp->lru_chain);
+	}
+	else
+		goto found;		/* no more entries to track */
+
+	memset(cc_temp, 0, sizeof(ccacheChunk));
+	cc_temp->hash = hash;
+	cc_temp->database_oid = MyDatabaseId;
+	cc_temp->table_oid = table_oid;
+	cc_temp->relfilenode = relfilenode;
+	cc_temp->block_nr = block_nr;
+	cc_temp->refcnt = 1;
+	cc_temp->atime = now;
+	dlist_push_tail(&ccache_state->active_slots[index],
+					&cc_temp->hash_chain);
+	dlist_push_head(&ccache_state->lru_misshit_list,
+					&cc_temp->lru_chain);
+found:
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	return cc_chunk;
+}
+
+/*
+ * ccache_reclaim_chunks_nolock
+ *
+ * It releases the least recently used chunks, until @required bytes can be
+ * allocated within the pg_strom.ccache_total_size.
+ */
+static bool
+ccache_reclaim_chunks_nolock(size_t required)
+{
+	dlist_mutable_iter iter;
+
+	if (required > ccache_total_size)
+		return false;
+	dlist_reverse_foreach_modify(iter, &ccache_state->lru_active_list)
+	{
+		ccacheChunk *cc_temp = dlist_container(ccacheChunk,
+											   lru_chain, iter.cur);
+		if (ccache_state->ccache_usage + required <= ccache_total_size)
+			break;
+		/* chunks still referenced by scan are not reclaimable */
+		if (cc_temp->refcnt > 1)
+			continue;
+		ccache_invalidate_chunk_nolock(cc_temp);
+	}
+	return (ccache_state->ccache_usage + required <= ccache_total_size);
+}
+
+/*
+ * ccache_invalidator_oid - returns OID of invalidator trigger function
+ */
+static Oid
+ccache_invalidator_oid(void)
+{
+	Oid			namespace_oid;
+	oidvector	proc_args;
+
+	if (!OidIsValid(ccache_invalidator_func_oid))
+	{
+		namespace_oid = get_namespace_oid("pgstrom", true);
+		if (!OidIsValid(namespace_oid))
+			return InvalidOid;
+
+		SET_VARSIZE(&proc_args, offsetof(oidvector, values));
+		proc_args.ndim = 1;
+		proc_args.dataoffset = 0;
+		proc_args.elemtype = OIDOID;
+		proc_args.dim1 = 0;
+		proc_args.lbound1 = 1;
+
+		ccache_invalidator_func_oid = get_function_oid("ccache_invalidator",
+													   &proc_args,
+													   namespace_oid,
+													   true);
+	}
+	return ccache_invalidator_func_oid;
+}
+
+/*
+ * ccache_callback_on_procoid - catcache callback on PROCOID
+ */
+static void
+ccache_callback_on_procoid(Datum arg, int cacheid, uint32 hashvalue)
+{
+	Assert(cacheid == PROCOID);
+	ccache_invalidator_func_oid = InvalidOid;
+}
+
+/*
+ * ccache_column_is_supported
+ *
+ * Only built-in data types that have identical Apache Arrow representation
+ * can be cached, because the chunk is read by the Arrow_Fdw routines.
+ */
+static bool
+ccache_column_is_supported(Form_pg_attribute attr)
+{
+	if (attr->attisdropped)
+		return false;
+	switch (attr->atttypid)
+	{
+		case BOOLOID:
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case FLOAT2OID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case NUMERICOID:
+		case DATEOID:
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		case TEXTOID:
+		case BYTEAOID:
+			return true;
+		default:
+			break;
+	}
+	return false;
+}
+
+/*
+ * RelationCanUseColumnarCache
+ *
+ * It checks whether the relation has invalidator triggers configured
+ * correctly, and returns the set of cached columns (as offset from the
+ * FirstLowInvalidHeapAttributeNumber) if any. Arguments of the triggers
+ * are the name of the columns to be cached; all the supported columns are
+ * cached if no arguments.
+ */
+bool
+RelationCanUseColumnarCache(Relation relation, Bitmapset **p_ccache_refs)
+{
+	TriggerDesc *trigdesc = relation->trigdesc;
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	Oid			invalidator_oid;
+	Trigger	   *trig_row = NULL;
+	bool		has_row_insert = false;
+	bool		has_row_update = false;
+	bool		has_row_delete = false;
+	bool		has_stmt_truncate = false;
+	Bitmapset  *ccache_refs = NULL;
+	int			i, j;
+
+	if (RelationGetForm(relation)->relkind != RELKIND_RELATION &&
+		RelationGetForm(relation)->relkind != RELKIND_MATVIEW)
+		return false;
+	if (!trigdesc ||
+		!trigdesc->trig_insert_after_row ||
+		!trigdesc->trig_update_after_row ||
+		!trigdesc->trig_delete_after_row ||
+		!trigdesc->trig_truncate_after_statement)
+		return false;
+	invalidator_oid = ccache_invalidator_oid();
+	if (!OidIsValid(invalidator_oid))
+		return false;
+
+	for (i=0; i < trigdesc->numtriggers; i++)
+	{
+		Trigger	   *trigger = &trigdesc->triggers[i];
+
+		if (trigger->tgfoid != invalidator_oid)
+			continue;
+		if (trigger->tgenabled != TRIGGER_FIRES_ALWAYS)
+			continue;
+		if (TRIGGER_FOR_AFTER(trigger->tgtype))
+		{
+			if (TRIGGER_FOR_ROW(trigger->tgtype))
+			{
+				if (TRIGGER_FOR_INSERT(trigger->tgtype))
+					has_row_insert = true;
+				if (TRIGGER_FOR_UPDATE(trigger->tgtype))
+					has_row_update = true;
+				if (TRIGGER_FOR_DELETE(trigger->tgtype))
+					has_row_delete = true;
+				trig_row = trigger;
+			}
+			else
+			{
+				if (TRIGGER_FOR_TRUNCATE(trigger->tgtype))
+					has_stmt_truncate = true;
+			}
+		}
+	}
+	if (!has_row_insert ||
+		!has_row_update ||
+		!has_row_delete ||
+		!has_stmt_truncate)
+		return false;
+
+	/* columns to be cached */
+	Assert(trig_row != NULL);
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
+
+		if (!ccache_column_is_supported(attr))
+			continue;
+		if (trig_row->tgnargs > 0)
+		{
+			for (i=0; i < trig_row->tgnargs; i++)
+			{
+				if (strcmp(trig_row->tgargs[i], NameStr(attr->attname)) == 0)
+					break;
+			}
+			if (i == trig_row->tgnargs)
+				continue;
+		}
+		ccache_refs = bms_add_member(ccache_refs, attr->attnum -
+									 FirstLowInvalidHeapAttributeNumber);
+	}
+	if (bms_is_empty(ccache_refs))
+		return false;
+	if (p_ccache_refs)
+		*p_ccache_refs = ccache_refs;
+	return true;
+}
+
+/*
+ * pgstromExecInitColumnarCache
+ */
+void
+pgstromExecInitColumnarCache(GpuTaskState *gts)
+{
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	ccacheScanState *cc_state;
+	Bitmapset  *ccache_refs;
+
+	gts->ccache_state = NULL;
+	gts->ccache_count = 0;
+	gts->ccache_device_count = 0;
+	if (!pgstrom_enable_ccache || !relation)
+		return;
+	if (!RelationCanUseColumnarCache(relation, &ccache_refs))
+		return;
+	/* all the referenced columns must be cached, and no system columns */
+	if (!bms_is_subset(gts->outer_refs, ccache_refs))
+		return;
+
+	cc_state = palloc0(sizeof(ccacheScanState));
+	cc_state->memcxt = CurrentMemoryContext;
+	cc_state->ccache_refs = ccache_refs;
+	cc_state->ccache_files = NIL;
+	cc_state->device_refs = NIL;
+
+	gts->ccache_state = cc_state;
+}
+
+/*
+ * pgstromColumnarCacheIsReady
+ *
+ * It checks whether the chunk at @block_nr is already cached, to return
+ * the PDS under construction prior to the columnar cache.
+ */
+bool
+pgstromColumnarCacheIsReady(GpuTaskState *gts, BlockNumber block_nr)
+{
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	ccacheChunk *cc_chunk;
+
+	Assert(gts->ccache_state != NULL);
+	cc_chunk = ccache_get_chunk(relation, block_nr);
+	if (!cc_chunk)
+		return false;
+	ccache_put_chunk(cc_chunk);
+	return true;
+}
+
+/*
+ * ccache_reserve_device_nolock
+ *
+ * It checks whether a new device image of @length bytes fits the budget of
+ * the device (pg_strom.ccache_gpu_size), and detaches the device images of
+ * the least recently used chunks not referenced by any scans. The detached
+ * images are returned by @victims, to be released by the caller out of the
+ * spinlock.
+ */
+static bool
+ccache_reserve_device_nolock(cl_int cuda_dindex, size_t length,
+							 ccacheDeviceImage *victims, int *p_nvictims)
+{
+	size_t		budget = (size_t)ccache_gpu_size_kb << 10;
+	size_t	   *usage = &ccache_gpu_usage[cuda_dindex];
+	int			nvictims = 0;
+	dlist_iter	iter;
+
+	if (length > budget)
+		return false;
+	dlist_reverse_foreach(iter, &ccache_state->lru_active_list)
+	{
+		ccacheChunk *cc_temp = dlist_container(ccacheChunk,
+											   lru_chain, iter.cur);
+		if (*usage + length <= budget ||
+			nvictims >= CCACHE_NUM_RELEASE_IMAGES)
+			break;
+		if (cc_temp->gpu_length == 0 ||
+			cc_temp->gpu_dindex != cuda_dindex ||
+			cc_temp->refcnt > 1)
+			continue;
+		victims[nvictims].cuda_dindex = cc_temp->gpu_dindex;
+		victims[nvictims].gpu_mhandle = cc_temp->gpu_mhandle;
+		nvictims++;
+		*usage -= cc_temp->gpu_length;
+		cc_temp->gpu_length = 0;
+	}
+	*p_nvictims = nvictims;
+	if (*usage + length > budget)
+		return false;
+	*usage += length;
+	return true;
+}
+
+/*
+ * ccache_upload_device_image
+ *
+ * It loads the entire chunk file onto the preserved device memory, then
+ * returns the IPC handle of the device image.
+ */
+static bool
+ccache_upload_device_image(ccacheChunk *cc_chunk, File filp,
+						   GpuContext *gcontext, size_t length,
+						   CUipcMemHandle *p_gpu_mhandle)
+{
+	cl_int		cuda_dindex = gcontext->cuda_dindex;
+	ccacheDeviceImage victims[CCACHE_NUM_RELEASE_IMAGES];
+	CUipcMemHandle gpu_mhandle;
+	CUdeviceptr	m_gbuf = 0UL;
+	char	   *hbuf = NULL;
+	ssize_t		nbytes;
+	bool		reserved;
+	int			i, nvictims = 0;
+	CUresult	rc;
+
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	reserved = ccache_reserve_device_nolock(cuda_dindex, length,
+											victims, &nvictims);
+	SpinLockRelease(&ccache_state->chunks_lock);
+	for (i=0; i < nvictims; i++)
+	{
+		rc = gpuMemFreePreserved(victims[i].cuda_dindex,
+								 victims[i].gpu_mhandle);
+		if (rc != CUDA_SUCCESS && rc != CUDA_ERROR_NOT_FOUND)
+			elog(WARNING, "failed on gpuMemFreePreserved: %s",
+				 errorText(rc));
+	}
+	if (!reserved)
+		return false;
+
+	rc = gpuMemAllocPreservedEvictable(cuda_dindex, &gpu_mhandle, length);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(DEBUG2, "failed on gpuMemAllocPreservedEvictable: %s",
+			 errorText(rc));
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		ccache_gpu_usage[cuda_dindex] -= length;
+		SpinLockRelease(&ccache_state->chunks_lock);
+		return false;
+	}
+
+	PG_TRY();
+	{
+		rc = gpuMemAllocHost(gcontext, (void **)&hbuf, length);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuMemAllocHost: %s", errorText(rc));
+		memset(hbuf + cc_chunk->length, 0, length - cc_chunk->length);
+		if (lseek(FileGetRawDesc(filp), 0, SEEK_SET) < 0)
+			elog(ERROR, "failed on lseek('%s'): %m", FilePathName(filp));
+		nbytes = __readFile(FileGetRawDesc(filp), hbuf, cc_chunk->length);
+		if (nbytes != cc_chunk->length)
+			elog(ERROR, "failed on read('%s'): %m", FilePathName(filp));
+
+		rc = gpuIpcOpenMemHandle(gcontext,
+								 &m_gbuf,
+								 gpu_mhandle,
+								 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+		GPUCONTEXT_PUSH(gcontext);
+		rc = cuMemcpyHtoD(m_gbuf, hbuf, length);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+		GPUCONTEXT_POP(gcontext);
+
+		rc = gpuIpcCloseMemHandle(gcontext, m_gbuf);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcCloseMemHandle: %s", errorText(rc));
+		rc = gpuMemFreeHost(gcontext, hbuf);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuMemFreeHost: %s", errorText(rc));
+	}
+	PG_CATCH();
+	{
+		/* host buffer and IPC mapping shall be released with GpuContext */
+		gpuMemPreservedPut(cuda_dindex, gpu_mhandle);
+		gpuMemFreePreserved(cuda_dindex, gpu_mhandle);
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		ccache_gpu_usage[cuda_dindex] -= length;
+		SpinLockRelease(&ccache_state->chunks_lock);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	*p_gpu_mhandle = gpu_mhandle;
+	return true;
+}
+
+/*
+ * ccache_map_device_image
+ *
+ * It maps the device image of the chunk on the GpuContext, or builds a new
+ * device image if pg_strom.ccache_gpu_size allows. Then, GpuScan/GpuJoin/
+ * GpuPreAgg can build up KDS_FORMAT_ARROW by device-to-device copy, with no
+ * host-to-device transfer. It returns 0, if not available.
+ */
+static CUdeviceptr
+ccache_map_device_image(ccacheScanState *cc_state,
+						ccacheChunk *cc_chunk,
+						File filp,
+						GpuContext *gcontext)
+{
+	cl_int		cuda_dindex = gcontext->cuda_dindex;
+	size_t		length = TYPEALIGN(PAGE_SIZE, cc_chunk->length);
+	ccacheDeviceRef *dref;
+	CUipcMemHandle gpu_mhandle;
+	CUdeviceptr	m_gbuf;
+	bool		has_image = false;
+	bool		registered = false;
+	MemoryContext oldcxt;
+	CUresult	rc;
+
+	ccache_release_device_images();
+
+	/*
+	 * The reference by the scan prevents the device image to be detached
+	 * by the concurrent sessions, until ccache_release_device_ref().
+	 */
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	cc_chunk->refcnt++;
+	if (cc_chunk->gpu_length > 0 && cc_chunk->gpu_dindex == cuda_dindex)
+	{
+		gpu_mhandle = cc_chunk->gpu_mhandle;
+		has_image = true;
+	}
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	/* preserved memory may be evicted by the keeper */
+	if (has_image && !gpuMemPreservedGet(cuda_dindex, gpu_mhandle))
+	{
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		if (cc_chunk->gpu_length > 0 &&
+			cc_chunk->gpu_dindex == cuda_dindex &&
+			memcmp(&cc_chunk->gpu_mhandle, &gpu_mhandle,
+				   sizeof(CUipcMemHandle)) == 0)
+		{
+			ccache_gpu_usage[cuda_dindex] -= cc_chunk->gpu_length;
+			cc_chunk->gpu_length = 0;
+		}
+		SpinLockRelease(&ccache_state->chunks_lock);
+		has_image = false;
+	}
+
+	if (!has_image)
+	{
+		PG_TRY();
+		{
+			registered = ccache_upload_device_image(cc_chunk, filp, gcontext,
+													length, &gpu_mhandle);
+		}
+		PG_CATCH();
+		{
+			ccache_put_chunk(cc_chunk);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+
+		if (registered)
+		{
+			SpinLockAcquire(&ccache_state->chunks_lock);
+			if (cc_chunk->gpu_length == 0)
+			{
+				cc_chunk->gpu_dindex = cuda_dindex;
+				cc_chunk->gpu_length = length;
+				cc_chunk->gpu_mhandle = gpu_mhandle;
+			}
+			else
+			{
+				/* concurrent session built the device image first */
+				ccache_gpu_usage[cuda_dindex] -= length;
+				registered = false;
+			}
+			SpinLockRelease(&ccache_state->chunks_lock);
+			if (!registered)
+			{
+				gpuMemPreservedPut(cuda_dindex, gpu_mhandle);
+				rc = gpuMemFreePreserved(cuda_dindex, gpu_mhandle);
+				if (rc != CUDA_SUCCESS && rc != CUDA_ERROR_NOT_FOUND)
+					elog(WARNING, "failed on gpuMemFreePreserved: %s",
+						 errorText(rc));
+			}
+		}
+		if (!registered)
+		{
+			ccache_put_chunk(cc_chunk);
+			return 0UL;
+		}
+	}
+
+	dref = MemoryContextAllocZero(TopMemoryContext,
+								  sizeof(ccacheDeviceRef));
+	dref->cc_chunk = cc_chunk;
+	dref->cuda_dindex = cuda_dindex;
+	dref->gpu_mhandle = gpu_mhandle;
+	dlist_push_tail(&ccache_device_refs, &dref->chain);
+	oldcxt = MemoryContextSwitchTo(cc_state->memcxt);
+	cc_state->device_refs = lappend(cc_state->device_refs, dref);
+	MemoryContextSwitchTo(oldcxt);
+
+	rc = gpuIpcOpenMemHandle(gcontext,
+							 &m_gbuf,
+							 gpu_mhandle,
+							 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+	dref->gcontext = gcontext;
+	dref->m_gbuf = m_gbuf;
+
+	return m_gbuf;
+}
+
+/*
+ * ccache_release_device_ref
+ *
+ * It releases the reference to the device image. If @dref is NULL, all the
+ * remaining references are released at end of the transaction; GpuContext
+ * shall unmap the device memory by itself in this case.
+ */
+static void
+ccache_release_device_ref(ccacheDeviceRef *dref)
+{
+	dlist_mutable_iter iter;
+	CUresult	rc;
+
+	dlist_foreach_modify(iter, &ccache_device_refs)
+	{
+		ccacheDeviceRef *temp = dlist_container(ccacheDeviceRef,
+												chain, iter.cur);
+		if (dref)
+		{
+			if (temp != dref)
+				continue;
+			if (temp->m_gbuf != 0UL)
+			{
+				rc = gpuIpcCloseMemHandle(temp->gcontext, temp->m_gbuf);
+				if (rc != CUDA_SUCCESS)
+					elog(WARNING, "failed on gpuIpcCloseMemHandle: %s",
+						 errorText(rc));
+			}
+		}
+		dlist_delete(&temp->chain);
+		gpuMemPreservedPut(temp->cuda_dindex, temp->gpu_mhandle);
+		ccache_put_chunk(temp->cc_chunk);
+		pfree(temp);
+	}
+	ccache_release_device_images();
+}
+
+/*
+ * ccacheDeviceXactCallback
+ */
+static void
+ccacheDeviceXactCallback(XactEvent event, void *arg)
+{
+	/* device images referenced by the aborted query, if any */
+	if (event == XACT_EVENT_COMMIT ||
+		event == XACT_EVENT_ABORT)
+	{
+		if (!dlist_is_empty(&ccache_device_refs))
+			ccache_release_device_ref(NULL);
+	}
+}
+
+/*
+ * pgstromExecScanColumnarCache
+ *
+ * It loads the chunk at @block_nr from the columnar cache, or returns NULL
+ * if not cached yet.
+ */
+pgstrom_data_store *
+pgstromExecScanColumnarCache(GpuTaskState *gts, BlockNumber block_nr)
+{
+	ccacheScanState *cc_state = gts->ccache_state;
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	ccacheChunk *cc_chunk;
+	pgstrom_data_store *pds = NULL;
+	char		fname[MAXPGPATH];
+	File		filp = -1;
+	CUdeviceptr	m_gbuf = 0UL;
+	MemoryContext oldcxt;
+
+	Assert(cc_state != NULL);
+	cc_chunk = ccache_get_chunk(relation, block_nr);
+	if (!cc_chunk)
+		return NULL;
+
+	PG_TRY();
+	{
+		ccache_chunk_filename(fname, cc_chunk);
+		filp = PathNameOpenFile(fname, O_RDONLY | PG_BINARY);
+		if (filp < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open ccache file \"%s\": %m", fname)));
+		/* device image of the chunk, if pg_strom.ccache_gpu_size > 0 */
+		if (gts->gcontext && ccache_gpu_size_kb > 0)
+			m_gbuf = ccache_map_device_image(cc_state, cc_chunk,
+											 filp, gts->gcontext);
+		pds = arrowFdwLoadColumnarCache(filp, relation,
+										cc_state->ccache_refs,
+										gts->outer_refs,
+										gts->gcontext,
+										cc_state->memcxt,
+										m_gbuf);
+	}
+	PG_CATCH();
+	{
+		if (filp >= 0)
+			FileClose(filp);
+		ccache_put_chunk(cc_chunk);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	if (!pds)
+	{
+		/* not compatible to the current relation definition */
+		if (cc_chunk->hash_chain.prev != NULL &&
+			cc_chunk->hash_chain.next != NULL)
+			ccache_invalidate_chunk_nolock(cc_chunk);
+	}
+	ccache_put_chunk_nolock(cc_chunk);
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	if (!pds)
+	{
+		FileClose(filp);
+		return NULL;
+	}
+	pds->kds.table_oid = RelationGetRelid(relation);
+	/*
+	 * The chunk file must be kept open until end of the scan, because
+	 * SSD2GPU Direct SQL reads the file asynchronously.
+	 */
+	oldcxt = MemoryContextSwitchTo(cc_state->memcxt);
+	cc_state->ccache_files = lappend_int(cc_state->ccache_files, filp);
+	MemoryContextSwitchTo(oldcxt);
+	gts->ccache_count++;
+	if (pds->gpubuf_iov)
+		gts->ccache_device_count++;
+
+	return pds;
+}
+
+/*
+ * pgstromExecEndColumnarCache
+ */
+void
+pgstromExecEndColumnarCache(GpuTaskState *gts)
+{
+	ccacheScanState *cc_state = gts->ccache_state;
+	ListCell   *lc;
+
+	if (!cc_state)
+		return;
+	foreach (lc, cc_state->ccache_files)
+		FileClose((File) lfirst_int(lc));
+	list_free(cc_state->ccache_files);
+	cc_state->ccache_files = NIL;
+	/* release device images mapped by the scan */
+	foreach (lc, cc_state->device_refs)
+		ccache_release_device_ref((ccacheDeviceRef *) lfirst(lc));
+	list_free(cc_state->device_refs);
+	cc_state->device_refs = NIL;
+}
+
+/*
+ * ccache_invalidate_block
+ */
+static void
+ccache_invalidate_block(Relation relation, BlockNumber block_nr)
+{
+	Oid			table_oid = RelationGetRelid(relation);
+	pg_crc32	hash;
+	int			index;
+	dlist_iter	iter;
+
+	block_nr &= ~(CCACHE_CHUNK_NBLOCKS - 1);
+	hash = ccache_compute_hashvalue(MyDatabaseId, table_oid, block_nr);
+	index = hash % ccache_num_slots;
+
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	dlist_foreach(iter, &ccache_state->active_slots[index])
+	{
+		ccacheChunk *cc_temp = dlist_container(ccacheChunk,
+											   hash_chain,
+											   iter.cur);
+		if (cc_temp->hash == hash &&
+			cc_temp->database_oid == MyDatabaseId &&
+			cc_temp->table_oid == table_oid &&
+			cc_temp->block_nr == block_nr)
+		{
+			ccache_invalidate_chunk_nolock(cc_temp);
+			break;
+		}
+	}
+	SpinLockRelease(&ccache_state->chunks_lock);
+}
+
+/*
+ * pgstrom_ccache_invalidator
+ *
+ * AFTER ROW trigger invalidates the chunk which contains the modified row,
+ * and AFTER TRUNCATE statement trigger invalidates all the chunks of the
+ * table. Even if rows were updated, PD_ALL_VISIBLE of the page is already
+ * cleared, so the chunk shall not be built again until next VACUUM.
+ */
+Datum
+pgstrom_ccache_invalidator(PG_FUNCTION_ARGS)
+{
+	FmgrInfo	   *flinfo = fcinfo->flinfo;
+	TriggerData	   *trigdata = (TriggerData *) fcinfo->context;
+	Relation		rel;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		elog(ERROR, "%s: must be called as trigger", __FUNCTION__);
+	if (!TRIGGER_FIRED_AFTER(trigdata->tg_event))
+		elog(ERROR, "%s: must be configured as AFTER trigger", __FUNCTION__);
+	rel = trigdata->tg_relation;
+	if (TRIGGER_FIRED_FOR_ROW(trigdata->tg_event))
+	{
+		HeapTuple	tuples[2];
+		int			i, ntuples = 0;
+
+		if (TRIGGER_FIRED_BY_INSERT(trigdata->tg_event) ||
+			TRIGGER_FIRED_BY_DELETE(trigdata->tg_event))
+			tuples[ntuples++] = trigdata->tg_trigtuple;
+		else if (TRIGGER_FIRED_BY_UPDATE(trigdata->tg_event))
+		{
+			tuples[ntuples++] = trigdata->tg_trigtuple;
+			tuples[ntuples++] = trigdata->tg_newtuple;
+		}
+		else
+			elog(ERROR, "%s: triggered by unknown event", __FUNCTION__);
+
+		for (i=0; i < ntuples; i++)
+		{
+			BlockNumber	block_nr;
+			BlockNumber	block_nr_last;
+
+			if (!tuples[i])
+				continue;
+			block_nr = ItemPointerGetBlockNumber(&tuples[i]->t_self);
+			block_nr &= ~(CCACHE_CHUNK_NBLOCKS - 1);
+			/*
+			 * Several least bits of @block_nr should be always zero.
+			 * So, we use the least bit as a mark of valid @block_nr_last.
+			 */
+			block_nr_last = (BlockNumber)((uintptr_t)flinfo->fn_extra);
+			if ((block_nr_last & 1) != 0 &&
+				(block_nr_last & ~(CCACHE_CHUNK_NBLOCKS - 1)) == block_nr)
+				continue;
+			ccache_invalidate_block(rel, block_nr);
+			flinfo->fn_extra = (void *)((uintptr_t)(block_nr + 1));
+		}
+	}
+	else
+	{
+		dlist_mutable_iter iter;
+		int			index;
+
+		if (!TRIGGER_FIRED_BY_TRUNCATE(trigdata->tg_event))
+			elog(ERROR, "%s: triggered by unknown event", __FUNCTION__);
+
+		for (index=0; index < ccache_num_slots; index++)
+		{
+			SpinLockAcquire(&ccache_state->chunks_lock);
+			dlist_foreach_modify(iter, &ccache_state->active_slots[index])
+			{
+				ccacheChunk *cc_temp = dlist_container(ccacheChunk,
+													   hash_chain,
+													   iter.cur);
+				if (cc_temp->database_oid == MyDatabaseId &&
+					cc_temp->table_oid == RelationGetRelid(rel))
+					ccache_invalidate_chunk_nolock(cc_temp);
+			}
+			SpinLockRelease(&ccache_state->chunks_lock);
+		}
+	}
+	PG_RETURN_POINTER(NULL);
+}
+PG_FUNCTION_INFO_V1(pgstrom_ccache_invalidator);
+
+/*
+ * pgstrom_ccache_info
+ */
+Datum
+pgstrom_ccache_info(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	ccacheChunk	   *cc_chunk;
+	List		   *cc_chunks_list = NIL;
+	HeapTuple		tuple;
+	bool			isnull[7];
+	Datum			values[7];
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		dlist_iter		iter;
+		ccacheChunk	   *cc_array;
+		int				i, nitems = 0;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(7);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "database_id",
+						   OIDOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "table_id",
+						   REGCLASSOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "block_nr",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "nitems",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "length",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "ctime",
+						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "atime",
+						   TIMESTAMPTZOID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		/* collect current cache state */
+		cc_array = palloc(sizeof(ccacheChunk) * ccache_num_chunks);
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		for (i=0; i < ccache_num_slots; i++)
+		{
+			dlist_foreach(iter, &ccache_state->active_slots[i])
+			{
+				ccacheChunk	   *cc_temp = dlist_container(ccacheChunk,
+														  hash_chain,
+														  iter.cur);
+				if (!CCACHE_CTIME_IS_READY(cc_temp->ctime))
+					continue;
+				Assert(nitems < ccache_num_chunks);
+				memcpy(&cc_array[nitems++], cc_temp, sizeof(ccacheChunk));
+			}
+		}
+		SpinLockRelease(&ccache_state->chunks_lock);
+		for (i=0; i < nitems; i++)
+			cc_chunks_list = lappend(cc_chunks_list, &cc_array[i]);
+		fncxt->user_fctx = cc_chunks_list;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+	cc_chunks_list = fncxt->user_fctx;
+
+	if (cc_chunks_list == NIL)
+		SRF_RETURN_DONE(fncxt);
+	cc_chunk = linitial(cc_chunks_list);
+	fncxt->user_fctx = list_delete_first(cc_chunks_list);
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = ObjectIdGetDatum(cc_chunk->database_oid);
+	values[1] = ObjectIdGetDatum(cc_chunk->table_oid);
+	values[2] = Int32GetDatum(cc_chunk->block_nr);
+	values[3] = Int64GetDatum(cc_chunk->nitems);
+	values[4] = Int64GetDatum(cc_chunk->length);
+	values[5] = TimestampTzGetDatum(cc_chunk->ctime);
+	values[6] = TimestampTzGetDatum(cc_chunk->atime);
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_ccache_info);
+
+/*
+ * __ccache_build_chunk
+ *
+ * It reads the heap blocks of the chunk, then writes out the cached columns
+ * as an Apache Arrow file. It gives up to build the chunk if any blocks are
+ * not all-visible, because the columnar cache has no visibility information.
+ */
+static bool
+__ccache_build_chunk(ccacheChunk *cc_chunk,
+					 Relation relation,
+					 Bitmapset *ccache_refs,
+					 size_t *p_length,
+					 cl_uint *p_nitems)
+{
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	TupleDesc	cc_tupdesc;
+	BufferAccessStrategy strategy;
+	MemoryContext memcxt;
+	MemoryContext tupcxt;
+	MemoryContext oldcxt;
+	struct SQLtable *table;
+	int		   *attmap;
+	Datum	   *values;
+	bool	   *isnull;
+	Datum	   *cc_values;
+	bool	   *cc_isnull;
+	char		fname[MAXPGPATH];
+	int			fdesc;
+	int			j, k, cc_natts = bms_num_members(ccache_refs);
+	BlockNumber	block_nr;
+	BlockNumber	block_end = cc_chunk->block_nr + CCACHE_CHUNK_NBLOCKS;
+	bool		all_visible = true;
+	size_t		nitems = 0;
+	size_t		length = 0;
+
+	memcxt = AllocSetContextCreate(CurrentMemoryContext,
+								   "ccache chunk builder",
+								   ALLOCSET_DEFAULT_SIZES);
+	tupcxt = AllocSetContextCreate(memcxt,
+								   "ccache per-block context",
+								   ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(memcxt);
+	/* tuple descriptor of the cached columns */
+	cc_tupdesc = CreateTemplateTupleDesc(cc_natts);
+	attmap = palloc(sizeof(int) * cc_natts);
+	for (k = bms_next_member(ccache_refs, -1), j=0;
+		 k >= 0;
+		 k = bms_next_member(ccache_refs, k), j++)
+	{
+		attmap[j] = k + FirstLowInvalidHeapAttributeNumber;
+		TupleDescCopyEntry(cc_tupdesc, j+1, tupdesc, attmap[j]);
+	}
+	values = palloc(sizeof(Datum) * tupdesc->natts);
+	isnull = palloc(sizeof(bool)  * tupdesc->natts);
+	cc_values = palloc(sizeof(Datum) * cc_natts);
+	cc_isnull = palloc(sizeof(bool)  * cc_natts);
+	strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	ccache_chunk_filename(fname, cc_chunk);
+	fdesc = OpenTransientFile(fname, O_RDWR | O_CREAT | O_TRUNC | PG_BINARY);
+	if (fdesc < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create ccache file \"%s\": %m", fname)));
+	PG_TRY();
+	{
+		table = arrowFdwCreateColumnarCache(cc_tupdesc, fdesc, fname);
+		for (block_nr = cc_chunk->block_nr;
+			 all_visible && block_nr < block_end;
+			 block_nr++)
+		{
+			Buffer		buffer;
+			Page		page;
+			OffsetNumber lineoff;
+			OffsetNumber lines;
+			List	   *tuples_list = NIL;
+			ListCell   *lc;
+
+			CHECK_FOR_INTERRUPTS();
+			buffer = ReadBufferExtended(relation, MAIN_FORKNUM, block_nr,
+										RBM_NORMAL, strategy);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+			page = BufferGetPage(buffer);
+			if (!PageIsAllVisible(page))
+				all_visible = false;
+			else
+			{
+				/* copy the tuples, then release the buffer lock soon */
+				MemoryContextSwitchTo(tupcxt);
+				lines = PageGetMaxOffsetNumber(page);
+				for (lineoff = FirstOffsetNumber;
+					 lineoff <= lines;
+					 lineoff = OffsetNumberNext(lineoff))
+				{
+					ItemId		lpp = PageGetItemId(page, lineoff);
+					HeapTupleData tuple;
+
+					if (!ItemIdIsNormal(lpp))
+						continue;
+					tuple.t_data = (HeapTupleHeader) PageGetItem(page, lpp);
+					tuple.t_len = ItemIdGetLength(lpp);
+					tuple.t_tableOid = RelationGetRelid(relation);
+					ItemPointerSet(&tuple.t_self, block_nr, lineoff);
+
+					tuples_list = lappend(tuples_list,
+										  heap_copytuple(&tuple));
+				}
+				MemoryContextSwitchTo(memcxt);
+			}
+			UnlockReleaseBuffer(buffer);
+
+			foreach (lc, tuples_list)
+			{
+				HeapTuple	tuple = lfirst(lc);
+
+				MemoryContextSwitchTo(tupcxt);
+				heap_deform_tuple(tuple, tupdesc, values, isnull);
+				for (j=0; j < cc_natts; j++)
+				{
+					int		anum = attmap[j];
+					Form_pg_attribute attr = tupleDescAttr(tupdesc, anum-1);
+
+					cc_isnull[j] = isnull[anum-1];
+					if (isnull[anum-1])
+						cc_values[j] = 0;
+					else if (attr->attlen == -1)
+						cc_values[j] = PointerGetDatum(
+							PG_DETOAST_DATUM_PACKED(values[anum-1]));
+					else
+						cc_values[j] = values[anum-1];
+				}
+				MemoryContextSwitchTo(memcxt);
+				arrowFdwPutColumnarCache(table, cc_tupdesc,
+										 cc_values, cc_isnull);
+				nitems++;
+			}
+			MemoryContextReset(tupcxt);
+		}
+		if (all_visible && nitems > 0 && nitems <= UINT_MAX)
+			length = arrowFdwWriteColumnarCache(table);
+	}
+	PG_CATCH();
+	{
+		CloseTransientFile(fdesc);
+		unlink(fname);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	CloseTransientFile(fdesc);
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(memcxt);
+	FreeAccessStrategy(strategy);
+
+	if (length == 0)
+	{
+		/* not all-visible, or empty chunk */
+		if (unlink(fname) != 0)
+			elog(WARNING, "failed on unlink('%s'): %m", fname);
+		return false;
+	}
+	*p_length = length;
+	*p_nitems = nitems;
+	return true;
+}
+
+/*
+ * ccache_build_chunk
+ *
+ * It builds the chunk which is already marked as in-progress, then makes
+ * the chunk ready to load, unless it is not invalidated concurrently.
+ */
+static bool
+ccache_build_chunk(ccacheChunk *cc_chunk)
+{
+	Relation	relation;
+	Bitmapset  *ccache_refs;
+	size_t		length = 0;
+	cl_uint		nitems = 0;
+	bool		built = false;
+	char		fname[MAXPGPATH];
+
+	Assert(cc_chunk->ctime == CCACHE_CTIME_IN_PROGRESS);
+	PG_TRY();
+	{
+		relation = try_relation_open(cc_chunk->table_oid, AccessShareLock);
+		if (relation)
+		{
+			if (relation->rd_node.relNode == cc_chunk->relfilenode &&
+				RelationCanUseColumnarCache(relation, &ccache_refs) &&
+				(cc_chunk->block_nr + CCACHE_CHUNK_NBLOCKS <=
+				 RelationGetNumberOfBlocks(relation)))
+			{
+				built = __ccache_build_chunk(cc_chunk, relation, ccache_refs,
+											 &length, &nitems);
+			}
+			relation_close(relation, AccessShareLock);
+		}
+	}
+	PG_CATCH();
+	{
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		cc_chunk->ctime = CCACHE_CTIME_NOT_BUILD;
+		if (cc_chunk->hash_chain.prev != NULL &&
+			cc_chunk->hash_chain.next != NULL)
+			ccache_invalidate_chunk_nolock(cc_chunk);
+		ccache_put_chunk_nolock(cc_chunk);
+		SpinLockRelease(&ccache_state->chunks_lock);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	if (cc_chunk->hash_chain.prev == NULL ||
+		cc_chunk->hash_chain.next == NULL)
+	{
+		/* concurrently invalidated, so the chunk file is already stale */
+		cc_chunk->ctime = CCACHE_CTIME_NOT_BUILD;
+		if (built)
+		{
+			ccache_chunk_filename(fname, cc_chunk);
+			if (unlink(fname) != 0)
+				elog(WARNING, "failed on unlink('%s'): %m", fname);
+			built = false;
+		}
+	}
+	else if (!built)
+	{
+		/* will be registered again, on the next scan */
+		cc_chunk->ctime = CCACHE_CTIME_NOT_BUILD;
+		ccache_invalidate_chunk_nolock(cc_chunk);
+	}
+	else
+	{
+		cc_chunk->ctime = GetCurrentTimestamp();
+		cc_chunk->length = length;
+		cc_chunk->nitems = nitems;
+		ccache_state->ccache_usage += TYPEALIGN(BLCKSZ, length);
+		dlist_push_head(&ccache_state->lru_active_list,
+						&cc_chunk->lru_chain);
+	}
+	ccache_put_chunk_nolock(cc_chunk);
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	return built;
+}
+
+/*
+ * ccache_start_build_nolock
+ *
+ * It marks the chunk as in-progress, with an extra reference by the builder.
+ */
+static void
+ccache_start_build_nolock(ccacheChunk *cc_chunk)
+{
+	Assert(cc_chunk->ctime == CCACHE_CTIME_NOT_BUILD);
+	if (cc_chunk->lru_chain.prev != NULL &&
+		cc_chunk->lru_chain.next != NULL)
+	{
+		dlist_delete(&cc_chunk->lru_chain);
+		memset(&cc_chunk->lru_chain, 0, sizeof(dlist_node));
+	}
+	cc_chunk->ctime = CCACHE_CTIME_IN_PROGRESS;
+	cc_chunk->generation = ++ccache_state->generation;
+	cc_chunk->refcnt++;
+}
+
+/*
+ * pgstrom_ccache_prewarm
+ *
+ * API for synchronous ccache build
+ */
+Datum
+pgstrom_ccache_prewarm(PG_FUNCTION_ARGS)
+{
+	Oid			table_oid = PG_GETARG_OID(0);
+	Relation	relation;
+	BlockNumber	block_nr;
+	BlockNumber	nblocks;
+	cl_int		load_count = 0;
+
+	relation = table_open(table_oid, AccessShareLock);
+	if (!RelationCanUseColumnarCache(relation, NULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("columnar cache is not configured on \"%s\"",
+						RelationGetRelationName(relation))));
+	nblocks = RelationGetNumberOfBlocks(relation);
+	for (block_nr = 0;
+		 block_nr + CCACHE_CHUNK_NBLOCKS <= nblocks;
+		 block_nr += CCACHE_CHUNK_NBLOCKS)
+	{
+		ccacheChunk *cc_chunk;
+		pg_crc32	hash;
+		int			index;
+		dlist_iter	iter;
+		dlist_node *dnode;
+
+		/* lookup or assign a chunk to build */
+		hash = ccache_compute_hashvalue(MyDatabaseId, table_oid, block_nr);
+		index = hash % ccache_num_slots;
+
+		SpinLockAcquire(&ccache_state->chunks_lock);
+		cc_chunk = NULL;
+		dlist_foreach(iter, &ccache_state->active_slots[index])
+		{
+			ccacheChunk *cc_temp = dlist_container(ccacheChunk,
+												   hash_chain,
+												   iter.cur);
+			if (cc_temp->hash == hash &&
+				cc_temp->database_oid == MyDatabaseId &&
+				cc_temp->table_oid == table_oid &&
+				cc_temp->block_nr == block_nr)
+			{
+				if (cc_temp->relfilenode != relation->rd_node.relNode)
+					ccache_invalidate_chunk_nolock(cc_temp);
+				else
+					cc_chunk = cc_temp;
+				break;
+			}
+		}
+		if (cc_chunk && cc_chunk->ctime != CCACHE_CTIME_NOT_BUILD)
+		{
+			/* already built, or in-progress */
+			SpinLockRelease(&ccache_state->chunks_lock);
+			continue;
+		}
+		if (!ccache_reclaim_chunks_nolock(CCACHE_CHUNK_SIZE))
+		{
+			SpinLockRelease(&ccache_state->chunks_lock);
+			break;		/* exceeds the resource limit */
+		}
+		if (!cc_chunk)
+		{
+			if (!dlist_is_empty(&ccache_state->free_chunks_list))
+			{
+				dnode = dlist_pop_head_node(&ccache_state->free_chunks_list);
+				cc_chunk = dlist_container(ccacheChunk, hash_chain, dnode);
+			}
+			else if (!dlist_is_empty(&ccache_state->lru_misshit_list))
+			{
+				dnode = dlist_tail_node(&ccache_state->lru_misshit_list);
+				cc_chunk = dlist_container(ccacheChunk, lru_chain, dnode);
+				dlist_delete(&cc_chunk->hash_chain);
+				dlist_delete(&cc_chunk->lru_chain);
+			}
+			else
+			{
+				SpinLockRelease(&ccache_state->chunks_lock);
+				break;		/* no more ccache entry */
+			}
+			memset(cc_chunk, 0, sizeof(ccacheChunk));
+			cc_chunk->hash = hash;
+			cc_chunk->database_oid = MyDatabaseId;
+			cc_chunk->table_oid = table_oid;
+			cc_chunk->relfilenode = relation->rd_node.relNode;
+			cc_chunk->block_nr = block_nr;
+			cc_chunk->refcnt = 1;
+			cc_chunk->atime = GetCurrentTimestamp();
+			dlist_push_tail(&ccache_state->active_slots[index],
+							&cc_chunk->hash_chain);
+		}
+		ccache_start_build_nolock(cc_chunk);
+		SpinLockRelease(&ccache_state->chunks_lock);
+
+		if (ccache_build_chunk(cc_chunk))
+			load_count++;
+	}
+	table_close(relation, NoLock);
+
+	PG_RETURN_INT32(load_count);
+}
+PG_FUNCTION_INFO_V1(pgstrom_ccache_prewarm);
+
+/*
+ * ccache_pick_misshit_chunk
+ *
+ * It picks up the most recently missed chunk of the current database.
+ */
+static ccacheChunk *
+ccache_pick_misshit_chunk(void)
+{
+	ccacheChunk *cc_chunk = NULL;
+	dlist_iter	iter;
+
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	dlist_foreach(iter, &ccache_state->lru_misshit_list)
+	{
+		ccacheChunk *cc_temp = dlist_container(ccacheChunk,
+											   lru_chain, iter.cur);
+		if (cc_temp->database_oid != MyDatabaseId)
+			continue;
+		Assert(cc_temp->ctime == CCACHE_CTIME_NOT_BUILD);
+		if (ccache_reclaim_chunks_nolock(CCACHE_CHUNK_SIZE))
+		{
+			ccache_start_build_nolock(cc_temp);
+			cc_chunk = cc_temp;
+		}
+		break;
+	}
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	return cc_chunk;
+}
+
+/*
+ * ccacheBuilderSigTerm
+ */
+static void
+ccacheBuilderSigTerm(SIGNAL_ARGS)
+{
+	int		saved_errno = errno;
+
+	ccache_builder_got_signal = true;
+
+	pg_memory_barrier();
+
+	SetLatch(MyLatch);
+
+	errno = saved_errno;
+}
+
+/*
+ * ccacheBuilderMain
+ */
+void
+ccacheBuilderMain(Datum arg)
+{
+	int			builder_id = DatumGetInt32(arg);
+	const char *database_name;
+
+	pqsignal(SIGTERM, ccacheBuilderSigTerm);
+	BackgroundWorkerUnblockSignals();
+
+	Assert(ccache_database_list != NIL);
+	database_name = list_nth(ccache_database_list,
+							 builder_id % list_length(ccache_database_list));
+	BackgroundWorkerInitializeConnection(database_name, NULL, 0);
+	elog(LOG, "PG-Strom CCache Builder-%d started on database \"%s\"",
+		 builder_id, database_name);
+
+	/*
+	 * Event Loop
+	 */
+	while (!ccache_builder_got_signal)
+	{
+		ccacheChunk *cc_chunk;
+		bool		built;
+		int			ev;
+
+		/* device images of the chunks invalidated by the updates */
+		ccache_release_device_images();
+		cc_chunk = ccache_pick_misshit_chunk();
+
+		if (!cc_chunk)
+		{
+			ev = WaitLatch(MyLatch,
+						   WL_LATCH_SET |
+						   WL_TIMEOUT |
+						   WL_POSTMASTER_DEATH,
+						   1000L,
+						   PG_WAIT_EXTENSION);
+			ResetLatch(MyLatch);
+			if (ev & WL_POSTMASTER_DEATH)
+				elog(FATAL, "unexpected postmaster dead");
+			CHECK_FOR_INTERRUPTS();
+			continue;
+		}
+		/* build a chunk at the misshit entry */
+		SetCurrentStatementStartTimestamp();
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+		built = ccache_build_chunk(cc_chunk);
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+
+		elog(DEBUG2, "ccache: relation %u, block %u %s",
+			 cc_chunk->table_oid, cc_chunk->block_nr,
+			 built ? "built" : "not built");
+	}
+	proc_exit(1);
+}
+
+/*
+ * pgstrom_startup_ccache
+ */
+static void
+pgstrom_startup_ccache(void)
+{
+	ccacheChunk *cc_chunk;
+	size_t		required;
+	bool		found;
+	int			i;
+	DIR		   *dir;
+	struct dirent *dent;
+
+	if (shmem_startup_next)
+		(*shmem_startup_next)();
+
+	required = MAXALIGN(offsetof(ccacheState,
+								 active_slots[ccache_num_slots])) +
+		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks) +
+		MAXALIGN(sizeof(size_t) * numDevAttrs);
+	ccache_state = ShmemInitStruct("Columnar Cache Shared Segment",
+								   required, &found);
+	if (found)
+		elog(ERROR, "Bug? Columnar Cache Shared Segment is already built");
+	memset(ccache_state, 0, required);
+	SpinLockInit(&ccache_state->chunks_lock);
+	dlist_init(&ccache_state->lru_misshit_list);
+	dlist_init(&ccache_state->lru_active_list);
+	dlist_init(&ccache_state->free_chunks_list);
+	dlist_init(&ccache_state->gpu_release_list);
+	for (i=0; i < ccache_num_slots; i++)
+		dlist_init(&ccache_state->active_slots[i]);
+	/* ccache-chunks */
+	cc_chunk = (ccacheChunk *)
+		((char *)ccache_state +
+		 MAXALIGN(offsetof(ccacheState, active_slots[ccache_num_slots])));
+	for (i=0; i < ccache_num_chunks; i++)
+	{
+		dlist_push_tail(&ccache_state->free_chunks_list,
+						&cc_chunk->hash_chain);
+		cc_chunk++;
+	}
+	/* usage of the device memory by the device images */
+	ccache_gpu_usage = (size_t *)
+		((char *)ccache_state +
+		 MAXALIGN(offsetof(ccacheState, active_slots[ccache_num_slots])) +
+		 MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks));
+
+	/* cleanup ccache files of the previous run */
+	dir = AllocateDir(ccache_base_dir);
+	while ((dent = ReadDir(dir, ccache_base_dir)) != NULL)
+	{
+		char		fname[MAXPGPATH];
+
+		if (strncmp(dent->d_name, "CC", 2) != 0)
+			continue;
+		snprintf(fname, sizeof(fname), "%s/%s",
+				 ccache_base_dir, dent->d_name);
+		if (unlink(fname) != 0)
+			elog(WARNING, "failed on unlink('%s'): %m", fname);
+	}
+	FreeDir(dir);
+}
+
+/*
+ * pgstrom_init_ccache
+ */
+void
+pgstrom_init_ccache(void)
+{
+	static int	ccache_total_size_kb;
+	int			ccache_total_size_default;
+	struct statfs statbuf;
+	size_t		required;
+	char	   *rawnames;
+	List	   *namelist;
+	ListCell   *lc;
+	int			i, num_builders;
+
+	/* pg_strom.enable_ccache */
+	DefineCustomBoolVariable("pg_strom.enable_ccache",
+							 "Enables to load chunks from the columnar cache",
+							 NULL,
+							 &pgstrom_enable_ccache,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.ccache_base_dir */
+	DefineCustomStringVariable("pg_strom.ccache_base_dir",
+							   "directory name used by ccache",
+							   NULL,
+							   &ccache_base_dir_name,
+							   "/dev/shm",
+							   PGC_POSTMASTER,
+							   GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+							   NULL, NULL, NULL);
+	snprintf(ccache_base_dir, sizeof(ccache_base_dir),
+			 "%s/.pg_strom.ccache.%u",
+			 ccache_base_dir_name, PostPortNumber);
+	if (mkdir(ccache_base_dir, 0700) != 0 && errno != EEXIST)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not make a ccache directory \"%s\": %m",
+						ccache_base_dir)));
+	if (statfs(ccache_base_dir, &statbuf) != 0)
+		elog(ERROR, "failed on statfs('%s'): %m", ccache_base_dir);
+
+	/* calculation of the default 'pg_strom.ccache_total_size' */
+	ccache_total_size_default =
+		Min((((3 * statbuf.f_blocks) / 4) * statbuf.f_bsize) >> 10,
+			(((2 * PHYS_PAGES) / 3) * (PAGE_SIZE >> 10)));
+	ccache_total_size_default = Min(ccache_total_size_default, INT_MAX);
+	/* pg_strom.ccache_total_size */
+	DefineCustomIntVariable("pg_strom.ccache_total_size",
+							"possible maximum allocation of ccache",
+							NULL,
+							&ccache_total_size_kb,
+							ccache_total_size_default,
+							0,
+							INT_MAX,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+	ccache_total_size = (size_t)ccache_total_size_kb << 10;
+
+	/* pg_strom.ccache_databases */
+	DefineCustomStringVariable("pg_strom.ccache_databases",
+							   "databases where ccache builder works on",
+							   NULL,
+							   &ccache_databases,
+							   "",
+							   PGC_POSTMASTER,
+							   GUC_NOT_IN_SAMPLE,
+							   NULL, NULL, NULL);
+	/* pg_strom.ccache_num_builders */
+	DefineCustomIntVariable("pg_strom.ccache_num_builders",
+							"number of ccache builder worker processes",
+							NULL,
+							&ccache_num_builders,
+							2,
+							0,
+							INT_MAX,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* pg_strom.ccache_gpu_size */
+	DefineCustomIntVariable("pg_strom.ccache_gpu_size",
+							"Size of device memory to keep the ccache chunks per device",
+							NULL,
+							&ccache_gpu_size_kb,
+							0,			/* disabled */
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
+	rawnames = pstrdup(ccache_databases);
+	if (!SplitIdentifierString(rawnames, ',', &namelist))
+		elog(ERROR, "pg_strom.ccache_databases is not valid list");
+	foreach (lc, namelist)
+	{
+		char   *dbname = lfirst(lc);
+
+		if (strlen(dbname) >= NAMEDATALEN)
+			elog(ERROR, "database name \"%s\" in pg_strom.ccache_databases is too long",
+				 dbname);
+		ccache_database_list = lappend(ccache_database_list, pstrdup(dbname));
+	}
+	list_free(namelist);
+	pfree(rawnames);
+
+	ccache_num_slots = Max(ccache_total_size / CCACHE_CHUNK_SIZE, 300);
+	ccache_num_chunks = 5 * ccache_num_slots;
+
+	/* request for static shared memory */
+	required = MAXALIGN(offsetof(ccacheState,
+								 active_slots[ccache_num_slots])) +
+		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks) +
+		MAXALIGN(sizeof(size_t) * numDevAttrs);
+	RequestAddinShmemSpace(required);
+	shmem_startup_next = shmem_startup_hook;
+	shmem_startup_hook = pgstrom_startup_ccache;
+
+	CacheRegisterSyscacheCallback(PROCOID, ccache_callback_on_procoid, 0);
+	dlist_init(&ccache_device_refs);
+	RegisterXactCallback(ccacheDeviceXactCallback, NULL);
+
+	/* register ccache builders, at least one per database */
+	if (ccache_database_list != NIL && ccache_num_builders > 0)
+	{
+		num_builders = Max(ccache_num_builders,
+						   list_length(ccache_database_list));
+		for (i=0; i < num_builders; i++)
+		{
+			BackgroundWorker worker;
+
+			memset(&worker, 0, sizeof(BackgroundWorker));
+			snprintf(worker.bgw_name, sizeof(worker.bgw_name),
+					 "PG-Strom CCache Builder-%d", i);
+			worker.bgw_flags = (BGWORKER_SHMEM_ACCESS |
+								BGWORKER_BACKEND_DATABASE_CONNECTION);
+			worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+			worker.bgw_restart_time = 5;
+			snprintf(worker.bgw_library_name,
+					 BGW_MAXLEN, "pg_strom");
+			snprintf(worker.bgw_function_name,
+					 BGW_MAXLEN, "ccacheBuilderMain");
+			worker.bgw_main_arg = Int32GetDatum(i);
+			RegisterBackgroundWorker(&worker);
+		}
+	}
+}
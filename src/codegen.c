@@ -17,8 +17,64 @@
  */
 #include "pg_strom.h"
 #include "cuda_numeric.h"
+#include "cuda_jsonlib.h"
 
 static MemoryContext	devinfo_memcxt;
+static int			jit_specialize_threshold;	/* GUC */
+static int			text_warp_threshold;		/* GUC */
+static int			devexpr_reject_log_level;	/* GUC */
+
+/*
+ * Recent rejections of device expressions in this backend, for EXPLAIN
+ * VERBOSE and pgstrom.device_expression_rejects view.
+ */
+typedef struct
+{
+	dlist_node	chain;
+	uint64		seqno;		/* sequence number of the last rejection */
+	uint64		count;		/* number of rejections */
+	TimestampTz	last_time;	/* timestamp of the last rejection */
+	Oid			func_oid;	/* function of the rejected node, if any */
+	Oid			type_oid;	/* result type of the rejected node, if any */
+	char	   *reason;		/* reason of the rejection */
+	char	   *location;	/* caller of pgstrom_device_expression */
+} devexpr_reject_info;
+
+#define DEVEXPR_REJECT_MAX_ITEMS	100
+static MemoryContext	devexpr_reject_memcxt;
+static dlist_head		devexpr_reject_list;
+static int				devexpr_reject_nitems = 0;
+static uint64			devexpr_reject_seqno = 0;
+
+static const struct config_enum_entry devexpr_reject_log_level_options[] = {
+	{"debug5",	DEBUG5,		false},
+	{"debug4",	DEBUG4,		false},
+	{"debug3",	DEBUG3,		false},
+	{"debug2",	DEBUG2,		false},
+	{"debug1",	DEBUG1,		false},
+	{"debug",	DEBUG2,		true},
+	{"log",		LOG,		false},
+	{"info",	INFO,		false},
+	{"notice",	NOTICE,		false},
+	{"warning",	WARNING,	false},
+	{NULL, 0, false}
+};
+
+Datum pgstrom_device_expression_rejects(PG_FUNCTION_ARGS);
+Datum pgstrom_device_functions_invalidate(PG_FUNCTION_ARGS);
+
+#ifndef INT2ARRAYOID
+#define INT2ARRAYOID		1005	/* see pg_type.h */
+#endif
+#ifndef INT4ARRAYOID
+#define INT4ARRAYOID		1007	/* see pg_type.h */
+#endif
+#ifndef INT8ARRAYOID
+#define INT8ARRAYOID		1016	/* see pg_type.h */
+#endif
+
+/* max number of IN-list items to be unrolled on specialization */
+#define JIT_SPECIALIZE_MAX_INLIST	64
 static dlist_head	devtype_info_slot[128];
 static dlist_head	devfunc_info_slot[1024];
 static dlist_head	devcast_info_slot[48];
@@ -70,8 +126,8 @@ static struct {
 	const char	   *type_schema;
 	const char	   *type_name;
 	const char	   *type_oid_label;
-	const char	   *max_const;
-	const char	   *min_const;
+	const char	   *max_const;		/* initial value of pmin() */
+	const char	   *min_const;		/* initial value of pmax() */
 	const char	   *zero_const;
 	cl_uint			type_flags;		/* library to declare this type */
 	cl_uint			extra_sz;		/* required size to store internal form */
@@ -99,13 +155,13 @@ static struct {
 				 "__half_as_short(0.0)",
 				 0, 0, pg_float2_devtype_hashfunc),
 	DEVTYPE_DECL("float4", "FLOAT4OID",
-				 "__float_as_int(FLT_MAX)",
-				 "__float_as_int(-FLT_MAX)",
+				 "__float_as_int(FLT_NAN)",
+				 "__float_as_int(-FLT_INFINITY)",
 				 "__float_as_int(0.0)",
 				 0, 0, pg_float4_devtype_hashfunc),
 	DEVTYPE_DECL("float8", "FLOAT8OID",
-				 "__double_as_longlong(DBL_MAX)",
-				 "__double_as_longlong(-DBL_MAX)",
+				 "__double_as_longlong(DBL_NAN)",
+				 "__double_as_longlong(-DBL_INFINITY)",
 				 "__double_as_longlong(0.0)",
 				 0, 0, pg_float8_devtype_hashfunc),
 	/*
@@ -1531,6 +1587,10 @@ static devfunc_catalog_t devfunc_common_catalog[] = {
 	{ "date_part", 2, {TEXTOID,TIMETZOID},     100, "t/f:extract_timetz"},
 	{ "date_part", 2, {TEXTOID,TIMEOID},       100, "t/f:extract_time"},
 
+	/* AT TIME ZONE with a constant time zone */
+	{ "timezone", 2, {TEXTOID,TIMESTAMPTZOID}, 100, "Zt/f:timestamptz_zone"},
+	{ "timezone", 2, {TEXTOID,TIMESTAMPOID},   100, "Zt/f:timestamp_zone"},
+
 	/* other time and data functions */
 	{ "now", 0, {}, 1, "t/f:now" },
 
@@ -1562,35 +1622,42 @@ static devfunc_catalog_t devfunc_common_catalog[] = {
 	/*
 	 * Text functions
 	 */
-	{ "bpchareq",  2, {BPCHAROID,BPCHAROID},  200, "s/f:bpchareq" },
-	{ "bpcharne",  2, {BPCHAROID,BPCHAROID},  200, "s/f:bpcharne" },
+	{ "bpchareq",  2, {BPCHAROID,BPCHAROID},  200, "sD/f:bpchareq" },
+	{ "bpcharne",  2, {BPCHAROID,BPCHAROID},  200, "sD/f:bpcharne" },
 	{ "bpcharlt",  2, {BPCHAROID,BPCHAROID},  200, "sL/f:bpcharlt" },
 	{ "bpcharle",  2, {BPCHAROID,BPCHAROID},  200, "sL/f:bpcharle" },
 	{ "bpchargt",  2, {BPCHAROID,BPCHAROID},  200, "sL/f:bpchargt" },
 	{ "bpcharge",  2, {BPCHAROID,BPCHAROID},  200, "sL/f:bpcharge" },
 	{ "bpcharcmp", 2, {BPCHAROID, BPCHAROID}, 200, "sL/f:type_compare"},
 	{ "length",    1, {BPCHAROID},              2, "sL/f:bpcharlen"},
-	{ "texteq",    2, {TEXTOID, TEXTOID},     200, "s/f:texteq" },
-	{ "textne",    2, {TEXTOID, TEXTOID},     200, "s/f:textne" },
+	{ "texteq",    2, {TEXTOID, TEXTOID},     200, "sD/f:texteq" },
+	{ "textne",    2, {TEXTOID, TEXTOID},     200, "sD/f:textne" },
 	{ "text_lt",   2, {TEXTOID, TEXTOID},     200, "sL/f:text_lt" },
 	{ "text_le",   2, {TEXTOID, TEXTOID},     200, "sL/f:text_le" },
 	{ "text_gt",   2, {TEXTOID, TEXTOID},     200, "sL/f:text_gt" },
 	{ "text_ge",   2, {TEXTOID, TEXTOID},     200, "sL/f:text_ge" },
 	{ "bttextcmp", 2, {TEXTOID, TEXTOID},     200, "sL/f:type_compare" },
 	/* LIKE operators */
-	{ "like",        2, {TEXTOID, TEXTOID},    9999, "s/f:textlike" },
-	{ "textlike",    2, {TEXTOID, TEXTOID},    9999, "s/f:textlike" },
+	{ "like",        2, {TEXTOID, TEXTOID},    9999, "Ws/f:textlike" },
+	{ "textlike",    2, {TEXTOID, TEXTOID},    9999, "Ws/f:textlike" },
 	{ "bpcharlike",  2, {BPCHAROID, TEXTOID},  9999, "s/f:bpcharlike" },
-	{ "notlike",     2, {TEXTOID, TEXTOID},    9999, "s/f:textnlike" },
-	{ "textnlike",   2, {TEXTOID, TEXTOID},    9999, "s/f:textnlike" },
+	{ "notlike",     2, {TEXTOID, TEXTOID},    9999, "Ws/f:textnlike" },
+	{ "textnlike",   2, {TEXTOID, TEXTOID},    9999, "Ws/f:textnlike" },
 	{ "bpcharnlike", 2, {BPCHAROID, TEXTOID},  9999, "s/f:bpcharnlike" },
 	/* ILIKE operators */
-	{ "texticlike",    2, {TEXTOID, TEXTOID},  9999, "Ls/f:texticlike" },
+	{ "texticlike",    2, {TEXTOID, TEXTOID},  9999, "LWs/f:texticlike" },
 	{ "bpchariclike",  2, {TEXTOID, TEXTOID},  9999, "Ls/f:bpchariclike" },
-	{ "texticnlike",   2, {TEXTOID, TEXTOID},  9999, "Ls/f:texticnlike" },
+	{ "texticnlike",   2, {TEXTOID, TEXTOID},  9999, "LWs/f:texticnlike" },
 	{ "bpcharicnlike", 2, {BPCHAROID, TEXTOID},9999, "Ls/f:bpcharicnlike" },
+	/* regular expression operators (also SIMILAR TO) */
+	{ "textregexeq",   2, {TEXTOID, TEXTOID},  9999, "Rs/f:textregexeq" },
+	{ "textregexne",   2, {TEXTOID, TEXTOID},  9999, "Rs/f:textregexne" },
+	{ "texticregexeq", 2, {TEXTOID, TEXTOID},  9999, "Is/f:textregexeq" },
+	{ "texticregexne", 2, {TEXTOID, TEXTOID},  9999, "Is/f:textregexne" },
 	/* string operations */
 	{ "length",		1, {TEXTOID},                 2, "s/f:textlen" },
+	{ "strpos",		2, {TEXTOID,TEXTOID},      9999, "Ws/f:textpos" },
+	{ "position",	2, {TEXTOID,TEXTOID},      9999, "Ws/f:textpos" },
 	{ "textcat",	2, {TEXTOID,TEXTOID},
 	  999, "Cs/f:textcat",
 	  vlbuf_estimate_textcat
@@ -1639,6 +1706,53 @@ static devfunc_catalog_t devfunc_common_catalog[] = {
 	{ "jsonb_exists",             1, {JSONBOID,TEXTOID},
 	  100, "j/f:jsonb_exists"
 	},
+	{ "jsonb_exists_any",         2, {JSONBOID,TEXTARRAYOID},
+	  100, "Kj/f:jsonb_exists_any"
+	},
+	{ "jsonb_exists_all",         2, {JSONBOID,TEXTARRAYOID},
+	  100, "Kj/f:jsonb_exists_all"
+	},
+	{ "jsonb_contains",           2, {JSONBOID,JSONBOID},
+	  1000, "j/f:jsonb_contains"
+	},
+	{ "jsonb_contained",          2, {JSONBOID,JSONBOID},
+	  1000, "j/f:jsonb_contained"
+	},
+	{ "jsonb_extract_path",       2, {JSONBOID,TEXTARRAYOID},
+	  1000, "PjC/f:jsonb_extract_path",
+	  vlbuf_estimate_jsonb
+	},
+	{ "jsonb_extract_path_op",    2, {JSONBOID,TEXTARRAYOID},
+	  1000, "PjC/f:jsonb_extract_path",
+	  vlbuf_estimate_jsonb
+	},
+	{ "jsonb_extract_path_text",  2, {JSONBOID,TEXTARRAYOID},
+	  1000, "PjC/f:jsonb_extract_path_text",
+	  vlbuf_estimate_jsonb
+	},
+	{ "jsonb_extract_path_text_op", 2, {JSONBOID,TEXTARRAYOID},
+	  1000, "PjC/f:jsonb_extract_path_text",
+	  vlbuf_estimate_jsonb
+	},
+	/* array operators towards a constant array */
+	{ "arrayoverlap",   2, {INT2ARRAYOID,INT2ARRAYOID},
+	  100, "Ap/f:arrayoverlap_int2" },
+	{ "arrayoverlap",   2, {INT4ARRAYOID,INT4ARRAYOID},
+	  100, "Ap/f:arrayoverlap_int4" },
+	{ "arrayoverlap",   2, {INT8ARRAYOID,INT8ARRAYOID},
+	  100, "Ap/f:arrayoverlap_int8" },
+	{ "arraycontains",  2, {INT2ARRAYOID,INT2ARRAYOID},
+	  100, "Ap/f:arraycontains_int2" },
+	{ "arraycontains",  2, {INT4ARRAYOID,INT4ARRAYOID},
+	  100, "Ap/f:arraycontains_int4" },
+	{ "arraycontains",  2, {INT8ARRAYOID,INT8ARRAYOID},
+	  100, "Ap/f:arraycontains_int8" },
+	{ "arraycontained", 2, {INT2ARRAYOID,INT2ARRAYOID},
+	  100, "Ap/f:arraycontained_int2" },
+	{ "arraycontained", 2, {INT4ARRAYOID,INT4ARRAYOID},
+	  100, "Ap/f:arraycontained_int4" },
+	{ "arraycontained", 2, {INT8ARRAYOID,INT8ARRAYOID},
+	  100, "Ap/f:arraycontained_int8" },
 };
 
 /*
@@ -2011,6 +2125,16 @@ static devfunc_extra_catalog_t devfunc_extra_catalog[] = {
 	{ FLOAT8, "as_float8("INT8")", 1, "p/f:as_float8" },
 	{ FLOAT4, "as_float4("INT4")", 1, "p/f:as_float4" },
 	{ FLOAT2, "as_float2("INT2")", 1, "p/f:as_float2" },
+
+	/* histogram bucket of pgstrom.approx_percentile */
+	{ INT4,    "pgstrom.approx_percentile_bucket("FLOAT8")",
+	  5, "m/f:approx_percentile_bucket" },
+
+	/* scaled integer portion of exact numeric sum/avg */
+	{ INT8,    "pgstrom.numeric_scaled_hi("NUMERIC","INT4")",
+	  10, "f:numeric_scaled_hi" },
+	{ INT8,    "pgstrom.numeric_scaled_lo("NUMERIC","INT4")",
+	  10, "f:numeric_scaled_lo" },
 };
 
 #undef BOOL
@@ -2037,6 +2161,25 @@ devfunc_generic_result_sz(codegen_context *context,
 	elog(ERROR, "unexpected type length: %d", rtype->type_length);
 }
 
+/*
+ * pgstrom_collation_is_deterministic
+ *
+ * PG12 added nondeterministic collations; strings with different byte
+ * sequences may be equal, thus binary comparison / hashing on the device
+ * side does not work for them.
+ */
+static bool
+pgstrom_collation_is_deterministic(Oid collid)
+{
+#if PG_VERSION_NUM >= 120000
+	if (OidIsValid(collid) &&
+		collid != DEFAULT_COLLATION_OID &&
+		!lc_collate_is_c(collid))
+		return get_collation_isdeterministic(collid);
+#endif
+	return true;
+}
+
 static devfunc_info *
 __construct_devfunc_info(HeapTuple protup,
 						 Oid func_collid,
@@ -2055,7 +2198,10 @@ __construct_devfunc_info(HeapTuple protup,
 	int32			flags = 0;
 	int				j;
 	bool			has_collation = false;
+	bool			has_deterministic = false;
 	bool			has_callbacks = false;
+	char			const_prep = '\0';
+	bool			has_warp_variant = false;
 
 	/* fetch attribute */
 	end = strchr(func_template, '/');
@@ -2068,9 +2214,23 @@ __construct_devfunc_info(HeapTuple protup,
 				case 'L':
 					has_collation = true;
 					break;
+				case 'D':
+					has_deterministic = true;
+					break;
 				case 'C':
 					has_callbacks = true;
 					break;
+				case 'R':
+				case 'I':
+				case 'K':
+				case 'P':
+				case 'Z':
+				case 'A':
+					const_prep = *pos;
+					break;
+				case 'W':
+					has_warp_variant = true;
+					break;
 				case 'p':
 					flags |= DEVKERNEL_NEEDS_PRIMITIVE;
 					break;
@@ -2124,7 +2284,21 @@ __construct_devfunc_info(HeapTuple protup,
 			dfunc->func_is_negative = true;
 		dfunc->func_collid = func_collid;
 	}
+	else if (has_deterministic)
+	{
+		/*
+		 * Equality of deterministic collations is binary identical, so
+		 * the device function (and the hash function) is fine regardless
+		 * of the locale; e.g, en_US or ICU collations.
+		 */
+		if (OidIsValid(func_collid) &&
+			!pgstrom_collation_is_deterministic(func_collid))
+			dfunc->func_is_negative = true;
+		dfunc->func_collid = func_collid;
+	}
 	dfunc->func_is_strict = proc->proisstrict;
+	dfunc->func_const_prep = const_prep;
+	dfunc->func_warp_variant = has_warp_variant;
 	dfunc->func_flags = flags;
 	dfunc->func_args = dfunc_args;
 	dfunc->func_rettype = dtype;
@@ -2249,6 +2423,12 @@ pgstrom_devfunc_construct_extra(HeapTuple protup,
 			goto found;
 		}
 	}
+	/* elsewhere, user defined device function if any */
+	result = pgstrom_devfunc_construct_user(protup,
+											func_argtypes,
+											func_collid);
+	if (result)
+		goto found;
 	elog(DEBUG2, "no extra function found for sig=[%s] rettype=[%s]",
 		 sig.data, rettype);
 found:
@@ -2257,6 +2437,170 @@ found:
 	return result;
 }
 
+/*
+ * User defined device functions
+ *
+ * pgstrom.device_functions catalog associates SQL functions with the CUDA
+ * source of their device implementation; a body of the device function
+ * that takes arguments as arg1, arg2, ... and returns the result by the
+ * device type. Its trigger invalidates the caches on any modification.
+ */
+#define Natts_pgstrom_device_functions			3
+#define Anum_pgstrom_device_functions_func_oid	1
+#define Anum_pgstrom_device_functions_devcost	2
+#define Anum_pgstrom_device_functions_source	3
+
+static Oid		devfunc_user_catalog_oid = InvalidOid;
+
+static Oid
+devfunc_user_catalog_lookup(void)
+{
+	Oid		namespace_oid;
+
+	if (!OidIsValid(devfunc_user_catalog_oid))
+	{
+		namespace_oid = get_namespace_oid("pgstrom", true);
+		if (OidIsValid(namespace_oid))
+			devfunc_user_catalog_oid = get_relname_relid("device_functions",
+														 namespace_oid);
+	}
+	return devfunc_user_catalog_oid;
+}
+
+static devfunc_info *
+pgstrom_devfunc_construct_user(HeapTuple protup,
+							   oidvector *func_argtypes,
+							   Oid func_collid)
+{
+	Form_pg_proc	proc = (Form_pg_proc) GETSTRUCT(protup);
+	Oid				func_oid = PgProcTupleGetOid(protup);
+	Oid				catalog_oid = devfunc_user_catalog_lookup();
+	Relation		rel;
+	TupleDesc		tupdesc;
+	ScanKeyData		skey;
+	SysScanDesc		sscan;
+	HeapTuple		tuple;
+	Datum			datum;
+	bool			isnull;
+	int				func_devcost = 1;
+	char		   *func_body = NULL;
+	char		   *func_template;
+	devfunc_info   *dfunc;
+	devtype_info   *dtype;
+	StringInfoData	buf;
+	ListCell	   *lc;
+	int				i;
+
+	/* user defined device function never accepts binary compatible types */
+	if (!OidIsValid(catalog_oid) ||
+		proc->pronargs != func_argtypes->dim1 ||
+		proc->pronargs > DEVFUNC_MAX_NARGS ||
+		memcmp(proc->proargtypes.values, func_argtypes->values,
+			   sizeof(Oid) * proc->pronargs) != 0)
+		return NULL;
+
+	rel = table_open(catalog_oid, AccessShareLock);
+	tupdesc = RelationGetDescr(rel);
+	if (tupdesc->natts != Natts_pgstrom_device_functions)
+		elog(ERROR, "pgstrom.device_functions has unexpected definition");
+	ScanKeyInit(&skey,
+				Anum_pgstrom_device_functions_func_oid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(func_oid));
+	sscan = systable_beginscan(rel, InvalidOid, false, NULL, 1, &skey);
+	tuple = systable_getnext(sscan);
+	if (HeapTupleIsValid(tuple))
+	{
+		datum = heap_getattr(tuple, Anum_pgstrom_device_functions_devcost,
+							 tupdesc, &isnull);
+		if (!isnull)
+			func_devcost = DatumGetInt32(datum);
+		datum = heap_getattr(tuple, Anum_pgstrom_device_functions_source,
+							 tupdesc, &isnull);
+		if (!isnull)
+			func_body = TextDatumGetCString(datum);
+	}
+	systable_endscan(sscan);
+	table_close(rel, AccessShareLock);
+	if (!func_body)
+		return NULL;
+
+	func_template = MemoryContextAlloc(devinfo_memcxt, 40);
+	snprintf(func_template, 40, "f:user_%u", func_oid);
+	dfunc = __construct_devfunc_info(protup,
+									 func_collid,
+									 proc->pronargs,
+									 proc->proargtypes.values,
+									 func_devcost,
+									 func_template,
+									 NULL);
+	if (!dfunc || dfunc->func_is_negative)
+		return dfunc;
+
+	/*
+	 * Definition of the device function; it may be injected twice to the
+	 * combined kernel of GpuJoin + GpuPreAgg.
+	 */
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "#ifndef PGSTROM_USER_DEVFUNC_%u\n"
+					 "#define PGSTROM_USER_DEVFUNC_%u\n"
+					 "DEVICE_FUNCTION(pg_%s_t)\n"
+					 "pgfn_%s(kern_context *kcxt",
+					 func_oid, func_oid,
+					 dfunc->func_rettype->type_name,
+					 dfunc->func_devname);
+	i = 1;
+	foreach (lc, dfunc->func_args)
+	{
+		dtype = lfirst(lc);
+		appendStringInfo(&buf, ", pg_%s_t arg%d", dtype->type_name, i++);
+	}
+	appendStringInfoString(&buf, ")\n{\n");
+	if (dfunc->func_is_strict && proc->pronargs > 0)
+	{
+		appendStringInfoString(&buf, "  if (");
+		for (i=1; i <= proc->pronargs; i++)
+			appendStringInfo(&buf, "%sarg%d.isnull", i > 1 ? " || " : "", i);
+		appendStringInfo(&buf,
+						 ")\n"
+						 "  {\n"
+						 "    pg_%s_t __result;\n"
+						 "\n"
+						 "    __result.isnull = true;\n"
+						 "    return __result;\n"
+						 "  }\n",
+						 dfunc->func_rettype->type_name);
+	}
+	appendStringInfo(&buf,
+					 "%s\n"
+					 "}\n"
+					 "#endif\t/* PGSTROM_USER_DEVFUNC_%u */\n\n",
+					 func_body, func_oid);
+	dfunc->func_source = MemoryContextStrdup(devinfo_memcxt, buf.data);
+	pfree(buf.data);
+	pfree(func_body);
+
+	return dfunc;
+}
+
+/*
+ * pgstrom_device_functions_invalidate
+ *
+ * Trigger function of pgstrom.device_functions. It invalidates all the
+ * relation caches, so the device function caches and the cached plans that
+ * embed the older definition are also invalidated.
+ */
+Datum
+pgstrom_device_functions_invalidate(PG_FUNCTION_ARGS)
+{
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		elog(ERROR, "%s: must be called as trigger", __FUNCTION__);
+	CacheInvalidateRelcacheAll();
+	PG_RETURN_POINTER(NULL);
+}
+PG_FUNCTION_INFO_V1(pgstrom_device_functions_invalidate);
+
 static devfunc_info *
 __pgstrom_devfunc_lookup_or_create(HeapTuple protup,
 								   Oid func_rettype,
@@ -2547,6 +2891,36 @@ pgstrom_devfunc_track(codegen_context *context, devfunc_info *dfunc)
 		dtype = (devtype_info *) lfirst(lc);
 		context->extra_flags |= dtype->type_flags;
 	}
+	/* user defined device function shall be injected to the kernel */
+	if (dfunc->func_source &&
+		!list_member_ptr(context->user_funcs, dfunc))
+		context->user_funcs = lappend(context->user_funcs, dfunc);
+}
+
+/*
+ * pgstrom_codegen_user_functions
+ *
+ * It puts the definitions of user defined device functions in use at the
+ * head of the kernel source, prior to the generated code that calls them.
+ */
+void
+pgstrom_codegen_user_functions(StringInfo kern, codegen_context *context)
+{
+	StringInfoData	buf;
+	ListCell	   *lc;
+
+	if (context->user_funcs == NIL)
+		return;
+	initStringInfo(&buf);
+	foreach (lc, context->user_funcs)
+	{
+		devfunc_info   *dfunc = lfirst(lc);
+
+		appendStringInfoString(&buf, dfunc->func_source);
+	}
+	appendBinaryStringInfo(&buf, kern->data, kern->len);
+	pfree(kern->data);
+	*kern = buf;
 }
 
 /*
@@ -2738,6 +3112,132 @@ static Node *__codegen_current_node = NULL;
 			appendStringInfoChar((str),(c));	\
 	} while(0)
 
+/*
+ * __codegen_simple_literal
+ *
+ * It writes out a literal of the fixed-length device type, if supported.
+ */
+static bool
+__codegen_simple_literal(StringInfo buf, Oid type_oid,
+						 Datum value, bool isnull)
+{
+	const char *base;
+	char		temp[80];
+
+	switch (type_oid)
+	{
+		case BOOLOID:
+			base = "cl_bool";
+			snprintf(temp, sizeof(temp), "%s",
+					 DatumGetBool(value) ? "true" : "false");
+			break;
+		case INT2OID:
+			base = "cl_short";
+			snprintf(temp, sizeof(temp), "%d", (int)DatumGetInt16(value));
+			break;
+		case INT4OID:
+		case DATEOID:
+			base = (type_oid == INT4OID ? "cl_int" : "DateADT");
+			if (DatumGetInt32(value) == PG_INT32_MIN)
+				snprintf(temp, sizeof(temp), "INT_MIN");
+			else
+				snprintf(temp, sizeof(temp), "%d", DatumGetInt32(value));
+			break;
+		case INT8OID:
+		case CASHOID:
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			base = (type_oid == TIMEOID ? "TimeADT" :
+					type_oid == TIMESTAMPOID ? "Timestamp" :
+					type_oid == TIMESTAMPTZOID ? "TimestampTz" : "cl_long");
+			if (DatumGetInt64(value) == PG_INT64_MIN)
+				snprintf(temp, sizeof(temp), "LONG_MIN");
+			else
+				snprintf(temp, sizeof(temp), "%ldL",
+						 (long)DatumGetInt64(value));
+			break;
+		case FLOAT4OID:
+			{
+				union { float fval; cl_uint ival; } u;
+
+				base = "cl_float";
+				u.fval = DatumGetFloat4(value);
+				snprintf(temp, sizeof(temp), "__int_as_float(0x%08x)",
+						 u.ival);
+			}
+			break;
+		case FLOAT8OID:
+			{
+				union { double fval; cl_ulong ival; } u;
+
+				base = "cl_double";
+				u.fval = DatumGetFloat8(value);
+				snprintf(temp, sizeof(temp),
+						 "__longlong_as_double(0x%016lxL)", u.ival);
+			}
+			break;
+		default:
+			return false;
+	}
+	if (buf)
+	{
+		if (isnull)
+			appendStringInfo(buf, "{(%s)0, true}", base);
+		else
+			appendStringInfo(buf, "{(%s)%s, false}", base, temp);
+	}
+	return true;
+}
+
+/*
+ * __codegen_const_is_hot
+ *
+ * It checks whether the supplied constant value is planned frequently
+ * enough to bake into the kernel source. A distinct value makes a distinct
+ * program, so we don't specialize the values used only once or twice.
+ */
+static bool
+__codegen_const_is_hot(codegen_context *context, Const *con)
+{
+	StringInfoData	key;
+	const char	   *pos;
+	int				i, len;
+	bool			retval;
+
+	if (jit_specialize_threshold <= 0 || !context->str.data)
+		return false;
+
+	initStringInfo(&key);
+	appendStringInfo(&key, "CONST:%u:", con->consttype);
+	if (con->constisnull)
+		appendStringInfoString(&key, "null");
+	else
+	{
+		if (con->constbyval)
+		{
+			pos = (const char *)&con->constvalue;
+			len = con->constlen;
+		}
+		else if (con->constlen > 0)
+		{
+			pos = DatumGetPointer(con->constvalue);
+			len = con->constlen;
+		}
+		else
+		{
+			pos = DatumGetPointer(con->constvalue);
+			len = VARSIZE_ANY(pos);
+		}
+		for (i=0; i < len; i++)
+			appendStringInfo(&key, "%02x", (unsigned char)pos[i]);
+	}
+	retval = pgstrom_cuda_source_is_hot(key.data, jit_specialize_threshold);
+	pfree(key.data);
+
+	return retval;
+}
+
 static int
 codegen_const_expression(codegen_context *context,
 						 Const *con)
@@ -2755,6 +3255,10 @@ codegen_const_expression(codegen_context *context,
 	__appendStringInfo(&context->str,
 					   "KPARAM_%u", index);
 	context->param_refs = bms_add_member(context->param_refs, index);
+	if (__codegen_simple_literal(NULL, con->consttype, 0, true) &&
+		__codegen_const_is_hot(context, con))
+		context->param_literals = bms_add_member(context->param_literals,
+												 index);
 	if (con->constisnull)
 		width = 0;
 	else if (con->constlen > 0)
@@ -2892,6 +3396,41 @@ codegen_varnode_expression(codegen_context *context, Var *var)
 	return width;
 }
 
+/*
+ * codegen_text_warp_variant
+ *
+ * It checks whether the warp-cooperative variant of text functions should
+ * be used, according to the average width of the text column. The variant
+ * works with byte-wise search, so only single-byte and UTF-8 encodings are
+ * supported.
+ */
+static bool
+codegen_text_warp_variant(codegen_context *context, List *args)
+{
+	Node	   *expr = linitial(args);
+	Var		   *var;
+	RangeTblEntry *rte;
+
+	if (text_warp_threshold <= 0 || !context->root)
+		return false;
+	if (GetDatabaseEncoding() != PG_UTF8 &&
+		pg_database_encoding_max_length() != 1)
+		return false;
+	while (IsA(expr, RelabelType))
+		expr = (Node *)((RelabelType *) expr)->arg;
+	if (!IsA(expr, Var))
+		return false;
+	var = (Var *) expr;
+	if (var->varno <= 0 ||
+		var->varno >= context->root->simple_rel_array_size ||
+		var->varattno <= 0)
+		return false;
+	rte = planner_rt_fetch(var->varno, context->root);
+	if (!rte || rte->rtekind != RTE_RELATION)
+		return false;
+	return (get_attavgwidth(rte->relid, var->varattno) >= text_warp_threshold);
+}
+
 static int
 codegen_function_expression(codegen_context *context,
 							devfunc_info *dfunc, List *args)
@@ -2902,8 +3441,10 @@ codegen_function_expression(codegen_context *context,
 	int			index = 0;
 
 	__appendStringInfo(&context->str,
-					   "pgfn_%s(kcxt",
-					   dfunc->func_devname);
+					   "pgfn_%s%s(kcxt",
+					   dfunc->func_devname,
+					   dfunc->func_warp_variant &&
+					   codegen_text_warp_variant(context, args) ? "_warp" : "");
 	forboth (lc1, dfunc->func_args,
 			 lc2, args)
 	{
@@ -2945,6 +3486,410 @@ codegen_function_expression(codegen_context *context,
 	return dfunc->devfunc_result_sz(context, dfunc, fn_args, vl_width);
 }
 
+/*
+ * build_jsonb_keys_param
+ *
+ * It preprocesses a constant text[] for jsonb key existence (?|, ?&) or
+ * path lookup (#>, #>>) into kern_jsonb_keys; array indexes are parsed
+ * here, so device code never parses the path elements for each row.
+ */
+static bytea *
+build_jsonb_keys_param(ArrayType *array, bool is_path)
+{
+	Datum	   *elem_values;
+	bool	   *elem_isnull;
+	int			i, k, nitems;
+	size_t		sz;
+	StringInfoData buf;
+	kern_jsonb_keys *keys;
+
+	deconstruct_array(array, TEXTOID, -1, false, 'i',
+					  &elem_values, &elem_isnull, &nitems);
+	/* NULL elements are ignored for keys, but makes NULL for path */
+	for (i=0, k=0; i < nitems; i++)
+	{
+		if (!elem_isnull[i])
+			k++;
+		else if (is_path)
+			__ELog("jsonb path with NULL element is not device supported");
+	}
+	if (is_path && k == 0)
+		__ELog("empty jsonb path is not device supported");
+
+	sz = offsetof(kern_jsonb_keys, items[k]);
+	initStringInfo(&buf);
+	appendStringInfoSpaces(&buf, VARHDRSZ + sz);
+	memset(buf.data, 0, buf.len);
+	for (i=0, k=0; i < nitems; i++)
+	{
+		text	   *t;
+		char	   *cstr;
+		char	   *end;
+		long		index;
+		kern_jsonb_key *key;
+
+		if (elem_isnull[i])
+			continue;
+		t = DatumGetTextPP(elem_values[i]);
+		cstr = text_to_cstring(t);
+		key = &((kern_jsonb_keys *)(buf.data + VARHDRSZ))->items[k++];
+		key->offset = buf.len - VARHDRSZ;
+		key->length = VARSIZE_ANY_EXHDR(t);
+		errno = 0;
+		index = strtol(cstr, &end, 10);
+		if (end != cstr && *end == '\0' && errno == 0 &&
+			index >= INT_MIN && index <= INT_MAX)
+		{
+			key->index = index;
+			key->has_index = true;
+		}
+		appendBinaryStringInfo(&buf, VARDATA_ANY(t), VARSIZE_ANY_EXHDR(t));
+		pfree(cstr);
+	}
+	keys = (kern_jsonb_keys *)(buf.data + VARHDRSZ);
+	keys->nitems = k;
+	SET_VARSIZE(buf.data, buf.len);
+
+	return (bytea *) buf.data;
+}
+
+/*
+ * build_array_consts_param
+ *
+ * It preprocesses a constant array for the array operators (&&, @>, <@)
+ * into kern_array_consts; elements are sorted and deduplicated, so device
+ * code probes them by binary search.
+ */
+static int
+__compare_array_consts(const void *__a, const void *__b)
+{
+	cl_long		a = *((const cl_long *) __a);
+	cl_long		b = *((const cl_long *) __b);
+
+	if (a < b)
+		return -1;
+	if (a > b)
+		return 1;
+	return 0;
+}
+
+static bytea *
+build_array_consts_param(ArrayType *array, devtype_info *dtype_e,
+						 bool is_contains)
+{
+	kern_array_consts *ac;
+	StringInfoData buf;
+	Datum	   *elem_values;
+	bool	   *elem_isnull;
+	cl_long	   *values;
+	bool		has_null = false;
+	cl_uint		values_offset;
+	int			i, j, nitems;
+
+	deconstruct_array(array,
+					  dtype_e->type_oid,
+					  dtype_e->type_length,
+					  dtype_e->type_byval,
+					  dtype_e->type_align,
+					  &elem_values, &elem_isnull, &nitems);
+	values = palloc(sizeof(cl_long) * Max(nitems, 1));
+	for (i=0, j=0; i < nitems; i++)
+	{
+		if (elem_isnull[i])
+		{
+			has_null = true;
+			continue;
+		}
+		switch (dtype_e->type_oid)
+		{
+			case INT2OID:
+				values[j++] = DatumGetInt16(elem_values[i]);
+				break;
+			case INT4OID:
+				values[j++] = DatumGetInt32(elem_values[i]);
+				break;
+			case INT8OID:
+				values[j++] = DatumGetInt64(elem_values[i]);
+				break;
+			default:
+				__ELog("Bug? unexpected array element type: %s",
+					   format_type_be(dtype_e->type_oid));
+		}
+	}
+	if (j > 1)
+	{
+		qsort(values, j, sizeof(cl_long), __compare_array_consts);
+		for (i=1, nitems=1; i < j; i++)
+		{
+			if (values[i] != values[nitems-1])
+				values[nitems++] = values[i];
+		}
+	}
+	else
+		nitems = j;
+	if (is_contains && nitems > KERN_ARRAY_CONSTS_MAX_CONTAINS)
+		__ELog("too large constant array for @> operator (%d items)",
+			   nitems);
+
+	initStringInfo(&buf);
+	appendStringInfoSpaces(&buf, VARHDRSZ + sizeof(kern_array_consts));
+	while (TYPEALIGN(sizeof(cl_long), buf.len) != buf.len)
+		appendStringInfoChar(&buf, '\0');
+	values_offset = buf.len - VARHDRSZ;
+	appendBinaryStringInfo(&buf, (char *)values, sizeof(cl_long) * nitems);
+
+	ac = (kern_array_consts *)(buf.data + VARHDRSZ);
+	memset(ac, 0, sizeof(kern_array_consts));
+	ac->nitems = nitems;
+	ac->has_null = has_null;
+	ac->values_offset = values_offset;
+	SET_VARSIZE(buf.data, buf.len);
+	pfree(values);
+
+	return (bytea *) buf.data;
+}
+
+/*
+ * codegen_const_prep_expression
+ *
+ * Some device functions take a constant argument preprocessed at the
+ * planning time, instead of the constant value itself; regular expression
+ * pattern is compiled to DFA, text[] for jsonb keys/path is transformed to
+ * kern_jsonb_keys, constant array of the array operators is sorted into
+ * kern_array_consts, and time zone name of timezone() (1st argument) is
+ * transformed to kern_tz_info. The result is delivered as a bytea parameter.
+ */
+static int
+codegen_const_prep_expression(codegen_context *context,
+							  devfunc_info *dfunc, List *args, Oid collid)
+{
+	int			cindex = (dfunc->func_const_prep == 'Z' ? 0 : 1);
+	int			eindex = 1 - cindex;
+	devtype_info *dtype = list_nth(dfunc->func_args, eindex);
+	Node	   *expr = list_nth(args, eindex);
+	Node	   *carg = list_nth(args, cindex);
+	Oid			expr_type_oid = exprType(expr);
+	Const	   *con;
+	bytea	   *prep = NULL;
+	const char *errmsg = NULL;
+	Expr	   *fn_args[2];
+	int			vl_width[2];
+	int			i;
+
+	while (IsA(carg, RelabelType))
+		carg = (Node *)((RelabelType *) carg)->arg;
+	if (!IsA(carg, Const) || ((Const *) carg)->constisnull)
+		__ELog("%s argument of %s must be a constant",
+			   cindex == 0 ? "1st" : "2nd",
+			   format_procedure(dfunc->func_oid));
+	con = (Const *) carg;
+	switch (dfunc->func_const_prep)
+	{
+		case 'R':
+		case 'I':
+			prep = pgstrom_regex_compile(DatumGetTextPP(con->constvalue),
+										 dfunc->func_const_prep == 'I',
+										 collid, &errmsg);
+			if (!prep)
+				__ELog("regular expression is not supported on device: %s",
+					   errmsg);
+			break;
+		case 'K':
+		case 'P':
+			prep = build_jsonb_keys_param(DatumGetArrayTypeP(con->constvalue),
+										  dfunc->func_const_prep == 'P');
+			break;
+		case 'A':
+			prep = build_array_consts_param(DatumGetArrayTypeP(con->constvalue),
+											dtype->type_element,
+											strncmp(dfunc->func_devname,
+													"arraycontains_", 14) == 0);
+			break;
+		case 'Z':
+			prep = pgstrom_build_timezone_param(DatumGetTextPP(con->constvalue),
+												&errmsg);
+			if (!prep)
+				__ELog("time zone is not supported on device: %s", errmsg);
+			break;
+		default:
+			__ELog("Bug? unknown preprocessing of the constant: %c",
+				   dfunc->func_const_prep);
+	}
+	con = makeConst(BYTEAOID, -1, InvalidOid, -1,
+					PointerGetDatum(prep), false, false);
+
+	__appendStringInfo(&context->str,
+					   "pgfn_%s(kcxt, ",
+					   dfunc->func_devname);
+	for (i=0; i < 2; i++)
+	{
+		if (i > 0)
+			__appendStringInfo(&context->str, ", ");
+		if (i == cindex)
+		{
+			vl_width[i] = codegen_const_expression(context, con);
+			fn_args[i] = (Expr *) con;
+			continue;
+		}
+		if (dtype->type_oid == expr_type_oid)
+			codegen_expression_walker(context, expr, &vl_width[i]);
+		else if (pgstrom_devtype_can_relabel(expr_type_oid,
+											 dtype->type_oid))
+		{
+			__appendStringInfo(&context->str, "to_%s(", dtype->type_name);
+			codegen_expression_walker(context, expr, &vl_width[i]);
+			__appendStringInfoChar(&context->str, ')');
+		}
+		else
+		{
+			__ELog("Bug? unsupported implicit type cast (%s)->(%s)",
+				   format_type_be(expr_type_oid),
+				   format_type_be(dtype->type_oid));
+		}
+		fn_args[i] = (Expr *) expr;
+	}
+	__appendStringInfoChar(&context->str, ')');
+
+	return dfunc->devfunc_result_sz(context, dfunc, fn_args, vl_width);
+}
+
+/*
+ * codegen_hash_partition_expression
+ *
+ * satisfies_hash_partition() is the partition constraint of hash partitions;
+ * e.g, INSERT ... SELECT into a particular partition picks up the source
+ * rows routed to the partition by this function. It runs on the device if
+ * parent, modulus and remainder are constants, and the partition keys use
+ * the default hash operator classes of the types supported below.
+ */
+static int
+codegen_hash_partition_expression(codegen_context *context, FuncExpr *func)
+{
+	Datum		cvalues[3];
+	Oid			parent_oid;
+	cl_int		modulus;
+	cl_int		remainder;
+	Relation	rel;
+	int			nkeys = list_length(func->args) - 3;
+	Oid		   *key_supfunc = alloca(sizeof(Oid) * Max(nkeys, 1));
+	Oid		   *key_collid = alloca(sizeof(Oid) * Max(nkeys, 1));
+	int			partnatts = -1;
+	ListCell   *lc;
+	int			i;
+
+	if (func->funcvariadic || nkeys < 1)
+		__ELog("satisfies_hash_partition with VARIADIC array is not device supported");
+	for (i=0; i < 3; i++)
+	{
+		Node   *carg = list_nth(func->args, i);
+
+		while (IsA(carg, RelabelType))
+			carg = (Node *)((RelabelType *) carg)->arg;
+		if (!IsA(carg, Const) || ((Const *) carg)->constisnull)
+			__ELog("parent, modulus and remainder of satisfies_hash_partition must be constants");
+		cvalues[i] = ((Const *) carg)->constvalue;
+	}
+	parent_oid = DatumGetObjectId(cvalues[0]);
+	modulus = DatumGetInt32(cvalues[1]);
+	remainder = DatumGetInt32(cvalues[2]);
+	if (modulus <= 0 || remainder < 0 || remainder >= modulus)
+		__ELog("invalid modulus/remainder of satisfies_hash_partition");
+
+	/* fetch the partition key definition */
+	rel = try_relation_open(parent_oid, AccessShareLock);
+	if (rel)
+	{
+		if (rel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE)
+		{
+			PartitionKey	key = RelationGetPartitionKey(rel);
+
+			if (key->strategy == PARTITION_STRATEGY_HASH &&
+				key->partnatts == nkeys)
+			{
+				partnatts = key->partnatts;
+				for (i=0; i < nkeys; i++)
+				{
+					key_supfunc[i] = key->partsupfunc[i].fn_oid;
+					key_collid[i] = key->partcollation[i];
+				}
+			}
+		}
+		relation_close(rel, AccessShareLock);
+	}
+	if (partnatts != nkeys)
+		__ELog("relation %u is not a hash partitioned table with %d keys",
+			   parent_oid, nkeys);
+
+	__appendStringInfo(&context->str, "pg_satisfies_hash_partition(kcxt, ");
+	for (i=0; i < nkeys; i++)
+		__appendStringInfo(&context->str, "pg_hash_partition(kcxt, ");
+	__appendStringInfo(&context->str, "0UL");
+	i = -3;
+	foreach (lc, func->args)
+	{
+		Node	   *expr = lfirst(lc);
+		Oid			expr_type_oid = exprType(expr);
+		Oid			key_type_oid;
+		devtype_info *dtype;
+		int			dummy;
+
+		if (i < 0)
+		{
+			i++;
+			continue;	/* skip parent, modulus and remainder */
+		}
+		switch (key_supfunc[i])
+		{
+			case F_HASHINT2EXTENDED:
+				key_type_oid = INT2OID;
+				break;
+			case F_HASHINT4EXTENDED:
+				key_type_oid = INT4OID;
+				break;
+			case F_HASHINT8EXTENDED:
+				key_type_oid = INT8OID;
+				break;
+			case F_HASHFLOAT4EXTENDED:
+				key_type_oid = FLOAT4OID;
+				break;
+			case F_HASHFLOAT8EXTENDED:
+				key_type_oid = FLOAT8OID;
+				break;
+			case F_HASHTEXTEXTENDED:
+				key_type_oid = TEXTOID;
+				if (!pgstrom_collation_is_deterministic(key_collid[i]))
+					__ELog("hash partition key with non-deterministic collation is not device supported");
+				break;
+			default:
+				__ELog("hash support function %s of the partition key is not device supported",
+					   format_procedure(key_supfunc[i]));
+		}
+		dtype = pgstrom_devtype_lookup_and_track(key_type_oid, context);
+		if (!dtype)
+			__ELog("device type %s is not supported",
+				   format_type_be(key_type_oid));
+		__appendStringInfo(&context->str, ", ");
+		if (expr_type_oid == key_type_oid)
+			codegen_expression_walker(context, expr, &dummy);
+		else if (pgstrom_devtype_can_relabel(expr_type_oid, key_type_oid))
+		{
+			__appendStringInfo(&context->str, "to_%s(", dtype->type_name);
+			codegen_expression_walker(context, expr, &dummy);
+			__appendStringInfoChar(&context->str, ')');
+		}
+		else
+			__ELog("partition key type mismatch (%s)->(%s)",
+				   format_type_be(expr_type_oid),
+				   format_type_be(key_type_oid));
+		__appendStringInfoChar(&context->str, ')');
+		context->devcost += 1;
+		i++;
+	}
+	__appendStringInfo(&context->str, ", %d, %d)", modulus, remainder);
+
+	return sizeof(cl_bool);
+}
+
 static int
 codegen_nulltest_expression(codegen_context *context,
 							NullTest *nulltest)
@@ -3432,6 +4377,9 @@ codegen_scalar_array_op_expression(codegen_context *context,
 		if (!dfunc)
 			__ELog("function %s is not device supported",
 				   format_procedure(opexpr->opfuncid));
+		if (dfunc->func_const_prep)
+			__ELog("function %s with ANY/ALL is not device supported",
+				   format_procedure(opexpr->opfuncid));
 		pgstrom_devfunc_track(context, dfunc);
 	}
 	PG_CATCH();
@@ -3442,6 +4390,62 @@ codegen_scalar_array_op_expression(codegen_context *context,
 	PG_END_TRY();
 	ReleaseSysCache(fn_tup);
 
+	/*
+	 * Unroll the IN-list, if array is a frequently used constant of values
+	 * which are also bakable into the kernel source.
+	 */
+	if ((IsA(node_s, Var) || IsA(node_s, Param)) &&
+		IsA(node_a, Const) && !((Const *)node_a)->constisnull &&
+		__codegen_simple_literal(NULL, dtype_e->type_oid, 0, true) &&
+		__codegen_const_is_hot(context, (Const *)node_a))
+	{
+		ArrayType  *array = DatumGetArrayTypeP(((Const *)node_a)->constvalue);
+		Datum	   *elem_values;
+		bool	   *elem_isnull;
+		int			i, nitems;
+		int			varno;
+
+		deconstruct_array(array,
+						  dtype_e->type_oid,
+						  dtype_e->type_length,
+						  dtype_e->type_byval,
+						  dtype_e->type_align,
+						  &elem_values, &elem_isnull, &nitems);
+		if (nitems <= JIT_SPECIALIZE_MAX_INLIST)
+		{
+			varno = ++context->decl_count;
+			__appendStringInfo(
+				&context->decl_temp,
+				"  pg_bool_t __temp%d __attribute__((unused));\n"
+				"  cl_bool   __anynull%d __attribute__((unused)) = false;\n",
+				varno, varno);
+			for (i=0; i < nitems; i++)
+			{
+				__appendStringInfo(&context->str,
+								   "%s(__temp%d, __anynull%d, pgfn_%s(kcxt, ",
+								   opexpr->useOr ? "OR" : "AND",
+								   varno, varno,
+								   dfunc->func_devname);
+				codegen_expression_walker(context, node_s, NULL);
+				__appendStringInfo(&context->str, ", pg_%s_t",
+								   dtype_e->type_name);
+				__codegen_simple_literal(&context->str,
+										 dtype_e->type_oid,
+										 elem_values[i],
+										 elem_isnull[i]);
+				__appendStringInfo(&context->str, "), ");
+			}
+			__appendStringInfo(&context->str,
+							   "PG_BOOL(__anynull%d, %s)",
+							   varno, opexpr->useOr ? "false" : "true");
+			for (i=0; i < nitems; i++)
+				__appendStringInfoChar(&context->str, ')');
+			context->devcost += Max(nitems, 1) * dfunc->func_devcost;
+
+			return sizeof(cl_bool);
+		}
+	}
+
 	__appendStringInfo(&context->str,
 					   "PG_SCALAR_ARRAY_OP(kcxt, pgfn_%s, ",
 					   dfunc->func_devname);
@@ -3494,6 +4498,11 @@ codegen_expression_walker(codegen_context *context,
 			{
 				FuncExpr   *func = (FuncExpr *) node;
 
+				if (func->funcid == F_SATISFIES_HASH_PARTITION)
+				{
+					width = codegen_hash_partition_expression(context, func);
+					break;
+				}
 				dfunc = pgstrom_devfunc_lookup(func->funcid,
 											   func->funcresulttype,
 											   func->args,
@@ -3502,9 +4511,15 @@ codegen_expression_walker(codegen_context *context,
 					__ELog("function %s is not device supported",
 						   format_procedure(func->funcid));
 				pgstrom_devfunc_track(context, dfunc);
-				width = codegen_function_expression(context,
-													dfunc,
-													func->args);
+				if (dfunc->func_const_prep)
+					width = codegen_const_prep_expression(context,
+														  dfunc,
+														  func->args,
+														  func->inputcollid);
+				else
+					width = codegen_function_expression(context,
+														dfunc,
+														func->args);
 				context->devcost += dfunc->func_devcost;
 			}
 			break;
@@ -3523,9 +4538,15 @@ codegen_expression_walker(codegen_context *context,
 					__ELog("function %s is not device supported",
 						   format_procedure(func_oid));
 				pgstrom_devfunc_track(context, dfunc);
-				width = codegen_function_expression(context,
-													dfunc,
-													op->args);
+				if (dfunc->func_const_prep)
+					width = codegen_const_prep_expression(context,
+														  dfunc,
+														  op->args,
+														  op->inputcollid);
+				else
+					width = codegen_function_expression(context,
+														dfunc,
+														op->args);
 				context->devcost += dfunc->func_devcost;
 			}
 			break;
@@ -3652,10 +4673,20 @@ pgstrom_codegen_param_declarations(StringInfo buf, codegen_context *context)
 				__ELog("failed to lookup device type: %u",
 					   con->consttype);
 
-			appendStringInfo(
-				buf,
-				"  pg_%s_t KPARAM_%u = pg_%s_param(kcxt,%d);\n",
-				dtype->type_name, index, dtype->type_name, index);
+			if (bms_is_member(index, context->param_literals))
+			{
+				appendStringInfo(buf, "  pg_%s_t KPARAM_%u = ",
+								 dtype->type_name, index);
+				__codegen_simple_literal(buf, con->consttype,
+										 con->constvalue,
+										 con->constisnull);
+				appendStringInfoString(buf, ";\n");
+			}
+			else
+				appendStringInfo(
+					buf,
+					"  pg_%s_t KPARAM_%u = pg_%s_param(kcxt,%d);\n",
+					dtype->type_name, index, dtype->type_name, index);
 		}
 		else if (IsA(node, Param))
 		{
@@ -3728,6 +4759,202 @@ pgstrom_union_type_declarations(StringInfo buf,
 	appendStringInfo(buf, "  } %s;\n", name);
 }
 
+/*
+ * devexpr_reject_record
+ *
+ * It records the reason why the expression is not device executable.
+ * The same rejection (function, type and reason) is merged, and the least
+ * recently rejected one is released if too many.
+ */
+static void
+devexpr_reject_record(Node *node, const char *reason,
+					  const char *filename, int lineno)
+{
+	MemoryContext oldcxt;
+	devexpr_reject_info *entry;
+	dlist_iter	iter;
+	Oid			func_oid = InvalidOid;
+	Oid			type_oid = InvalidOid;
+
+	if (node)
+	{
+		if (IsA(node, FuncExpr))
+			func_oid = ((FuncExpr *) node)->funcid;
+		else if (IsA(node, OpExpr) ||
+				 IsA(node, DistinctExpr) ||
+				 IsA(node, NullIfExpr))
+			func_oid = get_opcode(((OpExpr *) node)->opno);
+		else if (IsA(node, ScalarArrayOpExpr))
+			func_oid = get_opcode(((ScalarArrayOpExpr *) node)->opno);
+		if (!IsA(node, List))
+			type_oid = exprType(node);
+	}
+
+	dlist_foreach(iter, &devexpr_reject_list)
+	{
+		entry = dlist_container(devexpr_reject_info, chain, iter.cur);
+		if (entry->func_oid == func_oid &&
+			entry->type_oid == type_oid &&
+			strcmp(entry->reason, reason) == 0)
+		{
+			entry->seqno = ++devexpr_reject_seqno;
+			entry->count++;
+			entry->last_time = GetCurrentTimestamp();
+			dlist_move_head(&devexpr_reject_list, &entry->chain);
+			return;
+		}
+	}
+
+	oldcxt = MemoryContextSwitchTo(devexpr_reject_memcxt);
+	entry = palloc0(sizeof(devexpr_reject_info));
+	entry->seqno = ++devexpr_reject_seqno;
+	entry->count = 1;
+	entry->last_time = GetCurrentTimestamp();
+	entry->func_oid = func_oid;
+	entry->type_oid = type_oid;
+	entry->reason = pstrdup(reason);
+	entry->location = psprintf("%s:%d", filename, lineno);
+	dlist_push_head(&devexpr_reject_list, &entry->chain);
+	MemoryContextSwitchTo(oldcxt);
+
+	if (++devexpr_reject_nitems > DEVEXPR_REJECT_MAX_ITEMS)
+	{
+		entry = dlist_container(devexpr_reject_info, chain,
+								dlist_tail_node(&devexpr_reject_list));
+		dlist_delete(&entry->chain);
+		pfree(entry->reason);
+		pfree(entry->location);
+		pfree(entry);
+		devexpr_reject_nitems--;
+	}
+}
+
+/*
+ * pgstrom_devexpr_reject_seqno
+ *
+ * It returns the current sequence number of the rejections, to pick up
+ * the rejections during a particular planning.
+ */
+uint64
+pgstrom_devexpr_reject_seqno(void)
+{
+	return devexpr_reject_seqno;
+}
+
+/*
+ * pgstrom_devexpr_reject_reasons
+ *
+ * It returns a list of the human readable rejection reasons since the
+ * supplied sequence number, in the order of the first occurrence.
+ */
+List *
+pgstrom_devexpr_reject_reasons(uint64 since)
+{
+	List	   *result = NIL;
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &devexpr_reject_list)
+	{
+		devexpr_reject_info *entry
+			= dlist_container(devexpr_reject_info, chain, iter.cur);
+		StringInfoData buf;
+
+		if (entry->seqno <= since)
+			break;
+		initStringInfo(&buf);
+		appendStringInfoString(&buf, entry->reason);
+		if (OidIsValid(entry->func_oid))
+			appendStringInfo(&buf, " [function: %s]",
+							 format_procedure(entry->func_oid));
+		else if (OidIsValid(entry->type_oid))
+			appendStringInfo(&buf, " [type: %s]",
+							 format_type_be(entry->type_oid));
+		result = lcons(buf.data, result);
+	}
+	return result;
+}
+
+/*
+ * pgstrom_device_expression_rejects
+ *
+ * It shows the recent rejections of device expressions in this backend.
+ */
+Datum
+pgstrom_device_expression_rejects(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	devexpr_reject_info *entry;
+	HeapTuple	tuple;
+	Datum		values[7];
+	bool		isnull[7];
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		List		   *items = NIL;
+		dlist_iter		iter;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(7);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "func",
+						   REGPROCEDUREOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "type",
+						   REGTYPEOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "reason",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "location",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "count",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "last_time",
+						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "seqno",
+						   INT8OID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		/* snapshot, because the list may be updated during the scan */
+		dlist_foreach(iter, &devexpr_reject_list)
+		{
+			devexpr_reject_info *temp = palloc(sizeof(devexpr_reject_info));
+
+			entry = dlist_container(devexpr_reject_info, chain, iter.cur);
+			memcpy(temp, entry, sizeof(devexpr_reject_info));
+			temp->reason = pstrdup(entry->reason);
+			temp->location = pstrdup(entry->location);
+			items = lappend(items, temp);
+		}
+		fncxt->user_fctx = items;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+
+	if (fncxt->call_cntr >= list_length((List *) fncxt->user_fctx))
+		SRF_RETURN_DONE(fncxt);
+	entry = list_nth((List *) fncxt->user_fctx, fncxt->call_cntr);
+
+	memset(isnull, 0, sizeof(isnull));
+	if (OidIsValid(entry->func_oid))
+		values[0] = ObjectIdGetDatum(entry->func_oid);
+	else
+		isnull[0] = true;
+	if (OidIsValid(entry->type_oid))
+		values[1] = ObjectIdGetDatum(entry->type_oid);
+	else
+		isnull[1] = true;
+	values[2] = CStringGetTextDatum(entry->reason);
+	values[3] = CStringGetTextDatum(entry->location);
+	values[4] = Int64GetDatum(entry->count);
+	values[5] = TimestampTzGetDatum(entry->last_time);
+	values[6] = Int64GetDatum(entry->seqno);
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_device_expression_rejects);
+
 /*
  * __pgstrom_device_expression
  *
@@ -3780,7 +5007,9 @@ __pgstrom_device_expression(PlannerInfo *root,
 
 		FlushErrorState();
 
-		ereport(DEBUG2,
+		devexpr_reject_record(__codegen_current_node, edata->message,
+							  filename, lineno);
+		ereport(devexpr_reject_log_level,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("%s:%d %s, at %s:%d",
 						filename, lineno,
@@ -3798,8 +5027,13 @@ __pgstrom_device_expression(PlannerInfo *root,
 	{
 		if (con.varlena_bufsz > KERN_CONTEXT_VARLENA_BUFSZ_LIMIT)
 		{
-			elog(DEBUG2, "Expression consumes too much buffer (%u): %s",
-				 con.varlena_bufsz, nodeToString(expr));
+			char   *reason = psprintf("expression consumes too much buffer (%u)",
+									  con.varlena_bufsz);
+
+			devexpr_reject_record((Node *)expr, reason, filename, lineno);
+			elog(devexpr_reject_log_level, "%s:%d %s: %s",
+				 filename, lineno, reason, nodeToString(expr));
+			pfree(reason);
 			return false;
 		}
 		Assert(con.devcost >= 0);
@@ -3941,6 +5175,18 @@ devfunc_cache_invalidator(Datum arg, int cacheid, uint32 hashvalue)
 	}
 }
 
+static void
+devfunc_user_catalog_invalidator(Datum arg, Oid relid)
+{
+	int		hindex;
+
+	if (OidIsValid(relid) && relid != devfunc_user_catalog_oid)
+		return;
+	for (hindex=0; hindex < lengthof(devfunc_info_slot); hindex++)
+		dlist_init(&devfunc_info_slot[hindex]);
+	devfunc_user_catalog_oid = InvalidOid;
+}
+
 static void
 devcast_cache_invalidator(Datum arg, int cacheid, uint32 hashvalue)
 {
@@ -3997,7 +5243,48 @@ pgstrom_init_codegen(void)
 										   "device type/func info cache",
 										   ALLOCSET_DEFAULT_SIZES);
 	CacheRegisterSyscacheCallback(PROCOID, devfunc_cache_invalidator, 0);
+	CacheRegisterRelcacheCallback(devfunc_user_catalog_invalidator, 0);
 	CacheRegisterSyscacheCallback(TYPEOID, devtype_cache_invalidator, 0);
 	CacheRegisterSyscacheCallback(CASTSOURCETARGET,
 								  devcast_cache_invalidator, 0);
+
+	devexpr_reject_memcxt = AllocSetContextCreate(TopMemoryContext,
+												  "device expression rejects",
+												  ALLOCSET_SMALL_SIZES);
+	dlist_init(&devexpr_reject_list);
+
+	/* pg_strom.jit_specialize_threshold */
+	DefineCustomIntVariable("pg_strom.jit_specialize_threshold",
+							"Number of plannings of the same constant to bake its value into the GPU kernel source",
+							NULL,
+							&jit_specialize_threshold,
+							0,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	/* pg_strom.text_warp_threshold */
+	DefineCustomIntVariable("pg_strom.text_warp_threshold",
+							"Average width of text columns to process them by warp-cooperative device functions",
+							NULL,
+							&text_warp_threshold,
+							256,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	/* pg_strom.device_expression_log_level */
+	DefineCustomEnumVariable("pg_strom.device_expression_log_level",
+							 "Log level to report expressions not executable on GPU devices",
+							 NULL,
+							 &devexpr_reject_log_level,
+							 DEBUG2,
+							 devexpr_reject_log_level_options,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 }
@@ -762,6 +762,27 @@ STROMCL_EXTERNAL_COMP_HASH_TEMPLATE(composite)
 STROMCL_EXTERNAL_ARROW_TEMPLATE(composite)
 #endif
 
+/*
+ * hash functions compatible to the hash-partitioning
+ */
+#ifdef __CUDACC__
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_int2_t datum);
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_int4_t datum);
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_int8_t datum);
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_float4_t datum);
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_float8_t datum);
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_text_t datum);
+DEVICE_FUNCTION(pg_bool_t)
+pg_satisfies_hash_partition(kern_context *kcxt, cl_ulong rowhash,
+							cl_int modulus, cl_int remainder);
+#endif /* __CUDACC__ */
+
 /*
  * handler functions for DATUM_CLASS__(VARLENA|ARRAY|COMPOSITE)
  */
@@ -592,6 +592,98 @@ pg_hash_any(const cl_uchar *k, cl_int keylen)
 
 	return c;
 }
+
+/*
+ * Device version of hash_any_extended() in PG host code
+ */
+STATIC_FUNCTION(cl_ulong)
+pg_hash_any_extended(const cl_uchar *k, cl_int keylen, cl_ulong seed)
+{
+	cl_uint		a, b, c;
+	cl_uint		len;
+
+	/* Set up the internal state */
+	len = keylen;
+	a = b = c = 0x9e3779b9 + len + 3923095;
+
+	/* If the seed is non-zero, use it to perturb the internal state */
+	if (seed != 0)
+	{
+		a += (cl_uint)(seed >> 32);
+		b += (cl_uint) seed;
+		mix(a, b, c);
+	}
+
+	/* handle most of the key, with byte-wise fetches */
+	while (len >= 12)
+	{
+		a += k[0] + (((cl_uint) k[1] << 8) +
+					 ((cl_uint) k[2] << 16) +
+					 ((cl_uint) k[3] << 24));
+		b += k[4] + (((cl_uint) k[5] << 8) +
+					 ((cl_uint) k[6] << 16) +
+					 ((cl_uint) k[7] << 24));
+		c += k[8] + (((cl_uint) k[9] << 8) +
+					 ((cl_uint) k[10] << 16) +
+					 ((cl_uint) k[11] << 24));
+		mix(a, b, c);
+		k += 12;
+		len -= 12;
+	}
+
+	/* handle the last 11 bytes */
+	switch (len)            /* all the case statements fall through */
+	{
+		case 11:
+			c += ((cl_uint) k[10] << 24);
+		case 10:
+			c += ((cl_uint) k[9] << 16);
+		case 9:
+			c += ((cl_uint) k[8] << 8);
+			/* the lowest byte of c is reserved for the length */
+		case 8:
+			b += ((cl_uint) k[7] << 24);
+		case 7:
+			b += ((cl_uint) k[6] << 16);
+		case 6:
+			b += ((cl_uint) k[5] << 8);
+		case 5:
+			b += k[4];
+		case 4:
+			a += ((cl_uint) k[3] << 24);
+		case 3:
+			a += ((cl_uint) k[2] << 16);
+		case 2:
+			a += ((cl_uint) k[1] << 8);
+		case 1:
+			a += k[0];
+			/* case 0: nothing left to add */
+	}
+	final(a, b, c);
+
+	return ((cl_ulong) b << 32) | c;
+}
+
+/*
+ * Device version of hash_uint32_extended() in PG host code
+ */
+STATIC_FUNCTION(cl_ulong)
+pg_hash_uint32_extended(cl_uint k, cl_ulong seed)
+{
+	cl_uint		a, b, c;
+
+	a = b = c = 0x9e3779b9 + (cl_uint) sizeof(cl_uint) + 3923095;
+	if (seed != 0)
+	{
+		a += (cl_uint)(seed >> 32);
+		b += (cl_uint) seed;
+		mix(a, b, c);
+	}
+	a += k;
+	final(a, b, c);
+
+	return ((cl_ulong) b << 32) | c;
+}
 #undef rot
 #undef mix
 #undef final
@@ -1261,6 +1353,120 @@ pg_comp_hash(kern_context *kcxt, pg_interval_t datum)
 	return pg_hash_any((cl_uchar *)&days, sizeof(cl_long));
 }
 
+/*
+ * Hash-functions compatible to the hash-partitioning
+ *
+ * pg_hash_partition() combines the extended hash value of the partition key
+ * to @rowhash; like compute_partition_hash_value(), NULL keys are skipped.
+ * It assumes the default hash operator class of the key types.
+ */
+#define PG_HASH_PARTITION_SEED		0x7A5B22367996DCFDUL
+
+STATIC_INLINE(cl_ulong)
+pg_hash_combine64(cl_ulong a, cl_ulong b)
+{
+	/* see hash_combine64 */
+	a ^= b + 0x49a0f4dd15e5a8e4UL + (a << 54) + (a >> 7);
+	return a;
+}
+
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_int2_t datum)
+{
+	if (datum.isnull)
+		return rowhash;
+	return pg_hash_combine64(rowhash,
+		pg_hash_uint32_extended((cl_int)datum.value,
+								PG_HASH_PARTITION_SEED));
+}
+
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_int4_t datum)
+{
+	if (datum.isnull)
+		return rowhash;
+	return pg_hash_combine64(rowhash,
+		pg_hash_uint32_extended(datum.value,
+								PG_HASH_PARTITION_SEED));
+}
+
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_int8_t datum)
+{
+	cl_uint		hi, lo;
+
+	if (datum.isnull)
+		return rowhash;
+	/* see hashint8extended */
+	lo = (cl_uint)(datum.value & 0xffffffffL);
+	hi = (cl_uint)(datum.value >> 32);
+	lo ^= (datum.value >= 0 ? hi : ~hi);
+	return pg_hash_combine64(rowhash,
+		pg_hash_uint32_extended(lo, PG_HASH_PARTITION_SEED));
+}
+
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_float8_t datum)
+{
+	cl_double	fval;
+
+	if (datum.isnull)
+		return rowhash;
+	/* see hashfloat8extended */
+	fval = datum.value;
+	if (fval == 0.0)
+		return pg_hash_combine64(rowhash, PG_HASH_PARTITION_SEED);
+	if (isnan(fval))
+		fval = __longlong_as_double(0x7ff8000000000000L);	/* get_float8_nan */
+	return pg_hash_combine64(rowhash,
+		pg_hash_any_extended((cl_uchar *)&fval, sizeof(cl_double),
+							 PG_HASH_PARTITION_SEED));
+}
+
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_float4_t datum)
+{
+	pg_float8_t	temp;
+
+	/* see hashfloat4extended; it hashes float4 as float8 */
+	temp.isnull = datum.isnull;
+	temp.value  = (cl_double) datum.value;
+	return pg_hash_partition(kcxt, rowhash, temp);
+}
+
+DEVICE_FUNCTION(cl_ulong)
+pg_hash_partition(kern_context *kcxt, cl_ulong rowhash, pg_text_t datum)
+{
+	if (datum.isnull)
+		return rowhash;
+	if (datum.length >= 0)
+		return pg_hash_combine64(rowhash,
+			pg_hash_any_extended((cl_uchar *)datum.value, datum.length,
+								 PG_HASH_PARTITION_SEED));
+	if (VARATT_IS_COMPRESSED(datum.value) ||
+		VARATT_IS_EXTERNAL(datum.value))
+	{
+		STROM_CPU_FALLBACK(kcxt, ERRCODE_STROM_VARLENA_UNSUPPORTED,
+						   "varlena datum is compressed or external");
+		return rowhash;
+	}
+	return pg_hash_combine64(rowhash,
+		pg_hash_any_extended((cl_uchar *)VARDATA_ANY(datum.value),
+							 VARSIZE_ANY_EXHDR(datum.value),
+							 PG_HASH_PARTITION_SEED));
+}
+
+DEVICE_FUNCTION(pg_bool_t)
+pg_satisfies_hash_partition(kern_context *kcxt, cl_ulong rowhash,
+							cl_int modulus, cl_int remainder)
+{
+	pg_bool_t	result;
+
+	result.isnull = false;
+	result.value  = (rowhash % (cl_ulong)modulus == (cl_ulong)remainder);
+	return result;
+}
+
 /*
  * for DATUM_CLASS__VARLENA handler
  *
@@ -2024,3 +2230,111 @@ pg_composite_datum_write(kern_context *kcxt, char *dest, Datum datum)
 	kcxt->vlpos = vlpos_saved;
 	return sz;
 }
+
+/*
+ * __xact_visible_committed
+ *
+ * It returns true, if @xid is committed and visible to the snapshot.
+ */
+STATIC_FUNCTION(cl_bool)
+__xact_visible_committed(kern_xact_visibility *xvis,
+						 TransactionId xid, cl_bool hint_committed)
+{
+	cl_uchar   *bitmap = KERN_XACT_VISIBILITY_BITMAP(xvis);
+	cl_uint		diff;
+
+	/* bootstrap and frozen xids are always committed */
+	if (xid < FirstNormalTransactionId)
+		return (xid != InvalidTransactionId);
+	/* xids not finished at the snapshot */
+	if ((cl_int)(xid - xvis->xmax) >= 0)
+		return false;
+	if ((cl_int)(xid - xvis->xmin) >= 0)
+	{
+		cl_int		head = 0;
+		cl_int		tail = (cl_int)xvis->xcnt - 1;
+
+		while (head <= tail)
+		{
+			cl_int	curr = (head + tail) / 2;
+
+			if (xvis->xip[curr] == xid)
+				return false;
+			if (xvis->xip[curr] < xid)
+				head = curr + 1;
+			else
+				tail = curr - 1;
+		}
+	}
+	if (hint_committed)
+		return true;
+	/*
+	 * VACUUM removes aborted xids prior to advance relfrozenxid, so xids
+	 * older than the relfrozenxid are committed.
+	 */
+	diff = xid - xvis->xid_base;
+	if ((cl_int)diff < 0)
+		return true;
+	return (bitmap[diff >> 3] & (1 << (diff & 7))) != 0;
+}
+
+/*
+ * kern_heap_visibility_check
+ *
+ * It checks MVCC visibility of the tuples on the blocks which are not
+ * all-visible, then marks invisible tuples unused, like CPU doing for the
+ * blocks on the shared buffer. Each thread-block processes a block.
+ *
+ * NOTE: Host side enables this check only if no MultiXactId exists in the
+ * relation at the beginning of the scan, so MultiXactId in t_xmax is always
+ * newer than the snapshot, and its updater is not visible.
+ * HEAP_MOVED_* is never set since v9.0, and VACUUM sets hint bits on them
+ * prior to advance relfrozenxid.
+ */
+KERNEL_FUNCTION(void)
+kern_heap_visibility_check(kern_data_store *kds,
+						   kern_xact_visibility *xvis,
+						   cl_uint block_base)
+{
+	cl_uint		block_id = block_base + get_group_id();
+	PageHeaderData *pg_page;
+	cl_uint		i, n_lines;
+
+	if (block_id >= kds->nitems)
+		return;
+	pg_page = KERN_DATA_STORE_BLOCK_PGPAGE(kds, block_id);
+	if ((pg_page->pd_flags & PD_ALL_VISIBLE) != 0)
+		return;
+	n_lines = PageGetMaxOffsetNumber(pg_page);
+	for (i = get_local_id(); i < n_lines; i += get_local_size())
+	{
+		ItemIdData *lpp = PageGetItemId(pg_page, i+1);
+		HeapTupleHeaderData *htup;
+		cl_ushort	infomask;
+
+		if (!ItemIdIsNormal(lpp))
+			continue;
+		htup = PageGetItem(pg_page, lpp);
+		infomask = htup->t_infomask;
+
+		/* inserter must be committed and visible */
+		if ((infomask & HEAP_XMIN_FROZEN) == HEAP_XMIN_FROZEN)
+			;
+		else if ((infomask & HEAP_XMIN_INVALID) != 0 ||
+				 !__xact_visible_committed(xvis,
+										   htup->t_choice.t_heap.t_xmin,
+										   (infomask & HEAP_XMIN_COMMITTED) != 0))
+		{
+			ItemIdSetUnused(lpp);
+			continue;
+		}
+		/* deleter must not be committed or visible */
+		if ((infomask & (HEAP_XMAX_INVALID | HEAP_XMAX_IS_MULTI)) != 0 ||
+			HEAP_XMAX_IS_LOCKED_ONLY(infomask))
+			continue;
+		if (__xact_visible_committed(xvis,
+									 htup->t_choice.t_heap.t_xmax,
+									 (infomask & HEAP_XMAX_COMMITTED) != 0))
+			ItemIdSetUnused(lpp);
+	}
+}
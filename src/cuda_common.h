@@ -602,6 +602,19 @@ typedef struct {
 #define HEAP_COMBOCID			0x0020	/* t_cid is a combo cid */
 #define HEAP_XMAX_EXCL_LOCK		0x0040	/* xmax is exclusive locker */
 #define HEAP_XMAX_LOCK_ONLY		0x0080	/* xmax, if valid, is only a locker */
+#define HEAP_XMAX_SHR_LOCK		(HEAP_XMAX_EXCL_LOCK | HEAP_XMAX_KEYSHR_LOCK)
+#define HEAP_LOCK_MASK			(HEAP_XMAX_SHR_LOCK | HEAP_XMAX_EXCL_LOCK | \
+								 HEAP_XMAX_KEYSHR_LOCK)
+#define HEAP_XMIN_COMMITTED		0x0100	/* t_xmin committed */
+#define HEAP_XMIN_INVALID		0x0200	/* t_xmin invalid/aborted */
+#define HEAP_XMIN_FROZEN		(HEAP_XMIN_COMMITTED|HEAP_XMIN_INVALID)
+#define HEAP_XMAX_COMMITTED		0x0400	/* t_xmax committed */
+#define HEAP_XMAX_INVALID		0x0800	/* t_xmax invalid/aborted */
+#define HEAP_XMAX_IS_MULTI		0x1000	/* t_xmax is a MultiXactId */
+
+#define HEAP_XMAX_IS_LOCKED_ONLY(infomask)						\
+	(((infomask) & HEAP_XMAX_LOCK_ONLY) != 0 ||					\
+	 ((infomask) & (HEAP_XMAX_IS_MULTI | HEAP_LOCK_MASK)) == HEAP_XMAX_EXCL_LOCK)
 
 /*
  * information stored in t_infomask2:
@@ -620,6 +633,8 @@ typedef struct {
  * visible to the current scan snapshot.
  */
 typedef cl_uint		TransactionId;
+#define InvalidTransactionId		((TransactionId) 0)
+#define FirstNormalTransactionId	((TransactionId) 3)
 
 /* definitions at storage/itemid.h */
 typedef struct ItemIdData
@@ -731,8 +746,8 @@ PageGetMaxOffsetNumber(PageHeaderData *page)
  * | <slot format> | <row format> / <hash format> | <block format> |
  * +---------------+------------------------------+----------------+
  * | values/isnull | Offset to the first hash-    | BlockNumber of |
- * | pair of the   | item for each slot (*).      | PostgreSQL;    |
- * | 1st tuple     |                              | used to setup  |
+ * | pair of the   | item and fingerprints for    | PostgreSQL;    |
+ * | 1st tuple     | each slot (*).               | used to setup  |
  * | +-------------+ (*) nslots=0 if row-format,  | ctid system    |
  * | | values[0]   | thus, it has no offset to    | column.        |
  * | |    :        | hash items.                  |                |
@@ -819,6 +834,14 @@ typedef struct {
 	cl_uint			values_length;
 	cl_uint			extra_offset;
 	cl_uint			extra_length;
+	/*
+	 * (only arrow format)
+	 * @dict_offset and @dict_length point the offset array of dictionary,
+	 * if dictionary-encoded. In this case, @values_XXX points the index
+	 * array, and @extra_XXX points the body of the dictionary.
+	 */
+	cl_uint			dict_offset;
+	cl_uint			dict_length;
 
 	/*
 	 * (only column format)
@@ -852,6 +875,25 @@ typedef struct
 	kern_tupitem		t;		/* HeapTuple of this entry */
 } kern_hashitem;
 
+/*
+ * kern_hashslot - individual slot for KDS_FORMAT_HASH
+ *
+ * Each slot keeps a bitmap of 5-bit fingerprints (upper bits of the hash
+ * value) of the items linked to the slot, next to the offset of the first
+ * item. So, most of probes with no matched hash value are rejected by only
+ * one 64bit load of the slot, without walking on the hash-item chain.
+ */
+typedef union
+{
+	cl_ulong			value;
+	struct {
+		cl_uint			first;	/* offset of the first item (PACKED) */
+		cl_uint			tags;	/* bitmap of fingerprints */
+	} s;
+} kern_hashslot;
+
+#define KERN_HASH_FINGERPRINT(hash)		(1U << ((cl_uint)(hash) >> 27))
+
 #define KDS_FORMAT_ROW			1
 #define KDS_FORMAT_SLOT			2
 #define KDS_FORMAT_HASH			3	/* inner hash table for GpuHashJoin */
@@ -937,7 +979,7 @@ __kds_unpack(cl_uint offset)
 #define KDS_ESTIMATE_HASH_LENGTH(ncols,nitems,htup_sz)					\
 	(KDS_ESTIMATE_HEAD_LENGTH(ncols) +									\
 	 STROMALIGN(sizeof(cl_uint) * (nitems)) +							\
-	 STROMALIGN(sizeof(cl_uint) * __KDS_NSLOTS(nitems)) +				\
+	 STROMALIGN(sizeof(kern_hashslot) * __KDS_NSLOTS(nitems)) +		\
 	 STROMALIGN(MAXALIGN(offsetof(kern_hashitem,						\
 								  t.htup) + htup_sz) * (nitems)))
 
@@ -965,12 +1007,12 @@ KERN_DATA_STORE_ROWINDEX(kern_data_store *kds)
 }
 
 /* access function for hash-format */
-STATIC_INLINE(cl_uint *)
+STATIC_INLINE(kern_hashslot *)
 KERN_DATA_STORE_HASHSLOT(kern_data_store *kds)
 {
 	Assert(kds->format == KDS_FORMAT_HASH);
-	return (cl_uint *)(KERN_DATA_STORE_BODY(kds) +
-					   STROMALIGN(sizeof(cl_uint) * kds->nitems));
+	return (kern_hashslot *)(KERN_DATA_STORE_BODY(kds) +
+							 STROMALIGN(sizeof(cl_uint) * kds->nitems));
 }
 
 /* access function for row- and hash-format */
@@ -1010,9 +1052,14 @@ KDS_ROW_REF_HTUP(kern_data_store *kds,
 STATIC_INLINE(kern_hashitem *)
 KERN_HASH_FIRST_ITEM(kern_data_store *kds, cl_uint hash)
 {
-	cl_uint	   *slot = KERN_DATA_STORE_HASHSLOT(kds);
-	size_t		offset = __kds_unpack(slot[hash % kds->nslots]);
+	kern_hashslot  *slot = KERN_DATA_STORE_HASHSLOT(kds);
+	kern_hashslot	curr;
+	size_t			offset;
 
+	curr.value = slot[hash % kds->nslots].value;
+	if ((curr.s.tags & KERN_HASH_FINGERPRINT(hash)) == 0)
+		return NULL;
+	offset = __kds_unpack(curr.s.first);
 	if (offset == 0)
 		return NULL;
 	Assert(offset < kds->length);
@@ -1115,6 +1162,33 @@ KDS_BLOCK_REF_HTUP(kern_data_store *kds,
 	return (HeapTupleHeaderData *)PageGetItem(pg_page, lpp);
 }
 
+/*
+ * kern_xact_visibility
+ *
+ * Snapshot and commit status of the transactions, for MVCC visibility checks
+ * on the raw blocks which are not all-visible. Commit status of the xids in
+ * [xid_base, xmax) follows the sorted in-progress xids as a bitmap.
+ */
+typedef struct
+{
+	size_t			length;		/* length of this structure */
+	TransactionId	xmin;		/* snapshot->xmin */
+	TransactionId	xmax;		/* snapshot->xmax */
+	TransactionId	xid_base;	/* relfrozenxid of the relation */
+	cl_uint			xcnt;		/* number of in-progress xids */
+	TransactionId	xip[FLEXIBLE_ARRAY_MEMBER];
+} kern_xact_visibility;
+
+#define KERN_XACT_VISIBILITY_BITMAP(xvis)		\
+	((cl_uchar *)((xvis)->xip + (xvis)->xcnt))
+
+#ifdef __CUDACC__
+KERNEL_FUNCTION(void)
+kern_heap_visibility_check(kern_data_store *kds,
+						   kern_xact_visibility *xvis,
+						   cl_uint block_base);
+#endif	/* __CUDACC__ */
+
 /* access functions for apache arrow format */
 STATIC_INLINE(void *)
 kern_fetch_simple_datum_arrow(kern_colmeta *cmeta,
@@ -1160,6 +1234,13 @@ kern_fetch_varlena_datum_arrow(kern_colmeta *cmeta,
 		   sizeof(cl_uint) * (index+1) <= __kds_unpack(cmeta->values_length));
 	offset = (cl_uint *)(base + __kds_unpack(cmeta->values_offset));
 	extra = base + __kds_unpack(cmeta->extra_offset);
+	if (cmeta->dict_offset)
+	{
+		/* dictionary-encoded; values array has index of the dictionary */
+		index = offset[index];
+		Assert(sizeof(cl_uint) * (index+1) < __kds_unpack(cmeta->dict_length));
+		offset = (cl_uint *)(base + __kds_unpack(cmeta->dict_offset));
+	}
 
 	Assert(offset[index] <= offset[index+1] &&
 		   offset[index+1] <= __kds_unpack(cmeta->extra_length));
@@ -1747,6 +1828,54 @@ kern_get_datum_column(kern_data_store *kds,
 	return (void *)values;
 }
 
+/*
+ * Bucket of the histogram for pgstrom.approx_percentile
+ *
+ * A positive value X is put on the bucket 'i' if GAMMA^(i-1) < X <= GAMMA^i,
+ * so the representative value of the bucket has relative error less than
+ * (GAMMA-1)/(GAMMA+1). Negative values are mirrored, and zero is bucket-0.
+ * The bucket index is monotonic to the value, thus buckets can be walked
+ * in the order of the value.
+ */
+#define APPROX_PERCENTILE_GAMMA		1.02
+#define APPROX_PERCENTILE_NBUCKETS	2048
+#define APPROX_PERCENTILE_MAX_INDEX	(2 * APPROX_PERCENTILE_NBUCKETS + 1)
+
+STATIC_INLINE(cl_int)
+approx_percentile_bucket(cl_double value)
+{
+	cl_double	mag = (value < 0.0 ? -value : value);
+	cl_double	lg;
+	cl_int		index;
+
+	if (value != value)
+		return APPROX_PERCENTILE_MAX_INDEX;		/* NaN is the largest */
+	if (mag == 0.0)
+		return 0;
+	lg = ceil(log(mag) / log(APPROX_PERCENTILE_GAMMA));
+	if (lg < -(cl_double)APPROX_PERCENTILE_NBUCKETS)
+		lg = -(cl_double)APPROX_PERCENTILE_NBUCKETS;
+	else if (lg > (cl_double)APPROX_PERCENTILE_NBUCKETS)
+		lg = (cl_double)APPROX_PERCENTILE_NBUCKETS;
+	index = (cl_int)lg + APPROX_PERCENTILE_NBUCKETS + 1;
+
+	return (value < 0.0 ? -index : index);
+}
+
+STATIC_INLINE(cl_double)
+approx_percentile_value(cl_int bucket)
+{
+	cl_int		index = (bucket < 0 ? -bucket : bucket);
+	cl_double	value;
+
+	if (bucket == 0)
+		return 0.0;
+	value = (2.0 * pow(APPROX_PERCENTILE_GAMMA,
+					   (cl_double)(index - APPROX_PERCENTILE_NBUCKETS - 1)) /
+			 (APPROX_PERCENTILE_GAMMA + 1.0));
+	return (bucket < 0 ? -value : value);
+}
+
 /* base type definitions and templates */
 #include "cuda_basetype.h"
 /* numeric functions support (must be here) */
@@ -27,11 +27,18 @@ static __shared__ cl_int	base_depth;
 static __shared__ cl_uint	src_read_pos;
 static __shared__ cl_uint	dst_base_index;
 static __shared__ size_t	dst_base_usage;
+static __shared__ kern_data_store *dst_kds_curr;
 extern __shared__ cl_uint	wip_count[0];	/* [GPUJOIN_MAX_DEPTH+1] items */
 extern __shared__ cl_uint	read_pos[0];	/* [GPUJOIN_MAX_DEPTH+1] items */
 extern __shared__ cl_uint	write_pos[0];	/* [GPUJOIN_MAX_DEPTH+1] items */
 static __shared__ cl_uint	stat_source_nitems;
 extern __shared__ cl_uint	stat_nitems[0];	/* [GPUJOIN_MAX_DEPTH+1] items */
+/* window of the candidate inner rows per outer row, if sorted NestLoop */
+static __shared__ cl_int	nl_window_depth;
+static __shared__ cl_uint	nl_window_rpos;
+static __shared__ cl_uint	nl_window_width;
+static __shared__ cl_uint	nl_window_lo[MAXTHREADS_PER_BLOCK];
+static __shared__ cl_uint	nl_window_hi[MAXTHREADS_PER_BLOCK];
 
 /*
  * gpujoin_suspend_context
@@ -157,12 +164,59 @@ gpujoin_rewind_stack(kern_gpujoin *kgjoin, cl_int depth,
 	return depth;
 }
 
+/*
+ * gpujoin_check_bloom_filter
+ *
+ * It checks whether the outer row may match with any inner rows, using
+ * the bloom filter of the inner hash tables. Only the depth whose hash
+ * keys reference the outer relation alone has bloom filter, so we can
+ * compute the hash value from the source row.
+ */
+STATIC_FUNCTION(cl_bool)
+gpujoin_check_bloom_filter(kern_context *kcxt,
+						   kern_multirels *kmrels,
+						   kern_data_store *kds_src,
+						   cl_uint t_offset)
+{
+	cl_int		depth, nrels = __ldg(&kmrels->nrels);
+
+	for (depth=1; depth <= nrels; depth++)
+	{
+		cl_uint	   *bloom = KERN_MULTIRELS_BLOOM_FILTER(kmrels, depth);
+		cl_uint		nbits;
+		cl_uint		hash;
+		cl_uint		k;
+		cl_bool		is_null_keys;
+
+		if (!bloom)
+			continue;
+		nbits = __ldg(&kmrels->chunks[depth-1].bloom_nbits);
+		hash = gpujoin_hash_value(kcxt,
+								  kds_src,
+								  kmrels,
+								  depth,
+								  &t_offset,
+								  &is_null_keys);
+		/* MEMO: NULL-keys will never match to inner-join */
+		if (is_null_keys)
+			return false;
+		k = KERN_BLOOM_FILTER_BIT1(hash, nbits);
+		if ((__ldg(&bloom[k >> 5]) & (1U << (k & 31))) == 0)
+			return false;
+		k = KERN_BLOOM_FILTER_BIT2(hash, nbits);
+		if ((__ldg(&bloom[k >> 5]) & (1U << (k & 31))) == 0)
+			return false;
+	}
+	return true;
+}
+
 /*
  * gpujoin_load_source
  */
 STATIC_FUNCTION(cl_int)
 gpujoin_load_source(kern_context *kcxt,
 					kern_gpujoin *kgjoin,
+					kern_multirels *kmrels,
 					kern_data_store *kds_src,
 					cl_uint *wr_stack,
 					cl_uint *l_state)
@@ -266,6 +320,9 @@ gpujoin_load_source(kern_context *kcxt,
 		}
 		assert(wip_count[0] == 0);
 	}
+	/* drop outer rows which never match, by the bloom filter */
+	if (visible)
+		visible = gpujoin_check_bloom_filter(kcxt, kmrels, kds_src, t_offset);
 	/* error checks */
 	if (__syncthreads_count(kcxt->errcode) > 0)
 		return -1;
@@ -505,25 +562,44 @@ gpujoin_projection_row(kern_context *kcxt,
 			} i;
 			cl_ulong	v64;
 		} oldval, curval, newval;
+		kern_data_store *kds_curr;
+		cl_uint		curr_chain;
 
 		needs_suspend = 0;
-		curval.i.nitems	= kds_dst->nitems;
-		curval.i.usage	= kds_dst->usage;
+	retry:
+		/*
+		 * Pick up the current destination buffer; kds_dst itself or one of
+		 * the overflow buffers pre-allocated by the host code.
+		 */
+		curr_chain = *((volatile cl_uint *)&kgjoin->dst_curr_chain);
+		kds_curr = (curr_chain == 0
+					? kds_dst
+					: (kern_data_store *)kgjoin->dst_chains[curr_chain-1]);
+		curval.i.nitems	= kds_curr->nitems;
+		curval.i.usage	= kds_curr->usage;
 		do {
 			newval = oldval = curval;
 			newval.i.nitems	+= nvalids;
 			newval.i.usage	+= __kds_packed(count);
 
-			if (KERN_DATA_STORE_HEAD_LENGTH(kds_dst) +
+			if (KERN_DATA_STORE_HEAD_LENGTH(kds_curr) +
 				STROMALIGN(sizeof(cl_uint) * newval.i.nitems) +
-				__kds_unpack(newval.i.usage) > kds_dst->length)
+				__kds_unpack(newval.i.usage) > kds_curr->length)
 			{
+				/* switch to the next overflow buffer, if any */
+				if (curr_chain < kgjoin->dst_nchains)
+				{
+					atomicCAS(&kgjoin->dst_curr_chain,
+							  curr_chain, curr_chain + 1);
+					goto retry;
+				}
 				needs_suspend = 1;
 				break;
 			}
-		} while ((curval.v64 = atomicCAS((cl_ulong *)&kds_dst->nitems,
+		} while ((curval.v64 = atomicCAS((cl_ulong *)&kds_curr->nitems,
 										 oldval.v64,
 										 newval.v64)) != oldval.v64);
+		dst_kds_curr = kds_curr;
 		dst_base_index = oldval.i.nitems;
 		dst_base_usage = __kds_unpack(oldval.i.usage);
 	}
@@ -533,6 +609,7 @@ gpujoin_projection_row(kern_context *kcxt,
 		gpujoin_suspend_context(kgjoin, nrels+1, l_state, matched);
 		return -2;	/* <-- not to update statistics */
 	}
+	kds_dst = dst_kds_curr;
 	dest_index = dst_base_index + get_local_id();
 	dest_offset += dst_base_usage + required;
 
@@ -733,6 +810,45 @@ gpujoin_projection_slot(kern_context *kcxt,
 	return nrels + 1;
 }
 
+/*
+ * gpujoin_nestloop_search
+ *
+ * It looks up the first inner row where the lower bound qualifiers get
+ * true (is_upper = false), or the first one where the upper bound
+ * qualifiers get false (is_upper = true), by binary search on the inner
+ * rows sorted by the nestloop key.
+ */
+STATIC_FUNCTION(cl_uint)
+gpujoin_nestloop_search(kern_context *kcxt,
+						kern_data_store *kds_src,
+						kern_multirels *kmrels,
+						cl_int depth,
+						cl_uint *x_buffer,
+						cl_uint head,
+						cl_bool is_upper)
+{
+	kern_data_store *kds_in = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
+	cl_uint		tail = kmrels->chunks[depth-1].sorted_nitems;
+
+	while (head < tail)
+	{
+		cl_uint			curr = head + (tail - head) / 2;
+		kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds_in, curr);
+
+		if (gpujoin_nestloop_bound(kcxt,
+								   kds_src,
+								   kmrels,
+								   depth,
+								   x_buffer,
+								   &tupitem->htup,
+								   is_upper) == is_upper)
+			head = curr + 1;
+		else
+			tail = curr;
+	}
+	return head;
+}
+
 /*
  * gpujoin_exec_nestloop
  */
@@ -754,9 +870,12 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 	cl_uint			x_unitsz;
 	cl_uint			y_unitsz;
 	cl_uint			x_index;	/* outer index */
+	cl_uint			x_local;
 	cl_uint			y_index;	/* inner index */
+	cl_uint			y_limit;
 	cl_uint			wr_index;
 	cl_uint			count;
+	cl_bool			is_sorted = KERN_MULTIRELS_SORTED_NESTLOOP(kmrels, depth);
 	cl_bool			result = false;
 	__shared__ cl_bool matched_sync[MAXTHREADS_PER_BLOCK];
 
@@ -788,9 +907,106 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 
 	x_index = get_local_id() % x_unitsz;
 	y_index = get_local_id() / x_unitsz;
+	x_local = x_index;
 
-	if (y_unitsz * l_state[depth] >= kds_in->nitems)
+	/*
+	 * If inner rows are sorted by the nestloop key, each outer row of the
+	 * current unit looks up the window of the candidate inner rows by
+	 * binary search, instead of the cross-product with all the inner rows.
+	 * The windows on the shared memory may be overwritten by the other
+	 * sorted depth, or lost by suspend/resume, so they are built again
+	 * unless the tag matches.
+	 */
+	if (is_sorted)
 	{
+		if (l_state[depth] == 0 ||
+			nl_window_depth != depth ||
+			nl_window_rpos != read_pos[depth-1])
+		{
+			__syncthreads();
+			if (get_local_id() == 0)
+			{
+				nl_window_depth = depth;
+				nl_window_rpos = read_pos[depth-1];
+				nl_window_width = 0;
+			}
+			__syncthreads();
+			if (get_local_id() < x_unitsz)
+			{
+				cl_uint		x_pos = read_pos[depth-1] + get_local_id();
+				cl_uint		lo = 0;
+				cl_uint		hi = 0;
+
+				if (x_pos < write_pos[depth-1])
+				{
+					lo = gpujoin_nestloop_search(kcxt, kds_src, kmrels, depth,
+												 rd_stack + x_pos * depth,
+												 0, false);
+					hi = gpujoin_nestloop_search(kcxt, kds_src, kmrels, depth,
+												 rd_stack + x_pos * depth,
+												 lo, true);
+				}
+				nl_window_lo[get_local_id()] = lo;
+				nl_window_hi[get_local_id()] = hi;
+				atomicMax(&nl_window_width, hi - lo);
+			}
+			__syncthreads();
+		}
+		y_limit = nl_window_width;
+	}
+	else
+		y_limit = kds_in->nitems;
+
+	if (y_unitsz * l_state[depth] >= y_limit)
+	{
+		/*
+		 * In case of SEMI or ANTI JOIN, the outer combinations are emitted
+		 * here according to whether it had any matched inner tuples.
+		 */
+		if (KERN_MULTIRELS_SEMI_JOIN(kmrels, depth) ||
+			KERN_MULTIRELS_ANTI_JOIN(kmrels, depth))
+		{
+			cl_bool		is_semi = KERN_MULTIRELS_SEMI_JOIN(kmrels, depth);
+			cl_uint		x_local = x_index;
+
+			if (get_local_id() < x_unitsz)
+				matched_sync[get_local_id()] = false;
+			__syncthreads();
+			if (matched[depth])
+				matched_sync[x_local] = true;
+			__syncthreads();
+			x_index += read_pos[depth-1];
+			if (y_index == 0 && x_index < write_pos[depth-1])
+				result = (is_semi
+						  ? matched_sync[x_local]
+						  : !matched_sync[x_local]);
+			rd_stack += (x_index * depth);
+
+			wr_index = write_pos[depth];
+			wr_index += pgstromStairlikeBinaryCount(result, &count);
+			if (get_local_id() == 0)
+			{
+				wip_count[depth] = 0;
+				write_pos[depth] += count;
+				stat_nitems[depth] += count;
+				read_pos[depth-1] += x_unitsz;
+			}
+			wr_stack += wr_index * (depth + 1);
+			if (result)
+			{
+				memcpy(wr_stack, rd_stack, sizeof(cl_uint) * depth);
+				wr_stack[depth] = 0;
+			}
+			l_state[depth] = 0;
+			matched[depth] = false;
+			__syncthreads();
+			wr_index = write_pos[depth];
+			__syncthreads();
+			if (wr_index + get_local_size() <= kgjoin->pstack_nrooms)
+				return depth;
+			return depth + 1;
+		}
+
 		/*
 		 * In case of LEFT OUTER JOIN, we need to check whether the outer
 		 * combination had any matched inner tuples, or not.
@@ -831,7 +1047,12 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 	if (x_index < write_pos[depth-1] && y_index < y_unitsz)
 	{
 		y_index += y_unitsz * l_state[depth];
-		if (y_index < kds_in->nitems)
+		if (is_sorted)
+		{
+			y_index += nl_window_lo[x_local];
+			y_limit = nl_window_hi[x_local];
+		}
+		if (y_index < y_limit)
 		{
 			tupitem = KERN_DATA_STORE_TUPITEM(kds_in, y_index);
 
@@ -848,6 +1069,10 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 				if (oj_map && !oj_map[y_index])
 					oj_map[y_index] = true;
 			}
+			/* SEMI/ANTI JOIN emits outer rows at the end of inner scan */
+			if (KERN_MULTIRELS_SEMI_JOIN(kmrels, depth) ||
+				KERN_MULTIRELS_ANTI_JOIN(kmrels, depth))
+				result = false;
 		}
 	}
 	l_state[depth]++;
@@ -956,7 +1181,8 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 											&is_null_keys);
 			/* MEMO: NULL-keys will never match to inner-join */
 			if (!is_null_keys)
-				khitem = KERN_HASH_FIRST_ITEM(kds_hash, hash_value);
+				khitem = KERN_MULTIRELS_HASH_FIRST_ITEM(kmrels, depth,
+														hash_value);
 			/* rewind the varlena buffer */
 			kcxt->vlpos = kcxt->vlbuf;
 		}
@@ -1009,12 +1235,29 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 		}
 		t_offset = __kds_packed((char *)&khitem->t.htup -
 								(char *)kds_hash);
+
+		/*
+		 * SEMI JOIN emits the outer row on the first match, and ANTI JOIN
+		 * never emits the outer row once matched. In both cases, we don't
+		 * need to walk on the hash-slot chain any more.
+		 */
+		if (joinquals_matched &&
+			(KERN_MULTIRELS_SEMI_JOIN(kmrels, depth) ||
+			 KERN_MULTIRELS_ANTI_JOIN(kmrels, depth)))
+		{
+			result = KERN_MULTIRELS_SEMI_JOIN(kmrels, depth);
+			t_offset = UINT_MAX;
+			khitem = NULL;
+		}
+		else if (KERN_MULTIRELS_ANTI_JOIN(kmrels, depth))
+			result = false;
 	}
-	else if (KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth) &&
+	else if ((KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth) ||
+			  KERN_MULTIRELS_ANTI_JOIN(kmrels, depth)) &&
 			 l_state[depth] != UINT_MAX &&
 			 !matched[depth])
 	{
-		/* No matched outer rows, but LEFT/FULL OUTER */
+		/* No matched outer rows, but LEFT/FULL OUTER or ANTI */
 		result = true;
 	}
 	else
@@ -1059,6 +1302,22 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 	return depth+1;
 }
 
+/*
+ * gpujoin_copy_pseudo_stack
+ *
+ * It copies the pseudo-stack of the block between the shared memory and
+ * the global memory, on suspend / resume of GPU kernel.
+ */
+STATIC_FUNCTION(void)
+gpujoin_copy_pseudo_stack(cl_uint *dst, const cl_uint *src, cl_uint nitems)
+{
+	cl_uint		i;
+
+	for (i=get_local_id(); i < nitems; i+=get_local_size())
+		dst[i] = src[i];
+	__syncthreads();
+}
+
 #define PSTACK_DEPTH(d)							\
 	((d) >= 0 && (d) <= kgjoin->num_rels		\
 	 ? (pstack_base + pstack_nrooms * ((d) * ((d) + 1)) / 2) : NULL)
@@ -1073,6 +1332,7 @@ gpujoin_main(kern_context *kcxt,
 			 kern_data_store *kds_src,
 			 kern_data_store *kds_dst,
 			 kern_parambuf *kparams_gpreagg, /* only if combined GpuJoin */
+			 cl_uint *pstack_shmem,			/* only if shared pstack */
 			 cl_uint *l_state,
 			 cl_bool *matched)
 {
@@ -1080,7 +1340,9 @@ gpujoin_main(kern_context *kcxt,
 	cl_int			depth;
 	cl_int			index;
 	cl_uint			pstack_nrooms;
+	cl_uint			pstack_length;
 	cl_uint		   *pstack_base;
+	cl_uint		   *pstack_global;
 	__shared__ cl_int depth_thread0 __attribute__((unused));
 
 	assert(__ldg(&kds_src->format) == KDS_FORMAT_ROW ||
@@ -1091,9 +1353,11 @@ gpujoin_main(kern_context *kcxt,
 
 	/* setup private variables */
 	pstack_nrooms = kgjoin->pstack_nrooms;
-	pstack_base = (cl_uint *)((char *)kgjoin + kgjoin->pstack_offset)
-		+ get_group_id() * pstack_nrooms * ((max_depth+1) *
-											(max_depth+2)) / 2;
+	pstack_length = KERN_GPUJOIN_PSEUDO_STACK_LENGTH(pstack_nrooms,
+													 max_depth);
+	pstack_global = (cl_uint *)((char *)kgjoin + kgjoin->pstack_offset)
+		+ get_group_id() * pstack_length;
+	pstack_base = (pstack_shmem ? pstack_shmem : pstack_global);
 	/* init per-depth context */
 	memset(l_state, 0, sizeof(l_state));
 	memset(matched, 0, sizeof(matched));
@@ -1107,6 +1371,7 @@ gpujoin_main(kern_context *kcxt,
 		memset(write_pos, 0, sizeof(cl_uint) * (max_depth+1));
 		scan_done = false;
 		base_depth = 0;
+		nl_window_depth = -1;
 	}
 	/* resume the per-depth context, if any */
 	if (kgjoin->resume_context)
@@ -1114,6 +1379,9 @@ gpujoin_main(kern_context *kcxt,
 	else
 		depth = 0;
 	__syncthreads();
+	/* restore the pseudo-stack on the shared memory, if any */
+	if (pstack_shmem && kgjoin->resume_context)
+		gpujoin_copy_pseudo_stack(pstack_shmem, pstack_global, pstack_length);
 
 	/* main logic of GpuJoin */
 	while (depth >= 0)
@@ -1125,6 +1393,7 @@ gpujoin_main(kern_context *kcxt,
 			/* LOAD FROM KDS_SRC (ROW/BLOCK/ARROW) */
 			depth = gpujoin_load_source(kcxt,
 										kgjoin,
+										kmrels,
 										kds_src,
 										PSTACK_DEPTH(depth),
 										l_state);
@@ -1191,6 +1460,10 @@ gpujoin_main(kern_context *kcxt,
 		assert(depth_thread0 == depth);
 	}
 
+	/* save the pseudo-stack on the shared memory, if suspended */
+	if (pstack_shmem && depth == -2)
+		gpujoin_copy_pseudo_stack(pstack_global, pstack_shmem, pstack_length);
+
 	/* update statistics only if normal exit */
 	if (depth == -1 && get_local_id() == 0)
 	{
@@ -1207,6 +1480,70 @@ gpujoin_main(kern_context *kcxt,
 	__syncthreads();
 }
 
+/*
+ * gpujoin_build_hash_table
+ *
+ * It calculates hash value of the inner rows loaded in KDS_FORMAT_HASH,
+ * then links them to the hash slots. Host side set up nslots and zero-
+ * cleared hash slots (and bloom filter, if any) prior to the kernel.
+ */
+DEVICE_FUNCTION(void)
+gpujoin_build_hash_table(kern_context *kcxt,
+						 kern_multirels *kmrels,
+						 cl_int depth)
+{
+	kern_data_store *kds_hash = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
+	cl_uint	   *row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
+	kern_hashslot *hash_slot = KERN_DATA_STORE_HASHSLOT(kds_hash);
+	cl_uint	   *bloom = KERN_MULTIRELS_BLOOM_FILTER(kmrels, depth);
+	cl_uint		nbits = kmrels->chunks[depth-1].bloom_nbits;
+	cl_bool		right_outer = KERN_MULTIRELS_RIGHT_OUTER_JOIN(kmrels, depth);
+	cl_uint		i, k;
+
+	assert(kds_hash->format == KDS_FORMAT_HASH);
+	for (i = get_global_id();
+		 i < kds_hash->nitems;
+		 i += get_global_size())
+	{
+		kern_hashitem *khitem = (kern_hashitem *)
+			((char *)kds_hash
+			 + __kds_unpack(row_index[i])
+			 - offsetof(kern_hashitem, t));
+		cl_uint		hash;
+		cl_uint		offset;
+		cl_bool		is_null_keys;
+
+		hash = gpujoin_inner_hash_value(kcxt,
+										kmrels,
+										depth,
+										&khitem->t.htup,
+										&is_null_keys);
+		if (kcxt->errcode != ERRCODE_STROM_SUCCESS)
+			break;
+		khitem->hash = hash;
+		/*
+		 * NULL-keys never match to outer rows, so we don't link them unless
+		 * RIGHT/FULL OUTER JOIN picks up unmatched inner rows.
+		 */
+		if (is_null_keys && !right_outer)
+		{
+			khitem->next = 0;
+			continue;
+		}
+		offset = __kds_packed((char *)khitem - (char *)kds_hash);
+		k = hash % kds_hash->nslots;
+		khitem->next = atomicExch(&hash_slot[k].s.first, offset);
+		atomicOr(&hash_slot[k].s.tags, KERN_HASH_FINGERPRINT(hash));
+		if (bloom)
+		{
+			k = KERN_BLOOM_FILTER_BIT1(hash, nbits);
+			atomicOr(&bloom[k >> 5], (1U << (k & 31)));
+			k = KERN_BLOOM_FILTER_BIT2(hash, nbits);
+			atomicOr(&bloom[k >> 5], (1U << (k & 31)));
+		}
+	}
+}
+
 /*
  * gpujoin_collocate_outer_join_map
  *
@@ -1227,10 +1564,7 @@ gpujoin_colocate_outer_join_map(kern_multirels *kmrels,
 	{
 		map = 0;
 		for (j = 0; j <= num_devices; j++)
-		{
-			map |= ojmaps[i];
-			ojmaps += nrooms;
-		}
+			map |= ojmaps[j * nrooms + i];
 		destmap[i] = map;
 	}
 }
@@ -1245,6 +1579,7 @@ gpujoin_right_outer(kern_context *kcxt,
 					cl_int outer_depth,
 					kern_data_store *kds_dst,
 					kern_parambuf *kparams_gpreagg,
+					cl_uint *pstack_shmem,
 					cl_uint *l_state,
 					cl_bool *matched)
 {
@@ -1252,7 +1587,9 @@ gpujoin_right_outer(kern_context *kcxt,
 	cl_int			depth;
 	cl_int			index;
 	cl_uint			pstack_nrooms;
+	cl_uint			pstack_length;
 	cl_uint		   *pstack_base;
+	cl_uint		   *pstack_global;
 	__shared__ cl_int depth_thread0 __attribute__((unused));
 
 	assert(KERN_MULTIRELS_RIGHT_OUTER_JOIN(kmrels, outer_depth));
@@ -1260,9 +1597,11 @@ gpujoin_right_outer(kern_context *kcxt,
 		   (kds_dst->format == KDS_FORMAT_SLOT && kparams_gpreagg != NULL));
 	/* setup private variables */
 	pstack_nrooms = kgjoin->pstack_nrooms;
-	pstack_base = (cl_uint *)((char *)kgjoin + kgjoin->pstack_offset)
-		+ get_group_id() * pstack_nrooms * ((max_depth+1) *
-											(max_depth+2)) / 2;
+	pstack_length = KERN_GPUJOIN_PSEUDO_STACK_LENGTH(pstack_nrooms,
+													 max_depth);
+	pstack_global = (cl_uint *)((char *)kgjoin + kgjoin->pstack_offset)
+		+ get_group_id() * pstack_length;
+	pstack_base = (pstack_shmem ? pstack_shmem : pstack_global);
 	/* setup per-depth context */
 	memset(l_state, 0, sizeof(l_state));
 	memset(matched, 0, sizeof(matched));
@@ -1276,6 +1615,7 @@ gpujoin_right_outer(kern_context *kcxt,
 		memset(write_pos, 0, sizeof(cl_uint) * (max_depth+1));
 		scan_done = false;
 		base_depth = outer_depth;
+		nl_window_depth = -1;
 	}
 	/* resume the per-depth context, if any */
 	if (kgjoin->resume_context)
@@ -1283,6 +1623,9 @@ gpujoin_right_outer(kern_context *kcxt,
 	else
 		depth = outer_depth;
 	__syncthreads();
+	/* restore the pseudo-stack on the shared memory, if any */
+	if (pstack_shmem && kgjoin->resume_context)
+		gpujoin_copy_pseudo_stack(pstack_shmem, pstack_global, pstack_length);
 
 	/* main logic of GpuJoin */
 	while (depth >= outer_depth)
@@ -1360,6 +1703,10 @@ gpujoin_right_outer(kern_context *kcxt,
 			return;
 		assert(depth == depth_thread0);
 	}
+	/* save the pseudo-stack on the shared memory, if suspended */
+	if (pstack_shmem && depth == -2)
+		gpujoin_copy_pseudo_stack(pstack_global, pstack_shmem, pstack_length);
+
 	/* write out statistics */
 	if (get_local_id() == 0)
 	{
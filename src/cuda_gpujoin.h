@@ -32,10 +32,19 @@ typedef struct
 	{
 		cl_ulong	chunk_offset;	/* offset to KDS or Hash */
 		cl_ulong	ojmap_offset;	/* offset to outer-join map, if any */
+		cl_ulong	bloom_offset;	/* offset to bloom filter, if any */
+		cl_ulong	skew_offset;	/* offset to skew table, if any */
+		cl_uint		bloom_nbits;	/* width of bloom filter (2^N bits) */
+		cl_uint		skew_nitems;	/* number of heavy-hitter keys */
+		cl_uint		sorted_nitems;	/* number of inner rows sorted by the
+									 * nestloop key; NULLs are not counted */
 		cl_bool		is_nestloop;	/* true, if NestLoop. */
+		cl_bool		is_sorted;		/* true, if NestLoop on the sorted inner */
 		cl_bool		left_outer;		/* true, if JOIN_LEFT or JOIN_FULL */
 		cl_bool		right_outer;	/* true, if JOIN_RIGHT or JOIN_FULL */
-		cl_char		__padding__[5];
+		cl_bool		semi_join;		/* true, if JOIN_SEMI */
+		cl_bool		anti_join;		/* true, if JOIN_ANTI */
+		cl_char		__padding__[6];
 	} chunks[FLEXIBLE_ARRAY_MEMBER];
 } kern_multirels;
 
@@ -52,12 +61,95 @@ typedef struct
 					(size_t)(kmrels)->chunks[(depth)-1].ojmap_offset)	\
 				 : NULL))
 
+#define KERN_MULTIRELS_BLOOM_FILTER(kmrels, depth)				\
+	((cl_uint *)((kmrels)->chunks[(depth)-1].bloom_offset == 0	\
+				 ? NULL											\
+				 : ((char *)(kmrels) +							\
+					(size_t)(kmrels)->chunks[(depth)-1].bloom_offset)))
+
+/*
+ * Bloom filter of the inner hash table
+ *
+ * Host code sets two bits for each hash value of the inner keys, then
+ * GPU kernel drops outer rows prior to the join if either bit is not set.
+ * Width of the bloom filter is always 2^N bits.
+ */
+#define KERN_BLOOM_FILTER_BIT1(hash,nbits)				\
+	((cl_uint)(hash) & ((nbits) - 1))
+#define KERN_BLOOM_FILTER_BIT2(hash,nbits)				\
+	((((cl_uint)(hash) >> 16 | (cl_uint)(hash) << 16) *	\
+	  0x9e3779b1U) & ((nbits) - 1))
+
+/*
+ * Skew table of the inner hash table
+ *
+ * Inner rows of the heavy-hitter keys are linked to the dedicated chain of
+ * the skew table, instead of the hash slot, so probes by the other keys
+ * never walk on the long chain of the heavy-hitters. Host code detects
+ * the heavy-hitters by sampling, and entries are sorted by the hash value.
+ */
+typedef struct
+{
+	cl_uint		hash;		/* hash value of the heavy-hitter key */
+	cl_uint		first;		/* packed offset to the first hash item */
+} kern_skewitem;
+
+#define GPUJOIN_SKEW_MAX_NITEMS		64
+
+#define KERN_MULTIRELS_SKEW_TABLE(kmrels, depth)				\
+	((kern_skewitem *)((kmrels)->chunks[(depth)-1].skew_offset == 0	\
+					   ? NULL										\
+					   : ((char *)(kmrels) +						\
+						  (size_t)(kmrels)->chunks[(depth)-1].skew_offset)))
+
+STATIC_INLINE(kern_hashitem *)
+KERN_MULTIRELS_HASH_FIRST_ITEM(kern_multirels *kmrels, cl_int depth,
+							   cl_uint hash)
+{
+	kern_data_store *kds_hash = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
+	kern_skewitem  *skew = KERN_MULTIRELS_SKEW_TABLE(kmrels, depth);
+
+	if (skew)
+	{
+		cl_int		head = 0;
+		cl_int		tail = (cl_int)kmrels->chunks[depth-1].skew_nitems - 1;
+
+		/* binary search on the heavy-hitters */
+		while (head <= tail)
+		{
+			cl_int		curr = (head + tail) / 2;
+
+			if (skew[curr].hash == hash)
+			{
+				if (skew[curr].first == 0)
+					return NULL;
+				return (kern_hashitem *)
+					((char *)kds_hash + __kds_unpack(skew[curr].first));
+			}
+			if (skew[curr].hash < hash)
+				head = curr + 1;
+			else
+				tail = curr - 1;
+		}
+	}
+	return KERN_HASH_FIRST_ITEM(kds_hash, hash);
+}
+
 #define KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth)	\
 	__ldg(&((kmrels)->chunks[(depth)-1].left_outer))
 
 #define KERN_MULTIRELS_RIGHT_OUTER_JOIN(kmrels, depth)	\
 	__ldg(&((kmrels)->chunks[(depth)-1].right_outer))
 
+#define KERN_MULTIRELS_SEMI_JOIN(kmrels, depth)			\
+	__ldg(&((kmrels)->chunks[(depth)-1].semi_join))
+
+#define KERN_MULTIRELS_ANTI_JOIN(kmrels, depth)			\
+	__ldg(&((kmrels)->chunks[(depth)-1].anti_join))
+
+#define KERN_MULTIRELS_SORTED_NESTLOOP(kmrels, depth)	\
+	__ldg(&((kmrels)->chunks[(depth)-1].is_sorted))
+
 /*
  * kern_gpujoin - control object of GpuJoin
  *
@@ -79,8 +171,10 @@ typedef struct
  * The third segment is used to save the combination of joined rows as
  * intermediate results, performs like a pseudo-stack area. Individual SMs
  * have exclusive pseudo-stack, thus, can be utilized as a large but slow
- * shared memory. (If depth is low, we may be able to use the actual shared
- * memory instead.)
+ * shared memory. If depth is low, GPU kernel is built with
+ * GPUJOIN_SHARED_PSTACK_NROOMS, then the pseudo-stack is kept on the actual
+ * shared memory; the third segment is used only to save its contents when
+ * GPU kernel gets suspended.
  * The 4th segment is used to save the execution context when GPU kernel
  * gets suspended. Both of shared memory contents (e.g, read_pos, write_pos)
  * and thread's private variables (e.g, depth, l_state, matched) are saved,
@@ -92,6 +186,14 @@ typedef struct
  * buffer does not run out, thus, it shall not consume devuce physical pages
  * because we allocate the control segment using unified managed memory.
  */
+/*
+ * GPUJOIN_MAX_DST_CHAINS - max number of the pre-allocated overflow buffers
+ * of the destination buffer. GPU kernel switches the destination to the next
+ * overflow buffer by atomic operation when the current one gets full, and
+ * suspends itself only when all the overflow buffers are consumed.
+ */
+#define GPUJOIN_MAX_DST_CHAINS		8
+
 struct kern_gpujoin
 {
 	kern_errorbuf	kerror;				/* kernel error information */
@@ -107,6 +209,10 @@ struct kern_gpujoin
 	cl_uint			suspend_count;		/* number of suspended blocks */
 	cl_bool			resume_context;		/* resume context from suspend */
 	cl_uint			src_read_pos;		/* position to read from kds_src */
+	/* chain of the destination buffer (only KDS_FORMAT_ROW) */
+	cl_uint			dst_nchains;		/* number of overflow buffers */
+	cl_uint			dst_curr_chain;		/* out: # of overflow buffers used */
+	cl_ulong		dst_chains[GPUJOIN_MAX_DST_CHAINS]; /* kern_data_store */
 	/* error status to be backed (OUT) */
 	cl_uint			source_nitems;		/* out: # of source rows */
 	cl_uint			outer_nitems;		/* out: # of filtered source rows */
@@ -126,6 +232,7 @@ gpujoin_reset_kernel_task(kern_gpujoin *kgjoin, bool resume_context)
 	memset(&kgjoin->kerror, 0, sizeof(kern_errorbuf));
 	kgjoin->suspend_count	= 0;
 	kgjoin->resume_context	= resume_context;
+	kgjoin->dst_curr_chain	= 0;
 }
 #endif
 
@@ -159,6 +266,21 @@ typedef struct gpujoinSuspendContext	gpujoinSuspendContext;
 			   (char *)(kgjoin))
 #define KERN_GPUJOIN_PSEUDO_STACK(kgjoin)					\
 	((cl_uint *)((char *)(kgjoin) + (kgjoin)->pstack_offset))
+#define KERN_GPUJOIN_PSEUDO_STACK_LENGTH(nrooms,nrels)		\
+	((nrooms) * (((nrels) + 1) * ((nrels) + 2)) / 2)
+/*
+ * pseudo-stack on the shared memory, if depth is low enough
+ *
+ * Block size must be less than half of the pseudo-stack entries per depth,
+ * to keep room to write out the combination of rows by all the threads.
+ */
+#define GPUJOIN_SHARED_PSTACK_MAX_DEPTH		3
+#define GPUJOIN_SHARED_PSTACK_MAXSZ			(24 * 1024)
+#define GPUJOIN_SHARED_PSTACK_NROOMS_FOR(nrels)				\
+	((GPUJOIN_SHARED_PSTACK_MAXSZ /							\
+	  (sizeof(cl_uint) * KERN_GPUJOIN_PSEUDO_STACK_LENGTH(1,(nrels)))) & ~63U)
+#define GPUJOIN_PSTACK_MAX_BLOCK_SZ(nrooms)					\
+	Min(MAXTHREADS_PER_BLOCK, ((nrooms) / 2) & ~31U)
 #define KERN_GPUJOIN_SUSPEND_CONTEXT(kgjoin,group_id)		\
 	((struct gpujoinSuspendContext *)						\
 	 ((char *)(kgjoin) + (kgjoin)->suspend_offset +			\
@@ -207,6 +329,24 @@ gpujoin_join_quals(kern_context *kcxt,
 				   HeapTupleHeaderData *inner_htup,
 				   cl_bool *joinquals_matched);
 
+/*
+ * gpujoin_nestloop_bound
+ *
+ * Evaluation of the lower (is_upper = false) or upper (is_upper = true)
+ * bound qualifiers on the nestloop key, if inner rows of this depth are
+ * sorted by the key. Lower bound qualifiers are true on the tail of the
+ * sorted inner rows, and upper bound qualifiers are true on the head, so
+ * the candidate window of the outer row is found by binary search.
+ */
+DEVICE_FUNCTION(cl_bool)
+gpujoin_nestloop_bound(kern_context *kcxt,
+					   kern_data_store *kds,
+					   kern_multirels *kmrels,
+					   int depth,
+					   cl_uint *x_buffer,
+					   HeapTupleHeaderData *inner_htup,
+					   cl_bool is_upper);
+
 /*
  * gpujoin_hash_value
  *
@@ -220,6 +360,19 @@ gpujoin_hash_value(kern_context *kcxt,
 				   cl_uint *x_buffer,
 				   cl_bool *is_null_keys);
 
+/*
+ * gpujoin_inner_hash_value
+ *
+ * Calculation of hash value of the inner row, if hash table of this depth
+ * is built on the device.
+ */
+DEVICE_FUNCTION(cl_uint)
+gpujoin_inner_hash_value(kern_context *kcxt,
+						 kern_multirels *kmrels,
+						 cl_int depth,
+						 HeapTupleHeaderData *i_htup,
+						 cl_bool *is_null_keys);
+
 /*
  * gpujoin_projection
  *
@@ -245,8 +398,16 @@ gpujoin_main(kern_context *kcxt,
 			 kern_data_store *kds_src,
 			 kern_data_store *kds_dst,
 			 kern_parambuf *kparams_gpreagg,		/* only if combined Join */
+			 cl_uint *pstack_shmem,					/* only if shared pstack */
 			 cl_uint *l_state,
 			 cl_bool *matched);
+/*
+ * gpujoin_build_hash_table - construction of the inner hash table
+ */
+DEVICE_FUNCTION(void)
+gpujoin_build_hash_table(kern_context *kcxt,
+						 kern_multirels *kmrels,
+						 cl_int depth);
 /*
  * gpujoin_right_outer - main logic for right-outer-join
  */
@@ -257,6 +418,7 @@ gpujoin_right_outer(kern_context *kcxt,
 					cl_int outer_depth,
 					kern_data_store *kds_dst,
 					kern_parambuf *kparams_gpreagg, /* only if combined Join */
+					cl_uint *pstack_shmem,			/* only if shared pstack */
 					cl_uint *l_state,
 					cl_bool *matched);
 #endif	/* __CUDACC__ */
@@ -269,6 +431,13 @@ __shared__ cl_uint   wip_count[GPUJOIN_MAX_DEPTH+1];
 __shared__ cl_uint   read_pos[GPUJOIN_MAX_DEPTH+1];
 __shared__ cl_uint   write_pos[GPUJOIN_MAX_DEPTH+1];
 __shared__ cl_uint   stat_nitems[GPUJOIN_MAX_DEPTH+1];
+#ifdef GPUJOIN_SHARED_PSTACK_NROOMS
+__shared__ cl_uint   pstack_shmem[KERN_GPUJOIN_PSEUDO_STACK_LENGTH(
+							GPUJOIN_SHARED_PSTACK_NROOMS, GPUJOIN_MAX_DEPTH)];
+#define GPUJOIN_PSTACK_SHMEM		pstack_shmem
+#else
+#define GPUJOIN_PSTACK_SHMEM		NULL
+#endif
 
 KERNEL_FUNCTION(void)
 kern_gpujoin_main(kern_gpujoin *kgjoin,
@@ -283,6 +452,9 @@ kern_gpujoin_main(kern_gpujoin *kgjoin,
 	DECL_KERNEL_CONTEXT(u);
 
 	assert(kgjoin->num_rels == GPUJOIN_MAX_DEPTH);
+#ifdef GPUJOIN_SHARED_PSTACK_NROOMS
+	assert(kgjoin->pstack_nrooms == GPUJOIN_SHARED_PSTACK_NROOMS);
+#endif
 	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
 	gpujoin_main(&u.kcxt,
 				 kgjoin,
@@ -290,6 +462,7 @@ kern_gpujoin_main(kern_gpujoin *kgjoin,
 				 kds_src,
 				 kds_dst,
 				 kparams_gpreagg,
+				 GPUJOIN_PSTACK_SHMEM,
 				 l_state,
 				 matched);
 	kern_writeback_error_status(&kgjoin->kerror, &u.kcxt);
@@ -308,6 +481,9 @@ kern_gpujoin_right_outer(kern_gpujoin *kgjoin,
 	DECL_KERNEL_CONTEXT(u);
 
 	assert(kgjoin->num_rels == GPUJOIN_MAX_DEPTH);
+#ifdef GPUJOIN_SHARED_PSTACK_NROOMS
+	assert(kgjoin->pstack_nrooms == GPUJOIN_SHARED_PSTACK_NROOMS);
+#endif
 	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
 	gpujoin_right_outer(&u.kcxt,
 						kgjoin,
@@ -315,11 +491,25 @@ kern_gpujoin_right_outer(kern_gpujoin *kgjoin,
 						outer_depth,
 						kds_dst,
 						kparams_gpreagg,
+						GPUJOIN_PSTACK_SHMEM,
 						l_state,
 						matched);
 	kern_writeback_error_status(&kgjoin->kerror, &u.kcxt);
 }
 
+KERNEL_FUNCTION(void)
+kern_gpujoin_build_hash_table(kern_multirels *kmrels,
+							  cl_int depth,
+							  kern_parambuf *kparams,
+							  kern_errorbuf *kerror)
+{
+	DECL_KERNEL_CONTEXT(u);
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
+	gpujoin_build_hash_table(&u.kcxt, kmrels, depth);
+	kern_writeback_error_status(kerror, &u.kcxt);
+}
+
 #ifndef GPUPREAGG_COMBINED_JOIN
 DEVICE_FUNCTION(void)
 gpupreagg_projection_slot(kern_context *kcxt_gpreagg,
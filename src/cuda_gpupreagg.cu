@@ -1236,6 +1236,183 @@ retry_fnext:
 	return !meet_locked;
 }
 
+/*
+ * gpupreagg_sample_groups
+ *
+ * It counts number of the distinct groups in the rows sampled from the
+ * kds_slot evenly, then chooses the reduction mode of the chunk.
+ * This function shall be launched with a single thread-block.
+ */
+DEVICE_FUNCTION(void)
+gpupreagg_sample_groups(kern_context *kcxt,
+						kern_gpupreagg *kgpreagg,		/* in/out */
+						kern_errorbuf *kgjoin_errorbuf,	/* in */
+						kern_data_store *kds_slot)		/* in */
+{
+	cl_uint			nitems = kds_slot->nitems;
+	cl_uint			nsamples = Min(nitems, GPUPREAGG_SAMPLE_NROWS);
+	cl_uint			i, k;
+	__shared__ cl_uint	l_hset[GPUPREAGG_SAMPLE_HASHSIZE];
+	__shared__ cl_uint	l_nvalids;
+	__shared__ cl_uint	l_ngroups;
+
+	/* skip if previous stage reported an error */
+	if (kgjoin_errorbuf &&
+		__syncthreads_count(kgjoin_errorbuf->errcode) != 0)
+		return;
+	if (__syncthreads_count(kgpreagg->kerror.errcode) != 0)
+		return;
+	assert(kgpreagg->num_group_keys > 0);
+	assert(kds_slot->format == KDS_FORMAT_SLOT);
+
+	for (i = get_local_id();
+		 i < GPUPREAGG_SAMPLE_HASHSIZE;
+		 i += get_local_size())
+		l_hset[i] = 0;
+	if (get_local_id() == 0)
+	{
+		l_nvalids = 0;
+		l_ngroups = 0;
+	}
+	__syncthreads();
+
+	for (i = get_local_id(); i < nsamples; i += get_local_size())
+	{
+		cl_uint		index = (cl_uint)(((cl_ulong)i * nitems) / nsamples);
+		cl_uint		hash_value;
+		cl_uint		curval;
+
+		hash_value = gpupreagg_hashvalue(kcxt,
+										 KERN_DATA_STORE_DCLASS(kds_slot,
+																index),
+										 KERN_DATA_STORE_VALUES(kds_slot,
+																index));
+		/* rows out of the current partition are never reduced */
+		if (kgpreagg->part_nbits > 0 &&
+			(hash_value >> (32 - kgpreagg->part_nbits)) !=
+			kgpreagg->part_index)
+			continue;
+		atomicAdd(&l_nvalids, 1);
+		/* 0 is a mark of empty slot */
+		if (hash_value == 0)
+			hash_value = 1;
+		k = hash_value % GPUPREAGG_SAMPLE_HASHSIZE;
+		for (;;)
+		{
+			curval = atomicCAS(&l_hset[k], 0, hash_value);
+			if (curval == 0)
+			{
+				atomicAdd(&l_ngroups, 1);
+				break;
+			}
+			if (curval == hash_value)
+				break;
+			k = (k + 1) % GPUPREAGG_SAMPLE_HASHSIZE;
+		}
+	}
+	__syncthreads();
+
+	if (get_local_id() == 0)
+	{
+		/*
+		 * NOTE: groups are counted by the hash values, so a few groups
+		 * may be merged by hash collision. It is harmless because the
+		 * number of groups is used only to choose the reduction mode.
+		 */
+		if (l_nvalids == 0)
+			kgpreagg->reduction_mode = GPUPREAGG_REDUCTION__LOCAL;
+		else if (l_ngroups < GPUPREAGG_WARP_MAX_NGROUPS)
+			kgpreagg->reduction_mode = GPUPREAGG_REDUCTION__WARP;
+		else if (2 * l_ngroups > l_nvalids)
+			kgpreagg->reduction_mode = GPUPREAGG_REDUCTION__GLOBAL;
+		else
+			kgpreagg->reduction_mode = GPUPREAGG_REDUCTION__LOCAL;
+		kgpreagg->sampled_ngroups = l_ngroups;
+	}
+}
+
+/*
+ * gpupreagg_warp_reduction
+ *
+ * It merges the rows with same grouping keys in a warp to the leader lane,
+ * which is the first lane of the group, by warp shuffles. Non-leader rows
+ * are invalidated, and *p_kds_index is cleared not to be reduced again.
+ * All the lanes in the warp must call this function.
+ */
+STATIC_FUNCTION(void)
+gpupreagg_warp_reduction(kern_context *kcxt,
+						 kern_data_store *kds_slot,
+						 cl_char *attr_is_preagg,
+						 cl_char *row_inval_map,
+						 cl_uint *p_kds_index,
+						 cl_uint hash_value)
+{
+	cl_uint		kds_index = *p_kds_index;
+	cl_bool		is_valid = (kds_index < kds_slot->nitems);
+	cl_uint		lane_id = LaneId();
+	cl_uint		leader = lane_id;
+	cl_uint		valid_mask;
+	cl_char	   *slot_dclass = NULL;
+	Datum	   *slot_values = NULL;
+	cl_uint		j, k;
+
+	valid_mask = __ballot_sync(0xffffffffU, is_valid);
+	if (is_valid)
+	{
+		slot_dclass = KERN_DATA_STORE_DCLASS(kds_slot, kds_index);
+		slot_values = KERN_DATA_STORE_VALUES(kds_slot, kds_index);
+	}
+	/* the first lane that has same grouping keys becomes the leader */
+	for (k=0; k < warpSize; k++)
+	{
+		cl_uint		k_hash = __shfl_sync(0xffffffffU, hash_value, k);
+		cl_uint		k_index = __shfl_sync(0xffffffffU, kds_index, k);
+
+		if (k < lane_id &&
+			leader == lane_id &&
+			is_valid &&
+			(valid_mask & (1U << k)) != 0 &&
+			k_hash == hash_value &&
+			gpupreagg_keymatch(kcxt,
+							   kds_slot, kds_index,
+							   kds_slot, k_index))
+			leader = k;
+	}
+	/* accumulation by the leaders; they own the rows, so no atomics */
+	for (k=0; k < warpSize; k++)
+	{
+		cl_uint		k_leader = __shfl_sync(0xffffffffU, leader, k);
+
+		if (k_leader == k)
+			continue;	/* k-th lane is leader itself, or invalid */
+		for (j=0; j < kds_slot->ncols; j++)
+		{
+			cl_char		k_dclass;
+			Datum		k_datum;
+
+			if (!attr_is_preagg[j])
+				continue;
+			k_dclass = __shfl_sync(0xffffffffU,
+								   (cl_int)(is_valid ? slot_dclass[j] : 0), k);
+			k_datum = (Datum)
+				__shfl_sync(0xffffffffU,
+							(cl_ulong)(is_valid ? slot_values[j] : 0), k);
+			if (lane_id == k_leader)
+				gpupreagg_nogroup_calc(j,
+									   &slot_dclass[j],
+									   &slot_values[j],
+									   k_dclass,
+									   k_datum);
+		}
+	}
+	/* non-leader rows are already merged to the leader's row */
+	if (is_valid && leader != lane_id)
+	{
+		row_inval_map[kds_index] = true;
+		*p_kds_index = UINT_MAX;
+	}
+}
+
 /*
  * gpupreagg_group_reduction
  */
@@ -1258,6 +1435,7 @@ gpupreagg_groupby_reduction(kern_context *kcxt,
 	cl_bool			is_last_reduction = false;
 	cl_bool			l_hashslot_cleanup = true;
 	cl_char		   *row_inval_map;
+	cl_uint			reduction_mode = kgpreagg->reduction_mode;
 #define GROUPBY_LOCAL_HASHSIZE	2400
 #define GROUPBY_LOCAL_BUFSIZE	1800
 	__shared__ cl_bool	l_dclass[GROUPBY_LOCAL_BUFSIZE];
@@ -1293,7 +1471,8 @@ gpupreagg_groupby_reduction(kern_context *kcxt,
 		{
 			l_hashslot_cleanup = false;
 			for (i = get_local_id();
-				 i < GROUPBY_LOCAL_HASHSIZE;
+				 i < GROUPBY_LOCAL_HASHSIZE &&
+				 reduction_mode != GPUPREAGG_REDUCTION__GLOBAL;
 				 i += get_local_size())
 			{
 				l_hashslot[i].s.hash = 0;
@@ -1322,11 +1501,55 @@ gpupreagg_groupby_reduction(kern_context *kcxt,
 			hash_value = gpupreagg_hashvalue(kcxt,
 											 slot_dclass,
 											 slot_values);
+			/*
+			 * On the hash-partitioned reduction, rows out of the current
+			 * partition are skipped; they shall be reduced on the later
+			 * scan for their own partition.
+			 */
+			if (kgpreagg->part_nbits > 0 &&
+				(hash_value >> (32 - kgpreagg->part_nbits)) !=
+				kgpreagg->part_index)
+				kds_index = UINT_MAX;
 		}
 		/* error checks */
 		if (__syncthreads_count(kcxt->errcode) > 0)
 			return;
 
+		if (reduction_mode == GPUPREAGG_REDUCTION__GLOBAL)
+		{
+			/*
+			 * Global reduction mode; every rows are moved to the final
+			 * hash-slot without merge on the local hash-slot. l_hashslot[]
+			 * is used as a plain buffer of the pending rows here.
+			 */
+			if (kds_index < kds_slot->nitems)
+			{
+				buf_index = atomicAdd(&l_nitems, 1);
+				l_hashslot[buf_index].s.hash = hash_value;
+				l_hashslot[buf_index].s.index = kds_index;
+				l_b2h_index[buf_index] = buf_index;
+			}
+			__syncthreads();
+			goto skip_local_reduction;
+		}
+		else if (reduction_mode == GPUPREAGG_REDUCTION__WARP)
+		{
+			gpupreagg_warp_reduction(kcxt,
+									 kds_slot,
+									 attr_is_preagg,
+									 row_inval_map,
+									 &kds_index,
+									 hash_value);
+			if (kds_index >= kds_slot->nitems)
+			{
+				slot_dclass = NULL;
+				slot_values = NULL;
+			}
+			/* error checks */
+			if (__syncthreads_count(kcxt->errcode) > 0)
+				return;
+		}
+
 		if (kds_index < kds_slot->nitems)
 		{
 			pagg_hashslot	old_slot;
@@ -1462,6 +1685,7 @@ gpupreagg_groupby_reduction(kern_context *kcxt,
 		 * final reduction steps if needed
 		 */
 		if (is_last_reduction ||
+			reduction_mode == GPUPREAGG_REDUCTION__GLOBAL ||
 			l_nitems + get_local_size() > GROUPBY_LOCAL_BUFSIZE)
 		{
 			cl_uint		nloops;
@@ -48,12 +48,39 @@ struct kern_gpupreagg
 	/* -- other hashing parameters -- */
 	cl_uint			key_dist_salt;			/* hashkey distribution salt */
 	cl_uint			hash_size;				/* size of global hash-slots */
+	/* -- hash-partitioned reduction -- */
+	cl_uint			part_nbits;			/* # of hash bits for partition, or 0 */
+	cl_uint			part_index;			/* current partition to be reduced */
+	/* -- adaptive reduction -- */
+	cl_uint			reduction_mode;		/* one of GPUPREAGG_REDUCTION__* */
+	cl_uint			sampled_ngroups;	/* out: # of groups in the samples */
 	kern_parambuf	kparams;
 	/* <-- gpupreaggSuspendContext[], if any --> */
 	/* <-- gpupreaggRowInvalidationMap. if any --> */
 };
 typedef struct kern_gpupreagg	kern_gpupreagg;
 
+/*
+ * Reduction mode of GROUP BY; kern_gpupreagg_sample_groups chooses one of
+ * them for each chunk according to the number of distinct groups in the
+ * sampled rows.
+ *
+ * LOCAL  - rows are merged on the local hash-slot on the shared memory
+ *          first, then moved to the final hash-slot.
+ * GLOBAL - rows are moved to the final hash-slot directly, because local
+ *          hash-slot rarely merges the rows on high cardinality.
+ * WARP   - rows with same grouping keys in a warp are merged by warp
+ *          shuffles prior to the local hash-slot, to reduce contention
+ *          of atomic operations on very low cardinality.
+ */
+#define GPUPREAGG_REDUCTION__LOCAL		0
+#define GPUPREAGG_REDUCTION__GLOBAL		1
+#define GPUPREAGG_REDUCTION__WARP		2
+
+#define GPUPREAGG_SAMPLE_NROWS			2048
+#define GPUPREAGG_SAMPLE_HASHSIZE		4096
+#define GPUPREAGG_WARP_MAX_NGROUPS		32
+
 /*
  * gpupreaggSuspendContext is used to suspend gpupreagg_setup_block kernel.
  * Because KDS_FORMAT_BLOCK can have more items than estimation, so we cannot
@@ -273,6 +300,11 @@ gpupreagg_groupby_reduction(kern_context *kcxt,
 							kern_data_store *kds_slot,		/* in */
 							kern_data_store *kds_final,		/* shared out */
 							kern_global_hashslot *f_hash);	/* shared out */
+DEVICE_FUNCTION(void)
+gpupreagg_sample_groups(kern_context *kcxt,
+						kern_gpupreagg *kgpreagg,		/* in/out */
+						kern_errorbuf *kgjoin_errorbuf,	/* in */
+						kern_data_store *kds_slot);		/* in */
 #endif /* __CUDACC__ */
 
 /* ----------------------------------------------------------------
@@ -281,6 +313,34 @@ gpupreagg_groupby_reduction(kern_context *kcxt,
  *
  * ---------------------------------------------------------------- */
 #ifdef __CUDACC__
+/*
+ * Comparison of floating-point values in the PostgreSQL manner; NaN is
+ * larger than any other values, and equal to other NaN.
+ */
+STATIC_INLINE(cl_bool)
+__aggcalc_float_lt(cl_float a, cl_float b)
+{
+	return (isnan(a) ? false : (isnan(b) ? true : a < b));
+}
+
+STATIC_INLINE(cl_bool)
+__aggcalc_float_gt(cl_float a, cl_float b)
+{
+	return (isnan(a) ? !isnan(b) : (isnan(b) ? false : a > b));
+}
+
+STATIC_INLINE(cl_bool)
+__aggcalc_double_lt(cl_double a, cl_double b)
+{
+	return (isnan(a) ? false : (isnan(b) ? true : a < b));
+}
+
+STATIC_INLINE(cl_bool)
+__aggcalc_double_gt(cl_double a, cl_double b)
+{
+	return (isnan(a) ? !isnan(b) : (isnan(b) ? false : a > b));
+}
+
 STATIC_INLINE(void)
 aggcalc_atomic_min_int(cl_char *p_accum_dclass, Datum *p_accum_datum,
 					   cl_char newval_dclass, Datum newval_datum)
@@ -378,7 +438,8 @@ aggcalc_atomic_min_float(cl_char *p_accum_dclass, Datum *p_accum_datum,
 
 		do {
 			oldval = curval;
-			if (__int_as_float(oldval) < __int_as_float(newval))
+			if (!__aggcalc_float_lt(__int_as_float(newval),
+									__int_as_float(oldval)))
 				break;
 		} while ((curval = atomicCAS((cl_uint *)p_accum_datum,
 									 oldval, newval)) != oldval);
@@ -400,7 +461,8 @@ aggcalc_atomic_max_float(cl_char *p_accum_dclass, Datum *p_accum_datum,
 
 		do {
 			oldval = curval;
-			if (__int_as_float(oldval) > __int_as_float(newval))
+			if (!__aggcalc_float_gt(__int_as_float(newval),
+									__int_as_float(oldval)))
 				break;
 		} while ((curval = atomicCAS((cl_uint *)p_accum_datum,
 									 oldval, newval)) != oldval);
@@ -436,7 +498,8 @@ aggcalc_atomic_min_double(cl_char *p_accum_dclass, Datum *p_accum_datum,
 
 		do {
 			oldval = curval;
-			if (__longlong_as_double(oldval) < __longlong_as_double(newval))
+			if (!__aggcalc_double_lt(__longlong_as_double(newval),
+									 __longlong_as_double(oldval)))
 				break;
 		} while ((curval = atomicCAS((cl_ulong *)p_accum_datum,
 									 oldval, newval)) != oldval);
@@ -458,7 +521,8 @@ aggcalc_atomic_max_double(cl_char *p_accum_dclass, Datum *p_accum_datum,
 
 		do {
 			oldval = curval;
-			if (__longlong_as_double(oldval) > __longlong_as_double(newval))
+			if (!__aggcalc_double_gt(__longlong_as_double(newval),
+									 __longlong_as_double(oldval)))
 				break;
 		} while ((curval = atomicCAS((cl_ulong *)p_accum_datum,
 									 oldval, newval)) != oldval);
@@ -575,9 +639,10 @@ aggcalc_normal_min_float(cl_char *p_accum_dclass, Datum *p_accum_datum,
 {
 	if (newval_dclass == DATUM_CLASS__NORMAL)
 	{
-		*((cl_float *)p_accum_datum)
-			= Min(*((cl_float *)p_accum_datum),
-				  __int_as_float(newval_datum & 0xffffffff));
+		cl_float	newval = __int_as_float(newval_datum & 0xffffffff);
+
+		if (__aggcalc_float_lt(newval, *((cl_float *)p_accum_datum)))
+			*((cl_float *)p_accum_datum) = newval;
 		*p_accum_dclass = DATUM_CLASS__NORMAL;
 	}
 	else
@@ -590,9 +655,10 @@ aggcalc_normal_max_float(cl_char *p_accum_dclass, Datum *p_accum_datum,
 {
 	if (newval_dclass == DATUM_CLASS__NORMAL)
 	{
-		*((cl_float *)p_accum_datum)
-			= Max(*((cl_float *)p_accum_datum),
-				  __int_as_float(newval_datum & 0xffffffff));
+		cl_float	newval = __int_as_float(newval_datum & 0xffffffff);
+
+		if (__aggcalc_float_gt(newval, *((cl_float *)p_accum_datum)))
+			*((cl_float *)p_accum_datum) = newval;
 		*p_accum_dclass = DATUM_CLASS__NORMAL;
 	}
 	else
@@ -619,9 +685,10 @@ aggcalc_normal_min_double(cl_char *p_accum_dclass, Datum *p_accum_datum,
 {
 	if (newval_dclass == DATUM_CLASS__NORMAL)
 	{
-		*((cl_double *)p_accum_datum)
-			= Min(*((cl_double *)p_accum_datum),
-				  __longlong_as_double((cl_ulong)newval_datum));
+		cl_double	newval = __longlong_as_double((cl_ulong)newval_datum);
+
+		if (__aggcalc_double_lt(newval, *((cl_double *)p_accum_datum)))
+			*((cl_double *)p_accum_datum) = newval;
 		*p_accum_dclass = DATUM_CLASS__NORMAL;
 	}
 	else
@@ -634,9 +701,10 @@ aggcalc_normal_max_double(cl_char *p_accum_dclass, Datum *p_accum_datum,
 {
 	if (newval_dclass == DATUM_CLASS__NORMAL)
 	{
-		*((cl_double *)p_accum_datum)
-			= Max(*((cl_double *)p_accum_datum),
-				  __longlong_as_double((cl_ulong)newval_datum));
+		cl_double	newval = __longlong_as_double((cl_ulong)newval_datum);
+
+		if (__aggcalc_double_gt(newval, *((cl_double *)p_accum_datum)))
+			*((cl_double *)p_accum_datum) = newval;
 		*p_accum_dclass = DATUM_CLASS__NORMAL;
 	}
 	else
@@ -721,6 +789,22 @@ kern_gpupreagg_nogroup_reduction(kern_gpupreagg *kgpreagg,
 	kern_writeback_error_status(&kgpreagg->kerror, &u.kcxt);
 }
 
+KERNEL_FUNCTION(void)
+kern_gpupreagg_sample_groups(kern_gpupreagg *kgpreagg,
+							 kern_errorbuf *kgjoin_errorbuf,
+							 kern_data_store *kds_slot)
+{
+	kern_parambuf *kparams = KERN_GPUPREAGG_PARAMBUF(kgpreagg);
+	DECL_KERNEL_CONTEXT(u);
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
+	gpupreagg_sample_groups(&u.kcxt,
+							kgpreagg,
+							kgjoin_errorbuf,
+							kds_slot);
+	kern_writeback_error_status(&kgpreagg->kerror, &u.kcxt);
+}
+
 KERNEL_FUNCTION(void)
 kern_gpupreagg_groupby_reduction(kern_gpupreagg *kgpreagg,
 								 kern_errorbuf *kgjoin_errorbuf,
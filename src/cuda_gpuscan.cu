@@ -18,6 +18,216 @@
 #include "cuda_common.h"
 #include "cuda_gpuscan.h"
 
+/*
+ * gpuscan_bytecode_eval - evaluation of the device qualifiers by bytecode
+ *
+ * It is a small stack machine on top of the precompiled library, to run
+ * the simple but common qualifiers without JIT compile. See the comment of
+ * codegen_gpuscan_bytecode() for the supported shapes.
+ */
+typedef struct
+{
+	cl_bool		isnull;
+	cl_bool		is_float;
+	union {
+		cl_long		ival;
+		cl_double	fval;
+	} u;
+} gsbcDatum;
+
+STATIC_INLINE(void)
+gsbc_fetch_datum(gsbcDatum *result, cl_short vtype, void *addr)
+{
+	result->is_float = false;
+	if (!addr)
+	{
+		result->isnull = true;
+		result->u.ival = 0;
+		return;
+	}
+	result->isnull = false;
+	switch (vtype)
+	{
+		case GSBC_TYPE__BOOL:
+			result->u.ival = (*((cl_bool *)addr) ? 1 : 0);
+			break;
+		case GSBC_TYPE__INT2:
+			result->u.ival = *((cl_short *)addr);
+			break;
+		case GSBC_TYPE__INT4:
+			result->u.ival = *((cl_int *)addr);
+			break;
+		case GSBC_TYPE__INT8:
+			result->u.ival = *((cl_long *)addr);
+			break;
+		case GSBC_TYPE__FLOAT4:
+			result->is_float = true;
+			result->u.fval = (cl_double)(*((cl_float *)addr));
+			break;
+		case GSBC_TYPE__FLOAT8:
+			result->is_float = true;
+			result->u.fval = *((cl_double *)addr);
+			break;
+		default:
+			result->isnull = true;
+			break;
+	}
+}
+
+STATIC_INLINE(cl_int)
+gsbc_compare_datum(gsbcDatum *arg1, gsbcDatum *arg2)
+{
+	if (!arg1->is_float)
+	{
+		assert(!arg2->is_float);
+		if (arg1->u.ival < arg2->u.ival)
+			return -1;
+		if (arg1->u.ival > arg2->u.ival)
+			return 1;
+		return 0;
+	}
+	/* same as float8_cmp_internal; NaN is larger than any other values */
+	if (isnan(arg1->u.fval))
+		return (isnan(arg2->u.fval) ? 0 : 1);
+	if (isnan(arg2->u.fval))
+		return -1;
+	if (arg1->u.fval < arg2->u.fval)
+		return -1;
+	if (arg1->u.fval > arg2->u.fval)
+		return 1;
+	return 0;
+}
+
+DEVICE_FUNCTION(cl_bool)
+gpuscan_bytecode_eval(kern_context *kcxt,
+					  kern_data_store *kds,
+					  HeapTupleHeaderData *htup)
+{
+	struct varlena *vl_code = (struct varlena *)
+		kparam_get_value(kcxt->kparams, 0);
+	gpuscanBytecode *code;
+	gsbcDatum	stack[GSBC_MAX_STACK_DEPTH];
+	cl_int		depth = 0;
+	cl_int		i, j, n, ncodes;
+
+	if (!vl_code)
+		return true;
+	code = (gpuscanBytecode *)VARDATA(vl_code);
+	ncodes = VARSIZE_EXHDR(vl_code) / sizeof(gpuscanBytecode);
+	for (i=0; i < ncodes; i++)
+	{
+		gpuscanBytecode *op = &code[i];
+		gsbcDatum  *arg1, *arg2;
+		void	   *addr;
+		cl_int		cmp;
+		cl_bool		anynull;
+		cl_bool		retval;
+
+		switch (op->opcode)
+		{
+			case GSBC_OP__VAR:
+				if (depth >= GSBC_MAX_STACK_DEPTH)
+					goto bailout;
+				addr = kern_get_datum_tuple(kds->colmeta, htup, op->arg - 1);
+				gsbc_fetch_datum(&stack[depth++], op->vtype, addr);
+				break;
+
+			case GSBC_OP__PARAM:
+				if (depth >= GSBC_MAX_STACK_DEPTH)
+					goto bailout;
+				addr = kparam_get_value(kcxt->kparams, op->arg);
+				gsbc_fetch_datum(&stack[depth++], op->vtype, addr);
+				break;
+
+			case GSBC_OP__EQ:
+			case GSBC_OP__NE:
+			case GSBC_OP__LT:
+			case GSBC_OP__LE:
+			case GSBC_OP__GT:
+			case GSBC_OP__GE:
+				if (depth < 2)
+					goto bailout;
+				arg2 = &stack[--depth];
+				arg1 = &stack[depth - 1];
+				if (arg1->isnull || arg2->isnull)
+				{
+					arg1->isnull = true;
+					arg1->is_float = false;
+					break;
+				}
+				cmp = gsbc_compare_datum(arg1, arg2);
+				switch (op->opcode)
+				{
+					case GSBC_OP__EQ: retval = (cmp == 0); break;
+					case GSBC_OP__NE: retval = (cmp != 0); break;
+					case GSBC_OP__LT: retval = (cmp <  0); break;
+					case GSBC_OP__LE: retval = (cmp <= 0); break;
+					case GSBC_OP__GT: retval = (cmp >  0); break;
+					default:          retval = (cmp >= 0); break;
+				}
+				arg1->is_float = false;
+				arg1->u.ival = (retval ? 1 : 0);
+				break;
+
+			case GSBC_OP__AND:
+			case GSBC_OP__OR:
+				n = op->arg;
+				if (n < 1 || depth < n)
+					goto bailout;
+				/* same as three-valued logic of ExecEvalAnd / ExecEvalOr */
+				retval = (op->opcode == GSBC_OP__AND);
+				anynull = false;
+				for (j=depth - n; j < depth; j++)
+				{
+					if (stack[j].isnull)
+						anynull = true;
+					else if ((stack[j].u.ival != 0) != retval)
+					{
+						retval = !retval;
+						anynull = false;
+						break;
+					}
+				}
+				depth -= n;
+				stack[depth].isnull = anynull;
+				stack[depth].is_float = false;
+				stack[depth].u.ival = (retval ? 1 : 0);
+				depth++;
+				break;
+
+			case GSBC_OP__NOT:
+				if (depth < 1)
+					goto bailout;
+				arg1 = &stack[depth - 1];
+				if (!arg1->isnull)
+					arg1->u.ival = (arg1->u.ival != 0 ? 0 : 1);
+				break;
+
+			case GSBC_OP__IS_NULL:
+			case GSBC_OP__IS_NOT_NULL:
+				if (depth < 1)
+					goto bailout;
+				arg1 = &stack[depth - 1];
+				retval = (arg1->isnull == (op->opcode == GSBC_OP__IS_NULL));
+				arg1->isnull = false;
+				arg1->is_float = false;
+				arg1->u.ival = (retval ? 1 : 0);
+				break;
+
+			default:
+				goto bailout;
+		}
+	}
+	if (depth != 1)
+		goto bailout;
+	return (!stack[0].isnull && stack[0].u.ival != 0);
+
+bailout:
+	STROM_EREPORT(kcxt, ERRCODE_INTERNAL_ERROR,
+				  "corrupted bytecode of GpuScan device qualifiers");
+	return false;
+}
+
 /*
  * gpuscan_main_row - GpuScan logic for KDS_FORMAT_ROW
  */
@@ -94,7 +304,7 @@ gpuscan_main_row(kern_context *kcxt,
 		if (nvalids == 0)
 			goto skip;
 
-		if (has_device_projection)
+		if (has_device_projection && kds_dst != NULL)
 		{
 			/* extract the source tuple to the private slot, if any */
 			if (tupitem && rc)
@@ -20,6 +20,8 @@
 /*
  * kern_gpuscan
  */
+#define GPUSCAN_MAX_REORDER_QUALS	8
+
 struct kern_gpuscan {
 	kern_errorbuf	kerror;
 	cl_uint			grid_sz;
@@ -32,9 +34,13 @@ struct kern_gpuscan {
 	cl_uint			suspend_sz;			/* size of suspend context buffer */
 	cl_uint			suspend_count;		/* # of suspended workgroups */
 	cl_bool			resume_context;		/* true, if kernel should resume */
+	/* run-time reordering of device qualifiers */
+	cl_uchar		quals_order[GPUSCAN_MAX_REORDER_QUALS];
+	cl_uint			quals_nitems_in[GPUSCAN_MAX_REORDER_QUALS];
+	cl_uint			quals_nitems_out[GPUSCAN_MAX_REORDER_QUALS];
 	kern_parambuf	kparams;
 	/* <-- gpuscanSuspendContext --> */
-	/* <-- gpuscanResultIndex (if KDS_FORMAT_ROW with no projection) -->*/
+	/* <-- gpuscanResultIndex (if KDS_FORMAT_ROW with no device projection) -->*/
 };
 typedef struct kern_gpuscan		kern_gpuscan;
 
@@ -50,8 +56,45 @@ typedef struct
 	cl_uint		results[FLEXIBLE_ARRAY_MEMBER];
 } gpuscanResultIndex;
 
+/*
+ * gpuscanBytecode - postfix program of the device qualifiers, evaluated by
+ * the precompiled gpuscan_bytecode_eval() instead of the JIT compiled code.
+ * It is delivered as a bytea parameter at KPARAM_0.
+ */
+#define GSBC_OP__VAR			1	/* push column (arg: attnum) */
+#define GSBC_OP__PARAM			2	/* push Const/Param (arg: param index) */
+#define GSBC_OP__EQ				3	/* compare top two values */
+#define GSBC_OP__NE				4
+#define GSBC_OP__LT				5
+#define GSBC_OP__LE				6
+#define GSBC_OP__GT				7
+#define GSBC_OP__GE				8
+#define GSBC_OP__AND			9	/* arg: number of operands */
+#define GSBC_OP__OR				10	/* arg: number of operands */
+#define GSBC_OP__NOT			11
+#define GSBC_OP__IS_NULL		12
+#define GSBC_OP__IS_NOT_NULL	13
+
+#define GSBC_TYPE__BOOL			1
+#define GSBC_TYPE__INT2			2
+#define GSBC_TYPE__INT4			3
+#define GSBC_TYPE__INT8			4
+#define GSBC_TYPE__FLOAT4		5
+#define GSBC_TYPE__FLOAT8		6
+
+#define GSBC_MAX_STACK_DEPTH	32
+
+typedef struct
+{
+	cl_short	opcode;		/* one of GSBC_OP__* */
+	cl_short	vtype;		/* one of GSBC_TYPE__*, if VAR/PARAM */
+	cl_int		arg;
+} gpuscanBytecode;
+
 #define KERN_GPUSCAN_PARAMBUF(kgpuscan)			\
 	(&((kern_gpuscan *)(kgpuscan))->kparams)
+#define KERN_GPUSCAN_FROM_PARAMBUF(kparams)		\
+	((kern_gpuscan *)((char *)(kparams) - offsetof(kern_gpuscan, kparams)))
 #define KERN_GPUSCAN_PARAMBUF_LENGTH(kgpuscan)	\
 	STROMALIGN(KERN_GPUSCAN_PARAMBUF(kgpuscan)->length)
 #define KERN_GPUSCAN_SUSPEND_CONTEXT(kgpuscan, group_id) \
@@ -82,6 +125,35 @@ gpuscan_quals_eval_arrow(kern_context *kcxt,
 						 kern_data_store *kds,
 						 cl_uint src_index);
 
+/*
+ * gpuscan_bytecode_eval - precompiled evaluator of the gpuscanBytecode
+ */
+DEVICE_FUNCTION(cl_bool)
+gpuscan_bytecode_eval(kern_context *kcxt,
+					  kern_data_store *kds,
+					  HeapTupleHeaderData *htup);
+
+/*
+ * gpuscan_quals_count - accumulates per-clause statistics of device quals
+ *
+ * The auto-generated gpuscan_quals_eval() calls this function for each
+ * clause in the order given by kgpuscan->quals_order, then host-side
+ * picks up the most selective one for the later chunks.
+ */
+DEVICE_INLINE(cl_bool)
+gpuscan_quals_count(kern_gpuscan *kgpuscan, cl_uint qual_index, cl_bool rv)
+{
+	cl_uint		mask = __activemask();
+	cl_uint		pmask = __ballot_sync(mask, rv);
+
+	if (LaneId() == __ffs(mask) - 1)
+	{
+		atomicAdd(&kgpuscan->quals_nitems_in[qual_index], __popc(mask));
+		atomicAdd(&kgpuscan->quals_nitems_out[qual_index], __popc(pmask));
+	}
+	return rv;
+}
+
 DEVICE_FUNCTION(void)
 gpuscan_projection_tuple(kern_context *kcxt,
 						 kern_data_store *kds_src,
@@ -30,7 +30,8 @@ gpusort_setup_column(kern_context *kcxt,
 	cl_uint			loop, nloops;
 	__shared__ cl_uint pos;
 
-	assert(kds_src->format == KDS_FORMAT_COLUMN);
+	assert(kds_src->format == KDS_FORMAT_COLUMN ||
+		   kds_src->format == KDS_FORMAT_ROW);
 	nloops = (kds_src->nitems + globalSz - 1) / globalSz;
 	for (loop=0; loop < nloops; loop++)
 	{
@@ -236,3 +237,551 @@ gpusort_bitonic_merge(kern_context *kcxt,
 		kresults->results[partBase + i] = localIdx[i];
 	__syncthreads();
 }
+
+/*
+ * gpusort_radix_setup
+ *
+ * It translates the sort key of keyidx to the radix key for each row.
+ */
+DEVICE_FUNCTION(void)
+gpusort_radix_setup(kern_context *kcxt,
+					kern_gpusort *kgpusort,
+					kern_data_store *kds_src,
+					kern_gpusort_radix *kradix,
+					cl_uint keyidx)
+{
+	cl_ulong   *keys = KERN_GPUSORT_RADIX_KEYS(kradix);
+	cl_uchar   *nulls = KERN_GPUSORT_RADIX_NULLS(kradix);
+	cl_uint		index;
+
+	/* quick bailout if any error happen in the prior kernel */
+	if (__syncthreads_count(kgpusort->kerror.errcode) != 0)
+		return;
+
+	for (index = get_global_id();
+		 index < kradix->nitems;
+		 index += get_global_size())
+	{
+		nulls[index] = gpusort_radix_key(kcxt, kds_src, index, keyidx,
+										 &keys[index]);
+	}
+}
+
+/*
+ * gpusort_radix_digit
+ */
+DEVICE_INLINE(cl_uint)
+gpusort_radix_digit(kern_gpusort_radix *kradix,
+					cl_uint row_index, cl_uint shift)
+{
+	if (shift == GPUSORT_RADIX_NULL_SHIFT)
+		return KERN_GPUSORT_RADIX_NULLS(kradix)[row_index];
+	return (cl_uint)((KERN_GPUSORT_RADIX_KEYS(kradix)[row_index] >> shift) &
+					 (GPUSORT_RADIX_NBUCKETS - 1));
+}
+
+/*
+ * gpusort_radix_histogram
+ *
+ * Every block counts the digits of GPUSORT_RADIX_TILESZ items, then the
+ * histogram is stored in the digit-major order; so the exclusive prefix
+ * sum of the histogram gives the destination of each block and digit.
+ */
+DEVICE_FUNCTION(void)
+gpusort_radix_histogram(kern_context *kcxt,
+						kern_gpusort *kgpusort,
+						kern_gpusort_radix *kradix,
+						cl_uint src_buf,
+						cl_uint shift)
+{
+	gpusortResultIndex *kresults = KERN_GPUSORT_RESULT_INDEX(kgpusort);
+	cl_uint	   *src_index = (src_buf == 0
+							 ? kresults->results
+							 : KERN_GPUSORT_RADIX_INDEX(kradix));
+	cl_uint	   *hist = KERN_GPUSORT_RADIX_HIST(kradix);
+	cl_uint		head = get_group_id() * GPUSORT_RADIX_TILESZ;
+	cl_uint		tail = Min(head + GPUSORT_RADIX_TILESZ, kradix->nitems);
+	cl_uint		i;
+	__shared__ cl_uint counts[GPUSORT_RADIX_NBUCKETS];
+
+	assert(get_local_size() == GPUSORT_RADIX_BLOCKSZ);
+	/* quick bailout if any error happen in the prior kernel */
+	if (__syncthreads_count(kgpusort->kerror.errcode) != 0)
+		return;
+
+	counts[get_local_id()] = 0;
+	__syncthreads();
+	for (i = head + get_local_id(); i < tail; i += get_local_size())
+	{
+		cl_uint		digit = gpusort_radix_digit(kradix, src_index[i], shift);
+
+		atomicAdd(&counts[digit], 1);
+	}
+	__syncthreads();
+	hist[get_local_id() * kradix->nblocks + get_group_id()]
+		= counts[get_local_id()];
+}
+
+/*
+ * gpusort_radix_prefix
+ *
+ * exclusive prefix sum of the histogram by a single thread block
+ */
+DEVICE_FUNCTION(void)
+gpusort_radix_prefix(kern_context *kcxt,
+					 kern_gpusort *kgpusort,
+					 kern_gpusort_radix *kradix)
+{
+	cl_uint	   *hist = KERN_GPUSORT_RADIX_HIST(kradix);
+	cl_uint		nhists = GPUSORT_RADIX_NBUCKETS * kradix->nblocks;
+	cl_uint		unitsz = (nhists + get_local_size() - 1) / get_local_size();
+	cl_uint		head = Min(get_local_id() * unitsz, nhists);
+	cl_uint		tail = Min(head + unitsz, nhists);
+	cl_uint		sum = 0;
+	cl_uint		i, temp;
+	__shared__ cl_uint psum[MAXTHREADS_PER_BLOCK];
+
+	assert(get_num_groups() == 1);
+	/* quick bailout if any error happen in the prior kernel */
+	if (__syncthreads_count(kgpusort->kerror.errcode) != 0)
+		return;
+
+	for (i=head; i < tail; i++)
+		sum += hist[i];
+	psum[get_local_id()] = sum;
+	__syncthreads();
+	if (get_local_id() == 0)
+	{
+		sum = 0;
+		for (i=0; i < get_local_size(); i++)
+		{
+			temp = psum[i];
+			psum[i] = sum;
+			sum += temp;
+		}
+	}
+	__syncthreads();
+	sum = psum[get_local_id()];
+	for (i=head; i < tail; i++)
+	{
+		temp = hist[i];
+		hist[i] = sum;
+		sum += temp;
+	}
+}
+
+/*
+ * gpusort_radix_scatter
+ *
+ * It moves the row-index to the destination buffer according to the
+ * digit. Rank of the items that have same digit within a warp is
+ * determined using ballot of each bit, so items keep the order in the
+ * source buffer; it is required for LSD radix sort.
+ */
+DEVICE_FUNCTION(void)
+gpusort_radix_scatter(kern_context *kcxt,
+					  kern_gpusort *kgpusort,
+					  kern_gpusort_radix *kradix,
+					  cl_uint src_buf,
+					  cl_uint shift)
+{
+	gpusortResultIndex *kresults = KERN_GPUSORT_RESULT_INDEX(kgpusort);
+	cl_uint	   *src_index = (src_buf == 0
+							 ? kresults->results
+							 : KERN_GPUSORT_RADIX_INDEX(kradix));
+	cl_uint	   *dst_index = (src_buf == 0
+							 ? KERN_GPUSORT_RADIX_INDEX(kradix)
+							 : kresults->results);
+	cl_uint	   *hist = KERN_GPUSORT_RADIX_HIST(kradix);
+	cl_uint		head = get_group_id() * GPUSORT_RADIX_TILESZ;
+	cl_uint		tail = Min(head + GPUSORT_RADIX_TILESZ, kradix->nitems);
+	cl_uint		warp_id = get_local_id() / warpSize;
+	cl_uint		lane_id = LaneId();
+	cl_uint		base;
+	cl_uint		w, k;
+	__shared__ cl_uint bucket_base[GPUSORT_RADIX_NBUCKETS];
+	__shared__ cl_uint bucket_total[GPUSORT_RADIX_NBUCKETS];
+	__shared__ cl_uint warp_count[GPUSORT_RADIX_BLOCKSZ / 32]
+							[GPUSORT_RADIX_NBUCKETS];
+
+	assert(get_local_size() == GPUSORT_RADIX_BLOCKSZ);
+	/* quick bailout if any error happen in the prior kernel */
+	if (__syncthreads_count(kgpusort->kerror.errcode) != 0)
+		return;
+
+	bucket_base[get_local_id()] = hist[get_local_id() * kradix->nblocks +
+									   get_group_id()];
+	for (base = head; base < tail; base += get_local_size())
+	{
+		cl_uint		index = base + get_local_id();
+		cl_bool		is_valid = (index < tail);
+		cl_uint		row_index = 0;
+		cl_uint		digit = 0;
+		cl_uint		peers;
+		cl_uint		rank;
+
+		if (is_valid)
+		{
+			row_index = src_index[index];
+			digit = gpusort_radix_digit(kradix, row_index, shift);
+		}
+		for (w=0; w < GPUSORT_RADIX_BLOCKSZ / 32; w++)
+			warp_count[w][get_local_id()] = 0;
+		__syncthreads();
+
+		/* lanes that have the same digit */
+		peers = __ballot_sync(0xffffffffU, is_valid);
+		for (k=0; k < GPUSORT_RADIX_BITS; k++)
+		{
+			cl_bool		bit = ((digit >> k) & 1) != 0;
+			cl_uint		mask = __ballot_sync(0xffffffffU, bit);
+
+			peers &= (bit ? mask : ~mask);
+		}
+		rank = __popc(peers & ((1U << lane_id) - 1));
+		if (is_valid && rank == 0)
+			warp_count[warp_id][digit] = __popc(peers);
+		__syncthreads();
+
+		/* exclusive prefix sum of the warp counts for each digit */
+		{
+			cl_uint		sum = 0;
+			cl_uint		temp;
+
+			for (w=0; w < GPUSORT_RADIX_BLOCKSZ / 32; w++)
+			{
+				temp = warp_count[w][get_local_id()];
+				warp_count[w][get_local_id()] = sum;
+				sum += temp;
+			}
+			bucket_total[get_local_id()] = sum;
+		}
+		__syncthreads();
+
+		if (is_valid)
+			dst_index[bucket_base[digit] +
+					  warp_count[warp_id][digit] + rank] = row_index;
+		__syncthreads();
+		bucket_base[get_local_id()] += bucket_total[get_local_id()];
+		__syncthreads();
+	}
+}
+
+/*
+ * gpuwinagg_setup
+ *
+ * It initializes the lanes of GpuWindowAgg on the sorted result index.
+ * Partition and peer boundaries are identified by comparison with the
+ * neighbor items, then the argument values of aggregate functions are
+ * loaded.
+ */
+DEVICE_FUNCTION(void)
+gpuwinagg_setup(kern_context *kcxt,
+				kern_gpusort *kgpusort,
+				kern_data_store *kds_src,
+				kern_gpuwinagg *kgwagg)
+{
+	gpusortResultIndex *kresults = KERN_GPUSORT_RESULT_INDEX(kgpusort);
+	cl_uint			nitems = kgwagg->nitems;
+	cl_uint			index;
+	cl_ulong		values[GPUWINAGG_MAX_NARGS];
+	cl_bool			isnull[GPUWINAGG_MAX_NARGS];
+
+	/* quick bailout if any error happen in the prior kernel */
+	if (__syncthreads_count(kgpusort->kerror.errcode) != 0)
+		return;
+
+	for (index = get_global_id();
+		 index < nitems;
+		 index += get_global_size())
+	{
+		cl_uint		pos = kresults->results[index];
+		cl_bool		part_head = (index == 0);
+		cl_bool		peer_head = (index == 0);
+		cl_bool		part_tail = (index == nitems - 1);
+		cl_bool		peer_tail = (index == nitems - 1);
+		cl_int		depth;
+		cl_uint		fn;
+
+		if (index > 0)
+		{
+			gpuwinagg_keycomp(kcxt, kds_src,
+							  kresults->results[index - 1], pos, &depth);
+			part_head = (depth < kgwagg->part_nkeys);
+			peer_head = (depth < kgwagg->nkeys);
+		}
+		if (index < nitems - 1)
+		{
+			gpuwinagg_keycomp(kcxt, kds_src,
+							  pos, kresults->results[index + 1], &depth);
+			part_tail = (depth < kgwagg->part_nkeys);
+			peer_tail = (depth < kgwagg->nkeys);
+		}
+		KERN_GPUWINAGG_LANE(kgwagg, 0, GPUWINAGG_LANE__PART_HEAD)[index]
+			= (part_head ? index : 0);
+		KERN_GPUWINAGG_LANE(kgwagg, 0, GPUWINAGG_LANE__PEER_HEAD)[index]
+			= (peer_head ? index : 0);
+		KERN_GPUWINAGG_LANE(kgwagg, 0, GPUWINAGG_LANE__PART_TAIL)[index]
+			= (part_tail ? index : nitems - 1);
+		KERN_GPUWINAGG_LANE(kgwagg, 0, GPUWINAGG_LANE__PEER_TAIL)[index]
+			= (peer_tail ? index : nitems - 1);
+		KERN_GPUWINAGG_LANE(kgwagg, 0, GPUWINAGG_LANE__DENSE_RANK)[index]
+			= (peer_head ? 1 : 0);
+
+		if (kgwagg->nargs > 0)
+			gpuwinagg_fetch_args(kcxt, kds_src, pos, values, isnull);
+		for (fn=0; fn < kgwagg->nfuncs; fn++)
+		{
+			kern_gpuwinagg_func *wfunc = &kgwagg->funcs[fn];
+			cl_bool		__isnull = true;
+			cl_ulong	__value = 0;
+
+			if (wfunc->argidx >= 0)
+			{
+				__isnull = isnull[wfunc->argidx];
+				__value  = values[wfunc->argidx];
+			}
+			else if (wfunc->func == GPUWINAGG_FUNC__COUNT)
+				__isnull = false;	/* count(*) */
+
+			if (__isnull)
+			{
+				/* identity value of the operator */
+				switch (wfunc->func)
+				{
+					case GPUWINAGG_FUNC__MIN_INT:
+						__value = (cl_ulong)LONG_MAX;
+						break;
+					case GPUWINAGG_FUNC__MAX_INT:
+						__value = (cl_ulong)LONG_MIN;
+						break;
+					case GPUWINAGG_FUNC__MIN_FP:
+						/* NaN is larger than any other values */
+						__value = 0x7ff8000000000000UL;
+						break;
+					case GPUWINAGG_FUNC__MAX_FP:
+						__value = 0xfff0000000000000UL;		/* -Inf */
+						break;
+					default:
+						__value = 0;
+						break;
+				}
+			}
+			KERN_GPUWINAGG_LANE(kgwagg, 0,
+								KERN_GPUWINAGG_VALUE_LANE(fn))[index] = __value;
+			KERN_GPUWINAGG_LANE(kgwagg, 0,
+								KERN_GPUWINAGG_COUNT_LANE(fn))[index]
+				= (__isnull ? 0 : 1);
+		}
+	}
+}
+
+/*
+ * gpuwinagg_combine - combine two values according to the function
+ */
+STATIC_INLINE(cl_ulong)
+gpuwinagg_combine(cl_char func, cl_ulong x, cl_ulong y)
+{
+	cl_double	fx, fy;
+
+	switch (func)
+	{
+		case GPUWINAGG_FUNC__SUM_INT:
+			return (cl_ulong)((cl_long)x + (cl_long)y);
+		case GPUWINAGG_FUNC__MIN_INT:
+			return (cl_ulong)Min((cl_long)x, (cl_long)y);
+		case GPUWINAGG_FUNC__MAX_INT:
+			return (cl_ulong)Max((cl_long)x, (cl_long)y);
+		case GPUWINAGG_FUNC__SUM_FP:
+			fx = __longlong_as_double(x);
+			fy = __longlong_as_double(y);
+			return __double_as_longlong(fx + fy);
+		case GPUWINAGG_FUNC__MIN_FP:
+			fx = __longlong_as_double(x);
+			fy = __longlong_as_double(y);
+			if (isnan(fx))
+				return y;
+			if (isnan(fy))
+				return x;
+			return (fx < fy ? x : y);
+		case GPUWINAGG_FUNC__MAX_FP:
+			fx = __longlong_as_double(x);
+			fy = __longlong_as_double(y);
+			if (isnan(fx))
+				return x;
+			if (isnan(fy))
+				return y;
+			return (fx > fy ? x : y);
+		default:
+			break;
+	}
+	return x;
+}
+
+/*
+ * gpuwinagg_scan
+ *
+ * A step of Hillis-Steele scan with the supplied distance. The host code
+ * launches this kernel with distance = 1, 2, 4, ... for the boundary lanes
+ * (segmented = false) first, then for the accumulation lanes segmented by
+ * the head of partition (segmented = true).
+ */
+DEVICE_FUNCTION(void)
+gpuwinagg_scan(kern_context *kcxt,
+			   kern_gpusort *kgpusort,
+			   kern_gpuwinagg *kgwagg,
+			   cl_bool segmented,
+			   cl_uint distance,
+			   cl_uint src_buf)
+{
+	cl_uint			nitems = kgwagg->nitems;
+	cl_uint			dst_buf = 1 - src_buf;
+	cl_uint			index;
+	cl_uint			lane;
+
+	/* quick bailout if any error happen in the prior kernel */
+	if (__syncthreads_count(kgpusort->kerror.errcode) != 0)
+		return;
+
+	for (index = get_global_id();
+		 index < nitems;
+		 index += get_global_size())
+	{
+		cl_ulong   *src;
+		cl_ulong   *dst;
+		cl_ulong	part_head;
+		cl_bool		has_prev;
+
+		src = KERN_GPUWINAGG_LANE(kgwagg, src_buf, GPUWINAGG_LANE__PART_HEAD);
+		part_head = src[index];
+		has_prev = (index >= distance &&
+					(!segmented || index - distance >= part_head));
+		for (lane=0; lane < kgwagg->nlanes; lane++)
+		{
+			cl_ulong	x, y;
+
+			src = KERN_GPUWINAGG_LANE(kgwagg, src_buf, lane);
+			dst = KERN_GPUWINAGG_LANE(kgwagg, dst_buf, lane);
+			x = src[index];
+			if (!segmented)
+			{
+				if (lane == GPUWINAGG_LANE__PART_HEAD ||
+					lane == GPUWINAGG_LANE__PEER_HEAD)
+				{
+					/* forward max-scan */
+					if (index >= distance)
+						x = Max(x, src[index - distance]);
+				}
+				else if (lane == GPUWINAGG_LANE__PART_TAIL ||
+						 lane == GPUWINAGG_LANE__PEER_TAIL)
+				{
+					/* backward min-scan */
+					if (index + distance < nitems)
+						x = Min(x, src[index + distance]);
+				}
+			}
+			else if (lane >= GPUWINAGG_LANE__DENSE_RANK && has_prev)
+			{
+				cl_char		func = GPUWINAGG_FUNC__SUM_INT;
+
+				y = src[index - distance];
+				if (lane >= GPUWINAGG_NUM_FIXED_LANES &&
+					((lane - GPUWINAGG_NUM_FIXED_LANES) & 1) == 0)
+				{
+					/* value lane; counter lanes are always SUM_INT */
+					func = kgwagg->funcs[(lane -
+										  GPUWINAGG_NUM_FIXED_LANES) / 2].func;
+				}
+				x = gpuwinagg_combine(func, y, x);
+			}
+			dst[index] = x;
+		}
+	}
+}
+
+/*
+ * gpuwinagg_final
+ *
+ * It writes out the result of window functions for each sorted item.
+ */
+DEVICE_FUNCTION(void)
+gpuwinagg_final(kern_context *kcxt,
+				kern_gpusort *kgpusort,
+				kern_gpuwinagg *kgwagg,
+				cl_uint src_buf)
+{
+	cl_uint			nitems = kgwagg->nitems;
+	cl_ulong	   *part_head;
+	cl_ulong	   *peer_head;
+	cl_ulong	   *part_tail;
+	cl_ulong	   *peer_tail;
+	cl_ulong	   *dense_rank;
+	cl_uint			index;
+	cl_uint			fn;
+
+	/* quick bailout if any error happen in the prior kernel */
+	if (__syncthreads_count(kgpusort->kerror.errcode) != 0)
+		return;
+
+	part_head = KERN_GPUWINAGG_LANE(kgwagg, src_buf,
+									GPUWINAGG_LANE__PART_HEAD);
+	peer_head = KERN_GPUWINAGG_LANE(kgwagg, src_buf,
+									GPUWINAGG_LANE__PEER_HEAD);
+	part_tail = KERN_GPUWINAGG_LANE(kgwagg, src_buf,
+									GPUWINAGG_LANE__PART_TAIL);
+	peer_tail = KERN_GPUWINAGG_LANE(kgwagg, src_buf,
+									GPUWINAGG_LANE__PEER_TAIL);
+	dense_rank = KERN_GPUWINAGG_LANE(kgwagg, src_buf,
+									 GPUWINAGG_LANE__DENSE_RANK);
+	for (index = get_global_id();
+		 index < nitems;
+		 index += get_global_size())
+	{
+		for (fn=0; fn < kgwagg->nfuncs; fn++)
+		{
+			kern_gpuwinagg_func *wfunc = &kgwagg->funcs[fn];
+			cl_ulong   *values = KERN_GPUWINAGG_VALUES(kgwagg, fn);
+			cl_bool	   *isnull = KERN_GPUWINAGG_ISNULL(kgwagg, fn);
+			cl_ulong	count;
+			cl_uint		pos;
+
+			switch (wfunc->func)
+			{
+				case GPUWINAGG_FUNC__ROW_NUMBER:
+					values[index] = index - part_head[index] + 1;
+					isnull[index] = false;
+					continue;
+				case GPUWINAGG_FUNC__RANK:
+					values[index] = peer_head[index] - part_head[index] + 1;
+					isnull[index] = false;
+					continue;
+				case GPUWINAGG_FUNC__DENSE_RANK:
+					values[index] = dense_rank[index];
+					isnull[index] = false;
+					continue;
+				default:
+					break;
+			}
+			/* aggregate functions; pick up the tail of the frame */
+			if (wfunc->frame == GPUWINAGG_FRAME__ROWS_RUNNING)
+				pos = index;
+			else if (wfunc->frame == GPUWINAGG_FRAME__PEER_RUNNING)
+				pos = peer_tail[index];
+			else
+				pos = part_tail[index];
+			count = KERN_GPUWINAGG_LANE(kgwagg, src_buf,
+										KERN_GPUWINAGG_COUNT_LANE(fn))[pos];
+			if (wfunc->func == GPUWINAGG_FUNC__COUNT)
+			{
+				values[index] = count;
+				isnull[index] = false;
+			}
+			else
+			{
+				values[index] = KERN_GPUWINAGG_LANE(kgwagg, src_buf,
+									KERN_GPUWINAGG_VALUE_LANE(fn))[pos];
+				isnull[index] = (count == 0);
+			}
+		}
+	}
+}
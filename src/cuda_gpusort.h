@@ -45,6 +45,107 @@ typedef struct {
 #define BITONIC_MAX_LOCAL_SHIFT		12
 #define BITONIC_MAX_LOCAL_SZ		(1<<BITONIC_MAX_LOCAL_SHIFT)
 
+/*
+ * kern_gpusort_radix - working buffer of the radix sort
+ *
+ * If all the sort keys are fixed-length integer, floating point or
+ * date/time types, GpuSort runs LSD radix sort instead of the bitonic
+ * sorting. Each key is translated to an unsigned 64bit value whose
+ * order is identical to the key, and sorted by 8 passes of 8bit digits
+ * from the least significant one, then by one more pass of the null
+ * digit. The keys are processed from the last one to the first; it
+ * works because every pass is a stable sort.
+ * The result index is double buffered by gpusortResultIndex and the
+ * index buffer below.
+ */
+#define GPUSORT_RADIX_BITS			8
+#define GPUSORT_RADIX_NBUCKETS		(1<<GPUSORT_RADIX_BITS)
+#define GPUSORT_RADIX_NULL_SHIFT	64		/* pass of the null digit */
+#define GPUSORT_RADIX_BLOCKSZ		256		/* == GPUSORT_RADIX_NBUCKETS */
+#define GPUSORT_RADIX_TILESZ		4096	/* # of items per block */
+#define GPUSORT_RADIX_NPASSES		(64 / GPUSORT_RADIX_BITS + 1)
+
+typedef struct {
+	cl_uint			nitems;
+	cl_uint			nblocks;		/* # of blocks for histogram/scatter */
+	size_t			keys_offset;	/* cl_ulong keys[nitems] by row-index */
+	size_t			nulls_offset;	/* cl_uchar nulls[nitems] by row-index */
+	size_t			index_offset;	/* cl_uint index[nitems] */
+	size_t			hist_offset;	/* cl_uint hist[NBUCKETS * nblocks] */
+	size_t			length;			/* length of the entire buffer */
+} kern_gpusort_radix;
+
+#define KERN_GPUSORT_RADIX_KEYS(kradix)								((cl_ulong *)((char *)(kradix) + (kradix)->keys_offset))
+#define KERN_GPUSORT_RADIX_NULLS(kradix)							((cl_uchar *)((char *)(kradix) + (kradix)->nulls_offset))
+#define KERN_GPUSORT_RADIX_INDEX(kradix)							((cl_uint *)((char *)(kradix) + (kradix)->index_offset))
+#define KERN_GPUSORT_RADIX_HIST(kradix)								((cl_uint *)((char *)(kradix) + (kradix)->hist_offset))
+
+/*
+ * kern_gpuwinagg - control structure of GpuWindowAgg
+ *
+ * Window functions are computed on the result index sorted by the
+ * PARTITION BY / ORDER BY keys. Each lane is an array of nitems 64bit
+ * values, and the kernels run a series of (segmented) Hillis-Steele
+ * scans over the lanes. Lanes are double buffered, so the buffer has
+ * 2 * nlanes * nitems items. Results are stored per window function.
+ */
+#define GPUWINAGG_FUNC__ROW_NUMBER		1
+#define GPUWINAGG_FUNC__RANK			2
+#define GPUWINAGG_FUNC__DENSE_RANK		3
+#define GPUWINAGG_FUNC__COUNT			4
+#define GPUWINAGG_FUNC__SUM_INT			5
+#define GPUWINAGG_FUNC__SUM_FP			6
+#define GPUWINAGG_FUNC__MIN_INT			7
+#define GPUWINAGG_FUNC__MAX_INT			8
+#define GPUWINAGG_FUNC__MIN_FP			9
+#define GPUWINAGG_FUNC__MAX_FP			10
+
+#define GPUWINAGG_FRAME__ROWS_RUNNING	1	/* ROWS UNBOUNDED PRECEDING
+											 * AND CURRENT ROW */
+#define GPUWINAGG_FRAME__PEER_RUNNING	2	/* RANGE/GROUPS UNBOUNDED
+											 * PRECEDING AND CURRENT ROW */
+#define GPUWINAGG_FRAME__PARTITION		3	/* whole partition */
+
+#define GPUWINAGG_LANE__PART_HEAD		0	/* head of the partition */
+#define GPUWINAGG_LANE__PEER_HEAD		1	/* head of the peer group */
+#define GPUWINAGG_LANE__PART_TAIL		2	/* tail of the partition */
+#define GPUWINAGG_LANE__PEER_TAIL		3	/* tail of the peer group */
+#define GPUWINAGG_LANE__DENSE_RANK		4	/* # of peer groups */
+#define GPUWINAGG_NUM_FIXED_LANES		5
+/* followed by value and count lanes for each aggregate function */
+
+typedef struct {
+	cl_char			func;		/* one of GPUWINAGG_FUNC__* */
+	cl_char			frame;		/* one of GPUWINAGG_FRAME__* */
+	cl_short		argidx;		/* index of argument, or -1 */
+} kern_gpuwinagg_func;
+
+typedef struct {
+	cl_uint			nitems;		/* copy of gpusortResultIndex->nitems */
+	cl_uint			part_nkeys;	/* # of PARTITION BY keys */
+	cl_uint			nkeys;		/* # of PARTITION BY + ORDER BY keys */
+	cl_uint			nargs;		/* # of argument values */
+	cl_uint			nfuncs;		/* # of window functions */
+	cl_uint			nlanes;		/* # of lanes */
+	size_t			lanes_offset;	/* offset to the lanes buffer */
+	size_t			values_offset;	/* offset to the result values */
+	size_t			isnull_offset;	/* offset to the result nullmap */
+	kern_gpuwinagg_func funcs[FLEXIBLE_ARRAY_MEMBER];
+} kern_gpuwinagg;
+
+#define KERN_GPUWINAGG_LANE(kgwagg,buf,lane)					\
+	((cl_ulong *)((char *)(kgwagg) + (kgwagg)->lanes_offset) +	\
+	 ((size_t)(buf) * (kgwagg)->nlanes + (lane)) * (kgwagg)->nitems)
+#define KERN_GPUWINAGG_VALUES(kgwagg,fn)						\
+	((cl_ulong *)((char *)(kgwagg) + (kgwagg)->values_offset) +	\
+	 (size_t)(fn) * (kgwagg)->nitems)
+#define KERN_GPUWINAGG_ISNULL(kgwagg,fn)						\
+	((cl_bool *)((char *)(kgwagg) + (kgwagg)->isnull_offset) +	\
+	 (size_t)(fn) * (kgwagg)->nitems)
+#define KERN_GPUWINAGG_VALUE_LANE(fn)	(GPUWINAGG_NUM_FIXED_LANES + 2 * (fn))
+#define KERN_GPUWINAGG_COUNT_LANE(fn)	(GPUWINAGG_NUM_FIXED_LANES + 2 * (fn) + 1)
+#define GPUWINAGG_MAX_NARGS			64
+
 #ifdef __CUDACC__
 /*
  * gpusort_quals_eval - evaluation of device qualifier
@@ -61,6 +162,62 @@ gpusort_keycomp(kern_context *kcxt,
 				kern_data_store *kds_src,
 				cl_uint x_index,
 				cl_uint y_index);
+/*
+ * gpuwinagg_keycomp - comparison of two keys with the depth of equality;
+ * *p_depth is set to the number of leading keys that are equal.
+ */
+DEVICE_FUNCTION(cl_int)
+gpuwinagg_keycomp(kern_context *kcxt,
+				  kern_data_store *kds_src,
+				  cl_uint x_index,
+				  cl_uint y_index,
+				  cl_int *p_depth);
+/*
+ * gpusort_radix_key - translation of the sort key to the radix key.
+ * It returns the null digit (0 or 1) according to NULLS FIRST/LAST, and
+ * *p_key is set to the key whose unsigned order is identical to the sort
+ * key; already inverted if DESC.
+ */
+DEVICE_FUNCTION(cl_uint)
+gpusort_radix_key(kern_context *kcxt,
+				  kern_data_store *kds_src,
+				  cl_uint row_index,
+				  cl_uint keyidx,
+				  cl_ulong *p_key);
+
+DEVICE_INLINE(cl_ulong)
+gpusort_radix_int_key(cl_long ival)
+{
+	return (cl_ulong)ival ^ 0x8000000000000000UL;
+}
+
+DEVICE_INLINE(cl_ulong)
+gpusort_radix_fp_key(cl_double fval)
+{
+	cl_long		ival;
+
+	/* NaN is larger than any other values, and -0.0 equals to 0.0 */
+	if (isnan(fval))
+		return ~0UL;
+	if (fval == 0.0)
+		return 0x8000000000000000UL;
+	ival = __double_as_longlong(fval);
+	if (ival < 0)
+		return ~((cl_ulong)ival);
+	return (cl_ulong)ival | 0x8000000000000000UL;
+}
+
+/*
+ * gpuwinagg_fetch_args - fetch argument values of the window functions.
+ * integer values are stored as cl_long, and floating point values are
+ * stored as bit pattern of cl_double.
+ */
+DEVICE_FUNCTION(void)
+gpuwinagg_fetch_args(kern_context *kcxt,
+					 kern_data_store *kds_src,
+					 cl_uint row_index,
+					 cl_ulong *values,
+					 cl_bool *isnull);
 /*
  * GpuSort main logic;
  */
@@ -82,6 +239,45 @@ DEVICE_FUNCTION(void)
 gpusort_bitonic_merge(kern_context *kcxt,
 					  kern_gpusort *kgpusort,
 					  kern_data_store *kds_src);
+DEVICE_FUNCTION(void)
+gpusort_radix_setup(kern_context *kcxt,
+					kern_gpusort *kgpusort,
+					kern_data_store *kds_src,
+					kern_gpusort_radix *kradix,
+					cl_uint keyidx);
+DEVICE_FUNCTION(void)
+gpusort_radix_histogram(kern_context *kcxt,
+						kern_gpusort *kgpusort,
+						kern_gpusort_radix *kradix,
+						cl_uint src_buf,
+						cl_uint shift);
+DEVICE_FUNCTION(void)
+gpusort_radix_prefix(kern_context *kcxt,
+					 kern_gpusort *kgpusort,
+					 kern_gpusort_radix *kradix);
+DEVICE_FUNCTION(void)
+gpusort_radix_scatter(kern_context *kcxt,
+					  kern_gpusort *kgpusort,
+					  kern_gpusort_radix *kradix,
+					  cl_uint src_buf,
+					  cl_uint shift);
+DEVICE_FUNCTION(void)
+gpuwinagg_setup(kern_context *kcxt,
+				kern_gpusort *kgpusort,
+				kern_data_store *kds_src,
+				kern_gpuwinagg *kgwagg);
+DEVICE_FUNCTION(void)
+gpuwinagg_scan(kern_context *kcxt,
+			   kern_gpusort *kgpusort,
+			   kern_gpuwinagg *kgwagg,
+			   cl_bool segmented,
+			   cl_uint distance,
+			   cl_uint src_buf);
+DEVICE_FUNCTION(void)
+gpuwinagg_final(kern_context *kcxt,
+				kern_gpusort *kgpusort,
+				kern_gpuwinagg *kgwagg,
+				cl_uint src_buf);
 #endif	/* __CUDACC__ */
 
 #ifdef	__CUDACC_RTC__
@@ -130,5 +326,93 @@ kern_gpusort_bitonic_merge(kern_gpusort *kgpusort,
 	gpusort_bitonic_merge(&u.kcxt, kgpusort, kds_src);
 	kern_writeback_error_status(&kgpusort->kerror, &u.kcxt);
 }
+
+KERNEL_FUNCTION(void)
+kern_gpusort_radix_setup(kern_gpusort *kgpusort,
+						 kern_data_store *kds_src,
+						 kern_gpusort_radix *kradix,
+						 cl_uint keyidx)
+{
+	DECL_KERNEL_CONTEXT(u);
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, &kgpusort->kparams);
+	gpusort_radix_setup(&u.kcxt, kgpusort, kds_src, kradix, keyidx);
+	kern_writeback_error_status(&kgpusort->kerror, &u.kcxt);
+}
+
+KERNEL_FUNCTION(void)
+kern_gpusort_radix_histogram(kern_gpusort *kgpusort,
+							 kern_gpusort_radix *kradix,
+							 cl_uint src_buf,
+							 cl_uint shift)
+{
+	DECL_KERNEL_CONTEXT(u);
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, &kgpusort->kparams);
+	gpusort_radix_histogram(&u.kcxt, kgpusort, kradix, src_buf, shift);
+	kern_writeback_error_status(&kgpusort->kerror, &u.kcxt);
+}
+
+KERNEL_FUNCTION_MAXTHREADS(void)
+kern_gpusort_radix_prefix(kern_gpusort *kgpusort,
+						  kern_gpusort_radix *kradix)
+{
+	DECL_KERNEL_CONTEXT(u);
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, &kgpusort->kparams);
+	gpusort_radix_prefix(&u.kcxt, kgpusort, kradix);
+	kern_writeback_error_status(&kgpusort->kerror, &u.kcxt);
+}
+
+KERNEL_FUNCTION(void)
+kern_gpusort_radix_scatter(kern_gpusort *kgpusort,
+						   kern_gpusort_radix *kradix,
+						   cl_uint src_buf,
+						   cl_uint shift)
+{
+	DECL_KERNEL_CONTEXT(u);
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, &kgpusort->kparams);
+	gpusort_radix_scatter(&u.kcxt, kgpusort, kradix, src_buf, shift);
+	kern_writeback_error_status(&kgpusort->kerror, &u.kcxt);
+}
+
+KERNEL_FUNCTION(void)
+kern_gpuwinagg_setup(kern_gpusort *kgpusort,
+					 kern_data_store *kds_src,
+					 kern_gpuwinagg *kgwagg)
+{
+	DECL_KERNEL_CONTEXT(u);
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, &kgpusort->kparams);
+	gpuwinagg_setup(&u.kcxt, kgpusort, kds_src, kgwagg);
+	kern_writeback_error_status(&kgpusort->kerror, &u.kcxt);
+}
+
+KERNEL_FUNCTION(void)
+kern_gpuwinagg_scan(kern_gpusort *kgpusort,
+					kern_gpuwinagg *kgwagg,
+					cl_bool segmented,
+					cl_uint distance,
+					cl_uint src_buf)
+{
+	DECL_KERNEL_CONTEXT(u);
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, &kgpusort->kparams);
+	gpuwinagg_scan(&u.kcxt, kgpusort, kgwagg, segmented, distance, src_buf);
+	kern_writeback_error_status(&kgpusort->kerror, &u.kcxt);
+}
+
+KERNEL_FUNCTION(void)
+kern_gpuwinagg_final(kern_gpusort *kgpusort,
+					 kern_gpuwinagg *kgwagg,
+					 cl_uint src_buf)
+{
+	DECL_KERNEL_CONTEXT(u);
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, &kgpusort->kparams);
+	gpuwinagg_final(&u.kcxt, kgpusort, kgwagg, src_buf);
+	kern_writeback_error_status(&kgpusort->kerror, &u.kcxt);
+}
 #endif	/* __CUDACC_RTC__ */
 #endif	/* CUDA_GPUSORT_H */
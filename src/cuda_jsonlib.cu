@@ -823,6 +823,345 @@ pgfn_jsonb_exists(kern_context *kcxt,
 	return result;
 }
 
+/*
+ * __jsonb_exists_key - same as jsonb_exists() at the CPU side; the key
+ * matches to either of object keys or string elements of the array.
+ */
+STATIC_FUNCTION(cl_bool)
+__jsonb_exists_key(JsonbContainer *jc, char *key, cl_int keylen)
+{
+	cl_uint		jheader = __Fetch(&jc->header);
+
+	if (JsonContainerIsObject(jheader))
+		return (findJsonbIndexFromObject(jc, key, keylen) >= 0);
+	if (JsonContainerIsArray(jheader))
+	{
+		cl_uint		count = JsonContainerSize(jheader);
+		char	   *base = (char *)(jc->children + count);
+		cl_uint		j;
+
+		for (j=0; j < count; j++)
+		{
+			JEntry		entry = __Fetch(&jc->children[j]);
+
+			if (JBE_ISSTRING(entry) &&
+				compareJsonbStringValue(base + getJsonbOffset(jc, j),
+										getJsonbLength(jc, j),
+										key, keylen) == 0)
+				return true;
+		}
+	}
+	return false;
+}
+
+STATIC_FUNCTION(pg_bool_t)
+__jsonb_exists_keys(kern_context *kcxt,
+					pg_jsonb_t arg1, pg_bytea_t arg2, cl_bool is_any)
+{
+	pg_bool_t	result;
+	char	   *jdata;
+	char	   *kdata;
+	cl_int		jlen, klen;
+
+	if (!pg_varlena_datum_extract(kcxt, arg1, &jdata, &jlen) ||
+		!pg_varlena_datum_extract(kcxt, arg2, &kdata, &klen))
+	{
+		result.isnull = true;
+	}
+	else
+	{
+		kern_jsonb_keys *keys = (kern_jsonb_keys *)kdata;
+		cl_uint		i;
+
+		result.isnull = false;
+		result.value  = !is_any;
+		for (i=0; i < keys->nitems; i++)
+		{
+			kern_jsonb_key *key = &keys->items[i];
+
+			if (__jsonb_exists_key((JsonbContainer *)jdata,
+								   kdata + key->offset,
+								   key->length) == is_any)
+			{
+				result.value = is_any;
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_jsonb_exists_any(kern_context *kcxt,
+					  pg_jsonb_t arg1, pg_bytea_t arg2)
+{
+	return __jsonb_exists_keys(kcxt, arg1, arg2, true);
+}
+
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_jsonb_exists_all(kern_context *kcxt,
+					  pg_jsonb_t arg1, pg_bytea_t arg2)
+{
+	return __jsonb_exists_keys(kcxt, arg1, arg2, false);
+}
+
+/*
+ * jsonb containment; logic of JsonbDeepContains()
+ */
+STATIC_FUNCTION(cl_bool)
+__jsonb_scalar_equal(kern_context *kcxt,
+					 JsonbContainer *jc1, cl_int index1, char *base1,
+					 JsonbContainer *jc2, cl_int index2, char *base2)
+{
+	JEntry		entry1 = __Fetch(&jc1->children[index1]);
+	JEntry		entry2 = __Fetch(&jc2->children[index2]);
+
+	if ((entry1 & JENTRY_TYPEMASK) != (entry2 & JENTRY_TYPEMASK))
+		return false;
+	if (JBE_ISSTRING(entry1))
+	{
+		return (compareJsonbStringValue(base1 + getJsonbOffset(jc1, index1),
+										getJsonbLength(jc1, index1),
+										base2 + getJsonbOffset(jc2, index2),
+										getJsonbLength(jc2, index2)) == 0);
+	}
+	else if (JBE_ISNUMERIC(entry1))
+	{
+		pg_numeric_t	num1, num2;
+		pg_bool_t		rv;
+
+		num1 = pg_numeric_from_varlena(kcxt, (varlena *)
+									   (base1 + INTALIGN(getJsonbOffset(jc1, index1))));
+		num2 = pg_numeric_from_varlena(kcxt, (varlena *)
+									   (base2 + INTALIGN(getJsonbOffset(jc2, index2))));
+		rv = pgfn_numeric_eq(kcxt, num1, num2);
+		return (!rv.isnull && rv.value);
+	}
+	/* null, true or false */
+	return true;
+}
+
+STATIC_FUNCTION(cl_bool)
+__jsonb_deep_contains(kern_context *kcxt,
+					  JsonbContainer *val,		/* may not be aligned */
+					  JsonbContainer *tmpl)		/* may not be aligned */
+{
+	cl_uint		vheader = __Fetch(&val->header);
+	cl_uint		theader = __Fetch(&tmpl->header);
+	cl_uint		vcount = JsonContainerSize(vheader);
+	cl_uint		tcount = JsonContainerSize(theader);
+	char	   *vbase;
+	char	   *tbase;
+	cl_uint		i, j;
+
+	if (JsonContainerIsObject(vheader) != JsonContainerIsObject(theader))
+		return false;
+	if (JsonContainerIsObject(theader))
+	{
+		if (vcount < tcount)
+			return false;
+		vbase = (char *)(val->children + 2 * vcount);
+		tbase = (char *)(tmpl->children + 2 * tcount);
+		for (j=0; j < tcount; j++)
+		{
+			JEntry		ventry;
+			JEntry		tentry;
+			cl_int		index;
+
+			index = findJsonbIndexFromObject(val,
+											 tbase + getJsonbOffset(tmpl, j),
+											 getJsonbLength(tmpl, j));
+			if (index < 0)
+				return false;
+			index += vcount;	/* index of the value, not key */
+			ventry = __Fetch(&val->children[index]);
+			tentry = __Fetch(&tmpl->children[j + tcount]);
+			if (JBE_ISCONTAINER(tentry))
+			{
+				if (!JBE_ISCONTAINER(ventry) ||
+					!__jsonb_deep_contains(kcxt, (JsonbContainer *)
+										   (vbase + INTALIGN(getJsonbOffset(val, index))),
+										   (JsonbContainer *)
+										   (tbase + INTALIGN(getJsonbOffset(tmpl, j + tcount)))))
+					return false;
+			}
+			else if (JBE_ISCONTAINER(ventry) ||
+					 !__jsonb_scalar_equal(kcxt,
+										   val, index, vbase,
+										   tmpl, j + tcount, tbase))
+				return false;
+		}
+		return true;
+	}
+	/* a raw scalar may not contain an array */
+	if (JsonContainerIsScalar(vheader) && !JsonContainerIsScalar(theader))
+		return false;
+	vbase = (char *)(val->children + vcount);
+	tbase = (char *)(tmpl->children + tcount);
+	for (j=0; j < tcount; j++)
+	{
+		JEntry		tentry = __Fetch(&tmpl->children[j]);
+		cl_bool		found = false;
+
+		for (i=0; !found && i < vcount; i++)
+		{
+			JEntry		ventry = __Fetch(&val->children[i]);
+
+			if (JBE_ISCONTAINER(tentry))
+			{
+				if (JBE_ISCONTAINER(ventry) &&
+					__jsonb_deep_contains(kcxt, (JsonbContainer *)
+										  (vbase + INTALIGN(getJsonbOffset(val, i))),
+										  (JsonbContainer *)
+										  (tbase + INTALIGN(getJsonbOffset(tmpl, j)))))
+					found = true;
+			}
+			else if (!JBE_ISCONTAINER(ventry) &&
+					 __jsonb_scalar_equal(kcxt,
+										  val, i, vbase,
+										  tmpl, j, tbase))
+				found = true;
+		}
+		if (!found)
+			return false;
+	}
+	return true;
+}
+
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_jsonb_contains(kern_context *kcxt,
+					pg_jsonb_t arg1, pg_jsonb_t arg2)
+{
+	pg_bool_t	result;
+	char	   *jdata1, *jdata2;
+	cl_int		jlen1, jlen2;
+
+	if (!pg_varlena_datum_extract(kcxt, arg1, &jdata1, &jlen1) ||
+		!pg_varlena_datum_extract(kcxt, arg2, &jdata2, &jlen2))
+	{
+		result.isnull = true;
+	}
+	else
+	{
+		result.isnull = false;
+		result.value = __jsonb_deep_contains(kcxt,
+											 (JsonbContainer *)jdata1,
+											 (JsonbContainer *)jdata2);
+	}
+	return result;
+}
+
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_jsonb_contained(kern_context *kcxt,
+					 pg_jsonb_t arg1, pg_jsonb_t arg2)
+{
+	return pgfn_jsonb_contains(kcxt, arg2, arg1);
+}
+
+/*
+ * jsonb path lookup (#>, #>>)
+ */
+STATIC_FUNCTION(cl_bool)
+__jsonb_walk_path(JsonbContainer *jc,		/* may not be aligned */
+				  kern_jsonb_keys *keys,
+				  JsonbContainer **p_jc, cl_int *p_index, char **p_base)
+{
+	cl_uint		k;
+
+	for (k=0; k < keys->nitems; k++)
+	{
+		kern_jsonb_key *key = &keys->items[k];
+		cl_uint		jheader = __Fetch(&jc->header);
+		cl_uint		count = JsonContainerSize(jheader);
+		char	   *base;
+		cl_int		index;
+		JEntry		entry;
+
+		if (JsonContainerIsObject(jheader))
+		{
+			base = (char *)(jc->children + 2 * count);
+			index = findJsonbIndexFromObject(jc, (char *)keys + key->offset,
+											 key->length);
+			if (index < 0)
+				return false;
+			index += count;		/* index of the value, not key */
+		}
+		else if (JsonContainerIsArray(jheader) &&
+				 !JsonContainerIsScalar(jheader))
+		{
+			if (!key->has_index)
+				return false;
+			base = (char *)(jc->children + count);
+			index = key->index;
+			if (index < 0)
+				index += count;	/* index from the tail, if negative */
+			if (index < 0 || index >= count)
+				return false;
+		}
+		else
+			return false;
+
+		if (k == keys->nitems - 1)
+		{
+			*p_jc = jc;
+			*p_index = index;
+			*p_base = base;
+			return true;
+		}
+		entry = __Fetch(&jc->children[index]);
+		if (!JBE_ISCONTAINER(entry))
+			return false;
+		jc = (JsonbContainer *)(base + INTALIGN(getJsonbOffset(jc, index)));
+	}
+	return false;
+}
+
+DEVICE_FUNCTION(pg_jsonb_t)
+pgfn_jsonb_extract_path(kern_context *kcxt,
+						pg_jsonb_t arg1, pg_bytea_t arg2)
+{
+	pg_jsonb_t	result;
+	char	   *jdata;
+	char	   *kdata;
+	cl_int		jlen, klen;
+	JsonbContainer *jc;
+	cl_int		index;
+	char	   *base;
+
+	if (!pg_varlena_datum_extract(kcxt, arg1, &jdata, &jlen) ||
+		!pg_varlena_datum_extract(kcxt, arg2, &kdata, &klen) ||
+		!__jsonb_walk_path((JsonbContainer *)jdata,
+						   (kern_jsonb_keys *)kdata,
+						   &jc, &index, &base))
+		result.isnull = true;
+	else
+		result = extractJsonbItemFromContainer(kcxt, jc, index, base);
+	return result;
+}
+
+DEVICE_FUNCTION(pg_text_t)
+pgfn_jsonb_extract_path_text(kern_context *kcxt,
+							 pg_jsonb_t arg1, pg_bytea_t arg2)
+{
+	pg_text_t	result;
+	char	   *jdata;
+	char	   *kdata;
+	cl_int		jlen, klen;
+	JsonbContainer *jc;
+	cl_int		index;
+	char	   *base;
+
+	if (!pg_varlena_datum_extract(kcxt, arg1, &jdata, &jlen) ||
+		!pg_varlena_datum_extract(kcxt, arg2, &kdata, &klen) ||
+		!__jsonb_walk_path((JsonbContainer *)jdata,
+						   (kern_jsonb_keys *)kdata,
+						   &jc, &index, &base))
+		result.isnull = true;
+	else
+		result = extractTextItemFromContainer(kcxt, jc, index, base);
+	return result;
+}
+
 /*
  * Special shortcut for CoerceViaIO; fetch jsonb element as numeric values
  */
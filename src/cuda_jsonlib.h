@@ -28,6 +28,25 @@ STROMCL_EXTERNAL_COMP_HASH_TEMPLATE(jsonb)
 STROMCL_UNSUPPORTED_ARROW_TEMPLATE(jsonb)
 #endif	/* PG_JSONB_TYPE_DEFINED */
 
+/*
+ * kern_jsonb_keys - constant text[] for jsonb key existence (?|, ?&) and
+ * path lookup (#>, #>>), preprocessed on the host side by codegen.
+ */
+typedef struct
+{
+	cl_uint		offset;		/* offset of the key from head of kern_jsonb_keys */
+	cl_uint		length;		/* length of the key */
+	cl_int		index;		/* array index, if key is a valid integer */
+	cl_bool		has_index;	/* true, if 'index' is valid */
+	cl_char		__padding__[3];
+} kern_jsonb_key;
+
+typedef struct
+{
+	cl_uint		nitems;
+	kern_jsonb_key items[FLEXIBLE_ARRAY_MEMBER];
+} kern_jsonb_keys;
+
 #ifdef __CUDACC__
 /* jsonb operator functions  */
 DEVICE_FUNCTION(pg_jsonb_t)
@@ -45,6 +64,24 @@ pgfn_jsonb_array_element_text(kern_context *kcxt,
 DEVICE_FUNCTION(pg_bool_t)
 pgfn_jsonb_exists(kern_context *kcxt,
 				  pg_jsonb_t arg1, pg_text_t arg2);
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_jsonb_exists_any(kern_context *kcxt,
+					  pg_jsonb_t arg1, pg_bytea_t arg2);
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_jsonb_exists_all(kern_context *kcxt,
+					  pg_jsonb_t arg1, pg_bytea_t arg2);
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_jsonb_contains(kern_context *kcxt,
+					pg_jsonb_t arg1, pg_jsonb_t arg2);
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_jsonb_contained(kern_context *kcxt,
+					 pg_jsonb_t arg1, pg_jsonb_t arg2);
+DEVICE_FUNCTION(pg_jsonb_t)
+pgfn_jsonb_extract_path(kern_context *kcxt,
+						pg_jsonb_t arg1, pg_bytea_t arg2);
+DEVICE_FUNCTION(pg_text_t)
+pgfn_jsonb_extract_path_text(kern_context *kcxt,
+							 pg_jsonb_t arg1, pg_bytea_t arg2);
 /* special shortcut for CoerceViaIO; fetch jsonb element as numeric values */
 DEVICE_FUNCTION(pg_numeric_t)
 pgfn_jsonb_object_field_as_numeric(kern_context *kcxt,
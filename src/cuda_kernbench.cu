@@ -0,0 +1,372 @@
+/*
+ * cuda_kernbench.cu
+ *
+ * Device kernels of the micro benchmark of the device functions; driven
+ * by utils/kernbench. Not a part of the libraries installed.
+ * ----
+ * Copyright 2011-2020 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2020 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "cuda_common.h"
+#include "cuda_numeric.h"
+#include "cuda_textlib.h"
+#include "cuda_jsonlib.h"
+#include "cuda_gpupreagg.h"
+
+/*
+ * NOTE: every kernel below runs the grid-stride loop by the unit of thread
+ * block, so all the threads in a block always execute the same number of
+ * iterations, then the results are counted by pgstromStairlikeBinaryCount
+ * or pgstromStairlikeSum, and added to the global counter once per block.
+ */
+
+/*
+ * kernbench_text_like - text LIKE pattern by GenericMatchText
+ */
+KERNEL_FUNCTION(void)
+kernbench_text_like(kern_parambuf *kparams,
+					kern_errorbuf *kerror,
+					cl_uint nitems,
+					cl_uint *vl_offsets,	/* in: offset of varlena */
+					char *vl_buffer,		/* in: varlena buffer */
+					varlena *vl_pattern,	/* in: LIKE pattern */
+					cl_uint *p_nmatched)	/* out */
+{
+	DECL_KERNEL_CONTEXT(u);
+	pg_text_t	pattern;
+	cl_uint		base;
+	cl_uint		count;
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
+	pattern.value = (char *)vl_pattern;
+	pattern.isnull = false;
+	pattern.length = -1;
+	for (base = get_global_base(); base < nitems; base += get_global_size())
+	{
+		cl_uint		index = base + get_local_id();
+		pg_text_t	datum;
+		pg_bool_t	rv;
+
+		rv.isnull = true;
+		if (index < nitems)
+		{
+			datum.value = vl_buffer + vl_offsets[index];
+			datum.isnull = false;
+			datum.length = -1;
+			rv = pgfn_textlike(&u.kcxt, datum, pattern);
+		}
+		pgstromStairlikeBinaryCount(!rv.isnull && rv.value, &count);
+		if (get_local_id() == 0 && count > 0)
+			atomicAdd(p_nmatched, count);
+	}
+	kern_writeback_error_status(kerror, &u.kcxt);
+}
+
+/*
+ * kernbench_jsonb_field - jsonb ->> text by the binary search on keys
+ */
+KERNEL_FUNCTION(void)
+kernbench_jsonb_field(kern_parambuf *kparams,
+					  kern_errorbuf *kerror,
+					  cl_uint nitems,
+					  cl_uint *vl_offsets,	/* in: offset of jsonb */
+					  char *vl_buffer,		/* in: jsonb buffer */
+					  varlena *vl_key,		/* in: key to fetch */
+					  cl_uint *p_nfound)	/* out */
+{
+	DECL_KERNEL_CONTEXT(u);
+	pg_text_t	key;
+	cl_uint		base;
+	cl_uint		count;
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
+	key.value = (char *)vl_key;
+	key.isnull = false;
+	key.length = -1;
+	for (base = get_global_base(); base < nitems; base += get_global_size())
+	{
+		cl_uint		index = base + get_local_id();
+		pg_jsonb_t	datum;
+		pg_text_t	rv;
+
+		rv.isnull = true;
+		if (index < nitems)
+		{
+			datum.value = vl_buffer + vl_offsets[index];
+			datum.isnull = false;
+			datum.length = -1;
+			rv = pgfn_jsonb_object_field_text(&u.kcxt, datum, key);
+		}
+		pgstromStairlikeBinaryCount(!rv.isnull, &count);
+		if (get_local_id() == 0 && count > 0)
+			atomicAdd(p_nfound, count);
+	}
+	kern_writeback_error_status(kerror, &u.kcxt);
+}
+
+/*
+ * kernbench_numeric_add - numeric addition with rescaling, and comparison
+ */
+KERNEL_FUNCTION(void)
+kernbench_numeric_add(kern_parambuf *kparams,
+					  kern_errorbuf *kerror,
+					  cl_uint nitems,
+					  cl_long *x_values, cl_short x_scale,
+					  cl_long *y_values, cl_short y_scale,
+					  cl_uint *p_npositive)	/* out */
+{
+	DECL_KERNEL_CONTEXT(u);
+	pg_numeric_t	zero;
+	cl_uint			base;
+	cl_uint			count;
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
+	memset(&zero, 0, sizeof(pg_numeric_t));
+	for (base = get_global_base(); base < nitems; base += get_global_size())
+	{
+		cl_uint			index = base + get_local_id();
+		pg_numeric_t	x, y, z;
+		pg_bool_t		rv;
+
+		rv.isnull = true;
+		if (index < nitems)
+		{
+			x = zero;
+			x.value = __Int128_add(x.value, x_values[index]);
+			x.weight = x_scale;
+			y = zero;
+			y.value = __Int128_add(y.value, y_values[index]);
+			y.weight = y_scale;
+			z = pgfn_numeric_add(&u.kcxt, x, y);
+			rv = pgfn_numeric_gt(&u.kcxt, z, zero);
+		}
+		pgstromStairlikeBinaryCount(!rv.isnull && rv.value, &count);
+		if (get_local_id() == 0 && count > 0)
+			atomicAdd(p_npositive, count);
+	}
+	kern_writeback_error_status(kerror, &u.kcxt);
+}
+
+/*
+ * kernbench_hash_* - probe on the KDS_FORMAT_HASH (int4 key) as GpuHashJoin
+ * doing. The hash table is built on the device, so the host code need not
+ * know the layout of kern_data_store.
+ */
+#define KERNBENCH_HASH_TUPLE_OFFSET								\
+	MAXALIGN(offsetof(HeapTupleHeaderData, t_bits))
+#define KERNBENCH_HASH_ITEM_SIZE								\
+	MAXALIGN(offsetof(kern_hashitem, t.htup) +					\
+			 KERNBENCH_HASH_TUPLE_OFFSET + sizeof(cl_int))
+
+STATIC_INLINE(size_t)
+kernbench_hash_item_offset(kern_data_store *kds, cl_uint index)
+{
+	return (KERN_DATA_STORE_HEAD_LENGTH(kds) +
+			STROMALIGN(sizeof(cl_uint) * kds->nitems) +
+			STROMALIGN(sizeof(kern_hashslot) * kds->nslots) +
+			KERNBENCH_HASH_ITEM_SIZE * (size_t)index);
+}
+
+KERNEL_FUNCTION(void)
+kernbench_hash_length(cl_uint nitems, size_t *p_length)
+{
+	if (get_global_id() == 0)
+	{
+		*p_length = (STROMALIGN(offsetof(kern_data_store, colmeta[1])) +
+					 STROMALIGN(sizeof(cl_uint) * nitems) +
+					 STROMALIGN(sizeof(kern_hashslot) *
+								__KDS_NSLOTS(nitems)) +
+					 KERNBENCH_HASH_ITEM_SIZE * (size_t)nitems);
+	}
+}
+
+/* kds_hash must be cleared by zero prior to the call */
+KERNEL_FUNCTION(void)
+kernbench_hash_setup(kern_data_store *kds_hash,
+					 size_t length, cl_uint nitems)
+{
+	if (get_global_id() == 0)
+	{
+		kds_hash->length = length;
+		kds_hash->nitems = nitems;
+		kds_hash->usage  = __kds_packed(length -
+										KERNBENCH_HASH_ITEM_SIZE *
+										(size_t)nitems);
+		kds_hash->nrooms = nitems;
+		kds_hash->ncols  = 1;
+		kds_hash->format = KDS_FORMAT_HASH;
+		kds_hash->nslots = __KDS_NSLOTS(nitems);
+		kds_hash->nr_colmeta = 1;
+		kds_hash->colmeta[0].attbyval = true;
+		kds_hash->colmeta[0].attalign = sizeof(cl_int);
+		kds_hash->colmeta[0].attlen = sizeof(cl_int);
+		kds_hash->colmeta[0].attnum = 1;
+	}
+}
+
+KERNEL_FUNCTION(void)
+kernbench_hash_build(kern_parambuf *kparams,
+					 kern_errorbuf *kerror,
+					 kern_data_store *kds_hash,
+					 cl_int *keys)
+{
+	DECL_KERNEL_CONTEXT(u);
+	kern_hashslot *hslot = KERN_DATA_STORE_HASHSLOT(kds_hash);
+	cl_uint		index;
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
+	for (index = get_global_id();
+		 index < kds_hash->nitems;
+		 index += get_global_size())
+	{
+		size_t		offset = kernbench_hash_item_offset(kds_hash, index);
+		kern_hashitem *khitem = (kern_hashitem *)((char *)kds_hash + offset);
+		HeapTupleHeaderData *htup = &khitem->t.htup;
+		pg_int4_t	temp;
+		kern_hashslot oldval, newval, curval;
+		cl_uint		hash;
+
+		temp.isnull = false;
+		temp.value  = keys[index];
+		hash = pg_comp_hash(&u.kcxt, temp);
+
+		khitem->hash  = hash;
+		khitem->rowid = index;
+		khitem->t.t_len = KERNBENCH_HASH_TUPLE_OFFSET + sizeof(cl_int);
+		khitem->t.t_self.ip_blkid.bi_hi = (index >> 16);
+		khitem->t.t_self.ip_blkid.bi_lo = (index & 0xffff);
+		khitem->t.t_self.ip_posid = 1;
+		htup->t_infomask2 = 1;
+		htup->t_infomask = 0;
+		htup->t_hoff = KERNBENCH_HASH_TUPLE_OFFSET;
+		*((cl_int *)((char *)htup + KERNBENCH_HASH_TUPLE_OFFSET)) = keys[index];
+		KERN_DATA_STORE_ROWINDEX(kds_hash)[index]
+			= __kds_packed(offset + offsetof(kern_hashitem, t));
+
+		/* push the item into the hash slot */
+		curval.value = hslot[hash % kds_hash->nslots].value;
+		do {
+			oldval = curval;
+			khitem->next = oldval.s.first;
+			newval.s.first = __kds_packed(offset);
+			newval.s.tags  = oldval.s.tags | KERN_HASH_FINGERPRINT(hash);
+			__threadfence();
+			curval.value = atomicCAS(&hslot[hash % kds_hash->nslots].value,
+									 oldval.value, newval.value);
+		} while (curval.value != oldval.value);
+	}
+	kern_writeback_error_status(kerror, &u.kcxt);
+}
+
+KERNEL_FUNCTION(void)
+kernbench_hash_probe(kern_parambuf *kparams,
+					 kern_errorbuf *kerror,
+					 kern_data_store *kds_hash,
+					 cl_uint nitems,
+					 cl_int *keys,
+					 cl_uint *p_nmatched)
+{
+	DECL_KERNEL_CONTEXT(u);
+	cl_uint		base;
+	cl_uint		count;
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
+	for (base = get_global_base(); base < nitems; base += get_global_size())
+	{
+		cl_uint		index = base + get_local_id();
+		cl_uint		nmatched = 0;
+
+		if (index < nitems)
+		{
+			kern_hashitem *khitem;
+			pg_int4_t	temp;
+			cl_uint		hash;
+
+			temp.isnull = false;
+			temp.value  = keys[index];
+			hash = pg_comp_hash(&u.kcxt, temp);
+			for (khitem = KERN_HASH_FIRST_ITEM(kds_hash, hash);
+				 khitem != NULL;
+				 khitem = KERN_HASH_NEXT_ITEM(kds_hash, khitem))
+			{
+				HeapTupleHeaderData *htup = &khitem->t.htup;
+
+				if (khitem->hash == hash &&
+					*((cl_int *)((char *)htup + htup->t_hoff)) == temp.value)
+					nmatched++;
+			}
+		}
+		pgstromStairlikeSum(nmatched, &count);
+		if (get_local_id() == 0 && count > 0)
+			atomicAdd(p_nmatched, count);
+	}
+	kern_writeback_error_status(kerror, &u.kcxt);
+}
+
+/*
+ * kernbench_preagg_reduction - sum(value) GROUP BY key, using the atomic
+ * operations of GpuPreAgg. If number of the groups is small enough, rows
+ * are reduced on the shared memory first, then merged to the global ones.
+ */
+#define KERNBENCH_LOCAL_NGROUPS		1024
+
+KERNEL_FUNCTION(void)
+kernbench_preagg_reduction(kern_parambuf *kparams,
+						   kern_errorbuf *kerror,
+						   cl_uint nitems,
+						   cl_uint *gkeys,
+						   cl_long *values,
+						   cl_uint ngroups,
+						   cl_char *g_dclass,	/* out */
+						   Datum   *g_values)	/* out */
+{
+	DECL_KERNEL_CONTEXT(u);
+	__shared__ cl_char	l_dclass[KERNBENCH_LOCAL_NGROUPS];
+	__shared__ Datum	l_values[KERNBENCH_LOCAL_NGROUPS];
+	cl_bool		local_reduction = (ngroups <= KERNBENCH_LOCAL_NGROUPS);
+	cl_uint		index;
+
+	INIT_KERNEL_CONTEXT(&u.kcxt, kparams);
+	if (local_reduction)
+	{
+		for (index = get_local_id(); index < ngroups;
+			 index += get_local_size())
+		{
+			l_dclass[index] = DATUM_CLASS__NULL;
+			l_values[index] = 0;
+		}
+		__syncthreads();
+	}
+	for (index = get_global_id(); index < nitems; index += get_global_size())
+	{
+		cl_uint		gkey = gkeys[index] % ngroups;
+
+		if (local_reduction)
+			aggcalc_atomic_add_long(&l_dclass[gkey], &l_values[gkey],
+									DATUM_CLASS__NORMAL, values[index]);
+		else
+			aggcalc_atomic_add_long(&g_dclass[gkey], &g_values[gkey],
+									DATUM_CLASS__NORMAL, values[index]);
+	}
+	if (local_reduction)
+	{
+		__syncthreads();
+		for (index = get_local_id(); index < ngroups;
+			 index += get_local_size())
+		{
+			if (l_dclass[index] == DATUM_CLASS__NORMAL)
+				aggcalc_atomic_add_long(&g_dclass[index], &g_values[index],
+										l_dclass[index], l_values[index]);
+		}
+	}
+	kern_writeback_error_status(kerror, &u.kcxt);
+}
@@ -1812,6 +1812,17 @@ pgfn_trunc(kern_context *kcxt, pg_float8_t arg1)
 	return result;
 }
 
+DEVICE_FUNCTION(pg_int4_t)
+pgfn_approx_percentile_bucket(kern_context *kcxt, pg_float8_t arg1)
+{
+	pg_int4_t	result;
+
+	result.isnull = arg1.isnull;
+	if (!result.isnull)
+		result.value = approx_percentile_bucket(arg1.value);
+	return result;
+}
+
 /*
  * Trigonometric function
  */
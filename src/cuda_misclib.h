@@ -300,6 +300,8 @@ DEVICE_FUNCTION(pg_float8_t)
 pgfn_dpow(kern_context *kcxt, pg_float8_t arg1, pg_float8_t arg2);
 DEVICE_FUNCTION(pg_float8_t)
 pgfn_trunc(kern_context *kcxt, pg_float8_t arg1);
+DEVICE_FUNCTION(pg_int4_t)
+pgfn_approx_percentile_bucket(kern_context *kcxt, pg_float8_t arg1);
 /*
  * Trigonometric function
  */
@@ -160,6 +160,53 @@ pg_numeric_normalize(pg_numeric_t num)
 	return num;
 }
 
+/*
+ * pg_numeric_rescale
+ *
+ * It aligns the weight of the supplied value to the new_weight, by
+ * multiplication with power of 10. Unlike a loop of *10, arguments with
+ * a large difference of the scale (typically, Arrow Decimal with the
+ * fixed column scale towards constants) consume at most three steps.
+ */
+static __device__ const cl_long __numeric_pow10[] = {
+	1L,
+	10L,
+	100L,
+	1000L,
+	10000L,
+	100000L,
+	1000000L,
+	10000000L,
+	100000000L,
+	1000000000L,
+	10000000000L,
+	100000000000L,
+	1000000000000L,
+	10000000000000L,
+	100000000000000L,
+	1000000000000000L,
+	10000000000000000L,
+	100000000000000000L,
+	1000000000000000000L,
+};
+#define NUMERIC_POW10_MAX	18
+
+STATIC_INLINE(pg_numeric_t)
+pg_numeric_rescale(pg_numeric_t num, int new_weight)
+{
+	int		shift = new_weight - num.weight;
+
+	while (shift > 0)
+	{
+		int		k = Min(shift, NUMERIC_POW10_MAX);
+
+		num.value = __Int128_mul(num.value, __numeric_pow10[k]);
+		shift -= k;
+	}
+	num.weight = new_weight;
+	return num;
+}
+
 PUBLIC_FUNCTION(pg_numeric_t)
 pg_numeric_from_varlena(kern_context *kcxt, struct varlena *vl_datum)
 {
@@ -352,12 +399,18 @@ pg_datum_fetch_arrow(kern_context *kcxt,
 		/*
 		 * Note that Decimal::scale is equivalent to numeric::weight.
 		 * It is the number of digits after the decimal point.
+		 *
+		 * We keep the scaled 128bit integer as is, without normalization,
+		 * because all the values in a column have identical scale, thus
+		 * comparison or addition between them needs no rescaling.
+		 * It also preserves the display scale of the column on the final
+		 * projection.
 		 */
 		memcpy(&temp.value, addr, sizeof(Int128_t));
 		temp.weight = cmeta->attopts.decimal.scale;
 		temp.isnull = false;
 
-		result = pg_numeric_normalize(temp);
+		result = temp;
 	}
 }
 
@@ -476,6 +529,8 @@ pg_comp_hash(kern_context *kcxt, pg_numeric_t datum)
 {
 	if (datum.isnull)
 		return 0;
+	/* values from Arrow Decimal may not be normalized */
+	datum = pg_numeric_normalize(datum);
 
 	return pg_hash_any((cl_uchar *)&datum.value,
 					   offsetof(pg_numeric_t, weight) + sizeof(cl_short));
@@ -646,6 +701,90 @@ pgfn_numeric_int8(kern_context *kcxt, pg_numeric_t arg)
 	return result;
 }
 
+/*
+ * numeric_to_scaled_integer
+ *
+ * It converts the numeric value to 64bit integer multiplied by 10^scale.
+ * Unlike numeric_to_integer, it never rounds the fraction digits, so CPU
+ * fallback is raised if value is not representable exactly.
+ */
+STATIC_FUNCTION(cl_long)
+numeric_to_scaled_integer(kern_context *kcxt, pg_numeric_t arg,
+						  cl_int scale, cl_bool *p_isnull)
+{
+	Int128_t	curr = arg.value;
+	int			weight = arg.weight;
+	bool		is_negative = false;
+	cl_long		mod;
+
+	if (__Int128_sign(curr) < 0)
+	{
+		is_negative = true;
+		curr = __Int128_inverse(curr);
+	}
+	while (weight > scale)
+	{
+		curr = __Int128_div(curr, 10, &mod);
+		if (mod != 0)
+			goto out_of_range;
+		weight--;
+	}
+	while (weight < scale)
+	{
+		if (curr.hi != 0)
+			goto out_of_range;
+		curr = __Int128_mul(curr, 10);
+		weight++;
+	}
+	if (curr.hi != 0 || curr.lo > LONG_MAX)
+		goto out_of_range;
+	return (!is_negative ? (cl_long)curr.lo : -((cl_long)curr.lo));
+
+out_of_range:
+	*p_isnull = true;
+	STROM_CPU_FALLBACK(kcxt, ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE,
+					   "numeric value out of range of scaled integer");
+	return 0;
+}
+
+/*
+ * pgstrom.numeric_scaled_hi(numeric, int4)
+ * pgstrom.numeric_scaled_lo(numeric, int4)
+ *
+ * upper (signed) and lower (unsigned) 32bits of the scaled integer. The sum
+ * of each portion never overflows 64bit accumulators of GpuPreAgg unless
+ * number of rows exceeds 2^31, so the exact 96bit sum is kept.
+ */
+DEVICE_FUNCTION(pg_int8_t)
+pgfn_numeric_scaled_hi(kern_context *kcxt, pg_numeric_t arg1, pg_int4_t arg2)
+{
+	pg_int8_t	result;
+
+	result.isnull = (arg1.isnull | arg2.isnull);
+	if (!result.isnull)
+	{
+		result.value = numeric_to_scaled_integer(kcxt, arg1, arg2.value,
+												 &result.isnull);
+		result.value >>= 32;
+	}
+	return result;
+}
+
+DEVICE_FUNCTION(pg_int8_t)
+pgfn_numeric_scaled_lo(kern_context *kcxt, pg_numeric_t arg1, pg_int4_t arg2)
+{
+	pg_int8_t	result;
+
+	result.isnull = (arg1.isnull | arg2.isnull);
+	if (!result.isnull)
+	{
+		result.value = numeric_to_scaled_integer(kcxt, arg1, arg2.value,
+												 &result.isnull);
+		result.value &= 0xffffffffL;
+	}
+	return result;
+}
+
 DEVICE_FUNCTION(pg_float2_t)
 pgfn_numeric_float2(kern_context *kcxt, pg_numeric_t arg)
 {
@@ -1030,16 +1169,10 @@ pgfn_numeric_add(kern_context *kcxt,
 	result.isnull = arg1.isnull | arg2.isnull;
 	if (result.isnull)
 		return result;
-	while (arg1.weight > arg2.weight)
-	{
-		arg2.value = __Int128_mul(arg2.value, 10);
-		arg2.weight++;
-	}
-	while (arg1.weight < arg2.weight)
-	{
-		arg1.value = __Int128_mul(arg1.value, 10);
-		arg1.weight++;
-	}
+	if (arg1.weight > arg2.weight)
+		arg2 = pg_numeric_rescale(arg2, arg1.weight);
+	else if (arg1.weight < arg2.weight)
+		arg1 = pg_numeric_rescale(arg1, arg2.weight);
 	asm volatile("add.cc.u64     %0, %2, %3;\n"
 				 "addc.u64       %1, %4, %5;\n"
 				 : "=l" (result.value.lo),
@@ -1049,8 +1182,12 @@ pgfn_numeric_add(kern_context *kcxt,
 				   "l" (arg1.value.hi),
 				   "l" (arg2.value.hi));
 	result.weight = arg1.weight;
-
-	return pg_numeric_normalize(result);
+	/*
+	 * No normalization here; the result keeps the larger scale of the
+	 * arguments (as dscale of PostgreSQL numeric doing), and next addition
+	 * towards the same column needs no rescaling, like sum() or avg().
+	 */
+	return result;
 }
 
 DEVICE_FUNCTION(pg_numeric_t)
@@ -1120,16 +1257,10 @@ numeric_cmp(kern_context *kcxt, pg_numeric_t arg1, pg_numeric_t arg2)
 	else if (sign1 < sign2)
 		return -1;
 	/* ok, both of arg1 and arg2 is not zero, and have same sign */
-	while (arg1.weight > arg2.weight)
-	{
-		arg2.value = __Int128_mul(arg2.value, 10);
-		arg2.weight++;
-	}
-	while (arg1.weight < arg2.weight)
-	{
-		arg1.value = __Int128_mul(arg1.value, 10);
-		arg1.weight++;
-	}
+	if (arg1.weight > arg2.weight)
+		arg2 = pg_numeric_rescale(arg2, arg1.weight);
+	else if (arg1.weight < arg2.weight)
+		arg1 = pg_numeric_rescale(arg1, arg2.weight);
 	return __Int128_compare(arg1.value, arg2.value);
 }
 
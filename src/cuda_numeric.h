@@ -340,6 +340,10 @@ DEVICE_FUNCTION(pg_int4_t)
 pgfn_numeric_int4(kern_context *kcxt, pg_numeric_t arg);
 DEVICE_FUNCTION(pg_int8_t)
 pgfn_numeric_int8(kern_context *kcxt, pg_numeric_t arg);
+DEVICE_FUNCTION(pg_int8_t)
+pgfn_numeric_scaled_hi(kern_context *kcxt, pg_numeric_t arg1, pg_int4_t arg2);
+DEVICE_FUNCTION(pg_int8_t)
+pgfn_numeric_scaled_lo(kern_context *kcxt, pg_numeric_t arg1, pg_int4_t arg2);
 DEVICE_FUNCTION(pg_float2_t)
 pgfn_numeric_float2(kern_context *kcxt, pg_numeric_t arg);
 DEVICE_FUNCTION(pg_float4_t)
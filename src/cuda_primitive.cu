@@ -1042,3 +1042,29 @@ BASIC_INT_MODFUNC_TEMPLATE(int4mod, int4)
 BASIC_INT_MODFUNC_TEMPLATE(int8mod, int8)
 
 #undef BASIC_INT_MODFUNC_TEMPLATE
+
+/*
+ * Array operators (&&, @>, <@) towards a sorted constant array
+ */
+#define BASIC_ARRAY_CONSTS_TEMPLATE(name,e_type,mode)				\
+	DEVICE_FUNCTION(pg_bool_t)										\
+	pgfn_##name##_##e_type(kern_context *kcxt,						\
+						   pg_array_t arg1, pg_bytea_t arg2)		\
+	{																\
+		return PG_ARRAY_CONSTS_MATCH<pg_##e_type##_t>(				\
+			kcxt, arg1, arg2, (mode),								\
+			sizeof(((pg_##e_type##_t *)0)->value),					\
+			sizeof(((pg_##e_type##_t *)0)->value));					\
+	}
+
+BASIC_ARRAY_CONSTS_TEMPLATE(arrayoverlap, int2, KERN_ARRAY_CONSTS__OVERLAP)
+BASIC_ARRAY_CONSTS_TEMPLATE(arrayoverlap, int4, KERN_ARRAY_CONSTS__OVERLAP)
+BASIC_ARRAY_CONSTS_TEMPLATE(arrayoverlap, int8, KERN_ARRAY_CONSTS__OVERLAP)
+BASIC_ARRAY_CONSTS_TEMPLATE(arraycontains, int2, KERN_ARRAY_CONSTS__CONTAINS)
+BASIC_ARRAY_CONSTS_TEMPLATE(arraycontains, int4, KERN_ARRAY_CONSTS__CONTAINS)
+BASIC_ARRAY_CONSTS_TEMPLATE(arraycontains, int8, KERN_ARRAY_CONSTS__CONTAINS)
+BASIC_ARRAY_CONSTS_TEMPLATE(arraycontained, int2, KERN_ARRAY_CONSTS__CONTAINED)
+BASIC_ARRAY_CONSTS_TEMPLATE(arraycontained, int4, KERN_ARRAY_CONSTS__CONTAINED)
+BASIC_ARRAY_CONSTS_TEMPLATE(arraycontained, int8, KERN_ARRAY_CONSTS__CONTAINED)
+
+#undef BASIC_ARRAY_CONSTS_TEMPLATE
@@ -441,4 +441,23 @@ pgfn_int4mod(kern_context *kcxt, pg_int4_t arg1, pg_int4_t arg2);
 DEVICE_FUNCTION(pg_int8_t)
 pgfn_int8mod(kern_context *kcxt, pg_int8_t arg1, pg_int8_t arg2);
 
+
+/*
+ * Array operators (&&, @>, <@) towards a sorted constant array
+ */
+#define PG_ARRAY_CONSTS_DECL_TEMPLATE(e_type)						\
+	DEVICE_FUNCTION(pg_bool_t)										\
+	pgfn_arrayoverlap_##e_type(kern_context *kcxt,					\
+							   pg_array_t arg1, pg_bytea_t arg2);	\
+	DEVICE_FUNCTION(pg_bool_t)										\
+	pgfn_arraycontains_##e_type(kern_context *kcxt,					\
+								pg_array_t arg1, pg_bytea_t arg2);	\
+	DEVICE_FUNCTION(pg_bool_t)										\
+	pgfn_arraycontained_##e_type(kern_context *kcxt,				\
+								 pg_array_t arg1, pg_bytea_t arg2);
+PG_ARRAY_CONSTS_DECL_TEMPLATE(int2)
+PG_ARRAY_CONSTS_DECL_TEMPLATE(int4)
+PG_ARRAY_CONSTS_DECL_TEMPLATE(int8)
+#undef PG_ARRAY_CONSTS_DECL_TEMPLATE
+
 #endif	/* CUDA_PRIMITIVE_H */
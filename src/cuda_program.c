@@ -16,12 +16,13 @@
  * GNU General Public License for more details.
  */
 #include "pg_strom.h"
+#include "cuda_timelib.h"
 #include "mb/pg_wchar.h"
 #include "access/xact.h"
 #include "pgtime.h"
 #include "utils/pg_locale.h"
 
-typedef struct
+typedef struct program_cache_entry
 {
 	cl_int			magic;
 	cl_int			mclass;
@@ -47,6 +48,15 @@ typedef struct
 	size_t			ptx_length;
 	char		   *error_msg;
 	int				error_code;
+	/* cubin image linked on the first load; set once under the lock */
+	struct program_cache_entry *cubin_chunk;
+	char		   *cubin_image;
+	size_t			cubin_length;
+	/* statistics; see pgstrom_program_cache_info */
+	TimestampTz		ctime;			/* time when entry is created */
+	TimestampTz		atime;			/* time when entry is last used */
+	cl_ulong		nhits;			/* number of cache hits */
+	cl_ulong		build_usec;		/* time consumed to build */
 	char			data[FLEXIBLE_ARRAY_MEMBER];
 } program_cache_entry;
 
@@ -61,6 +71,7 @@ typedef struct
 #define CUDA_PROGRAM_BUILD_FAILURE			((void *)(~0UL))
 
 #define PGCACHE_HASH_SIZE	960
+#define PGCACHE_BUILD_HIST_NSLOTS	12	/* [0,10ms), [10,20ms), ... 10.24s- */
 #define WORDNUM(x)			((x) / BITS_PER_BITMAPWORD)
 #define BITNUM(x)			((x) % BITS_PER_BITMAPWORD)
 
@@ -74,6 +85,19 @@ typedef struct
 	dlist_head	build_list;		/* build pending list */
 	dlist_head	addr_list;
 	dlist_head	free_list[PGCACHE_CHUNKSZ_MAX_BIT + 1];
+	/* planning counter of kernel source shapes; see pgstrom_cuda_source_is_hot */
+	struct {
+		pg_crc32	crc;
+		cl_uint		count;
+	} hot_shapes[PGCACHE_HASH_SIZE];
+	/* statistics; see pgstrom_program_cache_stats */
+	cl_ulong	num_hits;
+	cl_ulong	num_misses;
+	cl_ulong	num_evictions;
+	cl_ulong	num_builds;
+	cl_ulong	num_build_failures;
+	cl_ulong	build_usec_total;
+	cl_ulong	build_hist[PGCACHE_BUILD_HIST_NSLOTS];
 	char		base[FLEXIBLE_ARRAY_MEMBER];
 } program_cache_head;
 
@@ -89,6 +113,7 @@ typedef struct
 static int		program_cache_size_kb;
 static int		num_program_builders;
 static bool		pgstrom_debug_jit_compile_options;
+static char	   *program_cache_dir;
 
 /* ---- static variables ---- */
 static shmem_startup_hook_type shmem_startup_next;
@@ -98,6 +123,8 @@ static bool		cuda_program_builder_got_signal = false;
 
 /* ---- forward declarations ---- */
 static void put_cuda_program_entry_nolock(program_cache_entry *entry);
+Datum pgstrom_program_cache_info(PG_FUNCTION_ARGS);
+Datum pgstrom_program_cache_stats(PG_FUNCTION_ARGS);
 void cudaProgramBuilderMain(Datum arg);
 static void cudaProgramBuilderWakeUp(bool error_if_no_builders);
 
@@ -194,6 +221,7 @@ reclaim_cuda_program_entry_nolock(int mclass)
 		memset(&entry->lru_chain, 0, sizeof(dlist_node));
 
 		put_cuda_program_entry_nolock(entry);
+		pgcache_head->num_evictions++;
 	}
 	return true;
 }
@@ -231,6 +259,13 @@ create_cuda_program_entry_nolock(size_t variable_length)
 	Assert(entry->magic == PGCACHE_CHUNK_MAGIC &&
 		   entry->mclass == mclass);
 	memset(&entry->free_chain, 0, sizeof(dlist_node));
+	entry->cubin_chunk = NULL;
+	entry->cubin_image = NULL;
+	entry->cubin_length = 0;
+	entry->ctime = 0;
+	entry->atime = 0;
+	entry->nhits = 0;
+	entry->build_usec = 0;
 
 	return entry;
 }
@@ -269,6 +304,17 @@ put_cuda_program_entry_nolock(program_cache_entry *entry)
 	Assert(!entry->hash_chain.next && !entry->hash_chain.prev);
 	Assert(!entry->lru_chain.next && !entry->lru_chain.prev);
 
+	/* release the linked cubin image also */
+	if (entry->cubin_chunk)
+	{
+		program_cache_entry *cubin_chunk = entry->cubin_chunk;
+
+		entry->cubin_chunk = NULL;
+		entry->cubin_image = NULL;
+		entry->cubin_length = 0;
+		put_cuda_program_entry_nolock(cubin_chunk);
+	}
+
 	while (entry->mclass < PGCACHE_CHUNKSZ_MAX_BIT)
 	{
 		offset = ((uintptr_t)entry - (uintptr_t)pgcache_head->base);
@@ -314,6 +360,42 @@ put_cuda_program_entry_nolock(program_cache_entry *entry)
 					&entry->free_chain);
 }
 
+/*
+ * attach_cubin_program_entry
+ *
+ * It keeps the cubin image, linked with the device libraries, on the
+ * program cache entry, so that other backends can load the module without
+ * cuLink*() APIs. It is just an optimization, so silently gives up if
+ * no shared memory is available.
+ */
+static void
+attach_cubin_program_entry(program_cache_entry *entry,
+						   const char *bin_image, size_t bin_length)
+{
+	program_cache_entry *cubin_chunk;
+
+	SpinLockAcquire(&pgcache_head->lock);
+	if (!entry->cubin_image &&
+		(entry->pgid_chain.prev || entry->pgid_chain.next))
+	{
+		cubin_chunk = create_cuda_program_entry_nolock(bin_length);
+		if (cubin_chunk)
+		{
+			memset(&cubin_chunk->pgid_chain, 0, sizeof(dlist_node));
+			memset(&cubin_chunk->hash_chain, 0, sizeof(dlist_node));
+			memset(&cubin_chunk->lru_chain, 0, sizeof(dlist_node));
+			memset(&cubin_chunk->build_chain, 0, sizeof(dlist_node));
+			cubin_chunk->refcnt = 1;	/* owned by the entry */
+			memcpy(cubin_chunk->data, bin_image, bin_length);
+
+			entry->cubin_chunk	= cubin_chunk;
+			entry->cubin_image	= cubin_chunk->data;
+			entry->cubin_length	= bin_length;
+		}
+	}
+	SpinLockRelease(&pgcache_head->lock);
+}
+
 /*
  * put_cuda_program_entry
  */
@@ -404,7 +486,8 @@ construct_flat_cuda_source(cl_uint extra_flags,
 static char *
 link_cuda_libraries(char *ptx_image,
 					size_t ptx_length,
-					cl_uint extra_flags)
+					cl_uint extra_flags,
+					size_t *p_bin_length)
 {
 	CUlinkState		lstate;
 	CUresult		rc;
@@ -532,6 +615,7 @@ link_cuda_libraries(char *ptx_image,
 		if (!bin_image)
 			werror("out of memory");
 		memcpy(bin_image, temp, bin_length);
+		*p_bin_length = bin_length;
 	}
 	STROM_CATCH();
 	{
@@ -676,6 +760,188 @@ pgstrom_cuda_binary_file(ProgramId program_id)
 	return pstrdup(tempfilepath);
 }
 
+/*
+ * Persistent program cache
+ *
+ * If pg_strom.program_cache_dir is configured, PTX images built by NVRTC
+ * and cubin images linked with the device libraries are saved in the
+ * directory, to skip the run-time compilation after restart of the server
+ * or eviction from the shared program cache.
+ * Files are named by the crc of the program; a saved image is used only
+ * if the source code, build flags, target capability, and the version of
+ * CUDA and PG-Strom are identical.
+ * These routines can run in the GPU worker threads, so must not use
+ * palloc/elog.
+ */
+#define PGCACHE_PFILE_MAGIC		0x43505350	/* "PSPC" */
+#define PGCACHE_PFILE_VERSION	1
+#ifdef PGSTROM_VERSION
+#define PGCACHE_PFILE_STROM_VERSION		PGSTROM_VERSION
+#else
+#define PGCACHE_PFILE_STROM_VERSION		"unknown"
+#endif
+
+typedef struct
+{
+	uint32		magic;
+	uint32		version;
+	char		strom_version[32];
+	int			cuda_version;
+	int			target_cc;
+	cl_uint		extra_flags;
+	cl_uint		varlena_bufsz;
+	pg_crc32	crc;
+	pg_crc32	ptx_crc;		/* PTX image the file derives */
+	size_t		kern_deflen;
+	size_t		kern_srclen;
+	size_t		image_length;
+} program_pcache_head;
+
+static void
+__pcacheFilePath(char *path, program_cache_entry *entry, const char *suffix)
+{
+	snprintf(path, MAXPGPATH, "%s/%08x.%d.%08x.%s",
+			 program_cache_dir,
+			 entry->crc,
+			 entry->target_cc,
+			 entry->extra_flags,
+			 suffix);
+}
+
+static void
+__pcacheSetupHead(program_pcache_head *head, program_cache_entry *entry)
+{
+	memset(head, 0, sizeof(program_pcache_head));
+	head->magic			= PGCACHE_PFILE_MAGIC;
+	head->version		= PGCACHE_PFILE_VERSION;
+	strncpy(head->strom_version, PGCACHE_PFILE_STROM_VERSION,
+			sizeof(head->strom_version) - 1);
+	head->cuda_version	= CUDA_VERSION;
+	head->target_cc		= entry->target_cc;
+	head->extra_flags	= entry->extra_flags;
+	head->varlena_bufsz	= entry->varlena_bufsz;
+	head->crc			= entry->crc;
+}
+
+/*
+ * savePersistentProgramCache - write out a PTX (with the source code) or
+ * cubin image. Errors are not critical, so just ignored.
+ */
+static void
+savePersistentProgramCache(program_cache_entry *entry,
+						   const char *suffix, pg_crc32 ptx_crc,
+						   const char *image, size_t image_length)
+{
+	static pg_atomic_uint64 pcacheFileCounter = {0};
+	program_pcache_head head;
+	char		path[MAXPGPATH];
+	char		temp[MAXPGPATH];
+	bool		with_source = (strcmp(suffix, "ptx") == 0);
+	bool		is_ok = true;
+	int			fdesc;
+
+	if (!program_cache_dir || *program_cache_dir == '\0')
+		return;
+	__pcacheFilePath(path, entry, suffix);
+	snprintf(temp, MAXPGPATH, "%s.%d.%lu.tmp",
+			 path, MyProcPid,
+			 pg_atomic_fetch_add_u64(&pcacheFileCounter, 1));
+	fdesc = open(temp, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY, 0600);
+	if (fdesc < 0 && errno == ENOENT)
+	{
+		mkdir(program_cache_dir, S_IRWXU);
+		fdesc = open(temp, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY, 0600);
+	}
+	if (fdesc < 0)
+		return;
+
+	__pcacheSetupHead(&head, entry);
+	head.ptx_crc		= ptx_crc;
+	if (with_source)
+	{
+		head.kern_deflen	= entry->kern_deflen;
+		head.kern_srclen	= entry->kern_srclen;
+	}
+	head.image_length	= image_length;
+	if (__writeFile(fdesc, &head, sizeof(head)) != sizeof(head) ||
+		(with_source &&
+		 (__writeFile(fdesc, entry->kern_define,
+					  head.kern_deflen) != head.kern_deflen ||
+		  __writeFile(fdesc, entry->kern_source,
+					  head.kern_srclen) != head.kern_srclen)) ||
+		__writeFile(fdesc, image, image_length) != image_length)
+		is_ok = false;
+	if (close(fdesc) != 0)
+		is_ok = false;
+	if (!is_ok || rename(temp, path) != 0)
+		unlink(temp);
+}
+
+/*
+ * loadPersistentProgramCache - read a PTX or cubin image saved by
+ * savePersistentProgramCache, if any. It returns a malloc'ed buffer.
+ */
+static char *
+loadPersistentProgramCache(program_cache_entry *entry,
+						   const char *suffix, pg_crc32 ptx_crc,
+						   size_t *p_image_length)
+{
+	program_pcache_head head;
+	program_pcache_head temp;
+	char		path[MAXPGPATH];
+	bool		with_source = (strcmp(suffix, "ptx") == 0);
+	char	   *buffer = NULL;
+	size_t		length;
+	int			fdesc;
+
+	if (!program_cache_dir || *program_cache_dir == '\0')
+		return NULL;
+	__pcacheFilePath(path, entry, suffix);
+	fdesc = open(path, O_RDONLY | PG_BINARY);
+	if (fdesc < 0)
+		return NULL;
+
+	__pcacheSetupHead(&temp, entry);
+	if (__readFile(fdesc, &head, sizeof(head)) != sizeof(head) ||
+		head.magic			!= temp.magic ||
+		head.version		!= temp.version ||
+		strncmp(head.strom_version, temp.strom_version,
+				sizeof(head.strom_version)) != 0 ||
+		head.cuda_version	!= temp.cuda_version ||
+		head.target_cc		!= temp.target_cc ||
+		head.extra_flags	!= temp.extra_flags ||
+		head.varlena_bufsz	!= temp.varlena_bufsz ||
+		head.crc			!= temp.crc ||
+		(!with_source && head.ptx_crc != ptx_crc) ||
+		head.kern_deflen	!= (with_source ? entry->kern_deflen : 0) ||
+		head.kern_srclen	!= (with_source ? entry->kern_srclen : 0) ||
+		head.image_length == 0)
+		goto bailout;
+
+	length = Max(head.kern_deflen + head.kern_srclen, head.image_length);
+	buffer = malloc(length + 1);
+	if (!buffer)
+		goto bailout;
+	/* the source code must be identical */
+	if (with_source &&
+		(__readFile(fdesc, buffer, head.kern_deflen) != head.kern_deflen ||
+		 memcmp(buffer, entry->kern_define, head.kern_deflen) != 0 ||
+		 __readFile(fdesc, buffer, head.kern_srclen) != head.kern_srclen ||
+		 memcmp(buffer, entry->kern_source, head.kern_srclen) != 0))
+		goto bailout;
+	if (__readFile(fdesc, buffer, head.image_length) != head.image_length)
+		goto bailout;
+	close(fdesc);
+	*p_image_length = head.image_length;
+	return buffer;
+
+bailout:
+	if (buffer)
+		free(buffer);
+	close(fdesc);
+	return NULL;
+}
+
 /*
  * build_cuda_program - an interface to run synchronous build process
  */
@@ -697,6 +963,9 @@ build_cuda_program(program_cache_entry *src_entry)
 	int				hindex;
 	size_t			offset;
 	size_t			length;
+	TimestampTz		tv_begin = GetCurrentTimestamp();
+	TimestampTz		tv_end;
+	cl_ulong		build_usec;
 
 	Assert(!src_entry->build_chain.prev && !src_entry->build_chain.next);
 
@@ -712,6 +981,18 @@ build_cuda_program(program_cache_entry *src_entry)
 	{
 		char	gpu_arch_option[256];
 
+		/* Is the PTX image already built at the previous run? */
+		ptx_image = loadPersistentProgramCache(src_entry, "ptx", 0,
+											   &ptx_length);
+		if (ptx_image)
+		{
+			build_log = strdup("loaded from the program cache directory");
+			if (!build_log)
+				werror("out of memory");
+			log_length = strlen(build_log);
+			goto setup_bin_entry;
+		}
+
 		rc = nvrtcCreateProgram(&program,
 								source,
 								"pg-strom",
@@ -798,15 +1079,24 @@ build_cuda_program(program_cache_entry *src_entry)
 		if (rc != NVRTC_SUCCESS)
 			werror("failed on nvrtcDestroyProgram: %s",
 				   nvrtcGetErrorString(rc));
+		program = NULL;
+
+		/* save the PTX image for the later runs */
+		if (ptx_image)
+			savePersistentProgramCache(src_entry, "ptx", 0,
+									   ptx_image, ptx_length);
 
 		/*
 		 * Allocation of a new entry, to keep ptx_image/build_log
 		 */
+	setup_bin_entry:
 		length = (MAXALIGN(src_entry->kern_deflen + 1) +
 				  MAXALIGN(src_entry->kern_srclen + 1) +
 				  MAXALIGN(ptx_length + 1) +
 				  MAXALIGN(log_length + 1) +
 				  PGCACHE_MIN_ERRORMSG_BUFSIZE);
+		tv_end = GetCurrentTimestamp();
+		build_usec = (tv_end > tv_begin ? tv_end - tv_begin : 0);
 		SpinLockAcquire(&pgcache_head->lock);
 		bin_entry = create_cuda_program_entry_nolock(length);
 		if (!bin_entry)
@@ -814,6 +1104,22 @@ build_cuda_program(program_cache_entry *src_entry)
 			SpinLockRelease(&pgcache_head->lock);
 			werror("out of CUDA program cache");
 		}
+		bin_entry->ctime			= src_entry->ctime;
+		bin_entry->atime			= src_entry->atime;
+		bin_entry->nhits			= src_entry->nhits;
+		bin_entry->build_usec		= build_usec;
+		pgcache_head->num_builds++;
+		if (!ptx_image)
+			pgcache_head->num_build_failures++;
+		pgcache_head->build_usec_total += build_usec;
+		{
+			int		k = 0;
+
+			while (k < PGCACHE_BUILD_HIST_NSLOTS - 1 &&
+				   build_usec >= (10000UL << k))
+				k++;
+			pgcache_head->build_hist[k]++;
+		}
 		/*
 		 * OK, replace the src_entry by the bin_entry
 		 */
@@ -935,6 +1241,7 @@ __pgstrom_create_cuda_program(GpuContext *gcontext,
 	cl_int		target_cc;
 	dlist_iter	iter;
 	pg_crc32	crc;
+	TimestampTz	tv_now = GetCurrentTimestamp();
 
 	/* build with debug option? */
 	if (pgstrom_debug_jit_compile_options)
@@ -970,6 +1277,9 @@ __pgstrom_create_cuda_program(GpuContext *gcontext,
 			get_cuda_program_entry_nolock(entry);
 			/* Move this entry to the head of LRU list */
 			dlist_move_head(&pgcache_head->lru_list, &entry->lru_chain);
+			entry->nhits++;
+			entry->atime = tv_now;
+			pgcache_head->num_hits++;
 		retry_checks:
 			if (entry->ptx_image != NULL || !wait_for_build)
 			{
@@ -1042,6 +1352,9 @@ __pgstrom_create_cuda_program(GpuContext *gcontext,
 		SpinLockRelease(&pgcache_head->lock);
 		werror("out of shared memory");
 	}
+	entry->ctime = tv_now;
+	entry->atime = tv_now;
+	pgcache_head->num_misses++;
 
 	/* find out a unique program_id */
 	do {
@@ -1520,6 +1833,108 @@ assign_timelib_session_info(StringInfo buf)
 	appendStringInfoChar(buf, '\n');
 }
 
+/*
+ * pgstrom_build_timezone_param
+ *
+ * It builds kern_tz_info for timezone() (AT TIME ZONE) with a constant
+ * time zone; the transition table of the zone is shipped to the device
+ * as a bytea parameter, so any time zone other than the session's one
+ * can be processed on the device. NULL shall be returned if the supplied
+ * zone is not supported on the device.
+ */
+static void
+__append_tz_array(StringInfo buf, cl_uint *p_offset,
+				  const void *data, int len, int align)
+{
+	/* kern_tz_info is located next to the varlena header */
+	while (TYPEALIGN(align, buf->len) != buf->len)
+		appendStringInfoChar(buf, '\0');
+	*p_offset = buf->len - VARHDRSZ;
+	if (len > 0)
+		appendBinaryStringInfo(buf, data, len);
+}
+
+bytea *
+pgstrom_build_timezone_param(text *zone, const char **p_errmsg)
+{
+	char		tzname[TZ_STRLEN_MAX + 1];
+	char	   *lowzone;
+	int			type, val;
+	pg_tz	   *tzp;
+	kern_tz_info tzinfo;
+	StringInfoData buf;
+
+	text_to_cstring_buffer(zone, tzname, sizeof(tzname));
+	lowzone = downcase_truncate_identifier(tzname, strlen(tzname), false);
+	type = DecodeTimezoneAbbrev(0, lowzone, &val, &tzp);
+
+	memset(&tzinfo, 0, sizeof(kern_tz_info));
+	initStringInfo(&buf);
+	appendStringInfoSpaces(&buf, VARHDRSZ + sizeof(kern_tz_info));
+	if (type == TZ || type == DTZ)
+	{
+		/* fixed-offset abbreviation */
+		tzinfo.fixed_tz = -val;
+		tzinfo.is_fixed = true;
+	}
+	else if (type == DYNTZ)
+	{
+		/* offset depends on the abbreviation and the timestamp */
+		*p_errmsg = "dynamic-offset time zone abbreviation";
+		pfree(buf.data);
+		return NULL;
+	}
+	else if ((tzp = pg_tzset(tzname)) != NULL)
+	{
+		const struct state *sp = &tzp->state;
+		tz_ttinfo	ttis[TZ_MAX_TYPES];
+		tz_lsinfo	lsis[TZ_MAX_LEAPS];
+		cl_long		ats[TZ_MAX_TIMES];
+		int			i;
+
+		tzinfo.goback = sp->goback;
+		tzinfo.goahead = sp->goahead;
+		tzinfo.leapcnt = sp->leapcnt;
+		tzinfo.timecnt = sp->timecnt;
+		tzinfo.typecnt = sp->typecnt;
+		tzinfo.defaulttype = sp->defaulttype;
+		for (i=0; i < sp->timecnt; i++)
+			ats[i] = sp->ats[i];
+		for (i=0; i < sp->leapcnt; i++)
+		{
+			lsis[i].ls_trans = sp->lsis[i].ls_trans;
+			lsis[i].ls_corr  = sp->lsis[i].ls_corr;
+		}
+		for (i=0; i < sp->typecnt; i++)
+		{
+			ttis[i].tt_gmtoff  = sp->ttis[i].tt_gmtoff;
+			ttis[i].tt_isdst   = sp->ttis[i].tt_isdst;
+			ttis[i].tt_abbrind = sp->ttis[i].tt_abbrind;
+			ttis[i].tt_ttisstd = sp->ttis[i].tt_ttisstd;
+			ttis[i].tt_ttisgmt = sp->ttis[i].tt_ttisgmt;
+		}
+		__append_tz_array(&buf, &tzinfo.ats_offset, ats,
+						  sizeof(cl_long) * sp->timecnt, sizeof(cl_long));
+		__append_tz_array(&buf, &tzinfo.lsis_offset, lsis,
+						  sizeof(tz_lsinfo) * sp->leapcnt, sizeof(cl_long));
+		__append_tz_array(&buf, &tzinfo.ttis_offset, ttis,
+						  sizeof(tz_ttinfo) * sp->typecnt, sizeof(cl_int));
+		__append_tz_array(&buf, &tzinfo.types_offset, sp->types,
+						  sizeof(cl_uchar) * sp->timecnt, sizeof(cl_uchar));
+	}
+	else
+	{
+		/* CPU fallback will raise an error, if any rows */
+		*p_errmsg = "time zone not recognized";
+		pfree(buf.data);
+		return NULL;
+	}
+	memcpy(buf.data + VARHDRSZ, &tzinfo, sizeof(kern_tz_info));
+	SET_VARSIZE(buf.data, buf.len);
+
+	return (bytea *)buf.data;
+}
+
 static void
 assign_misclib_session_info(StringInfo buf)
 {
@@ -1578,6 +1993,60 @@ pgstrom_build_session_info(StringInfo buf,
 		assign_gpupreagg_session_info(buf, gts);
 }
 
+/*
+ * pgstrom_cuda_program_is_built
+ *
+ * It checks whether the GPU program is already built (or failed to build),
+ * without waiting for the program builders.
+ */
+bool
+pgstrom_cuda_program_is_built(ProgramId program_id)
+{
+	program_cache_entry *entry;
+	bool		retval = true;
+
+	SpinLockAcquire(&pgcache_head->lock);
+	entry = lookup_cuda_program_entry_nolock(program_id);
+	if (entry && !entry->ptx_image)
+		retval = false;
+	SpinLockRelease(&pgcache_head->lock);
+
+	return retval;
+}
+
+/*
+ * pgstrom_cuda_source_is_hot
+ *
+ * It counts how many times the supplied kernel source shape is planned,
+ * then returns true once it reaches the @threshold. The counter is kept
+ * on a direct-mapped table, so a collision just restarts the counting.
+ */
+bool
+pgstrom_cuda_source_is_hot(const char *kern_source, int threshold)
+{
+	pg_crc32	crc;
+	int			hindex;
+	bool		retval;
+
+	INIT_LEGACY_CRC32(crc);
+	COMP_LEGACY_CRC32(crc, kern_source, strlen(kern_source));
+	FIN_LEGACY_CRC32(crc);
+	hindex = crc % PGCACHE_HASH_SIZE;
+
+	SpinLockAcquire(&pgcache_head->lock);
+	if (pgcache_head->hot_shapes[hindex].crc != crc)
+	{
+		pgcache_head->hot_shapes[hindex].crc = crc;
+		pgcache_head->hot_shapes[hindex].count = 0;
+	}
+	if (pgcache_head->hot_shapes[hindex].count < UINT_MAX)
+		pgcache_head->hot_shapes[hindex].count++;
+	retval = (pgcache_head->hot_shapes[hindex].count >= threshold);
+	SpinLockRelease(&pgcache_head->lock);
+
+	return retval;
+}
+
 /*
  * pgstrom_load_cuda_program
  */
@@ -1589,6 +2058,8 @@ pgstrom_load_cuda_program(ProgramId program_id)
 	CUresult	rc;
 	size_t		stack_sz, lvalue;
 	char	   *bin_image;
+	size_t		bin_length;
+	program_cache_entry *cubin_owner = NULL;
 
 	SpinLockAcquire(&pgcache_head->lock);
 retry_checks:
@@ -1607,6 +2078,13 @@ retry_checks:
 	else if (entry->ptx_image)
 	{
 		get_cuda_program_entry_nolock(entry);
+		/* already linked by someone? */
+		if (entry->cubin_image)
+		{
+			bin_image = entry->cubin_image;
+			bin_length = entry->cubin_length;
+			cubin_owner = entry;	/* keep the refcnt until module load */
+		}
 		SpinLockRelease(&pgcache_head->lock);
 
 		/*
@@ -1630,11 +2108,23 @@ retry_checks:
 			Assert(__ptx_crc == entry->ptx_crc);
 		}
 #endif /* USE_ASSERT_CHECKING */
+		if (cubin_owner)
+			goto load_module;
 		STROM_TRY();
 		{
-			bin_image = link_cuda_libraries(entry->ptx_image,
-											entry->ptx_length,
-											entry->extra_flags);
+			bin_image = loadPersistentProgramCache(entry, "cubin",
+												   entry->ptx_crc,
+												   &bin_length);
+			if (!bin_image)
+			{
+				bin_image = link_cuda_libraries(entry->ptx_image,
+												entry->ptx_length,
+												entry->extra_flags,
+												&bin_length);
+				savePersistentProgramCache(entry, "cubin",
+										   entry->ptx_crc,
+										   bin_image, bin_length);
+			}
 		}
 		STROM_CATCH();
 		{
@@ -1642,6 +2132,7 @@ retry_checks:
 			STROM_RE_THROW();
 		}
 		STROM_END_TRY();
+		attach_cubin_program_entry(entry, bin_image, bin_length);
 		put_cuda_program_entry(entry);
 	}
 	else if (entry->build_chain.prev || entry->build_chain.next)
@@ -1684,7 +2175,12 @@ retry_checks:
 		SpinLockAcquire(&pgcache_head->lock);
 		goto retry_checks;
 	}
+load_module:
 	rc = cuModuleLoadData(&cuda_module, bin_image);
+	if (cubin_owner)
+		put_cuda_program_entry(cubin_owner);
+	else
+		free(bin_image);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuModuleLoadData: %s", errorText(rc));
 
@@ -1783,10 +2279,14 @@ cudaProgramBuilderMain(Datum arg)
 
 			PG_TRY();
 			{
+				pgstromNvtxRangePush("cudaProgramBuild (program_id=%lu)",
+									 (unsigned long)entry->program_id);
 				entry = build_cuda_program(entry);
+				pgstromNvtxRangePop();
 			}
 			PG_CATCH();
 			{
+				pgstromNvtxRangePop();
 				/*
 				 * Unlike CUDA_PROGRAM_BUILD_FAILURE case, exceptions are
 				 * often raised by resource starvation, or other reasons,
@@ -1835,6 +2335,250 @@ cudaProgramBuilderWakeUp(bool error_if_no_builders)
 		elog(ERROR, "PG-Strom: no active CUDA C program builder");
 }
 
+/*
+ * pgstrom_program_cache_info
+ *
+ * It shows the GPU programs being kept on the program cache.
+ */
+typedef struct
+{
+	ProgramId	program_id;
+	pg_crc32	crc;
+	int			target_cc;
+	cl_uint		extra_flags;
+	size_t		length;
+	int			refcnt;
+	const char *status;
+	bool		has_cubin;
+	cl_ulong	build_usec;
+	TimestampTz	ctime;
+	TimestampTz	atime;
+	cl_ulong	nhits;
+} programCacheInfo;
+
+Datum
+pgstrom_program_cache_info(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	programCacheInfo *info;
+	Datum		values[12];
+	bool		isnull[12];
+	HeapTuple	tuple;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		programCacheInfo *info_array;
+		dlist_iter		iter;
+		int				nitems = 0;
+		int				nrooms = 0;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(12);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "program_id",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "crc",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "target_cc",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "extra_flags",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "length",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "refcnt",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "status",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 8, "has_cubin",
+						   BOOLOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 9, "build_time",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 10, "ctime",
+						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 11, "atime",
+						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 12, "nhits",
+						   INT8OID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		/*
+		 * count the number of entries first, because we cannot allocate
+		 * memory under the spinlock.
+		 */
+		SpinLockAcquire(&pgcache_head->lock);
+		dlist_foreach(iter, &pgcache_head->lru_list)
+			nrooms++;
+		SpinLockRelease(&pgcache_head->lock);
+
+		nrooms += 32;	/* margin for concurrent insertion */
+		info_array = palloc(sizeof(programCacheInfo) * nrooms);
+
+		SpinLockAcquire(&pgcache_head->lock);
+		dlist_foreach(iter, &pgcache_head->lru_list)
+		{
+			program_cache_entry *entry
+				= dlist_container(program_cache_entry, lru_chain, iter.cur);
+
+			if (nitems >= nrooms)
+				break;
+			info = &info_array[nitems++];
+			info->program_id = entry->program_id;
+			info->crc = entry->crc;
+			info->target_cc = entry->target_cc;
+			info->extra_flags = entry->extra_flags;
+			info->length = (1UL << entry->mclass);
+			if (entry->cubin_chunk)
+				info->length += (1UL << entry->cubin_chunk->mclass);
+			info->refcnt = entry->refcnt;
+			if (entry->ptx_image == CUDA_PROGRAM_BUILD_FAILURE)
+				info->status = "failed";
+			else if (entry->ptx_image)
+				info->status = "built";
+			else if (entry->build_chain.prev || entry->build_chain.next)
+				info->status = "pending";
+			else
+				info->status = "building";
+			info->has_cubin = (entry->cubin_image != NULL);
+			info->build_usec = entry->build_usec;
+			info->ctime = entry->ctime;
+			info->atime = entry->atime;
+			info->nhits = entry->nhits;
+		}
+		SpinLockRelease(&pgcache_head->lock);
+
+		fncxt->user_fctx = info_array;
+		fncxt->max_calls = nitems;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+
+	if (fncxt->call_cntr >= fncxt->max_calls)
+		SRF_RETURN_DONE(fncxt);
+	info = (programCacheInfo *)fncxt->user_fctx + fncxt->call_cntr;
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = Int64GetDatum(info->program_id);
+	values[1] = Int64GetDatum((int64)info->crc);
+	values[2] = Int32GetDatum(info->target_cc);
+	values[3] = Int32GetDatum(info->extra_flags);
+	values[4] = Int64GetDatum(info->length);
+	values[5] = Int32GetDatum(info->refcnt);
+	values[6] = CStringGetTextDatum(info->status);
+	values[7] = BoolGetDatum(info->has_cubin);
+	if (strcmp(info->status, "built") == 0 ||
+		strcmp(info->status, "failed") == 0)
+		values[8] = Float8GetDatum((double)info->build_usec / 1000.0);
+	else
+		isnull[8] = true;
+	values[9] = TimestampTzGetDatum(info->ctime);
+	values[10] = TimestampTzGetDatum(info->atime);
+	values[11] = Int64GetDatum(info->nhits);
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_program_cache_info);
+
+/*
+ * pgstrom_program_cache_stats
+ *
+ * It shows the global statistics of the program cache.
+ */
+Datum
+pgstrom_program_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[11];
+	bool		isnull[11];
+	Datum		hist[PGCACHE_BUILD_HIST_NSLOTS];
+	cl_ulong	num_hits;
+	cl_ulong	num_misses;
+	cl_ulong	num_evictions;
+	cl_ulong	num_builds;
+	cl_ulong	num_build_failures;
+	cl_ulong	build_usec_total;
+	size_t		total_sz = ((size_t)program_cache_size_kb << 10);
+	size_t		free_sz = 0;
+	int			num_entries = 0;
+	int			build_queue = 0;
+	int			i;
+	dlist_iter	iter;
+
+	tupdesc = CreateTemplateTupleDesc(11);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "cache_size",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "cache_usage",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "num_entries",
+					   INT4OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "num_hits",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "num_misses",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "num_evictions",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "num_builds",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 8, "num_build_failures",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 9, "build_queue",
+					   INT4OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 10, "build_time_avg",
+					   FLOAT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 11, "build_time_hist",
+					   INT8ARRAYOID, -1, 0);
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	SpinLockAcquire(&pgcache_head->lock);
+	dlist_foreach(iter, &pgcache_head->lru_list)
+		num_entries++;
+	dlist_foreach(iter, &pgcache_head->build_list)
+		build_queue++;
+	for (i=0; i <= PGCACHE_CHUNKSZ_MAX_BIT; i++)
+	{
+		dlist_foreach(iter, &pgcache_head->free_list[i])
+			free_sz += (1UL << i);
+	}
+	num_hits = pgcache_head->num_hits;
+	num_misses = pgcache_head->num_misses;
+	num_evictions = pgcache_head->num_evictions;
+	num_builds = pgcache_head->num_builds;
+	num_build_failures = pgcache_head->num_build_failures;
+	build_usec_total = pgcache_head->build_usec_total;
+	for (i=0; i < PGCACHE_BUILD_HIST_NSLOTS; i++)
+		hist[i] = Int64GetDatum(pgcache_head->build_hist[i]);
+	SpinLockRelease(&pgcache_head->lock);
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = Int64GetDatum(total_sz);
+	values[1] = Int64GetDatum(total_sz > free_sz ? total_sz - free_sz : 0);
+	values[2] = Int32GetDatum(num_entries);
+	values[3] = Int64GetDatum(num_hits);
+	values[4] = Int64GetDatum(num_misses);
+	values[5] = Int64GetDatum(num_evictions);
+	values[6] = Int64GetDatum(num_builds);
+	values[7] = Int64GetDatum(num_build_failures);
+	values[8] = Int32GetDatum(build_queue);
+	if (num_builds > 0)
+		values[9] = Float8GetDatum((double)build_usec_total /
+								   (1000.0 * (double)num_builds));
+	else
+		isnull[9] = true;
+	values[10] = PointerGetDatum(construct_array(hist,
+												 PGCACHE_BUILD_HIST_NSLOTS,
+												 INT8OID,
+												 sizeof(int64),
+												 FLOAT8PASSBYVAL, 'd'));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc,
+													  values,
+													  isnull)));
+}
+PG_FUNCTION_INFO_V1(pgstrom_program_cache_stats);
+
 #if 0
 /*
  * XXXX - PL/CUDA was re-designed to use CUDA runtime,
@@ -2040,6 +2784,18 @@ pgstrom_init_cuda_program(void)
 							 GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
 							 NULL, NULL, NULL);
 
+	/*
+	 * Directory to save the built GPU programs persistently
+	 */
+	DefineCustomStringVariable("pg_strom.program_cache_dir",
+							   "directory to save the built GPU programs persistently",
+							   NULL,
+							   &program_cache_dir,
+							   NULL,
+							   PGC_POSTMASTER,
+							   GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+							   NULL, NULL, NULL);
+
 	/* allocation of static shared memory */
 	RequestAddinShmemSpace(offsetof(program_cache_head, base) +
 						   ((size_t)program_cache_size_kb << 10));
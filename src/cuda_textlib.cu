@@ -1113,6 +1113,402 @@ pgfn_bpcharicnlike(kern_context *kcxt, pg_bpchar_t arg1, pg_text_t arg2)
 	return result;
 }
 
+/*
+ * Warp-cooperative variants of LIKE and strpos
+ *
+ * Device functions usually process a row per thread, so long text values
+ * (URLs, user agents, log lines, ...) make threads in a warp diverged
+ * massively. The variants below pick up the arguments of the active threads
+ * in the warp one by one, then all the threads scan the text together; each
+ * thread checks the candidate positions (base + rank) with coalesced loads,
+ * and the result is returned to the owner of the row.
+ * codegen chooses these variants only if average width of the text column
+ * exceeds pg_strom.text_warp_threshold, and the database encoding is either
+ * single-byte or UTF-8 which allows byte-wise substring search.
+ */
+#define WARP_TEXT_MIN_LENGTH		64
+
+STATIC_INLINE(cl_bool)
+__text_prefix_equal(const char *s, const char *p, cl_int len, cl_bool icase)
+{
+	cl_int		k;
+
+	for (k=0; k < len; k++)
+	{
+		cl_char		c1 = s[k];
+		cl_char		c2 = p[k];
+
+		if (icase)
+		{
+			c1 = GetCharLowerCase(c1);
+			c2 = GetCharLowerCase(c2);
+		}
+		if (c1 != c2)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * __warp_strstr - returns the first byte position of 'p' in 's' at or
+ * after 'start', or -1 if not found. All the threads in 'mask' must call
+ * it with identical arguments.
+ */
+STATIC_FUNCTION(cl_int)
+__warp_strstr(cl_uint mask, cl_int rank, cl_int nlanes,
+			  const char *s, cl_int slen,
+			  const char *p, cl_int plen,
+			  cl_int start, cl_bool icase)
+{
+	cl_int		base;
+
+	for (base = start; base + plen <= slen; base += nlanes)
+	{
+		cl_int		i = base + rank;
+		cl_bool		found = false;
+		cl_uint		ballot;
+
+		if (i + plen <= slen &&
+			(icase ? GetCharLowerCase(s[i]) == GetCharLowerCase(p[0])
+				   : s[i] == p[0]))
+			found = __text_prefix_equal(s + i + 1, p + 1, plen - 1, icase);
+		ballot = __ballot_sync(mask, found);
+		if (ballot != 0)
+		{
+			cl_int	lane = __ffs(ballot) - 1;
+
+			return base + __popc(mask & ((1U << lane) - 1));
+		}
+	}
+	return -1;
+}
+
+/*
+ * __warp_like - LIKE pattern that consists of only literals and '%'.
+ * Each literal segment is searched by the warp; leftmost match is enough
+ * because '%' can absorb everything else.
+ */
+STATIC_FUNCTION(cl_bool)
+__warp_like(cl_uint mask, cl_int rank, cl_int nlanes,
+			const char *s, cl_int slen,
+			const char *p, cl_int plen, cl_bool icase)
+{
+	cl_bool		anchored = true;
+	cl_int		pos = 0;
+	cl_int		i = 0;
+	cl_int		j;
+
+	while (i < plen)
+	{
+		if (p[i] == '%')
+		{
+			anchored = false;
+			i++;
+			continue;
+		}
+		for (j=i; j < plen && p[j] != '%'; j++);
+
+		if (anchored)
+		{
+			if (pos + (j - i) > slen ||
+				!__text_prefix_equal(s + pos, p + i, j - i, icase))
+				return false;
+			pos += (j - i);
+		}
+		else if (j == plen)
+		{
+			/* the last segment must match to the tail */
+			if (slen - pos < j - i)
+				return false;
+			return __text_prefix_equal(s + slen - (j - i),
+									   p + i, j - i, icase);
+		}
+		else
+		{
+			cl_int	k = __warp_strstr(mask, rank, nlanes,
+									  s, slen, p + i, j - i, pos, icase);
+			if (k < 0)
+				return false;
+			pos = k + (j - i);
+		}
+		anchored = true;
+		i = j;
+	}
+	return (anchored ? pos == slen : true);
+}
+
+STATIC_FUNCTION(cl_bool)
+WarpMatchText(kern_context *kcxt,
+			  char *s, cl_int slen,
+			  char *p, cl_int plen, cl_bool icase)
+{
+	cl_uint		mask = __activemask();
+	cl_int		lane = (get_local_id() & (warpSize - 1));
+	cl_int		rank = __popc(mask & ((1U << lane) - 1));
+	cl_int		nlanes = __popc(mask);
+	cl_uint		temp;
+	cl_bool		result = false;
+
+	/* not worth to cooperate, if all the texts are short */
+	if (__all_sync(mask, slen < WARP_TEXT_MIN_LENGTH))
+	{
+		if (icase)
+			return (GenericCaseMatchText(kcxt, s, slen,
+										 p, plen, 0) == LIKE_TRUE);
+		return (GenericMatchText(kcxt, s, slen, p, plen, 0) == LIKE_TRUE);
+	}
+
+	for (temp = mask; temp != 0; temp &= (temp - 1))
+	{
+		cl_int		owner = __ffs(temp) - 1;
+		char	   *__s = (char *)__shfl_sync(mask, (cl_ulong)s, owner);
+		char	   *__p = (char *)__shfl_sync(mask, (cl_ulong)p, owner);
+		cl_int		__slen = __shfl_sync(mask, slen, owner);
+		cl_int		__plen = __shfl_sync(mask, plen, owner);
+		cl_bool		simple = true;
+		cl_bool		matched;
+		cl_int		k;
+
+		/* '_' and escape characters are processed by the owner */
+		for (k=0; k < __plen; k++)
+		{
+			if (__p[k] == '_' || __p[k] == '\\')
+			{
+				simple = false;
+				break;
+			}
+		}
+		if (simple)
+		{
+			matched = __warp_like(mask, rank, nlanes,
+								  __s, __slen, __p, __plen, icase);
+			if (lane == owner)
+				result = matched;
+		}
+		else if (lane == owner)
+		{
+			if (icase)
+				result = (GenericCaseMatchText(kcxt, s, slen,
+											   p, plen, 0) == LIKE_TRUE);
+			else
+				result = (GenericMatchText(kcxt, s, slen,
+										   p, plen, 0) == LIKE_TRUE);
+		}
+		__syncwarp(mask);
+	}
+	return result;
+}
+
+#define PGFN_TEXTLIKE_WARP_TEMPLATE(FUNCNAME, ICASE, NEGATIVE)			\
+	DEVICE_FUNCTION(pg_bool_t)											\
+	pgfn_##FUNCNAME##_warp(kern_context *kcxt,							\
+						   pg_text_t arg1, pg_text_t arg2)				\
+	{																	\
+		pg_bool_t	result;												\
+		char	   *s, *p;												\
+		cl_int		slen;												\
+		cl_int		plen;												\
+																		\
+		result.isnull = arg1.isnull | arg2.isnull;						\
+		if (!result.isnull)												\
+		{																\
+			if (!pg_varlena_datum_extract(kcxt, arg1, &s, &slen) ||		\
+				!pg_varlena_datum_extract(kcxt, arg2, &p, &plen))		\
+				result.isnull = true;									\
+			else														\
+				result.value = (WarpMatchText(kcxt, s, slen, p, plen,	\
+											  ICASE) != NEGATIVE);		\
+		}																\
+		return result;													\
+	}
+
+PGFN_TEXTLIKE_WARP_TEMPLATE(textlike, false, false)
+PGFN_TEXTLIKE_WARP_TEMPLATE(textnlike, false, true)
+PGFN_TEXTLIKE_WARP_TEMPLATE(texticlike, true, false)
+PGFN_TEXTLIKE_WARP_TEMPLATE(texticnlike, true, true)
+#undef PGFN_TEXTLIKE_WARP_TEMPLATE
+
+/*
+ * strpos / position
+ */
+DEVICE_FUNCTION(pg_int4_t)
+pgfn_textpos(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
+{
+	pg_int4_t	result;
+	char	   *s, *p, *pos, *end;
+	cl_int		slen, plen;
+	cl_int		n;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		if (!pg_varlena_datum_extract(kcxt, arg1, &s, &slen) ||
+			!pg_varlena_datum_extract(kcxt, arg2, &p, &plen))
+		{
+			result.isnull = true;
+			return result;
+		}
+		result.value = (plen == 0 ? 1 : 0);
+		end = s + slen;
+		for (pos = s, n = 1; plen > 0 && pos + plen <= end; n++)
+		{
+			if (__text_prefix_equal(pos, p, plen, false))
+			{
+				result.value = n;
+				break;
+			}
+			if (pg_database_encoding_max_length() == 1)
+				pos++;
+			else
+				pos += pg_wchar_mblen(pos);
+		}
+	}
+	return result;
+}
+
+DEVICE_FUNCTION(pg_int4_t)
+pgfn_textpos_warp(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
+{
+	pg_int4_t	result;
+	char	   *s, *p;
+	cl_int		slen, plen;
+	cl_uint		mask;
+	cl_int		lane, rank, nlanes;
+	cl_uint		temp;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (result.isnull)
+		return result;
+	if (!pg_varlena_datum_extract(kcxt, arg1, &s, &slen) ||
+		!pg_varlena_datum_extract(kcxt, arg2, &p, &plen))
+	{
+		result.isnull = true;
+		return result;
+	}
+	mask = __activemask();
+	if (__all_sync(mask, slen < WARP_TEXT_MIN_LENGTH))
+		return pgfn_textpos(kcxt, arg1, arg2);
+
+	lane = (get_local_id() & (warpSize - 1));
+	rank = __popc(mask & ((1U << lane) - 1));
+	nlanes = __popc(mask);
+	for (temp = mask; temp != 0; temp &= (temp - 1))
+	{
+		cl_int		owner = __ffs(temp) - 1;
+		char	   *__s = (char *)__shfl_sync(mask, (cl_ulong)s, owner);
+		char	   *__p = (char *)__shfl_sync(mask, (cl_ulong)p, owner);
+		cl_int		__slen = __shfl_sync(mask, slen, owner);
+		cl_int		__plen = __shfl_sync(mask, plen, owner);
+		cl_int		k, base, nchars;
+
+		if (__plen == 0)
+			k = 0;
+		else
+			k = __warp_strstr(mask, rank, nlanes,
+							  __s, __slen, __p, __plen, 0, false);
+		if (k < 0)
+			nchars = -1;
+		else if (pg_database_encoding_max_length() == 1)
+			nchars = k;
+		else
+		{
+			/* UTF-8; count the leading bytes prior to the position */
+			nchars = 0;
+			for (base = 0; base < k; base += nlanes)
+			{
+				cl_int	i = base + rank;
+
+				nchars += __popc(__ballot_sync(mask, (i < k &&
+													  (__s[i] & 0xc0) != 0x80)));
+			}
+		}
+		if (lane == owner)
+			result.value = nchars + 1;
+		__syncwarp(mask);
+	}
+	return result;
+}
+
 #undef LIKE_TRUE
 #undef LIKE_FALSE
 #undef LIKE_ABORT
+
+/*
+ * Regular expression operators
+ *
+ * The pattern is already compiled to DFA by pgstrom_regex_compile() on
+ * the host side, so all we need to do is walking on the transition table
+ * for each byte of the text.
+ */
+STATIC_FUNCTION(cl_bool)
+RegexExecDFA(kern_context *kcxt, char *s, cl_int slen, pg_bytea_t arg,
+			 cl_bool *p_isnull)
+{
+	const kern_regex_dfa *dfa;
+	const cl_uchar *flags;
+	char	   *p;
+	cl_int		plen;
+	cl_uint		state = 0;
+	cl_int		i;
+
+	if (!pg_varlena_datum_extract(kcxt, arg, &p, &plen))
+	{
+		*p_isnull = true;
+		return false;
+	}
+	dfa = (const kern_regex_dfa *) p;
+	flags = KERN_REGEX_DFA_FLAGS(dfa);
+	for (i=0; i < slen; i++)
+	{
+		if (flags[state] & KERN_REGEX_DFA__ACCEPT)
+			return true;
+		if (flags[state] & KERN_REGEX_DFA__DEAD)
+			return false;
+		state = dfa->trans[state * dfa->nclasses +
+						   dfa->classmap[(cl_uchar) s[i]]];
+	}
+	return (flags[state] & (KERN_REGEX_DFA__ACCEPT |
+							KERN_REGEX_DFA__ACCEPT_EOS)) != 0;
+}
+
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_textregexeq(kern_context *kcxt, pg_text_t arg1, pg_bytea_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		char	   *s;
+		cl_int		slen;
+
+		if (!pg_varlena_datum_extract(kcxt, arg1, &s, &slen))
+		{
+			result.isnull = true;
+			return result;
+		}
+		result.value = RegexExecDFA(kcxt, s, slen, arg2, &result.isnull);
+	}
+	return result;
+}
+
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_textregexne(kern_context *kcxt, pg_text_t arg1, pg_bytea_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		char	   *s;
+		cl_int		slen;
+
+		if (!pg_varlena_datum_extract(kcxt, arg1, &s, &slen))
+		{
+			result.isnull = true;
+			return result;
+		}
+		result.value = !RegexExecDFA(kcxt, s, slen, arg2, &result.isnull);
+	}
+	return result;
+}
@@ -17,6 +17,27 @@
  */
 #ifndef CUDA_TEXTLIB_H
 #define CUDA_TEXTLIB_H
+
+/*
+ * kern_regex_dfa - DFA of regular expression; built by pgstrom_regex_compile
+ * on the host side, then delivered to the device as a bytea parameter.
+ */
+#define KERN_REGEX_DFA__ACCEPT		0x01	/* pattern is already matched */
+#define KERN_REGEX_DFA__ACCEPT_EOS	0x02	/* matched at the end of text */
+#define KERN_REGEX_DFA__DEAD		0x04	/* pattern never matches any more */
+
+typedef struct
+{
+	cl_ushort	nstates;		/* number of the DFA states */
+	cl_ushort	nclasses;		/* number of the byte classes */
+	cl_uchar	classmap[256];	/* byte -> class */
+	cl_ushort	trans[FLEXIBLE_ARRAY_MEMBER];	/* [nstates * nclasses] */
+	/* cl_uchar flags[nstates] follows the transition table */
+} kern_regex_dfa;
+
+#define KERN_REGEX_DFA_FLAGS(dfa)									\
+	((cl_uchar *)((dfa)->trans + (dfa)->nstates * (dfa)->nclasses))
+
 #ifdef __CUDACC__
 DEVICE_INLINE(cl_int)
 bpchar_truelen(const char *s, cl_int len)
@@ -121,5 +142,24 @@ DEVICE_FUNCTION(pg_bool_t)
 pgfn_bpchariclike(kern_context *kcxt, pg_bpchar_t arg1, pg_text_t arg2);
 DEVICE_FUNCTION(pg_bool_t)
 pgfn_bpcharicnlike(kern_context *kcxt, pg_bpchar_t arg1, pg_text_t arg2);
+/* warp-cooperative variants for long text */
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_textlike_warp(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2);
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_textnlike_warp(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2);
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_texticlike_warp(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2);
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_texticnlike_warp(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2);
+/* strpos / position */
+DEVICE_FUNCTION(pg_int4_t)
+pgfn_textpos(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2);
+DEVICE_FUNCTION(pg_int4_t)
+pgfn_textpos_warp(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2);
+/* regular expression operators; pattern is compiled to kern_regex_dfa */
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_textregexeq(kern_context *kcxt, pg_text_t arg1, pg_bytea_t arg2);
+DEVICE_FUNCTION(pg_bool_t)
+pgfn_textregexne(kern_context *kcxt, pg_text_t arg1, pg_bytea_t arg2);
 #endif	/* __CUDACC__ */
 #endif	/* CUDA_TEXTLIB_H */
@@ -1422,6 +1422,139 @@ pgfn_timestamp_timestamptz(kern_context *kcxt, pg_timestamp_t arg1)
 	return timestamp2timestamptz(kcxt, arg1);
 }
 
+/*
+ * timezone() (AT TIME ZONE) with a constant time zone
+ *
+ * The time zone is preprocessed to kern_tz_info on the host side, then
+ * it is delivered as a bytea parameter.
+ */
+STATIC_FUNCTION(const kern_tz_info *)
+__setup_tz_state(kern_context *kcxt, pg_bytea_t arg, tz_state *sp)
+{
+	const kern_tz_info *tzinfo;
+	char	   *base;
+	cl_int		len;
+
+	if (!pg_varlena_datum_extract(kcxt, arg, &base, &len) ||
+		len < sizeof(kern_tz_info))
+	{
+		STROM_EREPORT(kcxt, ERRCODE_DATA_CORRUPTED,
+					  "corrupted time zone parameter");
+		return NULL;
+	}
+	tzinfo = (const kern_tz_info *)base;
+	if (!tzinfo->is_fixed)
+	{
+		sp->leapcnt = tzinfo->leapcnt;
+		sp->timecnt = tzinfo->timecnt;
+		sp->typecnt = tzinfo->typecnt;
+		sp->charcnt = 0;
+		sp->goback  = tzinfo->goback;
+		sp->goahead = tzinfo->goahead;
+		sp->ats     = (cl_long *)(base + tzinfo->ats_offset);
+		sp->types   = (cl_uchar *)(base + tzinfo->types_offset);
+		sp->ttis    = (tz_ttinfo *)(base + tzinfo->ttis_offset);
+		sp->lsis    = (tz_lsinfo *)(base + tzinfo->lsis_offset);
+		sp->defaulttype = tzinfo->defaulttype;
+	}
+	return tzinfo;
+}
+
+DEVICE_FUNCTION(pg_timestamp_t)
+pgfn_timestamptz_zone(kern_context *kcxt,
+					  pg_bytea_t arg1, pg_timestamptz_t arg2)
+{
+	pg_timestamp_t	result;
+	const kern_tz_info *tzinfo;
+	tz_state		tzstate;
+	struct pg_tm	tm;
+	fsec_t			fsec;
+	int				tz;
+
+	result.isnull = (arg1.isnull | arg2.isnull);
+	if (result.isnull)
+		return result;
+	if (TIMESTAMP_NOT_FINITE(arg2.value))
+	{
+		result.value = arg2.value;
+		return result;
+	}
+	tzinfo = __setup_tz_state(kcxt, arg1, &tzstate);
+	if (!tzinfo)
+		result.isnull = true;
+	else if (tzinfo->is_fixed)
+	{
+		/* see dt2local() */
+		result.value = arg2.value - tzinfo->fixed_tz * USECS_PER_SEC;
+	}
+	else if (!timestamp2tm(arg2.value, &tz, &tm, &fsec, &tzstate) ||
+			 !tm2timestamp(&tm, fsec, NULL, &result.value))
+	{
+		result.isnull = true;
+		STROM_EREPORT(kcxt, ERRCODE_DATETIME_VALUE_OUT_OF_RANGE,
+					  "timestamp out of range");
+	}
+	if (!result.isnull && !IS_VALID_TIMESTAMP(result.value))
+	{
+		result.isnull = true;
+		STROM_EREPORT(kcxt, ERRCODE_DATETIME_VALUE_OUT_OF_RANGE,
+					  "timestamp out of range");
+	}
+	return result;
+}
+
+DEVICE_FUNCTION(pg_timestamptz_t)
+pgfn_timestamp_zone(kern_context *kcxt,
+					pg_bytea_t arg1, pg_timestamp_t arg2)
+{
+	pg_timestamptz_t result;
+	const kern_tz_info *tzinfo;
+	tz_state		tzstate;
+	struct pg_tm	tm;
+	fsec_t			fsec;
+	int				tz;
+
+	result.isnull = (arg1.isnull | arg2.isnull);
+	if (result.isnull)
+		return result;
+	if (TIMESTAMP_NOT_FINITE(arg2.value))
+	{
+		result.value = arg2.value;
+		return result;
+	}
+	tzinfo = __setup_tz_state(kcxt, arg1, &tzstate);
+	if (!tzinfo)
+		result.isnull = true;
+	else if (tzinfo->is_fixed)
+	{
+		/* see dt2local() */
+		result.value = arg2.value + tzinfo->fixed_tz * USECS_PER_SEC;
+	}
+	else if (!timestamp2tm(arg2.value, NULL, &tm, &fsec, NULL))
+	{
+		result.isnull = true;
+		STROM_EREPORT(kcxt, ERRCODE_DATETIME_VALUE_OUT_OF_RANGE,
+					  "timestamp out of range");
+	}
+	else
+	{
+		tz = DetermineTimeZoneOffset(&tm, &tzstate);
+		if (!tm2timestamp(&tm, fsec, &tz, &result.value))
+		{
+			result.isnull = true;
+			STROM_EREPORT(kcxt, ERRCODE_DATETIME_VALUE_OUT_OF_RANGE,
+						  "timestamp out of range");
+		}
+	}
+	if (!result.isnull && !IS_VALID_TIMESTAMP(result.value))
+	{
+		result.isnull = true;
+		STROM_EREPORT(kcxt, ERRCODE_DATETIME_VALUE_OUT_OF_RANGE,
+					  "timestamp out of range");
+	}
+	return result;
+}
+
 /*
  * Simple comparison
  */
@@ -17,6 +17,41 @@
  */
 #ifndef CUDA_TIMELIB_H
 #define CUDA_TIMELIB_H
+
+typedef struct {
+	cl_long		ls_trans; /* pg_time_t in original */
+	cl_long		ls_corr;
+} tz_lsinfo;
+typedef struct {
+	cl_int		tt_gmtoff;
+	cl_bool		tt_isdst;
+	cl_int		tt_abbrind;
+	cl_bool		tt_ttisstd;
+	cl_bool		tt_ttisgmt;
+} tz_ttinfo;
+
+/*
+ * kern_tz_info - constant time zone of timezone() (AT TIME ZONE), built
+ * on the host side by codegen. Offsets of the arrays are relative to the
+ * head of kern_tz_info, and 'ats' / 'lsis' are 64bit aligned on the
+ * assumption that the varlena header of kparams is 64bit aligned.
+ */
+typedef struct {
+	cl_int		fixed_tz;		/* valid, if is_fixed */
+	cl_bool		is_fixed;		/* fixed-offset abbreviation */
+	cl_bool		goback;
+	cl_bool		goahead;
+	cl_bool		__padding__;
+	cl_int		leapcnt;
+	cl_int		timecnt;
+	cl_int		typecnt;
+	cl_int		defaulttype;
+	cl_uint		ats_offset;		/* cl_long[timecnt] */
+	cl_uint		lsis_offset;	/* tz_lsinfo[leapcnt] */
+	cl_uint		ttis_offset;	/* tz_ttinfo[typecnt] */
+	cl_uint		types_offset;	/* cl_uchar[timecnt] */
+} kern_tz_info;
+
 #ifdef __CUDACC__
 /* definitions copied from date.h */
 typedef cl_int		DateADT;
@@ -185,17 +220,6 @@ interval_cmp_value(const Interval interval, cl_long *days, cl_long *fraction)
  * to be defined by session information
  */
 DEVICE_FUNCTION(Timestamp) SetEpochTimestamp(void);
-typedef struct {
-	cl_long		ls_trans; /* pg_time_t in original */
-	cl_long		ls_corr;
-} tz_lsinfo;
-typedef struct {
-	cl_int		tt_gmtoff;
-	cl_bool		tt_isdst;
-	cl_int		tt_abbrind;
-	cl_bool		tt_ttisstd;
-	cl_bool		tt_ttisgmt;
-} tz_ttinfo;
 typedef struct {
 	cl_int		leapcnt;
 	cl_int		timecnt;
@@ -541,6 +565,15 @@ DEVICE_FUNCTION(pg_bool_t)
 pgfn_overlaps_timestamptz(kern_context *kcxt,
 						  pg_timestamptz_t arg1, pg_timestamptz_t arg2,
 						  pg_timestamptz_t arg3, pg_timestamptz_t arg4);
+/*
+ * timezone() (AT TIME ZONE) with a constant time zone
+ */
+DEVICE_FUNCTION(pg_timestamp_t)
+pgfn_timestamptz_zone(kern_context *kcxt,
+					  pg_bytea_t arg1, pg_timestamptz_t arg2);
+DEVICE_FUNCTION(pg_timestamptz_t)
+pgfn_timestamp_zone(kern_context *kcxt,
+					pg_bytea_t arg1, pg_timestamp_t arg2);
 /*
  * EXTRACT()
  */
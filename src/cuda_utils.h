@@ -17,6 +17,26 @@
  */
 #ifndef CUDA_UTILS_H
 #define CUDA_UTILS_H
+
+/*
+ * kern_array_consts - constant array of the array operators (&&, @>, <@),
+ * sorted and deduplicated on the host side by codegen. 'values' are 64bit
+ * aligned on the assumption that the varlena header of kparams is 64bit
+ * aligned, like kern_tz_info.
+ */
+typedef struct
+{
+	cl_uint		nitems;			/* number of unique non-NULL items */
+	cl_bool		has_null;		/* true, if any NULL elements */
+	cl_char		__padding__[3];
+	cl_uint		values_offset;	/* cl_long[nitems] from the head */
+} kern_array_consts;
+
+#define KERN_ARRAY_CONSTS__OVERLAP		1	/* array && const */
+#define KERN_ARRAY_CONSTS__CONTAINS		2	/* array @> const */
+#define KERN_ARRAY_CONSTS__CONTAINED	3	/* array <@ const */
+#define KERN_ARRAY_CONSTS_MAX_CONTAINS	256
+
 #ifdef __CUDACC__
 /*
  * NumSmx - reference to the %nsmid register
@@ -805,5 +825,171 @@ PG_SCALAR_ARRAY_OP(kern_context *kcxt,
 	}
 	return result;
 }
+
+/*
+ * Support routine of array operators (&&, @>, <@) towards a constant array
+ *
+ * The constant array is sorted on the host side, so each element of the
+ * array datum is probed by binary search, instead of the nested loop of
+ * array_contain_compare(). NULL elements never match anything.
+ */
+DEVICE_INLINE(cl_int)
+__array_consts_search(const cl_long *values, cl_uint nitems, cl_long key)
+{
+	cl_uint		head = 0;
+	cl_uint		tail = nitems;
+
+	while (head < tail)
+	{
+		cl_uint		curr = (head + tail) / 2;
+
+		if (values[curr] < key)
+			head = curr + 1;
+		else if (values[curr] > key)
+			tail = curr;
+		else
+			return curr;
+	}
+	return -1;
+}
+
+template <typename ElementType>
+DEVICE_INLINE(pg_bool_t)
+PG_ARRAY_CONSTS_MATCH(kern_context *kcxt,
+					  pg_array_t array,
+					  pg_bytea_t consts,
+					  cl_int mode,		/* one of KERN_ARRAY_CONSTS__* */
+					  cl_int typelen,
+					  cl_int typealign)
+{
+	kern_colmeta *smeta = array.smeta;
+	const kern_array_consts *ac;
+	const cl_long *values;
+	ElementType	element;
+	pg_bool_t	result;
+	char	   *cbase;
+	cl_int		clen;
+	char	   *base;
+	cl_uint		offset = 0;
+	char	   *nullmap = NULL;
+	int			nullmask = 1;
+	cl_uint		found[KERN_ARRAY_CONSTS_MAX_CONTAINS / 32];
+	cl_uint		nfound = 0;
+	cl_uint		i, nitems;
+	cl_int		k;
+
+	result.isnull = (array.isnull | consts.isnull);
+	result.value = false;
+	if (result.isnull)
+		return result;
+	if (!pg_varlena_datum_extract(kcxt, consts, &cbase, &clen) ||
+		clen < sizeof(kern_array_consts))
+	{
+		STROM_EREPORT(kcxt, ERRCODE_DATA_CORRUPTED,
+					  "corrupted constant array parameter");
+		result.isnull = true;
+		return result;
+	}
+	ac = (const kern_array_consts *)cbase;
+	values = (const cl_long *)(cbase + ac->values_offset);
+	if (mode == KERN_ARRAY_CONSTS__CONTAINS)
+	{
+		/* NULL element of the constant never matches */
+		if (ac->has_null)
+			return result;
+		if (ac->nitems == 0)
+		{
+			result.value = true;
+			return result;
+		}
+		memset(found, 0, sizeof(found));
+	}
+	/* result if all the elements are walked */
+	result.value = (mode == KERN_ARRAY_CONSTS__CONTAINED);
+
+	if (array.length < 0)
+	{
+		nitems = ArrayGetNItems(kcxt,
+								ARR_NDIM(array.value),
+								ARR_DIMS(array.value));
+		base = ARR_DATA_PTR(array.value);
+		nullmap = ARR_NULLBITMAP(array.value);
+	}
+	else
+	{
+		nitems = array.length;
+		base = (char *)array.value;
+		if (smeta->nullmap_offset != 0)
+			nullmap = base + __kds_unpack(smeta->nullmap_offset);
+	}
+
+	for (i=0; i < nitems; i++)
+	{
+		if (nullmap && (*nullmap & nullmask) == 0)
+			pg_datum_ref(kcxt, element, NULL);
+		else if (array.length < 0)
+		{
+			/* PG Array */
+			char   *pos = base + offset;
+
+			pg_datum_ref(kcxt, element, pos);
+			offset = TYPEALIGN(typealign, offset + typelen);
+		}
+		else
+		{
+			/* Arrow::List */
+			assert(i < array.length);
+			pg_datum_fetch_arrow(kcxt, element, smeta, base, i);
+		}
+		/* advance nullmap pointer if any */
+		if (nullmap)
+		{
+			nullmask <<= 1;
+			if (nullmask == 0x0100)
+			{
+				nullmap++;
+				nullmask = 1;
+			}
+		}
+
+		if (element.isnull)
+		{
+			if (mode == KERN_ARRAY_CONSTS__CONTAINED)
+			{
+				result.value = false;
+				break;
+			}
+			continue;
+		}
+		k = __array_consts_search(values, ac->nitems,
+								  (cl_long)element.value);
+		if (mode == KERN_ARRAY_CONSTS__OVERLAP)
+		{
+			if (k >= 0)
+			{
+				result.value = true;
+				break;
+			}
+		}
+		else if (mode == KERN_ARRAY_CONSTS__CONTAINED)
+		{
+			if (k < 0)
+			{
+				result.value = false;
+				break;
+			}
+		}
+		else if (k >= 0 && (found[k / 32] & (1U << (k % 32))) == 0)
+		{
+			found[k / 32] |= (1U << (k % 32));
+			if (++nfound == ac->nitems)
+			{
+				result.value = true;
+				break;
+			}
+		}
+	}
+	return result;
+}
 #endif  /* __CUDACC__ */
 #endif  /* CUDA_UTILS_H */
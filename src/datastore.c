@@ -19,6 +19,9 @@
 #include "pg_strom.h"
 #include "cuda_numeric.h"
 #include "nvme_strom.h"
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
 
 /*
  * estimate_num_chunks
@@ -97,22 +100,73 @@ KDS_fetch_tuple_slot(TupleTableSlot *slot,
 		ExecClearTuple(slot);
 		memcpy(slot->tts_values, tts_values, sizeof(Datum) * natts);
 		memcpy(slot->tts_isnull, tts_isnull, sizeof(bool) * natts);
-#ifdef NOT_USED
-		/*
-		 * XXX - pointer reference is better than memcpy from performance
-		 * perspectives, however, we need to ensure tts_values/tts_isnull
-		 * shall be restored when pgstrom-data-store is released.
-		 * It will be cause of complicated / invisible bugs.
-		 */
-		slot->tts_values = tts_values;
-		slot->tts_isnull = tts_isnull;
+		ExecStoreVirtualTuple(slot);
+		return true;
+	}
+	return false;
+}
+
+/*
+ * KDS_fetch_tuple_slot_ref - zero-copy version of KDS_fetch_tuple_slot
+ *
+ * It points tts_values/tts_isnull of the slot to the KDS_FORMAT_SLOT buffer
+ * directly, instead of memcpy. Varlena datum is already a valid pointer in
+ * the host address space, because the buffer is managed memory.
+ * The original arrays of the slot are saved on the GpuTaskState, then
+ * PDS_release_slot_ref() restores them prior to release of the buffer.
+ */
+static bool
+KDS_fetch_tuple_slot_ref(TupleTableSlot *slot,
+						 kern_data_store *kds,
+						 GpuTaskState *gts,
+						 size_t row_index)
+{
+	if (row_index < kds->nitems)
+	{
+		Datum  *tts_values = KERN_DATA_STORE_VALUES(kds, row_index);
+		char   *tts_isnull = KERN_DATA_STORE_DCLASS(kds, row_index);
+#ifdef USE_ASSERT_CHECKING
+		int		i, natts = slot->tts_tupleDescriptor->natts;
+
+		for (i=0; i < natts; i++)
+			Assert(tts_isnull[i] == DATUM_CLASS__NORMAL ||
+				   tts_isnull[i] == DATUM_CLASS__NULL);
 #endif
+		ExecClearTuple(slot);
+		if (gts->curr_slot_ref != slot)
+		{
+			PDS_release_slot_ref(gts);
+			gts->curr_slot_ref = slot;
+			gts->curr_slot_values = slot->tts_values;
+			gts->curr_slot_isnull = slot->tts_isnull;
+		}
+		slot->tts_values = tts_values;
+		slot->tts_isnull = (bool *)tts_isnull;
 		ExecStoreVirtualTuple(slot);
 		return true;
 	}
 	return false;
 }
 
+/*
+ * PDS_release_slot_ref - restore the slot which references KDS_FORMAT_SLOT
+ */
+void
+PDS_release_slot_ref(GpuTaskState *gts)
+{
+	TupleTableSlot *slot = gts->curr_slot_ref;
+
+	if (slot)
+	{
+		ExecClearTuple(slot);
+		slot->tts_values = gts->curr_slot_values;
+		slot->tts_isnull = gts->curr_slot_isnull;
+		gts->curr_slot_ref = NULL;
+		gts->curr_slot_values = NULL;
+		gts->curr_slot_isnull = NULL;
+	}
+}
+
 bool
 KDS_fetch_tuple_column(TupleTableSlot *slot,
 					   kern_data_store *kds,
@@ -220,8 +274,8 @@ PDS_fetch_tuple(TupleTableSlot *slot,
 									   &gts->curr_tuple,
 									   gts->curr_index++);
 		case KDS_FORMAT_SLOT:
-			return KDS_fetch_tuple_slot(slot, &pds->kds,
-										gts->curr_index++);
+			return KDS_fetch_tuple_slot_ref(slot, &pds->kds, gts,
+											gts->curr_index++);
 		case KDS_FORMAT_BLOCK:
 			return KDS_fetch_tuple_block(slot, &pds->kds, gts);
 		case KDS_FORMAT_COLUMN:
@@ -289,6 +343,7 @@ __PDS_clone(pgstrom_data_store *pds_old,
 	pg_atomic_init_u32(&pds_new->refcnt, 1);
 	pds_new->nblocks_uncached = 0;
 	pds_new->filedesc = -1;
+	pds_new->recycle_sz = 0;
 	memcpy(&pds_new->kds,
 		   &pds_old->kds,
 		   KERN_DATA_STORE_HEAD_LENGTH(&pds_old->kds));
@@ -299,6 +354,71 @@ __PDS_clone(pgstrom_data_store *pds_old,
 	return pds_new;
 }
 
+/*
+ * __PDS_alloc_buffer - allocation of PDS buffer, with reuse of the recycled
+ * buffers of the same length, if any.
+ */
+static CUresult
+__PDS_alloc_buffer(GpuContext *gcontext,
+				   void **p_buffer, size_t length, bool is_hostmem,
+				   const char *filename, int lineno)
+{
+	int			i;
+
+	SpinLockAcquire(&gcontext->pds_recycle_lock);
+	for (i = gcontext->pds_recycle_nitems - 1; i >= 0; i--)
+	{
+		if (gcontext->pds_recycle[i].length == length &&
+			gcontext->pds_recycle[i].is_hostmem == is_hostmem)
+		{
+			*p_buffer = gcontext->pds_recycle[i].ptr;
+			gcontext->pds_recycle[i]
+				= gcontext->pds_recycle[--gcontext->pds_recycle_nitems];
+			SpinLockRelease(&gcontext->pds_recycle_lock);
+			return CUDA_SUCCESS;
+		}
+	}
+	SpinLockRelease(&gcontext->pds_recycle_lock);
+
+	if (is_hostmem)
+		return __gpuMemAllocHost(gcontext, p_buffer, length,
+								 filename, lineno);
+	return __gpuMemAllocManaged(gcontext,
+								(CUdeviceptr *)p_buffer,
+								length,
+								CU_MEM_ATTACH_GLOBAL,
+								filename, lineno);
+}
+
+/*
+ * PDS_flush_recycled - release all the PDS buffers kept for reuse
+ *
+ * It must be called prior to the reclaim of memory segments and the
+ * destruction of CUDA context.
+ */
+void
+PDS_flush_recycled(GpuContext *gcontext)
+{
+	void	   *ptr;
+	CUresult	rc;
+
+	for (;;)
+	{
+		SpinLockAcquire(&gcontext->pds_recycle_lock);
+		if (gcontext->pds_recycle_nitems == 0)
+		{
+			SpinLockRelease(&gcontext->pds_recycle_lock);
+			break;
+		}
+		ptr = gcontext->pds_recycle[--gcontext->pds_recycle_nitems].ptr;
+		SpinLockRelease(&gcontext->pds_recycle_lock);
+
+		rc = gpuMemFree(gcontext, (CUdeviceptr) ptr);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on gpuMemFree: %s", errorText(rc));
+	}
+}
+
 /*
  * PDS_retain
  */
@@ -331,7 +451,10 @@ PDS_release(pgstrom_data_store *pds)
 		if (!pds->gcontext)
 		{
 			Assert(pds->kds.format == KDS_FORMAT_ARROW);
-			pfree(pds);
+			if (pds->mmap_length == 0)
+				pfree(pds);
+			else if (__munmapFile(pds) != 0)
+				elog(ERROR, "failed on __munmapFile: %m");
 		}
 #if 0
 		else if ((pds->kds.format == KDS_FORMAT_BLOCK) ||
@@ -344,6 +467,22 @@ PDS_release(pgstrom_data_store *pds)
 #endif
 		else
 		{
+			/* keep the chunk-sized buffer for reuse, if any room */
+			if (pds->recycle_sz > 0)
+			{
+				SpinLockAcquire(&gcontext->pds_recycle_lock);
+				if (gcontext->pds_recycle_nitems < PDS_RECYCLE_NSLOTS)
+				{
+					int		i = gcontext->pds_recycle_nitems++;
+
+					gcontext->pds_recycle[i].ptr = pds;
+					gcontext->pds_recycle[i].length = pds->recycle_sz;
+					gcontext->pds_recycle[i].is_hostmem = pds->recycle_hostmem;
+					SpinLockRelease(&gcontext->pds_recycle_lock);
+					return;
+				}
+				SpinLockRelease(&gcontext->pds_recycle_lock);
+			}
 			rc = gpuMemFree(gcontext, (CUdeviceptr) pds);
 			if (rc != CUDA_SUCCESS)
 				werror("failed on gpuMemFree: %s", errorText(rc));
@@ -586,19 +725,15 @@ __PDS_create_row(GpuContext *gcontext,
 				 const char *filename, int lineno)
 {
 	pgstrom_data_store *pds;
-	CUdeviceptr	m_deviceptr;
+	size_t		length;
 	CUresult	rc;
 
 	bytesize = STROMALIGN_DOWN(bytesize);
-	rc = __gpuMemAllocManaged(gcontext,
-							  &m_deviceptr,
-							  offsetof(pgstrom_data_store,
-									   kds) + bytesize,
-							  CU_MEM_ATTACH_GLOBAL,
-							  filename, lineno);
+	length = offsetof(pgstrom_data_store, kds) + bytesize;
+	rc = __PDS_alloc_buffer(gcontext, (void **)&pds, length, false,
+							filename, lineno);
 	if (rc != CUDA_SUCCESS)
 		werror("out of managed memory");
-	pds = (pgstrom_data_store *) m_deviceptr;
 
 	/* setup */
 	pds->gcontext = gcontext;
@@ -607,6 +742,8 @@ __PDS_create_row(GpuContext *gcontext,
 						   KDS_FORMAT_ROW, INT_MAX);
 	pds->nblocks_uncached = 0;
 	pds->filedesc = -1;
+	pds->recycle_sz = (length <= pgstrom_chunk_size() ? length : 0);
+	pds->recycle_hostmem = false;
 
 	return pds;
 }
@@ -642,6 +779,7 @@ __PDS_create_hash(GpuContext *gcontext,
 						   KDS_FORMAT_HASH, INT_MAX);
 	pds->nblocks_uncached = 0;
 	pds->filedesc = -1;
+	pds->recycle_sz = 0;
 
 	return pds;
 }
@@ -653,8 +791,8 @@ __PDS_create_slot(GpuContext *gcontext,
 				  const char *filename, int lineno)
 {
 	pgstrom_data_store *pds;
-	CUdeviceptr	m_deviceptr;
 	CUresult	rc;
+	size_t		length;
 	size_t		kds_head_sz;
 	size_t		unitsz;
 	size_t		nrooms;
@@ -666,15 +804,11 @@ __PDS_create_slot(GpuContext *gcontext,
 	unitsz = MAXALIGN((sizeof(Datum) + sizeof(char)) * tupdesc->natts);
 	nrooms = (bytesize - kds_head_sz) / unitsz;
 
-	rc = __gpuMemAllocManaged(gcontext,
-							  &m_deviceptr,
-							  offsetof(pgstrom_data_store,
-									   kds) + bytesize,
-							  CU_MEM_ATTACH_GLOBAL,
-							  filename, lineno);
+	length = offsetof(pgstrom_data_store, kds) + bytesize;
+	rc = __PDS_alloc_buffer(gcontext, (void **)&pds, length, false,
+							filename, lineno);
 	if (rc != CUDA_SUCCESS)
 		werror("out of managed memory");
-	pds = (pgstrom_data_store *) m_deviceptr;
 
 	/* setup */
 	pds->gcontext = gcontext;
@@ -684,6 +818,8 @@ __PDS_create_slot(GpuContext *gcontext,
 						   KDS_FORMAT_SLOT, nrooms);
 	pds->nblocks_uncached = 0;
 	pds->filedesc = -1;
+	pds->recycle_sz = (length <= pgstrom_chunk_size() ? length : 0);
+	pds->recycle_hostmem = false;
 
 	return pds;
 }
@@ -708,10 +844,9 @@ __PDS_create_block(GpuContext *gcontext,
 			 offsetof(pgstrom_data_store, kds) + bytesize,
 			 pgstrom_chunk_size());
 
-	rc = __gpuMemAllocHost(gcontext,
-						   (void **)&pds,
-						   pgstrom_chunk_size(),
-						   filename, lineno);
+	rc = __PDS_alloc_buffer(gcontext, (void **)&pds,
+							pgstrom_chunk_size(), true,
+							filename, lineno);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on gpuMemAllocHost: %s", errorText(rc));
 	/* setup */
@@ -722,6 +857,10 @@ __PDS_create_block(GpuContext *gcontext,
     pds->kds.nrows_per_block = nvme_sstate->nrows_per_block;
     pds->nblocks_uncached = 0;
 	pds->filedesc = -1;
+	pds->xvis = NULL;
+	pds->nblocks_unchecked = 0;
+	pds->recycle_sz = pgstrom_chunk_size();
+	pds->recycle_hostmem = true;
 
 	return pds;
 }
@@ -802,6 +941,8 @@ nvme_sstate_open_files(GpuContext *gcontext,
 			elog(ERROR, "out of memory");
 		}
 		nvme_sstate->fdesc[i] = fdesc;
+		/* register the file handle, if GPUDirect Storage */
+		cufileRegisterFileDesc(fdesc);
 	}
 
 	while (i < nvme_sstate->nr_segs)
@@ -813,7 +954,84 @@ nvme_sstate_open_files(GpuContext *gcontext,
 			elog(ERROR, "out of memory");
 		}
 		nvme_sstate->fdesc[i] = fdesc;
+		cufileRegisterFileDesc(fdesc);
+		i++;
+	}
+}
+
+/*
+ * __PDS_setup_xact_visibility
+ *
+ * It builds kern_xact_visibility on the managed memory, if MVCC visibility
+ * of the blocks not all-visible can be checked on the GPU device. Elsewhere,
+ * it returns NULL, then these blocks are loaded through the shared buffer.
+ */
+static kern_xact_visibility *
+__PDS_setup_xact_visibility(GpuContext *gcontext,
+							Relation relation,
+							Snapshot snapshot)
+{
+	kern_xact_visibility *xvis;
+	TransactionId	xid_base = relation->rd_rel->relfrozenxid;
+	TransactionId	xid;
+	cl_uchar	   *bitmap;
+	cl_uint			xcnt;
+	cl_uint			nxids;
+	cl_uint			i;
+	size_t			length;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+
+	/*
+	 * GPU does not look at MultiXactId, sub-transactions, and tuples
+	 * by the current transaction. If the relation contains no MultiXactId
+	 * at the beginning of the scan, t_xmax with MultiXactId is always
+	 * newer than the snapshot.
+	 */
+	if (nvme_strom_visibility_window() == 0 ||
+		!IsMVCCSnapshot(snapshot) ||
+		snapshot->takenDuringRecovery ||
+		snapshot->suboverflowed ||
+		TransactionIdIsValid(GetTopTransactionIdIfAny()) ||
+		!TransactionIdIsNormal(xid_base) ||
+		!TransactionIdPrecedes(xid_base, snapshot->xmax) ||
+		relation->rd_rel->relminmxid != ReadNextMultiXactId())
+		return NULL;
+	nxids = snapshot->xmax - xid_base;
+	if (nxids > nvme_strom_visibility_window())
+		return NULL;
+
+	xcnt = snapshot->xcnt + snapshot->subxcnt;
+	length = STROMALIGN(offsetof(kern_xact_visibility, xip[xcnt]) +
+						(nxids + BITS_PER_BYTE - 1) / BITS_PER_BYTE);
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	xvis = (kern_xact_visibility *) m_deviceptr;
+	memset(xvis, 0, length);
+	xvis->length   = length;
+	xvis->xmin     = snapshot->xmin;
+	xvis->xmax     = snapshot->xmax;
+	xvis->xid_base = xid_base;
+	xvis->xcnt     = xcnt;
+	memcpy(xvis->xip, snapshot->xip,
+		   sizeof(TransactionId) * snapshot->xcnt);
+	memcpy(xvis->xip + snapshot->xcnt, snapshot->subxip,
+		   sizeof(TransactionId) * snapshot->subxcnt);
+	qsort(xvis->xip, xcnt, sizeof(TransactionId), xidComparator);
+
+	/* commit status of the transactions in [xid_base, xmax) */
+	bitmap = KERN_XACT_VISIBILITY_BITMAP(xvis);
+	for (i=0, xid=xid_base; i < nxids; i++, xid++)
+	{
+		if (TransactionIdIsNormal(xid) &&
+			TransactionIdDidCommit(xid))
+			bitmap[i / BITS_PER_BYTE] |= (1 << (i % BITS_PER_BYTE));
 	}
+	return xvis;
 }
 
 /*
@@ -840,11 +1058,17 @@ PDS_init_heapscan_state(GpuTaskState *gts)
 	 * Check storage capability of NVMe-Strom
 	 */
 	if (nrows_per_block == 0 ||
-		!RelationCanUseNvmeStrom(relation) ||
-		(nr_blocks = RelationGetNumberOfBlocks(relation)) <= RELSEG_SIZE)
-	{
+		!RelationCanUseNvmeStrom(relation))
+		return;
+	/*
+	 * Relations less than a segment are usually cached, however, we allow
+	 * partial scan unless it fits into a single chunk. Blocks on the shared
+	 * buffer are loaded by CPU, and the worker also routes the blocks on the
+	 * page cache to the host path.
+	 */
+	nr_blocks = RelationGetNumberOfBlocks(relation);
+	if (nr_blocks <= RELSEG_SIZE && !nvme_strom_partial_scan())
 		return;
-	}
 
 	/*
 	 * Calculation of an optimal number of data-blocks for each PDS.
@@ -868,6 +1092,8 @@ PDS_init_heapscan_state(GpuTaskState *gts)
 
 	nchunks = (RELSEG_SIZE + nrooms_max - 1) / nrooms_max;
 	nblocks_per_chunk = (RELSEG_SIZE + nchunks - 1) / nchunks;
+	if (nr_blocks <= nblocks_per_chunk)
+		return;
 
 	/* allocation of NVMEScanState structure */
 	nr_segs = (nr_blocks + (BlockNumber) RELSEG_SIZE - 1) / RELSEG_SIZE;
@@ -878,6 +1104,8 @@ PDS_init_heapscan_state(GpuTaskState *gts)
 	nvme_sstate->nblocks_per_chunk = nblocks_per_chunk;
 	nvme_sstate->curr_segno = InvalidBlockNumber;
 	nvme_sstate->curr_vmbuffer = InvalidBuffer;
+	nvme_sstate->xvis = __PDS_setup_xact_visibility(gcontext, relation,
+													estate->es_snapshot);
 	nvme_sstate->nr_segs = nr_segs;
 	nvme_sstate_open_files(gcontext, nvme_sstate, relation);
 
@@ -902,10 +1130,14 @@ PDS_end_heapscan_state(GpuTaskState *gts)
 			ReleaseBuffer(nvme_sstate->curr_vmbuffer);
 			nvme_sstate->curr_vmbuffer = InvalidBuffer;
 		}
+		/* release visibility info, if any */
+		if (nvme_sstate->xvis)
+			gpuMemFree(gcontext, (CUdeviceptr)nvme_sstate->xvis);
 		/* close file descriptors, if any */
 		for (i=0; i < nvme_sstate->nr_segs; i++)
 		{
 			fdesc = nvme_sstate->fdesc[i];
+			cufileUnregisterFileDesc(fdesc);
 			untrackRawFileDesc(gcontext, fdesc);
 			if (close(fdesc))
 				elog(NOTICE, "failed on close(%d): %m", fdesc);
@@ -934,6 +1166,7 @@ PDS_exec_heapscan_block(pgstrom_data_store *pds,
 	Page			dpage;
 	cl_uint			nr_loaded;
 	bool			all_visible;
+	bool			vm_all_visible = false;
 
 	/* PDS cannot eat any blocks more, obviously */
 	if (pds->kds.nitems >= pds->kds.nrooms)
@@ -944,12 +1177,14 @@ PDS_exec_heapscan_block(pgstrom_data_store *pds,
 
 	/*
 	 * NVMe-Strom can be applied only when filesystem supports the feature,
-	 * and the current source block is all-visible.
+	 * and the current source block is all-visible, or its visibility can be
+	 * checked on the GPU device.
 	 * Elsewhere, we will go fallback with synchronized buffer scan.
 	 */
 	if (RelationCanUseNvmeStrom(relation) &&
-		VM_ALL_VISIBLE(relation, blknum,
-					   &nvme_sstate->curr_vmbuffer))
+		((vm_all_visible = VM_ALL_VISIBLE(relation, blknum,
+										  &nvme_sstate->curr_vmbuffer)) ||
+		 nvme_sstate->xvis != NULL))
 	{
 		BufferTag	newTag;
 		uint32		newHash;
@@ -988,6 +1223,11 @@ PDS_exec_heapscan_block(pgstrom_data_store *pds,
 				pds->nblocks_uncached++;
 				pds->kds.nitems++;
 				block_nums[pds->kds.nrooms - pds->nblocks_uncached] = blknum;
+				/* visibility shall be checked on the tail blocks */
+				if (!vm_all_visible)
+					pds->xvis = nvme_sstate->xvis;
+				if (pds->xvis)
+					pds->nblocks_unchecked = pds->nblocks_uncached;
 
 				retval = true;
 			}
@@ -1057,13 +1297,255 @@ PDS_exec_heapscan_block(pgstrom_data_store *pds,
 	return true;
 }
 
+/*
+ * PDS_inline_external_tuples
+ *
+ * Device code cannot fetch external toast datum from the TOAST relation,
+ * so these tuples always fell back to CPU. This routine replaces the tuples
+ * that have external datum by the flatten version; all the external datum
+ * are fetched and decompressed, then embedded inline.
+ * If we have no space on the KDS, the original tuple is kept as is, then
+ * device code will run CPU fallback for them.
+ */
+static void
+PDS_inline_external_tuples(kern_data_store *kds, TupleDesc tupdesc,
+						   cl_uint *tup_index, int ntup)
+{
+	Datum	   *values = alloca(sizeof(Datum) * tupdesc->natts);
+	bool	   *isnull = alloca(sizeof(bool) * tupdesc->natts);
+	Datum	   *tofree = alloca(sizeof(Datum) * tupdesc->natts);
+	int			i, j, nfree;
+
+	for (i=0; i < ntup; i++)
+	{
+		kern_tupitem   *tup_item = (kern_tupitem *)
+			((char *)kds + __kds_unpack(tup_index[i]));
+		HeapTupleData	tup;
+		HeapTuple		newtup;
+		size_t			curr_usage;
+
+		if (!HeapTupleHeaderHasExternal(&tup_item->htup))
+			continue;
+		tup.t_len = tup_item->t_len;
+		tup.t_self = tup_item->t_self;
+		tup.t_tableOid = kds->table_oid;
+		tup.t_data = &tup_item->htup;
+
+		heap_deform_tuple(&tup, tupdesc, values, isnull);
+		nfree = 0;
+		for (j=0; j < tupdesc->natts; j++)
+		{
+			Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
+			struct varlena *vl;
+
+			if (isnull[j] || attr->attlen != -1)
+				continue;
+			vl = (struct varlena *) DatumGetPointer(values[j]);
+			if (VARATT_IS_EXTERNAL(vl))
+			{
+				values[j] = PointerGetDatum(heap_tuple_untoast_attr(vl));
+				tofree[nfree++] = values[j];
+			}
+		}
+		newtup = heap_form_tuple(tupdesc, values, isnull);
+		/* see toast_flatten_tuple(); header fields must be preserved */
+		newtup->t_data->t_choice = tup.t_data->t_choice;
+		newtup->t_data->t_ctid = tup.t_data->t_ctid;
+		newtup->t_data->t_infomask &= ~HEAP_XACT_MASK;
+		newtup->t_data->t_infomask |= (tup.t_data->t_infomask & HEAP_XACT_MASK);
+		newtup->t_data->t_infomask2 &= ~HEAP2_XACT_MASK;
+		newtup->t_data->t_infomask2 |= (tup.t_data->t_infomask2 & HEAP2_XACT_MASK);
+
+		curr_usage = (__kds_unpack(kds->usage) +
+					  MAXALIGN(offsetof(kern_tupitem, htup) + newtup->t_len));
+		if (KERN_DATA_STORE_HEAD_LENGTH(kds) +
+			STROMALIGN(sizeof(cl_uint) * (kds->nitems + ntup)) +
+			curr_usage <= kds->length)
+		{
+			tup_item = (kern_tupitem *)((char *)kds + kds->length - curr_usage);
+			tup_index[i] = __kds_packed((uintptr_t)tup_item - (uintptr_t)kds);
+			tup_item->t_len = newtup->t_len;
+			tup_item->t_self = tup.t_self;
+			memcpy(&tup_item->htup, newtup->t_data, newtup->t_len);
+			kds->usage = __kds_packed(curr_usage);
+		}
+		heap_freetuple(newtup);
+		for (j=0; j < nfree; j++)
+			pfree(DatumGetPointer(tofree[j]));
+	}
+}
+
+/*
+ * Helper threads to copy tuples of heap-scan
+ *
+ * Backend process is not thread-safe, so the helper threads never call any
+ * PostgreSQL APIs. The backend reads the buffer and checks visibility of
+ * the tuples under the buffer lock, and reserves the destination on the
+ * KDS. Then, the helper threads copy the tuple bodies while the backend
+ * keeps only the buffer pin, like the page-at-a-time mode of heapam doing.
+ */
+typedef struct
+{
+	void	   *dest;
+	void	   *source;
+	cl_uint		length;
+} pdsCopyItem;
+
+typedef struct
+{
+	dlist_node	chain;
+	Buffer		buffer;		/* pinned buffer; released by the backend */
+	bool		is_done;	/* protected by pds_copy_lock */
+	cl_int		nitems;
+	pdsCopyItem	items[MaxHeapTuplesPerPage];
+} pdsCopyJob;
+
+#define PDS_COPY_MAX_INFLIGHT		64
+
+static pthread_mutex_t	pds_copy_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	pds_copy_cond = PTHREAD_COND_INITIALIZER;
+static dlist_head		pds_copy_pending_list
+							= DLIST_STATIC_INIT(pds_copy_pending_list);
+static int				pds_copy_num_threads = 0;
+/* only backend touches the variables below */
+static pdsCopyJob	   *pds_copy_inflight[PDS_COPY_MAX_INFLIGHT];
+static int				pds_copy_head = 0;
+static int				pds_copy_ninflight = 0;
+static pdsCopyJob	   *pds_copy_free_job = NULL;
+
+static void *
+PDS_copy_worker_main(void *arg)
+{
+	pdsCopyJob *job;
+	dlist_node *dnode;
+	int			i;
+
+	for (;;)
+	{
+		pthreadMutexLock(&pds_copy_lock);
+		while (dlist_is_empty(&pds_copy_pending_list))
+			pthreadCondWait(&pds_copy_cond, &pds_copy_lock);
+		dnode = dlist_pop_head_node(&pds_copy_pending_list);
+		pthreadMutexUnlock(&pds_copy_lock);
+
+		job = dlist_container(pdsCopyJob, chain, dnode);
+		for (i=0; i < job->nitems; i++)
+			memcpy(job->items[i].dest,
+				   job->items[i].source,
+				   job->items[i].length);
+
+		pthreadMutexLock(&pds_copy_lock);
+		job->is_done = true;
+		pthreadCondBroadcast(&pds_copy_cond);
+		pthreadMutexUnlock(&pds_copy_lock);
+	}
+	return NULL;
+}
+
+/*
+ * PDS_copy_worker_startup - launch the helper threads on demand
+ */
+static bool
+PDS_copy_worker_startup(void)
+{
+	sigset_t	sigmask;
+	sigset_t	oldmask;
+
+	if (pds_copy_num_threads >= pgstrom_heapscan_copy_threads)
+		return (pds_copy_num_threads > 0);
+	/* helper threads never handle any signals */
+	sigfillset(&sigmask);
+	if ((errno = pthread_sigmask(SIG_SETMASK, &sigmask, &oldmask)) != 0)
+		elog(ERROR, "failed on pthread_sigmask: %m");
+	while (pds_copy_num_threads < pgstrom_heapscan_copy_threads)
+	{
+		pthread_t	thread;
+
+		if ((errno = pthread_create(&thread, NULL,
+									PDS_copy_worker_main, NULL)) != 0)
+		{
+			elog(LOG, "failed on pthread_create: %m");
+			break;
+		}
+		pthread_detach(thread);
+		pds_copy_num_threads++;
+	}
+	if ((errno = pthread_sigmask(SIG_SETMASK, &oldmask, NULL)) != 0)
+		elog(ERROR, "failed on pthread_sigmask: %m");
+
+	return (pds_copy_num_threads > 0);
+}
+
+/*
+ * PDS_copy_wait_oldest - wait for completion of the oldest job, then
+ * release the buffer pin.
+ */
+static void
+PDS_copy_wait_oldest(void)
+{
+	pdsCopyJob *job;
+
+	Assert(pds_copy_ninflight > 0);
+	job = pds_copy_inflight[pds_copy_head];
+	pthreadMutexLock(&pds_copy_lock);
+	while (!job->is_done)
+		pthreadCondWait(&pds_copy_cond, &pds_copy_lock);
+	pthreadMutexUnlock(&pds_copy_lock);
+
+	ReleaseBuffer(job->buffer);
+	pds_copy_inflight[pds_copy_head] = NULL;
+	pds_copy_head = (pds_copy_head + 1) % PDS_COPY_MAX_INFLIGHT;
+	pds_copy_ninflight--;
+	/* keep one job for reuse */
+	if (!pds_copy_free_job)
+		pds_copy_free_job = job;
+	else
+		pfree(job);
+}
+
+/*
+ * PDS_copy_submit_job
+ */
+static void
+PDS_copy_submit_job(pdsCopyJob *job)
+{
+	int			index;
+
+	if (pds_copy_ninflight >= PDS_COPY_MAX_INFLIGHT)
+		PDS_copy_wait_oldest();
+	index = (pds_copy_head + pds_copy_ninflight) % PDS_COPY_MAX_INFLIGHT;
+	pds_copy_inflight[index] = job;
+	pds_copy_ninflight++;
+
+	job->is_done = false;
+	pthreadMutexLock(&pds_copy_lock);
+	dlist_push_tail(&pds_copy_pending_list, &job->chain);
+	pthreadCondSignal(&pds_copy_cond);
+	pthreadMutexUnlock(&pds_copy_lock);
+}
+
+/*
+ * PDS_wait_heapscan_copy
+ *
+ * It waits for completion of all the tuple copies by the helper threads.
+ * Caller must ensure it is called prior to use of the PDS, and prior to
+ * the release of buffer pins on error.
+ */
+void
+PDS_wait_heapscan_copy(void)
+{
+	while (pds_copy_ninflight > 0)
+		PDS_copy_wait_oldest();
+}
+
 /*
  * PDS_exec_heapscan_row - PDS scan for KDS_FORMAT_ROW format
  */
 static bool
 PDS_exec_heapscan_row(pgstrom_data_store *pds,
 					  Relation relation,
-					  HeapScanDesc hscan)
+					  HeapScanDesc hscan,
+					  bool async_copy)
 {
 	BlockNumber		blknum = hscan->rs_cblock;
 	Snapshot		snapshot = ((TableScanDesc)hscan)->rs_snapshot;
@@ -1079,6 +1561,8 @@ PDS_exec_heapscan_row(pgstrom_data_store *pds,
 	kern_tupitem   *tup_item;
 	bool			all_visible;
 	Size			max_consume;
+	pdsCopyJob	   *job = NULL;
+	bool			has_external = false;
 
 	/* Load the target buffer */
 	buffer = ReadBufferExtended(relation, MAIN_FORKNUM, blknum,
@@ -1117,6 +1601,22 @@ PDS_exec_heapscan_row(pgstrom_data_store *pds,
 	 */
 	all_visible = PageIsAllVisible(page) && !snapshot->takenDuringRecovery;
 
+	/*
+	 * Tuple bodies are copied by the helper threads, if available.
+	 */
+	if (async_copy)
+	{
+		if (pds_copy_free_job)
+		{
+			job = pds_copy_free_job;
+			pds_copy_free_job = NULL;
+		}
+		else
+			job = MemoryContextAlloc(TopMemoryContext, sizeof(pdsCopyJob));
+		job->buffer = buffer;
+		job->nitems = 0;
+	}
+
 	/* TODO: make SerializationNeededForRead() an external function
 	 * on the core side. It kills necessity of setting up HeapTupleData
 	 * when all_visible and non-serialized transaction.
@@ -1155,14 +1655,62 @@ PDS_exec_heapscan_row(pgstrom_data_store *pds,
 		tup_index[ntup] = __kds_packed((uintptr_t)tup_item - (uintptr_t)kds);
 		tup_item->t_len = tup.t_len;
 		tup_item->t_self = tup.t_self;
-		memcpy(&tup_item->htup, tup.t_data, tup.t_len);
+		if (job)
+		{
+			pdsCopyItem *item = &job->items[job->nitems++];
+
+			item->dest = &tup_item->htup;
+			item->source = tup.t_data;
+			item->length = tup.t_len;
+		}
+		else
+			memcpy(&tup_item->htup, tup.t_data, tup.t_len);
+		if (HeapTupleHasExternal(&tup))
+			has_external = true;
 		kds->usage = __kds_packed(curr_usage);
 
 		ntup++;
 	}
-	UnlockReleaseBuffer(buffer);
+
+	/*
+	 * The block with external toast datum is copied by the backend itself,
+	 * because PDS_inline_external_tuples() references the tuples soon.
+	 */
+	if (job && has_external &&
+		pgstrom_enable_inline_toast &&
+		OidIsValid(relation->rd_rel->reltoastrelid))
+	{
+		int		i;
+
+		for (i=0; i < job->nitems; i++)
+			memcpy(job->items[i].dest,
+				   job->items[i].source,
+				   job->items[i].length);
+		job->nitems = 0;
+	}
+
+	if (job && job->nitems > 0)
+	{
+		/* keep the buffer pin until the copy gets completed */
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		PDS_copy_submit_job(job);
+	}
+	else
+	{
+		UnlockReleaseBuffer(buffer);
+		if (job && !pds_copy_free_job)
+			pds_copy_free_job = job;
+		else if (job)
+			pfree(job);
+	}
 	Assert(ntup <= MaxHeapTuplesPerPage);
 	Assert(kds->nitems + ntup <= kds->nrooms);
+	/* embed external toast datum, if any */
+	if (has_external &&
+		pgstrom_enable_inline_toast &&
+		OidIsValid(relation->rd_rel->reltoastrelid))
+		PDS_inline_external_tuples(kds, RelationGetDescr(relation),
+								   tup_index, ntup);
 	kds->nitems += ntup;
 
 	return true;
@@ -1181,7 +1729,19 @@ PDS_exec_heapscan(GpuTaskState *gts, pgstrom_data_store *pds)
 	CHECK_FOR_INTERRUPTS();
 
 	if (pds->kds.format == KDS_FORMAT_ROW)
-		retval = PDS_exec_heapscan_row(pds, relation, hscan);
+	{
+		cl_uint		row_base = pds->kds.nitems;
+		bool		async_copy = false;
+
+		/* zone map under construction references the tuples soon */
+		if (pgstrom_heapscan_copy_threads > 0 &&
+			!pgstromZoneMapIsBuilding(gts))
+			async_copy = PDS_copy_worker_startup();
+		retval = PDS_exec_heapscan_row(pds, relation, hscan, async_copy);
+		/* update zone map under construction, if any */
+		if (retval && gts->outer_zmap_state)
+			pgstromZoneMapUpdate(gts, hscan->rs_cblock, &pds->kds, row_base);
+	}
 	else if (pds->kds.format == KDS_FORMAT_BLOCK)
 	{
 		Assert(gts->nvme_sstate);
@@ -1273,7 +1833,7 @@ KDS_insert_hashitem(kern_data_store *kds,
 
 	if (KERN_DATA_STORE_HEAD_LENGTH(kds) +
 		STROMALIGN(sizeof(cl_uint) * (kds->nitems + 1)) +
-		STROMALIGN(sizeof(cl_uint) * __KDS_NSLOTS(kds->nitems + 1)) +
+		STROMALIGN(sizeof(kern_hashslot) * __KDS_NSLOTS(kds->nitems + 1)) +
 		STROMALIGN(curr_usage) > kds->length)
 		return false;	/* no more space to put */
 
@@ -1293,6 +1853,186 @@ KDS_insert_hashitem(kern_data_store *kds,
 	return true;
 }
 
+/*
+ * __PDS_read_uring - reads the file ranges using io_uring
+ *
+ * It keeps up to pg_strom.io_uring_depth read requests in flight. If the
+ * ranges are aligned and pg_strom.io_uring_direct is enabled, the file is
+ * reopened with O_DIRECT to bypass the page cache; a range with short read
+ * (tail of the file) or unaligned buffer is retried with buffered i/o.
+ * It returns false if io_uring is not available, then caller shall read
+ * the ranges by pread(2) instead.
+ */
+typedef struct
+{
+	char	   *dest;
+	off_t		f_pos;
+	size_t		len;
+	bool		buffered;	/* fallback from O_DIRECT */
+} pds_io_range;
+
+#define PDS_IO_DIRECT_ALIGN		4096
+
+static bool
+__PDS_read_uring(int fdesc, pds_io_range *ranges, int nranges,
+				 bool zero_tail)
+{
+#ifdef HAVE_LIBURING
+	struct io_uring	ring;
+	pds_io_range  **pending;
+	int			depth = Min(pgstrom_io_uring_depth, nranges);
+	int			dfdesc = -1;
+	int			p_head = 0;
+	int			p_tail = 0;
+	int			num_pending = 0;
+	int			inflight = 0;
+	int			i, rv;
+	int			errcode = 0;
+	const char *errlabel = NULL;
+
+	if (pgstrom_io_uring_depth <= 0 || nranges <= 0)
+		return false;
+	if (io_uring_queue_init(depth, &ring, 0) != 0)
+		return false;
+	if (pgstrom_io_uring_direct)
+	{
+		for (i=0; i < nranges; i++)
+		{
+			if (((uintptr_t)ranges[i].dest & (PDS_IO_DIRECT_ALIGN-1)) != 0 ||
+				(ranges[i].f_pos & (PDS_IO_DIRECT_ALIGN-1)) != 0 ||
+				(ranges[i].len & (PDS_IO_DIRECT_ALIGN-1)) != 0)
+				break;
+		}
+		if (i == nranges)
+		{
+			char	path[64];
+
+			snprintf(path, sizeof(path), "/proc/self/fd/%d", fdesc);
+			dfdesc = open(path, O_RDONLY | O_DIRECT);
+		}
+	}
+	pending = alloca(sizeof(pds_io_range *) * nranges);
+	for (i=0; i < nranges; i++)
+	{
+		ranges[i].buffered = (dfdesc < 0);
+		pending[i] = &ranges[i];
+	}
+	num_pending = nranges;
+
+	while (num_pending > 0 || inflight > 0)
+	{
+		struct io_uring_sqe *sqe;
+		struct io_uring_cqe *cqe;
+
+		/* fill up the submission queue */
+		while (num_pending > 0 && inflight < depth && !errlabel)
+		{
+			pds_io_range *r = pending[p_head];
+
+			sqe = io_uring_get_sqe(&ring);
+			if (!sqe)
+				break;
+			io_uring_prep_read(sqe, r->buffered ? fdesc : dfdesc,
+							   r->dest, r->len, r->f_pos);
+			io_uring_sqe_set_data(sqe, r);
+			p_head = (p_head + 1) % nranges;
+			num_pending--;
+			inflight++;
+		}
+		if (errlabel)
+			num_pending = 0;	/* no more submission on error */
+		if (inflight == 0)
+			break;
+		rv = io_uring_submit_and_wait(&ring, 1);
+		if (rv < 0 && rv != -EINTR)
+		{
+			/* in-flight requests are reaped by io_uring_queue_exit */
+			if (!errlabel)
+			{
+				errlabel = "io_uring_submit_and_wait";
+				errcode = -rv;
+			}
+			break;
+		}
+		/* reap the completed requests */
+		while (io_uring_peek_cqe(&ring, &cqe) == 0)
+		{
+			pds_io_range *r = io_uring_cqe_get_data(cqe);
+			int			res = cqe->res;
+			bool		resubmit = false;
+
+			io_uring_cqe_seen(&ring, cqe);
+			inflight--;
+			if (errlabel)
+				continue;
+			if (res == -EINTR || res == -EAGAIN)
+				resubmit = true;
+			else if (res < 0 && !r->buffered &&
+					 (res == -EINVAL || res == -EFAULT))
+			{
+				r->buffered = true;
+				resubmit = true;
+			}
+			else if (res < 0)
+			{
+				errlabel = "read";
+				errcode = -res;
+			}
+			else if (res == 0)
+			{
+				/*
+				 * Due to the page_sz alignment, we may try to read the file
+				 * over its tail, in case of Arrow files.
+				 */
+				if (zero_tail && r->len < PAGE_SIZE)
+					memset(r->dest, 0, r->len);
+				else
+				{
+					errlabel = "read (unexpected EOF)";
+					errcode = EIO;
+				}
+			}
+			else
+			{
+				Assert(res <= r->len);
+				r->dest  += res;
+				r->f_pos += res;
+				r->len   -= res;
+				if (r->len > 0)
+				{
+					r->buffered = true;
+					resubmit = true;
+				}
+			}
+			if (resubmit)
+			{
+				pending[p_tail] = r;
+				p_tail = (p_tail + 1) % nranges;
+				num_pending++;
+			}
+		}
+		if (GpuWorkerCurrentContext &&
+			pg_atomic_read_u32(&GpuWorkerCurrentContext->terminate_workers) &&
+			!errlabel)
+		{
+			errlabel = "read (GpuContext worker termination)";
+			errcode = EINTR;
+		}
+	}
+	io_uring_queue_exit(&ring);
+	if (dfdesc >= 0)
+		close(dfdesc);
+	if (errlabel)
+	{
+		errno = errcode;
+		werror("failed on %s of io_uring: %m", errlabel);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
 /*
  * PDS_fillup_blocks
  *
@@ -1303,11 +2043,11 @@ PDS_fillup_blocks(pgstrom_data_store *pds)
 {
 	cl_int			filedesc = pds->filedesc;
 	cl_int			i, nr_loaded;
+	cl_int			nranges = 0;
 	ssize_t			nbytes;
 	char		   *dest_addr;
-	loff_t			curr_fpos;
-	size_t			curr_size;
 	BlockNumber	   *block_nums;
+	pds_io_range   *ranges;
 
 	if (pds->kds.format != KDS_FORMAT_BLOCK)
 		elog(ERROR, "Bug? only KDS_FORMAT_BLOCK can be filled up");
@@ -1320,50 +2060,97 @@ PDS_fillup_blocks(pgstrom_data_store *pds)
 	nr_loaded = pds->kds.nitems - pds->nblocks_uncached;
 	block_nums = (BlockNumber *)KERN_DATA_STORE_BODY(&pds->kds);
 	dest_addr = (char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds, nr_loaded);
-	curr_fpos = 0;
-	curr_size = 0;
+	ranges = alloca(sizeof(pds_io_range) * pds->nblocks_uncached);
 	for (i=pds->nblocks_uncached-1; i >=0; i--)
 	{
 		loff_t	file_pos = (block_nums[i] & (RELSEG_SIZE - 1)) * BLCKSZ;
 
-		if (curr_size > 0 &&
-			curr_fpos + curr_size == file_pos)
+		if (nranges > 0 &&
+			ranges[nranges-1].f_pos + ranges[nranges-1].len == file_pos)
 		{
 			/* merge with the pending i/o */
-			curr_size += BLCKSZ;
+			ranges[nranges-1].len += BLCKSZ;
 		}
 		else
 		{
-			while (curr_size > 0)
+			ranges[nranges].dest  = dest_addr;
+			ranges[nranges].f_pos = file_pos;
+			ranges[nranges].len   = BLCKSZ;
+			nranges++;
+		}
+		dest_addr += BLCKSZ;
+	}
+	Assert(dest_addr == (char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds,
+															 pds->kds.nitems));
+	if (!__PDS_read_uring(filedesc, ranges, nranges, false))
+	{
+		for (i=0; i < nranges; i++)
+		{
+			pds_io_range *r = &ranges[i];
+
+			while (r->len > 0)
 			{
-				nbytes = pread(filedesc, dest_addr, curr_size, curr_fpos);
-				Assert(nbytes <= curr_size);
+				nbytes = pread(filedesc, r->dest, r->len, r->f_pos);
+				Assert(nbytes <= r->len);
 				if (nbytes < 0 || (nbytes == 0 && errno != EINTR))
 					elog(ERROR, "failed on pread(2): %m");
-				dest_addr += nbytes;
-				curr_fpos += nbytes;
-				curr_size -= nbytes;
+				r->dest  += nbytes;
+				r->f_pos += nbytes;
+				r->len   -= nbytes;
 			}
-			curr_fpos = file_pos;
-			curr_size = BLCKSZ;
 		}
 	}
-
-	while (curr_size > 0)
-	{
-		nbytes = pread(filedesc, dest_addr, curr_size, curr_fpos);
-		Assert(nbytes <= curr_size);
-		if (nbytes < 0 || (nbytes == 0 && errno != EINTR))
-			elog(ERROR, "failed on pread(2): %m");
-		dest_addr += nbytes;
-		curr_fpos += nbytes;
-		curr_size -= nbytes;
-	}
-	Assert(dest_addr == (char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds,
-															 pds->kds.nitems));
 	pds->nblocks_uncached = 0;
 }
 
+/*
+ * PDS_check_visibility
+ *
+ * It launches kern_heap_visibility_check on the tail @nblocks_unchecked
+ * blocks already transferred to @m_kds, then invisible tuples are marked
+ * unused prior to the GPU kernel. If CPU fallback happen, host-side buffer
+ * shall be written back from the device.
+ */
+void
+PDS_check_visibility(pgstrom_data_store *pds,
+					 CUdeviceptr m_kds,
+					 CUmodule cuda_module)
+{
+	CUfunction	kern_visibility;
+	cl_uint		block_base;
+	cl_uint		block_sz;
+	void	   *kern_args[3];
+	CUresult	rc;
+
+	if (pds->kds.format != KDS_FORMAT_BLOCK ||
+		!pds->xvis ||
+		pds->nblocks_unchecked == 0)
+		return;
+	Assert(pds->nblocks_unchecked <= pds->kds.nitems);
+
+	rc = cuModuleGetFunction(&kern_visibility,
+							 cuda_module,
+							 "kern_heap_visibility_check");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	block_base = pds->kds.nitems - pds->nblocks_unchecked;
+	block_sz = TYPEALIGN(32, Max(pds->kds.nrows_per_block, 1));
+	block_sz = Min(block_sz, 256);
+	kern_args[0] = &m_kds;
+	kern_args[1] = &pds->xvis;
+	kern_args[2] = &block_base;
+	rc = cuLaunchKernel(kern_visibility,
+						pds->nblocks_unchecked, 1, 1,
+						block_sz, 1, 1,
+						0,
+						CU_STREAM_PER_THREAD,
+						kern_args,
+						NULL);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuLaunchKernel: %s", errorText(rc));
+}
+
 /*
  * PDS_fillup_arrow
  */
@@ -1374,6 +2161,7 @@ __PDS_fillup_arrow(pgstrom_data_store *pds_dst,
 				   int fdesc, strom_io_vector *iovec)
 {
 	size_t	head_sz = KERN_DATA_STORE_HEAD_LENGTH(kds_head);
+	pds_io_range *ranges;
 	int		j;
 
 	Assert(kds_head->format == KDS_FORMAT_ARROW);
@@ -1385,6 +2173,19 @@ __PDS_fillup_arrow(pgstrom_data_store *pds_dst,
 	pds_dst->iovec = NULL;
 	memcpy(&pds_dst->kds, kds_head, head_sz);
 
+	/* asynchronous i/o by io_uring, if available */
+	ranges = alloca(sizeof(pds_io_range) * Max(iovec->nr_chunks, 1));
+	for (j=0; j < iovec->nr_chunks; j++)
+	{
+		strom_io_chunk *ioc = &iovec->ioc[j];
+
+		ranges[j].dest  = (char *)&pds_dst->kds + ioc->m_offset;
+		ranges[j].f_pos = (size_t)ioc->fchunk_id * PAGE_SIZE;
+		ranges[j].len   = (size_t)ioc->nr_pages * PAGE_SIZE;
+	}
+	if (__PDS_read_uring(fdesc, ranges, iovec->nr_chunks, true))
+		return;
+
 	for (j=0; j < iovec->nr_chunks; j++)
 	{
 		strom_io_chunk *ioc = &iovec->ioc[j];
@@ -1476,12 +2277,12 @@ PDS_writeback_arrow(pgstrom_data_store *pds_src,
 
 	Assert(pds_src->kds.format == KDS_FORMAT_ARROW &&
 		   pds_src->iovec != NULL);
-	rc = gpuMemAllocHostRaw(pds_src->gcontext,
-							(void **)&pds_dst,
-							offsetof(pgstrom_data_store,
-									 kds) + pds_src->kds.length);
+	rc = gpuMemAllocHost(pds_src->gcontext,
+						 (void **)&pds_dst,
+						 offsetof(pgstrom_data_store,
+								  kds) + pds_src->kds.length);
 	if (rc != CUDA_SUCCESS)
-		werror("failed on gpuMemAllocHostRaw: %s", errorText(rc));
+		werror("failed on gpuMemAllocHost: %s", errorText(rc));
 
 	memset(pds_dst, 0, offsetof(pgstrom_data_store, kds));
 	pds_dst->gcontext = pds_src->gcontext;
@@ -113,6 +113,9 @@ DEV_ATTR(VIRTUAL_ADDRESS_MANAGEMENT_SUPPORTED, BOOL, 0, "Device supports virtual
 DEV_ATTR(HANDLE_TYPE_POSIX_FILE_DESCRIPTOR_SUPPORTED, BOOL, 0, "Device supports exporting memory to a posix file descriptor")
 DEV_ATTR(HANDLE_TYPE_WIN32_HANDLE_SUPPORTED, BOOL, 0, "Device supports exporting memory to a Win32 NT handle")
 DEV_ATTR(HANDLE_TYPE_WIN32_KMT_HANDLE_SUPPORTED, BOOL, 0, "Device supports exporting memory to a Win32 KMT handle")
+#if CUDA_VERSION >= 11020
+DEV_ATTR(MEMORY_POOLS_SUPPORTED, BOOL, 0, "Device supports using the cuMemAllocAsync and cuMemPool family of APIs")
+#endif	/* CUDA 11.2 */
 #endif	/* CUDA 10.2 */
 #endif	/* CUDA 9.2 */
 #endif	/* CUDA 9.0 */
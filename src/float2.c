@@ -624,7 +624,8 @@ pgstrom_float2_larger(PG_FUNCTION_ARGS)
 	half_t	arg1 = PG_GETARG_FLOAT2(0);
 	half_t	arg2 = PG_GETARG_FLOAT2(1);
 
-	PG_RETURN_FLOAT2(fp16_to_fp32(arg1) > fp16_to_fp32(arg2) ? arg1 : arg2);
+	PG_RETURN_FLOAT2(float4_cmp_internal(fp16_to_fp32(arg1),
+										 fp16_to_fp32(arg2)) > 0 ? arg1 : arg2);
 }
 PG_FUNCTION_INFO_V1(pgstrom_float2_larger);
 
@@ -634,7 +635,8 @@ pgstrom_float2_smaller(PG_FUNCTION_ARGS)
 	half_t	arg1 = PG_GETARG_FLOAT2(0);
 	half_t	arg2 = PG_GETARG_FLOAT2(1);
 
-	PG_RETURN_FLOAT2(fp16_to_fp32(arg1) < fp16_to_fp32(arg2) ? arg1 : arg2);
+	PG_RETURN_FLOAT2(float4_cmp_internal(fp16_to_fp32(arg1),
+										 fp16_to_fp32(arg2)) < 0 ? arg1 : arg2);
 }
 PG_FUNCTION_INFO_V1(pgstrom_float2_smaller);
 
@@ -23,6 +23,7 @@
 #include "utils/pg_crc.h"
 #include "utils/resowner.h"
 #include "pg_strom.h"
+#include <sched.h>
 
 /* IPC stuff of GpuContext */
 typedef struct
@@ -31,6 +32,7 @@ typedef struct
 	pthread_mutex_t		mutex;
 	pthread_cond_t		cond;
 	pg_atomic_uint32	command;
+	GpuContextActivity	activity;
 } GpuContextIPCEntry;
 
 typedef struct
@@ -41,16 +43,47 @@ typedef struct
 	GpuContextIPCEntry ipc_entries[FLEXIBLE_ARRAY_MEMBER];
 } GpuContextIPCHead;
 
+/*
+ * GpuTaskSchedEntry - per-device state of the fair-share scheduler
+ *
+ * A GpuContext is 'active' while it has admitted GpuTasks or waits for
+ * admission. Each active GpuContext can run its share of the device queue
+ * depth (pg_strom.global_max_async_tasks) in proportion to its weight
+ * (pg_strom.gpu_task_priority). It can exceed the share only if nobody
+ * else waits for admission, so the device never sleeps while a batch job
+ * has work to do, and an interactive query does not wait for the whole
+ * queue of the batch job.
+ */
+typedef struct
+{
+	slock_t		lock;
+	cl_uint		num_waiters;	/* # of GpuContexts waiting for admission */
+	cl_ulong	sum_weights;	/* sum of weights of the active GpuContexts */
+} GpuTaskSchedEntry;
+
 /* variables */
 static shmem_startup_hook_type shmem_startup_next = NULL;
 static pg_atomic_uint32 *global_num_running_tasks;	/* shared */
+static GpuTaskSchedEntry *gpu_task_sched;			/* shared */
 static GpuContextIPCHead *gcontext_ipc_head;	/* shared */
+static GpuContextActivity gcontext_activity_sink;	/* after detach */
 int					global_max_async_tasks;		/* GUC */
 int					local_max_async_tasks;		/* GUC */
+bool				pgstrom_adaptive_async_tasks;	/* GUC */
+int					pgstrom_gpu_task_priority;	/* GUC */
 int					max_num_gpucontext;			/* GUC */
+bool				pgstrom_enable_cuda_graph;	/* GUC */
+static bool			keep_cuda_context;			/* GUC */
+static bool			gpu_numa_affinity;			/* GUC */
+static bool			gpu_numa_affinity_backend;	/* GUC */
 static slock_t		activeGpuContextLock;
 static dlist_head	activeGpuContextList;
 
+static void steerBackendNumaAffinity(GpuContext *gcontext);
+static void restoreBackendNumaAffinity(GpuContext *gcontext);
+
+Datum pgstrom_gpu_activity(PG_FUNCTION_ARGS);
+
 /*
  * Resource tracker of GpuContext
  *
@@ -245,6 +278,46 @@ untrackGpuMem(GpuContext *gcontext, CUdeviceptr devptr)
 	return NULL;
 }
 
+/*
+ * untrackGpuMemByExtra - pick up one of the GPU memory tracked with the
+ * supplied 'extra'. It returns 0 if no more tracked memory.
+ */
+CUdeviceptr
+untrackGpuMemByExtra(GpuContext *gcontext, void *extra,
+					 const char **p_filename, int *p_lineno)
+{
+	CUdeviceptr	devptr;
+	int			i;
+
+	SpinLockAcquire(&gcontext->restrack_lock);
+	for (i=0; i < RESTRACK_HASHSIZE; i++)
+	{
+		dlist_iter	iter;
+
+		dlist_foreach (iter, &gcontext->restrack[i])
+		{
+			ResourceTracker *tracker
+				= dlist_container(ResourceTracker, chain, iter.cur);
+
+			if (tracker->resclass == RESTRACK_CLASS__GPUMEMORY &&
+				tracker->u.devmem.extra == extra)
+			{
+				dlist_delete(&tracker->chain);
+				SpinLockRelease(&gcontext->restrack_lock);
+				devptr = tracker->u.devmem.ptr;
+				if (p_filename)
+					*p_filename = tracker->filename;
+				if (p_lineno)
+					*p_lineno = tracker->lineno;
+				free(tracker);
+				return devptr;
+			}
+		}
+	}
+	SpinLockRelease(&gcontext->restrack_lock);
+	return 0UL;
+}
+
 /*
  * trackRawFileDesc - tracker of raw file descriptors
  */
@@ -487,6 +560,146 @@ GpuContextLookupModule(GpuContext *gcontext, ProgramId program_id)
 	return cuda_module;
 }
 
+/*
+ * CudaContextPool - CUDA context and modules kept by the process
+ *
+ * cuCtxCreate() and module load take a few hundreds milliseconds, so we
+ * keep the CUDA context and the modules loaded on it, for the next
+ * GpuContext of the process (pg_strom.keep_cuda_context).
+ * One CUDA context is kept per device and MPS usage.
+ */
+#define CUDA_CONTEXT_POOL_MAX_MODULES	64
+
+typedef struct
+{
+	CUcontext	cuda_context;
+	dlist_head	cuda_modules;	/* list of GpuContextModuleEntry */
+	cl_int		num_modules;
+} CudaContextPool;
+
+static CudaContextPool *cuda_context_pool = NULL;
+
+static CudaContextPool *
+lookupCudaContextPool(GpuContext *gcontext)
+{
+	int		i;
+
+	if (!cuda_context_pool)
+	{
+		cuda_context_pool = calloc(2 * numDevAttrs, sizeof(CudaContextPool));
+		if (!cuda_context_pool)
+			return NULL;
+		for (i=0; i < 2 * numDevAttrs; i++)
+			dlist_init(&cuda_context_pool[i].cuda_modules);
+	}
+	return &cuda_context_pool[2 * gcontext->cuda_dindex +
+							  (gcontext->never_use_mps ? 1 : 0)];
+}
+
+/*
+ * saveCudaContextPool - try to keep the CUDA context of the GpuContext
+ * being released. It returns false if the CUDA context must be destroyed.
+ */
+static bool
+saveCudaContextPool(GpuContext *gcontext)
+{
+	CudaContextPool *pool;
+	ResourceTracker *tracker;
+	dlist_iter	iter;
+	dlist_node *dnode;
+	CUresult	rc;
+	int			i;
+
+	if (!keep_cuda_context)
+		return false;
+	pool = lookupCudaContextPool(gcontext);
+	if (!pool || pool->cuda_context)
+		return false;
+	/* no device memory must be leaked */
+	for (i=0; i < RESTRACK_HASHSIZE; i++)
+	{
+		dlist_foreach(iter, &gcontext->restrack[i])
+		{
+			tracker = dlist_container(ResourceTracker, chain, iter.cur);
+			if (tracker->resclass == RESTRACK_CLASS__GPUMEMORY ||
+				tracker->resclass == RESTRACK_CLASS__GPUMEMORY_IPC)
+				return false;
+		}
+	}
+
+	GPUCONTEXT_PUSH(gcontext);
+	if (!pgstrom_gpu_mmgr_release_segments(gcontext))
+	{
+		GPUCONTEXT_POP(gcontext);
+		return false;
+	}
+	for (i=0; i < gcontext->num_workers; i++)
+	{
+		if (gcontext->cuda_events0[i])
+			cuEventDestroy(gcontext->cuda_events0[i]);
+		if (gcontext->cuda_events1[i])
+			cuEventDestroy(gcontext->cuda_events1[i]);
+		gcontext->cuda_events0[i] = NULL;
+		gcontext->cuda_events1[i] = NULL;
+	}
+	/* move the modules to the pool, then unload the overflow */
+	for (i=0; i < CUDA_MODULES_HASHSIZE; i++)
+	{
+		while (!dlist_is_empty(&gcontext->cuda_modules_slot[i]))
+		{
+			dnode = dlist_pop_head_node(&gcontext->cuda_modules_slot[i]);
+			dlist_push_head(&pool->cuda_modules, dnode);
+			pool->num_modules++;
+		}
+	}
+	while (pool->num_modules > CUDA_CONTEXT_POOL_MAX_MODULES)
+	{
+		GpuContextModuleEntry *entry;
+
+		dnode = dlist_pop_head_node(&pool->cuda_modules);
+		entry = dlist_container(GpuContextModuleEntry, chain, dnode);
+		rc = cuModuleUnload(entry->cuda_module);
+		if (rc != CUDA_SUCCESS)
+			wnotice("failed on cuModuleUnload: %s", errorText(rc));
+		free(entry);
+		pool->num_modules--;
+	}
+	GPUCONTEXT_POP(gcontext);
+
+	pool->cuda_context = gcontext->cuda_context;
+	return true;
+}
+
+/*
+ * loadCudaContextPool - pick up the CUDA context kept, if any
+ */
+static bool
+loadCudaContextPool(GpuContext *gcontext)
+{
+	CudaContextPool *pool;
+	GpuContextModuleEntry *entry;
+	dlist_node *dnode;
+
+	if (!cuda_context_pool)
+		return false;
+	pool = lookupCudaContextPool(gcontext);
+	if (!pool || !pool->cuda_context)
+		return false;
+
+	gcontext->cuda_context = pool->cuda_context;
+	pool->cuda_context = NULL;
+	while (!dlist_is_empty(&pool->cuda_modules))
+	{
+		dnode = dlist_pop_tail_node(&pool->cuda_modules);
+		entry = dlist_container(GpuContextModuleEntry, chain, dnode);
+		dlist_push_head(&gcontext->cuda_modules_slot[entry->program_id %
+													 CUDA_MODULES_HASHSIZE],
+						&entry->chain);
+	}
+	pool->num_modules = 0;
+	return true;
+}
+
 /*
  * ReleaseLocalResources - release all the private resources tracked by
  * the resource tracker of GpuContext
@@ -501,13 +714,33 @@ ReleaseLocalResources(GpuContext *gcontext, bool normal_exit)
 
 	Assert(!gcontext->worker_is_running);
 
+	/* restore the CPU affinity of the backend, if steered */
+	restoreBackendNumaAffinity(gcontext);
+
+	/* return the slots of scheduler, if any */
+	if (gpu_task_sched)
+	{
+		gpuTaskSchedLeave(gcontext);
+		gpuTaskSchedDone(gcontext, gcontext->sched_num_running);
+	}
+
 	if (gcontext->cuda_context)
 	{
-		rc = cuCtxDestroy(gcontext->cuda_context);
-		if (rc != CUDA_SUCCESS)
-			elog(WARNING, "Failed on cuCtxDestroy: %s", errorText(rc));
+		/* return the recycled PDS buffers prior to the leak checks */
+		PDS_flush_recycled(gcontext);
+		/* memory pool is not owned by the CUDA context */
+		pgstrom_gpu_mmgr_release_mempool(gcontext, normal_exit);
+		if (!normal_exit || !saveCudaContextPool(gcontext))
+		{
+			pgstrom_gpu_mmgr_unregister_iomap(gcontext);
+			rc = cuCtxDestroy(gcontext->cuda_context);
+			if (rc != CUDA_SUCCESS)
+				elog(WARNING, "Failed on cuCtxDestroy: %s", errorText(rc));
+		}
 		gcontext->cuda_context = NULL;
 	}
+	/* CUfunction handles cached by the backend are no longer valid */
+	gpuOptimalBlockSizeReset();
 
 	/* OK, release other resources */
 	for (i=0; i < RESTRACK_HASHSIZE; i++)
@@ -593,6 +826,30 @@ ReleaseLocalResources(GpuContext *gcontext, bool normal_exit)
 __thread GpuContext	   *GpuWorkerCurrentContext = NULL;
 __thread sigjmp_buf	   *GpuWorkerExceptionStack = NULL;
 __thread cl_int			GpuWorkerIndex = -1;
+__thread CUstream		GpuWorkerStreamH2D = NULL;
+__thread CUstream		GpuWorkerStreamD2H = NULL;
+static __thread CUevent	GpuWorkerPrefetchEvent = NULL;
+static __thread CUevent	GpuWorkerStageEventBegin = NULL;
+static __thread CUevent	GpuWorkerStageEventRecv = NULL;
+static __thread GpuTask *GpuWorkerNextTask = NULL;
+
+/*
+ * GpuKernelGraph - per-worker cache of CUDA Graph executables
+ */
+#define GPU_KERNEL_GRAPH_NSLOTS		8
+typedef struct
+{
+	GpuTaskState   *gts;
+	cl_int			seq_id;
+	cl_int			nkernels;
+	GpuKernelLaunch	shape[GPU_KERNEL_SEQ_MAX_KERNELS];	/* no kern_args */
+	CUgraph			graph;
+	CUgraphExec		exec;
+	CUgraphNode		nodes[GPU_KERNEL_SEQ_MAX_KERNELS];
+	cl_ulong		last_used;
+} GpuKernelGraph;
+static __thread GpuKernelGraph GpuWorkerKernelGraphs[GPU_KERNEL_GRAPH_NSLOTS];
+static __thread cl_ulong GpuWorkerKernelGraphClock = 0;
 
 void
 GpuContextWorkerReportError(int elevel,
@@ -605,30 +862,607 @@ GpuContextWorkerReportError(int elevel,
 	uint32		expected = 0;
 	va_list		va_args;
 
-	Assert(gcontext != NULL);
-	Assert(elevel >= ERROR);
-	if (pg_atomic_compare_exchange_u32(&gcontext->error_level,
-									   &expected, (uint32)(2 * elevel + 1)))
+	Assert(gcontext != NULL);
+	Assert(elevel >= ERROR);
+	if (pg_atomic_compare_exchange_u32(&gcontext->error_level,
+									   &expected, (uint32)(2 * elevel + 1)))
+	{
+		const char *slash;
+
+		slash = strrchr(filename,'/');
+		if (slash)
+			filename = slash + 1;
+
+		gcontext->error_code		= errcode;
+		gcontext->error_filename	= filename;
+		gcontext->error_lineno		= lineno;
+		gcontext->error_funcname	= funcname;
+		va_start(va_args, fmt);
+		vsnprintf(gcontext->error_message,
+				  sizeof(gcontext->error_message), fmt, va_args);
+		va_end(va_args);
+		/* unlock error information */
+		pg_atomic_fetch_and_u32(&gcontext->error_level, 0xfffffffeU);
+	}
+	if (GpuWorkerExceptionStack)
+		siglongjmp(*GpuWorkerExceptionStack, 1);
+}
+
+/*
+ * GpuContextPushTask - enqueue a GpuTask to one of the worker queues
+ *
+ * NOTE: caller must hold gcontext->mutex, and wake up a worker thread.
+ */
+void
+GpuContextPushTask(GpuContext *gcontext, GpuTask *gtask)
+{
+	GpuWorkerQueue *wqueue;
+
+	wqueue = &gcontext->worker_queues[gcontext->next_queue++ %
+									  gcontext->num_workers];
+	SpinLockAcquire(&wqueue->lock);
+	dlist_push_tail(&wqueue->tasks, &gtask->chain);
+	pg_atomic_add_fetch_u32(&gcontext->num_pending_tasks, 1);
+	pg_atomic_add_fetch_u32(&gcontext->activity->num_pending, 1);
+	SpinLockRelease(&wqueue->lock);
+}
+
+/*
+ * GpuContextPopTask - dequeue a GpuTask from the queue of the current
+ * worker, or steal one from the queue of other workers.
+ */
+static GpuTask *
+GpuContextPopTask(GpuContext *gcontext)
+{
+	GpuWorkerQueue *wqueue;
+	dlist_node	   *dnode = NULL;
+	int				i, k;
+
+	if (pg_atomic_read_u32(&gcontext->num_pending_tasks) == 0)
+		return NULL;
+	for (i=0; i < gcontext->num_workers && !dnode; i++)
+	{
+		k = (GpuWorkerIndex + i) % gcontext->num_workers;
+		wqueue = &gcontext->worker_queues[k];
+		/* quick check without lock */
+		if (dlist_is_empty(&wqueue->tasks))
+			continue;
+		SpinLockAcquire(&wqueue->lock);
+		if (!dlist_is_empty(&wqueue->tasks))
+		{
+			dnode = dlist_pop_head_node(&wqueue->tasks);
+			pg_atomic_sub_fetch_u32(&gcontext->num_pending_tasks, 1);
+			pg_atomic_sub_fetch_u32(&gcontext->activity->num_pending, 1);
+		}
+		SpinLockRelease(&wqueue->lock);
+	}
+	return (dnode ? dlist_container(GpuTask, chain, dnode) : NULL);
+}
+
+/*
+ * GpuContextCancelTasks - remove the pending GpuTasks of the GTS, not
+ * picked up by the worker threads yet. It returns number of the tasks
+ * moved to @cancelled_tasks.
+ *
+ * NOTE: caller must hold gcontext->mutex
+ */
+int
+GpuContextCancelTasks(GpuContext *gcontext, GpuTaskState *gts,
+					  dlist_head *cancelled_tasks)
+{
+	dlist_mutable_iter iter;
+	int			i, count = 0;
+
+	for (i=0; i < gcontext->num_workers; i++)
+	{
+		GpuWorkerQueue *wqueue = &gcontext->worker_queues[i];
+
+		SpinLockAcquire(&wqueue->lock);
+		dlist_foreach_modify(iter, &wqueue->tasks)
+		{
+			GpuTask	   *gtask = dlist_container(GpuTask, chain, iter.cur);
+
+			if (gtask->gts != gts)
+				continue;
+			dlist_delete(&gtask->chain);
+			dlist_push_tail(cancelled_tasks, &gtask->chain);
+			pg_atomic_sub_fetch_u32(&gcontext->num_pending_tasks, 1);
+			pg_atomic_sub_fetch_u32(&gcontext->activity->num_pending, 1);
+			count++;
+		}
+		SpinLockRelease(&wqueue->lock);
+	}
+	return count;
+}
+
+/*
+ * GpuWorkerPrefetchNextTask
+ *
+ * It picks up the next GpuTask for the current worker, then kicks its
+ * host-to-device transfer on the H2D stream, while the current GpuTask is
+ * running on the device. cb_process_task shall call this function just
+ * before its synchronization point. Nothing happens if any other workers
+ * are idle, because they can run the next GpuTask immediately.
+ */
+void
+GpuWorkerPrefetchNextTask(void)
+{
+	GpuContext *gcontext = GpuWorkerCurrentContext;
+	GpuTask	   *gtask;
+	CUresult	rc;
+
+	if (GpuWorkerNextTask || !GpuWorkerStreamH2D ||
+		pg_atomic_read_u32(&gcontext->num_idle_workers) > 0)
+		return;
+	gtask = GpuContextPopTask(gcontext);
+	if (!gtask)
+		return;
+	if (gtask->gts->cb_prefetch_task &&
+		gtask->gts->cb_prefetch_task(gtask, GpuWorkerStreamH2D))
+	{
+		rc = cuEventRecord(GpuWorkerPrefetchEvent, GpuWorkerStreamH2D);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventRecord: %s", errorText(rc));
+		gtask->prefetched = true;
+	}
+	GpuWorkerNextTask = gtask;
+}
+
+/*
+ * GpuWorkerWaitPrefetch
+ *
+ * It makes the @stream wait for the completion of host-to-device transfer
+ * kicked by GpuWorkerPrefetchNextTask. It returns true if @gtask was
+ * prefetched, so caller can skip its own transfer.
+ */
+bool
+GpuWorkerWaitPrefetch(GpuTask *gtask, CUstream stream)
+{
+	CUresult	rc;
+
+	if (!gtask->prefetched)
+		return false;
+	rc = cuStreamWaitEvent(stream, GpuWorkerPrefetchEvent, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuStreamWaitEvent: %s", errorText(rc));
+	gtask->prefetched = false;
+	return true;
+}
+
+/*
+ * GpuWorkerStageXXXX
+ *
+ * Time consumption per stage of GpuTask, measured by CUDA events.
+ * The kernel execution time is always measured for pgstrom.stat_gpu_device
+ * and pgstrom.stat_gpu_statements, but the others are measured only if
+ * EXPLAIN ANALYZE. cb_process_task calls GpuWorkerStageBegin() prior to
+ * the host-to-device DMA, GpuWorkerStageLaunch() just before the kernel
+ * launch, GpuWorkerStageKernel() after the synchronization of
+ * CU_EVENT0_PER_THREAD recorded next to the kernel, and
+ * GpuWorkerStageRecv() after the device-to-host DMA of the results
+ * enqueued on the supplied stream.
+ */
+static inline bool
+GpuWorkerStageEnabled(GpuTask *gtask)
+{
+	return (GpuWorkerStageEventBegin != NULL);
+}
+
+static inline bool
+GpuWorkerStageInstrument(GpuTask *gtask)
+{
+	return (gtask->gts->css.ss.ps.instrument != NULL &&
+			GpuWorkerStageEventRecv != NULL);
+}
+
+static inline void
+__GpuWorkerStageAdd(GpuTask *gtask, GpuTaskStage stage,
+					CUevent ev_start, CUevent ev_stop)
+{
+	float		elapsed;
+	CUresult	rc;
+
+	Assert(stage < GTSTAGE__NUM_TASK_STAGES);
+	rc = cuEventElapsedTime(&elapsed, ev_start, ev_stop);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventElapsedTime: %s", errorText(rc));
+	if ((gtask->stage_mask & (1U << stage)) == 0)
+	{
+		gtask->stage_ms[stage] = 0.0;
+		gtask->stage_mask |= (1U << stage);
+	}
+	gtask->stage_ms[stage] += elapsed;
+}
+
+void
+GpuWorkerStageBegin(GpuTask *gtask)
+{
+	CUresult	rc;
+
+	gtask->stage_mask = 0;
+	if (!GpuWorkerStageEnabled(gtask))
+		return;
+	rc = cuEventRecord(GpuWorkerStageEventBegin, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+	/* DMA_SEND shall be measured on the first kernel completion */
+	gtask->stage_mask = (1U << GTSTAGE__NUM_TASK_STAGES);
+}
+
+void
+GpuWorkerStageLaunch(GpuTask *gtask)
+{
+	CUresult	rc;
+
+	if (!GpuWorkerStageEnabled(gtask))
+		return;
+	rc = cuEventRecord(CU_EVENT1_PER_THREAD, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+}
+
+void
+GpuWorkerStageKernel(GpuTask *gtask, bool is_resumed)
+{
+	cl_uint		pending = (1U << GTSTAGE__NUM_TASK_STAGES);
+
+	if (!GpuWorkerStageEnabled(gtask))
+		return;
+	if ((gtask->stage_mask & pending) != 0)
+	{
+		gtask->stage_mask &= ~pending;
+		__GpuWorkerStageAdd(gtask, GTSTAGE__DMA_SEND,
+							GpuWorkerStageEventBegin,
+							CU_EVENT1_PER_THREAD);
+	}
+	__GpuWorkerStageAdd(gtask, (is_resumed
+								? GTSTAGE__KERN_RESUME
+								: GTSTAGE__KERN_EXEC),
+						CU_EVENT1_PER_THREAD,
+						CU_EVENT0_PER_THREAD);
+}
+
+void
+GpuWorkerStageRecv(GpuTask *gtask, CUstream stream)
+{
+	CUresult	rc;
+
+	if (!GpuWorkerStageInstrument(gtask))
+		return;
+	/*
+	 * NOTE: results are usually written back by the asynchronous prefetch
+	 * on the @stream, so we have to wait for its completion here.
+	 * It is a small overhead only when EXPLAIN ANALYZE.
+	 */
+	rc = cuEventRecord(GpuWorkerStageEventRecv, stream);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+	rc = cuEventSynchronize(GpuWorkerStageEventRecv);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	__GpuWorkerStageAdd(gtask, GTSTAGE__DMA_RECV,
+						CU_EVENT0_PER_THREAD,
+						GpuWorkerStageEventRecv);
+}
+
+/*
+ * GpuWorkerStageMerge - merge the stage timings of GpuTask into GTS
+ */
+static void
+GpuWorkerStageMerge(GpuContext *gcontext, GpuTaskState *gts, GpuTask *gtask)
+{
+	int		i;
+
+	if (!GpuWorkerStageInstrument(gtask))
+		return;
+	pthreadMutexLock(gcontext->mutex);
+	for (i=0; i < GTSTAGE__NUM_TASK_STAGES; i++)
+	{
+		if ((gtask->stage_mask & (1U << i)) != 0)
+			addGpuTaskStageStat(&gts->stage_stat[i],
+								(double)gtask->stage_ms[i]);
+	}
+	pthreadMutexUnlock(gcontext->mutex);
+	gtask->stage_mask = 0;
+}
+
+/*
+ * gpuKernelSeqInit
+ */
+void
+gpuKernelSeqInit(GpuKernelSeq *kseq, GpuTaskState *gts, cl_int seq_id)
+{
+	kseq->gts = gts;
+	kseq->seq_id = seq_id;
+	kseq->nkernels = 0;
+}
+
+/*
+ * gpuKernelSeqAdd
+ */
+void
+gpuKernelSeqAdd(GpuKernelSeq *kseq,
+				CUfunction kfunc,
+				cl_uint grid_sz,
+				cl_uint block_sz,
+				cl_uint shmem_sz,
+				void **kern_args, int nargs)
+{
+	GpuKernelLaunch *kl;
+
+	if (kseq->nkernels >= GPU_KERNEL_SEQ_MAX_KERNELS ||
+		nargs > GPU_KERNEL_SEQ_MAX_ARGS)
+		werror("Bug? too large kernel launch sequence");
+	kl = &kseq->kernels[kseq->nkernels++];
+	memset(kl, 0, sizeof(GpuKernelLaunch));
+	kl->kfunc	 = kfunc;
+	kl->grid_sz	 = grid_sz;
+	kl->block_sz = block_sz;
+	kl->shmem_sz = shmem_sz;
+	memcpy(kl->kern_args, kern_args, sizeof(void *) * nargs);
+}
+
+#if CUDA_VERSION >= 11040
+static void
+__gpuKernelSeqNodeParams(CUDA_KERNEL_NODE_PARAMS *params, GpuKernelLaunch *kl)
+{
+	memset(params, 0, sizeof(CUDA_KERNEL_NODE_PARAMS));
+	params->func			= kl->kfunc;
+	params->gridDimX		= kl->grid_sz;
+	params->gridDimY		= 1;
+	params->gridDimZ		= 1;
+	params->blockDimX		= kl->block_sz;
+	params->blockDimY		= 1;
+	params->blockDimZ		= 1;
+	params->sharedMemBytes	= kl->shmem_sz;
+	params->kernelParams	= kl->kern_args;
+	params->extra			= NULL;
+}
+
+static void
+__gpuKernelGraphRelease(GpuKernelGraph *kgraph)
+{
+	if (kgraph->exec)
+		cuGraphExecDestroy(kgraph->exec);
+	if (kgraph->graph)
+		cuGraphDestroy(kgraph->graph);
+	memset(kgraph, 0, sizeof(GpuKernelGraph));
+}
+
+/*
+ * __gpuKernelGraphBuild - build a linear graph of the kernel launches
+ */
+static CUresult
+__gpuKernelGraphBuild(GpuKernelGraph *kgraph, GpuKernelSeq *kseq)
+{
+	CUDA_KERNEL_NODE_PARAMS params;
+	CUresult	rc;
+	int			i;
+
+	rc = cuGraphCreate(&kgraph->graph, 0);
+	if (rc != CUDA_SUCCESS)
+		return rc;
+	for (i=0; i < kseq->nkernels; i++)
+	{
+		__gpuKernelSeqNodeParams(&params, &kseq->kernels[i]);
+		rc = cuGraphAddKernelNode(&kgraph->nodes[i],
+								  kgraph->graph,
+								  i > 0 ? &kgraph->nodes[i-1] : NULL,
+								  i > 0 ? 1 : 0,
+								  &params);
+		if (rc != CUDA_SUCCESS)
+			goto error;
+	}
+	rc = cuGraphInstantiateWithFlags(&kgraph->exec, kgraph->graph, 0);
+	if (rc != CUDA_SUCCESS)
+		goto error;
+	kgraph->gts = kseq->gts;
+	kgraph->seq_id = kseq->seq_id;
+	kgraph->nkernels = kseq->nkernels;
+	for (i=0; i < kseq->nkernels; i++)
+	{
+		kgraph->shape[i] = kseq->kernels[i];
+		memset(kgraph->shape[i].kern_args, 0,
+			   sizeof(kgraph->shape[i].kern_args));
+	}
+	return CUDA_SUCCESS;
+
+error:
+	__gpuKernelGraphRelease(kgraph);
+	return rc;
+}
+
+/*
+ * __gpuKernelGraphMatch - check whether the graph is reusable for the
+ * supplied sequence, by updates of the kernel parameters only.
+ */
+static bool
+__gpuKernelGraphMatch(GpuKernelGraph *kgraph, GpuKernelSeq *kseq)
+{
+	int		i;
+
+	if (kgraph->nkernels != kseq->nkernels)
+		return false;
+	for (i=0; i < kseq->nkernels; i++)
+	{
+		GpuKernelLaunch *a = &kgraph->shape[i];
+		GpuKernelLaunch *b = &kseq->kernels[i];
+
+		if (a->kfunc != b->kfunc ||
+			a->grid_sz != b->grid_sz ||
+			a->block_sz != b->block_sz ||
+			a->shmem_sz != b->shmem_sz)
+			return false;
+	}
+	return true;
+}
+#endif	/* CUDA_VERSION >= 11040 */
+
+/*
+ * gpuKernelSeqLaunch
+ *
+ * It launches the sequence of kernels on the @stream. Once a sequence of
+ * the same GTS is launched, the worker thread keeps the CUDA Graph, and
+ * replays it with updated kernel parameters for the later chunks, to save
+ * the driver overhead per cuLaunchKernel.
+ * The graphs are released on exit of the worker thread; GTS never outlives
+ * the worker threads of the GpuContext.
+ */
+CUresult
+gpuKernelSeqLaunch(GpuKernelSeq *kseq, CUstream stream)
+{
+	CUresult	rc;
+	int			i;
+
+#if CUDA_VERSION >= 11040
+	if (pgstrom_enable_cuda_graph && kseq->nkernels > 1)
+	{
+		GpuKernelGraph *kgraph = NULL;
+		CUDA_KERNEL_NODE_PARAMS params;
+
+		for (i=0; i < GPU_KERNEL_GRAPH_NSLOTS; i++)
+		{
+			GpuKernelGraph *temp = &GpuWorkerKernelGraphs[i];
+
+			if (temp->exec &&
+				temp->gts == kseq->gts &&
+				temp->seq_id == kseq->seq_id)
+			{
+				kgraph = temp;
+				break;
+			}
+			/* elsewhere, choose an empty or the least recently used slot */
+			if (!kgraph || !kgraph->exec ||
+				(temp->exec && temp->last_used < kgraph->last_used))
+				kgraph = temp;
+		}
+		if (kgraph->exec && __gpuKernelGraphMatch(kgraph, kseq))
+		{
+			for (i=0; i < kseq->nkernels; i++)
+			{
+				__gpuKernelSeqNodeParams(&params, &kseq->kernels[i]);
+				rc = cuGraphExecKernelNodeSetParams(kgraph->exec,
+													kgraph->nodes[i],
+													&params);
+				if (rc != CUDA_SUCCESS)
+					break;
+			}
+			if (rc != CUDA_SUCCESS)
+				__gpuKernelGraphRelease(kgraph);
+		}
+		else
+		{
+			__gpuKernelGraphRelease(kgraph);
+			rc = __gpuKernelGraphBuild(kgraph, kseq);
+		}
+		if (rc == CUDA_SUCCESS)
+		{
+			kgraph->last_used = ++GpuWorkerKernelGraphClock;
+			return cuGraphLaunch(kgraph->exec, stream);
+		}
+		/* elsewhere, launch kernels one by one */
+	}
+#endif
+	for (i=0; i < kseq->nkernels; i++)
+	{
+		GpuKernelLaunch *kl = &kseq->kernels[i];
+
+		rc = cuLaunchKernel(kl->kfunc,
+							kl->grid_sz, 1, 1,
+							kl->block_sz, 1, 1,
+							kl->shmem_sz,
+							stream,
+							kl->kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			return rc;
+	}
+	return CUDA_SUCCESS;
+}
+
+/*
+ * GpuWorkerReleaseKernelGraphs
+ */
+static void
+GpuWorkerReleaseKernelGraphs(void)
+{
+#if CUDA_VERSION >= 11040
+	int		i;
+
+	for (i=0; i < GPU_KERNEL_GRAPH_NSLOTS; i++)
+		__gpuKernelGraphRelease(&GpuWorkerKernelGraphs[i]);
+#endif
+	GpuWorkerKernelGraphClock = 0;
+}
+
+/*
+ * gpuTaskAdjustWindow - adaptive concurrency control of GTS
+ *
+ * It works like the congestion control of TCP; the number of in-flight
+ * GpuTasks of the GTS is increased additively (1/window per completion)
+ * as long as the device is not saturated, the device memory has headroom,
+ * and the task latency is not inflated by queueing. Once a GpuTask is
+ * retried due to lack of GPU resources, the window is reduced by half.
+ */
+#define ADAPTIVE_MEMORY_HEADROOM		0.90
+#define ADAPTIVE_LATENCY_INFLATION		2.0
+
+static void
+gpuTaskAdjustWindow(GpuContext *gcontext, GpuTaskState *gts,
+					GpuTask *gtask, bool congested, TimestampTz tv_begin)
+{
+	TimestampTz	tv_now;
+	double		latency;
+
+	if (!pgstrom_adaptive_async_tasks)
+		return;
+	tv_now = GetCurrentTimestamp();
+	latency = (double)(tv_now - tv_begin);
+	if (gtask->chunk_sz > 0)
+		latency *= (double)(1UL << 20) / (double)gtask->chunk_sz;
+
+	pthreadMutexLock(gcontext->mutex);
+	if (congested)
 	{
-		const char *slash;
-
-		slash = strrchr(filename,'/');
-		if (slash)
-			filename = slash + 1;
+		/* multiplicative decrease, once per the task latency */
+		if (tv_now - gts->window_shrunk >
+			(TimestampTz)Max(gts->latency_min, 1000.0))
+		{
+			gts->inflight_window = Max(gts->inflight_window / 2.0, 1.0);
+			gts->window_shrunk = tv_now;
+		}
+	}
+	else
+	{
+		/* the minimum slowly goes up, to forget the stale one */
+		if (gts->latency_min <= 0.0 || latency < gts->latency_min)
+			gts->latency_min = latency;
+		else
+			gts->latency_min *= 1.01;
 
-		gcontext->error_code		= errcode;
-		gcontext->error_filename	= filename;
-		gcontext->error_lineno		= lineno;
-		gcontext->error_funcname	= funcname;
-		va_start(va_args, fmt);
-		vsnprintf(gcontext->error_message,
-				  sizeof(gcontext->error_message), fmt, va_args);
-		va_end(va_args);
-		/* unlock error information */
-		pg_atomic_fetch_and_u32(&gcontext->error_level, 0xfffffffeU);
+		/* additive increase */
+		if (latency < ADAPTIVE_LATENCY_INFLATION * gts->latency_min &&
+			pg_atomic_read_u32(gcontext->global_num_running_tasks) <
+			global_max_async_tasks &&
+			gpuMemUsageRatio(gcontext->cuda_dindex) < ADAPTIVE_MEMORY_HEADROOM)
+		{
+			gts->inflight_window = Min(gts->inflight_window +
+									   1.0 / gts->inflight_window,
+									   (double)gts->max_async_tasks);
+		}
 	}
-	if (GpuWorkerExceptionStack)
-		siglongjmp(*GpuWorkerExceptionStack, 1);
+	pthreadMutexUnlock(gcontext->mutex);
+}
+
+/*
+ * GpuWorkerSetState - exports the state of the current worker thread
+ */
+static inline void
+GpuWorkerSetState(GpuContext *gcontext, GpuWorkerState state)
+{
+	if (GpuWorkerIndex >= 0 && GpuWorkerIndex < GPUCTX_ACTIVITY_MAX_WORKERS)
+		pg_atomic_write_u32(&gcontext->activity->worker_state[GpuWorkerIndex],
+							state);
 }
 
 /*
@@ -638,7 +1472,6 @@ static void *
 GpuContextWorkerMain(void *arg)
 {
 	GpuContext	   *gcontext = arg;
-	dlist_node	   *dnode;
 	GpuTask		   *gtask;
 	CUresult		rc;
 	uint32			command;
@@ -657,47 +1490,106 @@ GpuContextWorkerMain(void *arg)
 		return NULL;
 	}
 	GpuWorkerCurrentContext = gcontext;
+	GpuWorkerSetState(gcontext, GpuWorkerState__Idle);
 
 	STROM_TRY();
 	{
+		/* copy streams to overlap with the kernel execution */
+		rc = cuStreamCreate(&GpuWorkerStreamH2D, CU_STREAM_NON_BLOCKING);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuStreamCreate: %s", errorText(rc));
+		rc = cuStreamCreate(&GpuWorkerStreamD2H, CU_STREAM_NON_BLOCKING);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuStreamCreate: %s", errorText(rc));
+		rc = cuEventCreate(&GpuWorkerPrefetchEvent, CU_EVENT_DISABLE_TIMING);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventCreate: %s", errorText(rc));
+		rc = cuEventCreate(&GpuWorkerStageEventBegin, CU_EVENT_DEFAULT);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventCreate: %s", errorText(rc));
+		rc = cuEventCreate(&GpuWorkerStageEventRecv, CU_EVENT_BLOCKING_SYNC);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventCreate: %s", errorText(rc));
+
 		while (pg_atomic_read_u32(&gcontext->terminate_workers) == 0)
 		{
 			GpuTaskState *gts;
 			CUmodule	cuda_module;
 			cl_int		retval;
+			TimestampTz	tv_begin;
+			cl_ulong	generation;
+			long		backoff_ms = 10;
 
-			pthreadMutexLock(gcontext->mutex);
-			if (dlist_is_empty(&gcontext->pending_tasks))
+			if (GpuWorkerNextTask)
+			{
+				gtask = GpuWorkerNextTask;
+				GpuWorkerNextTask = NULL;
+			}
+			else
+				gtask = GpuContextPopTask(gcontext);
+			if (!gtask)
 			{
+				pthreadMutexLock(gcontext->mutex);
+				/* GpuTask is enqueued under the mutex, so recheck here */
+				if (pg_atomic_read_u32(&gcontext->num_pending_tasks) > 0)
+				{
+					pthreadMutexUnlock(gcontext->mutex);
+					continue;
+				}
+				pg_atomic_fetch_add_u32(&gcontext->num_idle_workers, 1);
+				GpuWorkerSetState(gcontext, GpuWorkerState__Idle);
 				is_wakeup = pthreadCondWaitTimeout(gcontext->cond,
 												   gcontext->mutex,
 												   4000);
+				pg_atomic_fetch_sub_u32(&gcontext->num_idle_workers, 1);
 				pthreadMutexUnlock(gcontext->mutex);
 				if (is_wakeup)
 					command = pg_atomic_exchange_u32(gcontext->command, 0);
 				else
-					command = GPUCTX_CMD__RECLAIM_MEMORY;
+					command = 0;
 
 				if ((command & GPUCTX_CMD__RECLAIM_MEMORY) != 0)
+				{
+					/* a concurrent session is waiting for device memory */
+					GpuWorkerSetState(gcontext, GpuWorkerState__Reclaim);
+					gpuMemReclaimSegment(gcontext, true);
+					GpuWorkerSetState(gcontext, GpuWorkerState__Idle);
+				}
+				else if (!is_wakeup)
 				{
 					/*
 					 * XXX - Once GPU related tasks get idle, all the worker
 					 * threads may reach the timeout almost simultaneously.
 					 */
 					pthreadCondSignal(gcontext->cond);
-					gpuMemReclaimSegment(gcontext);
+					GpuWorkerSetState(gcontext, GpuWorkerState__Reclaim);
+					gpuMemReclaimSegment(gcontext, false);
+					GpuWorkerSetState(gcontext, GpuWorkerState__Idle);
 				}
 			}
 			else
 			{
-				dnode = dlist_pop_head_node(&gcontext->pending_tasks);
-				gtask = dlist_container(GpuTask, chain, dnode);
-				pthreadMutexUnlock(gcontext->mutex);
+				/*
+				 * Even if we are busy, release request by the concurrent
+				 * sessions should be processed soon.
+				 */
+				if (pg_atomic_read_u32(gcontext->command) != 0)
+				{
+					command = pg_atomic_exchange_u32(gcontext->command, 0);
+					if ((command & GPUCTX_CMD__RECLAIM_MEMORY) != 0)
+						gpuMemReclaimSegment(gcontext, true);
+				}
 
 				gts = gtask->gts;
+				GpuWorkerSetState(gcontext, GpuWorkerState__Running);
+				pg_atomic_write_u64(&gcontext->activity->program_id,
+									gtask->program_id);
 				cuda_module = GpuContextLookupModule(gcontext,
 													 gtask->program_id);
+				tv_begin = GetCurrentTimestamp();
 			retry_gputask:
+				/* snapshot prior to the resource allocation */
+				generation = gpuMemReleaseGeneration(gcontext);
 				/*
 				 * pgstromProcessGpuTask() returns the following status:
 				 *
@@ -708,11 +1600,53 @@ GpuContextWorkerMain(void *arg)
 				 * <0 : GpuTask gets completed successfully, and the
 				 *      handler wants to release GpuTask immediately.
 				 */
+				pgstromNvtxRangePush("GpuTask (plan=%d, seq=%u)",
+									 gts->css.ss.ps.plan->plan_id,
+									 gtask->task_seq);
 				retval = gts->cb_process_task(gtask, cuda_module);
+				pgstromNvtxRangePop();
+				/* adjust the number of in-flight tasks of GTS */
+				gpuTaskAdjustWindow(gcontext, gts, gtask, retval > 0,
+									tv_begin);
+				/* track the latency for adaptive chunk sizing */
+				if (retval <= 0 && gtask->chunk_sz > 0)
+				{
+					double	usec_per_mb = (double)
+						(GetCurrentTimestamp() - tv_begin) *
+						(double)(1UL << 20) / (double)gtask->chunk_sz;
+
+					pthreadMutexLock(gcontext->mutex);
+					if (gts->usec_per_mb <= 0.0)
+						gts->usec_per_mb = usec_per_mb;
+					else
+						gts->usec_per_mb = (0.75 * gts->usec_per_mb +
+											0.25 * usec_per_mb);
+					pthreadMutexUnlock(gcontext->mutex);
+				}
+				/* cumulative statistics, and time consumption per stage */
+				if (retval > 0)
+					pgstromStatGpuTaskRetry(gtask, gcontext->cuda_dindex);
+				else
+				{
+					pg_atomic_fetch_add_u64(&gcontext->activity->num_completed,
+											1);
+					pgstromStatGpuTaskDone(gtask, gcontext->cuda_dindex,
+										   GetCurrentTimestamp() - tv_begin);
+					if (gtask->stage_mask != 0)
+						GpuWorkerStageMerge(gcontext, gts, gtask);
+				}
 				if (retval > 0)
 				{
-					/* wait for 40ms */
-					pg_usleep(40000L);
+					/*
+					 * Wait for release of device memory or completion of
+					 * other GpuTasks since the last trial. Timeout is just
+					 * a safety net for resources we are not notified,
+					 * so it backs off exponentially up to 320ms.
+					 */
+					GpuWorkerSetState(gcontext, GpuWorkerState__Retry);
+					if (!gpuMemWaitRelease(gcontext, generation, backoff_ms))
+						backoff_ms = Min(2 * backoff_ms, 320);
+					GpuWorkerSetState(gcontext, GpuWorkerState__Running);
 					if (pg_atomic_read_u32(&gcontext->terminate_workers) == 0)
 						goto retry_gputask;
 					else
@@ -721,8 +1655,7 @@ GpuContextWorkerMain(void *arg)
 						 * urgent bailout if GpuContext is shutting down.
 						 */
 						pthreadMutexLock(gcontext->mutex);
-						dlist_push_tail(&gcontext->pending_tasks,
-										&gtask->chain);
+						GpuContextPushTask(gcontext, gtask);
 						gts->num_running_tasks--;
 						pthreadMutexUnlock(gcontext->mutex);
 					}
@@ -749,7 +1682,10 @@ GpuContextWorkerMain(void *arg)
 					gts->num_ready_tasks++;
 					pthreadMutexUnlock(gcontext->mutex);
 
+					gpuTaskSchedDone(gcontext, 1);
 					SetLatch(MyLatch);
+					/* GpuTask retrying for resources may be able to run */
+					gpuMemNotifyRelease(gcontext->cuda_dindex);
 				}
 				else
 				{
@@ -774,10 +1710,22 @@ GpuContextWorkerMain(void *arg)
 
 						gts->cb_release_task(gtask);
 					}
+					gpuTaskSchedDone(gcontext, 1);
 					SetLatch(MyLatch);
+					gpuMemNotifyRelease(gcontext->cuda_dindex);
 				}
 			}
 		}
+		/* back the prefetched GpuTask, if any */
+		if (GpuWorkerNextTask)
+		{
+			gtask = GpuWorkerNextTask;
+			pthreadMutexLock(gcontext->mutex);
+			GpuContextPushTask(gcontext, gtask);
+			gtask->gts->num_running_tasks--;
+			pthreadMutexUnlock(gcontext->mutex);
+			GpuWorkerNextTask = NULL;
+		}
 	}
 	STROM_CATCH();
 	{
@@ -788,6 +1736,24 @@ GpuContextWorkerMain(void *arg)
 	}
 	STROM_END_TRY();
 
+	GpuWorkerSetState(gcontext, GpuWorkerState__Exited);
+	GpuWorkerReleaseKernelGraphs();
+	if (GpuWorkerPrefetchEvent)
+		cuEventDestroy(GpuWorkerPrefetchEvent);
+	if (GpuWorkerStageEventBegin)
+		cuEventDestroy(GpuWorkerStageEventBegin);
+	if (GpuWorkerStageEventRecv)
+		cuEventDestroy(GpuWorkerStageEventRecv);
+	if (GpuWorkerStreamD2H)
+		cuStreamDestroy(GpuWorkerStreamD2H);
+	if (GpuWorkerStreamH2D)
+		cuStreamDestroy(GpuWorkerStreamH2D);
+	GpuWorkerPrefetchEvent = NULL;
+	GpuWorkerStageEventBegin = NULL;
+	GpuWorkerStageEventRecv = NULL;
+	GpuWorkerStreamD2H = NULL;
+	GpuWorkerStreamH2D = NULL;
+
 	return NULL;
 }
 
@@ -823,6 +1789,9 @@ activate_cuda_context(GpuContext *gcontext)
 	if (gcontext->cuda_context)
 		return;
 	Assert(dindex >= 0 && dindex < numDevAttrs);
+	/* reuse the CUDA context kept by the previous GpuContext, if any */
+	if (loadCudaContextPool(gcontext))
+		goto out;
 	rc = cuDeviceGet(&cuda_device, devAttrs[dindex].DEV_ID);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuDeviceGet: %s", errorText(rc));
@@ -850,6 +1819,134 @@ activate_cuda_context(GpuContext *gcontext)
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuCtxCreate: %s", errorText(rc));
 	gcontext->cuda_context = cuda_context;
+out:
+	/* bind the backend on the NUMA node of the GPU, if required */
+	steerBackendNumaAffinity(gcontext);
+	/* stream-ordered memory pool, if supported */
+	pgstrom_gpu_mmgr_init_mempool(gcontext);
+}
+
+/*
+ * NUMA affinity of the GpuContext
+ *
+ * Worker threads are bound to the CPUs on the NUMA node where the GPU
+ * device is connected, to avoid the DMA and I/O map traffic across the
+ * inter-socket link. The pinned host buffers allocated by the threads are
+ * also placed on the local node, by the first-touch policy of the kernel.
+ * Optionally, the backend itself is also bound during the GpuContext is
+ * active.
+ */
+static cpu_set_t   *gpu_numa_cpusets = NULL;	/* per device */
+static bool		   *gpu_numa_cpusets_valid = NULL;
+static cpu_set_t	backend_saved_cpuset;
+static int			backend_numa_steered = 0;
+
+static bool
+__parseNumaNodeCpuList(int numa_node_id, cpu_set_t *cpuset)
+{
+	char		path[MAXPGPATH];
+	char		linebuf[2048];
+	char	   *tok, *pos;
+	FILE	   *filp;
+	bool		retval;
+
+	CPU_ZERO(cpuset);
+	snprintf(path, sizeof(path),
+			 "/sys/devices/system/node/node%d/cpulist", numa_node_id);
+	filp = fopen(path, "r");
+	if (!filp)
+		return false;
+	retval = (fgets(linebuf, sizeof(linebuf), filp) != NULL);
+	fclose(filp);
+	if (!retval)
+		return false;
+
+	for (tok = strtok_r(linebuf, ",\n", &pos);
+		 tok != NULL;
+		 tok = strtok_r(NULL, ",\n", &pos))
+	{
+		int		lo, hi, cpu;
+
+		if (sscanf(tok, "%d-%d", &lo, &hi) != 2)
+		{
+			if (sscanf(tok, "%d", &lo) != 1)
+				continue;
+			hi = lo;
+		}
+		for (cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; cpu++)
+			CPU_SET(cpu, cpuset);
+	}
+	return (CPU_COUNT(cpuset) > 0);
+}
+
+static cpu_set_t *
+lookupGpuNumaCpuset(int cuda_dindex)
+{
+	int		i;
+
+	if (!gpu_numa_cpusets)
+	{
+		cpu_set_t  *cpusets = calloc(numDevAttrs, sizeof(cpu_set_t));
+		bool	   *valids = calloc(numDevAttrs, sizeof(bool));
+
+		if (!cpusets || !valids)
+		{
+			if (cpusets)
+				free(cpusets);
+			if (valids)
+				free(valids);
+			return NULL;
+		}
+		for (i=0; i < numDevAttrs; i++)
+		{
+			if (devAttrs[i].NUMA_NODE_ID >= 0)
+				valids[i] = __parseNumaNodeCpuList(devAttrs[i].NUMA_NODE_ID,
+												   &cpusets[i]);
+		}
+		gpu_numa_cpusets = cpusets;
+		gpu_numa_cpusets_valid = valids;
+	}
+	Assert(cuda_dindex >= 0 && cuda_dindex < numDevAttrs);
+	if (!gpu_numa_cpusets_valid[cuda_dindex])
+		return NULL;
+	return &gpu_numa_cpusets[cuda_dindex];
+}
+
+static void
+steerBackendNumaAffinity(GpuContext *gcontext)
+{
+	cpu_set_t  *cpuset;
+
+	if (!gpu_numa_affinity_backend || gcontext->numa_steered)
+		return;
+	cpuset = lookupGpuNumaCpuset(gcontext->cuda_dindex);
+	if (!cpuset)
+		return;
+	if (backend_numa_steered == 0 &&
+		sched_getaffinity(0, sizeof(cpu_set_t), &backend_saved_cpuset) != 0)
+	{
+		elog(DEBUG2, "failed on sched_getaffinity: %m");
+		return;
+	}
+	if (sched_setaffinity(0, sizeof(cpu_set_t), cpuset) != 0)
+	{
+		elog(DEBUG2, "failed on sched_setaffinity: %m");
+		return;
+	}
+	backend_numa_steered++;
+	gcontext->numa_steered = true;
+}
+
+static void
+restoreBackendNumaAffinity(GpuContext *gcontext)
+{
+	if (!gcontext->numa_steered)
+		return;
+	gcontext->numa_steered = false;
+	Assert(backend_numa_steered > 0);
+	if (--backend_numa_steered == 0 &&
+		sched_setaffinity(0, sizeof(cpu_set_t), &backend_saved_cpuset) != 0)
+		wnotice("failed on sched_setaffinity: %m");
 }
 
 /*
@@ -858,6 +1955,8 @@ activate_cuda_context(GpuContext *gcontext)
 static void
 activate_cuda_workers(GpuContext *gcontext)
 {
+	pthread_attr_t attr;
+	cpu_set_t  *cpuset;
 	CUresult	rc;
 	cl_int		i;
 
@@ -886,21 +1985,191 @@ activate_cuda_workers(GpuContext *gcontext)
 	}
 	GPUCONTEXT_POP(gcontext);
 
-	/* creation of worker threads */
+	/* creation of worker threads, on the NUMA node of the GPU if any */
+	if ((errno = pthread_attr_init(&attr)) != 0)
+		elog(ERROR, "failed on pthread_attr_init: %m");
+	if (gpu_numa_affinity &&
+		(cpuset = lookupGpuNumaCpuset(gcontext->cuda_dindex)) != NULL &&
+		(errno = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t),
+											 cpuset)) != 0)
+		elog(DEBUG2, "failed on pthread_attr_setaffinity_np: %m");
 	for (i=0; i < gcontext->num_workers; i++)
 	{
 		pthread_t	thread;
 
-		if ((errno = pthread_create(&thread, NULL,
+		if ((errno = pthread_create(&thread, &attr,
 									GpuContextWorkerMain,
 									gcontext)) != 0)
+		{
+			pthread_attr_destroy(&attr);
 			elog(ERROR, "failed on pthread_create: %m");
-
+		}
 		gcontext->worker_threads[i] = thread;
 	}
+	pthread_attr_destroy(&attr);
 	gcontext->worker_is_running = true;
 }
 
+/*
+ * __gpuTaskSchedUpdate - update the state of GpuContext on the scheduler.
+ * Caller must hold the lock of the scheduler entry.
+ */
+static void
+__gpuTaskSchedUpdate(GpuTaskSchedEntry *sched, GpuContext *gcontext,
+					 cl_uint num_running, bool waiting)
+{
+	bool	was_active = (gcontext->sched_num_running > 0 ||
+						  gcontext->sched_waiting);
+	bool	is_active = (num_running > 0 || waiting);
+
+	if (!gcontext->sched_waiting && waiting)
+		sched->num_waiters++;
+	else if (gcontext->sched_waiting && !waiting)
+	{
+		Assert(sched->num_waiters > 0);
+		sched->num_waiters--;
+	}
+
+	if (!was_active && is_active)
+	{
+		gcontext->sched_weight = pgstrom_gpu_task_priority;
+		sched->sum_weights += gcontext->sched_weight;
+	}
+	else if (was_active && !is_active)
+	{
+		Assert(sched->sum_weights >= gcontext->sched_weight);
+		sched->sum_weights -= gcontext->sched_weight;
+		gcontext->sched_weight = 0;
+	}
+	gcontext->sched_num_running = num_running;
+	gcontext->sched_waiting = waiting;
+	pg_atomic_write_u32(&gcontext->activity->num_inflight, num_running);
+}
+
+/*
+ * gpuTaskSchedAdmit
+ *
+ * It checks whether the GpuContext can submit one more GpuTask to the
+ * device, and reserves a slot of the device queue if admitted. Unless
+ * admitted, GpuContext is registered as a waiter, then the concurrent
+ * sessions over their share stop submission until it gets admitted.
+ * @force reserves a slot regardless of the limitation; to be used when
+ * the backend has nothing to wait for.
+ */
+bool
+gpuTaskSchedAdmit(GpuContext *gcontext, bool force)
+{
+	GpuTaskSchedEntry *sched = &gpu_task_sched[gcontext->cuda_dindex];
+	cl_uint		depth;
+	cl_uint		share;
+	cl_uint		weight;
+	cl_uint		num_waiters;
+	cl_ulong	sum_weights;
+	bool		admit = force;
+
+	SpinLockAcquire(&sched->lock);
+	if (!admit)
+	{
+		depth = pg_atomic_read_u32(gcontext->global_num_running_tasks);
+		if (depth < global_max_async_tasks)
+		{
+			sum_weights = sched->sum_weights;
+			num_waiters = sched->num_waiters;
+			if (gcontext->sched_num_running > 0 || gcontext->sched_waiting)
+				weight = gcontext->sched_weight;
+			else
+			{
+				weight = pgstrom_gpu_task_priority;
+				sum_weights += weight;
+			}
+			if (gcontext->sched_waiting)
+				num_waiters--;
+			share = (cl_uint)((double)global_max_async_tasks *
+							  (double)weight / (double)Max(sum_weights, 1));
+			if (gcontext->sched_num_running < Max(share, 1) ||
+				num_waiters == 0)
+				admit = true;
+		}
+	}
+	if (admit)
+	{
+		__gpuTaskSchedUpdate(sched, gcontext,
+							 gcontext->sched_num_running + 1, false);
+		pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
+	}
+	else
+	{
+		__gpuTaskSchedUpdate(sched, gcontext,
+							 gcontext->sched_num_running, true);
+	}
+	SpinLockRelease(&sched->lock);
+
+	return admit;
+}
+
+/*
+ * gpuTaskSchedDone - release the slots of the completed/cancelled GpuTasks
+ */
+void
+gpuTaskSchedDone(GpuContext *gcontext, cl_uint ntasks)
+{
+	GpuTaskSchedEntry *sched = &gpu_task_sched[gcontext->cuda_dindex];
+
+	if (ntasks == 0)
+		return;
+	SpinLockAcquire(&sched->lock);
+	Assert(gcontext->sched_num_running >= ntasks);
+	ntasks = Min(ntasks, gcontext->sched_num_running);
+	__gpuTaskSchedUpdate(sched, gcontext,
+						 gcontext->sched_num_running - ntasks,
+						 gcontext->sched_waiting);
+	pg_atomic_sub_fetch_u32(gcontext->global_num_running_tasks, ntasks);
+	SpinLockRelease(&sched->lock);
+}
+
+/*
+ * gpuTaskSchedLeave - GpuContext no longer waits for admission
+ */
+void
+gpuTaskSchedLeave(GpuContext *gcontext)
+{
+	GpuTaskSchedEntry *sched = &gpu_task_sched[gcontext->cuda_dindex];
+
+	SpinLockAcquire(&sched->lock);
+	__gpuTaskSchedUpdate(sched, gcontext,
+						 gcontext->sched_num_running, false);
+	SpinLockRelease(&sched->lock);
+}
+
+/*
+ * GetLeastBusyGpuDevice
+ *
+ * It returns the device index with the least number of running GpuTasks in
+ * the whole system. Ties are broken by the worker number, so concurrently
+ * launched workers are distributed over the devices.
+ */
+int
+GetLeastBusyGpuDevice(void)
+{
+	int		base = (IsParallelWorker()
+					? ParallelWorkerNumber
+					: MyProc->pgprocno);
+	int		i, j, cuda_dindex = -1;
+	uint32	count, count_min = UINT_MAX;
+
+	for (i=0; i < numDevAttrs; i++)
+	{
+		j = (base + i) % numDevAttrs;
+		count = pg_atomic_read_u32(&global_num_running_tasks[j]);
+		if (count < count_min)
+		{
+			cuda_dindex = j;
+			count_min = count;
+		}
+	}
+	return cuda_dindex;
+}
+
 /*
  * GetGpuContext - acquire a free GpuContext
  */
@@ -943,12 +2212,15 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps,
 	 * Not found, so allocate a new one
 	 */
 	gcontext = calloc(1, offsetof(GpuContext, worker_threads[num_workers]) +
-					  2 * sizeof(CUevent) * num_workers);
+					  2 * sizeof(CUevent) * num_workers +
+					  sizeof(GpuWorkerQueue) * num_workers);
 	if (!gcontext)
 		elog(ERROR, "out of memory");
 	gcontext->cuda_events0 = (CUevent *)
 		((char *)gcontext + offsetof(GpuContext, worker_threads[num_workers]));
 	gcontext->cuda_events1 = gcontext->cuda_events0 + num_workers;
+	gcontext->worker_queues = (GpuWorkerQueue *)
+		(gcontext->cuda_events1 + num_workers);
 
 	/* choose a device to use, if no preference */
 	if (cuda_dindex < 0)
@@ -971,12 +2243,19 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps,
 	pthreadMutexInit(&ipc_entry->mutex, 1);
 	pthreadCondInit(&ipc_entry->cond);
 	pg_atomic_init_u32(&ipc_entry->command, 0);
+	memset(&ipc_entry->activity, 0, sizeof(GpuContextActivity));
+	pg_atomic_init_u32(&ipc_entry->activity.cuda_dindex, cuda_dindex);
+	pg_atomic_init_u32(&ipc_entry->activity.num_workers, num_workers);
+	pg_atomic_init_u64(&ipc_entry->activity.program_id,
+					   (uint64) INVALID_PROGRAM_ID);
+	pg_atomic_write_u32(&ipc_entry->activity.pid, MyProcPid);
 
 	/* setup fields */
 	pg_atomic_init_u32(&gcontext->refcnt, 1);
 	gcontext->resowner		= CurrentResourceOwner;
 	gcontext->never_use_mps	= never_use_mps;
 	gcontext->cuda_dindex	= cuda_dindex;
+	gcontext->session_role	= GetSessionUserId();
 	pthreadMutexInit(&gcontext->cuda_modules_lock, 0);
 	for (i=0; i < CUDA_MODULES_HASHSIZE; i++)
 		dlist_init(&gcontext->cuda_modules_slot[i]);
@@ -998,12 +2277,19 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps,
 	gcontext->mutex		= &ipc_entry->mutex;
 	gcontext->cond		= &ipc_entry->cond;
 	gcontext->command	= &ipc_entry->command;
+	gcontext->activity	= &ipc_entry->activity;
 	pg_atomic_init_u32(&gcontext->terminate_workers, 0);
-	dlist_init(&gcontext->pending_tasks);
+	pg_atomic_init_u32(&gcontext->num_pending_tasks, 0);
+	pg_atomic_init_u32(&gcontext->num_idle_workers, 0);
+	gcontext->next_queue = 0;
 	gcontext->num_workers = num_workers;
 	pg_atomic_init_u32(&gcontext->worker_index, 0);
 	for (i=0; i < num_workers; i++)
+	{
 		gcontext->worker_threads[i] = pthread_self();
+		SpinLockInit(&gcontext->worker_queues[i].lock);
+		dlist_init(&gcontext->worker_queues[i].tasks);
+	}
 
 	SpinLockAcquire(&activeGpuContextLock);
 	dlist_push_head(&activeGpuContextList, &gcontext->chain);
@@ -1033,6 +2319,26 @@ ActivateGpuContext(GpuContext *gcontext)
 		activate_cuda_workers(gcontext);
 }
 
+/*
+ * LimitGpuContextWorkers - reduce the number of GPU worker threads
+ *
+ * It shall be called prior to the activation of the worker threads;
+ * the GpuContext is already allocated with pg_strom.local_max_async_tasks
+ * threads at most.
+ */
+void
+LimitGpuContextWorkers(GpuContext *gcontext, cl_int num_workers)
+{
+	if (!gcontext || gcontext->worker_is_running)
+		return;
+	num_workers = Max(num_workers, 1);
+	if (gcontext->num_workers > num_workers)
+	{
+		gcontext->num_workers = num_workers;
+		pg_atomic_write_u32(&gcontext->activity->num_workers, num_workers);
+	}
+}
+
 /*
  * ActivateGpuContextNoWorkers - activate only cuda_context
  */
@@ -1052,6 +2358,13 @@ DetachGpuContextIPCEntry(GpuContext *gcontext)
 	GpuContextIPCEntry *ipc_entry = (GpuContextIPCEntry *)
 		((char *)gcontext->mutex - offsetof(GpuContextIPCEntry, mutex));
 
+	/*
+	 * NOTE: worker threads and device memory cleanup may still update
+	 * the activity counters until SynchronizeGpuContext(), so redirect
+	 * them to the local sink not to mess up the next owner of the entry.
+	 */
+	pg_atomic_write_u32(&ipc_entry->activity.pid, 0);
+	gcontext->activity = &gcontext_activity_sink;
 	SpinLockAcquire(&gcontext_ipc_head->lock);
 	/* detach from the active list */
 	dlist_delete(&ipc_entry->chain);
@@ -1060,6 +2373,53 @@ DetachGpuContextIPCEntry(GpuContext *gcontext)
 	SpinLockRelease(&gcontext_ipc_head->lock);
 }
 
+/*
+ * GpuContextSendCommandToPeers
+ *
+ * It sends a command to the worker threads of the other GpuContexts on the
+ * same device, and returns number of the GpuContexts signaled.
+ */
+int
+GpuContextSendCommandToPeers(GpuContext *gcontext, uint32 command)
+{
+	GpuContextIPCEntry *my_entry = (GpuContextIPCEntry *)
+		((char *)gcontext->mutex - offsetof(GpuContextIPCEntry, mutex));
+	GpuContextIPCEntry **peers;
+	dlist_iter	iter;
+	int			i, npeers = 0;
+
+	peers = malloc(sizeof(GpuContextIPCEntry *) * max_num_gpucontext);
+	if (!peers)
+		return 0;
+	SpinLockAcquire(&gcontext_ipc_head->lock);
+	dlist_foreach(iter, &gcontext_ipc_head->active_list[gcontext->cuda_dindex])
+	{
+		GpuContextIPCEntry *ipc_entry = (GpuContextIPCEntry *)
+			dlist_container(GpuContextIPCEntry, chain, iter.cur);
+
+		if (ipc_entry == my_entry)
+			continue;
+		Assert(npeers < max_num_gpucontext);
+		pg_atomic_fetch_or_u32(&ipc_entry->command, command);
+		peers[npeers++] = ipc_entry;
+	}
+	SpinLockRelease(&gcontext_ipc_head->lock);
+
+	/*
+	 * NOTE: IPC entry may be detached and reused concurrently, but it is
+	 * harmless because the command just makes an extra memory reclaim.
+	 */
+	for (i=0; i < npeers; i++)
+	{
+		pthreadMutexLock(&peers[i]->mutex);
+		pthreadCondSignal(&peers[i]->cond);
+		pthreadMutexUnlock(&peers[i]->mutex);
+	}
+	free(peers);
+
+	return npeers;
+}
+
 /*
  * GetGpuContext - increment reference counter
  */
@@ -1235,6 +2595,190 @@ gpucontext_shmem_exit_cleanup(int code, Datum arg)
 	}
 }
 
+/*
+ * pgstrom_gpu_activity - live state of GpuContexts for each backend
+ *
+ * NOTE: IPC entries are picked up without locks not to block the worker
+ * threads, so the result is just a snapshot on the best effort.
+ */
+typedef struct
+{
+	uint32		pid;
+	uint32		cuda_dindex;
+	uint32		num_workers;
+	uint32		num_pending;
+	uint32		num_inflight;
+	uint32		num_running;
+	uint64		num_completed;
+	uint64		program_id;
+	uint64		mem_normal;
+	uint64		mem_managed;
+	uint64		mem_iomap;
+	uint64		mem_hostmem;
+	uint32		mem_segments;
+	uint64		mem_free;
+	uint32		mem_free_chunks[GPUCTX_ACTIVITY_MEM_NCLASSES];
+	uint32		worker_state[GPUCTX_ACTIVITY_MAX_WORKERS];
+} gpu_activity_info;
+
+Datum
+pgstrom_gpu_activity(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	gpu_activity_info *info;
+	HeapTuple	tuple;
+	Datum		values[16];
+	bool		isnull[16];
+	Datum		chunks[GPUCTX_ACTIVITY_MEM_NCLASSES];
+	Datum	   *states;
+	int			i;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		List		   *items = NIL;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(16);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  1, "pid",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  2, "device",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  3, "pending",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  4, "running",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  5, "inflight",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  6, "max_async",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  7, "completed",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  8, "program_id",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  9, "mem_normal",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 10, "mem_managed",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 11, "mem_iomap",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 12, "mem_hostmem",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 13, "mem_segments",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 14, "mem_free",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 15, "mem_free_chunks",
+						   INT4ARRAYOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 16, "worker_states",
+						   TEXTARRAYOID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		for (i=0; i < max_num_gpucontext; i++)
+		{
+			GpuContextActivity *activity
+				= &gcontext_ipc_head->ipc_entries[i].activity;
+			uint32		pid = pg_atomic_read_u32(&activity->pid);
+			int			j;
+
+			if (pid == 0)
+				continue;
+			info = palloc0(sizeof(gpu_activity_info));
+			info->pid = pid;
+			info->cuda_dindex = pg_atomic_read_u32(&activity->cuda_dindex);
+			info->num_workers = Min(pg_atomic_read_u32(&activity->num_workers),
+									GPUCTX_ACTIVITY_MAX_WORKERS);
+			info->num_pending = pg_atomic_read_u32(&activity->num_pending);
+			info->num_inflight = pg_atomic_read_u32(&activity->num_inflight);
+			info->num_completed = pg_atomic_read_u64(&activity->num_completed);
+			info->program_id = pg_atomic_read_u64(&activity->program_id);
+			info->mem_normal = pg_atomic_read_u64(&activity->mem_normal);
+			info->mem_managed = pg_atomic_read_u64(&activity->mem_managed);
+			info->mem_iomap = pg_atomic_read_u64(&activity->mem_iomap);
+			info->mem_hostmem = pg_atomic_read_u64(&activity->mem_hostmem);
+			info->mem_segments = pg_atomic_read_u32(&activity->mem_segments);
+			info->mem_free = pg_atomic_read_u64(&activity->mem_free);
+			for (j=0; j < GPUCTX_ACTIVITY_MEM_NCLASSES; j++)
+				info->mem_free_chunks[j]
+					= pg_atomic_read_u32(&activity->mem_free_chunks[j]);
+			for (j=0; j < info->num_workers; j++)
+			{
+				uint32	state = pg_atomic_read_u32(&activity->worker_state[j]);
+
+				if (state == GpuWorkerState__Running ||
+					state == GpuWorkerState__Retry)
+					info->num_running++;
+				info->worker_state[j] = state;
+			}
+			/* entry might be released during the snapshot */
+			if (pg_atomic_read_u32(&activity->pid) != pid)
+			{
+				pfree(info);
+				continue;
+			}
+			items = lappend(items, info);
+		}
+		fncxt->user_fctx = items;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+
+	if (fncxt->call_cntr >= list_length((List *) fncxt->user_fctx))
+		SRF_RETURN_DONE(fncxt);
+	info = list_nth((List *) fncxt->user_fctx, fncxt->call_cntr);
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = Int32GetDatum(info->pid);
+	values[1] = Int32GetDatum(info->cuda_dindex);
+	values[2] = Int32GetDatum(info->num_pending);
+	values[3] = Int32GetDatum(info->num_running);
+	values[4] = Int32GetDatum(info->num_inflight);
+	values[5] = Int32GetDatum(info->num_workers);
+	values[6] = Int64GetDatum(info->num_completed);
+	if (info->program_id == (uint64) INVALID_PROGRAM_ID)
+		isnull[7] = true;
+	else
+		values[7] = Int64GetDatum(info->program_id);
+	values[8] = Int64GetDatum(info->mem_normal);
+	values[9] = Int64GetDatum(info->mem_managed);
+	values[10] = Int64GetDatum(info->mem_iomap);
+	values[11] = Int64GetDatum(info->mem_hostmem);
+	values[12] = Int32GetDatum(info->mem_segments);
+	values[13] = Int64GetDatum(info->mem_free);
+	for (i=0; i < GPUCTX_ACTIVITY_MEM_NCLASSES; i++)
+		chunks[i] = Int32GetDatum(info->mem_free_chunks[i]);
+	values[14] = PointerGetDatum(construct_array(chunks,
+												 GPUCTX_ACTIVITY_MEM_NCLASSES,
+												 INT4OID, sizeof(int32),
+												 true, 'i'));
+
+	states = palloc(sizeof(Datum) * Max(info->num_workers, 1));
+	for (i=0; i < info->num_workers; i++)
+	{
+		const char *label;
+
+		switch (info->worker_state[i])
+		{
+			case GpuWorkerState__Idle:		label = "idle";		break;
+			case GpuWorkerState__Running:	label = "running";	break;
+			case GpuWorkerState__Retry:		label = "retry";	break;
+			case GpuWorkerState__Reclaim:	label = "reclaim";	break;
+			case GpuWorkerState__Exited:	label = "exited";	break;
+			default:						label = "inactive";	break;
+		}
+		states[i] = CStringGetTextDatum(label);
+	}
+	values[15] = PointerGetDatum(construct_array(states, info->num_workers,
+												 TEXTOID, -1, false, 'i'));
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gpu_activity);
+
 /*
  * pgstrom_startup_gpu_context
  */
@@ -1256,6 +2800,19 @@ pgstrom_startup_gpu_context(void)
 	for (i=0; i < numDevAttrs; i++)
 		pg_atomic_init_u32(&global_num_running_tasks[i], 0);
 
+	gpu_task_sched =
+		ShmemInitStruct("GPU task scheduler",
+						sizeof(GpuTaskSchedEntry) * numDevAttrs,
+						&found);
+	if (found)
+		elog(ERROR, "Bug? GPU task scheduler exists");
+	for (i=0; i < numDevAttrs; i++)
+	{
+		SpinLockInit(&gpu_task_sched[i].lock);
+		gpu_task_sched[i].num_waiters = 0;
+		gpu_task_sched[i].sum_weights = 0;
+	}
+
 	gcontext_ipc_head =
 		ShmemInitStruct("IPC stuff for GpuContex",
 						MAXALIGN(offsetof(GpuContextIPCHead,
@@ -1306,7 +2863,27 @@ pgstrom_init_gpu_context(void)
 							&local_max_async_tasks,
 							8,
 							1,
-							64,
+							GPUCTX_ACTIVITY_MAX_WORKERS,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("pg_strom.adaptive_async_tasks",
+			"Enables adaptive control of the number of concurrent GpuTasks per backend",
+							 NULL,
+							 &pgstrom_adaptive_async_tasks,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pg_strom.gpu_task_priority",
+			"Weight of the session on the fair-share scheduling of GpuTasks",
+							NULL,
+							&pgstrom_gpu_task_priority,
+							100,
+							1,
+							10000,
 							PGC_SUSET,
 							GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
@@ -1323,12 +2900,49 @@ pgstrom_init_gpu_context(void)
 							GUC_NOT_IN_SAMPLE | GUC_NO_SHOW_ALL,
 							NULL, NULL, NULL);
 
+	DefineCustomBoolVariable("pg_strom.enable_cuda_graph",
+							 "Enables CUDA Graph to replay a series of kernel launches per chunk",
+							 NULL,
+							 &pgstrom_enable_cuda_graph,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("pg_strom.gpu_numa_affinity",
+							 "Binds GPU worker threads to the NUMA node of the GPU device",
+							 NULL,
+							 &gpu_numa_affinity,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("pg_strom.gpu_numa_affinity_backend",
+							 "Binds the backend process to the NUMA node of the GPU device during GPU execution",
+							 NULL,
+							 &gpu_numa_affinity_backend,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("pg_strom.keep_cuda_context",
+							 "Keeps CUDA context and modules for the next query in the same session",
+							 NULL,
+							 &keep_cuda_context,
+							 false,
+							 PGC_SUSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
 	/* initialization of GpuContext List */
 	SpinLockInit(&activeGpuContextLock);
 	dlist_init(&activeGpuContextList);
 
 	/* shared memory */
 	RequestAddinShmemSpace(MAXALIGN(sizeof(pg_atomic_uint32) * numDevAttrs) +
+						   MAXALIGN(sizeof(GpuTaskSchedEntry) * numDevAttrs) +
 						   MAXALIGN(offsetof(GpuContextIPCHead,
 											ipc_entries[max_num_gpucontext])) +
 						   MAXALIGN(sizeof(dlist_head) * numDevAttrs));
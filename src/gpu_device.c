@@ -379,6 +379,38 @@ gpuOccupancyMaxPotentialBlockSize(int *p_min_grid_sz,
 	return rc;
 }
 
+/*
+ * Cache of the optimal grid/block size
+ *
+ * The occupancy calculator is not cheap, but the result depends only on
+ * the kernel function (thus, program and its variant), device and the
+ * dynamic shared memory consumption. So, we keep the results per thread.
+ * Because CUfunction handles may be reused once CUDA modules are unloaded,
+ * the cache shall be reset by gpuOptimalBlockSizeReset() on release of the
+ * GpuContext. GPU worker threads are launched per GpuContext, so it is
+ * only needed for the backend.
+ */
+#define OPTIMAL_BLOCKSIZE_CACHE_NSLOTS		64
+
+typedef struct
+{
+	CUfunction	kern_function;
+	CUdevice	cuda_device;
+	size_t		dynamic_shmem_per_block;
+	size_t		dynamic_shmem_per_thread;
+	cl_int		grid_sz;
+	cl_int		block_sz;
+} OptimalBlockSizeCache;
+
+static __thread OptimalBlockSizeCache
+	optimal_blocksize_cache[OPTIMAL_BLOCKSIZE_CACHE_NSLOTS];
+
+void
+gpuOptimalBlockSizeReset(void)
+{
+	memset(optimal_blocksize_cache, 0, sizeof(optimal_blocksize_cache));
+}
+
 CUresult
 gpuOptimalBlockSize(int *p_grid_sz,
 					int *p_block_sz,
@@ -387,13 +419,30 @@ gpuOptimalBlockSize(int *p_grid_sz,
 					size_t dynamic_shmem_per_block,
 					size_t dynamic_shmem_per_thread)
 {
+	OptimalBlockSizeCache *cache;
 	cl_int		mp_count;
 	cl_int		min_grid_sz;
 	cl_int		max_block_sz;
 	cl_int		max_multiplicity;
 	size_t		dynamic_shmem_sz;
+	cl_uint		hindex;
 	CUresult	rc;
 
+	hindex = hash_uint32((cl_uint)((uintptr_t)kern_function >> 4) ^
+						 (cl_uint)cuda_device ^
+						 (cl_uint)(dynamic_shmem_per_block << 8) ^
+						 (cl_uint)(dynamic_shmem_per_thread << 20));
+	cache = &optimal_blocksize_cache[hindex % OPTIMAL_BLOCKSIZE_CACHE_NSLOTS];
+	if (cache->kern_function == kern_function &&
+		cache->cuda_device == cuda_device &&
+		cache->dynamic_shmem_per_block == dynamic_shmem_per_block &&
+		cache->dynamic_shmem_per_thread == dynamic_shmem_per_thread)
+	{
+		*p_grid_sz = cache->grid_sz;
+		*p_block_sz = cache->block_sz;
+		return CUDA_SUCCESS;
+	}
+
 	rc = cuDeviceGetAttribute(&mp_count,
 							  CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT,
 							  cuda_device);
@@ -421,6 +470,13 @@ gpuOptimalBlockSize(int *p_grid_sz,
 					 max_multiplicity) * mp_count;
 	*p_block_sz = max_block_sz;
 
+	cache->kern_function = kern_function;
+	cache->cuda_device = cuda_device;
+	cache->dynamic_shmem_per_block = dynamic_shmem_per_block;
+	cache->dynamic_shmem_per_thread = dynamic_shmem_per_thread;
+	cache->grid_sz = *p_grid_sz;
+	cache->block_sz = *p_block_sz;
+
 	return CUDA_SUCCESS;
 }
 
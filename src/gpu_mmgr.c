@@ -55,6 +55,8 @@ typedef struct
 	dlist_node		chain;
 	GpuMemKind		gm_kind;	/* one of GpuMemKind__* */
 	CUdeviceptr		m_segment;	/* device pointer of the segment */
+	size_t			segment_sz;	/* length of the segment */
+	bool			hostcache;	/* host segment from the hostcache */
 	unsigned long	iomap_handle; /* only if GpuMemKind__IOMapMemory */
 	slock_t			lock;		/* protection of chunks */
 	pg_atomic_uint32 num_active_chunks; /* # of active chunks */
@@ -62,18 +64,54 @@ typedef struct
 	GpuMemChunk		gm_chunks[FLEXIBLE_ARRAY_MEMBER];
 } GpuMemSegment;
 
-/* statistics of GPU memory usage (shared; per device) */
-//to be used for memory release request mechanism
+/*
+ * statistics of GPU memory usage (shared; per device)
+ *
+ * It also performs as a rendezvous point of the memory release request
+ * mechanism. Once a backend fails to allocate a new segment, it asks the
+ * peer GpuContexts on the same device to release their idle segments, then
+ * waits for the release_generation to be incremented.
+ */
 typedef struct
 {
 	size_t				total_size;
 	pg_atomic_uint64	normal_usage;
 	pg_atomic_uint64	managed_usage;
 	pg_atomic_uint64	iomap_usage;
+	pg_atomic_uint64	peak_usage;		/* high-water mark of the above */
+	/* memory release request mechanism */
+	pthread_mutex_t		release_mutex;
+	pthread_cond_t		release_cond;
+	pg_atomic_uint64	release_generation;
+	pg_atomic_uint32	release_waiters;
+	/* evictable preserved memory, and reclaim request to the keeper */
+	pg_atomic_uint64	preserved_evictable;
+	pg_atomic_uint32	preserved_reclaim;
 } GpuMemStatistics;
 
+/*
+ * GpuMemHostCache - pinned host segment cached across GpuContexts
+ *
+ * Pinned host memory allocation takes milliseconds, and it is not ignorable
+ * for short queries because GpuContext is created per query. So, we keep
+ * a certain amount of host segments in the process-local cache. They are
+ * allocated under the primary context of CUDA with portable flag, thus
+ * not destroyed with GpuContext, and available for all the CUDA contexts.
+ */
+typedef struct
+{
+	dlist_node		chain;
+	CUdeviceptr		m_segment;
+} GpuMemHostCache;
+
 /*
  * GpuMemPreserved
+ *
+ * If @evictable, the keeper may release the preserved memory once nobody
+ * references it (@refcnt == 0), in LRU order of @atime, when the device
+ * memory or the quota of the owner runs out. Its users must acquire the
+ * reference by gpuMemPreservedGet() prior to the use, and must be prepared
+ * for the case when it was already evicted.
  */
 typedef struct
 {
@@ -83,7 +121,10 @@ typedef struct
    	CUdeviceptr		m_devptr;	/* valid only keeper */
 	CUipcMemHandle	m_handle;
 	Oid				owner;		/* owner of the preserved memory */
+	bool			evictable;	/* keeper can release it if unreferenced */
+	cl_int			refcnt;		/* number of references by the users */
 	TimestampTz		ctime;		/* time of creation */
+	TimestampTz		atime;		/* time of the last access */
 } GpuMemPreserved;
 
 /*
@@ -98,6 +139,8 @@ typedef struct
 	CUipcMemHandle	m_handle;
 	cl_int			cuda_dindex;
 	ssize_t			bytesize;
+	bool			evictable;
+	size_t			quota;		/* quota of the owner in bytes, or 0 */
 } GpuMemPreservedRequest;
 
 /*
@@ -127,8 +170,18 @@ static shmem_startup_hook_type shmem_startup_next = NULL;
 static GpuMemStatistics *gm_stat_array = NULL;
 static int			gpu_memory_segment_size_kb;	/* GUC */
 static size_t		gm_segment_sz;	/* bytesize */
+static int			gpu_memory_segment_min_size_kb;	/* GUC */
+static size_t		gm_segment_min_sz;	/* bytesize */
+static int			gpu_memory_reclaim_timeout;	/* GUC */
+static bool			gpu_memory_pool_enabled;	/* GUC */
+static int			pinned_host_cache_size_mb;	/* GUC */
+static pthread_mutex_t gm_hostcache_lock = PTHREAD_MUTEX_INITIALIZER;
+static dlist_head	gm_hostcache_list;
+static size_t		gm_hostcache_usage = 0;		/* # of bytes cached */
+static CUcontext	gm_hostcache_context = NULL;
 
 static int			num_preserved_gpu_memory_regions;	/* GUC */
+static int			preserved_gpu_memory_quota_mb;		/* GUC */
 static bool			gpummgr_bgworker_got_signal = false;
 static GpuMemPreservedHead *gmemp_head = NULL;
 static	CUcontext  *gpummgr_cuda_context = NULL;
@@ -137,6 +190,330 @@ Datum pgstrom_device_preserved_meminfo(PG_FUNCTION_ARGS);
 
 #define GPUMEM_DEVICE_RAW_EXTRA		((void *)(~0L))
 #define GPUMEM_HOST_RAW_EXTRA		((void *)(~1L))
+#define GPUMEM_DEVICE_ASYNC_EXTRA	((void *)(~2L))
+
+/*
+ * gpuMemHostSegmentAlloc - allocation of a pinned host segment
+ *
+ * It picks up a cached segment first, if any. Elsewhere, it allocates
+ * a new segment under the primary context, if hostcache is enabled.
+ */
+static CUresult
+gpuMemHostSegmentAlloc(GpuContext *gcontext,
+					   CUdeviceptr *p_segment,
+					   bool *p_hostcache)
+{
+	GpuMemHostCache *hcache;
+	CUdevice	cuda_device;
+	CUresult	rc;
+
+	if (pinned_host_cache_size_mb <= 0)
+	{
+		/* no hostcache, so allocated under the GpuContext */
+		*p_hostcache = false;
+		return cuMemHostAlloc((void **)p_segment, gm_segment_sz,
+							  CU_MEMHOSTALLOC_PORTABLE);
+	}
+
+	pthreadMutexLock(&gm_hostcache_lock);
+	if (!dlist_is_empty(&gm_hostcache_list))
+	{
+		hcache = dlist_container(GpuMemHostCache, chain,
+								 dlist_pop_head_node(&gm_hostcache_list));
+		gm_hostcache_usage -= gm_segment_sz;
+		pthreadMutexUnlock(&gm_hostcache_lock);
+
+		*p_segment = hcache->m_segment;
+		*p_hostcache = true;
+		free(hcache);
+		return CUDA_SUCCESS;
+	}
+
+	if (!gm_hostcache_context)
+	{
+		rc = cuDeviceGet(&cuda_device,
+						 devAttrs[gcontext->cuda_dindex].DEV_ID);
+		if (rc == CUDA_SUCCESS)
+			rc = cuDevicePrimaryCtxRetain(&gm_hostcache_context,
+										  cuda_device);
+		if (rc != CUDA_SUCCESS)
+		{
+			pthreadMutexUnlock(&gm_hostcache_lock);
+			wnotice("failed on cuDevicePrimaryCtxRetain: %s",
+					errorText(rc));
+			return rc;
+		}
+	}
+	pthreadMutexUnlock(&gm_hostcache_lock);
+
+	rc = cuCtxPushCurrent(gm_hostcache_context);
+	if (rc != CUDA_SUCCESS)
+		return rc;
+	rc = cuMemHostAlloc((void **)p_segment, gm_segment_sz,
+						CU_MEMHOSTALLOC_PORTABLE);
+	cuCtxPopCurrent(NULL);
+	*p_hostcache = true;
+
+	return rc;
+}
+
+/*
+ * gpuMemHostSegmentRelease - release of a pinned host segment from the
+ * hostcache; it is kept by the cache if still has room.
+ */
+static CUresult
+gpuMemHostSegmentRelease(CUdeviceptr m_segment)
+{
+	GpuMemHostCache *hcache;
+	size_t		limit = (size_t)pinned_host_cache_size_mb << 20;
+	CUresult	rc;
+
+	pthreadMutexLock(&gm_hostcache_lock);
+	if (gm_hostcache_usage + gm_segment_sz <= limit &&
+		(hcache = malloc(sizeof(GpuMemHostCache))) != NULL)
+	{
+		hcache->m_segment = m_segment;
+		dlist_push_head(&gm_hostcache_list, &hcache->chain);
+		gm_hostcache_usage += gm_segment_sz;
+		pthreadMutexUnlock(&gm_hostcache_lock);
+		return CUDA_SUCCESS;
+	}
+	pthreadMutexUnlock(&gm_hostcache_lock);
+
+	Assert(gm_hostcache_context != NULL);
+	rc = cuCtxPushCurrent(gm_hostcache_context);
+	if (rc != CUDA_SUCCESS)
+		return rc;
+	rc = cuMemFreeHost((void *)m_segment);
+	cuCtxPopCurrent(NULL);
+
+	return rc;
+}
+
+/*
+ * gpuMemActivityAccount - memory usage per GpuContext for gpu_activity()
+ */
+static inline void
+gpuMemActivityAccount(GpuContext *gcontext, GpuMemKind gm_kind, int64 delta)
+{
+	GpuContextActivity *activity = gcontext->activity;
+	pg_atomic_uint64   *counter;
+
+	switch (gm_kind)
+	{
+		case GpuMemKind__NormalMemory:
+			counter = &activity->mem_normal;
+			break;
+		case GpuMemKind__ManagedMemory:
+			counter = &activity->mem_managed;
+			break;
+		case GpuMemKind__IOMapMemory:
+			counter = &activity->mem_iomap;
+			break;
+		case GpuMemKind__HostMemory:
+			counter = &activity->mem_hostmem;
+			break;
+		default:
+			return;
+	}
+	pg_atomic_fetch_add_u64(counter, delta);
+}
+
+/*
+ * gpuMemNotifyRelease - wake up the waiters for device memory, if any
+ *
+ * It is called on release of device memory, and completion of GpuTasks.
+ * The generation is always incremented, so a waiter who took its snapshot
+ * prior to the resource allocation never misses the release.
+ */
+void
+gpuMemNotifyRelease(cl_int cuda_dindex)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[cuda_dindex];
+
+	pg_atomic_fetch_add_u64(&gm_stat->release_generation, 1);
+	if (pg_atomic_read_u32(&gm_stat->release_waiters) == 0)
+		return;
+	pthreadMutexLock(&gm_stat->release_mutex);
+	pthreadCondBroadcast(&gm_stat->release_cond);
+	pthreadMutexUnlock(&gm_stat->release_mutex);
+}
+
+/*
+ * __gpuMemUpdatePeakUsage - update the high-water mark of the device memory
+ */
+static void
+__gpuMemUpdatePeakUsage(GpuMemStatistics *gm_stat)
+{
+	uint64		usage = (pg_atomic_read_u64(&gm_stat->normal_usage) +
+						 pg_atomic_read_u64(&gm_stat->managed_usage) +
+						 pg_atomic_read_u64(&gm_stat->iomap_usage));
+	uint64		peak = pg_atomic_read_u64(&gm_stat->peak_usage);
+
+	while (peak < usage)
+	{
+		if (pg_atomic_compare_exchange_u64(&gm_stat->peak_usage,
+										   &peak, usage))
+			break;
+	}
+}
+
+/*
+ * gpuMemUsageInfo - current and peak usage of the device memory
+ */
+void
+gpuMemUsageInfo(cl_int cuda_dindex, size_t *p_total_size,
+				size_t *p_curr_usage, size_t *p_peak_usage)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[cuda_dindex];
+
+	*p_total_size = gm_stat->total_size;
+	*p_curr_usage = (pg_atomic_read_u64(&gm_stat->normal_usage) +
+					 pg_atomic_read_u64(&gm_stat->managed_usage) +
+					 pg_atomic_read_u64(&gm_stat->iomap_usage));
+	*p_peak_usage = pg_atomic_read_u64(&gm_stat->peak_usage);
+}
+
+/*
+ * gpuMemResetPeakUsage - reset the high-water mark by the current usage
+ */
+void
+gpuMemResetPeakUsage(cl_int cuda_dindex)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[cuda_dindex];
+
+	pg_atomic_write_u64(&gm_stat->peak_usage, 0);
+	__gpuMemUpdatePeakUsage(gm_stat);
+}
+
+/*
+ * gpuMemUsageRatio - ratio of the device memory consumed on the device
+ */
+double
+gpuMemUsageRatio(cl_int cuda_dindex)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[cuda_dindex];
+	cl_ulong	usage;
+
+	if (gm_stat->total_size == 0)
+		return 0.0;
+	usage = (pg_atomic_read_u64(&gm_stat->normal_usage) +
+			 pg_atomic_read_u64(&gm_stat->iomap_usage));
+	return (double)usage / (double)gm_stat->total_size;
+}
+
+/*
+ * gpuMemReleaseGeneration - snapshot of the generation for
+ * gpuMemWaitRelease()
+ */
+cl_ulong
+gpuMemReleaseGeneration(GpuContext *gcontext)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[gcontext->cuda_dindex];
+
+	return pg_atomic_read_u64(&gm_stat->release_generation);
+}
+
+/*
+ * __gpuMemWaitRelease - wait for any device memory release on the device,
+ * or the timeout. It returns true if someone released device memory since
+ * the supplied generation.
+ */
+static bool
+__gpuMemWaitRelease(GpuMemStatistics *gm_stat,
+					cl_ulong generation, long timeout_ms)
+{
+	TimestampTz	tv_expired;
+	long		remain_ms = timeout_ms;
+	bool		retval;
+
+	tv_expired = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+											 timeout_ms);
+	pthreadMutexLock(&gm_stat->release_mutex);
+	while (pg_atomic_read_u64(&gm_stat->release_generation) == generation &&
+		   remain_ms > 0)
+	{
+		if (!pthreadCondWaitTimeout(&gm_stat->release_cond,
+									&gm_stat->release_mutex,
+									remain_ms))
+			break;
+		remain_ms = (tv_expired - GetCurrentTimestamp()) / 1000L;
+	}
+	retval = (pg_atomic_read_u64(&gm_stat->release_generation) != generation);
+	pthreadMutexUnlock(&gm_stat->release_mutex);
+
+	return retval;
+}
+
+/*
+ * gpuMemWaitRelease - wait for device memory release or completion of
+ * GpuTasks since the @generation, instead of the fixed time sleep, when
+ * GpuTask cannot acquire enough device resources. It returns true, if
+ * something was released.
+ */
+bool
+gpuMemWaitRelease(GpuContext *gcontext, cl_ulong generation, long timeout_ms)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[gcontext->cuda_dindex];
+	bool		retval;
+
+	pg_atomic_fetch_add_u32(&gm_stat->release_waiters, 1);
+	retval = __gpuMemWaitRelease(gm_stat, generation, timeout_ms);
+	pg_atomic_fetch_sub_u32(&gm_stat->release_waiters, 1);
+
+	return retval;
+}
+
+/*
+ * gpuMemRequestPreservedReclaim - ask the keeper to release the evictable
+ * preserved memory not referenced by anybody. It returns true if request
+ * is sent; the keeper wakes up waiters once it released something.
+ */
+static bool
+gpuMemRequestPreservedReclaim(cl_int cuda_dindex)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[cuda_dindex];
+	Latch	   *keeper;
+
+	if (pg_atomic_read_u64(&gm_stat->preserved_evictable) == 0)
+		return false;
+	keeper = gmemp_head->gmemp_keeper;
+	if (!keeper)
+		return false;
+	pg_atomic_write_u32(&gm_stat->preserved_reclaim, 1);
+	SetLatch(keeper);
+	return true;
+}
+
+/*
+ * gpuMemRequestRelease - ask the peer GpuContexts on the same device to
+ * release their idle segments immediately, then wait for the completion.
+ * It returns true if some device memory was released, so caller can retry.
+ */
+static bool
+gpuMemRequestRelease(GpuContext *gcontext)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[gcontext->cuda_dindex];
+	cl_ulong	generation;
+	int			count;
+	bool		retval = false;
+
+	if (gpu_memory_reclaim_timeout <= 0)
+		return false;
+
+	pg_atomic_fetch_add_u32(&gm_stat->release_waiters, 1);
+	generation = pg_atomic_read_u64(&gm_stat->release_generation);
+	count = GpuContextSendCommandToPeers(gcontext,
+										 GPUCTX_CMD__RECLAIM_MEMORY);
+	if (gpuMemRequestPreservedReclaim(gcontext->cuda_dindex))
+		count++;
+	if (count > 0)
+		retval = __gpuMemWaitRelease(gm_stat, generation,
+									 gpu_memory_reclaim_timeout);
+	pg_atomic_fetch_sub_u32(&gm_stat->release_waiters, 1);
+
+	return retval;
+}
 
 /*
  * gpuMemFreeChunk
@@ -149,12 +526,12 @@ gpuMemFreeChunk(GpuContext *gcontext,
 	GpuMemChunk	   *gm_chunk;
 	GpuMemChunk	   *gm_buddy;
 	cl_long			unitsz = GPUMEM_CHUNKSZ_MIN;
-	cl_long			nchunks = gm_segment_sz / unitsz;
+	cl_long			nchunks = gm_seg->segment_sz / unitsz;
 	cl_long			index;
 	cl_long			shift;
 
 	Assert(m_deviceptr >= gm_seg->m_segment &&
-		   m_deviceptr <  gm_seg->m_segment + gm_segment_sz);
+		   m_deviceptr <  gm_seg->m_segment + gm_seg->segment_sz);
 	index = (m_deviceptr - gm_seg->m_segment) / unitsz;
 	Assert(index >= 0 && index < nchunks);
 	gm_chunk = &gm_seg->gm_chunks[index];
@@ -233,11 +610,17 @@ gpuMemFreeExtra(GpuContext *gcontext,
 	GPUCONTEXT_PUSH(gcontext);
 	if (extra == GPUMEM_DEVICE_RAW_EXTRA)
 		rc = cuMemFree(m_deviceptr);
+#if CUDA_VERSION >= 11020
+	else if (extra == GPUMEM_DEVICE_ASYNC_EXTRA)
+		rc = cuMemFreeAsync(m_deviceptr, CU_STREAM_PER_THREAD);
+#endif
 	else if (extra == GPUMEM_HOST_RAW_EXTRA)
 		rc = cuMemFreeHost((void *)m_deviceptr);
 	else
 		rc = gpuMemFreeChunk(gcontext, m_deviceptr, (GpuMemSegment *)extra);
 	GPUCONTEXT_POP(gcontext);
+	if (rc == CUDA_SUCCESS)
+		gpuMemNotifyRelease(gcontext->cuda_dindex);
 
 	return rc;
 }
@@ -277,9 +660,17 @@ __gpuMemAllocRaw(GpuContext *gcontext,
 {
 	CUdeviceptr	m_deviceptr;
 	CUresult	rc;
+	bool		release_requested = false;
 
 	GPUCONTEXT_PUSH(gcontext);
+retry:
 	rc = cuMemAlloc(&m_deviceptr, bytesize);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY && !release_requested)
+	{
+		release_requested = true;
+		if (gpuMemRequestRelease(gcontext))
+			goto retry;
+	}
 	if (rc != CUDA_SUCCESS)
 		wnotice("failed on cuMemAlloc(%zu): %s", bytesize, errorText(rc));
 	else if (!trackGpuMem(gcontext, m_deviceptr,
@@ -309,9 +700,17 @@ __gpuMemAllocManagedRaw(GpuContext *gcontext,
 {
 	CUdeviceptr	m_deviceptr;
 	CUresult	rc;
+	bool		release_requested = false;
 
 	GPUCONTEXT_PUSH(gcontext);
+retry:
 	rc = cuMemAllocManaged(&m_deviceptr, bytesize, flags);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY && !release_requested)
+	{
+		release_requested = true;
+		if (gpuMemRequestRelease(gcontext))
+			goto retry;
+	}
 	if (rc != CUDA_SUCCESS)
 		wnotice("failed on cuMemAllocManaged(%zu): %s",
 				bytesize, errorText(rc));
@@ -375,9 +774,17 @@ __gpuMemAllocDev(GpuContext *gcontext,
 {
 	CUdeviceptr	m_deviceptr;
 	CUresult	rc;
+	bool		release_requested = false;
 
 	GPUCONTEXT_PUSH(gcontext);
+retry:
 	rc = cuMemAlloc(&m_deviceptr, bytesize);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY && !release_requested)
+	{
+		release_requested = true;
+		if (gpuMemRequestRelease(gcontext))
+			goto retry;
+	}
 	if (rc != CUDA_SUCCESS)
 		wnotice("failed on cuMemAlloc(%zu): %s", bytesize, errorText(rc));
 	else
@@ -448,6 +855,41 @@ gpuMemSplitChunk(GpuMemSegment *gm_seg, cl_int mclass)
 	return true;
 }
 
+/*
+ * gpuMemSegmentSize - length of the new segment to be allocated
+ *
+ * I/O mapped and host memory segments are always gpu_memory_segment_size,
+ * because i/o mapping is expensive, and host segments are shared with the
+ * hostcache. Normal and managed memory segments start from
+ * gpu_memory_segment_min_size, then grow geometrically; a new segment is
+ * as large as the total of the existing ones, up to gpu_memory_segment_size.
+ * Once idle segments are reclaimed, the next one shrinks again.
+ */
+static size_t
+gpuMemSegmentSize(GpuMemKind gm_kind, dlist_head *gm_segment_list,
+				  cl_int mclass)
+{
+	GpuMemSegment  *gm_seg;
+	dlist_iter		iter;
+	size_t			total_sz = 0;
+	size_t			segment_sz;
+
+	if (gm_kind != GpuMemKind__NormalMemory &&
+		gm_kind != GpuMemKind__ManagedMemory)
+		return gm_segment_sz;
+
+	dlist_foreach(iter, gm_segment_list)
+	{
+		gm_seg = dlist_container(GpuMemSegment, chain, iter.cur);
+		total_sz += gm_seg->segment_sz;
+	}
+	segment_sz = Max(total_sz, gm_segment_min_sz);
+	segment_sz = Max(segment_sz, 1UL << mclass);
+	segment_sz = TYPEALIGN(GPUMEM_CHUNKSZ_MIN, segment_sz);
+
+	return Min(segment_sz, gm_segment_sz);
+}
+
 /*
  * gpuMemAllocChunk
  */
@@ -468,10 +910,12 @@ gpuMemAllocChunk(GpuMemKind gm_kind,
 	dlist_head	   *gm_segment_list;
 	CUresult		rc;
 	size_t			unitsz = GPUMEM_CHUNKSZ_MIN;
-	cl_int			nchunks = gm_segment_sz / unitsz;
+	size_t			segment_sz;
+	cl_int			nchunks;
 	cl_int			i, __mclass;
 	size_t			segment_usage;
 	bool			has_exclusive_lock = false;
+	bool			release_requested = false;
 
 	switch (gm_kind)
 	{
@@ -518,7 +962,8 @@ retry:
 			pthreadRWLockUnlock(&gcontext->gm_rwlock);
 			/* ok, found */
 			Assert(gm_chunk >= gm_seg->gm_chunks &&
-				   (gm_chunk - gm_seg->gm_chunks) < nchunks);
+				   (gm_chunk - gm_seg->gm_chunks) <
+				   gm_seg->segment_sz / unitsz);
 			i = gm_chunk - gm_seg->gm_chunks;
 			m_deviceptr = gm_seg->m_segment + i * unitsz;
 			if (!trackGpuMem(gcontext, m_deviceptr, gm_seg,
@@ -544,6 +989,8 @@ retry:
 	/*
 	 * allocation of a new segment
 	 */
+	segment_sz = gpuMemSegmentSize(gm_kind, gm_segment_list, mclass);
+	nchunks = segment_sz / unitsz;
 	gm_seg = calloc(1, offsetof(GpuMemSegment, gm_chunks[nchunks]));
 	if (!gm_seg)
 	{
@@ -563,25 +1010,36 @@ retry:
 	switch (gm_kind)
 	{
 		case GpuMemKind__NormalMemory:
-			rc = cuMemAlloc(&m_segment, gm_segment_sz);
-			//wnotice("normal m_segment = %p - %p by %s:%d", (void *)m_segment, (void *)(m_segment - gm_segment_sz), filename, lineno);
+			rc = cuMemAlloc(&m_segment, segment_sz);
+			//wnotice("normal m_segment = %p - %p by %s:%d", (void *)m_segment, (void *)(m_segment - segment_sz), filename, lineno);
 			break;
 
 		case GpuMemKind__ManagedMemory:
-			rc = cuMemAllocManaged(&m_segment, gm_segment_sz,
+			rc = cuMemAllocManaged(&m_segment, segment_sz,
 								   CU_MEM_ATTACH_GLOBAL);
-			//wnotice("managed m_segment = %p - %p", (void *)m_segment, (void *)(m_segment + gm_segment_sz));
+			//wnotice("managed m_segment = %p - %p", (void *)m_segment, (void *)(m_segment + segment_sz));
 			break;
 
 		case GpuMemKind__IOMapMemory:
-			rc = cuMemAlloc(&m_segment, gm_segment_sz);
-			if (rc == CUDA_SUCCESS)
+			rc = cuMemAlloc(&m_segment, segment_sz);
+			if (rc == CUDA_SUCCESS && nvme_strom_use_cufile())
+			{
+				/* no i/o map handle on cuFile, so device address instead */
+				if (cufileRegisterBuffer(m_segment, segment_sz))
+					gm_seg->iomap_handle = (unsigned long)m_segment;
+				else
+				{
+					cuMemFree(m_segment);
+					rc = CUDA_ERROR_MAP_FAILED;
+				}
+			}
+			else if (rc == CUDA_SUCCESS)
 			{
 				StromCmd__MapGpuMemory cmd;
 
 				memset(&cmd, 0, sizeof(StromCmd__MapGpuMemory));
 				cmd.vaddress = m_segment;
-				cmd.length = gm_segment_sz;
+				cmd.length = segment_sz;
 				if (nvme_strom_ioctl(STROM_IOCTL__MAP_GPU_MEMORY, &cmd) == 0)
 					gm_seg->iomap_handle = cmd.handle;
 				else
@@ -591,13 +1049,13 @@ retry:
 					rc = CUDA_ERROR_MAP_FAILED;
 				}
 			}
-			//wnotice("iomap m_segment = %p - %p", (void *)m_segment, (void *)(m_segment - gm_segment_sz));
+			//wnotice("iomap m_segment = %p - %p", (void *)m_segment, (void *)(m_segment - segment_sz));
 			break;
 
 		case GpuMemKind__HostMemory:
-			rc = cuMemHostAlloc((void **)&m_segment, gm_segment_sz,
-								CU_MEMHOSTALLOC_PORTABLE);
-			//wnotice("hostmem m_segment = %p - %p", (void *)m_segment, (void *)(m_segment - gm_segment_sz));
+			rc = gpuMemHostSegmentAlloc(gcontext, &m_segment,
+										&gm_seg->hostcache);
+			//wnotice("hostmem m_segment = %p - %p", (void *)m_segment, (void *)(m_segment - segment_sz));
 			break;
 
 		default:
@@ -610,11 +1068,28 @@ retry:
 	{
 		free(gm_seg);
 		pthreadRWLockUnlock(&gcontext->gm_rwlock);
+		/*
+		 * Device memory may be kept by idle segments of the concurrent
+		 * GpuContexts. Ask them to release, then retry once.
+		 */
+		if (rc == CUDA_ERROR_OUT_OF_MEMORY &&
+			gm_kind != GpuMemKind__HostMemory &&
+			!release_requested)
+		{
+			release_requested = true;
+			if (gpuMemRequestRelease(gcontext))
+			{
+				has_exclusive_lock = false;
+				pthreadRWLockReadLock(&gcontext->gm_rwlock);
+				goto retry;
+			}
+		}
 		return rc;
 	}
 	/* setup of GpuMemSegment */
 	gm_seg->gm_kind		= gm_kind;
 	gm_seg->m_segment	= m_segment;
+	gm_seg->segment_sz	= segment_sz;
 	SpinLockInit(&gm_seg->lock);
 	pg_atomic_init_u32(&gm_seg->num_active_chunks, 0);
 	for (i=0; i <= GPUMEM_CHUNKSZ_MAX_BIT; i++)
@@ -622,10 +1097,10 @@ retry:
 
 	__mclass = GPUMEM_CHUNKSZ_MAX_BIT;
 	segment_usage = 0;
-	while (segment_usage < gm_segment_sz &&
+	while (segment_usage < segment_sz &&
 		   __mclass >= GPUMEM_CHUNKSZ_MIN_BIT)
 	{
-		if (segment_usage + (1UL << __mclass) > gm_segment_sz)
+		if (segment_usage + (1UL << __mclass) > segment_sz)
 			__mclass--;
 		else
 		{
@@ -638,7 +1113,7 @@ retry:
 			segment_usage += (1UL << __mclass);
 		}
 	}
-	Assert(segment_usage == gm_segment_sz);
+	Assert(segment_usage == segment_sz);
 	dlist_push_head(gm_segment_list, &gm_seg->chain);
 
 	/* update statistics */
@@ -646,17 +1121,19 @@ retry:
 	switch (gm_kind)
 	{
 		case GpuMemKind__NormalMemory:
-			pg_atomic_add_fetch_u64(&gm_stat->normal_usage, gm_segment_sz);
+			pg_atomic_add_fetch_u64(&gm_stat->normal_usage, segment_sz);
 			break;
 		case GpuMemKind__ManagedMemory:
-			pg_atomic_add_fetch_u64(&gm_stat->managed_usage, gm_segment_sz);
+			pg_atomic_add_fetch_u64(&gm_stat->managed_usage, segment_sz);
 			break;
 		case GpuMemKind__IOMapMemory:
-			pg_atomic_add_fetch_u64(&gm_stat->iomap_usage, gm_segment_sz);
+			pg_atomic_add_fetch_u64(&gm_stat->iomap_usage, segment_sz);
 			break;
 		default:
 			break;
 	}
+	gpuMemActivityAccount(gcontext, gm_kind, segment_sz);
+	__gpuMemUpdatePeakUsage(gm_stat);
 	goto retry;
 }
 
@@ -684,6 +1161,76 @@ __gpuMemAlloc(GpuContext *gcontext,
 							filename, lineno);
 }
 
+/*
+ * gpuMemAllocAsync
+ *
+ * It allocates device memory from the stream-ordered memory pool of the
+ * GpuContext, if available. It does not synchronize the device, and its
+ * release by gpuMemFree() is also ordered on the per-thread default stream,
+ * so it is suitable for short-lived buffers per GpuTask. Caller must not
+ * touch the buffer out of the 'cuda_stream' ordering, like DMA by NVMe-Strom.
+ * If memory pool is not available, it falls back to gpuMemAlloc().
+ */
+CUresult
+__gpuMemAllocAsync(GpuContext *gcontext,
+				   CUdeviceptr *p_deviceptr,
+				   size_t bytesize,
+				   CUstream cuda_stream,
+				   const char *filename, int lineno)
+{
+#if CUDA_VERSION >= 11020
+	CUdeviceptr	m_deviceptr;
+	CUresult	rc;
+	bool		pool_trimmed = false;
+	bool		release_requested = false;
+
+	if (!gcontext->gm_mempool)
+		return __gpuMemAlloc(gcontext, p_deviceptr, bytesize,
+							 filename, lineno);
+	GPUCONTEXT_PUSH(gcontext);
+retry:
+	rc = cuMemAllocFromPoolAsync(&m_deviceptr, bytesize,
+								 gcontext->gm_mempool,
+								 cuda_stream);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+	{
+		/* release the memory cached by the pool first, then peers */
+		if (!pool_trimmed)
+		{
+			pool_trimmed = true;
+			if (cuMemPoolTrimTo(gcontext->gm_mempool, 0) == CUDA_SUCCESS)
+				goto retry;
+		}
+		if (!release_requested)
+		{
+			release_requested = true;
+			if (gpuMemRequestRelease(gcontext))
+				goto retry;
+		}
+	}
+	if (rc == CUDA_SUCCESS)
+	{
+		if (!trackGpuMem(gcontext, m_deviceptr,
+						 GPUMEM_DEVICE_ASYNC_EXTRA,
+						 filename, lineno))
+		{
+			cuMemFreeAsync(m_deviceptr, cuda_stream);
+			rc = CUDA_ERROR_OUT_OF_MEMORY;
+		}
+		else
+		{
+			*p_deviceptr = m_deviceptr;
+		}
+	}
+	GPUCONTEXT_POP(gcontext);
+
+	return rc;
+#else
+	return __gpuMemAlloc(gcontext, p_deviceptr, bytesize,
+						 filename, lineno);
+#endif
+}
+
 /*
  * gpuMemAllocIOMap
  */
@@ -776,7 +1323,8 @@ __gpuMemAllocHost(GpuContext *gcontext,
 static CUresult
 __gpuMemPreservedRequest(cl_int cuda_dindex,
 						 CUipcMemHandle *m_handle,
-						 ssize_t bytesize)
+						 ssize_t bytesize,
+						 bool evictable)
 {
 	GpuMemPreservedRequest *gmemp_req = NULL;
 	dlist_node	   *dnode;
@@ -810,6 +1358,8 @@ __gpuMemPreservedRequest(cl_int cuda_dindex,
 		memset(&gmemp_req->m_handle, 0, sizeof(CUipcMemHandle));
 	gmemp_req->cuda_dindex = cuda_dindex;
 	gmemp_req->bytesize = bytesize;
+	gmemp_req->evictable = evictable;
+	gmemp_req->quota = (size_t)preserved_gpu_memory_quota_mb << 20;
 
 	dlist_push_tail(&gmemp_head->gmemp_req_pending_list,
 					&gmemp_req->chain);
@@ -871,7 +1421,28 @@ __gpuMemAllocPreserved(cl_int cuda_dindex,
 	Assert(bytesize > 0);
 	return __gpuMemPreservedRequest(cuda_dindex,
 									ipc_mhandle,
-									bytesize);
+									bytesize,
+									false);
+}
+
+/*
+ * __gpuMemAllocPreservedEvictable
+ *
+ * It allocates preserved device memory that the keeper can release when it
+ * is not referenced by anybody. The caller holds a reference on the new
+ * memory, to be released by gpuMemPreservedPut().
+ */
+CUresult
+__gpuMemAllocPreservedEvictable(cl_int cuda_dindex,
+								CUipcMemHandle *ipc_mhandle,
+								ssize_t bytesize,
+								const char *filename, int lineno)
+{
+	Assert(bytesize > 0);
+	return __gpuMemPreservedRequest(cuda_dindex,
+									ipc_mhandle,
+									bytesize,
+									true);
 }
 
 /*
@@ -881,36 +1452,178 @@ CUresult
 gpuMemFreePreserved(cl_int cuda_dindex,
 					CUipcMemHandle m_handle)
 {
-	return __gpuMemPreservedRequest(cuda_dindex, &m_handle, 0);
+	return __gpuMemPreservedRequest(cuda_dindex, &m_handle, 0, false);
 }
 
 /*
- * gpuMemReclaimSegment - release a free segment if any
+ * __lookupGpuMemPreserved
+ *
+ * NOTE: caller must hold gmemp_head->lock
  */
-void
-gpuMemReclaimSegment(GpuContext *gcontext)
+static GpuMemPreserved *
+__lookupGpuMemPreserved(cl_int cuda_dindex, CUipcMemHandle *m_handle)
 {
-	dlist_head	   *dhead_n = &gcontext->gm_normal_list;
-	dlist_head	   *dhead_i = &gcontext->gm_iomap_list;
-	dlist_head	   *dhead_m = &gcontext->gm_managed_list;
-	dlist_head	   *dhead_h = &gcontext->gm_hostmem_list;
-	dlist_node	   *dnode_n = NULL;
-	dlist_node	   *dnode_i = NULL;
-	dlist_node	   *dnode_m = NULL;
-	dlist_node	   *dnode_h = NULL;
-	GpuMemSegment  *gm_seg;
-	CUresult		rc;
+	dlist_iter	iter;
+	pg_crc32	crc;
+	int			i;
 
-	pthreadRWLockWriteLock(&gcontext->gm_rwlock);
-	if (!dlist_is_empty(dhead_n))
-		dnode_n = dlist_tail_node(dhead_n);
-	if (!dlist_is_empty(dhead_i))
-		dnode_i = dlist_tail_node(dhead_i);
+	INIT_LEGACY_CRC32(crc);
+	COMP_LEGACY_CRC32(crc, &cuda_dindex, sizeof(cl_int));
+	COMP_LEGACY_CRC32(crc, m_handle, sizeof(CUipcMemHandle));
+	FIN_LEGACY_CRC32(crc);
+
+	i = crc % GPUMEM_PRESERVED_HASH_NSLOTS;
+	dlist_foreach(iter, &gmemp_head->gmemp_active_list[i])
+	{
+		GpuMemPreserved *gmemp = dlist_container(GpuMemPreserved,
+												 chain, iter.cur);
+		if (gmemp->cuda_dindex == cuda_dindex &&
+			memcmp(&gmemp->m_handle, m_handle,
+				   sizeof(CUipcMemHandle)) == 0)
+			return gmemp;
+	}
+	return NULL;
+}
+
+/*
+ * gpuMemPreservedGet
+ *
+ * It acquires a reference on the preserved device memory, to prevent
+ * eviction by the keeper. It returns false if the preserved device memory
+ * is already gone.
+ */
+bool
+gpuMemPreservedGet(cl_int cuda_dindex, CUipcMemHandle m_handle)
+{
+	GpuMemPreserved *gmemp;
+
+	SpinLockAcquire(&gmemp_head->lock);
+	gmemp = __lookupGpuMemPreserved(cuda_dindex, &m_handle);
+	if (gmemp)
+	{
+		gmemp->refcnt++;
+		gmemp->atime = GetCurrentTimestamp();
+	}
+	SpinLockRelease(&gmemp_head->lock);
+
+	return (gmemp != NULL);
+}
+
+/*
+ * gpuMemPreservedPut
+ *
+ * It releases the reference acquired by gpuMemPreservedGet() or
+ * gpuMemAllocPreservedEvictable().
+ */
+void
+gpuMemPreservedPut(cl_int cuda_dindex, CUipcMemHandle m_handle)
+{
+	GpuMemPreserved *gmemp;
+
+	SpinLockAcquire(&gmemp_head->lock);
+	gmemp = __lookupGpuMemPreserved(cuda_dindex, &m_handle);
+	if (gmemp)
+	{
+		Assert(gmemp->refcnt > 0);
+		gmemp->refcnt--;
+		gmemp->atime = GetCurrentTimestamp();
+	}
+	SpinLockRelease(&gmemp_head->lock);
+}
+
+/*
+ * gpuMemActivitySnapshot - export the occupancy of the free-lists
+ *
+ * It counts the free chunks of all the segments per class, for the
+ * fragmentation statistics of pgstrom.gpu_activity.
+ */
+static void
+gpuMemActivitySnapshot(GpuContext *gcontext)
+{
+	GpuContextActivity *activity = gcontext->activity;
+	dlist_head	   *dheads[4];
+	GpuMemSegment  *gm_seg;
+	dlist_iter		iter1;
+	dlist_iter		iter2;
+	cl_uint			nsegments = 0;
+	cl_ulong		free_sz = 0;
+	cl_uint			free_chunks[GPUCTX_ACTIVITY_MEM_NCLASSES];
+	int				i, j;
+
+	StaticAssertStmt(GPUCTX_ACTIVITY_MEM_NCLASSES ==
+					 GPUMEM_CHUNKSZ_MAX_BIT - GPUMEM_CHUNKSZ_MIN_BIT + 1,
+					 "GPUCTX_ACTIVITY_MEM_NCLASSES mismatch");
+	memset(free_chunks, 0, sizeof(free_chunks));
+	dheads[0] = &gcontext->gm_normal_list;
+	dheads[1] = &gcontext->gm_iomap_list;
+	dheads[2] = &gcontext->gm_managed_list;
+	dheads[3] = &gcontext->gm_hostmem_list;
+
+	pthreadRWLockReadLock(&gcontext->gm_rwlock);
+	for (i=0; i < lengthof(dheads); i++)
+	{
+		dlist_foreach(iter1, dheads[i])
+		{
+			gm_seg = dlist_container(GpuMemSegment, chain, iter1.cur);
+			SpinLockAcquire(&gm_seg->lock);
+			for (j=GPUMEM_CHUNKSZ_MIN_BIT; j <= GPUMEM_CHUNKSZ_MAX_BIT; j++)
+			{
+				dlist_foreach(iter2, &gm_seg->free_chunks[j])
+				{
+					free_chunks[j - GPUMEM_CHUNKSZ_MIN_BIT]++;
+					free_sz += (1UL << j);
+				}
+			}
+			SpinLockRelease(&gm_seg->lock);
+			nsegments++;
+		}
+	}
+	pthreadRWLockUnlock(&gcontext->gm_rwlock);
+
+	pg_atomic_write_u32(&activity->mem_segments, nsegments);
+	pg_atomic_write_u64(&activity->mem_free, free_sz);
+	for (i=0; i < GPUCTX_ACTIVITY_MEM_NCLASSES; i++)
+		pg_atomic_write_u32(&activity->mem_free_chunks[i], free_chunks[i]);
+}
+
+/*
+ * gpuMemReclaimSegment - release a free segment if any
+ *
+ * On the regular timeout, it releases at most one idle segment of the
+ * device memory per invocation, for gradual shrink. If 'urgent', it releases
+ * all the idle segments at once because a concurrent backend is waiting for
+ * the device memory. It returns true if any segment was released.
+ */
+bool
+gpuMemReclaimSegment(GpuContext *gcontext, bool urgent)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[gcontext->cuda_dindex];
+	dlist_head	   *dhead_n = &gcontext->gm_normal_list;
+	dlist_head	   *dhead_i = &gcontext->gm_iomap_list;
+	dlist_head	   *dhead_m = &gcontext->gm_managed_list;
+	dlist_head	   *dhead_h = &gcontext->gm_hostmem_list;
+	dlist_node	   *dnode_n = NULL;
+	dlist_node	   *dnode_i = NULL;
+	dlist_node	   *dnode_m = NULL;
+	dlist_node	   *dnode_h = NULL;
+	GpuMemSegment  *gm_seg;
+	CUresult		rc;
+	bool			device_released = false;
+	bool			any_released = false;
+
+	/* recycled PDS buffers keep the segments active */
+	PDS_flush_recycled(gcontext);
+
+	pthreadRWLockWriteLock(&gcontext->gm_rwlock);
+	if (!dlist_is_empty(dhead_n))
+		dnode_n = dlist_tail_node(dhead_n);
+	if (!dlist_is_empty(dhead_i))
+		dnode_i = dlist_tail_node(dhead_i);
 	if (!dlist_is_empty(dhead_m))
 		dnode_m = dlist_tail_node(dhead_m);
 	if (!dlist_is_empty(dhead_h))
 		dnode_h = dlist_tail_node(dhead_h);
-	while (dnode_n || dnode_i)
+	while (dnode_n || dnode_i || dnode_m || dnode_h)
 	{
 		if (dnode_n)
 		{
@@ -929,10 +1642,16 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 					werror("failed on cuMemFree: %s", errorText(rc));
 				}
 				dlist_delete(&gm_seg->chain);
+				pg_atomic_sub_fetch_u64(&gm_stat->normal_usage,
+										gm_seg->segment_sz);
+				gpuMemActivityAccount(gcontext, GpuMemKind__NormalMemory,
+									  -(int64) gm_seg->segment_sz);
 				free(gm_seg);
-				break;
+				device_released = true;
+				if (!urgent)
+					break;
 			}
-					}
+		}
 
 		if (dnode_i)
 		{
@@ -943,7 +1662,9 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 				dnode_i = NULL;
 			Assert(gm_seg->gm_kind == GpuMemKind__IOMapMemory);
 			if (pg_atomic_read_u32(&gm_seg->num_active_chunks) == 0)
-            {
+			{
+				if (nvme_strom_use_cufile())
+					cufileUnregisterBuffer(gm_seg->m_segment);
 				rc = cuMemFree(gm_seg->m_segment);
 				if (rc != CUDA_SUCCESS)
 				{
@@ -951,8 +1672,14 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 					werror("failed on cuMemFree: %s", errorText(rc));
 				}
 				dlist_delete(&gm_seg->chain);
+				pg_atomic_sub_fetch_u64(&gm_stat->iomap_usage,
+										gm_seg->segment_sz);
+				gpuMemActivityAccount(gcontext, GpuMemKind__IOMapMemory,
+									  -(int64) gm_seg->segment_sz);
 				free(gm_seg);
-				break;
+				device_released = true;
+				if (!urgent)
+					break;
 			}
 		}
 
@@ -973,7 +1700,12 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 					werror("failed on cuMemFree: %s", errorText(rc));
 				}
 				dlist_delete(&gm_seg->chain);
+				pg_atomic_sub_fetch_u64(&gm_stat->managed_usage,
+										gm_seg->segment_sz);
+				gpuMemActivityAccount(gcontext, GpuMemKind__ManagedMemory,
+									  -(int64) gm_seg->segment_sz);
 				free(gm_seg);
+				device_released = true;
 			}
 		}
 		if (dnode_h)
@@ -986,18 +1718,39 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 			Assert(gm_seg->gm_kind == GpuMemKind__HostMemory);
 			if (pg_atomic_read_u32(&gm_seg->num_active_chunks) == 0)
 			{
-				rc = cuMemFreeHost((void *)gm_seg->m_segment);
+				if (gm_seg->hostcache)
+					rc = gpuMemHostSegmentRelease(gm_seg->m_segment);
+				else
+					rc = cuMemFreeHost((void *)gm_seg->m_segment);
 				if (rc != CUDA_SUCCESS)
 				{
 					pthreadRWLockUnlock(&gcontext->gm_rwlock);
 					werror("failed on cuMemFreeHost: %s", errorText(rc));
 				}
 				dlist_delete(&gm_seg->chain);
+				gpuMemActivityAccount(gcontext, GpuMemKind__HostMemory,
+									  -(int64) gm_seg->segment_sz);
 				free(gm_seg);
+				any_released = true;
 			}
 		}
 	}
 	pthreadRWLockUnlock(&gcontext->gm_rwlock);
+
+#if CUDA_VERSION >= 11020
+	/* unused memory cached by the pool is also released on urgent */
+	if (urgent && gcontext->gm_mempool)
+	{
+		rc = cuMemPoolTrimTo(gcontext->gm_mempool, 0);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPoolTrimTo: %s", errorText(rc));
+		device_released = true;
+	}
+#endif
+	if (device_released)
+		gpuMemNotifyRelease(gcontext->cuda_dindex);
+	gpuMemActivitySnapshot(gcontext);
+	return (device_released || any_released);
 }
 
 /*
@@ -1011,6 +1764,209 @@ pgstrom_gpu_mmgr_init_gpucontext(GpuContext *gcontext)
 	dlist_init(&gcontext->gm_iomap_list);
 	dlist_init(&gcontext->gm_managed_list);
 	dlist_init(&gcontext->gm_hostmem_list);
+#if CUDA_VERSION >= 11020
+	gcontext->gm_mempool = NULL;
+#endif
+	SpinLockInit(&gcontext->pds_recycle_lock);
+	gcontext->pds_recycle_nitems = 0;
+}
+
+/*
+ * pgstrom_gpu_mmgr_init_mempool - setup of the stream-ordered memory pool
+ *
+ * NOTE: It shall be called just after the CUDA context creation.
+ */
+void
+pgstrom_gpu_mmgr_init_mempool(GpuContext *gcontext)
+{
+#if CUDA_VERSION >= 11020
+	DevAttributes  *dattrs = &devAttrs[gcontext->cuda_dindex];
+	CUmemPoolProps	props;
+	CUmemoryPool	mempool;
+	cuuint64_t		threshold = gm_segment_sz;
+	CUresult		rc;
+
+	gcontext->gm_mempool = NULL;
+	if (!gpu_memory_pool_enabled || !dattrs->MEMORY_POOLS_SUPPORTED)
+		return;
+
+	memset(&props, 0, sizeof(CUmemPoolProps));
+	props.allocType = CU_MEM_ALLOCATION_TYPE_PINNED;
+	props.handleTypes = CU_MEM_HANDLE_TYPE_NONE;
+	props.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+	props.location.id = dattrs->DEV_ID;
+	rc = cuMemPoolCreate(&mempool, &props);
+	if (rc != CUDA_SUCCESS)
+	{
+		wnotice("failed on cuMemPoolCreate: %s", errorText(rc));
+		return;
+	}
+	/* keep a segment size of unused memory, not to release on every sync */
+	rc = cuMemPoolSetAttribute(mempool,
+							   CU_MEMPOOL_ATTR_RELEASE_THRESHOLD,
+							   &threshold);
+	if (rc != CUDA_SUCCESS)
+	{
+		wnotice("failed on cuMemPoolSetAttribute: %s", errorText(rc));
+		cuMemPoolDestroy(mempool);
+		return;
+	}
+	gcontext->gm_mempool = mempool;
+#endif
+}
+
+/*
+ * pgstrom_gpu_mmgr_release_mempool - release of the memory pool
+ *
+ * NOTE: Unlike the segments, memory pool is not owned by the CUDA context,
+ * so it shall be called before cuCtxDestroy().
+ */
+void
+pgstrom_gpu_mmgr_release_mempool(GpuContext *gcontext, bool normal_exit)
+{
+#if CUDA_VERSION >= 11020
+	CUdeviceptr	m_deviceptr;
+	const char *filename;
+	int			lineno;
+	CUresult	rc;
+
+	if (!gcontext->gm_mempool)
+		return;
+	GPUCONTEXT_PUSH(gcontext);
+	while ((m_deviceptr = untrackGpuMemByExtra(gcontext,
+											   GPUMEM_DEVICE_ASYNC_EXTRA,
+											   &filename,
+											   &lineno)) != 0UL)
+	{
+		if (normal_exit)
+			wnotice("GPU memory %p by (%s:%d) likely leaked",
+					(void *)m_deviceptr, __basename(filename), lineno);
+		rc = cuMemFree(m_deviceptr);
+		if (rc != CUDA_SUCCESS)
+			wnotice("failed on cuMemFree: %s", errorText(rc));
+	}
+	rc = cuMemPoolDestroy(gcontext->gm_mempool);
+	if (rc != CUDA_SUCCESS)
+		wnotice("failed on cuMemPoolDestroy: %s", errorText(rc));
+	gcontext->gm_mempool = NULL;
+	GPUCONTEXT_POP(gcontext);
+#endif
+}
+
+/*
+ * pgstrom_gpu_mmgr_unregister_iomap - unregister i/o mapped segments
+ * from GPUDirect Storage
+ *
+ * NOTE: segments are released with CUDA context, however, the buffers
+ * registered to cuFile shall be unregistered before cuCtxDestroy().
+ */
+void
+pgstrom_gpu_mmgr_unregister_iomap(GpuContext *gcontext)
+{
+	GpuMemSegment  *gm_seg;
+	dlist_iter		iter;
+
+	if (!nvme_strom_use_cufile() || dlist_is_empty(&gcontext->gm_iomap_list))
+		return;
+	GPUCONTEXT_PUSH(gcontext);
+	dlist_foreach(iter, &gcontext->gm_iomap_list)
+	{
+		gm_seg = dlist_container(GpuMemSegment, chain, iter.cur);
+		if (gm_seg->iomap_handle != 0UL)
+		{
+			cufileUnregisterBuffer(gm_seg->m_segment);
+			gm_seg->iomap_handle = 0UL;
+		}
+	}
+	GPUCONTEXT_POP(gcontext);
+}
+
+/*
+ * pgstrom_gpu_mmgr_release_segments - release segments explicitly
+ *
+ * It releases the segments owned by the CUDA context, to keep the CUDA
+ * context alive for the next GpuContext. It returns false if any segment
+ * still has active chunks, or fails to release, then caller must destroy
+ * the CUDA context instead. Caller must set the CUDA context current.
+ */
+bool
+pgstrom_gpu_mmgr_release_segments(GpuContext *gcontext)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[gcontext->cuda_dindex];
+	dlist_head	   *dheads[4];
+	dlist_iter		iter;
+	dlist_mutable_iter miter;
+	GpuMemSegment  *gm_seg;
+	CUresult		rc;
+	bool			retval = true;
+	int				i;
+
+	dheads[0] = &gcontext->gm_normal_list;
+	dheads[1] = &gcontext->gm_iomap_list;
+	dheads[2] = &gcontext->gm_managed_list;
+	dheads[3] = &gcontext->gm_hostmem_list;
+	for (i=0; i < lengthof(dheads); i++)
+	{
+		dlist_foreach(iter, dheads[i])
+		{
+			gm_seg = dlist_container(GpuMemSegment, chain, iter.cur);
+			if (pg_atomic_read_u32(&gm_seg->num_active_chunks) != 0)
+				return false;
+		}
+	}
+
+	for (i=0; i < lengthof(dheads); i++)
+	{
+		dlist_foreach_modify(miter, dheads[i])
+		{
+			gm_seg = dlist_container(GpuMemSegment, chain, miter.cur);
+			switch (gm_seg->gm_kind)
+			{
+				case GpuMemKind__HostMemory:
+					/* hostcache segments are cleaned up later */
+					if (gm_seg->hostcache)
+						continue;
+					rc = cuMemFreeHost((void *)gm_seg->m_segment);
+					break;
+				case GpuMemKind__IOMapMemory:
+					if (nvme_strom_use_cufile())
+						cufileUnregisterBuffer(gm_seg->m_segment);
+					rc = cuMemFree(gm_seg->m_segment);
+					break;
+				default:
+					rc = cuMemFree(gm_seg->m_segment);
+					break;
+			}
+			if (rc != CUDA_SUCCESS)
+			{
+				wnotice("failed on release of segment: %s", errorText(rc));
+				retval = false;
+				continue;
+			}
+			dlist_delete(&gm_seg->chain);
+			switch (gm_seg->gm_kind)
+			{
+				case GpuMemKind__NormalMemory:
+					pg_atomic_sub_fetch_u64(&gm_stat->normal_usage,
+											gm_seg->segment_sz);
+					break;
+				case GpuMemKind__IOMapMemory:
+					pg_atomic_sub_fetch_u64(&gm_stat->iomap_usage,
+											gm_seg->segment_sz);
+					break;
+				case GpuMemKind__ManagedMemory:
+					pg_atomic_sub_fetch_u64(&gm_stat->managed_usage,
+											gm_seg->segment_sz);
+					break;
+				default:
+					break;
+			}
+			gpuMemActivityAccount(gcontext, gm_seg->gm_kind,
+								  -(int64) gm_seg->segment_sz);
+			free(gm_seg);
+		}
+	}
+	return retval;
 }
 
 /*
@@ -1033,7 +1989,7 @@ pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext)
 	{
 		dnode = dlist_pop_head_node(&gcontext->gm_normal_list);
 		gm_seg = dlist_container(GpuMemSegment, chain, dnode);
-		pg_atomic_sub_fetch_u64(&gm_stat->normal_usage, gm_segment_sz);
+		pg_atomic_sub_fetch_u64(&gm_stat->normal_usage, gm_seg->segment_sz);
 		free(gm_seg);
 	}
 
@@ -1041,7 +1997,7 @@ pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext)
 	{
 		dnode = dlist_pop_head_node(&gcontext->gm_managed_list);
 		gm_seg = dlist_container(GpuMemSegment, chain, dnode);
-		pg_atomic_sub_fetch_u64(&gm_stat->managed_usage, gm_segment_sz);
+		pg_atomic_sub_fetch_u64(&gm_stat->managed_usage, gm_seg->segment_sz);
 		free(gm_seg);
 	}
 
@@ -1049,7 +2005,7 @@ pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext)
 	{
 		dnode = dlist_pop_head_node(&gcontext->gm_iomap_list);
 		gm_seg = dlist_container(GpuMemSegment, chain, dnode);
-		pg_atomic_sub_fetch_u64(&gm_stat->iomap_usage, gm_segment_sz);
+		pg_atomic_sub_fetch_u64(&gm_stat->iomap_usage, gm_seg->segment_sz);
 		free(gm_seg);
 	}
 
@@ -1057,8 +2013,126 @@ pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext)
 	{
 		dnode = dlist_pop_head_node(&gcontext->gm_hostmem_list);
 		gm_seg = dlist_container(GpuMemSegment, chain, dnode);
+		/*
+		 * Host segments in the hostcache survive the CUDA context, so
+		 * we can reuse them for the next GpuContext. Elsewhere, segments
+		 * with leaked chunks shall be released, because someone may still
+		 * reference the chunks.
+		 */
+		if (gm_seg->hostcache)
+		{
+			CUresult	rc;
+
+			if (pg_atomic_read_u32(&gm_seg->num_active_chunks) == 0)
+				rc = gpuMemHostSegmentRelease(gm_seg->m_segment);
+			else
+			{
+				rc = cuCtxPushCurrent(gm_hostcache_context);
+				if (rc == CUDA_SUCCESS)
+				{
+					rc = cuMemFreeHost((void *)gm_seg->m_segment);
+					cuCtxPopCurrent(NULL);
+				}
+			}
+			if (rc != CUDA_SUCCESS)
+				wnotice("failed on release of pinned host segment: %s",
+						errorText(rc));
+		}
 		free(gm_seg);
 	}
+	/* device memory is released by cuCtxDestroy() */
+	gpuMemNotifyRelease(gcontext->cuda_dindex);
+}
+
+/*
+ * __gpummgrReleasePreserved
+ */
+static CUresult
+__gpummgrReleasePreserved(GpuMemPreserved *gmemp)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[gmemp->cuda_dindex];
+	CUresult	rc;
+
+	rc = cuMemFree(gmemp->m_devptr);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuMemFree: %s", errorText(rc));
+	if (gmemp->evictable)
+		pg_atomic_sub_fetch_u64(&gm_stat->preserved_evictable,
+								gmemp->bytesize);
+	dlist_delete(&gmemp->chain);
+	memset(gmemp, 0, sizeof(GpuMemPreserved));
+	dlist_push_head(&gmemp_head->gmemp_free_list,
+					&gmemp->chain);
+	return rc;
+}
+
+/*
+ * gpummgrEvictPreserved
+ *
+ * It releases the evictable preserved memory not referenced by anybody, in
+ * LRU order, until @required bytes are released. If @cuda_dindex < 0 or
+ * @owner is invalid, it does not care about the device or the owner.
+ * It returns the total length of the released memory.
+ */
+static size_t
+gpummgrEvictPreserved(cl_int cuda_dindex, Oid owner, size_t required)
+{
+	size_t		total = 0;
+	dlist_iter	iter;
+	int			i;
+
+	while (total < required)
+	{
+		GpuMemPreserved *victim = NULL;
+
+		for (i=0; i < GPUMEM_PRESERVED_HASH_NSLOTS; i++)
+		{
+			dlist_foreach(iter, &gmemp_head->gmemp_active_list[i])
+			{
+				GpuMemPreserved *gmemp = dlist_container(GpuMemPreserved,
+														 chain, iter.cur);
+				if (!gmemp->evictable || gmemp->refcnt > 0)
+					continue;
+				if (cuda_dindex >= 0 && gmemp->cuda_dindex != cuda_dindex)
+					continue;
+				if (OidIsValid(owner) && gmemp->owner != owner)
+					continue;
+				if (!victim || gmemp->atime < victim->atime)
+					victim = gmemp;
+			}
+		}
+		if (!victim)
+			break;
+		elog(LOG, "evict: preserved memory %zu bytes at %p",
+			 victim->bytesize, (void *)victim->m_devptr);
+		total += victim->bytesize;
+		__gpummgrReleasePreserved(victim);
+	}
+	return total;
+}
+
+/*
+ * gpummgrPreservedUsage - total length of the preserved memory by @owner
+ */
+static size_t
+gpummgrPreservedUsage(cl_int cuda_dindex, Oid owner)
+{
+	size_t		total = 0;
+	dlist_iter	iter;
+	int			i;
+
+	for (i=0; i < GPUMEM_PRESERVED_HASH_NSLOTS; i++)
+	{
+		dlist_foreach(iter, &gmemp_head->gmemp_active_list[i])
+		{
+			GpuMemPreserved *gmemp = dlist_container(GpuMemPreserved,
+													 chain, iter.cur);
+			if (gmemp->cuda_dindex == cuda_dindex &&
+				gmemp->owner == owner)
+				total += gmemp->bytesize;
+		}
+	}
+	return total;
 }
 
 /*
@@ -1075,7 +2149,28 @@ gpummgrHandleAllocPreserved(GpuMemPreservedRequest *gmemp_req)
 	pg_crc32		crc;
 	int				i;
 
-	if (dlist_is_empty(&gmemp_head->gmemp_free_list))
+	/* quota of the owner (per device) */
+	if (gmemp_req->quota > 0)
+	{
+		size_t	usage = gpummgrPreservedUsage(gmemp_req->cuda_dindex,
+											  gmemp_req->owner);
+		if (gmemp_req->bytesize > gmemp_req->quota)
+			return CUDA_ERROR_OUT_OF_MEMORY;
+		if (usage + gmemp_req->bytesize > gmemp_req->quota)
+			usage -= gpummgrEvictPreserved(gmemp_req->cuda_dindex,
+										   gmemp_req->owner,
+										   usage + gmemp_req->bytesize -
+										   gmemp_req->quota);
+		if (usage + gmemp_req->bytesize > gmemp_req->quota)
+		{
+			elog(LOG, "preserved memory of role %u exceeds the quota",
+				 gmemp_req->owner);
+			return CUDA_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	if (dlist_is_empty(&gmemp_head->gmemp_free_list) &&
+		gpummgrEvictPreserved(-1, InvalidOid, 1) == 0)
 		return CUDA_ERROR_OUT_OF_MEMORY;
 
 	dnode = dlist_pop_head_node(&gmemp_head->gmemp_free_list);
@@ -1089,10 +2184,18 @@ gpummgrHandleAllocPreserved(GpuMemPreservedRequest *gmemp_req)
 		goto error_1;
 	}
 
-	rc = cuMemAlloc(&m_devptr, gmemp_req->bytesize);
-	if (rc != CUDA_SUCCESS)
+	for (;;)
 	{
+		rc = cuMemAlloc(&m_devptr, gmemp_req->bytesize);
+		if (rc == CUDA_SUCCESS)
+			break;
+		if (rc == CUDA_ERROR_OUT_OF_MEMORY &&
+			gpummgrEvictPreserved(gmemp_req->cuda_dindex,
+								  InvalidOid,
+								  gmemp_req->bytesize) > 0)
+			continue;
 		elog(WARNING, "failed on cuMemAlloc: %s", errorText(rc));
+		cuCtxPopCurrent(NULL);
 		goto error_1;
 	}
 
@@ -1116,7 +2219,17 @@ gpummgrHandleAllocPreserved(GpuMemPreservedRequest *gmemp_req)
 	gmemp->m_devptr	= m_devptr;
 	memcpy(&gmemp->m_handle, &m_handle, sizeof(CUipcMemHandle));
 	gmemp->owner = gmemp_req->owner;
+	gmemp->evictable = gmemp_req->evictable;
+	gmemp->refcnt = (gmemp_req->evictable ? 1 : 0);
 	gmemp->ctime = GetCurrentTimestamp();
+	gmemp->atime = gmemp->ctime;
+	if (gmemp->evictable)
+	{
+		GpuMemStatistics *gm_stat = &gm_stat_array[gmemp->cuda_dindex];
+
+		pg_atomic_add_fetch_u64(&gm_stat->preserved_evictable,
+								gmemp->bytesize);
+	}
 
 	INIT_LEGACY_CRC32(crc);
 	COMP_LEGACY_CRC32(crc, &gmemp_req->cuda_dindex, sizeof(cl_int));
@@ -1146,46 +2259,15 @@ error_1:
 static CUresult
 gpummgrHandleFreePreserved(GpuMemPreservedRequest *gmemp_req)
 {
-	GpuMemPreserved *gmemp = NULL;
-	dlist_iter	iter;
-	pg_crc32	crc;
-	int			i;
-	CUresult	rc, result = CUDA_SUCCESS;
-
-	INIT_LEGACY_CRC32(crc);
-	COMP_LEGACY_CRC32(crc, &gmemp_req->cuda_dindex, sizeof(cl_int));
-	COMP_LEGACY_CRC32(crc, &gmemp_req->m_handle, sizeof(CUipcMemHandle));
-	FIN_LEGACY_CRC32(crc);
+	GpuMemPreserved *gmemp;
 
-	i = crc % GPUMEM_PRESERVED_HASH_NSLOTS;
-	dlist_foreach(iter, &gmemp_head->gmemp_active_list[i])
-	{
-		GpuMemPreserved *temp = dlist_container(GpuMemPreserved,
-												chain, iter.cur);
-		if (temp->cuda_dindex == gmemp_req->cuda_dindex &&
-			memcmp(&temp->m_handle, &gmemp_req->m_handle,
-				   sizeof(CUipcMemHandle)) == 0)
-		{
-			gmemp = temp;
-			break;
-		}
-	}
+	gmemp = __lookupGpuMemPreserved(gmemp_req->cuda_dindex,
+									&gmemp_req->m_handle);
 	if (!gmemp)
 		return CUDA_ERROR_NOT_FOUND;
-
-	rc = cuMemFree(gmemp->m_devptr);
-	if (rc != CUDA_SUCCESS)
-	{
-		elog(WARNING, "failed on cuMemFree: %s", errorText(rc));
-		result = rc;
-	}
-	elog(LOG, "free: preserved memory at %p", (void *)gmemp->m_devptr);
-
-	dlist_delete(&gmemp->chain);
-	memset(gmemp, 0, sizeof(GpuMemPreserved));
-	dlist_push_head(&gmemp_head->gmemp_free_list,
-					&gmemp->chain);
-	return result;
+	elog(LOG, "free: preserved memory at %p", (void *)gmemp->m_devptr);
+
+	return __gpummgrReleasePreserved(gmemp);
 }
 
 /*
@@ -1253,6 +2335,21 @@ gpummgrBgWorkerMain(Datum arg)
 	{
 		GpuMemPreservedRequest *gmemp_req;
 
+		/* release request of device memory by the backends */
+		for (i=0; i < numDevAttrs; i++)
+		{
+			GpuMemStatistics *gm_stat = &gm_stat_array[i];
+			size_t		nbytes;
+
+			if (pg_atomic_exchange_u32(&gm_stat->preserved_reclaim, 0) == 0)
+				continue;
+			SpinLockAcquire(&gmemp_head->lock);
+			nbytes = gpummgrEvictPreserved(i, InvalidOid, gm_segment_sz);
+			SpinLockRelease(&gmemp_head->lock);
+			if (nbytes > 0)
+				gpuMemNotifyRelease(i);
+		}
+
 		SpinLockAcquire(&gmemp_head->lock);
 		if (dlist_is_empty(&gmemp_head->gmemp_req_pending_list))
 		{
@@ -1298,8 +2395,8 @@ Datum
 pgstrom_device_preserved_meminfo(PG_FUNCTION_ARGS)
 {
 	FuncCallContext *fncxt;
-	Datum		values[5];
-	bool		isnull[5];
+	Datum		values[8];
+	bool		isnull[8];
 	HeapTuple	tuple;
 	GpuMemPreserved *gmemp, *lcopy;
 	List	   *gmemp_list = NIL;
@@ -1315,7 +2412,7 @@ pgstrom_device_preserved_meminfo(PG_FUNCTION_ARGS)
 		fncxt = SRF_FIRSTCALL_INIT();
 		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
 
-		tupdesc = CreateTemplateTupleDesc(5);
+		tupdesc = CreateTemplateTupleDesc(8);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "device_nr",
 						   INT4OID, -1, 0);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "handle",
@@ -1326,6 +2423,12 @@ pgstrom_device_preserved_meminfo(PG_FUNCTION_ARGS)
 						   INT8OID, -1, 0);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "ctime",
 						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "atime",
+						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "evictable",
+						   BOOLOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 8, "refcnt",
+						   INT4OID, -1, 0);
 		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
 
 		/* collect current preserved GPU memory information */
@@ -1382,6 +2485,9 @@ pgstrom_device_preserved_meminfo(PG_FUNCTION_ARGS)
 	values[2] = ObjectIdGetDatum(gmemp->owner);
 	values[3] = Int64GetDatum(gmemp->bytesize);
 	values[4] = TimestampTzGetDatum(gmemp->ctime);
+	values[5] = TimestampTzGetDatum(gmemp->atime);
+	values[6] = BoolGetDatum(gmemp->evictable);
+	values[7] = Int32GetDatum(gmemp->refcnt);
 
 	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
 	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
@@ -1411,7 +2517,18 @@ pgstrom_startup_gpu_mmgr(void)
 		elog(ERROR, "Bug? GPU Device Memory Statistics exists");
 	memset(gm_stat_array, 0, required);
 	for (i=0; i < numDevAttrs; i++)
-		gm_stat_array[i].total_size = devAttrs[i].DEV_TOTAL_MEMSZ;
+	{
+		GpuMemStatistics *gm_stat = &gm_stat_array[i];
+
+		gm_stat->total_size = devAttrs[i].DEV_TOTAL_MEMSZ;
+		pthreadMutexInit(&gm_stat->release_mutex, 1);
+		pthreadCondInit(&gm_stat->release_cond);
+		pg_atomic_init_u64(&gm_stat->release_generation, 0);
+		pg_atomic_init_u32(&gm_stat->release_waiters, 0);
+		pg_atomic_init_u64(&gm_stat->preserved_evictable, 0);
+		pg_atomic_init_u32(&gm_stat->preserved_reclaim, 0);
+		pg_atomic_init_u64(&gm_stat->peak_usage, 0);
+	}
 
 	/*
 	 * GpuMemPreservedHead
@@ -1471,6 +2588,70 @@ pgstrom_init_gpu_mmgr(void)
 			 (int)(pgstrom_chunk_size() >> 10));
 	gm_segment_sz = (size_t)gpu_memory_segment_size_kb << 10;
 
+	/*
+	 * initial segment size of the normal / managed device memory in kB
+	 */
+	DefineCustomIntVariable("pg_strom.gpu_memory_segment_min_size",
+							"initial size of the GPU device memory segment",
+							NULL,
+							&gpu_memory_segment_min_size_kb,
+							(pgstrom_chunk_size() * 2) >> 10,
+							GPUMEM_CHUNKSZ_MIN >> 10,
+							GPUMEM_CHUNKSZ_MAX >> 10,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+	gm_segment_min_sz = TYPEALIGN(GPUMEM_CHUNKSZ_MIN,
+								  (size_t)gpu_memory_segment_min_size_kb << 10);
+	gm_segment_min_sz = Min(gm_segment_min_sz, gm_segment_sz);
+
+	/* pg_strom.pinned_host_cache_size */
+	DefineCustomIntVariable("pg_strom.pinned_host_cache_size",
+							"size of pinned host memory cached per process",
+							NULL,
+							&pinned_host_cache_size_mb,
+							512,
+							0,
+							INT_MAX,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_MB,
+							NULL, NULL, NULL);
+	dlist_init(&gm_hostcache_list);
+
+	/* pg_strom.gpu_memory_pool */
+	DefineCustomBoolVariable("pg_strom.gpu_memory_pool",
+							 "Enables stream-ordered memory pool for short-lived GPU buffers",
+							 NULL,
+							 &gpu_memory_pool_enabled,
+							 true,
+							 PGC_SUSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* pg_strom.gpu_memory_reclaim_timeout */
+	DefineCustomIntVariable("pg_strom.gpu_memory_reclaim_timeout",
+							"timeout to wait for the idle GPU memory release by the concurrent sessions",
+							NULL,
+							&gpu_memory_reclaim_timeout,
+							100,
+							0,
+							10000,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_MS,
+							NULL, NULL, NULL);
+
+	/* pg_strom.preserved_gpu_memory_quota */
+	DefineCustomIntVariable("pg_strom.preserved_gpu_memory_quota",
+							"quota of preserved GPU device memory per role and device",
+							NULL,
+							&preserved_gpu_memory_quota_mb,
+							0,
+							0,
+							INT_MAX,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_MB,
+							NULL, NULL, NULL);
+
 	/* pg_strom.max_nchunks_for_multi_processes */
 	DefineCustomIntVariable("pg_strom.max_num_preserved_gpu_memory",
 							"max number of preserved GPU device memory for multi-process sharing",
@@ -1534,6 +2715,138 @@ retry:
 	}
 }
 
+/*
+ * ssd2gpuPageCache - residency of the source file range on the page cache
+ *
+ * SSD2GPU Direct makes sense only for the blocks which are actually stored
+ * on the storage. Blocks already on the page cache are cheaper to copy by
+ * CPU, then kick RAM2GPU DMA, in parallel to the SSD2GPU P2P DMA.
+ */
+typedef struct
+{
+	char		   *map_addr;	/* mmap'ed address, or NULL */
+	size_t			map_len;	/* length of the mapped range */
+	off_t			map_pos;	/* file offset of the map_addr */
+	unsigned char  *vec;		/* result of mincore(2) */
+} ssd2gpuPageCache;
+
+static void
+__ssd2gpuPageCacheClose(ssd2gpuPageCache *pc)
+{
+	if (pc->map_addr)
+		munmap(pc->map_addr, pc->map_len);
+	if (pc->vec)
+		free(pc->vec);
+	memset(pc, 0, sizeof(ssd2gpuPageCache));
+}
+
+static bool
+__ssd2gpuPageCacheOpen(ssd2gpuPageCache *pc, int fdesc,
+					   off_t f_head, off_t f_tail)
+{
+	void	   *map_addr;
+
+	memset(pc, 0, sizeof(ssd2gpuPageCache));
+	if (!nvme_strom_partial_scan() || f_head >= f_tail)
+		return false;
+	pc->map_pos = TYPEALIGN_DOWN(PAGE_SIZE, f_head);
+	pc->map_len = TYPEALIGN(PAGE_SIZE, f_tail) - pc->map_pos;
+	map_addr = mmap(NULL, pc->map_len, PROT_READ, MAP_SHARED,
+					fdesc, pc->map_pos);
+	if (map_addr == MAP_FAILED)
+		return false;
+	pc->map_addr = map_addr;
+	pc->vec = malloc(pc->map_len / PAGE_SIZE);
+	if (!pc->vec ||
+		mincore(pc->map_addr, pc->map_len, pc->vec) != 0)
+	{
+		__ssd2gpuPageCacheClose(pc);
+		return false;
+	}
+	return true;
+}
+
+static bool
+__ssd2gpuPageCacheResident(ssd2gpuPageCache *pc, off_t f_pos, size_t len)
+{
+	size_t		i = (f_pos - pc->map_pos) / PAGE_SIZE;
+	size_t		n = (f_pos + len - 1 - pc->map_pos) / PAGE_SIZE;
+
+	Assert(f_pos >= pc->map_pos &&
+		   f_pos + len <= pc->map_pos + pc->map_len);
+	while (i <= n)
+	{
+		if ((pc->vec[i++] & 1) == 0)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * __ssd2gpuPageCacheSortBlocks
+ *
+ * It moves the uncached blocks on the page cache to the head of uncached
+ * portion, and returns the number of the blocks to be loaded by CPU.
+ */
+static cl_uint
+__ssd2gpuPageCacheSortBlocks(ssd2gpuPageCache *pc, pgstrom_data_store *pds)
+{
+	BlockNumber	   *block_nums = (BlockNumber *)KERN_DATA_STORE_BODY(&pds->kds);
+	cl_uint			nr_loaded = pds->kds.nitems - pds->nblocks_uncached;
+	cl_uint			nr_resident = 0;
+	off_t			f_head = LONG_MAX;
+	off_t			f_tail = 0;
+	off_t			f_pos;
+	cl_uint			i;
+
+	for (i=nr_loaded; i < pds->kds.nitems; i++)
+	{
+		f_pos = (off_t)(block_nums[i] & (RELSEG_SIZE - 1)) * BLCKSZ;
+		f_head = Min(f_head, f_pos);
+		f_tail = Max(f_tail, f_pos + BLCKSZ);
+	}
+	if (!__ssd2gpuPageCacheOpen(pc, pds->filedesc, f_head, f_tail))
+		return 0;
+
+	for (i=nr_loaded; i < pds->kds.nitems; i++)
+	{
+		f_pos = (off_t)(block_nums[i] & (RELSEG_SIZE - 1)) * BLCKSZ;
+		if (__ssd2gpuPageCacheResident(pc, f_pos, BLCKSZ))
+		{
+			BlockNumber	temp = block_nums[nr_loaded + nr_resident];
+
+			block_nums[nr_loaded + nr_resident] = block_nums[i];
+			block_nums[i] = temp;
+			nr_resident++;
+		}
+	}
+	if (nr_resident == 0)
+		__ssd2gpuPageCacheClose(pc);
+	return nr_resident;
+}
+
+/*
+ * __ssd2gpuPageCacheLoadBlocks - copies the blocks on the page cache
+ */
+static void
+__ssd2gpuPageCacheLoadBlocks(ssd2gpuPageCache *pc, pgstrom_data_store *pds,
+							 cl_uint nr_resident)
+{
+	BlockNumber	   *block_nums = (BlockNumber *)KERN_DATA_STORE_BODY(&pds->kds);
+	cl_uint			nr_loaded = pds->kds.nitems - pds->nblocks_uncached;
+	cl_uint			i;
+
+	for (i=nr_loaded; i < nr_loaded + nr_resident; i++)
+	{
+		off_t	f_pos = (off_t)(block_nums[i] & (RELSEG_SIZE - 1)) * BLCKSZ;
+
+		memcpy(KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds, i),
+			   pc->map_addr + (f_pos - pc->map_pos),
+			   BLCKSZ);
+	}
+	pds->nblocks_uncached -= nr_resident;
+}
+
 /*
  * __gpuMemCopyFromSSD_Block - for KDS_FORMAT_BLOCK
  */
@@ -1544,13 +2857,27 @@ __gpuMemCopyFromSSD_Block(GpuContext *gcontext,
 						  pgstrom_data_store *pds)
 {
 	StromCmd__MemCopySsdToGpuBlocks cmd;
+	ssd2gpuPageCache pc;
 	size_t			offset = m_kds - gm_seg->m_segment;
 	size_t			length;
 	cl_uint			nr_loaded;
+	cl_uint			nr_resident = 0;
 	BlockNumber	   *block_nums;
 	CUresult		rc;
 
 	Assert(pds->kds.format == KDS_FORMAT_BLOCK);
+	Assert(pds->nblocks_uncached <= pds->kds.nitems);
+	/* blocks on the page cache are loaded by CPU */
+	if (pds->nblocks_uncached > 0)
+	{
+		nr_resident = __ssd2gpuPageCacheSortBlocks(&pc, pds);
+		if (nr_resident == pds->nblocks_uncached)
+		{
+			__ssd2gpuPageCacheLoadBlocks(&pc, pds, nr_resident);
+			__ssd2gpuPageCacheClose(&pc);
+			nr_resident = 0;
+		}
+	}
 	/* nothing special if all the blocks are already loaded */
 	if (pds->nblocks_uncached == 0)
 	{
@@ -1562,29 +2889,61 @@ __gpuMemCopyFromSSD_Block(GpuContext *gcontext,
 			werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
 		return 0UL;
 	}
-	Assert(pds->nblocks_uncached <= pds->kds.nitems);
-	nr_loaded = pds->kds.nitems - pds->nblocks_uncached;
+	nr_loaded = pds->kds.nitems - pds->nblocks_uncached + nr_resident;
 	length = ((char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds, nr_loaded) -
 			  (char *)(&pds->kds));
 	offset += length;
 	/* userspace pointers */
 	block_nums = (BlockNumber *)KERN_DATA_STORE_BODY(&pds->kds) + nr_loaded;
 
+	if (nvme_strom_use_cufile())
+	{
+		/* (1) load the blocks on the page cache */
+		if (nr_resident > 0)
+		{
+			__ssd2gpuPageCacheLoadBlocks(&pc, pds, nr_resident);
+			__ssd2gpuPageCacheClose(&pc);
+		}
+		/* (2) RAM2GPU DMA (earlier half) */
+		rc = cuMemcpyHtoDAsync(m_kds,
+							   &pds->kds,
+							   length,
+							   CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+		/* (3) SSD2GPU by cuFile; it returns on completion */
+		cufileReadBlocks(pds->filedesc,
+						 gm_seg->m_segment, offset,
+						 block_nums, pds->nblocks_uncached);
+		return 0UL;
+	}
+
 	/* setup ioctl(2) command */
 	memset(&cmd, 0, sizeof(StromCmd__MemCopySsdToGpuBlocks));
 	cmd.handle		= gm_seg->iomap_handle;
 	cmd.offset		= offset;
 	cmd.file_desc	= pds->filedesc;
-	cmd.nr_chunks	= pds->nblocks_uncached;
+	cmd.nr_chunks	= pds->nblocks_uncached - nr_resident;
 	cmd.chunk_sz	= BLCKSZ;
 	cmd.relseg_sz	= RELSEG_SIZE;
 	cmd.chunk_ids	= block_nums;
 
 	/* (1) kick SSD2GPU P2P DMA */
 	if (nvme_strom_ioctl(STROM_IOCTL__MEMCPY_SSD2GPU_BLOCKS, &cmd) != 0)
+	{
+		if (nr_resident > 0)
+			__ssd2gpuPageCacheClose(&pc);
 		werror("failed on STROM_IOCTL__MEMCPY_SSD2GPU_BLOCKS: %m");
+	}
+
+	/* (2) load the blocks on the page cache, during the P2P DMA */
+	if (nr_resident > 0)
+	{
+		__ssd2gpuPageCacheLoadBlocks(&pc, pds, nr_resident);
+		__ssd2gpuPageCacheClose(&pc);
+	}
 
-	/* (2) kick RAM2GPU DMA (earlier half) */
+	/* (3) kick RAM2GPU DMA (earlier half) */
 	rc = cuMemcpyHtoDAsync(m_kds,
 						   &pds->kds,
 						   length,
@@ -1597,6 +2956,141 @@ __gpuMemCopyFromSSD_Block(GpuContext *gcontext,
 	return cmd.dma_task_id;
 }
 
+/*
+ * __ssd2gpuPageCacheSplitIOVec
+ *
+ * It returns an I/O-vector (malloc'd) that consists of the pages not on the
+ * page cache, or NULL if no pages of the @iovec are on the page cache.
+ */
+static strom_io_vector *
+__ssd2gpuPageCacheSplitIOVec(ssd2gpuPageCache *pc, int fdesc,
+							 strom_io_vector *iovec)
+{
+	strom_io_vector *iov_ssd;
+	off_t		f_head = LONG_MAX;
+	off_t		f_tail = 0;
+	off_t		f_pos;
+	cl_uint		nr_resident = 0;
+	cl_uint		nr_chunks = 0;
+	cl_uint		i, k;
+
+	for (i=0; i < iovec->nr_chunks; i++)
+	{
+		strom_io_chunk *ioc = &iovec->ioc[i];
+
+		f_pos = (off_t)ioc->fchunk_id * PAGE_SIZE;
+		f_head = Min(f_head, f_pos);
+		f_tail = Max(f_tail, f_pos + (off_t)ioc->nr_pages * PAGE_SIZE);
+	}
+	if (!__ssd2gpuPageCacheOpen(pc, fdesc, f_head, f_tail))
+		return NULL;
+
+	/* count number of the SSD2GPU chunks */
+	for (i=0; i < iovec->nr_chunks; i++)
+	{
+		strom_io_chunk *ioc = &iovec->ioc[i];
+		bool		prev_resident = true;
+
+		for (k=0; k < ioc->nr_pages; k++)
+		{
+			f_pos = ((off_t)ioc->fchunk_id + k) * PAGE_SIZE;
+			if (__ssd2gpuPageCacheResident(pc, f_pos, PAGE_SIZE))
+			{
+				nr_resident++;
+				prev_resident = true;
+			}
+			else
+			{
+				if (prev_resident)
+					nr_chunks++;
+				prev_resident = false;
+			}
+		}
+	}
+	if (nr_resident == 0)
+		goto bailout;
+	iov_ssd = malloc(offsetof(strom_io_vector, ioc[nr_chunks]));
+	if (!iov_ssd)
+		goto bailout;
+
+	/* setup I/O-vector for SSD2GPU */
+	iov_ssd->nr_chunks = 0;
+	for (i=0; i < iovec->nr_chunks; i++)
+	{
+		strom_io_chunk *ioc = &iovec->ioc[i];
+		strom_io_chunk *curr = NULL;
+
+		for (k=0; k < ioc->nr_pages; k++)
+		{
+			f_pos = ((off_t)ioc->fchunk_id + k) * PAGE_SIZE;
+			if (__ssd2gpuPageCacheResident(pc, f_pos, PAGE_SIZE))
+				curr = NULL;
+			else if (curr)
+				curr->nr_pages++;
+			else
+			{
+				Assert(iov_ssd->nr_chunks < nr_chunks);
+				curr = &iov_ssd->ioc[iov_ssd->nr_chunks++];
+				curr->m_offset  = ioc->m_offset + (size_t)k * PAGE_SIZE;
+				curr->fchunk_id = ioc->fchunk_id + k;
+				curr->nr_pages  = 1;
+			}
+		}
+	}
+	Assert(iov_ssd->nr_chunks == nr_chunks);
+	return iov_ssd;
+
+bailout:
+	__ssd2gpuPageCacheClose(pc);
+	return NULL;
+}
+
+/*
+ * __ssd2gpuPageCacheLoadIOVec
+ *
+ * It kicks RAM2GPU DMA for the pages of @iovec on the page cache.
+ * Note that cuMemcpyHtoDAsync() from the pageable memory returns after the
+ * source buffer is copied to the staging buffer, so the caller can unmap
+ * the page cache immediately.
+ */
+static void
+__ssd2gpuPageCacheLoadIOVec(ssd2gpuPageCache *pc, CUdeviceptr m_kds,
+							strom_io_vector *iovec)
+{
+	cl_uint		i, k, n;
+	CUresult	rc;
+
+	for (i=0; i < iovec->nr_chunks; i++)
+	{
+		strom_io_chunk *ioc = &iovec->ioc[i];
+
+		k = 0;
+		while (k < ioc->nr_pages)
+		{
+			off_t	f_pos = ((off_t)ioc->fchunk_id + k) * PAGE_SIZE;
+
+			if (!__ssd2gpuPageCacheResident(pc, f_pos, PAGE_SIZE))
+			{
+				k++;
+				continue;
+			}
+			for (n=1; k + n < ioc->nr_pages; n++)
+			{
+				if (!__ssd2gpuPageCacheResident(pc, f_pos + (off_t)n * PAGE_SIZE,
+												PAGE_SIZE))
+					break;
+			}
+			rc = cuMemcpyHtoDAsync(m_kds + ioc->m_offset + (size_t)k * PAGE_SIZE,
+								   pc->map_addr + (f_pos - pc->map_pos),
+								   (size_t)n * PAGE_SIZE,
+								   CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+			k += n;
+		}
+	}
+}
+
 /*
  * __gpuMemCopyFromSSD_Arrow - for KDS_FORMAT_ARROW
  */
@@ -1606,6 +3100,10 @@ __gpuMemCopyFromSSD_Arrow(GpuContext *gcontext,
 						  CUdeviceptr m_kds,
 						  pgstrom_data_store *pds)
 {
+	strom_io_vector *iovec = pds->iovec;
+	strom_io_vector *iov_ssd;
+	ssd2gpuPageCache pc;
+	volatile unsigned long dma_task_id = 0UL;
 	size_t		head_sz;
 	CUresult	rc;
 
@@ -1619,26 +3117,72 @@ __gpuMemCopyFromSSD_Arrow(GpuContext *gcontext,
 						   CU_STREAM_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
-	
-	/* (2) SSD2GPU P2P DMA */
-	if (pds->iovec)
+	if (!iovec)
+		return 0UL;
+
+	/*
+	 * (2) pages on the page cache are sent by RAM2GPU DMA, and the rest of
+	 * pages are read by SSD2GPU P2P DMA concurrently.
+	 */
+	iov_ssd = __ssd2gpuPageCacheSplitIOVec(&pc, pds->filedesc, iovec);
+	STROM_TRY();
 	{
-		StromCmd__MemCopySsdToGpuRaw cmd;
-		strom_io_vector	   *iovec = pds->iovec;
+		if (nvme_strom_use_cufile())
+		{
+			/* cuFile is synchronous, so RAM2GPU DMA shall be kicked first */
+			if (iov_ssd)
+			{
+				__ssd2gpuPageCacheLoadIOVec(&pc, m_kds, iovec);
+				iovec = iov_ssd;
+			}
+			if (iovec->nr_chunks > 0)
+				cufileReadIOVec(pds->filedesc,
+								gm_seg->m_segment,
+								m_kds - gm_seg->m_segment,
+								iovec);
+		}
+		else
+		{
+			StromCmd__MemCopySsdToGpuRaw cmd;
+			strom_io_vector *iov_dma = (iov_ssd ? iov_ssd : iovec);
 
-		memset(&cmd, 0, sizeof(StromCmd__MemCopySsdToGpuRaw));
-		cmd.handle    = gm_seg->iomap_handle;
-		cmd.offset    = m_kds - gm_seg->m_segment;
-		cmd.file_desc = pds->filedesc;
-		cmd.nr_chunks = iovec->nr_chunks;
-		cmd.page_sz   = PAGE_SIZE;
-		cmd.io_chunks = iovec->ioc;
+			if (iov_dma->nr_chunks > 0)
+			{
+				memset(&cmd, 0, sizeof(StromCmd__MemCopySsdToGpuRaw));
+				cmd.handle    = gm_seg->iomap_handle;
+				cmd.offset    = m_kds - gm_seg->m_segment;
+				cmd.file_desc = pds->filedesc;
+				cmd.nr_chunks = iov_dma->nr_chunks;
+				cmd.page_sz   = PAGE_SIZE;
+				cmd.io_chunks = iov_dma->ioc;
+
+				if (nvme_strom_ioctl(STROM_IOCTL__MEMCPY_SSD2GPU_RAW, &cmd) != 0)
+					werror("failed on STROM_IOCTL__MEMCPY_SSD2GPU_RAW: %m");
+				dma_task_id = cmd.dma_task_id;
+			}
+			if (iov_ssd)
+				__ssd2gpuPageCacheLoadIOVec(&pc, m_kds, iovec);
+		}
+	}
+	STROM_CATCH();
+	{
+		if (dma_task_id)
+			gpuMemCopyFromSSDWaitRaw(gcontext, dma_task_id);
+		if (iov_ssd)
+		{
+			__ssd2gpuPageCacheClose(&pc);
+			free(iov_ssd);
+		}
+		STROM_RE_THROW();
+	}
+	STROM_END_TRY();
 
-		if (nvme_strom_ioctl(STROM_IOCTL__MEMCPY_SSD2GPU_RAW, &cmd) != 0)
-			werror("failed on STROM_IOCTL__MEMCPY_SSD2GPU_RAW: %m");
-		return cmd.dma_task_id;
+	if (iov_ssd)
+	{
+		__ssd2gpuPageCacheClose(&pc);
+		free(iov_ssd);
 	}
-	return 0UL;
+	return dma_task_id;
 }
 
 /*
@@ -1649,7 +3193,10 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 {
 	GpuContext	   *gcontext = GpuWorkerCurrentContext;
 	GpuMemSegment  *gm_seg;
+	nvmeIOTicket	ticket;
+	size_t			nbytes = 0;
 	unsigned long	dma_task_id;
+	int				i;
 
 	/* ensure the @m_kds is exactly i/o mapped buffer */
 	Assert(gcontext != NULL);
@@ -1659,23 +3206,229 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 		gm_seg->iomap_handle == 0UL)
 		werror("nvme-strom: invalid device pointer");
 	Assert(m_kds >= gm_seg->m_segment &&
-		   m_kds + pds->kds.length <= gm_seg->m_segment + gm_segment_sz);
-	switch (pds->kds.format)
+		   m_kds + pds->kds.length <= gm_seg->m_segment + gm_seg->segment_sz);
+	/* admission control of the SSD2GPU I/O */
+	if (pds->kds.format == KDS_FORMAT_BLOCK)
+		nbytes = (size_t)pds->nblocks_uncached * BLCKSZ;
+	else if (pds->kds.format == KDS_FORMAT_ARROW && pds->iovec)
 	{
-		case KDS_FORMAT_BLOCK:
-			dma_task_id = __gpuMemCopyFromSSD_Block(gcontext,
-													gm_seg, m_kds, pds);
-			break;
-		case KDS_FORMAT_ARROW:
-			dma_task_id = __gpuMemCopyFromSSD_Arrow(gcontext,
-													gm_seg, m_kds, pds);
-			break;
-		default:
-			werror("nvme-strom: unsupported KDS format: %d",
-				   pds->kds.format);
-			break;
+		for (i=0; i < pds->iovec->nr_chunks; i++)
+			nbytes += (size_t)pds->iovec->ioc[i].nr_pages * PAGE_SIZE;
+	}
+	nvmeIOAdmissionBegin(&ticket, gcontext, pds->filedesc, nbytes);
+
+	pgstromNvtxRangePush("SSD2GPU DMA (%zu bytes)", nbytes);
+	STROM_TRY();
+	{
+		switch (pds->kds.format)
+		{
+			case KDS_FORMAT_BLOCK:
+				dma_task_id = __gpuMemCopyFromSSD_Block(gcontext,
+														gm_seg, m_kds, pds);
+				break;
+			case KDS_FORMAT_ARROW:
+				dma_task_id = __gpuMemCopyFromSSD_Arrow(gcontext,
+														gm_seg, m_kds, pds);
+				break;
+			default:
+				werror("nvme-strom: unsupported KDS format: %d",
+					   pds->kds.format);
+				break;
+		}
+		/* Wait for completion of SSD2GPU P2P DMA */
+		if (dma_task_id)
+			gpuMemCopyFromSSDWaitRaw(gcontext, dma_task_id);
+	}
+	STROM_CATCH();
+	{
+		pgstromNvtxRangePop();
+		nvmeIOAdmissionEnd(&ticket, false);
+		STROM_RE_THROW();
+	}
+	STROM_END_TRY();
+	pgstromNvtxRangePop();
+	nvmeIOAdmissionEnd(&ticket, true);
+}
+
+/*
+ * gpuMemCopyFromSSDFile - load the head @length bytes of the file onto the
+ * device memory at @m_dest, through an i/o mapped buffer piece by piece.
+ *
+ * It is used to load a large buffer spilled to the file on NVMe-SSD, thus
+ * the destination is usually larger than the i/o mapped segment. Pages on
+ * the page cache are sent by RAM2GPU DMA, and the rest of pages are read by
+ * SSD2GPU P2P DMA, then copied to the destination on the device.
+ * It returns false if SSD2GPU Direct is not available on the file, then
+ * caller has to load the buffer by itself. Caller must set the CUDA context
+ * current, and must ensure dirty pages of the file are already written back.
+ */
+bool
+gpuMemCopyFromSSDFile(GpuContext *gcontext, CUdeviceptr m_dest,
+					  int fdesc, size_t length)
+{
+	GpuMemSegment  *gm_seg;
+	CUdeviceptr		m_iomap;
+	strom_io_vector *iovec;
+	nvmeIOTicket	ticket;
+	volatile bool	ticket_active = false;
+	size_t			unitsz;
+	size_t			offset;
+	bool			result = true;
+	CUresult		rc;
+
+	if (length == 0)
+		return true;
+	unitsz = Min(TYPEALIGN(PAGE_SIZE, length),
+				 TYPEALIGN_DOWN(PAGE_SIZE, gpuMemAllocIOMapMaxLength()));
+	rc = gpuMemAllocIOMap(gcontext, &m_iomap, unitsz);
+	if (rc != CUDA_SUCCESS)
+		return false;
+	gm_seg = lookupGpuMem(gcontext, m_iomap);
+	if (!gm_seg ||
+		gm_seg->gm_kind != GpuMemKind__IOMapMemory ||
+		gm_seg->iomap_handle == 0UL)
+	{
+		gpuMemFree(gcontext, m_iomap);
+		return false;
+	}
+	iovec = alloca(offsetof(strom_io_vector, ioc[1]));
+
+	STROM_TRY();
+	{
+		for (offset=0; result && offset < length; offset += unitsz)
+		{
+			size_t		nbytes = Min(unitsz, length - offset);
+			strom_io_vector *iov_ssd;
+			strom_io_vector *iov_dma;
+			ssd2gpuPageCache pc;
+			unsigned long dma_task_id = 0UL;
+			size_t		ssd_nbytes = 0;
+			cl_uint		i;
+
+			iovec->nr_chunks = 1;
+			iovec->ioc[0].m_offset  = 0;
+			iovec->ioc[0].fchunk_id = offset / PAGE_SIZE;
+			iovec->ioc[0].nr_pages  = TYPEALIGN(PAGE_SIZE, nbytes) / PAGE_SIZE;
+
+			iov_ssd = __ssd2gpuPageCacheSplitIOVec(&pc, fdesc, iovec);
+			iov_dma = (iov_ssd ? iov_ssd : iovec);
+			for (i=0; i < iov_dma->nr_chunks; i++)
+				ssd_nbytes += (size_t)iov_dma->ioc[i].nr_pages * PAGE_SIZE;
+			nvmeIOAdmissionBegin(&ticket, gcontext, fdesc, ssd_nbytes);
+			ticket_active = true;
+			if (iov_ssd)
+				__ssd2gpuPageCacheLoadIOVec(&pc, m_iomap, iovec);
+			if (iov_dma->nr_chunks > 0)
+			{
+				if (nvme_strom_use_cufile())
+					cufileReadIOVec(fdesc,
+									gm_seg->m_segment,
+									m_iomap - gm_seg->m_segment,
+									iov_dma);
+				else
+				{
+					StromCmd__MemCopySsdToGpuRaw cmd;
+
+					memset(&cmd, 0, sizeof(StromCmd__MemCopySsdToGpuRaw));
+					cmd.handle    = gm_seg->iomap_handle;
+					cmd.offset    = m_iomap - gm_seg->m_segment;
+					cmd.file_desc = fdesc;
+					cmd.nr_chunks = iov_dma->nr_chunks;
+					cmd.page_sz   = PAGE_SIZE;
+					cmd.io_chunks = iov_dma->ioc;
+
+					if (nvme_strom_ioctl(STROM_IOCTL__MEMCPY_SSD2GPU_RAW,
+										 &cmd) != 0)
+					{
+						/* no DMA is kicked, caller loads the buffer */
+						result = false;
+					}
+					else
+						dma_task_id = cmd.dma_task_id;
+				}
+			}
+			if (dma_task_id)
+				gpuMemCopyFromSSDWaitRaw(gcontext, dma_task_id);
+			nvmeIOAdmissionEnd(&ticket, result);
+			ticket_active = false;
+			if (iov_ssd)
+			{
+				__ssd2gpuPageCacheClose(&pc);
+				free(iov_ssd);
+			}
+			if (!result)
+				break;
+			/* i/o mapped buffer is reused for the next piece */
+			rc = cuMemcpyDtoDAsync(m_dest + offset, m_iomap, nbytes,
+								   CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemcpyDtoDAsync: %s", errorText(rc));
+			rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuStreamSynchronize: %s", errorText(rc));
+		}
+	}
+	STROM_CATCH();
+	{
+		if (ticket_active)
+			nvmeIOAdmissionEnd(&ticket, false);
+		gpuMemFree(gcontext, m_iomap);
+		STROM_RE_THROW();
+	}
+	STROM_END_TRY();
+	gpuMemFree(gcontext, m_iomap);
+
+	return result;
+}
+
+/*
+ * gpuMemCopyFromGpuBuffer - build up KDS_FORMAT_ARROW from the preserved
+ * GPU buffer which already keeps the column arrays.
+ *
+ * NOTE: @m_gbuf is mapped by the backend during the scan, so this routine
+ * don't need to open/close IPC handle. Copies are enqueued to the per-thread
+ * default stream, so the following kernels never run prior to completion.
+ */
+void
+gpuMemCopyFromGpuBuffer(CUdeviceptr m_kds, pgstrom_data_store *pds)
+{
+	gpubuf_io_vector *gbiov = pds->gpubuf_iov;
+	size_t		head_sz;
+	int			i;
+	CUresult	rc;
+
+	Assert(pds->kds.format == KDS_FORMAT_ARROW && gbiov != NULL);
+	/* (1) RAM2GPU DMA (header portion) */
+	head_sz = KERN_DATA_STORE_HEAD_LENGTH(&pds->kds);
+	rc = cuMemcpyHtoDAsync(m_kds,
+						   &pds->kds,
+						   head_sz,
+						   CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+
+	/* (2) GPU2GPU copy from the GPU buffer, or RAM2GPU for small chunks */
+	for (i=0; i < gbiov->nr_chunks; i++)
+	{
+		gpubuf_io_chunk *ioc = &gbiov->ioc[i];
+
+		if (ioc->from_host)
+		{
+			rc = cuMemcpyHtoDAsync(m_kds + ioc->m_offset,
+								   (char *)&pds->kds + ioc->s_offset,
+								   ioc->length,
+								   CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+		}
+		else
+		{
+			rc = cuMemcpyDtoDAsync(m_kds + ioc->m_offset,
+								   gbiov->m_gbuf + ioc->s_offset,
+								   ioc->length,
+								   CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemcpyDtoDAsync: %s", errorText(rc));
+		}
 	}
-	/* Wait for completion of SSD2GPU P2P DMA */
-	if (dma_task_id)
-		gpuMemCopyFromSSDWaitRaw(gcontext, dma_task_id);
 }
@@ -17,6 +17,80 @@
  */
 #include "pg_strom.h"
 
+/*
+ * GpuTaskStatEntry - cumulative statistics of GpuTasks (shared)
+ *
+ * Every GpuTask is accounted on the shared memory per GPU device and per
+ * queryId of the statement (if pg_stat_statements or compute_query_id
+ * assigns it). These are exposed as pgstrom.stat_gpu_device and
+ * pgstrom.stat_gpu_statements.
+ *
+ * NOTE: These counters are updated by GPU worker threads, so we must not
+ * use any PostgreSQL backend facility except for atomic operations.
+ */
+#define GPUTASK_STAT_NSLOTS		1000
+
+typedef struct
+{
+	pg_atomic_uint64 key;			/* queryId, or 0 if unused */
+	pg_atomic_uint64 num_tasks;		/* # of GpuTasks completed */
+	pg_atomic_uint64 num_fallbacks;	/* # of GpuTasks fallen back to CPU */
+	pg_atomic_uint64 num_retries;	/* # of retries by lack of resources */
+	pg_atomic_uint64 gpu_time_us;	/* time to process GpuTasks */
+	pg_atomic_uint64 kern_time_us;	/* time of GPU kernel execution */
+	pg_atomic_uint64 h2d_bytes;		/* bytes of host-to-device DMA */
+	pg_atomic_uint64 d2h_bytes;		/* bytes of device-to-host DMA */
+	pg_atomic_uint64 ssd2gpu_base;	/* SSD2GPU bytes at the last reset */
+} GpuTaskStatEntry;
+
+/*
+ * GpuTaskCostEntry - runtime feedback to the cost model (shared)
+ *
+ * Estimated cost and actual execution time of the GPU nodes executed with
+ * instrumentation (EXPLAIN ANALYZE or auto_explain), per GpuTaskKind.
+ * The actual time is converted to the cost unit using the result of
+ * pgstrom.gpu_cost_calibrate(), then the ratio to the estimation is
+ * reported by pgstrom.gpu_cost_feedback, and applied to the cost of GPU
+ * nodes if pg_strom.gpu_cost_feedback is enabled.
+ */
+#define GPUTASK_COST_NKINDS		(GpuTaskKind_GpuSort + 1)
+
+typedef struct
+{
+	pg_atomic_uint64 nplans;		/* # of instrumented executions */
+	pg_atomic_uint64 est_cost;		/* sum of the estimated cost (x1000) */
+	pg_atomic_uint64 actual_us;		/* sum of the actual time in usec */
+} GpuTaskCostEntry;
+
+typedef struct
+{
+	TimestampTz		stats_reset;
+	/* result of the last pgstrom.gpu_cost_calibrate() */
+	slock_t			calib_lock;
+	double			calib_cost_per_ms;	/* cost unit per msec, or 0.0 */
+	TimestampTz		calib_time;
+	GpuTaskCostEntry costs[GPUTASK_COST_NKINDS];
+	GpuTaskStatEntry queries[GPUTASK_STAT_NSLOTS];
+	GpuTaskStatEntry gpus[FLEXIBLE_ARRAY_MEMBER];
+} GpuTaskStatHead;
+
+static shmem_startup_hook_type shmem_startup_next = NULL;
+static GpuTaskStatHead *gputask_stat_head = NULL;
+static bool		pgstrom_enable_gpu_cost_feedback;	/* GUC */
+static bool		pgstrom_parallel_share_async_tasks;	/* GUC */
+static bool		pgstrom_enable_async_append;		/* GUC */
+static ExecutorStart_hook_type executor_start_next = NULL;
+
+#define GPU_COST_FEEDBACK_MIN_PLANS		10
+#define GPU_COST_FEEDBACK_MIN_RATIO		0.1
+#define GPU_COST_FEEDBACK_MAX_RATIO		10.0
+
+Datum	pgstrom_stat_gpu_device(PG_FUNCTION_ARGS);
+Datum	pgstrom_stat_gpu_statements(PG_FUNCTION_ARGS);
+Datum	pgstrom_stat_gpu_reset(PG_FUNCTION_ARGS);
+Datum	pgstrom_gpu_cost_calibrate(PG_FUNCTION_ARGS);
+Datum	pgstrom_gpu_cost_feedback_info(PG_FUNCTION_ARGS);
+
 /*
  * construct_kern_parambuf
  *
@@ -217,6 +291,7 @@ void
 pgstromInitGpuTaskState(GpuTaskState *gts,
 						GpuContext *gcontext,
 						GpuTaskKind task_kind,
+						List *outer_quals,
 						List *outer_refs_list,
 						List *used_params,
 						cl_int optimal_gpu,
@@ -263,10 +338,16 @@ pgstromInitGpuTaskState(GpuTaskState *gts,
 		}
 		/* setup ArrowFdwState, if foreign-table */
 		if (RelationGetForm(relation)->relkind == RELKIND_FOREIGN_TABLE)
-			gts->af_state = ExecInitArrowFdw(relation, outer_refs);
+			gts->af_state = ExecInitArrowFdw(&gts->css.ss,
+											 outer_quals,
+											 outer_refs);
 	}
+	/* setup zone map, if any simple comparison in the outer quals */
+	pgstromExecInitZoneMap(gts, outer_quals);
 	gts->outer_refs = outer_refs;
 	gts->scan_done = false;
+	/* setup columnar cache, if any */
+	pgstromExecInitColumnarCache(gts);
 
 	InstrInit(&gts->outer_instrument, estate->es_instrument);
 	gts->scan_overflow = NULL;
@@ -279,13 +360,148 @@ pgstromInitGpuTaskState(GpuTaskState *gts,
 	 * be setup only when it is not responsible to partial read.
 	 */
 
+	/* adaptive chunk sizing, if pg_strom.chunk_target_latency > 0 */
+	gts->chunk_size = 0;
+	gts->usec_per_mb = 0.0;
+	/* adaptive concurrency control, if pg_strom.adaptive_async_tasks */
+	gts->max_async_tasks = local_max_async_tasks;
+	gts->inflight_window = Max(local_max_async_tasks / 2, 1);
+	gts->latency_min = 0.0;
+	gts->window_shrunk = 0;
+	/* LIMIT clause pushdown shall be set by the caller, if any */
+	gts->tuple_bound = -1;
+	pg_atomic_init_u64(&gts->ntuples_ready_local, 0);
+	gts->ntuples_ready = &gts->ntuples_ready_local;
+	/* for pgstrom.stat_gpu_statements */
+	gts->query_id = estate->es_plannedstmt->queryId;
+
+	/* async Append shall be setup by pgstrom_executor_start */
+	gts->append_next = NULL;
 	/* callbacks shall be set by the caller */
+	gts->cb_async_begin = NULL;
+	gts->cb_cpu_task = NULL;
+	gts->hybrid_exec = false;
+	gts->program_ready = false;
 	dlist_init(&gts->ready_tasks);
 	gts->num_ready_tasks = 0;
 	/* co-operation with CPU parallel (setup by DSM init handler) */
 	gts->pcxt = NULL;
 }
 
+/*
+ * pgstromAsyncAppendBegin
+ *
+ * It launches the first GpuTasks of the next GPU node under the Append,
+ * while the current GTS drains the remaining tasks. They are picked up by
+ * fetch_next_gputask() of the next GTS as usual, once Append moves to it.
+ * Because the next GTS may have its own GpuContext (partitions are often
+ * assigned to different devices), these devices run concurrently.
+ */
+static void
+pgstromAsyncAppendBegin(GpuTaskState *gts)
+{
+	GpuTaskState   *ngts = gts->append_next;
+	GpuContext	   *gcontext;
+	GpuTask		   *gtask;
+	cl_int			local_max_tasks;
+
+	if (!ngts->cb_async_begin ||
+		ngts->scan_done ||
+		ngts->curr_task ||
+		ngts->num_running_tasks > 0 ||
+		ngts->num_ready_tasks > 0 ||
+		ngts->css.ss.ps.chgParam != NULL)
+		return;
+	/* open the GpuContext, and setup the state on ahead */
+	gcontext = ngts->gcontext;
+	ActivateGpuContext(gcontext);
+	if (!ngts->cb_async_begin(ngts))
+		return;
+	CHECK_FOR_GPUCONTEXT(gcontext);
+
+	local_max_tasks = (!pgstrom_adaptive_async_tasks
+					   ? ngts->max_async_tasks
+					   : Max((cl_int)ngts->inflight_window, 1));
+	pthreadMutexLock(gcontext->mutex);
+	while (ngts->num_running_tasks < local_max_tasks &&
+		   gpuTaskSchedAdmit(gcontext, false))
+	{
+		pthreadMutexUnlock(gcontext->mutex);
+		gtask = ngts->cb_next_task(ngts);
+		pthreadMutexLock(gcontext->mutex);
+		if (!gtask)
+		{
+			gpuTaskSchedDone(gcontext, 1);
+			ngts->scan_done = true;
+			break;
+		}
+		GpuContextPushTask(gcontext, gtask);
+		ngts->num_running_tasks++;
+		pthreadCondSignal(gcontext->cond);
+	}
+	pthreadMutexUnlock(gcontext->mutex);
+	gpuTaskSchedLeave(gcontext);
+}
+
+/*
+ * __pgstromSetupAsyncAppend
+ */
+static bool
+__pgstromSetupAsyncAppend(PlanState *ps, void *context)
+{
+	if (IsA(ps, AppendState) &&
+		!ps->plan->parallel_aware)
+	{
+		AppendState	   *astate = (AppendState *) ps;
+		GpuTaskState   *prev = NULL;
+		int				i;
+
+		/*
+		 * Run-time partition pruning may skip some of the sub-plans, so
+		 * we cannot know which one is the next on ahead.
+		 */
+		if (astate->as_prune_state != NULL)
+			goto skip;
+		for (i=0; i < astate->as_nplans; i++)
+		{
+			PlanState  *curr = astate->appendplans[i];
+
+			if (pgstrom_planstate_is_gpuscan(curr) ||
+				pgstrom_planstate_is_gpujoin(curr) ||
+				pgstrom_planstate_is_gpupreagg(curr))
+			{
+				if (prev)
+					prev->append_next = (GpuTaskState *) curr;
+				prev = (GpuTaskState *) curr;
+			}
+			else
+				prev = NULL;
+		}
+	}
+skip:
+	return planstate_tree_walker(ps, __pgstromSetupAsyncAppend, context);
+}
+
+/*
+ * pgstrom_executor_start
+ *
+ * It links GPU nodes under the same Append node, for async Append.
+ */
+static void
+pgstrom_executor_start(QueryDesc *queryDesc, int eflags)
+{
+	if (executor_start_next)
+		(*executor_start_next)(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+
+	if (pgstrom_enabled &&
+		pgstrom_enable_async_append &&
+		(eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0 &&
+		queryDesc->planstate)
+		__pgstromSetupAsyncAppend(queryDesc->planstate, NULL);
+}
+
 /*
  * fetch_next_gputask
  */
@@ -296,37 +512,96 @@ fetch_next_gputask(GpuTaskState *gts)
 	GpuTask		   *gtask;
 	dlist_node	   *dnode;
 	cl_int			local_num_running_tasks;
-	cl_int			global_num_running_tasks;
+	cl_int			local_max_tasks;
 	cl_int			ev;
+	dlist_head		cancelled_tasks;
 
 	/* force activate GpuContext on demand */
 	Assert(gcontext->worker_is_running);
 	CHECK_FOR_GPUCONTEXT(gcontext);
 
+	dlist_init(&cancelled_tasks);
 	pthreadMutexLock(gcontext->mutex);
 	while (!gts->scan_done)
 	{
 		ResetLatch(MyLatch);
+		/*
+		 * No more chunks are needed, if LIMIT bound is already met.
+		 * Pending GpuTasks not yet picked up by the GPU workers also
+		 * shall be cancelled.
+		 */
+		if (gts->tuple_bound >= 0 &&
+			pg_atomic_read_u64(gts->ntuples_ready) >= gts->tuple_bound)
+		{
+			int		ncancels = GpuContextCancelTasks(gcontext, gts,
+													 &cancelled_tasks);
+			gts->num_running_tasks -= ncancels;
+			gpuTaskSchedDone(gcontext, ncancels);
+			gts->scan_done = true;
+			break;
+		}
+		/*
+		 * GPU program is not built yet. Instead of the wait for the program
+		 * builders, CPU processes the next chunk by itself, if GTS supports.
+		 */
+		if (pgstrom_cpu_exec_while_build &&
+			gts->cb_cpu_task &&
+			!gts->program_ready &&
+			!(gts->program_ready =
+			  pgstrom_cuda_program_is_built(gts->program_id)))
+		{
+			bool	is_cpu_task;
+
+			pthreadMutexUnlock(gcontext->mutex);
+			gtask = gts->cb_next_task(gts);
+			is_cpu_task = (gtask && gts->cb_cpu_task(gts, gtask));
+			pthreadMutexLock(gcontext->mutex);
+			if (!gtask)
+			{
+				gts->scan_done = true;
+				break;
+			}
+			if (is_cpu_task)
+			{
+				dlist_push_tail(&gts->ready_tasks, &gtask->chain);
+				gts->num_ready_tasks++;
+				pthreadMutexUnlock(gcontext->mutex);
+				goto pickup_gputask;
+			}
+			gpuTaskSchedAdmit(gcontext, true);
+			GpuContextPushTask(gcontext, gtask);
+			gts->num_running_tasks++;
+			pthreadCondSignal(gcontext->cond);
+			continue;
+		}
+
+		/*
+		 * Admission of the next GpuTask by the scheduler, as long as
+		 * the local limit is not exceeded. If GTS has nothing to wait for,
+		 * it is admitted regardless of the device queue depth.
+		 */
 		local_num_running_tasks = (gts->num_ready_tasks +
 								   gts->num_running_tasks);
-		global_num_running_tasks =
-			pg_atomic_read_u32(gcontext->global_num_running_tasks);
-		if ((local_num_running_tasks < local_max_async_tasks &&
-			 global_num_running_tasks < global_max_async_tasks) ||
+		local_max_tasks = (!pgstrom_adaptive_async_tasks
+						   ? gts->max_async_tasks
+						   : Max((cl_int)gts->inflight_window, 1));
+		if ((local_num_running_tasks < local_max_tasks &&
+			 gpuTaskSchedAdmit(gcontext, false)) ||
 			(dlist_is_empty(&gts->ready_tasks) &&
-			 gts->num_running_tasks == 0))
+			 gts->num_running_tasks == 0 &&
+			 gpuTaskSchedAdmit(gcontext, true)))
 		{
 			pthreadMutexUnlock(gcontext->mutex);
 			gtask = gts->cb_next_task(gts);
 			pthreadMutexLock(gcontext->mutex);
 			if (!gtask)
 			{
+				gpuTaskSchedDone(gcontext, 1);
 				gts->scan_done = true;
 				break;
 			}
-			dlist_push_tail(&gcontext->pending_tasks, &gtask->chain);
+			GpuContextPushTask(gcontext, gtask);
 			gts->num_running_tasks++;
-			pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
 			pthreadCondSignal(gcontext->cond);
 		}
 		else if (!dlist_is_empty(&gts->ready_tasks))
@@ -339,6 +614,38 @@ fetch_next_gputask(GpuTaskState *gts)
 			pthreadMutexUnlock(gcontext->mutex);
 			goto pickup_gputask;
 		}
+		else if (gts->cb_cpu_task &&
+				 gts->hybrid_exec &&
+				 gts->num_running_tasks > 0)
+		{
+			/*
+			 * GPU is busy with enough number of GpuTasks, but nobody gets
+			 * completed yet. Instead of the wait for completion, CPU may
+			 * process the next chunk by itself, if GTS supports.
+			 */
+			bool	is_cpu_task;
+
+			pthreadMutexUnlock(gcontext->mutex);
+			gtask = gts->cb_next_task(gts);
+			is_cpu_task = (gtask && gts->cb_cpu_task(gts, gtask));
+			pthreadMutexLock(gcontext->mutex);
+			if (!gtask)
+			{
+				gts->scan_done = true;
+				break;
+			}
+			if (is_cpu_task)
+			{
+				dlist_push_tail(&gts->ready_tasks, &gtask->chain);
+				gts->num_ready_tasks++;
+				pthreadMutexUnlock(gcontext->mutex);
+				goto pickup_gputask;
+			}
+			gpuTaskSchedAdmit(gcontext, true);
+			GpuContextPushTask(gcontext, gtask);
+			gts->num_running_tasks++;
+			pthreadCondSignal(gcontext->cond);
+		}
 		else if (gts->num_running_tasks > 0)
 		{
 			/*
@@ -374,6 +681,23 @@ fetch_next_gputask(GpuTaskState *gts)
 		}
 	}
 	pthreadMutexUnlock(gcontext->mutex);
+	gpuTaskSchedLeave(gcontext);
+
+	/* release the cancelled GpuTasks, if any */
+	while (!dlist_is_empty(&cancelled_tasks))
+	{
+		dnode = dlist_pop_head_node(&cancelled_tasks);
+		gtask = dlist_container(GpuTask, chain, dnode);
+		gts->cb_release_task(gtask);
+	}
+
+	/*
+	 * Relation scan has already done, so the next GPU node under the Append
+	 * may start its GpuTasks, unless LIMIT clause may terminate the Append
+	 * prior to the next sub-plan.
+	 */
+	if (gts->append_next && gts->tuple_bound < 0)
+		pgstromAsyncAppendBegin(gts);
 
 	/*
 	 * Once we exit the above loop, either a completed task was returned,
@@ -408,10 +732,9 @@ retry:
 					}
 					else
 					{
-						dlist_push_tail(&gcontext->pending_tasks,
-										&gtask->chain);
+						gpuTaskSchedAdmit(gcontext, true);
+						GpuContextPushTask(gcontext, gtask);
 						gts->num_running_tasks++;
-						pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
 						pthreadCondSignal(gcontext->cond);
 					}
 					goto retry;
@@ -449,6 +772,19 @@ pickup_gputask:
 	return gtask;
 }
 
+/*
+ * pgstromAddGpuTaskResults
+ *
+ * It counts up the number of result rows generated by GpuTasks, for LIMIT
+ * clause pushdown. Note that it may be called by the GPU worker threads.
+ */
+void
+pgstromAddGpuTaskResults(GpuTaskState *gts, size_t nitems)
+{
+	if (gts->tuple_bound >= 0 && nitems > 0)
+		pg_atomic_fetch_add_u64(gts->ntuples_ready, nitems);
+}
+
 /*
  * pgstromExecGpuTaskState
  */
@@ -464,6 +800,7 @@ pgstromExecGpuTaskState(GpuTaskState *gts)
 		/* release the current GpuTask object that was already scanned */
 		if (gtask)
 		{
+			PDS_release_slot_ref(gts);
 			gts->cb_release_task(gtask);
 			gts->curr_task = NULL;
 			gts->curr_index = 0;
@@ -474,7 +811,10 @@ pgstromExecGpuTaskState(GpuTaskState *gts)
 		if (!gtask)
 			return NULL;
 		if (gtask->cpu_fallback)
+		{
 			gts->num_cpu_fallbacks++;
+			pgstromStatGpuTaskFallback(gts);
+		}
 		gts->curr_task = gtask;
 		gts->curr_index = 0;
 		gts->curr_lp_index = 0;
@@ -491,6 +831,9 @@ pgstromExecGpuTaskState(GpuTaskState *gts)
 void
 pgstromRescanGpuTaskState(GpuTaskState *gts)
 {
+	/* slot shall not reference the buffers to be released */
+	PDS_release_slot_ref(gts);
+
 	/*
 	 * release all the unprocessed tasks
 	 */
@@ -506,11 +849,97 @@ pgstromRescanGpuTaskState(GpuTaskState *gts)
 	/* rewind the scan position if GTS scans a table */
 	pgstromRewindScanChunk(gts);
 
+	/* reset the counter of LIMIT clause pushdown */
+	pg_atomic_write_u64(&gts->ntuples_ready_local, 0);
+
 	/* Also rewind the scan state of Arrow_Fdw */
 	if (gts->af_state)
 		ExecReScanArrowFdw(gts->af_state);
 }
 
+/*
+ * pgstromStatGpuTaskCost - feedback of the actual time to the cost model
+ *
+ * NOTE: Only instrumented executions by the backend are accounted; CPU
+ * parallel workers are merged to the leader's execution time.
+ */
+static void
+pgstromStatGpuTaskCost(GpuTaskState *gts)
+{
+	Instrumentation *instrument = gts->css.ss.ps.instrument;
+	Plan	   *plan = gts->css.ss.ps.plan;
+	GpuTaskCostEntry *entry;
+	double		est_cost;
+	double		actual_ms;
+
+	if (!gputask_stat_head || !instrument || IsParallelWorker() ||
+		gts->task_kind >= GPUTASK_COST_NKINDS)
+		return;
+	InstrEndLoop(instrument);
+	if (instrument->nloops <= 0.0 || plan->total_cost <= 0.0)
+		return;
+	/* estimation without the feedback, to avoid amplification */
+	est_cost = plan->total_cost / pgstrom_gpu_cost_feedback(gts->task_kind);
+	actual_ms = 1000.0 * instrument->total / instrument->nloops;
+
+	entry = &gputask_stat_head->costs[gts->task_kind];
+	pg_atomic_fetch_add_u64(&entry->nplans, 1);
+	pg_atomic_fetch_add_u64(&entry->est_cost, (uint64)(est_cost * 1000.0));
+	pg_atomic_fetch_add_u64(&entry->actual_us, (uint64)(actual_ms * 1000.0));
+}
+
+/*
+ * __pgstrom_gpu_cost_ratio - ratio of the actual cost to the estimation
+ */
+static double
+__pgstrom_gpu_cost_ratio(GpuTaskKind task_kind, uint64 *p_nplans)
+{
+	GpuTaskCostEntry *entry;
+	double		cost_per_ms;
+	uint64		nplans;
+	uint64		est_cost;
+	uint64		actual_us;
+
+	*p_nplans = 0;
+	if (!gputask_stat_head || task_kind >= GPUTASK_COST_NKINDS)
+		return -1.0;
+	SpinLockAcquire(&gputask_stat_head->calib_lock);
+	cost_per_ms = gputask_stat_head->calib_cost_per_ms;
+	SpinLockRelease(&gputask_stat_head->calib_lock);
+
+	entry = &gputask_stat_head->costs[task_kind];
+	nplans = pg_atomic_read_u64(&entry->nplans);
+	est_cost = pg_atomic_read_u64(&entry->est_cost);
+	actual_us = pg_atomic_read_u64(&entry->actual_us);
+	*p_nplans = nplans;
+	if (cost_per_ms <= 0.0 || nplans == 0 || est_cost == 0)
+		return -1.0;
+	return (((double)actual_us / 1000.0) * cost_per_ms /
+			((double)est_cost / 1000.0));
+}
+
+/*
+ * pgstrom_gpu_cost_feedback
+ *
+ * It returns the factor to be applied on the cost of GPU nodes, according
+ * to the runtime feedback. 1.0 if pg_strom.gpu_cost_feedback is disabled,
+ * or not sufficient samples yet.
+ */
+double
+pgstrom_gpu_cost_feedback(GpuTaskKind task_kind)
+{
+	uint64		nplans;
+	double		ratio;
+
+	if (!pgstrom_enable_gpu_cost_feedback)
+		return 1.0;
+	ratio = __pgstrom_gpu_cost_ratio(task_kind, &nplans);
+	if (ratio <= 0.0 || nplans < GPU_COST_FEEDBACK_MIN_PLANS)
+		return 1.0;
+	return Max(Min(ratio, GPU_COST_FEEDBACK_MAX_RATIO),
+			   GPU_COST_FEEDBACK_MIN_RATIO);
+}
+
 /*
  * pgstromReleaseGpuTaskState
  */
@@ -537,6 +966,12 @@ pgstromReleaseGpuTaskState(GpuTaskState *gts, GpuTaskRuntimeStat *gt_rtstat)
 	/* shutdown Arrow_Fdw state */
 	if (gts->af_state)
 		ExecEndArrowFdw(gts->af_state);
+	/* close columnar cache files, if any */
+	pgstromExecEndColumnarCache(gts);
+	/* release zone map state, if any */
+	pgstromExecEndZoneMap(gts);
+	/* runtime feedback to the cost model, if instrumented */
+	pgstromStatGpuTaskCost(gts);
 	/* unreference CUDA program */
 	if (gts->program_id != INVALID_PROGRAM_ID)
 		pgstrom_put_cuda_program(gts->gcontext, gts->program_id);
@@ -552,6 +987,7 @@ pgstromExplainGpuTaskState(GpuTaskState *gts, ExplainState *es)
 {
 	Relation	rel = gts->css.ss.ss_currentRelation;
 	char		temp[320];
+	int			i;
 
 	/* GPU preference, if any */
 	if (es->verbose || gts->optimal_gpu >= 0)
@@ -597,10 +1033,79 @@ pgstromExplainGpuTaskState(GpuTaskState *gts, ExplainState *es)
 	else if (es->format != EXPLAIN_FORMAT_TEXT)
 		ExplainPropertyText("NVMe-Strom", "disabled", es);
 
+	/* Columnar cache support */
+	if (gts->ccache_state)
+	{
+		if (!es->analyze)
+			ExplainPropertyText("CCache", "enabled", es);
+		else
+		{
+			ExplainPropertyInteger("CCache Hits",
+								   NULL, gts->ccache_count, es);
+			if (gts->ccache_device_count > 0)
+				ExplainPropertyInteger("CCache Device Hits",
+									   NULL, gts->ccache_device_count, es);
+		}
+	}
+	else if (es->format != EXPLAIN_FORMAT_TEXT)
+		ExplainPropertyText("CCache", "disabled", es);
+
 	/* Number of CPU fallbacks, if any */
 	if (es->analyze && gts->num_cpu_fallbacks > 0)
 		ExplainPropertyInteger("CPU fallbacks",
 							   NULL, gts->num_cpu_fallbacks, es);
+	/* Number of GpuTasks built in this process (machine readable only) */
+	if (es->analyze && es->format != EXPLAIN_FORMAT_TEXT)
+		ExplainPropertyInteger("GPU Tasks",
+							   NULL, gts->num_tasks_seq, es);
+	/* Time consumption per stage, if any */
+	if (es->analyze && es->verbose && !pgstrom_regression_test_mode)
+	{
+		static const char *stage_labels[] = {
+			"DMA Send",			/* GTSTAGE__DMA_SEND */
+			"GPU Exec",			/* GTSTAGE__KERN_EXEC */
+			"GPU Resume",		/* GTSTAGE__KERN_RESUME */
+			"DMA Recv",			/* GTSTAGE__DMA_RECV */
+			"Inner Preload",	/* GTSTAGE__INNER_PRELOAD */
+		};
+		StaticAssertStmt(lengthof(stage_labels) == GTSTAGE__NUM_STAGES,
+						 "stage_labels[] does not match GpuTaskStage");
+
+		for (i=0; i < GTSTAGE__NUM_STAGES; i++)
+		{
+			GpuTaskStageStat *stat = &gts->stage_stat[i];
+			char		label[80];
+
+			if (stat->count == 0)
+				continue;
+			if (es->format == EXPLAIN_FORMAT_TEXT)
+			{
+				snprintf(temp, sizeof(temp),
+						 "total: %.3fms, avg: %.3fms, "
+						 "min: %.3fms, max: %.3fms, count: %lu",
+						 stat->total,
+						 stat->total / (double)stat->count,
+						 stat->min,
+						 stat->max,
+						 stat->count);
+				ExplainPropertyText(stage_labels[i], temp, es);
+			}
+			else
+			{
+				snprintf(label, sizeof(label), "%s Total", stage_labels[i]);
+				ExplainPropertyFloat(label, "ms", stat->total, 3, es);
+				snprintf(label, sizeof(label), "%s Avg", stage_labels[i]);
+				ExplainPropertyFloat(label, "ms", stat->total /
+									 (double)stat->count, 3, es);
+				snprintf(label, sizeof(label), "%s Min", stage_labels[i]);
+				ExplainPropertyFloat(label, "ms", stat->min, 3, es);
+				snprintf(label, sizeof(label), "%s Max", stage_labels[i]);
+				ExplainPropertyFloat(label, "ms", stat->max, 3, es);
+				snprintf(label, sizeof(label), "%s Count", stage_labels[i]);
+				ExplainPropertyInteger(label, NULL, stat->count, es);
+			}
+		}
+	}
 	/* Properties of Arrow_Fdw if any */
 	if (gts->af_state)
 		ExplainArrowFdw(gts->af_state, rel, es);
@@ -635,7 +1140,31 @@ pgstromEstimateDSMGpuTaskState(GpuTaskState *gts, ParallelContext *pcxt)
 		return MAXALIGN(offsetof(GpuTaskSharedState, phscan) +
 						table_parallelscan_estimate(relation, snapshot));
 	}
-	return 0;
+	return MAXALIGN(offsetof(GpuTaskSharedState, phscan));
+}
+
+/*
+ * pgstromShareAsyncTasks
+ *
+ * If pg_strom.parallel_share_async_tasks is enabled, the leader and the
+ * parallel workers share pg_strom.local_max_async_tasks, as if they run
+ * on a single GpuContext. Each process runs its share of GPU worker
+ * threads and in-flight GpuTasks, so device memory for the chunks and
+ * CUDA context switches don't grow in proportion to the number of the
+ * parallel workers.
+ */
+static void
+pgstromShareAsyncTasks(GpuTaskState *gts, GpuTaskSharedState *gtss)
+{
+	cl_int		max_async_tasks;
+
+	if (gtss->num_participants <= 1)
+		return;
+	max_async_tasks = Max(local_max_async_tasks / gtss->num_participants, 1);
+	gts->max_async_tasks = max_async_tasks;
+	gts->inflight_window = Min(gts->inflight_window,
+							   (double)max_async_tasks);
+	LimitGpuContextWorkers(gts->gcontext, max_async_tasks);
 }
 
 /*
@@ -651,6 +1180,15 @@ pgstromInitDSMGpuTaskState(GpuTaskState *gts,
 	Snapshot	snapshot = estate->es_snapshot;
 	GpuTaskSharedState *gtss = coordinate;
 
+	gtss->num_participants = 1;
+	if (pgstrom_parallel_share_async_tasks)
+	{
+		gtss->num_participants = pcxt->nworkers +
+			(parallel_leader_participation ? 1 : 0);
+		pgstromShareAsyncTasks(gts, gtss);
+	}
+	if (relation)
+		pg_atomic_init_u64(&gtss->ntuples_ready, 0);
 	if (gts->af_state)
 	{
 		Assert(RelationGetForm(relation)->relkind == RELKIND_FOREIGN_TABLE);
@@ -670,6 +1208,8 @@ pgstromInitDSMGpuTaskState(GpuTaskState *gts,
 	}
 	gts->gtss = gtss;
 	gts->pcxt = pcxt;
+	if (relation)
+		gts->ntuples_ready = &gtss->ntuples_ready;
 }
 
 /*
@@ -681,6 +1221,8 @@ pgstromInitWorkerGpuTaskState(GpuTaskState *gts, void *coordinate)
 	Relation	relation = gts->css.ss.ss_currentRelation;
 	GpuTaskSharedState *gtss = coordinate;
 
+	if (IsParallelWorker())
+		pgstromShareAsyncTasks(gts, gtss);
 	if (gts->af_state)
 	{
 		Assert(RelationGetForm(relation)->relkind == RELKIND_FOREIGN_TABLE);
@@ -695,6 +1237,8 @@ pgstromInitWorkerGpuTaskState(GpuTaskState *gts, void *coordinate)
 		PDS_init_heapscan_state(gts);
 	}
 	gts->gtss = gtss;
+	if (relation)
+		gts->ntuples_ready = &gtss->ntuples_ready;
 }
 
 /*
@@ -711,6 +1255,8 @@ pgstromReInitializeDSMGpuTaskState(GpuTaskState *gts)
 	gtss->pbs_startblock = InvalidBlockNumber;
 	gtss->pbs_nallocated = 0;
 	SpinLockRelease(&gtss->pbs_mutex);
+	if (relation)
+		pg_atomic_write_u64(&gtss->ntuples_ready, 0);
 
 	if (gts->af_state)
 		ExecReInitDSMArrowFdw(gts->af_state);
@@ -728,6 +1274,881 @@ pgstromInitGpuTask(GpuTaskState *gts, GpuTask *gtask)
 	gtask->program_id   = gts->program_id;
 	gtask->gts          = gts;
 	gtask->cpu_fallback = false;
+	gtask->chunk_sz     = gts->chunk_size;
+	gtask->task_seq     = gts->num_tasks_seq++;
+	gtask->stage_mask   = 0;
+}
+
+/*
+ * __pgstromStatLookup - find or assign a slot for the queryId
+ */
+static GpuTaskStatEntry *
+__pgstromStatLookup(uint64 query_id)
+{
+	int		i;
+
+	if (query_id == 0)
+		return NULL;
+	for (i=0; i < GPUTASK_STAT_NSLOTS; i++)
+	{
+		int			index = (query_id + i) % GPUTASK_STAT_NSLOTS;
+		GpuTaskStatEntry *entry = &gputask_stat_head->queries[index];
+		uint64		curr = pg_atomic_read_u64(&entry->key);
+
+		if (curr == 0)
+		{
+			if (pg_atomic_compare_exchange_u64(&entry->key, &curr, query_id))
+				return entry;
+		}
+		if (curr == query_id)
+			return entry;
+	}
+	return NULL;	/* no more slots; the statement is not accounted */
+}
+
+/*
+ * __pgstromStatGpuTaskEntries - entries per device and per statement
+ */
+static int
+__pgstromStatGpuTaskEntries(GpuTaskState *gts, cl_int cuda_dindex,
+							GpuTaskStatEntry **entries)
+{
+	int		nitems = 0;
+
+	if (!gputask_stat_head)
+		return 0;
+	if (cuda_dindex >= 0 && cuda_dindex < numDevAttrs)
+		entries[nitems++] = &gputask_stat_head->gpus[cuda_dindex];
+	entries[nitems] = __pgstromStatLookup(gts->query_id);
+	if (entries[nitems])
+		nitems++;
+	return nitems;
+}
+
+/*
+ * pgstromStatGpuTaskDone - called by GPU workers on completion of GpuTask
+ */
+void
+pgstromStatGpuTaskDone(GpuTask *gtask, cl_int cuda_dindex,
+					   uint64 gpu_time_us)
+{
+	GpuTaskStatEntry *entries[2];
+	uint64		kern_time_us = 0;
+	int			i, nitems;
+
+	nitems = __pgstromStatGpuTaskEntries(gtask->gts, cuda_dindex, entries);
+	for (i = GTSTAGE__KERN_EXEC; i <= GTSTAGE__KERN_RESUME; i++)
+	{
+		if ((gtask->stage_mask & (1U << i)) != 0)
+			kern_time_us += (uint64)(gtask->stage_ms[i] * 1000.0);
+	}
+	for (i=0; i < nitems; i++)
+	{
+		pg_atomic_fetch_add_u64(&entries[i]->num_tasks, 1);
+		pg_atomic_fetch_add_u64(&entries[i]->gpu_time_us, gpu_time_us);
+		pg_atomic_fetch_add_u64(&entries[i]->kern_time_us, kern_time_us);
+	}
+}
+
+/*
+ * pgstromStatGpuTaskRetry - called by GPU workers on lack of resources
+ */
+void
+pgstromStatGpuTaskRetry(GpuTask *gtask, cl_int cuda_dindex)
+{
+	GpuTaskStatEntry *entries[2];
+	int			i, nitems;
+
+	nitems = __pgstromStatGpuTaskEntries(gtask->gts, cuda_dindex, entries);
+	for (i=0; i < nitems; i++)
+		pg_atomic_fetch_add_u64(&entries[i]->num_retries, 1);
+}
+
+/*
+ * pgstromStatGpuTaskDMA - called by cb_process_task on DMA
+ */
+void
+pgstromStatGpuTaskDMA(GpuTask *gtask, cl_int cuda_dindex,
+					  size_t h2d_bytes, size_t d2h_bytes)
+{
+	GpuTaskStatEntry *entries[2];
+	int			i, nitems;
+
+	nitems = __pgstromStatGpuTaskEntries(gtask->gts, cuda_dindex, entries);
+	for (i=0; i < nitems; i++)
+	{
+		if (h2d_bytes > 0)
+			pg_atomic_fetch_add_u64(&entries[i]->h2d_bytes, h2d_bytes);
+		if (d2h_bytes > 0)
+			pg_atomic_fetch_add_u64(&entries[i]->d2h_bytes, d2h_bytes);
+	}
+}
+
+/*
+ * pgstromStatGpuTaskFallback - called by the backend on CPU fallback
+ */
+void
+pgstromStatGpuTaskFallback(GpuTaskState *gts)
+{
+	GpuTaskStatEntry *entries[2];
+	int			i, nitems;
+
+	nitems = __pgstromStatGpuTaskEntries(gts, gts->gcontext->cuda_dindex,
+										 entries);
+	for (i=0; i < nitems; i++)
+		pg_atomic_fetch_add_u64(&entries[i]->num_fallbacks, 1);
+}
+
+/*
+ * __pgstrom_stat_gpu_values
+ */
+static int
+__pgstrom_stat_gpu_values(GpuTaskStatEntry *entry, Datum *values)
+{
+	values[0] = Int64GetDatum(pg_atomic_read_u64(&entry->num_tasks));
+	values[1] = Int64GetDatum(pg_atomic_read_u64(&entry->num_fallbacks));
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&entry->num_retries));
+	values[3] = Float8GetDatum((double)
+							   pg_atomic_read_u64(&entry->gpu_time_us) / 1000.0);
+	values[4] = Float8GetDatum((double)
+							   pg_atomic_read_u64(&entry->kern_time_us) / 1000.0);
+	values[5] = Int64GetDatum(pg_atomic_read_u64(&entry->h2d_bytes));
+	values[6] = Int64GetDatum(pg_atomic_read_u64(&entry->d2h_bytes));
+	return 7;
+}
+
+static void
+__pgstrom_stat_gpu_tupdesc(TupleDesc tupdesc, AttrNumber anum)
+{
+	TupleDescInitEntry(tupdesc, anum++, "tasks", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, anum++, "fallbacks", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, anum++, "oom_retries", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, anum++, "gpu_time", FLOAT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, anum++, "kernel_time", FLOAT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, anum++, "h2d_bytes", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, anum++, "d2h_bytes", INT8OID, -1, 0);
+}
+
+/*
+ * pgstrom_stat_gpu_device
+ *
+ * It shows the cumulative statistics of GpuTasks per GPU device.
+ */
+Datum
+pgstrom_stat_gpu_device(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	GpuTaskStatEntry *entry;
+	HeapTuple	tuple;
+	Datum		values[14];
+	bool		isnull[14];
+	cl_uint	   *p_index;
+	cl_uint		index;
+	size_t		total_size;
+	size_t		curr_usage;
+	size_t		peak_usage;
+	int			j;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(14);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "gpu_id",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "gpu_name",
+						   TEXTOID, -1, 0);
+		__pgstrom_stat_gpu_tupdesc(tupdesc, (AttrNumber) 3);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 10, "ssd2gpu_bytes",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 11, "mem_total",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 12, "mem_usage",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 13, "mem_peak",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 14, "stats_reset",
+						   TIMESTAMPTZOID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+		fncxt->user_fctx = palloc0(sizeof(cl_uint));
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+	p_index = (cl_uint *) fncxt->user_fctx;
+
+	if (!gputask_stat_head || *p_index >= numDevAttrs)
+		SRF_RETURN_DONE(fncxt);
+	index = (*p_index)++;
+	entry = &gputask_stat_head->gpus[index];
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = Int32GetDatum(devAttrs[index].DEV_ID);
+	values[1] = CStringGetTextDatum(devAttrs[index].DEV_NAME);
+	j = 2 + __pgstrom_stat_gpu_values(entry, values + 2);
+	values[j++] = Int64GetDatum(nvmeIOStatGpuTotalBytes(index) -
+								pg_atomic_read_u64(&entry->ssd2gpu_base));
+	gpuMemUsageInfo(index, &total_size, &curr_usage, &peak_usage);
+	values[j++] = Int64GetDatum(total_size);
+	values[j++] = Int64GetDatum(curr_usage);
+	values[j++] = Int64GetDatum(peak_usage);
+	values[j++] = TimestampTzGetDatum(gputask_stat_head->stats_reset);
+	Assert(j == lengthof(values));
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_stat_gpu_device);
+
+/*
+ * pgstrom_stat_gpu_statements
+ *
+ * It shows the cumulative statistics of GpuTasks per queryId.
+ */
+Datum
+pgstrom_stat_gpu_statements(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	GpuTaskStatEntry *entry;
+	HeapTuple	tuple;
+	Datum		values[8];
+	bool		isnull[8];
+	cl_uint	   *p_index;
+	uint64		query_id;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(8);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "queryid",
+						   INT8OID, -1, 0);
+		__pgstrom_stat_gpu_tupdesc(tupdesc, (AttrNumber) 2);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+		fncxt->user_fctx = palloc0(sizeof(cl_uint));
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+	p_index = (cl_uint *) fncxt->user_fctx;
+
+	while (gputask_stat_head && *p_index < GPUTASK_STAT_NSLOTS)
+	{
+		entry = &gputask_stat_head->queries[(*p_index)++];
+		query_id = pg_atomic_read_u64(&entry->key);
+		if (query_id == 0)
+			continue;
+		memset(isnull, 0, sizeof(isnull));
+		values[0] = Int64GetDatum((int64)query_id);
+		__pgstrom_stat_gpu_values(entry, values + 1);
+
+		tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+		SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+	}
+	SRF_RETURN_DONE(fncxt);
+}
+PG_FUNCTION_INFO_V1(pgstrom_stat_gpu_statements);
+
+/*
+ * __pgstrom_stat_gpu_reset_entry
+ */
+static void
+__pgstrom_stat_gpu_reset_entry(GpuTaskStatEntry *entry)
+{
+	pg_atomic_write_u64(&entry->num_tasks, 0);
+	pg_atomic_write_u64(&entry->num_fallbacks, 0);
+	pg_atomic_write_u64(&entry->num_retries, 0);
+	pg_atomic_write_u64(&entry->gpu_time_us, 0);
+	pg_atomic_write_u64(&entry->kern_time_us, 0);
+	pg_atomic_write_u64(&entry->h2d_bytes, 0);
+	pg_atomic_write_u64(&entry->d2h_bytes, 0);
+}
+
+/*
+ * pgstrom_stat_gpu_reset
+ *
+ * It resets the cumulative statistics of GpuTasks. Slots of the statements
+ * are released, and the high-water mark of the device memory is reset by
+ * the current usage.
+ */
+Datum
+pgstrom_stat_gpu_reset(PG_FUNCTION_ARGS)
+{
+	int		i;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("only superuser can reset the GPU statistics")));
+	if (!gputask_stat_head)
+		PG_RETURN_VOID();
+	for (i=0; i < GPUTASK_STAT_NSLOTS; i++)
+	{
+		GpuTaskStatEntry *entry = &gputask_stat_head->queries[i];
+
+		__pgstrom_stat_gpu_reset_entry(entry);
+		pg_atomic_write_u64(&entry->key, 0);
+	}
+	for (i=0; i < numDevAttrs; i++)
+	{
+		GpuTaskStatEntry *entry = &gputask_stat_head->gpus[i];
+
+		__pgstrom_stat_gpu_reset_entry(entry);
+		pg_atomic_write_u64(&entry->ssd2gpu_base,
+							nvmeIOStatGpuTotalBytes(i));
+		gpuMemResetPeakUsage(i);
+	}
+	for (i=0; i < GPUTASK_COST_NKINDS; i++)
+	{
+		GpuTaskCostEntry *entry = &gputask_stat_head->costs[i];
+
+		pg_atomic_write_u64(&entry->nplans, 0);
+		pg_atomic_write_u64(&entry->est_cost, 0);
+		pg_atomic_write_u64(&entry->actual_us, 0);
+	}
+	gputask_stat_head->stats_reset = GetCurrentTimestamp();
+
+	PG_RETURN_VOID();
+}
+PG_FUNCTION_INFO_V1(pgstrom_stat_gpu_reset);
+
+/*
+ * GPU cost model calibration
+ *
+ * pgstrom.gpu_cost_calibrate() runs micro benchmarks on the GPU devices,
+ * then suggests pg_strom.gpu_setup_cost, gpu_dma_cost and gpu_operator_cost.
+ * Because all the cost parameters are relative to cpu_operator_cost, time
+ * of float8gt() by CPU is also measured as the reference of the cost unit.
+ */
+#define GPU_COST_CALIBRATE_NITEMS		(4U << 20)	/* 4M rows */
+#define GPU_COST_CALIBRATE_CPU_NITEMS	(1U << 20)	/* 1M rows */
+#define GPU_COST_CALIBRATE_NLOOPS		16
+#define GPU_COST_CALIBRATE_NTRIES		20
+
+static const char *gpu_cost_calibrate_kern_source =
+	"KERNEL_FUNCTION(void)\n"
+	"kern_cost_calibrate_noop(cl_uint *p_dummy)\n"
+	"{\n"
+	"}\n"
+	"\n"
+	"KERNEL_FUNCTION(void)\n"
+	"kern_cost_calibrate_quals(cl_uint nitems,\n"
+	"                          cl_uint nloops,\n"
+	"                          cl_double *values,\n"
+	"                          cl_uint *p_nmatched)\n"
+	"{\n"
+	"  DECL_KERNEL_CONTEXT(u);\n"
+	"  cl_uint     index;\n"
+	"  cl_uint     count = 0;\n"
+	"\n"
+	"  INIT_KERNEL_CONTEXT(&u.kcxt, NULL);\n"
+	"  for (index = get_global_id();\n"
+	"       index < nitems;\n"
+	"       index += get_global_size())\n"
+	"  {\n"
+	"    pg_float8_t datum;\n"
+	"    pg_float8_t bound;\n"
+	"    pg_bool_t   rv;\n"
+	"    cl_uint     j;\n"
+	"\n"
+	"    datum.isnull = false;\n"
+	"    datum.value = values[index];\n"
+	"    bound.isnull = false;\n"
+	"    for (j=0; j < nloops; j++)\n"
+	"    {\n"
+	"      bound.value = values[(index + j + 1) % nitems];\n"
+	"      rv = pgfn_float8gt(&u.kcxt, datum, bound);\n"
+	"      if (!rv.isnull && rv.value)\n"
+	"        count++;\n"
+	"    }\n"
+	"  }\n"
+	"  if (count > 0)\n"
+	"    atomicAdd(p_nmatched, count);\n"
+	"}\n";
+
+typedef struct
+{
+	cl_int		cuda_dindex;
+	const char *parameter;
+	double		current;		/* negative, if not a parameter */
+	double		recommended;	/* negative, if not a parameter */
+	double		measured_us;
+} gpu_cost_calibrate_info;
+
+/*
+ * __gpu_cost_calibrate_cpu - usec per float8gt() by CPU
+ */
+static double
+__gpu_cost_calibrate_cpu(void)
+{
+	FmgrInfo	flinfo;
+	double	   *values;
+	cl_uint		nitems = GPU_COST_CALIBRATE_CPU_NITEMS;
+	cl_uint		i, j, count = 0;
+	instr_time	tv1, tv2;
+
+	values = palloc(sizeof(double) * nitems);
+	for (i=0; i < nitems; i++)
+		values[i] = (double) random() / (double) MAX_RANDOM_VALUE;
+	fmgr_info(F_FLOAT8GT, &flinfo);
+
+	INSTR_TIME_SET_CURRENT(tv1);
+	for (i=0; i < nitems; i++)
+	{
+		for (j=0; j < GPU_COST_CALIBRATE_NLOOPS; j++)
+		{
+			Datum	bound = Float8GetDatum(values[(i + j + 1) % nitems]);
+
+			if (DatumGetBool(FunctionCall2(&flinfo,
+										   Float8GetDatum(values[i]),
+										   bound)))
+				count++;
+		}
+		CHECK_FOR_INTERRUPTS();
+	}
+	INSTR_TIME_SET_CURRENT(tv2);
+	INSTR_TIME_SUBTRACT(tv2, tv1);
+	pfree(values);
+	elog(DEBUG2, "calibration: %u of %u comparisons matched by CPU",
+		 count, nitems * GPU_COST_CALIBRATE_NLOOPS);
+
+	return (INSTR_TIME_GET_MICROSEC(tv2) /
+			((double) nitems * (double) GPU_COST_CALIBRATE_NLOOPS));
+}
+
+/*
+ * __gpu_cost_calibrate_launch - usec per synchronous kernel launch
+ */
+static double
+__gpu_cost_calibrate_launch(CUfunction kfunc,
+							cl_int grid_sz, cl_int block_sz,
+							void **kern_args, int ntries)
+{
+	instr_time	tv1, tv2;
+	CUresult	rc;
+	int			i;
+
+	INSTR_TIME_SET_CURRENT(tv1);
+	for (i=0; i < ntries; i++)
+	{
+		rc = cuLaunchKernel(kfunc,
+							grid_sz, 1, 1,
+							block_sz, 1, 1,
+							0,
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuLaunchKernel: %s", errorText(rc));
+		rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuStreamSynchronize: %s", errorText(rc));
+	}
+	INSTR_TIME_SET_CURRENT(tv2);
+	INSTR_TIME_SUBTRACT(tv2, tv1);
+
+	return INSTR_TIME_GET_MICROSEC(tv2) / (double) ntries;
+}
+
+/*
+ * __gpu_cost_calibrate_device
+ */
+static List *
+__gpu_cost_calibrate_device(cl_int cuda_dindex, double cpu_op_us)
+{
+	GpuContext *gcontext;
+	ProgramId	program_id;
+	CUmodule	cuda_module;
+	CUfunction	kern_noop;
+	CUfunction	kern_quals;
+	CUdeviceptr	m_values;
+	CUdeviceptr	m_nmatched;
+	CUdeviceptr	m_chunk;
+	void	   *h_chunk;
+	double	   *h_values;
+	size_t		chunk_sz = pgstrom_chunk_size();
+	cl_uint		nitems = GPU_COST_CALIBRATE_NITEMS;
+	cl_uint		nloops;
+	cl_int		grid_sz;
+	cl_int		block_sz;
+	void	   *kern_args[4];
+	double		setup_us;
+	double		launch_us;
+	double		quals1_us;
+	double		qualsN_us;
+	double		gpu_op_us;
+	double		dma_us;
+	double		cost_per_us = cpu_operator_cost / cpu_op_us;
+	instr_time	tv1, tv2;
+	CUresult	rc;
+	List	   *results = NIL;
+	gpu_cost_calibrate_info *info;
+	cl_uint		i;
+
+	/* build the program prior to the measurement */
+	gcontext = AllocGpuContext(cuda_dindex, false, false, false);
+	program_id = pgstrom_create_cuda_program(gcontext,
+											 0,
+											 0,
+											 gpu_cost_calibrate_kern_source,
+											 "",
+											 true,
+											 false);
+	/*
+	 * Setup cost; activation of GpuContext, load of the CUDA program and
+	 * the first kernel launch. Note that the CUDA context may be reused
+	 * from the context pool of the process, as usual queries do.
+	 */
+	INSTR_TIME_SET_CURRENT(tv1);
+	ActivateGpuContextNoWorkers(gcontext);
+	GPUCONTEXT_PUSH(gcontext);
+	cuda_module = GpuContextLookupModule(gcontext, program_id);
+	rc = cuModuleGetFunction(&kern_noop, cuda_module,
+							 "kern_cost_calibrate_noop");
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_quals, cuda_module,
+							 "kern_cost_calibrate_quals");
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuModuleGetFunction: %s", errorText(rc));
+
+	rc = gpuMemAllocManaged(gcontext,
+							&m_nmatched,
+							sizeof(cl_uint),
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	kern_args[0] = &m_nmatched;
+	(void) __gpu_cost_calibrate_launch(kern_noop, 1, 1, kern_args, 1);
+	INSTR_TIME_SET_CURRENT(tv2);
+	INSTR_TIME_SUBTRACT(tv2, tv1);
+	setup_us = INSTR_TIME_GET_MICROSEC(tv2);
+
+	/* kernel launch */
+	launch_us = __gpu_cost_calibrate_launch(kern_noop, 1, 1, kern_args,
+											GPU_COST_CALIBRATE_NTRIES);
+
+	/* DMA transfer of a chunk (host --> device) */
+	rc = gpuMemAllocHost(gcontext, &h_chunk, chunk_sz);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocHost: %s", errorText(rc));
+	memset(h_chunk, 0, chunk_sz);
+	rc = gpuMemAlloc(gcontext, &m_chunk, chunk_sz);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAlloc: %s", errorText(rc));
+	INSTR_TIME_SET_CURRENT(tv1);
+	for (i=0; i < GPU_COST_CALIBRATE_NTRIES; i++)
+	{
+		rc = cuMemcpyHtoD(m_chunk, h_chunk, chunk_sz);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+	}
+	INSTR_TIME_SET_CURRENT(tv2);
+	INSTR_TIME_SUBTRACT(tv2, tv1);
+	dma_us = (INSTR_TIME_GET_MICROSEC(tv2) /
+			  (double) GPU_COST_CALIBRATE_NTRIES);
+	gpuMemFree(gcontext, m_chunk);
+	gpuMemFreeHost(gcontext, h_chunk);
+
+	/*
+	 * Per-row qualifier evaluation; the difference between 1 and NLOOPS
+	 * comparisons per row is the cost of the device operators.
+	 */
+	rc = gpuMemAlloc(gcontext, &m_values, sizeof(double) * nitems);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAlloc: %s", errorText(rc));
+	h_values = palloc(sizeof(double) * nitems);
+	for (i=0; i < nitems; i++)
+		h_values[i] = (double) random() / (double) MAX_RANDOM_VALUE;
+	rc = cuMemcpyHtoD(m_values, h_values, sizeof(double) * nitems);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+	pfree(h_values);
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_quals,
+							 gcontext->cuda_device,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuOptimalBlockSize: %s", errorText(rc));
+	nloops = 1;
+	kern_args[0] = &nitems;
+	kern_args[1] = &nloops;
+	kern_args[2] = &m_values;
+	kern_args[3] = &m_nmatched;
+	(void) __gpu_cost_calibrate_launch(kern_quals, grid_sz, block_sz,
+									   kern_args, 1);	/* warm up */
+	quals1_us = __gpu_cost_calibrate_launch(kern_quals, grid_sz, block_sz,
+											kern_args,
+											GPU_COST_CALIBRATE_NTRIES);
+	nloops = GPU_COST_CALIBRATE_NLOOPS;
+	qualsN_us = __gpu_cost_calibrate_launch(kern_quals, grid_sz, block_sz,
+											kern_args,
+											GPU_COST_CALIBRATE_NTRIES);
+	GPUCONTEXT_POP(gcontext);
+	gpu_op_us = Max(qualsN_us - quals1_us, 0.0) /
+		((double) nitems * (double)(GPU_COST_CALIBRATE_NLOOPS - 1));
+	gpuMemFree(gcontext, m_values);
+	gpuMemFree(gcontext, m_nmatched);
+
+	pgstrom_put_cuda_program(gcontext, program_id);
+	PutGpuContext(gcontext);
+
+	/* results */
+	info = palloc(sizeof(gpu_cost_calibrate_info));
+	info->cuda_dindex = cuda_dindex;
+	info->parameter = "pg_strom.gpu_setup_cost";
+	info->current = pgstrom_gpu_setup_cost;
+	info->recommended = setup_us * cost_per_us;
+	info->measured_us = setup_us;
+	results = lappend(results, info);
+
+	/* cost per chunk contains a kernel launch */
+	info = palloc(sizeof(gpu_cost_calibrate_info));
+	info->cuda_dindex = cuda_dindex;
+	info->parameter = "pg_strom.gpu_dma_cost";
+	info->current = pgstrom_gpu_dma_cost;
+	info->recommended = (dma_us + launch_us) * cost_per_us;
+	info->measured_us = dma_us;
+	results = lappend(results, info);
+
+	info = palloc(sizeof(gpu_cost_calibrate_info));
+	info->cuda_dindex = cuda_dindex;
+	info->parameter = "pg_strom.gpu_operator_cost";
+	info->current = pgstrom_gpu_operator_cost;
+	info->recommended = gpu_op_us * cost_per_us;
+	info->measured_us = gpu_op_us;
+	results = lappend(results, info);
+
+	info = palloc(sizeof(gpu_cost_calibrate_info));
+	info->cuda_dindex = cuda_dindex;
+	info->parameter = "kernel_launch";
+	info->current = -1.0;
+	info->recommended = -1.0;
+	info->measured_us = launch_us;
+	results = lappend(results, info);
+
+	return results;
+}
+
+/*
+ * pgstrom_gpu_cost_calibrate
+ */
+Datum
+pgstrom_gpu_cost_calibrate(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	gpu_cost_calibrate_info *info;
+	HeapTuple	tuple;
+	Datum		values[5];
+	bool		isnull[5];
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		List		   *results = NIL;
+		double			cpu_op_us;
+		int				i;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		if (!superuser())
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+					 errmsg("only superuser can run the cost calibration")));
+		if (!PG_ARGISNULL(0))
+		{
+			i = PG_GETARG_INT32(0);
+			if (i < 0 || i >= numDevAttrs)
+				elog(ERROR, "GPU device %d does not exist", i);
+		}
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(5);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "device",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "parameter",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "current",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "recommended",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "measured_us",
+						   FLOAT8OID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		/* reference of the cost unit */
+		cpu_op_us = __gpu_cost_calibrate_cpu();
+		if (cpu_op_us <= 0.0 || cpu_operator_cost <= 0.0)
+			elog(ERROR, "unable to measure the cost unit");
+		info = palloc(sizeof(gpu_cost_calibrate_info));
+		info->cuda_dindex = -1;
+		info->parameter = "cpu_operator_cost";
+		info->current = cpu_operator_cost;
+		info->recommended = -1.0;
+		info->measured_us = cpu_op_us;
+		results = lappend(results, info);
+
+		for (i=0; i < numDevAttrs; i++)
+		{
+			if (!PG_ARGISNULL(0) && PG_GETARG_INT32(0) != i)
+				continue;
+			results = list_concat(results,
+								  __gpu_cost_calibrate_device(i, cpu_op_us));
+		}
+		/* save the cost unit for the runtime feedback */
+		if (gputask_stat_head)
+		{
+			SpinLockAcquire(&gputask_stat_head->calib_lock);
+			gputask_stat_head->calib_cost_per_ms
+				= 1000.0 * cpu_operator_cost / cpu_op_us;
+			gputask_stat_head->calib_time = GetCurrentTimestamp();
+			SpinLockRelease(&gputask_stat_head->calib_lock);
+		}
+		fncxt->user_fctx = results;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+
+	if (fncxt->call_cntr >= list_length((List *) fncxt->user_fctx))
+		SRF_RETURN_DONE(fncxt);
+	info = list_nth((List *) fncxt->user_fctx, fncxt->call_cntr);
+
+	memset(isnull, 0, sizeof(isnull));
+	if (info->cuda_dindex >= 0)
+		values[0] = Int32GetDatum(devAttrs[info->cuda_dindex].DEV_ID);
+	else
+		isnull[0] = true;
+	values[1] = CStringGetTextDatum(info->parameter);
+	if (info->current >= 0.0)
+		values[2] = Float8GetDatum(info->current);
+	else
+		isnull[2] = true;
+	if (info->recommended >= 0.0)
+		values[3] = Float8GetDatum(info->recommended);
+	else
+		isnull[3] = true;
+	values[4] = Float8GetDatum(info->measured_us);
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gpu_cost_calibrate);
+
+/*
+ * pgstrom_gpu_cost_feedback_info
+ *
+ * It shows the runtime feedback to the cost model per GpuTaskKind.
+ */
+Datum
+pgstrom_gpu_cost_feedback_info(PG_FUNCTION_ARGS)
+{
+	static const char *task_labels[GPUTASK_COST_NKINDS] = {
+		"GpuScan", "GpuJoin", "GpuPreAgg", "GpuSort",
+	};
+	FuncCallContext *fncxt;
+	GpuTaskCostEntry *entry;
+	HeapTuple	tuple;
+	Datum		values[7];
+	bool		isnull[7];
+	uint64		nplans;
+	double		ratio;
+	int			index;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(7);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "task",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "plans",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "est_cost",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "actual_ms",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "cost_ratio",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "applied",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "calibrated",
+						   TIMESTAMPTZOID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+
+	if (!gputask_stat_head || fncxt->call_cntr >= GPUTASK_COST_NKINDS)
+		SRF_RETURN_DONE(fncxt);
+	index = fncxt->call_cntr;
+	entry = &gputask_stat_head->costs[index];
+
+	memset(isnull, 0, sizeof(isnull));
+	ratio = __pgstrom_gpu_cost_ratio((GpuTaskKind) index, &nplans);
+	values[0] = CStringGetTextDatum(task_labels[index]);
+	values[1] = Int64GetDatum(nplans);
+	if (nplans > 0)
+	{
+		values[2] = Float8GetDatum((double)
+								   pg_atomic_read_u64(&entry->est_cost) /
+								   (1000.0 * (double) nplans));
+		values[3] = Float8GetDatum((double)
+								   pg_atomic_read_u64(&entry->actual_us) /
+								   (1000.0 * (double) nplans));
+	}
+	else
+	{
+		isnull[2] = true;
+		isnull[3] = true;
+	}
+	if (ratio > 0.0)
+		values[4] = Float8GetDatum(ratio);
+	else
+		isnull[4] = true;
+	values[5] = Float8GetDatum(pgstrom_gpu_cost_feedback((GpuTaskKind) index));
+	SpinLockAcquire(&gputask_stat_head->calib_lock);
+	if (gputask_stat_head->calib_time != 0)
+		values[6] = TimestampTzGetDatum(gputask_stat_head->calib_time);
+	else
+		isnull[6] = true;
+	SpinLockRelease(&gputask_stat_head->calib_lock);
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gpu_cost_feedback_info);
+
+/*
+ * pgstrom_startup_gputasks
+ */
+static void
+pgstrom_startup_gputasks(void)
+{
+	size_t		required;
+	bool		found;
+
+	if (shmem_startup_next)
+		(*shmem_startup_next)();
+
+	required = STROMALIGN(offsetof(GpuTaskStatHead, gpus[numDevAttrs]));
+	gputask_stat_head = ShmemInitStruct("GpuTask Statistics",
+										required, &found);
+	if (found)
+		elog(ERROR, "Bug? GpuTask Statistics exists");
+	memset(gputask_stat_head, 0, required);
+	gputask_stat_head->stats_reset = GetCurrentTimestamp();
+	SpinLockInit(&gputask_stat_head->calib_lock);
 }
 
 /*
@@ -736,5 +2157,36 @@ pgstromInitGpuTask(GpuTaskState *gts, GpuTask *gtask)
 void
 pgstrom_init_gputasks(void)
 {
-	/* nothing to do */
+	DefineCustomBoolVariable("pg_strom.gpu_cost_feedback",
+							 "Applies runtime feedback to the cost of GPU nodes",
+							 NULL,
+							 &pgstrom_enable_gpu_cost_feedback,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	DefineCustomBoolVariable("pg_strom.parallel_share_async_tasks",
+							 "Parallel workers share pg_strom.local_max_async_tasks with the leader",
+							 NULL,
+							 &pgstrom_parallel_share_async_tasks,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	DefineCustomBoolVariable("pg_strom.enable_async_append",
+							 "Enables to launch GpuTasks of the next Append sub-plan on ahead",
+							 NULL,
+							 &pgstrom_enable_async_append,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* shared memory for the cumulative statistics */
+	RequestAddinShmemSpace(STROMALIGN(offsetof(GpuTaskStatHead,
+											   gpus[numDevAttrs])));
+	shmem_startup_next = shmem_startup_hook;
+	shmem_startup_hook = pgstrom_startup_gputasks;
+	/* executor hook for async Append */
+	executor_start_next = ExecutorStart_hook;
+	ExecutorStart_hook = pgstrom_executor_start;
 }
@@ -37,6 +37,8 @@ typedef struct
 	cl_long			index_nblocks;
 	Cost			inner_cost;		/* cost to setup inner heap/hash */
 	cl_int		   *sibling_param_id; /* only if partition-wise join child */
+	cl_int			inner_nbatches;	/* number of inner hash batches */
+	cl_int			batch_depth;	/* depth of the split hash table, or 0 */
 	struct {
 		JoinType	join_type;		/* one of JOIN_* */
 		double		join_nrows;		/* intermediate nrows in this depth */
@@ -82,6 +84,27 @@ typedef struct
 	/* supplemental information of ps_tlist */
 	List	   *ps_src_depth;	/* source depth of the ps_tlist entry */
 	List	   *ps_src_resno;	/* source resno of the ps_tlist entry */
+	cl_int		tuple_bound;	/* LIMIT bound pushed down, or -1 */
+	cl_int		inner_nbatches;	/* number of inner hash batches */
+	cl_int		batch_depth;	/* depth of the split hash table, or 0 */
+	List	   *bloom_filters;	/* bloom filter is usable, for each depth */
+	List	   *range_attnums;	/* outer Arrow_Fdw column to be pruned by
+								 * the inner key range, for each depth */
+	List	   *device_builds;	/* hash table is built on the device,
+								 * for each depth */
+	List	   *batch_bounds;	/* upper bounds of the inner key for each
+								 * batch, if split by the key range */
+	List	   *feedback_keys;	/* fingerprint of the join, for each depth */
+	List	   *prune_keys;		/* index of the hash key to prune inner rows
+								 * by the outer partition, for each depth */
+	List	   *prune_conds;	/* list of (strategy, Const) pairs to prune
+								 * inner rows, for each depth */
+	List	   *nestloop_keys;	/* inner key to sort the inner rows of
+								 * nestloop, for each depth */
+	List	   *nestloop_lower_quals; /* join quals to restrict the lower
+									   * bound of the nestloop key */
+	List	   *nestloop_upper_quals; /* join quals to restrict the upper
+									   * bound of the nestloop key */
 } GpuJoinInfo;
 
 static inline void
@@ -120,6 +143,19 @@ form_gpujoin_info(CustomScan *cscan, GpuJoinInfo *gj_info)
 
 	privs = lappend(privs, gj_info->ps_src_depth);
 	privs = lappend(privs, gj_info->ps_src_resno);
+	privs = lappend(privs, makeInteger(gj_info->tuple_bound));
+	privs = lappend(privs, makeInteger(gj_info->inner_nbatches));
+	privs = lappend(privs, makeInteger(gj_info->batch_depth));
+	privs = lappend(privs, gj_info->bloom_filters);
+	privs = lappend(privs, gj_info->range_attnums);
+	privs = lappend(privs, gj_info->device_builds);
+	privs = lappend(privs, gj_info->batch_bounds);
+	privs = lappend(privs, gj_info->feedback_keys);
+	privs = lappend(privs, gj_info->prune_keys);
+	privs = lappend(privs, gj_info->prune_conds);
+	exprs = lappend(exprs, gj_info->nestloop_keys);
+	exprs = lappend(exprs, gj_info->nestloop_lower_quals);
+	exprs = lappend(exprs, gj_info->nestloop_upper_quals);
 
 	cscan->custom_private = privs;
 	cscan->custom_exprs = exprs;
@@ -164,6 +200,19 @@ deform_gpujoin_info(CustomScan *cscan)
 
 	gj_info->ps_src_depth = list_nth(privs, pindex++);
 	gj_info->ps_src_resno = list_nth(privs, pindex++);
+	gj_info->tuple_bound = intVal(list_nth(privs, pindex++));
+	gj_info->inner_nbatches = intVal(list_nth(privs, pindex++));
+	gj_info->batch_depth = intVal(list_nth(privs, pindex++));
+	gj_info->bloom_filters = list_nth(privs, pindex++);
+	gj_info->range_attnums = list_nth(privs, pindex++);
+	gj_info->device_builds = list_nth(privs, pindex++);
+	gj_info->batch_bounds = list_nth(privs, pindex++);
+	gj_info->feedback_keys = list_nth(privs, pindex++);
+	gj_info->prune_keys = list_nth(privs, pindex++);
+	gj_info->prune_conds = list_nth(privs, pindex++);
+	gj_info->nestloop_keys = list_nth(exprs, eindex++);
+	gj_info->nestloop_lower_quals = list_nth(exprs, eindex++);
+	gj_info->nestloop_upper_quals = list_nth(exprs, eindex++);
 	Assert(pindex == list_length(privs));
 	Assert(eindex == list_length(exprs));
 
@@ -196,6 +245,32 @@ typedef struct
 	 */
 	List			   *hash_outer_keys;
 	List			   *hash_inner_keys;
+	cl_int				hash_nbatches;		/* number of batches, if split */
+	cl_int				hash_curr_batch;	/* current batch to be loaded */
+	Datum			   *batch_bounds;		/* upper bounds of the batches,
+											 * if split by the key range */
+	uint32				feedback_key;		/* fingerprint of the depth */
+
+	/* conditions to prune inner rows never matched to the outer partition */
+	int					nprune_conds;
+	ExprState		   *prune_key;
+	TypeCacheEntry	   *prune_tcache;
+	int				   *prune_strategy;
+	Datum			   *prune_values;
+	cl_bool				bloom_filter;		/* build bloom filter, if true */
+	cl_bool				device_build;		/* build hash table on GPU */
+
+	/* key to sort the inner rows of nestloop, if any */
+	ExprState		   *nestloop_key;
+	TypeCacheEntry	   *nestloop_tcache;
+	cl_uint				sorted_nitems;		/* number of non-NULL keys */
+
+	/* range of the inner keys, to prune outer Arrow_Fdw RecordBatches */
+	AttrNumber			range_attnum;
+	TypeCacheEntry	   *range_tcache;
+	bool				range_valid;
+	Datum				range_min;
+	Datum				range_max;
 
 	/* CPU Fallback related */
 	AttrNumber		   *inner_dst_resno;
@@ -204,6 +279,10 @@ typedef struct
 	cl_long				fallback_inner_index;
 	pg_crc32			fallback_inner_hash;
 	cl_bool				fallback_inner_matched;
+	/* CPU hash index of the inner buffer, built on the first fallback */
+	cl_ulong		   *fallback_hindex;	/* sorted (hash, row_index) */
+	kern_data_store	   *fallback_hindex_kds;	/* kds_in of the hindex */
+	cl_long				fallback_hindex_pos;	/* or -1, if chain walk */
 } innerState;
 
 typedef struct
@@ -219,6 +298,16 @@ typedef struct
 	GpuContext	  **m_kmrels_gcontext;	/* only master process */
 	shared_mmap_segment *seg_kmrels;
 	cl_int			curr_outer_depth;
+	cl_int			inner_nbatches;		/* number of inner hash batches */
+	cl_int			curr_batch;			/* current batch of inner hash */
+	cl_uint			pstack_nrooms;		/* pseudo-stack entries per depth */
+	bool			shared_pstack;		/* pseudo-stack on shared memory */
+	char		   *inner_cache_key;	/* key of the inner buffer cache,
+										 * or NULL if not cacheable */
+	List		   *inner_cache_relids;	/* relations in the inner plans */
+	struct GpuJoinInnerCacheRef *inner_cache; /* reference to the inner
+											   * buffer cache, if any */
+	bool			inner_cache_hit;	/* true, if inner cache is used */
 
 	/*
 	 * Expressions to be used in the CPU fallback path
@@ -292,6 +381,68 @@ struct GpuJoinSiblingState
 };
 typedef struct GpuJoinSiblingState	GpuJoinSiblingState;
 
+/*
+ * GpuJoinInnerCache - inner buffer kept on the preserved device memory
+ * for reuse by the later queries (shared structure)
+ */
+#define GPUJOIN_INNER_CACHE_NSLOTS		256
+typedef struct
+{
+	dlist_node		chain;		/* link to the hash slot */
+	dlist_node		lru_chain;	/* link to the LRU list */
+	uint32			refcnt;		/* protected by the lock */
+	bool			is_valid;	/* false, if already invalidated */
+	uint32			hash;
+	Oid				database_oid;
+	int				cuda_dindex;
+	CUipcMemHandle	ipc_mhandle;
+	size_t			nbytes;		/* size of device memory */
+	TimestampTz		last_used;
+	int				nrels;		/* number of relations in the inner plans */
+	Oid			   *relids;
+	char		   *key;
+} GpuJoinInnerCache;
+
+typedef struct
+{
+	LWLock			lock;
+	dlist_head		hash_slots[GPUJOIN_INNER_CACHE_NSLOTS];
+	dlist_head		lru_list;
+} GpuJoinInnerCacheHead;
+
+/*
+ * GpuJoinFeedback - observed ratio of the output rows to the input rows
+ * for each depth, keyed by the fingerprint of the join (shared structure)
+ */
+#define GPUJOIN_FEEDBACK_NSLOTS			4096
+#define GPUJOIN_FEEDBACK_MIN_NROWS		1000
+typedef struct
+{
+	uint32			hash;		/* fingerprint of the depth */
+	Oid				database_oid;
+	uint32			nloops;		/* number of observations */
+	double			nrows_ratio;
+} GpuJoinFeedbackItem;
+
+typedef struct
+{
+	LWLock			lock;
+	GpuJoinFeedbackItem items[GPUJOIN_FEEDBACK_NSLOTS];
+} GpuJoinFeedbackHead;
+
+/*
+ * GpuJoinInnerCacheRef - reference to the inner buffer cache by the
+ * GpuJoin of this backend (private structure)
+ */
+struct GpuJoinInnerCacheRef
+{
+	dlist_node		chain;		/* link to gpujoin_inner_cache_refs */
+	GpuJoinInnerCache *entry;
+	GpuContext	   *gcontext;
+	CUdeviceptr		m_kmrels;	/* mapped on @gcontext */
+};
+typedef struct GpuJoinInnerCacheRef	GpuJoinInnerCacheRef;
+
 /*
  * GpuJoinRuntimeStat - shared runtime statistics
  */
@@ -323,21 +474,65 @@ typedef struct
 	kern_gpujoin	kern;		/* kern_gpujoin of this request */
 } GpuJoinTask;
 
+/*
+ * Expected size of the inner hash table per batch, when GpuHashJoin splits
+ * a large inner relation; it leaves margin for the 1.5GB limitation.
+ */
+#define GPUJOIN_BATCH_CHUNK_SIZE		(1UL << 30)
+
 /* static variables */
 static set_join_pathlist_hook_type set_join_pathlist_next;
 static CustomPathMethods	gpujoin_path_methods;
 static CustomScanMethods	gpujoin_plan_methods;
 static CustomExecMethods	gpujoin_exec_methods;
 static bool					enable_gpunestloop;				/* GUC */
+static bool					enable_gpunestloop_sorted;		/* GUC */
 static bool					enable_gpuhashjoin;				/* GUC */
 static bool					enable_partitionwise_gpujoin;	/* GUC */
+static bool					enable_gpuhashjoin_batches;		/* GUC */
+static bool					enable_gpujoin_bloom_filter;	/* GUC */
+static bool					enable_gpuhashjoin_device_build;	/* GUC */
+static bool					enable_gpujoin_multi_gpu;		/* GUC */
+static bool					enable_gpuhashjoin_skew;		/* GUC */
+static bool					enable_gpuhashjoin_range_batches;	/* GUC */
+static bool					enable_gpujoin_shared_pstack;	/* GUC */
+static bool					enable_gpujoin_partition_prune;	/* GUC */
+static bool					enable_gpujoin_inner_cache;		/* GUC */
+static int					gpujoin_inner_cache_size_kb;	/* GUC */
+static int					gpujoin_dst_chains;				/* GUC */
+static GpuJoinInnerCacheHead *gpujoin_inner_cache_head = NULL;
+static bool					enable_gpujoin_feedback;		/* GUC */
+static GpuJoinFeedbackHead *gpujoin_feedback_head = NULL;
+static dlist_head			gpujoin_inner_cache_refs;
+static shmem_startup_hook_type shmem_startup_next = NULL;
+
+/*
+ * Inner relations smaller than the threshold are hashed by CPU, because
+ * the device kernel and write-back of the hash table are not cheap.
+ */
+#define GPUJOIN_DEVICE_BUILD_THRESHOLD		100000.0
+
+/*
+ * Inner hash table with more rows than the threshold is sampled to detect
+ * heavy-hitter keys; that is also the minimum estimated number of rows per
+ * heavy-hitter key.
+ */
+#define GPUJOIN_SKEW_THRESHOLD				256
+#define GPUJOIN_SKEW_NSAMPLES				4096
+
+/*
+ * Number of pseudo-stack entries per depth on the global memory
+ */
+#define GPUJOIN_PSTACK_NROOMS				2048
 
 /* static functions */
 static void gpujoin_switch_task(GpuTaskState *gts, GpuTask *gtask);
+static bool gpujoin_cpu_task(GpuTaskState *gts, GpuTask *gtask);
 static GpuTask *gpujoin_next_task(GpuTaskState *gts);
 static GpuTask *gpujoin_terminator_task(GpuTaskState *gts,
 										cl_bool *task_is_ready);
 static TupleTableSlot *gpujoin_next_tuple(GpuTaskState *gts);
+static bool gpujoin_async_begin(GpuTaskState *gts);
 static cl_uint get_tuple_hashvalue(innerState *istate,
 								   bool is_inner_hashkeys,
 								   TupleTableSlot *slot,
@@ -353,6 +548,8 @@ static void createGpuJoinSharedState(GpuJoinState *gjs,
 									 ParallelContext *pcxt,
 									 void *coordinate);
 static void gpujoinColocateOuterJoinMapsToHost(GpuJoinState *gjs);
+static void gpujoin_inner_cache_init_key(GpuJoinState *gjs,
+										 GpuJoinInfo *gj_info);
 
 /*
  * misc declarations
@@ -534,6 +731,123 @@ estimate_inner_buffersize(PlannerInfo *root,
 	return inner_total_sz;
 }
 
+/*
+ * gpujoin_feedback_key
+ *
+ * It computes fingerprint of the join at a particular depth; by the
+ * relations already joined, the inner relation, join type and qualifiers.
+ */
+static uint32
+gpujoin_feedback_key(PlannerInfo *root,
+					 Relids outer_relids,
+					 Path *scan_path,
+					 JoinType join_type,
+					 List *join_quals)
+{
+	RelOptInfo *scan_rel = scan_path->parent;
+	Relids		relids = bms_union(outer_relids, scan_rel->relids);
+	StringInfoData buf;
+	ListCell   *lc;
+	uint32		hash;
+	int			k = -1;
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf, "join=%d;rels=", (int)join_type);
+	while ((k = bms_next_member(relids, k)) >= 0)
+	{
+		RangeTblEntry *rte = root->simple_rte_array[k];
+
+		if (rte->rtekind == RTE_RELATION)
+			appendStringInfo(&buf, "%u,", rte->relid);
+		else
+			appendStringInfo(&buf, "%d:%d,", k, (int)rte->rtekind);
+	}
+	appendStringInfoString(&buf, ";quals=");
+	foreach (lc, join_quals)
+	{
+		RestrictInfo   *rinfo = lfirst(lc);
+
+		appendStringInfoString(&buf, nodeToString(rinfo->clause));
+	}
+	if (scan_rel->reloptkind == RELOPT_BASEREL)
+	{
+		appendStringInfoString(&buf, ";scan=");
+		foreach (lc, scan_rel->baserestrictinfo)
+		{
+			RestrictInfo   *rinfo = lfirst(lc);
+
+			appendStringInfoString(&buf, nodeToString(rinfo->clause));
+		}
+	}
+	hash = DatumGetUInt32(hash_any((unsigned char *)buf.data, buf.len));
+	pfree(buf.data);
+	bms_free(relids);
+
+	return hash;
+}
+
+/*
+ * gpujoin_feedback_lookup
+ *
+ * It looks up the ratio of output rows to input rows at a depth, observed
+ * by the former executions.
+ */
+static bool
+gpujoin_feedback_lookup(uint32 hash, double *p_nrows_ratio)
+{
+	GpuJoinFeedbackItem *fitem;
+	bool		found = false;
+
+	if (!enable_gpujoin_feedback || !gpujoin_feedback_head)
+		return false;
+	fitem = &gpujoin_feedback_head->items[hash % GPUJOIN_FEEDBACK_NSLOTS];
+	LWLockAcquire(&gpujoin_feedback_head->lock, LW_SHARED);
+	if (fitem->nloops > 0 &&
+		fitem->hash == hash &&
+		fitem->database_oid == MyDatabaseId)
+	{
+		*p_nrows_ratio = fitem->nrows_ratio;
+		found = true;
+	}
+	LWLockRelease(&gpujoin_feedback_head->lock);
+
+	return found;
+}
+
+/*
+ * gpujoin_feedback_update
+ *
+ * It saves the ratio of output rows to input rows at a depth. The new
+ * observation is blended to the older ones, not to swing the plan by
+ * a particular execution.
+ */
+static void
+gpujoin_feedback_update(uint32 hash, double nrows_ratio)
+{
+	GpuJoinFeedbackItem *fitem;
+
+	if (!enable_gpujoin_feedback || !gpujoin_feedback_head)
+		return;
+	fitem = &gpujoin_feedback_head->items[hash % GPUJOIN_FEEDBACK_NSLOTS];
+	LWLockAcquire(&gpujoin_feedback_head->lock, LW_EXCLUSIVE);
+	if (fitem->nloops > 0 &&
+		fitem->hash == hash &&
+		fitem->database_oid == MyDatabaseId)
+	{
+		fitem->nrows_ratio = (fitem->nrows_ratio + nrows_ratio) / 2.0;
+		fitem->nloops++;
+	}
+	else
+	{
+		/* older entry on the same slot is replaced */
+		fitem->hash = hash;
+		fitem->database_oid = MyDatabaseId;
+		fitem->nloops = 1;
+		fitem->nrows_ratio = nrows_ratio;
+	}
+	LWLockRelease(&gpujoin_feedback_head->lock);
+}
+
 /*
  * cost_gpujoin
  *
@@ -554,10 +868,13 @@ cost_gpujoin(PlannerInfo *root,
 	Cost		startup_delay;
 	Size		inner_buffer_sz = 0;
 	double		gpu_ratio = pgstrom_gpu_operator_cost / cpu_operator_cost;
+	double		cost_ratio;
 	double		parallel_divisor = 1.0;
 	double		num_chunks;
 	double		outer_ntuples = outer_path->rows;
 	int			i, num_rels = gpath->num_rels;
+	int			nbatches = 1;
+	bool		has_outer_join = false;
 	bool		retval = false;
 
 	/*
@@ -604,6 +921,15 @@ cost_gpujoin(PlannerInfo *root,
 												outer_path,
 												gpath,
 												num_chunks);
+	gpath->inner_nbatches = 1;
+	gpath->batch_depth = 0;
+	for (i=0; i < num_rels; i++)
+	{
+		if (gpath->inners[i].join_type == JOIN_RIGHT ||
+			gpath->inners[i].join_type == JOIN_FULL)
+			has_outer_join = true;
+	}
+
 	/*
 	 * Cost for each depth
 	 */
@@ -627,6 +953,28 @@ cost_gpujoin(PlannerInfo *root,
 		 * least 3bit because row-/hash-item shall be always put on 64bit
 		 * aligned location.
 		 */
+		if (ichunk_size >= 0x60000000UL && nbatches == 1 &&
+			enable_gpuhashjoin_batches &&
+			hash_quals != NIL &&
+			gpath->inners[i].join_type == JOIN_INNER &&
+			!has_outer_join &&
+			parallel_nworkers == 0 &&
+			!gpath->sibling_param_id)
+		{
+			/*
+			 * If the inner hash table is too large, we split it into
+			 * multiple batches by the hash value, then rescan the outer
+			 * relation for each batch. An outer row never matches with
+			 * inner rows in the other batches, so the result is identical.
+			 */
+			nbatches = (ichunk_size + GPUJOIN_BATCH_CHUNK_SIZE - 1)
+				/ GPUJOIN_BATCH_CHUNK_SIZE;
+			ichunk_size = ichunk_size / nbatches + BLCKSZ;
+			inner_buffer_sz -= (gpath->inners[i].ichunk_size - ichunk_size);
+			gpath->inners[i].ichunk_size = ichunk_size;
+			gpath->inner_nbatches = nbatches;
+			gpath->batch_depth = i + 1;
+		}
 		if (ichunk_size >= 0x60000000UL)
 		{
 			if (client_min_messages <= DEBUG1 || log_min_messages <= DEBUG1)
@@ -717,6 +1065,13 @@ cost_gpujoin(PlannerInfo *root,
 	inner_cost += ((double)inner_buffer_sz /
 				   (double)pgstrom_chunk_size()) * pgstrom_gpu_dma_cost;
 
+	/* outer/inner relations are rescanned for each batch */
+	if (nbatches > 1)
+	{
+		run_cost *= (double)nbatches;
+		inner_cost *= (double)nbatches;
+	}
+
 	/* cost for GPU projection */
 	startup_cost += joinrel->reltarget->cost.startup;
 	run_cost += (joinrel->reltarget->cost.per_tuple +
@@ -732,6 +1087,15 @@ cost_gpujoin(PlannerInfo *root,
 	 */
 	startup_delay = run_cost * (1.0 / num_chunks);
 
+	/*
+	 * runtime feedback to the cost model, if any
+	 */
+	cost_ratio = pgstrom_gpu_cost_feedback(GpuTaskKind_GpuJoin);
+	startup_cost *= cost_ratio;
+	inner_cost *= cost_ratio;
+	run_cost *= cost_ratio;
+	startup_delay *= cost_ratio;
+
 	/*
 	 * Put cost value on the gpath.
 	 */
@@ -768,7 +1132,9 @@ cost_gpujoin(PlannerInfo *root,
 			appendStringInfo(&buf, " %s%s ",
 							 join_type == JOIN_FULL ? "F" :
 							 join_type == JOIN_LEFT ? "L" :
-							 join_type == JOIN_RIGHT ? "R" : "I",
+							 join_type == JOIN_RIGHT ? "R" :
+							 join_type == JOIN_SEMI ? "S" :
+							 join_type == JOIN_ANTI ? "A" : "I",
 							 is_nestloop ? "NL" : "HJ");
 		}
 		__dump_gpujoin_rel(&buf, root, outer_path->parent);
@@ -848,7 +1214,9 @@ create_gpujoin_path(PlannerInfo *root,
 			hash_quals = ip_item->hash_quals;
 		else if (enable_gpunestloop &&
 				 (ip_item->join_type == JOIN_INNER ||
-				  ip_item->join_type == JOIN_LEFT))
+				  ip_item->join_type == JOIN_LEFT ||
+				  ip_item->join_type == JOIN_SEMI ||
+				  ip_item->join_type == JOIN_ANTI))
 			hash_quals = NIL;
 		else
 		{
@@ -867,6 +1235,32 @@ create_gpujoin_path(PlannerInfo *root,
 	}
 	Assert(i == num_rels);
 
+	/*
+	 * Number of rows for each depth is replaced by the ratio observed on
+	 * the former executions, if any. It allows to avoid bad join order
+	 * by wrong estimation of the join selectivity.
+	 */
+	if (enable_gpujoin_feedback && gpujoin_feedback_head)
+	{
+		Relids		relids = outer_path->parent->relids;
+		double		nrows_in = outer_path->parent->rows;
+		double		nrows_ratio;
+
+		for (i=0; i < num_rels; i++)
+		{
+			uint32	hash = gpujoin_feedback_key(root, relids,
+												gjpath->inners[i].scan_path,
+												gjpath->inners[i].join_type,
+												gjpath->inners[i].join_quals);
+			if (gpujoin_feedback_lookup(hash, &nrows_ratio))
+				gjpath->inners[i].join_nrows = clamp_row_est(nrows_in *
+															 nrows_ratio);
+			nrows_in = gjpath->inners[i].join_nrows;
+			relids = bms_union(relids,
+							   gjpath->inners[i].scan_path->parent->relids);
+		}
+	}
+
 	/* Try to pull up outer scan if enough simple */
 	pgstrom_pullup_outer_scan(root, outer_path,
 							  &gjpath->outer_relid,
@@ -1841,6 +2235,9 @@ build_partitionwise_gpujoin_leafs(PlannerInfo *root,
 		{
 			GpuJoinPath *gpath = lfirst(cell);
 
+			/* batched inner hash tables cannot be shared */
+			if (gpath->inner_nbatches > 1)
+				goto gpujoin_not_compatible;
 			if (cell == list_head(new_append_subpaths))
 			{
 				num_rels = gpath->num_rels;
@@ -1949,6 +2346,75 @@ gpujoin_not_compatible:
 	return new_append_subpaths;
 }
 
+/*
+ * is_simple_appendrel_path
+ *
+ * It checks whether the Append is an inheritance tree or a flattened
+ * UNION ALL, not a partitioned table, but all the children are plain
+ * tables or Arrow_Fdw foreign tables. GpuJoin/GpuPreAgg can be pushed
+ * down to the children as if they are partition leafs, then the child
+ * scan is pulled up into the GpuJoin/GpuPreAgg.
+ * A child of flattened UNION ALL may project expressions or constants,
+ * so we also require that all the translated_vars are plain Vars of the
+ * child relation, to map the attributes of the parent as is.
+ */
+static bool
+__is_simple_appendrel_child(PlannerInfo *root, RelOptInfo *subrel)
+{
+	ListCell   *lc1, *lc2;
+
+	foreach (lc1, root->append_rel_list)
+	{
+		AppendRelInfo *apinfo = lfirst(lc1);
+
+		if (apinfo->child_relid != subrel->relid)
+			continue;
+		foreach (lc2, apinfo->translated_vars)
+		{
+			Var	   *var = lfirst(lc2);
+
+			/* NULL for dropped columns */
+			if (!var)
+				continue;
+			if (!IsA(var, Var) ||
+				var->varno != subrel->relid ||
+				var->varlevelsup != 0)
+				return false;
+		}
+		return true;
+	}
+	return false;
+}
+
+static bool
+is_simple_appendrel_path(PlannerInfo *root, AppendPath *append_path)
+{
+	RelOptInfo *append_rel = append_path->path.parent;
+	ListCell   *lc;
+
+	if (append_rel->reloptkind != RELOPT_BASEREL ||
+		append_path->subpaths == NIL)
+		return false;
+	foreach (lc, append_path->subpaths)
+	{
+		Path	   *subpath = lfirst(lc);
+		RelOptInfo *subrel = subpath->parent;
+		RangeTblEntry *rte;
+
+		if (subrel->reloptkind != RELOPT_OTHER_MEMBER_REL ||
+			subrel->rtekind != RTE_RELATION)
+			return false;
+		rte = root->simple_rte_array[subrel->relid];
+		if (rte->relkind != RELKIND_RELATION &&
+			!(rte->relkind == RELKIND_FOREIGN_TABLE &&
+			  baseRelIsArrowFdw(subrel)))
+			return false;
+		if (!__is_simple_appendrel_child(root, subrel))
+			return false;
+	}
+	return true;
+}
+
 /*
  * extract_partitionwise_pathlist
  */
@@ -1973,8 +2439,9 @@ __extract_partitionwise_pathlist(PlannerInfo *root,
 		List	   *join_info_list_saved;
 		List	  **join_rel_level_saved;
 
-		if (append_path->partitioned_rels == NIL)
-			return NIL;		/* not a partition */
+		if (append_path->partitioned_rels == NIL &&
+			!is_simple_appendrel_path(root, append_path))
+			return NIL;		/* neither partition nor simple appendrel */
 
 		join_rel_level_saved = root->join_rel_level;
 		join_info_list_saved = root->join_info_list;
@@ -2225,7 +2692,9 @@ try_add_gpujoin_paths(PlannerInfo *root,
 	if (join_type != JOIN_INNER &&
 		join_type != JOIN_FULL &&
 		join_type != JOIN_RIGHT &&
-		join_type != JOIN_LEFT)
+		join_type != JOIN_LEFT &&
+		join_type != JOIN_SEMI &&
+		join_type != JOIN_ANTI)
 		return;
 
 	/*
@@ -2282,6 +2751,13 @@ try_add_gpujoin_paths(PlannerInfo *root,
 
 		if (!pgstrom_device_expression(root, joinrel, rinfo->clause))
 			return;
+		/*
+		 * ANTI JOIN emits outer rows that have no matched inner rows, so
+		 * pushed-down qualifiers must be evaluated on the result rows;
+		 * it is not supported right now.
+		 */
+		if (join_type == JOIN_ANTI && rinfo->is_pushed_down)
+			return;
 	}
 
 	/*
@@ -2765,6 +3241,7 @@ build_device_targetlist(PlannerInfo *root,
 	build_device_tlist_walker((Node *)gj_info->other_quals, &context);
 	build_device_tlist_walker((Node *)gj_info->hash_inner_keys, &context);
 	build_device_tlist_walker((Node *)gj_info->hash_outer_keys, &context);
+	build_device_tlist_walker((Node *)gj_info->nestloop_keys, &context);
 	build_device_tlist_walker((Node *)targetlist, &context);
 
 	Assert(list_length(context.ps_tlist) == list_length(context.ps_depth) &&
@@ -2775,6 +3252,305 @@ build_device_targetlist(PlannerInfo *root,
 	cscan->custom_scan_tlist = context.ps_tlist;
 }
 
+/*
+ * gpujoin_range_batch_bounds
+ *
+ * It picks up (nbatches - 1) boundary values of the inner hash key from the
+ * histogram of pg_statistic. If batched inner hash table is split by the key
+ * range, instead of the hash value, outer Arrow_Fdw scan of each batch can
+ * skip RecordBatches out of the range, so outer relation sorted by the join
+ * key is read only once in total.
+ */
+static List *
+gpujoin_range_batch_bounds(PlannerInfo *root, Node *ikey, int nbatches)
+{
+	Var			   *var = (Var *) ikey;
+	RangeTblEntry  *rte;
+	HeapTuple		tup;
+	AttStatsSlot	sslot;
+	TypeCacheEntry *tcache;
+	List		   *results = NIL;
+	Datum			prev = 0;
+	int				k;
+
+	if (!enable_gpuhashjoin_range_batches ||
+		!IsA(var, Var) || var->varattno <= 0 ||
+		var->varno >= root->simple_rel_array_size)
+		return NIL;
+	rte = root->simple_rte_array[var->varno];
+	if (!rte || rte->rtekind != RTE_RELATION)
+		return NIL;
+	tcache = lookup_type_cache(var->vartype, TYPECACHE_CMP_PROC_FINFO);
+	if (!tcache->typbyval || !OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+		return NIL;
+
+	tup = SearchSysCache3(STATRELATTINH,
+						  ObjectIdGetDatum(rte->relid),
+						  Int16GetDatum(var->varattno),
+						  BoolGetDatum(rte->inh));
+	if (!HeapTupleIsValid(tup))
+		return NIL;
+	if (get_attstatsslot(&sslot, tup,
+						 STATISTIC_KIND_HISTOGRAM,
+						 InvalidOid,
+						 ATTSTATSSLOT_VALUES))
+	{
+		if (sslot.valuetype == var->vartype &&
+			sslot.nvalues > nbatches)
+		{
+			for (k=1; k < nbatches; k++)
+			{
+				Datum	datum = sslot.values[k * (sslot.nvalues - 1) /
+											 nbatches];
+				/* boundaries must be strictly increasing */
+				if (k > 1 &&
+					DatumGetInt32(FunctionCall2(&tcache->cmp_proc_finfo,
+												prev, datum)) >= 0)
+				{
+					list_free_deep(results);
+					results = NIL;
+					break;
+				}
+				results = lappend(results,
+								  makeConst(var->vartype,
+											-1,
+											var->varcollid,
+											tcache->typlen,
+											datum,
+											false,
+											true));
+				prev = datum;
+			}
+		}
+		free_attstatsslot(&sslot);
+	}
+	ReleaseSysCache(tup);
+
+	return results;
+}
+
+/*
+ * gpujoin_inner_prune_conds
+ *
+ * If outer relation is a partition leaf, its partition constraint on the
+ * hash key also restricts the inner rows which can match. It returns list
+ * of (strategy, Const) pairs to prune inner rows during the preload, and
+ * index of the hash key to be compared.
+ */
+static List *
+gpujoin_inner_prune_conds(PlannerInfo *root,
+						  Index outer_relid,
+						  List *hash_inner_keys,
+						  List *hash_outer_keys,
+						  int *p_key_index)
+{
+	RangeTblEntry  *rte = root->simple_rte_array[outer_relid];
+	Expr		   *pqual;
+	List		   *pqual_list;
+	ListCell	   *lc1, *lc2, *cell;
+	int				key_index = 0;
+
+	if (!enable_gpujoin_partition_prune ||
+		rte->rtekind != RTE_RELATION)
+		return NIL;
+	pqual = get_partition_qual_relid(rte->relid);
+	if (!pqual)
+		return NIL;
+	pqual_list = make_ands_implicit(pqual);
+
+	forboth (lc1, hash_inner_keys,
+			 lc2, hash_outer_keys)
+	{
+		Node	   *ikey = lfirst(lc1);
+		Var		   *okey = lfirst(lc2);
+		TypeCacheEntry *tcache;
+		List	   *results = NIL;
+
+		if (!IsA(okey, Var) ||
+			okey->varno != outer_relid ||
+			okey->varattno <= 0 ||
+			exprType(ikey) != okey->vartype)
+			goto next;
+		tcache = lookup_type_cache(okey->vartype,
+								   TYPECACHE_BTREE_OPFAMILY |
+								   TYPECACHE_CMP_PROC_FINFO);
+		if (!tcache->typbyval ||
+			!OidIsValid(tcache->btree_opf) ||
+			!OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+			goto next;
+
+		foreach (cell, pqual_list)
+		{
+			OpExpr	   *op = lfirst(cell);
+			Node	   *arg1;
+			Node	   *arg2;
+			int			strategy;
+
+			if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+				continue;
+			arg1 = linitial(op->args);
+			arg2 = lsecond(op->args);
+			strategy = get_op_opfamily_strategy(op->opno, tcache->btree_opf);
+			if (strategy == 0)
+				continue;
+			if (IsA(arg2, Var) && IsA(arg1, Const))
+			{
+				/* commute the operator; Const op Var */
+				Node   *temp = arg1;
+
+				arg1 = arg2;
+				arg2 = temp;
+				if (strategy == BTLessStrategyNumber)
+					strategy = BTGreaterStrategyNumber;
+				else if (strategy == BTLessEqualStrategyNumber)
+					strategy = BTGreaterEqualStrategyNumber;
+				else if (strategy == BTGreaterEqualStrategyNumber)
+					strategy = BTLessEqualStrategyNumber;
+				else if (strategy == BTGreaterStrategyNumber)
+					strategy = BTLessStrategyNumber;
+			}
+			if (!IsA(arg1, Var) ||
+				((Var *)arg1)->varattno != okey->varattno ||
+				!IsA(arg2, Const) ||
+				((Const *)arg2)->constisnull ||
+				((Const *)arg2)->consttype != okey->vartype)
+				continue;
+			results = lappend(results,
+							  list_make2(makeInteger(strategy),
+										 copyObject(arg2)));
+		}
+		if (results != NIL)
+		{
+			*p_key_index = key_index;
+			return results;
+		}
+	next:
+		key_index++;
+	}
+	return NIL;
+}
+
+/*
+ * gpujoin_nestloop_sort_key
+ *
+ * GpuNestLoop by the join qualifiers like "inner.x BETWEEN outer.a AND
+ * outer.b" evaluates the cross-product of outer and inner rows. If inner
+ * rows are sorted by the key, each outer row can look up the window of the
+ * candidate inner rows by binary search. It returns the inner Var with the
+ * largest number of the btree-comparable qualifiers, and the qualifiers
+ * to restrict the lower and upper bound of the key.
+ */
+static Var *
+gpujoin_nestloop_sort_key(RelOptInfo *scan_rel,
+						  List *join_quals,
+						  List **p_lower_quals,
+						  List **p_upper_quals)
+{
+	List	   *key_list = NIL;
+	List	   *lower_list = NIL;
+	List	   *upper_list = NIL;
+	ListCell   *lc1, *lc2, *lc3, *cell;
+	Var		   *key_best = NULL;
+	int			nquals_best = 0;
+
+	if (!enable_gpunestloop_sorted)
+		return NULL;
+	foreach (cell, join_quals)
+	{
+		OpExpr	   *op = lfirst(cell);
+		Node	   *arg1;
+		Node	   *arg2;
+		Var		   *var;
+		TypeCacheEntry *tcache;
+		int			strategy;
+
+		if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+			continue;
+		arg1 = linitial(op->args);
+		arg2 = lsecond(op->args);
+		if (IsA(arg2, Var) &&
+			bms_is_member(((Var *)arg2)->varno, scan_rel->relids))
+		{
+			/* inner Var is on the right side */
+			Node   *temp = arg1;
+
+			arg1 = arg2;
+			arg2 = temp;
+		}
+		var = (Var *) arg1;
+		if (!IsA(var, Var) ||
+			var->varlevelsup > 0 ||
+			var->varattno <= 0 ||
+			!bms_is_member(var->varno, scan_rel->relids) ||
+			bms_overlap(pull_varnos(arg2), scan_rel->relids) ||
+			contain_volatile_functions(arg2))
+			continue;
+		tcache = lookup_type_cache(var->vartype,
+								   TYPECACHE_BTREE_OPFAMILY |
+								   TYPECACHE_CMP_PROC_FINFO);
+		if (!tcache->typbyval ||
+			!OidIsValid(tcache->btree_opf) ||
+			!OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+			continue;
+		strategy = get_op_opfamily_strategy(op->opno, tcache->btree_opf);
+		if (strategy == 0)
+			continue;
+		if (arg1 != linitial(op->args))
+		{
+			/* commute the operator; outer op Var */
+			if (strategy == BTLessStrategyNumber)
+				strategy = BTGreaterStrategyNumber;
+			else if (strategy == BTLessEqualStrategyNumber)
+				strategy = BTGreaterEqualStrategyNumber;
+			else if (strategy == BTGreaterEqualStrategyNumber)
+				strategy = BTLessEqualStrategyNumber;
+			else if (strategy == BTGreaterStrategyNumber)
+				strategy = BTLessStrategyNumber;
+		}
+
+		/* lookup the qualifiers by the same key */
+		forthree (lc1, key_list,
+				  lc2, lower_list,
+				  lc3, upper_list)
+		{
+			if (equal(lfirst(lc1), var))
+				break;
+		}
+		if (!lc1)
+		{
+			key_list = lappend(key_list, var);
+			lower_list = lappend(lower_list, NIL);
+			upper_list = lappend(upper_list, NIL);
+			lc2 = list_tail(lower_list);
+			lc3 = list_tail(upper_list);
+		}
+		if (strategy == BTEqualStrategyNumber ||
+			strategy == BTGreaterEqualStrategyNumber ||
+			strategy == BTGreaterStrategyNumber)
+			lfirst(lc2) = lappend((List *)lfirst(lc2), op);
+		if (strategy == BTEqualStrategyNumber ||
+			strategy == BTLessEqualStrategyNumber ||
+			strategy == BTLessStrategyNumber)
+			lfirst(lc3) = lappend((List *)lfirst(lc3), op);
+	}
+
+	forthree (lc1, key_list,
+			  lc2, lower_list,
+			  lc3, upper_list)
+	{
+		int		nquals = list_length(lfirst(lc2)) + list_length(lfirst(lc3));
+
+		if (nquals > nquals_best)
+		{
+			key_best = lfirst(lc1);
+			nquals_best = nquals;
+			*p_lower_quals = lfirst(lc2);
+			*p_upper_quals = lfirst(lc3);
+		}
+	}
+	return key_best;
+}
+
 /*
  * PlanGpuJoinPath
  *
@@ -2795,6 +3571,8 @@ PlanGpuJoinPath(PlannerInfo *root,
 	CustomScan	   *cscan;
 	codegen_context	context;
 	Plan		   *outer_plan;
+	Relids			outer_relids;
+	Relids			fb_relids;
 	ListCell	   *lc;
 	double			outer_nrows;
 	int				i, k;
@@ -2840,12 +3618,23 @@ PlanGpuJoinPath(PlannerInfo *root,
 	}
 
 	outer_nrows = outer_plan->plan_rows;
+	outer_relids = ((Path *)linitial(best_path->custom_paths))->parent->relids;
+	fb_relids = outer_relids;
 	for (i=0; i < gjpath->num_rels; i++)
 	{
+		JoinType	join_type = gjpath->inners[i].join_type;
 		List	   *hash_inner_keys = NIL;
 		List	   *hash_outer_keys = NIL;
 		List	   *join_quals = NIL;
 		List	   *other_quals = NIL;
+		bool		bloom_filter = false;
+		bool		device_build = false;
+		AttrNumber	range_attnum = 0;
+		int			prune_key;
+		List	   *prune_conds;
+		Var		   *nestloop_key;
+		List	   *nestloop_lower_quals;
+		List	   *nestloop_upper_quals;
 
 		foreach (lc, gjpath->inners[i].hash_quals)
 		{
@@ -2881,6 +3670,94 @@ PlanGpuJoinPath(PlannerInfo *root,
 				elog(ERROR, "Bug? hash-clause reference bogus varnos");
 		}
 
+		/*
+		 * Bloom filter of the inner hash table can drop outer rows that
+		 * never match prior to the join, if hash keys reference the outer
+		 * relation only. In addition, if outer relation is Arrow_Fdw, the
+		 * range of inner keys allows to skip RecordBatches by min/max
+		 * statistics.
+		 */
+		if (enable_gpujoin_bloom_filter &&
+			hash_outer_keys != NIL &&
+			(join_type == JOIN_INNER ||
+			 join_type == JOIN_RIGHT ||
+			 join_type == JOIN_SEMI) &&
+			bms_is_subset(pull_varnos((Node *)hash_outer_keys), outer_relids))
+		{
+			bloom_filter = true;
+			if (outer_relid > 0 &&
+				list_length(hash_outer_keys) == 1 &&
+				baseRelIsArrowFdw(root->simple_rel_array[outer_relid]))
+			{
+				Var	   *var = linitial(hash_outer_keys);
+
+				if (IsA(var, Var) &&
+					var->varno == outer_relid &&
+					var->varattno > 0 &&
+					exprType(linitial(hash_inner_keys)) == var->vartype)
+					range_attnum = var->varattno;
+			}
+		}
+		gj_info.bloom_filters = lappend_int(gj_info.bloom_filters,
+											bloom_filter);
+		gj_info.range_attnums = lappend_int(gj_info.range_attnums,
+											range_attnum);
+
+		/*
+		 * Batched inner hash table is split by the key range, if outer
+		 * Arrow_Fdw can skip RecordBatches according to the inner keys.
+		 * Each outer rescan reads only RecordBatches within the range of
+		 * the current batch, instead of the entire relation.
+		 */
+		if (range_attnum > 0 && gjpath->batch_depth == i + 1)
+			gj_info.batch_bounds =
+				gpujoin_range_batch_bounds(root, linitial(hash_inner_keys),
+										   gjpath->inner_nbatches);
+
+		/*
+		 * Large inner hash table is built by GPU kernel, instead of the
+		 * hash value calculation on CPU for each inner row. Batched hash
+		 * table needs hash values on CPU side to pick up rows.
+		 */
+		if (enable_gpuhashjoin_device_build &&
+			hash_inner_keys != NIL &&
+			gjpath->batch_depth != i + 1 &&
+			gjpath->inners[i].scan_path->rows >= GPUJOIN_DEVICE_BUILD_THRESHOLD)
+			device_build = true;
+		gj_info.device_builds = lappend_int(gj_info.device_builds,
+											device_build);
+
+		/*
+		 * If outer relation is a partition leaf, inner rows out of the
+		 * partition bound never match. Inner buffer shared by the sibling
+		 * partition leafs is loaded only once, so it is not pruned.
+		 */
+		prune_key = -1;
+		prune_conds = NIL;
+		if (outer_relid > 0 &&
+			hash_inner_keys != NIL &&
+			!gjpath->sibling_param_id &&
+			(join_type == JOIN_INNER ||
+			 join_type == JOIN_LEFT ||
+			 join_type == JOIN_SEMI ||
+			 join_type == JOIN_ANTI))
+			prune_conds = gpujoin_inner_prune_conds(root, outer_relid,
+													hash_inner_keys,
+													hash_outer_keys,
+													&prune_key);
+		gj_info.prune_keys = lappend_int(gj_info.prune_keys, prune_key);
+		gj_info.prune_conds = lappend(gj_info.prune_conds, prune_conds);
+
+		/* fingerprint to save the observed nrows for the later planning */
+		gj_info.feedback_keys =
+			lappend_int(gj_info.feedback_keys,
+						(int)gpujoin_feedback_key(root, fb_relids,
+												  gjpath->inners[i].scan_path,
+												  join_type,
+												  gjpath->inners[i].join_quals));
+		fb_relids = bms_union(fb_relids,
+							  gjpath->inners[i].scan_path->parent->relids);
+
 		/*
 		 * Add properties of GpuJoinInfo
 		 */
@@ -2890,8 +3767,7 @@ PlanGpuJoinPath(PlannerInfo *root,
 									pmakeFloat(gjpath->inners[i].join_nrows));
 		gj_info.ichunk_size = lappend_int(gj_info.ichunk_size,
 										  gjpath->inners[i].ichunk_size);
-		gj_info.join_types = lappend_int(gj_info.join_types,
-										 gjpath->inners[i].join_type);
+		gj_info.join_types = lappend_int(gj_info.join_types, join_type);
 
 		if (IS_OUTER_JOIN(gjpath->inners[i].join_type))
 		{
@@ -2905,6 +3781,30 @@ PlanGpuJoinPath(PlannerInfo *root,
 												false);
 			other_quals = NIL;
 		}
+
+		/*
+		 * GpuNestLoop by the range qualifiers looks up the window of the
+		 * candidate inner rows sorted by the key, prior to evaluation of
+		 * the join qualifiers.
+		 */
+		nestloop_key = NULL;
+		nestloop_lower_quals = NIL;
+		nestloop_upper_quals = NIL;
+		if (hash_inner_keys == NIL)
+			nestloop_key = gpujoin_nestloop_sort_key(
+								gjpath->inners[i].scan_path->parent,
+								join_quals,
+								&nestloop_lower_quals,
+								&nestloop_upper_quals);
+		gj_info.nestloop_keys = lappend(gj_info.nestloop_keys,
+										nestloop_key
+										? list_make1(nestloop_key)
+										: NIL);
+		gj_info.nestloop_lower_quals = lappend(gj_info.nestloop_lower_quals,
+											   nestloop_lower_quals);
+		gj_info.nestloop_upper_quals = lappend(gj_info.nestloop_upper_quals,
+											   nestloop_upper_quals);
+
 		gj_info.join_quals = lappend(gj_info.join_quals, join_quals);
 		gj_info.other_quals = lappend(gj_info.other_quals, other_quals);
 		gj_info.hash_inner_keys = lappend(gj_info.hash_inner_keys,
@@ -2979,6 +3879,30 @@ PlanGpuJoinPath(PlannerInfo *root,
 	gj_info.extra_flags = context.extra_flags | DEVKERNEL_NEEDS_GPUJOIN;
 	gj_info.used_params = context.used_params;
 
+	gj_info.inner_nbatches = Max(gjpath->inner_nbatches, 1);
+	gj_info.batch_depth = gjpath->batch_depth;
+
+	/*
+	 * LIMIT clause pushdown, if GpuJoin is the only source of the query
+	 * result. RIGHT/FULL OUTER JOIN is not supported because unmatched
+	 * inner rows are not determined until the end of outer scan.
+	 * Batched inner hash table also rescans the outer relation.
+	 */
+	gj_info.tuple_bound = -1;
+	for (i=0; i < gjpath->num_rels; i++)
+	{
+		JoinType	join_type = gjpath->inners[i].join_type;
+
+		if (join_type == JOIN_RIGHT || join_type == JOIN_FULL)
+			break;
+	}
+	if (i == gjpath->num_rels && gjpath->inner_nbatches <= 1)
+	{
+		cl_long		tuple_bound = pgstrom_get_tuple_bound(root, joinrel);
+
+		if (tuple_bound >= 0 && tuple_bound <= INT_MAX)
+			gj_info.tuple_bound = tuple_bound;
+	}
 	form_gpujoin_info(cscan, &gj_info);
 
 	return &cscan->scan.plan;
@@ -3052,6 +3976,11 @@ assign_gpujoin_session_info(StringInfo buf, GpuTaskState *gts)
 		buf,
 		"#define GPUJOIN_MAX_DEPTH %u\n",
 		gjs->num_rels);
+	if (gjs->shared_pstack)
+		appendStringInfo(
+			buf,
+			"#define GPUJOIN_SHARED_PSTACK_NROOMS %u\n",
+			gjs->pstack_nrooms);
 }
 
 static Node *
@@ -3090,9 +4019,26 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	cl_int			i, j, nattrs;
 	StringInfoData	kern_define;
 	ProgramId		program_id;
+	int				cuda_dindex = gj_info->optimal_gpu;
+
+	/*
+	 * Parallel workers of GpuJoin are distributed over the multiple GPUs,
+	 * regardless of the preference on plan time. The leader process loads
+	 * the inner buffer onto all the devices, and the outer chunks are
+	 * picked up by the workers whose GPU has spare capacity.
+	 * However, if the outer relation is located close to a particular GPU
+	 * (optimal_gpu >= 0), workers on the other GPUs cannot use SSD-to-GPU
+	 * Direct SQL, so we keep them on the optimal GPU.
+	 */
+	if (enable_gpujoin_multi_gpu &&
+		gj_info->optimal_gpu < 0 &&
+		numDevAttrs > 1 &&
+		IsParallelWorker() &&
+		node->ss.ps.plan->parallel_aware)
+		cuda_dindex = GetLeastBusyGpuDevice();
 
 	/* activate a GpuContext for CUDA kernel execution */
-	gjs->gts.gcontext = AllocGpuContext(gj_info->optimal_gpu,
+	gjs->gts.gcontext = AllocGpuContext(cuda_dindex,
 										false, false, false);
 	/*
 	 * Re-initialization of scan tuple-descriptor and projection-info,
@@ -3115,6 +4061,7 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	pgstromInitGpuTaskState(&gjs->gts,
 							gjs->gts.gcontext,
 							GpuTaskKind_GpuJoin,
+							gj_info->outer_quals,
 							gj_info->outer_refs,
 							gj_info->used_params,
 							gj_info->optimal_gpu,
@@ -3124,14 +4071,35 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	gjs->gts.cb_next_task		= gpujoin_next_task;
 	gjs->gts.cb_terminator_task	= gpujoin_terminator_task;
 	gjs->gts.cb_switch_task		= gpujoin_switch_task;
+	gjs->gts.cb_cpu_task		= gpujoin_cpu_task;
 	gjs->gts.cb_process_task	= gpujoin_process_task;
 	gjs->gts.cb_release_task	= gpujoin_release_task;
+	gjs->gts.cb_async_begin		= gpujoin_async_begin;
+	gjs->gts.tuple_bound		= gj_info->tuple_bound;
 
 	/* DSM & GPU memory of inner buffer */
 	gjs->m_kmrels = 0UL;
 	gjs->m_kmrels_array = NULL;
 	gjs->seg_kmrels = NULL;
 	gjs->curr_outer_depth = -1;
+	gjs->inner_nbatches = Max(gj_info->inner_nbatches, 1);
+	/*
+	 * Shallow GpuJoin keeps the pseudo-stack on the shared memory, instead
+	 * of the global memory. It has less entries per depth, so the block
+	 * size of GPU kernel is also restricted.
+	 */
+	if (enable_gpujoin_shared_pstack &&
+		gjs->num_rels <= GPUJOIN_SHARED_PSTACK_MAX_DEPTH)
+	{
+		gjs->pstack_nrooms = GPUJOIN_SHARED_PSTACK_NROOMS_FOR(gjs->num_rels);
+		gjs->shared_pstack = true;
+	}
+	else
+	{
+		gjs->pstack_nrooms = GPUJOIN_PSTACK_NROOMS;
+		gjs->shared_pstack = false;
+	}
+	gjs->curr_batch = 0;
 	if (gj_info->sibling_param_id >= 0)
 	{
 		ParamExecData  *param
@@ -3295,6 +4263,7 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 		List	   *other_quals;
 		List	   *hash_inner_keys;
 		List	   *hash_outer_keys;
+		List	   *nestloop_keys;
 		TupleTableSlot *inner_slot;
 		double		plan_nrows_in;
 		double		plan_nrows_out;
@@ -3307,6 +4276,38 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 		istate->nrows_ratio = plan_nrows_out / Max(plan_nrows_in, 1.0);
 		istate->ichunk_size = list_nth_int(gj_info->ichunk_size, i);
 		istate->join_type = (JoinType)list_nth_int(gj_info->join_types, i);
+		if (istate->depth == gj_info->batch_depth)
+			istate->hash_nbatches = gjs->inner_nbatches;
+		else
+			istate->hash_nbatches = 1;
+		istate->hash_curr_batch = 0;
+		istate->feedback_key = (uint32)list_nth_int(gj_info->feedback_keys, i);
+		istate->bloom_filter = list_nth_int(gj_info->bloom_filters, i);
+		istate->device_build = list_nth_int(gj_info->device_builds, i);
+		istate->range_attnum = list_nth_int(gj_info->range_attnums, i);
+		if (istate->range_attnum > 0)
+		{
+			Node	   *ikey = linitial(list_nth(gj_info->hash_inner_keys, i));
+			TypeCacheEntry *tcache;
+
+			tcache = lookup_type_cache(exprType(ikey),
+									   TYPECACHE_CMP_PROC_FINFO);
+			if (tcache->typbyval && OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+				istate->range_tcache = tcache;
+			else
+				istate->range_attnum = 0;
+		}
+		if (istate->depth == gj_info->batch_depth &&
+			istate->range_attnum > 0 &&
+			list_length(gj_info->batch_bounds) == istate->hash_nbatches - 1)
+		{
+			cl_int		k = 0;
+
+			istate->batch_bounds = palloc(sizeof(Datum) *
+										  istate->hash_nbatches);
+			foreach (lc1, gj_info->batch_bounds)
+				istate->batch_bounds[k++] = ((Const *)lfirst(lc1))->constvalue;
+		}
 
 		/*
 		 * NOTE: We need to deal with Var-node references carefully,
@@ -3355,8 +4356,50 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 			}
 		}
 
-		/*
-		 * CPU fallback setup for INNER reference
+		/* key to sort the inner rows of nestloop, if any */
+		nestloop_keys = list_nth(gj_info->nestloop_keys, i);
+		if (nestloop_keys != NIL)
+		{
+			nestloop_keys = fixup_varnode_to_origin(i+1,
+													gj_info->ps_src_depth,
+													gj_info->ps_src_resno,
+													nestloop_keys);
+			istate->nestloop_key = ExecInitExpr(linitial(nestloop_keys),
+												&ss->ps);
+			istate->nestloop_tcache =
+				lookup_type_cache(exprType(linitial(nestloop_keys)),
+								  TYPECACHE_CMP_PROC_FINFO);
+		}
+
+		/* conditions to prune inner rows by the outer partition */
+		if (list_nth_int(gj_info->prune_keys, i) >= 0)
+		{
+			List	   *prune_conds = list_nth(gj_info->prune_conds, i);
+			int			prune_key = list_nth_int(gj_info->prune_keys, i);
+
+			istate->prune_key = list_nth(istate->hash_inner_keys, prune_key);
+			istate->prune_tcache =
+				lookup_type_cache(exprType((Node *)list_nth(hash_inner_keys,
+															prune_key)),
+								  TYPECACHE_CMP_PROC_FINFO);
+			istate->prune_strategy = palloc(sizeof(int) *
+											list_length(prune_conds));
+			istate->prune_values = palloc(sizeof(Datum) *
+										  list_length(prune_conds));
+			foreach (lc1, prune_conds)
+			{
+				List	   *pair = lfirst(lc1);
+				Const	   *con = lsecond(pair);
+
+				istate->prune_strategy[istate->nprune_conds] =
+					intVal(linitial(pair));
+				istate->prune_values[istate->nprune_conds] = con->constvalue;
+				istate->nprune_conds++;
+			}
+		}
+
+		/*
+		 * CPU fallback setup for INNER reference
 		 */
 		inner_slot = istate->state->ps_ResultTupleSlot;
 		nattrs = inner_slot->tts_tupleDescriptor->natts;
@@ -3364,6 +4407,7 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 		istate->inner_src_anum_max = FirstLowInvalidHeapAttributeNumber;
 		nattrs -= FirstLowInvalidHeapAttributeNumber;
 		istate->inner_dst_resno = palloc0(sizeof(AttrNumber) * nattrs);
+		istate->fallback_hindex_pos = -1;
 
 		j = 1;
 		forboth (lc1, gj_info->ps_src_depth,
@@ -3402,6 +4446,10 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	gjs->gts.program_id = program_id;
 	pfree(kern_define.data);
 
+	/* key of the inner buffer cache, if reusable */
+	if (!explain_only)
+		gpujoin_inner_cache_init_key(gjs, gj_info);
+
 	/* expected kresults buffer expand rate */
 	gjs->result_width =
 		MAXALIGN(offsetof(HeapTupleHeaderData,
@@ -3429,17 +4477,77 @@ ExecReCheckGpuJoin(CustomScanState *node, TupleTableSlot *slot)
 /*
  * ExecGpuJoin
  */
+/*
+ * gpujoin_rewind_inner_batch
+ *
+ * It rewinds the inner relations to reload the inner buffer with tuples
+ * of the supplied batch, if inner hash table is split into multiple batches.
+ */
+static void
+gpujoin_rewind_inner_batch(GpuJoinState *gjs, cl_int batch)
+{
+	cl_int		i;
+
+	for (i=0; i < gjs->num_rels; i++)
+	{
+		innerState *istate = &gjs->inners[i];
+
+		istate->hash_curr_batch = batch;
+		ExecReScan(istate->state);
+	}
+	GpuJoinInnerUnload(&gjs->gts, true);
+	gjs->curr_batch = batch;
+}
+
 static TupleTableSlot *
 ExecGpuJoin(CustomScanState *node)
 {
 	GpuJoinState *gjs = (GpuJoinState *) node;
 
+	TupleTableSlot *slot = NULL;
+
 	ActivateGpuContext(gjs->gts.gcontext);
-	if (!GpuJoinInnerPreload(&gjs->gts, NULL))
-		return NULL;
-	return ExecScan(&node->ss,
-					(ExecScanAccessMtd) pgstromExecGpuTaskState,
-					(ExecScanRecheckMtd) ExecReCheckGpuJoin);
+	for (;;)
+	{
+		if (GpuJoinInnerPreload(&gjs->gts, NULL))
+		{
+			slot = ExecScan(&node->ss,
+							(ExecScanAccessMtd) pgstromExecGpuTaskState,
+							(ExecScanRecheckMtd) ExecReCheckGpuJoin);
+			if (!TupIsNull(slot))
+				break;
+		}
+		if (gjs->curr_batch + 1 >= gjs->inner_nbatches)
+			break;
+		/*
+		 * Move to the next batch of the inner hash table; outer relation
+		 * shall be rescanned towards the new batch.
+		 */
+		SynchronizeGpuContext(gjs->gts.gcontext);
+		gpujoin_rewind_inner_batch(gjs, gjs->curr_batch + 1);
+		if (outerPlanState(gjs))
+			ExecReScan(outerPlanState(gjs));
+		gjs->gts.scan_overflow = NULL;
+		pgstromRescanGpuTaskState(&gjs->gts);
+	}
+	return slot;
+}
+
+/*
+ * gpujoin_async_begin - setup GpuJoin prior to ExecGpuJoin for async Append
+ *
+ * The inner buffer is preloaded here; it is usually shared with the former
+ * sibling if partition-wise join. Not supported if the inner hash table is
+ * split into multiple batches, because outer relation shall be rescanned.
+ */
+static bool
+gpujoin_async_begin(GpuTaskState *gts)
+{
+	GpuJoinState   *gjs = (GpuJoinState *) gts;
+
+	if (gjs->inner_nbatches > 1)
+		return false;
+	return GpuJoinInnerPreload(gts, NULL);
 }
 
 static void
@@ -3494,6 +4602,9 @@ ExecReScanGpuJoin(CustomScanState *node)
 		/* rewind the inner hash/heap buffer */
 		GpuJoinInnerUnload(&gjs->gts, true);
 	}
+	/* rewind the batched inner hash table to the first batch */
+	if (gjs->curr_batch > 0)
+		gpujoin_rewind_inner_batch(gjs, 0);
 	/* common rescan handling */
 	pgstromRescanGpuTaskState(&gjs->gts);
 }
@@ -3611,14 +4722,18 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 			appendStringInfo(&str, "GpuHash%sJoin",
 							 join_type == JOIN_FULL ? "Full" :
 							 join_type == JOIN_LEFT ? "Left" :
-							 join_type == JOIN_RIGHT ? "Right" : "");
+							 join_type == JOIN_RIGHT ? "Right" :
+							 join_type == JOIN_SEMI ? "Semi" :
+							 join_type == JOIN_ANTI ? "Anti" : "");
 		}
 		else
 		{
 			appendStringInfo(&str, "GpuNestLoop%s",
 							 join_type == JOIN_FULL ? "Full" :
 							 join_type == JOIN_LEFT ? "Left" :
-							 join_type == JOIN_RIGHT ? "Right" : "");
+							 join_type == JOIN_RIGHT ? "Right" :
+							 join_type == JOIN_SEMI ? "Semi" :
+							 join_type == JOIN_ANTI ? "Anti" : "");
 		}
 		snprintf(qlabel, sizeof(qlabel), "Depth%2d", depth);
 		indent_width = es->indent * 2 + strlen(qlabel) + 2;
@@ -3642,6 +4757,16 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 									 format_bytesz(istate->ichunk_size),
 									 format_bytesz(exec_sz));
 				}
+				if (istate->hash_nbatches > 1)
+					appendStringInfo(&str, ", %sbatches: %d",
+									 istate->batch_bounds ? "range-" : "",
+									 istate->hash_nbatches);
+				if (istate->bloom_filter)
+					appendStringInfoString(&str, ", bloom-filter");
+				if (istate->device_build)
+					appendStringInfoString(&str, ", device-build");
+				if (istate->nprune_conds > 0)
+					appendStringInfoString(&str, ", partition-pruned");
 
 				if (!gj_rtstat)
 					appendStringInfo(&str, ", nrows %.0f...%.0f)",
@@ -3682,6 +4807,22 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 							 "Depth % 2d KDS Exec Size", depth);
 					ExplainPropertyInteger(qlabel, NULL, len, es);
 				}
+				if (istate->hash_nbatches > 1)
+				{
+					snprintf(qlabel, sizeof(qlabel),
+							 "Depth% 2d Hash Batches", depth);
+					ExplainPropertyInteger(qlabel, NULL,
+										   istate->hash_nbatches, es);
+				}
+				if (hash_outer_key)
+				{
+					snprintf(qlabel, sizeof(qlabel),
+							 "Depth% 2d Bloom Filter", depth);
+					ExplainPropertyBool(qlabel, istate->bloom_filter, es);
+					snprintf(qlabel, sizeof(qlabel),
+							 "Depth% 2d Device Build", depth);
+					ExplainPropertyBool(qlabel, istate->device_build, es);
+				}
 
 				snprintf(qlabel, sizeof(qlabel),
 						 "Depth% 2d Plan Rows-in", depth);
@@ -3768,6 +4909,10 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 		}
 		depth++;
 	}
+	/* inner buffer cache, if any */
+	if (es->analyze && gjs->inner_cache_key)
+		ExplainPropertyText("Inner Buffer Cache",
+							gjs->inner_cache_hit ? "hit" : "miss", es);
 	/* other common field */
 	pgstromExplainGpuTaskState(&gjs->gts, es);
 }
@@ -3827,8 +4972,7 @@ ExecGpuJoinInitDSM(CustomScanState *node,
 	coordinate = (char *)coordinate + gjs->gj_sstate->ss_length;
 	if (gjs->gts.outer_index_state)
 	{
-		gjs->gts.outer_index_map = (Bitmapset *)coordinate;
-		gjs->gts.outer_index_map->nwords = -1;		/* uninitialized */
+		pgstromInitBrinIndexMap(&gjs->gts, coordinate);
 		coordinate = ((char *)coordinate +
 					  pgstromSizeOfBrinIndexMap(&gjs->gts));
 	}
@@ -3856,7 +5000,7 @@ ExecGpuJoinInitWorker(CustomScanState *node,
 	coordinate = (char *)coordinate + gj_sstate->ss_length;
 	if (gjs->gts.outer_index_state)
 	{
-		gjs->gts.outer_index_map = (Bitmapset *)coordinate;
+		pgstromAttachBrinIndexMap(&gjs->gts, coordinate);
 		coordinate = ((char *)coordinate +
 					  pgstromSizeOfBrinIndexMap(&gjs->gts));
 	}
@@ -3907,6 +5051,31 @@ ExecShutdownGpuJoin(CustomScanState *node)
 										   MAXALIGN(length));
 		memcpy(gj_rtstat_new, gj_rtstat_old, length);
 		gjs->gj_rtstat = gj_rtstat_new;
+
+		/*
+		 * Save the observed nrows for each depth, to be referenced by the
+		 * later planning. Batched inner hash table rescans the outer
+		 * relation, so its statistics are not informative.
+		 */
+		if (gjs->inner_nbatches <= 1)
+		{
+			int		i;
+
+			for (i=0; i < gjs->num_rels; i++)
+			{
+				double	nrows_in = (double)
+					(pg_atomic_read_u64(&gj_rtstat_new->jstat[i].inner_nitems) +
+					 pg_atomic_read_u64(&gj_rtstat_new->jstat[i].right_nitems));
+				double	nrows_out = (double)
+					(pg_atomic_read_u64(&gj_rtstat_new->jstat[i+1].inner_nitems) +
+					 pg_atomic_read_u64(&gj_rtstat_new->jstat[i+1].right_nitems));
+
+				if (nrows_in < GPUJOIN_FEEDBACK_MIN_NROWS)
+					break;
+				gpujoin_feedback_update(gjs->inners[i].feedback_key,
+										nrows_out / nrows_in);
+			}
+		}
 	}
 }
 
@@ -4258,6 +5427,68 @@ gpujoin_codegen_join_quals(StringInfo source,
 		"\n");
 }
 
+/*
+ * codegen for:
+ * STATIC_FUNCTION(cl_bool)
+ * gpujoin_nestloop_bound_depth%u(kern_context *kcxt,
+ *                                kern_data_store *kds,
+ *                                kern_multirels *kmrels,
+ *                                cl_int *o_buffer,
+ *                                HeapTupleHeaderData *i_htup,
+ *                                cl_bool is_upper)
+ */
+static void
+gpujoin_codegen_nestloop_bound(StringInfo source,
+							   GpuJoinInfo *gj_info,
+							   int cur_depth,
+							   codegen_context *context)
+{
+	List	   *lower_quals;
+	List	   *upper_quals;
+	char	   *lower_quals_code = NULL;
+	char	   *upper_quals_code = NULL;
+
+	Assert(cur_depth > 0 && cur_depth <= gj_info->num_rels);
+	lower_quals = list_nth(gj_info->nestloop_lower_quals, cur_depth - 1);
+	upper_quals = list_nth(gj_info->nestloop_upper_quals, cur_depth - 1);
+
+	context->used_vars = NIL;
+	context->param_refs = NULL;
+	resetStringInfo(&context->decl_temp);
+	if (lower_quals != NIL)
+		lower_quals_code = pgstrom_codegen_expression((Node *)lower_quals,
+													  context);
+	if (upper_quals != NIL)
+		upper_quals_code = pgstrom_codegen_expression((Node *)upper_quals,
+													  context);
+	appendStringInfo(
+		source,
+		"DEVICE_FUNCTION(cl_bool)\n"
+		"gpujoin_nestloop_bound_depth%d(kern_context *kcxt,\n"
+		"                              kern_data_store *kds,\n"
+		"                              kern_multirels *kmrels,\n"
+		"                              cl_uint *o_buffer,\n"
+		"                              HeapTupleHeaderData *i_htup,\n"
+		"                              cl_bool is_upper)\n"
+		"{\n%s",
+		cur_depth, context->decl_temp.data);
+
+	gpujoin_codegen_var_param_decl(source, gj_info,
+								   cur_depth, context);
+
+	appendStringInfo(
+		source,
+		"  if (!is_upper)\n"
+		"    return %s;\n"
+		"  return %s;\n"
+		"}\n"
+		"\n",
+		lower_quals_code
+		? psprintf("EVAL(%s)", lower_quals_code) : "true",
+		upper_quals_code
+		? psprintf("EVAL(%s)", upper_quals_code) : "true");
+}
+
 /*
  * codegen for:
  * STATIC_FUNCTION(cl_uint)
@@ -4266,22 +5497,33 @@ gpujoin_codegen_join_quals(StringInfo source,
  *                            kern_multirels *kmrels,
  *                            cl_int *o_buffer,
  *                            cl_bool *is_null_keys)
+ * or, if is_inner,
+ * STATIC_FUNCTION(cl_uint)
+ * gpujoin_inner_hash_value_depth%u(kern_context *kcxt,
+ *                                  kern_data_store *kds,
+ *                                  kern_multirels *kmrels,
+ *                                  cl_int *o_buffer,
+ *                                  HeapTupleHeaderData *i_htup,
+ *                                  cl_bool *is_null_keys)
  */
 static void
 gpujoin_codegen_hash_value(StringInfo source,
 						   GpuJoinInfo *gj_info,
 						   int cur_depth,
+						   bool is_inner,
 						   codegen_context *context)
 {
 	StringInfoData	decl;
 	StringInfoData	body;
-	List		   *hash_outer_keys;
+	List		   *hash_keys;
 	List		   *type_oid_list = NIL;
 	ListCell	   *lc;
 
 	Assert(cur_depth > 0 && cur_depth <= gj_info->num_rels);
-	hash_outer_keys = list_nth(gj_info->hash_outer_keys, cur_depth - 1);
-	Assert(hash_outer_keys != NIL);
+	hash_keys = list_nth(is_inner
+						 ? gj_info->hash_inner_keys
+						 : gj_info->hash_outer_keys, cur_depth - 1);
+	Assert(hash_keys != NIL);
 
 	initStringInfo(&decl);
 	initStringInfo(&body);
@@ -4294,7 +5536,7 @@ gpujoin_codegen_hash_value(StringInfo source,
 	context->used_vars = NIL;
 	context->param_refs = NULL;
 	resetStringInfo(&context->decl_temp);
-	foreach (lc, hash_outer_keys)
+	foreach (lc, hash_keys)
 	{
 		Node	   *key_expr = lfirst(lc);
 		Oid			key_type = exprType(key_expr);
@@ -4327,10 +5569,11 @@ gpujoin_codegen_hash_value(StringInfo source,
 	appendStringInfo(
 		source,
 		"STATIC_FUNCTION(cl_uint)\n"
-		"gpujoin_hash_value_depth%u(kern_context *kcxt,\n"
+		"gpujoin_%shash_value_depth%u(kern_context *kcxt,\n"
 		"                          kern_data_store *kds,\n"
 		"                          kern_multirels *kmrels,\n"
 		"                          cl_uint *o_buffer,\n"
+		"%s"
 		"                          cl_bool *p_is_null_keys)\n"
 		"{\n"
 		"%s%s%s"
@@ -4339,7 +5582,9 @@ gpujoin_codegen_hash_value(StringInfo source,
 		"  return hash;\n"
 		"}\n"
 		"\n",
+		is_inner ? "inner_" : "",
 		cur_depth,
+		is_inner ? "                          HeapTupleHeaderData *i_htup,\n" : "",
 		decl.data,
 		context->decl_temp.data,
 		body.data);
@@ -4885,6 +6130,58 @@ gpujoin_codegen(PlannerInfo *root,
 		"  return false;\n"
 		"}\n\n");
 
+	/*
+	 * gpujoin_nestloop_bound, for the depth whose inner rows are sorted
+	 */
+	depth = 1;
+	foreach (cell, gj_info->nestloop_keys)
+	{
+		if (lfirst(cell) != NIL)
+		{
+			context->varlena_bufsz = 0;
+			gpujoin_codegen_nestloop_bound(&source, gj_info, depth, context);
+			varlena_bufsz = Max(varlena_bufsz, context->varlena_bufsz);
+		}
+		depth++;
+	}
+
+	appendStringInfo(
+		&source,
+		"DEVICE_FUNCTION(cl_bool)\n"
+		"gpujoin_nestloop_bound(kern_context *kcxt,\n"
+		"                       kern_data_store *kds,\n"
+		"                       kern_multirels *kmrels,\n"
+		"                       int depth,\n"
+		"                       cl_uint *o_buffer,\n"
+		"                       HeapTupleHeaderData *i_htup,\n"
+		"                       cl_bool is_upper)\n"
+		"{\n"
+		"  switch (depth)\n"
+		"  {\n");
+	depth = 1;
+	foreach (cell, gj_info->nestloop_keys)
+	{
+		if (lfirst(cell) != NIL)
+		{
+			appendStringInfo(
+				&source,
+				"  case %d:\n"
+				"    return gpujoin_nestloop_bound_depth%d(kcxt, kds, kmrels,\n"
+				"                                         o_buffer, i_htup,\n"
+				"                                         is_upper);\n",
+				depth, depth);
+		}
+		depth++;
+	}
+	appendStringInfo(
+		&source,
+		"  default:\n"
+		"    STROM_EREPORT(kcxt, ERRCODE_STROM_WRONG_CODE_GENERATION,\n"
+		"                  \"GpuJoin: wrong code generation\");\n"
+		"    break;\n"
+		"  }\n"
+		"  return false;\n"
+		"}\n\n");
 
 	depth = 1;
 	foreach (cell, gj_info->hash_outer_keys)
@@ -4892,7 +6189,8 @@ gpujoin_codegen(PlannerInfo *root,
 		if (lfirst(cell) != NULL)
 		{
 			context->varlena_bufsz = 0;
-			gpujoin_codegen_hash_value(&source, gj_info, depth, context);
+			gpujoin_codegen_hash_value(&source, gj_info, depth,
+									   false, context);
 			varlena_bufsz = Max(varlena_bufsz, context->varlena_bufsz);
 		}
 		depth++;
@@ -4938,6 +6236,59 @@ gpujoin_codegen(PlannerInfo *root,
 		"}\n"
 		"\n");
 
+	/*
+	 * gpujoin_inner_hash_value, for the depth whose hash tables are built
+	 * on the device
+	 */
+	depth = 1;
+	foreach (cell, gj_info->device_builds)
+	{
+		if (lfirst_int(cell))
+		{
+			context->varlena_bufsz = 0;
+			gpujoin_codegen_hash_value(&source, gj_info, depth,
+									   true, context);
+			varlena_bufsz = Max(varlena_bufsz, context->varlena_bufsz);
+		}
+		depth++;
+	}
+
+	appendStringInfo(
+		&source,
+		"DEVICE_FUNCTION(cl_uint)\n"
+		"gpujoin_inner_hash_value(kern_context *kcxt,\n"
+		"                         kern_multirels *kmrels,\n"
+		"                         cl_int depth,\n"
+		"                         HeapTupleHeaderData *i_htup,\n"
+		"                         cl_bool *is_null_keys)\n"
+		"{\n"
+		"  switch (depth)\n"
+		"  {\n");
+	depth = 1;
+	foreach (cell, gj_info->device_builds)
+	{
+		if (lfirst_int(cell))
+		{
+			appendStringInfo(
+				&source,
+				"  case %u:\n"
+				"    return gpujoin_inner_hash_value_depth%u(kcxt,NULL,kmrels,\n"
+				"                                     NULL,i_htup,is_null_keys);\n",
+				depth, depth);
+		}
+		depth++;
+	}
+	appendStringInfo(
+		&source,
+		"  default:\n"
+		"    STROM_EREPORT(kcxt, ERRCODE_STROM_WRONG_CODE_GENERATION,\n"
+		"                  \"GpuJoin: wrong code generation\");\n"
+		"    break;\n"
+		"  }\n"
+		"  return (cl_uint)(-1);\n"
+		"}\n"
+		"\n");
+
 	/*
 	 * gpujoin_projection
 	 */
@@ -4947,6 +6298,8 @@ gpujoin_codegen(PlannerInfo *root,
 
 	/* required varlena buffer size */
 	gj_info->varlena_bufsz = varlena_bufsz;
+	/* user defined device functions, if any */
+	pgstrom_codegen_user_functions(&source, context);
 
 	return source.data;
 }
@@ -4973,9 +6326,9 @@ GpuJoinSetupTask(struct kern_gpujoin *kgjoin, GpuTaskState *gts,
 	head_sz = STROMALIGN(offsetof(kern_gpujoin,
 								  stat_nitems[gjs->num_rels + 1]));
 	param_sz = STROMALIGN(gjs->gts.kern_params->length);
-	pstack_nrooms = 2048;
+	pstack_nrooms = gjs->pstack_nrooms;
 	pstack_sz = MAXALIGN(sizeof(cl_uint) *
-						 pstack_nrooms * ((nrels+1) * (nrels+2)) / 2);
+						 KERN_GPUJOIN_PSEUDO_STACK_LENGTH(pstack_nrooms, nrels));
 	suspend_sz = STROMALIGN(offsetof(gpujoinSuspendContext,
 									 pd[nrels + 1]));
 	if (kgjoin)
@@ -5044,6 +6397,7 @@ gpujoin_create_task(GpuJoinState *gjs,
 		pgjoin->with_nvme_strom = true;
 	}
 	GpuJoinSetupTask(&pgjoin->kern, &gjs->gts, pds_src);
+	pgjoin->kern.dst_nchains = gpujoin_dst_chains;
 
 	return &pgjoin->task;
 }
@@ -5117,6 +6471,32 @@ gpujoin_switch_task(GpuTaskState *gts, GpuTask *gtask)
 {
 }
 
+/*
+ * gpujoin_cpu_task
+ *
+ * It marks the GpuTask to be processed by CPU using the fallback code, if
+ * the outer chunk is already accessible on the host side. Tasks of RIGHT
+ * OUTER JOIN are always processed by GPU.
+ */
+static bool
+gpujoin_cpu_task(GpuTaskState *gts, GpuTask *gtask)
+{
+	GpuJoinTask	   *pgjoin = (GpuJoinTask *) gtask;
+	pgstrom_data_store *pds_src = pgjoin->pds_src;
+
+	if (pds_src &&
+		(pds_src->kds.format == KDS_FORMAT_ROW ||
+		 (pds_src->kds.format == KDS_FORMAT_BLOCK &&
+		  pds_src->nblocks_uncached == 0) ||
+		 (pds_src->kds.format == KDS_FORMAT_ARROW &&
+		  pds_src->iovec == NULL)))
+	{
+		pgjoin->task.cpu_fallback = true;
+		return true;
+	}
+	return false;
+}
+
 /*
  * gpujoin_next_task
  */
@@ -5197,14 +6577,16 @@ gpujoinSyncRightOuterJoin(GpuTaskState *gts)
 	{
 		/*
 		 * In case of PG workers, the last process per GPU needs to write back
-		 * OUTER JOIN map to the DSM area. (only happen on multi-GPU mode)
+		 * OUTER JOIN map to the DSM area, if partition-wise GpuJoin. (only
+		 * happen on multi-GPU mode) Elsewhere, the master process pulls the
+		 * map from the device memory by peer-to-peer copy.
 		 */
 		kern_multirels *h_kmrels = shared_mmap_address(gjs->seg_kmrels);
 		cl_int			dindex = gcontext->cuda_dindex;
 		uint32			pg_nworkers_pergpu =
 			pg_atomic_sub_fetch_u32(&gj_sstate->pergpu[dindex].pg_nworkers, 1);
 
-		if (pg_nworkers_pergpu == 0)
+		if (pg_nworkers_pergpu == 0 && gjs->sibling)
 		{
 			CUresult	rc;
 			size_t		offset = (h_kmrels->kmrels_length +
@@ -5454,6 +6836,125 @@ gpujoin_fallback_tuple_extract(TupleTableSlot *slot_fallback,
 	}
 }
 
+/*
+ * gpujoinFallbackBuildHashIndex
+ *
+ * It builds an array of (hash, row_index) pairs sorted by the hash value
+ * on the inner hash table, once per inner buffer. CPU fallback probes the
+ * array by binary search, then walks on the adjacent entries which have
+ * exactly same hash value, instead of the hash-chain of the device hash
+ * table; that contains items of other hash values in the same slot.
+ */
+static int
+__compare_fallback_hindex(const void *__a, const void *__b)
+{
+	cl_ulong	a = *((const cl_ulong *)__a);
+	cl_ulong	b = *((const cl_ulong *)__b);
+
+	if (a < b)
+		return -1;
+	if (a > b)
+		return 1;
+	return 0;
+}
+
+static void
+gpujoinFallbackBuildHashIndex(GpuJoinState *gjs, innerState *istate,
+							  kern_data_store *kds_in)
+{
+	EState	   *estate = gjs->gts.css.ss.ps.state;
+	cl_uint	   *row_index = KERN_DATA_STORE_ROWINDEX(kds_in);
+	cl_ulong   *hindex = NULL;
+	cl_uint		i;
+
+	Assert(kds_in->format == KDS_FORMAT_HASH);
+	if (istate->fallback_hindex)
+		pfree(istate->fallback_hindex);
+	if (kds_in->nitems > 0)
+	{
+		hindex = MemoryContextAllocHuge(estate->es_query_cxt,
+										sizeof(cl_ulong) * kds_in->nitems);
+		for (i=0; i < kds_in->nitems; i++)
+		{
+			kern_hashitem  *khitem = (kern_hashitem *)
+				((char *)kds_in
+				 + __kds_unpack(row_index[i])
+				 - offsetof(kern_hashitem, t));
+			hindex[i] = ((cl_ulong)khitem->hash << 32) | (cl_ulong)row_index[i];
+		}
+		qsort(hindex, kds_in->nitems, sizeof(cl_ulong),
+			  __compare_fallback_hindex);
+	}
+	istate->fallback_hindex = hindex;
+	istate->fallback_hindex_kds = kds_in;
+	istate->fallback_hindex_pos = -1;
+}
+
+/*
+ * gpujoinFallbackResetHashIndex - discards the CPU hash index, if any
+ */
+static void
+gpujoinFallbackResetHashIndex(GpuJoinState *gjs)
+{
+	int		i;
+
+	for (i=0; i < gjs->num_rels; i++)
+	{
+		innerState *istate = &gjs->inners[i];
+
+		if (istate->fallback_hindex)
+			pfree(istate->fallback_hindex);
+		istate->fallback_hindex = NULL;
+		istate->fallback_hindex_kds = NULL;
+		istate->fallback_hindex_pos = -1;
+	}
+}
+
+/*
+ * gpujoinFallbackHashIndexLookup
+ *
+ * It returns the first (if is_first) or the next hash item that has
+ * the supplied hash value, or NULL if no more items.
+ */
+static kern_hashitem *
+gpujoinFallbackHashIndexLookup(innerState *istate,
+							   kern_data_store *kds_in,
+							   cl_uint hash, bool is_first)
+{
+	cl_ulong   *hindex = istate->fallback_hindex;
+	cl_long		pos;
+
+	if (is_first)
+	{
+		cl_ulong	key = ((cl_ulong)hash << 32);
+		cl_long		head = 0;
+		cl_long		tail = kds_in->nitems;
+
+		/* lower bound of the hash value */
+		while (head < tail)
+		{
+			cl_long		curr = (head + tail) / 2;
+
+			if (hindex[curr] < key)
+				head = curr + 1;
+			else
+				tail = curr;
+		}
+		pos = head;
+	}
+	else
+	{
+		Assert(istate->fallback_hindex_pos >= 0);
+		pos = istate->fallback_hindex_pos + 1;
+	}
+	if (pos >= kds_in->nitems || (cl_uint)(hindex[pos] >> 32) != hash)
+		return NULL;
+	istate->fallback_hindex_pos = pos;
+	return (kern_hashitem *)((char *)kds_in
+							 + __kds_unpack((cl_uint)hindex[pos])
+							 - offsetof(kern_hashitem, t));
+}
+
 /*
  * Hash-Join for CPU fallback
  */
@@ -5469,6 +6970,12 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 	cl_uint			hash;
 	bool			retval;
 
+	/* SEMI/ANTI JOIN takes only one inner row per outer row */
+	if (istate->fallback_inner_matched &&
+		(istate->join_type == JOIN_SEMI ||
+		 istate->join_type == JOIN_ANTI))
+		return depth-1;
+
 	do {
 		if (istate->fallback_inner_index == 0)
 		{
@@ -5482,14 +6989,27 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 			if (is_nullkeys)
 				goto end;
 			istate->fallback_inner_hash = hash;
-			for (khitem = KERN_HASH_FIRST_ITEM(kds_in, hash);
-				 khitem && khitem->hash != hash;
-				 khitem = KERN_HASH_NEXT_ITEM(kds_in, khitem));
+			/* rejected by the fingerprint of the hash slot */
+			if (!KERN_MULTIRELS_HASH_FIRST_ITEM(h_kmrels, depth, hash))
+				goto end;
+			if (istate->fallback_hindex_kds != kds_in)
+				gpujoinFallbackBuildHashIndex(gjs, istate, kds_in);
+			khitem = gpujoinFallbackHashIndexLookup(istate, kds_in,
+													hash, true);
+			if (!khitem)
+				goto end;
+		}
+		else if (istate->fallback_hindex_pos >= 0)
+		{
+			hash = istate->fallback_inner_hash;
+			khitem = gpujoinFallbackHashIndexLookup(istate, kds_in,
+													hash, false);
 			if (!khitem)
 				goto end;
 		}
 		else
 		{
+			/* resumed from the suspend context; walk on the hash-chain */
 			hash = istate->fallback_inner_hash;
 			khitem = (kern_hashitem *)
 				((char *)kds_in + istate->fallback_inner_index);
@@ -5515,6 +7035,10 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 	/* update outer join map */
 	if (ojmaps)
 		ojmaps[khitem->rowid] = 1;
+	istate->fallback_inner_matched = true;
+	/* ANTI JOIN never emits outer rows that have matched inner rows */
+	if (istate->join_type == JOIN_ANTI)
+		return depth-1;
 	/* rewind the next depth */
 	if (depth < gjs->num_rels)
 	{
@@ -5527,7 +7051,8 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 end:
 	if (!istate->fallback_inner_matched &&
 		(istate->join_type == JOIN_LEFT ||
-		 istate->join_type == JOIN_FULL))
+		 istate->join_type == JOIN_FULL ||
+		 istate->join_type == JOIN_ANTI))
 	{
 		istate->fallback_inner_matched = true;
 		gpujoin_fallback_tuple_extract(gjs->slot_fallback,
@@ -5562,6 +7087,12 @@ gpujoinFallbackNestLoop(int depth, GpuJoinState *gjs)
 	cl_bool		   *ojmaps = KERN_MULTIRELS_OUTER_JOIN_MAP(h_kmrels, depth);
 	cl_uint			index;
 
+	/* SEMI/ANTI JOIN takes only one inner row per outer row */
+	if (istate->fallback_inner_matched &&
+		(istate->join_type == JOIN_SEMI ||
+		 istate->join_type == JOIN_ANTI))
+		return depth-1;
+
 	for (index = istate->fallback_inner_index;
 		 index < kds_in->nitems;
 		 index++)
@@ -5580,9 +7111,13 @@ gpujoinFallbackNestLoop(int depth, GpuJoinState *gjs)
 		if (retval)
 		{
 			istate->fallback_inner_index = index + 1;
+			istate->fallback_inner_matched = true;
 			/* update outer join map */
 			if (ojmaps)
 				ojmaps[index] = 1;
+			/* ANTI JOIN never emits outer rows with matched inner rows */
+			if (istate->join_type == JOIN_ANTI)
+				return depth-1;
 			/* rewind the next depth */
 			if (depth < gjs->num_rels)
 			{
@@ -5596,7 +7131,8 @@ gpujoinFallbackNestLoop(int depth, GpuJoinState *gjs)
 
 	if (!istate->fallback_inner_matched &&
 		(istate->join_type == JOIN_LEFT ||
-		 istate->join_type == JOIN_FULL))
+		 istate->join_type == JOIN_FULL ||
+		 istate->join_type == JOIN_ANTI))
 	{
 		istate->fallback_inner_index = kds_in->nitems;
 		istate->fallback_inner_matched = true;
@@ -5924,6 +7460,7 @@ lnext:
 					istate->fallback_inner_index =
 						((char *)khitem - (char *)kds_in);
 					istate->fallback_inner_hash = khitem->hash;
+					istate->fallback_hindex_pos = -1;
 					istate->fallback_inner_matched = matched;
 				}
 			}
@@ -6146,28 +7683,61 @@ gpujoinUpdateRunTimeStat(GpuTaskState *gts, kern_gpujoin *kgjoin)
 }
 
 /*
- * gpujoin_throw_partial_result
+ * gpujoin_prefetch_results
+ *
+ * async prefetch of the result rows to the host, prior to the read by
+ * gpujoin_next_tuple(). Only the row-index and the tuples packed from
+ * the tail of kds_dst are valid.
  */
 static void
-gpujoin_throw_partial_result(GpuJoinTask *pgjoin)
+gpujoin_prefetch_results(GpuJoinTask *pgjoin, pgstrom_data_store *pds_dst)
 {
-	GpuContext	   *gcontext = GpuWorkerCurrentContext;
-	GpuTaskState   *gts = pgjoin->task.gts;
-	pgstrom_data_store *pds_dst = pgjoin->pds_dst;
-	pgstrom_data_store *pds_new = PDS_clone(pds_dst);
-	cl_int			num_rels = pgjoin->kern.num_rels;
-	GpuJoinTask	   *gresp;
-	size_t			head_sz;
-	size_t			param_sz;
-	CUresult		rc;
+	CUdeviceptr	m_kds_dst = (CUdeviceptr)&pds_dst->kds;
+	size_t		usage = __kds_unpack(pds_dst->kds.usage);
+	size_t		head_sz;
+	CUresult	rc;
 
-	/* async prefetch kds_dst; which should be on the device memory */
-	rc = cuMemPrefetchAsync((CUdeviceptr) &pds_dst->kds,
-							pds_dst->kds.length,
+	if (pds_dst->kds.nitems == 0)
+		return;
+	head_sz = (KERN_DATA_STORE_HEAD_LENGTH(&pds_dst->kds) +
+			   sizeof(cl_uint) * pds_dst->kds.nitems);
+	rc = cuMemPrefetchAsync(m_kds_dst + pds_dst->kds.length - usage,
+							usage,
 							CU_DEVICE_CPU,
 							CU_STREAM_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	rc = cuMemPrefetchAsync(m_kds_dst,
+							head_sz,
+							CU_DEVICE_CPU,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	pgstromStatGpuTaskDMA(&pgjoin->task, CU_DINDEX_PER_THREAD,
+						  0, usage + head_sz);
+}
+
+/*
+ * gpujoin_throw_partial_result
+ *
+ * It backs the current kds_dst to the backend as a partial result, then
+ * assigns @pds_new (or an empty clone, if NULL) as the new kds_dst.
+ */
+static void
+gpujoin_throw_partial_result(GpuJoinTask *pgjoin,
+							 pgstrom_data_store *pds_new)
+{
+	GpuContext	   *gcontext = GpuWorkerCurrentContext;
+	GpuTaskState   *gts = pgjoin->task.gts;
+	pgstrom_data_store *pds_dst = pgjoin->pds_dst;
+	cl_int			num_rels = pgjoin->kern.num_rels;
+	GpuJoinTask	   *gresp;
+	size_t			head_sz;
+	size_t			param_sz;
+	CUresult		rc;
+
+	/* async prefetch kds_dst; which should be on the device memory */
+	gpujoin_prefetch_results(pgjoin, pds_dst);
 
 	/* setup responder task with supplied @kds_dst */
 	head_sz = STROMALIGN(offsetof(GpuJoinTask, kern) +
@@ -6196,7 +7766,8 @@ gpujoin_throw_partial_result(GpuJoinTask *pgjoin)
 		   KERN_GPUJOIN_PARAMBUF(&pgjoin->kern),
 		   KERN_GPUJOIN_PARAMBUF_LENGTH(&pgjoin->kern));
 	/* assign a new empty buffer */
-	pgjoin->pds_dst			= pds_new;
+	pgjoin->pds_dst			= (pds_new ? pds_new : PDS_clone(pds_dst));
+	pgstromAddGpuTaskResults(gts, pds_dst->kds.nitems);
 
 	/* Back GpuTask to GTS */
 	pthreadMutexLock(gcontext->mutex);
@@ -6208,6 +7779,76 @@ gpujoin_throw_partial_result(GpuJoinTask *pgjoin)
 	SetLatch(MyLatch);
 }
 
+/*
+ * gpujoin_setup_dst_chains
+ *
+ * It assigns empty overflow buffers to the kernel, so GPU kernel can
+ * continue to write out the results without suspend / resume when kds_dst
+ * gets full. They are not prefetched to the device, because they shall
+ * not consume physical pages unless GPU kernel touches them.
+ */
+static void
+gpujoin_setup_dst_chains(GpuJoinTask *pgjoin,
+						 pgstrom_data_store **pds_chains)
+{
+	cl_uint		i;
+
+	Assert(pgjoin->kern.dst_nchains <= GPUJOIN_MAX_DST_CHAINS);
+	pgjoin->kern.dst_curr_chain = 0;
+	for (i=0; i < pgjoin->kern.dst_nchains; i++)
+	{
+		if (!pds_chains[i])
+			pds_chains[i] = PDS_clone(pgjoin->pds_dst);
+		pgjoin->kern.dst_chains[i] = (cl_ulong)&pds_chains[i]->kds;
+	}
+}
+
+/*
+ * gpujoin_drain_dst_chains
+ *
+ * It backs the overflow buffers consumed by GPU kernel to the backend,
+ * then the last one becomes the kds_dst of the GpuJoinTask. Unused ones
+ * are kept for the next invocation.
+ */
+static void
+gpujoin_drain_dst_chains(GpuJoinTask *pgjoin,
+						 pgstrom_data_store **pds_chains)
+{
+	cl_uint		i, j, nused = pgjoin->kern.dst_curr_chain;
+
+	Assert(nused <= pgjoin->kern.dst_nchains);
+	for (i=0; i < nused; i++)
+	{
+		gpujoin_throw_partial_result(pgjoin, pds_chains[i]);
+		pds_chains[i] = NULL;
+	}
+	/* move the unused buffers to the head */
+	for (i=0, j=nused; j < pgjoin->kern.dst_nchains; i++, j++)
+	{
+		pds_chains[i] = pds_chains[j];
+		pds_chains[j] = NULL;
+	}
+	pgjoin->kern.dst_curr_chain = 0;
+}
+
+/*
+ * gpujoin_release_dst_chains
+ */
+static void
+gpujoin_release_dst_chains(GpuJoinTask *pgjoin,
+						   pgstrom_data_store **pds_chains)
+{
+	cl_uint		i;
+
+	for (i=0; i < GPUJOIN_MAX_DST_CHAINS; i++)
+	{
+		if (pds_chains[i])
+			PDS_release(pds_chains[i]);
+		pds_chains[i] = NULL;
+	}
+	pgjoin->kern.dst_curr_chain = 0;
+}
+
 /*
  * gpujoinColocateOuterJoinMapsToHost
  *
@@ -6267,7 +7908,7 @@ gpujoinColocateOuterJoinMaps(GpuTaskState *gts, CUmodule cuda_module)
 	CUfunction		kern_colocate;
 	CUresult		rc;
 	size_t			ojmaps_sz = h_kmrels->ojmaps_length;
-	cl_int			grid_sz;
+	cl_int			i, grid_sz;
 	cl_int			block_sz;
 	void		   *kern_args[4];
 
@@ -6283,19 +7924,52 @@ gpujoinColocateOuterJoinMaps(GpuTaskState *gts, CUmodule cuda_module)
 
 	h_ojmaps = ((char *)h_kmrels + h_kmrels->kmrels_length);
 	m_ojmaps = gjs->m_kmrels + h_kmrels->kmrels_length;
-	if (CU_DINDEX_PER_THREAD > 0)
+	if (gjs->m_kmrels_array && !gjs->sibling)
 	{
-		rc = cuMemcpyHtoD(m_ojmaps,
-						  h_ojmaps,
-						  ojmaps_sz * CU_DINDEX_PER_THREAD);
+		/*
+		 * The master process holds the inner buffer of all the devices,
+		 * so OUTER JOIN maps are pulled from the peer devices directly;
+		 * only the map by CPU fallback comes from the host.
+		 */
+		for (i=0; i < numDevAttrs; i++)
+		{
+			GpuContext *__gcontext = gjs->m_kmrels_gcontext[i];
+
+			if (i == CU_DINDEX_PER_THREAD ||
+				gjs->m_kmrels_array[i] == 0UL)
+				continue;
+			rc = cuMemcpyPeerAsync(m_ojmaps + ojmaps_sz * i,
+								   CU_CONTEXT_PER_THREAD,
+								   gjs->m_kmrels_array[i] +
+								   h_kmrels->kmrels_length + ojmaps_sz * i,
+								   __gcontext->cuda_context,
+								   ojmaps_sz,
+								   CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemcpyPeerAsync: %s", errorText(rc));
+		}
+		rc = cuMemcpyHtoD(m_ojmaps + ojmaps_sz * numDevAttrs,
+						  h_ojmaps + ojmaps_sz * numDevAttrs,
+						  ojmaps_sz);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemcpyHtoD: %s", errorText(rc));
+	}
+	else
+	{
+		if (CU_DINDEX_PER_THREAD > 0)
+		{
+			rc = cuMemcpyHtoD(m_ojmaps,
+							  h_ojmaps,
+							  ojmaps_sz * CU_DINDEX_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemcpyHtoD: %s", errorText(rc));
+		}
+		rc = cuMemcpyHtoD(m_ojmaps + ojmaps_sz * (CU_DINDEX_PER_THREAD + 1),
+						  h_ojmaps + ojmaps_sz * (CU_DINDEX_PER_THREAD + 1),
+						  (numDevAttrs - CU_DINDEX_PER_THREAD) * ojmaps_sz);
 		if (rc != CUDA_SUCCESS)
 			werror("failed on cuMemcpyHtoD: %s", errorText(rc));
 	}
-	rc = cuMemcpyHtoD(m_ojmaps + ojmaps_sz * (CU_DINDEX_PER_THREAD + 1),
-					  h_ojmaps + ojmaps_sz * (CU_DINDEX_PER_THREAD + 1),
-					  (numDevAttrs - CU_DINDEX_PER_THREAD) * ojmaps_sz);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuMemcpyHtoD: %s", errorText(rc));
 
 	/*
 	 * Launch)
@@ -6316,8 +7990,8 @@ gpujoinColocateOuterJoinMaps(GpuTaskState *gts, CUmodule cuda_module)
 	kern_args[1] = &numDevAttrs;
 
 	rc = cuLaunchKernel(kern_colocate,
-						block_sz, 1, 1,
 						grid_sz, 1, 1,
+						block_sz, 1, 1,
 						0,
 						CU_STREAM_PER_THREAD,
 						kern_args,
@@ -6346,7 +8020,9 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	cl_int				retval = 10001;
 	void			   *kern_args[10];
 	void			   *last_suspend = NULL;
+	pgstrom_data_store *pds_chains[GPUJOIN_MAX_DST_CHAINS];
 
+	memset(pds_chains, 0, sizeof(pds_chains));
 	/* sanity checks */
 	Assert(!pds_src || (pds_src->kds.format == KDS_FORMAT_ROW ||
 						pds_src->kds.format == KDS_FORMAT_BLOCK ||
@@ -6369,9 +8045,15 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 
 		Assert(pds_src->kds.format == KDS_FORMAT_BLOCK ||
 			   pds_src->kds.format == KDS_FORMAT_ARROW);
-		rc = gpuMemAllocIOMap(gcontext,
-							  &m_kds_src,
-							  required);
+		/* columns on the GPU buffer don't need i/o mapped memory */
+		if (pds_src->kds.format == KDS_FORMAT_ARROW && pds_src->gpubuf_iov)
+			rc = gpuMemAlloc(gcontext,
+							 &m_kds_src,
+							 required);
+		else
+			rc = gpuMemAllocIOMap(gcontext,
+								  &m_kds_src,
+								  required);
 		if (rc == CUDA_SUCCESS)
 			m_kds_src_release = true;
 		else if (rc == CUDA_ERROR_OUT_OF_MEMORY)
@@ -6381,9 +8063,10 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 			{
 				PDS_fillup_blocks(pds_src);
 
-				rc = gpuMemAlloc(gcontext,
-								 &m_kds_src,
-                                 required);
+				rc = gpuMemAllocAsync(gcontext,
+									  &m_kds_src,
+									  required,
+									  CU_STREAM_PER_THREAD);
 				if (rc == CUDA_SUCCESS)
 					m_kds_src_release = true;
 				else if (rc == CUDA_ERROR_OUT_OF_MEMORY)
@@ -6410,9 +8093,13 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	/*
 	 * OK, kick a series of GpuJoin invocations
 	 */
+	GpuWorkerStageBegin(&pgjoin->task);
 	if (pgjoin->with_nvme_strom)
 	{
-		gpuMemCopyFromSSD(m_kds_src, pds_src);
+		if (pds_src->kds.format == KDS_FORMAT_ARROW && pds_src->gpubuf_iov)
+			gpuMemCopyFromGpuBuffer(m_kds_src, pds_src);
+		else
+			gpuMemCopyFromSSD(m_kds_src, pds_src);
 	}
 	else if (pds_src->kds.format == KDS_FORMAT_BLOCK)
 	{
@@ -6433,6 +8120,11 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 		if (rc != CUDA_SUCCESS)
 			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 	}
+	/* MVCC visibility checks on the raw blocks, if needed */
+	PDS_check_visibility(pds_src, m_kds_src, cuda_module);
+	if (!pgjoin->with_nvme_strom)
+		pgstromStatGpuTaskDMA(&pgjoin->task, CU_DINDEX_PER_THREAD,
+							  pds_src->kds.length, 0);
 
 	/* Launch:
 	 * KERNEL_FUNCTION(void)
@@ -6449,17 +8141,39 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 							 0, sizeof(cl_int));
 	if (rc != CUDA_SUCCESS)
 		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	block_sz = Min(block_sz,
+				   GPUJOIN_PSTACK_MAX_BLOCK_SZ(pgjoin->kern.pstack_nrooms));
 	pgjoin->kern.grid_sz	= grid_sz;
 	pgjoin->kern.block_sz	= block_sz;
 
 resume_kernel:
 	m_kds_dst = (CUdeviceptr)&pds_dst->kds;
+	gpujoin_setup_dst_chains(pgjoin, pds_chains);
+	/*
+	 * kern_gpujoin and kparams are referenced by all the threads, and
+	 * kds_dst shall be filled up by the GPU kernel. Pseudo stack and
+	 * suspend context are not prefetched, because they shall not consume
+	 * physical pages unless GPU kernel is suspended.
+	 */
+	rc = cuMemPrefetchAsync(m_kgjoin,
+							KERN_GPUJOIN_HEAD_LENGTH(&pgjoin->kern),
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	rc = cuMemPrefetchAsync(m_kds_dst,
+							pds_dst->kds.length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 	kern_args[0] = &m_kgjoin;
 	kern_args[1] = &gjs->m_kmrels;
 	kern_args[2] = &m_kds_src;
 	kern_args[3] = &m_kds_dst;
 	kern_args[4] = &m_nullptr;
 
+	GpuWorkerStageLaunch(&pgjoin->task);
 	rc = cuLaunchKernel(kern_gpujoin_main,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -6478,15 +8192,19 @@ resume_kernel:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	GpuWorkerStageKernel(&pgjoin->task, last_suspend != NULL);
 
 	memcpy(&pgjoin->task.kerror,
 		   &pgjoin->kern.kerror, sizeof(kern_errorbuf));
 	if (pgjoin->task.kerror.errcode == ERRCODE_STROM_SUCCESS)
 	{
+		/* results on the overflow buffers, if any */
+		gpujoin_drain_dst_chains(pgjoin, pds_chains);
+		pds_dst = pgjoin->pds_dst;
 		if (pgjoin->kern.suspend_count > 0)
 		{
 			CHECK_WORKER_TERMINATION();
-			gpujoin_throw_partial_result(pgjoin);
+			gpujoin_throw_partial_result(pgjoin, NULL);
 
 			pgjoin->kern.suspend_count = 0;
 			pgjoin->kern.resume_context = true;
@@ -6501,6 +8219,9 @@ resume_kernel:
 			goto resume_kernel;
 		}
 		gpujoinUpdateRunTimeStat(&gjs->gts, &pgjoin->kern);
+		pgstromAddGpuTaskResults(&gjs->gts, pds_dst->kds.nitems);
+		gpujoin_prefetch_results(pgjoin, pds_dst);
+		GpuWorkerStageRecv(&pgjoin->task, CU_STREAM_PER_THREAD);
 		/* return task if any result rows */
 		retval = (pds_dst->kds.nitems > 0 ? 0 : -1);
 	}
@@ -6528,6 +8249,8 @@ resume_kernel:
 		}
 		memset(&pgjoin->task.kerror, 0, sizeof(kern_errorbuf));
 		pgjoin->task.cpu_fallback = true;
+		/* CPU fallback discards the results since the last suspend */
+		gpujoin_release_dst_chains(pgjoin, pds_chains);
 		pgjoin->kern.resume_context = (last_suspend != NULL);
 		if (last_suspend)
 		{
@@ -6543,6 +8266,7 @@ resume_kernel:
 		retval = 0;
 	}
 out_of_resource:
+	gpujoin_release_dst_chains(pgjoin, pds_chains);
 	if (m_kds_src_release)
 		gpuMemFree(gcontext, m_kds_src);
 	return retval;
@@ -6563,8 +8287,10 @@ gpujoin_process_right_outer(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	cl_int				block_sz;
 	void			   *kern_args[5];
 	void			   *last_suspend = NULL;
+	pgstrom_data_store *pds_chains[GPUJOIN_MAX_DST_CHAINS];
 	cl_int				retval;
 
+	memset(pds_chains, 0, sizeof(pds_chains));
 	/* sanity checks */
 	Assert(!pgjoin->pds_src);
 	Assert(pds_dst->kds.format == KDS_FORMAT_ROW);
@@ -6595,14 +8321,37 @@ gpujoin_process_right_outer(GpuJoinTask *pgjoin, CUmodule cuda_module)
 							 0, sizeof(cl_int));
 	if (rc != CUDA_SUCCESS)
 		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	block_sz = Min(block_sz,
+				   GPUJOIN_PSTACK_MAX_BLOCK_SZ(pgjoin->kern.pstack_nrooms));
+	GpuWorkerStageBegin(&pgjoin->task);
 resume_kernel:
 	m_kds_dst = (CUdeviceptr)&pds_dst->kds;
+	gpujoin_setup_dst_chains(pgjoin, pds_chains);
+	/*
+	 * kern_gpujoin and kparams are referenced by all the threads, and
+	 * kds_dst shall be filled up by the GPU kernel. Pseudo stack and
+	 * suspend context are not prefetched, because they shall not consume
+	 * physical pages unless GPU kernel is suspended.
+	 */
+	rc = cuMemPrefetchAsync(m_kgjoin,
+							KERN_GPUJOIN_HEAD_LENGTH(&pgjoin->kern),
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	rc = cuMemPrefetchAsync(m_kds_dst,
+							pds_dst->kds.length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 	kern_args[0] = &m_kgjoin;
 	kern_args[1] = &gjs->m_kmrels;
 	kern_args[2] = &outer_depth;
 	kern_args[3] = &m_kds_dst;
 	kern_args[4] = &m_nullptr;
 
+	GpuWorkerStageLaunch(&pgjoin->task);
 	rc = cuLaunchKernel(kern_gpujoin_main,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -6621,16 +8370,20 @@ resume_kernel:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	GpuWorkerStageKernel(&pgjoin->task, last_suspend != NULL);
 
 	memcpy(&pgjoin->task.kerror,
 		   &pgjoin->kern.kerror, sizeof(kern_errorbuf));
 	if (pgjoin->task.kerror.errcode == ERRCODE_STROM_SUCCESS)
 	{
+		/* results on the overflow buffers, if any */
+		gpujoin_drain_dst_chains(pgjoin, pds_chains);
+		pds_dst = pgjoin->pds_dst;
 		if (pgjoin->kern.suspend_count > 0)
 		{
 			CHECK_WORKER_TERMINATION();
 
-			gpujoin_throw_partial_result(pgjoin);
+			gpujoin_throw_partial_result(pgjoin, NULL);
 			pds_dst = pgjoin->pds_dst;	/* buffer renew */
 
 			pgjoin->kern.suspend_count = 0;
@@ -6643,6 +8396,9 @@ resume_kernel:
 			goto resume_kernel;
 		}
 		gpujoinUpdateRunTimeStat(&gjs->gts, &pgjoin->kern);
+		pgstromAddGpuTaskResults(&gjs->gts, pds_dst->kds.nitems);
+		gpujoin_prefetch_results(pgjoin, pds_dst);
+		GpuWorkerStageRecv(&pgjoin->task, CU_STREAM_PER_THREAD);
 		/* return task if any result rows */
 		retval = (pds_dst->kds.nitems > 0 ? 0 : -1);
 	}
@@ -6651,6 +8407,8 @@ resume_kernel:
 	{
 		memset(&pgjoin->task.kerror, 0, sizeof(kern_errorbuf));
 		pgjoin->task.cpu_fallback = true;
+		/* CPU fallback discards the results since the last suspend */
+		gpujoin_release_dst_chains(pgjoin, pds_chains);
 		pgjoin->kern.resume_context = (last_suspend != NULL);
 		if (last_suspend)
 		{
@@ -6665,6 +8423,7 @@ resume_kernel:
 		/* raise an error */
 		retval = 0;
 	}
+	gpujoin_release_dst_chains(pgjoin, pds_chains);
 	return retval;
 }
 
@@ -6674,10 +8433,14 @@ gpujoin_process_task(GpuTask *gtask, CUmodule cuda_module)
 	GpuJoinTask *pgjoin = (GpuJoinTask *) gtask;
 	int		retval;
 
+	pgstromNvtxRangePush("GpuJoin (plan=%d, seq=%u)",
+						 gtask->gts->css.ss.ps.plan->plan_id,
+						 gtask->task_seq);
 	if (pgjoin->pds_src)
 		retval = gpujoin_process_inner_join(pgjoin, cuda_module);
 	else
 		retval = gpujoin_process_right_outer(pgjoin, cuda_module);
+	pgstromNvtxRangePop();
 
 	return retval;
 }
@@ -6800,7 +8563,7 @@ gpujoin_compaction_inner_kds(kern_data_store *kds_in)
 		   kds_in->nslots == 0);
 	front_sz = KERN_DATA_STORE_HEAD_LENGTH(kds_in) +
 		STROMALIGN(sizeof(cl_uint) * kds_in->nitems) +
-		STROMALIGN(sizeof(cl_uint) * kds_in->nslots);
+		STROMALIGN(sizeof(kern_hashslot) * kds_in->nslots);
 	Assert(front_sz == MAXALIGN(front_sz));
 	Assert(front_sz + curr_usage <= kds_in->length);
 	shift = kds_in->length - (front_sz + curr_usage);
@@ -6816,6 +8579,149 @@ gpujoin_compaction_inner_kds(kern_data_store *kds_in)
 	}
 }
 
+/*
+ * gpujoin_inner_update_key_range
+ *
+ * It tracks min/max value of the inner hash key; outer Arrow_Fdw can skip
+ * RecordBatches out of the range.
+ */
+static void
+gpujoin_inner_update_key_range(innerState *istate)
+{
+	ExprState  *ikey = linitial(istate->hash_inner_keys);
+	FmgrInfo   *cmp_func = &istate->range_tcache->cmp_proc_finfo;
+	Datum		datum;
+	bool		isnull;
+
+	/* ecxt_innertuple is already set by get_tuple_hashvalue() */
+	datum = ExecEvalExpr(ikey, istate->econtext, &isnull);
+	if (isnull)
+		return;
+	if (!istate->range_valid)
+	{
+		istate->range_min = datum;
+		istate->range_max = datum;
+		istate->range_valid = true;
+	}
+	else if (DatumGetInt32(FunctionCall2(cmp_func, istate->range_min,
+										 datum)) > 0)
+		istate->range_min = datum;
+	else if (DatumGetInt32(FunctionCall2(cmp_func, istate->range_max,
+										 datum)) < 0)
+		istate->range_max = datum;
+}
+
+/*
+ * gpujoin_inner_prune_row
+ *
+ * It returns true, if the current inner row is out of the partition bound
+ * of the outer relation, thus, never matches.
+ */
+static bool
+gpujoin_inner_prune_row(innerState *istate)
+{
+	FmgrInfo   *cmp_func = &istate->prune_tcache->cmp_proc_finfo;
+	Datum		datum;
+	bool		isnull;
+	int			i, cmp;
+
+	datum = ExecEvalExpr(istate->prune_key, istate->econtext, &isnull);
+	if (isnull)
+		return false;	/* to be handled by the hash-join logic */
+	for (i=0; i < istate->nprune_conds; i++)
+	{
+		cmp = DatumGetInt32(FunctionCall2(cmp_func, datum,
+										  istate->prune_values[i]));
+		switch (istate->prune_strategy[i])
+		{
+			case BTLessStrategyNumber:
+				if (cmp >= 0)
+					return true;
+				break;
+			case BTLessEqualStrategyNumber:
+				if (cmp > 0)
+					return true;
+				break;
+			case BTEqualStrategyNumber:
+				if (cmp != 0)
+					return true;
+				break;
+			case BTGreaterEqualStrategyNumber:
+				if (cmp < 0)
+					return true;
+				break;
+			case BTGreaterStrategyNumber:
+				if (cmp <= 0)
+					return true;
+				break;
+			default:
+				break;
+		}
+	}
+	return false;
+}
+
+/*
+ * gpujoin_inner_range_batch
+ *
+ * It returns the batch number the current inner row belongs to, if batched
+ * inner hash table is split by the key range.
+ */
+static cl_int
+gpujoin_inner_range_batch(innerState *istate)
+{
+	ExprState  *ikey = linitial(istate->hash_inner_keys);
+	FmgrInfo   *cmp_func = &istate->range_tcache->cmp_proc_finfo;
+	Datum		datum;
+	bool		isnull;
+	cl_int		left = 0;
+	cl_int		right = istate->hash_nbatches - 1;
+
+	/* ecxt_innertuple is already set by get_tuple_hashvalue() */
+	datum = ExecEvalExpr(ikey, istate->econtext, &isnull);
+	if (isnull)
+		return 0;	/* NULL keys are kept for outer join, if any */
+	/* the first batch whose upper bound is larger than or equal to */
+	while (left < right)
+	{
+		cl_int	curr = (left + right) / 2;
+
+		if (DatumGetInt32(FunctionCall2(cmp_func, datum,
+										istate->batch_bounds[curr])) <= 0)
+			right = curr;
+		else
+			left = curr + 1;
+	}
+	return left;
+}
+
+/*
+ * gpujoin_inner_bloom_filter
+ *
+ * It builds bloom filter of the inner hash table.
+ */
+static void
+gpujoin_inner_bloom_filter(kern_data_store *kds_hash,
+						   cl_uint *bloom, cl_uint nbits)
+{
+	cl_uint	   *row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
+	cl_uint		i, k;
+
+	memset(bloom, 0, nbits / BITS_PER_BYTE);
+	for (i=0; i < kds_hash->nitems; i++)
+	{
+		kern_hashitem  *khitem = (kern_hashitem *)
+			((char *)kds_hash
+			 + __kds_unpack(row_index[i])
+			 - offsetof(kern_hashitem, t));
+
+		k = KERN_BLOOM_FILTER_BIT1(khitem->hash, nbits);
+		bloom[k >> 5] |= (1U << (k & 31));
+		k = KERN_BLOOM_FILTER_BIT2(khitem->hash, nbits);
+		bloom[k >> 5] |= (1U << (k & 31));
+	}
+}
+
 /*
  * gpujoin_inner_hash_preload
  *
@@ -6830,11 +8736,12 @@ gpujoin_inner_hash_preload(innerState *istate,
 {
 	TupleTableSlot *scan_slot;
 	cl_uint		   *row_index;
-	cl_uint		   *hash_slot;
+	kern_hashslot  *hash_slot;
 	cl_uint			i, j;
 	pg_crc32		hash;
 	bool			is_null_keys;
 
+	istate->range_valid = false;
 	for (;;)
 	{
 		scan_slot = ExecProcNode(istate->state);
@@ -6842,6 +8749,25 @@ gpujoin_inner_hash_preload(innerState *istate,
 			break;
 
 		(void)ExecFetchSlotHeapTuple(scan_slot, false, NULL);
+		/* inner rows out of the outer partition bound never match */
+		if (istate->nprune_conds > 0)
+		{
+			istate->econtext->ecxt_innertuple = scan_slot;
+			if (gpujoin_inner_prune_row(istate))
+				continue;
+		}
+		/* hash value shall be calculated by the device kernel */
+		if (istate->device_build)
+		{
+			while (!KDS_insert_hashitem(kds_hash, scan_slot, 0))
+				kds_hash = gpujoin_expand_inner_kds(seg, kds_offset);
+			if (istate->range_attnum > 0)
+			{
+				istate->econtext->ecxt_innertuple = scan_slot;
+				gpujoin_inner_update_key_range(istate);
+			}
+			continue;
+		}
 		hash = get_tuple_hashvalue(istate, true, scan_slot,
 								   &is_null_keys);
 		/*
@@ -6850,18 +8776,34 @@ gpujoin_inner_hash_preload(innerState *istate,
 		 * we don't need to keep this tuple in the 
 		 */
 		if (is_null_keys && (istate->join_type == JOIN_INNER ||
-							 istate->join_type == JOIN_LEFT))
+							 istate->join_type == JOIN_LEFT ||
+							 istate->join_type == JOIN_SEMI ||
+							 istate->join_type == JOIN_ANTI))
+			continue;
+		/* only tuples in the current batch, if hash table is split */
+		if (istate->batch_bounds)
+		{
+			if (gpujoin_inner_range_batch(istate) != istate->hash_curr_batch)
+				continue;
+		}
+		else if (istate->hash_nbatches > 1 &&
+				 DatumGetUInt32(hash_uint32(hash)) % istate->hash_nbatches
+				 != istate->hash_curr_batch)
 			continue;
 
 		while (!KDS_insert_hashitem(kds_hash, scan_slot, hash))
 			kds_hash = gpujoin_expand_inner_kds(seg, kds_offset);
+		if (istate->range_attnum > 0)
+			gpujoin_inner_update_key_range(istate);
 	}
 	kds_hash->nslots = __KDS_NSLOTS(kds_hash->nitems);
 	gpujoin_compaction_inner_kds(kds_hash);
 	/* construction of the hash table */
 	row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
 	hash_slot = KERN_DATA_STORE_HASHSLOT(kds_hash);
-	memset(hash_slot, 0, sizeof(cl_uint) * kds_hash->nslots);
+	memset(hash_slot, 0, sizeof(kern_hashslot) * kds_hash->nslots);
+	if (istate->device_build)
+		return;		/* to be built by gpujoin_inner_device_build() */
 	for (i=0; i < kds_hash->nitems; i++)
 	{
 		kern_hashitem  *khitem = (kern_hashitem *)
@@ -6870,10 +8812,77 @@ gpujoin_inner_hash_preload(innerState *istate,
 			 - offsetof(kern_hashitem, t));
 		Assert(khitem->rowid == i);
 		j = khitem->hash % kds_hash->nslots;
-		khitem->next = hash_slot[j];
-		hash_slot[j] = __kds_packed((char *)khitem -
-									(char *)kds_hash);
+		khitem->next = hash_slot[j].s.first;
+		hash_slot[j].s.first = __kds_packed((char *)khitem -
+											(char *)kds_hash);
+		hash_slot[j].s.tags |= KERN_HASH_FINGERPRINT(khitem->hash);
+	}
+}
+
+/*
+ * gpujoin_inner_heap_sort
+ *
+ * It reorders the row-index of the inner data store by the nestloop key,
+ * so GPU kernel can look up the candidate inner rows of the outer row by
+ * binary search. Rows with NULL key never match to the range qualifiers,
+ * so they are moved to the tail, out of the sorted_nitems.
+ */
+typedef struct
+{
+	Datum		key;
+	cl_uint		index;
+} gpujoin_sort_item;
+
+static int
+__gpujoin_sort_item_comp(const void *__a, const void *__b, void *arg)
+{
+	const gpujoin_sort_item *a = (const gpujoin_sort_item *)__a;
+	const gpujoin_sort_item *b = (const gpujoin_sort_item *)__b;
+	FmgrInfo   *cmp_func = (FmgrInfo *)arg;
+	int			rv;
+
+	rv = DatumGetInt32(FunctionCall2(cmp_func, a->key, b->key));
+	if (rv != 0)
+		return rv;
+	/* keeps the order of preload, for the stable results */
+	if (a->index < b->index)
+		return -1;
+	if (a->index > b->index)
+		return 1;
+	return 0;
+}
+
+static void
+gpujoin_inner_heap_sort(innerState *istate,
+						kern_data_store *kds_heap,
+						gpujoin_sort_item *items,
+						cl_uint nitems)
+{
+	cl_uint	   *row_index = KERN_DATA_STORE_ROWINDEX(kds_heap);
+	cl_uint	   *sorted_index;
+	cl_uint		i, j;
+
+	qsort_arg(items, nitems, sizeof(gpujoin_sort_item),
+			  __gpujoin_sort_item_comp,
+			  &istate->nestloop_tcache->cmp_proc_finfo);
+	sorted_index = MemoryContextAllocHuge(CurrentMemoryContext,
+										  sizeof(cl_uint) * kds_heap->nitems);
+	for (i=0; i < nitems; i++)
+	{
+		sorted_index[i] = row_index[items[i].index];
+		row_index[items[i].index] = 0;
+	}
+	/* rows with NULL key follow the sorted rows */
+	for (i=0, j=nitems; i < kds_heap->nitems; i++)
+	{
+		if (row_index[i] != 0)
+			sorted_index[j++] = row_index[i];
 	}
+	Assert(j == kds_heap->nitems);
+	memcpy(row_index, sorted_index, sizeof(cl_uint) * kds_heap->nitems);
+	pfree(sorted_index);
+
+	istate->sorted_nitems = nitems;
 }
 
 /*
@@ -6889,7 +8898,11 @@ gpujoin_inner_heap_preload(innerState *istate,
 						   size_t kds_offset)
 {
 	PlanState	   *scan_ps = istate->state;
+	ExprContext	   *econtext = istate->econtext;
 	TupleTableSlot *scan_slot;
+	gpujoin_sort_item *items = NULL;
+	cl_uint			nitems = 0;
+	cl_uint			nrooms = 0;
 
 	for (;;)
 	{
@@ -6899,80 +8912,1006 @@ gpujoin_inner_heap_preload(innerState *istate,
 		(void)ExecFetchSlotHeapTuple(scan_slot, false, NULL);
 		while (!KDS_insert_tuple(kds_heap, scan_slot))
 			kds_heap = gpujoin_expand_inner_kds(seg, kds_offset);
+
+		/* nestloop key of the row just inserted, if sorted */
+		if (istate->nestloop_key)
+		{
+			Datum		datum;
+			bool		isnull;
+
+			econtext->ecxt_innertuple = scan_slot;
+			datum = ExecEvalExpr(istate->nestloop_key, econtext, &isnull);
+			if (isnull)
+				continue;
+			if (nitems >= nrooms)
+			{
+				nrooms = Max(2 * nrooms, 4096);
+				if (!items)
+					items = MemoryContextAllocHuge(CurrentMemoryContext,
+										sizeof(gpujoin_sort_item) * nrooms);
+				else
+					items = repalloc_huge(items, sizeof(gpujoin_sort_item) *
+										  nrooms);
+			}
+			items[nitems].key = datum;
+			items[nitems].index = kds_heap->nitems - 1;
+			nitems++;
+		}
 	}
 	Assert(kds_heap->nslots == 0);
 	gpujoin_compaction_inner_kds(kds_heap);
+	if (istate->nestloop_key)
+	{
+		gpujoin_inner_heap_sort(istate, kds_heap, items, nitems);
+		if (items)
+			pfree(items);
+	}
 	if (kds_heap->length > (size_t)UINT_MAX)
 		elog(ERROR, "GpuJoin: inner heap table larger than 4GB is not supported right now (%zu bytes)", kds_heap->length);		
 }
 
 /*
- * gpujoin_inner_preload
+ * gpujoin_inner_hash_rebuild
  *
- * It preload inner relation to the DSM buffer once.
+ * CPU fallback of gpujoin_build_hash_table(); it calculates hash value of
+ * the inner rows already loaded, then links them to the hash slots.
  */
-static bool
-__gpujoin_inner_preload(GpuJoinState *gjs, bool preload_multi_gpu)
+static void
+gpujoin_inner_hash_rebuild(innerState *istate, kern_multirels *h_kmrels)
 {
-	GpuContext	   *gcontext = gjs->gts.gcontext;
-	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
-	kern_multirels *h_kmrels;
-	kern_data_store *kds;
-	shared_mmap_segment *seg;
-	int				i, num_rels = gjs->num_rels;
-	int				dindex_min;
-	int				dindex_max;
-	size_t			ojmaps_usage = 0;
-	size_t			kmrels_usage = 0;
-	size_t			required;
-	bool			result = true;
-
-	Assert(!IsParallelWorker());
-	gjs->m_kmrels_array = MemoryContextAllocZero(CurTransactionContext,
-										numDevAttrs * sizeof(CUdeviceptr));
-	gjs->m_kmrels_gcontext = MemoryContextAllocZero(CurTransactionContext,
-										numDevAttrs * sizeof(GpuContext *));
-	seg = shared_mmap_create(pgstrom_chunk_size());
-	h_kmrels = shared_mmap_address(seg);
-	kmrels_usage = STROMALIGN(offsetof(kern_multirels, chunks[num_rels]));
-	memset(h_kmrels, 0, kmrels_usage);
+	kern_data_store *kds_hash = KERN_MULTIRELS_INNER_KDS(h_kmrels,
+														 istate->depth);
+	cl_uint		   *bloom = KERN_MULTIRELS_BLOOM_FILTER(h_kmrels,
+														istate->depth);
+	cl_uint		   *row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
+	kern_hashslot  *hash_slot = KERN_DATA_STORE_HASHSLOT(kds_hash);
+	TupleDesc		tupdesc;
+	TupleTableSlot *slot;
+	HeapTupleData	tuple;
+	cl_uint			i, j;
+	cl_uint			hash;
+	bool			is_null_keys;
 
-	/*
-	 * Load inner relations
-	 */
-	for (i=0; i < num_rels; i++)
+	tupdesc = istate->state->ps_ResultTupleSlot->tts_tupleDescriptor;
+	slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsHeapTuple);
+	memset(hash_slot, 0, sizeof(kern_hashslot) * kds_hash->nslots);
+	for (i=0; i < kds_hash->nitems; i++)
 	{
-		innerState	   *istate = &gjs->inners[i];
-		PlanState	   *scan_ps = istate->state;
-		TupleTableSlot *ps_slot = scan_ps->ps_ResultTupleSlot;
-		TupleDesc		ps_desc = ps_slot->tts_tupleDescriptor;
-		kern_data_store *kds;
-		size_t			dsm_length;
-		size_t			kds_length;
-		size_t			kds_head_sz;
+		kern_hashitem  *khitem = (kern_hashitem *)
+			((char *)kds_hash
+			 + __kds_unpack(row_index[i])
+			 - offsetof(kern_hashitem, t));
 
-		/* expand DSM on demand */
-		dsm_length = shared_mmap_length(seg);
-		kds_head_sz = KDS_calculateHeadSize(ps_desc);
-		while (kmrels_usage + kds_head_sz > dsm_length)
-		{
-			size_t	new_length = TYPEALIGN(BLCKSZ, (3 * dsm_length) / 2);
+		tuple.t_len = khitem->t.t_len;
+		tuple.t_self = khitem->t.t_self;
+		tuple.t_tableOid = InvalidOid;
+		tuple.t_data = &khitem->t.htup;
+		ExecStoreHeapTuple(&tuple, slot, false);
 
-			h_kmrels = shared_mmap_expand(seg, new_length);
-			dsm_length = shared_mmap_length(seg);
+		hash = get_tuple_hashvalue(istate, true, slot, &is_null_keys);
+		khitem->hash = hash;
+		if (is_null_keys && (istate->join_type != JOIN_RIGHT &&
+							 istate->join_type != JOIN_FULL))
+		{
+			khitem->next = 0;
+			continue;
 		}
-		kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
-		kds_length = Min(dsm_length - kmrels_usage, 0x100000000L);
-		init_kernel_data_store(kds,
-							   ps_desc,
-							   kds_length,
-							   (istate->hash_inner_keys != NIL
-								? KDS_FORMAT_HASH
-								: KDS_FORMAT_ROW),
-							   UINT_MAX);
-		h_kmrels->chunks[i].chunk_offset = kmrels_usage;
-		if (istate->hash_inner_keys != NIL)
-			gpujoin_inner_hash_preload(istate, seg, kds, kmrels_usage);
+		j = hash % kds_hash->nslots;
+		khitem->next = hash_slot[j].s.first;
+		hash_slot[j].s.first = __kds_packed((char *)khitem -
+											(char *)kds_hash);
+		hash_slot[j].s.tags |= KERN_HASH_FINGERPRINT(hash);
+	}
+	if (bloom)
+		gpujoin_inner_bloom_filter(kds_hash, bloom,
+						h_kmrels->chunks[istate->depth-1].bloom_nbits);
+	ExecDropSingleTupleTableSlot(slot);
+}
+
+/*
+ * gpujoin_inner_hash_skew
+ *
+ * It samples hash values of the inner hash table to detect heavy-hitter
+ * keys, then moves their hash items from the hash slots to the dedicated
+ * chains of the skew table. It returns true, if any items are moved.
+ */
+typedef struct
+{
+	cl_uint		hash;
+	cl_uint		count;
+} gpujoin_skew_sample;
+
+static int
+__gpujoin_skew_hash_comp(const void *__a, const void *__b)
+{
+	cl_uint		a = ((const gpujoin_skew_sample *)__a)->hash;
+	cl_uint		b = ((const gpujoin_skew_sample *)__b)->hash;
+
+	if (a < b)
+		return -1;
+	if (a > b)
+		return 1;
+	return 0;
+}
+
+static int
+__gpujoin_skew_count_comp(const void *__a, const void *__b)
+{
+	cl_uint		a = ((const gpujoin_skew_sample *)__a)->count;
+	cl_uint		b = ((const gpujoin_skew_sample *)__b)->count;
+
+	/* descending order */
+	if (a > b)
+		return -1;
+	if (a < b)
+		return 1;
+	return 0;
+}
+
+static bool
+gpujoin_inner_hash_skew(kern_multirels *h_kmrels, int depth)
+{
+	kern_data_store *kds_hash = KERN_MULTIRELS_INNER_KDS(h_kmrels, depth);
+	kern_skewitem  *skew = KERN_MULTIRELS_SKEW_TABLE(h_kmrels, depth);
+	cl_uint		   *row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
+	kern_hashslot  *hash_slot = KERN_DATA_STORE_HASHSLOT(kds_hash);
+	gpujoin_skew_sample *samples;
+	cl_uint			nsamples;
+	cl_uint			nheavy = 0;
+	cl_uint			nitems = 0;
+	cl_uint			i, j;
+
+	h_kmrels->chunks[depth-1].skew_nitems = 0;
+	if (!skew || kds_hash->nitems < GPUJOIN_SKEW_THRESHOLD)
+		return false;
+
+	/* sample hash values at even intervals */
+	nsamples = Min(kds_hash->nitems, GPUJOIN_SKEW_NSAMPLES);
+	samples = palloc(sizeof(gpujoin_skew_sample) * nsamples);
+	for (i=0; i < nsamples; i++)
+	{
+		kern_hashitem  *khitem = (kern_hashitem *)
+			((char *)kds_hash
+			 + __kds_unpack(row_index[(size_t)i * kds_hash->nitems /
+									  nsamples])
+			 - offsetof(kern_hashitem, t));
+		samples[i].hash = khitem->hash;
+		samples[i].count = 1;
+	}
+	qsort(samples, nsamples, sizeof(gpujoin_skew_sample),
+		  __gpujoin_skew_hash_comp);
+	for (i=0, j=1; j <= nsamples; j++)
+	{
+		if (j < nsamples && samples[j].hash == samples[i].hash)
+			continue;
+		/* estimated number of the inner rows with this hash value */
+		if ((double)(j - i) * (double)kds_hash->nitems /
+			(double)nsamples >= (double)GPUJOIN_SKEW_THRESHOLD)
+		{
+			samples[nheavy].hash = samples[i].hash;
+			samples[nheavy].count = j - i;
+			nheavy++;
+		}
+		i = j;
+	}
+	if (nheavy > GPUJOIN_SKEW_MAX_NITEMS)
+	{
+		qsort(samples, nheavy, sizeof(gpujoin_skew_sample),
+			  __gpujoin_skew_count_comp);
+		nheavy = GPUJOIN_SKEW_MAX_NITEMS;
+	}
+	qsort(samples, nheavy, sizeof(gpujoin_skew_sample),
+		  __gpujoin_skew_hash_comp);
+
+	/* move the hash items of heavy-hitters to the skew table */
+	for (i=0; i < nheavy; i++)
+	{
+		cl_uint		hash = samples[i].hash;
+		cl_uint	   *pnext = &hash_slot[hash % kds_hash->nslots].s.first;
+		cl_uint	   *ptail;
+
+		skew[nitems].hash = hash;
+		skew[nitems].first = 0;
+		ptail = &skew[nitems].first;
+		while (*pnext != 0)
+		{
+			kern_hashitem  *khitem = (kern_hashitem *)
+				((char *)kds_hash + __kds_unpack(*pnext));
+
+			if (khitem->hash == hash)
+			{
+				*ptail = *pnext;
+				*pnext = khitem->next;
+				ptail = &khitem->next;
+			}
+			else
+				pnext = &khitem->next;
+		}
+		*ptail = 0;
+		/* NULL-keys are not linked to the hash slot */
+		if (skew[nitems].first != 0)
+			nitems++;
+	}
+	h_kmrels->chunks[depth-1].skew_nitems = nitems;
+	pfree(samples);
+
+	return (nitems > 0);
+}
+
+/*
+ * gpujoin_inner_device_build
+ *
+ * It builds the inner hash tables loaded without hash values on the device,
+ * then writes back them to the host buffer, because CPU fallback and other
+ * devices also reference the inner hash tables.
+ */
+static void
+gpujoin_inner_device_build(GpuJoinState *gjs,
+						   GpuContext *gcontext,
+						   CUdeviceptr m_kmrels,
+						   kern_multirels *h_kmrels)
+{
+	kern_parambuf  *kparams = gjs->gts.kern_params;
+	CUmodule		cuda_module = NULL;
+	CUfunction		kern_build;
+	CUdeviceptr		m_buffer = 0UL;
+	CUdeviceptr		m_kerror = 0UL;
+	CUdeviceptr		m_kparams = 0UL;
+	kern_errorbuf  *kerror = NULL;
+	CUresult		rc;
+	cl_int			grid_sz;
+	cl_int			block_sz;
+	cl_int			depth;
+	void		   *kern_args[4];
+
+	for (depth=1; depth <= gjs->num_rels; depth++)
+	{
+		innerState	   *istate = &gjs->inners[depth-1];
+		kern_data_store *kds_hash = KERN_MULTIRELS_INNER_KDS(h_kmrels, depth);
+		size_t			kds_offset = h_kmrels->chunks[depth-1].chunk_offset;
+		size_t			bloom_offset = h_kmrels->chunks[depth-1].bloom_offset;
+		size_t			bloom_sz;
+		cl_int			__grid_sz;
+		bool			update_device = false;
+
+		if (!istate->device_build || kds_hash->nitems == 0)
+			continue;
+		bloom_sz = h_kmrels->chunks[depth-1].bloom_nbits / BITS_PER_BYTE;
+
+		if (!cuda_module)
+		{
+			size_t		length;
+
+			cuda_module = GpuContextLookupModule(gcontext,
+												 gjs->gts.program_id);
+			rc = cuModuleGetFunction(&kern_build,
+									 cuda_module,
+									 "kern_gpujoin_build_hash_table");
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuModuleGetFunction: %s",
+					 errorText(rc));
+			rc = gpuOptimalBlockSize(&grid_sz,
+									 &block_sz,
+									 kern_build,
+									 gcontext->cuda_device,
+									 0, 0);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuOptimalBlockSize: %s",
+					 errorText(rc));
+
+			length = (STROMALIGN(sizeof(kern_errorbuf)) +
+					  STROMALIGN(kparams->length));
+			rc = gpuMemAllocManaged(gcontext,
+									&m_buffer,
+									length,
+									CU_MEM_ATTACH_GLOBAL);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuMemAllocManaged: %s",
+					 errorText(rc));
+			m_kerror = m_buffer;
+			m_kparams = m_buffer + STROMALIGN(sizeof(kern_errorbuf));
+			kerror = (kern_errorbuf *)m_kerror;
+			memcpy((void *)m_kparams, kparams, kparams->length);
+		}
+		memset(kerror, 0, sizeof(kern_errorbuf));
+
+		/*
+		 * KERNEL_FUNCTION(void)
+		 * kern_gpujoin_build_hash_table(kern_multirels *kmrels,
+		 *                               cl_int depth,
+		 *                               kern_parambuf *kparams,
+		 *                               kern_errorbuf *kerror)
+		 */
+		__grid_sz = Min(grid_sz, (kds_hash->nitems +
+								  block_sz - 1) / block_sz);
+		kern_args[0] = &m_kmrels;
+		kern_args[1] = &depth;
+		kern_args[2] = &m_kparams;
+		kern_args[3] = &m_kerror;
+		rc = cuLaunchKernel(kern_build,
+							__grid_sz, 1, 1,
+							block_sz, 1, 1,
+							0,
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuLaunchKernel: %s", errorText(rc));
+		rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuStreamSynchronize: %s", errorText(rc));
+
+		if (kerror->errcode == ERRCODE_STROM_SUCCESS)
+		{
+			/* write back the hash table (and bloom filter) to the host */
+			rc = cuMemcpyDtoH(kds_hash,
+							  m_kmrels + kds_offset,
+							  kds_hash->length);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+			if (bloom_offset > 0)
+			{
+				rc = cuMemcpyDtoH((char *)h_kmrels + bloom_offset,
+								  m_kmrels + bloom_offset,
+								  bloom_sz);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuMemcpyDtoH: %s",
+						 errorText(rc));
+			}
+		}
+		else if (pgstrom_cpu_fallback_enabled &&
+				 (kerror->errcode & ERRCODE_FLAGS_CPU_FALLBACK) != 0)
+		{
+			/* build the hash table by CPU, then send it to the device */
+			gpujoin_inner_hash_rebuild(istate, h_kmrels);
+			update_device = true;
+		}
+		else
+		{
+			ereport(ERROR,
+					(errcode(kerror->errcode & ~ERRCODE_FLAGS_CPU_FALLBACK),
+					 errmsg("GPU kernel: %s", kerror->message),
+					 errdetail("GPU kernel location: %s:%d [%s]",
+							   kerror->filename,
+							   kerror->lineno,
+							   kerror->funcname)));
+		}
+		/* heavy-hitter keys are moved to the skew table by CPU */
+		if (gpujoin_inner_hash_skew(h_kmrels, depth))
+			update_device = true;
+
+		if (update_device)
+		{
+			size_t	skew_offset = h_kmrels->chunks[depth-1].skew_offset;
+
+			rc = cuMemcpyHtoD(m_kmrels + kds_offset,
+							  kds_hash,
+							  kds_hash->length);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+			if (bloom_offset > 0)
+			{
+				rc = cuMemcpyHtoD(m_kmrels + bloom_offset,
+								  (char *)h_kmrels + bloom_offset,
+								  bloom_sz);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuMemcpyHtoD: %s",
+						 errorText(rc));
+			}
+			if (skew_offset > 0)
+			{
+				rc = cuMemcpyHtoD(m_kmrels + skew_offset,
+								  (char *)h_kmrels + skew_offset,
+								  sizeof(kern_skewitem) *
+								  GPUJOIN_SKEW_MAX_NITEMS);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuMemcpyHtoD: %s",
+						 errorText(rc));
+				rc = cuMemcpyHtoD(m_kmrels +
+								  offsetof(kern_multirels,
+										   chunks[depth-1].skew_nitems),
+								  &h_kmrels->chunks[depth-1].skew_nitems,
+								  sizeof(cl_uint));
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuMemcpyHtoD: %s",
+						 errorText(rc));
+			}
+		}
+	}
+	if (m_buffer != 0UL)
+	{
+		rc = gpuMemFree(gcontext, m_buffer);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuMemFree: %s", errorText(rc));
+	}
+}
+
+/*
+ * __gpujoin_inner_cache_walker
+ *
+ * It checks whether the inner plan always produces the same result under
+ * the same snapshot; only plain tables are scanned without any parameters
+ * and mutable functions. It also records the scanned relations on the key.
+ */
+typedef struct
+{
+	List	   *relids;
+	StringInfo	key;
+} gpujoin_inner_cache_context;
+
+static bool
+__gpujoin_inner_cache_walker(PlanState *ps,
+							 gpujoin_inner_cache_context *context)
+{
+	Plan	   *plan = ps->plan;
+	List	   *exprs = NIL;
+
+	if (!bms_is_empty(plan->allParam))
+		return true;
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+		case T_CustomScan:
+			if (IsA(plan, IndexScan))
+				exprs = ((IndexScan *)plan)->indexqualorig;
+			else if (IsA(plan, IndexOnlyScan))
+				exprs = ((IndexOnlyScan *)plan)->indexqual;
+			else if (IsA(plan, BitmapHeapScan))
+				exprs = ((BitmapHeapScan *)plan)->bitmapqualorig;
+			else if (IsA(plan, CustomScan))
+				exprs = ((CustomScan *)plan)->custom_exprs;
+			if (((Scan *)plan)->scanrelid > 0)
+			{
+				Relation	rel = ((ScanState *)ps)->ss_currentRelation;
+
+				if (!rel || (rel->rd_rel->relkind != RELKIND_RELATION &&
+							 rel->rd_rel->relkind != RELKIND_MATVIEW))
+					return true;
+				context->relids = list_append_unique_oid(context->relids,
+														 RelationGetRelid(rel));
+				appendStringInfo(context->key, "rel%u=%u;",
+								 ((Scan *)plan)->scanrelid,
+								 RelationGetRelid(rel));
+			}
+			break;
+		case T_BitmapIndexScan:
+			exprs = ((BitmapIndexScan *)plan)->indexqualorig;
+			break;
+		case T_NestLoop:
+		case T_MergeJoin:
+		case T_HashJoin:
+			exprs = ((Join *)plan)->joinqual;
+			break;
+		case T_BitmapAnd:
+		case T_BitmapOr:
+		case T_Result:
+		case T_Material:
+		case T_Sort:
+		case T_Append:
+		case T_MergeAppend:
+		case T_SubqueryScan:
+		case T_Agg:
+		case T_Group:
+		case T_Unique:
+		case T_Hash:
+		case T_Gather:
+		case T_GatherMerge:
+			break;
+		default:
+			return true;	/* not supported */
+	}
+	if (contain_mutable_functions((Node *)plan->targetlist) ||
+		contain_mutable_functions((Node *)plan->qual) ||
+		contain_mutable_functions((Node *)exprs))
+		return true;
+
+	return planstate_tree_walker(ps, __gpujoin_inner_cache_walker, context);
+}
+
+/*
+ * gpujoin_inner_cache_init_key
+ *
+ * It constructs the key of the inner buffer cache, if this GpuJoin can
+ * reuse the inner buffer built by the other queries. The key consists of
+ * the inner plans, relations, and the snapshot; inner buffer is valid only
+ * if the set of committed transactions is identical.
+ */
+static void
+gpujoin_inner_cache_init_key(GpuJoinState *gjs, GpuJoinInfo *gj_info)
+{
+	EState	   *estate = gjs->gts.css.ss.ps.state;
+	Snapshot	snapshot = estate->es_snapshot;
+	gpujoin_inner_cache_context context;
+	StringInfoData key;
+	TransactionId *xids;
+	int			i, nxids;
+
+	if (!enable_gpujoin_inner_cache ||
+		gpujoin_inner_cache_size_kb == 0 ||
+		gjs->sibling != NULL ||
+		gjs->inner_nbatches > 1 ||
+		estate->es_plannedstmt->commandType != CMD_SELECT ||
+		estate->es_plannedstmt->hasModifyingCTE ||
+		!IsMVCCSnapshot(snapshot) ||
+		snapshot->suboverflowed ||
+		TransactionIdIsValid(GetTopTransactionIdIfAny()))
+		return;
+
+	initStringInfo(&key);
+	appendStringInfo(&key, "db=%u;", MyDatabaseId);
+	/* snapshot; in-progress transactions are sorted */
+	nxids = snapshot->xcnt + snapshot->subxcnt;
+	xids = palloc(sizeof(TransactionId) * (nxids + 1));
+	memcpy(xids, snapshot->xip,
+		   sizeof(TransactionId) * snapshot->xcnt);
+	memcpy(xids + snapshot->xcnt, snapshot->subxip,
+		   sizeof(TransactionId) * snapshot->subxcnt);
+	qsort(xids, nxids, sizeof(TransactionId), xidComparator);
+	appendStringInfo(&key, "xmin=%u;xmax=%u;xip=",
+					 snapshot->xmin, snapshot->xmax);
+	for (i=0; i < nxids; i++)
+		appendStringInfo(&key, "%u,", xids[i]);
+	appendStringInfoChar(&key, ';');
+	pfree(xids);
+
+	memset(&context, 0, sizeof(context));
+	context.key = &key;
+	for (i=0; i < gjs->num_rels; i++)
+	{
+		innerState *istate = &gjs->inners[i];
+		List	   *hash_inner_keys = list_nth(gj_info->hash_inner_keys, i);
+
+		/* RIGHT/FULL OUTER JOIN updates outer join map on the buffer */
+		if (istate->join_type == JOIN_RIGHT ||
+			istate->join_type == JOIN_FULL ||
+			istate->range_attnum > 0 ||
+			istate->nprune_conds > 0 ||
+			contain_mutable_functions((Node *)hash_inner_keys) ||
+			__gpujoin_inner_cache_walker(istate->state, &context))
+		{
+			pfree(key.data);
+			return;
+		}
+		appendStringInfo(&key, "depth%d={join=%d;bloom=%d;device=%d;"
+						 "keys=%s;sort=%s;plan=%s};",
+						 istate->depth,
+						 (int)istate->join_type,
+						 (int)istate->bloom_filter,
+						 (int)istate->device_build,
+						 nodeToString(hash_inner_keys),
+						 nodeToString(list_nth(gj_info->nestloop_keys, i)),
+						 nodeToString(istate->state->plan));
+	}
+	gjs->inner_cache_key = key.data;
+	gjs->inner_cache_relids = context.relids;
+}
+
+/*
+ * putGpuJoinInnerCache
+ *
+ * NOTE: caller must have exclusive lock of the GpuJoinInnerCacheHead
+ */
+static void
+putGpuJoinInnerCache(GpuJoinInnerCache *entry)
+{
+	CUresult	rc;
+
+	Assert(entry->refcnt > 0);
+	if (--entry->refcnt > 0)
+		return;
+	Assert(!entry->is_valid);
+	/* CUDA_ERROR_NOT_FOUND, if already evicted by the keeper */
+	rc = gpuMemFreePreserved(entry->cuda_dindex, entry->ipc_mhandle);
+	if (rc != CUDA_SUCCESS && rc != CUDA_ERROR_NOT_FOUND)
+		elog(WARNING, "failed on gpuMemFreePreserved: %s", errorText(rc));
+	pfree(entry);
+}
+
+/*
+ * __invalidateGpuJoinInnerCache
+ *
+ * NOTE: caller must have exclusive lock of the GpuJoinInnerCacheHead
+ */
+static void
+__invalidateGpuJoinInnerCache(GpuJoinInnerCache *entry)
+{
+	Assert(entry->is_valid);
+	dlist_delete(&entry->chain);
+	dlist_delete(&entry->lru_chain);
+	entry->is_valid = false;
+	putGpuJoinInnerCache(entry);
+}
+
+/*
+ * reserveGpuJoinInnerCache
+ *
+ * It checks whether a new inner buffer of @nbytes fits the budget of the
+ * device (pg_strom.gpujoin_inner_cache_size), and evicts the inner buffers
+ * not referenced by any queries, in LRU order.
+ *
+ * NOTE: caller must have exclusive lock of the GpuJoinInnerCacheHead
+ */
+static bool
+reserveGpuJoinInnerCache(int cuda_dindex, size_t nbytes)
+{
+	size_t		budget = (size_t)gpujoin_inner_cache_size_kb << 10;
+	size_t		usage = 0;
+	dlist_mutable_iter iter;
+
+	if (nbytes > budget)
+		return false;
+	dlist_foreach_modify(iter, &gpujoin_inner_cache_head->lru_list)
+	{
+		GpuJoinInnerCache *entry = dlist_container(GpuJoinInnerCache,
+												   lru_chain, iter.cur);
+		if (entry->cuda_dindex == cuda_dindex)
+			usage += entry->nbytes;
+	}
+	dlist_foreach_modify(iter, &gpujoin_inner_cache_head->lru_list)
+	{
+		GpuJoinInnerCache *entry = dlist_container(GpuJoinInnerCache,
+												   lru_chain, iter.cur);
+		if (usage + nbytes <= budget)
+			break;
+		if (entry->cuda_dindex != cuda_dindex || entry->refcnt > 1)
+			continue;
+		usage -= entry->nbytes;
+		__invalidateGpuJoinInnerCache(entry);
+	}
+	return (usage + nbytes <= budget);
+}
+
+/*
+ * gpujoin_inner_cache_lookup
+ *
+ * It looks up the inner buffer cache that matches the key of this GpuJoin,
+ * then maps the device memory and copies the inner buffer to the host for
+ * CPU fallback. It returns true, if inner buffer is ready by the cache.
+ */
+static bool
+gpujoin_inner_cache_lookup(GpuJoinState *gjs)
+{
+	GpuContext	   *gcontext = gjs->gts.gcontext;
+	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
+	GpuJoinInnerCache *entry = NULL;
+	GpuJoinInnerCacheRef *cref;
+	shared_mmap_segment *seg;
+	kern_multirels *h_kmrels;
+	uint32			hash;
+	dlist_iter		iter;
+	CUdeviceptr		m_kmrels;
+	CUresult		rc;
+
+	if (!gjs->inner_cache_key ||
+		TransactionIdIsValid(GetTopTransactionIdIfAny()))
+		return false;
+	hash = DatumGetUInt32(hash_any((unsigned char *)gjs->inner_cache_key,
+								   strlen(gjs->inner_cache_key)));
+	LWLockAcquire(&gpujoin_inner_cache_head->lock, LW_EXCLUSIVE);
+	dlist_foreach(iter, &gpujoin_inner_cache_head->hash_slots[hash %
+											GPUJOIN_INNER_CACHE_NSLOTS])
+	{
+		GpuJoinInnerCache *temp = dlist_container(GpuJoinInnerCache,
+												  chain, iter.cur);
+		if (temp->hash == hash &&
+			temp->cuda_dindex == gcontext->cuda_dindex &&
+			strcmp(temp->key, gjs->inner_cache_key) == 0)
+		{
+			/* preserved memory may be evicted by the keeper */
+			if (!gpuMemPreservedGet(temp->cuda_dindex, temp->ipc_mhandle))
+			{
+				__invalidateGpuJoinInnerCache(temp);
+				break;
+			}
+			entry = temp;
+			entry->refcnt++;
+			entry->last_used = GetCurrentTimestamp();
+			dlist_delete(&entry->lru_chain);
+			dlist_push_tail(&gpujoin_inner_cache_head->lru_list,
+							&entry->lru_chain);
+			break;
+		}
+	}
+	LWLockRelease(&gpujoin_inner_cache_head->lock);
+	if (!entry)
+		return false;
+
+	cref = MemoryContextAllocZero(TopMemoryContext,
+								  sizeof(GpuJoinInnerCacheRef));
+	cref->entry = entry;
+	dlist_push_tail(&gpujoin_inner_cache_refs, &cref->chain);
+	gjs->inner_cache = cref;
+
+	rc = gpuIpcOpenMemHandle(gcontext,
+							 &m_kmrels,
+							 entry->ipc_mhandle,
+							 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+	cref->gcontext = GetGpuContext(gcontext);
+	cref->m_kmrels = m_kmrels;
+
+	/* host copy of the inner buffer */
+	seg = shared_mmap_create(entry->nbytes);
+	h_kmrels = shared_mmap_address(seg);
+	GPUCONTEXT_PUSH(gcontext);
+	rc = cuMemcpyDtoH(h_kmrels, m_kmrels, entry->nbytes);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+	GPUCONTEXT_POP(gcontext);
+	h_kmrels->cuda_dindex = numDevAttrs;	/* host side */
+
+	gjs->m_kmrels = m_kmrels;
+	gjs->m_kmrels_array[gcontext->cuda_dindex] = m_kmrels;
+	gjs->m_kmrels_gcontext[gcontext->cuda_dindex] = cref->gcontext;
+	gjs->seg_kmrels = seg;
+	gjs->inner_cache_hit = true;
+	gj_sstate->pergpu[gcontext->cuda_dindex].m_handle = entry->ipc_mhandle;
+	gj_sstate->kmrels_handle = shared_mmap_handle(seg);
+
+	return true;
+}
+
+/*
+ * gpujoin_inner_cache_alloc
+ *
+ * It allocates preserved device memory for the inner buffer to be cached.
+ * The new entry is not visible to others until gpujoin_inner_cache_register.
+ */
+static bool
+gpujoin_inner_cache_alloc(GpuJoinState *gjs,
+						  GpuContext *gcontext,
+						  size_t required,
+						  CUdeviceptr *p_m_kmrels,
+						  CUipcMemHandle *p_ipc_mhandle)
+{
+	GpuJoinInnerCache *entry;
+	GpuJoinInnerCacheRef *cref;
+	size_t			key_len = strlen(gjs->inner_cache_key) + 1;
+	int				nrels = list_length(gjs->inner_cache_relids);
+	CUipcMemHandle	ipc_mhandle;
+	CUdeviceptr		m_kmrels;
+	ListCell	   *lc;
+	int				i = 0;
+	bool			reserved;
+	CUresult		rc;
+
+	LWLockAcquire(&gpujoin_inner_cache_head->lock, LW_EXCLUSIVE);
+	reserved = reserveGpuJoinInnerCache(gcontext->cuda_dindex, required);
+	LWLockRelease(&gpujoin_inner_cache_head->lock);
+	if (!reserved)
+		return false;
+
+	rc = gpuMemAllocPreservedEvictable(gcontext->cuda_dindex,
+									   &ipc_mhandle,
+									   required);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(DEBUG2, "failed on gpuMemAllocPreservedEvictable: %s",
+			 errorText(rc));
+		return false;
+	}
+	entry = MemoryContextAllocZero(TopSharedMemoryContext,
+								   MAXALIGN(sizeof(GpuJoinInnerCache)) +
+								   MAXALIGN(sizeof(Oid) * nrels) +
+								   MAXALIGN(key_len));
+	entry->refcnt = 1;		/* by this GpuJoin */
+	entry->cuda_dindex = gcontext->cuda_dindex;
+	entry->ipc_mhandle = ipc_mhandle;
+	entry->nbytes = required;
+	entry->hash = DatumGetUInt32(hash_any((unsigned char *)
+										  gjs->inner_cache_key,
+										  key_len - 1));
+	entry->database_oid = MyDatabaseId;
+	entry->nrels = nrels;
+	entry->relids = (Oid *)((char *)entry +
+							MAXALIGN(sizeof(GpuJoinInnerCache)));
+	foreach (lc, gjs->inner_cache_relids)
+		entry->relids[i++] = lfirst_oid(lc);
+	entry->key = (char *)entry->relids + MAXALIGN(sizeof(Oid) * nrels);
+	memcpy(entry->key, gjs->inner_cache_key, key_len);
+
+	/* release the preserved memory on error, using the reference */
+	cref = MemoryContextAllocZero(TopMemoryContext,
+								  sizeof(GpuJoinInnerCacheRef));
+	cref->entry = entry;
+	dlist_push_tail(&gpujoin_inner_cache_refs, &cref->chain);
+	gjs->inner_cache = cref;
+
+	rc = gpuIpcOpenMemHandle(gcontext,
+							 &m_kmrels,
+							 ipc_mhandle,
+							 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+	cref->gcontext = gcontext;
+	cref->m_kmrels = m_kmrels;
+
+	*p_m_kmrels = m_kmrels;
+	*p_ipc_mhandle = ipc_mhandle;
+	return true;
+}
+
+/*
+ * gpujoin_inner_cache_register
+ *
+ * It makes the inner buffer visible to the later queries.
+ */
+static void
+gpujoin_inner_cache_register(GpuJoinState *gjs)
+{
+	GpuJoinInnerCache *entry = gjs->inner_cache->entry;
+	int			index = entry->hash % GPUJOIN_INNER_CACHE_NSLOTS;
+
+	LWLockAcquire(&gpujoin_inner_cache_head->lock, LW_EXCLUSIVE);
+	entry->is_valid = true;
+	entry->refcnt++;		/* by the cache */
+	entry->last_used = GetCurrentTimestamp();
+	dlist_push_tail(&gpujoin_inner_cache_head->hash_slots[index],
+					&entry->chain);
+	dlist_push_tail(&gpujoin_inner_cache_head->lru_list,
+					&entry->lru_chain);
+	LWLockRelease(&gpujoin_inner_cache_head->lock);
+}
+
+/*
+ * gpujoin_inner_cache_release
+ *
+ * It releases the reference to the inner buffer cache. If @cref is NULL,
+ * all the remaining references are released at end of the transaction;
+ * GpuContext shall unmap the device memory by itself in this case.
+ */
+static void
+gpujoin_inner_cache_release(GpuJoinInnerCacheRef *cref)
+{
+	dlist_mutable_iter iter;
+	CUresult	rc;
+
+	dlist_foreach_modify(iter, &gpujoin_inner_cache_refs)
+	{
+		GpuJoinInnerCacheRef *temp = dlist_container(GpuJoinInnerCacheRef,
+													 chain, iter.cur);
+		if (cref)
+		{
+			if (temp != cref)
+				continue;
+			if (temp->m_kmrels != 0UL)
+			{
+				rc = gpuIpcCloseMemHandle(temp->gcontext, temp->m_kmrels);
+				if (rc != CUDA_SUCCESS)
+					elog(WARNING, "failed on gpuIpcCloseMemHandle: %s",
+						 errorText(rc));
+			}
+		}
+		dlist_delete(&temp->chain);
+		gpuMemPreservedPut(temp->entry->cuda_dindex,
+						   temp->entry->ipc_mhandle);
+		LWLockAcquire(&gpujoin_inner_cache_head->lock, LW_EXCLUSIVE);
+		putGpuJoinInnerCache(temp->entry);
+		LWLockRelease(&gpujoin_inner_cache_head->lock);
+		pfree(temp);
+	}
+}
+
+/*
+ * gpujoinInnerCacheRelcacheCallback
+ */
+static void
+gpujoinInnerCacheRelcacheCallback(Datum arg, Oid relid)
+{
+	dlist_mutable_iter iter;
+	int			i;
+
+	if (!gpujoin_inner_cache_head)
+		return;
+	LWLockAcquire(&gpujoin_inner_cache_head->lock, LW_EXCLUSIVE);
+	dlist_foreach_modify(iter, &gpujoin_inner_cache_head->lru_list)
+	{
+		GpuJoinInnerCache *entry = dlist_container(GpuJoinInnerCache,
+												   lru_chain, iter.cur);
+		if (entry->database_oid != MyDatabaseId)
+			continue;
+		if (OidIsValid(relid))
+		{
+			for (i=0; i < entry->nrels; i++)
+			{
+				if (entry->relids[i] == relid)
+					break;
+			}
+			if (i == entry->nrels)
+				continue;
+		}
+		__invalidateGpuJoinInnerCache(entry);
+	}
+	LWLockRelease(&gpujoin_inner_cache_head->lock);
+}
+
+/*
+ * gpujoinInnerCacheXactCallback
+ */
+static void
+gpujoinInnerCacheXactCallback(XactEvent event, void *arg)
+{
+	/* inner buffer cache referenced by the aborted query, if any */
+	if (event == XACT_EVENT_COMMIT ||
+		event == XACT_EVENT_ABORT)
+		gpujoin_inner_cache_release(NULL);
+}
+
+/*
+ * gpujoin_inner_preload
+ *
+ * It preload inner relation to the DSM buffer once.
+ */
+static bool
+__gpujoin_inner_preload(GpuJoinState *gjs, bool preload_multi_gpu)
+{
+	GpuContext	   *gcontext = gjs->gts.gcontext;
+	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
+	kern_multirels *h_kmrels;
+	kern_data_store *kds;
+	shared_mmap_segment *seg;
+	int				i, j, num_rels = gjs->num_rels;
+	int				dindex_min;
+	int				dindex_max;
+	size_t			ojmaps_usage = 0;
+	size_t			kmrels_usage = 0;
+	size_t			required;
+	bool			result = true;
+
+	Assert(!IsParallelWorker());
+	gjs->m_kmrels_array = MemoryContextAllocZero(CurTransactionContext,
+										numDevAttrs * sizeof(CUdeviceptr));
+	gjs->m_kmrels_gcontext = MemoryContextAllocZero(CurTransactionContext,
+										numDevAttrs * sizeof(GpuContext *));
+	/* inner buffer built by the other query, if any */
+	if (!preload_multi_gpu && gpujoin_inner_cache_lookup(gjs))
+		return true;
+
+	seg = shared_mmap_create(pgstrom_chunk_size());
+	h_kmrels = shared_mmap_address(seg);
+	kmrels_usage = STROMALIGN(offsetof(kern_multirels, chunks[num_rels]));
+	memset(h_kmrels, 0, kmrels_usage);
+
+	/*
+	 * Load inner relations
+	 */
+	for (i=0; i < num_rels; i++)
+	{
+		innerState	   *istate = &gjs->inners[i];
+		PlanState	   *scan_ps = istate->state;
+		TupleTableSlot *ps_slot = scan_ps->ps_ResultTupleSlot;
+		TupleDesc		ps_desc = ps_slot->tts_tupleDescriptor;
+		kern_data_store *kds;
+		size_t			dsm_length;
+		size_t			kds_length;
+		size_t			kds_head_sz;
+
+		/* expand DSM on demand */
+		dsm_length = shared_mmap_length(seg);
+		kds_head_sz = KDS_calculateHeadSize(ps_desc);
+		while (kmrels_usage + kds_head_sz > dsm_length)
+		{
+			size_t	new_length = TYPEALIGN(BLCKSZ, (3 * dsm_length) / 2);
+
+			h_kmrels = shared_mmap_expand(seg, new_length);
+			dsm_length = shared_mmap_length(seg);
+		}
+		kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
+		kds_length = Min(dsm_length - kmrels_usage, 0x100000000L);
+		init_kernel_data_store(kds,
+							   ps_desc,
+							   kds_length,
+							   (istate->hash_inner_keys != NIL
+								? KDS_FORMAT_HASH
+								: KDS_FORMAT_ROW),
+							   UINT_MAX);
+		h_kmrels->chunks[i].chunk_offset = kmrels_usage;
+		if (istate->hash_inner_keys != NIL)
+			gpujoin_inner_hash_preload(istate, seg, kds, kmrels_usage);
 		else
 			gpujoin_inner_heap_preload(istate, seg, kds, kmrels_usage);
 
@@ -6982,6 +9921,11 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool preload_multi_gpu)
 
 		if (!istate->hash_outer_keys)
 			h_kmrels->chunks[i].is_nestloop = true;
+		if (istate->nestloop_key)
+		{
+			h_kmrels->chunks[i].is_sorted = true;
+			h_kmrels->chunks[i].sorted_nitems = istate->sorted_nitems;
+		}
 		if (istate->join_type == JOIN_RIGHT ||
 			istate->join_type == JOIN_FULL)
 		{
@@ -6994,7 +9938,67 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool preload_multi_gpu)
 		{
 			h_kmrels->chunks[i].left_outer = true;
 		}
+		if (istate->join_type == JOIN_SEMI)
+			h_kmrels->chunks[i].semi_join = true;
+		if (istate->join_type == JOIN_ANTI)
+			h_kmrels->chunks[i].anti_join = true;
 		kmrels_usage += STROMALIGN(kds->length);
+
+		/*
+		 * Bloom filter of the inner hash table, if any. It takes 8bits
+		 * per inner row at least, for the false positive rate about 5%.
+		 */
+		if (istate->bloom_filter && kds->nitems > 0)
+		{
+			size_t		nbits = 1024;
+			size_t		bloom_sz;
+
+			while (nbits < 8 * (size_t)kds->nitems && nbits < (1UL << 31))
+				nbits *= 2;
+			bloom_sz = STROMALIGN(nbits / BITS_PER_BYTE);
+			dsm_length = shared_mmap_length(seg);
+			if (kmrels_usage + bloom_sz > dsm_length)
+			{
+				h_kmrels = shared_mmap_expand(seg, TYPEALIGN(BLCKSZ,
+												kmrels_usage + bloom_sz));
+				kds = KERN_MULTIRELS_INNER_KDS(h_kmrels, i+1);
+			}
+			if (istate->device_build)
+				memset((char *)h_kmrels + kmrels_usage, 0, bloom_sz);
+			else
+				gpujoin_inner_bloom_filter(kds, (cl_uint *)
+										   ((char *)h_kmrels + kmrels_usage),
+										   nbits);
+			h_kmrels->chunks[i].bloom_offset = kmrels_usage;
+			h_kmrels->chunks[i].bloom_nbits = nbits;
+			kmrels_usage += bloom_sz;
+		}
+
+		/*
+		 * Skew table of the heavy-hitter keys, if any. Inner hash table
+		 * built by the device is checked after the construction.
+		 */
+		if (enable_gpuhashjoin_skew &&
+			istate->hash_inner_keys != NIL &&
+			kds->nitems >= GPUJOIN_SKEW_THRESHOLD)
+		{
+			size_t		skew_sz = STROMALIGN(sizeof(kern_skewitem) *
+											 GPUJOIN_SKEW_MAX_NITEMS);
+
+			dsm_length = shared_mmap_length(seg);
+			if (kmrels_usage + skew_sz > dsm_length)
+			{
+				h_kmrels = shared_mmap_expand(seg, TYPEALIGN(BLCKSZ,
+												kmrels_usage + skew_sz));
+				kds = KERN_MULTIRELS_INNER_KDS(h_kmrels, i+1);
+			}
+			memset((char *)h_kmrels + kmrels_usage, 0, skew_sz);
+			h_kmrels->chunks[i].skew_offset = kmrels_usage;
+			h_kmrels->chunks[i].skew_nitems = 0;
+			kmrels_usage += skew_sz;
+			if (!istate->device_build)
+				gpujoin_inner_hash_skew(h_kmrels, i+1);
+		}
 	}
 	Assert(kmrels_usage <= shared_mmap_length(seg));
 	h_kmrels->kmrels_length = kmrels_usage;
@@ -7002,6 +10006,28 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool preload_multi_gpu)
 	h_kmrels->cuda_dindex = numDevAttrs;	/* host side */
 	h_kmrels->nrels = num_rels;
 
+	/*
+	 * Range of the inner keys allows outer Arrow_Fdw to skip RecordBatches
+	 * which never match, according to the min/max statistics.
+	 */
+	if (gjs->gts.af_state)
+	{
+		ExecResetArrowFdwKeyRange(gjs->gts.af_state);
+		for (i=0; i < num_rels; i++)
+		{
+			innerState *istate = &gjs->inners[i];
+
+			if (istate->range_attnum > 0 &&
+				istate->range_valid &&
+				(istate->hash_nbatches <= 1 || istate->batch_bounds))
+				ExecAddArrowFdwKeyRange(gjs->gts.af_state,
+										istate->range_attnum,
+										istate->range_tcache->type_id,
+										istate->range_min,
+										istate->range_max);
+		}
+	}
+
 	/*
 	 * NOTE: Special optimization case. In case when any chunk has no items,
 	 * and all deeper level is inner join, it is obvious no tuples shall be
@@ -7033,40 +10059,86 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool preload_multi_gpu)
 	 */
 	dindex_min = (!preload_multi_gpu ? gcontext->cuda_dindex : 0);
 	dindex_max = (!preload_multi_gpu ? gcontext->cuda_dindex : numDevAttrs-1);
-	for (i = dindex_min; i <= dindex_max; i++)
+	for (j = dindex_min; j <= dindex_max; j++)
 	{
 		GpuContext *__gcontext;
 		CUdeviceptr	m_deviceptr;
 		CUresult	rc;
 
+		/*
+		 * NOTE: The device of the own GpuContext is processed first, because
+		 * it builds the inner hash tables if needed, then other devices
+		 * receive the image written back to the host.
+		 */
+		if (j == dindex_min)
+			i = gcontext->cuda_dindex;
+		else if (j == gcontext->cuda_dindex)
+			i = dindex_min;
+		else
+			i = j;
+
 		if (i == gcontext->cuda_dindex)
 			__gcontext = GetGpuContext(gcontext);
 		else
 			__gcontext = AllocGpuContext(i, false, true, false);
 
-		rc = gpuMemAllocDev(__gcontext,
-							&m_deviceptr,
-							required,
-							&gj_sstate->pergpu[i].m_handle);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on gpuMemAllocDev: %s", errorText(rc));
+		if (!preload_multi_gpu &&
+			gjs->inner_cache_key != NULL &&
+			gpujoin_inner_cache_alloc(gjs, __gcontext, required,
+									  &m_deviceptr,
+									  &gj_sstate->pergpu[i].m_handle))
+		{
+			/* preserved device memory for the inner buffer cache */
+		}
+		else
+		{
+			rc = gpuMemAllocDev(__gcontext,
+								&m_deviceptr,
+								required,
+								&gj_sstate->pergpu[i].m_handle);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuMemAllocDev: %s", errorText(rc));
+		}
 		if (i == gcontext->cuda_dindex)
 			gjs->m_kmrels = m_deviceptr;
 		gjs->m_kmrels_array[i] = m_deviceptr;
 		gjs->m_kmrels_gcontext[i] = __gcontext;
 
 		GPUCONTEXT_PUSH(__gcontext);
-		rc = cuMemcpyHtoD(m_deviceptr, h_kmrels, required);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+		/*
+		 * The same image is sent to multiple devices, so page-lock it once
+		 * to avoid the staging copy by the driver for each transfer.
+		 */
+		if (j == dindex_min && dindex_min < dindex_max)
+			shared_mmap_host_register(seg);
+		/*
+		 * The inner buffer spilled to NVMe-SSD is loaded by SSD2GPU Direct
+		 * piece by piece, not to read back the evicted pages to RAM.
+		 */
+		if (!shared_mmap_load_device(seg, __gcontext, m_deviceptr, required))
+		{
+			rc = cuMemcpyHtoD(m_deviceptr, h_kmrels, required);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+		}
 		rc = cuMemsetD32(m_deviceptr + offsetof(kern_multirels,
 												cuda_dindex),
 						 (unsigned int)i,
 						 1);
 		if (rc != CUDA_SUCCESS)
 			elog(ERROR, "failed on cuMemsetD32: %s", errorText(rc));
+		if (i == gcontext->cuda_dindex)
+			gpujoin_inner_device_build(gjs, __gcontext, m_deviceptr, h_kmrels);
 		GPUCONTEXT_POP(__gcontext);
 	}
+	if (dindex_min < dindex_max)
+	{
+		GPUCONTEXT_PUSH(gcontext);
+		shared_mmap_host_unregister(seg);
+		GPUCONTEXT_POP(gcontext);
+	}
+	if (gjs->inner_cache)
+		gpujoin_inner_cache_register(gjs);
 skip_device_malloc:
 	gj_sstate->kmrels_handle = shared_mmap_handle(seg);
 	gjs->seg_kmrels = seg;
@@ -7147,7 +10219,22 @@ GpuJoinInnerPreload(GpuTaskState *gts, CUdeviceptr *p_m_kmrels)
 		if (!IsParallelWorker())
 		{
 			/* master process is responsible for inner preloading */
-			if (__gpujoin_inner_preload(gjs, preload_multi_gpu))
+			TimestampTz	tv_preload = GetCurrentTimestamp();
+			bool		preloaded;
+
+			pgstromNvtxRangePush("GpuJoinInnerPreload (plan=%d)",
+								 gts->css.ss.ps.plan->plan_id);
+			preloaded = __gpujoin_inner_preload(gjs, preload_multi_gpu);
+			pgstromNvtxRangePop();
+			if (gjs->gts.css.ss.ps.instrument)
+			{
+				GpuTaskStageStat *stat
+					= &gjs->gts.stage_stat[GTSTAGE__INNER_PRELOAD];
+
+				addGpuTaskStageStat(stat, (double)(GetCurrentTimestamp() -
+												   tv_preload) / 1000.0);
+			}
+			if (preloaded)
 			{
 				preload_done = 1;	/* valid inner buffer was loaded */
 				if (sibling)
@@ -7282,6 +10369,8 @@ GpuJoinInnerUnload(GpuTaskState *gts, bool is_rescan)
 
 	if (!gj_sstate || !gjs->seg_kmrels)
 		return;
+	/* CPU hash index shall be rebuilt on the next inner buffer */
+	gpujoinFallbackResetHashIndex(gjs);
 
 	if (IsParallelWorker())
 	{
@@ -7347,9 +10436,20 @@ GpuJoinInnerUnload(GpuTaskState *gts, bool is_rescan)
 				if (gjs->m_kmrels_array[i] == 0UL)
 					continue;
 
-				rc = gpuMemFree(__gcontext, gjs->m_kmrels_array[i]);
-				if (rc != CUDA_SUCCESS)
-					elog(ERROR, "failed on gpuMemFree: %s", errorText(rc));
+				if (gjs->inner_cache &&
+					gjs->inner_cache->m_kmrels == gjs->m_kmrels_array[i])
+				{
+					/* preserved memory is kept by the inner buffer cache */
+					gpujoin_inner_cache_release(gjs->inner_cache);
+					gjs->inner_cache = NULL;
+				}
+				else
+				{
+					rc = gpuMemFree(__gcontext, gjs->m_kmrels_array[i]);
+					if (rc != CUDA_SUCCESS)
+						elog(ERROR, "failed on gpuMemFree: %s",
+							 errorText(rc));
+				}
 				PutGpuContext(__gcontext);
 			}
 			pfree(gjs->m_kmrels_array);
@@ -7431,6 +10531,42 @@ gpujoinHasRightOuterJoin(GpuTaskState *gts)
 	return (kmrels->ojmaps_length > 0);
 }
 
+/*
+ * pgstrom_startup_gpujoin
+ */
+static void
+pgstrom_startup_gpujoin(void)
+{
+	bool	found;
+	int		i;
+
+	if (shmem_startup_next)
+		(*shmem_startup_next)();
+
+	gpujoin_inner_cache_head =
+		ShmemInitStruct("gpujoin_inner_cache_head",
+						MAXALIGN(sizeof(GpuJoinInnerCacheHead)),
+						&found);
+	if (!IsUnderPostmaster)
+	{
+		LWLockInitialize(&gpujoin_inner_cache_head->lock, -1);
+		for (i=0; i < GPUJOIN_INNER_CACHE_NSLOTS; i++)
+			dlist_init(&gpujoin_inner_cache_head->hash_slots[i]);
+		dlist_init(&gpujoin_inner_cache_head->lru_list);
+	}
+
+	gpujoin_feedback_head =
+		ShmemInitStruct("gpujoin_feedback_head",
+						MAXALIGN(sizeof(GpuJoinFeedbackHead)),
+						&found);
+	if (!IsUnderPostmaster)
+	{
+		LWLockInitialize(&gpujoin_feedback_head->lock, -1);
+		memset(gpujoin_feedback_head->items, 0,
+			   sizeof(gpujoin_feedback_head->items));
+	}
+}
+
 /*
  * pgstrom_init_gpujoin
  *
@@ -7448,6 +10584,15 @@ pgstrom_init_gpujoin(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* turn on/off GpuNestLoop on the sorted inner */
+	DefineCustomBoolVariable("pg_strom.enable_gpunestloop_sorted",
+							 "Enables GpuNestLoop to sort inner rows by the range join key",
+							 NULL,
+							 &enable_gpunestloop_sorted,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* turn on/off gpuhashjoin */
 	DefineCustomBoolVariable("pg_strom.enable_gpuhashjoin",
 							 "Enables the use of GpuHashJoin logic",
@@ -7457,6 +10602,78 @@ pgstrom_init_gpujoin(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* turn on/off bloom filter of the inner hash table */
+	DefineCustomBoolVariable("pg_strom.enable_gpujoin_bloom_filter",
+							 "Enables the bloom filter of GpuHashJoin to drop unmatched outer rows prior to the join",
+							 NULL,
+							 &enable_gpujoin_bloom_filter,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off construction of the inner hash table on the device */
+	DefineCustomBoolVariable("pg_strom.enable_gpuhashjoin_device_build",
+							 "Enables to build inner hash table of GpuHashJoin on the device",
+							 NULL,
+							 &enable_gpuhashjoin_device_build,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off skew table of the heavy-hitter keys */
+	DefineCustomBoolVariable("pg_strom.enable_gpuhashjoin_skew",
+							 "Enables GpuHashJoin to handle heavy-hitter keys of the inner hash table separately",
+							 NULL,
+							 &enable_gpuhashjoin_skew,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off pruning of inner rows by the outer partition bound */
+	DefineCustomBoolVariable("pg_strom.enable_gpujoin_partition_prune",
+							 "Enables GpuJoin to prune inner rows by the partition bound of outer relation",
+							 NULL,
+							 &enable_gpujoin_partition_prune,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off pseudo-stack on the shared memory */
+	DefineCustomBoolVariable("pg_strom.enable_gpujoin_shared_pstack",
+							 "Enables GpuJoin with low depth to keep the pseudo-stack on the shared memory",
+							 NULL,
+							 &enable_gpujoin_shared_pstack,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off feedback of the observed nrows to the planner */
+	DefineCustomBoolVariable("pg_strom.enable_gpujoin_feedback",
+							 "Enables GpuJoin planning to use nrows per depth observed by the former executions",
+							 NULL,
+							 &enable_gpujoin_feedback,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off batches split by the inner key range */
+	DefineCustomBoolVariable("pg_strom.enable_gpuhashjoin_range_batches",
+							 "Enables batched GpuHashJoin to split inner hash table by the key range, for sorted Arrow_Fdw outer",
+							 NULL,
+							 &enable_gpuhashjoin_range_batches,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off batched gpuhashjoin for large inner relations */
+	DefineCustomBoolVariable("pg_strom.enable_gpuhashjoin_batches",
+							 "Enables GpuHashJoin to split large inner hash table into multiple batches",
+							 NULL,
+							 &enable_gpuhashjoin_batches,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 #if PG_VERSION_NUM >= 110000
 	/* turn on/off partition wise gpujoin */
 	DefineCustomBoolVariable("pg_strom.enable_partitionwise_gpujoin",
@@ -7470,6 +10687,45 @@ pgstrom_init_gpujoin(void)
 #else
 	enable_partitionwise_gpujoin = false;
 #endif
+	/* turn on/off distribution of parallel workers over multiple GPUs */
+	DefineCustomBoolVariable("pg_strom.enable_gpujoin_multi_gpu",
+							 "Enables parallel workers of GpuJoin to use multiple GPUs",
+							 NULL,
+							 &enable_gpujoin_multi_gpu,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off reuse of the inner buffer across queries */
+	DefineCustomBoolVariable("pg_strom.enable_gpujoin_inner_cache",
+							 "Enables GpuJoin to reuse the inner buffer built by the prior queries",
+							 NULL,
+							 &enable_gpujoin_inner_cache,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.gpujoin_inner_cache_size",
+							"Size of device memory to cache the inner buffer of GpuJoin per device",
+							NULL,
+							&gpujoin_inner_cache_size_kb,
+							0,			/* disabled */
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+	/* number of overflow buffers of the GpuJoin results */
+	DefineCustomIntVariable("pg_strom.gpujoin_dst_chains",
+							"Number of overflow result buffers GpuJoin kernel can switch to without suspend",
+							NULL,
+							&gpujoin_dst_chains,
+							2,
+							0,
+							GPUJOIN_MAX_DST_CHAINS,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
 	/* setup path methods */
 	gpujoin_path_methods.CustomName				= "GpuJoin";
 	gpujoin_path_methods.PlanCustomPath			= PlanGpuJoinPath;
@@ -7497,4 +10753,13 @@ pgstrom_init_gpujoin(void)
 	/* hook registration */
 	set_join_pathlist_next = set_join_pathlist_hook;
 	set_join_pathlist_hook = gpujoin_add_join_path;
+
+	/* shared state of the inner buffer cache */
+	RequestAddinShmemSpace(MAXALIGN(sizeof(GpuJoinInnerCacheHead)) +
+						   MAXALIGN(sizeof(GpuJoinFeedbackHead)));
+	shmem_startup_next = shmem_startup_hook;
+	shmem_startup_hook = pgstrom_startup_gpujoin;
+	RegisterXactCallback(gpujoinInnerCacheXactCallback, NULL);
+	CacheRegisterRelcacheCallback(gpujoinInnerCacheRelcacheCallback, 0);
+	dlist_init(&gpujoin_inner_cache_refs);
 }
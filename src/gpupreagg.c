@@ -28,7 +28,18 @@ static bool					enable_gpupreagg;				/* GUC */
 static bool					enable_pullup_outer_join;		/* GUC */
 static bool					enable_partitionwise_gpupreagg;	/* GUC */
 static bool					enable_numeric_aggfuncs; 		/* GUC */
+static bool					enable_numeric_exact_aggfuncs;	/* GUC */
+static bool					enable_gpupreagg_distinct;		/* GUC */
+static bool					enable_gpupreagg_complete;		/* GUC */
+static bool					enable_gpupreagg_adaptive;		/* GUC */
+static int					gpupreagg_partition_size;		/* GUC */
 static double				gpupreagg_reduction_threshold;	/* GUC */
+static bool					enable_gpupreagg_partial_cache;	/* GUC */
+static int					gpupreagg_partial_cache_size_kb; /* GUC */
+static shmem_startup_hook_type shmem_startup_next = NULL;
+
+/* up to 64 partitions on the hash-partitioned reduction */
+#define GPUPREAGG_MAX_PARTITION_NBITS	6
 
 typedef struct
 {
@@ -55,6 +66,14 @@ typedef struct
 	cl_uint			extra_flags;
 	cl_uint			varlena_bufsz;
 	List		   *used_params;	/* referenced Const/Param */
+	bool			complete_mode;	/* true, if no final Agg node */
+	List		   *final_resnos;	/* resno of the junk Aggref entries */
+	List		   *final_aggargs;	/* partial state of the Aggref above, that
+									 * references the custom_scan_tlist by
+									 * INDEX_VAR; setrefs.c should not update
+									 * this field also */
+	cl_uint			part_nbits;		/* # of hash bits for partition, or 0 */
+	cl_uint			part_index;		/* partition to be reduced */
 } GpuPreAggInfo;
 
 static inline void
@@ -84,6 +103,11 @@ form_gpupreagg_info(CustomScan *cscan, GpuPreAggInfo *gpa_info)
 	privs = lappend(privs, makeInteger(gpa_info->extra_flags));
 	privs = lappend(privs, makeInteger(gpa_info->varlena_bufsz));
 	exprs = lappend(exprs, gpa_info->used_params);
+	privs = lappend(privs, makeInteger(gpa_info->complete_mode));
+	privs = lappend(privs, gpa_info->final_resnos);
+	privs = lappend(privs, gpa_info->final_aggargs);
+	privs = lappend(privs, makeInteger(gpa_info->part_nbits));
+	privs = lappend(privs, makeInteger(gpa_info->part_index));
 
 	cscan->custom_private = privs;
 	cscan->custom_exprs = exprs;
@@ -119,6 +143,11 @@ deform_gpupreagg_info(CustomScan *cscan)
 	gpa_info->extra_flags = intVal(list_nth(privs, pindex++));
 	gpa_info->varlena_bufsz = intVal(list_nth(privs, pindex++));
 	gpa_info->used_params = list_nth(exprs, eindex++);
+	gpa_info->complete_mode = intVal(list_nth(privs, pindex++));
+	gpa_info->final_resnos = list_nth(privs, pindex++);
+	gpa_info->final_aggargs = list_nth(privs, pindex++);
+	gpa_info->part_nbits = intVal(list_nth(privs, pindex++));
+	gpa_info->part_index = intVal(list_nth(privs, pindex++));
 	Assert(pindex == list_length(privs));
 	Assert(eindex == list_length(exprs));
 
@@ -153,11 +182,95 @@ typedef struct
 	size_t			plan_nrows_in;	/* num of outer rows planned */
 	size_t			plan_ngroups;	/* num of groups planned */
 	size_t			plan_extra_sz;	/* size of varlena planned */
+	cl_uint			part_nbits;		/* # of hash bits for partition, or 0 */
+	cl_uint			part_index;		/* partition to be reduced */
+	cl_bool			fallback_disabled; /* CPU fallback is not available */
+	cl_bool			adaptive_reduction; /* choose reduction mode per chunk */
+
+	/* properties of the complete aggregation mode */
+	cl_bool			complete_mode;
+	cl_int			num_final_aggs;
+	struct GpuPreAggFinalAgg *final_aggs;
+	MemoryContext	final_cxt;		/* per-group transition state */
+	Node		   *final_aggcontext; /* pseudo context for AggCheckCallContext */
+
+	/* properties of the partial aggregation cache */
+	char		   *pcache_key;		/* key of the cache, or NULL */
+	uint32			pcache_nbatches; /* number of RecordBatches to scan */
+	ArrowRecordBatchIdent *pcache_idents;
+	uint32			pcache_nreused;	/* number of RecordBatches reused */
+	char		   *pcache_rows;	/* partial results reused from the cache */
+	size_t			pcache_rows_len;
+	size_t			pcache_rows_pos;
+	uint64			pcache_nrows;
+	bool			pcache_store;	/* true, if results shall be cached */
+	StringInfoData	pcache_buf;		/* partial results to be cached */
+	uint64			pcache_buf_nrows;
 } GpuPreAggState;
 
+/*
+ * GpuPreAggPartialCache - partial aggregation results of a GpuPreAgg on
+ * Arrow_Fdw, for reuse by the later queries (shared structure)
+ *
+ * RecordBatches are never modified once written, so the partial results of
+ * the RecordBatches processed by the prior query are still valid. The later
+ * query reuses them, then runs GpuPreAgg only on the RecordBatches newly
+ * appended. The final Agg node merges both of the partial results.
+ * If a file is rewritten, or replaced by truncate/compaction, its st_ctim in
+ * ArrowRecordBatchIdent no longer matches, so the entry is never reused.
+ * Only appends by Arrow_Fdw itself carry the entries over; see
+ * gpupreagg_partial_cache_rebase().
+ */
+#define GPUPREAGG_PARTIAL_CACHE_NSLOTS		256
+typedef struct
+{
+	dlist_node		chain;		/* link to the hash slot */
+	dlist_node		lru_chain;	/* link to the LRU list */
+	uint32			hash;
+	Oid				database_oid;
+	Oid				relid;
+	size_t			nbytes;		/* size of this entry */
+	uint32			nbatches;	/* number of RecordBatches covered */
+	ArrowRecordBatchIdent *idents;	/* sorted by __compareArrowRecordBatchIdent */
+	uint64			nrows;		/* number of partial results */
+	size_t			rows_len;
+	char		   *rows;		/* array of (uint32 t_len, HeapTupleHeader) */
+	char		   *key;
+} GpuPreAggPartialCache;
+
+typedef struct
+{
+	LWLock			lock;
+	size_t			usage;		/* total size of the entries */
+	dlist_head		hash_slots[GPUPREAGG_PARTIAL_CACHE_NSLOTS];
+	dlist_head		lru_list;
+} GpuPreAggPartialCacheHead;
+
+static GpuPreAggPartialCacheHead *gpupreagg_partial_cache_head = NULL;
+
+/*
+ * GpuPreAggFinalAgg - final aggregate function run by GpuPreAgg itself
+ * on the complete aggregation mode.
+ */
+typedef struct GpuPreAggFinalAgg
+{
+	AttrNumber		resno;			/* junk resno on the scan tuple */
+	ExprState	   *arg;			/* partial state on the gpreagg_slot */
+	Oid				inputcollid;
+	FmgrInfo		transfn;
+	FmgrInfo		finalfn;		/* fn_oid is invalid, if no finalfn */
+	Datum			init_value;
+	bool			init_isnull;
+	int16			transtypeLen;
+	bool			transtypeByVal;
+} GpuPreAggFinalAgg;
+
 struct GpuPreAggRuntimeStat
 {
 	GpuTaskRuntimeStat	c;		/* common statistics */
+	pg_atomic_uint64	num_local_reduction;	/* # of chunks by each */
+	pg_atomic_uint64	num_global_reduction;	/* reduction mode */
+	pg_atomic_uint64	num_warp_reduction;
 };
 typedef struct GpuPreAggRuntimeStat	GpuPreAggRuntimeStat;
 
@@ -210,6 +323,7 @@ static bool		gpupreagg_build_path_target(PlannerInfo *root,
 											Path       *input_path,
 											Bitmapset **p_pfunc_bitmap,
 											Node **p_havingQual,
+											List **p_distinct_keys,
 											bool *p_can_pullup_outerscan);
 static char	   *gpupreagg_codegen(codegen_context *context,
 								  CustomScan *cscan,
@@ -229,6 +343,14 @@ static GpuTask *gpupreagg_terminator_task(GpuTaskState *gts,
 static int  gpupreagg_process_task(GpuTask *gtask, CUmodule cuda_module);
 static void gpupreagg_release_task(GpuTask *gtask);
 static TupleTableSlot *gpupreagg_next_tuple(GpuTaskState *gts);
+static bool gpupreagg_async_begin(GpuTaskState *gts);
+static void gpupreagg_partial_cache_init(GpuPreAggState *gpas,
+										 GpuPreAggInfo *gpa_info,
+										 int eflags);
+static TupleTableSlot *gpupreagg_partial_cache_fetch(GpuPreAggState *gpas);
+static void gpupreagg_partial_cache_append(GpuPreAggState *gpas,
+										   TupleTableSlot *slot);
+static void gpupreagg_partial_cache_store(GpuPreAggState *gpas);
 
 /*
  * Arguments of alternative functions.
@@ -303,6 +425,11 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	  "s:pavg", 2, {INT8OID, INT8OID},
 	  {ALTFUNC_EXPR_NROWS, ALTFUNC_EXPR_PSUM}, 0, false
 	},
+	{ "avg",    1, {FLOAT2OID},
+	  "s:favg",     FLOAT8ARRAYOID,
+	  "s:pavg", 2, {INT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS, ALTFUNC_EXPR_PSUM}, 0, false
+	},
 	{ "avg",    1, {FLOAT4OID},
 	  "s:favg",     FLOAT8ARRAYOID,
 	  "s:pavg", 2, {INT8OID, FLOAT8OID},
@@ -347,6 +474,11 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	  "varref", 1, {INT8OID},
 	  {ALTFUNC_EXPR_PMAX}, 0, false
 	},
+	{ "max",    1, {FLOAT2OID},
+	  "s:fmax_float2", FLOAT4OID,
+	  "varref", 1, {FLOAT4OID},
+	  {ALTFUNC_EXPR_PMAX}, 0, false
+	},
 	{ "max",    1, {FLOAT4OID},
 	  "c:max",      FLOAT4OID,
 	  "varref", 1, {FLOAT4OID},
@@ -406,6 +538,11 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	  "varref", 1, {INT8OID},
 	  {ALTFUNC_EXPR_PMIN}, 0, false
 	},
+	{ "min",    1, {FLOAT2OID},
+	  "s:fmin_float2", FLOAT4OID,
+	  "varref", 1, {FLOAT4OID},
+	  {ALTFUNC_EXPR_PMIN}, 0, false
+	},
 	{ "min",    1, {FLOAT4OID},
 	  "c:min",      FLOAT4OID,
 	  "varref", 1, {FLOAT4OID},
@@ -465,6 +602,11 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	  "varref", 1, {INT8OID},
 	  {ALTFUNC_EXPR_PSUM}, 0, false
 	},
+	{ "sum",    1, {FLOAT2OID},
+	  "c:sum",      FLOAT8OID,
+	  "varref", 1, {FLOAT8OID},
+	  {ALTFUNC_EXPR_PSUM}, 0, false
+	},
 	{ "sum",    1, {FLOAT4OID},
 	  "c:sum",      FLOAT4OID,
 	  "varref", 1, {FLOAT4OID},
@@ -509,6 +651,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0, false
 	},
+	{ "stddev",      1, {FLOAT2OID},
+	  "s:stddev",        FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, false
+	},
 	{ "stddev",      1, {FLOAT4OID},
 	  "s:stddev",        FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -554,6 +703,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0
 	},
+	{ "stddev_pop",  1, {FLOAT2OID},
+	  "s:stddev_pop",    FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0
+	},
 	{ "stddev_pop",  1, {FLOAT4OID},
 	  "s:stddev_pop",    FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -599,6 +755,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0
 	},
+	{ "stddev_samp", 1, {FLOAT2OID},
+	  "s:stddev_samp",   FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0
+	},
 	{ "stddev_samp", 1, {FLOAT4OID},
 	  "s:stddev_samp",   FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -644,6 +807,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0
 	},
+	{ "variance",    1, {FLOAT2OID},
+	  "s:variance",      FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0
+	},
 	{ "variance",    1, {FLOAT4OID},
 	  "s:variance",      FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -689,6 +859,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0
 	},
+	{ "var_pop",     1, {FLOAT2OID},
+	  "s:var_pop",       FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0
+	},
 	{ "var_pop",     1, {FLOAT4OID},
 	  "s:var_pop",       FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -734,6 +911,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0
 	},
+	{ "var_samp",    1, {FLOAT2OID},
+	  "s:var_samp",      FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0
+	},
 	{ "var_samp",    1, {FLOAT4OID},
 	  "s:var_samp",      FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -950,6 +1134,7 @@ cost_gpupreagg(PlannerInfo *root,
 			   cl_long index_nblocks)
 {
 	double		gpu_cpu_ratio = pgstrom_gpu_operator_cost / cpu_operator_cost;
+	double		cost_ratio;
 	double		ntuples_out;
 	Cost		startup_cost;
 	Cost		run_cost;
@@ -1093,6 +1278,11 @@ cost_gpupreagg(PlannerInfo *root,
 	/* Cost estimation to fetch results */
 	run_cost += cpu_tuple_cost * ntuples_out;
 
+	/* runtime feedback to the cost model, if any */
+	cost_ratio = pgstrom_gpu_cost_feedback(GpuTaskKind_GpuPreAgg);
+	startup_cost *= cost_ratio;
+	run_cost *= cost_ratio;
+
 	cpath->path.rows			= ntuples_out;
 	cpath->path.startup_cost	= startup_cost;
 	cpath->path.total_cost		= startup_cost + run_cost;
@@ -1299,6 +1489,101 @@ prepend_gpupreagg_path(PlannerInfo *root,
 	return partial_path;
 }
 
+/*
+ * try_add_final_groupingsets_paths
+ *
+ * GpuPreAgg groups the input rows by the union of all the grouping keys,
+ * that is the finest grouping set, then GroupingSets node rolls up the
+ * partial results for each grouping set. So, all the grouping sets are
+ * built by a single scan of the source relation.
+ *
+ * The rollups are copied from the GroupingSetsPath built by the core planner,
+ * because its logic to consolidate grouping sets is not exported. If no
+ * GroupingSetsPath is in the group_rel->pathlist (e.g. another CSP/FDW has
+ * already replaced it by a cheaper path), no path is added here.
+ */
+static void
+try_add_final_groupingsets_paths(PlannerInfo *root,
+								 RelOptInfo *group_rel,
+								 PathTarget *target_final,
+								 Path *partial_path,
+								 List *havingQuals,
+								 double num_groups,
+								 AggClauseCosts *agg_final_costs)
+{
+	PathTarget *target_upper = root->upper_targets[UPPERREL_GROUP_AGG];
+	PathTarget *target_orig __attribute__((unused));
+	Path	   *sort_path = NULL;
+	List	   *strategy_list = NIL;
+	List	   *rollups_list = NIL;
+	ListCell   *lc1, *lc2;
+
+	/*
+	 * Pick up the rollups prior to add_path(), because it may release
+	 * the GroupingSetsPath already in the pathlist.
+	 */
+	foreach (lc1, group_rel->pathlist)
+	{
+		GroupingSetsPath *gspath = lfirst(lc1);
+
+		if (IsA(gspath, GroupingSetsPath))
+		{
+			strategy_list = lappend_int(strategy_list, gspath->aggstrategy);
+			rollups_list = lappend(rollups_list, gspath->rollups);
+		}
+	}
+
+	forboth (lc1, strategy_list,
+			 lc2, rollups_list)
+	{
+		AggStrategy	rollup_strategy = (AggStrategy) lfirst_int(lc1);
+		List	   *rollups = lfirst(lc2);
+		Path	   *sub_path;
+		Path	   *final_path;
+
+		/* all hashed grouping sets need no sorted input */
+		if (rollup_strategy == AGG_HASHED)
+			sub_path = partial_path;
+		else
+		{
+			if (!sort_path)
+				sort_path = (Path *)
+					create_sort_path(root,
+									 group_rel,
+									 partial_path,
+									 root->group_pathkeys,
+									 -1.0);
+			sub_path = sort_path;
+		}
+		final_path = (Path *)
+			create_groupingsets_path(root,
+									 group_rel,
+									 sub_path,
+#if PG_VERSION_NUM < 110000
+									 target_final,
+#endif
+									 havingQuals,
+									 rollup_strategy,
+									 rollups,
+									 agg_final_costs,
+									 num_groups);
+#if PG_VERSION_NUM >= 110000
+		/* adjust cost and overwrite PathTarget */
+		target_orig = final_path->pathtarget;
+		final_path->startup_cost += (target_final->cost.startup -
+									 target_orig->cost.startup);
+		final_path->total_cost += (target_final->cost.startup -
+								   target_orig->cost.startup) +
+			(target_final->cost.per_tuple -
+			 target_orig->cost.per_tuple) * final_path->rows;
+		final_path->pathtarget = target_final;
+#endif
+		add_path(group_rel, pgstrom_create_dummy_path(root,
+													  final_path,
+													  target_upper));
+	}
+}
+
 /*
  * try_add_final_aggregation_paths
  */
@@ -1325,8 +1610,19 @@ try_add_final_aggregation_paths(PlannerInfo *root,
 				agg_final_costs->numOrderedAggs == 0 &&
 				grouping_is_hashable(parse->groupClause));
 
+	/* make final grouping paths (grouping sets) */
+	if (parse->groupingSets)
+	{
+		try_add_final_groupingsets_paths(root,
+										 group_rel,
+										 target_final,
+										 partial_path,
+										 havingQuals,
+										 num_groups,
+										 agg_final_costs);
+	}
 	/* make a final grouping path (nogroup) */
-	if (!parse->groupClause)
+	else if (!parse->groupClause)
 	{
 		final_path = (Path *)create_agg_path(root,
 											 group_rel,
@@ -1355,57 +1651,7 @@ try_add_final_aggregation_paths(PlannerInfo *root,
 								 partial_path,
 								 root->group_pathkeys,
 								 -1.0);
-			if (parse->groupingSets)
-			{
-				AggStrategy	rollup_strategy = AGG_PLAIN;
-				List	   *rollup_data_list = NIL;
-				ListCell   *lc;
-				/*
-				 * TODO: In this version, we expect group_rel->pathlist have
-				 * a GroupingSetsPath constructed by the built-in code.
-				 * It may not be right, if multiple CSP/FDW is installed and
-				 * cheaper path already eliminated the standard path.
-				 * However, it is a corner case now, and we don't support
-				 * this scenario _right now_.
-				 */
-				foreach (lc, group_rel->pathlist)
-				{
-					GroupingSetsPath   *pathnode = lfirst(lc);
-
-					if (IsA(pathnode, GroupingSetsPath))
-					{
-						rollup_strategy = pathnode->aggstrategy;
-						rollup_data_list = pathnode->rollups;
-						break;
-					}
-				}
-				if (!lc)
-					return;		/* give up */
-				final_path = (Path *)
-					create_groupingsets_path(root,
-											 group_rel,
-											 sort_path,
-#if PG_VERSION_NUM < 110000
-											 target_final,
-#endif
-											 (List *) parse->havingQual,
-											 rollup_strategy,
-											 rollup_data_list,
-											 agg_final_costs,
-											 num_groups);
-#if PG_VERSION_NUM >= 110000
-				/* adjust cost and overwrite PathTarget */
-				target_orig = final_path->pathtarget;
-				final_path->startup_cost += (target_final->cost.startup -
-											 target_orig->cost.startup);
-				final_path->total_cost += (target_final->cost.startup -
-										   target_orig->cost.startup) +
-					(target_final->cost.per_tuple -
-					 target_orig->cost.per_tuple) * final_path->rows;
-				final_path->pathtarget = target_final;
-#endif
-			}
-			else if (parse->hasAggs)
+			if (parse->hasAggs)
 				final_path = (Path *)
 					create_agg_path(root,
 									group_rel,
@@ -1490,6 +1736,7 @@ try_add_gpupreagg_append_paths(PlannerInfo *root,
 							   Bitmapset *pfunc_bitmap,
 							   List *havingQual,
 							   double num_groups,
+							   double device_ngroups,
 							   AggClauseCosts *agg_final_costs,
 							   bool can_pullup_outerscan,
 							   bool try_parallel_path)
@@ -1543,7 +1790,7 @@ try_add_gpupreagg_append_paths(PlannerInfo *root,
 											  curr_device,
 											  sub_path,
 											  pfunc_bitmap,
-											  num_groups,
+											  device_ngroups,
 											  can_pullup_outerscan,
 											  false);
 		if (!partial_path)
@@ -1596,6 +1843,182 @@ try_add_gpupreagg_append_paths(PlannerInfo *root,
 #endif	/* PG_VERSION_NUM >= 110000 */
 }
 
+/*
+ * gpupreagg_is_completable
+ *
+ * If GpuPreAgg runs on a single process without CPU fallback, its final
+ * buffer already has exactly one partial result per group. Then, the final
+ * aggregation is just a transition of the partial result by the alternative
+ * aggregate function once, so GpuPreAgg can run it by itself, instead of
+ * the Agg node over the partial results.
+ * It checks whether all the final Aggref nodes are available for this.
+ */
+static bool
+gpupreagg_is_completable(PathTarget *target_final)
+{
+	List	   *aggrefs;
+	ListCell   *lc;
+
+	aggrefs = pull_var_clause((Node *)target_final->exprs,
+							  PVC_INCLUDE_AGGREGATES |
+							  PVC_RECURSE_WINDOWFUNCS |
+							  PVC_INCLUDE_PLACEHOLDERS);
+	foreach (lc, aggrefs)
+	{
+		Aggref	   *aggref = lfirst(lc);
+		HeapTuple	tuple;
+		bool		finalextra;
+
+		if (!IsA(aggref, Aggref))
+			continue;
+		if (list_length(aggref->args) != 1 ||
+			aggref->aggdirectargs != NIL ||
+			aggref->aggorder != NIL ||
+			aggref->aggdistinct != NIL ||
+			aggref->aggfilter != NULL)
+			return false;
+		tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggref->aggfnoid));
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "cache lookup failed for pg_aggregate %u",
+				 aggref->aggfnoid);
+		finalextra = ((Form_pg_aggregate) GETSTRUCT(tuple))->aggfinalextra;
+		ReleaseSysCache(tuple);
+		if (finalextra)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * make_gpupreagg_complete_path
+ *
+ * It makes a copy of the GpuPreAgg path that runs the final aggregation
+ * by itself. See gpupreagg_is_completable() also.
+ */
+static Path *
+make_gpupreagg_complete_path(Path *partial_path,
+							 PathTarget *target_final,
+							 double num_groups,
+							 const AggClauseCosts *agg_final_costs)
+{
+	CustomPath	   *cpath;
+	GpuPreAggInfo  *gpa_info;
+
+	Assert(pgstrom_path_is_gpupreagg(partial_path) &&
+		   !partial_path->parallel_aware);
+	cpath = (CustomPath *)pgstrom_copy_gpupreagg_path(partial_path);
+	gpa_info = pmemdup(linitial(cpath->custom_private),
+					   sizeof(GpuPreAggInfo));
+	gpa_info->complete_mode = true;
+	cpath->custom_private = list_make3(gpa_info,
+									   lsecond(cpath->custom_private),
+									   lthird(cpath->custom_private));
+	cpath->path.pathtarget = target_final;
+	cpath->path.rows = num_groups;
+	cpath->path.total_cost += (agg_final_costs->transCost.per_tuple +
+							   agg_final_costs->finalCost +
+							   cpu_tuple_cost) * num_groups;
+	return &cpath->path;
+}
+
+/*
+ * try_add_gpupreagg_partition_paths
+ *
+ * If GROUP BY generates too much groups to keep them on the final buffer,
+ * GpuPreAgg runs the reduction for each hash-partition of the grouping keys
+ * sequentially. Each of the GpuPreAgg nodes scans the whole outer relation,
+ * but merges only the rows in its own partition, so the final buffer and
+ * hash-slot has to keep only a part of the groups.
+ * Because partitions have no common groups, they don't need the final Agg
+ * node on the complete mode.
+ * It returns false, if hash-partitioned reduction is not available.
+ */
+static bool
+try_add_gpupreagg_partition_paths(PlannerInfo *root,
+								  RelOptInfo *group_rel,
+								  PathTarget *target_final,
+								  PathTarget *target_partial,
+								  Path *partial_path,
+								  List *havingQual,
+								  double num_groups,
+								  double device_ngroups,
+								  AggClauseCosts *agg_final_costs,
+								  bool can_complete)
+{
+#if PG_VERSION_NUM >= 110000
+	PathTarget	   *target_upper = root->upper_targets[UPPERREL_GROUP_AGG];
+	GpuPreAggInfo  *gpa_info;
+	AppendPath	   *append_path;
+	List		   *append_paths_list = NIL;
+	int				part_nbits = 1;
+	int				nparts;
+	int				i;
+
+	/* Only when outer relation scan is pulled up (no sub-plans) */
+	if (!pgstrom_path_is_gpupreagg(partial_path) ||
+		partial_path->parallel_aware ||
+		((CustomPath *)partial_path)->custom_paths != NIL)
+		return false;
+	gpa_info = linitial(((CustomPath *)partial_path)->custom_private);
+
+	while ((double)gpupreagg_partition_size * (double)(1 << part_nbits)
+		   < device_ngroups && part_nbits < GPUPREAGG_MAX_PARTITION_NBITS)
+		part_nbits++;
+	nparts = (1 << part_nbits);
+
+	for (i=0; i < nparts; i++)
+	{
+		CustomPath	   *cpath;
+		GpuPreAggInfo  *part_info;
+		Path		   *sub_path;
+
+		cpath = (CustomPath *)pgstrom_copy_gpupreagg_path(partial_path);
+		part_info = pmemdup(gpa_info, sizeof(GpuPreAggInfo));
+		part_info->plan_ngroups = Max(gpa_info->plan_ngroups / nparts, 1.0);
+		part_info->part_nbits = part_nbits;
+		part_info->part_index = i;
+		cpath->custom_private = list_make3(part_info,
+										   lsecond(cpath->custom_private),
+										   lthird(cpath->custom_private));
+		cpath->path.rows = Max(partial_path->rows / nparts, 1.0);
+		sub_path = &cpath->path;
+		if (can_complete)
+			sub_path = make_gpupreagg_complete_path(sub_path,
+													target_final,
+													Max(num_groups / nparts,
+														1.0),
+													agg_final_costs);
+		append_paths_list = lappend(append_paths_list, sub_path);
+	}
+	append_path = create_append_path(root, partial_path->parent,
+									 append_paths_list, NIL,
+									 NIL, NULL,
+									 0, false,
+									 NIL, -1.0);
+	if (can_complete)
+	{
+		append_path->path.pathtarget = target_final;
+		add_path(group_rel, pgstrom_create_dummy_path(root,
+													  &append_path->path,
+													  target_upper));
+	}
+	else
+	{
+		append_path->path.pathtarget = target_partial;
+		try_add_final_aggregation_paths(root,
+										group_rel,
+										target_final,
+										&append_path->path,
+										havingQual,
+										num_groups,
+										agg_final_costs);
+	}
+	return true;
+#else
+	return false;
+#endif	/* PG_VERSION_NUM >= 110000 */
+}
+
 /*
  * try_add_gpupreagg_paths
  */
@@ -1613,9 +2036,12 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 	Path		   *partial_path;
 	Bitmapset	   *pfunc_bitmap;
 	Node		   *havingQual;
+	List		   *distinct_keys = NIL;
 	double			num_groups;
+	double			device_ngroups;
 	double			reduction_ratio;
 	bool			can_pullup_outerscan = true;
+	bool			can_complete;
 	AggClauseCosts	agg_final_costs;
 
 	/*
@@ -1630,18 +2056,40 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 	 * worse than the estimation at the planning stage.
 	 */
 	if (!parse->groupClause)
+	{
+		/* GROUPING SETS with empty sets only; not supported */
+		if (parse->groupingSets)
+			return;
 		num_groups = 1.0;
+	}
 	else
 	{
 		Path   *pathnode = linitial(group_rel->pathlist);
 
 		num_groups = Max(pathnode->rows, 1.0);
 	}
-	reduction_ratio = input_path->rows / num_groups;
+
+	/*
+	 * On GROUPING SETS, GpuPreAgg groups the input rows by the union of all
+	 * the grouping keys, so it generates less groups than the total number
+	 * of rows in the grouping sets.
+	 */
+	device_ngroups = num_groups;
+	if (parse->groupingSets)
+	{
+		List   *group_exprs = get_sortgrouplist_exprs(parse->groupClause,
+													  parse->targetList);
+		device_ngroups = estimate_num_groups(root,
+											 group_exprs,
+											 input_path->rows,
+											 NULL);
+		device_ngroups = Max(device_ngroups, 1.0);
+	}
+	reduction_ratio = input_path->rows / device_ngroups;
 	if (reduction_ratio < gpupreagg_reduction_threshold)
 	{
 		elog(DEBUG2, "GpuPreAgg: %.0f -> %.0f reduction ratio (%.2f) is bad",
-			 input_path->rows, num_groups, reduction_ratio);
+			 input_path->rows, device_ngroups, reduction_ratio);
 		return;
 	}
 
@@ -1654,9 +2102,34 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 									 input_path,
 									 &pfunc_bitmap,
 									 &havingQual,
+									 &distinct_keys,
 									 &can_pullup_outerscan))
 		return;
 
+	/*
+	 * Arguments of DISTINCT aggregates are added to the grouping-keys on
+	 * the device side, so GpuPreAgg generates more groups than the final
+	 * aggregation.
+	 */
+	if (distinct_keys != NIL)
+	{
+		List   *group_exprs = get_sortgrouplist_exprs(parse->groupClause,
+													  parse->targetList);
+		device_ngroups = estimate_num_groups(root,
+											 list_concat(group_exprs,
+														 distinct_keys),
+											 input_path->rows,
+											 NULL);
+		device_ngroups = Max(device_ngroups, 1.0);
+		reduction_ratio = input_path->rows / device_ngroups;
+		if (reduction_ratio < gpupreagg_reduction_threshold)
+		{
+			elog(DEBUG2, "GpuPreAgg: %.0f -> %.0f reduction ratio (%.2f) with DISTINCT-keys is bad",
+				 input_path->rows, device_ngroups, reduction_ratio);
+			return;
+		}
+	}
+
 	/* Get cost of aggregations */
 	memset(&agg_final_costs, 0, sizeof(AggClauseCosts));
 	if (parse->hasAggs)
@@ -1666,12 +2139,11 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 		get_agg_clause_costs(root, havingQual,
 							 AGGSPLIT_SIMPLE, &agg_final_costs);
 	}
-	/* GpuPreAgg does not support ordered aggregation */
-	if (agg_final_costs.numOrderedAggs > 0)
-	{
-		elog(DEBUG2, "GpuPreAgg does not support ordered aggregation");
-		return;
-	}
+	/*
+	 * NOTE: Aggregates with ORDER BY are already rejected, so numOrderedAggs
+	 * counts DISTINCT aggregates that run on the final aggregation as is.
+	 * try_add_final_aggregation_paths() does not consider AGG_HASHED then.
+	 */
 
 	if (enable_partitionwise_gpupreagg)
 		try_add_gpupreagg_append_paths(root,
@@ -1683,6 +2155,7 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 									   pfunc_bitmap,
 									   (List *) havingQual,
 									   num_groups,
+									   device_ngroups,
 									   &agg_final_costs,
 									   can_pullup_outerscan,
 									   try_parallel_path);
@@ -1693,13 +2166,56 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 										  target_device,
 										  input_path,
 										  pfunc_bitmap,
-										  num_groups,
+										  device_ngroups,
 										  can_pullup_outerscan,
 										  try_parallel_path);
 	if (!partial_path ||
 		(try_parallel_path && !IsA(partial_path, GatherPath)))
 		return;
 
+	/*
+	 * GpuPreAgg runs the final aggregation also, if every group is merged
+	 * on the final buffer only once. Note that an empty input must produce
+	 * one row without GROUP BY, and HAVING is evaluated by Agg node.
+	 * Partial results on Arrow_Fdw are not completed, if they can be
+	 * cached for the later queries; Agg node merges them.
+	 */
+	can_complete = (enable_gpupreagg_complete &&
+					!try_parallel_path &&
+					!pgstrom_cpu_fallback_enabled &&
+					!(enable_gpupreagg_partial_cache &&
+					  gpupreagg_partial_cache_size_kb > 0 &&
+					  baseRelIsArrowFdw(input_path->parent)) &&
+					parse->groupClause != NIL &&
+					parse->groupingSets == NIL &&
+					havingQual == NULL &&
+					distinct_keys == NIL &&
+					agg_final_costs.numOrderedAggs == 0 &&
+					pgstrom_path_is_gpupreagg(partial_path) &&
+					!partial_path->parallel_aware &&
+					gpupreagg_is_completable(target_final));
+
+	/*
+	 * Too much groups to keep on the final buffer at once, so it runs
+	 * the hash-partitioned reduction instead.
+	 */
+	if (gpupreagg_partition_size > 0 &&
+		device_ngroups > (double)gpupreagg_partition_size &&
+		!try_parallel_path &&
+		!pgstrom_cpu_fallback_enabled &&
+		parse->groupClause != NIL &&
+		try_add_gpupreagg_partition_paths(root,
+										  group_rel,
+										  target_final,
+										  target_partial,
+										  partial_path,
+										  (List *) havingQual,
+										  num_groups,
+										  device_ngroups,
+										  &agg_final_costs,
+										  can_complete))
+		return;
+
 	try_add_final_aggregation_paths(root,
 									group_rel,
 									target_final,
@@ -1707,6 +2223,17 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 									(List *) havingQual,
 									num_groups,
 									&agg_final_costs);
+	if (can_complete)
+	{
+		Path   *complete_path
+			= make_gpupreagg_complete_path(partial_path,
+										   target_final,
+										   num_groups,
+										   &agg_final_costs);
+		add_path(group_rel, pgstrom_create_dummy_path(root,
+													  complete_path,
+													  target_upper));
+	}
 }
 
 /*
@@ -2360,44 +2887,562 @@ make_alternative_aggref(PlannerInfo *root,
 	return (Node *)aggref_new;
 }
 
-typedef struct
+/*
+ * aggfunc_is_duplicate_insensitive
+ *
+ * It checks whether the supplied aggregate function returns the same
+ * result regardless of the duplicated input values.
+ */
+static bool
+aggfunc_is_duplicate_insensitive(Oid aggfnoid)
 {
-	bool		device_executable;
-	PlannerInfo *root;
-	PathTarget *target_upper;
-	PathTarget *target_partial;
-	PathTarget *target_device;
-	PathTarget *target_input;
-	RelOptInfo *input_rel;
-	Bitmapset  *pfunc_bitmap;
-} gpupreagg_build_path_target_context;
+	Oid			namespace_oid = get_namespace_oid("pgstrom", true);
+	char	   *func_name;
+	bool		retval = false;
 
-static Node *
-replace_expression_by_altfunc(Node *node,
-							  gpupreagg_build_path_target_context *con)
+	if (OidIsValid(namespace_oid) &&
+		get_func_namespace(aggfnoid) == namespace_oid)
+	{
+		func_name = get_func_name(aggfnoid);
+		if (func_name && strcmp(func_name, "hll_count") == 0)
+			retval = true;
+	}
+	return retval;
+}
+
+/*
+ * add_extra_grouping_key
+ *
+ * It adds the supplied expression to the grouping-keys of GpuPreAgg, but
+ * not of the final aggregation. Returns false if it is already a key.
+ */
+static bool
+add_extra_grouping_key(PlannerInfo *root,
+					   Expr *expr,
+					   PathTarget *target_partial,
+					   PathTarget *target_device)
 {
-	PathTarget *target_input = con->target_input;
+	Index		sortgroupref = 0;
 	ListCell   *lc;
+	int			j, n;
 
-	if (!node)
-		return NULL;
-	if (IsA(node, Aggref))
+	j = 0;
+	foreach (lc, target_device->exprs)
 	{
-		Node   *aggfn = make_alternative_aggref(con->root,
-												(Aggref *)node,
-												con->target_partial,
-												con->target_device,
-												con->target_input,
-												con->input_rel,
-												&con->pfunc_bitmap);
-		if (!aggfn)
-			con->device_executable = false;
-		return aggfn;
+		if (equal(expr, lfirst(lc)))
+			break;
+		j++;
 	}
+	if (!lc)
+		add_column_to_pathtarget(target_device, copyObject(expr), 0);
+	else if (target_device->sortgrouprefs[j] != 0)
+		return false;	/* already added */
 
-	foreach (lc, target_input->exprs)
+	/* assign a new sortgroupref, not to conflict with others */
+	foreach (lc, root->parse->targetList)
 	{
-		Expr   *expr_in = lfirst(lc);
+		TargetEntry *tle = lfirst(lc);
+
+		sortgroupref = Max(sortgroupref, tle->ressortgroupref);
+	}
+	n = list_length(target_device->exprs);
+	for (j=0; j < n; j++)
+		sortgroupref = Max(sortgroupref, target_device->sortgrouprefs[j]);
+	sortgroupref++;
+
+	j = 0;
+	foreach (lc, target_device->exprs)
+	{
+		if (equal(expr, lfirst(lc)))
+		{
+			target_device->sortgrouprefs[j] = sortgroupref;
+			break;
+		}
+		j++;
+	}
+
+	/* also add to the target_partial as grouping-key */
+	j = 0;
+	foreach (lc, target_partial->exprs)
+	{
+		if (equal(expr, lfirst(lc)) &&
+			(!target_partial->sortgrouprefs ||
+			 target_partial->sortgrouprefs[j] == 0))
+		{
+			n = list_length(target_partial->exprs);
+			target_partial->sortgrouprefs =
+				(!target_partial->sortgrouprefs
+				 ? palloc0(sizeof(Index) * (n+1))
+				 : repalloc(target_partial->sortgrouprefs,
+							sizeof(Index) * (n+1)));
+			target_partial->sortgrouprefs[j] = sortgroupref;
+			break;
+		}
+		j++;
+	}
+	if (!lc)
+		add_column_to_pathtarget(target_partial, copyObject(expr),
+								 sortgroupref);
+	return true;
+}
+
+/*
+ * make_distinct_aggref
+ *
+ * Aggregate with DISTINCT clause (or duplicate insensitive one) cannot be
+ * split into the partial and final aggregation, however, GpuPreAgg can
+ * eliminate the duplicated (grouping-keys, arguments) pairs on the device
+ * side, if arguments are added to the grouping-keys of GpuPreAgg.
+ * Then, the original Aggref runs on the final aggregation as is.
+ */
+static Node *
+make_distinct_aggref(PlannerInfo *root,
+					 Aggref *aggref,
+					 PathTarget *target_partial,
+					 PathTarget *target_device,
+					 List **p_distinct_keys)
+{
+	Query	   *parse = root->parse;
+	List	   *group_exprs;
+	ListCell   *lc;
+
+	if (!enable_gpupreagg_distinct)
+	{
+		elog(DEBUG2, "Aggregate with DISTINCT is disabled: %s",
+			 nodeToString(aggref));
+		return NULL;
+	}
+	if (aggref->aggorder ||
+		aggref->aggfilter ||
+		aggref->aggkind != AGGKIND_NORMAL)
+	{
+		elog(DEBUG2, "Aggregate with DISTINCT is not supported: %s",
+			 nodeToString(aggref));
+		return NULL;
+	}
+	group_exprs = get_sortgrouplist_exprs(parse->groupClause,
+										  parse->targetList);
+	foreach (lc, aggref->args)
+	{
+		TargetEntry *tle = lfirst(lc);
+		Expr	   *expr = tle->expr;
+		devtype_info *dtype;
+
+		/* no need to add the grouping-key twice */
+		if (list_member(group_exprs, expr))
+			continue;
+
+		dtype = pgstrom_devtype_lookup(exprType((Node *)expr));
+		if (!dtype || !dtype->hash_func ||
+			!pgstrom_devfunc_lookup_type_equal(dtype,
+											   exprCollation((Node *)expr)))
+		{
+			elog(DEBUG2, "DISTINCT argument has unsupported type (%s): %s",
+				 format_type_be(exprType((Node *)expr)),
+				 nodeToString(expr));
+			return NULL;
+		}
+
+		/* DISTINCT argument should be on the any of input items */
+		if (!list_member(target_device->exprs, expr))
+		{
+			elog(DEBUG2, "DISTINCT argument is not a simple input item: %s",
+				 nodeToString(expr));
+			return NULL;
+		}
+		if (add_extra_grouping_key(root, expr,
+								   target_partial,
+								   target_device))
+			*p_distinct_keys = lappend(*p_distinct_keys, expr);
+	}
+	return (Node *)copyObject(aggref);
+}
+
+/*
+ * aggfunc_is_approx_percentile
+ */
+static bool
+aggfunc_is_approx_percentile(Oid aggfnoid)
+{
+	Oid			namespace_oid = get_namespace_oid("pgstrom", true);
+	char	   *func_name;
+	bool		retval = false;
+
+	if (OidIsValid(namespace_oid) &&
+		get_func_namespace(aggfnoid) == namespace_oid)
+	{
+		func_name = get_func_name(aggfnoid);
+		if (func_name && strcmp(func_name, "approx_percentile") == 0)
+			retval = true;
+	}
+	return retval;
+}
+
+/*
+ * make_percentile_aggref
+ *
+ * pgstrom.approx_percentile(X, fraction) is processed by the pair of
+ * pgstrom.approx_percentile_bucket(X) added to the grouping-keys of
+ * GpuPreAgg, and NROWS(X) per bucket. Then, pgstrom.fpercentile()
+ * finalizes the percentile from the histogram on the CPU side.
+ */
+static Node *
+make_percentile_aggref(PlannerInfo *root,
+					   Aggref *aggref,
+					   PathTarget *target_partial,
+					   PathTarget *target_device,
+					   PathTarget *target_input,
+					   Bitmapset **p_pfunc_bitmap,
+					   List **p_distinct_keys)
+{
+	TargetEntry *tle_x;
+	TargetEntry *tle_f;
+	Expr	   *bucket;
+	FuncExpr   *pfunc;
+	Node	   *temp;
+	Aggref	   *aggref_new;
+	Oid			namespace_oid = get_namespace_oid("pgstrom", false);
+	Oid			func_argtypes_oid[3];
+	Oid			func_oid;
+	List	   *func_args;
+	HeapTuple	tuple;
+	Form_pg_aggregate agg_form;
+
+	if (!enable_gpupreagg_distinct ||
+		aggref->aggorder ||
+		aggref->aggdistinct ||
+		list_length(aggref->args) != 2)
+		return NULL;
+	tle_x = linitial(aggref->args);
+	tle_f = lsecond(aggref->args);
+	if (!IsA(tle_f->expr, Const))
+	{
+		elog(DEBUG2, "fraction of approx_percentile must be constant: %s",
+			 nodeToString(aggref));
+		return NULL;
+	}
+
+	/* bucket of the histogram, as an extra grouping-key */
+	bucket = (Expr *)make_altfunc_simple_expr("approx_percentile_bucket",
+											  tle_x->expr);
+	temp = replace_expression_by_outerref((Node *)bucket, target_input);
+	if (!pgstrom_device_expression(root, NULL, (Expr *)temp))
+		return NULL;
+	if (add_extra_grouping_key(root, bucket,
+							   target_partial,
+							   target_device))
+		*p_distinct_keys = lappend(*p_distinct_keys, bucket);
+
+	/* number of rows per bucket */
+	pfunc = make_altfunc_nrows_expr(aggref);
+	if (pfunc->args)
+	{
+		temp = replace_expression_by_outerref((Node *)pfunc->args,
+											  target_input);
+		if (!pgstrom_device_expression(root, NULL, (Expr *)temp))
+			return NULL;
+	}
+	if (!list_member(target_device->exprs, pfunc))
+	{
+		add_column_to_pathtarget(target_device, (Expr *)pfunc, 0);
+		*p_pfunc_bitmap = bms_add_member(*p_pfunc_bitmap,
+										 list_length(target_device->exprs) - 1);
+	}
+	add_new_column_to_pathtarget(target_partial, (Expr *)pfunc);
+
+	/* construction of the final Aggref */
+	func_argtypes_oid[0] = INT4OID;
+	func_argtypes_oid[1] = INT8OID;
+	func_argtypes_oid[2] = FLOAT8OID;
+	func_oid = get_function_oid("fpercentile",
+								buildoidvector(func_argtypes_oid, 3),
+								namespace_oid, false);
+	tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(func_oid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for pg_aggregate %u", func_oid);
+	agg_form = (Form_pg_aggregate) GETSTRUCT(tuple);
+
+	func_args = list_make3(makeTargetEntry(copyObject(bucket), 1, NULL, false),
+						   makeTargetEntry((Expr *)pfunc, 2, NULL, false),
+						   makeTargetEntry(copyObject(tle_f->expr), 3,
+										   NULL, false));
+	aggref_new = makeNode(Aggref);
+	aggref_new->aggfnoid		= func_oid;
+	aggref_new->aggtype			= aggref->aggtype;
+	aggref_new->aggcollid		= aggref->aggcollid;
+	aggref_new->inputcollid		= aggref->inputcollid;
+	aggref_new->aggtranstype	= agg_form->aggtranstype;
+	aggref_new->aggargtypes		= list_make3_oid(INT4OID, INT8OID, FLOAT8OID);
+	aggref_new->aggdirectargs	= NIL;
+	aggref_new->args			= func_args;
+	aggref_new->aggorder		= NIL;
+	aggref_new->aggdistinct		= NIL;
+	aggref_new->aggfilter		= NULL;	/* moved to GpuPreAgg */
+	aggref_new->aggstar			= false;
+	aggref_new->aggvariadic		= false;
+	aggref_new->aggkind			= AGGKIND_NORMAL;
+	aggref_new->agglevelsup		= 0;
+	aggref_new->aggsplit		= AGGSPLIT_SIMPLE;
+	aggref_new->location		= aggref->location;
+
+	ReleaseSysCache(tuple);
+
+	return (Node *)aggref_new;
+}
+
+/*
+ * aggfunc_is_numeric_exact
+ *
+ * It returns name of the final aggregate if the supplied Aggref is
+ * sum(numeric) or avg(numeric) with fixed precision and scale, thus
+ * the values are exactly representable by 64bit scaled integer.
+ */
+static const char *
+aggfunc_is_numeric_exact(Aggref *aggref, int32 *p_scale)
+{
+	TargetEntry *tle;
+	const char *func_name;
+	int32		typmod;
+	int32		precision;
+	int32		scale;
+
+	if (!enable_numeric_exact_aggfuncs ||
+		!enable_numeric_aggfuncs ||
+		aggref->aggorder ||
+		aggref->aggdistinct ||
+		list_length(aggref->args) != 1 ||
+		get_func_namespace(aggref->aggfnoid) != PG_CATALOG_NAMESPACE)
+		return NULL;
+	tle = linitial(aggref->args);
+	if (exprType((Node *)tle->expr) != NUMERICOID)
+		return NULL;
+	func_name = get_func_name(aggref->aggfnoid);
+	if (strcmp(func_name, "sum") == 0)
+		func_name = "fsum_numeric_exact";
+	else if (strcmp(func_name, "avg") == 0)
+		func_name = "favg_numeric_exact";
+	else
+		return NULL;
+
+	typmod = exprTypmod((Node *)tle->expr);
+	if (typmod < (int32) VARHDRSZ)
+		return NULL;
+	precision = ((typmod - VARHDRSZ) >> 16) & 0xffff;
+	scale = (typmod - VARHDRSZ) & 0xffff;
+	if (precision > 18 || scale > precision)
+		return NULL;
+	*p_scale = scale;
+	return func_name;
+}
+
+/*
+ * make_numeric_exact_aggref
+ *
+ * sum(numeric) and avg(numeric) with numeric(p,s) where p <= 18 are
+ * processed by the 64bit integer scaled by 10^s. GpuPreAgg accumulates
+ * the upper and the lower 32bits individually, then the final aggregation
+ * reconstructs the exact sum as 128bit integer on the CPU side, therefore
+ * no rounding error happen unlike the float8 based numeric aggregation.
+ */
+static Node *
+make_numeric_exact_aggref(PlannerInfo *root,
+						  Aggref *aggref,
+						  const char *final_name,
+						  int32 scale,
+						  PathTarget *target_partial,
+						  PathTarget *target_device,
+						  PathTarget *target_input,
+						  Bitmapset **p_pfunc_bitmap)
+{
+	TargetEntry *tle = linitial(aggref->args);
+	Oid			namespace_oid = get_namespace_oid("pgstrom", false);
+	Oid			func_argtypes_oid[4];
+	Oid			func_oid;
+	Const	   *scale_const;
+	List	   *altfunc_args = NIL;
+	Expr	   *expr_host;
+	Aggref	   *aggref_new;
+	HeapTuple	tuple;
+	Form_pg_aggregate agg_form;
+	int			i;
+
+	scale_const = makeConst(INT4OID,
+							-1,
+							InvalidOid,
+							sizeof(int32),
+							Int32GetDatum(scale),
+							false,
+							true);
+	for (i=0; i < 3; i++)
+	{
+		FuncExpr   *pfunc;
+		Node	   *temp;
+
+		if (i == 0)
+			pfunc = make_altfunc_nrows_expr(aggref);
+		else
+		{
+			Expr   *expr;
+
+			func_argtypes_oid[0] = NUMERICOID;
+			func_argtypes_oid[1] = INT4OID;
+			func_oid = get_function_oid(i == 1
+										? "numeric_scaled_hi"
+										: "numeric_scaled_lo",
+										buildoidvector(func_argtypes_oid, 2),
+										namespace_oid, false);
+			expr = (Expr *)makeFuncExpr(func_oid,
+										INT8OID,
+										list_make2(copyObject(tle->expr),
+												   copyObject(scale_const)),
+										InvalidOid,
+										InvalidOid,
+										COERCE_EXPLICIT_CALL);
+			/* make conditional if aggref has any filter */
+			expr = make_expr_conditional(expr, aggref->aggfilter, true);
+			pfunc = make_altfunc_simple_expr("psum", expr);
+		}
+		/* device executable? */
+		if (pfunc->args)
+		{
+			temp = replace_expression_by_outerref((Node *)pfunc->args,
+												  target_input);
+			if (!pgstrom_device_expression(root, NULL, (Expr *)temp))
+				return NULL;
+		}
+		if (!list_member(target_device->exprs, pfunc))
+		{
+			add_column_to_pathtarget(target_device, (Expr *)pfunc, 0);
+			*p_pfunc_bitmap = bms_add_member(*p_pfunc_bitmap,
+											 list_length(target_device->exprs) - 1);
+		}
+		altfunc_args = lappend(altfunc_args, pfunc);
+	}
+	altfunc_args = lappend(altfunc_args, scale_const);
+
+	/* partial state; pgstrom.pnumeric_exact(nrows, hi, lo, scale) */
+	func_argtypes_oid[0] = INT8OID;
+	func_argtypes_oid[1] = INT8OID;
+	func_argtypes_oid[2] = INT8OID;
+	func_argtypes_oid[3] = INT4OID;
+	func_oid = get_function_oid("pnumeric_exact",
+								buildoidvector(func_argtypes_oid, 4),
+								namespace_oid, false);
+	expr_host = (Expr *)makeFuncExpr(func_oid,
+									 INT8ARRAYOID,
+									 altfunc_args,
+									 InvalidOid,
+									 InvalidOid,
+									 COERCE_EXPLICIT_CALL);
+	add_new_column_to_pathtarget(target_partial, expr_host);
+
+	/* construction of the final Aggref */
+	func_argtypes_oid[0] = INT8ARRAYOID;
+	func_oid = get_function_oid(final_name,
+								buildoidvector(func_argtypes_oid, 1),
+								namespace_oid, false);
+	tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(func_oid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for pg_aggregate %u", func_oid);
+	agg_form = (Form_pg_aggregate) GETSTRUCT(tuple);
+
+	aggref_new = makeNode(Aggref);
+	aggref_new->aggfnoid		= func_oid;
+	aggref_new->aggtype			= aggref->aggtype;
+	aggref_new->aggcollid		= aggref->aggcollid;
+	aggref_new->inputcollid		= aggref->inputcollid;
+	aggref_new->aggtranstype	= agg_form->aggtranstype;
+	aggref_new->aggargtypes		= list_make1_oid(INT8ARRAYOID);
+	aggref_new->aggdirectargs	= NIL;
+	aggref_new->args			= list_make1(makeTargetEntry(expr_host,
+															 1,
+															 NULL,
+															 false));
+	aggref_new->aggorder		= NIL;
+	aggref_new->aggdistinct		= NIL;
+	aggref_new->aggfilter		= NULL;	/* moved to GpuPreAgg */
+	aggref_new->aggstar			= false;
+	aggref_new->aggvariadic		= false;
+	aggref_new->aggkind			= AGGKIND_NORMAL;
+	aggref_new->agglevelsup		= 0;
+	aggref_new->aggsplit		= AGGSPLIT_SIMPLE;
+	aggref_new->location		= aggref->location;
+
+	ReleaseSysCache(tuple);
+
+	return (Node *)aggref_new;
+}
+
+typedef struct
+{
+	bool		device_executable;
+	PlannerInfo *root;
+	PathTarget *target_upper;
+	PathTarget *target_partial;
+	PathTarget *target_device;
+	PathTarget *target_input;
+	RelOptInfo *input_rel;
+	Bitmapset  *pfunc_bitmap;
+	List	   *distinct_keys;
+} gpupreagg_build_path_target_context;
+
+static Node *
+replace_expression_by_altfunc(Node *node,
+							  gpupreagg_build_path_target_context *con)
+{
+	PathTarget *target_input = con->target_input;
+	ListCell   *lc;
+
+	if (!node)
+		return NULL;
+	if (IsA(node, Aggref))
+	{
+		Aggref *aggref = (Aggref *)node;
+		Node   *aggfn;
+		const char *final_name;
+		int32	scale;
+
+		if (aggref->aggdistinct ||
+			aggfunc_is_duplicate_insensitive(aggref->aggfnoid))
+			aggfn = make_distinct_aggref(con->root,
+										 aggref,
+										 con->target_partial,
+										 con->target_device,
+										 &con->distinct_keys);
+		else if (aggfunc_is_approx_percentile(aggref->aggfnoid))
+			aggfn = make_percentile_aggref(con->root,
+										   aggref,
+										   con->target_partial,
+										   con->target_device,
+										   con->target_input,
+										   &con->pfunc_bitmap,
+										   &con->distinct_keys);
+		else if ((final_name = aggfunc_is_numeric_exact(aggref,
+														&scale)) != NULL)
+			aggfn = make_numeric_exact_aggref(con->root,
+											  aggref,
+											  final_name,
+											  scale,
+											  con->target_partial,
+											  con->target_device,
+											  con->target_input,
+											  &con->pfunc_bitmap);
+		else
+			aggfn = make_alternative_aggref(con->root,
+											aggref,
+											con->target_partial,
+											con->target_device,
+											con->target_input,
+											con->input_rel,
+											&con->pfunc_bitmap);
+		if (!aggfn)
+			con->device_executable = false;
+		return aggfn;
+	}
+
+	foreach (lc, target_input->exprs)
+	{
+		Expr   *expr_in = lfirst(lc);
 
 		if (equal(node, expr_in))
 		{
@@ -2429,6 +3474,7 @@ gpupreagg_build_path_target(PlannerInfo *root,			/* in */
 							Path       *input_path,     /* in */
 							Bitmapset **p_pfunc_bitmap,	/* out */
 							Node **p_havingQual,		/* out */
+							List **p_distinct_keys,		/* out */
 							bool *p_can_pullup_outerscan) /* out */
 {
 	gpupreagg_build_path_target_context con;
@@ -2581,10 +3627,52 @@ gpupreagg_build_path_target(PlannerInfo *root,			/* in */
 	set_pathtarget_cost_width(root, target_partial);
 	set_pathtarget_cost_width(root, target_device);
 	*p_pfunc_bitmap = con.pfunc_bitmap;
+	*p_distinct_keys = con.distinct_keys;
 
 	return true;
 }
 
+/*
+ * build_combined_gpujoin_tlist
+ *
+ * Combined GpuJoin+GpuPreAgg hands over the join results on the device
+ * side, in the layout of the non-junk entries of the custom_scan_tlist of
+ * GpuJoin. If the targetlist of GpuJoin is not identical to them (columns
+ * are reordered or duplicated, or host-only expressions are decomposed),
+ * GpuJoin has its own CPU projection, then it prevents the combined mode.
+ * So, we replace the targetlist of the outer GpuJoin by the pseudo-scan
+ * layout as long as every entry referenced by GpuPreAgg is still there.
+ */
+static List *
+build_combined_gpujoin_tlist(Plan *outer_plan)
+{
+	CustomScan *gj_cscan = (CustomScan *) outer_plan;
+	List	   *tlist = NIL;
+	ListCell   *lc;
+
+	Assert(pgstrom_plan_is_gpujoin(outer_plan));
+	foreach (lc, gj_cscan->custom_scan_tlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		if (tle->resjunk)
+			continue;
+		tlist = lappend(tlist, makeTargetEntry(copyObject(tle->expr),
+											   list_length(tlist) + 1,
+											   tle->resname,
+											   false));
+	}
+
+	foreach (lc, outer_plan->targetlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		if (!tlist_member(tle->expr, tlist))
+			return outer_plan->targetlist;
+	}
+	return tlist;
+}
+
 /*
  * PlanGpuPreAggPath
  *
@@ -2624,6 +3712,9 @@ PlanGpuPreAggPath(PlannerInfo *root,
 	else
 	{
 		outer_plan = linitial(custom_plans);
+		if (enable_pullup_outer_join &&
+			pgstrom_plan_is_gpujoin(outer_plan))
+			outer_plan->targetlist = build_combined_gpujoin_tlist(outer_plan);
 		outer_tlist = outer_plan->targetlist;
 	}
 
@@ -2729,6 +3820,46 @@ PlanGpuPreAggPath(PlannerInfo *root,
 	gpa_info->outer_refs = outer_refs;
 	gpa_info->used_params = context.used_params;
 
+	/*
+	 * On the complete aggregation mode, Aggref nodes are added to the
+	 * custom_scan_tlist as junk entries, then setrefs.c replaces them in
+	 * the targetlist by the Var-nodes which reference the entries.
+	 * GpuPreAgg fills up the junk attributes by the final aggregation.
+	 */
+	if (gpa_info->complete_mode)
+	{
+		List	   *aggrefs;
+
+		aggrefs = pull_var_clause((Node *)tlist,
+								  PVC_INCLUDE_AGGREGATES |
+								  PVC_RECURSE_WINDOWFUNCS |
+								  PVC_INCLUDE_PLACEHOLDERS);
+		foreach (lc, aggrefs)
+		{
+			Aggref	   *aggref = lfirst(lc);
+			TargetEntry *tle;
+			Node	   *aggarg;
+
+			if (!IsA(aggref, Aggref) || tlist_member((Expr *)aggref,
+													 tlist_dev))
+				continue;
+			Assert(list_length(aggref->args) == 1);
+			tle = linitial(aggref->args);
+			aggarg = replace_expression_by_outerref((Node *)tle->expr,
+													target_device);
+			tle = makeTargetEntry((Expr *)aggref,
+								  list_length(tlist_dev) + 1,
+								  NULL,
+								  true);
+			tlist_dev = lappend(tlist_dev, tle);
+
+			gpa_info->final_resnos = lappend_int(gpa_info->final_resnos,
+												 tle->resno);
+			gpa_info->final_aggargs = lappend(gpa_info->final_aggargs,
+											  aggarg);
+		}
+		cscan->custom_scan_tlist = tlist_dev;
+	}
 	form_gpupreagg_info(cscan, gpa_info);
 
 	return &cscan->scan.plan;
@@ -3962,6 +5093,8 @@ gpupreagg_codegen(codegen_context *context,
 	/* merge above kernel functions */
 	appendStringInfoString(&kern, body.data);
 	pfree(body.data);
+	/* user defined device functions, if any */
+	pgstrom_codegen_user_functions(&kern, context);
 
 	gpa_info->varlena_bufsz = varlena_bufsz;
 
@@ -4062,6 +5195,78 @@ CreateGpuPreAggScanState(CustomScan *cscan)
 	return (Node *) gpas;
 }
 
+/*
+ * gpupreagg_init_complete_mode
+ */
+static void
+gpupreagg_init_complete_mode(GpuPreAggState *gpas,
+							 CustomScan *cscan,
+							 GpuPreAggInfo *gpa_info)
+{
+	WindowAggState *winstate = makeNode(WindowAggState);
+	ListCell	   *lc1, *lc2;
+	int				i = 0;
+
+	gpas->complete_mode = true;
+	gpas->final_cxt = AllocSetContextCreate(CurrentMemoryContext,
+											"GpuPreAgg final aggregation",
+											ALLOCSET_DEFAULT_SIZES);
+	/*
+	 * MEMO: transition functions which use AggCheckCallContext() require
+	 * fcinfo->context is either AggState or WindowAggState. The latter
+	 * needs only curaggcontext for the transition state.
+	 */
+	winstate->curaggcontext = gpas->final_cxt;
+	gpas->final_aggcontext = (Node *) winstate;
+
+	gpas->num_final_aggs = list_length(gpa_info->final_resnos);
+	gpas->final_aggs = palloc0(sizeof(GpuPreAggFinalAgg) *
+							   gpas->num_final_aggs);
+	forboth (lc1, gpa_info->final_resnos,
+			 lc2, gpa_info->final_aggargs)
+	{
+		GpuPreAggFinalAgg *fagg = &gpas->final_aggs[i++];
+		TargetEntry	   *tle = list_nth(cscan->custom_scan_tlist,
+									   lfirst_int(lc1) - 1);
+		Aggref		   *aggref = (Aggref *) tle->expr;
+		HeapTuple		tuple;
+		Form_pg_aggregate agg_form;
+		Datum			datum;
+
+		Assert(tle->resjunk && IsA(aggref, Aggref));
+		tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggref->aggfnoid));
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "cache lookup failed for pg_aggregate %u",
+				 aggref->aggfnoid);
+		agg_form = (Form_pg_aggregate) GETSTRUCT(tuple);
+
+		fagg->resno = tle->resno;
+		fagg->arg = ExecInitExpr(lfirst(lc2), &gpas->gts.css.ss.ps);
+		fagg->inputcollid = aggref->inputcollid;
+		fmgr_info(agg_form->aggtransfn, &fagg->transfn);
+		if (OidIsValid(agg_form->aggfinalfn))
+			fmgr_info(agg_form->aggfinalfn, &fagg->finalfn);
+		get_typlenbyval(aggref->aggtranstype,
+						&fagg->transtypeLen,
+						&fagg->transtypeByVal);
+		datum = SysCacheGetAttr(AGGFNOID, tuple,
+								Anum_pg_aggregate_agginitval,
+								&fagg->init_isnull);
+		if (!fagg->init_isnull)
+		{
+			Oid		typinput;
+			Oid		typioparam;
+			char   *str = TextDatumGetCString(datum);
+
+			getTypeInputInfo(aggref->aggtranstype, &typinput, &typioparam);
+			fagg->init_value = OidInputFunctionCall(typinput, str,
+													typioparam, -1);
+			pfree(str);
+		}
+		ReleaseSysCache(tuple);
+	}
+}
+
 /*
  * ExecInitGpuPreAgg
  */
@@ -4090,6 +5295,7 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
 	pgstromInitGpuTaskState(&gpas->gts,
 							gpas->gts.gcontext,
 							GpuTaskKind_GpuPreAgg,
+							gpa_info->outer_quals,
 							gpa_info->outer_refs,
 							gpa_info->used_params,
 							gpa_info->optimal_gpu,
@@ -4100,6 +5306,7 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
 	gpas->gts.cb_next_tuple      = gpupreagg_next_tuple;
 	gpas->gts.cb_process_task    = gpupreagg_process_task;
 	gpas->gts.cb_release_task    = gpupreagg_release_task;
+	gpas->gts.cb_async_begin     = gpupreagg_async_begin;
 	gpas->num_group_keys	= gpa_info->num_group_keys;
 
 	/* initialization of the outer relation */
@@ -4170,6 +5377,22 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
     gpas->plan_nrows_in		= gpa_info->outer_nrows;
 	gpas->plan_ngroups		= gpa_info->plan_ngroups;
 	gpas->plan_extra_sz		= gpa_info->plan_extra_sz;
+	gpas->part_nbits		= gpa_info->part_nbits;
+	gpas->part_index		= gpa_info->part_index;
+	/*
+	 * Fallback rows are neither partitioned nor merged to the final buffer,
+	 * so the hash-partitioned or complete mode cannot handle them.
+	 */
+	gpas->fallback_disabled	= (gpa_info->part_nbits > 0 ||
+							   gpa_info->complete_mode);
+	gpas->adaptive_reduction = (enable_gpupreagg_adaptive &&
+								gpas->num_group_keys > 0);
+
+	/* Setup the final aggregation, if complete mode */
+	if (gpa_info->complete_mode)
+		gpupreagg_init_complete_mode(gpas, cscan, gpa_info);
+	/* Reuse the partial results by the prior queries, if any */
+	gpupreagg_partial_cache_init(gpas, gpa_info, eflags);
 
 	/* Get CUDA program and async build if any */
 	if (gpas->combined_gpujoin)
@@ -4228,6 +5451,20 @@ ExecGpuPreAgg(CustomScanState *node)
 					(ExecScanRecheckMtd) ExecReCheckGpuPreAgg);
 }
 
+/*
+ * gpupreagg_async_begin - setup GpuPreAgg prior to ExecGpuPreAgg for
+ * async Append
+ */
+static bool
+gpupreagg_async_begin(GpuTaskState *gts)
+{
+	GpuPreAggState *gpas = (GpuPreAggState *) gts;
+
+	if (!gpas->gpa_sstate)
+		createGpuPreAggSharedState(gpas, NULL, NULL);
+	return true;
+}
+
 /*
  * ExecEndGpuPreAgg
  */
@@ -4257,6 +5494,7 @@ ExecEndGpuPreAgg(CustomScanState *node)
 		ExecEndNode(outerPlanState(node));
 
 	/* release final buffer / hashslot */
+	PDS_release_slot_ref(&gpas->gts);
 	if (gpas->pds_final)
 		PDS_release(gpas->pds_final);
 	if (gpas->m_fhash)
@@ -4267,6 +5505,8 @@ ExecEndGpuPreAgg(CustomScanState *node)
 		ExecDropSingleTupleTableSlot(gpas->gpreagg_slot);
 	if (gpas->outer_slot)
 		ExecDropSingleTupleTableSlot(gpas->outer_slot);
+	if (gpas->final_cxt)
+		MemoryContextDelete(gpas->final_cxt);
 	releaseGpuPreAggSharedState(gpas);
 	pgstromReleaseGpuTaskState(&gpas->gts, gt_rtstat);
 }
@@ -4290,6 +5530,9 @@ ExecReScanGpuPreAgg(CustomScanState *node)
 	pgstromRescanGpuTaskState(&gpas->gts);
 	/* reset other stuff */
 	gpas->terminator_done = false;
+	/* cached partial results are emitted again, but not stored twice */
+	gpas->pcache_rows_pos = 0;
+	gpas->pcache_store = false;
 }
 
 /*
@@ -4323,8 +5566,7 @@ ExecGpuPreAggInitDSM(CustomScanState *node,
 	coordinate = (char *)coordinate + gpas->gpa_sstate->ss_length;
 	if (gpas->gts.outer_index_state)
 	{
-		gpas->gts.outer_index_map = (Bitmapset *)coordinate;
-		gpas->gts.outer_index_map->nwords = -1;	/* uninitialized */
+		pgstromInitBrinIndexMap(&gpas->gts, coordinate);
 		coordinate = ((char *)coordinate +
 					  pgstromSizeOfBrinIndexMap(&gpas->gts));
 	}
@@ -4350,7 +5592,7 @@ ExecGpuPreAggInitWorker(CustomScanState *node,
 	coordinate = (char *)coordinate + gpa_sstate->ss_length;
 	if (gpas->gts.outer_index_state)
 	{
-		gpas->gts.outer_index_map = (Bitmapset *)coordinate;
+		pgstromAttachBrinIndexMap(&gpas->gts, coordinate);
 		coordinate = ((char *)coordinate +
 					  pgstromSizeOfBrinIndexMap(&gpas->gts));
 	}
@@ -4419,9 +5661,20 @@ ExplainGpuPreAgg(CustomScanState *node, List *ancestors, ExplainState *es)
 	/* shows reduction policy */
 	if (gpas->num_group_keys == 0)
 		policy = "NoGroup";
+	else if (gpas->adaptive_reduction)
+		policy = "Adaptive";
 	else
 		policy = "Local";
 	ExplainPropertyText("Reduction", policy, es);
+	/* shows hash-partition, if any */
+	if (gpas->part_nbits > 0)
+	{
+		char	temp[100];
+
+		snprintf(temp, sizeof(temp), "%u of %u",
+				 gpas->part_index, (1U << gpas->part_nbits));
+		ExplainPropertyText("Hash Partition", temp, es);
+	}
 
 	if (gpa_rtstat)
 		mergeGpuTaskRuntimeStat(&gpas->gts, &gpa_rtstat->c);
@@ -4434,7 +5687,14 @@ ExplainGpuPreAgg(CustomScanState *node, List *ancestors, ExplainState *es)
 	if (es->verbose)
 	{
 		foreach (lc, cscan->custom_scan_tlist)
-			gpu_proj = lappend(gpu_proj, ((TargetEntry *) lfirst(lc))->expr);
+		{
+			TargetEntry *tle = lfirst(lc);
+
+			/* Aggref for the complete mode is not a device projection */
+			if (tle->resjunk && IsA(tle->expr, Aggref))
+				continue;
+			gpu_proj = lappend(gpu_proj, tle->expr);
+		}
 		if (gpu_proj != NIL)
 		{
 			exprstr = deparse_expression((Node *)gpu_proj, dcontext,
@@ -4454,6 +5714,26 @@ ExplainGpuPreAgg(CustomScanState *node, List *ancestors, ExplainState *es)
 		ExplainPropertyText("Combined GpuJoin", "enabled", es);
 	else if (es->format != EXPLAIN_FORMAT_TEXT)
 		ExplainPropertyText("Combined GpuJoin", "disabled", es);
+	/* final aggregation without Agg node? */
+	if (gpas->complete_mode)
+		ExplainPropertyText("Complete Aggregation", "enabled", es);
+	else if (es->format != EXPLAIN_FORMAT_TEXT)
+		ExplainPropertyText("Complete Aggregation", "disabled", es);
+	/* partial results reused from the cache? */
+	if (es->analyze && gpas->pcache_key)
+	{
+		char	temp[200];
+
+		if (gpas->pcache_nreused > 0)
+			snprintf(temp, sizeof(temp),
+					 "hit (RecordBatches: %u of %u, rows: " UINT64_FORMAT ")",
+					 gpas->pcache_nreused,
+					 gpas->pcache_nbatches,
+					 gpas->pcache_nrows);
+		else
+			snprintf(temp, sizeof(temp), "miss");
+		ExplainPropertyText("Partial Cache", temp, es);
+	}
 	/* other common fields */
 	pgstromExplainGpuTaskState(&gpas->gts, es);
 	/* other run-time statistics, if any */
@@ -4465,6 +5745,36 @@ ExplainGpuPreAgg(CustomScanState *node, List *ancestors, ExplainState *es)
 		if (fallback_count > 0)
 			ExplainPropertyInteger("Num of CPU fallback rows",
 								   NULL, fallback_count, es);
+		if (gpas->adaptive_reduction && es->analyze)
+		{
+			uint64	num_local
+				= pg_atomic_read_u64(&gpa_rtstat->num_local_reduction);
+			uint64	num_global
+				= pg_atomic_read_u64(&gpa_rtstat->num_global_reduction);
+			uint64	num_warp
+				= pg_atomic_read_u64(&gpa_rtstat->num_warp_reduction);
+
+			if (es->format == EXPLAIN_FORMAT_TEXT)
+			{
+				char	temp[256];
+
+				snprintf(temp, sizeof(temp),
+						 "local: " UINT64_FORMAT
+						 ", global: " UINT64_FORMAT
+						 ", warp: " UINT64_FORMAT,
+						 num_local, num_global, num_warp);
+				ExplainPropertyText("Reduction Chunks", temp, es);
+			}
+			else
+			{
+				ExplainPropertyInteger("Local Reduction Chunks",
+									   NULL, num_local, es);
+				ExplainPropertyInteger("Global Reduction Chunks",
+									   NULL, num_global, es);
+				ExplainPropertyInteger("Warp Reduction Chunks",
+									   NULL, num_warp, es);
+			}
+		}
 	}
 }
 
@@ -4703,6 +6013,8 @@ gpupreagg_create_task(GpuPreAggState *gpas,
 	gpreagg->kern.hash_size = kds_slot_nrooms; //deprecated?
 	gpreagg->kern.suspend_size = suspend_sz;
 	gpreagg->kern.row_inval_map_size = row_inval_sz;
+	gpreagg->kern.part_nbits = gpas->part_nbits;
+	gpreagg->kern.part_index = gpas->part_index;
 	/* kern_parambuf */
 	memcpy(KERN_GPUPREAGG_PARAMBUF(&gpreagg->kern),
 		   gpas->gts.kern_params,
@@ -4910,6 +6222,107 @@ gpupreagg_next_tuple_fallback(GpuPreAggState *gpas, GpuPreAggTask *gpreagg)
 	return slot;
 }
 
+/*
+ * gpupreagg_complete_tuple
+ *
+ * It runs the final aggregation on a partial result of the final buffer,
+ * then stores them to the scan tuple slot that has junk attributes.
+ */
+static TupleTableSlot *
+gpupreagg_complete_tuple(GpuPreAggState *gpas, TupleTableSlot *gpa_slot)
+{
+	TupleTableSlot *slot = gpas->gts.css.ss.ss_ScanTupleSlot;
+	ExprContext	   *econtext = gpas->gts.css.ss.ps.ps_ExprContext;
+	int				natts = gpa_slot->tts_tupleDescriptor->natts;
+	MemoryContext	oldcxt;
+	int				i;
+
+	slot_getallattrs(gpa_slot);
+	ExecClearTuple(slot);
+	memcpy(slot->tts_values, gpa_slot->tts_values, sizeof(Datum) * natts);
+	memcpy(slot->tts_isnull, gpa_slot->tts_isnull, sizeof(bool) * natts);
+	for (i=natts; i < slot->tts_tupleDescriptor->natts; i++)
+	{
+		slot->tts_values[i] = 0;
+		slot->tts_isnull[i] = true;
+	}
+
+	MemoryContextReset(gpas->final_cxt);
+	oldcxt = MemoryContextSwitchTo(gpas->final_cxt);
+	econtext->ecxt_scantuple = gpa_slot;
+	for (i=0; i < gpas->num_final_aggs; i++)
+	{
+		GpuPreAggFinalAgg *fagg = &gpas->final_aggs[i];
+		LOCAL_FCINFO(fcinfo, 2);
+		Datum		pvalue;
+		bool		pisnull;
+		Datum		state;
+		bool		state_isnull;
+
+		pvalue = ExecEvalExpr(fagg->arg, econtext, &pisnull);
+		if (fagg->init_isnull)
+		{
+			state = 0;
+			state_isnull = true;
+		}
+		else
+		{
+			state = datumCopy(fagg->init_value,
+							  fagg->transtypeByVal,
+							  fagg->transtypeLen);
+			state_isnull = false;
+		}
+
+		/* transition by the partial result; once per group */
+		if (fagg->transfn.fn_strict && (pisnull || state_isnull))
+		{
+			/* the first non-null input becomes the initial state */
+			if (!pisnull)
+			{
+				state = datumCopy(pvalue,
+								  fagg->transtypeByVal,
+								  fagg->transtypeLen);
+				state_isnull = false;
+			}
+		}
+		else
+		{
+			InitFunctionCallInfoData(*fcinfo, &fagg->transfn, 2,
+									 fagg->inputcollid,
+									 gpas->final_aggcontext, NULL);
+			FC_ARG(fcinfo, 0) = state;
+			FC_NULL(fcinfo, 0) = state_isnull;
+			FC_ARG(fcinfo, 1) = pvalue;
+			FC_NULL(fcinfo, 1) = pisnull;
+			state = FunctionCallInvoke(fcinfo);
+			state_isnull = fcinfo->isnull;
+		}
+
+		/* final function, if any */
+		if (OidIsValid(fagg->finalfn.fn_oid) &&
+			!(fagg->finalfn.fn_strict && state_isnull))
+		{
+			InitFunctionCallInfoData(*fcinfo, &fagg->finalfn, 1,
+									 fagg->inputcollid,
+									 gpas->final_aggcontext, NULL);
+			FC_ARG(fcinfo, 0) = state;
+			FC_NULL(fcinfo, 0) = state_isnull;
+			state = FunctionCallInvoke(fcinfo);
+			state_isnull = fcinfo->isnull;
+		}
+		else if (OidIsValid(fagg->finalfn.fn_oid))
+		{
+			state = 0;
+			state_isnull = true;
+		}
+		slot->tts_values[fagg->resno - 1] = state;
+		slot->tts_isnull[fagg->resno - 1] = state_isnull;
+	}
+	MemoryContextSwitchTo(oldcxt);
+
+	return ExecStoreVirtualTuple(slot);
+}
+
 /*
  * gpupreagg_next_tuple
  */
@@ -4923,13 +6336,31 @@ gpupreagg_next_tuple(GpuTaskState *gts)
 
 	if (gpreagg->task.cpu_fallback)
 	{
+		if (gpas->fallback_disabled)
+			elog(ERROR, "GpuPreAgg: CPU fallback is not available on the hash-partitioned or complete aggregation mode");
 		slot = gpupreagg_next_tuple_fallback(gpas, gpreagg);
 	}
+	else if (!gpreagg->pds_src &&
+			 gpas->pcache_rows_pos < gpas->pcache_rows_len)
+	{
+		/* partial results reused from the cache, on the terminator */
+		return gpupreagg_partial_cache_fetch(gpas);
+	}
 	else if (gpas->gts.curr_index < pds_final->kds.nitems)
 	{
 		slot = gpas->gpreagg_slot;
 		ExecClearTuple(slot);
 		PDS_fetch_tuple(slot, pds_final, &gpas->gts);
+		if (gpas->complete_mode)
+			slot = gpupreagg_complete_tuple(gpas, slot);
+	}
+
+	if (gpas->pcache_store)
+	{
+		if (slot)
+			gpupreagg_partial_cache_append(gpas, slot);
+		else if (!gpreagg->pds_src && !gpreagg->task.cpu_fallback)
+			gpupreagg_partial_cache_store(gpas);
 	}
 	return slot;
 }
@@ -5014,6 +6445,29 @@ gpupreagg_init_final_hash(GpuPreAggTask *gpreagg,
 		werror("failed on cuStreamWaitEvent: %s", errorText(rc));
 }
 
+/*
+ * gpupreaggUpdateReductionStat
+ */
+static void
+gpupreaggUpdateReductionStat(GpuTaskState *gts, kern_gpupreagg *kgpreagg)
+{
+	GpuPreAggState *gpas = (GpuPreAggState *) gts;
+	GpuPreAggRuntimeStat *gpa_rtstat = gpas->gpa_rtstat;
+
+	switch (kgpreagg->reduction_mode)
+	{
+		case GPUPREAGG_REDUCTION__GLOBAL:
+			pg_atomic_add_fetch_u64(&gpa_rtstat->num_global_reduction, 1);
+			break;
+		case GPUPREAGG_REDUCTION__WARP:
+			pg_atomic_add_fetch_u64(&gpa_rtstat->num_warp_reduction, 1);
+			break;
+		default:
+			pg_atomic_add_fetch_u64(&gpa_rtstat->num_local_reduction, 1);
+			break;
+	}
+}
+
 /*
  * gpupreaggUpdateRunTimeStat
  */
@@ -5027,6 +6481,8 @@ gpupreaggUpdateRunTimeStat(GpuTaskState *gts, kern_gpupreagg *kgpreagg)
 							(int64)kgpreagg->nitems_real);
 	pg_atomic_add_fetch_u64(&gpa_rtstat->c.nitems_filtered,
 							(int64)kgpreagg->nitems_filtered);
+	if (gpas->adaptive_reduction)
+		gpupreaggUpdateReductionStat(gts, kgpreagg);
 	//TODO: other statistics
 }
 
@@ -5093,6 +6549,44 @@ gpupreagg_throw_partial_result(GpuPreAggTask *gpreagg,
  *
  * main logic to kick GpuPreAgg kernel function.
  */
+/*
+ * gpupreagg_setup_sample_groups
+ *
+ * It looks up kern_gpupreagg_sample_groups to be launched with a single
+ * thread-block, to choose the reduction mode of the chunk on the device
+ * side. It runs on the same stream, so no synchronization is needed prior
+ * to the reduction kernel. It returns false if not adaptive reduction.
+ */
+static bool
+gpupreagg_setup_sample_groups(GpuPreAggTask *gpreagg,
+							  CUmodule cuda_module,
+							  CUfunction *p_kern_sample,
+							  cl_int *p_block_sz)
+{
+	GpuPreAggState *gpas = (GpuPreAggState *) gpreagg->task.gts;
+	cl_int			grid_sz;
+	CUresult		rc;
+
+	if (!gpas->adaptive_reduction)
+	{
+		gpreagg->kern.reduction_mode = GPUPREAGG_REDUCTION__LOCAL;
+		return false;
+	}
+	rc = cuModuleGetFunction(p_kern_sample,
+							 cuda_module,
+							 "kern_gpupreagg_sample_groups");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 p_block_sz,
+							 *p_kern_sample,
+							 CU_DEVICE_PER_THREAD,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	return true;
+}
+
 static int
 gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 								 CUmodule cuda_module)
@@ -5113,6 +6607,8 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	bool			m_kds_src_release = false;
 	cl_int			grid_sz;
 	cl_int			block_sz;
+	CUfunction		kern_sample;
+	GpuKernelSeq	kseq;
 	void		   *last_suspend = NULL;
 	void		   *kern_args[6];
 	void		   *temp;
@@ -5166,9 +6662,15 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 
 		Assert(pds_src->kds.format == KDS_FORMAT_BLOCK ||
 			   pds_src->kds.format == KDS_FORMAT_ARROW);
-		rc = gpuMemAllocIOMap(gcontext,
-							  &m_kds_src,
-							  required);
+		/* columns on the GPU buffer don't need i/o mapped memory */
+		if (pds_src->kds.format == KDS_FORMAT_ARROW && pds_src->gpubuf_iov)
+			rc = gpuMemAlloc(gcontext,
+							 &m_kds_src,
+							 required);
+		else
+			rc = gpuMemAllocIOMap(gcontext,
+								  &m_kds_src,
+								  required);
 		if (rc == CUDA_SUCCESS)
 			m_kds_src_release = true;
 		else if (rc == CUDA_ERROR_OUT_OF_MEMORY)
@@ -5178,9 +6680,10 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 			{
 				PDS_fillup_blocks(pds_src);
 
-				rc = gpuMemAlloc(gcontext,
-								 &m_kds_src,
-								 required);
+				rc = gpuMemAllocAsync(gcontext,
+									  &m_kds_src,
+									  required,
+									  CU_STREAM_PER_THREAD);
 				if (rc == CUDA_SUCCESS)
 					m_kds_src_release = true;
 				else if (rc == CUDA_ERROR_OUT_OF_MEMORY)
@@ -5222,11 +6725,15 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	/*
 	 * OK, kick a series of GpuPreAgg invocations
 	 */
+	GpuWorkerStageBegin(&gpreagg->task);
 
 	/* source data to be reduced */
 	if (gpreagg->with_nvme_strom)
 	{
-		gpuMemCopyFromSSD(m_kds_src, pds_src);
+		if (pds_src->kds.format == KDS_FORMAT_ARROW && pds_src->gpubuf_iov)
+			gpuMemCopyFromGpuBuffer(m_kds_src, pds_src);
+		else
+			gpuMemCopyFromSSD(m_kds_src, pds_src);
 	}
 	else if (pds_src->kds.format == KDS_FORMAT_BLOCK)
 	{
@@ -5246,6 +6753,11 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 		if (rc != CUDA_SUCCESS)
 			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 	}
+	/* MVCC visibility checks on the raw blocks, if needed */
+	PDS_check_visibility(pds_src, m_kds_src, cuda_module);
+	if (!gpreagg->with_nvme_strom)
+		pgstromStatGpuTaskDMA(&gpreagg->task, CU_DINDEX_PER_THREAD,
+							  pds_src->kds.length, 0);
 
 	/*
 	 * Launch:
@@ -5262,23 +6774,32 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
 	gpreagg->kern.grid_sz = grid_sz;
 	gpreagg->kern.block_sz = block_sz;
+	/*
+	 * kern_gpupreagg and kparams are referenced by all the threads.
+	 * Suspend context is not prefetched, because it shall not consume
+	 * physical pages unless GPU kernel is suspended.
+	 */
+	rc = cuMemPrefetchAsync(m_gpreagg,
+							KERN_GPUPREAGG_LENGTH(&gpreagg->kern),
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
 resume_kernel:
 	/* make kds_slot empty */
 	((kern_data_store *)m_kds_slot)->nitems = 0;
 	((kern_data_store *)m_kds_slot)->usage = 0;
 
+	gpuKernelSeqInit(&kseq, &gpas->gts, 0);
 	kern_args[0] = &m_gpreagg;
 	kern_args[1] = &m_kds_src;
 	kern_args[2] = &m_kds_slot;
-	rc = cuLaunchKernel(kern_setup,
-						gpreagg->kern.grid_sz, 1, 1,
-						gpreagg->kern.block_sz, 1, 1,
-						sizeof(cl_int) * 1024,	/* for StairlikeSum */
-						CU_STREAM_PER_THREAD,
-						kern_args,
-						NULL);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuLaunchKernel: %s", errorText(rc));
+	gpuKernelSeqAdd(&kseq, kern_setup,
+					gpreagg->kern.grid_sz,
+					gpreagg->kern.block_sz,
+					sizeof(cl_int) * 1024,	/* for StairlikeSum */
+					kern_args, 3);
 
 	/*
 	 * Launch:
@@ -5289,6 +6810,16 @@ resume_kernel:
 	 *                          kern_data_store *kds_final,
 	 *                          kern_global_hashslot *f_hash)
 	 */
+	if (gpreagg->kern.num_group_keys > 0 &&
+		gpupreagg_setup_sample_groups(gpreagg, cuda_module,
+									  &kern_sample, &block_sz))
+	{
+		kern_args[0] = &m_gpreagg;
+		kern_args[1] = &m_nullptr;
+		kern_args[2] = &m_kds_slot;
+		gpuKernelSeqAdd(&kseq, kern_sample, 1, block_sz, 0,
+						kern_args, 3);
+	}
 	rc = gpuOptimalBlockSize(&grid_sz,
 							 &block_sz,
 							 kern_reduction,
@@ -5301,15 +6832,14 @@ resume_kernel:
 	kern_args[2] = &m_kds_slot;
 	kern_args[3] = &m_kds_final;
 	kern_args[4] = &m_fhash;
-	rc = cuLaunchKernel(kern_reduction,
-						grid_sz, 1, 1,
-						block_sz, 1, 1,
-						sizeof(cl_int) * 1024,	/* for StairlikeSum */
-						CU_STREAM_PER_THREAD,
-						kern_args,
-						NULL);
+	gpuKernelSeqAdd(&kseq, kern_reduction,
+					grid_sz, block_sz,
+					sizeof(cl_int) * 1024,	/* for StairlikeSum */
+					kern_args, 5);
+	GpuWorkerStageLaunch(&gpreagg->task);
+	rc = gpuKernelSeqLaunch(&kseq, CU_STREAM_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
-		werror("failed on cuLaunchKernel: %s", errorText(rc));
+		werror("failed on gpuKernelSeqLaunch: %s", errorText(rc));
 
 	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
@@ -5319,6 +6849,7 @@ resume_kernel:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	GpuWorkerStageKernel(&gpreagg->task, last_suspend != NULL);
 
 	/*
 	 * XXX - Even though we speculatively allocate large virtual device
@@ -5356,6 +6887,7 @@ resume_kernel:
 		retval = -1;
 	}
 	else if (pgstrom_cpu_fallback_enabled &&
+			 !gpas->fallback_disabled &&
 			 (gpreagg->task.kerror.errcode & ERRCODE_FLAGS_CPU_FALLBACK) != 0)
 	{
 		memset(&gpreagg->task.kerror, 0, sizeof(kern_errorbuf));
@@ -5369,7 +6901,8 @@ resume_kernel:
 			 * can generate alternative rows from pds_src.
 			 */
 			if (pds_src->kds.format == KDS_FORMAT_BLOCK &&
-				pds_src->nblocks_uncached > 0)
+				(pds_src->nblocks_uncached > 0 ||
+				 pds_src->nblocks_unchecked > 0))
 			{
 				rc = cuMemcpyDtoH(&pds_src->kds,
 								  m_kds_src,
@@ -5474,6 +7007,8 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 	bool			m_kds_src_release = false;
 	cl_int			grid_sz;
 	cl_int			block_sz;
+	CUfunction		kern_sample;
+	GpuKernelSeq	kseq;
 	void		   *kern_args[10];
 	void		   *last_suspend = NULL;
 	void		   *temp;
@@ -5514,9 +7049,15 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 
 		Assert(pds_src->kds.format == KDS_FORMAT_BLOCK ||
 			   pds_src->kds.format == KDS_FORMAT_ARROW);
-		rc = gpuMemAllocIOMap(gcontext,
-							  &m_kds_src,
-							  required);
+		/* columns on the GPU buffer don't need i/o mapped memory */
+		if (pds_src->kds.format == KDS_FORMAT_ARROW && pds_src->gpubuf_iov)
+			rc = gpuMemAlloc(gcontext,
+							 &m_kds_src,
+							 required);
+		else
+			rc = gpuMemAllocIOMap(gcontext,
+								  &m_kds_src,
+								  required);
 		if (rc == CUDA_SUCCESS)
 			m_kds_src_release = true;
 		else if (rc == CUDA_ERROR_OUT_OF_MEMORY)
@@ -5526,9 +7067,10 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 			{
 				PDS_fillup_blocks(pds_src);
 
-				rc = gpuMemAlloc(gcontext,
-								 &m_kds_src,
-								 required);
+				rc = gpuMemAllocAsync(gcontext,
+									  &m_kds_src,
+									  required,
+									  CU_STREAM_PER_THREAD);
 				if (rc == CUDA_SUCCESS)
 					m_kds_src_release = true;
 				else if (rc == CUDA_ERROR_OUT_OF_MEMORY)
@@ -5572,11 +7114,16 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 	/*
 	 * OK, kick a series of GpuPreAgg invocations
 	 */
+	GpuWorkerStageBegin(&gpreagg->task);
 	if (pds_src)
 	{
 		if (gpreagg->with_nvme_strom)
 		{
-			gpuMemCopyFromSSD(m_kds_src, pds_src);
+			if (pds_src->kds.format == KDS_FORMAT_ARROW &&
+				pds_src->gpubuf_iov)
+				gpuMemCopyFromGpuBuffer(m_kds_src, pds_src);
+			else
+				gpuMemCopyFromSSD(m_kds_src, pds_src);
 		}
 		else if (pds_src->kds.format == KDS_FORMAT_BLOCK)
 		{
@@ -5596,6 +7143,11 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 			if (rc != CUDA_SUCCESS)
 				werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 		}
+		/* MVCC visibility checks on the raw blocks, if needed */
+		PDS_check_visibility(pds_src, m_kds_src, cuda_module);
+		if (!gpreagg->with_nvme_strom)
+			pgstromStatGpuTaskDMA(&gpreagg->task, CU_DINDEX_PER_THREAD,
+								  pds_src->kds.length, 0);
 	}
 	else
 	{
@@ -5603,6 +7155,18 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 			outerPlanState(gpreagg->task.gts);
 		gpujoinColocateOuterJoinMaps(outer_gts, cuda_module);
 	}
+	/*
+	 * kern_gpupreagg and kparams are referenced by all the threads.
+	 * Suspend context is not prefetched, because it shall not consume
+	 * physical pages unless GPU kernel is suspended.
+	 */
+	rc = cuMemPrefetchAsync(m_gpreagg,
+							KERN_GPUPREAGG_LENGTH(&gpreagg->kern),
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
 resume_kernel:
 	/* make kds_slot empty again */
 	((kern_data_store *)m_kds_slot)->nitems = 0;
@@ -5632,6 +7196,8 @@ resume_kernel:
 							 0, sizeof(int));
 	if (rc != CUDA_SUCCESS)
 		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	block_sz = Min(block_sz,
+				   GPUJOIN_PSTACK_MAX_BLOCK_SZ(gpreagg->kgjoin->pstack_nrooms));
 	gpreagg->kern.grid_sz = grid_sz;
 	gpreagg->kern.block_sz = block_sz;
 
@@ -5644,15 +7210,11 @@ resume_kernel:
 	kern_args[3] = &m_kds_slot;
 	kern_args[4] = &m_kparams;
 
-	rc = cuLaunchKernel(kern_gpujoin_main,
-						grid_sz, 1, 1,
-						block_sz, 1, 1,
-						sizeof(cl_int) * block_sz,
-						CU_STREAM_PER_THREAD,
-						kern_args,
-						NULL);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuLaunchKernel: %s", errorText(rc));
+	gpuKernelSeqInit(&kseq, &gpas->gts, pds_src != NULL ? 1 : 2);
+	gpuKernelSeqAdd(&kseq, kern_gpujoin_main,
+					grid_sz, block_sz,
+					sizeof(cl_int) * block_sz,
+					kern_args, 5);
 
 	/*
 	 * Launch:
@@ -5663,6 +7225,16 @@ resume_kernel:
 	 *                          kern_data_store *kds_final,
 	 *                          kern_global_hashslot *f_hash)
 	 */
+	if (gpreagg->kern.num_group_keys > 0 &&
+		gpupreagg_setup_sample_groups(gpreagg, cuda_module,
+									  &kern_sample, &block_sz))
+	{
+		kern_args[0] = &m_gpreagg;
+		kern_args[1] = &m_kgjoin;
+		kern_args[2] = &m_kds_slot;
+		gpuKernelSeqAdd(&kseq, kern_sample, 1, block_sz, 0,
+						kern_args, 3);
+	}
 	rc = gpuOptimalBlockSize(&grid_sz,
 							 &block_sz,
 							 kern_gpupreagg_reduction,
@@ -5676,15 +7248,14 @@ resume_kernel:
 	kern_args[2] = &m_kds_slot;
 	kern_args[3] = &m_kds_final;
 	kern_args[4] = &m_fhash;
-	rc = cuLaunchKernel(kern_gpupreagg_reduction,
-						grid_sz, 1, 1,
-						block_sz, 1, 1,
-						sizeof(cl_int) * block_sz,	/* for StairlikeSum */
-						CU_STREAM_PER_THREAD,
-						kern_args,
-						NULL);
+	gpuKernelSeqAdd(&kseq, kern_gpupreagg_reduction,
+					grid_sz, block_sz,
+					sizeof(cl_int) * block_sz,	/* for StairlikeSum */
+					kern_args, 5);
+	GpuWorkerStageLaunch(&gpreagg->task);
+	rc = gpuKernelSeqLaunch(&kseq, CU_STREAM_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
-		werror("failed on cuLaunchKernel: %s", errorText(rc));
+		werror("failed on gpuKernelSeqLaunch: %s", errorText(rc));
 
 	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
@@ -5694,10 +7265,12 @@ resume_kernel:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	GpuWorkerStageKernel(&gpreagg->task, last_suspend != NULL);
 
 	if (kgjoin->kerror.errcode != ERRCODE_STROM_SUCCESS)
 	{
 		if (pgstrom_cpu_fallback_enabled &&
+			!gpas->fallback_disabled &&
 			(kgjoin->kerror.errcode & ERRCODE_FLAGS_CPU_FALLBACK) != 0)
 		{
 			/*
@@ -5711,7 +7284,8 @@ resume_kernel:
 
 			if (pds_src &&
 				pds_src->kds.format == KDS_FORMAT_BLOCK &&
-				pds_src->nblocks_uncached > 0)
+				(pds_src->nblocks_uncached > 0 ||
+				 pds_src->nblocks_unchecked > 0))
 			{
 				rc = cuMemcpyDtoH(&pds_src->kds,
 								  m_kds_src,
@@ -5743,6 +7317,7 @@ resume_kernel:
 	else if (gpreagg->kern.kerror.errcode != ERRCODE_STROM_SUCCESS)
 	{
 		if (pgstrom_cpu_fallback_enabled &&
+			!gpas->fallback_disabled &&
 			(gpreagg->kern.kerror.errcode & ERRCODE_FLAGS_CPU_FALLBACK) != 0)
 		{
 			/*
@@ -5835,10 +7410,14 @@ gpupreagg_process_task(GpuTask *gtask, CUmodule cuda_module)
 	GpuPreAggTask  *gpreagg = (GpuPreAggTask *) gtask;
 	int		retval;
 
+	pgstromNvtxRangePush("GpuPreAgg (plan=%d, seq=%u)",
+						 gtask->gts->css.ss.ps.plan->plan_id,
+						 gtask->task_seq);
 	if (!gpreagg->kgjoin)
 		retval = gpupreagg_process_reduction_task(gpreagg, cuda_module);
 	else
 		retval = gpupreagg_process_combined_task(gpreagg, cuda_module);
+	pgstromNvtxRangePop();
 
 	return retval;
 }
@@ -5859,6 +7438,424 @@ gpupreagg_release_task(GpuTask *gtask)
 	gpuMemFree(gcontext, (CUdeviceptr)gpreagg);
 }
 
+/*
+ * __compareArrowRecordBatchIdent
+ */
+static int
+__compareArrowRecordBatchIdent(const void *__a, const void *__b)
+{
+	const ArrowRecordBatchIdent *a = __a;
+	const ArrowRecordBatchIdent *b = __b;
+
+	if (a->st_dev != b->st_dev)
+		return (a->st_dev < b->st_dev ? -1 : 1);
+	if (a->st_ino != b->st_ino)
+		return (a->st_ino < b->st_ino ? -1 : 1);
+	if (a->st_ctim.tv_sec != b->st_ctim.tv_sec)
+		return (a->st_ctim.tv_sec < b->st_ctim.tv_sec ? -1 : 1);
+	if (a->st_ctim.tv_nsec != b->st_ctim.tv_nsec)
+		return (a->st_ctim.tv_nsec < b->st_ctim.tv_nsec ? -1 : 1);
+	if (a->rb_offset != b->rb_offset)
+		return (a->rb_offset < b->rb_offset ? -1 : 1);
+	if (a->rb_length != b->rb_length)
+		return (a->rb_length < b->rb_length ? -1 : 1);
+	if (a->rb_nitems != b->rb_nitems)
+		return (a->rb_nitems < b->rb_nitems ? -1 : 1);
+	if (a->rb_layout != b->rb_layout)
+		return (a->rb_layout < b->rb_layout ? -1 : 1);
+	return 0;
+}
+
+/*
+ * __invalidateGpuPreAggPartialCache
+ *
+ * NOTE: caller must have exclusive lock of the GpuPreAggPartialCacheHead
+ */
+static void
+__invalidateGpuPreAggPartialCache(GpuPreAggPartialCache *entry)
+{
+	dlist_delete(&entry->chain);
+	dlist_delete(&entry->lru_chain);
+	Assert(gpupreagg_partial_cache_head->usage >= entry->nbytes);
+	gpupreagg_partial_cache_head->usage -= entry->nbytes;
+	pfree(entry);
+}
+
+/*
+ * gpupreagg_partial_cache_init
+ *
+ * It constructs the key of the partial aggregation cache, if this GpuPreAgg
+ * scans Arrow_Fdw and its results are deterministic. If the prior query
+ * already cached the partial results of a part of the RecordBatches, this
+ * GpuPreAgg reuses them, and skips these RecordBatches.
+ */
+static void
+gpupreagg_partial_cache_init(GpuPreAggState *gpas,
+							 GpuPreAggInfo *gpa_info,
+							 int eflags)
+{
+	CustomScan	   *cscan = (CustomScan *) gpas->gts.css.ss.ps.plan;
+	EState		   *estate = gpas->gts.css.ss.ps.state;
+	Relation		relation = gpas->gts.css.ss.ss_currentRelation;
+	ArrowFdwState  *af_state = gpas->gts.af_state;
+	ArrowRecordBatchIdent *idents;
+	ArrowRecordBatchIdent *sorted;
+	Bitmapset	   *rb_skipped = NULL;
+	StringInfoData	key;
+	uint32			hash;
+	uint32			i, nbatches;
+	ListCell	   *lc;
+	dlist_mutable_iter iter;
+
+	if (!enable_gpupreagg_partial_cache ||
+		gpupreagg_partial_cache_size_kb == 0 ||
+		!af_state ||
+		!relation ||
+		gpas->combined_gpujoin ||
+		gpas->complete_mode ||
+		cscan->scan.plan.parallel_aware ||
+		IsParallelWorker() ||
+		(eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0 ||
+		estate->es_plannedstmt->commandType != CMD_SELECT ||
+		estate->es_plannedstmt->hasModifyingCTE ||
+		TransactionIdIsValid(GetTopTransactionIdIfAny()) ||
+		contain_mutable_functions((Node *)cscan->custom_scan_tlist) ||
+		contain_mutable_functions((Node *)gpa_info->outer_quals))
+		return;
+	/* Param may have different value for each execution */
+	foreach (lc, gpa_info->used_params)
+	{
+		if (!IsA(lfirst(lc), Const))
+			return;
+	}
+
+	/* the same RecordBatch twice makes the partial results ambiguous */
+	nbatches = ExecArrowFdwRecordBatchIdents(af_state, &idents);
+	sorted = palloc(sizeof(ArrowRecordBatchIdent) * Max(nbatches, 1));
+	memcpy(sorted, idents, sizeof(ArrowRecordBatchIdent) * nbatches);
+	qsort(sorted, nbatches, sizeof(ArrowRecordBatchIdent),
+		  __compareArrowRecordBatchIdent);
+	for (i=1; i < nbatches; i++)
+	{
+		if (__compareArrowRecordBatchIdent(&sorted[i-1], &sorted[i]) == 0)
+		{
+			pfree(sorted);
+			pfree(idents);
+			return;
+		}
+	}
+
+	initStringInfo(&key);
+	appendStringInfo(&key,
+					 "db=%u;relid=%u;part=%u/%u;"
+					 "tlist=%s;quals=%s;params=%s;",
+					 MyDatabaseId,
+					 RelationGetRelid(relation),
+					 gpas->part_index,
+					 gpas->part_nbits,
+					 nodeToString(cscan->custom_scan_tlist),
+					 nodeToString(gpa_info->outer_quals),
+					 nodeToString(gpa_info->used_params));
+	gpas->pcache_key = key.data;
+	gpas->pcache_nbatches = nbatches;
+	gpas->pcache_idents = sorted;
+	gpas->pcache_store = true;
+	initStringInfo(&gpas->pcache_buf);
+
+	hash = DatumGetUInt32(hash_any((unsigned char *)key.data, key.len));
+	LWLockAcquire(&gpupreagg_partial_cache_head->lock, LW_EXCLUSIVE);
+	dlist_foreach_modify(iter, &gpupreagg_partial_cache_head->hash_slots[hash %
+										GPUPREAGG_PARTIAL_CACHE_NSLOTS])
+	{
+		GpuPreAggPartialCache *entry = dlist_container(GpuPreAggPartialCache,
+													   chain, iter.cur);
+		if (entry->hash != hash ||
+			entry->database_oid != MyDatabaseId ||
+			strcmp(entry->key, key.data) != 0)
+			continue;
+
+		/* all the RecordBatches covered must be still scanned */
+		for (i=0; i < nbatches; i++)
+		{
+			if (bsearch(&idents[i],
+						entry->idents,
+						entry->nbatches,
+						sizeof(ArrowRecordBatchIdent),
+						__compareArrowRecordBatchIdent))
+				rb_skipped = bms_add_member(rb_skipped, i);
+		}
+		if (entry->nbatches > 0 &&
+			bms_num_members(rb_skipped) == entry->nbatches)
+		{
+			gpas->pcache_rows = palloc(Max(entry->rows_len, 1));
+			memcpy(gpas->pcache_rows, entry->rows, entry->rows_len);
+			gpas->pcache_rows_len = entry->rows_len;
+			gpas->pcache_nrows = entry->nrows;
+			gpas->pcache_nreused = entry->nbatches;
+			dlist_delete(&entry->lru_chain);
+			dlist_push_tail(&gpupreagg_partial_cache_head->lru_list,
+							&entry->lru_chain);
+		}
+		else
+		{
+			/* some of the files were modified, so the entry is obsolete */
+			__invalidateGpuPreAggPartialCache(entry);
+			bms_free(rb_skipped);
+			rb_skipped = NULL;
+		}
+		break;
+	}
+	LWLockRelease(&gpupreagg_partial_cache_head->lock);
+
+	if (rb_skipped)
+		ExecSkipArrowFdwRecordBatches(af_state, rb_skipped);
+	pfree(idents);
+}
+
+/*
+ * gpupreagg_partial_cache_fetch
+ *
+ * It fetches the next partial result reused from the cache.
+ */
+static TupleTableSlot *
+gpupreagg_partial_cache_fetch(GpuPreAggState *gpas)
+{
+	TupleTableSlot *slot = gpas->gpreagg_slot;
+	char		   *pos = gpas->pcache_rows + gpas->pcache_rows_pos;
+	HeapTupleData	tuple;
+
+	Assert(gpas->pcache_rows_pos < gpas->pcache_rows_len);
+	tuple.t_len = *((uint32 *)pos);
+	ItemPointerSetInvalid(&tuple.t_self);
+	tuple.t_tableOid = InvalidOid;
+	tuple.t_data = (HeapTupleHeader)(pos + MAXALIGN(sizeof(uint32)));
+	gpas->pcache_rows_pos += (MAXALIGN(sizeof(uint32)) +
+							  MAXALIGN(tuple.t_len));
+	ExecClearTuple(slot);
+	heap_deform_tuple(&tuple,
+					  slot->tts_tupleDescriptor,
+					  slot->tts_values,
+					  slot->tts_isnull);
+	return ExecStoreVirtualTuple(slot);
+}
+
+/*
+ * gpupreagg_partial_cache_append
+ *
+ * It saves a partial result generated by this GpuPreAgg, to be cached.
+ */
+static void
+gpupreagg_partial_cache_append(GpuPreAggState *gpas, TupleTableSlot *slot)
+{
+	StringInfo	buf = &gpas->pcache_buf;
+	size_t		budget = (size_t)gpupreagg_partial_cache_size_kb << 10;
+	HeapTuple	tuple;
+	size_t		sz;
+	char	   *pos;
+
+	slot_getallattrs(slot);
+	tuple = heap_form_tuple(slot->tts_tupleDescriptor,
+							slot->tts_values,
+							slot->tts_isnull);
+	sz = MAXALIGN(sizeof(uint32)) + MAXALIGN(tuple->t_len);
+	if (gpas->pcache_rows_len + buf->len + sz > Min(budget, MaxAllocSize / 2))
+	{
+		/* too large partial results to be cached */
+		gpas->pcache_store = false;
+		pfree(buf->data);
+		memset(buf, 0, sizeof(StringInfoData));
+	}
+	else
+	{
+		enlargeStringInfo(buf, sz);
+		pos = buf->data + buf->len;
+		memset(pos, 0, sz);
+		*((uint32 *)pos) = tuple->t_len;
+		memcpy(pos + MAXALIGN(sizeof(uint32)), tuple->t_data, tuple->t_len);
+		buf->len += sz;
+		gpas->pcache_buf_nrows++;
+	}
+	heap_freetuple(tuple);
+}
+
+/*
+ * gpupreagg_partial_cache_store
+ *
+ * It registers the partial results of all the RecordBatches; both of reused
+ * ones and generated ones, for the later queries. It supersedes the older
+ * entry with the same key, then evicts the entries in LRU order, if
+ * pg_strom.gpupreagg_partial_cache_size is overflow.
+ */
+static void
+gpupreagg_partial_cache_store(GpuPreAggState *gpas)
+{
+	GpuPreAggPartialCache *entry;
+	size_t		budget = (size_t)gpupreagg_partial_cache_size_kb << 10;
+	size_t		key_len = strlen(gpas->pcache_key) + 1;
+	size_t		rows_len = gpas->pcache_rows_len + gpas->pcache_buf.len;
+	size_t		nbytes;
+	uint32		hash;
+	char	   *pos;
+	dlist_mutable_iter iter;
+
+	gpas->pcache_store = false;
+	/* no new RecordBatches were processed */
+	if (gpas->pcache_nreused == gpas->pcache_nbatches)
+		return;
+	nbytes = (MAXALIGN(sizeof(GpuPreAggPartialCache)) +
+			  MAXALIGN(sizeof(ArrowRecordBatchIdent) * gpas->pcache_nbatches) +
+			  MAXALIGN(key_len) +
+			  MAXALIGN(rows_len));
+	if (nbytes > budget)
+		return;
+
+	entry = MemoryContextAllocZero(TopSharedMemoryContext, nbytes);
+	hash = DatumGetUInt32(hash_any((unsigned char *)gpas->pcache_key,
+								   key_len - 1));
+	entry->hash = hash;
+	entry->database_oid = MyDatabaseId;
+	entry->relid = RelationGetRelid(gpas->gts.css.ss.ss_currentRelation);
+	entry->nbytes = nbytes;
+	entry->nbatches = gpas->pcache_nbatches;
+	entry->nrows = gpas->pcache_nrows + gpas->pcache_buf_nrows;
+	entry->rows_len = rows_len;
+	pos = (char *)entry + MAXALIGN(sizeof(GpuPreAggPartialCache));
+	entry->idents = (ArrowRecordBatchIdent *)pos;
+	memcpy(entry->idents, gpas->pcache_idents,
+		   sizeof(ArrowRecordBatchIdent) * gpas->pcache_nbatches);
+	pos += MAXALIGN(sizeof(ArrowRecordBatchIdent) * gpas->pcache_nbatches);
+	entry->key = pos;
+	memcpy(entry->key, gpas->pcache_key, key_len);
+	pos += MAXALIGN(key_len);
+	entry->rows = pos;
+	if (gpas->pcache_rows_len > 0)
+		memcpy(pos, gpas->pcache_rows, gpas->pcache_rows_len);
+	if (gpas->pcache_buf.len > 0)
+		memcpy(pos + gpas->pcache_rows_len,
+			   gpas->pcache_buf.data,
+			   gpas->pcache_buf.len);
+
+	LWLockAcquire(&gpupreagg_partial_cache_head->lock, LW_EXCLUSIVE);
+	dlist_foreach_modify(iter, &gpupreagg_partial_cache_head->hash_slots[hash %
+										GPUPREAGG_PARTIAL_CACHE_NSLOTS])
+	{
+		GpuPreAggPartialCache *temp = dlist_container(GpuPreAggPartialCache,
+													  chain, iter.cur);
+		if (temp->hash == hash &&
+			temp->database_oid == MyDatabaseId &&
+			strcmp(temp->key, entry->key) == 0)
+			__invalidateGpuPreAggPartialCache(temp);
+	}
+	dlist_foreach_modify(iter, &gpupreagg_partial_cache_head->lru_list)
+	{
+		GpuPreAggPartialCache *temp = dlist_container(GpuPreAggPartialCache,
+													  lru_chain, iter.cur);
+		if (gpupreagg_partial_cache_head->usage + nbytes <= budget)
+			break;
+		__invalidateGpuPreAggPartialCache(temp);
+	}
+	if (gpupreagg_partial_cache_head->usage + nbytes <= budget)
+	{
+		dlist_push_tail(&gpupreagg_partial_cache_head->hash_slots[hash %
+											GPUPREAGG_PARTIAL_CACHE_NSLOTS],
+						&entry->chain);
+		dlist_push_tail(&gpupreagg_partial_cache_head->lru_list,
+						&entry->lru_chain);
+		gpupreagg_partial_cache_head->usage += nbytes;
+		entry = NULL;
+	}
+	LWLockRelease(&gpupreagg_partial_cache_head->lock);
+	if (entry)
+		pfree(entry);
+}
+
+/*
+ * gpupreagg_partial_cache_rebase
+ *
+ * Arrow_Fdw calls this routine once it appended RecordBatches on the file.
+ * The RecordBatches already in the file are not modified, so it moves the
+ * st_ctim of the idents forward to keep the entries valid. The order of the
+ * sorted idents is preserved, because all the idents of the file have the
+ * same st_ctim.
+ */
+void
+gpupreagg_partial_cache_rebase(const struct stat *old_stat,
+							   const struct stat *new_stat)
+{
+	dlist_iter	iter;
+	uint32		i;
+
+	if (!gpupreagg_partial_cache_head)
+		return;
+	LWLockAcquire(&gpupreagg_partial_cache_head->lock, LW_EXCLUSIVE);
+	dlist_foreach(iter, &gpupreagg_partial_cache_head->lru_list)
+	{
+		GpuPreAggPartialCache *entry = dlist_container(GpuPreAggPartialCache,
+													   lru_chain, iter.cur);
+		for (i=0; i < entry->nbatches; i++)
+		{
+			ArrowRecordBatchIdent *ident = &entry->idents[i];
+
+			if (ident->st_dev == old_stat->st_dev &&
+				ident->st_ino == old_stat->st_ino &&
+				ident->st_ctim.tv_sec == old_stat->st_ctim.tv_sec &&
+				ident->st_ctim.tv_nsec == old_stat->st_ctim.tv_nsec)
+				ident->st_ctim = new_stat->st_ctim;
+		}
+	}
+	LWLockRelease(&gpupreagg_partial_cache_head->lock);
+}
+
+/*
+ * gpupreaggPartialCacheRelcacheCallback
+ */
+static void
+gpupreaggPartialCacheRelcacheCallback(Datum arg, Oid relid)
+{
+	dlist_mutable_iter iter;
+
+	if (!gpupreagg_partial_cache_head)
+		return;
+	LWLockAcquire(&gpupreagg_partial_cache_head->lock, LW_EXCLUSIVE);
+	dlist_foreach_modify(iter, &gpupreagg_partial_cache_head->lru_list)
+	{
+		GpuPreAggPartialCache *entry = dlist_container(GpuPreAggPartialCache,
+													   lru_chain, iter.cur);
+		if (entry->database_oid != MyDatabaseId)
+			continue;
+		if (OidIsValid(relid) && entry->relid != relid)
+			continue;
+		__invalidateGpuPreAggPartialCache(entry);
+	}
+	LWLockRelease(&gpupreagg_partial_cache_head->lock);
+}
+
+/*
+ * pgstrom_startup_gpupreagg
+ */
+static void
+pgstrom_startup_gpupreagg(void)
+{
+	bool	found;
+	int		i;
+
+	if (shmem_startup_next)
+		(*shmem_startup_next)();
+
+	gpupreagg_partial_cache_head =
+		ShmemInitStruct("gpupreagg_partial_cache_head",
+						MAXALIGN(sizeof(GpuPreAggPartialCacheHead)),
+						&found);
+	if (!IsUnderPostmaster)
+	{
+		LWLockInitialize(&gpupreagg_partial_cache_head->lock, -1);
+		gpupreagg_partial_cache_head->usage = 0;
+		for (i=0; i < GPUPREAGG_PARTIAL_CACHE_NSLOTS; i++)
+			dlist_init(&gpupreagg_partial_cache_head->hash_slots[i]);
+		dlist_init(&gpupreagg_partial_cache_head->lru_list);
+	}
+}
+
 /*
  * entrypoint of GpuPreAgg
  */
@@ -5905,6 +7902,53 @@ pgstrom_init_gpupreagg(void)
 							 PGC_USERSET,
 							 GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* pg_strom.enable_numeric_exact_aggfuncs */
+	DefineCustomBoolVariable("pg_strom.enable_numeric_exact_aggfuncs",
+							 "Enables exact sum/avg on numeric by scaled integers",
+							 NULL,
+							 &enable_numeric_exact_aggfuncs,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.enable_gpupreagg_distinct */
+	DefineCustomBoolVariable("pg_strom.enable_gpupreagg_distinct",
+							 "Enables GpuPreAgg to eliminate duplicated arguments of DISTINCT aggregates",
+							 NULL,
+							 &enable_gpupreagg_distinct,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.enable_gpupreagg_complete */
+	DefineCustomBoolVariable("pg_strom.enable_gpupreagg_complete",
+							 "Enables GpuPreAgg to run the final aggregation without Agg node",
+							 NULL,
+							 &enable_gpupreagg_complete,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.enable_gpupreagg_adaptive */
+	DefineCustomBoolVariable("pg_strom.enable_gpupreagg_adaptive",
+							 "Enables GpuPreAgg to choose the reduction mode for each chunk",
+							 NULL,
+							 &enable_gpupreagg_adaptive,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpupreagg_partition_size */
+	DefineCustomIntVariable("pg_strom.gpupreagg_partition_size",
+							"Max number of groups per hash-partition of GpuPreAgg",
+							NULL,
+							&gpupreagg_partition_size,
+							20000000,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
 	/* pg_strom.gpupreagg_reduction_threshold */
 	DefineCustomRealVariable("pg_strom.gpupreagg_reduction_threshold",
 							 "Minimus reduction ratio to use GpuPreAgg",
@@ -5916,6 +7960,26 @@ pgstrom_init_gpupreagg(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* pg_strom.enable_gpupreagg_partial_cache */
+	DefineCustomBoolVariable("pg_strom.enable_gpupreagg_partial_cache",
+							 "Enables GpuPreAgg to reuse the partial results on Arrow_Fdw by the prior queries",
+							 NULL,
+							 &enable_gpupreagg_partial_cache,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpupreagg_partial_cache_size */
+	DefineCustomIntVariable("pg_strom.gpupreagg_partial_cache_size",
+							"Size of shared memory to cache the partial results of GpuPreAgg",
+							NULL,
+							&gpupreagg_partial_cache_size_kb,
+							0,			/* disabled */
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 	/* initialization of path method table */
 	memset(&gpupreagg_path_methods, 0, sizeof(CustomPathMethods));
 	gpupreagg_path_methods.CustomName          = "GpuPreAgg";
@@ -5944,4 +8008,10 @@ pgstrom_init_gpupreagg(void)
 	/* hook registration */
 	create_upper_paths_next = create_upper_paths_hook;
 	create_upper_paths_hook = gpupreagg_add_grouping_paths;
+
+	/* shared state of the partial aggregation cache */
+	RequestAddinShmemSpace(MAXALIGN(sizeof(GpuPreAggPartialCacheHead)));
+	shmem_startup_next = shmem_startup_hook;
+	shmem_startup_hook = pgstrom_startup_gpupreagg;
+	CacheRegisterRelcacheCallback(gpupreaggPartialCacheRelcacheCallback, 0);
 }
@@ -25,6 +25,10 @@ static CustomScanMethods	gpuscan_plan_methods;
 static CustomExecMethods	gpuscan_exec_methods;
 bool						enable_gpuscan;		/* GUC */
 static bool					enable_pullup_outer_scan;
+static bool					enable_gpuscan_adaptive_quals;	/* GUC */
+static bool					enable_gpuscan_hybrid_exec;		/* GUC */
+static bool					enable_gpuscan_late_materialize;	/* GUC */
+static int					gpuscan_bytecode_threshold;		/* GUC */
 
 /*
  * form/deform interface of private field of CustomScan(GpuScan)
@@ -40,9 +44,12 @@ typedef struct {
 	List	   *outer_refs;		/* referenced outer attributes */
 	List	   *used_params;
 	List	   *dev_quals;		/* implicitly-ANDed device quals */
+	List	   *dev_costs;		/* estimated cost of each device qual */
+	cl_int		tuple_bound;	/* LIMIT bound pushed down, or -1 */
 	Oid			index_oid;		/* OID of BRIN-index, if any */
 	List	   *index_conds;	/* BRIN-index key conditions */
 	List	   *index_quals;	/* original BRIN-index qualifier */
+	bool		bytecode_mode;	/* qualifiers are evaluated by bytecode */
 } GpuScanInfo;
 
 static inline void
@@ -61,9 +68,12 @@ form_gpuscan_info(CustomScan *cscan, GpuScanInfo *gs_info)
 	privs = lappend(privs, gs_info->outer_refs);
 	exprs = lappend(exprs, gs_info->used_params);
 	exprs = lappend(exprs, gs_info->dev_quals);
+	privs = lappend(privs, gs_info->dev_costs);
+	privs = lappend(privs, makeInteger(gs_info->tuple_bound));
 	privs = lappend(privs, makeInteger(gs_info->index_oid));
 	privs = lappend(privs, gs_info->index_conds);
 	exprs = lappend(exprs, gs_info->index_quals);
+	privs = lappend(privs, makeInteger(gs_info->bytecode_mode));
 
 	cscan->custom_private = privs;
 	cscan->custom_exprs = exprs;
@@ -88,15 +98,21 @@ deform_gpuscan_info(CustomScan *cscan)
 	gs_info->outer_refs = list_nth(privs, pindex++);
 	gs_info->used_params = list_nth(exprs, eindex++);
 	gs_info->dev_quals = list_nth(exprs, eindex++);
+	gs_info->dev_costs = list_nth(privs, pindex++);
+	gs_info->tuple_bound = intVal(list_nth(privs, pindex++));
 	gs_info->index_oid = intVal(list_nth(privs, pindex++));
 	gs_info->index_conds = list_nth(privs, pindex++);
 	gs_info->index_quals = list_nth(exprs, eindex++);
+	gs_info->bytecode_mode = intVal(list_nth(privs, pindex++));
 
 	return gs_info;
 }
 
 typedef struct {
 	GpuTaskRuntimeStat	c;		/* common statistics */
+	/* per-clause statistics for run-time reordering of device quals */
+	pg_atomic_uint64	quals_nitems_in[GPUSCAN_MAX_REORDER_QUALS];
+	pg_atomic_uint64	quals_nitems_out[GPUSCAN_MAX_REORDER_QUALS];
 } GpuScanRuntimeStat;
 
 typedef struct {
@@ -112,6 +128,10 @@ typedef struct {
 	HeapTupleData	scan_tuple;		/* buffer to fetch tuple */
 	ExprState	   *dev_quals;		/* quals to be run on the device */
 	bool			dev_projection;	/* true, if device projection is valid */
+	bool			late_materialize; /* true, if CPU runs projection on the
+									   * rows qualified by GPU */
+	cl_int			num_quals;		/* # of reorderable device quals */
+	cl_int			quals_cost[GPUSCAN_MAX_REORDER_QUALS];
 	cl_uint			proj_tuple_sz;
 	cl_uint			proj_extra_sz;
 	/* resource for CPU fallback */
@@ -138,8 +158,11 @@ typedef struct
 static GpuTask  *gpuscan_next_task(GpuTaskState *gts);
 static TupleTableSlot *gpuscan_next_tuple(GpuTaskState *gts);
 static void gpuscan_switch_task(GpuTaskState *gts, GpuTask *gtask);
+static bool gpuscan_cpu_task(GpuTaskState *gts, GpuTask *gtask);
 static int gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module);
+static bool gpuscan_prefetch_task(GpuTask *gtask, CUstream stream);
 static void gpuscan_release_task(GpuTask *gtask);
+static bool gpuscan_async_begin(GpuTaskState *gts);
 
 static void createGpuScanSharedState(GpuScanState *gss,
 									 ParallelContext *pcxt,
@@ -192,6 +215,7 @@ create_gpuscan_path(PlannerInfo *root,
 	double			scan_ntuples;
 	double			scan_nchunks;
 	double			cpu_per_tuple = 0.0;
+	double			cost_ratio;
 	int				scan_mode;
 
 	/* cost for disk i/o + GPU qualifiers */
@@ -266,6 +290,12 @@ create_gpuscan_path(PlannerInfo *root,
 	/* Latency to get the first chunk */
 	startup_delay = run_cost * (1.0 / scan_nchunks);
 
+	/* runtime feedback to the cost model, if any */
+	cost_ratio = pgstrom_gpu_cost_feedback(GpuTaskKind_GpuScan);
+	startup_cost *= cost_ratio;
+	run_cost *= cost_ratio;
+	startup_delay *= cost_ratio;
+
 	cpath->path.startup_cost = startup_cost + startup_delay;
 	cpath->path.total_cost = startup_cost + run_cost;
 	cpath->path.pathkeys = NIL;	/* unsorted results */
@@ -382,14 +412,19 @@ gpuscan_add_scan_path(PlannerInfo *root,
 
 /*
  * reorder_devqual_clauses
+ *
+ * It sorts the device clauses by the static cost; cheaper one first.
+ * @p_dev_costs shall be also sorted according to the new order.
  */
 static List *
-reorder_devqual_clauses(PlannerInfo *root, List *dev_quals, List *dev_costs)
+reorder_devqual_clauses(PlannerInfo *root, List *dev_quals, List **p_dev_costs)
 {
+	List	   *dev_costs = *p_dev_costs;
 	ListCell   *lc1, *lc2;
 	int			nitems;
 	int			i, j, k;
 	List	   *results = NIL;
+	List	   *costs = NIL;
 	struct {
 		Node   *qual;
 		int		cost;
@@ -424,8 +459,10 @@ reorder_devqual_clauses(PlannerInfo *root, List *dev_quals, List *dev_costs)
 			items[k] = temp;
 		}
 		results = lappend(results, items[i].qual);
+		costs = lappend_int(costs, items[i].cost);
 	}
 	pfree(items);
+	*p_dev_costs = costs;
 
 	return results;
 }
@@ -442,20 +479,43 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 	StringInfoData	tfunc;
 	StringInfoData	cfunc;
 	StringInfoData	temp;
+	StringInfoData	ebody;
 	Node		   *dev_quals;
 	Var			   *var;
 	char		   *expr_code = NULL;
+	List		   *qual_codes = NIL;
 	ListCell	   *lc;
 
 	initStringInfo(&tfunc);
 	initStringInfo(&cfunc);
 	initStringInfo(&temp);
+	initStringInfo(&ebody);
 
 	if (scanrelid == 0 || dev_quals_list == NIL)
 		goto output;
-	/* Let's walk on the device expression tree */
-	dev_quals = (Node *)make_flat_ands_explicit(dev_quals_list);
-	expr_code = pgstrom_codegen_expression(dev_quals, context);
+	/*
+	 * Let's walk on the device expression tree.
+	 *
+	 * If GpuScan has multiple device clauses, each clause is evaluated
+	 * individually in the order given by kgpuscan->quals_order[], to
+	 * reorder them according to the run-time selectivity.
+	 */
+	if (enable_gpuscan_adaptive_quals &&
+		strcmp(component, "gpuscan") == 0 &&
+		list_length(dev_quals_list) > 1 &&
+		list_length(dev_quals_list) <= GPUSCAN_MAX_REORDER_QUALS)
+	{
+		foreach (lc, dev_quals_list)
+		{
+			expr_code = pgstrom_codegen_expression(lfirst(lc), context);
+			qual_codes = lappend(qual_codes, expr_code);
+		}
+	}
+	else
+	{
+		dev_quals = (Node *)make_flat_ands_explicit(dev_quals_list);
+		expr_code = pgstrom_codegen_expression(dev_quals, context);
+	}
 	/* Const/Param declarations */
 	pgstrom_codegen_param_declarations(&cfunc, context);
 	pgstrom_codegen_param_declarations(&tfunc, context);
@@ -575,6 +635,50 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 			"  EXTRACT_HEAP_TUPLE_END();\n");
 	}
 output:
+	if (qual_codes != NIL)
+	{
+		int		qindex = 0;
+
+		appendStringInfo(
+			&ebody,
+			"  kern_gpuscan *kgpuscan = KERN_GPUSCAN_FROM_PARAMBUF(kcxt->kparams);\n"
+			"  cl_uint  __i, __k;\n"
+			"  cl_bool  __rv;\n"
+			"\n"
+			"  for (__i=0; __i < %d; __i++)\n"
+			"  {\n"
+			"    __k = kgpuscan->quals_order[__i];\n"
+			"    switch (__k)\n"
+			"    {\n",
+			list_length(qual_codes));
+		foreach (lc, qual_codes)
+		{
+			appendStringInfo(
+				&ebody,
+				"      case %d:\n"
+				"        __rv = EVAL(%s);\n"
+				"        break;\n",
+				qindex++, (char *)lfirst(lc));
+		}
+		appendStringInfoString(
+			&ebody,
+			"      default:\n"
+			"        __rv = false;\n"
+			"        break;\n"
+			"    }\n"
+			"    if (!gpuscan_quals_count(kgpuscan, __k, __rv))\n"
+			"      return false;\n"
+			"  }\n"
+			"  return true;\n");
+	}
+	else
+	{
+		appendStringInfo(
+			&ebody,
+			"  return %s;\n",
+			!expr_code ? "true" : psprintf("EVAL(%s)", expr_code));
+	}
+
 	appendStringInfo(
 		kern,
 		"DEVICE_FUNCTION(cl_bool)\n"
@@ -585,7 +689,7 @@ output:
 		"{\n"
 		"  void *addr __attribute__((unused));\n"
 		"%s%s\n"
-		"  return %s;\n"
+		"%s"
 		"}\n\n"
 		"DEVICE_FUNCTION(cl_bool)\n"
 		"%s_quals_eval_arrow(kern_context *kcxt,\n"
@@ -594,16 +698,315 @@ output:
 		"{\n"
 		"  void *addr __attribute__((unused));\n"
 		"%s%s\n"
-		"  return %s;\n"
+		"%s"
 		"}\n\n",
 		component,
 		context->decl_temp.data,
 		tfunc.data,
-		!expr_code ? "true" : psprintf("EVAL(%s)", expr_code),
+		ebody.data,
 		component,
 		context->decl_temp.data,
 		cfunc.data,
-		!expr_code ? "true" : psprintf("EVAL(%s)", expr_code));
+		ebody.data);
+}
+
+/*
+ * codegen_gpuscan_bytecode
+ *
+ * It tries to translate the device qualifiers into gpuscanBytecode, to be
+ * evaluated by the precompiled gpuscan_bytecode_eval(), instead of the JIT
+ * compiled logic. Only simple shapes are supported; comparison operators
+ * of integer, floating-point and date/time types between columns and
+ * Const/Param, AND/OR/NOT, IS [NOT] NULL and boolean columns.
+ * The supplied codegen_context must be fresh, because the bytecode itself
+ * shall be delivered as KPARAM_0.
+ */
+typedef struct
+{
+	codegen_context *context;
+	Index		scanrelid;
+	StringInfoData buf;
+	int			depth;
+} gsbc_context;
+
+static bool
+__gsbc_append_code(gsbc_context *gcxt, int opcode, int vtype, int arg)
+{
+	gpuscanBytecode	code;
+
+	code.opcode = opcode;
+	code.vtype = vtype;
+	code.arg = arg;
+	appendBinaryStringInfo(&gcxt->buf, (char *)&code, sizeof(code));
+
+	if (opcode == GSBC_OP__VAR || opcode == GSBC_OP__PARAM)
+		gcxt->depth++;
+	else if (opcode >= GSBC_OP__EQ && opcode <= GSBC_OP__GE)
+		gcxt->depth--;
+	else if (opcode == GSBC_OP__AND || opcode == GSBC_OP__OR)
+		gcxt->depth -= (arg - 1);
+	return (gcxt->depth <= GSBC_MAX_STACK_DEPTH);
+}
+
+static int
+__gsbc_type_code(Oid type_oid)
+{
+	switch (type_oid)
+	{
+		case BOOLOID:
+			return GSBC_TYPE__BOOL;
+		case INT2OID:
+			return GSBC_TYPE__INT2;
+		case INT4OID:
+		case DATEOID:
+			return GSBC_TYPE__INT4;
+		case INT8OID:
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return GSBC_TYPE__INT8;
+		case FLOAT4OID:
+			return GSBC_TYPE__FLOAT4;
+		case FLOAT8OID:
+			return GSBC_TYPE__FLOAT8;
+		default:
+			break;
+	}
+	return 0;
+}
+
+static bool
+__gsbc_append_operand(gsbc_context *gcxt, Node *node)
+{
+	codegen_context *context = gcxt->context;
+	ListCell   *lc;
+	int			vtype;
+	int			index;
+
+	if (IsA(node, Var))
+	{
+		Var	   *var = (Var *)node;
+
+		if (var->varno != gcxt->scanrelid ||
+			var->varattno <= 0 ||
+			var->varlevelsup != 0)
+			return false;
+		vtype = __gsbc_type_code(var->vartype);
+		if (vtype == 0)
+			return false;
+		return __gsbc_append_code(gcxt, GSBC_OP__VAR, vtype, var->varattno);
+	}
+	else if (IsA(node, Const))
+	{
+		Const  *con = (Const *)node;
+
+		vtype = __gsbc_type_code(con->consttype);
+		if (vtype == 0)
+			return false;
+		context->used_params = lappend(context->used_params,
+									   copyObject(con));
+		index = list_length(context->used_params) - 1;
+		return __gsbc_append_code(gcxt, GSBC_OP__PARAM, vtype, index);
+	}
+	else if (IsA(node, Param))
+	{
+		Param  *param = (Param *)node;
+
+		if (param->paramkind != PARAM_EXTERN)
+			return false;
+		vtype = __gsbc_type_code(param->paramtype);
+		if (vtype == 0)
+			return false;
+		index = 0;
+		foreach (lc, context->used_params)
+		{
+			if (equal(param, lfirst(lc)))
+				return __gsbc_append_code(gcxt, GSBC_OP__PARAM, vtype, index);
+			index++;
+		}
+		context->used_params = lappend(context->used_params,
+									   copyObject(param));
+		return __gsbc_append_code(gcxt, GSBC_OP__PARAM, vtype, index);
+	}
+	return false;
+}
+
+static bool
+__gsbc_append_opexpr(gsbc_context *gcxt, OpExpr *op)
+{
+	Node	   *arg1;
+	Node	   *arg2;
+	Oid			type1;
+	Oid			type2;
+	int			vtype1;
+	int			vtype2;
+	int			strategy;
+	int			opcode;
+	TypeCacheEntry *tcache;
+
+	if (list_length(op->args) != 2)
+		return false;
+	arg1 = linitial(op->args);
+	arg2 = lsecond(op->args);
+	type1 = exprType(arg1);
+	type2 = exprType(arg2);
+	vtype1 = __gsbc_type_code(type1);
+	vtype2 = __gsbc_type_code(type2);
+	if (vtype1 == 0 || vtype1 == GSBC_TYPE__BOOL ||
+		vtype2 == 0 || vtype2 == GSBC_TYPE__BOOL)
+		return false;
+	/*
+	 * integer and floating-point types can be compared across the types
+	 * of the same category; date/time types must be identical, because
+	 * cross-type comparison needs conversion of the values.
+	 */
+	if ((vtype1 == GSBC_TYPE__FLOAT4 || vtype1 == GSBC_TYPE__FLOAT8) !=
+		(vtype2 == GSBC_TYPE__FLOAT4 || vtype2 == GSBC_TYPE__FLOAT8))
+		return false;
+	if (type1 != type2 &&
+		((type1 != INT2OID && type1 != INT4OID && type1 != INT8OID &&
+		  type1 != FLOAT4OID && type1 != FLOAT8OID) ||
+		 (type2 != INT2OID && type2 != INT4OID && type2 != INT8OID &&
+		  type2 != FLOAT4OID && type2 != FLOAT8OID)))
+		return false;
+
+	tcache = lookup_type_cache(type1, TYPECACHE_BTREE_OPFAMILY);
+	if (!OidIsValid(tcache->btree_opf))
+		return false;
+	strategy = get_op_opfamily_strategy(op->opno, tcache->btree_opf);
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+			opcode = GSBC_OP__LT;
+			break;
+		case BTLessEqualStrategyNumber:
+			opcode = GSBC_OP__LE;
+			break;
+		case BTEqualStrategyNumber:
+			opcode = GSBC_OP__EQ;
+			break;
+		case BTGreaterEqualStrategyNumber:
+			opcode = GSBC_OP__GE;
+			break;
+		case BTGreaterStrategyNumber:
+			opcode = GSBC_OP__GT;
+			break;
+		default:
+			/* '<>' operator is not a member of btree, but its negator is */
+			if (get_op_opfamily_strategy(get_negator(op->opno),
+										 tcache->btree_opf)
+				!= BTEqualStrategyNumber)
+				return false;
+			opcode = GSBC_OP__NE;
+			break;
+	}
+	if (!__gsbc_append_operand(gcxt, arg1) ||
+		!__gsbc_append_operand(gcxt, arg2))
+		return false;
+	return __gsbc_append_code(gcxt, opcode, 0, 0);
+}
+
+static bool
+__gsbc_append_expr(gsbc_context *gcxt, Node *node)
+{
+	ListCell   *lc;
+
+	if (IsA(node, OpExpr))
+		return __gsbc_append_opexpr(gcxt, (OpExpr *)node);
+	else if (IsA(node, BoolExpr))
+	{
+		BoolExpr   *b = (BoolExpr *)node;
+
+		foreach (lc, b->args)
+		{
+			if (!__gsbc_append_expr(gcxt, lfirst(lc)))
+				return false;
+		}
+		if (b->boolop == AND_EXPR)
+			return __gsbc_append_code(gcxt, GSBC_OP__AND, 0,
+									  list_length(b->args));
+		if (b->boolop == OR_EXPR)
+			return __gsbc_append_code(gcxt, GSBC_OP__OR, 0,
+									  list_length(b->args));
+		if (b->boolop == NOT_EXPR && list_length(b->args) == 1)
+			return __gsbc_append_code(gcxt, GSBC_OP__NOT, 0, 0);
+		return false;
+	}
+	else if (IsA(node, NullTest))
+	{
+		NullTest   *nt = (NullTest *)node;
+
+		if (nt->argisrow || !IsA(nt->arg, Var))
+			return false;
+		if (!__gsbc_append_operand(gcxt, (Node *)nt->arg))
+			return false;
+		return __gsbc_append_code(gcxt, (nt->nulltesttype == IS_NULL
+										 ? GSBC_OP__IS_NULL
+										 : GSBC_OP__IS_NOT_NULL), 0, 0);
+	}
+	else if (IsA(node, Var) && exprType(node) == BOOLOID)
+		return __gsbc_append_operand(gcxt, node);
+
+	return false;
+}
+
+static bool
+codegen_gpuscan_bytecode(StringInfo kern,
+						 codegen_context *context,
+						 Index scanrelid,
+						 List *dev_quals_list)
+{
+	gsbc_context gcxt;
+	Const	   *con;
+	bytea	   *code;
+
+	Assert(context->used_params == NIL);
+	if (dev_quals_list == NIL)
+		return false;
+
+	memset(&gcxt, 0, sizeof(gsbc_context));
+	gcxt.context = context;
+	gcxt.scanrelid = scanrelid;
+	initStringInfo(&gcxt.buf);
+	/* KPARAM_0 is reserved for the bytecode itself */
+	con = makeConst(BYTEAOID, -1, InvalidOid, -1,
+					(Datum) 0, true, false);
+	context->used_params = list_make1(con);
+	if (!__gsbc_append_expr(&gcxt, (Node *)
+							make_ands_explicit(dev_quals_list)) ||
+		gcxt.depth != 1)
+	{
+		pfree(gcxt.buf.data);
+		context->used_params = NIL;
+		return false;
+	}
+	code = palloc(VARHDRSZ + gcxt.buf.len);
+	SET_VARSIZE(code, VARHDRSZ + gcxt.buf.len);
+	memcpy(VARDATA(code), gcxt.buf.data, gcxt.buf.len);
+	con->constvalue = PointerGetDatum(code);
+	con->constisnull = false;
+	pfree(gcxt.buf.data);
+
+	appendStringInfoString(
+		kern,
+		"DEVICE_FUNCTION(cl_bool)\n"
+		"gpuscan_quals_eval(kern_context *kcxt,\n"
+		"                   kern_data_store *kds,\n"
+		"                   ItemPointerData *t_self,\n"
+		"                   HeapTupleHeaderData *htup)\n"
+		"{\n"
+		"  return gpuscan_bytecode_eval(kcxt, kds, htup);\n"
+		"}\n\n"
+		"DEVICE_FUNCTION(cl_bool)\n"
+		"gpuscan_quals_eval_arrow(kern_context *kcxt,\n"
+		"                         kern_data_store *kds,\n"
+		"                         cl_uint row_index)\n"
+		"{\n"
+		"  STROM_EREPORT(kcxt, ERRCODE_INTERNAL_ERROR,\n"
+		"                \"bytecode qualifiers on Apache Arrow\");\n"
+		"  return false;\n"
+		"}\n\n");
+	return true;
 }
 
 /*
@@ -1278,15 +1681,19 @@ PlanGpuScanPath(PlannerInfo *root,
 	List		   *host_quals = NIL;
 	List		   *dev_quals = NIL;
 	List		   *dev_costs = NIL;
+	List		   *temp_quals;
+	List		   *temp_costs;
 	List		   *index_quals = NIL;
 	List		   *tlist_dev = NIL;
 	List		   *outer_refs = NIL;
 	ListCell	   *cell;
+	ListCell	   *lc;
 	Bitmapset	   *varattnos = NULL;
 	cl_int			proj_tuple_sz = 0;
 	cl_int			proj_extra_sz = 0;
 	cl_int			qual_extra_sz = 0;
 	cl_int			i, j;
+	bool			bytecode_mode = false;
 	StringInfoData	kern;
 	codegen_context	context;
 
@@ -1322,8 +1729,21 @@ PlanGpuScanPath(PlannerInfo *root,
 	}
 	/* Reduce RestrictInfo list to bare expressions; ignore pseudoconstants */
 	host_quals = extract_actual_clauses(host_quals, false);
-	dev_quals = reorder_devqual_clauses(root, dev_quals, dev_costs);
-	dev_quals = extract_actual_clauses(dev_quals, false);
+	dev_quals = reorder_devqual_clauses(root, dev_quals, &dev_costs);
+	temp_quals = NIL;
+	temp_costs = NIL;
+	forboth (cell, dev_quals,
+			 lc, dev_costs)
+	{
+		RestrictInfo *rinfo = lfirst(cell);
+
+		if (rinfo->pseudoconstant)
+			continue;
+		temp_quals = lappend(temp_quals, rinfo->clause);
+		temp_costs = lappend_int(temp_costs, lfirst_int(lc));
+	}
+	dev_quals = temp_quals;
+	dev_costs = temp_costs;
 	index_quals = extract_actual_clauses(gs_info->index_quals, false);
 
 	/*
@@ -1336,6 +1756,32 @@ PlanGpuScanPath(PlannerInfo *root,
 	pgstrom_init_codegen_context(&context, root, baserel);
 	codegen_gpuscan_quals(&kern, &context, "gpuscan",
 						  baserel->relid, dev_quals);
+	/*
+	 * Unless the qualifier shape is planned frequently, we use the bytecode
+	 * evaluator on the precompiled library, instead of the JIT compiled code.
+	 * It allows to skip the expensive build of rarely used programs.
+	 */
+	if (gpuscan_bytecode_threshold > 0 &&
+		dev_quals != NIL &&
+		!baseRelIsArrowFdw(baserel) &&
+		!pgstrom_cuda_source_is_hot(kern.data, gpuscan_bytecode_threshold))
+	{
+		StringInfoData	bkern;
+		codegen_context	bcontext;
+
+		initStringInfo(&bkern);
+		pgstrom_init_codegen_context(&bcontext, root, baserel);
+		if (codegen_gpuscan_bytecode(&bkern, &bcontext,
+									 baserel->relid, dev_quals))
+		{
+			pfree(kern.data);
+			kern = bkern;
+			context = bcontext;
+			bytecode_mode = true;
+		}
+		else
+			pfree(bkern.data);
+	}
 	qual_extra_sz = context.varlena_bufsz;
 	tlist_dev = build_gpuscan_projection(root,
 										 baserel,
@@ -1361,6 +1807,7 @@ PlanGpuScanPath(PlannerInfo *root,
 							   tlist_dev,
 							   varattnos);
 	table_close(relation, NoLock);
+	pgstrom_codegen_user_functions(&kern, &context);
 
 	/* save the outer_refs for columnar optimization */
 	pull_varattnos((Node *)dev_quals, baserel->relid, &varattnos);
@@ -1394,7 +1841,17 @@ PlanGpuScanPath(PlannerInfo *root,
 	gs_info->outer_refs = outer_refs;
 	gs_info->used_params = context.used_params;
 	gs_info->dev_quals = dev_quals;
+	gs_info->dev_costs = dev_costs;
+	gs_info->tuple_bound = -1;
+	if (host_quals == NIL)
+	{
+		cl_long		tuple_bound = pgstrom_get_tuple_bound(root, baserel);
+
+		if (tuple_bound >= 0 && tuple_bound <= INT_MAX)
+			gs_info->tuple_bound = tuple_bound;
+	}
 	gs_info->index_quals = index_quals;
+	gs_info->bytecode_mode = bytecode_mode;
 	form_gpuscan_info(cscan, gs_info);
 
 	return &cscan->scan.plan;
@@ -1645,7 +2102,8 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	Assert(innerPlanState(node) == NULL);
 
 	/* setup GpuContext for CUDA kernel execution */
-	gcontext = AllocGpuContext(gs_info->optimal_gpu,
+	gcontext = AllocGpuContext(PickupGpuForRelationScan(scan_rel,
+														gs_info->optimal_gpu),
 							   false, false, false);
 	gss->gts.gcontext = gcontext;
 
@@ -1676,30 +2134,44 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 											  cscan->scan.scanrelid);
 	}
 
+	/*
+	 * @dev_quals for CPU fallback references raw tuples regardless of device
+	 * projection. So, it must be initialized to reference the raw tuples.
+	 */
+	dev_quals_raw = (List *)
+		fixup_varnode_to_origin((Node *)gs_info->dev_quals,
+								cscan->custom_scan_tlist);
+
 	/* setup common GpuTaskState fields */
 	pgstromInitGpuTaskState(&gss->gts,
 							gcontext,
 							GpuTaskKind_GpuScan,
+							dev_quals_raw,
 							gs_info->outer_refs,
 							gs_info->used_params,
 							gs_info->optimal_gpu,
 							gs_info->nrows_per_block,
 							estate);
+	/*
+	 * Bytecode evaluator does not support Apache Arrow format, so we never
+	 * load chunks from the columnar cache.
+	 */
+	if (gs_info->bytecode_mode)
+	{
+		pgstromExecEndColumnarCache(&gss->gts);
+		gss->gts.ccache_state = NULL;
+	}
 	gss->gts.cb_next_task   = gpuscan_next_task;
 	gss->gts.cb_next_tuple  = gpuscan_next_tuple;
 	gss->gts.cb_switch_task = gpuscan_switch_task;
 	gss->gts.cb_process_task = gpuscan_process_task;
+	gss->gts.cb_prefetch_task = gpuscan_prefetch_task;
 	gss->gts.cb_release_task = gpuscan_release_task;
+	gss->gts.cb_cpu_task = gpuscan_cpu_task;
+	gss->gts.cb_async_begin = gpuscan_async_begin;
+	gss->gts.hybrid_exec = enable_gpuscan_hybrid_exec;
 
-	/*
-	 * initialize device qualifiers/projection stuff, for CPU fallback
-	 *
-	 * @dev_quals for CPU fallback references raw tuples regardless of device
-	 * projection. So, it must be initialized to reference the raw tuples.
-	 */
-	dev_quals_raw = (List *)
-		fixup_varnode_to_origin((Node *)gs_info->dev_quals,
-								cscan->custom_scan_tlist);
+	/* initialize device qualifiers/projection stuff, for CPU fallback */
 	gss->dev_quals = ExecInitQual(dev_quals_raw, &gss->gts.css.ss.ps);
 
 	foreach (lc, cscan->custom_scan_tlist)
@@ -1711,9 +2183,39 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 		dev_tlist = lappend(dev_tlist, tle);
 	}
 
+	/*
+	 * Late materialization - if device projection consists of simple
+	 * column references only, GPU returns the index of qualified rows
+	 * on the row-format chunk, then CPU fetches the columns of the rows
+	 * survived only. It saves DMA of the projected tuples.
+	 */
+	if (gss->dev_projection && enable_gpuscan_late_materialize)
+	{
+		gss->late_materialize = true;
+		foreach (lc, dev_tlist)
+		{
+			TargetEntry	   *tle = lfirst(lc);
+
+			if ((!IsA(tle->expr, Var) ||
+				 ((Var *) tle->expr)->varattno <= 0) &&
+				!IsA(tle->expr, Const))
+			{
+				gss->late_materialize = false;
+				break;
+			}
+		}
+	}
 	/* device projection related resource consumption */
 	gss->proj_tuple_sz = gs_info->proj_tuple_sz;
 	gss->proj_extra_sz = gs_info->proj_extra_sz;
+	/* LIMIT clause pushdown, if any */
+	gss->gts.tuple_bound = gs_info->tuple_bound;
+	/* static cost of the device quals, for run-time reordering */
+	if (list_length(gs_info->dev_costs) <= GPUSCAN_MAX_REORDER_QUALS)
+	{
+		foreach (lc, gs_info->dev_costs)
+			gss->quals_cost[gss->num_quals++] = lfirst_int(lc);
+	}
 	/* 'tableoid' should not change during relation scan */
 	gss->scan_tuple.t_tableOid = RelationGetRelid(scan_rel);
 	/* initialize resource for CPU fallback */
@@ -1812,6 +2314,19 @@ ExecGpuScan(CustomScanState *node)
 					(ExecScanRecheckMtd) ExecReCheckGpuScan);
 }
 
+/*
+ * gpuscan_async_begin - setup GpuScan prior to ExecGpuScan for async Append
+ */
+static bool
+gpuscan_async_begin(GpuTaskState *gts)
+{
+	GpuScanState   *gss = (GpuScanState *) gts;
+
+	if (!gss->gs_sstate)
+		createGpuScanSharedState(gss, NULL, NULL);
+	return true;
+}
+
 /*
  * ExecEndGpuScan
  */
@@ -1879,8 +2394,7 @@ ExecGpuScanInitDSM(CustomScanState *node,
 	coordinate = ((char *)coordinate + gss->gs_sstate->ss_length);
 	if (gss->gts.outer_index_state)
 	{
-		gss->gts.outer_index_map = (Bitmapset *)coordinate;
-		gss->gts.outer_index_map->nwords = -1;	/* uninitialized */
+		pgstromInitBrinIndexMap(&gss->gts, coordinate);
 		coordinate = ((char *)coordinate +
 					  pgstromSizeOfBrinIndexMap(&gss->gts));
 	}
@@ -1906,7 +2420,7 @@ ExecGpuScanInitWorker(CustomScanState *node,
 				  MAXALIGN(sizeof(GpuScanSharedState)));
 	if (gss->gts.outer_index_state)
 	{
-		gss->gts.outer_index_map = (Bitmapset *)coordinate;
+		pgstromAttachBrinIndexMap(&gss->gts, coordinate);
 		coordinate = ((char *)coordinate +
 					  pgstromSizeOfBrinIndexMap(&gss->gts));
 	}
@@ -2055,6 +2569,51 @@ resetGpuScanSharedState(GpuScanState *gss)
 	/* do nothing */
 }
 
+/*
+ * gpuscan_setup_quals_order
+ *
+ * It determines the order of device qualifiers to be evaluated by the next
+ * chunk, based on the per-clause statistics of the former chunks.
+ * The expected cost to evaluate a series of independent clauses is minimized
+ * if they are sorted by cost / (1 - selectivity); so, expensive clauses run
+ * only on the rows survived by the cheap and selective ones.
+ * Until the statistics are collected, clauses are evaluated in the order
+ * determined by the planner.
+ */
+static void
+gpuscan_setup_quals_order(GpuScanState *gss, kern_gpuscan *kgpuscan)
+{
+	GpuScanRuntimeStat *gs_rtstat = gss->gs_rtstat;
+	double		rank[GPUSCAN_MAX_REORDER_QUALS];
+	int			i, j, k;
+
+	for (i=0; i < GPUSCAN_MAX_REORDER_QUALS; i++)
+		kgpuscan->quals_order[i] = i;
+	if (gss->num_quals <= 1 || !gs_rtstat)
+		return;
+	if (pg_atomic_read_u64(&gs_rtstat->c.source_nitems) == 0)
+		return;
+
+	for (i=0; i < gss->num_quals; i++)
+	{
+		double	nitems_in = pg_atomic_read_u64(&gs_rtstat->quals_nitems_in[i]);
+		double	nitems_out = pg_atomic_read_u64(&gs_rtstat->quals_nitems_out[i]);
+		double	selectivity;
+
+		/* Laplace smoothing; no samples means 50% selectivity */
+		selectivity = (nitems_out + 1.0) / (nitems_in + 2.0);
+		rank[i] = (double)Max(gss->quals_cost[i], 1) / (1.0 - selectivity);
+	}
+	/* insertion sort; keeps the planner's order on tie */
+	for (i=1; i < gss->num_quals; i++)
+	{
+		k = kgpuscan->quals_order[i];
+		for (j=i; j > 0 && rank[kgpuscan->quals_order[j-1]] > rank[k]; j--)
+			kgpuscan->quals_order[j] = kgpuscan->quals_order[j-1];
+		kgpuscan->quals_order[j] = k;
+	}
+}
+
 /*
  * gpuscan_create_task - constructor of GpuScanTask
  */
@@ -2077,7 +2636,8 @@ gpuscan_create_task(GpuScanState *gss,
 	/*
 	 * allocation of destination buffer
 	 */
-	if (pds_src->kds.format == KDS_FORMAT_ROW && !gss->dev_projection)
+	if (pds_src->kds.format == KDS_FORMAT_ROW &&
+		(!gss->dev_projection || gss->late_materialize))
 	{
 		nresults = pds_src->kds.nitems;
 		result_index_sz = offsetof(gpuscanResultIndex,
@@ -2132,6 +2692,7 @@ gpuscan_create_task(GpuScanState *gss,
 	gscan->pds_src = pds_src;
 	gscan->pds_dst = pds_dst;
 	gscan->kern.suspend_sz = suspend_sz;
+	gpuscan_setup_quals_order(gss, &gscan->kern);
 	/* kern_parambuf */
 	memcpy(KERN_GPUSCAN_PARAMBUF(&gscan->kern),
 		   gss->gts.kern_params,
@@ -2148,6 +2709,30 @@ gpuscan_switch_task(GpuTaskState *gts, GpuTask *gtask)
 	gss->fallback_local_id = 0;
 }
 
+/*
+ * gpuscan_cpu_task
+ *
+ * It marks the GpuTask to be processed by CPU using the fallback code, if
+ * the source chunk is already accessible on the host side.
+ */
+static bool
+gpuscan_cpu_task(GpuTaskState *gts, GpuTask *gtask)
+{
+	GpuScanTask	   *gscan = (GpuScanTask *) gtask;
+	pgstrom_data_store *pds_src = gscan->pds_src;
+
+	if (pds_src->kds.format == KDS_FORMAT_ROW ||
+		(pds_src->kds.format == KDS_FORMAT_BLOCK &&
+		 pds_src->nblocks_uncached == 0) ||
+		(pds_src->kds.format == KDS_FORMAT_ARROW &&
+		 pds_src->iovec == NULL))
+	{
+		gscan->task.cpu_fallback = true;
+		return true;
+	}
+	return false;
+}
+
 /*
  * gpuscan_next_task
  */
@@ -2397,8 +2982,21 @@ gpuscan_next_tuple(GpuTaskState *gts)
 											 kds_offset,
 											 &tuple->t_self,
 											 &tuple->t_len);
-			slot = gss->gts.css.ss.ss_ScanTupleSlot;
-			ExecStoreHeapTuple(tuple, slot, false);
+			if (!gss->late_materialize)
+			{
+				slot = gss->gts.css.ss.ss_ScanTupleSlot;
+				ExecStoreHeapTuple(tuple, slot, false);
+			}
+			else
+			{
+				ExprContext	   *econtext = gss->gts.css.ss.ps.ps_ExprContext;
+
+				/* projection on CPU, for the rows qualified by GPU */
+				ExecStoreHeapTuple(tuple, gss->base_slot, false);
+				ResetExprContext(econtext);
+				econtext->ecxt_scantuple = gss->base_slot;
+				slot = ExecProject(gss->base_proj);
+			}
 		}
 	}
 	return slot;
@@ -2450,6 +3048,49 @@ gpuscan_throw_partial_result(GpuScanTask *gscan, pgstrom_data_store *pds_dst)
 	SetLatch(MyLatch);
 }
 
+/*
+ * gpuscan_prefetch_task - kick host-to-device transfer of the next task on
+ * the @stream, while the current task is running. NVMe-Strom mode is not
+ * supported, because it needs device memory allocation prior to the DMA.
+ */
+static bool
+gpuscan_prefetch_task(GpuTask *gtask, CUstream stream)
+{
+	GpuScanTask	   *gscan = (GpuScanTask *) gtask;
+	pgstrom_data_store *pds_src = gscan->pds_src;
+	pgstrom_data_store *pds_dst = gscan->pds_dst;
+	CUresult		rc;
+
+	if (gscan->with_nvme_strom ||
+		pds_src->kds.format == KDS_FORMAT_BLOCK)
+		return false;
+
+	rc = cuMemPrefetchAsync((CUdeviceptr)&gscan->kern,
+							KERN_GPUSCAN_DMASEND_LENGTH(&gscan->kern),
+							CU_DEVICE_PER_THREAD,
+							stream);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	rc = cuMemPrefetchAsync((CUdeviceptr)&pds_src->kds,
+							pds_src->kds.length,
+							CU_DEVICE_PER_THREAD,
+							stream);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	if (pds_dst)
+	{
+		rc = cuMemPrefetchAsync((CUdeviceptr)&pds_dst->kds,
+								KERN_DATA_STORE_HEAD_LENGTH(&pds_dst->kds),
+								CU_DEVICE_PER_THREAD,
+								stream);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	}
+	return true;
+}
+
 /*
  * gpuscan_process_task
  */
@@ -2465,6 +3106,7 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	CUdeviceptr		m_kds_src = 0UL;
 	CUdeviceptr		m_kds_dst = (pds_dst ? (CUdeviceptr)&pds_dst->kds : 0UL);
 	bool			m_kds_src_release = false;
+	bool			prefetched;
 	const char	   *kern_fname;
 	void		   *kern_args[5];
 	void		   *last_suspend = NULL;
@@ -2477,7 +3119,11 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	size_t			extra_size;
 	CUresult		rc;
 	int				retval = 100001;
+	int				i;
 
+	pgstromNvtxRangePush("GpuScan (plan=%d, seq=%u)",
+						 gtask->gts->css.ss.ps.plan->plan_id,
+						 gtask->task_seq);
 	/*
 	 * Lookup GPU kernel functions
 	 */
@@ -2509,9 +3155,15 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	{
 		Assert(pds_src->kds.format == KDS_FORMAT_BLOCK ||
 			   pds_src->kds.format == KDS_FORMAT_ARROW);
-		rc = gpuMemAllocIOMap(gcontext,
-							  &m_kds_src,
-							  pds_src->kds.length);
+		/* columns on the GPU buffer don't need i/o mapped memory */
+		if (pds_src->kds.format == KDS_FORMAT_ARROW && pds_src->gpubuf_iov)
+			rc = gpuMemAlloc(gcontext,
+							 &m_kds_src,
+							 pds_src->kds.length);
+		else
+			rc = gpuMemAllocIOMap(gcontext,
+								  &m_kds_src,
+								  pds_src->kds.length);
 		if (rc == CUDA_SUCCESS)
 			m_kds_src_release = true;
 		else if (rc == CUDA_ERROR_OUT_OF_MEMORY)
@@ -2521,9 +3173,10 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 			{
 				PDS_fillup_blocks(pds_src);
 
-				rc = gpuMemAlloc(gcontext,
-								 &m_kds_src,
-								 pds_src->kds.length);
+				rc = gpuMemAllocAsync(gcontext,
+									  &m_kds_src,
+									  pds_src->kds.length,
+									  CU_STREAM_PER_THREAD);
 				if (rc == CUDA_SUCCESS)
 					m_kds_src_release = true;
 				else if (rc == CUDA_ERROR_OUT_OF_MEMORY)
@@ -2548,20 +3201,33 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	}
 
 	/*
-	 * OK, enqueue a series of requests
+	 * OK, enqueue a series of requests, unless H2D transfer is already
+	 * kicked during execution of the previous task.
 	 */
-	length = KERN_GPUSCAN_DMASEND_LENGTH(&gscan->kern);
-	rc = cuMemPrefetchAsync((CUdeviceptr)&gscan->kern,
-							length,
-							CU_DEVICE_PER_THREAD,
-							CU_STREAM_PER_THREAD);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	GpuWorkerStageBegin(&gscan->task);
+	prefetched = GpuWorkerWaitPrefetch(&gscan->task, CU_STREAM_PER_THREAD);
+	if (!prefetched)
+	{
+		length = KERN_GPUSCAN_DMASEND_LENGTH(&gscan->kern);
+		rc = cuMemPrefetchAsync((CUdeviceptr)&gscan->kern,
+								length,
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	}
 
 	/* kern_data_store *kds_src */
-	if (gscan->with_nvme_strom)
+	if (prefetched)
 	{
-		gpuMemCopyFromSSD(m_kds_src, pds_src);
+		/* already done by gpuscan_prefetch_task */
+	}
+	else if (gscan->with_nvme_strom)
+	{
+		if (pds_src->kds.format == KDS_FORMAT_ARROW && pds_src->gpubuf_iov)
+			gpuMemCopyFromGpuBuffer(m_kds_src, pds_src);
+		else
+			gpuMemCopyFromSSD(m_kds_src, pds_src);
 	}
 	else if (pds_src->kds.format == KDS_FORMAT_BLOCK)
 	{
@@ -2581,9 +3247,14 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 		if (rc != CUDA_SUCCESS)
 			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 	}
+	/* MVCC visibility checks on the raw blocks, if needed */
+	PDS_check_visibility(pds_src, m_kds_src, cuda_module);
+	if (!gscan->with_nvme_strom)
+		pgstromStatGpuTaskDMA(&gscan->task, CU_DINDEX_PER_THREAD,
+							  pds_src->kds.length, 0);
 
 	/* head of the kds_dst, if any */
-	if (pds_dst)
+	if (pds_dst && !prefetched)
 	{
 		length = KERN_DATA_STORE_HEAD_LENGTH(&pds_dst->kds);
 		rc = cuMemPrefetchAsync((CUdeviceptr)&pds_dst->kds,
@@ -2614,10 +3285,15 @@ resume_kernel:
 	gscan->kern.nitems_out = 0;
 	gscan->kern.extra_size = 0;
 	gscan->kern.suspend_count = 0;
+	memset(gscan->kern.quals_nitems_in, 0,
+		   sizeof(gscan->kern.quals_nitems_in));
+	memset(gscan->kern.quals_nitems_out, 0,
+		   sizeof(gscan->kern.quals_nitems_out));
 	kern_args[0] = &m_gpuscan;
 	kern_args[1] = &m_kds_src;
 	kern_args[2] = &m_kds_dst;
 
+	GpuWorkerStageLaunch(&gscan->task);
 	rc = cuLaunchKernel(kern_gpuscan_quals,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -2632,10 +3308,14 @@ resume_kernel:
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventRecord: %s", errorText(rc));
 
+	/* H2D of the next task, overlapped with this kernel */
+	GpuWorkerPrefetchNextTask();
+
 	/* Point of synchronization */
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	GpuWorkerStageKernel(&gscan->task, last_suspend != NULL);
 
 	/*
 	 * Check GPU kernel status and nitems/usage
@@ -2657,18 +3337,28 @@ resume_kernel:
 								nitems_in);
 		pg_atomic_add_fetch_u64(&gs_rtstat->c.nitems_filtered,
 								nitems_in - nitems_out);
+		pgstromAddGpuTaskResults(&gss->gts, nitems_out);
+		for (i=0; i < gss->num_quals; i++)
+		{
+			pg_atomic_add_fetch_u64(&gs_rtstat->quals_nitems_in[i],
+									gscan->kern.quals_nitems_in[i]);
+			pg_atomic_add_fetch_u64(&gs_rtstat->quals_nitems_out[i],
+									gscan->kern.quals_nitems_out[i]);
+		}
 		if (!pds_dst)
 		{
 			Assert(extra_size == 0);
 
+			length = offsetof(gpuscanResultIndex, results[nitems_out]);
 			rc = cuMemPrefetchAsync((CUdeviceptr)
 									KERN_GPUSCAN_RESULT_INDEX(&gscan->kern),
-									offsetof(gpuscanResultIndex,
-											 results[nitems_out]),
+									length,
 									CU_DEVICE_CPU,
-									CU_STREAM_PER_THREAD);
+									CU_STREAM_D2H_PER_THREAD);
 			if (rc != CUDA_SUCCESS)
 				werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+			pgstromStatGpuTaskDMA(&gscan->task, CU_DINDEX_PER_THREAD,
+								  0, length);
 		}
 		else if (nitems_out > 0)
 		{
@@ -2677,7 +3367,7 @@ resume_kernel:
 			rc = cuMemPrefetchAsync((CUdeviceptr)(&pds_dst->kds) + offset,
 									extra_size,
 									CU_DEVICE_CPU,
-									CU_STREAM_PER_THREAD);
+									CU_STREAM_D2H_PER_THREAD);
 			if (rc != CUDA_SUCCESS)
 				werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 
@@ -2685,10 +3375,14 @@ resume_kernel:
 			rc = cuMemPrefetchAsync((CUdeviceptr)(&pds_dst->kds),
 									length + sizeof(cl_uint) * nitems_out,
 									CU_DEVICE_CPU,
-									CU_STREAM_PER_THREAD);
+									CU_STREAM_D2H_PER_THREAD);
 			if (rc != CUDA_SUCCESS)
 				werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+			pgstromStatGpuTaskDMA(&gscan->task, CU_DINDEX_PER_THREAD, 0,
+								  extra_size + length +
+								  sizeof(cl_uint) * nitems_out);
 		}
+		GpuWorkerStageRecv(&gscan->task, CU_STREAM_D2H_PER_THREAD);
 
 		/* resume gpuscan kernel, if suspended */
 		if (gscan->kern.suspend_count > 0)
@@ -2759,6 +3453,7 @@ resume_kernel:
 out_of_resource:
 	if (m_kds_src_release)
 		gpuMemFree(gcontext, m_kds_src);
+	pgstromNvtxRangePop();
 	return retval;
 }
 
@@ -2802,6 +3497,47 @@ pgstrom_init_gpuscan(void)
 							 PGC_USERSET,
                              GUC_NOT_IN_SAMPLE,
                              NULL, NULL, NULL);
+	/* pg_strom.gpuscan_adaptive_quals */
+	DefineCustomBoolVariable("pg_strom.gpuscan_adaptive_quals",
+							 "Enables run-time reordering of GpuScan device quals",
+							 NULL,
+							 &enable_gpuscan_adaptive_quals,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* pg_strom.gpuscan_bytecode_threshold */
+	DefineCustomIntVariable("pg_strom.gpuscan_bytecode_threshold",
+							"Number of plannings of the same GpuScan qualifier to switch from the bytecode evaluator to JIT compiled code",
+							NULL,
+							&gpuscan_bytecode_threshold,
+							3,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	/* pg_strom.gpuscan_hybrid_exec */
+	DefineCustomBoolVariable("pg_strom.gpuscan_hybrid_exec",
+							 "Enables CPU to process chunks while GPU is busy",
+							 NULL,
+							 &enable_gpuscan_hybrid_exec,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* pg_strom.gpuscan_late_materialize */
+	DefineCustomBoolVariable("pg_strom.gpuscan_late_materialize",
+							 "Enables CPU to fetch columns of the rows qualified by GPU",
+							 NULL,
+							 &enable_gpuscan_late_materialize,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 
 	/* setup path methods */
 	memset(&gpuscan_path_methods, 0, sizeof(gpuscan_path_methods));
@@ -0,0 +1,4210 @@
+/*
+ * gpusort.c
+ *
+ * GPU accelerated sorting and window functions
+ * ----
+ * Copyright 2011-2020 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2020 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "pg_strom.h"
+#include "lib/binaryheap.h"
+#include "utils/sortsupport.h"
+#include "cuda_gpusort.h"
+
+static create_upper_paths_hook_type create_upper_paths_next;
+static CustomPathMethods	gpuwinagg_path_methods;
+static CustomScanMethods	gpuwinagg_scan_methods;
+static CustomExecMethods	gpuwinagg_exec_methods;
+static CustomPathMethods	gputopn_path_methods;
+static CustomScanMethods	gputopn_scan_methods;
+static CustomExecMethods	gputopn_exec_methods;
+static CustomPathMethods	gpusort_path_methods;
+static CustomScanMethods	gpusort_scan_methods;
+static CustomExecMethods	gpusort_exec_methods;
+static bool					enable_gpuwinagg;		/* GUC */
+static bool					enable_gputopn;			/* GUC */
+static bool					enable_gpusort;			/* GUC */
+static double				gpusort_threshold;		/* GUC */
+static int					gpuwinagg_max_chunk_size_kb;	/* GUC */
+
+/*
+ * form/deform interface of private field of CustomScan(GpuWindowAgg/GpuTopN/GpuSort)
+ */
+typedef struct {
+	cl_int		optimal_gpu;	/* optimal GPU selection, or -1 */
+	char	   *kern_source;	/* source of the CUDA kernel */
+	cl_uint		extra_flags;	/* extra libraries to be included */
+	cl_uint		varlena_bufsz;	/* buffer size of temporary varlena datum */
+	List	   *used_params;	/* referenced Const/Param */
+	cl_uint		num_input_cols;	/* # of columns come from the outer plan */
+	cl_uint		part_nkeys;		/* # of PARTITION BY keys */
+	cl_int		topn_nitems;	/* # of rows required by GpuTopN */
+	cl_bool		radix_sort;		/* all the keys are radix sortable */
+	List	   *key_anums;		/* attnum of the keys on the outer plan */
+	List	   *key_sortops;	/* sort operator of the keys */
+	List	   *key_collations;	/* collation of the keys */
+	List	   *key_nulls_first;/* NULLS FIRST, or not */
+	List	   *key_descending;	/* DESC, or not */
+	List	   *func_kinds;		/* GPUWINAGG_FUNC__* */
+	List	   *func_frames;	/* GPUWINAGG_FRAME__* */
+	List	   *func_argidx;	/* index of the argument, or -1 */
+	List	   *arg_exprs;		/* arguments; Var references the outer */
+} GpuSortInfo;
+
+static inline void
+form_gpusort_info(CustomScan *cscan, GpuSortInfo *gs_info)
+{
+	List	   *privs = NIL;
+	List	   *exprs = NIL;
+
+	privs = lappend(privs, makeInteger(gs_info->optimal_gpu));
+	privs = lappend(privs, makeString(gs_info->kern_source));
+	privs = lappend(privs, makeInteger(gs_info->extra_flags));
+	privs = lappend(privs, makeInteger(gs_info->varlena_bufsz));
+	exprs = lappend(exprs, gs_info->used_params);
+	privs = lappend(privs, makeInteger(gs_info->num_input_cols));
+	privs = lappend(privs, makeInteger(gs_info->part_nkeys));
+	privs = lappend(privs, makeInteger(gs_info->topn_nitems));
+	privs = lappend(privs, makeInteger(gs_info->radix_sort));
+	privs = lappend(privs, gs_info->key_anums);
+	privs = lappend(privs, gs_info->key_sortops);
+	privs = lappend(privs, gs_info->key_collations);
+	privs = lappend(privs, gs_info->key_nulls_first);
+	privs = lappend(privs, gs_info->key_descending);
+	privs = lappend(privs, gs_info->func_kinds);
+	privs = lappend(privs, gs_info->func_frames);
+	privs = lappend(privs, gs_info->func_argidx);
+	privs = lappend(privs, gs_info->arg_exprs);
+
+	cscan->custom_private = privs;
+	cscan->custom_exprs = exprs;
+}
+
+static inline GpuSortInfo *
+deform_gpusort_info(CustomScan *cscan)
+{
+	GpuSortInfo *gs_info = palloc0(sizeof(GpuSortInfo));
+	List	   *privs = cscan->custom_private;
+	List	   *exprs = cscan->custom_exprs;
+	int			pindex = 0;
+	int			eindex = 0;
+
+	gs_info->optimal_gpu = intVal(list_nth(privs, pindex++));
+	gs_info->kern_source = strVal(list_nth(privs, pindex++));
+	gs_info->extra_flags = intVal(list_nth(privs, pindex++));
+	gs_info->varlena_bufsz = intVal(list_nth(privs, pindex++));
+	gs_info->used_params = list_nth(exprs, eindex++);
+	gs_info->num_input_cols = intVal(list_nth(privs, pindex++));
+	gs_info->part_nkeys = intVal(list_nth(privs, pindex++));
+	gs_info->topn_nitems = intVal(list_nth(privs, pindex++));
+	gs_info->radix_sort = intVal(list_nth(privs, pindex++));
+	gs_info->key_anums = list_nth(privs, pindex++);
+	gs_info->key_sortops = list_nth(privs, pindex++);
+	gs_info->key_collations = list_nth(privs, pindex++);
+	gs_info->key_nulls_first = list_nth(privs, pindex++);
+	gs_info->key_descending = list_nth(privs, pindex++);
+	gs_info->func_kinds = list_nth(privs, pindex++);
+	gs_info->func_frames = list_nth(privs, pindex++);
+	gs_info->func_argidx = list_nth(privs, pindex++);
+	gs_info->arg_exprs = list_nth(privs, pindex++);
+
+	return gs_info;
+}
+
+/*
+ * GpuWinAggState - execution state object of GpuWindowAgg
+ */
+typedef struct {
+	GpuTaskState	gts;
+	bool			scan_done;		/* all the outer rows are loaded */
+	cl_uint			num_input_cols;
+	cl_uint			part_nkeys;
+	cl_uint			nkeys;
+	AttrNumber	   *key_anums;
+	Oid			   *key_sortops;
+	Oid			   *key_collations;
+	bool		   *key_nulls_first;
+	SortSupport		key_ssup;		/* for CPU fallback */
+	cl_uint			nfuncs;
+	cl_char		   *func_kinds;
+	cl_char		   *func_frames;
+	cl_short	   *func_argidx;
+	Oid			   *func_types;		/* result type of window functions */
+	cl_uint			nargs;
+	Oid			   *arg_types;
+	ExprState	  **arg_states;		/* for CPU fallback */
+	TupleTableSlot *outer_slot;		/* slot to fetch the outer rows */
+	HeapTupleData	outer_tuple;	/* buffer to fetch the outer rows */
+	/*
+	 * CPU path; if the outer rows cannot be loaded onto a single chunk,
+	 * they are sorted by tuplesort, then window functions are computed
+	 * for each partition kept in the tuplestore.
+	 */
+	Tuplesortstate *cpu_sortstate;	/* NULL, if no sort keys */
+	Tuplestorestate *cpu_tupstore;	/* rows of the current partition */
+	int				cpu_peer_ptr;	/* read pointer to look ahead peers */
+	bool			cpu_part_loaded;
+	bool			cpu_peer_peeked;/* cpu_peer_slot is head of next peers */
+	TupleTableSlot *cpu_next_slot;	/* head of the next partition */
+	TupleTableSlot *cpu_head_slot;	/* head of the current partition/peers */
+	TupleTableSlot *cpu_peer_slot;	/* row fetched by the look-ahead */
+	TupleTableSlot *cpu_curr_slot;	/* row to be returned */
+	cl_uint			cpu_peer_nrows;	/* # of rows not returned in peers */
+	cl_ulong		cpu_row_number;
+	cl_ulong		cpu_rank;
+	cl_ulong		cpu_dense_rank;
+	struct gpuwinagg_cpu_accum *cpu_row_accum;	/* ROWS running frame */
+	struct gpuwinagg_cpu_accum *cpu_peer_accum;	/* RANGE running frame */
+	struct gpuwinagg_cpu_accum *cpu_part_accum;	/* entire partition */
+} GpuWinAggState;
+
+/*
+ * gpuwinagg_cpu_accum - an aggregation state of the CPU path
+ */
+typedef struct gpuwinagg_cpu_accum {
+	cl_ulong		value;
+	cl_ulong		count;
+} gpuwinagg_cpu_accum;
+
+/*
+ * GpuWinAggTask - a task object of GpuWindowAgg; it sorts the entire
+ * outer rows at once, then computes the window functions.
+ */
+typedef struct {
+	GpuTask			task;
+	pgstrom_data_store *pds_src;	/* all the outer rows */
+	kern_gpuwinagg *kgwagg;			/* lanes and results */
+	size_t			kgwagg_length;
+	kern_gpusort	kern;
+} GpuWinAggTask;
+
+/*
+ * GpuSortState - execution state object of GpuTopN and GpuSort
+ *
+ * Both of them sort the outer rows chunk by chunk. GpuTopN gathers the
+ * top-k rows of the chunks as candidates, then sorts them again at last.
+ * GpuSort keeps all the sorted chunks, then merges them on CPU.
+ */
+typedef struct {
+	GpuTaskState	gts;
+	cl_uint			num_input_cols;
+	cl_uint			topn_nitems;	/* k of ORDER BY ... LIMIT k, or 0 */
+	cl_uint			nkeys;
+	AttrNumber	   *key_anums;
+	SortSupport		key_ssup;		/* for CPU fallback and merge */
+	bool			radix_sort;
+	TupleTableSlot *outer_slot;		/* slot to fetch the outer rows */
+	HeapTupleData	outer_tuple;	/* buffer to fetch the outer rows */
+	bool			terminator_done;
+	/* GpuTopN */
+	pgstrom_data_store *pds_merge;	/* top-k candidates of the chunks */
+	/* GpuSort */
+	struct GpuSortTask **sorted_tasks;	/* already sorted chunks */
+	cl_uint			num_sorted_tasks;
+	cl_uint			max_sorted_tasks;
+	struct gpusort_merge_cursor *merge_cursors;
+	binaryheap	   *merge_heap;		/* k-way merge of the sorted chunks */
+} GpuSortState;
+
+/*
+ * GpuSortTask - a task object of GpuTopN and GpuSort; it sorts a chunk of
+ * the outer rows, or the candidates of GpuTopN if is_terminator. Terminator
+ * of GpuSort has no data store, and merges the sorted chunks on CPU.
+ */
+typedef struct GpuSortTask {
+	GpuTask			task;
+	pgstrom_data_store *pds_src;
+	cl_uint			topn_nitems;
+	bool			is_terminator;
+	kern_gpusort_radix *kradix;		/* working buffer of the radix sort */
+	kern_gpusort	kern;
+} GpuSortTask;
+
+/*
+ * gpusort_merge_cursor - current position of the sorted chunk
+ */
+typedef struct gpusort_merge_cursor {
+	GpuSortTask	   *gstask;
+	cl_uint			index;
+	cl_uint			nitems;
+	Datum		   *key_values;
+	bool		   *key_isnull;
+} gpusort_merge_cursor;
+
+/*
+ * static functions
+ */
+static GpuTask  *gpuwinagg_next_task(GpuTaskState *gts);
+static TupleTableSlot *gpuwinagg_next_tuple(GpuTaskState *gts);
+static int gpuwinagg_process_task(GpuTask *gtask, CUmodule cuda_module);
+static void gpuwinagg_release_task(GpuTask *gtask);
+static TupleTableSlot *gpuwinagg_cpu_next_tuple(GpuWinAggState *gwas);
+static void gpuwinagg_cpu_cleanup(GpuWinAggState *gwas);
+static GpuTask  *gpusort_next_task(GpuTaskState *gts);
+static GpuTask  *gpusort_terminator_task(GpuTaskState *gts,
+										 cl_bool *task_is_ready);
+static TupleTableSlot *gpusort_next_tuple(GpuTaskState *gts);
+static int gpusort_process_task(GpuTask *gtask, CUmodule cuda_module);
+static void gpusort_release_task(GpuTask *gtask);
+
+/*
+ * gpuwinagg_function_kind
+ *
+ * It checks whether the window function is supported by GpuWindowAgg.
+ * Built-in ranking functions, and count/sum/min/max on the fixed-length
+ * integer or floating-point values are supported right now.
+ */
+static int
+gpuwinagg_function_kind(WindowFunc *wfunc)
+{
+	HeapTuple		tup;
+	Form_pg_proc	proc;
+	const char	   *proname;
+	Oid				argtype = InvalidOid;
+	int				kind = 0;
+
+	if (wfunc->aggfilter != NULL)
+		return 0;
+	tup = SearchSysCache1(PROCOID, ObjectIdGetDatum(wfunc->winfnoid));
+	if (!HeapTupleIsValid(tup))
+		elog(ERROR, "cache lookup failed for function %u", wfunc->winfnoid);
+	proc = (Form_pg_proc) GETSTRUCT(tup);
+	proname = NameStr(proc->proname);
+	if (proc->pronamespace != PG_CATALOG_NAMESPACE ||
+		proc->pronargs != list_length(wfunc->args))
+		goto out;
+	if (proc->pronargs == 1)
+		argtype = proc->proargtypes.values[0];
+	else if (proc->pronargs > 1)
+		goto out;
+
+	if (!wfunc->winagg)
+	{
+		if (proc->pronargs != 0)
+			goto out;
+		if (strcmp(proname, "row_number") == 0)
+			kind = GPUWINAGG_FUNC__ROW_NUMBER;
+		else if (strcmp(proname, "rank") == 0)
+			kind = GPUWINAGG_FUNC__RANK;
+		else if (strcmp(proname, "dense_rank") == 0)
+			kind = GPUWINAGG_FUNC__DENSE_RANK;
+	}
+	else if (strcmp(proname, "count") == 0)
+	{
+		kind = GPUWINAGG_FUNC__COUNT;
+	}
+	else if (strcmp(proname, "sum") == 0)
+	{
+		if (argtype == INT2OID || argtype == INT4OID)
+			kind = GPUWINAGG_FUNC__SUM_INT;
+		else if (argtype == FLOAT4OID || argtype == FLOAT8OID)
+			kind = GPUWINAGG_FUNC__SUM_FP;
+	}
+	else if (strcmp(proname, "min") == 0 ||
+			 strcmp(proname, "max") == 0)
+	{
+		bool	is_min = (strcmp(proname, "min") == 0);
+
+		if (argtype == INT2OID || argtype == INT4OID || argtype == INT8OID)
+			kind = (is_min
+					? GPUWINAGG_FUNC__MIN_INT
+					: GPUWINAGG_FUNC__MAX_INT);
+		else if (argtype == FLOAT4OID || argtype == FLOAT8OID)
+			kind = (is_min
+					? GPUWINAGG_FUNC__MIN_FP
+					: GPUWINAGG_FUNC__MAX_FP);
+	}
+out:
+	ReleaseSysCache(tup);
+	return kind;
+}
+
+/*
+ * gpuwinagg_frame_kind
+ *
+ * It checks whether the window frame is supported by GpuWindowAgg.
+ * Frame has to start at UNBOUNDED PRECEDING, and has to end at either
+ * CURRENT ROW or UNBOUNDED FOLLOWING, without any exclusion.
+ */
+static int
+gpuwinagg_frame_kind(WindowClause *wc)
+{
+	int		options = wc->frameOptions;
+	int		allowed = (FRAMEOPTION_NONDEFAULT |
+					   FRAMEOPTION_RANGE |
+					   FRAMEOPTION_ROWS |
+#ifdef FRAMEOPTION_GROUPS
+					   FRAMEOPTION_GROUPS |
+#endif
+					   FRAMEOPTION_BETWEEN |
+					   FRAMEOPTION_START_UNBOUNDED_PRECEDING |
+					   FRAMEOPTION_END_CURRENT_ROW |
+					   FRAMEOPTION_END_UNBOUNDED_FOLLOWING);
+
+	if ((options & ~allowed) != 0 ||
+		(options & FRAMEOPTION_START_UNBOUNDED_PRECEDING) == 0)
+		return 0;
+	if ((options & FRAMEOPTION_END_UNBOUNDED_FOLLOWING) != 0)
+		return GPUWINAGG_FRAME__PARTITION;
+	if ((options & FRAMEOPTION_END_CURRENT_ROW) != 0)
+	{
+		if ((options & FRAMEOPTION_ROWS) != 0)
+			return GPUWINAGG_FRAME__ROWS_RUNNING;
+		return GPUWINAGG_FRAME__PEER_RUNNING;
+	}
+	return 0;
+}
+
+/*
+ * gather_window_functions
+ */
+static bool
+gather_window_functions(Node *node, List **p_wfuncs)
+{
+	if (!node)
+		return false;
+	if (IsA(node, WindowFunc))
+	{
+		*p_wfuncs = list_append_unique(*p_wfuncs, node);
+		return false;
+	}
+	return expression_tree_walker(node, gather_window_functions,
+								  (void *)p_wfuncs);
+}
+
+/*
+ * replace_expression_by_outerref
+ *
+ * It replaces the sub-expressions that appear on the input target by
+ * Var-node with INDEX_VAR. Window function arguments are computed on
+ * the outer tuple, on both of GPU and CPU fallback.
+ */
+static Node *
+replace_expression_by_outerref(Node *node, PathTarget *target_input)
+{
+	ListCell   *lc;
+	cl_int		resno = 1;
+
+	if (!node)
+		return NULL;
+	foreach (lc, target_input->exprs)
+	{
+		if (equal(node, lfirst(lc)))
+			return (Node *) makeVar(INDEX_VAR,
+									resno,
+									exprType(node),
+									exprTypmod(node),
+									exprCollation(node),
+									0);
+		resno++;
+	}
+	if (IsA(node, Var))
+		elog(ERROR, "Bug? Var-node didn'd appear on the input targetlist: %s",
+			 nodeToString(node));
+
+	return expression_tree_mutator(node,
+								   replace_expression_by_outerref,
+								   target_input);
+}
+
+/*
+ * gpusort_setup_sortkey
+ *
+ * It looks up the sort key on the input target, and checks whether GPU
+ * can compare the key values.
+ */
+static bool
+gpusort_setup_sortkey(PlannerInfo *root,
+					  PathTarget *target_input,
+					  SortGroupClause *sgc,
+					  GpuSortInfo *gs_info)
+{
+	Node		   *sortexpr = NULL;
+	Oid				type_oid;
+	Oid				coll_oid;
+	devtype_info   *dtype;
+	TypeCacheEntry *tcache;
+	bool			descending;
+	ListCell	   *lc;
+	int				i = 0;
+
+	/* lookup the key on the input target */
+	foreach (lc, target_input->exprs)
+	{
+		if (get_pathtarget_sortgroupref(target_input, i) ==
+			sgc->tleSortGroupRef)
+			break;
+		i++;
+	}
+	if (!lc)
+	{
+		sortexpr = get_sortgroupclause_expr(sgc, root->parse->targetList);
+		i = 0;
+		foreach (lc, target_input->exprs)
+		{
+			if (equal(sortexpr, lfirst(lc)))
+				break;
+			i++;
+		}
+		if (!lc)
+			return false;
+	}
+	sortexpr = lfirst(lc);
+
+	/* only default ordering of the data type is supported */
+	type_oid = exprType(sortexpr);
+	coll_oid = exprCollation(sortexpr);
+	tcache = lookup_type_cache(type_oid,
+							   TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
+	if (sgc->sortop == tcache->lt_opr)
+		descending = false;
+	else if (sgc->sortop == tcache->gt_opr)
+		descending = true;
+	else
+		return false;
+	dtype = pgstrom_devtype_lookup(type_oid);
+	if (!dtype || !pgstrom_devfunc_lookup_type_compare(dtype, coll_oid))
+		return false;
+
+	gs_info->key_anums = lappend_int(gs_info->key_anums, i + 1);
+	gs_info->key_sortops = lappend_oid(gs_info->key_sortops, sgc->sortop);
+	gs_info->key_collations = lappend_oid(gs_info->key_collations,
+										   coll_oid);
+	gs_info->key_nulls_first = lappend_int(gs_info->key_nulls_first,
+											sgc->nulls_first);
+	gs_info->key_descending = lappend_int(gs_info->key_descending,
+										   descending);
+	return true;
+}
+
+/*
+ * gpusort_radix_sortable
+ *
+ * It checks whether all the sort keys are fixed-length types that can
+ * be translated to the radix key.
+ */
+static bool
+gpusort_radix_sortable(PathTarget *target_input, GpuSortInfo *gs_info)
+{
+	ListCell   *lc;
+
+	foreach (lc, gs_info->key_anums)
+	{
+		Node   *sortexpr = list_nth(target_input->exprs, lfirst_int(lc) - 1);
+
+		switch (exprType(sortexpr))
+		{
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+			case FLOAT4OID:
+			case FLOAT8OID:
+			case DATEOID:
+			case TIMEOID:
+			case TIMESTAMPOID:
+			case TIMESTAMPTZOID:
+				break;
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * create_gpuwinagg_path
+ */
+static CustomPath *
+create_gpuwinagg_path(PlannerInfo *root,
+					  RelOptInfo *window_rel,
+					  Path *input_path)
+{
+	PathTarget	   *target_input = input_path->pathtarget;
+	PathTarget	   *target_final = window_rel->reltarget;
+	GpuSortInfo	   *gs_info;
+	CustomPath	   *cpath;
+	WindowClause   *wc = NULL;
+	List		   *wfuncs = NIL;
+	List		   *sortclauses;
+	Index			winref = 0;
+	int				frame;
+	int				nkeys;
+	int				nfuncs;
+	int				nlanes;
+	double			ntuples = Max(input_path->rows, 1.0);
+	double			log2n = Max(log2(ntuples), 1.0);
+	Cost			startup_cost;
+	Cost			run_cost;
+	ListCell	   *lc;
+
+	/* GpuWindowAgg supports only a single window clause */
+	gather_window_functions((Node *)target_final->exprs, &wfuncs);
+	if (wfuncs == NIL)
+		return NULL;
+	foreach (lc, wfuncs)
+	{
+		WindowFunc *wfunc = lfirst(lc);
+
+		if (winref == 0)
+			winref = wfunc->winref;
+		else if (winref != wfunc->winref)
+			return NULL;
+	}
+	foreach (lc, root->parse->windowClause)
+	{
+		WindowClause   *temp = lfirst(lc);
+
+		if (temp->winref == winref)
+		{
+			wc = temp;
+			break;
+		}
+	}
+	if (!wc)
+		return NULL;
+	frame = gpuwinagg_frame_kind(wc);
+	if (frame == 0)
+		return NULL;
+
+	gs_info = palloc0(sizeof(GpuSortInfo));
+	gs_info->optimal_gpu = -1;
+	gs_info->num_input_cols = list_length(target_input->exprs);
+	gs_info->part_nkeys = list_length(wc->partitionClause);
+
+	/* PARTITION BY and ORDER BY keys */
+	foreach (lc, wc->partitionClause)
+	{
+		if (!gpusort_setup_sortkey(root, target_input,
+								   lfirst(lc), gs_info))
+			return NULL;
+	}
+	foreach (lc, wc->orderClause)
+	{
+		if (!gpusort_setup_sortkey(root, target_input,
+								   lfirst(lc), gs_info))
+			return NULL;
+	}
+	nkeys = list_length(gs_info->key_anums);
+
+	/* window functions and arguments */
+	foreach (lc, wfuncs)
+	{
+		WindowFunc *wfunc = lfirst(lc);
+		int			kind = gpuwinagg_function_kind(wfunc);
+		int			argidx = -1;
+
+		if (kind == 0)
+			return NULL;
+		if (wfunc->args != NIL)
+		{
+			Node	   *arg = linitial(wfunc->args);
+			ListCell   *cell;
+
+			arg = replace_expression_by_outerref(arg, target_input);
+			if (!pgstrom_device_expression(root, NULL, (Expr *)arg))
+				return NULL;
+			argidx = 0;
+			foreach (cell, gs_info->arg_exprs)
+			{
+				if (equal(arg, lfirst(cell)))
+					break;
+				argidx++;
+			}
+			if (!cell)
+			{
+				if (argidx >= GPUWINAGG_MAX_NARGS)
+					return NULL;
+				gs_info->arg_exprs = lappend(gs_info->arg_exprs, arg);
+			}
+		}
+		gs_info->func_kinds = lappend_int(gs_info->func_kinds, kind);
+		gs_info->func_frames = lappend_int(gs_info->func_frames, frame);
+		gs_info->func_argidx = lappend_int(gs_info->func_argidx, argidx);
+	}
+	nfuncs = list_length(wfuncs);
+	nlanes = GPUWINAGG_NUM_FIXED_LANES + 2 * nfuncs;
+
+	/* all the outer rows must be loaded onto a single chunk */
+	if ((double)target_input->width * ntuples >= (double)KDS_OFFSET_MAX_SIZE ||
+		ntuples >= (double)(UINT_MAX / 2))
+		return NULL;
+
+	/*
+	 * Cost estimation
+	 *
+	 * Bitonic sorting takes O(N * log2(N)^2) comparisons, and Hillis-Steele
+	 * scan takes O(N * log2(N)) operations for each lane.
+	 */
+	startup_cost = input_path->total_cost + pgstrom_gpu_setup_cost;
+	startup_cost += pgstrom_gpu_dma_cost *
+		((double)target_input->width * ntuples /
+		 (double)pgstrom_chunk_size());
+	startup_cost += pgstrom_gpu_operator_cost *
+		(double)Max(nkeys, 1) * ntuples * log2n * log2n / 2.0;
+	startup_cost += pgstrom_gpu_operator_cost *
+		(double)nlanes * ntuples * 2.0 * log2n;
+	run_cost = (cpu_tuple_cost +
+				cpu_operator_cost * (double)nfuncs) * ntuples;
+
+	/* Setup CustomPath */
+	cpath = makeNode(CustomPath);
+	cpath->path.pathtype = T_CustomScan;
+	cpath->path.parent = window_rel;
+	cpath->path.pathtarget = target_final;
+	cpath->path.param_info = NULL;
+	cpath->path.parallel_aware = false;
+	cpath->path.parallel_safe = (window_rel->consider_parallel &&
+								 input_path->parallel_safe);
+	cpath->path.parallel_workers = 0;
+	cpath->path.rows = input_path->rows;
+	cpath->path.startup_cost = startup_cost;
+	cpath->path.total_cost = startup_cost + run_cost;
+	/* output is sorted by PARTITION BY + ORDER BY keys */
+	sortclauses = list_concat(list_copy(wc->partitionClause),
+							  list_copy(wc->orderClause));
+	cpath->path.pathkeys = make_pathkeys_for_sortclauses(root,
+														 sortclauses,
+														 root->parse->targetList);
+	cpath->flags = 0;
+	cpath->custom_paths = list_make1(input_path);
+	cpath->custom_private = list_make2(gs_info, wfuncs);
+	cpath->methods = &gpuwinagg_path_methods;
+
+	return cpath;
+}
+
+/*
+ * create_gputopn_path
+ *
+ * GpuTopN sorts every chunk of the outer rows on GPU, then picks up the
+ * top-k rows only. The candidate rows of all the chunks are sorted again,
+ * and the first k rows are returned in order.
+ */
+static CustomPath *
+create_gputopn_path(PlannerInfo *root,
+					RelOptInfo *ordered_rel,
+					Path *input_path)
+{
+	Query		   *parse = root->parse;
+	PathTarget	   *target_input = input_path->pathtarget;
+	GpuSortInfo	   *gs_info;
+	CustomPath	   *cpath;
+	double			ntuples = Max(input_path->rows, 1.0);
+	double			nchunks;
+	double			chunk_nrows;
+	double			merge_nrows;
+	double			log2n;
+	double			log2m;
+	int				nkeys;
+	Cost			startup_cost;
+	Cost			run_cost;
+	ListCell	   *lc;
+
+	/* ORDER BY ... LIMIT with constant values */
+	if (!parse->sortClause ||
+		parse->rowMarks != NIL ||
+		parse->hasTargetSRFs ||
+		root->limit_tuples < 1.0)
+		return NULL;
+	/* top-k rows must be much smaller than a chunk */
+	if (root->limit_tuples >= (double)(INT_MAX / 2) ||
+		root->limit_tuples * (double)Max(target_input->width, 1) >=
+		(double)pgstrom_chunk_size() / 4.0)
+		return NULL;
+	/* no benefit if LIMIT is larger than the outer rows */
+	if (root->limit_tuples >= ntuples)
+		return NULL;
+
+	gs_info = palloc0(sizeof(GpuSortInfo));
+	gs_info->optimal_gpu = -1;
+	gs_info->num_input_cols = list_length(target_input->exprs);
+	gs_info->part_nkeys = 0;
+	gs_info->topn_nitems = (cl_int)root->limit_tuples;
+	foreach (lc, parse->sortClause)
+	{
+		if (!gpusort_setup_sortkey(root, target_input,
+								   lfirst(lc), gs_info))
+			return NULL;
+	}
+	nkeys = list_length(gs_info->key_anums);
+	gs_info->radix_sort = gpusort_radix_sortable(target_input, gs_info);
+
+	/*
+	 * Cost estimation
+	 *
+	 * Every chunk is sorted by bitonic sorting, and the top-k rows of the
+	 * chunks are sorted again at the end.
+	 */
+	nchunks = ceil((double)Max(target_input->width, 1) * ntuples /
+				   (double)pgstrom_chunk_size());
+	nchunks = Max(nchunks, 1.0);
+	chunk_nrows = ntuples / nchunks;
+	merge_nrows = Min(nchunks * root->limit_tuples, ntuples);
+	log2n = Max(log2(chunk_nrows), 1.0);
+	log2m = Max(log2(merge_nrows), 1.0);
+
+	startup_cost = input_path->total_cost + pgstrom_gpu_setup_cost;
+	startup_cost += pgstrom_gpu_dma_cost * (nchunks + 1.0);
+	startup_cost += pgstrom_gpu_operator_cost *
+		(double)nkeys * ntuples * log2n * log2n / 2.0;
+	startup_cost += cpu_tuple_cost * merge_nrows;
+	startup_cost += pgstrom_gpu_operator_cost *
+		(double)nkeys * merge_nrows * log2m * log2m / 2.0;
+	run_cost = cpu_tuple_cost * root->limit_tuples;
+
+	/* Setup CustomPath */
+	cpath = makeNode(CustomPath);
+	cpath->path.pathtype = T_CustomScan;
+	cpath->path.parent = ordered_rel;
+	cpath->path.pathtarget = target_input;
+	cpath->path.param_info = NULL;
+	cpath->path.parallel_aware = false;
+	cpath->path.parallel_safe = false;
+	cpath->path.parallel_workers = 0;
+	cpath->path.rows = root->limit_tuples;
+	cpath->path.startup_cost = startup_cost;
+	cpath->path.total_cost = startup_cost + run_cost;
+	cpath->path.pathkeys = root->sort_pathkeys;
+	cpath->flags = 0;
+	cpath->custom_paths = list_make1(input_path);
+	cpath->custom_private = list_make1(gs_info);
+	cpath->methods = &gputopn_path_methods;
+
+	return cpath;
+}
+
+/*
+ * create_gpusort_path
+ *
+ * GpuSort sorts every chunk of the outer rows on GPU, then the sorted
+ * chunks are merged on CPU. It is used for ORDER BY, and for GROUP BY
+ * by the sorted aggregation.
+ */
+static CustomPath *
+create_gpusort_path(PlannerInfo *root,
+					RelOptInfo *upper_rel,
+					Path *input_path,
+					List *sortclauses,
+					List *pathkeys)
+{
+	PathTarget	   *target_input = input_path->pathtarget;
+	GpuSortInfo	   *gs_info;
+	CustomPath	   *cpath;
+	double			ntuples = Max(input_path->rows, 1.0);
+	double			nchunks;
+	double			chunk_nrows;
+	double			log2n;
+	int				nkeys;
+	Cost			startup_cost;
+	Cost			run_cost;
+	ListCell	   *lc;
+
+	if (!sortclauses || !pathkeys)
+		return NULL;
+	/* no benefit for the small outer relation */
+	if (ntuples < gpusort_threshold)
+		return NULL;
+
+	gs_info = palloc0(sizeof(GpuSortInfo));
+	gs_info->optimal_gpu = -1;
+	gs_info->num_input_cols = list_length(target_input->exprs);
+	gs_info->part_nkeys = 0;
+	gs_info->topn_nitems = 0;
+	foreach (lc, sortclauses)
+	{
+		if (!gpusort_setup_sortkey(root, target_input,
+								   lfirst(lc), gs_info))
+			return NULL;
+	}
+	nkeys = list_length(gs_info->key_anums);
+	gs_info->radix_sort = gpusort_radix_sortable(target_input, gs_info);
+
+	/*
+	 * Cost estimation
+	 *
+	 * Every chunk is sorted by bitonic sorting, or radix sorting that
+	 * takes O(N) operations for each pass. Then, the sorted chunks are
+	 * merged by comparison of O(N * log2(nchunks)).
+	 */
+	nchunks = ceil((double)Max(target_input->width, 1) * ntuples /
+				   (double)pgstrom_chunk_size());
+	nchunks = Max(nchunks, 1.0);
+	chunk_nrows = ntuples / nchunks;
+	log2n = Max(log2(chunk_nrows), 1.0);
+
+	startup_cost = input_path->total_cost + pgstrom_gpu_setup_cost;
+	startup_cost += pgstrom_gpu_dma_cost * nchunks;
+	if (gs_info->radix_sort)
+		startup_cost += pgstrom_gpu_operator_cost *
+			(double)(nkeys * GPUSORT_RADIX_NPASSES) * ntuples * 3.0;
+	else
+		startup_cost += pgstrom_gpu_operator_cost *
+			(double)nkeys * ntuples * log2n * log2n / 2.0;
+	run_cost = (cpu_tuple_cost +
+				2.0 * cpu_operator_cost * (double)nkeys *
+				Max(log2(nchunks), 1.0)) * ntuples;
+
+	/* Setup CustomPath */
+	cpath = makeNode(CustomPath);
+	cpath->path.pathtype = T_CustomScan;
+	cpath->path.parent = upper_rel;
+	cpath->path.pathtarget = target_input;
+	cpath->path.param_info = NULL;
+	cpath->path.parallel_aware = false;
+	cpath->path.parallel_safe = false;
+	cpath->path.parallel_workers = 0;
+	cpath->path.rows = input_path->rows;
+	cpath->path.startup_cost = startup_cost;
+	cpath->path.total_cost = startup_cost + run_cost;
+	cpath->path.pathkeys = pathkeys;
+	cpath->flags = 0;
+	cpath->custom_paths = list_make1(input_path);
+	cpath->custom_private = list_make1(gs_info);
+	cpath->methods = &gpusort_path_methods;
+
+	return cpath;
+}
+
+/*
+ * try_add_gpusort_grouping_path
+ *
+ * It adds Agg(sorted) on the GpuSort.
+ */
+static void
+try_add_gpusort_grouping_path(PlannerInfo *root,
+							  RelOptInfo *group_rel,
+							  Path *input_path)
+{
+	Query		   *parse = root->parse;
+	PathTarget	   *target_upper = group_rel->reltarget;
+	CustomPath	   *cpath;
+	Path		   *path;
+	AggClauseCosts	agg_final_costs;
+	double			num_groups;
+
+	if (!parse->groupClause ||
+		parse->groupingSets ||
+		!grouping_is_sortable(parse->groupClause) ||
+		group_rel->pathlist == NIL)
+		return;
+	num_groups = Max(((Path *)linitial(group_rel->pathlist))->rows, 1.0);
+
+	cpath = create_gpusort_path(root, group_rel, input_path,
+								parse->groupClause,
+								root->group_pathkeys);
+	if (!cpath)
+		return;
+
+	memset(&agg_final_costs, 0, sizeof(AggClauseCosts));
+	if (parse->hasAggs)
+	{
+		get_agg_clause_costs(root, (Node *)target_upper->exprs,
+							 AGGSPLIT_SIMPLE, &agg_final_costs);
+		get_agg_clause_costs(root, parse->havingQual,
+							 AGGSPLIT_SIMPLE, &agg_final_costs);
+	}
+	path = (Path *) create_agg_path(root,
+									group_rel,
+									&cpath->path,
+									target_upper,
+									AGG_SORTED,
+									AGGSPLIT_SIMPLE,
+									parse->groupClause,
+									(List *) parse->havingQual,
+									&agg_final_costs,
+									num_groups);
+	add_path(group_rel, path);
+}
+
+/*
+ * gpusort_add_upper_paths
+ *
+ * entrypoint to add GpuWindowAgg path on the window stage, GpuTopN and
+ * GpuSort paths on the ordered stage, and GpuSort + Agg path on the
+ * grouping stage.
+ */
+static void
+gpusort_add_upper_paths(PlannerInfo *root,
+						UpperRelationKind stage,
+						RelOptInfo *input_rel,
+						RelOptInfo *output_rel
+#if PG_VERSION_NUM >= 110000
+						,void *extra
+#endif
+	)
+{
+	CustomPath *cpath;
+
+	if (create_upper_paths_next)
+	{
+#if PG_VERSION_NUM < 110000
+		(*create_upper_paths_next)(root, stage, input_rel, output_rel);
+#else
+		(*create_upper_paths_next)(root, stage, input_rel, output_rel, extra);
+#endif
+	}
+
+	if (!pgstrom_enabled)
+		return;
+	if (stage == UPPERREL_WINDOW && enable_gpuwinagg)
+	{
+		if (get_namespace_oid("pgstrom", true) == InvalidOid)
+			return;
+		cpath = create_gpuwinagg_path(root, output_rel,
+									  input_rel->cheapest_total_path);
+		if (cpath)
+			add_path(output_rel, &cpath->path);
+	}
+	else if (stage == UPPERREL_ORDERED && (enable_gputopn || enable_gpusort))
+	{
+		Path	   *path;
+
+		if (get_namespace_oid("pgstrom", true) == InvalidOid)
+			return;
+		cpath = NULL;
+		if (enable_gputopn)
+			cpath = create_gputopn_path(root, output_rel,
+										input_rel->cheapest_total_path);
+		if (!cpath && enable_gpusort)
+			cpath = create_gpusort_path(root, output_rel,
+										input_rel->cheapest_total_path,
+										root->parse->sortClause,
+										root->sort_pathkeys);
+		if (!cpath)
+			return;
+		path = &cpath->path;
+		if (path->pathtarget != output_rel->reltarget)
+			path = apply_projection_to_path(root, output_rel, path,
+											output_rel->reltarget);
+		add_path(output_rel, path);
+	}
+	else if (stage == UPPERREL_GROUP_AGG && enable_gpusort)
+	{
+		if (get_namespace_oid("pgstrom", true) == InvalidOid)
+			return;
+		try_add_gpusort_grouping_path(root, output_rel,
+									  input_rel->cheapest_total_path);
+	}
+}
+
+/*
+ * gpusort_codegen_keycomp - code generator for
+ *
+ * DEVICE_FUNCTION(cl_int)
+ * gpuwinagg_keycomp(kern_context *kcxt,
+ *                   kern_data_store *kds_src,
+ *                   cl_uint x_index,
+ *                   cl_uint y_index,
+ *                   cl_int *p_depth);
+ */
+static void
+gpusort_codegen_keycomp(StringInfo kern,
+						codegen_context *context,
+						List *tlist_dev,
+						GpuSortInfo *gs_info)
+{
+	StringInfoData	body;
+	ListCell	   *lc1, *lc2, *lc3, *lc4;
+	int				depth = 0;
+
+	initStringInfo(&body);
+	forfour (lc1, gs_info->key_anums,
+			 lc2, gs_info->key_collations,
+			 lc3, gs_info->key_nulls_first,
+			 lc4, gs_info->key_descending)
+	{
+		AttrNumber		anum = lfirst_int(lc1);
+		Oid				coll_oid = lfirst_oid(lc2);
+		bool			nulls_first = lfirst_int(lc3);
+		bool			descending = lfirst_int(lc4);
+		TargetEntry	   *tle = list_nth(tlist_dev, anum - 1);
+		Oid				type_oid = exprType((Node *)tle->expr);
+		devtype_info   *dtype;
+		devfunc_info   *dfunc;
+		devtype_info   *darg;
+
+		dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+		if (!dtype)
+			elog(ERROR, "Bug? type (%s) is not supported at GPU",
+				 format_type_be(type_oid));
+		dfunc = pgstrom_devfunc_lookup_type_compare(dtype, coll_oid);
+		if (!dfunc)
+			elog(ERROR, "Bug? type (%s) has no device comparison function",
+				 format_type_be(type_oid));
+		pgstrom_devfunc_track(context, dfunc);
+		/* comparison function may take binary compatible type */
+		darg = linitial(dfunc->func_args);
+		if (dtype->type_oid != darg->type_oid &&
+			!pgstrom_devtype_can_relabel(dtype->type_oid, darg->type_oid))
+			elog(ERROR, "Bug? no binary compatible cast for %s -> %s",
+				 format_type_be(dtype->type_oid),
+				 format_type_be(darg->type_oid));
+
+		appendStringInfo(
+			&body,
+			"  /* sort key %d */\n"
+			"  {\n"
+			"    pg_%s_t x_value;\n"
+			"    pg_%s_t y_value;\n"
+			"\n"
+			"    addr = kern_get_datum_tuple(kds_src->colmeta, x_htup, %d);\n"
+			"    pg_datum_ref(kcxt, x_value, addr);\n"
+			"    addr = kern_get_datum_tuple(kds_src->colmeta, y_htup, %d);\n"
+			"    pg_datum_ref(kcxt, y_value, addr);\n"
+			"    if (x_value.isnull != y_value.isnull)\n"
+			"    {\n"
+			"      *p_depth = %d;\n"
+			"      return (x_value.isnull ? %d : %d);\n"
+			"    }\n"
+			"    if (!x_value.isnull)\n"
+			"    {\n"
+			"      comp = pgfn_%s(kcxt, x_value, y_value);\n"
+			"      if (comp.value != 0)\n"
+			"      {\n"
+			"        *p_depth = %d;\n"
+			"        return %scomp.value;\n"
+			"      }\n"
+			"    }\n"
+			"  }\n",
+			depth + 1,
+			darg->type_name,
+			darg->type_name,
+			anum - 1,
+			anum - 1,
+			depth,
+			nulls_first ? -1 : 1,
+			nulls_first ? 1 : -1,
+			dfunc->func_devname,
+			depth,
+			descending ? "-" : "");
+		depth++;
+	}
+
+	appendStringInfo(
+		kern,
+		"DEVICE_FUNCTION(cl_int)\n"
+		"gpuwinagg_keycomp(kern_context *kcxt,\n"
+		"                  kern_data_store *kds_src,\n"
+		"                  cl_uint x_index,\n"
+		"                  cl_uint y_index,\n"
+		"                  cl_int *p_depth)\n"
+		"{\n"
+		"  HeapTupleHeaderData *x_htup\n"
+		"    = &KERN_DATA_STORE_TUPITEM(kds_src, x_index)->htup;\n"
+		"  HeapTupleHeaderData *y_htup\n"
+		"    = &KERN_DATA_STORE_TUPITEM(kds_src, y_index)->htup;\n"
+		"  void       *addr;\n"
+		"  pg_int4_t   comp;\n"
+		"\n"
+		"%s"
+		"  *p_depth = %d;\n"
+		"  return 0;\n"
+		"}\n\n"
+		"DEVICE_FUNCTION(cl_int)\n"
+		"gpusort_keycomp(kern_context *kcxt,\n"
+		"                kern_data_store *kds_src,\n"
+		"                cl_uint x_index,\n"
+		"                cl_uint y_index)\n"
+		"{\n"
+		"  cl_int      depth;\n"
+		"\n"
+		"  return gpuwinagg_keycomp(kcxt, kds_src, x_index, y_index, &depth);\n"
+		"}\n\n",
+		body.data,
+		depth);
+	pfree(body.data);
+}
+
+/*
+ * gpusort_codegen_fetch_args - code generator for
+ *
+ * DEVICE_FUNCTION(void)
+ * gpuwinagg_fetch_args(kern_context *kcxt,
+ *                      kern_data_store *kds_src,
+ *                      cl_uint row_index,
+ *                      cl_ulong *values,
+ *                      cl_bool *isnull);
+ */
+static void
+gpusort_codegen_fetch_args(StringInfo kern,
+						   codegen_context *context,
+						   GpuSortInfo *gs_info)
+{
+	StringInfoData	decl;
+	StringInfoData	body;
+	ListCell	   *lc;
+	int				argidx = 0;
+
+	initStringInfo(&decl);
+	initStringInfo(&body);
+	context->param_refs = NULL;
+	context->used_vars = NIL;
+
+	foreach (lc, gs_info->arg_exprs)
+	{
+		Node		   *arg = lfirst(lc);
+		Oid				type_oid = exprType(arg);
+		devtype_info   *dtype;
+		char		   *expr_code;
+
+		dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+		if (!dtype)
+			elog(ERROR, "Bug? type (%s) is not supported at GPU",
+				 format_type_be(type_oid));
+		expr_code = pgstrom_codegen_expression(arg, context);
+		appendStringInfo(
+			&body,
+			"  {\n"
+			"    pg_%s_t temp = %s;\n"
+			"\n"
+			"    isnull[%d] = temp.isnull;\n",
+			dtype->type_name, expr_code,
+			argidx);
+		switch (type_oid)
+		{
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+				appendStringInfo(
+					&body,
+					"    values[%d] = (temp.isnull ? 0 : (cl_ulong)((cl_long)temp.value));\n",
+					argidx);
+				break;
+			case FLOAT4OID:
+			case FLOAT8OID:
+				appendStringInfo(
+					&body,
+					"    values[%d] = (temp.isnull ? 0 : __double_as_longlong((cl_double)temp.value));\n",
+					argidx);
+				break;
+			default:
+				/* count(x) references only the null state */
+				appendStringInfo(
+					&body,
+					"    values[%d] = 0;\n",
+					argidx);
+				break;
+		}
+		appendStringInfoString(&body, "  }\n");
+		argidx++;
+	}
+
+	/* declarations of the referenced columns */
+	foreach (lc, context->used_vars)
+	{
+		Var			   *var = lfirst(lc);
+		devtype_info   *dtype = pgstrom_devtype_lookup(var->vartype);
+
+		Assert(var->varno == INDEX_VAR && var->varattno > 0);
+		appendStringInfo(
+			&decl,
+			"  pg_%s_t %s_%u;\n",
+			dtype->type_name,
+			context->var_label,
+			var->varattno);
+	}
+	foreach (lc, context->used_vars)
+	{
+		Var		   *var = lfirst(lc);
+
+		appendStringInfo(
+			&decl,
+			"  addr = kern_get_datum_tuple(kds_src->colmeta, htup, %d);\n"
+			"  pg_datum_ref(kcxt, %s_%u, addr);\n",
+			var->varattno - 1,
+			context->var_label,
+			var->varattno);
+	}
+	pgstrom_codegen_param_declarations(&decl, context);
+
+	appendStringInfo(
+		kern,
+		"DEVICE_FUNCTION(void)\n"
+		"gpuwinagg_fetch_args(kern_context *kcxt,\n"
+		"                     kern_data_store *kds_src,\n"
+		"                     cl_uint row_index,\n"
+		"                     cl_ulong *values,\n"
+		"                     cl_bool *isnull)\n"
+		"{\n"
+		"  HeapTupleHeaderData *htup\n"
+		"    = &KERN_DATA_STORE_TUPITEM(kds_src, row_index)->htup;\n"
+		"  void       *addr __attribute__((unused));\n"
+		"%s%s\n%s"
+		"}\n\n",
+		decl.data,
+		context->decl_temp.data,
+		body.data);
+	pfree(decl.data);
+	pfree(body.data);
+}
+
+/*
+ * gpusort_codegen_radix_key - code generator for
+ *
+ * DEVICE_FUNCTION(cl_uint)
+ * gpusort_radix_key(kern_context *kcxt,
+ *                   kern_data_store *kds_src,
+ *                   cl_uint row_index,
+ *                   cl_uint keyidx,
+ *                   cl_ulong *p_key);
+ */
+static void
+gpusort_codegen_radix_key(StringInfo kern,
+						  codegen_context *context,
+						  List *tlist_dev,
+						  GpuSortInfo *gs_info)
+{
+	StringInfoData	body;
+	ListCell	   *lc1, *lc2, *lc3;
+	int				keyidx = 0;
+
+	initStringInfo(&body);
+	if (gs_info->radix_sort)
+	{
+		forthree (lc1, gs_info->key_anums,
+				  lc2, gs_info->key_nulls_first,
+				  lc3, gs_info->key_descending)
+		{
+			AttrNumber		anum = lfirst_int(lc1);
+			bool			nulls_first = lfirst_int(lc2);
+			bool			descending = lfirst_int(lc3);
+			TargetEntry	   *tle = list_nth(tlist_dev, anum - 1);
+			Oid				type_oid = exprType((Node *)tle->expr);
+			devtype_info   *dtype;
+			const char	   *conv;
+
+			dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+			if (!dtype)
+				elog(ERROR, "Bug? type (%s) is not supported at GPU",
+					 format_type_be(type_oid));
+			if (type_oid == FLOAT4OID || type_oid == FLOAT8OID)
+				conv = "gpusort_radix_fp_key((cl_double)datum.value)";
+			else
+				conv = "gpusort_radix_int_key((cl_long)datum.value)";
+
+			appendStringInfo(
+				&body,
+				"  case %d:\n"
+				"    {\n"
+				"      pg_%s_t datum;\n"
+				"\n"
+				"      addr = kern_get_datum_tuple(kds_src->colmeta, htup, %d);\n"
+				"      pg_datum_ref(kcxt, datum, addr);\n"
+				"      if (datum.isnull)\n"
+				"      {\n"
+				"        *p_key = 0;\n"
+				"        return %d;\n"
+				"      }\n"
+				"      *p_key = %s%s;\n"
+				"      return %d;\n"
+				"    }\n",
+				keyidx,
+				dtype->type_name,
+				anum - 1,
+				nulls_first ? 0 : 1,
+				descending ? "~" : "",
+				conv,
+				nulls_first ? 1 : 0);
+			keyidx++;
+		}
+	}
+
+	appendStringInfoString(
+		kern,
+		"DEVICE_FUNCTION(cl_uint)\n"
+		"gpusort_radix_key(kern_context *kcxt,\n"
+		"                  kern_data_store *kds_src,\n"
+		"                  cl_uint row_index,\n"
+		"                  cl_uint keyidx,\n"
+		"                  cl_ulong *p_key)\n"
+		"{\n");
+	if (body.len > 0)
+		appendStringInfo(
+			kern,
+			"  HeapTupleHeaderData *htup\n"
+			"    = &KERN_DATA_STORE_TUPITEM(kds_src, row_index)->htup;\n"
+			"  void       *addr;\n"
+			"\n"
+			"  switch (keyidx)\n"
+			"  {\n"
+			"%s"
+			"  default:\n"
+			"    break;\n"
+			"  }\n",
+			body.data);
+	appendStringInfoString(
+		kern,
+		"  *p_key = 0;\n"
+		"  return 0;\n"
+		"}\n\n");
+	pfree(body.data);
+}
+
+/*
+ * gpusort_codegen
+ */
+static char *
+gpusort_codegen(codegen_context *context,
+				List *tlist_dev,
+				GpuSortInfo *gs_info)
+{
+	StringInfoData	kern;
+
+	initStringInfo(&kern);
+	/* all the outer rows are sorted */
+	appendStringInfoString(
+		&kern,
+		"DEVICE_FUNCTION(cl_bool)\n"
+		"gpusort_quals_eval(kern_context *kcxt,\n"
+		"                   kern_data_store *kds,\n"
+		"                   cl_uint row_index)\n"
+		"{\n"
+		"  return true;\n"
+		"}\n\n");
+	gpusort_codegen_keycomp(&kern, context, tlist_dev, gs_info);
+	gpusort_codegen_radix_key(&kern, context, tlist_dev, gs_info);
+	gpusort_codegen_fetch_args(&kern, context, gs_info);
+	/* user defined device functions, if any */
+	pgstrom_codegen_user_functions(&kern, context);
+
+	return kern.data;
+}
+
+/*
+ * PlanGpuWinAggPath
+ */
+static Plan *
+PlanGpuWinAggPath(PlannerInfo *root,
+				  RelOptInfo *rel,
+				  struct CustomPath *best_path,
+				  List *tlist,
+				  List *clauses,
+				  List *custom_plans)
+{
+	CustomScan	   *cscan = makeNode(CustomScan);
+	GpuSortInfo	   *gs_info;
+	List		   *wfuncs;
+	List		   *tlist_dev = NIL;
+	Plan		   *outer_plan;
+	ListCell	   *lc;
+	codegen_context	context;
+
+	Assert(list_length(best_path->custom_private) == 2);
+	gs_info = linitial(best_path->custom_private);
+	wfuncs = lsecond(best_path->custom_private);
+	Assert(list_length(custom_plans) == 1);
+	outer_plan = linitial(custom_plans);
+
+	/*
+	 * custom_scan_tlist consists of the outer columns as is, and the
+	 * window functions. setrefs.c replaces the window functions in the
+	 * targetlist by references to the entries.
+	 */
+	foreach (lc, outer_plan->targetlist)
+	{
+		TargetEntry	   *tle = lfirst(lc);
+
+		tlist_dev = lappend(tlist_dev,
+							makeTargetEntry(copyObject(tle->expr),
+											list_length(tlist_dev) + 1,
+											NULL,
+											false));
+	}
+	Assert(list_length(tlist_dev) == gs_info->num_input_cols);
+	foreach (lc, wfuncs)
+	{
+		tlist_dev = lappend(tlist_dev,
+							makeTargetEntry(copyObject(lfirst(lc)),
+											list_length(tlist_dev) + 1,
+											NULL,
+											false));
+	}
+
+	/* setup CustomScan node */
+	cscan->scan.plan.targetlist = tlist;
+	cscan->scan.plan.qual = NIL;
+	outerPlan(cscan) = outer_plan;
+	cscan->scan.scanrelid = 0;
+	cscan->flags = best_path->flags;
+	cscan->custom_scan_tlist = tlist_dev;
+	cscan->methods = &gpuwinagg_scan_methods;
+
+	/* construction of the GPU kernel code */
+	pgstrom_init_codegen_context(&context, root, NULL);
+	gs_info->kern_source = gpusort_codegen(&context, tlist_dev, gs_info);
+	gs_info->extra_flags = context.extra_flags | DEVKERNEL_NEEDS_GPUSORT;
+	gs_info->varlena_bufsz = context.varlena_bufsz;
+	gs_info->used_params = context.used_params;
+	form_gpusort_info(cscan, gs_info);
+
+	return &cscan->scan.plan;
+}
+
+/*
+ * CreateGpuWinAggScanState
+ */
+static Node *
+CreateGpuWinAggScanState(CustomScan *cscan)
+{
+	GpuWinAggState *gwas = MemoryContextAllocZero(CurTransactionContext,
+												  sizeof(GpuWinAggState));
+	/* Set tag and executor callbacks */
+	NodeSetTag(gwas, T_CustomScanState);
+	gwas->gts.css.flags = cscan->flags;
+	if (cscan->methods == &gpuwinagg_scan_methods)
+		gwas->gts.css.methods = &gpuwinagg_exec_methods;
+	else
+		elog(ERROR, "Bug? unexpected CustomPlanMethods");
+
+	return (Node *) gwas;
+}
+
+/*
+ * ExecInitGpuWinAgg
+ */
+static void
+ExecInitGpuWinAgg(CustomScanState *node, EState *estate, int eflags)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	GpuSortInfo	   *gs_info = deform_gpusort_info(cscan);
+	GpuContext	   *gcontext;
+	TupleDesc		outer_tupdesc;
+	ListCell	   *lc1, *lc2, *lc3, *lc4;
+	StringInfoData	kern_define;
+	ProgramId		program_id;
+	bool			explain_only = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0);
+	int				i;
+
+	Assert(node->ss.ss_currentRelation == NULL &&
+		   outerPlan(cscan) != NULL);
+	/* activate a GpuContext for CUDA kernel execution */
+	gcontext = AllocGpuContext(gs_info->optimal_gpu,
+							   false, false, false);
+	gwas->gts.gcontext = gcontext;
+	/* setup common GpuTaskState fields */
+	pgstromInitGpuTaskState(&gwas->gts,
+							gcontext,
+							GpuTaskKind_GpuSort,
+							NIL,
+							NIL,
+							gs_info->used_params,
+							gs_info->optimal_gpu,
+							0,
+							estate);
+	gwas->gts.cb_next_task    = gpuwinagg_next_task;
+	gwas->gts.cb_next_tuple   = gpuwinagg_next_tuple;
+	gwas->gts.cb_process_task = gpuwinagg_process_task;
+	gwas->gts.cb_release_task = gpuwinagg_release_task;
+
+	/* initialization of the outer relation */
+	outerPlanState(gwas) = ExecInitNode(outerPlan(cscan), estate, eflags);
+	outer_tupdesc = ExecGetResultType(outerPlanState(gwas));
+	gwas->outer_slot = MakeSingleTupleTableSlot(outer_tupdesc,
+												&TTSOpsHeapTuple);
+	gwas->num_input_cols = gs_info->num_input_cols;
+	Assert(gwas->num_input_cols == outer_tupdesc->natts);
+
+	/* sort keys; SortSupport is used for CPU fallback */
+	gwas->part_nkeys = gs_info->part_nkeys;
+	gwas->nkeys = list_length(gs_info->key_anums);
+	gwas->key_anums = palloc0(sizeof(AttrNumber) * gwas->nkeys);
+	gwas->key_sortops = palloc0(sizeof(Oid) * gwas->nkeys);
+	gwas->key_collations = palloc0(sizeof(Oid) * gwas->nkeys);
+	gwas->key_nulls_first = palloc0(sizeof(bool) * gwas->nkeys);
+	gwas->key_ssup = palloc0(sizeof(SortSupportData) * gwas->nkeys);
+	i = 0;
+	forfour (lc1, gs_info->key_anums,
+			 lc2, gs_info->key_sortops,
+			 lc3, gs_info->key_collations,
+			 lc4, gs_info->key_nulls_first)
+	{
+		SortSupport	ssup = &gwas->key_ssup[i];
+
+		gwas->key_anums[i] = lfirst_int(lc1);
+		gwas->key_sortops[i] = lfirst_oid(lc2);
+		gwas->key_collations[i] = lfirst_oid(lc3);
+		gwas->key_nulls_first[i] = lfirst_int(lc4);
+		ssup->ssup_cxt = CurrentMemoryContext;
+		ssup->ssup_collation = lfirst_oid(lc3);
+		ssup->ssup_nulls_first = lfirst_int(lc4);
+		ssup->ssup_attno = gwas->key_anums[i];
+		PrepareSortSupportFromOrderingOp(lfirst_oid(lc2), ssup);
+		i++;
+	}
+
+	/* window functions */
+	gwas->nfuncs = list_length(gs_info->func_kinds);
+	gwas->func_kinds = palloc0(sizeof(cl_char) * gwas->nfuncs);
+	gwas->func_frames = palloc0(sizeof(cl_char) * gwas->nfuncs);
+	gwas->func_argidx = palloc0(sizeof(cl_short) * gwas->nfuncs);
+	gwas->func_types = palloc0(sizeof(Oid) * gwas->nfuncs);
+	i = 0;
+	forthree (lc1, gs_info->func_kinds,
+			  lc2, gs_info->func_frames,
+			  lc3, gs_info->func_argidx)
+	{
+		TargetEntry *tle = list_nth(cscan->custom_scan_tlist,
+									gwas->num_input_cols + i);
+
+		gwas->func_kinds[i] = lfirst_int(lc1);
+		gwas->func_frames[i] = lfirst_int(lc2);
+		gwas->func_argidx[i] = lfirst_int(lc3);
+		gwas->func_types[i] = exprType((Node *)tle->expr);
+		i++;
+	}
+	/* arguments of the window functions; evaluated on the outer tuple */
+	gwas->nargs = list_length(gs_info->arg_exprs);
+	gwas->arg_types = palloc0(sizeof(Oid) * gwas->nargs);
+	gwas->arg_states = palloc0(sizeof(ExprState *) * gwas->nargs);
+	i = 0;
+	foreach (lc1, gs_info->arg_exprs)
+	{
+		Expr   *arg = lfirst(lc1);
+
+		gwas->arg_types[i] = exprType((Node *)arg);
+		gwas->arg_states[i] = ExecInitExpr(arg, &gwas->gts.css.ss.ps);
+		i++;
+	}
+
+	/* Get CUDA program and async build if any */
+	initStringInfo(&kern_define);
+	pgstrom_build_session_info(&kern_define,
+							   &gwas->gts,
+							   gs_info->extra_flags);
+	program_id = pgstrom_create_cuda_program(gcontext,
+											 gs_info->extra_flags,
+											 gs_info->varlena_bufsz,
+											 gs_info->kern_source,
+											 kern_define.data,
+											 false,
+											 explain_only);
+	gwas->gts.program_id = program_id;
+	pfree(kern_define.data);
+}
+
+/*
+ * ExecReCheckGpuWinAgg
+ */
+static bool
+ExecReCheckGpuWinAgg(CustomScanState *node, TupleTableSlot *slot)
+{
+	/* GpuWindowAgg shall never be located under the LockRows */
+	return true;
+}
+
+/*
+ * ExecScanGpuWinAgg
+ *
+ * It returns the rows processed by GPU, or by the CPU path once the outer
+ * rows overflowed a single chunk.
+ */
+static TupleTableSlot *
+ExecScanGpuWinAgg(GpuWinAggState *gwas)
+{
+	TupleTableSlot *slot = NULL;
+
+	if (!gwas->cpu_tupstore)
+		slot = pgstromExecGpuTaskState(&gwas->gts);
+	if (!slot && gwas->cpu_tupstore)
+		slot = gpuwinagg_cpu_next_tuple(gwas);
+	return slot;
+}
+
+/*
+ * ExecGpuWinAgg
+ */
+static TupleTableSlot *
+ExecGpuWinAgg(CustomScanState *node)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) node;
+
+	ActivateGpuContext(gwas->gts.gcontext);
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) ExecScanGpuWinAgg,
+					(ExecScanRecheckMtd) ExecReCheckGpuWinAgg);
+}
+
+/*
+ * ExecEndGpuWinAgg
+ */
+static void
+ExecEndGpuWinAgg(CustomScanState *node)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gwas->gts.gcontext);
+	/* clean up subtree */
+	if (outerPlanState(node))
+		ExecEndNode(outerPlanState(node));
+	if (gwas->outer_slot)
+		ExecDropSingleTupleTableSlot(gwas->outer_slot);
+	gpuwinagg_cpu_cleanup(gwas);
+	if (gwas->cpu_next_slot)
+		ExecDropSingleTupleTableSlot(gwas->cpu_next_slot);
+	if (gwas->cpu_head_slot)
+		ExecDropSingleTupleTableSlot(gwas->cpu_head_slot);
+	if (gwas->cpu_peer_slot)
+		ExecDropSingleTupleTableSlot(gwas->cpu_peer_slot);
+	if (gwas->cpu_curr_slot)
+		ExecDropSingleTupleTableSlot(gwas->cpu_curr_slot);
+	pgstromReleaseGpuTaskState(&gwas->gts, NULL);
+}
+
+/*
+ * ExecReScanGpuWinAgg
+ */
+static void
+ExecReScanGpuWinAgg(CustomScanState *node)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gwas->gts.gcontext);
+	/* common rescan handling */
+	pgstromRescanGpuTaskState(&gwas->gts);
+	/* also rescan subtree */
+	ExecReScan(outerPlanState(node));
+	gwas->scan_done = false;
+	gpuwinagg_cpu_cleanup(gwas);
+}
+
+/*
+ * ExplainGpuWinAgg
+ */
+static void
+ExplainGpuWinAgg(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	GpuSortInfo	   *gs_info = deform_gpusort_info(cscan);
+	List		   *dcontext;
+	List		   *part_keys = NIL;
+	List		   *order_keys = NIL;
+	List		   *wfuncs = NIL;
+	ListCell	   *lc;
+	int				i = 0;
+
+	/* Set up deparsing context */
+	dcontext = set_deparse_context_planstate(es->deparse_cxt,
+											 (Node *)&gwas->gts.css.ss.ps,
+											 ancestors);
+	foreach (lc, gs_info->key_anums)
+	{
+		TargetEntry *tle = list_nth(cscan->custom_scan_tlist,
+									lfirst_int(lc) - 1);
+		if (i++ < gs_info->part_nkeys)
+			part_keys = lappend(part_keys, tle->expr);
+		else
+			order_keys = lappend(order_keys, tle->expr);
+	}
+	for (i=gs_info->num_input_cols;
+		 i < list_length(cscan->custom_scan_tlist); i++)
+	{
+		TargetEntry *tle = list_nth(cscan->custom_scan_tlist, i);
+
+		wfuncs = lappend(wfuncs, tle->expr);
+	}
+	if (part_keys != NIL)
+		ExplainPropertyText("Partition By",
+							deparse_expression((Node *)part_keys,
+											   dcontext,
+											   es->verbose, false), es);
+	if (order_keys != NIL)
+		ExplainPropertyText("Order By",
+							deparse_expression((Node *)order_keys,
+											   dcontext,
+											   es->verbose, false), es);
+	if (es->verbose)
+		ExplainPropertyText("Window Functions",
+							deparse_expression((Node *)wfuncs,
+											   dcontext,
+											   es->verbose, false), es);
+	/* outer rows overflowed a chunk, then processed on CPU */
+	if (es->analyze && gwas->cpu_tupstore)
+		ExplainPropertyText("CPU Window Functions", "enabled", es);
+	/* other common fields */
+	pgstromExplainGpuTaskState(&gwas->gts, es);
+}
+
+/*
+ * PlanGpuSortPath - for both of GpuTopN and GpuSort
+ */
+static Plan *
+PlanGpuSortPath(PlannerInfo *root,
+				RelOptInfo *rel,
+				struct CustomPath *best_path,
+				List *tlist,
+				List *clauses,
+				List *custom_plans)
+{
+	CustomScan	   *cscan = makeNode(CustomScan);
+	GpuSortInfo	   *gs_info;
+	List		   *tlist_dev = NIL;
+	Plan		   *outer_plan;
+	ListCell	   *lc;
+	codegen_context	context;
+
+	Assert(list_length(best_path->custom_private) == 1);
+	gs_info = linitial(best_path->custom_private);
+	Assert(list_length(custom_plans) == 1);
+	outer_plan = linitial(custom_plans);
+
+	/* custom_scan_tlist consists of the outer columns as is */
+	foreach (lc, outer_plan->targetlist)
+	{
+		TargetEntry	   *tle = lfirst(lc);
+
+		tlist_dev = lappend(tlist_dev,
+							makeTargetEntry(copyObject(tle->expr),
+											list_length(tlist_dev) + 1,
+											NULL,
+											false));
+	}
+	Assert(list_length(tlist_dev) == gs_info->num_input_cols);
+
+	/* setup CustomScan node */
+	cscan->scan.plan.targetlist = tlist;
+	cscan->scan.plan.qual = NIL;
+	outerPlan(cscan) = outer_plan;
+	cscan->scan.scanrelid = 0;
+	cscan->flags = best_path->flags;
+	cscan->custom_scan_tlist = tlist_dev;
+	if (best_path->methods == &gputopn_path_methods)
+		cscan->methods = &gputopn_scan_methods;
+	else if (best_path->methods == &gpusort_path_methods)
+		cscan->methods = &gpusort_scan_methods;
+	else
+		elog(ERROR, "Bug? unexpected CustomPathMethods");
+
+	/* construction of the GPU kernel code */
+	pgstrom_init_codegen_context(&context, root, NULL);
+	gs_info->kern_source = gpusort_codegen(&context, tlist_dev, gs_info);
+	gs_info->extra_flags = context.extra_flags | DEVKERNEL_NEEDS_GPUSORT;
+	gs_info->varlena_bufsz = context.varlena_bufsz;
+	gs_info->used_params = context.used_params;
+	form_gpusort_info(cscan, gs_info);
+
+	return &cscan->scan.plan;
+}
+
+/*
+ * CreateGpuSortScanState
+ */
+static Node *
+CreateGpuSortScanState(CustomScan *cscan)
+{
+	GpuSortState   *gss = MemoryContextAllocZero(CurTransactionContext,
+												 sizeof(GpuSortState));
+	/* Set tag and executor callbacks */
+	NodeSetTag(gss, T_CustomScanState);
+	gss->gts.css.flags = cscan->flags;
+	if (cscan->methods == &gputopn_scan_methods)
+		gss->gts.css.methods = &gputopn_exec_methods;
+	else if (cscan->methods == &gpusort_scan_methods)
+		gss->gts.css.methods = &gpusort_exec_methods;
+	else
+		elog(ERROR, "Bug? unexpected CustomPlanMethods");
+
+	return (Node *) gss;
+}
+
+/*
+ * ExecInitGpuSort
+ */
+static void
+ExecInitGpuSort(CustomScanState *node, EState *estate, int eflags)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	GpuSortInfo	   *gs_info = deform_gpusort_info(cscan);
+	GpuContext	   *gcontext;
+	TupleDesc		outer_tupdesc;
+	ListCell	   *lc1, *lc2, *lc3, *lc4;
+	StringInfoData	kern_define;
+	ProgramId		program_id;
+	bool			explain_only = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0);
+	int				i;
+
+	Assert(node->ss.ss_currentRelation == NULL &&
+		   outerPlan(cscan) != NULL);
+	/* activate a GpuContext for CUDA kernel execution */
+	gcontext = AllocGpuContext(gs_info->optimal_gpu,
+							   false, false, false);
+	gss->gts.gcontext = gcontext;
+	/* setup common GpuTaskState fields */
+	pgstromInitGpuTaskState(&gss->gts,
+							gcontext,
+							GpuTaskKind_GpuSort,
+							NIL,
+							NIL,
+							gs_info->used_params,
+							gs_info->optimal_gpu,
+							0,
+							estate);
+	gss->gts.cb_next_task       = gpusort_next_task;
+	gss->gts.cb_terminator_task = gpusort_terminator_task;
+	gss->gts.cb_next_tuple      = gpusort_next_tuple;
+	gss->gts.cb_process_task    = gpusort_process_task;
+	gss->gts.cb_release_task    = gpusort_release_task;
+
+	/* initialization of the outer relation */
+	outerPlanState(gss) = ExecInitNode(outerPlan(cscan), estate, eflags);
+	outer_tupdesc = ExecGetResultType(outerPlanState(gss));
+	gss->outer_slot = MakeSingleTupleTableSlot(outer_tupdesc,
+											   &TTSOpsHeapTuple);
+	gss->num_input_cols = gs_info->num_input_cols;
+	Assert(gss->num_input_cols == outer_tupdesc->natts);
+	gss->topn_nitems = gs_info->topn_nitems;
+	gss->radix_sort = gs_info->radix_sort;
+
+	/* sort keys; SortSupport is used for CPU fallback and merge */
+	gss->nkeys = list_length(gs_info->key_anums);
+	gss->key_anums = palloc0(sizeof(AttrNumber) * gss->nkeys);
+	gss->key_ssup = palloc0(sizeof(SortSupportData) * gss->nkeys);
+	i = 0;
+	forfour (lc1, gs_info->key_anums,
+			 lc2, gs_info->key_sortops,
+			 lc3, gs_info->key_collations,
+			 lc4, gs_info->key_nulls_first)
+	{
+		SortSupport	ssup = &gss->key_ssup[i];
+
+		gss->key_anums[i] = lfirst_int(lc1);
+		ssup->ssup_cxt = CurrentMemoryContext;
+		ssup->ssup_collation = lfirst_oid(lc3);
+		ssup->ssup_nulls_first = lfirst_int(lc4);
+		ssup->ssup_attno = gss->key_anums[i];
+		PrepareSortSupportFromOrderingOp(lfirst_oid(lc2), ssup);
+		i++;
+	}
+
+	/* Get CUDA program and async build if any */
+	initStringInfo(&kern_define);
+	pgstrom_build_session_info(&kern_define,
+							   &gss->gts,
+							   gs_info->extra_flags);
+	program_id = pgstrom_create_cuda_program(gcontext,
+											 gs_info->extra_flags,
+											 gs_info->varlena_bufsz,
+											 gs_info->kern_source,
+											 kern_define.data,
+											 false,
+											 explain_only);
+	gss->gts.program_id = program_id;
+	pfree(kern_define.data);
+}
+
+/*
+ * ExecReCheckGpuSort
+ */
+static bool
+ExecReCheckGpuSort(CustomScanState *node, TupleTableSlot *slot)
+{
+	/* GpuTopN/GpuSort shall never be located under the LockRows */
+	return true;
+}
+
+/*
+ * ExecGpuSort
+ */
+static TupleTableSlot *
+ExecGpuSort(CustomScanState *node)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+
+	ActivateGpuContext(gss->gts.gcontext);
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) pgstromExecGpuTaskState,
+					(ExecScanRecheckMtd) ExecReCheckGpuSort);
+}
+
+/*
+ * gpusort_cleanup_merge_state
+ *
+ * It releases the candidates of GpuTopN, and the sorted chunks of GpuSort.
+ */
+static void
+gpusort_cleanup_merge_state(GpuSortState *gss)
+{
+	cl_uint		i;
+
+	if (gss->pds_merge)
+		PDS_release(gss->pds_merge);
+	gss->pds_merge = NULL;
+
+	if (gss->merge_heap)
+		binaryheap_free(gss->merge_heap);
+	gss->merge_heap = NULL;
+	if (gss->merge_cursors)
+	{
+		for (i=0; i < gss->num_sorted_tasks; i++)
+		{
+			pfree(gss->merge_cursors[i].key_values);
+			pfree(gss->merge_cursors[i].key_isnull);
+		}
+		pfree(gss->merge_cursors);
+	}
+	gss->merge_cursors = NULL;
+
+	for (i=0; i < gss->num_sorted_tasks; i++)
+		gpusort_release_task(&gss->sorted_tasks[i]->task);
+	gss->num_sorted_tasks = 0;
+}
+
+/*
+ * ExecEndGpuSort
+ */
+static void
+ExecEndGpuSort(CustomScanState *node)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gss->gts.gcontext);
+	/* clean up subtree */
+	if (outerPlanState(node))
+		ExecEndNode(outerPlanState(node));
+	if (gss->outer_slot)
+		ExecDropSingleTupleTableSlot(gss->outer_slot);
+	gpusort_cleanup_merge_state(gss);
+	pgstromReleaseGpuTaskState(&gss->gts, NULL);
+}
+
+/*
+ * ExecReScanGpuSort
+ */
+static void
+ExecReScanGpuSort(CustomScanState *node)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gss->gts.gcontext);
+	/* common rescan handling */
+	pgstromRescanGpuTaskState(&gss->gts);
+	/* also rescan subtree */
+	ExecReScan(outerPlanState(node));
+	gpusort_cleanup_merge_state(gss);
+	gss->terminator_done = false;
+}
+
+/*
+ * ExplainGpuSort
+ */
+static void
+ExplainGpuSort(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	GpuSortInfo	   *gs_info = deform_gpusort_info(cscan);
+	List		   *dcontext;
+	List		   *order_keys = NIL;
+	ListCell	   *lc;
+
+	/* Set up deparsing context */
+	dcontext = set_deparse_context_planstate(es->deparse_cxt,
+											 (Node *)&gss->gts.css.ss.ps,
+											 ancestors);
+	foreach (lc, gs_info->key_anums)
+	{
+		TargetEntry *tle = list_nth(cscan->custom_scan_tlist,
+									lfirst_int(lc) - 1);
+		order_keys = lappend(order_keys, tle->expr);
+	}
+	ExplainPropertyText("Order By",
+						deparse_expression((Node *)order_keys,
+										   dcontext,
+										   es->verbose, false), es);
+	if (gs_info->topn_nitems > 0)
+		ExplainPropertyInteger("Top-N", NULL, gs_info->topn_nitems, es);
+	ExplainPropertyText("Sort Method",
+						gs_info->radix_sort ? "radix" : "bitonic", es);
+	/* other common fields */
+	pgstromExplainGpuTaskState(&gss->gts, es);
+}
+
+/*
+ * gpuwinagg_max_chunk_size
+ *
+ * It returns the maximum length of the data store GpuWindowAgg loads all
+ * the outer rows on.
+ */
+static inline size_t
+gpuwinagg_max_chunk_size(void)
+{
+	size_t		max_size = STROMALIGN_DOWN(KDS_OFFSET_MAX_SIZE);
+
+	if (gpuwinagg_max_chunk_size_kb > 0)
+		max_size = Min(max_size, (size_t)gpuwinagg_max_chunk_size_kb << 10);
+	return max_size;
+}
+
+/*
+ * gpusort_expand_pds
+ *
+ * It expands the row-format data store twice, because GpuWindowAgg has
+ * to load all the outer rows on a single chunk, and GpuTopN also gathers
+ * the candidate rows of the chunks. It returns NULL, if the data store
+ * already reached the max_size, then caller has to process the rows on CPU.
+ */
+static pgstrom_data_store *
+gpusort_expand_pds(GpuContext *gcontext,
+				   pgstrom_data_store *pds_old,
+				   TupleDesc tupdesc,
+				   size_t max_size)
+{
+	kern_data_store *kds_old = &pds_old->kds;
+	kern_data_store *kds_new;
+	pgstrom_data_store *pds_new;
+	size_t		usage = __kds_unpack(kds_old->usage);
+	size_t		length = Min(2 * kds_old->length, max_size);
+	cl_uint		shift;
+	cl_uint	   *row_index;
+	cl_uint		i;
+
+	if (length <= kds_old->length)
+		return NULL;
+	pds_new = PDS_create_row(gcontext, tupdesc, length);
+	kds_new = &pds_new->kds;
+
+	/* tuples are stored from the tail, so row-index has to be shifted */
+	shift = __kds_packed(kds_new->length - kds_old->length);
+	row_index = KERN_DATA_STORE_ROWINDEX(kds_new);
+	memcpy(row_index, KERN_DATA_STORE_ROWINDEX(kds_old),
+		   sizeof(cl_uint) * kds_old->nitems);
+	for (i=0; i < kds_old->nitems; i++)
+		row_index[i] += shift;
+	memcpy((char *)kds_new + kds_new->length - usage,
+		   (char *)kds_old + kds_old->length - usage,
+		   usage);
+	kds_new->nitems = kds_old->nitems;
+	kds_new->usage = kds_old->usage;
+	PDS_release(pds_old);
+
+	return pds_new;
+}
+
+/*
+ * gpuwinagg_create_task
+ */
+static GpuTask *
+gpuwinagg_create_task(GpuWinAggState *gwas, pgstrom_data_store *pds_src)
+{
+	GpuContext	   *gcontext = gwas->gts.gcontext;
+	kern_parambuf  *kparams = gwas->gts.kern_params;
+	GpuWinAggTask  *gwtask;
+	kern_gpuwinagg *kgwagg;
+	cl_uint			nitems = pds_src->kds.nitems;
+	cl_uint			nlanes = GPUWINAGG_NUM_FIXED_LANES + 2 * gwas->nfuncs;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+	size_t			head_sz;
+	size_t			length;
+	cl_uint			i;
+
+	/* allocation of GpuWinAggTask with gpusortResultIndex */
+	head_sz = (offsetof(GpuWinAggTask, kern.kparams) +
+			   STROMALIGN(kparams->length));
+	length = head_sz + STROMALIGN(offsetof(gpusortResultIndex,
+										   results[nitems]));
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	gwtask = (GpuWinAggTask *) m_deviceptr;
+	memset(gwtask, 0, head_sz + offsetof(gpusortResultIndex, results));
+
+	pgstromInitGpuTask(&gwas->gts, &gwtask->task);
+	gwtask->pds_src = pds_src;
+	gwtask->kern.nitems_in = nitems;
+	memcpy(KERN_GPUSORT_PARAMBUF(&gwtask->kern),
+		   kparams,
+		   kparams->length);
+
+	/* allocation of kern_gpuwinagg */
+	head_sz = STROMALIGN(offsetof(kern_gpuwinagg, funcs[gwas->nfuncs]));
+	length = (head_sz +
+			  STROMALIGN(sizeof(cl_ulong) * 2 * nlanes * (size_t)nitems) +
+			  STROMALIGN(sizeof(cl_ulong) * gwas->nfuncs * (size_t)nitems) +
+			  STROMALIGN(sizeof(cl_bool) * gwas->nfuncs * (size_t)nitems));
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	kgwagg = (kern_gpuwinagg *) m_deviceptr;
+	memset(kgwagg, 0, head_sz);
+	kgwagg->nitems = nitems;
+	kgwagg->part_nkeys = gwas->part_nkeys;
+	kgwagg->nkeys = gwas->nkeys;
+	kgwagg->nargs = gwas->nargs;
+	kgwagg->nfuncs = gwas->nfuncs;
+	kgwagg->nlanes = nlanes;
+	kgwagg->lanes_offset = head_sz;
+	kgwagg->values_offset = (kgwagg->lanes_offset +
+							 STROMALIGN(sizeof(cl_ulong) * 2 * nlanes *
+										(size_t)nitems));
+	kgwagg->isnull_offset = (kgwagg->values_offset +
+							 STROMALIGN(sizeof(cl_ulong) * gwas->nfuncs *
+										(size_t)nitems));
+	for (i=0; i < gwas->nfuncs; i++)
+	{
+		kgwagg->funcs[i].func   = gwas->func_kinds[i];
+		kgwagg->funcs[i].frame  = gwas->func_frames[i];
+		kgwagg->funcs[i].argidx = gwas->func_argidx[i];
+	}
+	gwtask->kgwagg = kgwagg;
+	gwtask->kgwagg_length = length;
+
+	return &gwtask->task;
+}
+
+/*
+ * gpuwinagg_cpu_put_tuple
+ */
+static inline void
+gpuwinagg_cpu_put_tuple(GpuWinAggState *gwas, TupleTableSlot *slot)
+{
+	if (gwas->cpu_sortstate)
+		tuplesort_puttupleslot(gwas->cpu_sortstate, slot);
+	else
+		tuplestore_puttupleslot(gwas->cpu_tupstore, slot);
+}
+
+/*
+ * gpuwinagg_cpu_begin
+ *
+ * It moves the rows already loaded on the data store, and the rest of the
+ * outer rows to the tuplesort, to compute window functions on CPU.
+ */
+static void
+gpuwinagg_cpu_begin(GpuWinAggState *gwas,
+					pgstrom_data_store *pds,
+					TupleTableSlot *slot)
+{
+	PlanState	   *outer_ps = outerPlanState(gwas);
+	TupleDesc		tupdesc = ExecGetResultType(outer_ps);
+	kern_data_store *kds = &pds->kds;
+	HeapTuple		tuple = &gwas->outer_tuple;
+	cl_uint			i;
+
+	if (!gwas->cpu_next_slot)
+	{
+		gwas->cpu_next_slot = MakeSingleTupleTableSlot(tupdesc,
+													   &TTSOpsMinimalTuple);
+		gwas->cpu_head_slot = MakeSingleTupleTableSlot(tupdesc,
+													   &TTSOpsMinimalTuple);
+		gwas->cpu_peer_slot = MakeSingleTupleTableSlot(tupdesc,
+													   &TTSOpsMinimalTuple);
+		gwas->cpu_curr_slot = MakeSingleTupleTableSlot(tupdesc,
+													   &TTSOpsMinimalTuple);
+		gwas->cpu_row_accum = palloc0(sizeof(gpuwinagg_cpu_accum) *
+									  Max(gwas->nfuncs, 1));
+		gwas->cpu_peer_accum = palloc0(sizeof(gpuwinagg_cpu_accum) *
+									   Max(gwas->nfuncs, 1));
+		gwas->cpu_part_accum = palloc0(sizeof(gpuwinagg_cpu_accum) *
+									   Max(gwas->nfuncs, 1));
+	}
+	gwas->cpu_tupstore = tuplestore_begin_heap(false, false, work_mem);
+	gwas->cpu_peer_ptr = tuplestore_alloc_read_pointer(gwas->cpu_tupstore,
+													   EXEC_FLAG_REWIND);
+	/* without sort keys, all the rows are a single partition as is */
+	if (gwas->nkeys > 0)
+		gwas->cpu_sortstate = tuplesort_begin_heap(tupdesc,
+												   gwas->nkeys,
+												   gwas->key_anums,
+												   gwas->key_sortops,
+												   gwas->key_collations,
+												   gwas->key_nulls_first,
+												   work_mem,
+												   NULL,
+												   false);
+	/* rows already loaded, the row overflowed, then the rest */
+	for (i=0; i < kds->nitems; i++)
+	{
+		kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds, i);
+
+		tuple->t_len  = tupitem->t_len;
+		tuple->t_self = tupitem->t_self;
+		tuple->t_data = &tupitem->htup;
+		ExecStoreHeapTuple(tuple, gwas->outer_slot, false);
+		gpuwinagg_cpu_put_tuple(gwas, gwas->outer_slot);
+	}
+	PDS_release(pds);
+	while (!TupIsNull(slot))
+	{
+		gpuwinagg_cpu_put_tuple(gwas, slot);
+		slot = ExecProcNode(outer_ps);
+	}
+	if (gwas->cpu_sortstate)
+		tuplesort_performsort(gwas->cpu_sortstate);
+}
+
+/*
+ * gpuwinagg_next_task
+ *
+ * It loads all the outer rows onto a single data store, because window
+ * functions need to reference the entire partition. If the outer rows
+ * overflow the data store, it switches to the CPU path.
+ */
+static GpuTask *
+gpuwinagg_next_task(GpuTaskState *gts)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) gts;
+	GpuContext	   *gcontext = gwas->gts.gcontext;
+	PlanState	   *outer_ps = outerPlanState(gwas);
+	TupleDesc		tupdesc = ExecGetResultType(outer_ps);
+	pgstrom_data_store *pds = NULL;
+	pgstrom_data_store *pds_new;
+	TupleTableSlot *slot;
+	size_t			max_size = gpuwinagg_max_chunk_size();
+
+	if (gwas->scan_done)
+		return NULL;
+	for (;;)
+	{
+		slot = ExecProcNode(outer_ps);
+		if (TupIsNull(slot))
+			break;
+		/* create a new data-store on demand */
+		if (!pds)
+			pds = PDS_create_row(gcontext,
+								 tupdesc,
+								 Min(pgstrom_chunk_size(), max_size));
+		while (!PDS_insert_tuple(pds, slot))
+		{
+			pds_new = gpusort_expand_pds(gcontext, pds, tupdesc, max_size);
+			if (!pds_new)
+			{
+				gpuwinagg_cpu_begin(gwas, pds, slot);
+				gwas->scan_done = true;
+				return NULL;
+			}
+			pds = pds_new;
+		}
+	}
+	gwas->scan_done = true;
+
+	if (!pds)
+		return NULL;
+	return gpuwinagg_create_task(gwas, pds);
+}
+
+/*
+ * gpuwinagg_combine - host version of the combine operation
+ */
+static cl_ulong
+gpuwinagg_combine(cl_char func, cl_ulong x, cl_ulong y)
+{
+	double		fx, fy;
+
+	switch (func)
+	{
+		case GPUWINAGG_FUNC__SUM_INT:
+			return (cl_ulong)((cl_long)x + (cl_long)y);
+		case GPUWINAGG_FUNC__MIN_INT:
+			return (cl_ulong)Min((cl_long)x, (cl_long)y);
+		case GPUWINAGG_FUNC__MAX_INT:
+			return (cl_ulong)Max((cl_long)x, (cl_long)y);
+		case GPUWINAGG_FUNC__SUM_FP:
+			fx = DatumGetFloat8((Datum)x);
+			fy = DatumGetFloat8((Datum)y);
+			return (cl_ulong)Float8GetDatum(fx + fy);
+		case GPUWINAGG_FUNC__MIN_FP:
+			fx = DatumGetFloat8((Datum)x);
+			fy = DatumGetFloat8((Datum)y);
+			if (isnan(fx))
+				return y;
+			if (isnan(fy))
+				return x;
+			return (fx < fy ? x : y);
+		case GPUWINAGG_FUNC__MAX_FP:
+			fx = DatumGetFloat8((Datum)x);
+			fy = DatumGetFloat8((Datum)y);
+			if (isnan(fx))
+				return x;
+			if (isnan(fy))
+				return y;
+			return (fx > fy ? x : y);
+		default:
+			break;
+	}
+	return x;
+}
+
+/*
+ * CPU fallback; it sorts the outer rows by qsort with the same definition
+ * of the GPU kernel.
+ */
+typedef struct {
+	cl_uint			nkeys;
+	SortSupport		ssup;
+	Datum		   *key_values;
+	bool		   *key_isnull;
+} gpusort_fallback_context;
+
+static int
+gpusort_fallback_keycomp(gpusort_fallback_context *fcxt,
+						 cl_uint x_index, cl_uint y_index,
+						 int *p_depth)
+{
+	Datum	   *x_values = fcxt->key_values + (size_t)x_index * fcxt->nkeys;
+	Datum	   *y_values = fcxt->key_values + (size_t)y_index * fcxt->nkeys;
+	bool	   *x_isnull = fcxt->key_isnull + (size_t)x_index * fcxt->nkeys;
+	bool	   *y_isnull = fcxt->key_isnull + (size_t)y_index * fcxt->nkeys;
+	int			k, comp;
+
+	for (k=0; k < fcxt->nkeys; k++)
+	{
+		comp = ApplySortComparator(x_values[k], x_isnull[k],
+								   y_values[k], y_isnull[k],
+								   &fcxt->ssup[k]);
+		if (comp != 0)
+		{
+			*p_depth = k;
+			return comp;
+		}
+	}
+	*p_depth = fcxt->nkeys;
+	return 0;
+}
+
+static int
+gpusort_fallback_qsort_comp(const void *__x, const void *__y, void *__arg)
+{
+	int		depth;
+
+	return gpusort_fallback_keycomp((gpusort_fallback_context *)__arg,
+									*((const cl_uint *)__x),
+									*((const cl_uint *)__y),
+									&depth);
+}
+
+static void
+gpusort_fallback_sort(gpusort_fallback_context *fcxt,
+					  TupleTableSlot *slot,
+					  HeapTuple tuple,
+					  kern_data_store *kds_src,
+					  cl_uint nkeys,
+					  AttrNumber *key_anums,
+					  SortSupport key_ssup,
+					  gpusortResultIndex *kresults)
+{
+	cl_uint		nitems = kds_src->nitems;
+	cl_uint		i, k;
+
+	memset(fcxt, 0, sizeof(gpusort_fallback_context));
+	fcxt->nkeys = nkeys;
+	fcxt->ssup = key_ssup;
+	fcxt->key_values = MemoryContextAllocHuge(CurrentMemoryContext,
+											  sizeof(Datum) *
+											  Max(nkeys, 1) * (size_t)nitems);
+	fcxt->key_isnull = MemoryContextAllocHuge(CurrentMemoryContext,
+											  sizeof(bool) *
+											  Max(nkeys, 1) * (size_t)nitems);
+	for (i=0; i < nitems; i++)
+	{
+		kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds_src, i);
+
+		tuple->t_len  = tupitem->t_len;
+		tuple->t_self = tupitem->t_self;
+		tuple->t_data = &tupitem->htup;
+		ExecStoreHeapTuple(tuple, slot, false);
+		slot_getallattrs(slot);
+		for (k=0; k < nkeys; k++)
+		{
+			int		j = key_anums[k] - 1;
+
+			fcxt->key_values[(size_t)i * nkeys + k] = slot->tts_values[j];
+			fcxt->key_isnull[(size_t)i * nkeys + k] = slot->tts_isnull[j];
+		}
+		kresults->results[i] = i;
+	}
+	kresults->nitems = nitems;
+	qsort_arg(kresults->results, nitems, sizeof(cl_uint),
+			  gpusort_fallback_qsort_comp, fcxt);
+}
+
+static cl_ulong
+gpuwinagg_fallback_datum(Oid type_oid, Datum datum)
+{
+	switch (type_oid)
+	{
+		case INT2OID:
+			return (cl_ulong)((cl_long)DatumGetInt16(datum));
+		case INT4OID:
+			return (cl_ulong)((cl_long)DatumGetInt32(datum));
+		case INT8OID:
+			return (cl_ulong)DatumGetInt64(datum);
+		case FLOAT4OID:
+			return (cl_ulong)Float8GetDatum((double)DatumGetFloat4(datum));
+		case FLOAT8OID:
+			return (cl_ulong)datum;
+		default:
+			break;
+	}
+	return 0;
+}
+
+static void
+gpuwinagg_cpu_fallback(GpuWinAggState *gwas, GpuWinAggTask *gwtask)
+{
+	ExprContext	   *econtext = gwas->gts.css.ss.ps.ps_ExprContext;
+	TupleTableSlot *slot = gwas->outer_slot;
+	HeapTuple		tuple = &gwas->outer_tuple;
+	kern_data_store *kds_src = &gwtask->pds_src->kds;
+	kern_gpuwinagg *kgwagg = gwtask->kgwagg;
+	gpusortResultIndex *kresults = KERN_GPUSORT_RESULT_INDEX(&gwtask->kern);
+	gpusort_fallback_context fcxt;
+	cl_uint			nitems = kds_src->nitems;
+	cl_uint			nkeys = gwas->nkeys;
+	cl_uint			nargs = gwas->nargs;
+	cl_ulong	   *arg_values = NULL;
+	bool		   *arg_isnull = NULL;
+	cl_char		   *heads;
+	cl_ulong	   *counts;
+	cl_uint			part_head = 0;
+	cl_uint			peer_head = 0;
+	cl_ulong		dense_rank = 0;
+	cl_uint			i, k, fn;
+	int				depth;
+
+	/* sort the outer rows */
+	gpusort_fallback_sort(&fcxt, slot, tuple, kds_src,
+						  nkeys, gwas->key_anums, gwas->key_ssup,
+						  kresults);
+
+	/* evaluate the arguments */
+	if (nargs > 0)
+	{
+		arg_values = MemoryContextAllocHuge(CurrentMemoryContext,
+											sizeof(cl_ulong) *
+											nargs * (size_t)nitems);
+		arg_isnull = MemoryContextAllocHuge(CurrentMemoryContext,
+											sizeof(bool) *
+											nargs * (size_t)nitems);
+	}
+	for (i=0; i < nitems && nargs > 0; i++)
+	{
+		kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds_src, i);
+
+		tuple->t_len  = tupitem->t_len;
+		tuple->t_self = tupitem->t_self;
+		tuple->t_data = &tupitem->htup;
+		ExecStoreHeapTuple(tuple, slot, false);
+		ResetExprContext(econtext);
+		econtext->ecxt_scantuple = slot;
+		for (k=0; k < nargs; k++)
+		{
+			Datum	datum;
+			bool	isnull;
+
+			datum = ExecEvalExpr(gwas->arg_states[k], econtext, &isnull);
+			arg_isnull[(size_t)i * nargs + k] = isnull;
+			arg_values[(size_t)i * nargs + k] =
+				(isnull ? 0 : gpuwinagg_fallback_datum(gwas->arg_types[k],
+													   datum));
+		}
+	}
+
+	/*
+	 * Forward scan; compute the ranking functions and running aggregates
+	 */
+	heads = MemoryContextAllocHuge(CurrentMemoryContext,
+								   sizeof(cl_char) * (size_t)nitems);
+	counts = MemoryContextAllocHuge(CurrentMemoryContext,
+									sizeof(cl_ulong) * Max(gwas->nfuncs, 1) *
+									(size_t)nitems);
+	for (i=0; i < nitems; i++)
+	{
+		cl_uint		pos = kresults->results[i];
+		bool		is_part_head = (i == 0);
+		bool		is_peer_head = (i == 0);
+
+		if (i > 0)
+		{
+			gpusort_fallback_keycomp(&fcxt, kresults->results[i-1],
+									 pos, &depth);
+			is_part_head = (depth < gwas->part_nkeys);
+			is_peer_head = (depth < nkeys);
+		}
+		if (is_part_head)
+		{
+			part_head = i;
+			dense_rank = 0;
+		}
+		if (is_peer_head)
+		{
+			peer_head = i;
+			dense_rank++;
+		}
+		heads[i] = (is_part_head ? 0x01 : 0) | (is_peer_head ? 0x02 : 0);
+
+		for (fn=0; fn < gwas->nfuncs; fn++)
+		{
+			cl_char		func = gwas->func_kinds[fn];
+			cl_short	argidx = gwas->func_argidx[fn];
+			cl_ulong   *values = KERN_GPUWINAGG_VALUES(kgwagg, fn);
+			cl_bool	   *isnull = KERN_GPUWINAGG_ISNULL(kgwagg, fn);
+			cl_ulong	value = 0;
+			cl_ulong	count;
+
+			switch (func)
+			{
+				case GPUWINAGG_FUNC__ROW_NUMBER:
+					values[i] = i - part_head + 1;
+					isnull[i] = false;
+					continue;
+				case GPUWINAGG_FUNC__RANK:
+					values[i] = peer_head - part_head + 1;
+					isnull[i] = false;
+					continue;
+				case GPUWINAGG_FUNC__DENSE_RANK:
+					values[i] = dense_rank;
+					isnull[i] = false;
+					continue;
+				default:
+					break;
+			}
+			if (argidx < 0)
+				count = 1;		/* count(*) */
+			else if (arg_isnull[(size_t)pos * nargs + argidx])
+				count = 0;
+			else
+			{
+				count = 1;
+				value = arg_values[(size_t)pos * nargs + argidx];
+			}
+
+			if (!is_part_head)
+			{
+				if (count > 0)
+					value = (counts[(size_t)fn * nitems + i - 1] > 0
+							 ? gpuwinagg_combine(func, values[i-1], value)
+							 : value);
+				else
+					value = values[i-1];
+				count += counts[(size_t)fn * nitems + i - 1];
+			}
+			values[i] = value;
+			counts[(size_t)fn * nitems + i] = count;
+		}
+	}
+
+	/*
+	 * Backward scan; pick up the value at the tail of the frame. The tail
+	 * of frame is tail of itself, so it can be processed in-place.
+	 */
+	if (gwas->nfuncs > 0)
+	{
+		cl_uint		part_tail = nitems - 1;
+		cl_uint		peer_tail = nitems - 1;
+
+		for (i=nitems; i > 0; i--)
+		{
+			cl_uint		index = i - 1;
+
+			if (index + 1 < nitems)
+			{
+				if ((heads[index + 1] & 0x01) != 0)
+					part_tail = index;
+				if ((heads[index + 1] & 0x02) != 0)
+					peer_tail = index;
+			}
+			for (fn=0; fn < gwas->nfuncs; fn++)
+			{
+				cl_char		func = gwas->func_kinds[fn];
+				cl_ulong   *values = KERN_GPUWINAGG_VALUES(kgwagg, fn);
+				cl_bool	   *isnull = KERN_GPUWINAGG_ISNULL(kgwagg, fn);
+				cl_ulong   *__counts = counts + (size_t)fn * nitems;
+				cl_uint		tail;
+
+				if (func == GPUWINAGG_FUNC__ROW_NUMBER ||
+					func == GPUWINAGG_FUNC__RANK ||
+					func == GPUWINAGG_FUNC__DENSE_RANK)
+					continue;
+				if (gwas->func_frames[fn] == GPUWINAGG_FRAME__ROWS_RUNNING)
+					tail = index;
+				else if (gwas->func_frames[fn] == GPUWINAGG_FRAME__PEER_RUNNING)
+					tail = peer_tail;
+				else
+					tail = part_tail;
+				values[index] = values[tail];
+				__counts[index] = __counts[tail];
+				if (func == GPUWINAGG_FUNC__COUNT)
+				{
+					values[index] = __counts[index];
+					isnull[index] = false;
+				}
+				else
+					isnull[index] = (__counts[index] == 0);
+			}
+		}
+	}
+	pfree(heads);
+	pfree(counts);
+	pfree(fcxt.key_values);
+	pfree(fcxt.key_isnull);
+	if (arg_values)
+		pfree(arg_values);
+	if (arg_isnull)
+		pfree(arg_isnull);
+}
+
+/*
+ * gpuwinagg_result_datum
+ *
+ * It transforms the result of window function to the datum.
+ */
+static Datum
+gpuwinagg_result_datum(Oid type_oid, cl_ulong value)
+{
+	switch (type_oid)
+	{
+		case INT2OID:
+			return Int16GetDatum((int16)(cl_long)value);
+		case INT4OID:
+			return Int32GetDatum((int32)(cl_long)value);
+		case INT8OID:
+			return Int64GetDatum((int64)value);
+		case FLOAT4OID:
+			return Float4GetDatum((float4)DatumGetFloat8((Datum)value));
+		case FLOAT8OID:
+			return (Datum)value;
+		default:
+			elog(ERROR, "Bug? unexpected result type of window function: %s",
+				 format_type_be(type_oid));
+	}
+	return 0;
+}
+
+/*
+ * gpuwinagg_next_tuple
+ */
+static TupleTableSlot *
+gpuwinagg_next_tuple(GpuTaskState *gts)
+{
+	GpuWinAggState *gwas = (GpuWinAggState *) gts;
+	GpuWinAggTask  *gwtask = (GpuWinAggTask *) gts->curr_task;
+	kern_data_store *kds_src = &gwtask->pds_src->kds;
+	kern_gpuwinagg *kgwagg = gwtask->kgwagg;
+	gpusortResultIndex *kresults = KERN_GPUSORT_RESULT_INDEX(&gwtask->kern);
+	TupleTableSlot *outer_slot = gwas->outer_slot;
+	TupleTableSlot *slot = gts->css.ss.ss_ScanTupleSlot;
+	HeapTuple		tuple = &gwas->outer_tuple;
+	kern_tupitem   *tupitem;
+	cl_uint			index;
+	cl_uint			fn;
+
+	if (gwtask->task.cpu_fallback && gts->curr_index == 0)
+		gpuwinagg_cpu_fallback(gwas, gwtask);
+	if (gts->curr_index >= kresults->nitems)
+		return NULL;
+	index = gts->curr_index++;
+
+	/* fetch the outer row */
+	tupitem = KERN_DATA_STORE_TUPITEM(kds_src, kresults->results[index]);
+	tuple->t_len  = tupitem->t_len;
+	tuple->t_self = tupitem->t_self;
+	tuple->t_data = &tupitem->htup;
+	ExecStoreHeapTuple(tuple, outer_slot, false);
+	slot_getallattrs(outer_slot);
+
+	/* outer columns, then window functions */
+	ExecClearTuple(slot);
+	memcpy(slot->tts_values, outer_slot->tts_values,
+		   sizeof(Datum) * gwas->num_input_cols);
+	memcpy(slot->tts_isnull, outer_slot->tts_isnull,
+		   sizeof(bool) * gwas->num_input_cols);
+	for (fn=0; fn < gwas->nfuncs; fn++)
+	{
+		cl_uint		j = gwas->num_input_cols + fn;
+		cl_ulong	value = KERN_GPUWINAGG_VALUES(kgwagg, fn)[index];
+
+		slot->tts_isnull[j] = KERN_GPUWINAGG_ISNULL(kgwagg, fn)[index];
+		slot->tts_values[j] = (slot->tts_isnull[j] ? 0 :
+							   gpuwinagg_result_datum(gwas->func_types[fn],
+													  value));
+	}
+	ExecStoreVirtualTuple(slot);
+
+	return slot;
+}
+
+/*
+ * gpuwinagg_cpu_cleanup
+ */
+static void
+gpuwinagg_cpu_cleanup(GpuWinAggState *gwas)
+{
+	if (gwas->cpu_next_slot)
+	{
+		ExecClearTuple(gwas->cpu_next_slot);
+		ExecClearTuple(gwas->cpu_head_slot);
+		ExecClearTuple(gwas->cpu_peer_slot);
+		ExecClearTuple(gwas->cpu_curr_slot);
+	}
+	if (gwas->cpu_sortstate)
+		tuplesort_end(gwas->cpu_sortstate);
+	if (gwas->cpu_tupstore)
+		tuplestore_end(gwas->cpu_tupstore);
+	gwas->cpu_sortstate = NULL;
+	gwas->cpu_tupstore = NULL;
+	gwas->cpu_part_loaded = false;
+	gwas->cpu_peer_peeked = false;
+	gwas->cpu_peer_nrows = 0;
+}
+
+/*
+ * gpuwinagg_cpu_keycomp
+ *
+ * It returns the depth of the first sort key different between the rows.
+ */
+static cl_uint
+gpuwinagg_cpu_keycomp(GpuWinAggState *gwas,
+					  TupleTableSlot *x_slot,
+					  TupleTableSlot *y_slot)
+{
+	cl_uint		k;
+
+	for (k=0; k < gwas->nkeys; k++)
+	{
+		AttrNumber	anum = gwas->key_anums[k];
+		Datum		x_datum, y_datum;
+		bool		x_isnull, y_isnull;
+
+		x_datum = slot_getattr(x_slot, anum, &x_isnull);
+		y_datum = slot_getattr(y_slot, anum, &y_isnull);
+		if (ApplySortComparator(x_datum, x_isnull,
+								y_datum, y_isnull,
+								&gwas->key_ssup[k]) != 0)
+			break;
+	}
+	return k;
+}
+
+/*
+ * gpuwinagg_cpu_accum_row
+ *
+ * It accumulates the arguments of the window aggregate functions.
+ */
+static void
+gpuwinagg_cpu_accum_row(GpuWinAggState *gwas,
+						TupleTableSlot *slot,
+						gpuwinagg_cpu_accum *accum)
+{
+	ExprContext	   *econtext = gwas->gts.css.ss.ps.ps_ExprContext;
+	cl_ulong		arg_values[GPUWINAGG_MAX_NARGS];
+	bool			arg_isnull[GPUWINAGG_MAX_NARGS];
+	cl_uint			k, fn;
+
+	ResetExprContext(econtext);
+	econtext->ecxt_scantuple = slot;
+	for (k=0; k < gwas->nargs; k++)
+	{
+		Datum	datum = ExecEvalExpr(gwas->arg_states[k], econtext,
+									 &arg_isnull[k]);
+
+		arg_values[k] = (arg_isnull[k] ? 0 :
+						 gpuwinagg_fallback_datum(gwas->arg_types[k], datum));
+	}
+
+	for (fn=0; fn < gwas->nfuncs; fn++)
+	{
+		cl_char		func = gwas->func_kinds[fn];
+		cl_short	argidx = gwas->func_argidx[fn];
+		cl_ulong	value = 0;
+
+		if (func == GPUWINAGG_FUNC__ROW_NUMBER ||
+			func == GPUWINAGG_FUNC__RANK ||
+			func == GPUWINAGG_FUNC__DENSE_RANK)
+			continue;
+		if (argidx >= 0)
+		{
+			if (arg_isnull[argidx])
+				continue;
+			value = arg_values[argidx];
+		}
+		accum[fn].value = (accum[fn].count > 0
+						   ? gpuwinagg_combine(func, accum[fn].value, value)
+						   : value);
+		accum[fn].count++;
+	}
+}
+
+/*
+ * gpuwinagg_cpu_load_partition
+ *
+ * It loads the rows of the next partition from the tuplesort onto the
+ * tuplestore, and computes the aggregates on the entire partition.
+ */
+static bool
+gpuwinagg_cpu_load_partition(GpuWinAggState *gwas)
+{
+	Tuplestorestate *tupstore = gwas->cpu_tupstore;
+	TupleTableSlot *next_slot = gwas->cpu_next_slot;
+	bool		has_part_frame = false;
+	cl_uint		fn;
+
+	if (!gwas->cpu_sortstate)
+	{
+		/* all the rows are already loaded as a single partition */
+		if (gwas->cpu_part_loaded)
+			return false;
+	}
+	else
+	{
+		if (TupIsNull(next_slot) &&
+			!tuplesort_gettupleslot(gwas->cpu_sortstate, true, false,
+									next_slot, NULL))
+			return false;
+		tuplestore_clear(tupstore);
+		tuplestore_puttupleslot(tupstore, next_slot);
+		ExecCopySlot(gwas->cpu_head_slot, next_slot);
+		for (;;)
+		{
+			if (!tuplesort_gettupleslot(gwas->cpu_sortstate, true, false,
+										next_slot, NULL))
+			{
+				ExecClearTuple(next_slot);
+				break;
+			}
+			if (gpuwinagg_cpu_keycomp(gwas, gwas->cpu_head_slot,
+									  next_slot) < gwas->part_nkeys)
+				break;
+			tuplestore_puttupleslot(tupstore, next_slot);
+		}
+	}
+	gwas->cpu_part_loaded = true;
+	gwas->cpu_peer_peeked = false;
+	gwas->cpu_peer_nrows = 0;
+	gwas->cpu_row_number = 0;
+	gwas->cpu_rank = 0;
+	gwas->cpu_dense_rank = 0;
+	memset(gwas->cpu_row_accum, 0, sizeof(gpuwinagg_cpu_accum) * gwas->nfuncs);
+	memset(gwas->cpu_peer_accum, 0, sizeof(gpuwinagg_cpu_accum) * gwas->nfuncs);
+	memset(gwas->cpu_part_accum, 0, sizeof(gpuwinagg_cpu_accum) * gwas->nfuncs);
+
+	/* aggregates on the entire partition */
+	for (fn=0; fn < gwas->nfuncs; fn++)
+	{
+		if (gwas->func_frames[fn] != GPUWINAGG_FRAME__ROWS_RUNNING &&
+			gwas->func_frames[fn] != GPUWINAGG_FRAME__PEER_RUNNING)
+			has_part_frame = true;
+	}
+	if (has_part_frame)
+	{
+		tuplestore_select_read_pointer(tupstore, gwas->cpu_peer_ptr);
+		while (tuplestore_gettupleslot(tupstore, true, false,
+									   gwas->cpu_peer_slot))
+			gpuwinagg_cpu_accum_row(gwas, gwas->cpu_peer_slot,
+									gwas->cpu_part_accum);
+		tuplestore_rescan(tupstore);
+		ExecClearTuple(gwas->cpu_peer_slot);
+	}
+	return true;
+}
+
+/*
+ * gpuwinagg_cpu_next_peers
+ *
+ * It looks ahead the rows of the next peer group in the current partition,
+ * to compute the aggregates on RANGE running frame.
+ */
+static bool
+gpuwinagg_cpu_next_peers(GpuWinAggState *gwas)
+{
+	Tuplestorestate *tupstore = gwas->cpu_tupstore;
+	TupleTableSlot *peer_slot = gwas->cpu_peer_slot;
+	cl_uint		nrows = 1;
+
+	tuplestore_select_read_pointer(tupstore, gwas->cpu_peer_ptr);
+	if (!gwas->cpu_peer_peeked &&
+		!tuplestore_gettupleslot(tupstore, true, false, peer_slot))
+		return false;
+	ExecCopySlot(gwas->cpu_head_slot, peer_slot);
+	gpuwinagg_cpu_accum_row(gwas, peer_slot, gwas->cpu_peer_accum);
+	gwas->cpu_peer_peeked = false;
+	while (tuplestore_gettupleslot(tupstore, true, false, peer_slot))
+	{
+		if (gpuwinagg_cpu_keycomp(gwas, gwas->cpu_head_slot,
+								  peer_slot) < gwas->nkeys)
+		{
+			gwas->cpu_peer_peeked = true;
+			break;
+		}
+		gpuwinagg_cpu_accum_row(gwas, peer_slot, gwas->cpu_peer_accum);
+		nrows++;
+	}
+	gwas->cpu_peer_nrows = nrows;
+	gwas->cpu_rank = gwas->cpu_row_number + 1;
+	gwas->cpu_dense_rank++;
+
+	return true;
+}
+
+/*
+ * gpuwinagg_cpu_next_tuple
+ *
+ * It returns the next row with window functions computed on CPU.
+ */
+static TupleTableSlot *
+gpuwinagg_cpu_next_tuple(GpuWinAggState *gwas)
+{
+	Tuplestorestate *tupstore = gwas->cpu_tupstore;
+	TupleTableSlot *curr_slot = gwas->cpu_curr_slot;
+	TupleTableSlot *slot = gwas->gts.css.ss.ss_ScanTupleSlot;
+	cl_uint		fn;
+
+	while (gwas->cpu_peer_nrows == 0)
+	{
+		if (gwas->cpu_part_loaded && gpuwinagg_cpu_next_peers(gwas))
+			break;
+		if (!gpuwinagg_cpu_load_partition(gwas))
+			return NULL;
+	}
+	tuplestore_select_read_pointer(tupstore, 0);
+	if (!tuplestore_gettupleslot(tupstore, true, false, curr_slot))
+		elog(ERROR, "Bug? GpuWindowAgg lost rows of the peer group");
+	gwas->cpu_peer_nrows--;
+	gwas->cpu_row_number++;
+	gpuwinagg_cpu_accum_row(gwas, curr_slot, gwas->cpu_row_accum);
+	slot_getallattrs(curr_slot);
+
+	/* outer columns, then window functions */
+	ExecClearTuple(slot);
+	memcpy(slot->tts_values, curr_slot->tts_values,
+		   sizeof(Datum) * gwas->num_input_cols);
+	memcpy(slot->tts_isnull, curr_slot->tts_isnull,
+		   sizeof(bool) * gwas->num_input_cols);
+	for (fn=0; fn < gwas->nfuncs; fn++)
+	{
+		cl_uint		j = gwas->num_input_cols + fn;
+		cl_char		func = gwas->func_kinds[fn];
+		gpuwinagg_cpu_accum *accum;
+		cl_ulong	value;
+		bool		isnull = false;
+
+		if (func == GPUWINAGG_FUNC__ROW_NUMBER)
+			value = gwas->cpu_row_number;
+		else if (func == GPUWINAGG_FUNC__RANK)
+			value = gwas->cpu_rank;
+		else if (func == GPUWINAGG_FUNC__DENSE_RANK)
+			value = gwas->cpu_dense_rank;
+		else
+		{
+			if (gwas->func_frames[fn] == GPUWINAGG_FRAME__ROWS_RUNNING)
+				accum = &gwas->cpu_row_accum[fn];
+			else if (gwas->func_frames[fn] == GPUWINAGG_FRAME__PEER_RUNNING)
+				accum = &gwas->cpu_peer_accum[fn];
+			else
+				accum = &gwas->cpu_part_accum[fn];
+			if (func == GPUWINAGG_FUNC__COUNT)
+				value = accum->count;
+			else
+			{
+				value = accum->value;
+				isnull = (accum->count == 0);
+			}
+		}
+		slot->tts_isnull[j] = isnull;
+		slot->tts_values[j] = (isnull ? 0 :
+							   gpuwinagg_result_datum(gwas->func_types[fn],
+													  value));
+	}
+	ExecStoreVirtualTuple(slot);
+
+	return slot;
+}
+
+/*
+ * __gpusort_launch_kernel
+ */
+static void
+__gpusort_launch_kernel(CUfunction kern_func,
+						cl_int grid_sz,
+						cl_int block_sz,
+						size_t shmem_sz,
+						void **kern_args)
+{
+	CUresult	rc;
+
+	rc = cuLaunchKernel(kern_func,
+						grid_sz, 1, 1,
+						block_sz, 1, 1,
+						shmem_sz,
+						CU_STREAM_PER_THREAD,
+						kern_args,
+						NULL);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuLaunchKernel: %s", errorText(rc));
+}
+
+/*
+ * gpusort_launch_sorting
+ *
+ * It launches the kernels to sort the kds_src; the sorted row-index shall
+ * be set on the gpusortResultIndex of kern_gpusort. If kradix is given,
+ * it runs the radix sort instead of the bitonic sorting.
+ */
+static void
+gpusort_launch_radix_sort(CUmodule cuda_module,
+						  CUdeviceptr m_gpusort,
+						  CUdeviceptr m_kds_src,
+						  CUdeviceptr m_kresults,
+						  kern_gpusort_radix *kradix,
+						  cl_uint nkeys)
+{
+	CUfunction		kern_radix_setup;
+	CUfunction		kern_radix_histogram;
+	CUfunction		kern_radix_prefix;
+	CUfunction		kern_radix_scatter;
+	CUdeviceptr		m_kradix = (CUdeviceptr)kradix;
+	cl_int			grid_sz;
+	cl_int			block_sz;
+	cl_uint			src_buf = 0;
+	cl_int			keyidx;
+	cl_uint			shift;
+	void		   *kern_args[5];
+	CUresult		rc;
+
+	rc = cuModuleGetFunction(&kern_radix_setup, cuda_module,
+							 "kern_gpusort_radix_setup");
+	if (rc == CUDA_SUCCESS)
+		rc = cuModuleGetFunction(&kern_radix_histogram, cuda_module,
+								 "kern_gpusort_radix_histogram");
+	if (rc == CUDA_SUCCESS)
+		rc = cuModuleGetFunction(&kern_radix_prefix, cuda_module,
+								 "kern_gpusort_radix_prefix");
+	if (rc == CUDA_SUCCESS)
+		rc = cuModuleGetFunction(&kern_radix_scatter, cuda_module,
+								 "kern_gpusort_radix_scatter");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_radix_setup,
+							 CU_DEVICE_PER_THREAD,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+
+	/* keys are sorted from the last one, by stable sort of each digit */
+	for (keyidx = nkeys - 1; keyidx >= 0; keyidx--)
+	{
+		/*
+		 * Launch:
+		 * KERNEL_FUNCTION(void)
+		 * kern_gpusort_radix_setup(kern_gpusort *kgpusort,
+		 *                          kern_data_store *kds_src,
+		 *                          kern_gpusort_radix *kradix,
+		 *                          cl_uint keyidx)
+		 */
+		kern_args[0] = &m_gpusort;
+		kern_args[1] = &m_kds_src;
+		kern_args[2] = &m_kradix;
+		kern_args[3] = &keyidx;
+		__gpusort_launch_kernel(kern_radix_setup,
+								grid_sz, block_sz, 0,
+								kern_args);
+
+		for (shift = 0;
+			 shift <= GPUSORT_RADIX_NULL_SHIFT;
+			 shift += GPUSORT_RADIX_BITS)
+		{
+			kern_args[0] = &m_gpusort;
+			kern_args[1] = &m_kradix;
+			kern_args[2] = &src_buf;
+			kern_args[3] = &shift;
+			__gpusort_launch_kernel(kern_radix_histogram,
+									kradix->nblocks,
+									GPUSORT_RADIX_BLOCKSZ, 0,
+									kern_args);
+			kern_args[0] = &m_gpusort;
+			kern_args[1] = &m_kradix;
+			__gpusort_launch_kernel(kern_radix_prefix,
+									1, MAXTHREADS_PER_BLOCK, 0,
+									kern_args);
+			kern_args[0] = &m_gpusort;
+			kern_args[1] = &m_kradix;
+			kern_args[2] = &src_buf;
+			kern_args[3] = &shift;
+			__gpusort_launch_kernel(kern_radix_scatter,
+									kradix->nblocks,
+									GPUSORT_RADIX_BLOCKSZ, 0,
+									kern_args);
+			src_buf = 1 - src_buf;
+		}
+	}
+
+	/* sorted index must be on the gpusortResultIndex */
+	if (src_buf != 0)
+	{
+		rc = cuMemcpyDtoDAsync(m_kresults + offsetof(gpusortResultIndex,
+													 results),
+							   m_kradix + kradix->index_offset,
+							   sizeof(cl_uint) * kradix->nitems,
+							   CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemcpyDtoDAsync: %s", errorText(rc));
+	}
+}
+
+static void
+gpusort_launch_sorting(CUmodule cuda_module,
+					   CUdeviceptr m_gpusort,
+					   CUdeviceptr m_kds_src,
+					   kern_gpusort_radix *kradix,
+					   cl_uint nkeys,
+					   cl_uint nitems)
+{
+	CUfunction		kern_setup_column;
+	CUfunction		kern_bitonic_local;
+	CUfunction		kern_bitonic_step;
+	CUfunction		kern_bitonic_merge;
+	CUdeviceptr		m_kresults;
+	cl_uint			partSize = 2 * BITONIC_MAX_LOCAL_SZ;
+	cl_int			grid_sz;
+	cl_int			block_sz;
+	cl_uint			blockSize;
+	cl_uint			unitSize;
+	cl_bool			reversing;
+	void		   *kern_args[4];
+	CUresult		rc;
+
+	rc = cuModuleGetFunction(&kern_setup_column, cuda_module,
+							 "kern_gpusort_setup_column");
+	if (rc == CUDA_SUCCESS)
+		rc = cuModuleGetFunction(&kern_bitonic_local, cuda_module,
+								 "kern_gpusort_bitonic_local");
+	if (rc == CUDA_SUCCESS)
+		rc = cuModuleGetFunction(&kern_bitonic_step, cuda_module,
+								 "kern_gpusort_bitonic_step");
+	if (rc == CUDA_SUCCESS)
+		rc = cuModuleGetFunction(&kern_bitonic_merge, cuda_module,
+								 "kern_gpusort_bitonic_merge");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	m_kresults = (CUdeviceptr)
+		KERN_GPUSORT_RESULT_INDEX((kern_gpusort *)m_gpusort);
+
+	/*
+	 * Launch:
+	 * KERNEL_FUNCTION(void)
+	 * kern_gpusort_setup_column(kern_gpusort *kgpusort,
+	 *                           kern_data_store *kds_src)
+	 */
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_setup_column,
+							 CU_DEVICE_PER_THREAD,
+							 0, sizeof(int));
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	kern_args[0] = &m_gpusort;
+	kern_args[1] = &m_kds_src;
+	__gpusort_launch_kernel(kern_setup_column,
+							grid_sz, block_sz,
+							sizeof(cl_int) * block_sz,	/* StairlikeSum */
+							kern_args);
+
+	if (kradix)
+	{
+		gpusort_launch_radix_sort(cuda_module, m_gpusort, m_kds_src,
+								  m_kresults, kradix, nkeys);
+		return;
+	}
+
+	/*
+	 * Launch: bitonic sorting
+	 *
+	 * kern_gpusort_bitonic_local sorts every partSize items on the local
+	 * memory, then larger blocks are merged by kern_gpusort_bitonic_step
+	 * (for steps larger than partSize) and kern_gpusort_bitonic_merge.
+	 */
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_bitonic_local,
+							 CU_DEVICE_PER_THREAD,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	kern_args[0] = &m_gpusort;
+	kern_args[1] = &m_kds_src;
+	__gpusort_launch_kernel(kern_bitonic_local,
+							(nitems + partSize - 1) / partSize,
+							block_sz, 0,
+							kern_args);
+	for (blockSize = 2 * partSize; blockSize / 2 < nitems; blockSize *= 2)
+	{
+		for (unitSize = blockSize; unitSize > partSize; unitSize /= 2)
+		{
+			cl_uint		nhalf = (blockSize / 2) *
+				((nitems + blockSize - 1) / blockSize);
+
+			rc = gpuOptimalBlockSize(&grid_sz,
+									 &block_sz,
+									 kern_bitonic_step,
+									 CU_DEVICE_PER_THREAD,
+									 0, 0);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+			reversing = (unitSize == blockSize);
+			kern_args[0] = &m_gpusort;
+			kern_args[1] = &m_kds_src;
+			kern_args[2] = &unitSize;
+			kern_args[3] = &reversing;
+			__gpusort_launch_kernel(kern_bitonic_step,
+									(nhalf + block_sz - 1) / block_sz,
+									block_sz, 0,
+									kern_args);
+		}
+		rc = gpuOptimalBlockSize(&grid_sz,
+								 &block_sz,
+								 kern_bitonic_merge,
+								 CU_DEVICE_PER_THREAD,
+								 0, 0);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+		kern_args[0] = &m_gpusort;
+		kern_args[1] = &m_kds_src;
+		__gpusort_launch_kernel(kern_bitonic_merge,
+								(nitems + partSize - 1) / partSize,
+								block_sz, 0,
+								kern_args);
+	}
+}
+
+/*
+ * gpuwinagg_process_task
+ */
+static int
+gpuwinagg_process_task(GpuTask *gtask, CUmodule cuda_module)
+{
+	GpuWinAggTask  *gwtask = (GpuWinAggTask *) gtask;
+	pgstrom_data_store *pds_src = gwtask->pds_src;
+	kern_gpuwinagg *kgwagg = gwtask->kgwagg;
+	cl_uint			nitems = pds_src->kds.nitems;
+	CUfunction		kern_wagg_setup;
+	CUfunction		kern_wagg_scan;
+	CUfunction		kern_wagg_final;
+	CUdeviceptr		m_gpusort = (CUdeviceptr)&gwtask->kern;
+	CUdeviceptr		m_kds_src = (CUdeviceptr)&pds_src->kds;
+	CUdeviceptr		m_kgwagg = (CUdeviceptr)kgwagg;
+	cl_int			grid_sz;
+	cl_int			block_sz;
+	cl_uint			distance;
+	cl_uint			src_buf = 0;
+	cl_bool			segmented;
+	void		   *kern_args[6];
+	CUresult		rc;
+
+	/*
+	 * Lookup kernel functions
+	 */
+	rc = cuModuleGetFunction(&kern_wagg_setup, cuda_module,
+							 "kern_gpuwinagg_setup");
+	if (rc == CUDA_SUCCESS)
+		rc = cuModuleGetFunction(&kern_wagg_scan, cuda_module,
+								 "kern_gpuwinagg_scan");
+	if (rc == CUDA_SUCCESS)
+		rc = cuModuleGetFunction(&kern_wagg_final, cuda_module,
+								 "kern_gpuwinagg_final");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	/* source data and working buffer */
+	rc = cuMemPrefetchAsync(m_kds_src,
+							pds_src->kds.length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	rc = cuMemPrefetchAsync(m_kgwagg,
+							gwtask->kgwagg_length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	/* sort the outer rows */
+	gpusort_launch_sorting(cuda_module, m_gpusort, m_kds_src,
+						   NULL, 0, nitems);
+
+	/*
+	 * Launch:
+	 * KERNEL_FUNCTION(void)
+	 * kern_gpuwinagg_setup(kern_gpusort *kgpusort,
+	 *                      kern_data_store *kds_src,
+	 *                      kern_gpuwinagg *kgwagg)
+	 */
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_wagg_setup,
+							 CU_DEVICE_PER_THREAD,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	kern_args[0] = &m_gpusort;
+	kern_args[1] = &m_kds_src;
+	kern_args[2] = &m_kgwagg;
+	__gpusort_launch_kernel(kern_wagg_setup,
+							grid_sz, block_sz, 0,
+							kern_args);
+
+	/*
+	 * Launch:
+	 * KERNEL_FUNCTION(void)
+	 * kern_gpuwinagg_scan(kern_gpusort *kgpusort,
+	 *                     kern_gpuwinagg *kgwagg,
+	 *                     cl_bool segmented,
+	 *                     cl_uint distance,
+	 *                     cl_uint src_buf)
+	 *
+	 * boundaries of partitions/peers first, then segmented accumulation.
+	 */
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_wagg_scan,
+							 CU_DEVICE_PER_THREAD,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	for (segmented = false; ; segmented = true)
+	{
+		for (distance = 1; distance < nitems; distance *= 2)
+		{
+			kern_args[0] = &m_gpusort;
+			kern_args[1] = &m_kgwagg;
+			kern_args[2] = &segmented;
+			kern_args[3] = &distance;
+			kern_args[4] = &src_buf;
+			__gpusort_launch_kernel(kern_wagg_scan,
+									grid_sz, block_sz, 0,
+									kern_args);
+			src_buf = 1 - src_buf;
+		}
+		if (segmented)
+			break;
+	}
+
+	/*
+	 * Launch:
+	 * KERNEL_FUNCTION(void)
+	 * kern_gpuwinagg_final(kern_gpusort *kgpusort,
+	 *                      kern_gpuwinagg *kgwagg,
+	 *                      cl_uint src_buf)
+	 */
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_wagg_final,
+							 CU_DEVICE_PER_THREAD,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	kern_args[0] = &m_gpusort;
+	kern_args[1] = &m_kgwagg;
+	kern_args[2] = &src_buf;
+	__gpusort_launch_kernel(kern_wagg_final,
+							grid_sz, block_sz, 0,
+							kern_args);
+
+	/* write back the results */
+	rc = cuMemPrefetchAsync(m_kgwagg + kgwagg->values_offset,
+							gwtask->kgwagg_length - kgwagg->values_offset,
+							CU_DEVICE_CPU,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+
+	/* Point of synchronization */
+	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventSynchronize: %s", errorText(rc));
+
+	memcpy(&gwtask->task.kerror,
+		   &gwtask->kern.kerror, sizeof(kern_errorbuf));
+	if (gwtask->task.kerror.errcode == ERRCODE_STROM_SUCCESS)
+	{
+		/* nothing to do */
+	}
+	else if (pgstrom_cpu_fallback_enabled &&
+			 (gwtask->task.kerror.errcode & ERRCODE_FLAGS_CPU_FALLBACK) != 0)
+	{
+		memset(&gwtask->task.kerror, 0, sizeof(kern_errorbuf));
+		gwtask->task.cpu_fallback = true;
+	}
+	else
+	{
+		/* raise an error */
+		gwtask->task.kerror.errcode &= ~ERRCODE_FLAGS_CPU_FALLBACK;
+	}
+	return 0;
+}
+
+/*
+ * gpuwinagg_release_task
+ */
+static void
+gpuwinagg_release_task(GpuTask *gtask)
+{
+	GpuWinAggTask  *gwtask = (GpuWinAggTask *) gtask;
+	GpuContext	   *gcontext = gtask->gts->gcontext;
+
+	if (gwtask->pds_src)
+		PDS_release(gwtask->pds_src);
+	if (gwtask->kgwagg)
+		gpuMemFree(gcontext, (CUdeviceptr)gwtask->kgwagg);
+	gpuMemFree(gcontext, (CUdeviceptr)gwtask);
+}
+
+/*
+ * gpusort_create_task
+ */
+static GpuTask *
+gpusort_create_task(GpuSortState *gss,
+					pgstrom_data_store *pds_src,
+					bool is_terminator)
+{
+	GpuContext	   *gcontext = gss->gts.gcontext;
+	kern_parambuf  *kparams = gss->gts.kern_params;
+	GpuSortTask	   *gstask;
+	cl_uint			nitems = (pds_src ? pds_src->kds.nitems : 0);
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+	size_t			head_sz;
+	size_t			length;
+
+	/* allocation of GpuSortTask with gpusortResultIndex */
+	head_sz = (offsetof(GpuSortTask, kern.kparams) +
+			   STROMALIGN(kparams->length));
+	length = head_sz + STROMALIGN(offsetof(gpusortResultIndex,
+										   results[nitems]));
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	gstask = (GpuSortTask *) m_deviceptr;
+	memset(gstask, 0, head_sz + offsetof(gpusortResultIndex, results));
+
+	pgstromInitGpuTask(&gss->gts, &gstask->task);
+	gstask->pds_src = pds_src;
+	gstask->topn_nitems = gss->topn_nitems;
+	gstask->is_terminator = is_terminator;
+	gstask->kern.nitems_in = nitems;
+	memcpy(KERN_GPUSORT_PARAMBUF(&gstask->kern),
+		   kparams,
+		   kparams->length);
+
+	/* working buffer of the radix sort */
+	if (gss->radix_sort && nitems > 1 &&
+		(is_terminator || gss->topn_nitems == 0 || nitems > gss->topn_nitems))
+	{
+		kern_gpusort_radix *kradix;
+		cl_uint		nblocks = ((nitems + GPUSORT_RADIX_TILESZ - 1) /
+							   GPUSORT_RADIX_TILESZ);
+		size_t		keys_offset = STROMALIGN(sizeof(kern_gpusort_radix));
+		size_t		nulls_offset = (keys_offset +
+									STROMALIGN(sizeof(cl_ulong) * nitems));
+		size_t		index_offset = (nulls_offset +
+									STROMALIGN(sizeof(cl_uchar) * nitems));
+		size_t		hist_offset = (index_offset +
+								   STROMALIGN(sizeof(cl_uint) * nitems));
+
+		length = hist_offset + STROMALIGN(sizeof(cl_uint) *
+										  GPUSORT_RADIX_NBUCKETS * nblocks);
+		rc = gpuMemAllocManaged(gcontext,
+								&m_deviceptr,
+								length,
+								CU_MEM_ATTACH_GLOBAL);
+		if (rc != CUDA_SUCCESS)
+		{
+			gpuMemFree(gcontext, (CUdeviceptr)gstask);
+			elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+		}
+		kradix = (kern_gpusort_radix *) m_deviceptr;
+		kradix->nitems = nitems;
+		kradix->nblocks = nblocks;
+		kradix->keys_offset = keys_offset;
+		kradix->nulls_offset = nulls_offset;
+		kradix->index_offset = index_offset;
+		kradix->hist_offset = hist_offset;
+		kradix->length = length;
+		gstask->kradix = kradix;
+	}
+	return &gstask->task;
+}
+
+/*
+ * gpusort_load_chunk
+ *
+ * It loads the outer rows onto a chunk.
+ */
+static pgstrom_data_store *
+gpusort_load_chunk(GpuSortState *gss)
+{
+	GpuTaskState   *gts = &gss->gts;
+	PlanState	   *outer_ps = outerPlanState(gss);
+	TupleDesc		tupdesc = ExecGetResultType(outer_ps);
+	pgstrom_data_store *pds = NULL;
+	TupleTableSlot *slot;
+
+	for (;;)
+	{
+		if (gts->scan_overflow)
+		{
+			if (gts->scan_overflow == (void *)(~0UL))
+				break;
+			slot = gts->scan_overflow;
+			gts->scan_overflow = NULL;
+		}
+		else
+		{
+			slot = ExecProcNode(outer_ps);
+			if (TupIsNull(slot))
+			{
+				gts->scan_overflow = (void *)(~0UL);
+				break;
+			}
+		}
+		/* create a new data-store on demand */
+		if (!pds)
+			pds = PDS_create_row(gts->gcontext,
+								 tupdesc,
+								 pgstrom_chunk_size());
+		if (!PDS_insert_tuple(pds, slot))
+		{
+			gts->scan_overflow = slot;
+			break;
+		}
+	}
+	return pds;
+}
+
+/*
+ * gpusort_next_task
+ *
+ * It loads the outer rows chunk by chunk. In case of GpuTopN, if the
+ * candidates of the chunks are piled up, they are sorted again to pick
+ * up the top-k rows.
+ */
+static GpuTask *
+gpusort_next_task(GpuTaskState *gts)
+{
+	GpuSortState   *gss = (GpuSortState *) gts;
+	pgstrom_data_store *pds;
+
+	if (gss->pds_merge &&
+		__kds_unpack(gss->pds_merge->kds.usage) >= pgstrom_chunk_size() / 2)
+	{
+		pds = gss->pds_merge;
+		gss->pds_merge = NULL;
+		return gpusort_create_task(gss, pds, false);
+	}
+	pds = gpusort_load_chunk(gss);
+	if (!pds)
+		return NULL;
+	return gpusort_create_task(gss, pds, false);
+}
+
+/*
+ * gpusort_terminator_task
+ *
+ * GpuTopN kicks the final sort of the top-k candidates of the chunks.
+ * GpuSort returns a task to merge the sorted chunks on CPU.
+ */
+static GpuTask *
+gpusort_terminator_task(GpuTaskState *gts, cl_bool *task_is_ready)
+{
+	GpuSortState   *gss = (GpuSortState *) gts;
+	pgstrom_data_store *pds = gss->pds_merge;
+
+	if (gss->terminator_done)
+		return NULL;
+	gss->terminator_done = true;
+	if (gss->topn_nitems == 0)
+	{
+		if (gss->num_sorted_tasks == 0)
+			return NULL;
+		*task_is_ready = true;
+		return gpusort_create_task(gss, NULL, true);
+	}
+	if (!pds)
+		return NULL;
+	gss->pds_merge = NULL;
+	*task_is_ready = false;
+
+	return gpusort_create_task(gss, pds, true);
+}
+
+/*
+ * gpusort_fetch_tuple
+ */
+static inline void
+gpusort_fetch_tuple(GpuSortState *gss, kern_data_store *kds, cl_uint index)
+{
+	kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds, index);
+	HeapTuple		tuple = &gss->outer_tuple;
+
+	tuple->t_len  = tupitem->t_len;
+	tuple->t_self = tupitem->t_self;
+	tuple->t_data = &tupitem->htup;
+	ExecStoreHeapTuple(tuple, gss->outer_slot, false);
+}
+
+/*
+ * gpusort_store_result
+ */
+static TupleTableSlot *
+gpusort_store_result(GpuSortState *gss, kern_data_store *kds, cl_uint index)
+{
+	TupleTableSlot *outer_slot = gss->outer_slot;
+	TupleTableSlot *slot = gss->gts.css.ss.ss_ScanTupleSlot;
+
+	gpusort_fetch_tuple(gss, kds, index);
+	slot_getallattrs(outer_slot);
+
+	ExecClearTuple(slot);
+	memcpy(slot->tts_values, outer_slot->tts_values,
+		   sizeof(Datum) * gss->num_input_cols);
+	memcpy(slot->tts_isnull, outer_slot->tts_isnull,
+		   sizeof(bool) * gss->num_input_cols);
+	ExecStoreVirtualTuple(slot);
+
+	return slot;
+}
+
+/*
+ * gpusort_merge_cursor_fetch
+ *
+ * It loads the sort keys of the current position of the sorted chunk.
+ */
+static void
+gpusort_merge_cursor_fetch(GpuSortState *gss, gpusort_merge_cursor *cursor)
+{
+	GpuSortTask	   *gstask = cursor->gstask;
+	kern_data_store *kds = &gstask->pds_src->kds;
+	gpusortResultIndex *kresults = KERN_GPUSORT_RESULT_INDEX(&gstask->kern);
+	TupleDesc		tupdesc = gss->outer_slot->tts_tupleDescriptor;
+	kern_tupitem   *tupitem;
+	HeapTupleData	tuple;
+	cl_uint			k;
+
+	tupitem = KERN_DATA_STORE_TUPITEM(kds, kresults->results[cursor->index]);
+	tuple.t_len  = tupitem->t_len;
+	tuple.t_self = tupitem->t_self;
+	tuple.t_tableOid = InvalidOid;
+	tuple.t_data = &tupitem->htup;
+	for (k=0; k < gss->nkeys; k++)
+	{
+		cursor->key_values[k] = heap_getattr(&tuple,
+											 gss->key_anums[k],
+											 tupdesc,
+											 &cursor->key_isnull[k]);
+	}
+}
+
+/*
+ * gpusort_merge_heap_comp
+ *
+ * NOTE: binaryheap is a max-heap, so comparison result is inverted.
+ */
+static int
+gpusort_merge_heap_comp(Datum a, Datum b, void *arg)
+{
+	GpuSortState   *gss = (GpuSortState *) arg;
+	gpusort_merge_cursor *x = &gss->merge_cursors[DatumGetInt32(a)];
+	gpusort_merge_cursor *y = &gss->merge_cursors[DatumGetInt32(b)];
+	cl_uint			k;
+	int				comp;
+
+	for (k=0; k < gss->nkeys; k++)
+	{
+		comp = ApplySortComparator(x->key_values[k], x->key_isnull[k],
+								   y->key_values[k], y->key_isnull[k],
+								   &gss->key_ssup[k]);
+		if (comp != 0)
+			return -comp;
+	}
+	return 0;
+}
+
+/*
+ * gpusort_merge_next_tuple
+ *
+ * k-way merge of the sorted chunks on CPU
+ */
+static TupleTableSlot *
+gpusort_merge_next_tuple(GpuSortState *gss)
+{
+	gpusort_merge_cursor *cursor;
+	TupleTableSlot *slot;
+	cl_uint			i;
+
+	if (!gss->merge_heap)
+	{
+		gss->merge_cursors = palloc0(sizeof(gpusort_merge_cursor) *
+									 gss->num_sorted_tasks);
+		gss->merge_heap = binaryheap_allocate(gss->num_sorted_tasks,
+											  gpusort_merge_heap_comp,
+											  gss);
+		for (i=0; i < gss->num_sorted_tasks; i++)
+		{
+			GpuSortTask	   *gstask = gss->sorted_tasks[i];
+
+			cursor = &gss->merge_cursors[i];
+			cursor->gstask = gstask;
+			cursor->index = 0;
+			cursor->nitems = KERN_GPUSORT_RESULT_INDEX(&gstask->kern)->nitems;
+			cursor->key_values = palloc0(sizeof(Datum) * gss->nkeys);
+			cursor->key_isnull = palloc0(sizeof(bool) * gss->nkeys);
+			if (cursor->nitems == 0)
+				continue;
+			gpusort_merge_cursor_fetch(gss, cursor);
+			binaryheap_add_unordered(gss->merge_heap, Int32GetDatum(i));
+		}
+		binaryheap_build(gss->merge_heap);
+	}
+	if (binaryheap_empty(gss->merge_heap))
+		return NULL;
+
+	i = DatumGetInt32(binaryheap_first(gss->merge_heap));
+	cursor = &gss->merge_cursors[i];
+	slot = gpusort_store_result(gss, &cursor->gstask->pds_src->kds,
+								KERN_GPUSORT_RESULT_INDEX(&cursor->gstask->kern)
+								->results[cursor->index]);
+	/* move to the next row of the chunk */
+	if (++cursor->index < cursor->nitems)
+	{
+		gpusort_merge_cursor_fetch(gss, cursor);
+		binaryheap_replace_first(gss->merge_heap, Int32GetDatum(i));
+	}
+	else
+	{
+		(void) binaryheap_remove_first(gss->merge_heap);
+	}
+	return slot;
+}
+
+/*
+ * gputopn_compact_candidates
+ *
+ * It sorts the candidates of GpuTopN on CPU, then returns a new data store
+ * that has only the top-k rows of them.
+ */
+static pgstrom_data_store *
+gputopn_compact_candidates(GpuSortState *gss, pgstrom_data_store *pds_old)
+{
+	kern_data_store *kds_old = &pds_old->kds;
+	TupleDesc	tupdesc = gss->outer_slot->tts_tupleDescriptor;
+	pgstrom_data_store *pds_new;
+	gpusortResultIndex *kresults;
+	gpusort_fallback_context fcxt;
+	cl_uint		i, nitems;
+
+	kresults = MemoryContextAllocHuge(CurrentMemoryContext,
+									  offsetof(gpusortResultIndex,
+											   results[kds_old->nitems]));
+	gpusort_fallback_sort(&fcxt,
+						  gss->outer_slot,
+						  &gss->outer_tuple,
+						  kds_old,
+						  gss->nkeys,
+						  gss->key_anums,
+						  gss->key_ssup,
+						  kresults);
+	pds_new = PDS_create_row(gss->gts.gcontext,
+							 tupdesc,
+							 kds_old->length);
+	nitems = Min(kresults->nitems, gss->topn_nitems);
+	for (i=0; i < nitems; i++)
+	{
+		gpusort_fetch_tuple(gss, kds_old, kresults->results[i]);
+		if (!PDS_insert_tuple(pds_new, gss->outer_slot))
+			elog(ERROR, "Bug? GpuTopN could not compact the candidate rows");
+	}
+	pfree(fcxt.key_values);
+	pfree(fcxt.key_isnull);
+	pfree(kresults);
+
+	return pds_new;
+}
+
+/*
+ * gpusort_next_tuple
+ */
+static TupleTableSlot *
+gpusort_next_tuple(GpuTaskState *gts)
+{
+	GpuSortState   *gss = (GpuSortState *) gts;
+	GpuSortTask	   *gstask = (GpuSortTask *) gts->curr_task;
+	kern_data_store *kds_src;
+	gpusortResultIndex *kresults = KERN_GPUSORT_RESULT_INDEX(&gstask->kern);
+	TupleTableSlot *outer_slot = gss->outer_slot;
+	cl_uint			nitems;
+	bool			all_items = false;
+	cl_uint			i;
+
+	/* GpuSort merges the sorted chunks */
+	if (!gstask->pds_src)
+	{
+		Assert(gss->topn_nitems == 0 && gstask->is_terminator);
+		return gpusort_merge_next_tuple(gss);
+	}
+	kds_src = &gstask->pds_src->kds;
+	nitems = kds_src->nitems;
+
+	if (gts->curr_index == 0)
+	{
+		if (nitems <= 1 ||
+			(!gstask->is_terminator && nitems <= gstask->topn_nitems))
+			all_items = true;	/* no need to sort */
+		else if (gstask->task.cpu_fallback)
+		{
+			gpusort_fallback_context fcxt;
+
+			gpusort_fallback_sort(&fcxt,
+								  outer_slot,
+								  &gss->outer_tuple,
+								  kds_src,
+								  gss->nkeys,
+								  gss->key_anums,
+								  gss->key_ssup,
+								  kresults);
+			pfree(fcxt.key_values);
+			pfree(fcxt.key_isnull);
+		}
+	}
+
+	if (gss->topn_nitems == 0)
+	{
+		/* GpuSort keeps the sorted chunk until the final merge */
+		if (all_items)
+		{
+			for (i=0; i < nitems; i++)
+				kresults->results[i] = i;
+			kresults->nitems = nitems;
+		}
+		if (gss->num_sorted_tasks >= gss->max_sorted_tasks)
+		{
+			gss->max_sorted_tasks = Max(2 * gss->max_sorted_tasks, 32);
+			if (!gss->sorted_tasks)
+				gss->sorted_tasks = palloc(sizeof(GpuSortTask *) *
+										   gss->max_sorted_tasks);
+			else
+				gss->sorted_tasks = repalloc(gss->sorted_tasks,
+											 sizeof(GpuSortTask *) *
+											 gss->max_sorted_tasks);
+		}
+		gss->sorted_tasks[gss->num_sorted_tasks++] = gstask;
+		/* detach the task not to be released */
+		gts->curr_task = NULL;
+		return NULL;
+	}
+
+	if (!gstask->is_terminator)
+	{
+		TupleDesc	tupdesc = outer_slot->tts_tupleDescriptor;
+
+		/* move the top-k rows of the chunk to the candidates */
+		if (gts->curr_index > 0)
+			return NULL;
+		nitems = Min(nitems, gstask->topn_nitems);
+		for (i=0; i < nitems; i++)
+		{
+			cl_uint		index = (all_items ? i : kresults->results[i]);
+			pgstrom_data_store *pds_new;
+
+			gpusort_fetch_tuple(gss, kds_src, index);
+			if (!gss->pds_merge)
+				gss->pds_merge = PDS_create_row(gts->gcontext,
+												tupdesc,
+												pgstrom_chunk_size());
+			while (!PDS_insert_tuple(gss->pds_merge, outer_slot))
+			{
+				pds_new = gpusort_expand_pds(gts->gcontext,
+											 gss->pds_merge,
+											 tupdesc,
+											 KDS_OFFSET_MAX_SIZE);
+				if (!pds_new)
+				{
+					/* picks up the top-k rows of the candidates on CPU */
+					pds_new = gputopn_compact_candidates(gss, gss->pds_merge);
+					if (pds_new->kds.nitems >= gss->pds_merge->kds.nitems)
+						elog(ERROR, "GpuTopN: too large candidate rows");
+					PDS_release(gss->pds_merge);
+					gpusort_fetch_tuple(gss, kds_src, index);
+				}
+				gss->pds_merge = pds_new;
+			}
+		}
+		gts->curr_index = nitems + 1;
+		return NULL;
+	}
+
+	/* final results of GpuTopN */
+	if (all_items)
+	{
+		if (gts->curr_index >= Min(nitems, gstask->topn_nitems))
+			return NULL;
+		return gpusort_store_result(gss, kds_src, gts->curr_index++);
+	}
+	if (gts->curr_index >= Min(kresults->nitems, gstask->topn_nitems))
+		return NULL;
+	return gpusort_store_result(gss, kds_src,
+								kresults->results[gts->curr_index++]);
+}
+
+/*
+ * gpusort_process_task
+ */
+static int
+gpusort_process_task(GpuTask *gtask, CUmodule cuda_module)
+{
+	GpuSortTask	   *gstask = (GpuSortTask *) gtask;
+	GpuSortState   *gss = (GpuSortState *) gtask->gts;
+	pgstrom_data_store *pds_src = gstask->pds_src;
+	cl_uint			nitems;
+	cl_uint			nresults;
+	CUdeviceptr		m_gpusort = (CUdeviceptr)&gstask->kern;
+	CUdeviceptr		m_kds_src;
+	CUdeviceptr		m_kresults;
+	CUresult		rc;
+
+	/* merge task of GpuSort runs on CPU */
+	if (!pds_src)
+		return 0;
+	/* a small chunk needs no sorting */
+	nitems = pds_src->kds.nitems;
+	if (nitems <= 1 ||
+		(!gstask->is_terminator && nitems <= gstask->topn_nitems))
+		return 0;
+
+	pgstromNvtxRangePush("GpuSort (plan=%d, seq=%u)",
+						 gtask->gts->css.ss.ps.plan->plan_id,
+						 gtask->task_seq);
+	m_kds_src = (CUdeviceptr)&pds_src->kds;
+	rc = cuMemPrefetchAsync(m_kds_src,
+							pds_src->kds.length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	if (gstask->kradix)
+	{
+		rc = cuMemPrefetchAsync((CUdeviceptr)gstask->kradix,
+								gstask->kradix->length,
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	}
+
+	/* sort the rows */
+	gpusort_launch_sorting(cuda_module, m_gpusort, m_kds_src,
+						   gstask->kradix, gss->nkeys, nitems);
+
+	/* write back the result index; only top-k rows for GpuTopN */
+	nresults = (gstask->topn_nitems == 0
+				? nitems
+				: Min(nitems, gstask->topn_nitems));
+	m_kresults = (CUdeviceptr)KERN_GPUSORT_RESULT_INDEX(&gstask->kern);
+	rc = cuMemPrefetchAsync(m_kresults,
+							offsetof(gpusortResultIndex,
+									 results[nresults]),
+							CU_DEVICE_CPU,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	if (gstask->topn_nitems == 0)
+	{
+		/* GpuSort also references the data store on the final merge */
+		rc = cuMemPrefetchAsync(m_kds_src,
+								pds_src->kds.length,
+								CU_DEVICE_CPU,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+	}
+
+	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+
+	/* Point of synchronization */
+	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventSynchronize: %s", errorText(rc));
+
+	memcpy(&gstask->task.kerror,
+		   &gstask->kern.kerror, sizeof(kern_errorbuf));
+	if (gstask->task.kerror.errcode == ERRCODE_STROM_SUCCESS)
+	{
+		/* nothing to do */
+	}
+	else if (pgstrom_cpu_fallback_enabled &&
+			 (gstask->task.kerror.errcode & ERRCODE_FLAGS_CPU_FALLBACK) != 0)
+	{
+		memset(&gstask->task.kerror, 0, sizeof(kern_errorbuf));
+		gstask->task.cpu_fallback = true;
+	}
+	else
+	{
+		/* raise an error */
+		gstask->task.kerror.errcode &= ~ERRCODE_FLAGS_CPU_FALLBACK;
+	}
+	pgstromNvtxRangePop();
+	return 0;
+}
+
+/*
+ * gpusort_release_task
+ */
+static void
+gpusort_release_task(GpuTask *gtask)
+{
+	GpuSortTask	   *gstask = (GpuSortTask *) gtask;
+	GpuContext	   *gcontext = gtask->gts->gcontext;
+
+	if (gstask->pds_src)
+		PDS_release(gstask->pds_src);
+	if (gstask->kradix)
+		gpuMemFree(gcontext, (CUdeviceptr)gstask->kradix);
+	gpuMemFree(gcontext, (CUdeviceptr)gstask);
+}
+
+/*
+ * pgstrom_init_gpusort
+ */
+void
+pgstrom_init_gpusort(void)
+{
+	/* pg_strom.enable_gpuwindowagg */
+	DefineCustomBoolVariable("pg_strom.enable_gpuwindowagg",
+							 "Enables the use of GPU window functions",
+							 NULL,
+							 &enable_gpuwinagg,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpuwindowagg_max_chunk_size */
+	DefineCustomIntVariable("pg_strom.gpuwindowagg_max_chunk_size",
+							"Maximum size of the chunk GpuWindowAgg loads all the outer rows on",
+							"0 means it is limited by the data store format only",
+							&gpuwinagg_max_chunk_size_kb,
+							0,
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
+	/* initialization of path method table */
+	memset(&gpuwinagg_path_methods, 0, sizeof(CustomPathMethods));
+	gpuwinagg_path_methods.CustomName          = "GpuWindowAgg";
+	gpuwinagg_path_methods.PlanCustomPath      = PlanGpuWinAggPath;
+
+	/* initialization of plan method table */
+	memset(&gpuwinagg_scan_methods, 0, sizeof(CustomScanMethods));
+	gpuwinagg_scan_methods.CustomName          = "GpuWindowAgg";
+	gpuwinagg_scan_methods.CreateCustomScanState
+		= CreateGpuWinAggScanState;
+	RegisterCustomScanMethods(&gpuwinagg_scan_methods);
+
+	/* initialization of exec method table */
+	memset(&gpuwinagg_exec_methods, 0, sizeof(CustomExecMethods));
+	gpuwinagg_exec_methods.CustomName          = "GpuWindowAgg";
+	gpuwinagg_exec_methods.BeginCustomScan     = ExecInitGpuWinAgg;
+	gpuwinagg_exec_methods.ExecCustomScan      = ExecGpuWinAgg;
+	gpuwinagg_exec_methods.EndCustomScan       = ExecEndGpuWinAgg;
+	gpuwinagg_exec_methods.ReScanCustomScan    = ExecReScanGpuWinAgg;
+	gpuwinagg_exec_methods.ExplainCustomScan   = ExplainGpuWinAgg;
+
+	/* pg_strom.enable_gputopn */
+	DefineCustomBoolVariable("pg_strom.enable_gputopn",
+							 "Enables the use of GPU Top-N sorting",
+							 NULL,
+							 &enable_gputopn,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* pg_strom.enable_gpusort */
+	DefineCustomBoolVariable("pg_strom.enable_gpusort",
+							 "Enables the use of GPU sorting",
+							 NULL,
+							 &enable_gpusort,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* pg_strom.gpusort_threshold */
+	DefineCustomRealVariable("pg_strom.gpusort_threshold",
+							 "Minimum number of rows to run GpuSort",
+							 NULL,
+							 &gpusort_threshold,
+							 100000.0,
+							 0.0,
+							 DBL_MAX,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* initialization of path method tables */
+	memset(&gputopn_path_methods, 0, sizeof(CustomPathMethods));
+	gputopn_path_methods.CustomName            = "GpuTopN";
+	gputopn_path_methods.PlanCustomPath        = PlanGpuSortPath;
+	memset(&gpusort_path_methods, 0, sizeof(CustomPathMethods));
+	gpusort_path_methods.CustomName            = "GpuSort";
+	gpusort_path_methods.PlanCustomPath        = PlanGpuSortPath;
+
+	/* initialization of plan method tables */
+	memset(&gputopn_scan_methods, 0, sizeof(CustomScanMethods));
+	gputopn_scan_methods.CustomName            = "GpuTopN";
+	gputopn_scan_methods.CreateCustomScanState = CreateGpuSortScanState;
+	RegisterCustomScanMethods(&gputopn_scan_methods);
+	memset(&gpusort_scan_methods, 0, sizeof(CustomScanMethods));
+	gpusort_scan_methods.CustomName            = "GpuSort";
+	gpusort_scan_methods.CreateCustomScanState = CreateGpuSortScanState;
+	RegisterCustomScanMethods(&gpusort_scan_methods);
+
+	/* initialization of exec method tables */
+	memset(&gputopn_exec_methods, 0, sizeof(CustomExecMethods));
+	gputopn_exec_methods.CustomName            = "GpuTopN";
+	gputopn_exec_methods.BeginCustomScan       = ExecInitGpuSort;
+	gputopn_exec_methods.ExecCustomScan        = ExecGpuSort;
+	gputopn_exec_methods.EndCustomScan         = ExecEndGpuSort;
+	gputopn_exec_methods.ReScanCustomScan      = ExecReScanGpuSort;
+	gputopn_exec_methods.ExplainCustomScan     = ExplainGpuSort;
+	memcpy(&gpusort_exec_methods, &gputopn_exec_methods,
+		   sizeof(CustomExecMethods));
+	gpusort_exec_methods.CustomName            = "GpuSort";
+
+	/* hook registration */
+	create_upper_paths_next = create_upper_paths_hook;
+	create_upper_paths_hook = gpusort_add_upper_paths;
+}
@@ -22,16 +22,25 @@ struct shared_mmap_segment
 	dlist_node		chain;
 	ResourceOwner	resowner;
 	uint32			handle;
+	char			filename[MAXPGPATH];
 	bool			needs_cleanup;
 	void		   *mapped_address;
 	size_t			mapped_length;
+	bool			host_registered;	/* page-locked by CUDA driver */
 };
 
 static dlist_head	shared_mmap_segment_list;
+static char		   *inner_spill_dir = NULL;			/* GUC */
+static int			inner_spill_threshold_mb;		/* GUC */
 
-
-
-
+/*
+ * A segment larger than pg_strom.inner_spill_threshold is moved to a file
+ * on the pg_strom.inner_spill_dir (usually, on NVMe-SSD), instead of the
+ * POSIX shared memory on RAM. The kernel writes back and evicts its pages
+ * under memory pressure, and the device can load the pages by SSD2GPU
+ * Direct. The highest bit of the handle identifies the spilled segment.
+ */
+#define SHARED_MMAP_SPILLED_HANDLE		0x80000000U
 
 /*
  * NOTE: PG12 removed dsm_resize() because it didn't handle failure of
@@ -39,14 +48,47 @@ static dlist_head	shared_mmap_segment_list;
  * So, we have *_expand() API instead, because we only try to expand
  * shared memory segment, and it nevet hits problematic scenario.
  */
-#define shared_mmap_filename(namebuf, handle)	\
-	snprintf((namebuf), sizeof(namebuf), "/pg_strom.%08x", (handle))
+static void
+shared_mmap_filename(char *namebuf, size_t namelen, uint32 handle)
+{
+	if ((handle & SHARED_MMAP_SPILLED_HANDLE) == 0)
+		snprintf(namebuf, namelen, "/pg_strom.%08x", handle);
+	else if (inner_spill_dir)
+		snprintf(namebuf, namelen, "%s/pg_strom.%08x",
+				 inner_spill_dir, handle);
+	else
+		elog(ERROR, "pg_strom.inner_spill_dir is not configured");
+}
+
+static int
+shared_mmap_open(const char *name, uint32 handle, int flags)
+{
+	if ((handle & SHARED_MMAP_SPILLED_HANDLE) == 0)
+		return shm_open(name, flags, 0600);
+	return open(name, flags, 0600);
+}
+
+static int
+shared_mmap_unlink(const char *name, uint32 handle)
+{
+	if ((handle & SHARED_MMAP_SPILLED_HANDLE) == 0)
+		return shm_unlink(name);
+	return unlink(name);
+}
+
+static inline bool
+shared_mmap_needs_spill(size_t size)
+{
+	return (inner_spill_dir != NULL &&
+			inner_spill_dir[0] != '\0' &&
+			size > ((size_t)inner_spill_threshold_mb << 20));
+}
 
 shared_mmap_segment *
 shared_mmap_create(size_t required)
 {
 	size_t		size = TYPEALIGN(PAGE_SIZE, required);
-	char		name[64];
+	char		name[MAXPGPATH];
 	uint32		handle;
 	int			rc, fdesc = -1;
 	void	   *address;
@@ -58,9 +100,13 @@ shared_mmap_create(size_t required)
 	{
 		do {
 			handle = ((uint32)MyProcPid ^ (uint32)random());
-			shared_mmap_filename(name, handle);
+			if (shared_mmap_needs_spill(size))
+				handle |= SHARED_MMAP_SPILLED_HANDLE;
+			else
+				handle &= ~SHARED_MMAP_SPILLED_HANDLE;
+			shared_mmap_filename(name, sizeof(name), handle);
 
-			fdesc = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+			fdesc = shared_mmap_open(name, handle, O_CREAT | O_EXCL | O_RDWR);
 			if (fdesc < 0 && errno != EEXIST)
 				elog(ERROR, "could not open shared memory segment \"%s\": %m",
 					 name);
@@ -83,7 +129,7 @@ shared_mmap_create(size_t required)
 	{
 		if (fdesc >= 0)
 		{
-			shm_unlink(name);
+			shared_mmap_unlink(name, handle);
 			close(fdesc);
 		}
 		pfree(shm_seg);
@@ -93,6 +139,7 @@ shared_mmap_create(size_t required)
 
 	shm_seg->resowner = CurrentResourceOwner;
 	shm_seg->handle = handle;
+	strcpy(shm_seg->filename, name);
 	shm_seg->needs_cleanup = true;
 	shm_seg->mapped_address = address;
 	shm_seg->mapped_length = size;
@@ -104,7 +151,7 @@ shared_mmap_create(size_t required)
 shared_mmap_segment *
 shared_mmap_attach(uint32 handle)
 {
-	char		name[64];
+	char		name[MAXPGPATH];
 	int			fdesc = -1;
 	struct stat	st_buf;
 	void	   *address;
@@ -114,8 +161,8 @@ shared_mmap_attach(uint32 handle)
 									 sizeof(shared_mmap_segment));
 	PG_TRY();
 	{
-		shared_mmap_filename(name, handle);
-		fdesc = shm_open(name, O_RDWR, 0600);
+		shared_mmap_filename(name, sizeof(name), handle);
+		fdesc = shared_mmap_open(name, handle, O_RDWR);
 		if (fdesc < 0)
 			elog(ERROR, "could not open shared memory segment \"%s\": %m",
 				 name);
@@ -141,6 +188,7 @@ shared_mmap_attach(uint32 handle)
 
 	shm_seg->resowner = CurrentResourceOwner;
 	shm_seg->handle = handle;
+	strcpy(shm_seg->filename, name);
 	shm_seg->needs_cleanup = false;
 	shm_seg->mapped_address = address;
 	shm_seg->mapped_length = st_buf.st_size;
@@ -152,9 +200,14 @@ shared_mmap_attach(uint32 handle)
 void
 shared_mmap_detach(shared_mmap_segment *shm_seg)
 {
-	char		name[64];
-
-	shared_mmap_filename(name, shm_seg->handle);
+	const char *name = shm_seg->filename;
+
+	/*
+	 * registration shall be already released if CUDA context that made
+	 * it was destroyed, so its failure is not a problem here.
+	 */
+	if (shm_seg->host_registered)
+		(void) cuMemHostUnregister(shm_seg->mapped_address);
 	if (munmap(shm_seg->mapped_address,
 			   shm_seg->mapped_length) != 0)
 	{
@@ -163,17 +216,87 @@ shared_mmap_detach(shared_mmap_segment *shm_seg)
 	}
 	if (shm_seg->needs_cleanup)
 	{
-		if (shm_unlink(name) != 0)
+		if (shared_mmap_unlink(name, shm_seg->handle) != 0)
 			elog(WARNING, "failed on shm_link(\"%s\"): %m", name);
 	}
 	dlist_delete(&shm_seg->chain);
 	pfree(shm_seg);
 }
 
+/*
+ * shared_mmap_spill - moves the segment to a file on the spill directory
+ */
+static void *
+shared_mmap_spill(shared_mmap_segment *shm_seg, size_t new_size)
+{
+	char		name[MAXPGPATH];
+	uint32		handle;
+	int			rc, fdesc = -1;
+	void	   *address;
+
+	Assert((shm_seg->handle & SHARED_MMAP_SPILLED_HANDLE) == 0);
+	if (!shm_seg->needs_cleanup)
+		elog(ERROR, "Bug? attached shared memory segment cannot spill");
+	PG_TRY();
+	{
+		handle = shm_seg->handle | SHARED_MMAP_SPILLED_HANDLE;
+		for (;;)
+		{
+			shared_mmap_filename(name, sizeof(name), handle);
+			fdesc = open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+			if (fdesc >= 0)
+				break;
+			if (errno != EEXIST)
+				elog(ERROR, "could not open spill file \"%s\": %m", name);
+			handle = (((uint32)MyProcPid ^ (uint32)random()) |
+					  SHARED_MMAP_SPILLED_HANDLE);
+		}
+
+		do {
+			rc = posix_fallocate(fdesc, 0, new_size);
+			if (rc < 0 && errno != EINTR)
+				elog(ERROR, "failed on posix_fallocate on \"%s\": %m", name);
+		} while (rc != 0);
+
+		address = mmap(NULL, new_size, PROT_READ | PROT_WRITE,
+					   MAP_SHARED, fdesc, 0);
+		if (address == MAP_FAILED)
+			elog(ERROR, "failed on mmap on \"%s\": %m", name);
+		close(fdesc);
+	}
+	PG_CATCH();
+	{
+		if (fdesc >= 0)
+		{
+			unlink(name);
+			close(fdesc);
+		}
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	memcpy(address, shm_seg->mapped_address, shm_seg->mapped_length);
+	if (munmap(shm_seg->mapped_address,
+			   shm_seg->mapped_length) != 0)
+		elog(WARNING, "failed on munmap(\"%s\", %zu): %m",
+			 shm_seg->filename, shm_seg->mapped_length);
+	if (shm_unlink(shm_seg->filename) != 0)
+		elog(WARNING, "failed on shm_unlink(\"%s\"): %m", shm_seg->filename);
+	elog(DEBUG1, "shared memory segment \"%s\" (%zu bytes) spilled to \"%s\"",
+		 shm_seg->filename, shm_seg->mapped_length, name);
+
+	shm_seg->handle = handle;
+	strcpy(shm_seg->filename, name);
+	shm_seg->mapped_address = address;
+	shm_seg->mapped_length = new_size;
+
+	return address;
+}
+
 void *
 shared_mmap_expand(shared_mmap_segment *shm_seg, size_t new_size)
 {
-	char		name[64];
+	const char *name = shm_seg->filename;
 	int			fdesc;
 	void	   *address;
 	struct stat	st_buf;
@@ -181,9 +304,13 @@ shared_mmap_expand(shared_mmap_segment *shm_seg, size_t new_size)
 	new_size = TYPEALIGN(PAGE_SIZE, new_size);
 	if (new_size <= shm_seg->mapped_length)
 		goto skip;	/* nothing to do */
+	if (shm_seg->host_registered)
+		elog(ERROR, "Bug? page-locked shared memory segment cannot expand");
+	if ((shm_seg->handle & SHARED_MMAP_SPILLED_HANDLE) == 0 &&
+		shared_mmap_needs_spill(new_size))
+		return shared_mmap_spill(shm_seg, new_size);
 
-	shared_mmap_filename(name, shm_seg->handle);
-	fdesc = shm_open(name, O_RDWR, 0600);
+	fdesc = shared_mmap_open(name, shm_seg->handle, O_RDWR);
 	if (fdesc < 0)
 		elog(ERROR, "could not open shared memory segment \"%s\": %m",
 			 name);
@@ -210,6 +337,7 @@ shared_mmap_expand(shared_mmap_segment *shm_seg, size_t new_size)
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
+	close(fdesc);
 skip:
 	return shm_seg->mapped_address;
 }
@@ -232,6 +360,102 @@ shared_mmap_handle(struct shared_mmap_segment *shm_seg)
 	return shm_seg->handle;
 }
 
+/*
+ * shared_mmap_host_register
+ *
+ * It page-locks the mapping as portable host memory, so DMA from/to any
+ * CUDA context can run without the staging copy by the driver. Caller
+ * must have a current CUDA context. It returns false if not registered,
+ * however, the mapping is still available as pageable memory.
+ */
+bool
+shared_mmap_host_register(shared_mmap_segment *shm_seg)
+{
+	CUresult	rc;
+
+	if (shm_seg->host_registered)
+		return true;
+	/* page-locking of the spilled segment makes no sense */
+	if ((shm_seg->handle & SHARED_MMAP_SPILLED_HANDLE) != 0)
+		return false;
+	rc = cuMemHostRegister(shm_seg->mapped_address,
+						   shm_seg->mapped_length,
+						   CU_MEMHOSTREGISTER_PORTABLE);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(DEBUG2, "failed on cuMemHostRegister: %s", errorText(rc));
+		return false;
+	}
+	shm_seg->host_registered = true;
+	return true;
+}
+
+/*
+ * shared_mmap_host_unregister
+ *
+ * Caller must have the CUDA context used for the registration.
+ */
+void
+shared_mmap_host_unregister(shared_mmap_segment *shm_seg)
+{
+	CUresult	rc;
+
+	if (!shm_seg->host_registered)
+		return;
+	rc = cuMemHostUnregister(shm_seg->mapped_address);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuMemHostUnregister: %s", errorText(rc));
+	shm_seg->host_registered = false;
+}
+
+/*
+ * shared_mmap_load_device
+ *
+ * It loads the head @length bytes of the segment spilled to the file onto
+ * the device memory at @m_deviceptr by SSD2GPU Direct, so pages evicted
+ * from the page cache are not read back to RAM. It returns false if the
+ * segment is not spilled, or SSD2GPU Direct is not available on the file,
+ * then caller has to copy the mapped image by itself.
+ * Caller must set the CUDA context current.
+ */
+bool
+shared_mmap_load_device(shared_mmap_segment *shm_seg,
+						GpuContext *gcontext,
+						CUdeviceptr m_deviceptr, size_t length)
+{
+	int			fdesc;
+	bool		result;
+
+	if ((shm_seg->handle & SHARED_MMAP_SPILLED_HANDLE) == 0)
+		return false;
+	Assert(length <= shm_seg->mapped_length);
+	/* SSD2GPU Direct reads the storage, so dirty pages must be written */
+	if (msync(shm_seg->mapped_address, length, MS_SYNC) != 0)
+		elog(ERROR, "failed on msync(\"%s\"): %m", shm_seg->filename);
+
+	fdesc = open(shm_seg->filename, O_RDONLY);
+	if (fdesc < 0)
+		elog(ERROR, "could not open spill file \"%s\": %m",
+			 shm_seg->filename);
+	PG_TRY();
+	{
+		cufileRegisterFileDesc(fdesc);
+		result = gpuMemCopyFromSSDFile(gcontext, m_deviceptr,
+									   fdesc, length);
+		cufileUnregisterFileDesc(fdesc);
+	}
+	PG_CATCH();
+	{
+		cufileUnregisterFileDesc(fdesc);
+		close(fdesc);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	close(fdesc);
+
+	return result;
+}
+
 static void
 shared_mmap_callback(ResourceReleasePhase phase,
 					 bool is_commit, bool is_toplevel, void *arg)
@@ -257,6 +481,26 @@ shared_mmap_callback(ResourceReleasePhase phase,
 void
 pgstrom_init_inners(void)
 {
+	/* pg_strom.inner_spill_dir */
+	DefineCustomStringVariable("pg_strom.inner_spill_dir",
+							   "directory to spill large inner buffers of GpuJoin",
+							   NULL,
+							   &inner_spill_dir,
+							   NULL,
+							   PGC_SUSET,
+							   GUC_NOT_IN_SAMPLE,
+							   NULL, NULL, NULL);
+	/* pg_strom.inner_spill_threshold */
+	DefineCustomIntVariable("pg_strom.inner_spill_threshold",
+							"size of the inner buffer to be spilled to the file",
+							NULL,
+							&inner_spill_threshold_mb,
+							2048,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_MB,
+							NULL, NULL, NULL);
 	dlist_init(&shared_mmap_segment_list);
 
 	RegisterResourceReleaseCallback(shared_mmap_callback, NULL);
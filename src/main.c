@@ -25,8 +25,13 @@ PG_MODULE_MAGIC;
 bool		pgstrom_enabled;
 bool		pgstrom_debug_kernel_source;
 bool		pgstrom_cpu_fallback_enabled;
+bool		pgstrom_cpu_exec_while_build;
 bool		pgstrom_regression_test_mode;
 static int	pgstrom_chunk_size_kb;
+int			pgstrom_chunk_target_latency;
+int			pgstrom_io_uring_depth = 0;
+bool		pgstrom_io_uring_direct = false;
+bool		pgstrom_enable_nvtx = false;
 
 /* cost factors */
 double		pgstrom_gpu_setup_cost;
@@ -35,6 +40,7 @@ double		pgstrom_gpu_operator_cost;
 
 /* misc static variables */
 static planner_hook_type	planner_hook_next;
+static ExplainOneQuery_hook_type explain_one_query_next;
 static CustomPathMethods	pgstrom_dummy_path_methods;
 static CustomScanMethods	pgstrom_dummy_plan_methods;
 
@@ -75,6 +81,15 @@ pgstrom_init_common_guc(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* turn on/off CPU execution while GPU program is not built yet */
+	DefineCustomBoolVariable("pg_strom.cpu_exec_while_build",
+							 "Enables CPU execution of chunks until GPU program gets built",
+							 NULL,
+							 &pgstrom_cpu_exec_while_build,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* turn on/off cuda kernel source saving */
 	DefineCustomBoolVariable("pg_strom.debug_kernel_source",
 							 "Turn on/off to display the kernel source path",
@@ -95,6 +110,17 @@ pgstrom_init_common_guc(void)
 							PGC_INTERNAL,
 							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
 							NULL, NULL, NULL);
+	/* target latency per GpuTask for adaptive chunk sizing */
+	DefineCustomIntVariable("pg_strom.chunk_target_latency",
+							"target latency per GpuTask to adjust chunk size",
+							"0 means fixed chunk size by pg_strom.chunk_size",
+							&pgstrom_chunk_target_latency,
+							0,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_MS,
+							NULL, NULL, NULL);
 	/* cost factor for Gpu setup */
 	DefineCustomRealVariable("pg_strom.gpu_setup_cost",
 							 "Cost to setup GPU device to run",
@@ -128,6 +154,38 @@ pgstrom_init_common_guc(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+#ifdef HAVE_LIBURING
+	/* asynchronous filesystem i/o by io_uring */
+	DefineCustomIntVariable("pg_strom.io_uring_depth",
+							"Max number of in-flight read requests of io_uring (0 disables)",
+							NULL,
+							&pgstrom_io_uring_depth,
+							64,
+							0,
+							1024,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomBoolVariable("pg_strom.io_uring_direct",
+							 "Enables O_DIRECT read by io_uring",
+							 NULL,
+							 &pgstrom_io_uring_direct,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+#endif
+#ifdef HAVE_NVTX
+	/* NVTX range annotations for Nsight Systems */
+	DefineCustomBoolVariable("pg_strom.enable_nvtx",
+							 "Enables NVTX range annotations for Nsight profiling",
+							 NULL,
+							 &pgstrom_enable_nvtx,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+#endif
 	/* disables some platform specific EXPLAIN output */
 	DefineCustomBoolVariable("pg_strom.regression_test_mode",
 							 "Disables some platform specific output in EXPLAIN; that can lead undesired test failed but harmless",
@@ -139,6 +197,78 @@ pgstrom_init_common_guc(void)
 							 NULL, NULL, NULL);
 }
 
+#ifdef HAVE_NVTX
+/*
+ * __pgstromNvtxRangePush
+ *
+ * It pushes a named NVTX range. Note that it can be called by GPU worker
+ * threads also, so it must not touch any PostgreSQL's infrastructure.
+ */
+void
+__pgstromNvtxRangePush(const char *fmt, ...)
+{
+	char		namebuf[200];
+	va_list		ap;
+
+	va_start(ap, fmt);
+	vsnprintf(namebuf, sizeof(namebuf), fmt, ap);
+	va_end(ap);
+	nvtxRangePushA(namebuf);
+}
+#endif
+
+/*
+ * pgstrom_get_tuple_bound
+ *
+ * It returns the number of rows required by the LIMIT clause, if @rel
+ * is the only source of the query result and no other operations that
+ * reduce or reorder rows (aggregation, sorting, ...) run on the way.
+ * Elsewhere, -1 shall be returned.
+ */
+cl_long
+pgstrom_get_tuple_bound(PlannerInfo *root, RelOptInfo *rel)
+{
+	Query	   *parse = root->parse;
+	Const	   *con;
+	cl_long		count;
+	cl_long		offset = 0;
+
+	if (parse->commandType != CMD_SELECT ||
+		parse->hasAggs ||
+		parse->hasWindowFuncs ||
+		parse->hasTargetSRFs ||
+		parse->groupClause != NIL ||
+		parse->groupingSets != NIL ||
+		parse->havingQual != NULL ||
+		parse->distinctClause != NIL ||
+		parse->sortClause != NIL ||
+		parse->setOperations != NULL ||
+		parse->rowMarks != NIL ||
+		parse->limitCount == NULL)
+		return -1;
+	if (rel->reloptkind != RELOPT_BASEREL &&
+		rel->reloptkind != RELOPT_JOINREL)
+		return -1;
+	if (!bms_equal(rel->relids, root->all_baserels))
+		return -1;
+
+	con = (Const *) parse->limitCount;
+	if (!IsA(con, Const) || con->constisnull)
+		return -1;
+	count = DatumGetInt64(con->constvalue);
+	if (count < 0)
+		return -1;
+	if (parse->limitOffset)
+	{
+		con = (Const *) parse->limitOffset;
+		if (!IsA(con, Const))
+			return -1;
+		if (!con->constisnull)
+			offset = Max(DatumGetInt64(con->constvalue), 0);
+	}
+	return count + offset;
+}
+
 /*
  * pgstrom_create_dummy_path
  */
@@ -366,6 +496,57 @@ pgstrom_post_planner(Query *parse,
 	return pstmt;
 }
 
+/*
+ * pgstrom_explain_one_query
+ *
+ * It shows the reason why expressions were not offloaded to GPU devices
+ * during the planning, on EXPLAIN VERBOSE.
+ */
+static void
+pgstrom_explain_one_query(Query *query,
+						  int cursorOptions,
+						  IntoClause *into,
+						  ExplainState *es,
+						  const char *queryString,
+						  ParamListInfo params,
+						  QueryEnvironment *queryEnv)
+{
+	uint64		seqno = pgstrom_devexpr_reject_seqno();
+	List	   *rejects = NIL;
+	ListCell   *lc;
+
+	if (explain_one_query_next)
+	{
+		(*explain_one_query_next)(query, cursorOptions, into, es,
+								  queryString, params, queryEnv);
+		if (es->verbose)
+			rejects = pgstrom_devexpr_reject_reasons(seqno);
+	}
+	else
+	{
+		PlannedStmt *plan;
+		instr_time	planstart;
+		instr_time	planduration;
+
+		INSTR_TIME_SET_CURRENT(planstart);
+		plan = pg_plan_query(query, cursorOptions, params);
+		INSTR_TIME_SET_CURRENT(planduration);
+		INSTR_TIME_SUBTRACT(planduration, planstart);
+		/* pick up the rejections prior to execution by EXPLAIN ANALYZE */
+		if (es->verbose)
+			rejects = pgstrom_devexpr_reject_reasons(seqno);
+		ExplainOnePlan(plan, into, es, queryString, params, queryEnv,
+					   &planduration);
+	}
+
+	if (!pgstrom_enabled ||
+		pgstrom_regression_test_mode ||
+		es->format != EXPLAIN_FORMAT_TEXT)
+		return;
+	foreach (lc, rejects)
+		ExplainPropertyText("GPU Offload Rejected", lfirst(lc), es);
+}
+
 /*
  * commercial_license_expired_at
  */
@@ -582,8 +763,10 @@ _PG_init(void)
 	pgstrom_init_gpujoin();
 	pgstrom_init_inners();
 	pgstrom_init_gpupreagg();
+	pgstrom_init_gpusort();
 	pgstrom_init_relscan();
 	pgstrom_init_arrow_fdw();
+	pgstrom_init_ccache();
 
 	/* check commercial license, if any */
 	check_heterodb_license();
@@ -602,4 +785,7 @@ _PG_init(void)
 	/* planner hook registration */
 	planner_hook_next = planner_hook;
 	planner_hook = pgstrom_post_planner;
+	/* explain hook registration */
+	explain_one_query_next = ExplainOneQuery_hook;
+	ExplainOneQuery_hook = pgstrom_explain_one_query;
 }
@@ -694,6 +694,7 @@ Datum pgstrom_random_int8range(PG_FUNCTION_ARGS);
 Datum pgstrom_random_tsrange(PG_FUNCTION_ARGS);
 Datum pgstrom_random_tstzrange(PG_FUNCTION_ARGS);
 Datum pgstrom_random_daterange(PG_FUNCTION_ARGS);
+Datum pgstrom_random_fill(PG_FUNCTION_ARGS);
 Datum pgstrom_abort_if(PG_FUNCTION_ARGS);
 
 static unsigned int		pgstrom_random_seed = 0;
@@ -1284,6 +1285,299 @@ pgstrom_random_daterange(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_random_daterange);
 
+/*
+ * pgstrom_random_fill
+ *
+ * It fills up the supplied heap table with random data for the benchmark
+ * purpose. Values are generated per column using the above generators,
+ * then inserted using multi-insert API by batch.
+ */
+#define RANDOM_FILL_NSLOTS		1000
+
+typedef enum
+{
+	RANDOM_FILL_CONV__NONE = 0,
+	RANDOM_FILL_CONV__INT2,
+	RANDOM_FILL_CONV__INT4,
+	RANDOM_FILL_CONV__FLOAT4,
+	RANDOM_FILL_CONV__NUMERIC,
+} randomFillConv;
+
+typedef struct
+{
+	bool		attisdropped;
+	FmgrInfo	flinfo;
+	int			nargs;
+	Datum		args[3];
+	bool		nulls[3];
+	randomFillConv conv;
+} randomFillColumn;
+
+static void
+setup_random_fill_column(randomFillColumn *rfcol,
+						 Form_pg_attribute attr, float8 ratio)
+{
+	PGFunction	func = NULL;
+
+	memset(rfcol, 0, sizeof(randomFillColumn));
+	if (attr->attisdropped)
+	{
+		rfcol->attisdropped = true;
+		return;
+	}
+	rfcol->nargs = 3;
+	rfcol->args[0] = Float8GetDatum(attr->attnotnull ? 0.0 : ratio);
+	rfcol->nulls[1] = true;
+	rfcol->nulls[2] = true;
+	switch (attr->atttypid)
+	{
+		case INT2OID:
+			func = pgstrom_random_int;
+			rfcol->args[2] = Int64GetDatum(SHRT_MAX);
+			rfcol->nulls[2] = false;
+			rfcol->conv = RANDOM_FILL_CONV__INT2;
+			break;
+		case INT4OID:
+			func = pgstrom_random_int;
+			rfcol->conv = RANDOM_FILL_CONV__INT4;
+			break;
+		case INT8OID:
+			func = pgstrom_random_int;
+			break;
+		case FLOAT4OID:
+			func = pgstrom_random_float;
+			rfcol->conv = RANDOM_FILL_CONV__FLOAT4;
+			break;
+		case FLOAT8OID:
+			func = pgstrom_random_float;
+			break;
+		case NUMERICOID:
+			func = pgstrom_random_float;
+			rfcol->conv = RANDOM_FILL_CONV__NUMERIC;
+			break;
+		case DATEOID:
+			func = pgstrom_random_date;
+			break;
+		case TIMEOID:
+			func = pgstrom_random_time;
+			break;
+		case TIMETZOID:
+			func = pgstrom_random_timetz;
+			break;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			func = pgstrom_random_timestamp;
+			break;
+		case MACADDROID:
+			func = pgstrom_random_macaddr;
+			break;
+		case INETOID:
+			func = pgstrom_random_inet;
+			rfcol->nargs = 2;
+			break;
+		case TEXTOID:
+		case VARCHAROID:
+			func = pgstrom_random_text_length;
+			rfcol->nargs = 2;
+			if (attr->atttypmod > VARHDRSZ)
+			{
+				rfcol->args[1] = Int32GetDatum(attr->atttypmod - VARHDRSZ);
+				rfcol->nulls[1] = false;
+			}
+			break;
+		case INT4RANGEOID:
+			func = pgstrom_random_int4range;
+			break;
+		case INT8RANGEOID:
+			func = pgstrom_random_int8range;
+			break;
+		case TSRANGEOID:
+			func = pgstrom_random_tsrange;
+			break;
+		case TSTZRANGEOID:
+			func = pgstrom_random_tstzrange;
+			break;
+		case DATERANGEOID:
+			func = pgstrom_random_daterange;
+			break;
+		default:
+			elog(ERROR, "%s: column \"%s\" has unsupported type: %s",
+				 __FUNCTION__, NameStr(attr->attname),
+				 format_type_be(attr->atttypid));
+	}
+	rfcol->flinfo.fn_addr = func;
+	rfcol->flinfo.fn_oid = InvalidOid;
+	rfcol->flinfo.fn_nargs = rfcol->nargs;
+	rfcol->flinfo.fn_strict = false;
+	rfcol->flinfo.fn_retset = false;
+	rfcol->flinfo.fn_mcxt = CurrentMemoryContext;
+}
+
+static Datum
+exec_random_fill_column(randomFillColumn *rfcol, bool *p_isnull)
+{
+	LOCAL_FCINFO(fcinfo, 3);
+	Datum		datum;
+	int			i;
+
+	InitFunctionCallInfoData(*fcinfo, &rfcol->flinfo, rfcol->nargs,
+							 InvalidOid, NULL, NULL);
+	for (i=0; i < rfcol->nargs; i++)
+	{
+		FC_ARG(fcinfo, i) = rfcol->args[i];
+		FC_NULL(fcinfo, i) = rfcol->nulls[i];
+	}
+	datum = FunctionCallInvoke(fcinfo);
+	*p_isnull = fcinfo->isnull;
+	if (fcinfo->isnull)
+		return 0;
+
+	switch (rfcol->conv)
+	{
+		case RANDOM_FILL_CONV__INT2:
+			return Int16GetDatum((int16)DatumGetInt64(datum));
+		case RANDOM_FILL_CONV__INT4:
+			return Int32GetDatum((int32)DatumGetInt64(datum));
+		case RANDOM_FILL_CONV__FLOAT4:
+			return Float4GetDatum((float4)DatumGetFloat8(datum));
+		case RANDOM_FILL_CONV__NUMERIC:
+			return DirectFunctionCall1(float8_numeric, datum);
+		default:
+			break;
+	}
+	return datum;
+}
+
+Datum
+pgstrom_random_fill(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int64		nrows = PG_GETARG_INT64(1);
+	float8		ratio = PG_GETARG_FLOAT8(2);
+	Relation	rel;
+	TupleDesc	tupdesc;
+	AclResult	aclresult;
+	List	   *index_list;
+	randomFillColumn *rfcols;
+	BulkInsertState bistate;
+	CommandId	mycid = GetCurrentCommandId(true);
+	MemoryContext batch_cxt;
+	MemoryContext oldcxt;
+#if PG_VERSION_NUM >= 120000
+	TupleTableSlot **slots;
+#else
+	HeapTuple  *tuples;
+	Datum	   *values;
+	bool	   *isnull;
+#endif
+	int64		count = 0;
+	int			i, j;
+
+	if (nrows < 0)
+		elog(ERROR, "%s: number of rows must not be negative", __FUNCTION__);
+	if (ratio < 0.0 || ratio > 100.0)
+		elog(ERROR, "%s: NULL ratio must be in range of 0.0 - 100.0%%",
+			 __FUNCTION__);
+
+	rel = table_open(relid, RowExclusiveLock);
+	if (RelationGetForm(rel)->relkind != RELKIND_RELATION)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a regular table",
+						RelationGetRelationName(rel)),
+				 errhint("use INSERT ... SELECT with pgstrom.random_*() instead")));
+	aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_INSERT);
+	if (aclresult != ACLCHECK_OK)
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("permission denied for table %s",
+						RelationGetRelationName(rel))));
+	/*
+	 * multi-insert API does not maintain indexes, triggers and constraints,
+	 * so we expect an empty table to be loaded before index creation.
+	 */
+	index_list = RelationGetIndexList(rel);
+	if (index_list != NIL ||
+		(rel->trigdesc != NULL) ||
+		(rel->rd_att->constr != NULL && rel->rd_att->constr->num_check > 0))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s: table \"%s\" has indexes, triggers or CHECK constraints",
+						__FUNCTION__, RelationGetRelationName(rel)),
+				 errhint("create them after data loading")));
+
+	tupdesc = RelationGetDescr(rel);
+	rfcols = palloc0(sizeof(randomFillColumn) * tupdesc->natts);
+	for (j=0; j < tupdesc->natts; j++)
+		setup_random_fill_column(&rfcols[j], tupleDescAttr(tupdesc, j), ratio);
+
+	batch_cxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "random_fill batch context",
+									  ALLOCSET_DEFAULT_SIZES);
+	bistate = GetBulkInsertState();
+#if PG_VERSION_NUM >= 120000
+	slots = palloc0(sizeof(TupleTableSlot *) * RANDOM_FILL_NSLOTS);
+	for (i=0; i < RANDOM_FILL_NSLOTS; i++)
+		slots[i] = table_slot_create(rel, NULL);
+#else
+	tuples = palloc0(sizeof(HeapTuple) * RANDOM_FILL_NSLOTS);
+	values = palloc0(sizeof(Datum) * tupdesc->natts);
+	isnull = palloc0(sizeof(bool) * tupdesc->natts);
+#endif
+	while (count < nrows)
+	{
+		int		nitems = Min(nrows - count, RANDOM_FILL_NSLOTS);
+
+		CHECK_FOR_INTERRUPTS();
+
+		MemoryContextReset(batch_cxt);
+		oldcxt = MemoryContextSwitchTo(batch_cxt);
+		for (i=0; i < nitems; i++)
+		{
+#if PG_VERSION_NUM >= 120000
+			TupleTableSlot *slot = slots[i];
+			Datum  *values = slot->tts_values;
+			bool   *isnull = slot->tts_isnull;
+
+			ExecClearTuple(slot);
+#endif
+			for (j=0; j < tupdesc->natts; j++)
+			{
+				if (rfcols[j].attisdropped)
+				{
+					values[j] = 0;
+					isnull[j] = true;
+				}
+				else
+					values[j] = exec_random_fill_column(&rfcols[j],
+														&isnull[j]);
+			}
+#if PG_VERSION_NUM >= 120000
+			ExecStoreVirtualTuple(slot);
+#else
+			tuples[i] = heap_form_tuple(tupdesc, values, isnull);
+#endif
+		}
+		MemoryContextSwitchTo(oldcxt);
+#if PG_VERSION_NUM >= 120000
+		table_multi_insert(rel, slots, nitems, mycid, 0, bistate);
+#else
+		heap_multi_insert(rel, tuples, nitems, mycid, 0, bistate);
+#endif
+		count += nitems;
+	}
+#if PG_VERSION_NUM >= 120000
+	for (i=0; i < RANDOM_FILL_NSLOTS; i++)
+		ExecDropSingleTupleTableSlot(slots[i]);
+#endif
+	FreeBulkInsertState(bistate);
+	MemoryContextDelete(batch_cxt);
+	table_close(rel, NoLock);
+
+	PG_RETURN_INT64(count);
+}
+PG_FUNCTION_INFO_V1(pgstrom_random_fill);
+
 Datum
 pgstrom_abort_if(PG_FUNCTION_ARGS)
 {
@@ -16,6 +16,11 @@
  * GNU General Public License for more details.
  */
 #include "pg_strom.h"
+#ifdef HAVE_CUFILE
+#include <cufile.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
 
 /*
  * NvmeAttributes - properties of NVMe disks
@@ -57,8 +62,19 @@ typedef struct PCIDevEntry	PCIDevEntry;
 static HTAB		   *nvmeHash = NULL;
 static bool			nvme_strom_enabled;			/* GUC */
 static int			nvme_strom_threshold_kb;	/* GUC */
+static bool			nvme_strom_partial_enabled;	/* GUC */
+static int			nvme_strom_visibility_xids;	/* GUC */
 static char		   *nvme_manual_distance_map;	/* GUC */
+static int			nvme_bandwidth_limit_mb;	/* GUC */
+static int			nvme_role_bandwidth_limit_mb;	/* GUC */
+static int			nvme_max_inflight_mb;		/* GUC */
+#ifdef HAVE_CUFILE
+static bool			gpudirect_storage_enabled;	/* GUC */
+static int			nvme_queue_depth;			/* GUC */
+#endif
+static shmem_startup_hook_type shmem_startup_next = NULL;
 static void			apply_nvme_manual_distance_map(void);
+Datum				pgstrom_nvme_io_stats(PG_FUNCTION_ARGS);
 static bool			sysfs_read_pcie_root_complex(const char *dirname,
 												 const char *my_name,
 												 List **p_pcie_root);
@@ -71,6 +87,31 @@ nvme_strom_threshold(void)
 	return (Size)nvme_strom_threshold_kb << 10;
 }
 
+/*
+ * nvme_strom_partial_scan
+ *
+ * It allows SSD-to-GPU Direct on the relations smaller than the threshold,
+ * and routes the blocks already on the page cache to the host path.
+ */
+bool
+nvme_strom_partial_scan(void)
+{
+	return nvme_strom_enabled && nvme_strom_partial_enabled;
+}
+
+/*
+ * nvme_strom_visibility_window
+ *
+ * Max number of transactions whose commit status is shipped to GPU, to check
+ * MVCC visibility of the blocks not all-visible. 0 means these blocks are
+ * always loaded through the shared buffer.
+ */
+int
+nvme_strom_visibility_window(void)
+{
+	return nvme_strom_visibility_xids;
+}
+
 /*
  * nvme_strom_ioctl
  */
@@ -720,6 +761,7 @@ typedef struct
 {
 	Oid		tablespace_oid;
 	int		nvme_optimal_gpu;
+	cl_ulong nvme_optimal_gpus;	/* mask of GPUs close to the NVMe devices */
 } vfs_nvme_status;
 
 static HTAB	   *vfs_nvme_htable = NULL;
@@ -735,18 +777,720 @@ vfs_nvme_cache_callback(Datum arg, int cacheid, uint32 hashvalue)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *
+ * GPUDirect Storage (cuFile) backend
+ *
+ * It performs as an alternative of the nvme_strom kernel module, but
+ * behind the same APIs. Files are registered by nvme_sstate_open_files()
+ * for heap scan, or on demand for Arrow files. The i/o mapped segments are
+ * registered to cuFile at the allocation time.
+ *
+ * ---------------------------------------------------------------- */
+#ifdef HAVE_CUFILE
+typedef struct
+{
+	CUfileHandle_t	fhandle;
+	dev_t			st_dev;
+	ino_t			st_ino;
+	bool			registered;
+	/* stripe geometry, if md-raid0 volume */
+	cl_uint			md_chunk_sz;
+	cl_int			md_nr_disks;
+} cufileFileHandle;
+
+static pthread_mutex_t	cufile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool				cufile_driver_opened = false;
+static cufileFileHandle *cufile_handles = NULL;
+static int				cufile_handles_nslots = 0;
+
+#define CUFILE_BATCH_MAX_NR		128
+
+#define EXT4_SUPER_MAGIC		0xEF53
+#define XFS_SUPER_MAGIC			0x58465342
+#define NFS_SUPER_MAGIC			0x6969
+#define LUSTRE_SUPER_MAGIC		0x0BD00BD0
+#define GPFS_SUPER_MAGIC		0x47504653
+#define BEEGFS_SUPER_MAGIC		0x19830326
+
+/*
+ * __cufileDriverOpen - open the cuFile driver on the first use
+ */
+static bool
+__cufileDriverOpen(void)
+{
+	CUfileError_t	status;
+
+	if (cufile_driver_opened)
+		return true;
+	status = cuFileDriverOpen();
+	if (status.err != CU_FILE_SUCCESS)
+		return false;
+	cufile_driver_opened = true;
+	return true;
+}
+
+/*
+ * __cufileSetupStripeGeometry - stripe chunk size and number of the disks
+ * if @st_dev is md-raid0 volume.
+ */
+static void
+__cufileSetupStripeGeometry(cufileFileHandle *entry, dev_t st_dev)
+{
+	char		path[MAXPGPATH];
+	const char *temp;
+	int			nr_disks;
+	unsigned int chunk_sz;
+
+	entry->md_chunk_sz = 0;
+	entry->md_nr_disks = 0;
+
+	snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/md/level",
+			 major(st_dev), minor(st_dev));
+	temp = sysfs_read_line(path, false);
+	if (!temp || strcmp(temp, "raid0") != 0)
+		return;
+
+	snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/md/raid_disks",
+			 major(st_dev), minor(st_dev));
+	temp = sysfs_read_line(path, false);
+	if (!temp || sscanf(temp, "%d", &nr_disks) != 1 || nr_disks <= 1)
+		return;
+
+	snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/md/chunk_size",
+			 major(st_dev), minor(st_dev));
+	temp = sysfs_read_line(path, false);
+	if (!temp || sscanf(temp, "%u", &chunk_sz) != 1 || chunk_sz == 0)
+		return;
+
+	entry->md_chunk_sz = chunk_sz;
+	entry->md_nr_disks = nr_disks;
+}
+
+/*
+ * __cufileLookupFileDesc - lookup or register the cuFile handle
+ *
+ * cufile_mutex must be held by the caller. Because the raw file descriptor
+ * may be closed and reused for another file, st_dev/st_ino are also
+ * checked.
+ */
+static cufileFileHandle *
+__cufileLookupFileDesc(int fdesc)
+{
+	cufileFileHandle *entry;
+	CUfileDescr_t	descr;
+	CUfileError_t	status;
+	struct stat		st_buf;
+
+	if (fdesc < 0 || fstat(fdesc, &st_buf) != 0)
+		return NULL;
+	if (fdesc >= cufile_handles_nslots)
+	{
+		int		nslots = Max(2 * cufile_handles_nslots, fdesc + 64);
+		cufileFileHandle *handles;
+
+		handles = realloc(cufile_handles, sizeof(cufileFileHandle) * nslots);
+		if (!handles)
+			return NULL;
+		memset(handles + cufile_handles_nslots, 0,
+			   sizeof(cufileFileHandle) * (nslots - cufile_handles_nslots));
+		cufile_handles = handles;
+		cufile_handles_nslots = nslots;
+	}
+	entry = &cufile_handles[fdesc];
+	if (entry->registered)
+	{
+		if (entry->st_dev == st_buf.st_dev &&
+			entry->st_ino == st_buf.st_ino)
+			return entry;
+		cuFileHandleDeregister(entry->fhandle);
+		entry->registered = false;
+	}
+	if (!__cufileDriverOpen())
+		return NULL;
+	memset(&descr, 0, sizeof(CUfileDescr_t));
+	descr.handle.fd = fdesc;
+	descr.type = CU_FILE_HANDLE_TYPE_OPAQUE_FD;
+	status = cuFileHandleRegister(&entry->fhandle, &descr);
+	if (status.err != CU_FILE_SUCCESS)
+		return NULL;
+	entry->st_dev = st_buf.st_dev;
+	entry->st_ino = st_buf.st_ino;
+	entry->registered = true;
+	__cufileSetupStripeGeometry(entry, st_buf.st_dev);
+
+	return entry;
+}
+
+/*
+ * __cufileOptimalGpuForBlockDev - the optimal GPU of the block device
+ * according to the distance map. md-raid volumes are resolved to the
+ * underlying devices, and all of them must have the same optimal GPU.
+ */
+static int
+__cufileOptimalGpuForBlockDev(const char *sysfs_path, int depth)
+{
+	char		path[MAXPGPATH];
+	char		dev_path[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *dent;
+	char	   *pos;
+	int			optimal_gpu = -1;
+
+	if (depth > 8 || !realpath(sysfs_path, dev_path))
+		return -1;
+
+	/* md-raid volume? */
+	snprintf(path, sizeof(path), "%s/slaves", dev_path);
+	dir = opendir(path);
+	if (dir)
+	{
+		bool	has_slaves = false;
+
+		while ((dent = readdir(dir)) != NULL)
+		{
+			int		curr_gpu;
+
+			if (dent->d_name[0] == '.')
+				continue;
+			has_slaves = true;
+			snprintf(path, sizeof(path), "/sys/class/block/%s", dent->d_name);
+			curr_gpu = __cufileOptimalGpuForBlockDev(path, depth+1);
+			if (curr_gpu < 0 ||
+				(optimal_gpu >= 0 && optimal_gpu != curr_gpu))
+			{
+				optimal_gpu = -1;
+				break;
+			}
+			optimal_gpu = curr_gpu;
+		}
+		closedir(dir);
+		if (has_slaves)
+			return optimal_gpu;
+	}
+
+	/*
+	 * Elsewhere, walk up the sysfs path (e.g, .../nvme/nvme0/nvme0n1/
+	 * nvme0n1p1) to the NVMe controller, then lookup the distance map.
+	 */
+	while ((pos = strrchr(dev_path, '/')) != NULL)
+	{
+		const char *name = pos + 1;
+
+		if (strncmp(name, "nvme", 4) == 0 &&
+			name[4] != '\0' &&
+			strspn(name + 4, "0123456789") == strlen(name + 4))
+		{
+			NvmeAttributes	key;
+			NvmeAttributes *nvme;
+			const char *temp;
+
+			snprintf(path, sizeof(path), "%s/dev", dev_path);
+			temp = sysfs_read_line(path, false);
+			if (!temp || !nvmeHash ||
+				sscanf(temp, "%d:%d",
+					   &key.nvme_major,
+					   &key.nvme_minor) != 2)
+				return -1;
+			nvme = hash_search(nvmeHash, &key, HASH_FIND, NULL);
+			return (nvme ? nvme->nvme_optimal_gpu : -1);
+		}
+		*pos = '\0';
+	}
+	return -1;
+}
+
+static int
+__cufileOptimalGpuForFile(int fdesc, const char *pathname)
+{
+	struct statfs	stfs_buf;
+	struct stat		st_buf;
+	char			path[MAXPGPATH];
+
+	/* only filesystems supported by GPUDirect Storage */
+	if (fstatfs(fdesc, &stfs_buf) != 0)
+		return -1;
+	switch (stfs_buf.f_type)
+	{
+		case EXT4_SUPER_MAGIC:
+		case XFS_SUPER_MAGIC:
+		case NFS_SUPER_MAGIC:
+		case LUSTRE_SUPER_MAGIC:
+		case GPFS_SUPER_MAGIC:
+		case BEEGFS_SUPER_MAGIC:
+			break;
+		default:
+			ereport(DEBUG1,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("GPUDirect Storage does not support filesystem (magic=%08lx) of '%s'",
+							(long)stfs_buf.f_type, pathname)));
+			return -1;
+	}
+	if (fstat(fdesc, &st_buf) != 0)
+		return -1;
+	snprintf(path, sizeof(path), "/sys/dev/block/%u:%u",
+			 major(st_buf.st_dev), minor(st_buf.st_dev));
+	return __cufileOptimalGpuForBlockDev(path, 0);
+}
+
+/*
+ * __cufileReadRanges - read the file ranges onto the device buffer
+ *
+ * It uses the batch API if available, or synchronous cuFileRead() for each
+ * range. Caller must call it in the GPU worker thread.
+ *
+ * If the file is on md-raid0 volume, ranges are split by the stripe of the
+ * underlying devices according to the extent map (FIEMAP), then submitted
+ * to keep pg_strom.nvme_queue_depth requests in flight per device, so that
+ * all the drives are busy during the chunk load.
+ */
+typedef struct
+{
+	off_t		file_offset;
+	off_t		m_offset;
+	size_t		length;
+	int			dev;		/* index of the underlying device */
+	int			state;		/* 0: pending, 1: in-flight, 2: done */
+} cufileIORange;
+
+#define CUFILE_SPLIT_MAX_NRANGES	16384
+#define CUFILE_SPLIT_MAX_EXTENTS	4096
+
+static cufileIORange *
+__cufileSplitRangesByDevice(int fdesc, cufileFileHandle *fh,
+							cufileIORange *ranges, int *p_nranges)
+{
+	int			nranges = *p_nranges;
+	off_t		f_head = LONG_MAX;
+	off_t		f_tail = 0;
+	size_t		nbounds = nranges;
+	struct fiemap  *fmap;
+	cufileIORange  *result;
+	int			i, j, k;
+
+	if (fh->md_nr_disks <= 1 || fh->md_chunk_sz == 0)
+		return ranges;
+	for (i=0; i < nranges; i++)
+	{
+		f_head = Min(f_head, ranges[i].file_offset);
+		f_tail = Max(f_tail, ranges[i].file_offset + ranges[i].length);
+		nbounds += ranges[i].length / fh->md_chunk_sz + 1;
+	}
+	/* number of extents in the range */
+	fmap = alloca(sizeof(struct fiemap));
+	memset(fmap, 0, sizeof(struct fiemap));
+	fmap->fm_start = f_head;
+	fmap->fm_length = f_tail - f_head;
+	fmap->fm_extent_count = 0;
+	if (ioctl(fdesc, FS_IOC_FIEMAP, fmap) != 0 ||
+		fmap->fm_mapped_extents == 0 ||
+		fmap->fm_mapped_extents > CUFILE_SPLIT_MAX_EXTENTS)
+		return ranges;
+	k = fmap->fm_mapped_extents;
+	nbounds += k;
+	if (nbounds > CUFILE_SPLIT_MAX_NRANGES)
+		return ranges;
+	fmap = alloca(offsetof(struct fiemap, fm_extents[k]));
+	memset(fmap, 0, offsetof(struct fiemap, fm_extents[k]));
+	fmap->fm_start = f_head;
+	fmap->fm_length = f_tail - f_head;
+	fmap->fm_extent_count = k;
+	if (ioctl(fdesc, FS_IOC_FIEMAP, fmap) != 0)
+		return ranges;
+
+	result = alloca(sizeof(cufileIORange) * nbounds);
+	for (i=0, k=0; i < nranges; i++)
+	{
+		off_t	f_pos = ranges[i].file_offset;
+		off_t	m_pos = ranges[i].m_offset;
+		size_t	remain = ranges[i].length;
+
+		while (remain > 0)
+		{
+			struct fiemap_extent *fe = NULL;
+			size_t	len = remain;
+			int		dev = 0;
+
+			for (j=0; j < fmap->fm_mapped_extents; j++)
+			{
+				fe = &fmap->fm_extents[j];
+				if (fe->fe_logical <= f_pos &&
+					f_pos < fe->fe_logical + fe->fe_length)
+					break;
+				fe = NULL;
+			}
+			if (fe)
+			{
+				uint64	p_pos = fe->fe_physical + (f_pos - fe->fe_logical);
+				uint64	stripe = p_pos / fh->md_chunk_sz;
+				size_t	s_len = (stripe + 1) * fh->md_chunk_sz - p_pos;
+
+				len = Min(len, fe->fe_logical + fe->fe_length - f_pos);
+				len = Min(len, s_len);
+				dev = stripe % fh->md_nr_disks;
+			}
+			if (k >= nbounds)
+				return ranges;		/* should not happen */
+			result[k].file_offset = f_pos;
+			result[k].m_offset = m_pos;
+			result[k].length = len;
+			result[k].dev = dev;
+			result[k].state = 0;
+			k++;
+			f_pos += len;
+			m_pos += len;
+			remain -= len;
+		}
+	}
+	*p_nranges = k;
+	return result;
+}
+
+static void
+__cufileReadRanges(int fdesc, cufileFileHandle *fh,
+				   CUdeviceptr m_base,
+				   cufileIORange *ranges, int nranges)
+{
+#if CUDA_VERSION >= 12000
+	CUfileIOParams_t  *params;
+	CUfileIOEvents_t  *events;
+	CUfileBatchHandle_t batch_id;
+	CUfileError_t	status;
+	int				ndevs = Max(fh->md_nr_disks, 1);
+	int			   *dev_inflight;
+	int				nr_params = 0;
+	int				nr_done = 0;
+	int				inflight = 0;
+	int				cursor = 0;
+	int				i;
+
+	for (i=0; i < nranges; i++)
+	{
+		ranges[i].dev = 0;
+		ranges[i].state = 0;
+	}
+	ranges = __cufileSplitRangesByDevice(fdesc, fh, ranges, &nranges);
+
+	params = alloca(sizeof(CUfileIOParams_t) * nranges);
+	events = alloca(sizeof(CUfileIOEvents_t) * CUFILE_BATCH_MAX_NR);
+	dev_inflight = alloca(sizeof(int) * ndevs);
+	memset(dev_inflight, 0, sizeof(int) * ndevs);
+	status = cuFileBatchIOSetUp(&batch_id, CUFILE_BATCH_MAX_NR);
+	if (status.err != CU_FILE_SUCCESS)
+		goto fallback;
+	while (nr_done < nranges)
+	{
+		int		base = nr_params;
+		unsigned int nr_events;
+
+		/* submit pending ranges as long as the device queue has room */
+		for (i=cursor; i < nranges && inflight < CUFILE_BATCH_MAX_NR; i++)
+		{
+			cufileIORange *r = &ranges[i];
+			CUfileIOParams_t *p;
+
+			if (r->state != 0 || dev_inflight[r->dev] >= nvme_queue_depth)
+				continue;
+			p = &params[nr_params++];
+			memset(p, 0, sizeof(CUfileIOParams_t));
+			p->mode = CUFILE_BATCH;
+			p->u.batch.devPtr_base = (void *)m_base;
+			p->u.batch.devPtr_offset = r->m_offset;
+			p->u.batch.file_offset = r->file_offset;
+			p->u.batch.size = r->length;
+			p->fh = fh->fhandle;
+			p->opcode = CUFILE_READ;
+			p->cookie = r;
+			r->state = 1;
+			dev_inflight[r->dev]++;
+			inflight++;
+		}
+		while (cursor < nranges && ranges[cursor].state != 0)
+			cursor++;
+		if (nr_params > base)
+		{
+			status = cuFileBatchIOSubmit(batch_id, nr_params - base,
+										 params + base, 0);
+			if (status.err != CU_FILE_SUCCESS)
+			{
+				cuFileBatchIODestroy(batch_id);
+				werror("failed on cuFileBatchIOSubmit: %s",
+					   cufileop_status_error(status.err));
+			}
+		}
+		Assert(inflight > 0);
+		/* wait for completion of any requests */
+		nr_events = Min(inflight, CUFILE_BATCH_MAX_NR);
+		status = cuFileBatchIOGetStatus(batch_id, 1, &nr_events,
+										events, NULL);
+		if (status.err != CU_FILE_SUCCESS)
+		{
+			cuFileBatchIODestroy(batch_id);
+			werror("failed on cuFileBatchIOGetStatus: %s",
+				   cufileop_status_error(status.err));
+		}
+		for (i=0; i < nr_events; i++)
+		{
+			cufileIORange *r = events[i].cookie;
+
+			if (events[i].status != CUFILE_COMPLETE ||
+				events[i].ret != r->length)
+			{
+				cuFileBatchIODestroy(batch_id);
+				werror("cuFile: failed on batch read (status=%d, %zu of %zu bytes)",
+					   (int)events[i].status,
+					   (size_t)events[i].ret, r->length);
+			}
+			r->state = 2;
+			dev_inflight[r->dev]--;
+			inflight--;
+			nr_done++;
+		}
+	}
+	cuFileBatchIODestroy(batch_id);
+	return;
+fallback:
+#endif
+	{
+		int		k;
+
+		for (k=0; k < nranges; k++)
+		{
+			cufileIORange *r = &ranges[k];
+			ssize_t		nbytes;
+
+			nbytes = cuFileRead(fh->fhandle, (void *)m_base,
+								r->length,
+								r->file_offset,
+								r->m_offset);
+			if (nbytes != r->length)
+				werror("failed on cuFileRead: %zd of %zu bytes",
+					   nbytes, r->length);
+		}
+	}
+}
+
+static void
+__cufileGetHandle(int fdesc, cufileFileHandle *result)
+{
+	cufileFileHandle *entry;
+
+	pthreadMutexLock(&cufile_mutex);
+	entry = __cufileLookupFileDesc(fdesc);
+	if (!entry)
+	{
+		pthreadMutexUnlock(&cufile_mutex);
+		werror("failed on cuFileHandleRegister (fdesc=%d)", fdesc);
+	}
+	memcpy(result, entry, sizeof(cufileFileHandle));
+	pthreadMutexUnlock(&cufile_mutex);
+}
+#endif	/* HAVE_CUFILE */
+
+/*
+ * nvme_strom_use_cufile - true, if GPUDirect Storage is the backend of
+ * SSD-to-GPU Direct SQL
+ */
+bool
+nvme_strom_use_cufile(void)
+{
+#ifdef HAVE_CUFILE
+	return gpudirect_storage_enabled;
+#else
+	return false;
+#endif
+}
+
+/*
+ * cufileRegisterFileDesc / cufileUnregisterFileDesc
+ */
+void
+cufileRegisterFileDesc(int fdesc)
+{
+#ifdef HAVE_CUFILE
+	cufileFileHandle *entry;
+
+	if (!gpudirect_storage_enabled)
+		return;
+	pthreadMutexLock(&cufile_mutex);
+	entry = __cufileLookupFileDesc(fdesc);
+	pthreadMutexUnlock(&cufile_mutex);
+	if (!entry)
+		elog(ERROR, "failed on cuFileHandleRegister (fdesc=%d)", fdesc);
+#endif
+}
+
+void
+cufileUnregisterFileDesc(int fdesc)
+{
+#ifdef HAVE_CUFILE
+	if (!gpudirect_storage_enabled)
+		return;
+	pthreadMutexLock(&cufile_mutex);
+	if (fdesc >= 0 &&
+		fdesc < cufile_handles_nslots &&
+		cufile_handles[fdesc].registered)
+	{
+		cuFileHandleDeregister(cufile_handles[fdesc].fhandle);
+		cufile_handles[fdesc].registered = false;
+	}
+	pthreadMutexUnlock(&cufile_mutex);
+#endif
+}
+
+/*
+ * cufileRegisterBuffer / cufileUnregisterBuffer - for i/o mapped segments
+ *
+ * Caller must set the CUDA context current.
+ */
+bool
+cufileRegisterBuffer(CUdeviceptr m_segment, size_t length)
+{
+#ifdef HAVE_CUFILE
+	CUfileError_t	status;
+
+	pthreadMutexLock(&cufile_mutex);
+	if (!__cufileDriverOpen())
+	{
+		pthreadMutexUnlock(&cufile_mutex);
+		return false;
+	}
+	pthreadMutexUnlock(&cufile_mutex);
+	status = cuFileBufRegister((void *)m_segment, length, 0);
+	if (status.err != CU_FILE_SUCCESS)
+	{
+		wnotice("failed on cuFileBufRegister: %s",
+				cufileop_status_error(status.err));
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void
+cufileUnregisterBuffer(CUdeviceptr m_segment)
+{
+#ifdef HAVE_CUFILE
+	CUfileError_t	status;
+
+	status = cuFileBufDeregister((void *)m_segment);
+	if (status.err != CU_FILE_SUCCESS)
+		wnotice("failed on cuFileBufDeregister: %s",
+				cufileop_status_error(status.err));
+#endif
+}
+
+/*
+ * cufileReadBlocks - load the heap blocks (in a segment file) onto the
+ * device buffer at @m_base + @m_offset. Contiguous blocks are merged to
+ * a single read.
+ */
+void
+cufileReadBlocks(int fdesc, CUdeviceptr m_base, size_t m_offset,
+				 BlockNumber *block_nums, cl_uint nr_blocks)
+{
+#ifdef HAVE_CUFILE
+	cufileFileHandle fh;
+	cufileIORange  *ranges;
+	int				i, nranges = 0;
+
+	__cufileGetHandle(fdesc, &fh);
+	ranges = alloca(sizeof(cufileIORange) * Max(nr_blocks, 1));
+	for (i=0; i < nr_blocks; i++)
+	{
+		off_t		file_offset = ((off_t)(block_nums[i] % RELSEG_SIZE) *
+								   (off_t)BLCKSZ);
+
+		if (nranges > 0 &&
+			ranges[nranges-1].file_offset +
+			ranges[nranges-1].length == file_offset)
+		{
+			ranges[nranges-1].length += BLCKSZ;
+		}
+		else
+		{
+			ranges[nranges].file_offset = file_offset;
+			ranges[nranges].m_offset = m_offset;
+			ranges[nranges].length = BLCKSZ;
+			nranges++;
+		}
+		m_offset += BLCKSZ;
+	}
+	__cufileReadRanges(fdesc, &fh, m_base, ranges, nranges);
+#else
+	werror("PG-Strom was not built with GPUDirect Storage support");
+#endif
+}
+
+/*
+ * cufileReadIOVec - load the file chunks of Arrow onto the device buffer
+ */
+void
+cufileReadIOVec(int fdesc, CUdeviceptr m_base, size_t m_offset,
+				strom_io_vector *iovec)
+{
+#ifdef HAVE_CUFILE
+	cufileFileHandle fh;
+	cufileIORange  *ranges;
+	int				i, nranges = 0;
+
+	__cufileGetHandle(fdesc, &fh);
+	ranges = alloca(sizeof(cufileIORange) * Max(iovec->nr_chunks, 1));
+	for (i=0; i < iovec->nr_chunks; i++)
+	{
+		strom_io_chunk *ioc = &iovec->ioc[i];
+		off_t		file_offset = (off_t)ioc->fchunk_id * (off_t)PAGE_SIZE;
+		off_t		m_pos = (off_t)(m_offset + ioc->m_offset);
+		size_t		length = (size_t)ioc->nr_pages * PAGE_SIZE;
+
+		if (nranges > 0 &&
+			ranges[nranges-1].file_offset +
+			ranges[nranges-1].length == file_offset &&
+			ranges[nranges-1].m_offset +
+			ranges[nranges-1].length == m_pos)
+		{
+			ranges[nranges-1].length += length;
+		}
+		else
+		{
+			ranges[nranges].file_offset = file_offset;
+			ranges[nranges].m_offset = m_pos;
+			ranges[nranges].length = length;
+			nranges++;
+		}
+	}
+	__cufileReadRanges(fdesc, &fh, m_base, ranges, nranges);
+#else
+	werror("PG-Strom was not built with GPUDirect Storage support");
+#endif
+}
+
 /*
  * GetOptimalGpuForFile
+ *
+ * If @p_optimal_gpus is given, it also returns the mask of the GPUs close to
+ * any of the underlying NVME devices, even if they have no single optimal GPU
+ * (e.g, md-raid0 volume over the NVME devices on different PCIe switches).
  */
-int
-GetOptimalGpuForFile(File fdesc)
+static int
+__GetOptimalGpuForFile(File fdesc, cl_ulong *p_optimal_gpus)
 {
 	StromCmd__CheckFile *uarg
 		= alloca(offsetof(StromCmd__CheckFile, rawdisks[100]));
 	int		nrooms = 100;
 	int		optimal_gpu = -1;
+	cl_ulong optimal_gpus = 0UL;
 	int		i, curr_gpu;
 
+	if (p_optimal_gpus)
+		*p_optimal_gpus = 0UL;
+#ifdef HAVE_CUFILE
+	if (gpudirect_storage_enabled)
+		return __cufileOptimalGpuForFile(FileGetRawDesc(fdesc),
+										 FilePathName(fdesc));
+#endif
 retry:
 	memset(uarg, 0, offsetof(StromCmd__CheckFile, rawdisks[nrooms]));
 	uarg->fdesc = FileGetRawDesc(fdesc);
@@ -787,16 +1531,26 @@ retry:
 		curr_gpu = nvme->nvme_optimal_gpu;
 		if (curr_gpu < 0)
 			return -1;
+		if (curr_gpu < 64)
+			optimal_gpus |= (1UL << curr_gpu);
 		if (optimal_gpu < 0)
 			optimal_gpu = curr_gpu;
 		else if (optimal_gpu != curr_gpu)
-			return -1;
+			optimal_gpu = INT_MAX;
 	}
-	return optimal_gpu;
+	if (p_optimal_gpus)
+		*p_optimal_gpus = optimal_gpus;
+	return (optimal_gpu != INT_MAX ? optimal_gpu : -1);
 }
 
-static cl_int
-GetOptimalGpuForTablespace(Oid tablespace_oid)
+int
+GetOptimalGpuForFile(File fdesc)
+{
+	return __GetOptimalGpuForFile(fdesc, NULL);
+}
+
+static vfs_nvme_status *
+lookupTablespaceNvmeStatus(Oid tablespace_oid)
 {
 	vfs_nvme_status *entry;
 	char   *pathname;
@@ -804,7 +1558,7 @@ GetOptimalGpuForTablespace(Oid tablespace_oid)
 	bool	found;
 
 	if (!nvme_strom_enabled)
-		return -1;		/* nvme_strom is not configured or disabled */
+		return NULL;	/* nvme_strom is not configured or disabled */
 
 	if (!OidIsValid(tablespace_oid))
 		tablespace_oid = MyDatabaseTableSpace;
@@ -830,6 +1584,7 @@ GetOptimalGpuForTablespace(Oid tablespace_oid)
 		/* check whether the tablespace is supported */
 		entry->tablespace_oid = tablespace_oid;
 		entry->nvme_optimal_gpu = -1;
+		entry->nvme_optimal_gpus = 0UL;
 
 		pathname = GetDatabasePath(MyDatabaseId, tablespace_oid);
 		fdesc = PathNameOpenFile(pathname, O_RDONLY | O_DIRECTORY);
@@ -841,11 +1596,20 @@ GetOptimalGpuForTablespace(Oid tablespace_oid)
 		}
 		else
 		{
-			entry->nvme_optimal_gpu = GetOptimalGpuForFile(fdesc);
+			entry->nvme_optimal_gpu =
+				__GetOptimalGpuForFile(fdesc, &entry->nvme_optimal_gpus);
 			FileClose(fdesc);
 		}
 	}
-	return entry->nvme_optimal_gpu;
+	return entry;
+}
+
+static cl_int
+GetOptimalGpuForTablespace(Oid tablespace_oid)
+{
+	vfs_nvme_status *entry = lookupTablespaceNvmeStatus(tablespace_oid);
+
+	return (entry ? entry->nvme_optimal_gpu : -1);
 }
 
 cl_int
@@ -878,6 +1642,49 @@ GetOptimalGpuForRelation(PlannerInfo *root, RelOptInfo *rel)
 	return -1;
 }
 
+/*
+ * PickupGpuForRelationScan
+ *
+ * It chooses the GPU device to scan the relation at the executor, if no
+ * single optimal GPU was chosen on the planning time. When the tablespace
+ * stands on the NVME devices close to different GPUs, the leader and the
+ * parallel workers are distributed over these GPUs, instead of all the
+ * installed GPUs, so that SSD-to-GPU Direct runs concurrently on every
+ * GPU close to the storage.
+ */
+cl_int
+PickupGpuForRelationScan(Relation relation, cl_int optimal_gpu)
+{
+	vfs_nvme_status *entry;
+	char		relpersistence = RelationGetForm(relation)->relpersistence;
+	cl_ulong	mask;
+	int			i, k, ngpus = 0;
+
+	if (optimal_gpu >= 0 ||
+		(relpersistence != RELPERSISTENCE_PERMANENT &&
+		 relpersistence != RELPERSISTENCE_UNLOGGED))
+		return optimal_gpu;
+	entry = lookupTablespaceNvmeStatus(RelationGetForm(relation)->reltablespace);
+	if (!entry)
+		return optimal_gpu;
+	mask = entry->nvme_optimal_gpus;
+	for (i=0; i < numDevAttrs && i < 64; i++)
+	{
+		if ((mask & (1UL << i)) != 0)
+			ngpus++;
+	}
+	if (ngpus < 2)
+		return optimal_gpu;
+
+	k = (IsParallelWorker() ? ParallelWorkerNumber + 1 : 0) % ngpus;
+	for (i=0; i < numDevAttrs && i < 64; i++)
+	{
+		if ((mask & (1UL << i)) != 0 && k-- == 0)
+			return i;
+	}
+	return optimal_gpu;
+}
+
 bool
 RelationCanUseNvmeStrom(Relation relation)
 {
@@ -892,16 +1699,14 @@ RelationCanUseNvmeStrom(Relation relation)
 }
 
 /*
- * ScanPathWillUseNvmeStrom - Optimizer Hint
+ * __ScanPathNvmeStromPages - number of pages to be scanned on the relations
+ * capable to SSD-to-GPU Direct
  */
-bool
-ScanPathWillUseNvmeStrom(PlannerInfo *root, RelOptInfo *baserel)
+static size_t
+__ScanPathNvmeStromPages(PlannerInfo *root, RelOptInfo *baserel)
 {
 	size_t		num_scan_pages = 0;
 
-	if (!nvme_strom_enabled)
-		return false;
-
 	/*
 	 * Check expected amount of the scan i/o.
 	 * If 'baserel' is children of partition table, threshold shall be
@@ -934,7 +1739,7 @@ ScanPathWillUseNvmeStrom(PlannerInfo *root, RelOptInfo *baserel)
 		{
 			elog(NOTICE, "Bug? child table (%d) not found in append_rel_list",
 				 baserel->relid);
-			return false;
+			return 0;
 		}
 
 		foreach (lc, root->append_rel_list)
@@ -953,12 +1758,420 @@ ScanPathWillUseNvmeStrom(PlannerInfo *root, RelOptInfo *baserel)
 		elog(ERROR, "Bug? unexpected reloptkind of base relation: %d",
 			 (int)baserel->reloptkind);
 
-	if (num_scan_pages < nvme_strom_threshold() / BLCKSZ)
+	return num_scan_pages;
+}
+
+/*
+ * ScanPathWillUseNvmeStrom - Optimizer Hint
+ */
+bool
+ScanPathWillUseNvmeStrom(PlannerInfo *root, RelOptInfo *baserel)
+{
+	if (!nvme_strom_enabled)
+		return false;
+	if (__ScanPathNvmeStromPages(root, baserel) < nvme_strom_threshold() / BLCKSZ)
 		return false;
 	/* ok, this table scan can use nvme-strom */
 	return true;
 }
 
+/*
+ * ScanPathMayUseNvmeStrom - Optimizer Hint
+ *
+ * It returns true if the relation is smaller than the threshold, but capable
+ * to SSD-to-GPU Direct. Executor decides the path for each chunk according
+ * to the residency of the blocks on the shared buffer and page cache.
+ */
+bool
+ScanPathMayUseNvmeStrom(PlannerInfo *root, RelOptInfo *baserel)
+{
+	if (!nvme_strom_partial_scan())
+		return false;
+	return (__ScanPathNvmeStromPages(root, baserel) > 0);
+}
+
+/* ------------------------------------------------------------
+ *
+ * Admission control and accounting of SSD2GPU I/O
+ *
+ * Every SSD2GPU request is accounted on the shared memory per block device
+ * the source file lives on, per session role and per GPU device.
+ * Prior to the submission, nvmeIOAdmissionBegin() delays the request
+ * according to the bandwidth caps of the backend and of the role, then
+ * waits for the in-flight bytes of the block device to fall below the
+ * pg_strom.nvme_max_inflight.
+ *
+ * NOTE: These routines are called by GPU worker threads, so we must not
+ * use any PostgreSQL backend facility except for atomic operations on the
+ * shared memory and pthread locks.
+ *
+ * ------------------------------------------------------------
+ */
+#define NVME_IOSTAT_NSLOTS		64
+
+typedef struct
+{
+	pg_atomic_uint64 key;			/* st_dev+1, role oid or 0 if unused */
+	pg_atomic_uint64 inflight_bytes;
+	pg_atomic_uint64 total_bytes;
+	pg_atomic_uint64 total_requests;
+	pg_atomic_uint64 total_wait_us;
+	pthread_mutex_t	lock;			/* lock of @next_start */
+	TimestampTz		next_start;		/* for the role bandwidth cap */
+} NvmeIOStatEntry;
+
+typedef struct
+{
+	NvmeIOStatEntry	devs[NVME_IOSTAT_NSLOTS];
+	NvmeIOStatEntry	roles[NVME_IOSTAT_NSLOTS];
+	NvmeIOStatEntry	gpus[FLEXIBLE_ARRAY_MEMBER];
+} NvmeIOStatHead;
+
+static NvmeIOStatHead  *nvme_iostat_head = NULL;
+static pthread_mutex_t	nvme_backend_iolock = PTHREAD_MUTEX_INITIALIZER;
+static TimestampTz		nvme_backend_next_start = 0;
+
+/*
+ * __nvmeIOStatLookup - find or assign a slot for the key
+ */
+static NvmeIOStatEntry *
+__nvmeIOStatLookup(NvmeIOStatEntry *slots, uint64 key)
+{
+	int		i;
+
+	Assert(key != 0);
+	for (i=0; i < NVME_IOSTAT_NSLOTS; i++)
+	{
+		NvmeIOStatEntry *entry = &slots[(key + i) % NVME_IOSTAT_NSLOTS];
+		uint64		curr = pg_atomic_read_u64(&entry->key);
+
+		if (curr == 0)
+		{
+			if (pg_atomic_compare_exchange_u64(&entry->key, &curr, key))
+				return entry;
+		}
+		if (curr == key)
+			return entry;
+	}
+	return NULL;	/* no more slots; the request is not accounted */
+}
+
+/*
+ * __nvmeIOReserveBandwidth
+ *
+ * It reserves a time slot for @nbytes on the bandwidth of @limit_mb [MB/s],
+ * then returns the timestamp when the request can be submitted.
+ */
+static TimestampTz
+__nvmeIOReserveBandwidth(pthread_mutex_t *lock, TimestampTz *p_next_start,
+						 size_t nbytes, int limit_mb, TimestampTz tv_now)
+{
+	TimestampTz	tv_start;
+	double		duration = ((double)nbytes * 1000000.0 /
+							((double)limit_mb * 1048576.0));
+
+	pthreadMutexLock(lock);
+	tv_start = Max(*p_next_start, tv_now);
+	*p_next_start = tv_start + (TimestampTz)duration;
+	pthreadMutexUnlock(lock);
+
+	return tv_start;
+}
+
+/*
+ * nvmeIOAdmissionBegin
+ */
+void
+nvmeIOAdmissionBegin(nvmeIOTicket *ticket, GpuContext *gcontext,
+					 int fdesc, size_t nbytes)
+{
+	NvmeIOStatEntry *dev_entry = NULL;
+	NvmeIOStatEntry *role_entry = NULL;
+	NvmeIOStatEntry *gpu_entry = NULL;
+	TimestampTz	tv_begin = GetCurrentTimestamp();
+	TimestampTz	tv_start = tv_begin;
+	TimestampTz	tv_curr;
+	struct stat	stat_buf;
+	uint64		wait_us;
+
+	memset(ticket, 0, sizeof(nvmeIOTicket));
+	if (!nvme_iostat_head || nbytes == 0)
+		return;
+	if (fstat(fdesc, &stat_buf) == 0)
+		dev_entry = __nvmeIOStatLookup(nvme_iostat_head->devs,
+									   (uint64)stat_buf.st_dev + 1);
+	if (OidIsValid(gcontext->session_role))
+		role_entry = __nvmeIOStatLookup(nvme_iostat_head->roles,
+										(uint64)gcontext->session_role);
+	if (gcontext->cuda_dindex >= 0 &&
+		gcontext->cuda_dindex < numDevAttrs)
+		gpu_entry = &nvme_iostat_head->gpus[gcontext->cuda_dindex];
+
+	/* bandwidth cap per backend */
+	if (nvme_bandwidth_limit_mb > 0)
+	{
+		tv_curr = __nvmeIOReserveBandwidth(&nvme_backend_iolock,
+										   &nvme_backend_next_start,
+										   nbytes,
+										   nvme_bandwidth_limit_mb,
+										   tv_begin);
+		tv_start = Max(tv_start, tv_curr);
+	}
+	/* bandwidth cap per role */
+	if (nvme_role_bandwidth_limit_mb > 0 && role_entry)
+	{
+		tv_curr = __nvmeIOReserveBandwidth(&role_entry->lock,
+										   &role_entry->next_start,
+										   nbytes,
+										   nvme_role_bandwidth_limit_mb,
+										   tv_begin);
+		tv_start = Max(tv_start, tv_curr);
+	}
+	for (;;)
+	{
+		tv_curr = GetCurrentTimestamp();
+		if (tv_curr >= tv_start)
+			break;
+		pg_usleep(Min(tv_start - tv_curr, 100000L));
+		CHECK_WORKER_TERMINATION();
+	}
+
+	/*
+	 * in-flight bytes per block device; a request larger than the cap
+	 * is admitted only when no other requests are running.
+	 */
+	if (dev_entry)
+	{
+		uint64		limit = (uint64)nvme_max_inflight_mb << 20;
+		uint64		curr;
+
+		for (;;)
+		{
+			curr = pg_atomic_read_u64(&dev_entry->inflight_bytes);
+			if (limit == 0 || curr == 0 || curr + nbytes <= limit)
+			{
+				if (pg_atomic_compare_exchange_u64(&dev_entry->inflight_bytes,
+												   &curr, curr + nbytes))
+					break;
+				continue;
+			}
+			pg_usleep(200L);
+			CHECK_WORKER_TERMINATION();
+		}
+	}
+	if (role_entry)
+		pg_atomic_fetch_add_u64(&role_entry->inflight_bytes, nbytes);
+	if (gpu_entry)
+		pg_atomic_fetch_add_u64(&gpu_entry->inflight_bytes, nbytes);
+
+	wait_us = GetCurrentTimestamp() - tv_begin;
+	if (dev_entry)
+		pg_atomic_fetch_add_u64(&dev_entry->total_wait_us, wait_us);
+	if (role_entry)
+		pg_atomic_fetch_add_u64(&role_entry->total_wait_us, wait_us);
+	if (gpu_entry)
+		pg_atomic_fetch_add_u64(&gpu_entry->total_wait_us, wait_us);
+
+	ticket->dev_entry = dev_entry;
+	ticket->role_entry = role_entry;
+	ticket->gpu_entry = gpu_entry;
+	ticket->nbytes = nbytes;
+}
+
+/*
+ * nvmeIOAdmissionEnd
+ */
+void
+nvmeIOAdmissionEnd(nvmeIOTicket *ticket, bool is_completed)
+{
+	NvmeIOStatEntry *entries[3];
+	int			i;
+
+	entries[0] = ticket->dev_entry;
+	entries[1] = ticket->role_entry;
+	entries[2] = ticket->gpu_entry;
+	for (i=0; i < lengthof(entries); i++)
+	{
+		NvmeIOStatEntry *entry = entries[i];
+
+		if (!entry)
+			continue;
+		pg_atomic_fetch_sub_u64(&entry->inflight_bytes, ticket->nbytes);
+		if (is_completed)
+		{
+			pg_atomic_fetch_add_u64(&entry->total_bytes, ticket->nbytes);
+			pg_atomic_fetch_add_u64(&entry->total_requests, 1);
+		}
+	}
+	memset(ticket, 0, sizeof(nvmeIOTicket));
+}
+
+/*
+ * nvmeIOStatGpuTotalBytes - total bytes of SSD2GPU I/O towards the GPU
+ */
+uint64
+nvmeIOStatGpuTotalBytes(cl_int cuda_dindex)
+{
+	if (!nvme_iostat_head ||
+		cuda_dindex < 0 || cuda_dindex >= numDevAttrs)
+		return 0;
+	return pg_atomic_read_u64(&nvme_iostat_head->gpus[cuda_dindex].total_bytes);
+}
+
+/*
+ * __pgstrom_nvme_io_stats_entry
+ */
+static HeapTuple
+__pgstrom_nvme_io_stats_entry(TupleDesc tupdesc, NvmeIOStatEntry *entry,
+							  const char *kind, const char *name)
+{
+	Datum		values[6];
+	bool		isnull[6];
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = CStringGetTextDatum(kind);
+	values[1] = CStringGetTextDatum(name);
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&entry->inflight_bytes));
+	values[3] = Int64GetDatum(pg_atomic_read_u64(&entry->total_bytes));
+	values[4] = Int64GetDatum(pg_atomic_read_u64(&entry->total_requests));
+	values[5] = Float8GetDatum((double)pg_atomic_read_u64(&entry->total_wait_us)
+							   / 1000.0);
+	return heap_form_tuple(tupdesc, values, isnull);
+}
+
+/*
+ * pgstrom_nvme_io_stats
+ *
+ * It shows the statistics of SSD2GPU I/O per block device, role and GPU.
+ */
+Datum
+pgstrom_nvme_io_stats(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	NvmeIOStatEntry *entry;
+	HeapTuple	tuple;
+	char		name[MAXPGPATH];
+	cl_uint	   *p_index;
+	cl_uint		index;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(6);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "kind",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "name",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "inflight_bytes",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "total_bytes",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "total_requests",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "total_wait",
+						   FLOAT8OID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+		fncxt->user_fctx = palloc0(sizeof(cl_uint));
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+	p_index = (cl_uint *) fncxt->user_fctx;
+
+	while (nvme_iostat_head &&
+		   *p_index < 2 * NVME_IOSTAT_NSLOTS + numDevAttrs)
+	{
+		index = (*p_index)++;
+		if (index < NVME_IOSTAT_NSLOTS)
+		{
+			char		path[MAXPGPATH];
+			char		link[MAXPGPATH];
+			ssize_t		sz;
+			uint64		key;
+			dev_t		st_dev;
+
+			entry = &nvme_iostat_head->devs[index];
+			key = pg_atomic_read_u64(&entry->key);
+			if (key == 0)
+				continue;
+			st_dev = (dev_t)(key - 1);
+			snprintf(path, sizeof(path), "/sys/dev/block/%u:%u",
+					 major(st_dev), minor(st_dev));
+			sz = readlink(path, link, sizeof(link) - 1);
+			if (sz > 0)
+			{
+				link[sz] = '\0';
+				strlcpy(name, basename(link), sizeof(name));
+			}
+			else
+				snprintf(name, sizeof(name), "%u:%u",
+						 major(st_dev), minor(st_dev));
+			tuple = __pgstrom_nvme_io_stats_entry(fncxt->tuple_desc, entry,
+												  "device", name);
+		}
+		else if (index < 2 * NVME_IOSTAT_NSLOTS)
+		{
+			Oid			role_oid;
+			char	   *role_name;
+
+			entry = &nvme_iostat_head->roles[index - NVME_IOSTAT_NSLOTS];
+			role_oid = (Oid)pg_atomic_read_u64(&entry->key);
+			if (!OidIsValid(role_oid))
+				continue;
+			role_name = GetUserNameFromId(role_oid, true);
+			if (role_name)
+				strlcpy(name, role_name, sizeof(name));
+			else
+				snprintf(name, sizeof(name), "%u", role_oid);
+			tuple = __pgstrom_nvme_io_stats_entry(fncxt->tuple_desc, entry,
+												  "role", name);
+		}
+		else
+		{
+			index -= 2 * NVME_IOSTAT_NSLOTS;
+			entry = &nvme_iostat_head->gpus[index];
+			snprintf(name, sizeof(name), "GPU%d", devAttrs[index].DEV_ID);
+			tuple = __pgstrom_nvme_io_stats_entry(fncxt->tuple_desc, entry,
+												  "gpu", name);
+		}
+		SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+	}
+	SRF_RETURN_DONE(fncxt);
+}
+PG_FUNCTION_INFO_V1(pgstrom_nvme_io_stats);
+
+/*
+ * pgstrom_startup_nvme_strom
+ */
+static void
+pgstrom_startup_nvme_strom(void)
+{
+	size_t		required;
+	bool		found;
+	int			i;
+
+	if (shmem_startup_next)
+		(*shmem_startup_next)();
+
+	required = STROMALIGN(offsetof(NvmeIOStatHead, gpus[numDevAttrs]));
+	nvme_iostat_head = ShmemInitStruct("SSD2GPU I/O Statistics",
+									   required, &found);
+	if (found)
+		elog(ERROR, "Bug? SSD2GPU I/O Statistics exists");
+	memset(nvme_iostat_head, 0, required);
+	for (i=0; i < NVME_IOSTAT_NSLOTS; i++)
+	{
+		pthreadMutexInit(&nvme_iostat_head->devs[i].lock, 1);
+		pthreadMutexInit(&nvme_iostat_head->roles[i].lock, 1);
+	}
+	for (i=0; i < numDevAttrs; i++)
+		pthreadMutexInit(&nvme_iostat_head->gpus[i].lock, 1);
+}
+
 /*
  * pgstrom_init_nvme_strom
  */
@@ -983,6 +2196,31 @@ pgstrom_init_nvme_strom(void)
 			break;
 		}
 	}
+#ifdef HAVE_CUFILE
+	/* pg_strom.gpudirect_storage */
+	DefineCustomBoolVariable("pg_strom.gpudirect_storage",
+							 "Uses GPUDirect Storage (cuFile) instead of nvme_strom for SSD-to-GPU Direct",
+							 NULL,
+							 &gpudirect_storage_enabled,
+							 true,
+							 PGC_POSTMASTER,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.nvme_queue_depth */
+	DefineCustomIntVariable("pg_strom.nvme_queue_depth",
+							"Number of in-flight GPUDirect Storage requests per NVMe device",
+							NULL,
+							&nvme_queue_depth,
+							32,
+							1,
+							CUFILE_BATCH_MAX_NR,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* GPUDirect Storage is not restricted to the Tesla models */
+	if (gpudirect_storage_enabled)
+		has_tesla_gpu = true;
+#endif
 	DefineCustomBoolVariable("pg_strom.nvme_strom_enabled",
 							 "Turn on/off SSD-to-GPU P2P DMA",
 							 NULL,
@@ -1014,6 +2252,27 @@ pgstrom_init_nvme_strom(void)
 							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
 							NULL, NULL, NULL);
 
+	/* pg_strom.nvme_visibility_window */
+	DefineCustomIntVariable("pg_strom.nvme_visibility_window",
+							"Max range of xids to check visibility of blocks not all-visible on GPU",
+							NULL,
+							&nvme_strom_visibility_xids,
+							1048576,
+							0,
+							268435456,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* pg_strom.nvme_strom_partial_scan */
+	DefineCustomBoolVariable("pg_strom.nvme_strom_partial_scan",
+							 "Enables SSD-to-GPU P2P DMA on partially cached relations",
+							 NULL,
+							 &nvme_strom_partial_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
 	/*
 	 * pg_strom.nvme_distance_map
 	 *
@@ -1031,4 +2290,44 @@ pgstrom_init_nvme_strom(void)
 							   GUC_NOT_IN_SAMPLE,
 							   NULL, NULL, NULL);
 	setup_nvme_distance_map();
+
+	/* pg_strom.nvme_bandwidth_limit */
+	DefineCustomIntVariable("pg_strom.nvme_bandwidth_limit",
+							"Bandwidth cap of SSD2GPU I/O per backend [MB/s]",
+							NULL,
+							&nvme_bandwidth_limit_mb,
+							0,
+							0,
+							INT_MAX,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* pg_strom.nvme_role_bandwidth_limit */
+	DefineCustomIntVariable("pg_strom.nvme_role_bandwidth_limit",
+							"Bandwidth cap of SSD2GPU I/O per role [MB/s]",
+							NULL,
+							&nvme_role_bandwidth_limit_mb,
+							0,
+							0,
+							INT_MAX,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* pg_strom.nvme_max_inflight */
+	DefineCustomIntVariable("pg_strom.nvme_max_inflight",
+							"Max in-flight bytes of SSD2GPU I/O per block device",
+							NULL,
+							&nvme_max_inflight_mb,
+							0,
+							0,
+							INT_MAX / 2,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_MB,
+							NULL, NULL, NULL);
+
+	/* shared memory for the SSD2GPU I/O statistics */
+	RequestAddinShmemSpace(STROMALIGN(offsetof(NvmeIOStatHead,
+											   gpus[numDevAttrs])));
+	shmem_startup_next = shmem_startup_hook;
+	shmem_startup_hook = pgstrom_startup_nvme_strom;
 }
@@ -251,6 +251,21 @@ ExecFetchSlotHeapTuple(TupleTableSlot *slot,
 }
 #endif	/* < PG12 */
 
+/*
+ * PG12 changed FunctionCallInfoData to have variable length arguments.
+ * FC_ARG() and FC_NULL() are also available on PG12 or later.
+ */
+#if PG_VERSION_NUM < 120000
+#define LOCAL_FCINFO(name,nargs)						\
+	FunctionCallInfoData name##data;					\
+	FunctionCallInfo name = &name##data
+#define FC_ARG(fcinfo,n)		((fcinfo)->arg[(n)])
+#define FC_NULL(fcinfo,n)		((fcinfo)->argnull[(n)])
+#else
+#define FC_ARG(fcinfo,n)		((fcinfo)->args[(n)].value)
+#define FC_NULL(fcinfo,n)		((fcinfo)->args[(n)].isnull)
+#endif
+
 /*
  * PG12 added 'pathkey' argument of create_append_path().
  * It shall be ignored on the older versions.
@@ -260,4 +275,13 @@ ExecFetchSlotHeapTuple(TupleTableSlot *slot,
 	create_append_path((a),(b),(c),(d),(f),(g),(h),(i),(j))
 #endif
 
+/*
+ * PG11 added 'coordinate' argument of tuplesort_begin_heap() for parallel
+ * sort. It shall be ignored on the older versions.
+ */
+#if PG_VERSION_NUM < 110000
+#define tuplesort_begin_heap(a,b,c,d,e,f,g,h,i)	\
+	tuplesort_begin_heap((a),(b),(c),(d),(e),(f),(g),(i))
+#endif
+
 #endif	/* PG_COMPAT_H */
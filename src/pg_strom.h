@@ -25,9 +25,12 @@
 #include "access/hash.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/multixact.h"
+#include "access/nbtree.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/sysattr.h"
+#include "access/transam.h"
 #include "access/tuptoaster.h"
 #include "access/twophase.h"
 #include "access/visibilitymap.h"
@@ -39,11 +42,13 @@
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
 #include "catalog/objectaddress.h"
+#include "catalog/partition.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_am.h"
 #include "catalog/pg_attribute.h"
 #include "catalog/pg_cast.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_collation.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_foreign_data_wrapper.h"
 #include "catalog/pg_foreign_server.h"
@@ -75,6 +80,7 @@
 #include "executor/nodeIndexscan.h"
 #include "executor/nodeCustom.h"
 #include "executor/nodeSubplan.h"
+#include "executor/spi.h"
 #include "fmgr.h"
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
@@ -123,6 +129,7 @@
 #include "port/atomics.h"
 #include "postmaster/bgworker.h"
 #include "postmaster/postmaster.h"
+#include "rewrite/rewriteManip.h"
 #include "storage/buf.h"
 #include "storage/buf_internals.h"
 #include "storage/ipc.h"
@@ -139,12 +146,14 @@
 #include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "storage/spin.h"
+#include "tcop/tcopprot.h"
 #include "utils/array.h"
 #include "utils/arrayaccess.h"
 #include "utils/builtins.h"
 #include "utils/bytea.h"
 #include "utils/cash.h"
 #include "utils/date.h"
+#include "utils/datum.h"
 #if PG_VERSION_NUM >= 120000
 #include "utils/float.h"
 #endif
@@ -158,6 +167,9 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/numeric.h"
+#if PG_VERSION_NUM >= 120000
+#include "utils/partcache.h"
+#endif
 #include "utils/pg_crc.h"
 #include "utils/pg_locale.h"
 #include "utils/rangetypes.h"
@@ -172,6 +184,8 @@
 #if PG_VERSION_NUM < 120000
 #include "utils/tqual.h"
 #endif
+#include "utils/tuplesort.h"
+#include "utils/tuplestore.h"
 #include "utils/typcache.h"
 #include "utils/uuid.h"
 #include "utils/varbit.h"
@@ -180,6 +194,9 @@
 #define CUDA_API_PER_THREAD_DEFAULT_STREAM		1
 #include <cuda.h>
 #include <nvrtc.h>
+#ifdef HAVE_NVTX
+#include <nvtx3/nvToolsExt.h>
+#endif
 
 #include <assert.h>
 #include <pthread.h>
@@ -239,6 +256,59 @@
 
 #define GPUCTX_CMD__RECLAIM_MEMORY		0x0001
 
+/*
+ * GpuWorkerQueue - queue of the pending GpuTasks for each worker thread.
+ * Submitter distributes GpuTasks in round-robin, and idle workers steal
+ * GpuTasks from the queue of other workers, not to contend on a single
+ * lock of the GpuContext.
+ */
+typedef struct
+{
+	slock_t			lock;
+	dlist_head		tasks;			/* list of GpuTask */
+} GpuWorkerQueue;
+
+#define PDS_RECYCLE_NSLOTS		4
+
+/*
+ * GpuContextActivity - state of the GpuContext exported on the shared
+ * memory, for pgstrom.gpu_activity(). Only the owner backend and its
+ * worker threads update the fields, and readers never acquire any locks,
+ * so the values are not consistent with each other strictly.
+ */
+#define GPUCTX_ACTIVITY_MAX_WORKERS		64	/* max of local_max_async_tasks */
+#define GPUCTX_ACTIVITY_MEM_NCLASSES	17	/* chunk classes; 16KB...1GB */
+
+typedef enum
+{
+	GpuWorkerState__Inactive = 0,
+	GpuWorkerState__Idle,			/* waiting for GpuTasks */
+	GpuWorkerState__Running,		/* processing a GpuTask */
+	GpuWorkerState__Retry,			/* waiting for GPU resources */
+	GpuWorkerState__Reclaim,		/* reclaiming device memory */
+	GpuWorkerState__Exited,			/* exited */
+} GpuWorkerState;
+
+typedef struct
+{
+	pg_atomic_uint32 pid;			/* PID of the owner; 0 if not in use */
+	pg_atomic_uint32 cuda_dindex;	/* device index */
+	pg_atomic_uint32 num_workers;	/* number of worker threads */
+	pg_atomic_uint32 num_pending;	/* # of GpuTasks in the worker queues */
+	pg_atomic_uint32 num_inflight;	/* # of GpuTasks admitted by scheduler */
+	pg_atomic_uint64 num_completed;	/* # of GpuTasks completed */
+	pg_atomic_uint64 program_id;	/* program of the latest GpuTask */
+	pg_atomic_uint64 mem_normal;	/* normal device memory segments */
+	pg_atomic_uint64 mem_managed;	/* managed memory segments */
+	pg_atomic_uint64 mem_iomap;		/* I/O mapped memory segments */
+	pg_atomic_uint64 mem_hostmem;	/* pinned host memory segments */
+	/* snapshot of the free-lists, updated on the periodic reclaim */
+	pg_atomic_uint32 mem_segments;	/* # of memory segments */
+	pg_atomic_uint64 mem_free;		/* free bytes in the segments */
+	pg_atomic_uint32 mem_free_chunks[GPUCTX_ACTIVITY_MEM_NCLASSES];
+	pg_atomic_uint32 worker_state[GPUCTX_ACTIVITY_MAX_WORKERS];
+} GpuContextActivity;
+
 typedef struct GpuContext
 {
 	dlist_node		chain;
@@ -253,6 +323,8 @@ typedef struct GpuContext
 	CUevent		   *cuda_events1; /* per-worker general purpose event */
 	pthread_mutex_t	cuda_modules_lock;
 	dlist_head		cuda_modules_slot[CUDA_MODULES_HASHSIZE];
+	bool			numa_steered;	/* backend is bound to the GPU's node */
+	Oid				session_role;	/* for SSD2GPU I/O accounting */
 	/* resource management */
 	slock_t			restrack_lock;
 	dlist_head		restrack[RESTRACK_HASHSIZE];
@@ -262,6 +334,17 @@ typedef struct GpuContext
 	dlist_head		gm_iomap_list;		/* list of I/O map memory segments */
 	dlist_head		gm_managed_list;	/* list of managed memory segments */
 	dlist_head		gm_hostmem_list;	/* list of Host memory segments */
+#if CUDA_VERSION >= 11020
+	CUmemoryPool	gm_mempool;			/* stream-ordered memory pool */
+#endif
+	/* recycled PDS buffers of the chunk-size class */
+	slock_t			pds_recycle_lock;
+	cl_int			pds_recycle_nitems;
+	struct {
+		void	   *ptr;
+		size_t		length;
+		bool		is_hostmem;
+	}				pds_recycle[PDS_RECYCLE_NSLOTS];
 	/* error information buffer */
 	pg_atomic_uint32 error_level;
 	int				error_code;
@@ -272,11 +355,18 @@ typedef struct GpuContext
 	/* management of the work-queue */
 	bool			worker_is_running;
 	pg_atomic_uint32 *global_num_running_tasks;
+	cl_uint			sched_weight;		/* weight while active */
+	cl_uint			sched_num_running;	/* # of admitted GpuTasks */
+	bool			sched_waiting;		/* waiting for admission */
 	pthread_mutex_t	*mutex;				/* IPC stuff */
 	pthread_cond_t	*cond;				/* IPC stuff */
 	pg_atomic_uint32 *command;			/* IPC stuff */
+	GpuContextActivity *activity;		/* IPC stuff */
 	pg_atomic_uint32 terminate_workers;
-	dlist_head		pending_tasks;		/* list of GpuTask */
+	pg_atomic_uint32 num_pending_tasks;	/* sum of the worker_queues */
+	pg_atomic_uint32 num_idle_workers;	/* # of workers in sleep */
+	GpuWorkerQueue *worker_queues;		/* per-worker pending GpuTasks */
+	cl_uint			next_queue;			/* protected by mutex */
 	cl_int			num_workers;
 	pg_atomic_uint32 worker_index;
 	pthread_t		worker_threads[FLEXIBLE_ARRAY_MEMBER];
@@ -297,11 +387,75 @@ typedef enum {
 	GpuTaskKind_PL_CUDA,
 } GpuTaskKind;
 
+/*
+ * GpuTaskStage - stages of time consumption of GPU related tasks
+ */
+typedef enum {
+	GTSTAGE__DMA_SEND = 0,		/* host-to-device DMA of the source */
+	GTSTAGE__KERN_EXEC,			/* execution of GPU kernel */
+	GTSTAGE__KERN_RESUME,		/* execution of suspended GPU kernel */
+	GTSTAGE__DMA_RECV,			/* device-to-host DMA of the results */
+	GTSTAGE__NUM_TASK_STAGES,	/* -- stages above are per GpuTask -- */
+	GTSTAGE__INNER_PRELOAD = GTSTAGE__NUM_TASK_STAGES,
+								/* preload of inner buffer (GpuJoin) */
+	GTSTAGE__NUM_STAGES,
+} GpuTaskStage;
+
+typedef struct {
+	cl_ulong		count;		/* # of samples */
+	double			total;		/* total time in ms */
+	double			min;		/* minimum time in ms */
+	double			max;		/* maximum time in ms */
+} GpuTaskStageStat;
+
+static inline void
+addGpuTaskStageStat(GpuTaskStageStat *stat, double ms)
+{
+	if (stat->count == 0 || stat->min > ms)
+		stat->min = ms;
+	if (stat->count == 0 || stat->max < ms)
+		stat->max = ms;
+	stat->total += ms;
+	stat->count++;
+}
+
+static inline void
+mergeGpuTaskStageStat(GpuTaskStageStat *dst, const GpuTaskStageStat *src)
+{
+	if (src->count == 0)
+		return;
+	if (dst->count == 0 || dst->min > src->min)
+		dst->min = src->min;
+	if (dst->count == 0 || dst->max < src->max)
+		dst->max = src->max;
+	dst->total += src->total;
+	dst->count += src->count;
+}
+
 typedef struct GpuTask				GpuTask;
 typedef struct GpuTaskState			GpuTaskState;
 typedef struct GpuTaskSharedState	GpuTaskSharedState;
 typedef struct ArrowFdwState		ArrowFdwState;
 
+/*
+ * ArrowRecordBatchIdent
+ *
+ * Identifier of a RecordBatch in the Arrow files. st_ctim tells us whether
+ * the file was modified (or the inode number was recycled) since then, and
+ * rb_layout is a hash of the buffer layout of the RecordBatch. Arrow_Fdw
+ * moves st_ctim forward when it appends RecordBatches by itself.
+ */
+typedef struct ArrowRecordBatchIdent
+{
+	dev_t		st_dev;
+	ino_t		st_ino;
+	struct timespec st_ctim;
+	off_t		rb_offset;
+	size_t		rb_length;
+	int64		rb_nitems;
+	uint32		rb_layout;
+} ArrowRecordBatchIdent;
+
 /*
  * GpuTaskState
  *
@@ -335,6 +489,7 @@ struct GpuTaskState
 
 	IndexScanDesc	outer_brin_index;	/* brin index of outer scan, if any */
 	long			outer_brin_count;	/* # of blocks skipped by index */
+	struct pgstromZoneMapState *outer_zmap_state; /* zone map, if any */
 
 	ArrowFdwState  *af_state;			/* for GpuTask on Arrow_Fdw */
 
@@ -345,6 +500,14 @@ struct GpuTaskState
 	struct NVMEScanState *nvme_sstate;
 	long			nvme_count;			/* # of blocks loaded by SSD2GPU */
 
+	/*
+	 * A state object for the columnar cache. If not NULL, chunks of the
+	 * outer relation may be loaded from the columnar cache in Arrow format.
+	 */
+	struct ccacheScanState *ccache_state;
+	long			ccache_count;		/* # of chunks loaded from ccache */
+	long			ccache_device_count;/* # of chunks on the device image */
+
 	/*
 	 * fields to fetch rows from the current task
 	 *
@@ -360,12 +523,23 @@ struct GpuTaskState
 	cl_long			curr_lp_index;	/* index of LinePointer in a block */
 	HeapTupleData	curr_tuple;		/* internal use of PDS_fetch() */
 	struct GpuTask *curr_task;	/* a GpuTask currently processed */
+	/*
+	 * A slot which references KDS_FORMAT_SLOT buffer of the curr_task
+	 * directly, and its own tts_values/tts_isnull to be restored.
+	 */
+	TupleTableSlot *curr_slot_ref;
+	Datum		   *curr_slot_values;
+	bool		   *curr_slot_isnull;
 
 	/* callbacks used by gputasks.c */
 	GpuTask		 *(*cb_next_task)(GpuTaskState *gts);
 	GpuTask		 *(*cb_terminator_task)(GpuTaskState *gts,
 										cl_bool *task_is_ready);
 	void		  (*cb_switch_task)(GpuTaskState *gts, GpuTask *gtask);
+	bool		  (*cb_cpu_task)(GpuTaskState *gts, GpuTask *gtask);
+	bool			hybrid_exec;	/* cb_cpu_task also while GPU is busy */
+	bool			program_ready;	/* CUDA program is already built */
+	bool		  (*cb_prefetch_task)(GpuTask *gtask, CUstream stream);
 	TupleTableSlot *(*cb_next_tuple)(GpuTaskState *gts);
 	int			  (*cb_process_task)(GpuTask *gtask,
 									 CUmodule cuda_module);
@@ -377,6 +551,58 @@ struct GpuTaskState
 
 	/* misc fields */
 	cl_long			num_cpu_fallbacks;	/* # of CPU fallback chunks */
+	cl_uint			num_tasks_seq;		/* sequence of GpuTasks built */
+
+	/*
+	 * Adaptive chunk sizing; @chunk_size is the size of the last chunk
+	 * read by the outer scan (0, if fixed size). @usec_per_mb is moving
+	 * average of the task latency per MB, updated by the GPU workers
+	 * (protected with GpuContext->mutex).
+	 */
+	Size			chunk_size;
+	double			usec_per_mb;
+
+	/*
+	 * Adaptive concurrency control; @inflight_window is the number of
+	 * in-flight GpuTasks allowed for this GTS, bounded by @max_async_tasks;
+	 * that is pg_strom.local_max_async_tasks, or its share per process if
+	 * pg_strom.parallel_share_async_tasks. It grows additively on completion
+	 * of GpuTasks, and shrinks by half on lack of GPU resources, at most
+	 * once per the task latency (@window_shrunk). @latency_min is the
+	 * minimum task latency observed (protected with GpuContext->mutex).
+	 */
+	cl_int			max_async_tasks;
+	double			inflight_window;
+	double			latency_min;
+	TimestampTz		window_shrunk;
+
+	/*
+	 * Time consumption per stage, if EXPLAIN ANALYZE. GPU workers merge
+	 * the timings of GpuTasks on their completion (protected with
+	 * GpuContext->mutex).
+	 */
+	GpuTaskStageStat stage_stat[GTSTAGE__NUM_STAGES];
+
+	/* queryId of the statement, to account pgstrom.stat_gpu_statements */
+	uint64			query_id;
+
+	/*
+	 * LIMIT clause pushdown; no more chunks are submitted once @tuple_bound
+	 * rows are already generated by the GpuTasks in the process (or any
+	 * workers, if CPU parallel).
+	 */
+	cl_long			tuple_bound;		/* LIMIT bound, or -1 if none */
+	pg_atomic_uint64 ntuples_ready_local;
+	pg_atomic_uint64 *ntuples_ready;	/* # of result rows generated */
+
+	/*
+	 * Async Append; @append_next is the next GPU node under the same Append
+	 * node. Once the outer scan of this GTS is done, the first GpuTasks of
+	 * @append_next are launched prior to its ExecProcNode, if its
+	 * @cb_async_begin can setup the state on ahead.
+	 */
+	GpuTaskState   *append_next;
+	bool		  (*cb_async_begin)(GpuTaskState *gts);
 
 	/* co-operation with CPU parallel */
 	GpuTaskSharedState *gtss;		/* DSM segment of GTS if any */
@@ -388,9 +614,15 @@ struct GpuTaskState
  */
 struct GpuTaskSharedState
 {
+	/* # of processes sharing pg_strom.local_max_async_tasks */
+	cl_uint			num_participants;
+
 	/* for arrow_fdw file scan  */
 	pg_atomic_uint32 af_rbatch_index;
 
+	/* for LIMIT clause pushdown */
+	pg_atomic_uint64 ntuples_ready;
+
 	/* for block-based regular table scan */
 	BlockNumber		pbs_nblocks;	/* # blocks in relation at start of scan */
 	slock_t			pbs_mutex;		/* lock of the fields below */
@@ -413,18 +645,25 @@ typedef struct
 	pg_atomic_uint64	nvme_count;
 	pg_atomic_uint64	brin_count;
 	pg_atomic_uint64	fallback_count;
+	/* protected with the lock above */
+	GpuTaskStageStat	stage_stat[GTSTAGE__NUM_STAGES];
 } GpuTaskRuntimeStat;
 
 static inline void
 mergeGpuTaskRuntimeStatParallelWorker(GpuTaskState *gts,
 									  GpuTaskRuntimeStat *gt_rtstat)
 {
+	int		i;
+
 	Assert(IsParallelWorker());
 	if (!gt_rtstat)
 		return;
 	SpinLockAcquire(&gt_rtstat->lock);
 	InstrAggNode(&gt_rtstat->outer_instrument,
 				 &gts->outer_instrument);
+	for (i=0; i < GTSTAGE__NUM_STAGES; i++)
+		mergeGpuTaskStageStat(&gt_rtstat->stage_stat[i],
+							  &gts->stage_stat[i]);
 	SpinLockRelease(&gt_rtstat->lock);
 	pg_atomic_add_fetch_u64(&gt_rtstat->nvme_count, gts->nvme_count);
 	pg_atomic_add_fetch_u64(&gt_rtstat->brin_count, gts->outer_brin_count);
@@ -436,8 +675,13 @@ static inline void
 mergeGpuTaskRuntimeStat(GpuTaskState *gts,
 						GpuTaskRuntimeStat *gt_rtstat)
 {
+	int		i;
+
 	InstrAggNode(&gts->outer_instrument,
 				 &gt_rtstat->outer_instrument);
+	for (i=0; i < GTSTAGE__NUM_STAGES; i++)
+		mergeGpuTaskStageStat(&gts->stage_stat[i],
+							  &gt_rtstat->stage_stat[i]);
 	gts->outer_instrument.tuplecount = (double)
 		pg_atomic_read_u64(&gt_rtstat->source_nitems);
 	gts->outer_instrument.nfiltered1 = (double)
@@ -466,6 +710,12 @@ struct GpuTask
 	ProgramId		program_id;		/* same with GTS's one */
 	GpuTaskState   *gts;			/* GTS reference in the backend */
 	bool			cpu_fallback;	/* true, if task needs CPU fallback */
+	bool			prefetched;		/* true, if H2D is already kicked */
+	Size			chunk_sz;		/* source chunk size, if adaptive */
+	cl_uint			task_seq;		/* sequence number in the GTS */
+	/* time consumption per stage, if EXPLAIN ANALYZE */
+	cl_uint			stage_mask;		/* bitmap of the stages measured */
+	float			stage_ms[GTSTAGE__NUM_TASK_STAGES];
 };
 
 /*
@@ -542,6 +792,13 @@ typedef struct devfunc_info {
 	Oid			func_collid;	/* OID of collation, if collation aware */
 	bool		func_is_negative;	/* True, if not supported by GPU */
 	bool		func_is_strict;		/* True, if NULL strict function */
+	char		func_const_prep;	/* preprocessing of the constant 2nd
+									 * argument; 'R' or 'I' for regex pattern
+									 * (case sensitive or not), 'K' for jsonb
+									 * keys, 'P' for jsonb path and 'A' for
+									 * sorted array, or 1st argument; 'Z' for
+									 * time zone */
+	bool		func_warp_variant;	/* True, if pgfn_<devname>_warp exists */
 	/* fields below are valid only if func_is_negative is false */
 	int32		func_flags;		/* Extra flags of this function */
 	List	   *func_args;		/* argument types by devtype_info */
@@ -550,6 +807,8 @@ typedef struct devfunc_info {
 	const char *func_devname;	/* name of the function in device side */
 	Cost		func_devcost;	/* relative cost to run function on GPU */
 	devfunc_result_sz_type devfunc_result_sz; /* result width estimator */
+	const char *func_source;	/* definition of the user defined device
+								 * function, if any */
 } devfunc_info;
 
 /*
@@ -569,6 +828,27 @@ typedef struct devcast_info {
 	devcast_coerceviaio_callback_f dcast_coerceviaio_callback;
 } devcast_info;
 
+/*
+ * gpubuf_io_vector - a set of copies to build up KDS_FORMAT_ARROW on the
+ * device memory from the preserved GPU buffer of arrow_fdw, instead of
+ * reading the arrow files again. Small portions (like nullmap) may come
+ * from the host PDS.
+ */
+typedef struct
+{
+	size_t			m_offset;	/* destination offset from the head of KDS */
+	size_t			s_offset;	/* source offset from @m_gbuf, or host KDS */
+	size_t			length;
+	cl_bool			from_host;	/* true, if source is the host KDS */
+} gpubuf_io_chunk;
+
+typedef struct
+{
+	CUdeviceptr		m_gbuf;		/* GPU buffer mapped on the GpuContext */
+	cl_int			nr_chunks;
+	gpubuf_io_chunk	ioc[FLEXIBLE_ARRAY_MEMBER];
+} gpubuf_io_vector;
+
 /*
  * pgstrom_data_store - a data structure with various format to exchange
  * a data chunk between the host and CUDA server.
@@ -594,10 +874,31 @@ typedef struct pgstrom_data_store
 	 * If NULL, KDS is preliminary loaded by CPU and filesystem, and
 	 * PDS is also allocated on managed memory area. So, worker don't
 	 * need to kick DMA operations explicitly.
+	 * @mmap_length is length of the mmap region, if PDS (without GPU
+	 * context) is mapped on the arrow file directly. Elsewhere, 0.
+	 * @gpubuf_iov is valid only if @iovec is also valid; it tells the
+	 * referenced columns are already resident on the GPU buffer, so worker
+	 * can copy them device-to-device. @iovec is still available to read
+	 * the arrow file, if device memory allocation failed.
+	 *
+	 * NOTE: @xvis is valid if any blocks, not all-visible, are loaded by
+	 * NVMe-Strom. Worker checks MVCC visibility of the tail @nblocks_unchecked
+	 * blocks on the device, prior to the GPU kernel.
 	 */
 	cl_uint				nblocks_uncached;	/* for KDS_FORMAT_BLOCK */
 	cl_int				filedesc;
 	strom_io_vector	   *iovec;				/* for KDS_FORMAT_ARROW */
+	size_t				mmap_length;		/* for KDS_FORMAT_ARROW */
+	gpubuf_io_vector   *gpubuf_iov;			/* for KDS_FORMAT_ARROW */
+	kern_xact_visibility *xvis;				/* for KDS_FORMAT_BLOCK */
+	cl_uint				nblocks_unchecked;	/* for KDS_FORMAT_BLOCK */
+	/*
+	 * NOTE: @recycle_sz is length of the buffer allocation, if PDS_release()
+	 * may keep the buffer on the GpuContext for reuse (Row/Slot/Block).
+	 * Elsewhere, 0.
+	 */
+	size_t				recycle_sz;
+	bool				recycle_hostmem;
 
 	/* data chunk in kernel portion */
 	kern_data_store kds	__attribute__ ((aligned (STROMALIGN_LEN)));
@@ -612,6 +913,7 @@ typedef struct NVMEScanState
 	cl_uint			nblocks_per_chunk;
 	BlockNumber		curr_segno;
 	Buffer			curr_vmbuffer;
+	kern_xact_visibility *xvis;	/* visibility info on managed memory, if any */
 	BlockNumber		nr_segs;
 	int				fdesc[FLEXIBLE_ARRAY_MEMBER];
 } NVMEScanState;
@@ -661,6 +963,7 @@ extern CUresult gpuOptimalBlockSize(int *p_grid_sz,
 									CUdevice cuda_device,
 									size_t dyn_shmem_per_block,
 									size_t dyn_shmem_per_thread);
+extern void		gpuOptimalBlockSizeReset(void);
 /*
  * shmbuf.c
  */
@@ -693,6 +996,11 @@ extern CUresult __gpuMemAlloc(GpuContext *gcontext,
 							  CUdeviceptr *p_devptr,
 							  size_t bytesize,
 							  const char *filename, int lineno);
+extern CUresult __gpuMemAllocAsync(GpuContext *gcontext,
+								   CUdeviceptr *p_devptr,
+								   size_t bytesize,
+								   CUstream cuda_stream,
+								   const char *filename, int lineno);
 extern CUresult __gpuMemAllocManaged(GpuContext *gcontext,
 									 CUdeviceptr *p_devptr,
 									 size_t bytesize,
@@ -711,6 +1019,13 @@ extern CUresult __gpuMemAllocPreserved(cl_int cuda_dindex,
 									   CUipcMemHandle *ipc_mhandle,
 									   ssize_t bytesize,
 									   const char *filename, int lineno);
+extern CUresult __gpuMemAllocPreservedEvictable(cl_int cuda_dindex,
+												CUipcMemHandle *ipc_mhandle,
+												ssize_t bytesize,
+												const char *filename,
+												int lineno);
+extern bool gpuMemPreservedGet(cl_int cuda_dindex, CUipcMemHandle m_handle);
+extern void gpuMemPreservedPut(cl_int cuda_dindex, CUipcMemHandle m_handle);
 extern CUresult __gpuIpcOpenMemHandle(GpuContext *gcontext,
 									  CUdeviceptr *p_deviceptr,
 									  CUipcMemHandle m_handle,
@@ -735,6 +1050,8 @@ extern CUresult gpuIpcCloseMemHandle(GpuContext *gcontext,
 	__gpuMemAllocDev((a),(b),(c),(d),__FILE__,__LINE__)
 #define gpuMemAlloc(a,b,c)					\
 	__gpuMemAlloc((a),(b),(c),__FILE__,__LINE__)
+#define gpuMemAllocAsync(a,b,c,d)			\
+	__gpuMemAllocAsync((a),(b),(c),(d),__FILE__,__LINE__)
 #define gpuMemAllocManaged(a,b,c,d)			\
 	__gpuMemAllocManaged((a),(b),(c),(d),__FILE__,__LINE__)
 #define gpuMemAllocIOMap(a,b,c)				\
@@ -743,14 +1060,32 @@ extern CUresult gpuIpcCloseMemHandle(GpuContext *gcontext,
 	__gpuMemAllocHost((a),(b),(c),__FILE__,__LINE__)
 #define gpuMemAllocPreserved(a,b,c)						\
 	__gpuMemAllocPreserved((a),(b),(c),__FILE__,__LINE__)
+#define gpuMemAllocPreservedEvictable(a,b,c)			\
+	__gpuMemAllocPreservedEvictable((a),(b),(c),__FILE__,__LINE__)
 #define gpuIpcOpenMemHandle(a,b,c,d)		\
 	__gpuIpcOpenMemHandle((a),(b),(c),(d),__FILE__,__LINE__)
 
-extern void gpuMemReclaimSegment(GpuContext *gcontext);
+extern bool gpuMemReclaimSegment(GpuContext *gcontext, bool urgent);
+extern void gpuMemNotifyRelease(cl_int cuda_dindex);
+extern double gpuMemUsageRatio(cl_int cuda_dindex);
+extern void gpuMemUsageInfo(cl_int cuda_dindex, size_t *p_total_size,
+							size_t *p_curr_usage, size_t *p_peak_usage);
+extern void gpuMemResetPeakUsage(cl_int cuda_dindex);
+extern cl_ulong gpuMemReleaseGeneration(GpuContext *gcontext);
+extern bool gpuMemWaitRelease(GpuContext *gcontext,
+							  cl_ulong generation, long timeout_ms);
 
 extern void gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds);
+extern bool gpuMemCopyFromSSDFile(GpuContext *gcontext, CUdeviceptr m_dest,
+								  int fdesc, size_t length);
+extern void gpuMemCopyFromGpuBuffer(CUdeviceptr m_kds, pgstrom_data_store *pds);
 
 extern void pgstrom_gpu_mmgr_init_gpucontext(GpuContext *gcontext);
+extern void pgstrom_gpu_mmgr_init_mempool(GpuContext *gcontext);
+extern void pgstrom_gpu_mmgr_release_mempool(GpuContext *gcontext,
+											 bool normal_exit);
+extern bool pgstrom_gpu_mmgr_release_segments(GpuContext *gcontext);
+extern void pgstrom_gpu_mmgr_unregister_iomap(GpuContext *gcontext);
 extern void pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext);
 extern void pgstrom_init_gpu_mmgr(void);
 
@@ -759,9 +1094,13 @@ extern void pgstrom_init_gpu_mmgr(void);
  */
 extern int		global_max_async_tasks;		/* GUC */
 extern int		local_max_async_tasks;		/* GUC */
+extern bool		pgstrom_adaptive_async_tasks;	/* GUC */
+extern int		pgstrom_gpu_task_priority;	/* GUC */
 extern __thread GpuContext	   *GpuWorkerCurrentContext;
 extern __thread sigjmp_buf	   *GpuWorkerExceptionStack;
 extern __thread int				GpuWorkerIndex;
+extern __thread CUstream		GpuWorkerStreamH2D;
+extern __thread CUstream		GpuWorkerStreamD2H;
 #define CU_CONTEXT_PER_THREAD					\
 	(GpuWorkerCurrentContext->cuda_context)
 #define CU_DEVICE_PER_THREAD					\
@@ -772,6 +1111,10 @@ extern __thread int				GpuWorkerIndex;
 	(GpuWorkerCurrentContext->cuda_events0[GpuWorkerIndex])
 #define CU_EVENT1_PER_THREAD					\
 	(GpuWorkerCurrentContext->cuda_events1[GpuWorkerIndex])
+#define CU_STREAM_H2D_PER_THREAD				\
+	(GpuWorkerStreamH2D)
+#define CU_STREAM_D2H_PER_THREAD				\
+	(GpuWorkerStreamD2H)
 
 extern void GpuContextWorkerReportError(int elevel,
 										int errcode,
@@ -810,16 +1153,65 @@ CHECK_FOR_GPUCONTEXT(GpuContext *gcontext)
 extern CUmodule GpuContextLookupModule(GpuContext *gcontext,
 									   ProgramId program_id);
 extern CUresult gpuInit(unsigned int flags);
+extern int	GetLeastBusyGpuDevice(void);
 extern GpuContext *AllocGpuContext(int cuda_dindex,
 								   bool never_use_mps,
 								   bool activate_context,
 								   bool activate_workers);
 extern void ActivateGpuContext(GpuContext *gcontext);
 extern void ActivateGpuContextNoWorkers(GpuContext *gcontext);
+extern void LimitGpuContextWorkers(GpuContext *gcontext, cl_int num_workers);
 extern GpuContext *GetGpuContext(GpuContext *gcontext);
 extern void PutGpuContext(GpuContext *gcontext);
 extern void SynchronizeGpuContext(GpuContext *gcontext);
 extern void SynchronizeGpuContextOnDSMDetach(dsm_segment *seg, Datum arg);
+extern int	GpuContextSendCommandToPeers(GpuContext *gcontext, uint32 command);
+extern void GpuContextPushTask(GpuContext *gcontext, GpuTask *gtask);
+extern bool gpuTaskSchedAdmit(GpuContext *gcontext, bool force);
+extern void gpuTaskSchedDone(GpuContext *gcontext, cl_uint ntasks);
+extern void gpuTaskSchedLeave(GpuContext *gcontext);
+extern void GpuWorkerPrefetchNextTask(void);
+extern bool GpuWorkerWaitPrefetch(GpuTask *gtask, CUstream stream);
+extern void GpuWorkerStageBegin(GpuTask *gtask);
+extern void GpuWorkerStageLaunch(GpuTask *gtask);
+extern void GpuWorkerStageKernel(GpuTask *gtask, bool is_resumed);
+extern void GpuWorkerStageRecv(GpuTask *gtask, CUstream stream);
+extern int	GpuContextCancelTasks(GpuContext *gcontext, GpuTaskState *gts,
+								  dlist_head *cancelled_tasks);
+
+/*
+ * GpuKernelSeq - a series of kernel launches per GpuTask, to be replayed
+ * using CUDA Graph. @kern_args must be valid until gpuKernelSeqLaunch().
+ */
+#define GPU_KERNEL_SEQ_MAX_KERNELS		4
+#define GPU_KERNEL_SEQ_MAX_ARGS			8
+typedef struct
+{
+	CUfunction		kfunc;
+	cl_uint			grid_sz;
+	cl_uint			block_sz;
+	cl_uint			shmem_sz;
+	void		   *kern_args[GPU_KERNEL_SEQ_MAX_ARGS];
+} GpuKernelLaunch;
+
+typedef struct
+{
+	GpuTaskState   *gts;		/* owner of the sequence */
+	cl_int			seq_id;		/* identifier within the GTS */
+	cl_int			nkernels;
+	GpuKernelLaunch	kernels[GPU_KERNEL_SEQ_MAX_KERNELS];
+} GpuKernelSeq;
+
+extern bool		pgstrom_enable_cuda_graph;		/* GUC */
+extern void gpuKernelSeqInit(GpuKernelSeq *kseq,
+							 GpuTaskState *gts, cl_int seq_id);
+extern void gpuKernelSeqAdd(GpuKernelSeq *kseq,
+							CUfunction kfunc,
+							cl_uint grid_sz,
+							cl_uint block_sz,
+							cl_uint shmem_sz,
+							void **kern_args, int nargs);
+extern CUresult gpuKernelSeqLaunch(GpuKernelSeq *kseq, CUstream stream);
 
 extern bool trackCudaProgram(GpuContext *gcontext, ProgramId program_id,
 							 const char *filename, int lineno);
@@ -828,6 +1220,9 @@ extern bool trackGpuMem(GpuContext *gcontext, CUdeviceptr devptr, void *extra,
 						const char *filename, int lineno);
 extern void *lookupGpuMem(GpuContext *gcontext, CUdeviceptr devptr);
 extern void *untrackGpuMem(GpuContext *gcontext, CUdeviceptr devptr);
+extern CUdeviceptr untrackGpuMemByExtra(GpuContext *gcontext, void *extra,
+										const char **p_filename,
+										int *p_lineno);
 extern bool trackGpuMemIPC(GpuContext *gcontext,
 						   CUdeviceptr devptr, void *extra,
 						   const char *filename, int lineno);
@@ -950,11 +1345,13 @@ extern kern_parambuf *construct_kern_parambuf(List *used_params,
 extern void pgstromInitGpuTaskState(GpuTaskState *gts,
 									GpuContext *gcontext,
 									GpuTaskKind task_kind,
+									List *outer_quals,
 									List *outer_refs,
 									List *used_params,
 									cl_int optimal_gpu,
 									cl_uint outer_nrows_per_block,
 									EState *estate);
+extern void pgstromAddGpuTaskResults(GpuTaskState *gts, size_t nitems);
 extern TupleTableSlot *pgstromExecGpuTaskState(GpuTaskState *gts);
 extern void pgstromRescanGpuTaskState(GpuTaskState *gts);
 extern void pgstromReleaseGpuTaskState(GpuTaskState *gts,
@@ -972,18 +1369,51 @@ extern void pgstromReInitializeDSMGpuTaskState(GpuTaskState *gts);
 extern GpuTask *fetch_next_gputask(GpuTaskState *gts);
 
 extern void pgstromInitGpuTask(GpuTaskState *gts, GpuTask *gtask);
+extern void pgstromStatGpuTaskDone(GpuTask *gtask, cl_int cuda_dindex,
+								   uint64 gpu_time_us);
+extern void pgstromStatGpuTaskRetry(GpuTask *gtask, cl_int cuda_dindex);
+extern void pgstromStatGpuTaskDMA(GpuTask *gtask, cl_int cuda_dindex,
+								  size_t h2d_bytes, size_t d2h_bytes);
+extern void pgstromStatGpuTaskFallback(GpuTaskState *gts);
+extern double pgstrom_gpu_cost_feedback(GpuTaskKind task_kind);
 extern void pgstrom_init_gputasks(void);
 
 /*
  * nvme_strom.c
  */
+typedef struct
+{
+	void	   *dev_entry;		/* accounting per block device */
+	void	   *role_entry;		/* accounting per session role */
+	void	   *gpu_entry;		/* accounting per GPU device */
+	size_t		nbytes;			/* length of the SSD2GPU request */
+} nvmeIOTicket;
+
 extern Size	nvme_strom_threshold(void);
+extern bool	nvme_strom_partial_scan(void);
+extern int	nvme_strom_visibility_window(void);
 extern int	nvme_strom_ioctl(int cmd, void *arg);
+extern bool	nvme_strom_use_cufile(void);
+extern void	cufileRegisterFileDesc(int fdesc);
+extern void	cufileUnregisterFileDesc(int fdesc);
+extern bool	cufileRegisterBuffer(CUdeviceptr m_segment, size_t length);
+extern void	cufileUnregisterBuffer(CUdeviceptr m_segment);
+extern void	cufileReadBlocks(int fdesc, CUdeviceptr m_base, size_t m_offset,
+							 BlockNumber *block_nums, cl_uint nr_blocks);
+extern void	cufileReadIOVec(int fdesc, CUdeviceptr m_base, size_t m_offset,
+							strom_io_vector *iovec);
+extern void	nvmeIOAdmissionBegin(nvmeIOTicket *ticket, GpuContext *gcontext,
+								 int fdesc, size_t nbytes);
+extern void	nvmeIOAdmissionEnd(nvmeIOTicket *ticket, bool is_completed);
+extern uint64 nvmeIOStatGpuTotalBytes(cl_int cuda_dindex);
 extern int	GetOptimalGpuForFile(File fdesc);
 extern int	GetOptimalGpuForRelation(PlannerInfo *root,
 									 RelOptInfo *rel);
 extern bool ScanPathWillUseNvmeStrom(PlannerInfo *root,
 									 RelOptInfo *baserel);
+extern bool ScanPathMayUseNvmeStrom(PlannerInfo *root,
+									RelOptInfo *baserel);
+extern cl_int PickupGpuForRelationScan(Relation relation, cl_int optimal_gpu);
 extern bool RelationCanUseNvmeStrom(Relation relation);
 extern void	pgstrom_init_nvme_strom(void);
 
@@ -1003,11 +1433,16 @@ extern ProgramId __pgstrom_create_cuda_program(GpuContext *gcontext,
 	__pgstrom_create_cuda_program((a),(b),(c),(d),(e),(f),(g),	\
 								  __FILE__,__LINE__)
 extern CUmodule pgstrom_load_cuda_program(ProgramId program_id);
+extern bool pgstrom_cuda_program_is_built(ProgramId program_id);
+extern bool pgstrom_cuda_source_is_hot(const char *kern_source,
+									   int threshold);
 extern void pgstrom_put_cuda_program(GpuContext *gcontext,
 									 ProgramId program_id);
 extern void pgstrom_build_session_info(StringInfo str,
 									   GpuTaskState *gts,
 									   cl_uint extra_flags);
+extern bytea *pgstrom_build_timezone_param(text *zone,
+										   const char **p_errmsg);
 
 extern char *pgstrom_cuda_source_string(ProgramId program_id);
 extern const char *pgstrom_cuda_source_file(ProgramId program_id);
@@ -1026,12 +1461,14 @@ struct codegen_context {
 	List	   *used_params;/* list of Const/Param in use */
 	List	   *used_vars;	/* list of Var in use */
 	Bitmapset  *param_refs;	/* referenced parameters */
+	Bitmapset  *param_literals;	/* Const parameters baked into the source */
 	const char *var_label;	/* prefix of var reference, if exist */
 	const char *kds_label;	/* label to reference kds, if exist */
 	List	   *pseudo_tlist;	/* pseudo tlist expression, if any */
 	int			extra_flags;	/* external libraries to be included */
 	int			varlena_bufsz;	/* required size of temporary varlena buffer */
 	int			devcost;	/* relative device cost */
+	List	   *user_funcs;	/* user defined device functions in use */
 };
 typedef struct codegen_context	codegen_context;
 
@@ -1053,6 +1490,8 @@ extern bool pgstrom_devtype_can_relabel(Oid src_type_oid,
 extern char *pgstrom_codegen_expression(Node *expr, codegen_context *context);
 extern void pgstrom_codegen_param_declarations(StringInfo buf,
 											   codegen_context *context);
+extern void pgstrom_codegen_user_functions(StringInfo kern,
+										   codegen_context *context);
 extern void pgstrom_union_type_declarations(StringInfo buf,
 											const char *name,
 											List *type_oid_list);
@@ -1072,11 +1511,20 @@ extern bool __pgstrom_device_expression(PlannerInfo *root,
 	__pgstrom_device_expression((a),(b),(c),NULL,(d),	\
 								__FILE__,__LINE__)
 
+extern uint64 pgstrom_devexpr_reject_seqno(void);
+extern List *pgstrom_devexpr_reject_reasons(uint64 since);
+
 extern void pgstrom_init_codegen_context(codegen_context *context,
 										 PlannerInfo *root,
 										 RelOptInfo *baserel);
 extern void pgstrom_init_codegen(void);
 
+/*
+ * regexp.c
+ */
+extern bytea *pgstrom_regex_compile(text *pattern, bool icase, Oid collid,
+									const char **p_errmsg);
+
 /*
  * datastore.c
  */
@@ -1094,6 +1542,7 @@ extern bool KDS_fetch_tuple_column(TupleTableSlot *slot,
 extern bool PDS_fetch_tuple(TupleTableSlot *slot,
 							pgstrom_data_store *pds,
 							GpuTaskState *gts);
+extern void PDS_release_slot_ref(GpuTaskState *gts);
 extern kern_data_store *__KDS_clone(GpuContext *gcontext,
 									kern_data_store *kds,
 									const char *filename, int lineno);
@@ -1101,6 +1550,7 @@ extern pgstrom_data_store *__PDS_clone(pgstrom_data_store *pds,
 									   const char *filename, int lineno);
 extern pgstrom_data_store *PDS_retain(pgstrom_data_store *pds);
 extern void PDS_release(pgstrom_data_store *pds);
+extern void PDS_flush_recycled(GpuContext *gcontext);
 
 extern size_t	KDS_calculateHeadSize(TupleDesc tupdesc);
 
@@ -1144,6 +1594,7 @@ extern void PDS_init_heapscan_state(GpuTaskState *gts);
 extern void PDS_end_heapscan_state(GpuTaskState *gts);
 extern bool PDS_exec_heapscan(GpuTaskState *gts,
 							  pgstrom_data_store *pds);
+extern void PDS_wait_heapscan_copy(void);
 extern cl_uint NVMESS_NBlocksPerChunk(struct NVMEScanState *nvme_sstate);
 
 #define PGSTROM_DATA_STORE_BLOCK_FILEPOS(pds)							\
@@ -1151,6 +1602,9 @@ extern cl_uint NVMESS_NBlocksPerChunk(struct NVMEScanState *nvme_sstate);
 													 (pds)->kds.nrooms) - \
 				(sizeof(loff_t) * (pds)->nblocks_uncached)))
 extern void PDS_fillup_blocks(pgstrom_data_store *pds);
+extern void PDS_check_visibility(pgstrom_data_store *pds,
+								 CUdeviceptr m_kds,
+								 CUmodule cuda_module);
 extern void __PDS_fillup_arrow(pgstrom_data_store *pds_dst,
 							   GpuContext *gcontext,
 							   kern_data_store *kds_head,
@@ -1170,6 +1624,8 @@ extern void pgstrom_init_datastore(void);
 /*
  * relscan.c
  */
+extern bool		pgstrom_enable_inline_toast;
+extern int		pgstrom_heapscan_copy_threads;
 extern IndexOptInfo *pgstrom_tryfind_brinindex(PlannerInfo *root,
 											   RelOptInfo *baserel,
 											   List **p_indexConds,
@@ -1178,6 +1634,7 @@ extern IndexOptInfo *pgstrom_tryfind_brinindex(PlannerInfo *root,
 #define PGSTROM_RELSCAN_NORMAL			0x0000
 #define PGSTROM_RELSCAN_SSD2GPU			0x0001
 #define PGSTROM_RELSCAN_BRIN_INDEX		0x0002
+#define PGSTROM_RELSCAN_SSD2GPU_PARTIAL	0x0004
 extern int pgstrom_common_relscan_cost(PlannerInfo *root,
 									   RelOptInfo *scan_rel,
 									   List *scan_quals,
@@ -1199,6 +1656,8 @@ extern void pgstromExecInitBrinIndexMap(GpuTaskState *gts,
 										List *index_conds,
 										List *index_quals);
 extern Size pgstromSizeOfBrinIndexMap(GpuTaskState *gts);
+extern void pgstromInitBrinIndexMap(GpuTaskState *gts, void *coordinate);
+extern void pgstromAttachBrinIndexMap(GpuTaskState *gts, void *coordinate);
 extern void pgstromExecGetBrinIndexMap(GpuTaskState *gts);
 extern void pgstromExecEndBrinIndexMap(GpuTaskState *gts);
 extern void pgstromExecRewindBrinIndexMap(GpuTaskState *gts);
@@ -1206,6 +1665,12 @@ extern void pgstromExplainBrinIndexMap(GpuTaskState *gts,
 									   ExplainState *es,
 									   List *dcontext);
 
+extern void pgstromExecInitZoneMap(GpuTaskState *gts, List *outer_quals);
+extern bool pgstromZoneMapIsBuilding(GpuTaskState *gts);
+extern void pgstromZoneMapUpdate(GpuTaskState *gts, BlockNumber blknum,
+								 kern_data_store *kds, cl_uint row_base);
+extern void pgstromExecEndZoneMap(GpuTaskState *gts);
+
 extern pgstrom_data_store *pgstromExecScanChunk(GpuTaskState *gts);
 extern void pgstromRewindScanChunk(GpuTaskState *gts);
 
@@ -1221,6 +1686,22 @@ extern void pgstromExplainOuterScan(GpuTaskState *gts,
 
 extern void pgstrom_init_relscan(void);
 
+/*
+ * ccache.c
+ */
+#define CCACHE_CHUNK_SIZE		(128L << 20)	/* 128MB */
+#define CCACHE_CHUNK_NBLOCKS	(CCACHE_CHUNK_SIZE / BLCKSZ)
+
+extern bool RelationCanUseColumnarCache(Relation relation,
+										Bitmapset **p_ccache_refs);
+extern void pgstromExecInitColumnarCache(GpuTaskState *gts);
+extern bool pgstromColumnarCacheIsReady(GpuTaskState *gts,
+										BlockNumber block_nr);
+extern pgstrom_data_store *pgstromExecScanColumnarCache(GpuTaskState *gts,
+														BlockNumber block_nr);
+extern void pgstromExecEndColumnarCache(GpuTaskState *gts);
+extern void pgstrom_init_ccache(void);
+
 /*
  * gpuscan.c
  */
@@ -1310,6 +1791,11 @@ extern void *shared_mmap_expand(shared_mmap_segment *shm_seg, size_t new_size);
 extern void *shared_mmap_address(shared_mmap_segment *shm_seg);
 extern size_t shared_mmap_length(shared_mmap_segment *shm_seg);
 extern uint64 shared_mmap_handle(shared_mmap_segment *shm_seg);
+extern bool shared_mmap_host_register(shared_mmap_segment *shm_seg);
+extern void shared_mmap_host_unregister(shared_mmap_segment *shm_seg);
+extern bool shared_mmap_load_device(shared_mmap_segment *shm_seg,
+									GpuContext *gcontext,
+									CUdeviceptr m_deviceptr, size_t length);
 
 extern void	pgstrom_init_inners(void);
 
@@ -1323,8 +1809,15 @@ extern Path *pgstrom_copy_gpupreagg_path(const Path *pathnode);
 extern void gpupreagg_post_planner(PlannedStmt *pstmt, CustomScan *cscan);
 extern void assign_gpupreagg_session_info(StringInfo buf,
 										  GpuTaskState *gts);
+extern void gpupreagg_partial_cache_rebase(const struct stat *old_stat,
+										   const struct stat *new_stat);
 extern void pgstrom_init_gpupreagg(void);
 
+/*
+ * gpusort.c
+ */
+extern void pgstrom_init_gpusort(void);
+
 /*
  * pl_cuda.c
  */
@@ -1386,10 +1879,19 @@ extern bool KDS_fetch_tuple_arrow(TupleTableSlot *slot,
 								  kern_data_store *kds,
 								  size_t row_index);
 
-extern ArrowFdwState *ExecInitArrowFdw(Relation relation,
+extern ArrowFdwState *ExecInitArrowFdw(ScanState *ss,
+									   List *outer_quals,
 									   Bitmapset *outer_refs);
 extern pgstrom_data_store *ExecScanChunkArrowFdw(GpuTaskState *gts);
 extern void ExecReScanArrowFdw(ArrowFdwState *af_state);
+extern void ExecAddArrowFdwKeyRange(ArrowFdwState *af_state,
+									AttrNumber attnum, Oid type_oid,
+									Datum min_key, Datum max_key);
+extern void ExecResetArrowFdwKeyRange(ArrowFdwState *af_state);
+extern uint32 ExecArrowFdwRecordBatchIdents(ArrowFdwState *af_state,
+											ArrowRecordBatchIdent **p_idents);
+extern void ExecSkipArrowFdwRecordBatches(ArrowFdwState *af_state,
+										  Bitmapset *rb_skipped);
 extern void ExecEndArrowFdw(ArrowFdwState *af_state);
 extern void ExecInitDSMArrowFdw(ArrowFdwState *af_state,
 								pg_atomic_uint32 *rbatch_index);
@@ -1399,6 +1901,20 @@ extern void ExecInitWorkerArrowFdw(ArrowFdwState *af_state,
 extern void ExecShutdownArrowFdw(ArrowFdwState *af_state);
 extern void ExplainArrowFdw(ArrowFdwState *af_state,
 							Relation frel, ExplainState *es);
+extern struct SQLtable *arrowFdwCreateColumnarCache(TupleDesc tupdesc,
+													int fdesc,
+													const char *filename);
+extern size_t arrowFdwPutColumnarCache(struct SQLtable *table,
+									   TupleDesc tupdesc,
+									   Datum *values, bool *isnull);
+extern size_t arrowFdwWriteColumnarCache(struct SQLtable *table);
+extern pgstrom_data_store *arrowFdwLoadColumnarCache(File filp,
+													 Relation relation,
+													 Bitmapset *ccache_refs,
+													 Bitmapset *referenced,
+													 GpuContext *gcontext,
+													 MemoryContext mcontext,
+													 CUdeviceptr m_gbuf);
 extern void pgstrom_init_arrow_fdw(void);
 
 /*
@@ -1453,8 +1969,13 @@ extern bool		pgstrom_enabled;
 extern bool		pgstrom_debug_kernel_source;
 extern bool		pgstrom_bulkexec_enabled;
 extern bool		pgstrom_cpu_fallback_enabled;
+extern bool		pgstrom_cpu_exec_while_build;
 extern bool		pgstrom_regression_test_mode;
 extern int		pgstrom_max_async_tasks;
+extern int		pgstrom_chunk_target_latency;
+extern int		pgstrom_io_uring_depth;
+extern bool		pgstrom_io_uring_direct;
+extern bool		pgstrom_enable_nvtx;
 extern double	pgstrom_gpu_setup_cost;
 extern double	pgstrom_gpu_dma_cost;
 extern double	pgstrom_gpu_operator_cost;
@@ -1464,7 +1985,30 @@ extern long		PAGE_MASK;
 extern int		PAGE_SHIFT;
 extern long		PHYS_PAGES;
 extern TimestampTz commercial_license_expired_at(void);
+#ifdef HAVE_NVTX
+extern void __pgstromNvtxRangePush(const char *fmt, ...)
+					pg_attribute_printf(1, 2);
+/*
+ * pgstromNvtxRangePush/Pop - NVTX range annotation for Nsight Systems.
+ * It references only a bool variable unless pg_strom.enable_nvtx is set,
+ * and entirely disappears if PG-Strom is built without WITH_NVTX.
+ */
+#define pgstromNvtxRangePush(fmt,...)						\
+	do {													\
+		if (pgstrom_enable_nvtx)							\
+			__pgstromNvtxRangePush((fmt), ##__VA_ARGS__);	\
+	} while(0)
+#define pgstromNvtxRangePop()								\
+	do {													\
+		if (pgstrom_enable_nvtx)							\
+			nvtxRangePop();									\
+	} while(0)
+#else
+#define pgstromNvtxRangePush(fmt,...)	do {} while(0)
+#define pgstromNvtxRangePop()			do {} while(0)
+#endif
 
+extern cl_long pgstrom_get_tuple_bound(PlannerInfo *root, RelOptInfo *rel);
 extern Path *pgstrom_create_dummy_path(PlannerInfo *root,
 									   Path *subpath,
 									   PathTarget *target);
@@ -0,0 +1,1174 @@
+/*
+ * regexp.c
+ *
+ * Compiler of regular expression patterns into DFA tables that are evaluated
+ * by the device functions (pgfn_textregexeq and so on) on GPU.
+ * ----
+ * Copyright 2011-2020 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2020 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "pg_strom.h"
+
+/*
+ * NOTE: Only a subset of the ARE (advanced regular expression) syntax of
+ * PostgreSQL is supported; literals, '.', bracket expressions, class
+ * escapes, '^', '$', '\A', '\Z', quantifiers and (non-)capturing groups.
+ * A regular expression operator returns only whether the pattern matches
+ * anywhere in the text, so greediness and capture positions are not
+ * relevant. Other features, like back references or lookahead constraints,
+ * and non-ASCII characters in the pattern are not supported; the caller
+ * runs such operators on CPU instead. The pattern is converted to NFA by
+ * Thompson's construction, then to DFA by subset construction over byte
+ * equivalence classes.
+ */
+#define REGEX_NFA_MAX_STATES	4096
+#define REGEX_DFA_MAX_STATES	512
+#define REGEX_DFA_MAX_SIZE		(64 * 1024)
+#define REGEX_MAX_REPEAT		255
+
+/* type of NFA states */
+#define RE_NFA__EPSILON		0
+#define RE_NFA__SPLIT		1
+#define RE_NFA__BYTES		2
+#define RE_NFA__BOL			3
+#define RE_NFA__EOL			4
+#define RE_NFA__MATCH		5
+
+#define RE_BYTESET_ADD(set,c)	((set)[(c) >> 5] |= (1U << ((c) & 31)))
+#define RE_BYTESET_DEL(set,c)	((set)[(c) >> 5] &= ~(1U << ((c) & 31)))
+#define RE_BYTESET_TEST(set,c)	(((set)[(c) >> 5] & (1U << ((c) & 31))) != 0)
+
+typedef struct
+{
+	int			op;			/* one of RE_NFA__* */
+	int			out1;		/* next state, or -1 if not connected yet */
+	int			out2;		/* alternative next state of SPLIT */
+	cl_uint		bytes[8];	/* set of bytes to be accepted by BYTES */
+} re_nfa_state;
+
+typedef struct
+{
+	int			start;		/* entry state of the fragment */
+	int			end;		/* EPSILON state; out1 is not connected yet */
+} re_frag;
+
+typedef struct
+{
+	const char *pos;		/* current position in the pattern */
+	const char *tail;		/* end of the pattern */
+	bool		icase;		/* case insensitive match */
+	bool		locale_is_c;	/* character classes are available */
+	bool		utf8;		/* database encoding is UTF-8 */
+	re_nfa_state *states;
+	int			nstates;
+	const char *errmsg;		/* reason why the pattern is not supported */
+} re_compile_state;
+
+/* result of re_parse_escape */
+#define RE_ESCAPE__CHAR		1
+#define RE_ESCAPE__CLASS	2
+#define RE_ESCAPE__BOL		3
+#define RE_ESCAPE__EOL		4
+
+static bool re_parse_regex(re_compile_state *cs, re_frag *f);
+
+static int
+re_new_state(re_compile_state *cs, int op)
+{
+	re_nfa_state *st;
+
+	if (cs->nstates >= REGEX_NFA_MAX_STATES)
+	{
+		cs->errmsg = "regular expression is too complicated";
+		return -1;
+	}
+	st = &cs->states[cs->nstates];
+	memset(st, 0, sizeof(re_nfa_state));
+	st->op = op;
+	st->out1 = -1;
+	st->out2 = -1;
+
+	return cs->nstates++;
+}
+
+static bool
+re_frag_empty(re_compile_state *cs, re_frag *f)
+{
+	int		e = re_new_state(cs, RE_NFA__EPSILON);
+
+	if (e < 0)
+		return false;
+	f->start = f->end = e;
+	return true;
+}
+
+static bool
+re_frag_simple(re_compile_state *cs, int op, const cl_uint *bytes, re_frag *f)
+{
+	int		e = re_new_state(cs, RE_NFA__EPSILON);
+	int		s = re_new_state(cs, op);
+
+	if (e < 0 || s < 0)
+		return false;
+	cs->states[s].out1 = e;
+	if (bytes)
+		memcpy(cs->states[s].bytes, bytes, sizeof(cs->states[s].bytes));
+	f->start = s;
+	f->end = e;
+	return true;
+}
+
+static void
+re_frag_concat(re_compile_state *cs, re_frag *f, const re_frag *next)
+{
+	cs->states[f->end].out1 = next->start;
+	f->end = next->end;
+}
+
+static bool
+re_frag_alt(re_compile_state *cs, re_frag *f, const re_frag *alt)
+{
+	int		e = re_new_state(cs, RE_NFA__EPSILON);
+	int		s = re_new_state(cs, RE_NFA__SPLIT);
+
+	if (e < 0 || s < 0)
+		return false;
+	cs->states[s].out1 = f->start;
+	cs->states[s].out2 = alt->start;
+	cs->states[f->end].out1 = e;
+	cs->states[alt->end].out1 = e;
+	f->start = s;
+	f->end = e;
+	return true;
+}
+
+/* X* */
+static bool
+re_frag_star(re_compile_state *cs, re_frag *f)
+{
+	int		e = re_new_state(cs, RE_NFA__EPSILON);
+	int		s = re_new_state(cs, RE_NFA__SPLIT);
+
+	if (e < 0 || s < 0)
+		return false;
+	cs->states[s].out1 = f->start;
+	cs->states[s].out2 = e;
+	cs->states[f->end].out1 = s;
+	f->start = s;
+	f->end = e;
+	return true;
+}
+
+/* X+ */
+static bool
+re_frag_plus(re_compile_state *cs, re_frag *f)
+{
+	int		e = re_new_state(cs, RE_NFA__EPSILON);
+	int		s = re_new_state(cs, RE_NFA__SPLIT);
+
+	if (e < 0 || s < 0)
+		return false;
+	cs->states[s].out1 = f->start;
+	cs->states[s].out2 = e;
+	cs->states[f->end].out1 = s;
+	f->end = e;
+	return true;
+}
+
+/* X? */
+static bool
+re_frag_quest(re_compile_state *cs, re_frag *f)
+{
+	int		e = re_new_state(cs, RE_NFA__EPSILON);
+	int		s = re_new_state(cs, RE_NFA__SPLIT);
+
+	if (e < 0 || s < 0)
+		return false;
+	cs->states[s].out1 = f->start;
+	cs->states[s].out2 = e;
+	cs->states[f->end].out1 = e;
+	f->start = s;
+	f->end = e;
+	return true;
+}
+
+/*
+ * re_frag_copy - duplicates the fragment that consists of the states
+ * in the range of [base, limit)
+ */
+static bool
+re_frag_copy(re_compile_state *cs, int base, int limit,
+			 const re_frag *src, re_frag *dst)
+{
+	int		offset = cs->nstates - base;
+	int		i, k;
+
+	for (i=base; i < limit; i++)
+	{
+		if ((k = re_new_state(cs, RE_NFA__EPSILON)) < 0)
+			return false;
+		memcpy(&cs->states[k], &cs->states[i], sizeof(re_nfa_state));
+		if (cs->states[k].out1 >= 0)
+			cs->states[k].out1 += offset;
+		if (cs->states[k].out2 >= 0)
+			cs->states[k].out2 += offset;
+	}
+	dst->start = src->start + offset;
+	dst->end   = src->end + offset;
+	return true;
+}
+
+/*
+ * re_frag_repeat - X{min,max}; max < 0 means no upper bound.
+ * X{m,n} is expanded to m copies of X followed by (n-m) copies of X?.
+ */
+static bool
+re_frag_repeat(re_compile_state *cs, int base, re_frag *f,
+			   int min, int max)
+{
+	int			limit = cs->nstates;
+	int			ncopies;
+	re_frag	   *copies;
+	re_frag		curr;
+	int			i;
+
+	if (min == 1 && max == 1)
+		return true;
+	if (min == 0 && max < 0)
+		return re_frag_star(cs, f);
+	if (min == 1 && max < 0)
+		return re_frag_plus(cs, f);
+	if (min == 0 && max == 1)
+		return re_frag_quest(cs, f);
+
+	ncopies = min + (max < 0 ? 1 : max - min);
+	if (ncopies == 0)
+		return re_frag_empty(cs, f);
+	copies = palloc(sizeof(re_frag) * ncopies);
+	/* make copies prior to any modification of the original fragment */
+	for (i=0; i < ncopies - 1; i++)
+	{
+		if (!re_frag_copy(cs, base, limit, f, &copies[i]))
+			return false;
+	}
+	copies[ncopies - 1] = *f;
+
+	if (!re_frag_empty(cs, &curr))
+		return false;
+	for (i=0; i < ncopies; i++)
+	{
+		if (i >= min)
+		{
+			if (max < 0 ? !re_frag_star(cs, &copies[i])
+						: !re_frag_quest(cs, &copies[i]))
+				return false;
+		}
+		re_frag_concat(cs, &curr, &copies[i]);
+	}
+	pfree(copies);
+	*f = curr;
+
+	return true;
+}
+
+/*
+ * re_frag_utf8_multibyte - any multibyte character of UTF-8
+ */
+static bool
+re_frag_utf8_multibyte(re_compile_state *cs, re_frag *f)
+{
+	static const cl_uchar lead_bytes[3][2] = {
+		{ 0xc2, 0xdf },
+		{ 0xe0, 0xef },
+		{ 0xf0, 0xf4 },
+	};
+	cl_uint		cont[8];
+	int			c, i, j;
+
+	memset(cont, 0, sizeof(cont));
+	for (c=0x80; c <= 0xbf; c++)
+		RE_BYTESET_ADD(cont, c);
+
+	for (i=0; i < 3; i++)
+	{
+		cl_uint		lead[8];
+		re_frag		curr;
+		re_frag		next;
+
+		memset(lead, 0, sizeof(lead));
+		for (c=lead_bytes[i][0]; c <= lead_bytes[i][1]; c++)
+			RE_BYTESET_ADD(lead, c);
+		if (!re_frag_simple(cs, RE_NFA__BYTES, lead, &curr))
+			return false;
+		for (j=0; j <= i; j++)
+		{
+			if (!re_frag_simple(cs, RE_NFA__BYTES, cont, &next))
+				return false;
+			re_frag_concat(cs, &curr, &next);
+		}
+		if (i == 0)
+			*f = curr;
+		else if (!re_frag_alt(cs, f, &curr))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * re_frag_charset - a character in the set of ASCII characters, or
+ * any character not in the set if negated.
+ */
+static bool
+re_frag_charset(re_compile_state *cs, const cl_uint *set, bool negated,
+				re_frag *f)
+{
+	cl_uint		bytes[8];
+	re_frag		mb;
+	int			c;
+
+	memset(bytes, 0, sizeof(bytes));
+	memcpy(bytes, set, sizeof(cl_uint) * 4);	/* 0x00-0x7f */
+	if (cs->icase)
+	{
+		for (c='a'; c <= 'z'; c++)
+		{
+			if (RE_BYTESET_TEST(bytes, c) ||
+				RE_BYTESET_TEST(bytes, c - 'a' + 'A'))
+			{
+				RE_BYTESET_ADD(bytes, c);
+				RE_BYTESET_ADD(bytes, c - 'a' + 'A');
+			}
+		}
+	}
+	if (!negated)
+		return re_frag_simple(cs, RE_NFA__BYTES, bytes, f);
+
+	for (c=0; c < 0x80; c++)
+	{
+		if (RE_BYTESET_TEST(bytes, c))
+			RE_BYTESET_DEL(bytes, c);
+		else
+			RE_BYTESET_ADD(bytes, c);
+	}
+	if (!cs->utf8)
+	{
+		/* any byte is a character on single-byte encodings */
+		for (c=0x80; c < 0x100; c++)
+			RE_BYTESET_ADD(bytes, c);
+		return re_frag_simple(cs, RE_NFA__BYTES, bytes, f);
+	}
+	if (!re_frag_simple(cs, RE_NFA__BYTES, bytes, f) ||
+		!re_frag_utf8_multibyte(cs, &mb) ||
+		!re_frag_alt(cs, f, &mb))
+		return false;
+	return true;
+}
+
+/*
+ * re_fill_class - set of ASCII characters in the character class
+ */
+static bool
+re_fill_class(re_compile_state *cs, const char *name, int namelen,
+			  cl_uint *set)
+{
+	int		c;
+
+	if (!cs->locale_is_c)
+	{
+		cs->errmsg = "character class is not supported on non-C locale";
+		return false;
+	}
+#define RE_CLASS_IS(label)									\
+	(namelen == sizeof(label) - 1 && strncmp(name, (label), namelen) == 0)
+	for (c=0; c < 0x80; c++)
+	{
+		bool	is_alpha = ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'));
+		bool	is_digit = (c >= '0' && c <= '9');
+		bool	is_space = (c == ' ' || (c >= '\t' && c <= '\r'));
+		bool	is_graph = (c > 0x20 && c < 0x7f);
+		bool	match;
+
+		if (RE_CLASS_IS("alnum"))
+			match = (is_alpha || is_digit);
+		else if (RE_CLASS_IS("alpha"))
+			match = is_alpha;
+		else if (RE_CLASS_IS("blank"))
+			match = (c == ' ' || c == '\t');
+		else if (RE_CLASS_IS("cntrl"))
+			match = (c < 0x20 || c == 0x7f);
+		else if (RE_CLASS_IS("digit"))
+			match = is_digit;
+		else if (RE_CLASS_IS("graph"))
+			match = is_graph;
+		else if (RE_CLASS_IS("lower"))
+			match = (c >= 'a' && c <= 'z');
+		else if (RE_CLASS_IS("print"))
+			match = (is_graph || c == ' ');
+		else if (RE_CLASS_IS("punct"))
+			match = (is_graph && !is_alpha && !is_digit);
+		else if (RE_CLASS_IS("space"))
+			match = is_space;
+		else if (RE_CLASS_IS("upper"))
+			match = (c >= 'A' && c <= 'Z');
+		else if (RE_CLASS_IS("xdigit"))
+			match = (is_digit ||
+					 (c >= 'a' && c <= 'f') ||
+					 (c >= 'A' && c <= 'F'));
+		else if (RE_CLASS_IS("word"))
+			match = (is_alpha || is_digit || c == '_');
+		else
+		{
+			cs->errmsg = "invalid character class";
+			return false;
+		}
+		if (match)
+			RE_BYTESET_ADD(set, c);
+	}
+#undef RE_CLASS_IS
+	return true;
+}
+
+/*
+ * re_parse_escape - parses an escape sequence next to the backslash
+ */
+static bool
+re_parse_escape(re_compile_state *cs, bool in_bracket,
+				int *p_kind, int *p_char, cl_uint *set, bool *p_negated)
+{
+	int		c;
+
+	if (cs->pos >= cs->tail)
+	{
+		cs->errmsg = "invalid escape \\ sequence";
+		return false;
+	}
+	c = (unsigned char) *cs->pos++;
+	*p_kind = RE_ESCAPE__CHAR;
+	*p_negated = false;
+	switch (c)
+	{
+		case 'd':
+		case 'D':
+			*p_kind = RE_ESCAPE__CLASS;
+			*p_negated = (c == 'D');
+			return re_fill_class(cs, "digit", 5, set);
+		case 's':
+		case 'S':
+			*p_kind = RE_ESCAPE__CLASS;
+			*p_negated = (c == 'S');
+			return re_fill_class(cs, "space", 5, set);
+		case 'w':
+		case 'W':
+			*p_kind = RE_ESCAPE__CLASS;
+			*p_negated = (c == 'W');
+			return re_fill_class(cs, "word", 4, set);
+		case 'A':
+			*p_kind = RE_ESCAPE__BOL;
+			break;
+		case 'Z':
+			*p_kind = RE_ESCAPE__EOL;
+			break;
+		case 'a':
+			*p_char = '\007';
+			break;
+		case 'b':
+			*p_char = '\b';
+			break;
+		case 'B':
+			*p_char = '\\';
+			break;
+		case 'e':
+			*p_char = '\033';
+			break;
+		case 'f':
+			*p_char = '\f';
+			break;
+		case 'n':
+			*p_char = '\n';
+			break;
+		case 'r':
+			*p_char = '\r';
+			break;
+		case 't':
+			*p_char = '\t';
+			break;
+		case 'v':
+			*p_char = '\v';
+			break;
+		case 'c':
+			if (cs->pos >= cs->tail)
+			{
+				cs->errmsg = "invalid escape \\ sequence";
+				return false;
+			}
+			*p_char = (*cs->pos++ & 037);
+			break;
+		case 'x':
+			{
+				int		value = 0;
+				int		ndigits = 0;
+
+				while (cs->pos < cs->tail && isxdigit((unsigned char)*cs->pos))
+				{
+					c = (unsigned char) *cs->pos++;
+					value = value * 16 + (isdigit(c) ? c - '0'
+										  : tolower(c) - 'a' + 10);
+					if (value >= 0x80)
+					{
+						cs->errmsg = "non-ASCII character in the pattern";
+						return false;
+					}
+					ndigits++;
+				}
+				if (ndigits == 0 || value == 0)
+				{
+					cs->errmsg = "invalid escape \\ sequence";
+					return false;
+				}
+				*p_char = value;
+			}
+			break;
+		default:
+			if (isalnum(c) || c >= 0x80)
+			{
+				/* back references, word boundaries, octal, unicode... */
+				cs->errmsg = "unsupported escape \\ sequence";
+				return false;
+			}
+			*p_char = c;
+			break;
+	}
+	if (in_bracket && (*p_kind == RE_ESCAPE__BOL ||
+					   *p_kind == RE_ESCAPE__EOL))
+	{
+		cs->errmsg = "invalid escape \\ sequence";
+		return false;
+	}
+	return true;
+}
+
+/*
+ * re_parse_bracket - parses bracket expression next to the '['
+ */
+static bool
+re_parse_bracket(re_compile_state *cs, re_frag *f)
+{
+	cl_uint		set[8];
+	bool		negated = false;
+	bool		first = true;
+
+	memset(set, 0, sizeof(set));
+	if (cs->pos < cs->tail && *cs->pos == '^')
+	{
+		negated = true;
+		cs->pos++;
+	}
+	for (;;)
+	{
+		int		lo, hi;
+		int		kind;
+		bool	class_negated;
+
+		if (cs->pos >= cs->tail)
+		{
+			cs->errmsg = "brackets [] not balanced";
+			return false;
+		}
+		lo = (unsigned char) *cs->pos;
+		if (lo == ']' && !first)
+		{
+			cs->pos++;
+			break;
+		}
+		first = false;
+
+		if (lo == '[' && cs->pos + 1 < cs->tail && cs->pos[1] == ':')
+		{
+			const char *name = cs->pos + 2;
+			const char *end;
+
+			for (end = name; end + 1 < cs->tail; end++)
+			{
+				if (end[0] == ':' && end[1] == ']')
+					break;
+			}
+			if (end + 1 >= cs->tail)
+			{
+				cs->errmsg = "brackets [] not balanced";
+				return false;
+			}
+			if (!re_fill_class(cs, name, end - name, set))
+				return false;
+			cs->pos = end + 2;
+			continue;
+		}
+		if (lo == '[' && cs->pos + 1 < cs->tail &&
+			(cs->pos[1] == '.' || cs->pos[1] == '='))
+		{
+			cs->errmsg = "collating elements are not supported";
+			return false;
+		}
+		cs->pos++;
+		if (lo == '\\')
+		{
+			if (!re_parse_escape(cs, true, &kind, &lo, set, &class_negated))
+				return false;
+			if (kind == RE_ESCAPE__CLASS)
+			{
+				if (class_negated)
+				{
+					cs->errmsg = "invalid escape \\ sequence";
+					return false;
+				}
+				continue;
+			}
+		}
+		else if (lo >= 0x80)
+		{
+			cs->errmsg = "non-ASCII character in the pattern";
+			return false;
+		}
+		hi = lo;
+		/* range of characters */
+		if (cs->pos + 1 < cs->tail &&
+			cs->pos[0] == '-' && cs->pos[1] != ']')
+		{
+			cs->pos++;
+			hi = (unsigned char) *cs->pos++;
+			if (hi == '\\')
+			{
+				if (!re_parse_escape(cs, true, &kind, &hi,
+									 set, &class_negated))
+					return false;
+				if (kind != RE_ESCAPE__CHAR)
+				{
+					cs->errmsg = "invalid character range";
+					return false;
+				}
+			}
+			else if (hi >= 0x80)
+			{
+				cs->errmsg = "non-ASCII character in the pattern";
+				return false;
+			}
+			if (hi < lo)
+			{
+				cs->errmsg = "invalid character range";
+				return false;
+			}
+		}
+		while (lo <= hi)
+		{
+			RE_BYTESET_ADD(set, lo);
+			lo++;
+		}
+	}
+	return re_frag_charset(cs, set, negated, f);
+}
+
+/*
+ * re_parse_atom
+ */
+static bool
+re_parse_atom(re_compile_state *cs, re_frag *f)
+{
+	cl_uint		set[8];
+	int			c = (unsigned char) *cs->pos++;
+	int			kind;
+	bool		negated;
+
+	memset(set, 0, sizeof(set));
+	switch (c)
+	{
+		case '(':
+			if (cs->pos < cs->tail && *cs->pos == '?')
+			{
+				if (cs->pos + 1 >= cs->tail || cs->pos[1] != ':')
+				{
+					cs->errmsg = "lookaround constraints or embedded options are not supported";
+					return false;
+				}
+				cs->pos += 2;
+			}
+			if (!re_parse_regex(cs, f))
+				return false;
+			if (cs->pos >= cs->tail || *cs->pos != ')')
+			{
+				cs->errmsg = "parentheses () not balanced";
+				return false;
+			}
+			cs->pos++;
+			return true;
+		case '.':
+			return re_frag_charset(cs, set, true, f);
+		case '[':
+			return re_parse_bracket(cs, f);
+		case '^':
+			return re_frag_simple(cs, RE_NFA__BOL, NULL, f);
+		case '$':
+			return re_frag_simple(cs, RE_NFA__EOL, NULL, f);
+		case '*':
+		case '+':
+		case '?':
+			cs->errmsg = "quantifier operand invalid";
+			return false;
+		case '{':
+			if (cs->pos < cs->tail && isdigit((unsigned char) *cs->pos))
+			{
+				cs->errmsg = "quantifier operand invalid";
+				return false;
+			}
+			break;
+		case '\\':
+			if (!re_parse_escape(cs, false, &kind, &c, set, &negated))
+				return false;
+			if (kind == RE_ESCAPE__CLASS)
+				return re_frag_charset(cs, set, negated, f);
+			if (kind == RE_ESCAPE__BOL)
+				return re_frag_simple(cs, RE_NFA__BOL, NULL, f);
+			if (kind == RE_ESCAPE__EOL)
+				return re_frag_simple(cs, RE_NFA__EOL, NULL, f);
+			break;
+		default:
+			if (c >= 0x80)
+			{
+				cs->errmsg = "non-ASCII character in the pattern";
+				return false;
+			}
+			break;
+	}
+	/* an ordinary character */
+	RE_BYTESET_ADD(set, c);
+	return re_frag_charset(cs, set, false, f);
+}
+
+/*
+ * re_parse_bound - parses {m}, {m,} or {m,n} next to the '{'
+ */
+static bool
+re_parse_bound(re_compile_state *cs, int *p_min, int *p_max)
+{
+	int		min = 0;
+	int		max;
+
+	while (cs->pos < cs->tail && isdigit((unsigned char) *cs->pos))
+	{
+		min = min * 10 + (*cs->pos++ - '0');
+		if (min > REGEX_MAX_REPEAT)
+			goto bad_bound;
+	}
+	max = min;
+	if (cs->pos < cs->tail && *cs->pos == ',')
+	{
+		cs->pos++;
+		if (cs->pos < cs->tail && isdigit((unsigned char) *cs->pos))
+		{
+			max = 0;
+			while (cs->pos < cs->tail && isdigit((unsigned char) *cs->pos))
+			{
+				max = max * 10 + (*cs->pos++ - '0');
+				if (max > REGEX_MAX_REPEAT)
+					goto bad_bound;
+			}
+			if (max < min)
+				goto bad_bound;
+		}
+		else
+			max = -1;
+	}
+	if (cs->pos >= cs->tail || *cs->pos != '}')
+		goto bad_bound;
+	cs->pos++;
+	*p_min = min;
+	*p_max = max;
+	return true;
+
+bad_bound:
+	cs->errmsg = "invalid repetition count(s)";
+	return false;
+}
+
+/*
+ * re_parse_piece - an atom possibly followed by a quantifier
+ */
+static bool
+re_parse_piece(re_compile_state *cs, re_frag *f)
+{
+	int		base = cs->nstates;
+	int		min, max;
+	int		c;
+
+	if (!re_parse_atom(cs, f))
+		return false;
+	if (cs->pos >= cs->tail)
+		return true;
+	c = *cs->pos;
+	if (c == '*')
+	{
+		min = 0;
+		max = -1;
+		cs->pos++;
+	}
+	else if (c == '+')
+	{
+		min = 1;
+		max = -1;
+		cs->pos++;
+	}
+	else if (c == '?')
+	{
+		min = 0;
+		max = 1;
+		cs->pos++;
+	}
+	else if (c == '{' && cs->pos + 1 < cs->tail &&
+			 isdigit((unsigned char) cs->pos[1]))
+	{
+		cs->pos++;
+		if (!re_parse_bound(cs, &min, &max))
+			return false;
+	}
+	else
+		return true;
+	/* non-greedy quantifiers make no difference for boolean results */
+	if (cs->pos < cs->tail && *cs->pos == '?')
+		cs->pos++;
+	if (cs->pos < cs->tail &&
+		(*cs->pos == '*' || *cs->pos == '+' || *cs->pos == '?' ||
+		 (*cs->pos == '{' && cs->pos + 1 < cs->tail &&
+		  isdigit((unsigned char) cs->pos[1]))))
+	{
+		cs->errmsg = "quantifier operand invalid";
+		return false;
+	}
+	return re_frag_repeat(cs, base, f, min, max);
+}
+
+/*
+ * re_parse_regex - branches separated by '|'
+ */
+static bool
+re_parse_regex(re_compile_state *cs, re_frag *f)
+{
+	bool	is_first = true;
+
+	for (;;)
+	{
+		re_frag		branch;
+		re_frag		piece;
+
+		if (!re_frag_empty(cs, &branch))
+			return false;
+		while (cs->pos < cs->tail && *cs->pos != '|' && *cs->pos != ')')
+		{
+			if (!re_parse_piece(cs, &piece))
+				return false;
+			re_frag_concat(cs, &branch, &piece);
+		}
+		if (is_first)
+			*f = branch;
+		else if (!re_frag_alt(cs, f, &branch))
+			return false;
+		is_first = false;
+
+		if (cs->pos >= cs->tail || *cs->pos != '|')
+			break;
+		cs->pos++;
+	}
+	return true;
+}
+
+/*
+ * re_nfa_closure - set of NFA states reachable from the kernel states
+ * without consuming any bytes.
+ */
+static Bitmapset *
+re_nfa_closure(re_compile_state *cs, Bitmapset *kernel, bool bol, bool eol)
+{
+	Bitmapset  *result = NULL;
+	int		   *stack = palloc(sizeof(int) * cs->nstates);
+	int			depth = 0;
+	int			k = -1;
+
+	while ((k = bms_next_member(kernel, k)) >= 0)
+	{
+		result = bms_add_member(result, k);
+		stack[depth++] = k;
+	}
+	while (depth > 0)
+	{
+		re_nfa_state *st = &cs->states[stack[--depth]];
+		int		next[2];
+		int		i, n = 0;
+
+		switch (st->op)
+		{
+			case RE_NFA__EPSILON:
+				next[n++] = st->out1;
+				break;
+			case RE_NFA__SPLIT:
+				next[n++] = st->out1;
+				next[n++] = st->out2;
+				break;
+			case RE_NFA__BOL:
+				if (bol)
+					next[n++] = st->out1;
+				break;
+			case RE_NFA__EOL:
+				if (eol)
+					next[n++] = st->out1;
+				break;
+			default:
+				break;
+		}
+		for (i=0; i < n; i++)
+		{
+			if (next[i] >= 0 && !bms_is_member(next[i], result))
+			{
+				result = bms_add_member(result, next[i]);
+				stack[depth++] = next[i];
+			}
+		}
+	}
+	pfree(stack);
+	return result;
+}
+
+/*
+ * pgstrom_regex_compile
+ *
+ * It compiles the regular expression pattern into kern_regex_dfa, or
+ * returns NULL with the reason if the pattern is not supported on GPU.
+ */
+bytea *
+pgstrom_regex_compile(text *pattern, bool icase, Oid collid,
+					  const char **p_errmsg)
+{
+	re_compile_state cs;
+	re_frag		f;
+	re_frag		m;
+	int			start;
+	int			match;
+	cl_uchar	classmap[256];
+	int			nclasses;
+	int			class_rep[256];
+	Bitmapset **dfa_sets;
+	uint32	   *dfa_hash;
+	cl_ushort  *dfa_trans;
+	cl_uchar   *dfa_flags;
+	int			nstates;
+	int			d, i, k, c;
+	bool		changed;
+	size_t		sz;
+	bytea	   *result;
+	kern_regex_dfa *dfa;
+
+	memset(&cs, 0, sizeof(re_compile_state));
+	if (GetDatabaseEncoding() == PG_UTF8)
+		cs.utf8 = true;
+	else if (pg_database_encoding_max_length() != 1)
+	{
+		*p_errmsg = "unsupported database encoding";
+		return NULL;
+	}
+	if (!OidIsValid(collid))
+	{
+		*p_errmsg = "no valid collation";
+		return NULL;
+	}
+	cs.locale_is_c = lc_ctype_is_c(collid);
+	cs.icase = icase;
+	cs.pos   = VARDATA_ANY(pattern);
+	cs.tail  = cs.pos + VARSIZE_ANY_EXHDR(pattern);
+	cs.states = palloc(sizeof(re_nfa_state) * REGEX_NFA_MAX_STATES);
+
+	/* ARE director prefix */
+	if (cs.tail - cs.pos >= 3 && strncmp(cs.pos, "***", 3) == 0)
+	{
+		*p_errmsg = "ARE director prefix is not supported";
+		return NULL;
+	}
+	/* pattern -> NFA */
+	if (!re_parse_regex(&cs, &f))
+		goto not_supported;
+	if (cs.pos < cs.tail)
+	{
+		cs.errmsg = "parentheses () not balanced";
+		goto not_supported;
+	}
+	if (!re_frag_simple(&cs, RE_NFA__MATCH, NULL, &m))
+		goto not_supported;
+	re_frag_concat(&cs, &f, &m);
+	start = f.start;
+	match = m.start;
+
+	/* byte equivalence classes */
+	memset(classmap, 0, sizeof(classmap));
+	nclasses = 1;
+	for (i=0; i < cs.nstates; i++)
+	{
+		re_nfa_state *st = &cs.states[i];
+		bool	inside[256];
+		bool	outside[256];
+		int		newid[256];
+
+		if (st->op != RE_NFA__BYTES)
+			continue;
+		memset(inside, 0, sizeof(bool) * nclasses);
+		memset(outside, 0, sizeof(bool) * nclasses);
+		for (c=0; c < 256; c++)
+		{
+			if (RE_BYTESET_TEST(st->bytes, c))
+				inside[classmap[c]] = true;
+			else
+				outside[classmap[c]] = true;
+		}
+		for (k=0; k < nclasses; k++)
+			newid[k] = (inside[k] && outside[k] ? -1 : k);
+		for (k=0, d=nclasses; k < d; k++)
+		{
+			if (newid[k] < 0)
+				newid[k] = nclasses++;
+		}
+		for (c=0; c < 256; c++)
+		{
+			if (RE_BYTESET_TEST(st->bytes, c))
+				classmap[c] = newid[classmap[c]];
+		}
+	}
+	for (k=0; k < nclasses; k++)
+		class_rep[k] = -1;
+	for (c=0; c < 256; c++)
+	{
+		if (class_rep[classmap[c]] < 0)
+			class_rep[classmap[c]] = c;
+	}
+
+	/*
+	 * NFA -> DFA by subset construction.  The state-0 is the beginning of
+	 * the text.  Every other state also contains the closure of the start
+	 * state, because the pattern can match at any position of the text.
+	 */
+	dfa_sets  = palloc(sizeof(Bitmapset *) * REGEX_DFA_MAX_STATES);
+	dfa_hash  = palloc(sizeof(uint32) * REGEX_DFA_MAX_STATES);
+	dfa_trans = palloc(sizeof(cl_ushort) * REGEX_DFA_MAX_STATES * nclasses);
+	dfa_flags = palloc0(sizeof(cl_uchar) * REGEX_DFA_MAX_STATES);
+
+	dfa_sets[0] = re_nfa_closure(&cs, bms_make_singleton(start), true, false);
+	dfa_hash[0] = bms_hash_value(dfa_sets[0]);
+	nstates = 1;
+	for (d=0; d < nstates; d++)
+	{
+		Bitmapset  *set = dfa_sets[d];
+		Bitmapset  *temp;
+
+		temp = re_nfa_closure(&cs, set, d == 0, true);
+		if (bms_is_member(match, temp))
+			dfa_flags[d] |= KERN_REGEX_DFA__ACCEPT_EOS;
+		if (bms_is_member(match, set))
+		{
+			/* already matched, so no need to walk on the text any more */
+			dfa_flags[d] |= KERN_REGEX_DFA__ACCEPT;
+			for (k=0; k < nclasses; k++)
+				dfa_trans[d * nclasses + k] = d;
+			continue;
+		}
+
+		for (k=0; k < nclasses; k++)
+		{
+			Bitmapset  *kernel = bms_make_singleton(start);
+			Bitmapset  *next;
+			uint32		hash;
+			int			j;
+
+			i = -1;
+			while ((i = bms_next_member(set, i)) >= 0)
+			{
+				re_nfa_state   *st = &cs.states[i];
+
+				if (st->op == RE_NFA__BYTES &&
+					RE_BYTESET_TEST(st->bytes, class_rep[k]))
+					kernel = bms_add_member(kernel, st->out1);
+			}
+			next = re_nfa_closure(&cs, kernel, false, false);
+			hash = bms_hash_value(next);
+			/* state-0 is never reached again, even if same NFA states */
+			for (j=1; j < nstates; j++)
+			{
+				if (dfa_hash[j] == hash && bms_equal(dfa_sets[j], next))
+					break;
+			}
+			if (j == nstates)
+			{
+				if (nstates >= REGEX_DFA_MAX_STATES ||
+					(nstates + 1) * nclasses * sizeof(cl_ushort)
+					> REGEX_DFA_MAX_SIZE)
+				{
+					cs.errmsg = "regular expression is too complicated";
+					goto not_supported;
+				}
+				dfa_sets[nstates] = next;
+				dfa_hash[nstates] = hash;
+				nstates++;
+			}
+			else
+				bms_free(next);
+			bms_free(kernel);
+			dfa_trans[d * nclasses + k] = j;
+		}
+	}
+
+	/* states that can never reach to the accept states */
+	for (d=0; d < nstates; d++)
+	{
+		if ((dfa_flags[d] & (KERN_REGEX_DFA__ACCEPT |
+							 KERN_REGEX_DFA__ACCEPT_EOS)) == 0)
+			dfa_flags[d] |= KERN_REGEX_DFA__DEAD;
+	}
+	do {
+		changed = false;
+		for (d=0; d < nstates; d++)
+		{
+			if ((dfa_flags[d] & KERN_REGEX_DFA__DEAD) == 0)
+				continue;
+			for (k=0; k < nclasses; k++)
+			{
+				if ((dfa_flags[dfa_trans[d * nclasses + k]] &
+					 KERN_REGEX_DFA__DEAD) == 0)
+				{
+					dfa_flags[d] &= ~KERN_REGEX_DFA__DEAD;
+					changed = true;
+					break;
+				}
+			}
+		}
+	} while (changed);
+
+	/* setup kern_regex_dfa */
+	sz = (offsetof(kern_regex_dfa, trans) +
+		  sizeof(cl_ushort) * nstates * nclasses +
+		  sizeof(cl_uchar) * nstates);
+	result = palloc0(VARHDRSZ + sz);
+	SET_VARSIZE(result, VARHDRSZ + sz);
+	dfa = (kern_regex_dfa *) VARDATA(result);
+	dfa->nstates  = nstates;
+	dfa->nclasses = nclasses;
+	memcpy(dfa->classmap, classmap, sizeof(classmap));
+	memcpy(dfa->trans, dfa_trans, sizeof(cl_ushort) * nstates * nclasses);
+	memcpy(KERN_REGEX_DFA_FLAGS(dfa), dfa_flags, sizeof(cl_uchar) * nstates);
+
+	return result;
+
+not_supported:
+	*p_errmsg = cs.errmsg;
+	return NULL;
+}
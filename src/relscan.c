@@ -27,6 +27,11 @@ typedef struct
 
 /*--- static variables ---*/
 static bool		pgstrom_enable_brin;
+static bool		pgstrom_enable_btree_bitmap;
+static bool		pgstrom_enable_zone_map;
+static double	pgstrom_brin_gap_tolerance;		/* GUC */
+bool			pgstrom_enable_inline_toast;	/* GUC */
+int				pgstrom_heapscan_copy_threads;	/* GUC */
 
 /*
  * simple_match_clause_to_indexcol
@@ -275,6 +280,46 @@ estimate_brinindex_scan_nblocks(PlannerInfo *root,
 	return (cl_long)(indexSelectivity * (double) baserel->pages);
 }
 
+/*
+ * estimate_btreeindex_scan_nblocks
+ *
+ * It estimates number of blocks to be fetched by the TID bitmap built on
+ * the B-tree index. Also see compute_bitmap_pages at costsize.c
+ */
+static cl_long
+estimate_btreeindex_scan_nblocks(PlannerInfo *root,
+								 RelOptInfo *baserel,
+								 IndexOptInfo *index,
+								 IndexClauseSet *clauseset,
+								 List **p_indexQuals)
+{
+	List	   *indexQuals = NIL;
+	Selectivity	qualSelectivity;
+	double		tuples_fetched;
+	double		pages_fetched;
+	double		T = (baserel->pages > 1 ? (double) baserel->pages : 1.0);
+	int			icol;
+
+	for (icol=0; icol < index->ncolumns; icol++)
+		indexQuals = list_concat(indexQuals,
+								 list_copy(clauseset->indexclauses[icol]));
+	qualSelectivity = clauselist_selectivity(root,
+											 indexQuals,
+											 baserel->relid,
+											 JOIN_INNER,
+											 NULL);
+	tuples_fetched = clamp_row_est(qualSelectivity * baserel->tuples);
+	pages_fetched = (2.0 * T * tuples_fetched) / (2.0 * T + tuples_fetched);
+	if (pages_fetched >= T)
+		pages_fetched = T;
+	else
+		pages_fetched = ceil(pages_fetched);
+
+	if (p_indexQuals)
+		*p_indexQuals = indexQuals;
+	return (cl_long) pages_fetched;
+}
+
 /*
  * extract_index_conditions
  */
@@ -354,8 +399,8 @@ pgstrom_tryfind_brinindex(PlannerInfo *root,
 	List		   *indexQuals = NIL;
 	ListCell	   *cell;
 
-	/* skip if GUC disables BRIN-index */
-	if (!pgstrom_enable_brin)
+	/* skip if GUC disables both of BRIN and B-tree index */
+	if (!pgstrom_enable_brin && !pgstrom_enable_btree_bitmap)
 		return NULL;
 
 	/* skip if no indexes */
@@ -377,8 +422,18 @@ pgstrom_tryfind_brinindex(PlannerInfo *root,
 		if (index->indpred != NIL && !index->predOK)
 			continue;
 
-		/* Only BRIN-indexes are now supported */
-		if (index->relam != BRIN_AM_OID)
+		/* Only BRIN-indexes and B-tree indexes are now supported */
+		if (index->relam == BRIN_AM_OID)
+		{
+			if (!pgstrom_enable_brin)
+				continue;
+		}
+		else if (index->relam == BTREE_AM_OID)
+		{
+			if (!pgstrom_enable_btree_bitmap || !index->amhasgetbitmap)
+				continue;
+		}
+		else
 			continue;
 
 		/* see match_clauses_to_index */
@@ -393,13 +448,24 @@ pgstrom_tryfind_brinindex(PlannerInfo *root,
 			continue;
 
 		/*
-		 * In case when multiple BRIN-indexes are configured,
-		 * the one with minimal selectivity is the best choice.
+		 * In case when multiple indexes are configured, the one with
+		 * minimal selectivity is the best choice.
 		 */
- 		nblocks = estimate_brinindex_scan_nblocks(root, baserel,
-												  index,
-												  &clauseset,
-												  &temp);
+		if (index->relam == BRIN_AM_OID)
+			nblocks = estimate_brinindex_scan_nblocks(root, baserel,
+													  index,
+													  &clauseset,
+													  &temp);
+		else
+		{
+			/* B-tree index requires the leading key qualifier */
+			if (clauseset.indexclauses[0] == NIL)
+				continue;
+			nblocks = estimate_btreeindex_scan_nblocks(root, baserel,
+													   index,
+													   &clauseset,
+													   &temp);
+		}
 		if (indexNBlocks > nblocks)
 		{
 			indexOpt = index;
@@ -474,12 +540,11 @@ pgstrom_common_relscan_cost(PlannerInfo *root,
 							  &spc_seq_page_cost);
 	disk_scan_cost = spc_seq_page_cost * nblocks;
 
-	/* consideration for BRIN-index, if any */
-	if (indexOpt)
+	/* consideration for BRIN-index or B-tree index, if any */
+	if (indexOpt && indexOpt->relam == BRIN_AM_OID)
 	{
 		BrinStatsData	statsData;
 		Relation		index_rel;
-		Cost			x;
 
 		index_rel = index_open(indexOpt->indexoid, AccessShareLock);
 		brinGetStats(index_rel, &statsData);
@@ -494,6 +559,32 @@ pgstrom_common_relscan_cost(PlannerInfo *root,
 			cost_qual_eval_node(&qcost, (Node *)lfirst(lc), root);
 			index_scan_cost += qcost.startup + qcost.per_tuple;
 		}
+	}
+	else if (indexOpt)
+	{
+		double		index_ntuples;
+
+		/* cost to build TID bitmap by B-tree index; like BitmapIndexScan */
+		index_ntuples = clamp_row_est(scan_rel->tuples *
+									  clauselist_selectivity(root,
+															 indexQuals,
+															 scan_rel->relid,
+															 JOIN_INNER,
+															 NULL));
+		get_tablespace_page_costs(indexOpt->reltablespace,
+								  &spc_rand_page_cost,
+								  &spc_seq_page_cost);
+		index_scan_cost = spc_rand_page_cost *
+			ceil((double) indexOpt->pages * index_ntuples /
+				 Max(scan_rel->tuples, 1.0));
+		cost_qual_eval_node(&qcost, (Node *)indexQuals, root);
+		index_scan_cost += qcost.startup +
+			(cpu_index_tuple_cost + qcost.per_tuple) * index_ntuples;
+	}
+
+	if (indexOpt)
+	{
+		Cost		x;
 
 		x = index_scan_cost + spc_rand_page_cost * (double)indexNBlocks;
 		if (disk_scan_cost > x)
@@ -505,9 +596,15 @@ pgstrom_common_relscan_cost(PlannerInfo *root,
 		}
 	}
 
-	/* check whether NVMe-Strom is capable */
+	/*
+	 * check whether NVMe-Strom is capable.
+	 * Relations smaller than the threshold are likely cached partially, so
+	 * executor decides the path per chunk, without cost discount.
+	 */
 	if (ScanPathWillUseNvmeStrom(root, scan_rel))
 		scan_mode |= PGSTROM_RELSCAN_SSD2GPU;
+	else if (ScanPathMayUseNvmeStrom(root, scan_rel))
+		scan_mode |= PGSTROM_RELSCAN_SSD2GPU_PARTIAL;
 
 	/*
 	 * Cost adjustment by CPU parallelism, if used.
@@ -602,7 +699,8 @@ pgstrom_common_relscan_cost(PlannerInfo *root,
 	*p_scan_ntuples = ntuples / parallel_divisor;
 	*p_scan_nchunks = nchunks / parallel_divisor;
 	*p_nrows_per_block =
-		((scan_mode & PGSTROM_RELSCAN_SSD2GPU) != 0 ? nrows_per_block : 0);
+		((scan_mode & (PGSTROM_RELSCAN_SSD2GPU |
+					   PGSTROM_RELSCAN_SSD2GPU_PARTIAL)) != 0 ? nrows_per_block : 0);
 	*p_startup_cost = startup_cost;
 	*p_run_cost = run_cost;
 
@@ -743,17 +841,54 @@ pgstromExecInitBrinIndexMap(GpuTaskState *gts,
 	else
 		pi_state->runtime_econtext = NULL;
 
-	/* BRIN index specific initialization */
 	pi_state->nblocks = RelationGetNumberOfBlocks(relation);
-	pi_state->brin_revmap = brinRevmapInitialize(pi_state->index_rel,
-												 &pi_state->range_sz,
-												 estate->es_snapshot);
-	pi_state->brin_desc = brin_build_desc(pi_state->index_rel);
+	if (pi_state->index_rel->rd_rel->relam == BRIN_AM_OID)
+	{
+		/* BRIN index specific initialization */
+		pi_state->brin_revmap = brinRevmapInitialize(pi_state->index_rel,
+													 &pi_state->range_sz,
+													 estate->es_snapshot);
+		pi_state->brin_desc = brin_build_desc(pi_state->index_rel);
+	}
+	else
+	{
+		/* B-tree index builds TID bitmap, then skips per block */
+		Assert(pi_state->index_rel->rd_rel->relam == BTREE_AM_OID);
+		pi_state->range_sz = 1;
+	}
 
 	/* save the state */
 	gts->outer_index_state = pi_state;
 }
 
+/*
+ * pgstromBrinMapBuild - state of the cooperative BRIN-index map build
+ *
+ * It is located prior to the Bitmapset, then parallel workers and the leader
+ * claim segments of BRIN_MAP_SEGMENT_NRANGES ranges to evaluate the BRIN
+ * summaries, and marks the ranges to be skipped. A range not evaluated yet
+ * is just read (lossy), so processes can start scan as soon as no segments
+ * are left to claim. Segments are aligned to the bitmap words, thus only
+ * one process updates a particular word.
+ */
+#define BRIN_MAP_SEGMENT_NRANGES	(16 * BITS_PER_BITMAPWORD)
+
+typedef struct
+{
+	cl_uint				nranges;	/* # of ranges by the leader */
+	cl_uint				nsegments;	/* # of segments to be built */
+	pg_atomic_uint32	next_segment;
+} pgstromBrinMapBuild;
+
+static inline Size
+__pgstromSizeOfBrinIndexMapWords(cl_uint nranges)
+{
+	int		nwords = (nranges + BITS_PER_BITMAPWORD - 1) / BITS_PER_BITMAPWORD;
+
+	return STROMALIGN(offsetof(Bitmapset, words) +
+					  sizeof(bitmapword) * nwords);
+}
+
 /*
  * pgstromSizeOfBrinIndexMap
  */
@@ -761,16 +896,75 @@ Size
 pgstromSizeOfBrinIndexMap(GpuTaskState *gts)
 {
 	pgstromIndexState *pi_state = gts->outer_index_state;
-	int		nwords;
+	int		nranges;
 
 	if (!pi_state)
 		return 0;
 
-	nwords = (pi_state->nblocks +
-			  pi_state->range_sz - 1) / pi_state->range_sz;
-	return STROMALIGN(offsetof(Bitmapset, words) +
-					  sizeof(bitmapword) * nwords);
+	nranges = (pi_state->nblocks +
+			   pi_state->range_sz - 1) / pi_state->range_sz;
+	return (MAXALIGN(sizeof(pgstromBrinMapBuild)) +
+			__pgstromSizeOfBrinIndexMapWords(nranges));
+}
+
+/*
+ * pgstromInitBrinIndexMap
+ *
+ * It initializes the BRIN-index map on the local memory or DSM area.
+ * BRIN-index map is ready to use from the beginning with no ranges to be
+ * skipped, then the scan processes build it cooperatively.
+ * On the other hands, B-tree index map is built by the leader process,
+ * so the map is not valid until completion of the build.
+ */
+void
+pgstromInitBrinIndexMap(GpuTaskState *gts, void *coordinate)
+{
+	pgstromIndexState *pi_state = gts->outer_index_state;
+	pgstromBrinMapBuild *build = coordinate;
+	Bitmapset  *brin_map;
+	cl_uint		nranges;
+	int			nwords;
+
+	Assert(pi_state != NULL);
+	nranges = (pi_state->nblocks +
+			   pi_state->range_sz - 1) / pi_state->range_sz;
+	nwords = (nranges + BITS_PER_BITMAPWORD - 1) / BITS_PER_BITMAPWORD;
+	brin_map = (Bitmapset *)((char *)coordinate +
+							 MAXALIGN(sizeof(pgstromBrinMapBuild)));
+	build->nranges = nranges;
+	if (pi_state->index_rel->rd_rel->relam != BRIN_AM_OID)
+	{
+		build->nsegments = 0;
+		brin_map->nwords = -1;		/* uninitialized */
+	}
+	else
+	{
+		build->nsegments = ((nranges + BRIN_MAP_SEGMENT_NRANGES - 1) /
+							BRIN_MAP_SEGMENT_NRANGES);
+		memset(brin_map->words, 0, sizeof(bitmapword) * nwords);
+		brin_map->nwords = nwords;
+	}
+	pg_atomic_init_u32(&build->next_segment, 0);
+	gts->outer_index_map = brin_map;
+}
+
+/*
+ * pgstromAttachBrinIndexMap
+ *
+ * It attaches the BRIN-index map on the DSM area by the parallel worker.
+ */
+void
+pgstromAttachBrinIndexMap(GpuTaskState *gts, void *coordinate)
+{
+	gts->outer_index_map = (Bitmapset *)((char *)coordinate +
+										 MAXALIGN(sizeof(pgstromBrinMapBuild)));
+}
 
+static inline pgstromBrinMapBuild *
+pgstromBrinMapBuildState(Bitmapset *brin_map)
+{
+	return (pgstromBrinMapBuild *)((char *)brin_map -
+								   MAXALIGN(sizeof(pgstromBrinMapBuild)));
 }
 
 /*
@@ -779,51 +973,28 @@ pgstromSizeOfBrinIndexMap(GpuTaskState *gts)
  * Also see bringetbitmap
  */
 static void
-__pgstromExecGetBrinIndexMap(pgstromIndexState *pi_state,
-							 Bitmapset *brin_map,
-							 Snapshot snapshot)
+__pgstromExecGetBrinIndexMapRange(pgstromIndexState *pi_state,
+								  Bitmapset *brin_map,
+								  Snapshot snapshot,
+								  Buffer *p_buf,
+								  FmgrInfo *consistentFn,
+								  BrinMemTuple **p_dtup,
+								  BrinTuple **p_btup,
+								  Size *p_btupsz,
+								  MemoryContext perRangeCxt,
+								  cl_uint range_head,
+								  cl_uint range_tail,
+								  long merge_gap)
 {
 	BrinDesc	   *bdesc = pi_state->brin_desc;
 	TupleDesc		bd_tupdesc = bdesc->bd_tupdesc;
-	BlockNumber		nblocks = pi_state->nblocks;
 	BlockNumber		range_sz = pi_state->range_sz;
-	BlockNumber		heapBlk;
 	BlockNumber		index;
-	Buffer			buf = InvalidBuffer;
-	FmgrInfo	   *consistentFn;
-	BrinMemTuple   *dtup;
-	BrinTuple	   *btup	__attribute__((unused)) = NULL;
-	Size			btupsz	__attribute__((unused)) = 0;
-	int				nranges;
-	int				nwords;
 	MemoryContext	oldcxt;
-	MemoryContext	perRangeCxt;
-
-	/* rooms for the consistent support procedures of indexed columns */
-	consistentFn = palloc0(sizeof(FmgrInfo) * bd_tupdesc->natts);
-	/* allocate an initial in-memory tuple */
-	dtup = brin_new_memtuple(bdesc);
 
-	/* moves to the working memory context per range */
-	perRangeCxt = AllocSetContextCreate(CurrentMemoryContext,
-										"PG-Strom BRIN-index temporary",
-										ALLOCSET_DEFAULT_SIZES);
-	oldcxt = MemoryContextSwitchTo(perRangeCxt);
-
-	nranges = (pi_state->nblocks +
-			   pi_state->range_sz - 1) / pi_state->range_sz;
-	nwords = (nranges + BITS_PER_BITMAPWORD - 1) / BITS_PER_BITMAPWORD;
-	Assert(brin_map->nwords < 0);
-	memset(brin_map->words, 0, sizeof(bitmapword) * nwords);
-	/*
-	 * Now scan the revmap.  We start by querying for heap page 0,
-	 * incrementing by the number of pages per range; this gives us a full
-	 * view of the table.
-	 */
-	for (heapBlk = 0, index = 0;
-		 heapBlk < nblocks;
-		 heapBlk += range_sz, index++)
+	for (index = range_head; index < range_tail; index++)
 	{
+		BlockNumber	heapBlk = index * range_sz;
 		BrinTuple  *tup;
 		OffsetNumber off;
 		Size		size;
@@ -832,17 +1003,21 @@ __pgstromExecGetBrinIndexMap(pgstromIndexState *pi_state,
 		CHECK_FOR_INTERRUPTS();
 
 		MemoryContextResetAndDeleteChildren(perRangeCxt);
+		oldcxt = MemoryContextSwitchTo(perRangeCxt);
 
 		tup = brinGetTupleForHeapBlock(pi_state->brin_revmap, heapBlk,
-									   &buf, &off, &size,
+									   p_buf, &off, &size,
 									   BUFFER_LOCK_SHARE,
 									   snapshot);
 		if (tup)
 		{
-			btup = brin_copy_tuple(tup, size, btup, &btupsz);
+			BrinMemTuple *dtup;
 
-			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-			dtup = brin_deform_tuple(bdesc, btup, dtup);
+			MemoryContextSwitchTo(oldcxt);
+			*p_btup = brin_copy_tuple(tup, size, *p_btup, p_btupsz);
+			LockBuffer(*p_buf, BUFFER_LOCK_UNLOCK);
+			dtup = *p_dtup = brin_deform_tuple(bdesc, *p_btup, *p_dtup);
+			MemoryContextSwitchTo(perRangeCxt);
 			if (!dtup->bt_placeholder)
 			{
 				for (keyno = 0; keyno < pi_state->num_scan_keys; keyno++)
@@ -864,7 +1039,7 @@ __pgstromExecGetBrinIndexMap(pgstromIndexState *pi_state,
 						tmp = index_getprocinfo(pi_state->index_rel, keyattno,
 												BRIN_PROCNUM_CONSISTENT);
 						fmgr_info_copy(&consistentFn[keyattno - 1], tmp,
-									   CurrentMemoryContext);
+									   oldcxt);
 					}
 
 					/*
@@ -879,20 +1054,163 @@ __pgstromExecGetBrinIndexMap(pgstromIndexState *pi_state,
 										   PointerGetDatum(key));
 					if (!DatumGetBool(rv))
 					{
-						if (index / BITS_PER_BITMAPWORD < nwords)
-							brin_map->words[index / BITS_PER_BITMAPWORD]
-								|= (1U << (index % BITS_PER_BITMAPWORD));
+						brin_map->words[index / BITS_PER_BITMAPWORD]
+							|= (1U << (index % BITS_PER_BITMAPWORD));
 						break;
 					}
 				}
 			}
 		}
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	/*
+	 * A short run of the ranges to be skipped, between the ranges to be
+	 * read, makes SSD2GPU Direct fragmented into many small DMA requests.
+	 * It is cheaper to read the run and filter out by GPU, as long as its
+	 * length is less than @merge_gap ranges.
+	 */
+	if (merge_gap > 0)
+	{
+		long	head = -1;
+
+		for (index = range_head; index < range_tail; index++)
+		{
+			if (brin_map->words[index / BITS_PER_BITMAPWORD] &
+				(1U << (index % BITS_PER_BITMAPWORD)))
+				continue;
+			if (head >= 0 && index - head - 1 > 0 &&
+				index - head - 1 <= merge_gap)
+			{
+				long	k;
+
+				for (k = head + 1; k < index; k++)
+					brin_map->words[k / BITS_PER_BITMAPWORD]
+						&= ~(1U << (k % BITS_PER_BITMAPWORD));
+			}
+			head = index;
+		}
+	}
+}
+
+static void
+__pgstromExecGetBrinIndexMap(pgstromIndexState *pi_state,
+							 Bitmapset *brin_map,
+							 Snapshot snapshot,
+							 long merge_gap)
+{
+	pgstromBrinMapBuild *build = pgstromBrinMapBuildState(brin_map);
+	BrinDesc	   *bdesc = pi_state->brin_desc;
+	Buffer			buf = InvalidBuffer;
+	FmgrInfo	   *consistentFn;
+	BrinMemTuple   *dtup;
+	BrinTuple	   *btup = NULL;
+	Size			btupsz = 0;
+	MemoryContext	perRangeCxt;
+	cl_uint			segment;
+
+	/* quick bailout, if no segments are left */
+	if (pg_atomic_read_u32(&build->next_segment) >= build->nsegments)
+		return;
+
+	/* rooms for the consistent support procedures of indexed columns */
+	consistentFn = palloc0(sizeof(FmgrInfo) * bdesc->bd_tupdesc->natts);
+	/* allocate an initial in-memory tuple */
+	dtup = brin_new_memtuple(bdesc);
+	/* working memory context per range */
+	perRangeCxt = AllocSetContextCreate(CurrentMemoryContext,
+										"PG-Strom BRIN-index temporary",
+										ALLOCSET_DEFAULT_SIZES);
+	/*
+	 * Now scan the revmap by the segment claimed. Each segment is evaluated
+	 * by exactly one of the leader or workers, and ranges are marked as soon
+	 * as its summary tells no tuples can match.
+	 */
+	for (;;)
+	{
+		cl_uint		range_head;
+		cl_uint		range_tail;
+
+		segment = pg_atomic_fetch_add_u32(&build->next_segment, 1);
+		if (segment >= build->nsegments)
+			break;
+		range_head = segment * BRIN_MAP_SEGMENT_NRANGES;
+		range_tail = Min(range_head + BRIN_MAP_SEGMENT_NRANGES,
+						 build->nranges);
+		__pgstromExecGetBrinIndexMapRange(pi_state,
+										  brin_map,
+										  snapshot,
+										  &buf,
+										  consistentFn,
+										  &dtup,
+										  &btup,
+										  &btupsz,
+										  perRangeCxt,
+										  range_head,
+										  range_tail,
+										  merge_gap);
 	}
-	MemoryContextSwitchTo(oldcxt);
 	MemoryContextDelete(perRangeCxt);
 
 	if (buf != InvalidBuffer)
 		ReleaseBuffer(buf);
+	pfree(consistentFn);
+}
+
+/*
+ * __pgstromExecGetBtreeIndexMap
+ *
+ * It builds a TID bitmap using the B-tree index, like BitmapIndexScan,
+ * then marks the blocks not contained in the bitmap to be skipped.
+ */
+static void
+__pgstromExecGetBtreeIndexMap(pgstromIndexState *pi_state,
+							  Bitmapset *brin_map,
+							  Snapshot snapshot)
+{
+	BlockNumber		nblocks = pi_state->nblocks;
+	IndexScanDesc	iscan;
+	TIDBitmap	   *tbm;
+	TBMIterator	   *tbm_iter;
+	TBMIterateResult *tbm_res;
+	int				nwords;
+
+	/* evaluate runtime keys, if any */
+	if (pi_state->num_runtime_keys > 0)
+	{
+		ResetExprContext(pi_state->runtime_econtext);
+		ExecIndexEvalRuntimeKeys(pi_state->runtime_econtext,
+								 pi_state->runtime_keys_info,
+								 pi_state->num_runtime_keys);
+	}
+	tbm = tbm_create(work_mem * 1024L, NULL);
+	iscan = index_beginscan_bitmap(pi_state->index_rel, snapshot,
+								   pi_state->num_scan_keys);
+	index_rescan(iscan, pi_state->scan_keys, pi_state->num_scan_keys,
+				 NULL, 0);
+	index_getbitmap(iscan, tbm);
+	index_endscan(iscan);
+
+	/* all the blocks are skipped, unless TID bitmap contains */
+	nwords = (nblocks + BITS_PER_BITMAPWORD - 1) / BITS_PER_BITMAPWORD;
+	Assert(brin_map->nwords < 0);
+	memset(brin_map->words, ~0, sizeof(bitmapword) * nwords);
+	if (nblocks % BITS_PER_BITMAPWORD != 0)
+		brin_map->words[nwords - 1]
+			&= (((bitmapword) 1 << (nblocks % BITS_PER_BITMAPWORD)) - 1);
+	tbm_iter = tbm_begin_iterate(tbm);
+	while ((tbm_res = tbm_iterate(tbm_iter)) != NULL)
+	{
+		BlockNumber	blkno = tbm_res->blockno;
+
+		CHECK_FOR_INTERRUPTS();
+		if (blkno < nblocks)
+			brin_map->words[blkno / BITS_PER_BITMAPWORD]
+				&= ~((bitmapword) 1 << (blkno % BITS_PER_BITMAPWORD));
+	}
+	tbm_end_iterate(tbm_iter);
+	tbm_free(tbm);
+
 	/* mark this bitmapset is ready */
 	pg_memory_barrier();
 	brin_map->nwords = nwords;
@@ -902,28 +1220,46 @@ void
 pgstromExecGetBrinIndexMap(GpuTaskState *gts)
 {
 	pgstromIndexState *pi_state = gts->outer_index_state;
+	EState	   *estate = gts->css.ss.ps.state;
 
-	if (!gts->outer_index_map || gts->outer_index_map->nwords < 0)
+	if (!gts->outer_index_map)
 	{
-		EState	   *estate = gts->css.ss.ps.state;
+		Assert(!IsParallelWorker());
+		pgstromInitBrinIndexMap(gts, MemoryContextAlloc(estate->es_query_cxt,
+											pgstromSizeOfBrinIndexMap(gts)));
+	}
 
-		if (!gts->outer_index_map)
-		{
-			Assert(!IsParallelWorker());
-			gts->outer_index_map
-				= MemoryContextAlloc(estate->es_query_cxt,
-									 pgstromSizeOfBrinIndexMap(gts));
-			gts->outer_index_map->nwords = -1;
-		}
+	/*
+	 * BRIN-index map is built by all the processes cooperatively, and is
+	 * available to scan regardless of the progress.
+	 */
+	if (pi_state->index_rel->rd_rel->relam == BRIN_AM_OID)
+	{
+		long	merge_gap = 0;
+
+		if (gts->nvme_sstate)
+			merge_gap = (long)
+				(pgstrom_brin_gap_tolerance *
+				 (double)NVMESS_NBlocksPerChunk(gts->nvme_sstate))
+				/ Max(pi_state->range_sz, 1);
+		__pgstromExecGetBrinIndexMap(pi_state,
+									 gts->outer_index_map,
+									 estate->es_snapshot,
+									 merge_gap);
+		return;
+	}
 
+	/* B-tree index map is built by the leader, and workers wait for it */
+	if (gts->outer_index_map->nwords < 0)
+	{
 		ResetLatch(MyLatch);
 		while (gts->outer_index_map->nwords < 0)
 		{
 			if (!IsParallelWorker())
 			{
-				__pgstromExecGetBrinIndexMap(pi_state,
-											 gts->outer_index_map,
-											 estate->es_snapshot);
+				__pgstromExecGetBtreeIndexMap(pi_state,
+											  gts->outer_index_map,
+											  estate->es_snapshot);
 				/* wake up parallel workers if any */
 				if (gts->pcxt)
 				{
@@ -938,31 +1274,12 @@ pgstromExecGetBrinIndexMap(GpuTaskState *gts)
 							ProcSendSignal(pid);
 					}
 				}
-#if 0
-				{
-					Bitmapset *map = gts->outer_index_map;
-					int		i;
-
-					elog(INFO, "BRIN-index (%s) range_sz = %d",
-						 RelationGetRelationName(pi_state->index_rel),
-						 pi_state->range_sz);
-					for (i=0; i < map->nwords; i += 4)
-					{
-						elog(INFO, "% 6d: %08x %08x %08x %08x",
-							 i * BITS_PER_BITMAPWORD,
-							 i+3 < map->nwords ? map->words[i+3] : 0,
-							 i+2 < map->nwords ? map->words[i+2] : 0,
-							 i+1 < map->nwords ? map->words[i+1] : 0,
-							 i   < map->nwords ? map->words[i]   : 0);
-					}
-				}
-#endif
 			}
 			else
 			{
 				int		ev;
 
-				/* wait for completion of BRIN-index preload */
+				/* wait for completion of B-tree index map build */
 				CHECK_FOR_INTERRUPTS();
 
 				ev = WaitLatch(MyLatch,
@@ -985,7 +1302,8 @@ pgstromExecEndBrinIndexMap(GpuTaskState *gts)
 
 	if (!pi_state)
 		return;
-	brinRevmapTerminate(pi_state->brin_revmap);
+	if (pi_state->brin_revmap)
+		brinRevmapTerminate(pi_state->brin_revmap);
 	index_close(pi_state->index_rel, NoLock);
 }
 
@@ -1002,37 +1320,671 @@ pgstromExplainBrinIndexMap(GpuTaskState *gts,
 						   List *dcontext)
 {
 	pgstromIndexState *pi_state = gts->outer_index_state;
+	const char *label;
 	char	   *conds_str;
 	char		temp[128];
 
 	if (!pi_state)
+	{
+		if (gts->outer_zmap_state && es->analyze)
+			ExplainPropertyInteger("Zone Map skipped", "blocks",
+								   gts->outer_brin_count, es);
 		return;
+	}
 
+	label = (pi_state->index_rel->rd_rel->relam == BRIN_AM_OID
+			 ? "BRIN" : "Bitmap Index");
 	conds_str = deparse_expression(pi_state->index_quals,
 								   dcontext, es->verbose, false);
-	ExplainPropertyText("BRIN cond", conds_str, es);
+	snprintf(temp, sizeof(temp), "%s cond", label);
+	ExplainPropertyText(temp, conds_str, es);
 	if (es->analyze)
 	{
 		if (es->format == EXPLAIN_FORMAT_TEXT)
 		{
-			snprintf(temp, sizeof(temp), "%ld of %ld (%.2f%%)",
+			char	buf[128];
+
+			snprintf(buf, sizeof(buf), "%ld of %ld (%.2f%%)",
 					 gts->outer_brin_count,
 					 (long)pi_state->nblocks,
 					 100.0 * ((double) gts->outer_brin_count /
 							  (double) pi_state->nblocks));
-			ExplainPropertyText("BRIN skipped", temp, es);
+			snprintf(temp, sizeof(temp), "%s skipped", label);
+			ExplainPropertyText(temp, buf, es);
 		}
 		else
 		{
-			ExplainPropertyInteger("BRIN fetched", NULL,
+			snprintf(temp, sizeof(temp), "%s fetched", label);
+			ExplainPropertyInteger(temp, NULL,
 								   pi_state->nblocks -
 								   gts->outer_brin_count, es);
-			ExplainPropertyInteger("BRIN skipped", NULL,
+			snprintf(temp, sizeof(temp), "%s skipped", label);
+			ExplainPropertyInteger(temp, NULL,
 								   gts->outer_brin_count, es);
 		}
 	}
 }
 
+/*
+ * Zone map support
+ *
+ * Zone map is an automatically maintained min/max statistics for each
+ * range of ZONE_MAP_RANGE_SZ blocks, on the columns referenced by the
+ * simple comparison (Var OP Const) in the outer quals. It is built during
+ * the full scan of the relation that has no BRIN-index, then, the next
+ * scan will skip the block-ranges that never satisfies the quals.
+ * A zone is valid only if all the blocks in the range were all-visible at
+ * the build time and are still all-visible on the visibility-map, and the
+ * relation has not been modified according to the statistics collector.
+ * The zone map is kept on the backend local memory.
+ */
+#define ZONE_MAP_RANGE_SZ		128
+
+typedef struct
+{
+	Oid			relid;
+	AttrNumber	attnum;
+} ZoneMapKey;
+
+typedef struct
+{
+	ZoneMapKey	key;			/* hash key */
+	Oid			atttypid;
+	int64		nchanges;		/* # of modification at the build time */
+	cl_uint		nzones;
+	bool	   *valid;			/* zone has valid min/max statistics */
+	bool	   *hasval;			/* zone has any non-NULL values */
+	Datum	   *min_values;
+	Datum	   *max_values;
+} ZoneMapEntry;
+
+typedef struct
+{
+	AttrNumber	attnum;
+	int			strategy;		/* btree strategy of (Var OP Const) */
+	Oid			collation;
+	Datum		value;
+	FmgrInfo	cmp_func;		/* comparator of (Var, Const) */
+} ZoneMapCond;
+
+typedef struct
+{
+	AttrNumber	attnum;
+	Oid			atttypid;
+	Oid			collation;
+	FmgrInfo   *cmp_func;		/* comparator of (Var, Var) */
+	bool	   *hasval;
+	Datum	   *min_values;
+	Datum	   *max_values;
+} ZoneMapBuild;
+
+struct pgstromZoneMapState
+{
+	cl_uint		nzones;			/* # of zones at the scan start */
+	int64		nchanges;		/* # of modification at the scan start */
+	List	   *conds;			/* list of ZoneMapCond */
+	int			nbuilds;
+	ZoneMapBuild *builds;		/* columns to be built */
+	bool		build_zone_map;	/* true, if zone map shall be (re-)built */
+	cl_uint	   *nblocks_seen;	/* # of blocks loaded, per zone */
+	bool	   *all_visible;	/* all-visible status, per zone */
+	Buffer		vmbuffer;
+	bool		map_ready;
+	Bitmapset  *skip_map;		/* zones to be skipped */
+};
+typedef struct pgstromZoneMapState pgstromZoneMapState;
+
+static HTAB	   *zone_map_htab = NULL;
+
+/*
+ * zoneMapRelcacheCallback
+ */
+static void
+zoneMapRelcacheCallback(Datum arg, Oid relid)
+{
+	HASH_SEQ_STATUS	hseq;
+	ZoneMapEntry   *entry;
+
+	if (!zone_map_htab)
+		return;
+	hash_seq_init(&hseq, zone_map_htab);
+	while ((entry = hash_seq_search(&hseq)) != NULL)
+	{
+		if (OidIsValid(relid) && entry->key.relid != relid)
+			continue;
+		if (entry->valid)
+			pfree(entry->valid);
+		if (entry->hasval)
+			pfree(entry->hasval);
+		if (entry->min_values)
+			pfree(entry->min_values);
+		if (entry->max_values)
+			pfree(entry->max_values);
+		hash_search(zone_map_htab, &entry->key, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * zoneMapRelationChanges
+ *
+ * It returns the total number of tuples modified on the relation. VACUUM
+ * may set all-visible flag on the modified blocks again, so zone map also
+ * has to be invalidated if this counter was moved.
+ */
+static int64
+zoneMapRelationChanges(Relation relation)
+{
+	Oid			relid = RelationGetRelid(relation);
+	PgStat_StatTabEntry *tabentry;
+	PgStat_TableStatus *tabstat;
+	int64		nchanges = 0;
+
+	tabentry = pgstat_fetch_stat_tabentry(relid);
+	if (tabentry)
+		nchanges += (tabentry->tuples_inserted +
+					 tabentry->tuples_updated +
+					 tabentry->tuples_deleted);
+	tabstat = find_tabstat_entry(relid);
+	if (tabstat)
+		nchanges += (tabstat->t_counts.t_tuples_inserted +
+					 tabstat->t_counts.t_tuples_updated +
+					 tabstat->t_counts.t_tuples_deleted);
+	return nchanges;
+}
+
+/*
+ * zoneMapLookupEntry
+ */
+static ZoneMapEntry *
+zoneMapLookupEntry(Oid relid, AttrNumber attnum, bool create)
+{
+	ZoneMapKey		hkey;
+	ZoneMapEntry   *entry;
+	bool			found;
+
+	if (!zone_map_htab)
+	{
+		HASHCTL		hctl;
+
+		if (!create)
+			return NULL;
+		memset(&hctl, 0, sizeof(HASHCTL));
+		hctl.keysize = sizeof(ZoneMapKey);
+		hctl.entrysize = sizeof(ZoneMapEntry);
+		hctl.hcxt = CacheMemoryContext;
+		zone_map_htab = hash_create("PG-Strom Zone Map", 256, &hctl,
+									HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+	memset(&hkey, 0, sizeof(ZoneMapKey));
+	hkey.relid = relid;
+	hkey.attnum = attnum;
+	entry = hash_search(zone_map_htab, &hkey,
+						create ? HASH_ENTER : HASH_FIND, &found);
+	if (entry && !found)
+	{
+		entry->atttypid = InvalidOid;
+		entry->nchanges = -1;
+		entry->nzones = 0;
+		entry->valid = NULL;
+		entry->hasval = NULL;
+		entry->min_values = NULL;
+		entry->max_values = NULL;
+	}
+	return entry;
+}
+
+/*
+ * zoneMapMatchCondition
+ *
+ * It checks whether the supplied qual is a simple comparison between
+ * a fixed-length, pass-by-value column and a constant.
+ */
+static ZoneMapCond *
+zoneMapMatchCondition(Expr *expr, TupleDesc tupdesc)
+{
+	OpExpr	   *op = (OpExpr *) expr;
+	Node	   *larg;
+	Node	   *rarg;
+	Var		   *var;
+	Const	   *con;
+	Oid			opno;
+	Form_pg_attribute attr;
+	TypeCacheEntry *tcache;
+	Oid			cmp_proc;
+	int			strategy;
+	ZoneMapCond *cond;
+
+	if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+		return NULL;
+	larg = (Node *) linitial(op->args);
+	rarg = (Node *) lsecond(op->args);
+	while (IsA(larg, RelabelType))
+		larg = (Node *)((RelabelType *) larg)->arg;
+	while (IsA(rarg, RelabelType))
+		rarg = (Node *)((RelabelType *) rarg)->arg;
+
+	if (IsA(larg, Var) && IsA(rarg, Const))
+	{
+		var = (Var *) larg;
+		con = (Const *) rarg;
+		opno = op->opno;
+	}
+	else if (IsA(larg, Const) && IsA(rarg, Var))
+	{
+		var = (Var *) rarg;
+		con = (Const *) larg;
+		opno = get_commutator(op->opno);
+		if (!OidIsValid(opno))
+			return NULL;
+	}
+	else
+		return NULL;
+
+	if (var->varlevelsup != 0 ||
+		var->varattno <= 0 ||
+		var->varattno > tupdesc->natts ||
+		con->constisnull)
+		return NULL;
+	attr = tupleDescAttr(tupdesc, var->varattno - 1);
+	if (attr->attisdropped ||
+		attr->atttypid != var->vartype ||
+		!attr->attbyval || attr->attlen <= 0)
+		return NULL;
+
+	tcache = lookup_type_cache(attr->atttypid, TYPECACHE_BTREE_OPFAMILY);
+	if (!OidIsValid(tcache->btree_opf))
+		return NULL;
+	strategy = get_op_opfamily_strategy(opno, tcache->btree_opf);
+	if (strategy < BTLessStrategyNumber ||
+		strategy > BTGreaterStrategyNumber)
+		return NULL;
+	cmp_proc = get_opfamily_proc(tcache->btree_opf,
+								 attr->atttypid,
+								 con->consttype,
+								 BTORDER_PROC);
+	if (!OidIsValid(cmp_proc))
+		return NULL;
+
+	cond = palloc0(sizeof(ZoneMapCond));
+	cond->attnum = attr->attnum;
+	cond->strategy = strategy;
+	cond->collation = op->inputcollid;
+	cond->value = con->constvalue;
+	fmgr_info(cmp_proc, &cond->cmp_func);
+
+	return cond;
+}
+
+/*
+ * pgstromExecInitZoneMap
+ */
+void
+pgstromExecInitZoneMap(GpuTaskState *gts, List *outer_quals)
+{
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	TupleDesc	tupdesc;
+	pgstromZoneMapState *zm_state;
+	Bitmapset  *attnums = NULL;
+	List	   *conds = NIL;
+	ListCell   *lc;
+	int			k, nbuilds;
+
+	gts->outer_zmap_state = NULL;
+	if (!pgstrom_enable_zone_map ||
+		!pgstat_track_counts ||
+		!relation ||
+		(RelationGetForm(relation)->relkind != RELKIND_RELATION &&
+		 RelationGetForm(relation)->relkind != RELKIND_MATVIEW))
+		return;
+
+	tupdesc = RelationGetDescr(relation);
+	foreach (lc, outer_quals)
+	{
+		ZoneMapCond *cond = zoneMapMatchCondition(lfirst(lc), tupdesc);
+
+		if (cond)
+		{
+			conds = lappend(conds, cond);
+			attnums = bms_add_member(attnums, cond->attnum);
+		}
+	}
+	if (conds == NIL)
+		return;
+
+	zm_state = palloc0(sizeof(pgstromZoneMapState));
+	zm_state->nzones = ((RelationGetNumberOfBlocks(relation) +
+						 ZONE_MAP_RANGE_SZ - 1) / ZONE_MAP_RANGE_SZ);
+	zm_state->nchanges = zoneMapRelationChanges(relation);
+	zm_state->conds = conds;
+	zm_state->vmbuffer = InvalidBuffer;
+
+	nbuilds = bms_num_members(attnums);
+	zm_state->builds = palloc0(sizeof(ZoneMapBuild) * nbuilds);
+	k = -1;
+	while ((k = bms_next_member(attnums, k)) >= 0)
+	{
+		ZoneMapBuild *zm_build = &zm_state->builds[zm_state->nbuilds++];
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, k - 1);
+		TypeCacheEntry *tcache;
+
+		tcache = lookup_type_cache(attr->atttypid,
+								   TYPECACHE_CMP_PROC_FINFO);
+		if (!OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+			continue;
+		zm_build->attnum = attr->attnum;
+		zm_build->atttypid = attr->atttypid;
+		zm_build->collation = attr->attcollation;
+		zm_build->cmp_func = &tcache->cmp_proc_finfo;
+		zm_build->hasval = palloc0(sizeof(bool) * zm_state->nzones);
+		zm_build->min_values = palloc0(sizeof(Datum) * zm_state->nzones);
+		zm_build->max_values = palloc0(sizeof(Datum) * zm_state->nzones);
+	}
+	zm_state->nblocks_seen = palloc0(sizeof(cl_uint) * zm_state->nzones);
+	zm_state->all_visible = palloc0(sizeof(bool) * zm_state->nzones);
+	memset(zm_state->all_visible, 1, sizeof(bool) * zm_state->nzones);
+
+	gts->outer_zmap_state = zm_state;
+}
+
+/*
+ * __zoneMapCondIsFalse
+ */
+static bool
+__zoneMapCondIsFalse(ZoneMapCond *cond, ZoneMapEntry *entry, cl_uint zone)
+{
+	Datum		min_value = entry->min_values[zone];
+	Datum		max_value = entry->max_values[zone];
+
+	/* btree operators are strict, so all-NULL zone never match */
+	if (!entry->hasval[zone])
+		return true;
+
+#define ZMCMP(X)												\
+	DatumGetInt32(FunctionCall2Coll(&cond->cmp_func,			\
+									cond->collation,			\
+									(X), cond->value))
+	switch (cond->strategy)
+	{
+		case BTLessStrategyNumber:
+			return ZMCMP(min_value) >= 0;
+		case BTLessEqualStrategyNumber:
+			return ZMCMP(min_value) > 0;
+		case BTEqualStrategyNumber:
+			return ZMCMP(min_value) > 0 || ZMCMP(max_value) < 0;
+		case BTGreaterEqualStrategyNumber:
+			return ZMCMP(max_value) < 0;
+		case BTGreaterStrategyNumber:
+			return ZMCMP(max_value) <= 0;
+		default:
+			break;
+	}
+#undef ZMCMP
+	return false;
+}
+
+/*
+ * pgstromExecGetZoneMap
+ *
+ * It constructs a bitmap of the zones to be skipped, according to the zone
+ * map built by the previous scan.
+ */
+static void
+pgstromExecGetZoneMap(GpuTaskState *gts)
+{
+	pgstromZoneMapState *zm_state = gts->outer_zmap_state;
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	Oid			relid = RelationGetRelid(relation);
+	BlockNumber	nblocks = RelationGetNumberOfBlocks(relation);
+	BlockNumber	blkno;
+	Bitmapset  *skip_map = NULL;
+	ListCell   *lc;
+	cl_uint		zone;
+
+	Assert(!zm_state->map_ready);
+	foreach (lc, zm_state->conds)
+	{
+		ZoneMapCond	   *cond = lfirst(lc);
+		ZoneMapEntry   *entry = zoneMapLookupEntry(relid, cond->attnum, false);
+
+		if (!entry ||
+			entry->nchanges != zm_state->nchanges ||
+			entry->nzones < zm_state->nzones)
+		{
+			zm_state->build_zone_map = true;
+			if (!entry || entry->nchanges != zm_state->nchanges)
+				continue;
+		}
+
+		for (zone=0; zone < Min(entry->nzones, zm_state->nzones); zone++)
+		{
+			if (bms_is_member(zone, skip_map))
+				continue;
+			if (!entry->valid[zone])
+			{
+				zm_state->build_zone_map = true;
+				continue;
+			}
+			if (!__zoneMapCondIsFalse(cond, entry, zone))
+				continue;
+			/* all the blocks in the zone must be still all-visible */
+			for (blkno = zone * ZONE_MAP_RANGE_SZ;
+				 blkno < Min((zone + 1) * ZONE_MAP_RANGE_SZ, nblocks);
+				 blkno++)
+			{
+				if (!VM_ALL_VISIBLE(relation, blkno, &zm_state->vmbuffer))
+					break;
+			}
+			if (blkno < Min((zone + 1) * ZONE_MAP_RANGE_SZ, nblocks))
+			{
+				entry->valid[zone] = false;
+				zm_state->build_zone_map = true;
+				continue;
+			}
+			skip_map = bms_add_member(skip_map, zone);
+		}
+	}
+	zm_state->skip_map = skip_map;
+	zm_state->map_ready = true;
+}
+
+/*
+ * pgstromZoneMapIsBuilding
+ */
+bool
+pgstromZoneMapIsBuilding(GpuTaskState *gts)
+{
+	pgstromZoneMapState *zm_state = gts->outer_zmap_state;
+
+	return (zm_state && zm_state->build_zone_map);
+}
+
+/*
+ * pgstromZoneMapUpdate
+ *
+ * It updates min/max statistics of the zone map under construction, by the
+ * tuples loaded from the block 'blknum' onto row-format.
+ */
+void
+pgstromZoneMapUpdate(GpuTaskState *gts, BlockNumber blknum,
+					 kern_data_store *kds, cl_uint row_base)
+{
+	pgstromZoneMapState *zm_state = gts->outer_zmap_state;
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	cl_uint		zone = blknum / ZONE_MAP_RANGE_SZ;
+	cl_uint		i, j;
+
+	if (!zm_state->build_zone_map || zone >= zm_state->nzones)
+		return;
+	zm_state->nblocks_seen[zone]++;
+	if (!VM_ALL_VISIBLE(relation, blknum, &zm_state->vmbuffer))
+		zm_state->all_visible[zone] = false;
+	if (!zm_state->all_visible[zone])
+		return;
+
+	for (i=row_base; i < kds->nitems; i++)
+	{
+		kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds, i);
+		HeapTupleData	tuple;
+
+		if (!tupitem)
+			continue;
+		tuple.t_len = tupitem->t_len;
+		tuple.t_self = tupitem->t_self;
+		tuple.t_tableOid = RelationGetRelid(relation);
+		tuple.t_data = &tupitem->htup;
+
+		for (j=0; j < zm_state->nbuilds; j++)
+		{
+			ZoneMapBuild *zm_build = &zm_state->builds[j];
+			Datum		datum;
+			bool		isnull;
+
+			if (zm_build->attnum == InvalidAttrNumber)
+				continue;
+			datum = heap_getattr(&tuple, zm_build->attnum, tupdesc, &isnull);
+			if (isnull)
+				continue;
+			if (!zm_build->hasval[zone])
+			{
+				zm_build->hasval[zone] = true;
+				zm_build->min_values[zone] = datum;
+				zm_build->max_values[zone] = datum;
+			}
+			else
+			{
+				if (DatumGetInt32(FunctionCall2Coll(zm_build->cmp_func,
+													zm_build->collation,
+													datum,
+													zm_build->min_values[zone])) < 0)
+					zm_build->min_values[zone] = datum;
+				if (DatumGetInt32(FunctionCall2Coll(zm_build->cmp_func,
+													zm_build->collation,
+													datum,
+													zm_build->max_values[zone])) > 0)
+					zm_build->max_values[zone] = datum;
+			}
+		}
+	}
+}
+
+/*
+ * pgstromZoneMapPublish
+ *
+ * It saves the zone map built by the scan. Only the zones whose blocks were
+ * entirely loaded and all-visible are marked as valid.
+ */
+static void
+pgstromZoneMapPublish(GpuTaskState *gts)
+{
+	pgstromZoneMapState *zm_state = gts->outer_zmap_state;
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	Oid			relid = RelationGetRelid(relation);
+	MemoryContext oldcxt;
+	cl_uint		zone;
+	int			j;
+
+	if (!zm_state->build_zone_map)
+		return;
+	/* relation was modified during the scan? */
+	if (zoneMapRelationChanges(relation) != zm_state->nchanges)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
+	for (j=0; j < zm_state->nbuilds; j++)
+	{
+		ZoneMapBuild   *zm_build = &zm_state->builds[j];
+		ZoneMapEntry   *entry;
+
+		if (zm_build->attnum == InvalidAttrNumber)
+			continue;
+		entry = zoneMapLookupEntry(relid, zm_build->attnum, true);
+		if (entry->nchanges != zm_state->nchanges ||
+			entry->atttypid != zm_build->atttypid)
+			entry->nzones = 0;
+		if (entry->nzones < zm_state->nzones)
+		{
+			if (!entry->valid)
+			{
+				entry->valid = palloc0(sizeof(bool) * zm_state->nzones);
+				entry->hasval = palloc0(sizeof(bool) * zm_state->nzones);
+				entry->min_values = palloc0(sizeof(Datum) * zm_state->nzones);
+				entry->max_values = palloc0(sizeof(Datum) * zm_state->nzones);
+			}
+			else
+			{
+				entry->valid = repalloc(entry->valid,
+										sizeof(bool) * zm_state->nzones);
+				entry->hasval = repalloc(entry->hasval,
+										 sizeof(bool) * zm_state->nzones);
+				entry->min_values = repalloc(entry->min_values,
+											 sizeof(Datum) * zm_state->nzones);
+				entry->max_values = repalloc(entry->max_values,
+											 sizeof(Datum) * zm_state->nzones);
+			}
+			for (zone = entry->nzones; zone < zm_state->nzones; zone++)
+				entry->valid[zone] = false;
+			entry->nzones = zm_state->nzones;
+		}
+		entry->atttypid = zm_build->atttypid;
+		entry->nchanges = zm_state->nchanges;
+
+		for (zone=0; zone < zm_state->nzones; zone++)
+		{
+			if (zm_state->nblocks_seen[zone] != ZONE_MAP_RANGE_SZ)
+				continue;	/* not loaded entirely */
+			if (!zm_state->all_visible[zone])
+				entry->valid[zone] = false;
+			else
+			{
+				entry->valid[zone] = true;
+				entry->hasval[zone] = zm_build->hasval[zone];
+				entry->min_values[zone] = zm_build->min_values[zone];
+				entry->max_values[zone] = zm_build->max_values[zone];
+			}
+		}
+	}
+	MemoryContextSwitchTo(oldcxt);
+	zm_state->build_zone_map = false;
+}
+
+/*
+ * pgstromExecRewindZoneMap
+ */
+static void
+pgstromExecRewindZoneMap(GpuTaskState *gts)
+{
+	pgstromZoneMapState *zm_state = gts->outer_zmap_state;
+	int			j;
+
+	if (!zm_state)
+		return;
+	memset(zm_state->nblocks_seen, 0, sizeof(cl_uint) * zm_state->nzones);
+	memset(zm_state->all_visible, 1, sizeof(bool) * zm_state->nzones);
+	for (j=0; j < zm_state->nbuilds; j++)
+	{
+		ZoneMapBuild   *zm_build = &zm_state->builds[j];
+
+		if (zm_build->attnum != InvalidAttrNumber)
+			memset(zm_build->hasval, 0, sizeof(bool) * zm_state->nzones);
+	}
+}
+
+/*
+ * pgstromExecEndZoneMap
+ */
+void
+pgstromExecEndZoneMap(GpuTaskState *gts)
+{
+	pgstromZoneMapState *zm_state = gts->outer_zmap_state;
+
+	if (zm_state && BufferIsValid(zm_state->vmbuffer))
+	{
+		ReleaseBuffer(zm_state->vmbuffer);
+		zm_state->vmbuffer = InvalidBuffer;
+	}
+}
+
 /*
  * heapscan_report_location
  */
@@ -1048,6 +2000,45 @@ heapscan_report_location(HeapScanDesc hscan)
 #endif
 }
 
+/*
+ * pgstromAdaptiveChunkSize
+ *
+ * It determines the size of the next row-chunk. If
+ * pg_strom.chunk_target_latency is configured, it picks up the largest
+ * chunk size in the range of 1/4 .. 4 times of pg_strom.chunk_size, as
+ * long as the expected latency of GpuTask does not exceed the target.
+ * The latency per MB is measured by the GPU workers, so it reflects the
+ * kernel execution time, DMA time and the retry on resource shortage.
+ */
+static Size
+pgstromAdaptiveChunkSize(GpuTaskState *gts)
+{
+	GpuContext *gcontext = gts->gcontext;
+	Size		chunk_size = pgstrom_chunk_size();
+	Size		chunk_size_max = 4 * chunk_size;
+	double		target_usec;
+	double		usec_per_mb;
+
+	if (pgstrom_chunk_target_latency <= 0)
+		return chunk_size;
+
+	pthreadMutexLock(gcontext->mutex);
+	usec_per_mb = gts->usec_per_mb;
+	pthreadMutexUnlock(gcontext->mutex);
+	if (usec_per_mb > 0.0)
+	{
+		target_usec = 1000.0 * (double)pgstrom_chunk_target_latency;
+		chunk_size /= 4;
+		while (chunk_size < chunk_size_max &&
+			   usec_per_mb * (double)(2 * chunk_size) /
+			   (double)(1UL << 20) <= target_usec)
+			chunk_size *= 2;
+	}
+	gts->chunk_size = chunk_size;
+
+	return chunk_size;
+}
+
 /*
  * pgstromExecHeapScanChunkParallel - read the heap relation by parallel scan
  */
@@ -1233,7 +2224,7 @@ pgstromExecHeapScanChunkParallel(GpuTaskState *gts,
 			else
 				pds = PDS_create_row(gts->gcontext,
 									 RelationGetDescr(relation),
-									 pgstrom_chunk_size());
+									 pgstromAdaptiveChunkSize(gts));
 			pds->kds.table_oid = RelationGetRelid(relation);
 		}
 		/* scan next block */
@@ -1252,6 +2243,35 @@ pgstromExecHeapScanChunkParallel(GpuTaskState *gts,
 	return pds;
 }
 
+/*
+ * pgstromPrefetchBrinRange
+ *
+ * It kicks asynchronous read of the next range to be read, according to
+ * the BRIN-index bitmap, when the scan enters into a range. It skips the
+ * ranges to be skipped, so we can prefetch the blocks beyond them, unlike
+ * the read-ahead by the kernel.
+ */
+static void
+pgstromPrefetchBrinRange(Relation rel, BlockNumber nblocks,
+						 Bitmapset *brin_map, cl_long brin_range_sz,
+						 cl_long page)
+{
+#ifdef USE_PREFETCH
+	long	pos = page / brin_range_sz + 1;
+	long	nranges = (nblocks + brin_range_sz - 1) / brin_range_sz;
+	long	blkno;
+
+	while (pos < nranges && bms_is_member(pos, brin_map))
+		pos++;
+	if (pos >= nranges)
+		return;
+	for (blkno = pos * brin_range_sz;
+		 blkno < Min((pos + 1) * brin_range_sz, (long)nblocks);
+		 blkno++)
+		PrefetchBuffer(rel, MAIN_FORKNUM, (BlockNumber)blkno);
+#endif
+}
+
 /*
  * pgstromExecHeapScanChunk
  */
@@ -1303,6 +2323,43 @@ pgstromExecHeapScanChunk(GpuTaskState *gts,
 				gts->outer_brin_count += (page - prev);
 				goto skip;
 			}
+			/* SSD2GPU Direct reads the storage without buffers */
+			if (!gts->nvme_sstate && page % brin_range_sz == 0)
+				pgstromPrefetchBrinRange(rel, hscan->rs_nblocks,
+										 brin_map, brin_range_sz, page);
+		}
+
+		/*
+		 * If any, try to load the columnar cache instead of the heap blocks
+		 * when the scan reaches head of the chunk. Chunk across the start
+		 * block of synchronized scan is never used.
+		 */
+		if (gts->ccache_state &&
+			(page % CCACHE_CHUNK_NBLOCKS) == 0 &&
+			page + CCACHE_CHUNK_NBLOCKS <= hscan->rs_nblocks &&
+			!(page < hscan->rs_startblock &&
+			  hscan->rs_startblock < page + CCACHE_CHUNK_NBLOCKS))
+		{
+			if (pds)
+			{
+				/* returns the current PDS first, if chunk is cached */
+				if (pgstromColumnarCacheIsReady(gts, page))
+					break;
+			}
+			else
+			{
+				pds = pgstromExecScanColumnarCache(gts, page);
+				if (pds)
+				{
+					page += CCACHE_CHUNK_NBLOCKS;
+					hscan->rs_cblock = (page < hscan->rs_nblocks ? page : 0);
+					heapscan_report_location(hscan);
+					/* end of the scan? */
+					if (hscan->rs_cblock == hscan->rs_startblock)
+						hscan->rs_cblock = InvalidBlockNumber;
+					break;
+				}
+			}
 		}
 
 		/* allocation of row-based PDS on demand */
@@ -1315,7 +2372,7 @@ pgstromExecHeapScanChunk(GpuTaskState *gts,
 			else
 				pds = PDS_create_row(gts->gcontext,
 									 RelationGetDescr(rel),
-									 pgstrom_chunk_size());
+									 pgstromAdaptiveChunkSize(gts));
 			pds->kds.table_oid = RelationGetRelid(rel);
 		}
 		/* scan the next block */
@@ -1378,11 +2435,34 @@ pgstromExecScanChunk(GpuTaskState *gts)
 	brin_map = gts->outer_index_map;
 	if (brin_map)
 		brin_range_sz = gts->outer_index_state->range_sz;
+	else if (!gts->outer_index_state && gts->outer_zmap_state)
+	{
+		/* Elsewhere, use the zone map built by the previous scan */
+		if (!gts->outer_zmap_state->map_ready)
+			pgstromExecGetZoneMap(gts);
+		brin_map = gts->outer_zmap_state->skip_map;
+		brin_range_sz = ZONE_MAP_RANGE_SZ;
+	}
 
-	if (gts->gtss)
-		pds = pgstromExecHeapScanChunkParallel(gts, brin_map, brin_range_sz);
-	else
-		pds = pgstromExecHeapScanChunk(gts, brin_map, brin_range_sz);
+	/*
+	 * Tuples may be still copied by the helper threads on return, so we
+	 * have to wait for them prior to the reference and error cleanup.
+	 */
+	PG_TRY();
+	{
+		if (gts->gtss)
+			pds = pgstromExecHeapScanChunkParallel(gts, brin_map,
+												   brin_range_sz);
+		else
+			pds = pgstromExecHeapScanChunk(gts, brin_map, brin_range_sz);
+		PDS_wait_heapscan_copy();
+	}
+	PG_CATCH();
+	{
+		PDS_wait_heapscan_copy();
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
 
 	if (pds)
 	{
@@ -1425,6 +2505,9 @@ pgstromExecScanChunk(GpuTaskState *gts)
 	else
 	{
 		InstrStopNode(&gts->outer_instrument, 0.0);
+		/* end of the scan; save the zone map, if built */
+		if (gts->outer_zmap_state)
+			pgstromZoneMapPublish(gts);
 	}
 	return pds;
 }
@@ -1443,6 +2526,7 @@ pgstromRewindScanChunk(GpuTaskState *gts)
 		table_rescan(tscan, NULL);
 		ExecScanReScan(&gts->css.ss);
 	}
+	pgstromExecRewindZoneMap(gts);
 }
 
 /*
@@ -1629,4 +2713,54 @@ pgstrom_init_relscan(void)
 							 PGC_USERSET,
                              GUC_NOT_IN_SAMPLE,
                              NULL, NULL, NULL);
+	/* pg_strom.enable_btree_bitmap */
+	DefineCustomBoolVariable("pg_strom.enable_btree_bitmap",
+							 "Enables to use B-tree index to build block bitmap",
+							 NULL,
+							 &pgstrom_enable_btree_bitmap,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.enable_zone_map */
+	DefineCustomBoolVariable("pg_strom.enable_zone_map",
+							 "Enables to use zone map built on the previous scan",
+							 NULL,
+							 &pgstrom_enable_zone_map,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	CacheRegisterRelcacheCallback(zoneMapRelcacheCallback, 0);
+	/* pg_strom.brin_gap_tolerance */
+	DefineCustomRealVariable("pg_strom.brin_gap_tolerance",
+							 "Ratio of the chunk size to read the gap between BRIN ranges anyway",
+							 NULL,
+							 &pgstrom_brin_gap_tolerance,
+							 0.25,
+							 0.0,
+							 1.0,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.enable_inline_toast */
+	DefineCustomBoolVariable("pg_strom.enable_inline_toast",
+							 "Enables to load external toast datum inline on row-chunk",
+							 NULL,
+							 &pgstrom_enable_inline_toast,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.heapscan_copy_threads */
+	DefineCustomIntVariable("pg_strom.heapscan_copy_threads",
+							"Number of helper threads to copy heap tuples onto row-chunk",
+							NULL,
+							&pgstrom_heapscan_copy_threads,
+							2,
+							0,
+							64,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
 }
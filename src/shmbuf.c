@@ -23,6 +23,11 @@
 #define SHMBUF_CHUNKSZ_MAX_BIT		32		/* 4GB */
 #define SHMBUF_CHUNKSZ_MIN			(1U << SHMBUF_CHUNKSZ_MIN_BIT)
 #define SHMBUF_CHUNKSZ_MAX			(1U << SHMBUF_CHUNKSZ_MAX_BIT)
+#define SHMBUF_QUICKLIST_MAX_BIT	13		/* 8KB */
+#define SHMBUF_QUICKLIST_NSLOTS		(SHMBUF_QUICKLIST_MAX_BIT -	\
+									 SHMBUF_CHUNKSZ_MIN_BIT + 1)
+#define SHMBUF_QUICKLIST_MAX_ITEMS	256
+#define SHMBUF_HUGEPAGE_SIZE		(2UL << 20)		/* 2MB */
 
 typedef struct
 {
@@ -76,12 +81,28 @@ typedef struct
 	bool			is_attached;/* true, if segment is already attached */
 } shmBufferLocalMap;
 
+/*
+ * shmBufferQuickList - free list of small chunks per size-class
+ *
+ * Chunks on the quick-list are still active from the standpoint of the
+ * buddy allocator, so they are neither merged nor dropped with the segment.
+ * It allows alloc/free of small chunks by the lock of its size-class only,
+ * without the lock of shmBufferContext.
+ */
+typedef struct
+{
+	slock_t			lock;
+	uint32			nitems;
+	slist_head		chunks;		/* slist_node is located on chunk->data */
+} shmBufferQuickList;
+
 typedef struct
 {
 	MemoryContextData header;	/* Standard memory-context fields */
 	dlist_node		chain;		/* link to shmem_context_list */
 	slock_t			lock;		/* Lock for shared memory allocation */
 	dlist_head		active_segment_list;
+	shmBufferQuickList quick_lists[SHMBUF_QUICKLIST_NSLOTS];
 	char			namebuf[FLEXIBLE_ARRAY_MEMBER];
 } shmBufferContext;
 
@@ -92,6 +113,7 @@ static struct sigaction sigaction_orig_sigbus;
 static size_t	shmbuf_segment_size;
 static int		shmbuf_segment_size_kb;		/* GUC */
 static int		shmbuf_num_logical_segment;	/* GUC */
+static bool		shmbuf_huge_pages;			/* GUC */
 static shmBufferSegmentHead *shmBufSegHead = NULL;	/* shared memory */
 static shmBufferLocalMap *shmBufLocalMaps = NULL;
 static char	   *shmbuf_segment_vaddr_head = NULL;
@@ -134,6 +156,42 @@ shmBufferSegmentFromChunk(shmBufferChunk *chunk)
 }
 
 
+/*
+ * shmBufferAdviseHugePages
+ *
+ * Segments are files on tmpfs, so MAP_HUGETLB is not available. Instead,
+ * we advise the kernel to back the mapping by transparent huge pages; it
+ * needs /sys/kernel/mm/transparent_hugepage/shmem_enabled = advise (or
+ * always). Failure is harmless, so we never raise an error here; it is
+ * also called in the signal handler.
+ */
+static inline void
+shmBufferAdviseHugePages(char *mmap_ptr)
+{
+#ifdef MADV_HUGEPAGE
+	if (shmbuf_huge_pages)
+		(void) madvise(mmap_ptr, shmbuf_segment_size, MADV_HUGEPAGE);
+#endif
+}
+
+/*
+ * shmBufferQuickListInit
+ */
+static void
+shmBufferQuickListInit(shmBufferContext *context)
+{
+	int		i;
+
+	for (i=0; i < SHMBUF_QUICKLIST_NSLOTS; i++)
+	{
+		shmBufferQuickList *qlist = &context->quick_lists[i];
+
+		SpinLockInit(&qlist->lock);
+		qlist->nitems = 0;
+		slist_init(&qlist->chunks);
+	}
+}
+
 #define SHMBUF_SEGMENT_FILENAME(namebuf,segment_id,revision)	\
 	snprintf((namebuf),NAMEDATALEN,"/.pg_shmbuf_%u.%u:%u",	\
 			 PostPortNumber,(segment_id),(revision)>>1)
@@ -250,6 +308,7 @@ shmBufferAttachSegmentOnDemand(int signum, siginfo_t *siginfo, void *unused)
 			goto normal_crash;
 		}
 		close(fdesc);
+		shmBufferAdviseHugePages(mmap_ptr);
 		SpinLockRelease(&lmap->mutex);
 
 		/* problem solved */
@@ -368,6 +427,7 @@ shmBufferCreateSegment(void)
 		elog(ERROR, "failed on mmap('%s'): %m", namebuf);
 	}
 	close(fdesc);
+	shmBufferAdviseHugePages(mmap_ptr);
 
 	/*
 	 * Ok, successfully mapped.
@@ -685,6 +745,38 @@ shmemContextAlloc(MemoryContext __context, Size required)
 {
 	shmBufferContext *context = (shmBufferContext *) __context;
 	shmBufferChunk *chunk;
+	Size		chunk_sz;
+	int			mclass;
+
+	/* fast path: small chunk on the quick-list */
+	chunk_sz = (offsetof(shmBufferChunk, data) +	/* header */
+				required +							/* payload */
+				sizeof(uint32));					/* magic */
+	mclass = Max(get_next_log2(chunk_sz), SHMBUF_CHUNKSZ_MIN_BIT);
+	if (mclass <= SHMBUF_QUICKLIST_MAX_BIT)
+	{
+		shmBufferQuickList *qlist
+			= &context->quick_lists[mclass - SHMBUF_CHUNKSZ_MIN_BIT];
+		slist_node *snode = NULL;
+
+		SpinLockAcquire(&qlist->lock);
+		if (!slist_is_empty(&qlist->chunks))
+		{
+			snode = slist_pop_head_node(&qlist->chunks);
+			qlist->nitems--;
+		}
+		SpinLockRelease(&qlist->lock);
+		if (snode)
+		{
+			chunk = SHMBUF_POINTER_GET_CHUNK(snode);
+			Assert(chunk->mclass == mclass &&
+				   chunk->memcxt == __context &&
+				   SHMBUF_CHUNK_MAGIC_HEAD(chunk) == SHMBUF_CHUNK_MAGIC_CODE);
+			chunk->required = required;
+			SHMBUF_CHUNK_MAGIC_TAIL(chunk) = SHMBUF_CHUNK_MAGIC_CODE;
+			return chunk->data;
+		}
+	}
 
 	SpinLockAcquire(&context->lock);
 	PG_TRY();
@@ -737,6 +829,24 @@ shmemContextFree(MemoryContext __context, void *pointer)
 	shmBufferChunk	   *chunk = SHMBUF_POINTER_GET_CHUNK(pointer);
 	shmBufferSegment   *seg = shmBufferSegmentFromChunk(chunk);
 
+	/* fast path: small chunk is kept on the quick-list */
+	if (chunk->mclass <= SHMBUF_QUICKLIST_MAX_BIT)
+	{
+		shmBufferQuickList *qlist
+			= &context->quick_lists[chunk->mclass - SHMBUF_CHUNKSZ_MIN_BIT];
+
+		Assert(SHMBUF_CHUNK_CHECK_MAGIC(chunk));
+		SpinLockAcquire(&qlist->lock);
+		if (qlist->nitems < SHMBUF_QUICKLIST_MAX_ITEMS)
+		{
+			slist_push_head(&qlist->chunks, (slist_node *)chunk->data);
+			qlist->nitems++;
+			SpinLockRelease(&qlist->lock);
+			return;
+		}
+		SpinLockRelease(&qlist->lock);
+	}
+
 	SpinLockAcquire(&context->lock);
 	Assert(shmemPointerValidation(context, seg, chunk));
 
@@ -881,6 +991,8 @@ shmemContextReset(MemoryContext __context)
 		dlist_push_head(&shmBufSegHead->free_segment_list, &seg->chain);
 		SpinLockRelease(&shmBufSegHead->lock);
 	}
+	/* chunks on the quick-list have gone with the segments */
+	shmBufferQuickListInit(context);
 	SpinLockRelease(&context->lock);
 }
 
@@ -1257,6 +1369,7 @@ SharedMemoryContextCreate(const char *name)
 	mcxt->name = scxt->namebuf;
 	SpinLockInit(&scxt->lock);
 	dlist_init(&scxt->active_segment_list);
+	shmBufferQuickListInit(scxt);
 
 	SpinLockAcquire(&shmBufSegHead->lock);
 	dlist_push_tail(&shmBufSegHead->shmem_context_list, &scxt->chain);
@@ -1328,6 +1441,7 @@ pgstrom_startup_shmbuf(void)
 	scxt = (shmBufferContext *)chunk->data;
 	SpinLockInit(&scxt->lock);
 	dlist_init(&scxt->active_segment_list);
+	shmBufferQuickListInit(scxt);
 	dlist_push_tail(&scxt->active_segment_list, &seg->chain);
 	chunk->memcxt = (MemoryContext) scxt;
 	
@@ -1389,14 +1503,30 @@ pgstrom_init_shmbuf(void)
 							PGC_POSTMASTER,
 							GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
-	/* preserver private address space but no physical memory assignment */
+
+	DefineCustomBoolVariable("shmbuf.huge_pages",
+							 "Enables transparent huge pages on the shared memory segments",
+							 NULL,
+							 &shmbuf_huge_pages,
+							 false,
+							 PGC_POSTMASTER,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/*
+	 * preserve private address space but no physical memory assignment.
+	 * Segments are aligned to the huge page boundary, so that THP can
+	 * back them entirely.
+	 */
 	length = shmbuf_segment_size * shmbuf_num_logical_segment;
-	shmbuf_segment_vaddr_head = mmap(NULL, length,
+	shmbuf_segment_vaddr_head = mmap(NULL, length + SHMBUF_HUGEPAGE_SIZE,
 									 PROT_NONE,
 									 MAP_PRIVATE | MAP_ANONYMOUS,
 									 -1, 0);
 	if (shmbuf_segment_vaddr_head == MAP_FAILED)
 		elog(ERROR, "failed on mmap(2): %m");
+	shmbuf_segment_vaddr_head = (char *)
+		TYPEALIGN(SHMBUF_HUGEPAGE_SIZE, shmbuf_segment_vaddr_head);
 	shmbuf_segment_vaddr_tail = shmbuf_segment_vaddr_head + length;
 
 	/* allocation of static shared memory */
@@ -373,6 +373,60 @@ SELECT id, a<=b v1, a<=d v2, a<=f v3,
 (SELECT * FROM test25g EXCEPT ALL SELECT * FROM test25p) ORDER BY id;
 (SELECT * FROM test25p EXCEPT ALL SELECT * FROM test25g) ORDER BY id;
 
+-- aggregate functions on float2, including NaN and overflow to infinity
+CREATE TABLE rt_float2 (
+  id   int,
+  gid  int,
+  v    float2
+);
+INSERT INTO rt_float2 (
+  SELECT x, x % 6,
+         CASE x % 6
+         WHEN 0 THEN pgstrom.random_float(2, -3200.0, 3200.0)
+         WHEN 1 THEN CASE WHEN x % 50 = 1 THEN 'NaN'::float8
+                          ELSE pgstrom.random_float(2, -3200.0, 3200.0)
+                          END
+         WHEN 2 THEN 'NaN'::float8
+         WHEN 3 THEN pgstrom.random_float(2, 30000.0, 90000.0)
+         WHEN 4 THEN CASE WHEN x % 100 = 4  THEN 'Infinity'::float8
+                          WHEN x % 100 = 52 THEN '-Infinity'::float8
+                          ELSE pgstrom.random_float(2, -60000.0, 60000.0)
+                          END
+         ELSE NULL
+         END
+    FROM generate_series(1,6000) x);
+SET pg_strom.enabled = on;
+SELECT gid, min(v), max(v), sum(v), avg(v),
+       variance(v) var, var_pop(v), stddev(v)
+  INTO test30g
+  FROM rt_float2
+ GROUP BY gid;
+SET pg_strom.enabled = off;
+SELECT gid, min(v), max(v), sum(v), avg(v),
+       variance(v) var, var_pop(v), stddev(v)
+  INTO test30p
+  FROM rt_float2
+ GROUP BY gid;
+(SELECT gid, min, max, sum, avg FROM test30g
+ EXCEPT ALL
+ SELECT gid, min, max, sum, avg FROM test30p) ORDER BY gid;
+(SELECT gid, min, max, sum, avg FROM test30p
+ EXCEPT ALL
+ SELECT gid, min, max, sum, avg FROM test30g) ORDER BY gid;
+SELECT gid, g.var, p.var, g.var_pop, p.var_pop, g.stddev, p.stddev
+  FROM test30g g FULL OUTER JOIN test30p p USING (gid)
+ WHERE NOT coalesce(g.var IS NOT DISTINCT FROM p.var OR
+                    (g.var <> 'NaN' AND p.var <> 'NaN' AND
+                     abs(g.var - p.var) <= 1.0e-9 * abs(p.var)), false)
+    OR NOT coalesce(g.var_pop IS NOT DISTINCT FROM p.var_pop OR
+                    (g.var_pop <> 'NaN' AND p.var_pop <> 'NaN' AND
+                     abs(g.var_pop - p.var_pop) <= 1.0e-9 * abs(p.var_pop)), false)
+    OR NOT coalesce(g.stddev IS NOT DISTINCT FROM p.stddev OR
+                    (g.stddev <> 'NaN' AND p.stddev <> 'NaN' AND
+                     abs(g.stddev - p.stddev) <= 1.0e-9 * abs(p.stddev)), false)
+ ORDER BY gid;
+SELECT gid, max, sum, avg FROM test30g WHERE gid >= 2 ORDER BY gid;
+
 -- cleanup temporary resource
 SET client_min_messages = error;
 DROP SCHEMA regtest_dtype_float_temp CASCADE;
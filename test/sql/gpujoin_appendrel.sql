@@ -0,0 +1,174 @@
+---
+--- Test for GpuJoin/GpuPreAgg push-down to inheritance children and UNION ALL
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_appendrel_temp CASCADE;
+CREATE SCHEMA regtest_appendrel_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_appendrel_temp,public;
+SELECT pgstrom.random_setseed(20200512);
+
+CREATE TABLE rt_dim (aid int, label text);
+INSERT INTO rt_dim (SELECT x, md5(x::text) FROM generate_series(1,100) x);
+
+CREATE TABLE rt_inh (id int, aid int, x float8);
+CREATE TABLE rt_inh_1 () INHERITS (rt_inh);
+CREATE TABLE rt_inh_2 () INHERITS (rt_inh);
+INSERT INTO rt_inh_1 (SELECT x, pgstrom.random_int(0, 1, 120),
+                                pgstrom.random_float(1, -100.0, 100.0)
+                        FROM generate_series(1,40000) x);
+INSERT INTO rt_inh_2 (SELECT x, pgstrom.random_int(1, 1, 120),
+                                pgstrom.random_float(0, -100.0, 100.0)
+                        FROM generate_series(40001,80000) x);
+
+CREATE TABLE rt_uni_1 (id int, aid int, x float8);
+CREATE TABLE rt_uni_2 (id int, aid int, x float8);
+INSERT INTO rt_uni_1 (SELECT * FROM rt_inh_1);
+INSERT INTO rt_uni_2 (SELECT * FROM rt_inh_2);
+VACUUM ANALYZE rt_dim, rt_inh, rt_inh_1, rt_inh_2, rt_uni_1, rt_uni_2;
+
+-- returns whether GpuJoin/GpuPreAgg is pushed down under the Append
+CREATE FUNCTION pushed_down_under_append(qry text)
+RETURNS bool AS
+$$
+DECLARE
+  plan  jsonb;
+BEGIN
+  EXECUTE 'EXPLAIN (costs off, format json) ' || qry INTO plan;
+  RETURN EXISTS (
+    WITH RECURSIVE n(node, under_append) AS (
+      SELECT plan->0->'Plan', false
+    UNION ALL
+      SELECT c, n.under_append OR n.node->>'Node Type' = 'Append'
+        FROM n, jsonb_array_elements(n.node->'Plans') c
+    )
+    SELECT 1 FROM n
+     WHERE under_append
+       AND node->>'Node Type' = 'Custom Scan'
+       AND node->>'Custom Plan Provider' IN ('GpuJoin', 'GpuPreAgg'));
+END
+$$ LANGUAGE plpgsql;
+
+-- disables CPU joins and kernel source
+SET max_parallel_workers_per_gather = 0;
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+SET pg_strom.debug_kernel_source = off;
+SET pg_strom.enable_partitionwise_gpujoin = on;
+SET pg_strom.enable_partitionwise_gpupreagg = on;
+
+-- inheritance parent
+SET pg_strom.enabled = on;
+SELECT pushed_down_under_append(
+  'SELECT id, aid, x, label FROM rt_inh NATURAL JOIN rt_dim WHERE x > 0');
+SELECT pushed_down_under_append(
+  'SELECT label, count(*), sum(x) FROM rt_inh NATURAL JOIN rt_dim GROUP BY label');
+SELECT id, aid, x, label INTO test01g
+  FROM rt_inh NATURAL JOIN rt_dim WHERE x > 0;
+SELECT label, count(*), sum(x) INTO test02g
+  FROM rt_inh NATURAL JOIN rt_dim GROUP BY label;
+SET pg_strom.enabled = off;
+SELECT id, aid, x, label INTO test01p
+  FROM rt_inh NATURAL JOIN rt_dim WHERE x > 0;
+SELECT label, count(*), sum(x) INTO test02p
+  FROM rt_inh NATURAL JOIN rt_dim GROUP BY label;
+(SELECT * FROM test01g EXCEPT ALL SELECT * FROM test01p) ORDER BY id;
+(SELECT * FROM test01p EXCEPT ALL SELECT * FROM test01g) ORDER BY id;
+SELECT g.label, g.count, p.count, g.sum, p.sum
+  FROM test02g g FULL OUTER JOIN test02p p ON g.label = p.label
+ WHERE g.label IS NULL OR p.label IS NULL
+    OR g.count != p.count OR abs(g.sum - p.sum) > 0.0001
+ ORDER BY g.label;
+
+-- UNION ALL of tables
+SET pg_strom.enabled = on;
+SELECT pushed_down_under_append(
+  'SELECT id, aid, x, label
+     FROM (SELECT id, aid, x FROM rt_uni_1
+           UNION ALL
+           SELECT id, aid, x FROM rt_uni_2) u NATURAL JOIN rt_dim
+    WHERE x > 0');
+SELECT pushed_down_under_append(
+  'SELECT label, count(*), sum(x)
+     FROM (SELECT id, aid, x FROM rt_uni_1
+           UNION ALL
+           SELECT id, aid, x FROM rt_uni_2) u NATURAL JOIN rt_dim
+    GROUP BY label');
+SELECT id, aid, x, label INTO test03g
+  FROM (SELECT id, aid, x FROM rt_uni_1
+        UNION ALL
+        SELECT id, aid, x FROM rt_uni_2) u NATURAL JOIN rt_dim
+ WHERE x > 0;
+SELECT label, count(*), sum(x) INTO test04g
+  FROM (SELECT id, aid, x FROM rt_uni_1
+        UNION ALL
+        SELECT id, aid, x FROM rt_uni_2) u NATURAL JOIN rt_dim
+ GROUP BY label;
+SET pg_strom.enabled = off;
+SELECT id, aid, x, label INTO test03p
+  FROM (SELECT id, aid, x FROM rt_uni_1
+        UNION ALL
+        SELECT id, aid, x FROM rt_uni_2) u NATURAL JOIN rt_dim
+ WHERE x > 0;
+SELECT label, count(*), sum(x) INTO test04p
+  FROM (SELECT id, aid, x FROM rt_uni_1
+        UNION ALL
+        SELECT id, aid, x FROM rt_uni_2) u NATURAL JOIN rt_dim
+ GROUP BY label;
+(SELECT * FROM test03g EXCEPT ALL SELECT * FROM test03p) ORDER BY id;
+(SELECT * FROM test03p EXCEPT ALL SELECT * FROM test03g) ORDER BY id;
+SELECT g.label, g.count, p.count, g.sum, p.sum
+  FROM test04g g FULL OUTER JOIN test04p p ON g.label = p.label
+ WHERE g.label IS NULL OR p.label IS NULL
+    OR g.count != p.count OR abs(g.sum - p.sum) > 0.0001
+ ORDER BY g.label;
+
+-- UNION ALL with expressions; must not be pushed down to the children
+SET pg_strom.enabled = on;
+SELECT pushed_down_under_append(
+  'SELECT id, aid, x, label
+     FROM (SELECT id, aid, x FROM rt_uni_1
+           UNION ALL
+           SELECT id, aid + 1, x * 2 FROM rt_uni_2) u NATURAL JOIN rt_dim
+    WHERE x > 0');
+SELECT pushed_down_under_append(
+  'SELECT label, count(*), sum(x)
+     FROM (SELECT id, aid, 1.0::float8 x FROM rt_uni_1
+           UNION ALL
+           SELECT id, aid, x FROM rt_uni_2) u NATURAL JOIN rt_dim
+    GROUP BY label');
+SELECT id, aid, x, label INTO test05g
+  FROM (SELECT id, aid, x FROM rt_uni_1
+        UNION ALL
+        SELECT id, aid + 1, x * 2 FROM rt_uni_2) u NATURAL JOIN rt_dim
+ WHERE x > 0;
+SELECT label, count(*), sum(x) INTO test06g
+  FROM (SELECT id, aid, 1.0::float8 x FROM rt_uni_1
+        UNION ALL
+        SELECT id, aid, x FROM rt_uni_2) u NATURAL JOIN rt_dim
+ GROUP BY label;
+SET pg_strom.enabled = off;
+SELECT id, aid, x, label INTO test05p
+  FROM (SELECT id, aid, x FROM rt_uni_1
+        UNION ALL
+        SELECT id, aid + 1, x * 2 FROM rt_uni_2) u NATURAL JOIN rt_dim
+ WHERE x > 0;
+SELECT label, count(*), sum(x) INTO test06p
+  FROM (SELECT id, aid, 1.0::float8 x FROM rt_uni_1
+        UNION ALL
+        SELECT id, aid, x FROM rt_uni_2) u NATURAL JOIN rt_dim
+ GROUP BY label;
+(SELECT * FROM test05g EXCEPT ALL SELECT * FROM test05p) ORDER BY id;
+(SELECT * FROM test05p EXCEPT ALL SELECT * FROM test05g) ORDER BY id;
+SELECT g.label, g.count, p.count, g.sum, p.sum
+  FROM test06g g FULL OUTER JOIN test06p p ON g.label = p.label
+ WHERE g.label IS NULL OR p.label IS NULL
+    OR g.count != p.count OR abs(g.sum - p.sum) > 0.0001
+ ORDER BY g.label;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_appendrel_temp CASCADE;
@@ -0,0 +1,185 @@
+---
+--- Test for SEMI / ANTI join by GpuHashJoin and GpuNestLoop
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_gpujoin_semi_temp CASCADE;
+CREATE SCHEMA regtest_gpujoin_semi_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_gpujoin_semi_temp,public;
+SELECT pgstrom.random_setseed(20200620);
+
+CREATE TABLE sj_outer (
+  id    int,
+  aid   int,
+  x     float8,
+  memo  text
+);
+INSERT INTO sj_outer (
+  SELECT x, pgstrom.random_int(1, 1, 5000),
+            pgstrom.random_float(1, -100.0, 100.0),
+            pgstrom.random_text_len(1, 60)
+    FROM generate_series(1,20000) x);
+-- compressed varlena; GPU kernel cannot handle, then CPU fallback
+UPDATE sj_outer SET memo = repeat(md5(id::text), 200) WHERE id % 997 = 0;
+
+-- inner relation with NULL join keys and duplicated keys
+CREATE TABLE sj_inner (
+  aid   int,
+  tag   text,
+  y     float8
+);
+INSERT INTO sj_inner (
+  SELECT CASE WHEN x % 50 = 0 THEN NULL ELSE x % 3000 + 1 END,
+         substring(md5(x::text), 1, 2),
+         pgstrom.random_float(1, -100.0, 100.0)
+    FROM generate_series(1,9000) x);
+
+-- inner relation of GpuNestLoop, larger than a block of GPU threads
+CREATE TABLE sj_large (
+  aid   int,
+  y     float8
+);
+INSERT INTO sj_large (
+  SELECT pgstrom.random_int(1, 1, 5000),
+         pgstrom.random_float(1, -100.0, 100.0)
+    FROM generate_series(1,6000) x);
+VACUUM ANALYZE sj_outer, sj_inner, sj_large;
+
+-- disables CPU joins and kernel source
+SET max_parallel_workers_per_gather = 0;
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+SET pg_strom.debug_kernel_source = off;
+
+-- SEMI join by EXISTS
+SET pg_strom.enabled = on;
+SELECT id, aid, x INTO test01g
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid);
+SET pg_strom.enabled = off;
+SELECT id, aid, x INTO test01p
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid);
+(SELECT * FROM test01g EXCEPT ALL SELECT * FROM test01p) ORDER BY id;
+(SELECT * FROM test01p EXCEPT ALL SELECT * FROM test01g) ORDER BY id;
+
+-- ANTI join by NOT EXISTS
+SET pg_strom.enabled = on;
+SELECT id, aid, x INTO test02g
+  FROM sj_outer o
+ WHERE NOT EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid);
+SET pg_strom.enabled = off;
+SELECT id, aid, x INTO test02p
+  FROM sj_outer o
+ WHERE NOT EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid);
+(SELECT * FROM test02g EXCEPT ALL SELECT * FROM test02p) ORDER BY id;
+(SELECT * FROM test02p EXCEPT ALL SELECT * FROM test02g) ORDER BY id;
+
+-- SEMI join by IN (subquery)
+SET pg_strom.enabled = on;
+SELECT id, aid, x INTO test03g
+  FROM sj_outer o
+ WHERE aid IN (SELECT aid FROM sj_inner WHERE y > 0.0);
+SET pg_strom.enabled = off;
+SELECT id, aid, x INTO test03p
+  FROM sj_outer o
+ WHERE aid IN (SELECT aid FROM sj_inner WHERE y > 0.0);
+(SELECT * FROM test03g EXCEPT ALL SELECT * FROM test03p) ORDER BY id;
+(SELECT * FROM test03p EXCEPT ALL SELECT * FROM test03g) ORDER BY id;
+
+-- SEMI / ANTI join with join qualifiers other than the hash keys
+SET pg_strom.enabled = on;
+SELECT id, aid, x INTO test04g
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid AND i.y < o.x);
+SELECT id, aid, x INTO test05g
+  FROM sj_outer o
+ WHERE NOT EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid AND i.y < o.x);
+SET pg_strom.enabled = off;
+SELECT id, aid, x INTO test04p
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid AND i.y < o.x);
+SELECT id, aid, x INTO test05p
+  FROM sj_outer o
+ WHERE NOT EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid AND i.y < o.x);
+(SELECT * FROM test04g EXCEPT ALL SELECT * FROM test04p) ORDER BY id;
+(SELECT * FROM test04p EXCEPT ALL SELECT * FROM test04g) ORDER BY id;
+(SELECT * FROM test05g EXCEPT ALL SELECT * FROM test05p) ORDER BY id;
+(SELECT * FROM test05p EXCEPT ALL SELECT * FROM test05g) ORDER BY id;
+
+-- SEMI / ANTI join by GpuNestLoop with non-equality join qualifiers
+SET pg_strom.enabled = on;
+SELECT id, aid, x INTO test06g
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_inner i
+                WHERE i.aid BETWEEN o.aid - 1 AND o.aid + 1 AND i.y > o.x);
+SELECT id, aid, x INTO test07g
+  FROM sj_outer o
+ WHERE NOT EXISTS (SELECT 1 FROM sj_inner i
+                    WHERE i.aid BETWEEN o.aid - 1 AND o.aid + 1 AND i.y > o.x);
+SET pg_strom.enabled = off;
+SELECT id, aid, x INTO test06p
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_inner i
+                WHERE i.aid BETWEEN o.aid - 1 AND o.aid + 1 AND i.y > o.x);
+SELECT id, aid, x INTO test07p
+  FROM sj_outer o
+ WHERE NOT EXISTS (SELECT 1 FROM sj_inner i
+                    WHERE i.aid BETWEEN o.aid - 1 AND o.aid + 1 AND i.y > o.x);
+(SELECT * FROM test06g EXCEPT ALL SELECT * FROM test06p) ORDER BY id;
+(SELECT * FROM test06p EXCEPT ALL SELECT * FROM test06g) ORDER BY id;
+(SELECT * FROM test07g EXCEPT ALL SELECT * FROM test07p) ORDER BY id;
+(SELECT * FROM test07p EXCEPT ALL SELECT * FROM test07g) ORDER BY id;
+
+-- GpuNestLoop whose inner relation is larger than a block
+SET pg_strom.enabled = on;
+SELECT id, aid, x INTO test08g
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_large l WHERE l.aid < o.aid AND l.y > o.x + 99.0);
+SELECT id, aid, x INTO test09g
+  FROM sj_outer o
+ WHERE NOT EXISTS (SELECT 1 FROM sj_large l WHERE l.aid < o.aid AND l.y > o.x + 99.0);
+SET pg_strom.enabled = off;
+SELECT id, aid, x INTO test08p
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_large l WHERE l.aid < o.aid AND l.y > o.x + 99.0);
+SELECT id, aid, x INTO test09p
+  FROM sj_outer o
+ WHERE NOT EXISTS (SELECT 1 FROM sj_large l WHERE l.aid < o.aid AND l.y > o.x + 99.0);
+(SELECT * FROM test08g EXCEPT ALL SELECT * FROM test08p) ORDER BY id;
+(SELECT * FROM test08p EXCEPT ALL SELECT * FROM test08g) ORDER BY id;
+(SELECT * FROM test09g EXCEPT ALL SELECT * FROM test09p) ORDER BY id;
+(SELECT * FROM test09p EXCEPT ALL SELECT * FROM test09g) ORDER BY id;
+
+-- SEMI / ANTI join with CPU fallback
+SET pg_strom.cpu_fallback = on;
+SET pg_strom.enabled = on;
+SELECT id, aid, x INTO test10g
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_inner i
+                WHERE i.aid = o.aid AND o.memo LIKE '%' || i.tag || '%');
+SELECT id, aid, x INTO test11g
+  FROM sj_outer o
+ WHERE memo LIKE '%ab%'
+   AND NOT EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid);
+SET pg_strom.enabled = off;
+SELECT id, aid, x INTO test10p
+  FROM sj_outer o
+ WHERE EXISTS (SELECT 1 FROM sj_inner i
+                WHERE i.aid = o.aid AND o.memo LIKE '%' || i.tag || '%');
+SELECT id, aid, x INTO test11p
+  FROM sj_outer o
+ WHERE memo LIKE '%ab%'
+   AND NOT EXISTS (SELECT 1 FROM sj_inner i WHERE i.aid = o.aid);
+(SELECT * FROM test10g EXCEPT ALL SELECT * FROM test10p) ORDER BY id;
+(SELECT * FROM test10p EXCEPT ALL SELECT * FROM test10g) ORDER BY id;
+(SELECT * FROM test11g EXCEPT ALL SELECT * FROM test11p) ORDER BY id;
+(SELECT * FROM test11p EXCEPT ALL SELECT * FROM test11g) ORDER BY id;
+RESET pg_strom.cpu_fallback;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_gpujoin_semi_temp CASCADE;
@@ -0,0 +1,281 @@
+---
+--- Test for GpuWindowAgg, GpuTopN and GpuSort
+---
+SET pg_strom.regression_test_mode = on;
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS regtest_gpusort_window_temp CASCADE;
+CREATE SCHEMA regtest_gpusort_window_temp;
+RESET client_min_messages;
+
+SET search_path = regtest_gpusort_window_temp,public;
+SELECT pgstrom.random_setseed(20200705);
+
+-- partition keys with NULL, NaN and Infinity; order keys with NULL
+CREATE TABLE rt_win (
+  id    int,
+  gkey  float8,
+  okey  int,
+  ival  int,
+  fval  float8
+);
+INSERT INTO rt_win (
+  SELECT x, CASE WHEN x % 50 = 0 THEN NULL
+                 WHEN x % 37 = 0 THEN 'NaN'::float8
+                 WHEN x % 41 = 0 THEN 'Infinity'::float8
+                 ELSE pgstrom.random_int(0, 1, 40)::float8
+            END,
+            pgstrom.random_int(2, 1, 500),
+            pgstrom.random_int(2, -1000, 1000),
+            CASE WHEN x % 101 = 0 THEN 'NaN'::float8
+                 ELSE pgstrom.random_float(2, -100.0, 100.0)
+            END
+    FROM generate_series(1,30000) x);
+VACUUM ANALYZE rt_win;
+
+-- returns whether the custom scan node is in the plan
+CREATE FUNCTION gpusort_in_plan(qry text, provider text)
+RETURNS bool AS
+$$
+DECLARE
+  plan  jsonb;
+BEGIN
+  EXECUTE 'EXPLAIN (costs off, format json) ' || qry INTO plan;
+  RETURN EXISTS (
+    WITH RECURSIVE n(node) AS (
+      SELECT plan->0->'Plan'
+    UNION ALL
+      SELECT c FROM n, jsonb_array_elements(n.node->'Plans') c
+    )
+    SELECT 1 FROM n
+     WHERE node->>'Node Type' = 'Custom Scan'
+       AND node->>'Custom Plan Provider' = provider);
+END
+$$ LANGUAGE plpgsql;
+
+-- returns whether GpuWindowAgg computed window functions on CPU
+CREATE FUNCTION cpu_window_functions(qry text)
+RETURNS bool AS
+$$
+DECLARE
+  plan  jsonb;
+BEGIN
+  EXECUTE 'EXPLAIN (analyze, costs off, timing off, summary off, format json) '
+       || qry INTO plan;
+  RETURN EXISTS (
+    WITH RECURSIVE n(node) AS (
+      SELECT plan->0->'Plan'
+    UNION ALL
+      SELECT c FROM n, jsonb_array_elements(n.node->'Plans') c
+    )
+    SELECT 1 FROM n WHERE node ? 'CPU Window Functions');
+END
+$$ LANGUAGE plpgsql;
+
+-- disables parallel scan and kernel source, and prefers GPU
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.debug_kernel_source = off;
+SET pg_strom.gpusort_threshold = 0;
+SET pg_strom.gpu_setup_cost = 0;
+SET pg_strom.gpu_dma_cost = 0;
+SET pg_strom.gpu_operator_cost = 0.00001;
+
+-- row_number(), rank() and dense_rank()
+SET pg_strom.enabled = on;
+SELECT gpusort_in_plan(
+  'SELECT id, row_number() OVER (PARTITION BY gkey ORDER BY okey, id)
+     FROM rt_win', 'GpuWindowAgg');
+SELECT id, gkey, okey,
+       row_number() OVER (PARTITION BY gkey ORDER BY okey, id) rn
+  INTO test01g
+  FROM rt_win;
+SELECT id, gkey, okey,
+       rank() OVER w rk, dense_rank() OVER w drk
+  INTO test02g
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey);
+SELECT id, fval,
+       rank() OVER w rk, dense_rank() OVER w drk
+  INTO test03g
+  FROM rt_win
+WINDOW w AS (ORDER BY fval DESC NULLS LAST);
+SET pg_strom.enabled = off;
+SELECT id, gkey, okey,
+       row_number() OVER (PARTITION BY gkey ORDER BY okey, id) rn
+  INTO test01p
+  FROM rt_win;
+SELECT id, gkey, okey,
+       rank() OVER w rk, dense_rank() OVER w drk
+  INTO test02p
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey);
+SELECT id, fval,
+       rank() OVER w rk, dense_rank() OVER w drk
+  INTO test03p
+  FROM rt_win
+WINDOW w AS (ORDER BY fval DESC NULLS LAST);
+(SELECT * FROM test01g EXCEPT ALL SELECT * FROM test01p) ORDER BY id;
+(SELECT * FROM test01p EXCEPT ALL SELECT * FROM test01g) ORDER BY id;
+(SELECT * FROM test02g EXCEPT ALL SELECT * FROM test02p) ORDER BY id;
+(SELECT * FROM test02p EXCEPT ALL SELECT * FROM test02g) ORDER BY id;
+(SELECT * FROM test03g EXCEPT ALL SELECT * FROM test03p) ORDER BY id;
+(SELECT * FROM test03p EXCEPT ALL SELECT * FROM test03g) ORDER BY id;
+
+-- aggregates on RANGE frame with peer rows, ROWS frame, entire partition
+SET pg_strom.enabled = on;
+SELECT gpusort_in_plan(
+  'SELECT id, count(*) OVER (PARTITION BY gkey ORDER BY okey) FROM rt_win',
+  'GpuWindowAgg');
+SELECT id, count(*) OVER w cnt, count(ival) OVER w cnt_i, sum(ival) OVER w sum_i,
+       min(fval) OVER w min_f, max(fval) OVER w max_f
+  INTO test04g
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey
+             RANGE BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW);
+SELECT id, count(*) OVER w cnt, count(ival) OVER w cnt_i, sum(ival) OVER w sum_i,
+       min(fval) OVER w min_f, max(fval) OVER w max_f
+  INTO test05g
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey, id
+             ROWS BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW);
+SELECT id, count(*) OVER w cnt, count(ival) OVER w cnt_i, sum(ival) OVER w sum_i,
+       min(fval) OVER w min_f, max(fval) OVER w max_f
+  INTO test06g
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey DESC NULLS LAST
+             ROWS BETWEEN UNBOUNDED PRECEDING AND UNBOUNDED FOLLOWING);
+SELECT id, count(*) OVER () cnt, sum(ival) OVER () sum_i,
+       min(fval) OVER () min_f, max(fval) OVER () max_f
+  INTO test07g
+  FROM rt_win;
+SET pg_strom.enabled = off;
+SELECT id, count(*) OVER w cnt, count(ival) OVER w cnt_i, sum(ival) OVER w sum_i,
+       min(fval) OVER w min_f, max(fval) OVER w max_f
+  INTO test04p
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey
+             RANGE BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW);
+SELECT id, count(*) OVER w cnt, count(ival) OVER w cnt_i, sum(ival) OVER w sum_i,
+       min(fval) OVER w min_f, max(fval) OVER w max_f
+  INTO test05p
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey, id
+             ROWS BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW);
+SELECT id, count(*) OVER w cnt, count(ival) OVER w cnt_i, sum(ival) OVER w sum_i,
+       min(fval) OVER w min_f, max(fval) OVER w max_f
+  INTO test06p
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey DESC NULLS LAST
+             ROWS BETWEEN UNBOUNDED PRECEDING AND UNBOUNDED FOLLOWING);
+SELECT id, count(*) OVER () cnt, sum(ival) OVER () sum_i,
+       min(fval) OVER () min_f, max(fval) OVER () max_f
+  INTO test07p
+  FROM rt_win;
+(SELECT * FROM test04g EXCEPT ALL SELECT * FROM test04p) ORDER BY id;
+(SELECT * FROM test04p EXCEPT ALL SELECT * FROM test04g) ORDER BY id;
+(SELECT * FROM test05g EXCEPT ALL SELECT * FROM test05p) ORDER BY id;
+(SELECT * FROM test05p EXCEPT ALL SELECT * FROM test05g) ORDER BY id;
+(SELECT * FROM test06g EXCEPT ALL SELECT * FROM test06p) ORDER BY id;
+(SELECT * FROM test06p EXCEPT ALL SELECT * FROM test06g) ORDER BY id;
+(SELECT * FROM test07g EXCEPT ALL SELECT * FROM test07p) ORDER BY id;
+(SELECT * FROM test07p EXCEPT ALL SELECT * FROM test07g) ORDER BY id;
+
+-- outer rows overflow the chunk; window functions are computed on CPU
+SET pg_strom.enabled = on;
+SET pg_strom.gpuwindowagg_max_chunk_size = '1MB';
+SELECT cpu_window_functions(
+  'SELECT id, row_number() OVER (PARTITION BY gkey ORDER BY okey, id)
+     FROM rt_win');
+SELECT cpu_window_functions(
+  'SELECT id, count(*) OVER () FROM rt_win');
+SELECT id, gkey, okey,
+       row_number() OVER (PARTITION BY gkey ORDER BY okey, id) rn
+  INTO test11c
+  FROM rt_win;
+SELECT id, gkey, okey,
+       rank() OVER w rk, dense_rank() OVER w drk
+  INTO test12c
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey);
+SELECT id, fval,
+       rank() OVER w rk, dense_rank() OVER w drk
+  INTO test13c
+  FROM rt_win
+WINDOW w AS (ORDER BY fval DESC NULLS LAST);
+SELECT id, count(*) OVER w cnt, count(ival) OVER w cnt_i, sum(ival) OVER w sum_i,
+       min(fval) OVER w min_f, max(fval) OVER w max_f
+  INTO test14c
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey
+             RANGE BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW);
+SELECT id, count(*) OVER w cnt, count(ival) OVER w cnt_i, sum(ival) OVER w sum_i,
+       min(fval) OVER w min_f, max(fval) OVER w max_f
+  INTO test15c
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey, id
+             ROWS BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW);
+SELECT id, count(*) OVER w cnt, count(ival) OVER w cnt_i, sum(ival) OVER w sum_i,
+       min(fval) OVER w min_f, max(fval) OVER w max_f
+  INTO test16c
+  FROM rt_win
+WINDOW w AS (PARTITION BY gkey ORDER BY okey DESC NULLS LAST
+             ROWS BETWEEN UNBOUNDED PRECEDING AND UNBOUNDED FOLLOWING);
+SELECT id, count(*) OVER () cnt, sum(ival) OVER () sum_i,
+       min(fval) OVER () min_f, max(fval) OVER () max_f
+  INTO test17c
+  FROM rt_win;
+RESET pg_strom.gpuwindowagg_max_chunk_size;
+(SELECT * FROM test11c EXCEPT ALL SELECT * FROM test01p) ORDER BY id;
+(SELECT * FROM test01p EXCEPT ALL SELECT * FROM test11c) ORDER BY id;
+(SELECT * FROM test12c EXCEPT ALL SELECT * FROM test02p) ORDER BY id;
+(SELECT * FROM test02p EXCEPT ALL SELECT * FROM test12c) ORDER BY id;
+(SELECT * FROM test13c EXCEPT ALL SELECT * FROM test03p) ORDER BY id;
+(SELECT * FROM test03p EXCEPT ALL SELECT * FROM test13c) ORDER BY id;
+(SELECT * FROM test14c EXCEPT ALL SELECT * FROM test04p) ORDER BY id;
+(SELECT * FROM test04p EXCEPT ALL SELECT * FROM test14c) ORDER BY id;
+(SELECT * FROM test15c EXCEPT ALL SELECT * FROM test05p) ORDER BY id;
+(SELECT * FROM test05p EXCEPT ALL SELECT * FROM test15c) ORDER BY id;
+(SELECT * FROM test16c EXCEPT ALL SELECT * FROM test06p) ORDER BY id;
+(SELECT * FROM test06p EXCEPT ALL SELECT * FROM test16c) ORDER BY id;
+(SELECT * FROM test17c EXCEPT ALL SELECT * FROM test07p) ORDER BY id;
+(SELECT * FROM test07p EXCEPT ALL SELECT * FROM test17c) ORDER BY id;
+
+-- ORDER BY ... LIMIT by GpuTopN, ORDER BY by GpuSort
+SET pg_strom.enabled = on;
+SELECT gpusort_in_plan(
+  'SELECT id FROM rt_win ORDER BY gkey NULLS FIRST, fval DESC, id LIMIT 200',
+  'GpuTopN');
+SELECT gpusort_in_plan(
+  'SELECT id FROM rt_win ORDER BY gkey, okey DESC, id', 'GpuSort');
+SELECT array_agg(id) ids INTO test21g
+  FROM (SELECT id FROM rt_win
+         ORDER BY gkey NULLS FIRST, fval DESC, id LIMIT 200) s;
+SELECT array_agg(id) ids INTO test22g
+  FROM (SELECT id FROM rt_win
+         ORDER BY fval, okey DESC NULLS LAST, id LIMIT 1000) s;
+SELECT array_agg(id) ids INTO test23g
+  FROM (SELECT id FROM rt_win
+         ORDER BY gkey, okey DESC, id) s;
+SELECT array_agg(id) ids INTO test24g
+  FROM (SELECT id FROM rt_win
+         ORDER BY fval DESC NULLS LAST, gkey NULLS FIRST, id) s;
+SET pg_strom.enabled = off;
+SELECT array_agg(id) ids INTO test21p
+  FROM (SELECT id FROM rt_win
+         ORDER BY gkey NULLS FIRST, fval DESC, id LIMIT 200) s;
+SELECT array_agg(id) ids INTO test22p
+  FROM (SELECT id FROM rt_win
+         ORDER BY fval, okey DESC NULLS LAST, id LIMIT 1000) s;
+SELECT array_agg(id) ids INTO test23p
+  FROM (SELECT id FROM rt_win
+         ORDER BY gkey, okey DESC, id) s;
+SELECT array_agg(id) ids INTO test24p
+  FROM (SELECT id FROM rt_win
+         ORDER BY fval DESC NULLS LAST, gkey NULLS FIRST, id) s;
+SELECT g.ids = p.ids FROM test21g g, test21p p;
+SELECT g.ids = p.ids FROM test22g g, test22p p;
+SELECT g.ids = p.ids FROM test23g g, test23p p;
+SELECT g.ids = p.ids FROM test24g g, test24p p;
+
+-- cleanup temporary resource
+SET client_min_messages = error;
+DROP SCHEMA regtest_gpusort_window_temp CASCADE;
@@ -0,0 +1,21 @@
+---
+--- Performance regression test for GpuJoin
+---
+SET search_path = pgstrom_perf,public;
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.enabled = on;
+SET pg_strom.enable_gpupreagg = off;
+SET pg_strom.cpu_fallback = on;
+
+SELECT * FROM pgstrom_perf.run('gpujoin_hash',
+$$SELECT count(*), sum(f.x)
+    FROM t_fact f, t_dim_a a, t_dim_b b
+   WHERE f.aid = a.aid AND f.bid = b.bid
+     AND a.grp < 50 AND b.grp IN (1, 3, 5)$$);
+
+SET pg_strom.enable_gpuhashjoin = off;
+SELECT * FROM pgstrom_perf.run('gpujoin_nestloop',
+$$SELECT count(*), sum(f.y)
+    FROM t_fact f, t_dim_b b
+   WHERE f.x < b.grp * 10.0 AND f.bid < b.bid AND b.bid < 20$$);
+RESET pg_strom.enable_gpuhashjoin;
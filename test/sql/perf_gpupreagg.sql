@@ -0,0 +1,18 @@
+---
+--- Performance regression test for GpuPreAgg
+---
+SET search_path = pgstrom_perf,public;
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.enabled = on;
+SET pg_strom.cpu_fallback = on;
+
+SELECT * FROM pgstrom_perf.run('gpupreagg_group',
+$$SELECT cat, count(*), sum(x), avg(y), min(x), max(y)
+    FROM t_fact
+   GROUP BY cat$$);
+
+SELECT * FROM pgstrom_perf.run('gpupreagg_join',
+$$SELECT a.grp, count(*), avg(f.x + f.y)
+    FROM t_fact f, t_dim_a a
+   WHERE f.aid = a.aid
+   GROUP BY a.grp$$);
@@ -0,0 +1,16 @@
+---
+--- Performance regression test for GpuScan
+---
+SET search_path = pgstrom_perf,public;
+SET max_parallel_workers_per_gather = 0;
+SET pg_strom.enabled = on;
+SET pg_strom.enable_gpupreagg = off;
+SET pg_strom.cpu_fallback = on;
+
+SELECT * FROM pgstrom_perf.run('gpuscan_filter',
+$$SELECT count(*) FROM t_fact
+   WHERE x > 20.0 AND y < 50.0 AND cat % 7 = 3$$);
+
+SELECT * FROM pgstrom_perf.run('gpuscan_projection',
+$$SELECT id, x * y + 1.0, sqrt(x) FROM t_fact
+   WHERE x BETWEEN 40.0 AND 60.0 AND memo IS NOT NULL$$);
@@ -0,0 +1,164 @@
+--
+-- initialization of performance regression test
+--
+-- pgstrom_perf.run(TEST, QUERY) runs EXPLAIN ANALYZE on the QUERY a few
+-- times, then reports the plan shape and whether the GPU nodes run without
+-- CPU fallback, and whether the best execution time is within the budget
+-- of pgstrom_perf.thresholds (multiplied by pgstrom_perf.threshold_factor,
+-- if any). The key counters are recorded at pgstrom_perf.results.
+--
+-- NOTE: the default thresholds are generous enough for the recent GPUs;
+-- you can relax or tighten them without editing the tests, like:
+--   PGOPTIONS="-c pgstrom_perf.threshold_factor=2.0" make perfcheck
+--
+SET client_min_messages = error;
+DROP SCHEMA IF EXISTS pgstrom_perf CASCADE;
+RESET client_min_messages;
+CREATE SCHEMA pgstrom_perf;
+SET search_path = pgstrom_perf,public;
+
+-- test data
+SELECT pgstrom.random_setseed(20200401);
+CREATE TABLE t_fact (
+  id     int,
+  cat    int,
+  aid    int,
+  bid    int,
+  x      float8,
+  y      float8,
+  memo   text
+);
+INSERT INTO t_fact (
+  SELECT i, pgstrom.random_int(0, 0, 99),
+            pgstrom.random_int(0, 1, 10000),
+            pgstrom.random_int(0, 1, 1000),
+            pgstrom.random_float(0.5, 0.0, 100.0),
+            pgstrom.random_float(0.5, 0.0, 100.0),
+            pgstrom.random_text_len(0.5, 24)
+    FROM generate_series(1,4000000) i);
+CREATE TABLE t_dim_a (
+  aid    int,
+  grp    int,
+  label  text
+);
+INSERT INTO t_dim_a (
+  SELECT i, pgstrom.random_int(0, 0, 99),
+            pgstrom.random_text_len(0, 16)
+    FROM generate_series(1,10000) i);
+CREATE TABLE t_dim_b (
+  bid    int,
+  grp    int,
+  label  text
+);
+INSERT INTO t_dim_b (
+  SELECT i, pgstrom.random_int(0, 0, 9),
+            pgstrom.random_text_len(0, 16)
+    FROM generate_series(1,1000) i);
+VACUUM ANALYZE t_fact, t_dim_a, t_dim_b;
+
+-- elapsed time budget per test [ms]
+CREATE TABLE thresholds (
+  test     text PRIMARY KEY,
+  max_ms   float8 NOT NULL
+);
+INSERT INTO thresholds VALUES
+  ('gpuscan_filter',       3000.0),
+  ('gpuscan_projection',   3000.0),
+  ('gpujoin_hash',         4000.0),
+  ('gpujoin_nestloop',     6000.0),
+  ('gpupreagg_group',      3000.0),
+  ('gpupreagg_join',       5000.0),
+  ('arrow_gpuscan',        2000.0),
+  ('arrow_gpupreagg',      2000.0);
+
+-- results of the run
+CREATE TABLE results (
+  test         text,
+  plan_shape   text,
+  gpu_tasks    bigint,
+  fallbacks    bigint,
+  nvme_blocks  bigint,
+  exec_ms      float8,
+  max_ms       float8,
+  run_at       timestamptz DEFAULT now()
+);
+
+-- "Node(Child, ...)" form of the plan tree
+CREATE FUNCTION plan_shape(node jsonb)
+RETURNS text AS
+$$
+DECLARE
+  label    text := coalesce(node->>'Custom Plan Provider',
+                            node->>'Node Type');
+  child    jsonb;
+  subplans text[] := '{}';
+BEGIN
+  IF node ? 'Plans' THEN
+    FOR child IN SELECT jsonb_array_elements(node->'Plans')
+    LOOP
+      subplans := subplans || plan_shape(child);
+    END LOOP;
+    RETURN label || '(' || array_to_string(subplans, ', ') || ')';
+  END IF;
+  RETURN label;
+END;
+$$ LANGUAGE plpgsql SET search_path = pgstrom_perf;
+
+CREATE FUNCTION run(p_test text, p_query text, p_nloops int = 3)
+RETURNS TABLE (test text, plan_shape text, gpu_executed bool,
+               fallback_free bool, within_threshold bool) AS
+$$
+DECLARE
+  v_plan      jsonb;
+  v_exec_ms   float8;
+  v_best_ms   float8;
+  v_max_ms    float8;
+  v_factor    float8;
+  v_tasks     bigint;
+  v_fallbacks bigint;
+  v_blocks    bigint;
+  v_shape     text;
+  i           int;
+BEGIN
+  -- the first run also warms up the cache and the GPU program
+  FOR i IN 0 .. p_nloops
+  LOOP
+    EXECUTE 'EXPLAIN (ANALYZE, VERBOSE, FORMAT JSON) ' || p_query INTO v_plan;
+    v_exec_ms := (v_plan->0->>'Execution Time')::float8;
+    IF i > 0 AND (v_best_ms IS NULL OR v_best_ms > v_exec_ms) THEN
+      v_best_ms := v_exec_ms;
+    END IF;
+  END LOOP;
+
+  WITH RECURSIVE nodes(n) AS (
+    SELECT v_plan->0->'Plan'
+    UNION ALL
+    SELECT jsonb_array_elements(n->'Plans') FROM nodes WHERE n ? 'Plans'
+  )
+  SELECT coalesce(sum((n->>'GPU Tasks')::bigint), 0),
+         coalesce(sum((n->>'CPU fallbacks')::bigint), 0) +
+         coalesce(sum((n->>'Num of CPU fallback rows')::bigint), 0),
+         coalesce(sum((n->>'NVMe-Strom Load Blocks')::bigint), 0)
+    INTO v_tasks, v_fallbacks, v_blocks
+    FROM nodes;
+
+  v_factor := coalesce(nullif(current_setting('pgstrom_perf.threshold_factor',
+                                              true), '')::float8, 1.0);
+  SELECT t.max_ms * v_factor INTO v_max_ms
+    FROM thresholds t WHERE t.test = p_test;
+  IF NOT FOUND THEN
+    RAISE EXCEPTION 'no threshold is defined for test "%"', p_test;
+  END IF;
+  v_shape := pgstrom_perf.plan_shape(v_plan->0->'Plan');
+
+  INSERT INTO results VALUES (p_test, v_shape, v_tasks, v_fallbacks,
+                              v_blocks, v_best_ms, v_max_ms);
+  IF v_best_ms > v_max_ms THEN
+    RAISE WARNING 'test "%" took %ms, but threshold is %ms',
+                  p_test, round(v_best_ms::numeric, 3), v_max_ms;
+  END IF;
+
+  RETURN QUERY SELECT p_test, v_shape, v_tasks > 0,
+                      v_fallbacks = 0, v_best_ms <= v_max_ms;
+END;
+$$ LANGUAGE plpgsql SET search_path = pgstrom_perf,public;
@@ -1,30 +1,249 @@
 #!/bin/sh
-
-YMD=`date +%Y%m%d`
-DIR=~/ssbm-logs
-CWD=`dirname $0`
+#
+# run-ssbm.sh - Star Schema Benchmark harness of PG-Strom
+#
+# It (optionally) generates the SSBM dataset by dbgen-ssbm at the given
+# scale factor, then loads the heap tables and the Arrow variant of the
+# lineorder table (by pg2arrow), and runs every query N times for each
+# combination of the execution mode (pgsql / strom), the data source
+# (heap / arrow) and the cache state (cold / warm).
+# Execution time is picked up from EXPLAIN ANALYZE, then written out to
+# results.csv and results.json. If a baseline (results.csv of the former
+# run) is given, comparison of the median is written to compare.csv.
+#
+CWD=`cd \`dirname $0\` && pwd`
 DBNAME="ssbm"
+SCALE=""
+NLOOPS=3
+MODES="pgsql strom"
+SOURCES="heap"
+CACHES="cold warm"
+OUTDIR=""
+ARROW_DIR=""
+BASELINE=""
+NWORKERS=2
+DBGEN=""
+
+usage()
+{
+  cat <<EOF
+usage: `basename $0` [OPTIONS] [DBNAME]
+
+  -d DBNAME     database name (default: ssbm)
+  -s SCALE      generates and loads the dataset at the scale factor
+                (existing tables are dropped; skip loading if omitted)
+  -a DIR        directory of the Arrow files; it enables the 'arrow'
+                data source, and writes lineorder.arrow by pg2arrow
+                when -s is given
+  -n NLOOPS     number of runs per query and cache state (default: 3)
+  -m MODES      execution modes to run (default: "pgsql strom")
+  -c CACHES     cache states to run (default: "cold warm")
+  -w NUM        max_parallel_workers_per_gather (default: 2)
+  -o OUTDIR     directory of the results (default: ~/ssbm-logs/DATETIME)
+  -b BASELINE   results.csv of the former run to be compared
+  -h            shows this message
+EOF
+  exit 1
+}
+
+elog()
+{
+  echo "run-ssbm: $*" >&2
+  exit 1
+}
+
+while getopts "d:s:a:n:m:c:w:o:b:h" opt
+do
+  case $opt in
+    d) DBNAME="$OPTARG" ;;
+    s) SCALE="$OPTARG" ;;
+    a) ARROW_DIR="$OPTARG"; SOURCES="heap arrow" ;;
+    n) NLOOPS="$OPTARG" ;;
+    m) MODES="$OPTARG" ;;
+    c) CACHES="$OPTARG" ;;
+    w) NWORKERS="$OPTARG" ;;
+    o) OUTDIR="$OPTARG" ;;
+    b) BASELINE="$OPTARG" ;;
+    *) usage ;;
+  esac
+done
+shift `expr $OPTIND - 1`
+test -n "$1" && DBNAME="$1"
+test -z "$OUTDIR" && OUTDIR=~/ssbm-logs/`date +%Y%m%d-%H%M%S`
+test -n "$BASELINE" -a ! -r "$BASELINE" && elog "baseline not found: $BASELINE"
+
+PSQL="psql -X -q -v ON_ERROR_STOP=1 -d $DBNAME"
 
-if [ -n "$1" ]; then
-  DBNAME="$1"
+mkdir -p ${OUTDIR}/plans || exit 1
+
+#
+# Data generation and loading
+#
+if [ -n "$SCALE" ]; then
+  for x in `dirname $0`/../../utils/dbgen-ssbm dbgen-ssbm
+  do
+    if [ -x "$x" ] || which "$x" > /dev/null 2>&1; then
+      DBGEN="$x"
+      break
+    fi
+  done
+  test -n "$DBGEN" || elog "dbgen-ssbm was not found"
+
+  ${PSQL} <<EOF || elog "failed on CREATE TABLE"
+DROP TABLE IF EXISTS customer, date1, lineorder, part, supplier CASCADE;
+\i ${CWD}/ssbm-ddl.sql
+EOF
+  for t in c:customer d:date1 p:part s:supplier l:lineorder
+  do
+    opt=`echo $t | cut -d: -f1`
+    tab=`echo $t | cut -d: -f2`
+    echo "loading ${tab} (SF=${SCALE}) ..."
+    ${PSQL} -c "\\copy ${tab} FROM PROGRAM '${DBGEN} -q -s ${SCALE} -X -T${opt}' DELIMITER '|'" \
+      || elog "failed on loading ${tab}"
+  done
+  ${PSQL} -c "VACUUM ANALYZE" || elog "failed on VACUUM ANALYZE"
+
+  if [ -n "$ARROW_DIR" ]; then
+    mkdir -p ${ARROW_DIR} || exit 1
+    rm -f ${ARROW_DIR}/lineorder.arrow
+    echo "writing ${ARROW_DIR}/lineorder.arrow ..."
+    pg2arrow -d ${DBNAME} -c "SELECT * FROM lineorder" \
+             -o ${ARROW_DIR}/lineorder.arrow \
+             --stat=lo_orderdate \
+      || elog "failed on pg2arrow"
+  fi
 fi
 
-mkdir -p ${DIR} || exit 1
+if [ -n "$ARROW_DIR" ]; then
+  test -r ${ARROW_DIR}/lineorder.arrow || \
+    elog "${ARROW_DIR}/lineorder.arrow was not found"
+  ${PSQL} <<EOF || elog "failed on IMPORT FOREIGN SCHEMA"
+DROP SCHEMA IF EXISTS ssbm_arrow CASCADE;
+CREATE SCHEMA ssbm_arrow;
+IMPORT FOREIGN SCHEMA lineorder FROM SERVER arrow_fdw INTO ssbm_arrow
+       OPTIONS (file '${ARROW_DIR}/lineorder.arrow');
+EOF
+fi
+
+#
+# Environment of the run
+#
+${PSQL} -At > ${OUTDIR}/environment.txt <<EOF
+SELECT 'version: ' || version();
+SELECT 'pg_strom: ' || extversion FROM pg_extension WHERE extname = 'pg_strom';
+SELECT 'scale: ${SCALE}';
+SELECT 'lineorder: ' || count(*) FROM lineorder;
+SELECT name || ': ' || setting FROM pg_settings
+ WHERE name LIKE 'pg_strom.%' OR name IN ('shared_buffers', 'work_mem');
+EOF
+nvidia-smi -L >> ${OUTDIR}/environment.txt 2>/dev/null
 
-sudo sysctl -w vm.drop_caches=1
-psql ${DBNAME} -a -f ${CWD}/ssbm-all-pgsql.sql > ${DIR}/log_pgsql_${DBNAME}_${YMD}a.log
+#
+# Benchmark runs
+#
+RESULTS_CSV=${OUTDIR}/results.csv
+echo "mode,source,query,cache,run,planning_ms,execution_ms" > ${RESULTS_CSV}
 
-sudo sysctl -w vm.drop_caches=1
-psql ${DBNAME} -a -f ${CWD}/ssbm-all-pgsql.sql > ${DIR}/log_pgsql_${DBNAME}_${YMD}b.log
+drop_caches()
+{
+  sudo sysctl -q -w vm.drop_caches=3 > /dev/null || \
+    echo "run-ssbm: unable to drop the page cache" >&2
+}
 
-sudo sysctl -w vm.drop_caches=1
-psql ${DBNAME} -a -f ${CWD}/ssbm-all-pgsql.sql > ${DIR}/log_pgsql_${DBNAME}_${YMD}c.log
+for mode in ${MODES}
+do
+  case $mode in
+    pgsql) enabled=off ;;
+    strom) enabled=on ;;
+    *) elog "unknown mode: $mode" ;;
+  esac
+  for src in ${SOURCES}
+  do
+    case $src in
+      heap)  search_path="public" ;;
+      arrow) search_path="ssbm_arrow,public" ;;
+      *) elog "unknown source: $src" ;;
+    esac
+    for qfile in ${CWD}/queries/q*.sql
+    do
+      qname=`basename $qfile .sql`
+      for cache in ${CACHES}
+      do
+        loop=1
+        while [ $loop -le $NLOOPS ]
+        do
+          test "$cache" = "cold" && drop_caches
+          plan=${OUTDIR}/plans/${mode}_${src}_${qname}_${cache}_${loop}.json
+          ${PSQL} -At -o ${plan} <<EOF
+SET search_path = ${search_path};
+SET pg_strom.enabled = ${enabled};
+SET max_parallel_workers_per_gather = ${NWORKERS};
+SET parallel_setup_cost = 100000;
+EXPLAIN (ANALYZE, FORMAT JSON)
+`sed -e 's/;[[:space:]]*$//' ${qfile}`;
+EOF
+          if [ $? -ne 0 ]; then
+            echo "run-ssbm: failed on ${mode}/${src}/${qname}" >&2
+            ptime=""
+            etime=""
+          else
+            ptime=`sed -n 's/.*"Planning Time": *\([0-9.]*\).*/\1/p' ${plan}`
+            etime=`sed -n 's/.*"Execution Time": *\([0-9.]*\).*/\1/p' ${plan}`
+          fi
+          echo "${mode},${src},${qname},${cache},${loop},${ptime},${etime}" \
+            | tee -a ${RESULTS_CSV}
+          loop=`expr $loop + 1`
+        done
+      done
+    done
+  done
+done
 
-sudo sysctl -w vm.drop_caches=1
-psql ${DBNAME} -a -f ${CWD}/ssbm-all-strom.sql > ${DIR}/log_strom_${DBNAME}_${YMD}a.log
+#
+# JSON form of the results
+#
+awk -F, 'NR > 1 {
+  printf("%s  {\"mode\": \"%s\", \"source\": \"%s\", \"query\": \"%s\", "   \
+         "\"cache\": \"%s\", \"run\": %d, \"planning_ms\": %s, "            \
+         "\"execution_ms\": %s}",                                         \
+         (NR > 2 ? ",\n" : "[\n"), $1, $2, $3, $4, $5,                     \
+         ($6 == "" ? "null" : $6), ($7 == "" ? "null" : $7));
+} END { print (NR > 1 ? "\n]" : "[]"); }' ${RESULTS_CSV} > ${OUTDIR}/results.json
 
-sudo sysctl -w vm.drop_caches=1
-psql ${DBNAME} -a -f ${CWD}/ssbm-all-strom.sql > ${DIR}/log_strom_${DBNAME}_${YMD}b.log
+#
+# Comparison with the baseline (median of the execution time)
+#
+if [ -n "$BASELINE" ]; then
+  median()
+  {
+    awk -F, 'NR > 1 && $7 != "" { print $1","$2","$3","$4","$7 }' $1 | \
+      sort -t, -k1,4 -k5,5n | \
+      awk -F, '{
+        key = $1","$2","$3","$4;
+        v[key, ++n[key]] = $5;
+      } END {
+        for (key in n) {
+          m = n[key];
+          med = (m % 2 ? v[key, (m+1)/2] : (v[key, m/2] + v[key, m/2+1]) / 2);
+          print key","med;
+        }
+      }' | sort
+  }
+  median ${BASELINE} | awk -F, '{ print $1"/"$2"/"$3"/"$4","$5 }' \
+    > ${OUTDIR}/.baseline.median
+  median ${RESULTS_CSV} | awk -F, '{ print $1"/"$2"/"$3"/"$4","$5 }' \
+    > ${OUTDIR}/.current.median
+  echo "mode,source,query,cache,baseline_ms,current_ms,diff_pct" \
+    > ${OUTDIR}/compare.csv
+  join -t, ${OUTDIR}/.baseline.median ${OUTDIR}/.current.median | \
+    awk -F, '{
+      split($1, k, "/");
+      printf("%s,%s,%s,%s,%.3f,%.3f,%+.1f\n", k[1], k[2], k[3], k[4],
+             $2, $3, ($2 > 0 ? ($3 - $2) * 100.0 / $2 : 0.0));
+    }' >> ${OUTDIR}/compare.csv
+  rm -f ${OUTDIR}/.baseline.median ${OUTDIR}/.current.median
+  echo "---- comparison with ${BASELINE} ----"
+  column -s, -t ${OUTDIR}/compare.csv 2>/dev/null || cat ${OUTDIR}/compare.csv
+fi
 
-sudo sysctl -w vm.drop_caches=1
-psql ${DBNAME} -a -f ${CWD}/ssbm-all-strom.sql > ${DIR}/log_strom_${DBNAME}_${YMD}c.log
+echo "results are written to ${OUTDIR}"
@@ -34,11 +34,15 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <libgen.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include <cuda.h>
 #include "../src/nvme_strom.h"
@@ -419,6 +423,586 @@ static void output_device(CUdevice device, int dindex, int dev_id)
 		}
 	}
 }
+/*
+ * Bandwidth self-test
+ *
+ * -b option measures the host<->device DMA bandwidth using pageable and
+ * pinned host buffer, and GPU-to-GPU bandwidth (if peer access is
+ * supported), for each device. -f FILE option measures the throughput of
+ * SSD-to-GPU Direct SQL Execution from the FILE to each GPU device, using
+ * the nvme_strom kernel module, with the PCIe distance between the NVMe
+ * device and GPU device as PG-Strom calculates at the startup time.
+ */
+#define BW_NLOOPS			5
+#define SSD2GPU_CHUNK_SZ	(1UL << 20)		/* 1MB per I/O chunk */
+#define SSD2GPU_NSEGMENTS	4				/* # of concurrent DMA tasks */
+
+static size_t	bw_buffer_sz = (256UL << 20);
+static int		bw_test_dma = 0;
+static char	  **bw_test_files = NULL;
+static int		bw_num_test_files = 0;
+
+static double
+timespec_diff_ms(struct timespec *tv1, struct timespec *tv2)
+{
+	return ((double)(tv2->tv_sec - tv1->tv_sec) * 1000.0 +
+			(double)(tv2->tv_nsec - tv1->tv_nsec) / 1000000.0);
+}
+
+/* MB/s from the bytes transferred and elapsed time in ms */
+static inline double
+bandwidth_mbps(size_t nbytes, double elapsed_ms)
+{
+	if (elapsed_ms <= 0.0)
+		return 0.0;
+	return ((double)nbytes / 1048576.0) / (elapsed_ms / 1000.0);
+}
+
+static double
+measure_memcpy_hostdev(CUdeviceptr m_devptr, void *h_buffer, size_t length,
+					CUevent ev_start, CUevent ev_stop, int is_htod)
+{
+	CUresult	rc;
+	float		elapsed;
+	int			loop;
+
+	/* warm-up */
+	if (is_htod)
+		rc = cuMemcpyHtoD(m_devptr, h_buffer, length);
+	else
+		rc = cuMemcpyDtoH(h_buffer, m_devptr, length);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuMemcpy%s", is_htod ? "HtoD" : "DtoH");
+
+	rc = cuEventRecord(ev_start, NULL);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuEventRecord");
+	for (loop=0; loop < BW_NLOOPS; loop++)
+	{
+		if (is_htod)
+			rc = cuMemcpyHtoD(m_devptr, h_buffer, length);
+		else
+			rc = cuMemcpyDtoH(h_buffer, m_devptr, length);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuMemcpy%s", is_htod ? "HtoD" : "DtoH");
+	}
+	rc = cuEventRecord(ev_stop, NULL);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuEventRecord");
+	rc = cuEventSynchronize(ev_stop);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuEventSynchronize");
+	rc = cuEventElapsedTime(&elapsed, ev_start, ev_stop);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuEventElapsedTime");
+
+	return bandwidth_mbps(length * BW_NLOOPS, elapsed);
+}
+
+static void
+output_dma_bandwidth(int count)
+{
+	CUdevice	device;
+	CUcontext	context;
+	CUdeviceptr	m_devptr;
+	CUevent		ev_start;
+	CUevent		ev_stop;
+	CUresult	rc;
+	void	   *h_pageable;
+	void	   *h_pinned;
+	double		bw[4];
+	int			i;
+
+	h_pageable = malloc(bw_buffer_sz);
+	if (!h_pageable)
+		sys_elog("out of memory");
+	memset(h_pageable, 0xa5, bw_buffer_sz);
+
+	if (!machine_format)
+		printf("--------\nHost<->Device DMA bandwidth (%zuMB x %d)\n",
+			   bw_buffer_sz >> 20, BW_NLOOPS);
+	for (i=0; i < count; i++)
+	{
+		rc = cuDeviceGet(&device, i);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuDeviceGet");
+		rc = cuCtxCreate(&context, 0, device);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuCtxCreate");
+		rc = cuMemAlloc(&m_devptr, bw_buffer_sz);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuMemAlloc");
+		rc = cuMemAllocHost(&h_pinned, bw_buffer_sz);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuMemAllocHost");
+		memset(h_pinned, 0xa5, bw_buffer_sz);
+		rc = cuEventCreate(&ev_start, CU_EVENT_DEFAULT);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuEventCreate");
+		rc = cuEventCreate(&ev_stop, CU_EVENT_DEFAULT);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuEventCreate");
+
+		bw[0] = measure_memcpy_hostdev(m_devptr, h_pageable, bw_buffer_sz,
+									ev_start, ev_stop, 1);
+		bw[1] = measure_memcpy_hostdev(m_devptr, h_pageable, bw_buffer_sz,
+									ev_start, ev_stop, 0);
+		bw[2] = measure_memcpy_hostdev(m_devptr, h_pinned, bw_buffer_sz,
+									ev_start, ev_stop, 1);
+		bw[3] = measure_memcpy_hostdev(m_devptr, h_pinned, bw_buffer_sz,
+									ev_start, ev_stop, 0);
+		if (!machine_format)
+		{
+			printf("GPU%d: HtoD %.0fMB/s, DtoH %.0fMB/s (pageable); "
+				   "HtoD %.0fMB/s, DtoH %.0fMB/s (pinned)\n",
+				   i, bw[0], bw[1], bw[2], bw[3]);
+		}
+		else
+		{
+			printf("BANDWIDTH%d:HTOD_PAGEABLE=%.0f\n", i, bw[0]);
+			printf("BANDWIDTH%d:DTOH_PAGEABLE=%.0f\n", i, bw[1]);
+			printf("BANDWIDTH%d:HTOD_PINNED=%.0f\n", i, bw[2]);
+			printf("BANDWIDTH%d:DTOH_PINNED=%.0f\n", i, bw[3]);
+		}
+		cuEventDestroy(ev_start);
+		cuEventDestroy(ev_stop);
+		cuMemFreeHost(h_pinned);
+		cuMemFree(m_devptr);
+		cuCtxDestroy(context);
+	}
+	free(h_pageable);
+}
+
+static void
+output_p2p_bandwidth(int count)
+{
+	CUcontext  *contexts;
+	CUdeviceptr *buffers;
+	CUdevice	device;
+	CUresult	rc;
+	int			i, j, loop;
+
+	if (count < 2)
+		return;
+	contexts = calloc(count, sizeof(CUcontext));
+	buffers = calloc(count, sizeof(CUdeviceptr));
+	if (!contexts || !buffers)
+		sys_elog("out of memory");
+	for (i=0; i < count; i++)
+	{
+		rc = cuDeviceGet(&device, i);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuDeviceGet");
+		rc = cuCtxCreate(&contexts[i], 0, device);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuCtxCreate");
+		rc = cuMemAlloc(&buffers[i], bw_buffer_sz);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuMemAlloc");
+	}
+
+	if (!machine_format)
+	{
+		printf("--------\nGPU-to-GPU bandwidth [MB/s] (%zuMB x %d)\n"
+			   "src\\dst", bw_buffer_sz >> 20, BW_NLOOPS);
+		for (j=0; j < count; j++)
+			printf("\t  GPU%d", j);
+		putchar('\n');
+	}
+	for (i=0; i < count; i++)
+	{
+		if (!machine_format)
+			printf("GPU%d", i);
+		for (j=0; j < count; j++)
+		{
+			CUdevice	src_dev;
+			CUdevice	dst_dev;
+			CUevent		ev_start;
+			CUevent		ev_stop;
+			float		elapsed;
+			int			can_access = 0;
+			double		bw;
+
+			if (i == j)
+			{
+				if (!machine_format)
+					printf("\t     -");
+				continue;
+			}
+			if (cuDeviceGet(&src_dev, i) != CUDA_SUCCESS ||
+				cuDeviceGet(&dst_dev, j) != CUDA_SUCCESS)
+				sys_elog("failed on cuDeviceGet");
+			rc = cuDeviceCanAccessPeer(&can_access, dst_dev, src_dev);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuDeviceCanAccessPeer");
+			if (!can_access)
+			{
+				if (!machine_format)
+					printf("\t   n/a");
+				continue;
+			}
+			rc = cuCtxSetCurrent(contexts[j]);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuCtxSetCurrent");
+			rc = cuCtxEnablePeerAccess(contexts[i], 0);
+			if (rc != CUDA_SUCCESS &&
+				rc != CUDA_ERROR_PEER_ACCESS_ALREADY_ENABLED)
+				cuda_elog(rc, "failed on cuCtxEnablePeerAccess");
+			rc = cuEventCreate(&ev_start, CU_EVENT_DEFAULT);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuEventCreate");
+			rc = cuEventCreate(&ev_stop, CU_EVENT_DEFAULT);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuEventCreate");
+			/* warm-up */
+			rc = cuMemcpyPeer(buffers[j], contexts[j],
+							  buffers[i], contexts[i], bw_buffer_sz);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuMemcpyPeer");
+			rc = cuEventRecord(ev_start, NULL);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuEventRecord");
+			for (loop=0; loop < BW_NLOOPS; loop++)
+			{
+				rc = cuMemcpyPeer(buffers[j], contexts[j],
+								  buffers[i], contexts[i], bw_buffer_sz);
+				if (rc != CUDA_SUCCESS)
+					cuda_elog(rc, "failed on cuMemcpyPeer");
+			}
+			rc = cuEventRecord(ev_stop, NULL);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuEventRecord");
+			rc = cuEventSynchronize(ev_stop);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuEventSynchronize");
+			rc = cuEventElapsedTime(&elapsed, ev_start, ev_stop);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuEventElapsedTime");
+			bw = bandwidth_mbps(bw_buffer_sz * BW_NLOOPS, elapsed);
+			if (!machine_format)
+				printf("\t%6.0f", bw);
+			else
+				printf("BANDWIDTH%d:P2P_GPU%d=%.0f\n", i, j, bw);
+			cuEventDestroy(ev_start);
+			cuEventDestroy(ev_stop);
+		}
+		if (!machine_format)
+			putchar('\n');
+	}
+
+	for (i=0; i < count; i++)
+	{
+		cuCtxSetCurrent(contexts[i]);
+		cuMemFree(buffers[i]);
+		cuCtxDestroy(contexts[i]);
+	}
+	free(contexts);
+	free(buffers);
+}
+
+/*
+ * pcie_device_path - returns the real sysfs path of the PCI device, like
+ * "pci0000:00/0000:00:02.0/0000:02:00.0" (without /sys/devices/ prefix),
+ * and its numa node.
+ */
+static char *
+pcie_device_path(const char *sysfs_path, int *p_numa_node)
+{
+	char		path[PATH_MAX];
+	char		temp[PATH_MAX + 20];
+	FILE	   *filp;
+
+	if (!realpath(sysfs_path, path) ||
+		strncmp(path, "/sys/devices/", 13) != 0)
+		return NULL;
+	*p_numa_node = -1;
+	snprintf(temp, sizeof(temp), "%s/numa_node", path);
+	filp = fopen(temp, "rb");
+	if (filp)
+	{
+		if (fscanf(filp, "%d", p_numa_node) != 1)
+			*p_numa_node = -1;
+		fclose(filp);
+	}
+	return strdup(path + 13);
+}
+
+/*
+ * pcie_device_distance - computes the distance between the GPU and NVMe
+ * on the PCIe tree, in the same manner as calculate_nvme_distance_map() of
+ * the PG-Strom module. The depth of the host bridge (pciXXXX:XX) is 1.
+ * -1 means they are not on the same NUMA node, or unknown.
+ */
+static int
+pcie_device_distance(const char *gpu_path, int gpu_numa,
+					 const char *nvme_path, int nvme_numa)
+{
+	const char *pos;
+	int			gpu_depth = 0;
+	int			nvme_depth = 0;
+	int			depth = 0;
+	int			i;
+
+	if (!gpu_path || !nvme_path || gpu_numa != nvme_numa)
+		return -1;
+	/* depth of the common ancestor */
+	for (i=0; gpu_path[i] != '\0' && gpu_path[i] == nvme_path[i]; i++)
+	{
+		if (gpu_path[i] == '/')
+			depth++;
+	}
+	if ((gpu_path[i] == '\0' && nvme_path[i] == '/') ||
+		(gpu_path[i] == '/' && nvme_path[i] == '\0'))
+		return -1;		/* one is parent of the other; should not happen */
+	for (pos = gpu_path; *pos != '\0'; pos++)
+		gpu_depth += (*pos == '/');
+	for (pos = nvme_path; *pos != '\0'; pos++)
+		nvme_depth += (*pos == '/');
+
+	return ((gpu_depth - depth) +
+			(nvme_depth - depth) +
+			(depth == 0 ? 2 : 1));
+}
+
+static void
+output_ssd2gpu_bandwidth(int count)
+{
+	StromCmd__CheckFile *cf;
+	CUdevice	device;
+	CUcontext	context;
+	CUdeviceptr	m_devptr;
+	CUresult	rc;
+	char	  **gpu_paths;
+	int		   *gpu_numa;
+	long		page_sz = sysconf(_SC_PAGESIZE);
+	size_t		seg_sz = bw_buffer_sz / SSD2GPU_NSEGMENTS;
+	unsigned int nr_ioc = (seg_sz + SSD2GPU_CHUNK_SZ - 1) / SSD2GPU_CHUNK_SZ;
+	strom_io_chunk *io_chunks;
+	int			nvme_fdesc;
+	int			i, j, k;
+
+	nvme_fdesc = open(NVME_STROM_IOCTL_PATHNAME, O_RDONLY);
+	if (nvme_fdesc < 0)
+		sys_elog("failed on open('%s'): %m", NVME_STROM_IOCTL_PATHNAME);
+	cf = calloc(1, offsetof(StromCmd__CheckFile, rawdisks[100]));
+	gpu_paths = calloc(count, sizeof(char *));
+	gpu_numa = calloc(count, sizeof(int));
+	io_chunks = calloc(SSD2GPU_NSEGMENTS * nr_ioc, sizeof(strom_io_chunk));
+	if (!cf || !gpu_paths || !gpu_numa || !io_chunks)
+		sys_elog("out of memory");
+
+	for (i=0; i < count; i++)
+	{
+		char	path[PATH_MAX];
+		int		dom_id, bus_id, dev_id;
+
+		if (cuDeviceGet(&device, i) != CUDA_SUCCESS ||
+			cuDeviceGetAttribute(&dom_id, CU_DEVICE_ATTRIBUTE_PCI_DOMAIN_ID,
+								 device) != CUDA_SUCCESS ||
+			cuDeviceGetAttribute(&bus_id, CU_DEVICE_ATTRIBUTE_PCI_BUS_ID,
+								 device) != CUDA_SUCCESS ||
+			cuDeviceGetAttribute(&dev_id, CU_DEVICE_ATTRIBUTE_PCI_DEVICE_ID,
+								 device) != CUDA_SUCCESS)
+			sys_elog("failed on cuDeviceGetAttribute");
+		snprintf(path, sizeof(path), "/sys/bus/pci/devices/%04x:%02x:%02x.0",
+				 dom_id, bus_id, dev_id);
+		gpu_paths[i] = pcie_device_path(path, &gpu_numa[i]);
+	}
+
+	if (!machine_format)
+		printf("--------\nSSD-to-GPU Direct throughput [MB/s] (distance)\n"
+			   "FILE (NVME)");
+	for (j=0; j < count && !machine_format; j++)
+		printf("\t   GPU%d", j);
+	if (!machine_format)
+		putchar('\n');
+
+	for (k=0; k < bw_num_test_files; k++)
+	{
+		const char *fname = bw_test_files[k];
+		char	  **nvme_paths;
+		int		   *nvme_numa;
+		char		nvme_names[1024];
+		struct stat	st_buf;
+		size_t		file_sz;
+		int			fdesc;
+
+		fdesc = open(fname, O_RDONLY);
+		if (fdesc < 0)
+			sys_elog("failed on open('%s'): %m", fname);
+		if (fstat(fdesc, &st_buf) != 0)
+			sys_elog("failed on fstat('%s'): %m", fname);
+		file_sz = (st_buf.st_size / page_sz) * page_sz;
+		if (file_sz == 0)
+			sys_elog("file '%s' is too small", fname);
+
+		memset(cf, 0, offsetof(StromCmd__CheckFile, rawdisks[100]));
+		cf->fdesc = fdesc;
+		cf->nrooms = 100;
+		if (ioctl(nvme_fdesc, STROM_IOCTL__CHECK_FILE, cf) != 0)
+			sys_elog("file '%s' does not support SSD-to-GPU Direct: %m",
+					 fname);
+		nvme_paths = calloc(cf->ndisks, sizeof(char *));
+		nvme_numa = calloc(cf->ndisks, sizeof(int));
+		if (!nvme_paths || !nvme_numa)
+			sys_elog("out of memory");
+		nvme_names[0] = '\0';
+		for (i=0; i < cf->ndisks && i < cf->nrooms; i++)
+		{
+			char	path[PATH_MAX];
+			char	name[PATH_MAX];
+			size_t	len = strlen(nvme_names);
+
+			snprintf(path, sizeof(path), "/sys/dev/char/%d:%d",
+					 cf->rawdisks[i].major, cf->rawdisks[i].minor);
+			if (!realpath(path, name))
+				snprintf(name, sizeof(name), "%d:%d",
+						 cf->rawdisks[i].major, cf->rawdisks[i].minor);
+			snprintf(nvme_names + len, sizeof(nvme_names) - len, "%s%s",
+					 i > 0 ? "," : "", basename(name));
+			strcat(path, "/device");
+			nvme_paths[i] = pcie_device_path(path, &nvme_numa[i]);
+		}
+		if (!machine_format)
+			printf("%s (%s)", fname, nvme_names);
+
+		for (j=0; j < count; j++)
+		{
+			StromCmd__MapGpuMemory map_cmd;
+			StromCmd__UnmapGpuMemory unmap_cmd;
+			StromCmd__MemCopySsdToGpuRaw raw_cmd;
+			StromCmd__MemCopyWait wait_cmd;
+			unsigned long dma_task_ids[SSD2GPU_NSEGMENTS];
+			unsigned long nr_ram2gpu = 0;
+			struct timespec tv1, tv2;
+			size_t		f_pos;
+			double		bw;
+			int			dist = -1;
+
+			/* distance of the worst NVMe device on the volume */
+			for (i=0; i < cf->ndisks && i < cf->nrooms; i++)
+			{
+				int		__dist = pcie_device_distance(gpu_paths[j],
+													  gpu_numa[j],
+													  nvme_paths[i],
+													  nvme_numa[i]);
+				if (__dist < 0)
+				{
+					dist = -1;
+					break;
+				}
+				if (dist < __dist)
+					dist = __dist;
+			}
+
+			rc = cuDeviceGet(&device, j);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuDeviceGet");
+			rc = cuCtxCreate(&context, 0, device);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuCtxCreate");
+			rc = cuMemAlloc(&m_devptr, bw_buffer_sz);
+			if (rc != CUDA_SUCCESS)
+				cuda_elog(rc, "failed on cuMemAlloc");
+			memset(&map_cmd, 0, sizeof(map_cmd));
+			map_cmd.vaddress = m_devptr;
+			map_cmd.length = bw_buffer_sz;
+			if (ioctl(nvme_fdesc, STROM_IOCTL__MAP_GPU_MEMORY, &map_cmd) != 0)
+				sys_elog("failed on ioctl(STROM_IOCTL__MAP_GPU_MEMORY): %m");
+
+			clock_gettime(CLOCK_MONOTONIC, &tv1);
+			for (f_pos = 0; f_pos < file_sz;)
+			{
+				int		nr_tasks = 0;
+
+				/* fill up the buffer with SSD2GPU_NSEGMENTS DMA tasks */
+				while (f_pos < file_sz && nr_tasks < SSD2GPU_NSEGMENTS)
+				{
+					strom_io_chunk *ioc = io_chunks + nr_tasks * nr_ioc;
+					size_t		m_offset = 0;
+					unsigned int nchunks = 0;
+
+					while (f_pos < file_sz && m_offset < seg_sz)
+					{
+						size_t	sz = SSD2GPU_CHUNK_SZ;
+
+						if (sz > seg_sz - m_offset)
+							sz = seg_sz - m_offset;
+						if (sz > file_sz - f_pos)
+							sz = file_sz - f_pos;
+						ioc[nchunks].m_offset = m_offset;
+						ioc[nchunks].fchunk_id = f_pos / page_sz;
+						ioc[nchunks].nr_pages = sz / page_sz;
+						nchunks++;
+						m_offset += sz;
+						f_pos += sz;
+					}
+					memset(&raw_cmd, 0, sizeof(raw_cmd));
+					raw_cmd.handle = map_cmd.handle;
+					raw_cmd.offset = nr_tasks * seg_sz;
+					raw_cmd.file_desc = fdesc;
+					raw_cmd.nr_chunks = nchunks;
+					raw_cmd.page_sz = page_sz;
+					raw_cmd.io_chunks = ioc;
+					if (ioctl(nvme_fdesc, STROM_IOCTL__MEMCPY_SSD2GPU_RAW,
+							  &raw_cmd) != 0)
+						sys_elog("failed on ioctl(STROM_IOCTL__MEMCPY_SSD2GPU_RAW): "
+								 "%m");
+					nr_ram2gpu += raw_cmd.nr_ram2gpu;
+					dma_task_ids[nr_tasks++] = raw_cmd.dma_task_id;
+				}
+				/* wait for completion of the DMA tasks */
+				for (i=0; i < nr_tasks; i++)
+				{
+					memset(&wait_cmd, 0, sizeof(wait_cmd));
+					wait_cmd.dma_task_id = dma_task_ids[i];
+					if (ioctl(nvme_fdesc, STROM_IOCTL__MEMCPY_WAIT,
+							  &wait_cmd) != 0 || wait_cmd.status != 0)
+						sys_elog("failed on ioctl(STROM_IOCTL__MEMCPY_WAIT): "
+								 "%m (status=%ld)", wait_cmd.status);
+				}
+			}
+			clock_gettime(CLOCK_MONOTONIC, &tv2);
+			bw = bandwidth_mbps(file_sz, timespec_diff_ms(&tv1, &tv2));
+
+			if (!machine_format)
+				printf("\t%6.0f(%d)%s", bw, dist, nr_ram2gpu > 0 ? "*" : "");
+			else
+			{
+				printf("SSD2GPU%d:GPU%d_FILE=%s\n", k, j, fname);
+				printf("SSD2GPU%d:GPU%d_NVME=%s\n", k, j, nvme_names);
+				printf("SSD2GPU%d:GPU%d_BANDWIDTH=%.0f\n", k, j, bw);
+				printf("SSD2GPU%d:GPU%d_DISTANCE=%d\n", k, j, dist);
+				printf("SSD2GPU%d:GPU%d_RAM2GPU_CHUNKS=%lu\n",
+					   k, j, nr_ram2gpu);
+			}
+			memset(&unmap_cmd, 0, sizeof(unmap_cmd));
+			unmap_cmd.handle = map_cmd.handle;
+			if (ioctl(nvme_fdesc, STROM_IOCTL__UNMAP_GPU_MEMORY,
+					  &unmap_cmd) != 0)
+				sys_elog("failed on ioctl(STROM_IOCTL__UNMAP_GPU_MEMORY): %m");
+			cuMemFree(m_devptr);
+			cuCtxDestroy(context);
+		}
+		if (!machine_format)
+			putchar('\n');
+		for (i=0; i < cf->ndisks && i < cf->nrooms; i++)
+			free(nvme_paths[i]);
+		free(nvme_paths);
+		free(nvme_numa);
+		close(fdesc);
+	}
+	if (!machine_format)
+		printf("(*) a part of the file was loaded from the page cache\n");
+
+	for (i=0; i < count; i++)
+		free(gpu_paths[i]);
+	free(gpu_paths);
+	free(gpu_numa);
+	free(io_chunks);
+	free(cf);
+	close(nvme_fdesc);
+}
 
 int main(int argc, char *argv[])
 {
@@ -434,7 +1018,7 @@ int main(int argc, char *argv[])
 	/*
 	 * Parse options
 	 */
-	while ((opt = getopt(argc, argv, "mldh")) != -1)
+	while ((opt = getopt(argc, argv, "mldbf:s:h")) != -1)
 	{
 		switch (opt)
 		{
@@ -447,13 +1031,36 @@ int main(int argc, char *argv[])
 			case 'd':
 				detailed_output = 1;
 				break;
+			case 'b':
+				bw_test_dma = 1;
+				break;
+			case 'f':
+				bw_test_files = realloc(bw_test_files, sizeof(char *) *
+										(bw_num_test_files + 1));
+				if (!bw_test_files)
+					sys_elog("out of memory");
+				bw_test_files[bw_num_test_files++] = optarg;
+				break;
+			case 's':
+				bw_buffer_sz = (size_t)atol(optarg) << 20;
+				if (bw_buffer_sz == 0)
+				{
+					fprintf(stderr, "invalid buffer size: %s\n", optarg);
+					return 1;
+				}
+				break;
 			default:
 				fprintf(stderr, "unknown option: %c\n", opt);
 			case 'h':
 				fprintf(stderr,
-						"usage: %s [-d][-m][-h]\n"
+						"usage: %s [-d][-m][-b][-f FILE][-s SIZE][-h]\n"
 						"  -d : detailed output\n"
 						"  -m : machine readable format\n"
+						"  -b : host<->device and GPU-to-GPU bandwidth test\n"
+						"  -f FILE : SSD-to-GPU Direct throughput test on FILE\n"
+						"            (can be specified multiple times)\n"
+						"  -s SIZE : buffer size of the bandwidth test in MB\n"
+						"            (default: 256)\n"
 						"  -h : shows this message\n",
 						basename(argv[0]));
 				return 1;
@@ -544,5 +1151,16 @@ int main(int argc, char *argv[])
 			break;
 	}
 	assert(j <= nr_gpus);
+
+	/*
+	 * Bandwidth self-test, if any
+	 */
+	if (bw_test_dma)
+	{
+		output_dma_bandwidth(count);
+		output_p2p_bandwidth(count);
+	}
+	if (bw_num_test_files > 0)
+		output_ssd2gpu_bandwidth(count);
 	return 0;
 }
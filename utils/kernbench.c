@@ -0,0 +1,779 @@
+/*
+ * kernbench.c
+ *
+ * Micro benchmark of the device functions and kernel primitives; text LIKE,
+ * jsonb key extraction, numeric arithmetic, hash-join probe and preagg
+ * reduction, over the synthetic buffers of configurable size and skew.
+ * Device kernels are in src/cuda_kernbench.cu, and linked with the GPU
+ * libraries of PG-Strom on the startup.
+ * ----
+ * Copyright 2011-2020 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2020 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <libgen.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cuda.h>
+
+#ifndef KERNBENCH_LIBDIR
+#define KERNBENCH_LIBDIR	"."
+#endif
+
+/*
+ * command line options
+ */
+static int			cuda_dindex = 0;
+static unsigned int	num_rows = 10000000;
+static int			num_loops = 5;
+static const char  *libdir = KERNBENCH_LIBDIR;
+static int			text_length = 32;
+static const char  *like_pattern = "%abc%";
+static int			jsonb_nkeys = 8;
+static unsigned int	inner_nrows = 1000000;
+static unsigned int	num_groups = 1000;
+static double		skew_factor = 0.0;
+static const char  *bench_list = "textlike,jsonb,numeric,hashjoin,preagg";
+static int			machine_format = 0;
+
+#define cuda_elog(errcode,fmt,...)							\
+	do {													\
+		const char *__cmd_name = strrchr(__FILE__, '/');	\
+		const char *__err_name;								\
+															\
+		if (!__cmd_name)									\
+			__cmd_name = __FILE__;							\
+		cuGetErrorName(errcode, &__err_name);				\
+		fprintf(stderr, "%s:%d [%s]  " fmt "\n",			\
+				__cmd_name, __LINE__, __err_name,			\
+				##__VA_ARGS__);								\
+		exit(1);											\
+	} while(0)
+
+#define sys_elog(fmt,...)									\
+	do {													\
+		const char *__cmd_name = strrchr(__FILE__, '/');	\
+															\
+		if (!__cmd_name)									\
+			__cmd_name = __FILE__;							\
+		fprintf(stderr, "%s:%d  " fmt "\n",					\
+				__cmd_name, __LINE__, ##__VA_ARGS__);			\
+		exit(1);											\
+	} while(0)
+
+#define MAXALIGN(x)		(((uintptr_t)(x) + 7UL) & ~7UL)
+
+/* enough large for kern_errorbuf and empty kern_parambuf */
+#define KERNBENCH_ERRORBUF_SZ	4096
+#define KERNBENCH_PARAMBUF_SZ	256
+
+static CUcontext	cuda_context;
+static CUmodule		cuda_module;
+static CUstream		cuda_stream;
+static CUdeviceptr	m_kerror;
+static CUdeviceptr	m_kparams;
+static CUdeviceptr	m_result;
+
+static void *
+__malloc(size_t sz)
+{
+	void   *ptr = malloc(sz);
+
+	if (!ptr)
+		sys_elog("out of memory");
+	return ptr;
+}
+
+static CUdeviceptr
+__cuMemAllocCopy(const void *hbuf, size_t sz)
+{
+	CUdeviceptr	m_buf;
+	CUresult	rc;
+
+	rc = cuMemAlloc(&m_buf, sz);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuMemAlloc(%zu)", sz);
+	if (hbuf)
+	{
+		rc = cuMemcpyHtoD(m_buf, hbuf, sz);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuMemcpyHtoD");
+	}
+	return m_buf;
+}
+
+/*
+ * random_key - key in [0, nkeys), skewed to the smaller values by the
+ * skew_factor (0 means uniform distribution)
+ */
+static unsigned int
+random_key(unsigned int nkeys)
+{
+	double	x = drand48();
+
+	if (skew_factor > 0.0)
+		x = pow(x, 1.0 + skew_factor);
+	return (unsigned int)(x * (double)nkeys) % nkeys;
+}
+
+/* PostgreSQL's 4B varlena header (little endian) */
+static char *
+set_varlena(char *pos, const char *data, size_t len)
+{
+	*((uint32_t *)pos) = (uint32_t)((len + 4) << 2);
+	memcpy(pos + 4, data, len);
+	return pos + MAXALIGN(len + 4);
+}
+
+/*
+ * setup_cuda_module - link src/cuda_kernbench.fatbin with the libraries
+ */
+static void
+setup_cuda_module(void)
+{
+	static const char *libnames[] = {
+		"cuda_kernbench",
+		"cuda_common",
+		"cuda_numeric",
+		"cuda_primitive",
+		"cuda_textlib",
+		"cuda_timelib",
+		"cuda_misclib",
+		"cuda_jsonlib",
+		NULL,
+	};
+	CUdevice	device;
+	CUlinkState	lstate;
+	CUjit_option jit_options[4];
+	void	   *jit_option_values[4];
+	char		log_buffer[16384];
+	char		pathname[4096];
+	void	   *bin_image;
+	size_t		bin_length;
+	CUresult	rc;
+	int			i;
+
+	rc = cuInit(0);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuInit");
+	rc = cuDeviceGet(&device, cuda_dindex);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuDeviceGet");
+	rc = cuCtxCreate(&cuda_context, CU_CTX_SCHED_AUTO, device);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuCtxCreate");
+	rc = cuStreamCreate(&cuda_stream, CU_STREAM_NON_BLOCKING);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuStreamCreate");
+
+	jit_options[0] = CU_JIT_TARGET_FROM_CUCONTEXT;
+	jit_option_values[0] = NULL;
+	jit_options[1] = CU_JIT_CACHE_MODE;
+	jit_option_values[1] = (void *)CU_JIT_CACHE_OPTION_CA;
+	jit_options[2] = CU_JIT_ERROR_LOG_BUFFER;
+	jit_option_values[2] = (void *)log_buffer;
+	jit_options[3] = CU_JIT_ERROR_LOG_BUFFER_SIZE_BYTES;
+	jit_option_values[3] = (void *)sizeof(log_buffer);
+	rc = cuLinkCreate(4, jit_options, jit_option_values, &lstate);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuLinkCreate");
+	for (i=0; libnames[i] != NULL; i++)
+	{
+		snprintf(pathname, sizeof(pathname), "%s/%s.fatbin",
+				 libdir, libnames[i]);
+		rc = cuLinkAddFile(lstate, CU_JIT_INPUT_FATBINARY,
+						   pathname, 0, NULL, NULL);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuLinkAddFile('%s')", pathname);
+	}
+	rc = cuLinkComplete(lstate, &bin_image, &bin_length);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuLinkComplete\nLog: %s", log_buffer);
+	rc = cuModuleLoadData(&cuda_module, bin_image);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuModuleLoadData");
+	rc = cuLinkDestroy(lstate);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuLinkDestroy");
+
+	m_kerror  = __cuMemAllocCopy(NULL, KERNBENCH_ERRORBUF_SZ);
+	m_kparams = __cuMemAllocCopy(NULL, KERNBENCH_PARAMBUF_SZ);
+	m_result  = __cuMemAllocCopy(NULL, sizeof(uint32_t));
+	rc = cuMemsetD8(m_kerror, 0, KERNBENCH_ERRORBUF_SZ);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuMemsetD8");
+	rc = cuMemsetD8(m_kparams, 0, KERNBENCH_PARAMBUF_SZ);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuMemsetD8");
+}
+
+static CUfunction
+lookup_kernel(const char *kern_name, int *p_grid_sz, int *p_block_sz,
+			  unsigned int nitems)
+{
+	CUfunction	kern_func;
+	int			min_grid_sz;
+	int			block_sz;
+	int			grid_sz;
+	CUresult	rc;
+
+	rc = cuModuleGetFunction(&kern_func, cuda_module, kern_name);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuModuleGetFunction('%s')", kern_name);
+	rc = cuOccupancyMaxPotentialBlockSize(&min_grid_sz, &block_sz,
+										  kern_func, NULL, 0, 0);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuOccupancyMaxPotentialBlockSize");
+	/* no more blocks than the device can run concurrently */
+	grid_sz = (nitems + block_sz - 1) / block_sz;
+	if (grid_sz > min_grid_sz)
+		grid_sz = min_grid_sz;
+	if (grid_sz < 1)
+		grid_sz = 1;
+	*p_grid_sz = grid_sz;
+	*p_block_sz = block_sz;
+
+	return kern_func;
+}
+
+static int
+cmp_float(const void *a, const void *b)
+{
+	float	fa = *((const float *)a);
+	float	fb = *((const float *)b);
+
+	return (fa < fb ? -1 : (fa > fb ? 1 : 0));
+}
+
+/*
+ * run_kernel - launches the kernel num_loops times (after one warm-up),
+ * then reports the median of the elapsed time.
+ */
+static void
+run_kernel(const char *label, const char *kern_name,
+		   void **kern_args, unsigned int nitems, size_t nbytes,
+		   CUdeviceptr m_reset, size_t reset_sz)
+{
+	CUfunction	kern_func;
+	CUevent		ev_begin;
+	CUevent		ev_end;
+	float	   *elapsed = alloca(sizeof(float) * (num_loops + 1));
+	float		median;
+	uint32_t	result;
+	int			errcode;
+	int			grid_sz;
+	int			block_sz;
+	int			loop;
+	CUresult	rc;
+
+	kern_func = lookup_kernel(kern_name, &grid_sz, &block_sz, nitems);
+	if ((rc = cuEventCreate(&ev_begin, CU_EVENT_DEFAULT)) != CUDA_SUCCESS ||
+		(rc = cuEventCreate(&ev_end, CU_EVENT_DEFAULT)) != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuEventCreate");
+
+	for (loop=0; loop <= num_loops; loop++)
+	{
+		rc = cuMemsetD8Async(m_reset, 0, reset_sz, cuda_stream);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuMemsetD8Async");
+		rc = cuEventRecord(ev_begin, cuda_stream);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuEventRecord");
+		rc = cuLaunchKernel(kern_func,
+							grid_sz, 1, 1,
+							block_sz, 1, 1,
+							0,
+							cuda_stream,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuLaunchKernel('%s')", kern_name);
+		rc = cuEventRecord(ev_end, cuda_stream);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuEventRecord");
+		rc = cuEventSynchronize(ev_end);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuEventSynchronize");
+		rc = cuEventElapsedTime(&elapsed[loop], ev_begin, ev_end);
+		if (rc != CUDA_SUCCESS)
+			cuda_elog(rc, "failed on cuEventElapsedTime");
+	}
+	/* the first run is warm-up */
+	qsort(elapsed + 1, num_loops, sizeof(float), cmp_float);
+	median = (num_loops % 2 != 0
+			  ? elapsed[1 + num_loops / 2]
+			  : (elapsed[num_loops / 2] + elapsed[1 + num_loops / 2]) / 2.0);
+
+	rc = cuMemcpyDtoH(&errcode, m_kerror, sizeof(int));
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuMemcpyDtoH");
+	if (errcode != 0)
+		sys_elog("%s: device error (errcode=%d)", label, errcode);
+	rc = cuMemcpyDtoH(&result, m_result, sizeof(uint32_t));
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuMemcpyDtoH");
+
+	if (machine_format)
+		printf("%s,%u,%zu,%.3f,%.3f,%.3f,%u\n",
+			   label, nitems, nbytes, median,
+			   (double)nbytes / (median * 1.0e6),
+			   (double)nitems / (median * 1.0e3),
+			   result);
+	else
+		printf("%-10s %11u %12zu %9.3f %8.2f %10.2f  (result=%u)\n",
+			   label, nitems, nbytes, median,
+			   (double)nbytes / (median * 1.0e6),
+			   (double)nitems / (median * 1.0e3),
+			   result);
+	cuEventDestroy(ev_begin);
+	cuEventDestroy(ev_end);
+}
+
+/*
+ * bench_textlike - random alphabets of text_length bytes
+ */
+static void
+bench_textlike(void)
+{
+	size_t		unitsz = MAXALIGN(text_length + 4);
+	uint32_t   *offsets = __malloc(sizeof(uint32_t) * num_rows);
+	char	   *buffer = __malloc(unitsz * num_rows);
+	char	   *pattern = __malloc(MAXALIGN(strlen(like_pattern) + 4));
+	char	   *temp = alloca(text_length);
+	char	   *pos = buffer;
+	CUdeviceptr	m_offsets;
+	CUdeviceptr	m_buffer;
+	CUdeviceptr	m_pattern;
+	void	   *kern_args[7];
+	unsigned int i, j;
+
+	if (unitsz * num_rows >= (1UL << 32))
+		sys_elog("textlike: too large buffer; reduce -n or -l");
+	for (i=0; i < num_rows; i++)
+	{
+		for (j=0; j < text_length; j++)
+			temp[j] = 'a' + random_key(26);
+		offsets[i] = pos - buffer;
+		pos = set_varlena(pos, temp, text_length);
+	}
+	set_varlena(pattern, like_pattern, strlen(like_pattern));
+
+	m_offsets = __cuMemAllocCopy(offsets, sizeof(uint32_t) * num_rows);
+	m_buffer  = __cuMemAllocCopy(buffer, pos - buffer);
+	m_pattern = __cuMemAllocCopy(pattern, MAXALIGN(strlen(like_pattern) + 4));
+
+	kern_args[0] = &m_kparams;
+	kern_args[1] = &m_kerror;
+	kern_args[2] = &num_rows;
+	kern_args[3] = &m_offsets;
+	kern_args[4] = &m_buffer;
+	kern_args[5] = &m_pattern;
+	kern_args[6] = &m_result;
+	run_kernel("textlike", "kernbench_text_like", kern_args,
+			   num_rows, sizeof(uint32_t) * num_rows + (pos - buffer),
+			   m_result, sizeof(uint32_t));
+
+	cuMemFree(m_offsets);
+	cuMemFree(m_buffer);
+	cuMemFree(m_pattern);
+	free(offsets);
+	free(buffer);
+	free(pattern);
+}
+
+/*
+ * bench_jsonb - {"k00" : "<value>", "k01" : "<value>", ...}
+ *
+ * It builds the binary form of jsonb; JsonbContainer header, JEntry for
+ * the keys then values, and the string bodies. We store an offset every
+ * 32 (JB_OFFSET_STRIDE) children, and lengths for the others.
+ */
+#define JENTRY_HAS_OFF		0x80000000
+#define JB_FOBJECT			0x20000000
+#define JB_OFFSET_STRIDE	32
+
+static char *
+build_jsonb(char *pos, int nkeys, unsigned int seed)
+{
+	uint32_t   *vl_head = (uint32_t *)pos;
+	uint32_t   *jc_head = vl_head + 1;
+	uint32_t   *jentry = jc_head + 1;
+	char	   *data = (char *)(jentry + 2 * nkeys);
+	char	   *base = data;
+	char		temp[40];
+	int			i, len;
+
+	*jc_head = (uint32_t)nkeys | JB_FOBJECT;
+	for (i=0; i < 2 * nkeys; i++)
+	{
+		if (i < nkeys)
+			len = sprintf(temp, "k%02d", i);
+		else
+			len = sprintf(temp, "value-%u-%d", seed, i - nkeys);
+		memcpy(data, temp, len);
+		data += len;
+		if (i % JB_OFFSET_STRIDE == 0)
+			jentry[i] = (uint32_t)(data - base) | JENTRY_HAS_OFF;
+		else
+			jentry[i] = (uint32_t)len;
+	}
+	*vl_head = (uint32_t)((data - (char *)vl_head) << 2);
+
+	return (char *)MAXALIGN(data);
+}
+
+static void
+bench_jsonb(void)
+{
+	size_t		unitsz = MAXALIGN(8 + 8 * jsonb_nkeys +
+								  4 * jsonb_nkeys +	/* keys */
+								  24 * jsonb_nkeys);	/* values */
+	uint32_t   *offsets = __malloc(sizeof(uint32_t) * num_rows);
+	char	   *buffer = __malloc(unitsz * num_rows);
+	char	   *pos = buffer;
+	char		key[40];
+	char		temp[48];
+	CUdeviceptr	m_offsets;
+	CUdeviceptr	m_buffer;
+	CUdeviceptr	m_key;
+	void	   *kern_args[7];
+	unsigned int i;
+
+	if (jsonb_nkeys < 1 || jsonb_nkeys > 100)
+		sys_elog("jsonb: number of keys must be 1..100");
+	if (unitsz * num_rows >= (1UL << 32))
+		sys_elog("jsonb: too large buffer; reduce -n or -k");
+	for (i=0; i < num_rows; i++)
+	{
+		offsets[i] = pos - buffer;
+		pos = build_jsonb(pos, jsonb_nkeys, (unsigned int)lrand48());
+	}
+	/* the key to fetch is chosen by the skew factor */
+	sprintf(key, "k%02u", random_key(jsonb_nkeys));
+	set_varlena(temp, key, strlen(key));
+
+	m_offsets = __cuMemAllocCopy(offsets, sizeof(uint32_t) * num_rows);
+	m_buffer  = __cuMemAllocCopy(buffer, pos - buffer);
+	m_key     = __cuMemAllocCopy(temp, sizeof(temp));
+
+	kern_args[0] = &m_kparams;
+	kern_args[1] = &m_kerror;
+	kern_args[2] = &num_rows;
+	kern_args[3] = &m_offsets;
+	kern_args[4] = &m_buffer;
+	kern_args[5] = &m_key;
+	kern_args[6] = &m_result;
+	run_kernel("jsonb", "kernbench_jsonb_field", kern_args,
+			   num_rows, sizeof(uint32_t) * num_rows + (pos - buffer),
+			   m_result, sizeof(uint32_t));
+
+	cuMemFree(m_offsets);
+	cuMemFree(m_buffer);
+	cuMemFree(m_key);
+	free(offsets);
+	free(buffer);
+}
+
+/*
+ * bench_numeric - numeric(12,2) + numeric(12,4); needs rescaling
+ */
+static void
+bench_numeric(void)
+{
+	int64_t	   *x_values = __malloc(sizeof(int64_t) * num_rows);
+	int64_t	   *y_values = __malloc(sizeof(int64_t) * num_rows);
+	short		x_scale = 2;
+	short		y_scale = 4;
+	CUdeviceptr	m_xvalues;
+	CUdeviceptr	m_yvalues;
+	void	   *kern_args[8];
+	unsigned int i;
+
+	for (i=0; i < num_rows; i++)
+	{
+		x_values[i] = (int64_t)(lrand48() % 2000000000L) - 1000000000L;
+		y_values[i] = (int64_t)(lrand48() % 2000000000L) - 1000000000L;
+	}
+	m_xvalues = __cuMemAllocCopy(x_values, sizeof(int64_t) * num_rows);
+	m_yvalues = __cuMemAllocCopy(y_values, sizeof(int64_t) * num_rows);
+
+	kern_args[0] = &m_kparams;
+	kern_args[1] = &m_kerror;
+	kern_args[2] = &num_rows;
+	kern_args[3] = &m_xvalues;
+	kern_args[4] = &x_scale;
+	kern_args[5] = &m_yvalues;
+	kern_args[6] = &y_scale;
+	kern_args[7] = &m_result;
+	run_kernel("numeric", "kernbench_numeric_add", kern_args,
+			   num_rows, 2 * sizeof(int64_t) * num_rows,
+			   m_result, sizeof(uint32_t));
+
+	cuMemFree(m_xvalues);
+	cuMemFree(m_yvalues);
+	free(x_values);
+	free(y_values);
+}
+
+/*
+ * bench_hashjoin - probe num_rows keys on the hash table of inner_nrows
+ */
+static void
+bench_hashjoin(void)
+{
+	int32_t	   *inner_keys = __malloc(sizeof(int32_t) * inner_nrows);
+	int32_t	   *outer_keys = __malloc(sizeof(int32_t) * num_rows);
+	CUdeviceptr	m_inner;
+	CUdeviceptr	m_outer;
+	CUdeviceptr	m_length;
+	CUdeviceptr	m_kds_hash;
+	CUfunction	kern_func;
+	size_t		length;
+	void	   *kern_args[6];
+	int			grid_sz;
+	int			block_sz;
+	unsigned int i;
+	CUresult	rc;
+
+	/* inner keys are unique; outer keys may not match (x2 range) */
+	for (i=0; i < inner_nrows; i++)
+		inner_keys[i] = i;
+	for (i=0; i < num_rows; i++)
+		outer_keys[i] = random_key(2 * inner_nrows);
+	m_inner = __cuMemAllocCopy(inner_keys, sizeof(int32_t) * inner_nrows);
+	m_outer = __cuMemAllocCopy(outer_keys, sizeof(int32_t) * num_rows);
+
+	/* build the inner hash table on the device */
+	m_length = __cuMemAllocCopy(NULL, sizeof(size_t));
+	kern_func = lookup_kernel("kernbench_hash_length", &grid_sz, &block_sz, 1);
+	kern_args[0] = &inner_nrows;
+	kern_args[1] = &m_length;
+	rc = cuLaunchKernel(kern_func, 1, 1, 1, 1, 1, 1, 0, NULL, kern_args, NULL);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuLaunchKernel");
+	rc = cuMemcpyDtoH(&length, m_length, sizeof(size_t));
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuMemcpyDtoH");
+	m_kds_hash = __cuMemAllocCopy(NULL, length);
+	rc = cuMemsetD8(m_kds_hash, 0, length);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuMemsetD8");
+
+	kern_func = lookup_kernel("kernbench_hash_setup", &grid_sz, &block_sz, 1);
+	kern_args[0] = &m_kds_hash;
+	kern_args[1] = &length;
+	kern_args[2] = &inner_nrows;
+	rc = cuLaunchKernel(kern_func, 1, 1, 1, 1, 1, 1, 0, NULL, kern_args, NULL);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuLaunchKernel");
+
+	kern_func = lookup_kernel("kernbench_hash_build", &grid_sz, &block_sz,
+							  inner_nrows);
+	kern_args[0] = &m_kparams;
+	kern_args[1] = &m_kerror;
+	kern_args[2] = &m_kds_hash;
+	kern_args[3] = &m_inner;
+	rc = cuLaunchKernel(kern_func,
+						grid_sz, 1, 1,
+						block_sz, 1, 1,
+						0, NULL, kern_args, NULL);
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuLaunchKernel");
+	rc = cuCtxSynchronize();
+	if (rc != CUDA_SUCCESS)
+		cuda_elog(rc, "failed on cuCtxSynchronize");
+
+	/* then, probe */
+	kern_args[0] = &m_kparams;
+	kern_args[1] = &m_kerror;
+	kern_args[2] = &m_kds_hash;
+	kern_args[3] = &num_rows;
+	kern_args[4] = &m_outer;
+	kern_args[5] = &m_result;
+	run_kernel("hashjoin", "kernbench_hash_probe", kern_args,
+			   num_rows, sizeof(int32_t) * num_rows,
+			   m_result, sizeof(uint32_t));
+
+	cuMemFree(m_inner);
+	cuMemFree(m_outer);
+	cuMemFree(m_length);
+	cuMemFree(m_kds_hash);
+	free(inner_keys);
+	free(outer_keys);
+}
+
+/*
+ * bench_preagg - sum(int8) GROUP BY key with num_groups
+ */
+static void
+bench_preagg(void)
+{
+	uint32_t   *gkeys = __malloc(sizeof(uint32_t) * num_rows);
+	int64_t	   *values = __malloc(sizeof(int64_t) * num_rows);
+	size_t		gbuf_sz = MAXALIGN(num_groups) + sizeof(int64_t) * num_groups;
+	CUdeviceptr	m_gkeys;
+	CUdeviceptr	m_values;
+	CUdeviceptr	m_gbuf;
+	CUdeviceptr	m_gdclass;
+	CUdeviceptr	m_gvalues;
+	void	   *kern_args[8];
+	unsigned int i;
+
+	if (num_groups < 1)
+		sys_elog("preagg: number of groups must be positive");
+	for (i=0; i < num_rows; i++)
+	{
+		gkeys[i] = random_key(num_groups);
+		values[i] = lrand48() % 10000;
+	}
+	m_gkeys  = __cuMemAllocCopy(gkeys, sizeof(uint32_t) * num_rows);
+	m_values = __cuMemAllocCopy(values, sizeof(int64_t) * num_rows);
+	m_gbuf   = __cuMemAllocCopy(NULL, gbuf_sz);
+	m_gdclass = m_gbuf;
+	m_gvalues = m_gbuf + MAXALIGN(num_groups);
+
+	kern_args[0] = &m_kparams;
+	kern_args[1] = &m_kerror;
+	kern_args[2] = &num_rows;
+	kern_args[3] = &m_gkeys;
+	kern_args[4] = &m_values;
+	kern_args[5] = &num_groups;
+	kern_args[6] = &m_gdclass;
+	kern_args[7] = &m_gvalues;
+	run_kernel("preagg", "kernbench_preagg_reduction", kern_args,
+			   num_rows, (sizeof(uint32_t) + sizeof(int64_t)) * num_rows,
+			   m_gbuf, gbuf_sz);
+
+	cuMemFree(m_gkeys);
+	cuMemFree(m_values);
+	cuMemFree(m_gbuf);
+	free(gkeys);
+	free(values);
+}
+
+static void
+usage(const char *command)
+{
+	fprintf(stderr,
+			"usage: %s [OPTIONS]\n"
+			"  -d DINDEX   : GPU device index (default: 0)\n"
+			"  -n NROWS    : number of rows (default: 10000000)\n"
+			"  -r NLOOPS   : number of runs to get the median (default: 5)\n"
+			"  -L LIBDIR   : directory of the GPU libraries (*.fatbin)\n"
+			"                (default: %s)\n"
+			"  -b LIST     : comma separated benchmarks to run, in\n"
+			"                textlike,jsonb,numeric,hashjoin,preagg\n"
+			"  -l LENGTH   : length of the text (default: 32)\n"
+			"  -p PATTERN  : LIKE pattern of textlike (default: %%abc%%)\n"
+			"  -k NKEYS    : number of the keys in jsonb (default: 8)\n"
+			"  -i NROWS    : number of inner rows for hashjoin\n"
+			"                (default: 1000000)\n"
+			"  -g NGROUPS  : number of groups for preagg (default: 1000)\n"
+			"  -s SKEW     : skew of the keys; 0 means uniform (default: 0)\n"
+			"  -m          : machine readable format (CSV)\n"
+			"  -h          : shows this message\n",
+			command, KERNBENCH_LIBDIR);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	char	   *list;
+	char	   *tok;
+	char	   *saveptr;
+	int			opt;
+
+	while ((opt = getopt(argc, argv, "d:n:r:L:b:l:p:k:i:g:s:mh")) != -1)
+	{
+		switch (opt)
+		{
+			case 'd':
+				cuda_dindex = atoi(optarg);
+				break;
+			case 'n':
+				num_rows = strtoul(optarg, NULL, 10);
+				break;
+			case 'r':
+				num_loops = atoi(optarg);
+				break;
+			case 'L':
+				libdir = optarg;
+				break;
+			case 'b':
+				bench_list = optarg;
+				break;
+			case 'l':
+				text_length = atoi(optarg);
+				break;
+			case 'p':
+				like_pattern = optarg;
+				break;
+			case 'k':
+				jsonb_nkeys = atoi(optarg);
+				break;
+			case 'i':
+				inner_nrows = strtoul(optarg, NULL, 10);
+				break;
+			case 'g':
+				num_groups = strtoul(optarg, NULL, 10);
+				break;
+			case 's':
+				skew_factor = atof(optarg);
+				break;
+			case 'm':
+				machine_format = 1;
+				break;
+			default:
+				usage(basename(argv[0]));
+				break;
+		}
+	}
+	if (num_rows == 0 || num_loops < 1 || text_length < 1 ||
+		inner_nrows == 0 || skew_factor < 0.0)
+		usage(basename(argv[0]));
+	srand48(20200101);
+
+	setup_cuda_module();
+	if (machine_format)
+		printf("bench,nrows,nbytes,time_ms,gb_per_sec,mrows_per_sec,result\n");
+	else
+		printf("%-10s %11s %12s %9s %8s %10s\n",
+			   "bench", "nrows", "nbytes", "time[ms]", "GB/s", "Mrows/s");
+
+	list = strdup(bench_list);
+	for (tok = strtok_r(list, ",", &saveptr);
+		 tok != NULL;
+		 tok = strtok_r(NULL, ",", &saveptr))
+	{
+		if (strcmp(tok, "textlike") == 0)
+			bench_textlike();
+		else if (strcmp(tok, "jsonb") == 0)
+			bench_jsonb();
+		else if (strcmp(tok, "numeric") == 0)
+			bench_numeric();
+		else if (strcmp(tok, "hashjoin") == 0)
+			bench_hashjoin();
+		else if (strcmp(tok, "preagg") == 0)
+			bench_preagg();
+		else
+			sys_elog("unknown benchmark: %s", tok);
+	}
+	free(list);
+
+	cuModuleUnload(cuda_module);
+	cuCtxDestroy(cuda_context);
+
+	return 0;
+}
@@ -7,17 +7,24 @@
  * it under the terms of the PostgreSQL License. See the LICENSE file.
  */
 #include "postgres.h"
+#include <arpa/inet.h>
 #include <assert.h>
 #include <endian.h>
 #include <getopt.h>
 #include <libpq-fe.h>
+#include <limits.h>
+#include <sys/wait.h>
 #include "arrow_ipc.h"
 
 /* static functions */
 #define CURSOR_NAME		"curr_pg2arrow"
-static PGresult *pgsql_begin_query(PGconn *conn, const char *query);
-static PGresult *pgsql_next_result(PGconn *conn);
+static PGresult *pgsql_begin_query(PGconn *conn, const char *query,
+								   const char *snapshot);
+static PGresult *pgsql_next_result(PGconn *conn, bool keep_empty);
 static void      pgsql_end_query(PGconn *conn);
+static PGresult *pgsql_begin_copy(PGconn *conn, const char *query,
+								  const char *snapshot);
+static void      pgsql_end_copy(PGconn *conn);
 static void      pgsql_setup_composite_type(PGconn *conn,
 											SQLtable *root,
 											SQLfield *attr,
@@ -51,6 +58,14 @@ static char	   *pgsql_database = NULL;
 static char	   *dump_arrow_filename = NULL;
 static int		shows_progress = 0;
 static userConfigOption *session_preset_commands = NULL;
+static char	   *stat_column_names = NULL;
+static int		num_workers = 0;
+static char	   *parallel_key = NULL;
+static int		use_copy_protocol = 0;
+static int		auto_dict_limit = 0;
+static char	   *partition_key = NULL;
+static char	   *partition_ddl_parent = NULL;
+static size_t	partition_mem_limit = 0;
 /* server settings */
 static char	   *server_timezone_name = NULL;
 static int64_t	server_timezone_offset = 0;
@@ -84,6 +99,28 @@ usage(void)
 		  "Arrow format options:\n"
 		  "  -s, --segment-size=SIZE size of record batch for each\n"
 		  "      (default: 256MB)\n"
+		  "      --stat=COLUMNS      embeds min/max statistics of the columns\n"
+		  "                          (comma separated) per record batch\n"
+		  "      --auto-dict=LIMIT   dictionary encoding on text columns, if\n"
+		  "                          number of distinct values in the first\n"
+		  "                          500,000 rows is less than or equal to LIMIT\n"
+		  "\n"
+		  "Parallel export options:\n"
+		  "  -n, --parallel=N        number of concurrent connections\n"
+		  "      --parallel-key=KEY  integer expression to split the results\n"
+		  "      (the i-th connection exports rows where abs(KEY %% N) = i,\n"
+		  "       into FILENAME with suffix '.i', under the same snapshot;\n"
+		  "       rows with NULL key are exported by the 0th connection)\n"
+		  "\n"
+		  "Partitioned output options:\n"
+		  "      --partition-key=KEY expression to route the results into\n"
+		  "      (rows are written into FILENAME with suffix '.KEY' for each\n"
+		  "       distinct value of the expression)\n"
+		  "      --partition-ddl=PARENT prints CREATE FOREIGN TABLE ...\n"
+		  "                          PARTITION OF PARENT for each file\n"
+		  "      --partition-mem=SIZE total size of the buffers of all the\n"
+		  "                          partitions, then the largest one is\n"
+		  "                          written out (default: 4GB)\n"
 		  "\n"
 		  "Connection options:\n"
 		  "  -h, --host=HOSTNAME     database server host\n"
@@ -95,6 +132,7 @@ usage(void)
 		  "Other options:\n"
 		  "      --dump=FILENAME     dump information of arrow file\n"
 		  "      --progress          shows progress of the job\n"
+		  "      --copy              fetch results using binary COPY protocol\n"
 		  "      --set=NAME:VALUE    GUC option to set before SQL execution\n"
 		  "\n"
 		  "Report bugs to <pgstrom@heterodb.com>.\n",
@@ -133,6 +171,30 @@ dumpArrowFile(const char *filename)
 	return 0;
 }
 
+/*
+ * parse_size_option - SIZE with optional k/kb, m/mb, g/gb suffix;
+ * it returns 0 for invalid form.
+ */
+static size_t
+parse_size_option(const char *value)
+{
+	const char *pos = value;
+
+	while (isdigit(*pos))
+		pos++;
+	if (pos == value)
+		return 0;
+	if (*pos == '\0')
+		return atol(value);
+	if (strcasecmp(pos, "k") == 0 || strcasecmp(pos, "kb") == 0)
+		return atol(value) * (1UL << 10);
+	if (strcasecmp(pos, "m") == 0 || strcasecmp(pos, "mb") == 0)
+		return atol(value) * (1UL << 20);
+	if (strcasecmp(pos, "g") == 0 || strcasecmp(pos, "gb") == 0)
+		return atol(value) * (1UL << 30);
+	return 0;
+}
+
 static void
 parse_options(int argc, char * const argv[])
 {
@@ -151,11 +213,18 @@ parse_options(int argc, char * const argv[])
 		{"progress",     no_argument,        NULL, 1001 },
 		{"append",       required_argument,  NULL, 1002 },
 		{"set",          required_argument,  NULL, 1003 },
+		{"stat",         required_argument,  NULL, 1004 },
+		{"parallel",     required_argument,  NULL,  'n' },
+		{"parallel-key", required_argument,  NULL, 1005 },
+		{"copy",         no_argument,        NULL, 1006 },
+		{"auto-dict",    required_argument,  NULL, 1007 },
+		{"partition-key", required_argument, NULL, 1008 },
+		{"partition-ddl", required_argument, NULL, 1009 },
+		{"partition-mem", required_argument, NULL, 1010 },
 		{"help",         no_argument,        NULL, 9999 },
 		{NULL, 0, NULL, 0},
 	};
 	int			c;
-	char	   *pos;
 	char	   *sql_file = NULL;
 	userConfigOption *last_user_config = NULL;
 
@@ -193,23 +262,18 @@ parse_options(int argc, char * const argv[])
 			case 's':
 				if (batch_segment_sz != 0)
 					Elog("-s option specified twice");
-				pos = optarg;
-				while (isdigit(*pos))
-					pos++;
-				if (*pos == '\0')
-					batch_segment_sz = atol(optarg);
-				else if (strcasecmp(pos, "k") == 0 ||
-						 strcasecmp(pos, "kb") == 0)
-					batch_segment_sz = atol(optarg) * (1UL << 10);
-				else if (strcasecmp(pos, "m") == 0 ||
-						 strcasecmp(pos, "mb") == 0)
-					batch_segment_sz = atol(optarg) * (1UL << 20);
-				else if (strcasecmp(pos, "g") == 0 ||
-						 strcasecmp(pos, "gb") == 0)
-					batch_segment_sz = atol(optarg) * (1UL << 30);
-				else
+				batch_segment_sz = parse_size_option(optarg);
+				if (batch_segment_sz == 0)
 					Elog("segment size is not valid: %s", optarg);
 				break;
+			case 'n':
+				if (num_workers != 0)
+					Elog("-n option specified twice");
+				num_workers = atoi(optarg);
+				if (num_workers < 1 || num_workers > 256)
+					Elog("number of parallel connections is not valid: %s",
+						 optarg);
+				break;
 			case 'h':
 				if (pgsql_hostname)
 					Elog("-h option specified twice");
@@ -278,6 +342,45 @@ parse_options(int argc, char * const argv[])
 					last_user_config = conf;
 				}
 				break;
+			case 1004:		/* --stat */
+				if (stat_column_names)
+					Elog("--stat option specified twice");
+				stat_column_names = optarg;
+				break;
+			case 1005:		/* --parallel-key */
+				if (parallel_key)
+					Elog("--parallel-key option specified twice");
+				parallel_key = optarg;
+				break;
+			case 1006:		/* --copy */
+				if (use_copy_protocol)
+					Elog("--copy option specified twice");
+				use_copy_protocol = 1;
+				break;
+			case 1007:		/* --auto-dict */
+				if (auto_dict_limit != 0)
+					Elog("--auto-dict option specified twice");
+				auto_dict_limit = atoi(optarg);
+				if (auto_dict_limit < 1)
+					Elog("--auto-dict=LIMIT is not valid: %s", optarg);
+				break;
+			case 1008:		/* --partition-key */
+				if (partition_key)
+					Elog("--partition-key option specified twice");
+				partition_key = optarg;
+				break;
+			case 1009:		/* --partition-ddl */
+				if (partition_ddl_parent)
+					Elog("--partition-ddl option specified twice");
+				partition_ddl_parent = optarg;
+				break;
+			case 1010:		/* --partition-mem */
+				if (partition_mem_limit != 0)
+					Elog("--partition-mem option specified twice");
+				partition_mem_limit = parse_size_option(optarg);
+				if (partition_mem_limit == 0)
+					Elog("--partition-mem=SIZE is not valid: %s", optarg);
+				break;
 			case 9999:		/* --help */
 			default:
 				usage();
@@ -310,6 +413,40 @@ parse_options(int argc, char * const argv[])
 		return;
 	}
 
+	if (num_workers > 1)
+	{
+		if (!parallel_key)
+			Elog("-n, --parallel=N needs --parallel-key=KEY");
+		if (!output_filename)
+			Elog("-n, --parallel=N needs -o, --output=FILENAME");
+	}
+	else if (parallel_key)
+		Elog("--parallel-key=KEY is valid only with -n, --parallel=N");
+	if (auto_dict_limit > 0)
+	{
+		if (use_copy_protocol)
+			Elog("--auto-dict and --copy are exclusive");
+		if (append_filename)
+			Elog("--auto-dict and --append are exclusive");
+	}
+	if (partition_key)
+	{
+		if (!output_filename)
+			Elog("--partition-key=KEY needs -o, --output=FILENAME");
+		if (num_workers > 1)
+			Elog("--partition-key and --parallel are exclusive");
+		if (use_copy_protocol)
+			Elog("--partition-key and --copy are exclusive");
+		if (auto_dict_limit > 0)
+			Elog("--partition-key and --auto-dict are exclusive");
+	}
+	else if (partition_ddl_parent)
+		Elog("--partition-ddl=PARENT is valid only with --partition-key=KEY");
+	else if (partition_mem_limit != 0)
+		Elog("--partition-mem=SIZE is valid only with --partition-key=KEY");
+	if (partition_mem_limit == 0)
+		partition_mem_limit = (1UL << 32);	/* 4GB in default */
+
 	if (batch_segment_sz == 0)
 		batch_segment_sz = (1UL << 28);		/* 256MB in default */
 	if (sql_file)
@@ -466,20 +603,51 @@ pgsql_init_session(PGconn *conn)
 	server_timezone_offset = -ntohll(*((uint64_t *)ptr));
 }
 
+/*
+ * pgsql_begin_transaction
+ */
+static void
+pgsql_begin_transaction(PGconn *conn, const char *snapshot)
+{
+	PGresult   *res;
+	char	   *buffer;
+
+	/* set transaction read-only */
+	if (!snapshot)
+	{
+		res = PQexec(conn, "BEGIN READ ONLY");
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			Elog("unable to begin transaction: %s", PQresultErrorMessage(res));
+		PQclear(res);
+	}
+	else
+	{
+		/* parallel export uses the snapshot exported by the leader */
+		res = PQexec(conn, "BEGIN ISOLATION LEVEL REPEATABLE READ READ ONLY");
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			Elog("unable to begin transaction: %s", PQresultErrorMessage(res));
+		PQclear(res);
+
+		buffer = palloc(strlen(snapshot) + 100);
+		sprintf(buffer, "SET TRANSACTION SNAPSHOT '%s'", snapshot);
+		res = PQexec(conn, buffer);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			Elog("unable to import snapshot: %s", PQresultErrorMessage(res));
+		PQclear(res);
+		pfree(buffer);
+	}
+}
+
 /*
  * pgsql_begin_query
  */
 static PGresult *
-pgsql_begin_query(PGconn *conn, const char *query)
+pgsql_begin_query(PGconn *conn, const char *query, const char *snapshot)
 {
 	PGresult   *res;
 	char	   *buffer;
 
-	/* set transaction read-only */
-	res = PQexec(conn, "BEGIN READ ONLY");
-	if (PQresultStatus(res) != PGRES_COMMAND_OK)
-		Elog("unable to begin transaction: %s", PQresultErrorMessage(res));
-	PQclear(res);
+	pgsql_begin_transaction(conn, snapshot);
 
 	/* declare cursor */
 	buffer = palloc(strlen(query) + 2048);
@@ -489,14 +657,20 @@ pgsql_begin_query(PGconn *conn, const char *query)
 		Elog("unable to declare a SQL cursor: %s", PQresultErrorMessage(res));
 	PQclear(res);
 
-	return pgsql_next_result(conn);
+	/*
+	 * A part of the results on parallel export may be empty, however,
+	 * it still needs the result to write out the schema.
+	 */
+	return pgsql_next_result(conn, snapshot != NULL);
 }
 
 /*
  * pgsql_next_result
+ *
+ * It returns NULL at the end of the results, unless @keep_empty is true.
  */
 static PGresult *
-pgsql_next_result(PGconn *conn)
+pgsql_next_result(PGconn *conn, bool keep_empty)
 {
 	PGresult   *res;
 	/* fetch results per half million rows */
@@ -506,7 +680,7 @@ pgsql_next_result(PGconn *conn)
 					   1);	/* results in binary mode */
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 		Elog("SQL execution failed: %s", PQresultErrorMessage(res));
-	if (PQntuples(res) == 0)
+	if (PQntuples(res) == 0 && !keep_empty)
 	{
 		PQclear(res);
 		return NULL;
@@ -532,6 +706,62 @@ pgsql_end_query(PGconn *conn)
 	PQfinish(conn);
 }
 
+/*
+ * pgsql_begin_copy
+ *
+ * It returns the description of the query results, to set up SQLtable,
+ * then kicks COPY ... TO STDOUT (FORMAT binary) of the query.
+ */
+static PGresult *
+pgsql_begin_copy(PGconn *conn, const char *query, const char *snapshot)
+{
+	PGresult   *res;
+	PGresult   *desc;
+	char	   *buffer;
+
+	pgsql_begin_transaction(conn, snapshot);
+
+	/* describe the query results without execution */
+	res = PQprepare(conn, "", query, 0, NULL);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		Elog("unable to prepare the SQL command: %s",
+			 PQresultErrorMessage(res));
+	PQclear(res);
+	desc = PQdescribePrepared(conn, "");
+	if (PQresultStatus(desc) != PGRES_COMMAND_OK)
+		Elog("unable to describe the SQL command: %s",
+			 PQresultErrorMessage(desc));
+
+	/* kick COPY command */
+	buffer = palloc(strlen(query) + 100);
+	sprintf(buffer, "COPY (%s) TO STDOUT (FORMAT binary)", query);
+	res = PQexec(conn, buffer);
+	if (PQresultStatus(res) != PGRES_COPY_OUT)
+		Elog("unable to run COPY command: %s", PQresultErrorMessage(res));
+	PQclear(res);
+	pfree(buffer);
+
+	return desc;
+}
+
+/*
+ * pgsql_end_copy
+ */
+static void
+pgsql_end_copy(PGconn *conn)
+{
+	PGresult   *res;
+
+	while ((res = PQgetResult(conn)) != NULL)
+	{
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			Elog("COPY command failed: %s", PQresultErrorMessage(res));
+		PQclear(res);
+	}
+	/* close the connection */
+	PQfinish(conn);
+}
+
 #define atooid(x)		((Oid) strtoul((x), NULL, 10))
 #define InvalidOid		((Oid) 0)
 
@@ -857,14 +1087,18 @@ pgsql_setup_array_element(PGconn *conn,
 }
 
 /*
- * pgsql_create_buffer
+ * __pgsql_create_buffer
+ *
+ * It constructs SQLtable according to the result columns, except for the
+ * first 'attbase' columns that are used internally.
  */
-SQLtable *
-pgsql_create_buffer(PGconn *conn, PGresult *res,
-					size_t segment_sz,
-					const char *sql_command)
+static SQLtable *
+__pgsql_create_buffer(PGconn *conn, PGresult *res,
+					  size_t segment_sz,
+					  const char *sql_command,
+					  int attbase)
 {
-	int			j, nfields = PQnfields(res);
+	int			j, nfields = PQnfields(res) - attbase;
 	SQLtable   *table;
 	ArrowKeyValue *kv;
 
@@ -874,9 +1108,9 @@ pgsql_create_buffer(PGconn *conn, PGresult *res,
 	table->nfields = nfields;
 	for (j=0; j < nfields; j++)
 	{
-		const char *attname = PQfname(res, j);
-		Oid			atttypid = PQftype(res, j);
-		int			atttypmod = PQfmod(res, j);
+		const char *attname = PQfname(res, attbase + j);
+		Oid			atttypid = PQftype(res, attbase + j);
+		int			atttypmod = PQfmod(res, attbase + j);
 		PGresult   *__res;
 		char		query[4096];
 		const char *typlen;
@@ -942,6 +1176,17 @@ pgsql_create_buffer(PGconn *conn, PGresult *res,
 	return table;
 }
 
+/*
+ * pgsql_create_buffer
+ */
+SQLtable *
+pgsql_create_buffer(PGconn *conn, PGresult *res,
+					size_t segment_sz,
+					const char *sql_command)
+{
+	return __pgsql_create_buffer(conn, res, segment_sz, sql_command, 0);
+}
+
 static int
 __arrow_type_is_compatible(SQLtable *root,
 						   SQLfield *attr,
@@ -1065,6 +1310,8 @@ initial_setup_append_file(SQLtable *table)
 	 * check schema compatibility
 	 */
 	readArrowFileDesc(table->fdesc, &af_info);
+	if (af_info.is_parquet)
+		Elog("--append is given, but Apache Parquet file is not writable");
 	af_schema = &af_info.footer.schema;
 	if (af_schema->_num_fields != table->nfields)
 		Elog("--append is given, but number of columns are different.");
@@ -1074,6 +1321,10 @@ initial_setup_append_file(SQLtable *table)
 										&table->columns[i],
 										af_schema->fields + i))
 			Elog("--append is given, but attribute %d is not compatible", i+1);
+		/* restore min/max statistics of the existing RecordBatches */
+		sql_field_restore_stat(&table->columns[i],
+							   af_schema->fields + i,
+							   af_info.footer._num_recordBatches);
 	}
 
 	/* restore DictionaryBatches already in the file */
@@ -1106,6 +1357,100 @@ initial_setup_append_file(SQLtable *table)
 			 table->fdesc, offset);
 }
 
+/*
+ * setup_stat_columns - enables min/max statistics by --stat option
+ */
+static void
+setup_stat_columns(SQLtable *table)
+{
+	char	   *temp = pstrdup(stat_column_names);
+	char	   *tok, *saveptr;
+	int			j;
+
+	for (tok = strtok_r(temp, ",", &saveptr);
+		 tok != NULL;
+		 tok = strtok_r(NULL, ",", &saveptr))
+	{
+		char   *tail;
+
+		while (isspace(*tok))
+			tok++;
+		tail = tok + strlen(tok) - 1;
+		while (tail >= tok && isspace(*tail))
+			*tail-- = '\0';
+		if (*tok == '\0')
+			continue;
+		for (j=0; j < table->nfields; j++)
+		{
+			SQLfield   *column = &table->columns[j];
+
+			if (strcmp(column->field_name, tok) == 0)
+			{
+				if (!sql_field_enable_stat(column))
+					Elog("--stat: column '%s' has unsupported type (%s)",
+						 tok, column->arrow_typename);
+				break;
+			}
+		}
+		if (j == table->nfields)
+			Elog("--stat: column '%s' was not found", tok);
+	}
+	pfree(temp);
+}
+
+/*
+ * setup_auto_dict_columns
+ *
+ * It applies dictionary encoding on the text columns, if number of the
+ * distinct values in the first result set is small enough. Labels that
+ * appear later are added to the dictionary on demand, so the dictionary
+ * batches are written after all the record batches.
+ */
+static void
+setup_auto_dict_columns(SQLtable *table, PGresult *res)
+{
+	int			i, j, nitems = PQntuples(res);
+	int			num_dicts = 0;
+	SQLdictionary *dict;
+
+	for (dict = table->sql_dict_list; dict != NULL; dict = dict->next)
+		num_dicts = Max(num_dicts, dict->dict_id + 1);
+
+	for (j=0; j < table->nfields; j++)
+	{
+		SQLfield   *column = &table->columns[j];
+		int			nslots;
+
+		if (column->arrow_type.node.tag != ArrowNodeTag__Utf8 ||
+			column->enumdict)
+			continue;
+
+		nslots = Min(Max(auto_dict_limit, 1<<10), 1<<18);
+		dict = palloc0(offsetof(SQLdictionary, hslots[nslots]));
+		dict->dict_id = num_dicts;
+		dict->is_dynamic = true;
+		sql_buffer_init(&dict->values);
+		sql_buffer_init(&dict->extra);
+		dict->nslots = nslots;
+		for (i=0; i < nitems && dict->nitems <= auto_dict_limit; i++)
+		{
+			if (PQgetisnull(res, i, j))
+				continue;
+			sql_dictionary_put_label(dict,
+									 PQgetvalue(res, i, j),
+									 PQgetlength(res, i, j));
+		}
+		if (dict->nitems > auto_dict_limit ||
+			!sql_field_enable_dictionary(column, dict))
+			continue;	/* too much cardinality */
+		/* Utf8 needs no extra buffer if dictionary encoded */
+		table->numBuffers--;
+		dict->next = table->sql_dict_list;
+		table->sql_dict_list = dict;
+		num_dicts++;
+	}
+}
+
 /*
  * pgsql_writeout_buffer
  */
@@ -1136,51 +1481,149 @@ pgsql_writeout_buffer(SQLtable *table)
 	}
 }
 
+/*
+ * pgsql_append_row
+ *
+ * It puts the i-th row of the results, except for the first 'attbase'
+ * columns, then returns the current buffer usage.
+ */
+static size_t
+pgsql_append_row(SQLtable *table, PGresult *res, int i, int attbase)
+{
+	SQLfield   *columns = table->columns;
+	size_t		usage = 0;
+	size_t		nitems = table->nitems;
+	int			j;
+
+	assert(table->nfields == PQnfields(res) - attbase);
+	for (j=0; j < table->nfields; j++)
+	{
+		SQLfield	   *column = &columns[j];
+		const char	   *addr;
+		size_t			sz;
+		/* data must be binary format */
+		assert(PQfformat(res, attbase + j) == 1);
+		if (PQgetisnull(res, i, attbase + j))
+		{
+			addr = NULL;
+			sz = 0;
+		}
+		else
+		{
+			addr = PQgetvalue(res, i, attbase + j);
+			sz = PQgetlength(res, i, attbase + j);
+		}
+		assert(column->nitems == nitems);
+		usage += sql_field_put_value(column, addr, sz);
+	}
+	table->nitems++;
+	/* exceeds the threshold to write? */
+	if (usage > table->segment_sz && nitems == 0)
+		Elog("A result row is larger than size of record batch!!");
+	return usage;
+}
+
 /*
  * pgsql_append_results
  */
 void
 pgsql_append_results(SQLtable *table, PGresult *res)
 {
-	SQLfield  *columns = table->columns;
 	int		i, ntuples = PQntuples(res);
-	int		j, nfields = PQnfields(res);
 
-	assert(table->nfields == nfields);
 	for (i=0; i < ntuples; i++)
 	{
-		size_t	usage = 0;
-		size_t	nitems = columns[0].nitems;
+		if (pgsql_append_row(table, res, i, 0) > table->segment_sz)
+			pgsql_writeout_buffer(table);
+	}
+}
 
-		for (j=0; j < nfields; j++)
+/*
+ * pgsql_append_copy_results
+ *
+ * It streams the binary COPY data into the SQLtable buffer, without
+ * materialization of PGresult. Each field has identical form to the
+ * binary results of the cursor, so put_value handlers are available.
+ */
+#define COPY_BINARY_SIGNATURE		"PGCOPY\n\377\r\n\0"
+#define COPY_BINARY_SIGNATURE_SZ	11
+
+static void
+pgsql_append_copy_results(SQLtable *table, PGconn *conn)
+{
+	SQLfield   *columns = table->columns;
+	bool		header_done = false;
+	char	   *buffer;
+	int			length;
+
+	while ((length = PQgetCopyData(conn, &buffer, 0)) > 0)
+	{
+		const char *pos = buffer;
+		const char *end = buffer + length;
+		uint16		ival16;
+		uint32		ival32;
+
+		if (!header_done)
 		{
-			SQLfield	   *column = &columns[j];
-			const char	   *addr;
-			size_t			sz;
-			/* data must be binary format */
-			assert(PQfformat(res, j) == 1);
-			if (PQgetisnull(res, i, j))
+			/* signature, flags and length of the header extension */
+			if (length < COPY_BINARY_SIGNATURE_SZ + 8 ||
+				memcmp(pos, COPY_BINARY_SIGNATURE,
+					   COPY_BINARY_SIGNATURE_SZ) != 0)
+				Elog("unexpected header of binary COPY data");
+			pos += COPY_BINARY_SIGNATURE_SZ + 4;
+			memcpy(&ival32, pos, sizeof(uint32));
+			pos += sizeof(uint32) + ntohl(ival32);
+			header_done = true;
+		}
+
+		while (pos < end)
+		{
+			size_t	usage = 0;
+			size_t	nitems = table->nitems;
+			int		j, nfields;
+
+			if (end - pos < sizeof(uint16))
+				Elog("binary COPY data is corrupted");
+			memcpy(&ival16, pos, sizeof(uint16));
+			pos += sizeof(uint16);
+			nfields = (int16)ntohs(ival16);
+			if (nfields < 0)
+				break;		/* file trailer */
+			if (nfields != table->nfields)
+				Elog("unexpected number of fields in binary COPY data: %d",
+					 nfields);
+			for (j=0; j < nfields; j++)
 			{
-				addr = NULL;
-				sz = 0;
+				int32	sz;
+
+				if (end - pos < sizeof(uint32))
+					Elog("binary COPY data is corrupted");
+				memcpy(&ival32, pos, sizeof(uint32));
+				pos += sizeof(uint32);
+				sz = (int32)ntohl(ival32);
+				if (sz < 0)
+					usage += sql_field_put_value(&columns[j], NULL, 0);
+				else
+				{
+					if (end - pos < sz)
+						Elog("binary COPY data is corrupted");
+					usage += sql_field_put_value(&columns[j], pos, sz);
+					pos += sz;
+				}
 			}
-			else
+			table->nitems++;
+			/* exceeds the threshold to write? */
+			if (usage > table->segment_sz)
 			{
-				addr = PQgetvalue(res, i, j);
-				sz = PQgetlength(res, i, j);
+				if (nitems == 0)
+					Elog("A result row is larger than size of record batch!!");
+				pgsql_writeout_buffer(table);
 			}
-			assert(column->nitems == nitems);
-			usage += sql_field_put_value(column, addr, sz);
-		}
-		table->nitems++;
-		/* exceeds the threshold to write? */
-		if (usage > table->segment_sz)
-		{
-			if (nitems == 0)
-				Elog("A result row is larger than size of record batch!!");
-			pgsql_writeout_buffer(table);
 		}
+		PQfreemem(buffer);
 	}
+	if (length == -2)
+		Elog("failed on PQgetCopyData: %s", PQerrorMessage(conn));
 }
 
 /*
@@ -1244,29 +1687,32 @@ pgsql_dump_buffer(SQLtable *table)
 }
 
 /*
- * Entrypoint of pg2arrow
+ * pg2arrow_export - export results of the query into an arrow file
  */
-int main(int argc, char * const argv[])
+static int
+pg2arrow_export(const char *snapshot)
 {
 	PGconn	   *conn;
 	PGresult   *res;
 	SQLtable   *table = NULL;
 	ssize_t		nbytes;
 
-	parse_options(argc, argv);
-	/* special case if '--dump <filename>' is given */
-	if (dump_arrow_filename)
-		return dumpArrowFile(dump_arrow_filename);
-
 	/* open PostgreSQL connection */
 	conn = pgsql_server_connect();
 	/* initialize the session */
 	pgsql_init_session(conn);
 	/* run SQL command */
-	res = pgsql_begin_query(conn, sql_command);
+	if (use_copy_protocol)
+		res = pgsql_begin_copy(conn, sql_command, snapshot);
+	else
+		res = pgsql_begin_query(conn, sql_command, snapshot);
 	if (!res)
 		Elog("SQL command returned an empty result");
 	table = pgsql_create_buffer(conn, res, batch_segment_sz, sql_command);
+	if (stat_column_names)
+		setup_stat_columns(table);
+	if (auto_dict_limit > 0)
+		setup_auto_dict_columns(table, res);
 	if (append_filename)
 	{
 		table->fdesc = open(append_filename, O_RDWR, 0644);
@@ -1307,19 +1753,417 @@ int main(int argc, char * const argv[])
 			Elog("failed on write(2): %m");
 		nbytes = writeArrowSchema(table);
 	}
-	writeArrowDictionaryBatches(table);
+	writeArrowDictionaryBatches(table, false);
+	if (use_copy_protocol)
+	{
+		PQclear(res);
+		pgsql_append_copy_results(table, conn);
+		pgsql_end_copy(conn);
+	}
+	else
+	{
+		do {
+			pgsql_append_results(table, res);
+			PQclear(res);
+			res = pgsql_next_result(conn, false);
+		} while (res != NULL);
+		pgsql_end_query(conn);
+	}
+	pgsql_writeout_buffer(table);
+	writeArrowDictionaryBatches(table, true);
+	nbytes = writeArrowFooter(table);
+
+	return 0;
+}
+
+/*
+ * pg2arrow_parallel_export
+ *
+ * It exports the query results using multiple connections, by fork(2) of
+ * the worker processes. Each worker exports a part of the results into
+ * the individual file under the snapshot exported by the leader, so the
+ * files are consistent as if a single query exported them.
+ */
+static int
+pg2arrow_parallel_export(void)
+{
+	PGconn	   *conn;
+	PGresult   *res;
+	char	   *snapshot;
+	char	   *base_query = sql_command;
+	char	   *base_fname = output_filename;
+	const char *suffix;
+	pid_t	   *children;
+	int			i, status;
+	int			nfailed = 0;
+
+	conn = pgsql_server_connect();
+	res = PQexec(conn, "BEGIN ISOLATION LEVEL REPEATABLE READ READ ONLY");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		Elog("unable to begin transaction: %s", PQresultErrorMessage(res));
+	PQclear(res);
+	res = PQexec(conn, "SELECT pg_export_snapshot()");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK ||
+		PQntuples(res) != 1 ||
+		PQgetisnull(res, 0, 0))
+		Elog("unable to export snapshot: %s", PQresultErrorMessage(res));
+	snapshot = pstrdup(PQgetvalue(res, 0, 0));
+	PQclear(res);
+
+	/* filename suffix shall be put prior to the '.arrow' extension */
+	suffix = strrchr(base_fname, '.');
+	if (!suffix || strcasecmp(suffix, ".arrow") != 0)
+		suffix = base_fname + strlen(base_fname);
+
+	children = palloc0(sizeof(pid_t) * num_workers);
+	for (i=0; i < num_workers; i++)
+	{
+		pid_t	child = fork();
+
+		if (child == 0)
+		{
+			/* worker process */
+			sql_command = palloc(strlen(base_query) +
+								 strlen(parallel_key) + 200);
+			sprintf(sql_command,
+					"SELECT * FROM (%s) __pg2arrow_parallel"
+					" WHERE coalesce(abs((%s) %% %d), 0) = %d",
+					base_query, parallel_key, num_workers, i);
+			output_filename = palloc(strlen(base_fname) + 20);
+			sprintf(output_filename, "%.*s.%d%s",
+					(int)(suffix - base_fname), base_fname, i, suffix);
+			exit(pg2arrow_export(snapshot));
+		}
+		else if (child < 0)
+		{
+			fprintf(stderr, "failed on fork(2): %m\n");
+			nfailed++;
+			break;
+		}
+		children[i] = child;
+	}
+
+	for (i=0; i < num_workers; i++)
+	{
+		if (children[i] == 0)
+			continue;
+		while (waitpid(children[i], &status, 0) < 0)
+		{
+			if (errno != EINTR)
+				Elog("failed on waitpid(2): %m");
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			nfailed++;
+	}
+	/* release the exported snapshot */
+	PQfinish(conn);
+
+	if (nfailed > 0)
+		Elog("%d of %d parallel exports failed", nfailed, num_workers);
+	return 0;
+}
+
+/*
+ * pg2arrow_partition_export
+ *
+ * It routes the query results into individual files for each distinct
+ * value of the partition key. Each partition has its own SQLtable buffer,
+ * and only PARTITION_MAX_OPEN_FILES files are kept open at the same time;
+ * the least recently written one is closed, then re-opened on the next
+ * write because the footer is written at the end of the job.
+ * Once total usage of the buffers exceeds --partition-mem, the largest one
+ * is written out as a RecordBatch, even if it is smaller than the segment.
+ */
+#define PARTITION_MAX_OPEN_FILES	64
+#define PARTITION_HASH_NSLOTS		1024
+
+typedef struct pgsqlPartition	pgsqlPartition;
+struct pgsqlPartition
+{
+	pgsqlPartition *next;		/* next item in the hash slot */
+	pgsqlPartition *chain;		/* next item in the creation order */
+	uint32		hash;
+	bool		isnull;			/* true, if partition key is NULL */
+	char	   *key;			/* partition key in text form */
+	char	   *suffix;			/* sanitized key for filename/relname */
+	char	   *filename;
+	uint64		last_used;		/* for LRU of the open files */
+	size_t		usage;			/* current usage of the buffer */
+	SQLtable   *table;
+};
+
+static pgsqlPartition  *partition_slots[PARTITION_HASH_NSLOTS];
+static pgsqlPartition  *partition_list = NULL;
+static pgsqlPartition  *partition_tail = NULL;
+static int				partition_nopen = 0;
+static uint64			partition_clock = 0;
+static size_t			partition_usage = 0;	/* total of part->usage */
+
+static void
+partition_open_file(pgsqlPartition *part, bool is_create)
+{
+	SQLtable   *table = part->table;
+
+	if (table->fdesc >= 0)
+	{
+		part->last_used = ++partition_clock;
+		return;
+	}
+	/* close the least recently used file, if too many */
+	if (partition_nopen >= PARTITION_MAX_OPEN_FILES)
+	{
+		pgsqlPartition *curr, *victim = NULL;
+
+		for (curr = partition_list; curr != NULL; curr = curr->chain)
+		{
+			if (curr->table->fdesc >= 0 &&
+				(!victim || curr->last_used < victim->last_used))
+				victim = curr;
+		}
+		assert(victim != NULL);
+		if (close(victim->table->fdesc) != 0)
+			Elog("failed on close('%s'): %m", victim->filename);
+		victim->table->fdesc = -1;
+		partition_nopen--;
+	}
+
+	if (is_create)
+		table->fdesc = open(part->filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	else
+		table->fdesc = open(part->filename, O_RDWR);
+	if (table->fdesc < 0)
+		Elog("failed to open '%s': %m", part->filename);
+	if (!is_create && lseek(table->fdesc, 0, SEEK_END) < 0)
+		Elog("failed on lseek('%s'): %m", part->filename);
+	partition_nopen++;
+	part->last_used = ++partition_clock;
+}
+
+static pgsqlPartition *
+partition_lookup_or_create(PGconn *conn, PGresult *res, int i)
+{
+	pgsqlPartition *part;
+	const char *key;
+	bool		isnull = PQgetisnull(res, i, 0);
+	int			len;
+	uint32		hash;
+	char	   *pos;
+	const char *base_fname = output_filename;
+	const char *ext;
+	ssize_t		nbytes;
+
+	if (isnull)
+	{
+		key = "null";
+		len = 4;
+		hash = 0;
+	}
+	else
+	{
+		key = PQgetvalue(res, i, 0);
+		len = PQgetlength(res, i, 0);
+		hash = hash_any((const unsigned char *)key, len);
+	}
+
+	for (part = partition_slots[hash % PARTITION_HASH_NSLOTS];
+		 part != NULL;
+		 part = part->next)
+	{
+		if (part->hash == hash &&
+			part->isnull == isnull &&
+			(isnull || (strlen(part->key) == len &&
+						memcmp(part->key, key, len) == 0)))
+			return part;
+	}
+
+	/* construct a new partition */
+	part = palloc0(sizeof(pgsqlPartition));
+	part->hash = hash;
+	part->isnull = isnull;
+	part->key = pnstrdup(key, len);
+	part->suffix = pstrdup(part->key);
+	for (pos = part->suffix; *pos != '\0'; pos++)
+	{
+		if (!isalnum(*pos) && *pos != '_')
+			*pos = '_';
+	}
+	ext = strrchr(base_fname, '.');
+	if (!ext || strcasecmp(ext, ".arrow") != 0)
+		ext = base_fname + strlen(base_fname);
+	part->filename = psprintf("%.*s.%s%s",
+							  (int)(ext - base_fname), base_fname,
+							  part->suffix, ext);
+	/* different keys must not be mapped to the same file */
+	{
+		pgsqlPartition *curr;
+
+		for (curr = partition_list; curr != NULL; curr = curr->chain)
+		{
+			if (strcmp(curr->filename, part->filename) == 0)
+				Elog("partition keys '%s' and '%s' are mapped to the same file '%s'",
+					 curr->key, part->key, part->filename);
+		}
+	}
+	part->table = __pgsql_create_buffer(conn, res, batch_segment_sz,
+										sql_command, 1);
+	part->table->fdesc = -1;
+	part->table->filename = part->filename;
+	if (stat_column_names)
+		setup_stat_columns(part->table);
+
+	/* write out header stuff from the file head */
+	partition_open_file(part, true);
+	nbytes = write(part->table->fdesc, "ARROW1\0\0", 8);
+	if (nbytes != 8)
+		Elog("failed on write(2): %m");
+	writeArrowSchema(part->table);
+	writeArrowDictionaryBatches(part->table, false);
+
+	part->next = partition_slots[hash % PARTITION_HASH_NSLOTS];
+	partition_slots[hash % PARTITION_HASH_NSLOTS] = part;
+	if (partition_tail)
+		partition_tail->chain = part;
+	else
+		partition_list = part;
+	partition_tail = part;
+
+	return part;
+}
+
+static void
+partition_writeout_buffer(pgsqlPartition *part)
+{
+	partition_open_file(part, false);
+	pgsql_writeout_buffer(part->table);
+	assert(partition_usage >= part->usage);
+	partition_usage -= part->usage;
+	part->usage = 0;
+}
+
+static void
+partition_print_ddl(pgsqlPartition *part)
+{
+	char		path[PATH_MAX];
+	char	   *pos;
+
+	if (!realpath(part->filename, path))
+		Elog("failed on realpath('%s'): %m", part->filename);
+	printf("CREATE FOREIGN TABLE %s_%s\n"
+		   "  PARTITION OF %s FOR VALUES IN (",
+		   partition_ddl_parent, part->suffix,
+		   partition_ddl_parent);
+	if (part->isnull)
+		printf("NULL");
+	else
+	{
+		putchar('\'');
+		for (pos = part->key; *pos != '\0'; pos++)
+		{
+			if (*pos == '\'')
+				putchar('\'');
+			putchar(*pos);
+		}
+		putchar('\'');
+	}
+	printf(")\n"
+		   "  SERVER arrow_fdw\n"
+		   "  OPTIONS (file '");
+	for (pos = path; *pos != '\0'; pos++)
+	{
+		if (*pos == '\'')
+			putchar('\'');
+		putchar(*pos);
+	}
+	printf("');\n");
+}
+
+static int
+pg2arrow_partition_export(void)
+{
+	PGconn	   *conn;
+	PGresult   *res;
+	pgsqlPartition *part;
+	char	   *query;
+
+	conn = pgsql_server_connect();
+	pgsql_init_session(conn);
+
+	query = psprintf("SELECT (%s)::text, * FROM (%s) __pg2arrow_partition",
+					 partition_key, sql_command);
+	res = pgsql_begin_query(conn, query, NULL);
+	if (!res)
+		Elog("SQL command returned an empty result");
 	do {
-		pgsql_append_results(table, res);
+		int		i, ntuples = PQntuples(res);
+
+		for (i=0; i < ntuples; i++)
+		{
+			size_t	usage;
+
+			part = partition_lookup_or_create(conn, res, i);
+			usage = pgsql_append_row(part->table, res, i, 1);
+			partition_usage += usage - part->usage;
+			part->usage = usage;
+			if (usage > part->table->segment_sz)
+				partition_writeout_buffer(part);
+
+			/* write out the largest buffer, if total usage is too large */
+			while (partition_usage > partition_mem_limit)
+			{
+				pgsqlPartition *curr, *victim = NULL;
+
+				for (curr = partition_list; curr != NULL; curr = curr->chain)
+				{
+					if (curr->usage > 0 &&
+						(!victim || curr->usage > victim->usage))
+						victim = curr;
+				}
+				assert(victim != NULL);
+				partition_writeout_buffer(victim);
+			}
+		}
 		PQclear(res);
-		res = pgsql_next_result(conn);
+		res = pgsql_next_result(conn, false);
 	} while (res != NULL);
 	pgsql_end_query(conn);
-	pgsql_writeout_buffer(table);
-	nbytes = writeArrowFooter(table);
 
+	for (part = partition_list; part != NULL; part = part->chain)
+	{
+		partition_writeout_buffer(part);
+		writeArrowFooter(part->table);
+		if (close(part->table->fdesc) != 0)
+			Elog("failed on close('%s'): %m", part->filename);
+		part->table->fdesc = -1;
+		partition_nopen--;
+	}
+
+	if (partition_ddl_parent)
+	{
+		for (part = partition_list; part != NULL; part = part->chain)
+			partition_print_ddl(part);
+	}
 	return 0;
 }
 
+/*
+ * Entrypoint of pg2arrow
+ */
+int main(int argc, char * const argv[])
+{
+	parse_options(argc, argv);
+	/* special case if '--dump <filename>' is given */
+	if (dump_arrow_filename)
+		return dumpArrowFile(dump_arrow_filename);
+	/* special case if '--parallel=N' is given */
+	if (num_workers > 1)
+		return pg2arrow_parallel_export();
+	/* special case if '--partition-key=KEY' is given */
+	if (partition_key)
+		return pg2arrow_partition_export();
+
+	return pg2arrow_export(NULL);
+}
+
 /*
  * This hash function was written by Bob Jenkins
  * (bob_jenkins@burtleburtle.net), and superficially adapted
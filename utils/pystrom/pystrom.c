@@ -445,8 +445,111 @@ bailout:
 	return ndarray;
 }
 
+/*
+ * pystrom_arrow_query
+ *
+ * It runs the query using pgstrom.arrow_query() on the supplied DB-API
+ * connection, then returns a list of pyarrow.RecordBatch.
+ */
+static PyObject *
+pystrom_arrow_query(PyObject *self, PyObject *args)
+{
+	PyObject   *conn;
+	const char *query;
+	long		batch_rows = 0;
+	PyObject   *mod_pyarrow = NULL;
+	PyObject   *mod_ipc = NULL;
+	PyObject   *cursor = NULL;
+	PyObject   *temp = NULL;
+	PyObject   *result = NULL;
+
+	if (!PyArg_ParseTuple(args, "Os|l", &conn, &query, &batch_rows))
+		return NULL;
+
+	mod_pyarrow = PyImport_ImportModule("pyarrow");
+	if (!mod_pyarrow)
+	{
+		PyErr_Format(PyExc_SystemError, "could not import 'pyarrow' module");
+		goto bailout;
+	}
+	mod_ipc = PyObject_GetAttrString(mod_pyarrow, "ipc");
+	if (!mod_ipc)
+	{
+		PyErr_Format(PyExc_SystemError, "pyarrow.ipc was not found");
+		goto bailout;
+	}
+	cursor = PyObject_CallMethod(conn, "cursor", NULL);
+	if (!cursor)
+		goto bailout;
+	temp = PyObject_CallMethod(cursor, "execute", "(s (s l))",
+							   "SELECT chunk FROM pgstrom.arrow_query(%s,%s)",
+							   query, batch_rows);
+	if (!temp)
+		goto bailout;
+	Py_DECREF(temp);
+
+	result = PyList_New(0);
+	if (!result)
+		goto bailout;
+	for (;;)
+	{
+		PyObject   *row;
+		PyObject   *buffer;
+		PyObject   *reader;
+		PyObject   *rbatch;
+
+		row = PyObject_CallMethod(cursor, "fetchone", NULL);
+		if (!row)
+			goto error;
+		if (row == Py_None)
+		{
+			Py_DECREF(row);
+			break;
+		}
+		/* every chunk is an Arrow file with one RecordBatch */
+		buffer = PyObject_CallMethod(mod_pyarrow, "py_buffer", "(O)",
+									 PyTuple_GetItem(row, 0));
+		Py_DECREF(row);
+		if (!buffer)
+			goto error;
+		reader = PyObject_CallMethod(mod_ipc, "open_file", "(O)", buffer);
+		Py_DECREF(buffer);
+		if (!reader)
+			goto error;
+		rbatch = PyObject_CallMethod(reader, "get_batch", "(i)", 0);
+		Py_DECREF(reader);
+		if (!rbatch)
+			goto error;
+		if (PyList_Append(result, rbatch) != 0)
+		{
+			Py_DECREF(rbatch);
+			goto error;
+		}
+		Py_DECREF(rbatch);
+	}
+	goto bailout;
+
+error:
+	Py_DECREF(result);
+	result = NULL;
+bailout:
+	if (cursor)
+	{
+		temp = PyObject_CallMethod(cursor, "close", NULL);
+		if (temp)
+			Py_DECREF(temp);
+		Py_DECREF(cursor);
+	}
+	if (mod_ipc)
+		Py_DECREF(mod_ipc);
+	if (mod_pyarrow)
+		Py_DECREF(mod_pyarrow);
+	return result;
+}
+
 static PyMethodDef pystrom_methods[] = {
 	{"ipc_import", (PyCFunction)pystrom_ipc_import, METH_VARARGS, "Import Gstore_fdw as cupy.core.ndarray"},
+	{"arrow_query", (PyCFunction)pystrom_arrow_query, METH_VARARGS, "Run query and fetch the results as pyarrow.RecordBatch"},
 	{NULL, NULL, 0, NULL},
 };
 